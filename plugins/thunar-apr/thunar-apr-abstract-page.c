@@ -52,6 +52,8 @@ static void thunar_apr_abstract_page_set_property (GObject                    *o
                                                    guint                       prop_id,
                                                    const GValue               *value,
                                                    GParamSpec                 *pspec);
+static void thunar_apr_abstract_page_load         (ThunarxPropertyPage        *property_page,
+                                                   GCancellable               *cancellable);
 static void thunar_apr_abstract_page_file_changed (ThunarAprAbstractPage      *abstract_page,
                                                    ThunarxFileInfo            *file);
 
@@ -70,13 +72,17 @@ THUNARX_DEFINE_ABSTRACT_TYPE (ThunarAprAbstractPage,
 static void
 thunar_apr_abstract_page_class_init (ThunarAprAbstractPageClass *klass)
 {
-  GObjectClass *gobject_class;
+  ThunarxPropertyPageClass *thunarxpropertypage_class;
+  GObjectClass             *gobject_class;
 
   gobject_class = G_OBJECT_CLASS (klass);
   gobject_class->dispose = thunar_apr_abstract_page_dispose;
   gobject_class->get_property = thunar_apr_abstract_page_get_property;
   gobject_class->set_property = thunar_apr_abstract_page_set_property;
 
+  thunarxpropertypage_class = THUNARX_PROPERTY_PAGE_CLASS (klass);
+  thunarxpropertypage_class->load = thunar_apr_abstract_page_load;
+
   /**
    * ThunarAprAbstractPage:file:
    *
@@ -176,10 +182,28 @@ thunar_apr_abstract_page_set_property (GObject      *object,
 
 
 
+static void
+thunar_apr_abstract_page_load (ThunarxPropertyPage *property_page,
+                               GCancellable        *cancellable)
+{
+  ThunarAprAbstractPage *abstract_page = THUNAR_APR_ABSTRACT_PAGE (property_page);
+
+  /* the pages read the file only when the user opens them, subclasses
+   * build their widgets first and chain up here afterwards */
+  if (G_LIKELY (abstract_page->file != NULL))
+    thunar_apr_abstract_page_file_changed (abstract_page, abstract_page->file);
+}
+
+
+
 static void
 thunar_apr_abstract_page_file_changed (ThunarAprAbstractPage *abstract_page,
                                        ThunarxFileInfo       *file)
 {
+  /* nothing to update before the page was opened */
+  if (!thunarx_property_page_is_loaded (THUNARX_PROPERTY_PAGE (abstract_page)))
+    return;
+
   /* emit the "file-changed" signal */
   g_signal_emit (G_OBJECT (abstract_page), abstract_page_signals[FILE_CHANGED], 0, file);
 }
@@ -40,23 +40,32 @@
 #include <libxfce4util/libxfce4util.h>
 #include <thunar-apr/thunar-apr-desktop-page.h>
 
-/* use g_access() on win32 */
-#if defined(G_OS_WIN32)
-#include <glib/gstdio.h>
-#else
-#define g_access(filename, mode) (access ((filename), (mode)))
-#endif
+/* the edits of the page are written to the file together, SAVE_DELAY (in ms)
+ * after the last one */
+#define SAVE_DELAY (500)
+
+
 
+typedef struct _ThunarAprDesktopLoad ThunarAprDesktopLoad;
+typedef struct _ThunarAprDesktopSave ThunarAprDesktopSave;
 
 
+
+static void     thunar_apr_desktop_page_dispose          (GObject                    *object);
 static void     thunar_apr_desktop_page_finalize         (GObject                    *object);
+static void     thunar_apr_desktop_page_load             (ThunarxPropertyPage        *property_page,
+                                                          GCancellable               *cancellable);
 static void     thunar_apr_desktop_page_file_changed     (ThunarAprAbstractPage      *abstract_page,
                                                           ThunarxFileInfo            *file);
+static void     thunar_apr_desktop_page_update           (ThunarAprDesktopPage       *desktop_page,
+                                                          ThunarAprDesktopLoad       *load);
 static void     thunar_apr_desktop_page_save             (ThunarAprDesktopPage       *desktop_page,
                                                           GtkWidget                  *widget);
-static void     thunar_apr_desktop_page_save_widget      (ThunarAprDesktopPage       *desktop_page,
+static void     thunar_apr_desktop_page_save_start       (ThunarAprDesktopPage       *desktop_page);
+static gboolean thunar_apr_desktop_page_save_widget      (ThunarAprDesktopPage       *desktop_page,
                                                           GtkWidget                  *widget,
-                                                          GKeyFile                   *key_file);
+                                                          ThunarAprDesktopSave       *save);
+static void     thunar_apr_desktop_save_free             (gpointer                    data);
 static void     thunar_apr_desktop_page_activated        (GtkWidget                  *entry,
                                                           ThunarAprDesktopPage       *desktop_page);
 static gboolean thunar_apr_desktop_page_focus_out_event  (GtkWidget                  *entry,
@@ -68,8 +77,6 @@ static void     thunar_apr_desktop_page_program_toggled  (GtkWidget
                                                           ThunarAprDesktopPage       *desktop_page);
 static void     thunar_apr_desktop_page_trusted_toggled  (GtkWidget                  *button,
                                                           ThunarAprDesktopPage       *desktop_page);
-static gboolean is_executable                            (GFile    *gfile,
-                                                          GError  **error);
 static gboolean set_executable                           (GFile    *gfile,
                                                           gboolean  executable,
                                                           GError  **error);
@@ -108,43 +115,52 @@ struct _ThunarAprDesktopPage
   gchar                *path_text;
   gchar                *url_text;
   gchar                *comment_text;
-};
-
-
 
-THUNARX_DEFINE_TYPE (ThunarAprDesktopPage,
-                     thunar_apr_desktop_page,
-                     THUNAR_APR_TYPE_ABSTRACT_PAGE);
+  /* the running load of the file */
+  GCancellable         *cancellable;
 
+  /* the edits not written yet, the save that is running, and
+   * whether the file changed while edits were pending */
+  ThunarAprDesktopSave *edits;
+  guint                 save_timeout_id;
+  gboolean              saving;
+  gboolean              reload_pending;
+};
 
+struct _ThunarAprDesktopLoad
+{
+  GFile    *file;
+  gboolean  check_trusted;
+
+  /* the results, key_file is %NULL if the file could not be read */
+  GKeyFile *key_file;
+  gboolean  executable;
+  gboolean  writable;
+  gboolean  trusted;
+};
 
-static gboolean
-is_executable (GFile   *gfile,
-               GError **error)
+struct _ThunarAprDesktopSave
 {
-  GError    *error_local = NULL;
-  GFileInfo *info;
-  gboolean   executable;
+  GFile    *file;
+
+  /* the new values, %NULL or -1 for the ones not edited */
+  gchar    *description_text;
+  gchar    *command_text;
+  gchar    *path_text;
+  gchar    *url_text;
+  gchar    *comment_text;
+  gint      snotify;
+  gint      terminal;
+
+  /* whether to update the checksum of the file */
+  gboolean  trusted;
+};
 
-  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
-  g_return_val_if_fail (G_IS_FILE (gfile),               FALSE);
 
-  info = g_file_query_info (gfile,
-                            G_FILE_ATTRIBUTE_ACCESS_CAN_EXECUTE,
-                            G_FILE_QUERY_INFO_NONE,
-                            NULL,
-                            &error_local);
-  if (error_local != NULL)
-    {
-      g_propagate_error (error, error_local);
-      return FALSE;
-    }
-
-  executable = g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_EXECUTE);
-  g_object_unref (info);
 
-  return executable;
-}
+THUNARX_DEFINE_TYPE (ThunarAprDesktopPage,
+                     thunar_apr_desktop_page,
+                     THUNAR_APR_TYPE_ABSTRACT_PAGE);
 
 
 
@@ -202,11 +218,16 @@ static void
 thunar_apr_desktop_page_class_init (ThunarAprDesktopPageClass *klass)
 {
   ThunarAprAbstractPageClass *thunarapr_abstract_page_class;
+  ThunarxPropertyPageClass   *thunarxpropertypage_class;
   GObjectClass               *gobject_class;
 
   gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->dispose = thunar_apr_desktop_page_dispose;
   gobject_class->finalize = thunar_apr_desktop_page_finalize;
 
+  thunarxpropertypage_class = THUNARX_PROPERTY_PAGE_CLASS (klass);
+  thunarxpropertypage_class->load = thunar_apr_desktop_page_load;
+
   thunarapr_abstract_page_class = THUNAR_APR_ABSTRACT_PAGE_CLASS (klass);
   thunarapr_abstract_page_class->file_changed = thunar_apr_desktop_page_file_changed;
 }
@@ -217,20 +238,32 @@ thunar_apr_desktop_page_class_init (ThunarAprDesktopPageClass *klass)
 static void
 thunar_apr_desktop_page_init (ThunarAprDesktopPage *desktop_page)
 {
-  AtkRelationSet *relations;
-  PangoAttribute *attribute;
-  PangoAttrList  *attr_list;
-  AtkRelation    *relation;
-  AtkObject      *object;
-  GtkWidget      *grid;
-  GtkWidget      *label;
-  GtkWidget      *spacer;
-  guint           row = 0;
-  GFile          *gfile;
-  gboolean        metadata_supported;
-
   gtk_container_set_border_width (GTK_CONTAINER (desktop_page), 12);
 
+  /* most desktop files are launchers, the real type is known once
+   * the file is read when the page is opened */
+  thunarx_property_page_set_label (THUNARX_PROPERTY_PAGE (desktop_page), _("Launcher"));
+}
+
+
+
+static void
+thunar_apr_desktop_page_load (ThunarxPropertyPage *property_page,
+                              GCancellable        *cancellable)
+{
+  ThunarAprDesktopPage *desktop_page = THUNAR_APR_DESKTOP_PAGE (property_page);
+  AtkRelationSet       *relations;
+  PangoAttribute       *attribute;
+  PangoAttrList        *attr_list;
+  AtkRelation          *relation;
+  AtkObject            *object;
+  GtkWidget            *grid;
+  GtkWidget            *label;
+  GtkWidget            *spacer;
+  guint                 row = 0;
+  GFile                *gfile;
+  gboolean              metadata_supported;
+
   /* allocate shared bold Pango attributes */
   attr_list = pango_attr_list_new ();
   attribute = pango_attr_weight_new (PANGO_WEIGHT_BOLD);
@@ -473,6 +506,9 @@ thunar_apr_desktop_page_init (ThunarAprDesktopPage *desktop_page)
 
   /* release shared bold Pango attributes */
   pango_attr_list_unref (attr_list);
+
+  /* read the file into the new widgets */
+  (*THUNARX_PROPERTY_PAGE_CLASS (thunar_apr_desktop_page_parent_class)->load) (property_page, cancellable);
 }
 
 
@@ -489,41 +525,151 @@ thunar_apr_desktop_page_finalize (GObject *object)
   g_free (desktop_page->url_text);
   g_free (desktop_page->comment_text);
 
+  /* the pending edits are written on dispose, this is just in case */
+  if (G_UNLIKELY (desktop_page->edits != NULL))
+    thunar_apr_desktop_save_free (desktop_page->edits);
+
   (*G_OBJECT_CLASS (thunar_apr_desktop_page_parent_class)->finalize) (object);
 }
 
 
 
 static void
-thunar_apr_desktop_page_file_changed (ThunarAprAbstractPage *abstract_page,
-                                      ThunarxFileInfo       *file)
+thunar_apr_desktop_page_dispose (GObject *object)
 {
-  ThunarAprDesktopPage *desktop_page = THUNAR_APR_DESKTOP_PAGE (abstract_page);
-  GKeyFile             *key_file;
-  GFile                *gfile;
-  gboolean              writable;
-  gboolean              enabled;
-  gboolean              executable;
-  gboolean              trusted;
+  ThunarAprDesktopPage *desktop_page = THUNAR_APR_DESKTOP_PAGE (object);
+
+  /* cancel the pending load when the dialog is closed, the
+   * callback won't touch the page then */
+  if (desktop_page->cancellable != NULL)
+    {
+      g_cancellable_cancel (desktop_page->cancellable);
+      g_clear_object (&desktop_page->cancellable);
+    }
+
+  /* but the pending edits are written right away */
+  if (desktop_page->save_timeout_id != 0)
+    {
+      g_source_remove (desktop_page->save_timeout_id);
+      desktop_page->save_timeout_id = 0;
+      thunar_apr_desktop_page_save_start (desktop_page);
+    }
+  desktop_page->reload_pending = FALSE;
+
+  (*G_OBJECT_CLASS (thunar_apr_desktop_page_parent_class)->dispose) (object);
+}
+
+
+
+static void
+thunar_apr_desktop_load_free (gpointer data)
+{
+  ThunarAprDesktopLoad *load = data;
+
+  if (load->key_file != NULL)
+    g_key_file_free (load->key_file);
+  g_object_unref (load->file);
+  g_slice_free (ThunarAprDesktopLoad, load);
+}
+
+
+
+/* reads the file and its flags, runs in a worker thread */
+static void
+thunar_apr_desktop_page_load_thread (GTask        *task,
+                                     gpointer      source_object,
+                                     gpointer      task_data,
+                                     GCancellable *cancellable)
+{
+  ThunarAprDesktopLoad *load = task_data;
+  GFileInfo            *info;
   GError               *error = NULL;
-  gchar                *filename;
-  gchar                *value;
-  gchar                *type;
-  gchar                *uri;
+  gchar                *contents;
+  gsize                 length;
 
-  /* allocate the key file memory */
-  key_file = g_key_file_new ();
+  if (g_file_load_contents (load->file, cancellable, &contents, &length, NULL, NULL))
+    {
+      load->key_file = g_key_file_new ();
+      if (!g_key_file_load_from_data (load->key_file, contents, length, G_KEY_FILE_NONE, NULL))
+        {
+          g_key_file_free (load->key_file);
+          load->key_file = NULL;
+        }
+      g_free (contents);
+    }
 
-  /* determine the local path to the file */
-  uri = thunarx_file_info_get_uri (file);
-  filename = g_filename_from_uri (uri, NULL, NULL);
-  g_free (uri);
+  if (load->key_file != NULL)
+    {
+      info = g_file_query_info (load->file,
+                                G_FILE_ATTRIBUTE_ACCESS_CAN_EXECUTE ","
+                                G_FILE_ATTRIBUTE_ACCESS_CAN_WRITE,
+                                G_FILE_QUERY_INFO_NONE,
+                                cancellable,
+                                &error);
+      if (G_LIKELY (info != NULL))
+        {
+          load->executable = g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_EXECUTE);
+          load->writable = g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_WRITE);
+          g_object_unref (info);
+        }
+      else
+        {
+          g_warning ("Failed to initialize program_button : %s", error->message);
+          g_clear_error (&error);
+        }
+
+      if (load->check_trusted)
+        {
+          load->trusted = xfce_g_file_is_trusted (load->file, cancellable, &error);
+          if (error != NULL)
+            {
+              g_warning ("Failed to initialize trusted_button : %s", error->message);
+              g_clear_error (&error);
+            }
+        }
+    }
+
+  g_task_return_boolean (task, TRUE);
+}
+
+
+
+static void
+thunar_apr_desktop_page_load_done (GObject      *object,
+                                   GAsyncResult *result,
+                                   gpointer      user_data)
+{
+  ThunarAprDesktopPage *desktop_page = THUNAR_APR_DESKTOP_PAGE (object);
+  GError               *error = NULL;
+
+  /* the page was closed, or the file changed again meanwhile */
+  if (!g_task_propagate_boolean (G_TASK (result), &error))
+    {
+      g_error_free (error);
+      return;
+    }
+
+  g_clear_object (&desktop_page->cancellable);
+
+  thunar_apr_desktop_page_update (desktop_page, g_task_get_task_data (G_TASK (result)));
+}
+
+
+
+static void
+thunar_apr_desktop_page_update (ThunarAprDesktopPage *desktop_page,
+                                ThunarAprDesktopLoad *load)
+{
+  gboolean writable;
+  gboolean enabled;
+  GError  *error = NULL;
+  gchar   *value;
+  gchar   *type;
 
-  /* try to load the file contents */
-  if (filename != NULL && g_key_file_load_from_file (key_file, filename, G_KEY_FILE_NONE, NULL))
+  if (G_LIKELY (load->key_file != NULL))
     {
       /* determine the type of the .desktop file (default to "Application") */
-      type = g_key_file_get_string (key_file, G_KEY_FILE_DESKTOP_GROUP, "Type", NULL);
+      type = g_key_file_get_string (load->key_file, G_KEY_FILE_DESKTOP_GROUP, "Type", NULL);
       if (G_UNLIKELY (type == NULL))
         type = g_strdup ("Application");
 
@@ -536,7 +682,7 @@ thunar_apr_desktop_page_file_changed (ThunarAprAbstractPage *abstract_page,
         thunarx_property_page_set_label (THUNARX_PROPERTY_PAGE (desktop_page), type);
 
       /* update the "Description" entry */
-      value = g_key_file_get_locale_string (key_file, G_KEY_FILE_DESKTOP_GROUP, "GenericName", NULL, NULL);
+      value = g_key_file_get_locale_string (load->key_file, G_KEY_FILE_DESKTOP_GROUP, "GenericName", NULL, NULL);
       if (g_strcmp0 (value, desktop_page->description_text) != 0)
         {
           /* update the entry */
@@ -552,7 +698,7 @@ thunar_apr_desktop_page_file_changed (ThunarAprAbstractPage *abstract_page,
         }
 
       /* update the "Comment" entry */
-      value = g_key_file_get_locale_string (key_file, G_KEY_FILE_DESKTOP_GROUP, "Comment", NULL, NULL);
+      value = g_key_file_get_locale_string (load->key_file, G_KEY_FILE_DESKTOP_GROUP, "Comment", NULL, NULL);
       if (g_strcmp0 (value, desktop_page->comment_text) != 0)
         {
           /* update the entry */
@@ -571,7 +717,7 @@ thunar_apr_desktop_page_file_changed (ThunarAprAbstractPage *abstract_page,
       if (strcmp (type, "Application") == 0)
         {
           /* update the "Command" entry but but ignore escape sequences */
-          value = g_key_file_get_value (key_file, G_KEY_FILE_DESKTOP_GROUP, G_KEY_FILE_DESKTOP_KEY_EXEC, NULL);
+          value = g_key_file_get_value (load->key_file, G_KEY_FILE_DESKTOP_GROUP, G_KEY_FILE_DESKTOP_KEY_EXEC, NULL);
           if (g_strcmp0 (value, desktop_page->command_text) != 0)
             {
               /* update the entry */
@@ -587,7 +733,7 @@ thunar_apr_desktop_page_file_changed (ThunarAprAbstractPage *abstract_page,
             }
 
           /* update the "Path" entry */
-          value = g_key_file_get_string (key_file, G_KEY_FILE_DESKTOP_GROUP, "Path", NULL);
+          value = g_key_file_get_string (load->key_file, G_KEY_FILE_DESKTOP_GROUP, "Path", NULL);
           if (g_strcmp0 (value, desktop_page->path_text) != 0)
             {
               /* update the entry */
@@ -603,14 +749,14 @@ thunar_apr_desktop_page_file_changed (ThunarAprAbstractPage *abstract_page,
             }
 
           /* update the "Use startup notification" button */
-          enabled = g_key_file_get_boolean (key_file, G_KEY_FILE_DESKTOP_GROUP, "StartupNotify", &error);
+          enabled = g_key_file_get_boolean (load->key_file, G_KEY_FILE_DESKTOP_GROUP, "StartupNotify", &error);
           g_signal_handlers_block_by_func (G_OBJECT (desktop_page->snotify_button), thunar_apr_desktop_page_toggled, desktop_page);
           gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (desktop_page->snotify_button), (error == NULL && enabled));
           g_signal_handlers_unblock_by_func (G_OBJECT (desktop_page->snotify_button), thunar_apr_desktop_page_toggled, desktop_page);
           g_clear_error (&error);
 
           /* update the "Run in terminal" button */
-          enabled = g_key_file_get_boolean (key_file, G_KEY_FILE_DESKTOP_GROUP, "Terminal", &error);
+          enabled = g_key_file_get_boolean (load->key_file, G_KEY_FILE_DESKTOP_GROUP, "Terminal", &error);
           g_signal_handlers_block_by_func (G_OBJECT (desktop_page->terminal_button), thunar_apr_desktop_page_toggled, desktop_page);
           gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (desktop_page->terminal_button), (error == NULL && enabled));
           g_signal_handlers_unblock_by_func (G_OBJECT (desktop_page->terminal_button), thunar_apr_desktop_page_toggled, desktop_page);
@@ -626,7 +772,7 @@ thunar_apr_desktop_page_file_changed (ThunarAprAbstractPage *abstract_page,
       else if (strcmp (type, "Link") == 0)
         {
           /* update the "URL" entry */
-          value = g_key_file_get_string (key_file, G_KEY_FILE_DESKTOP_GROUP, "URL", NULL);
+          value = g_key_file_get_string (load->key_file, G_KEY_FILE_DESKTOP_GROUP, "URL", NULL);
           if (g_strcmp0 (value, desktop_page->url_text) != 0)
             {
               /* update the entry */
@@ -658,37 +804,25 @@ thunar_apr_desktop_page_file_changed (ThunarAprAbstractPage *abstract_page,
           gtk_widget_hide (desktop_page->terminal_button);
         }
 
-      /* update flags */
-      gfile = thunarx_file_info_get_location (abstract_page->file);
-
-      executable = is_executable (gfile, &error);
-      if (error != NULL)
-        {
-          g_warning ("Failed to initialize program_button : %s", error->message);
-          g_clear_error (&error);
-        }
-      gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (desktop_page->program_button), executable);
+      /* update flags, the handlers would write the same values back */
+      g_signal_handlers_block_by_func (G_OBJECT (desktop_page->program_button), thunar_apr_desktop_page_program_toggled, desktop_page);
+      gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (desktop_page->program_button), load->executable);
+      g_signal_handlers_unblock_by_func (G_OBJECT (desktop_page->program_button), thunar_apr_desktop_page_program_toggled, desktop_page);
 
       if (desktop_page->trusted_button != NULL)
         {
-          trusted = xfce_g_file_is_trusted (gfile, NULL, &error);
-          if (error != NULL)
-            {
-              g_warning ("Failed to initialize trusted_button : %s", error->message);
-              g_clear_error (&error);
-            }
-          gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (desktop_page->trusted_button), trusted);
+          g_signal_handlers_block_by_func (G_OBJECT (desktop_page->trusted_button), thunar_apr_desktop_page_trusted_toggled, desktop_page);
+          gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (desktop_page->trusted_button), load->trusted);
+          g_signal_handlers_unblock_by_func (G_OBJECT (desktop_page->trusted_button), thunar_apr_desktop_page_trusted_toggled, desktop_page);
         }
 
-      g_object_unref (gfile);
-
       /* show security */
       gtk_widget_show (desktop_page->program_button);
       if (desktop_page->trusted_button != NULL)
         gtk_widget_show (desktop_page->trusted_button);
 
-      /* check if the file is writable... */
-      writable = (g_access (filename, W_OK) == 0);
+      /* the file is writable... */
+      writable = load->writable;
 
       /* ...and update the editability of the entries */
       gtk_editable_set_editable (GTK_EDITABLE (desktop_page->description_entry), writable);
@@ -722,117 +856,60 @@ thunar_apr_desktop_page_file_changed (ThunarAprAbstractPage *abstract_page,
       if (desktop_page->trusted_button != NULL)
         gtk_widget_hide (desktop_page->trusted_button);
     }
-
-  /* cleanup */
-  g_key_file_free (key_file);
-  g_free (filename);
 }
 
 
 
 static void
-thunar_apr_desktop_page_save (ThunarAprDesktopPage *desktop_page,
-                              GtkWidget            *widget)
+thunar_apr_desktop_page_file_changed (ThunarAprAbstractPage *abstract_page,
+                                      ThunarxFileInfo       *file)
 {
-  GtkWidget *toplevel;
-  GtkWidget *message;
-  GKeyFile  *key_file;
-  GError    *error = NULL;
-  gchar     *filename;
-  gchar     *data;
-  gchar     *uri;
-  gsize      data_length;
-  FILE      *fp;
-  GFile     *gfile;
-  gboolean   trusted;
-
-  /* verify that we still have a valid file */
-  if (THUNAR_APR_ABSTRACT_PAGE (desktop_page)->file == NULL)
-    return;
-
-  /* determine the local path to the file */
-  uri = thunarx_file_info_get_uri (THUNAR_APR_ABSTRACT_PAGE (desktop_page)->file);
-  filename = g_filename_from_uri (uri, NULL, NULL);
-  g_free (uri);
-
-  /* verify that we have a valid local path */
-  if (G_UNLIKELY (filename == NULL))
-    return;
-
-  /* allocate the key file resources */
-  key_file = g_key_file_new ();
+  ThunarAprDesktopPage *desktop_page = THUNAR_APR_DESKTOP_PAGE (abstract_page);
+  ThunarAprDesktopLoad *load;
+  GTask                *task;
 
-  /* try to parse the key file */
-  if (g_key_file_load_from_file (key_file, filename, G_KEY_FILE_KEEP_COMMENTS | G_KEY_FILE_KEEP_TRANSLATIONS, &error))
+  /* read the file again once the pending edits are written, the
+   * toggle buttons would show the old values until then otherwise */
+  if (desktop_page->save_timeout_id != 0 || desktop_page->saving)
     {
-      /* save the widget changes to the key file */
-      thunar_apr_desktop_page_save_widget (desktop_page, widget, key_file);
-
-      /* give empty desktop files a type */
-      if (!g_key_file_has_key (key_file, G_KEY_FILE_DESKTOP_GROUP,
-                               G_KEY_FILE_DESKTOP_KEY_TYPE, NULL))
-        {
-          g_key_file_set_string (key_file,
-                                 G_KEY_FILE_DESKTOP_GROUP,
-                                 G_KEY_FILE_DESKTOP_KEY_TYPE,
-                                 "Application");
-        }
-
-      /* determine the content of the key file */
-      data = g_key_file_to_data (key_file, &data_length, &error);
-      if (G_LIKELY (data_length > 0))
-        {
-          trusted = FALSE;
-          if (desktop_page->trusted_button != NULL)
-            trusted  = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (desktop_page->trusted_button));
-
-          /* try to save the key file content to disk */
-          fp = fopen (filename, "w");
-          if (G_LIKELY (fp != NULL))
-            {
-              if (fwrite (data, data_length, 1, fp) != 1)
-                error = g_error_new_literal (G_FILE_ERROR, g_file_error_from_errno (errno), g_strerror (errno));
-              fclose (fp);
-            }
-          else
-            {
-              error = g_error_new_literal (G_FILE_ERROR, g_file_error_from_errno (errno), g_strerror (errno));
-            }
-
-          /* Update safety flag checksum */
-          if (trusted && error == NULL)
-            {
-              gfile = thunarx_file_info_get_location (THUNAR_APR_ABSTRACT_PAGE (desktop_page)->file);
-              xfce_g_file_set_trusted (gfile, trusted, NULL, &error);
-              g_object_unref (gfile);
-            }
-        }
-
-      /* cleanup */
-      g_free (data);
+      desktop_page->reload_pending = TRUE;
+      return;
     }
 
-  /* check if we succeed */
-  if (G_UNLIKELY (error != NULL))
+  /* cancel the previous load */
+  if (desktop_page->cancellable != NULL)
     {
-      /* display an error dialog to the user */
-      toplevel = gtk_widget_get_toplevel (GTK_WIDGET (desktop_page));
-      message = gtk_message_dialog_new ((GtkWindow *) toplevel,
-                                        GTK_DIALOG_DESTROY_WITH_PARENT
-                                        | GTK_DIALOG_MODAL,
-                                        GTK_MESSAGE_ERROR,
-                                        GTK_BUTTONS_CLOSE,
-                                        _("Failed to save \"%s\"."), filename);
-      gtk_window_set_title (GTK_WINDOW (message), _("Error"));
-      gtk_message_dialog_format_secondary_text (GTK_MESSAGE_DIALOG (message), "%s.", error->message);
-      gtk_dialog_run (GTK_DIALOG (message));
-      gtk_widget_destroy (message);
-      g_error_free (error);
+      g_cancellable_cancel (desktop_page->cancellable);
+      g_object_unref (G_OBJECT (desktop_page->cancellable));
     }
 
-  /* cleanup */
-  g_key_file_free (key_file);
-  g_free (filename);
+  load = g_slice_new0 (ThunarAprDesktopLoad);
+  load->file = thunarx_file_info_get_location (file);
+  load->check_trusted = (desktop_page->trusted_button != NULL);
+
+  /* the file is read in a worker thread, launchers on a network home
+   * would block the dialog otherwise */
+  desktop_page->cancellable = g_cancellable_new ();
+  task = g_task_new (desktop_page, desktop_page->cancellable, thunar_apr_desktop_page_load_done, NULL);
+  g_task_set_task_data (task, load, thunar_apr_desktop_load_free);
+  g_task_run_in_thread (task, thunar_apr_desktop_page_load_thread);
+  g_object_unref (task);
+}
+
+
+
+static void
+thunar_apr_desktop_save_free (gpointer data)
+{
+  ThunarAprDesktopSave *save = data;
+
+  g_object_unref (save->file);
+  g_free (save->description_text);
+  g_free (save->command_text);
+  g_free (save->path_text);
+  g_free (save->url_text);
+  g_free (save->comment_text);
+  g_slice_free (ThunarAprDesktopSave, save);
 }
 
 
@@ -865,116 +942,276 @@ thunar_apr_desktop_page_set_string (GKeyFile    *key_file,
 
 
 static void
-thunar_apr_desktop_page_save_widget (ThunarAprDesktopPage *desktop_page,
-                                     GtkWidget            *widget,
-                                     GKeyFile             *key_file)
+thunar_apr_desktop_page_set_locale_string (GKeyFile    *key_file,
+                                           const gchar *key,
+                                           const gchar *value)
 {
   const gchar * const *locale;
-  gchar               *key;
+  gchar               *locale_key;
 
-  if (widget == desktop_page->description_entry)
+  /* save the new value localized if required */
+  for (locale = g_get_language_names (); *locale != NULL; ++locale)
     {
-      /* update the saved description text */
-      g_free (desktop_page->description_text);
-      desktop_page->description_text = gtk_editable_get_chars (GTK_EDITABLE (widget), 0, -1);
+      locale_key = g_strdup_printf ("%s[%s]", key, *locale);
+      if (g_key_file_has_key (key_file, G_KEY_FILE_DESKTOP_GROUP, locale_key, NULL))
+        {
+          thunar_apr_desktop_page_set_string (key_file, locale_key, value);
+          g_free (locale_key);
+          return;
+        }
+      g_free (locale_key);
+    }
+
+  /* fallback to the unlocalized value */
+  thunar_apr_desktop_page_set_string (key_file, key, value);
+}
+
+
 
-      /* save the new description (localized if required) */
-      for (locale = g_get_language_names (); *locale != NULL; ++locale)
+/* writes the edits to the file and updates its checksum, runs in a worker thread */
+static void
+thunar_apr_desktop_page_save_thread (GTask        *task,
+                                     gpointer      source_object,
+                                     gpointer      task_data,
+                                     GCancellable *cancellable)
+{
+  ThunarAprDesktopSave *save = task_data;
+  GKeyFile             *key_file;
+  GError               *error = NULL;
+  gchar                *contents;
+  gchar                *data;
+  gsize                 length;
+
+  /* the edits are applied to the current contents of the file */
+  if (g_file_load_contents (save->file, NULL, &contents, &length, NULL, &error))
+    {
+      key_file = g_key_file_new ();
+      if (g_key_file_load_from_data (key_file, contents, length, G_KEY_FILE_KEEP_COMMENTS | G_KEY_FILE_KEEP_TRANSLATIONS, &error))
         {
-          key = g_strdup_printf (G_KEY_FILE_DESKTOP_KEY_GENERIC_NAME "[%s]", *locale);
-          if (g_key_file_has_key (key_file, G_KEY_FILE_DESKTOP_GROUP, key, NULL))
+          if (save->description_text != NULL)
+            thunar_apr_desktop_page_set_locale_string (key_file, G_KEY_FILE_DESKTOP_KEY_GENERIC_NAME, save->description_text);
+          if (save->command_text != NULL)
+            thunar_apr_desktop_page_set_string (key_file, G_KEY_FILE_DESKTOP_KEY_EXEC, save->command_text);
+          if (save->path_text != NULL)
+            thunar_apr_desktop_page_set_string (key_file, G_KEY_FILE_DESKTOP_KEY_PATH, save->path_text);
+          if (save->url_text != NULL)
+            thunar_apr_desktop_page_set_string (key_file, G_KEY_FILE_DESKTOP_KEY_URL, save->url_text);
+          if (save->comment_text != NULL)
+            thunar_apr_desktop_page_set_locale_string (key_file, G_KEY_FILE_DESKTOP_KEY_COMMENT, save->comment_text);
+          if (save->snotify >= 0)
+            g_key_file_set_boolean (key_file, G_KEY_FILE_DESKTOP_GROUP, G_KEY_FILE_DESKTOP_KEY_STARTUP_NOTIFY, save->snotify);
+          if (save->terminal >= 0)
+            g_key_file_set_boolean (key_file, G_KEY_FILE_DESKTOP_GROUP, G_KEY_FILE_DESKTOP_KEY_TERMINAL, save->terminal);
+
+          /* give empty desktop files a type */
+          if (!g_key_file_has_key (key_file, G_KEY_FILE_DESKTOP_GROUP,
+                                   G_KEY_FILE_DESKTOP_KEY_TYPE, NULL))
             {
-              thunar_apr_desktop_page_set_string (key_file, key, desktop_page->description_text);
-              g_free (key);
-              break;
+              g_key_file_set_string (key_file,
+                                     G_KEY_FILE_DESKTOP_GROUP,
+                                     G_KEY_FILE_DESKTOP_KEY_TYPE,
+                                     "Application");
             }
-          g_free (key);
-        }
 
-      /* fallback to unlocalized description */
-      if (G_UNLIKELY (*locale == NULL))
-        {
-          thunar_apr_desktop_page_set_string (key_file,
-                                              G_KEY_FILE_DESKTOP_KEY_GENERIC_NAME,
-                                              desktop_page->description_text);
+          /* the new contents replace the file only once they are written
+           * completely, and the checksum follows before anyone sees them */
+          data = g_key_file_to_data (key_file, &length, NULL);
+          if (G_LIKELY (length > 0)
+              && g_file_replace_contents (save->file, data, length, NULL, FALSE,
+                                          G_FILE_CREATE_NONE, NULL, NULL, &error)
+              && save->trusted)
+            {
+              xfce_g_file_set_trusted (save->file, TRUE, NULL, &error);
+            }
+          g_free (data);
         }
+      g_key_file_free (key_file);
+      g_free (contents);
     }
-  else if (widget == desktop_page->command_entry)
+
+  if (G_UNLIKELY (error != NULL))
+    g_task_return_error (task, error);
+  else
+    g_task_return_boolean (task, TRUE);
+}
+
+
+
+static void
+thunar_apr_desktop_page_save_done (GObject      *object,
+                                   GAsyncResult *result,
+                                   gpointer      user_data)
+{
+  ThunarAprDesktopPage *desktop_page = THUNAR_APR_DESKTOP_PAGE (object);
+  ThunarAprDesktopSave *save = g_task_get_task_data (G_TASK (result));
+  GtkWidget            *toplevel;
+  GtkWidget            *message;
+  GError               *error = NULL;
+  gchar                *display_name;
+
+  desktop_page->saving = FALSE;
+
+  /* check if we succeed */
+  if (G_UNLIKELY (!g_task_propagate_boolean (G_TASK (result), &error)))
     {
-      /* update the saved command */
-      g_free (desktop_page->command_text);
-      desktop_page->command_text = gtk_editable_get_chars (GTK_EDITABLE (widget), 0, -1);
-
-      /* save the unlocalized command */
-      thunar_apr_desktop_page_set_string (key_file,
-                                          G_KEY_FILE_DESKTOP_KEY_EXEC,
-                                          desktop_page->command_text);
+      /* display an error dialog to the user */
+      toplevel = gtk_widget_get_toplevel (GTK_WIDGET (desktop_page));
+      display_name = g_file_get_parse_name (save->file);
+      message = gtk_message_dialog_new (gtk_widget_is_toplevel (toplevel) ? GTK_WINDOW (toplevel) : NULL,
+                                        GTK_DIALOG_DESTROY_WITH_PARENT
+                                        | GTK_DIALOG_MODAL,
+                                        GTK_MESSAGE_ERROR,
+                                        GTK_BUTTONS_CLOSE,
+                                        _("Failed to save \"%s\"."), display_name);
+      gtk_window_set_title (GTK_WINDOW (message), _("Error"));
+      gtk_message_dialog_format_secondary_text (GTK_MESSAGE_DIALOG (message), "%s.", error->message);
+      gtk_dialog_run (GTK_DIALOG (message));
+      gtk_widget_destroy (message);
+      g_free (display_name);
+      g_error_free (error);
     }
-  else if (widget == desktop_page->path_entry)
+
+  /* the edits made while the file was written */
+  if (desktop_page->save_timeout_id == 0)
+    thunar_apr_desktop_page_save_start (desktop_page);
+
+  /* and the changes held back meanwhile */
+  if (desktop_page->reload_pending
+      && desktop_page->save_timeout_id == 0
+      && !desktop_page->saving
+      && THUNAR_APR_ABSTRACT_PAGE (desktop_page)->file != NULL)
     {
-      /* update the saved command */
-      g_free (desktop_page->path_text);
-      desktop_page->path_text = gtk_editable_get_chars (GTK_EDITABLE (widget), 0, -1);
-
-      /* save the unlocalized command */
-      thunar_apr_desktop_page_set_string (key_file,
-                                          G_KEY_FILE_DESKTOP_KEY_PATH,
-                                          desktop_page->path_text);
+      desktop_page->reload_pending = FALSE;
+      thunar_apr_desktop_page_file_changed (THUNAR_APR_ABSTRACT_PAGE (desktop_page),
+                                            THUNAR_APR_ABSTRACT_PAGE (desktop_page)->file);
     }
-  else if (widget == desktop_page->url_entry)
+}
+
+
+
+static void
+thunar_apr_desktop_page_save_start (ThunarAprDesktopPage *desktop_page)
+{
+  GTask *task;
+
+  /* one save at a time, the edits made meanwhile follow it */
+  if (desktop_page->saving || desktop_page->edits == NULL)
+    return;
+
+  desktop_page->saving = TRUE;
+
+  task = g_task_new (desktop_page, NULL, thunar_apr_desktop_page_save_done, NULL);
+  g_task_set_task_data (task, desktop_page->edits, thunar_apr_desktop_save_free);
+  g_task_run_in_thread (task, thunar_apr_desktop_page_save_thread);
+  g_object_unref (task);
+
+  desktop_page->edits = NULL;
+}
+
+
+
+static gboolean
+thunar_apr_desktop_page_save_timeout (gpointer user_data)
+{
+  ThunarAprDesktopPage *desktop_page = THUNAR_APR_DESKTOP_PAGE (user_data);
+
+  desktop_page->save_timeout_id = 0;
+  thunar_apr_desktop_page_save_start (desktop_page);
+
+  return FALSE;
+}
+
+
+
+static void
+thunar_apr_desktop_page_save (ThunarAprDesktopPage *desktop_page,
+                              GtkWidget            *widget)
+{
+  ThunarAprDesktopSave *save;
+
+  /* verify that we still have a valid file */
+  if (THUNAR_APR_ABSTRACT_PAGE (desktop_page)->file == NULL)
+    return;
+
+  save = desktop_page->edits;
+  if (save == NULL)
     {
-      /* update the saved URL */
-      g_free (desktop_page->url_text);
-      desktop_page->url_text = gtk_editable_get_chars (GTK_EDITABLE (widget), 0, -1);
-
-      /* save the unlocalized url */
-      thunar_apr_desktop_page_set_string (key_file,
-                                          G_KEY_FILE_DESKTOP_KEY_URL,
-                                          desktop_page->url_text);
+      save = g_slice_new0 (ThunarAprDesktopSave);
+      save->file = thunarx_file_info_get_location (THUNAR_APR_ABSTRACT_PAGE (desktop_page)->file);
+      save->snotify = -1;
+      save->terminal = -1;
     }
-  else if (widget == desktop_page->comment_entry)
+
+  /* remember the widget changes for the next save */
+  if (!thunar_apr_desktop_page_save_widget (desktop_page, widget, save))
     {
-      /* update the saved comment text */
-      g_free (desktop_page->comment_text);
-      desktop_page->comment_text = gtk_editable_get_chars (GTK_EDITABLE (widget), 0, -1);
+      if (save != desktop_page->edits)
+        thunar_apr_desktop_save_free (save);
+      return;
+    }
 
-      /* save the new comment (localized if required) */
-      for (locale = g_get_language_names (); *locale != NULL; ++locale)
-        {
-          key = g_strdup_printf (G_KEY_FILE_DESKTOP_KEY_COMMENT "[%s]", *locale);
-          if (g_key_file_has_key (key_file, G_KEY_FILE_DESKTOP_GROUP, key, NULL))
-            {
-              thunar_apr_desktop_page_set_string (key_file, key, desktop_page->comment_text);
-              g_free (key);
-              break;
-            }
-          g_free (key);
-        }
+  desktop_page->edits = save;
+  save->trusted = (desktop_page->trusted_button != NULL)
+                  && gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (desktop_page->trusted_button));
 
-      /* fallback to unlocalized comment */
-      if (G_UNLIKELY (*locale == NULL))
-        thunar_apr_desktop_page_set_string (key_file,
-                                            G_KEY_FILE_DESKTOP_KEY_COMMENT,
-                                            desktop_page->comment_text);
-    }
-  else if (widget == desktop_page->snotify_button)
+  /* the edits of the next moments are written to the file in one go */
+  if (desktop_page->save_timeout_id != 0)
+    g_source_remove (desktop_page->save_timeout_id);
+  desktop_page->save_timeout_id = g_timeout_add (SAVE_DELAY, thunar_apr_desktop_page_save_timeout, desktop_page);
+}
+
+
+
+static gboolean
+thunar_apr_desktop_page_save_text (gchar       **saved_text,
+                                   gchar       **save_text,
+                                   GtkWidget    *entry)
+{
+  gchar *text;
+
+  /* nothing to save if the text is still the one in the file */
+  text = gtk_editable_get_chars (GTK_EDITABLE (entry), 0, -1);
+  if (g_strcmp0 (text, *saved_text) == 0)
     {
-      g_key_file_set_boolean (key_file,
-                              G_KEY_FILE_DESKTOP_GROUP,
-                              G_KEY_FILE_DESKTOP_KEY_STARTUP_NOTIFY,
-                              gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (widget)));
+      g_free (text);
+      return FALSE;
     }
+
+  /* update the saved text */
+  g_free (*saved_text);
+  *saved_text = text;
+
+  g_free (*save_text);
+  *save_text = g_strdup (text);
+
+  return TRUE;
+}
+
+
+
+static gboolean
+thunar_apr_desktop_page_save_widget (ThunarAprDesktopPage *desktop_page,
+                                     GtkWidget            *widget,
+                                     ThunarAprDesktopSave *save)
+{
+  if (widget == desktop_page->description_entry)
+    return thunar_apr_desktop_page_save_text (&desktop_page->description_text, &save->description_text, widget);
+  else if (widget == desktop_page->command_entry)
+    return thunar_apr_desktop_page_save_text (&desktop_page->command_text, &save->command_text, widget);
+  else if (widget == desktop_page->path_entry)
+    return thunar_apr_desktop_page_save_text (&desktop_page->path_text, &save->path_text, widget);
+  else if (widget == desktop_page->url_entry)
+    return thunar_apr_desktop_page_save_text (&desktop_page->url_text, &save->url_text, widget);
+  else if (widget == desktop_page->comment_entry)
+    return thunar_apr_desktop_page_save_text (&desktop_page->comment_text, &save->comment_text, widget);
+  else if (widget == desktop_page->snotify_button)
+    save->snotify = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (widget));
   else if (widget == desktop_page->terminal_button)
-    {
-      g_key_file_set_boolean (key_file,
-                              G_KEY_FILE_DESKTOP_GROUP,
-                              G_KEY_FILE_DESKTOP_KEY_TERMINAL,
-                              gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (widget)));
-    }
+    save->terminal = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (widget));
   else
-    {
-      g_assert_not_reached ();
-    }
+    g_assert_not_reached ();
+
+  return TRUE;
 }
 
 
@@ -1089,6 +1326,10 @@ thunar_apr_desktop_page_trusted_toggled (GtkWidget            *button,
   trusted  = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON (desktop_page->trusted_button));
   xfce_g_file_set_trusted (gfile, trusted, NULL, &error);
 
+  /* the pending edits keep the new state */
+  if (desktop_page->edits != NULL)
+    desktop_page->edits->trusted = trusted;
+
   g_object_unref (gfile);
 
   if (error != NULL)
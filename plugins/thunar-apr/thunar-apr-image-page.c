@@ -26,14 +26,16 @@
 
 #include <thunar-apr/thunar-apr-image-page.h>
 
-#ifdef HAVE_EXIF
-#include <libexif/exif-data.h>
-#endif
-
 
 
+static void thunar_apr_image_page_dispose       (GObject                  *object);
+static void thunar_apr_image_page_load          (ThunarxPropertyPage      *property_page,
+                                                 GCancellable             *cancellable);
 static void thunar_apr_image_page_file_changed  (ThunarAprAbstractPage    *abstract_page,
                                                  ThunarxFileInfo          *file);
+static void thunar_apr_image_page_metadata_done (GObject                  *object,
+                                                 GAsyncResult             *result,
+                                                 gpointer                  user_data);
 
 
 
@@ -41,25 +43,24 @@ static void thunar_apr_image_page_file_changed  (ThunarAprAbstractPage    *abstr
 static const struct
 {
   const gchar *name;
-  ExifTag      tag;
+  const gchar *tag;
 } TAIP_EXIF[] =
 {
-  { N_ ("Date Taken:"),        EXIF_TAG_DATE_TIME_ORIGINAL,  },
-  { N_ ("Camera Brand:"),      EXIF_TAG_MAKE,                },
-  { N_ ("Camera Model:"),      EXIF_TAG_MODEL,               },
-  { N_ ("Exposure Time:"),     EXIF_TAG_EXPOSURE_TIME,       },
-  { N_ ("Exposure Program:"),  EXIF_TAG_EXPOSURE_PROGRAM,    },
-  { N_ ("Aperture Value:"),    EXIF_TAG_APERTURE_VALUE,      },
-  { N_ ("Metering Mode:"),     EXIF_TAG_METERING_MODE,       },
-  { N_ ("Flash Fired:"),       EXIF_TAG_FLASH,               },
-  { N_ ("Focal Length:"),      EXIF_TAG_FOCAL_LENGTH,        },
-  { N_ ("Shutter Speed:"),     EXIF_TAG_SHUTTER_SPEED_VALUE, },
-  { N_ ("ISO Speed Ratings:"), EXIF_TAG_ISO_SPEED_RATINGS,   },
-  { N_ ("Software:"),          EXIF_TAG_SOFTWARE,            },
-  { N_ ("Description:"),       EXIF_TAG_IMAGE_DESCRIPTION,   },
-  { N_ ("Comment:"),           EXIF_TAG_USER_COMMENT,        },
-};
-#endif
+  { N_ ("Date Taken:"),        "DateTimeOriginal",  },
+  { N_ ("Camera Brand:"),      "Make",              },
+  { N_ ("Camera Model:"),      "Model",             },
+  { N_ ("Exposure Time:"),     "ExposureTime",      },
+  { N_ ("Exposure Program:"),  "ExposureProgram",   },
+  { N_ ("Aperture Value:"),    "ApertureValue",     },
+  { N_ ("Metering Mode:"),     "MeteringMode",      },
+  { N_ ("Flash Fired:"),       "Flash",             },
+  { N_ ("Focal Length:"),      "FocalLength",       },
+  { N_ ("Shutter Speed:"),     "ShutterSpeedValue", },
+  { N_ ("ISO Speed Ratings:"), "ISOSpeedRatings",   },
+  { N_ ("Software:"),          "Software",          },
+  { N_ ("Description:"),       "ImageDescription",  },
+  { N_ ("Comment:"),           "UserComment",       },
+};#endif
 
 
 
@@ -74,6 +75,9 @@ struct _ThunarAprImagePage
   GtkWidget            *type_label;
   GtkWidget            *dimensions_label;
 
+  /* pending metadata lookup */
+  GCancellable         *cancellable;
+
 #ifdef HAVE_EXIF
   GtkWidget            *exif_labels[G_N_ELEMENTS (TAIP_EXIF)];
 #endif
@@ -91,6 +95,14 @@ static void
 thunar_apr_image_page_class_init (ThunarAprImagePageClass *klass)
 {
   ThunarAprAbstractPageClass *thunarapr_abstract_page_class;
+  ThunarxPropertyPageClass   *thunarxpropertypage_class;
+  GObjectClass               *gobject_class;
+
+  gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->dispose = thunar_apr_image_page_dispose;
+
+  thunarxpropertypage_class = THUNARX_PROPERTY_PAGE_CLASS (klass);
+  thunarxpropertypage_class->load = thunar_apr_image_page_load;
 
   thunarapr_abstract_page_class = THUNAR_APR_ABSTRACT_PAGE_CLASS (klass);
   thunarapr_abstract_page_class->file_changed = thunar_apr_image_page_file_changed;
@@ -101,20 +113,28 @@ thunar_apr_image_page_class_init (ThunarAprImagePageClass *klass)
 static void
 thunar_apr_image_page_init (ThunarAprImagePage *image_page)
 {
-  AtkRelationSet *relations;
-  PangoAttribute *attribute;
-  PangoAttrList  *attr_list;
-  AtkRelation    *relation;
-  AtkObject      *object;
-  GtkWidget      *label;
-  GtkWidget      *grid;
-#ifdef HAVE_EXIF
-  GtkWidget      *spacer;
-  guint           n;
-#endif
-
   gtk_container_set_border_width (GTK_CONTAINER (image_page), 12);
   thunarx_property_page_set_label (THUNARX_PROPERTY_PAGE (image_page), _("Image"));
+}
+
+
+
+static void
+thunar_apr_image_page_load (ThunarxPropertyPage *property_page,
+                            GCancellable        *cancellable)
+{
+  ThunarAprImagePage *image_page = THUNAR_APR_IMAGE_PAGE (property_page);
+  AtkRelationSet     *relations;
+  PangoAttribute     *attribute;
+  PangoAttrList      *attr_list;
+  AtkRelation        *relation;
+  AtkObject          *object;
+  GtkWidget          *label;
+  GtkWidget          *grid;
+#ifdef HAVE_EXIF
+  GtkWidget          *spacer;
+  guint               n;
+#endif
 
   /* allocate shared bold Pango attributes */
   attr_list = pango_attr_list_new ();
@@ -207,6 +227,27 @@ thunar_apr_image_page_init (ThunarAprImagePage *image_page)
 
   /* release shared bold Pango attributes */
   pango_attr_list_unref (attr_list);
+
+  /* start the lookup for the file */
+  (*THUNARX_PROPERTY_PAGE_CLASS (thunar_apr_image_page_parent_class)->load) (property_page, cancellable);
+}
+
+
+
+static void
+thunar_apr_image_page_dispose (GObject *object)
+{
+  ThunarAprImagePage *image_page = THUNAR_APR_IMAGE_PAGE (object);
+
+  /* cancel the pending lookup when the dialog is closed, the
+   * callback won't touch the page then */
+  if (image_page->cancellable != NULL)
+    {
+      g_cancellable_cancel (image_page->cancellable);
+      g_clear_object (&image_page->cancellable);
+    }
+
+  (*G_OBJECT_CLASS (thunar_apr_image_page_parent_class)->dispose) (object);
 }
 
 
@@ -216,96 +257,95 @@ thunar_apr_image_page_file_changed (ThunarAprAbstractPage *abstract_page,
                                     ThunarxFileInfo       *file)
 {
   ThunarAprImagePage *image_page = THUNAR_APR_IMAGE_PAGE (abstract_page);
-  GdkPixbufFormat    *format;
-  gchar              *filename;
-  gchar              *text;
-  gchar              *uri;
-  gint                height;
-  gint                width;
+
+  /* cancel the previous lookup */
+  if (image_page->cancellable != NULL)
+    {
+      g_cancellable_cancel (image_page->cancellable);
+      g_object_unref (G_OBJECT (image_page->cancellable));
+    }
+
+  /* the headers are parsed in a worker thread unless the metadata is cached */
+  image_page->cancellable = g_cancellable_new ();
+  thunarx_file_metadata_lookup_async (file, image_page->cancellable, thunar_apr_image_page_metadata_done, image_page);
+}
+
+
+
+static void
+thunar_apr_image_page_metadata_done (GObject      *object,
+                                     GAsyncResult *result,
+                                     gpointer      user_data)
+{
+  ThunarAprImagePage  *image_page;
+  ThunarxFileMetadata *metadata;
+  GError              *error = NULL;
+  gchar               *text;
+  gint                 height;
+  gint                 width;
 #ifdef HAVE_EXIF
-  ExifEntry          *exif_entry;
-  ExifData           *exif_data;
-  gchar               exif_buffer[1024];
-  guint               n;
+  const gchar         *value;
+  guint                n;
 #endif
 
-  /* determine the URI for the file */
-  uri = thunarx_file_info_get_uri (file);
-  if (G_UNLIKELY (uri == NULL))
-    return;
-
-  /* determine the local path of the file */
-  filename = g_filename_from_uri (uri, NULL, NULL);
-  if (G_LIKELY (filename != NULL))
+  metadata = thunarx_file_metadata_lookup_finish (result, &error);
+  if (G_UNLIKELY (metadata == NULL))
     {
-      /* determine the pixbuf format */
-      format = gdk_pixbuf_get_file_info (filename, &width, &height);
-      if (G_LIKELY (format != NULL))
+      /* the page may be gone already if the lookup was cancelled */
+      if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
         {
-          /* update the "Image Type" label */
-          text = g_strdup_printf ("%s (%s)", gdk_pixbuf_format_get_name (format), gdk_pixbuf_format_get_description (format));
-          gtk_label_set_text (GTK_LABEL (image_page->type_label), text);
-          g_free (text);
+          g_error_free (error);
+          return;
+        }
 
-          /* update the "Image Size" label */
-          text = g_strdup_printf (ngettext ("%dx%d pixel", "%dx%d pixels", width + height), width, height);
-          gtk_label_set_text (GTK_LABEL (image_page->dimensions_label), text);
-          g_free (text);
+      g_clear_error (&error);
+    }
 
-#ifdef HAVE_EXIF
-          /* hide all Exif labels (will be shown again if data is available) */
-          for (n = 0; n < G_N_ELEMENTS (TAIP_EXIF); ++n)
-            gtk_widget_hide (image_page->exif_labels[n]);
+  image_page = THUNAR_APR_IMAGE_PAGE (user_data);
+
+  if (metadata != NULL && thunarx_file_metadata_get_dimensions (metadata, &width, &height))
+    {
+      /* update the "Image Type" label */
+      text = g_strdup_printf ("%s (%s)", thunarx_file_metadata_get_format_name (metadata), thunarx_file_metadata_get_format_description (metadata));
+      gtk_label_set_text (GTK_LABEL (image_page->type_label), text);
+      g_free (text);
 
-          /* try to load the Exif data for the file */
-          exif_data = exif_data_new_from_file (filename);
-          if (G_LIKELY (exif_data != NULL))
+      /* update the "Image Size" label */
+      text = g_strdup_printf (ngettext ("%dx%d pixel", "%dx%d pixels", width + height), width, height);
+      gtk_label_set_text (GTK_LABEL (image_page->dimensions_label), text);
+      g_free (text);
+
+#ifdef HAVE_EXIF
+      /* update all Exif labels, hiding the ones without data */
+      for (n = 0; n < G_N_ELEMENTS (TAIP_EXIF); ++n)
+        {
+          value = thunarx_file_metadata_get_exif (metadata, TAIP_EXIF[n].tag);
+          if (G_LIKELY (value != NULL))
             {
-              /* update all Exif labels */
-              for (n = 0; n < G_N_ELEMENTS (TAIP_EXIF); ++n)
-                {
-                  /* lookup the entry for the tag */
-                  exif_entry = exif_data_get_entry (exif_data, TAIP_EXIF[n].tag);
-                  if (G_LIKELY (exif_entry != NULL))
-                    {
-                      /* determine the value */
-                      if (exif_entry_get_value (exif_entry, exif_buffer, sizeof (exif_buffer)) != NULL)
-                        {
-                          /* setup the label text */
-                          text = (g_utf8_validate (exif_buffer, -1, NULL)) ? g_strdup (exif_buffer) : g_filename_display_name (exif_buffer);
-                          gtk_label_set_text (GTK_LABEL (image_page->exif_labels[n]), text);
-                          g_free (text);
-
-                          /* show the label */
-                          gtk_widget_show (image_page->exif_labels[n]);
-                        }
-                    }
-                }
-
-              /* cleanup */
-              exif_data_free (exif_data);
+              gtk_label_set_text (GTK_LABEL (image_page->exif_labels[n]), value);
+              gtk_widget_show (image_page->exif_labels[n]);
+            }
+          else
+            {
+              gtk_widget_hide (image_page->exif_labels[n]);
             }
-#endif
         }
-      else
-        {
-          /* tell the user that we're unable to determine the file info */
-          gtk_label_set_text (GTK_LABEL (image_page->type_label), _("Unknown"));
-          gtk_label_set_text (GTK_LABEL (image_page->dimensions_label), _("Unknown"));
+#endif
+    }
+  else
+    {
+      /* tell the user that we're unable to determine the file info */
+      gtk_label_set_text (GTK_LABEL (image_page->type_label), _("Unknown"));
+      gtk_label_set_text (GTK_LABEL (image_page->dimensions_label), _("Unknown"));
 
 #ifdef HAVE_EXIF
-          /* hide all Exif labels */
-          for (n = 0; n < G_N_ELEMENTS (TAIP_EXIF); ++n)
-            gtk_widget_hide (image_page->exif_labels[n]);
+      /* hide all Exif labels */
+      for (n = 0; n < G_N_ELEMENTS (TAIP_EXIF); ++n)
+        gtk_widget_hide (image_page->exif_labels[n]);
 #endif
-        }
     }
 
   /* cleanup */
-  g_free (filename);
-  g_free (uri);
+  if (metadata != NULL)
+    thunarx_file_metadata_unref (metadata);
 }
-
-
-
-
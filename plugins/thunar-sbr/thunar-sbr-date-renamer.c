@@ -40,12 +40,6 @@
 
 
 
-#ifdef HAVE_EXIF
-#include <libexif/exif-data.h>
-#endif
-
-
-
 /* Property identifiers */
 enum
 {
@@ -434,13 +428,11 @@ thunar_sbr_get_time (ThunarxFileInfo   *file,
                      ThunarSbrDateMode  mode)
 {
 
-  GFileInfo *file_info;
-  guint64    file_time = 0;
+  GFileInfo           *file_info;
+  guint64              file_time = 0;
 #ifdef HAVE_EXIF
-  gchar     *uri, *filename;
-  ExifEntry *exif_entry;
-  ExifData  *exif_data;
-  gchar     exif_buffer[128];
+  ThunarxFileMetadata *metadata;
+  const gchar         *value;
 #endif
 
   switch (mode)
@@ -452,8 +444,10 @@ thunar_sbr_get_time (ThunarxFileInfo   *file,
 
     case THUNAR_SBR_DATE_MODE_ATIME:
     case THUNAR_SBR_DATE_MODE_MTIME:
-      /* get the file info */
-      file_info = thunarx_file_info_get_file_info (file);
+      /* borrow the file info, no need for a reference here */
+      file_info = thunarx_file_info_peek_file_info (file);
+      if (G_UNLIKELY (file_info == NULL))
+        break;
 
       /* get the time from the info */
       if (mode == THUNAR_SBR_DATE_MODE_ATIME)
@@ -466,51 +460,28 @@ thunar_sbr_get_time (ThunarxFileInfo   *file,
           file_time = g_file_info_get_attribute_uint64 (file_info,
                                                         G_FILE_ATTRIBUTE_TIME_MODIFIED);
         }
-
-      /* release the file info */
-      g_object_unref (file_info);
       break;
 
 #ifdef HAVE_EXIF
     case THUNAR_SBR_DATE_MODE_TAKEN:
-      /* get the uri */
-      uri = thunarx_file_info_get_uri (file);
-      if (G_LIKELY (uri != NULL))
+      /* the metadata is cached, so previewing the same files again is cheap */
+      metadata = thunarx_file_metadata_lookup (file);
+      if (G_LIKELY (metadata != NULL))
         {
-          /* determine the local path of the file */
-          filename = g_filename_from_uri (uri, NULL, NULL);
-          if (G_LIKELY (filename != NULL))
-            {
-              /* try to load the exif data for the file */
-              exif_data = exif_data_new_from_file (filename);
-              if (G_LIKELY (exif_data != NULL))
-                {
-                  /* lookup the entry for the tag, fallback on less common ones */
-                  exif_entry = exif_data_get_entry (exif_data, EXIF_TAG_DATE_TIME);
-
-                  if (exif_entry == NULL)
-                    exif_entry = exif_data_get_entry (exif_data, EXIF_TAG_DATE_TIME_ORIGINAL);
-
-                  if (exif_entry == NULL)
-                    exif_entry = exif_data_get_entry (exif_data, EXIF_TAG_DATE_TIME_DIGITIZED);
-
-                  if (G_LIKELY (exif_entry != NULL))
-                    {
-                      /* determine the value */
-                      if (exif_entry_get_value (exif_entry, exif_buffer, sizeof (exif_buffer)) != NULL)
-                        file_time = thunar_sbr_get_time_from_string (exif_buffer);
-                    }
-
-                  /* cleanup */
-                  exif_data_free (exif_data);
-                }
-
-              /* cleanup */
-              g_free (filename);
-            }
+          /* lookup the value for the tag, fallback on less common ones */
+          value = thunarx_file_metadata_get_exif (metadata, "DateTime");
+
+          if (value == NULL)
+            value = thunarx_file_metadata_get_exif (metadata, "DateTimeOriginal");
+
+          if (value == NULL)
+            value = thunarx_file_metadata_get_exif (metadata, "DateTimeDigitized");
+
+          if (G_LIKELY (value != NULL))
+            file_time = thunar_sbr_get_time_from_string (value);
 
           /* cleanup */
-          g_free (uri);
+          thunarx_file_metadata_unref (metadata);
         }
 
       break;
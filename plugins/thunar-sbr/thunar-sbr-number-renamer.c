@@ -64,6 +64,12 @@ static gchar *thunar_sbr_number_renamer_process       (ThunarxRenamer
                                                        ThunarxFileInfo              *file,
                                                        const gchar                  *text,
                                                        guint                         idx);
+static void   thunar_sbr_number_renamer_process_batch (ThunarxRenamer               *renamer,
+                                                       ThunarxFileInfo             **files,
+                                                       const gchar                 **texts,
+                                                       const guint                  *indices,
+                                                       guint                         n_files,
+                                                       gchar                       **names);
 static void   thunar_sbr_number_renamer_update        (ThunarSbrNumberRenamer       *number_renamer);
 
 
@@ -108,6 +114,7 @@ thunar_sbr_number_renamer_class_init (ThunarSbrNumberRenamerClass *klass)
 
   thunarxrenamer_class = THUNARX_RENAMER_CLASS (klass);
   thunarxrenamer_class->process = thunar_sbr_number_renamer_process;
+  thunarxrenamer_class->process_batch = thunar_sbr_number_renamer_process_batch;
 
   /**
    * ThunarSbrNumberRenamer:mode:
@@ -364,18 +371,13 @@ thunar_sbr_number_renamer_realize (GtkWidget *widget)
 
 
 
-static gchar*
-thunar_sbr_number_renamer_process (ThunarxRenamer  *renamer,
-                                   ThunarxFileInfo *file,
-                                   const gchar     *text,
-                                   guint            idx)
+static gboolean
+thunar_sbr_number_renamer_get_start (ThunarSbrNumberRenamer *number_renamer,
+                                     guint                  *start_return)
 {
-  ThunarSbrNumberRenamer *number_renamer = THUNAR_SBR_NUMBER_RENAMER (renamer);
-  gboolean                invalid = TRUE;
-  gchar                  *endp;
-  gchar                  *name;
-  gchar                  *number = NULL;
-  guint                   start = 0;
+  gboolean invalid = TRUE;
+  gchar   *endp;
+  guint    start = 0;
 
   /* check whether "start" is valid for the "mode" */
   if (number_renamer->mode < THUNAR_SBR_NUMBER_MODE_ABC)
@@ -393,9 +395,21 @@ thunar_sbr_number_renamer_process (ThunarxRenamer  *renamer,
               || g_unichar_tolower (start) > 'z');
     }
 
-  /* check if we have invalid settings */
-  if (G_UNLIKELY (invalid))
-    return g_strdup (text);
+  *start_return = start;
+
+  return !invalid;
+}
+
+
+
+static gchar*
+thunar_sbr_number_renamer_format (ThunarSbrNumberRenamer *number_renamer,
+                                  const gchar            *text,
+                                  guint                   start,
+                                  guint                   idx)
+{
+  gchar *name;
+  gchar *number = NULL;
 
   /* format the number */
   switch (number_renamer->mode)
@@ -467,6 +481,51 @@ thunar_sbr_number_renamer_process (ThunarxRenamer  *renamer,
 
 
 
+static gchar*
+thunar_sbr_number_renamer_process (ThunarxRenamer  *renamer,
+                                   ThunarxFileInfo *file,
+                                   const gchar     *text,
+                                   guint            idx)
+{
+  ThunarSbrNumberRenamer *number_renamer = THUNAR_SBR_NUMBER_RENAMER (renamer);
+  guint                   start;
+
+  /* check if we have invalid settings */
+  if (G_UNLIKELY (!thunar_sbr_number_renamer_get_start (number_renamer, &start)))
+    return g_strdup (text);
+
+  return thunar_sbr_number_renamer_format (number_renamer, text, start, idx);
+}
+
+
+
+static void
+thunar_sbr_number_renamer_process_batch (ThunarxRenamer   *renamer,
+                                         ThunarxFileInfo **files,
+                                         const gchar     **texts,
+                                         const guint      *indices,
+                                         guint             n_files,
+                                         gchar           **names)
+{
+  ThunarSbrNumberRenamer *number_renamer = THUNAR_SBR_NUMBER_RENAMER (renamer);
+  gboolean                valid;
+  guint                   start;
+  guint                   n;
+
+  /* the settings are the same for all files */
+  valid = thunar_sbr_number_renamer_get_start (number_renamer, &start);
+
+  for (n = 0; n < n_files; ++n)
+    {
+      if (G_LIKELY (valid))
+        names[n] = thunar_sbr_number_renamer_format (number_renamer, texts[n], start, indices[n]);
+      else
+        names[n] = g_strdup (texts[n]);
+    }
+}
+
+
+
 static void
 thunar_sbr_number_renamer_update (ThunarSbrNumberRenamer *number_renamer)
 {
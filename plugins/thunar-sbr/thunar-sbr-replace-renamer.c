@@ -66,6 +66,14 @@ static gchar *thunar_sbr_replace_renamer_process      (ThunarxRenamer
                                                        ThunarxFileInfo              *file,
                                                        const gchar                  *text,
                                                        guint                         idx);
+static void   thunar_sbr_replace_renamer_process_batch (ThunarxRenamer              *renamer,
+                                                       ThunarxFileInfo             **files,
+                                                       const gchar                 **texts,
+                                                       const guint                  *indices,
+                                                       guint                         n_files,
+                                                       gchar                       **names);
+static gchar *thunar_sbr_replace_renamer_replace      (ThunarSbrReplaceRenamer      *replace_renamer,
+                                                       const gchar                  *text);
 #ifdef HAVE_PCRE2
 static gchar *thunar_sbr_replace_renamer_pcre_exec    (ThunarSbrReplaceRenamer      *replace_renamer,
                                                        const gchar                  *text);
@@ -93,8 +101,13 @@ struct _ThunarSbrReplaceRenamer
 
   /* PCRE compiled pattern */
 #ifdef HAVE_PCRE2
-  pcre2_code    *pcre_pattern;
-  gint           pcre_capture_count;
+  pcre2_code       *pcre_pattern;
+  pcre2_match_data *pcre_match_data;
+  gint              pcre_capture_count;
+
+  /* TRUE if the pattern and the replacement contain no special
+   * characters, so the substitution is a plain search and replace */
+  gboolean          pcre_literal;
 #endif
 };
 
@@ -121,6 +134,7 @@ thunar_sbr_replace_renamer_class_init (ThunarSbrReplaceRenamerClass *klass)
 
   thunarxrenamer_class = THUNARX_RENAMER_CLASS (klass);
   thunarxrenamer_class->process = thunar_sbr_replace_renamer_process;
+  thunarxrenamer_class->process_batch = thunar_sbr_replace_renamer_process_batch;
 
   /**
    * ThunarSbrReplaceRenamer:case-sensitive:
@@ -277,6 +291,8 @@ thunar_sbr_replace_renamer_finalize (GObject *object)
 #ifdef HAVE_PCRE2
   if (G_UNLIKELY (replace_renamer->pcre_pattern != NULL))
     pcre2_code_free (replace_renamer->pcre_pattern);
+  if (G_UNLIKELY (replace_renamer->pcre_match_data != NULL))
+    pcre2_match_data_free (replace_renamer->pcre_match_data);
 #endif
 
   /* release the strings */
@@ -419,17 +435,38 @@ tsrr_replace (const gchar *text,
 
 
 static gchar*
-thunar_sbr_replace_renamer_process (ThunarxRenamer  *renamer,
-                                    ThunarxFileInfo *file,
-                                    const gchar     *text,
-                                    guint            idx)
+tsrr_replace_exact (const gchar *text,
+                    const gchar *pattern,
+                    const gchar *replacement)
 {
-  ThunarSbrReplaceRenamer *replace_renamer = THUNAR_SBR_REPLACE_RENAMER (renamer);
+  const gchar *match;
+  GString     *result;
+  gsize        pattern_len = strlen (pattern);
 
-  /* nothing to replace if we don't have a pattern */
-  if (G_UNLIKELY (replace_renamer->pattern == NULL || *replace_renamer->pattern == '\0'))
+  /* a case-sensitive search needs no unichar comparison */
+  match = strstr (text, pattern);
+  if (G_LIKELY (match == NULL))
     return g_strdup (text);
 
+  result = g_string_sized_new (32);
+  do
+    {
+      g_string_append_len (result, text, match - text);
+      g_string_append (result, replacement);
+      text = match + pattern_len;
+    }
+  while ((match = strstr (text, pattern)) != NULL);
+  g_string_append (result, text);
+
+  return g_string_free (result, FALSE);
+}
+
+
+
+static gchar*
+thunar_sbr_replace_renamer_replace (ThunarSbrReplaceRenamer *replace_renamer,
+                                    const gchar             *text)
+{
   /* check if we should use regular expression */
   if (G_UNLIKELY (replace_renamer->regexp))
     {
@@ -438,13 +475,62 @@ thunar_sbr_replace_renamer_process (ThunarxRenamer  *renamer,
       if (G_UNLIKELY (replace_renamer->pcre_pattern == NULL))
         return g_strdup (text);
 
+      /* a pattern without special characters is just a (case-sensitive) string */
+      if (replace_renamer->pcre_literal)
+        return tsrr_replace_exact (text, replace_renamer->pattern, replace_renamer->replacement);
+
       /* just execute the pattern */
       return thunar_sbr_replace_renamer_pcre_exec (replace_renamer, text);
 #endif
     }
 
   /* perform the replace operation */
-  return tsrr_replace (text, replace_renamer->pattern, replace_renamer->replacement, replace_renamer->case_sensitive);
+  if (replace_renamer->case_sensitive)
+    return tsrr_replace_exact (text, replace_renamer->pattern, replace_renamer->replacement);
+  else
+    return tsrr_replace (text, replace_renamer->pattern, replace_renamer->replacement, FALSE);
+}
+
+
+
+static gchar*
+thunar_sbr_replace_renamer_process (ThunarxRenamer  *renamer,
+                                    ThunarxFileInfo *file,
+                                    const gchar     *text,
+                                    guint            idx)
+{
+  ThunarSbrReplaceRenamer *replace_renamer = THUNAR_SBR_REPLACE_RENAMER (renamer);
+
+  /* nothing to replace if we don't have a pattern */
+  if (G_UNLIKELY (replace_renamer->pattern == NULL || *replace_renamer->pattern == '\0'))
+    return g_strdup (text);
+
+  return thunar_sbr_replace_renamer_replace (replace_renamer, text);
+}
+
+
+
+static void
+thunar_sbr_replace_renamer_process_batch (ThunarxRenamer   *renamer,
+                                          ThunarxFileInfo **files,
+                                          const gchar     **texts,
+                                          const guint      *indices,
+                                          guint             n_files,
+                                          gchar           **names)
+{
+  ThunarSbrReplaceRenamer *replace_renamer = THUNAR_SBR_REPLACE_RENAMER (renamer);
+  guint                    n;
+
+  /* nothing to replace if we don't have a pattern */
+  if (G_UNLIKELY (replace_renamer->pattern == NULL || *replace_renamer->pattern == '\0'))
+    {
+      for (n = 0; n < n_files; ++n)
+        names[n] = g_strdup (texts[n]);
+      return;
+    }
+
+  for (n = 0; n < n_files; ++n)
+    names[n] = thunar_sbr_replace_renamer_replace (replace_renamer, texts[n]);
 }
 
 
@@ -455,34 +541,19 @@ thunar_sbr_replace_renamer_pcre_exec (ThunarSbrReplaceRenamer *replace_renamer,
                                       const gchar             *subject)
 {
   GString     *result;
-  int          error;
-  PCRE2_SIZE   erroffset;
   gchar        output[1024];
-  pcre2_code  *compiled_pattern;
   PCRE2_SIZE   outlen;
   int          n_substitutions;  /* number of substitutions that were carried out */
 
-  result = g_string_sized_new (32);
-
-  compiled_pattern = pcre2_compile_8 ((PCRE2_SPTR)replace_renamer->pattern,
-                                      PCRE2_ZERO_TERMINATED,
-                                      0,
-                                      &error,
-                                      &erroffset,
-                                      0);
-  if (compiled_pattern == NULL)
-    return g_strdup (subject);
-
-  pcre2_jit_compile (compiled_pattern, PCRE2_JIT_COMPLETE);
-
   outlen = sizeof (output) / sizeof(PCRE2_UCHAR);
   
-  n_substitutions = pcre2_substitute (compiled_pattern,
+  /* the pattern is compiled (and JIT compiled) once in pcre_update() */
+  n_substitutions = pcre2_substitute (replace_renamer->pcre_pattern,
                                       (PCRE2_SPTR)subject,
                                       PCRE2_ZERO_TERMINATED,
                                       0,
                                       PCRE2_SUBSTITUTE_GLOBAL | PCRE2_SUBSTITUTE_EXTENDED,
-                                      0,
+                                      replace_renamer->pcre_match_data,
                                       0,
                                       (PCRE2_SPTR)replace_renamer->replacement,
                                       PCRE2_ZERO_TERMINATED,
@@ -492,13 +563,12 @@ thunar_sbr_replace_renamer_pcre_exec (ThunarSbrReplaceRenamer *replace_renamer,
   if (n_substitutions < 0)
     {
       PCRE2_UCHAR buffer[256];
-      pcre2_get_error_message (error, buffer, sizeof(buffer));
-      g_warning ("PCRE2 substitution failed at offset %d: %s\n", (int)erroffset, buffer);
+      pcre2_get_error_message (n_substitutions, buffer, sizeof(buffer));
+      g_warning ("PCRE2 substitution failed: %s\n", buffer);
       return g_strdup (subject);
     }
 
-  pcre2_code_free (compiled_pattern);
-
+  result = g_string_sized_new (32);
   for (size_t i = 0; i < outlen; i++)
     g_string_append_c (result, output[i]);
 
@@ -524,6 +594,9 @@ thunar_sbr_replace_renamer_pcre_update (ThunarSbrReplaceRenamer *replace_renamer
       /* release the previous pattern (if any) */
       if (G_LIKELY (replace_renamer->pcre_pattern != NULL))
         pcre2_code_free (replace_renamer->pcre_pattern);
+      if (G_LIKELY (replace_renamer->pcre_match_data != NULL))
+        pcre2_match_data_free (replace_renamer->pcre_match_data);
+      replace_renamer->pcre_match_data = NULL;
 
       /* try to compile the new pattern */
       replace_renamer->pcre_pattern = pcre2_compile ((PCRE2_SPTR)replace_renamer->pattern, PCRE2_ZERO_TERMINATED, 0, &error, &erroffset, 0);
@@ -534,6 +607,19 @@ thunar_sbr_replace_renamer_pcre_update (ThunarSbrReplaceRenamer *replace_renamer
           pcre2_get_error_message (error, buffer, sizeof(buffer));
           g_warning ("PCRE2 compilation failed at offset %d: %s\n", (int)erroffset, buffer);
         }
+      else
+        {
+          /* the pattern is applied to every file of the preview, so JIT compile it
+           * and allocate the match data once, both are optional for pcre2_substitute() */
+          pcre2_jit_compile (replace_renamer->pcre_pattern, PCRE2_JIT_COMPLETE);
+          replace_renamer->pcre_match_data = pcre2_match_data_create_from_pattern (replace_renamer->pcre_pattern, NULL);
+        }
+
+      /* the regex engine is not needed for patterns without special characters */
+      replace_renamer->pcre_literal = (replace_renamer->pattern != NULL
+                                    && replace_renamer->pattern[strcspn (replace_renamer->pattern, "\\^$.|?*+()[]{}")] == '\0'
+                                    && (replace_renamer->replacement == NULL
+                                     || replace_renamer->replacement[strcspn (replace_renamer->replacement, "\\$")] == '\0'));
     }
 
   /* check if there was an error compiling the pattern */
@@ -797,6 +883,11 @@ thunar_sbr_replace_renamer_set_replacement (ThunarSbrReplaceRenamer *replace_ren
       g_free (replace_renamer->replacement);
       replace_renamer->replacement = g_strdup (replacement);
 
+#ifdef HAVE_PCRE2
+      /* check whether the substitution is still a plain one */
+      thunar_sbr_replace_renamer_pcre_update (replace_renamer);
+#endif
+
       /* update the renamer */
       thunarx_renamer_changed (THUNARX_RENAMER (replace_renamer));
 
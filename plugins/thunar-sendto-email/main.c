@@ -114,6 +114,12 @@ static const char *TSE_MIME_TYPES[] = {
   "application/x-zstd-compressed-tar",
 };
 
+/* file name suffixes of the archive types above, which zip stores
+ * as they are instead of compressing them a second time */
+static const char TSE_STORED_SUFFIXES[] =
+  ".7z:.ar:.arj:.br:.bz:.bz2:.tbz:.tbz2:.Z:.taz:.tz:.deb:.gz:.tgz:.lha:.lzh:.lhz"
+  ":.lzma:.tlz:.rar:.xz:.txz:.zip:.rpm:.jar:.lzo:.zoo:.iso:.zst:.tzst";
+
 
 
 /* compress response ids */
@@ -489,12 +495,14 @@ tse_compress (GList  *infos,
     }
 
   /* generate the argument list for the ZIP command */
-  argv = g_new0 (gchar *, g_list_length (infos) + 5);
+  argv = g_new0 (gchar *, g_list_length (infos) + 7);
   argv[0] = g_strdup ("zip");
   argv[1] = g_strdup ("-q");
   argv[2] = g_strdup ("-r");
-  argv[3] = g_strdup (zipfile);
-  for (lp = infos, n = 4; lp != NULL && succeed; lp = lp->next, ++n)
+  argv[3] = g_strdup ("-n");
+  argv[4] = g_strdup (TSE_STORED_SUFFIXES);
+  argv[5] = g_strdup (zipfile);
+  for (lp = infos, n = 6; lp != NULL && succeed; lp = lp->next, ++n)
     {
       /* create a symlink for the file to the tmp dir */
       tse_data = (TseData *) lp->data;
@@ -87,6 +87,13 @@ static gboolean thunar_tpa_leave_notify_event  (GtkWidget           *button,
                                                 ThunarTpa           *plugin);
 static void     thunar_tpa_on_trash_changed    (thunarTPATrash      *proxy,
                                                 gpointer             user_data);
+static void     thunar_tpa_on_trash_state      (thunarTPATrash      *proxy,
+                                                gboolean             full,
+                                                guint                n_items,
+                                                gpointer             user_data);
+static void     thunar_tpa_on_owner_changed    (GObject             *proxy,
+                                                GParamSpec          *pspec,
+                                                gpointer             user_data);
 static void     thunar_tpa_display_trash       (ThunarTpa           *plugin);
 static void     thunar_tpa_empty_trash         (ThunarTpa           *plugin);
 static gboolean thunar_tpa_move_to_trash       (ThunarTpa           *plugin,
@@ -114,6 +121,10 @@ struct _ThunarTpa
   GCancellable   *cancellable_empty_trash;
   GCancellable   *cancellable_move_to_trash;
   GCancellable   *cancellable_query_trash;
+
+  /* whether the file manager pushes the state of the trash,
+   * so that there is no need to query it ourselves */
+  gboolean        state_pushed;
 };
 
 /* Target types for dropping to the trash can */
@@ -187,6 +198,8 @@ thunar_tpa_init (ThunarTpa *plugin)
     thunar_tpa_error (plugin, error);
 
   g_signal_connect (plugin->proxy, "trash_changed", G_CALLBACK (thunar_tpa_on_trash_changed), plugin);
+  g_signal_connect (plugin->proxy, "trash_state_changed", G_CALLBACK (thunar_tpa_on_trash_state), plugin);
+  g_signal_connect (plugin->proxy, "notify::g-name-owner", G_CALLBACK (thunar_tpa_on_owner_changed), plugin);
 }
 
 static void
@@ -326,8 +339,9 @@ thunar_tpa_empty_trash_reply (GObject      *source_object,
   success = thunar_tpa_trash_call_empty_trash_finish (proxy, result, &error);
   if (G_LIKELY (success))
     {
-      /* query the new state of the trash */
-      thunar_tpa_query_trash (plugin);
+      /* query the new state of the trash, unless it will be pushed */
+      if (!plugin->state_pushed)
+        thunar_tpa_query_trash (plugin);
     }
   else
     {
@@ -353,8 +367,9 @@ thunar_tpa_move_to_trash_reply (GObject      *source_object,
   success = thunar_tpa_trash_call_move_to_trash_finish (proxy, result, &error);
   if (G_LIKELY (success))
     {
-      /* query the new state of the trash */
-      thunar_tpa_query_trash (plugin);
+      /* query the new state of the trash, unless it will be pushed */
+      if (!plugin->state_pushed)
+        thunar_tpa_query_trash (plugin);
     }
   else
     {
@@ -383,6 +398,10 @@ thunar_tpa_query_trash_reply (GObject      *source_object,
     {
       /* update the tooltip/plugin accordingly */
       thunar_tpa_state (plugin, full);
+
+      /* answering the query made the file manager watch the trash, from
+       * now on it emits "TrashStateChanged" for every empty/full change */
+      plugin->state_pushed = TRUE;
     }
   else
     {
@@ -436,8 +455,9 @@ thunar_tpa_enter_notify_event (GtkWidget        *button,
   g_return_val_if_fail (THUNAR_IS_TPA (plugin), FALSE);
   g_return_val_if_fail (plugin->button == button, FALSE);
 
-  /* query the new state of the trash */
-  thunar_tpa_query_trash (plugin);
+  /* query the new state of the trash, unless it is pushed anyway */
+  if (!plugin->state_pushed)
+    thunar_tpa_query_trash (plugin);
 
   return FALSE;
 }
@@ -452,8 +472,9 @@ thunar_tpa_leave_notify_event (GtkWidget        *button,
   g_return_val_if_fail (THUNAR_IS_TPA (plugin), FALSE);
   g_return_val_if_fail (plugin->button == button, FALSE);
 
-  /* query the new state of the trash */
-  thunar_tpa_query_trash (plugin);
+  /* query the new state of the trash, unless it is pushed anyway */
+  if (!plugin->state_pushed)
+    thunar_tpa_query_trash (plugin);
 
   return FALSE;
 }
@@ -469,8 +490,49 @@ thunar_tpa_on_trash_changed (thunarTPATrash *proxy,
   g_return_if_fail (THUNAR_IS_TPA (plugin));
   g_return_if_fail (plugin->proxy == proxy);
 
-  /* update the state of the trash plugin */
-  thunar_tpa_query_trash (plugin);
+  /* file managers without the "TrashStateChanged" signal only tell that something changed */
+  if (!plugin->state_pushed)
+    thunar_tpa_query_trash (plugin);
+}
+
+
+
+static void
+thunar_tpa_on_trash_state (thunarTPATrash *proxy,
+                           gboolean        full,
+                           guint           n_items,
+                           gpointer        user_data)
+{
+  ThunarTpa *plugin = THUNAR_TPA (user_data);
+
+  g_return_if_fail (THUNAR_IS_TPA (plugin));
+  g_return_if_fail (plugin->proxy == proxy);
+
+  /* update the tooltip/plugin accordingly */
+  thunar_tpa_state (plugin, full);
+}
+
+
+
+static void
+thunar_tpa_on_owner_changed (GObject    *proxy,
+                             GParamSpec *pspec,
+                             gpointer    user_data)
+{
+  ThunarTpa *plugin = THUNAR_TPA (user_data);
+  gchar     *name_owner;
+
+  g_return_if_fail (THUNAR_IS_TPA (plugin));
+
+  /* nobody pushes the state while the file manager is gone, so
+   * fall back to querying (and thereby activating) it on demand */
+  plugin->state_pushed = FALSE;
+
+  /* a new file manager is asked once, it pushes the state afterwards */
+  name_owner = g_dbus_proxy_get_name_owner (G_DBUS_PROXY (proxy));
+  if (name_owner != NULL)
+    thunar_tpa_query_trash (plugin);
+  g_free (name_owner);
 }
 
 
@@ -60,9 +60,20 @@
 #define _PATH_BSHELL "/bin/sh"
 #endif
 
+/* delay before reloading uca.xml after the monitor reported a change */
+#define THUNAR_UCA_MODEL_RELOAD_DELAY (250)
+
+/* Linux refuses a single argument longer than 32 pages (MAX_ARG_STRLEN),
+ * the whole command is a single argument of the shell */
+#define THUNAR_UCA_MODEL_MAX_ARG_STRLEN (32 * 4096 - 1)
+
+/* room left for the shell arguments and the spawn machinery, like xargs */
+#define THUNAR_UCA_MODEL_ARG_HEADROOM (2048)
+
 
 
 typedef struct _ThunarUcaModelItem ThunarUcaModelItem;
+typedef struct _ThunarUcaModelSpec ThunarUcaModelSpec;
 
 
 
@@ -125,7 +136,17 @@ static gboolean           thunar_uca_model_iter_parent      (GtkTreeModel
 static gboolean           thunar_uca_model_load_from_file   (ThunarUcaModel       *uca_model,
                                                              const gchar          *filename,
                                                              GError              **error);
+static void               thunar_uca_model_reload           (ThunarUcaModel       *uca_model);
+static gboolean           thunar_uca_model_reload_timer     (gpointer              user_data);
+static void               thunar_uca_model_monitor_changed  (GFileMonitor         *monitor,
+                                                             GFile                *file,
+                                                             GFile                *other_file,
+                                                             GFileMonitorEvent     event_type,
+                                                             gpointer              user_data);
+static gint64             thunar_uca_model_get_file_mtime   (void);
 static void               thunar_uca_model_item_reset       (ThunarUcaModelItem   *item);
+static void               thunar_uca_model_matcher_reset    (ThunarUcaModel       *uca_model);
+static void               thunar_uca_model_matcher_build    (ThunarUcaModel       *uca_model);
 static void               thunar_uca_model_item_free        (gpointer              data);
 static void               start_element_handler             (GMarkupParseContext  *context,
                                                              const gchar          *element_name,
@@ -156,6 +177,23 @@ struct _ThunarUcaModel
 
   GList          *items;
   gint            stamp;
+
+  /* the file patterns of all items, compiled into a single matcher
+   * which is rebuilt on demand after the items changed. "*.ext"
+   * patterns are looked up by suffix, "*" patterns always match
+   * and only the remaining patterns are matched one by one.
+   */
+  guint           matcher_valid : 1;
+  GHashTable     *match_suffixes;
+  GArray         *match_any;
+  GArray         *match_specs;
+
+  /* the model is shared by all providers in the process and only
+   * reloaded when uca.xml was changed on disk by someone else.
+   */
+  GFileMonitor   *monitor;
+  guint           reload_timer_id;
+  gint64          file_mtime;
 };
 
 struct _ThunarUcaModelItem
@@ -174,6 +212,15 @@ struct _ThunarUcaModelItem
 
   /* derived attributes */
   guint          multiple_selection : 1;
+  guint          has_range : 1;
+  gint           range_lower;
+  gint           range_upper;
+};
+
+struct _ThunarUcaModelSpec
+{
+  GPatternSpec  *pspec;
+  guint          item;
 };
 
 typedef XFCE_GENERIC_STACK(ParserState) ParserStack;
@@ -254,25 +301,25 @@ thunar_uca_model_tree_model_init (GtkTreeModelIface *iface)
 static void
 thunar_uca_model_init (ThunarUcaModel *uca_model)
 {
-  GError *error = NULL;
-  gchar  *filename;
+  GFile *file;
+  gchar *path;
 
   /* generate a unique stamp */
   uca_model->stamp = g_random_int ();
 
-  /* determine the path to the uca.xml config */
-  filename = xfce_resource_lookup (XFCE_RESOURCE_CONFIG, "Thunar/uca.xml");
-  if (G_LIKELY (filename != NULL))
-    {
-      /* try to load the file */
-      if (!thunar_uca_model_load_from_file (uca_model, filename, &error))
-        {
-          g_warning ("Failed to load `%s': %s", filename, error->message);
-          g_error_free (error);
-        }
+  /* load the actions from uca.xml */
+  thunar_uca_model_reload (uca_model);
 
-      /* release the filename */
-      g_free (filename);
+  /* watch the user's uca.xml, which may not exist yet */
+  path = xfce_resource_save_location (XFCE_RESOURCE_CONFIG, "Thunar/uca.xml", FALSE);
+  if (G_LIKELY (path != NULL))
+    {
+      file = g_file_new_for_path (path);
+      uca_model->monitor = g_file_monitor_file (file, G_FILE_MONITOR_NONE, NULL, NULL);
+      if (G_LIKELY (uca_model->monitor != NULL))
+        g_signal_connect (uca_model->monitor, "changed", G_CALLBACK (thunar_uca_model_monitor_changed), uca_model);
+      g_object_unref (file);
+      g_free (path);
     }
 }
 
@@ -283,6 +330,19 @@ thunar_uca_model_finalize (GObject *object)
 {
   ThunarUcaModel *uca_model = THUNAR_UCA_MODEL (object);
 
+  /* stop watching uca.xml */
+  if (uca_model->reload_timer_id != 0)
+    g_source_remove (uca_model->reload_timer_id);
+  if (uca_model->monitor != NULL)
+    {
+      g_signal_handlers_disconnect_by_func (uca_model->monitor, thunar_uca_model_monitor_changed, uca_model);
+      g_file_monitor_cancel (uca_model->monitor);
+      g_object_unref (uca_model->monitor);
+    }
+
+  /* release the matcher */
+  thunar_uca_model_matcher_reset (uca_model);
+
   /* release all items */
   g_list_free_full (uca_model->items, thunar_uca_model_item_free);
 
@@ -628,6 +688,127 @@ thunar_uca_model_load_from_file (ThunarUcaModel *uca_model,
 
 
 
+static void
+thunar_uca_model_reload (ThunarUcaModel *uca_model)
+{
+  GtkTreePath *path;
+  GError      *error = NULL;
+  gchar       *filename;
+
+  /* drop the current items, notifying views from the front */
+  while (uca_model->items != NULL)
+    {
+      thunar_uca_model_item_free (uca_model->items->data);
+      uca_model->items = g_list_delete_link (uca_model->items, uca_model->items);
+
+      path = gtk_tree_path_new_from_indices (0, -1);
+      gtk_tree_model_row_deleted (GTK_TREE_MODEL (uca_model), path);
+      gtk_tree_path_free (path);
+    }
+
+  /* determine the path to the uca.xml config */
+  filename = xfce_resource_lookup (XFCE_RESOURCE_CONFIG, "Thunar/uca.xml");
+  if (G_LIKELY (filename != NULL))
+    {
+      /* try to load the file */
+      if (!thunar_uca_model_load_from_file (uca_model, filename, &error))
+        {
+          g_warning ("Failed to load `%s': %s", filename, error->message);
+          g_error_free (error);
+        }
+
+      /* release the filename */
+      g_free (filename);
+    }
+
+  /* remember which version we loaded, this includes a save
+   * for newly generated unique ids in load_from_file()
+   */
+  uca_model->file_mtime = thunar_uca_model_get_file_mtime ();
+
+  /* compile the patterns of the loaded items */
+  thunar_uca_model_matcher_build (uca_model);
+}
+
+
+
+static gboolean
+thunar_uca_model_reload_timer (gpointer user_data)
+{
+  ThunarUcaModel *uca_model = THUNAR_UCA_MODEL (user_data);
+
+  uca_model->reload_timer_id = 0;
+
+  /* ignore events for our own saves and duplicate notifications */
+  if (thunar_uca_model_get_file_mtime () != uca_model->file_mtime)
+    thunar_uca_model_reload (uca_model);
+
+  return FALSE;
+}
+
+
+
+static void
+thunar_uca_model_monitor_changed (GFileMonitor     *monitor,
+                                  GFile            *file,
+                                  GFile            *other_file,
+                                  GFileMonitorEvent event_type,
+                                  gpointer          user_data)
+{
+  ThunarUcaModel *uca_model = THUNAR_UCA_MODEL (user_data);
+
+  switch (event_type)
+    {
+    case G_FILE_MONITOR_EVENT_CHANGED:
+    case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+    case G_FILE_MONITOR_EVENT_CREATED:
+    case G_FILE_MONITOR_EVENT_DELETED:
+    case G_FILE_MONITOR_EVENT_MOVED:
+      /* editors tend to emit several events per save, so wait for them to settle */
+      if (uca_model->reload_timer_id != 0)
+        g_source_remove (uca_model->reload_timer_id);
+      uca_model->reload_timer_id = g_timeout_add (THUNAR_UCA_MODEL_RELOAD_DELAY, thunar_uca_model_reload_timer, uca_model);
+      break;
+
+    default:
+      break;
+    }
+}
+
+
+
+static gint64
+thunar_uca_model_get_file_mtime (void)
+{
+  GFileInfo *info;
+  GFile     *file;
+  gchar     *path;
+  gint64     mtime = 0;
+
+  path = xfce_resource_save_location (XFCE_RESOURCE_CONFIG, "Thunar/uca.xml", FALSE);
+  if (G_UNLIKELY (path == NULL))
+    return 0;
+
+  file = g_file_new_for_path (path);
+  info = g_file_query_info (file,
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED ","
+                            G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC,
+                            G_FILE_QUERY_INFO_NONE, NULL, NULL);
+  if (info != NULL)
+    {
+      mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC
+            + g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+      g_object_unref (info);
+    }
+
+  g_object_unref (file);
+  g_free (path);
+
+  return mtime;
+}
+
+
+
 static void
 thunar_uca_model_item_reset (ThunarUcaModelItem *item)
 {
@@ -660,6 +841,95 @@ thunar_uca_model_item_free (gpointer data)
 
 
 
+static void
+thunar_uca_model_matcher_reset (ThunarUcaModel *uca_model)
+{
+  ThunarUcaModelSpec *spec;
+  guint               n;
+
+  if (uca_model->match_suffixes != NULL)
+    {
+      g_hash_table_destroy (uca_model->match_suffixes);
+      uca_model->match_suffixes = NULL;
+    }
+
+  if (uca_model->match_any != NULL)
+    {
+      g_array_free (uca_model->match_any, TRUE);
+      uca_model->match_any = NULL;
+    }
+
+  if (uca_model->match_specs != NULL)
+    {
+      for (n = 0; n < uca_model->match_specs->len; ++n)
+        {
+          spec = &g_array_index (uca_model->match_specs, ThunarUcaModelSpec, n);
+          g_pattern_spec_free (spec->pspec);
+        }
+      g_array_free (uca_model->match_specs, TRUE);
+      uca_model->match_specs = NULL;
+    }
+
+  uca_model->matcher_valid = FALSE;
+}
+
+
+
+static void
+thunar_uca_model_matcher_build (ThunarUcaModel *uca_model)
+{
+  ThunarUcaModelItem *item;
+  ThunarUcaModelSpec  spec;
+  const gchar        *pattern;
+  GSList             *items;
+  GList              *lp;
+  guint               i, m;
+
+  thunar_uca_model_matcher_reset (uca_model);
+
+  uca_model->match_suffixes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_slist_free);
+  uca_model->match_any = g_array_new (FALSE, FALSE, sizeof (guint));
+  uca_model->match_specs = g_array_new (FALSE, FALSE, sizeof (ThunarUcaModelSpec));
+
+  for (i = 0, lp = uca_model->items; lp != NULL; ++i, lp = lp->next)
+    {
+      item = lp->data;
+      if (G_UNLIKELY (item->patterns == NULL))
+        continue;
+
+      for (m = 0; item->patterns[m] != NULL; ++m)
+        {
+          pattern = item->patterns[m];
+
+          if (strcmp (pattern, "*") == 0)
+            {
+              /* matches every file name */
+              g_array_append_val (uca_model->match_any, i);
+            }
+          else if (pattern[0] == '*' && pattern[1] == '.' && strpbrk (pattern + 1, "*?") == NULL)
+            {
+              /* "*.ext" matches every file name ending in ".ext" */
+              items = g_hash_table_lookup (uca_model->match_suffixes, pattern + 1);
+              if (items != NULL)
+                g_hash_table_steal (uca_model->match_suffixes, pattern + 1);
+              items = g_slist_prepend (items, GUINT_TO_POINTER (i));
+              g_hash_table_insert (uca_model->match_suffixes, g_strdup (pattern + 1), items);
+            }
+          else
+            {
+              /* everything else needs a real glob match */
+              spec.pspec = g_pattern_spec_new (pattern);
+              spec.item = i;
+              g_array_append_val (uca_model->match_specs, spec);
+            }
+        }
+    }
+
+  uca_model->matcher_valid = TRUE;
+}
+
+
+
 static void
 start_element_handler (GMarkupParseContext *context,
                        const gchar         *element_name,
@@ -1128,22 +1398,23 @@ GList*
 thunar_uca_model_match (ThunarUcaModel *uca_model,
                         GList          *file_infos)
 {
-  typedef struct
-  {
-    gchar          *name;
-    ThunarUcaTypes  types;
-  } ThunarUcaFile;
-
   ThunarUcaModelItem *item;
-  ThunarUcaFile      *files;
+  ThunarUcaModelSpec *spec;
+  ThunarUcaTypes      types;
+  ThunarUcaTypes      selection_types = 0;
   GFile              *location;
-  gchar              *mime_type;
-  gboolean            matches;
+  const gchar        *name;
+  gchar              *name_reversed;
+  const gchar        *dot;
+  GSList             *sp;
   GList              *paths = NULL;
   GList              *lp;
-  gint                n_files;
-  gint                i, m, n;
-  gint                upper, lower;
+  guint              *marks;
+  guint               n_items;
+  guint               n_alive;
+  guint               n_files;
+  guint               i, n;
+  gsize               name_len;
   gchar              *path_test;
 
   g_return_val_if_fail (THUNAR_UCA_IS_MODEL (uca_model), NULL);
@@ -1153,10 +1424,9 @@ thunar_uca_model_match (ThunarUcaModel *uca_model,
   if (G_UNLIKELY (uca_model->items == NULL))
     return NULL;
 
-  /* determine the ThunarUcaFile's for the given file_infos */
-  n_files = g_list_length (file_infos);
-  files = g_new (ThunarUcaFile, n_files);
-  for (lp = file_infos, n = 0; lp != NULL; lp = lp->next, ++n)
+  /* classify the files once, each file has exactly one type bit */
+  n_files = 0;
+  for (lp = file_infos; lp != NULL; lp = lp->next, ++n_files)
     {
       location = thunarx_file_info_get_location (lp->data);
 
@@ -1165,75 +1435,92 @@ thunar_uca_model_match (ThunarUcaModel *uca_model,
         {
           /* cannot handle non-local files */
           g_object_unref (location);
-          g_free (files);
           return NULL;
         }
       g_free (path_test);
 
       g_object_unref (location);
 
-      mime_type = thunarx_file_info_get_mime_type (lp->data);
-
-      files[n].name = thunarx_file_info_get_name (lp->data);
-      files[n].types = types_from_mime_type (mime_type);
+      types = types_from_mime_type (thunarx_file_info_peek_mime_type (lp->data));
 
-      if (G_UNLIKELY (files[n].types == 0))
-        files[n].types = THUNAR_UCA_TYPE_OTHER_FILES;
+      if (G_UNLIKELY (types == 0))
+        types = THUNAR_UCA_TYPE_OTHER_FILES;
 
-      g_free (mime_type);
+      selection_types |= types;
     }
 
-  /* lookup the matching items */
+  /* compile the patterns if the items changed since the last match */
+  if (G_UNLIKELY (!uca_model->matcher_valid))
+    thunar_uca_model_matcher_build (uca_model);
+
+  /* an item is still a candidate after the n-th file if its mark
+   * equals n, items that do not apply get a mark that never does
+   */
+  n_items = g_list_length (uca_model->items);
+  marks = g_new (guint, n_items);
+  n_alive = 0;
   for (i = 0, lp = uca_model->items; lp != NULL; ++i, lp = lp->next)
     {
-      /* check if we can just ignore this item */
       item = (ThunarUcaModelItem *) lp->data;
-      upper = n_files;
-      lower = n_files;
+      marks[i] = G_MAXUINT;
 
-      if (item->range != NULL)
-        {
-          gchar **limits = g_strsplit (item->range, "-", 2);
-          if (limits[0] != NULL && limits[1] != NULL)
-            {
-              lower = g_strtod (limits[0], NULL);
-              upper = g_strtod (limits[1], NULL);
-            }
-          g_strfreev (limits);
-        }
-
-      if ((n_files > upper) || (n_files < lower))
+      if (item->has_range && ((gint) n_files > item->range_upper || (gint) n_files < item->range_lower))
         continue;
       if (!item->multiple_selection && n_files > 1)
         continue;
 
-      /* match the specified files */
-      for (n = 0; n < n_files; ++n)
-        {
-          /* verify that we support this type of file */
-          if ((files[n].types & item->types) == 0)
-            break;
+      /* verify that we support all types of files in the selection */
+      if ((selection_types & ~item->types) != 0)
+        continue;
 
-          /* atleast on pattern must match the file name */
-          for (m = 0, matches = FALSE; item->patterns[m] != NULL && !matches; ++m)
-            matches = g_pattern_match_simple (item->patterns[m], files[n].name);
+      marks[i] = 0;
+      ++n_alive;
+    }
 
-          /* no need to continue if none of the patterns match */
-          if (!matches)
-            break;
+  /* match the file names, atleast one pattern of the item must match each file */
+  for (lp = file_infos, n = 0; lp != NULL && n_alive > 0; lp = lp->next, ++n)
+    {
+      name = thunarx_file_info_peek_name (lp->data);
+      n_alive = 0;
+
+#define MARK_ITEM(index) G_STMT_START{ if (marks[(index)] == n) { marks[(index)] = n + 1; ++n_alive; } }G_STMT_END
+
+      /* items with a "*" pattern */
+      for (i = 0; i < uca_model->match_any->len; ++i)
+        MARK_ITEM (g_array_index (uca_model->match_any, guint, i));
+
+      /* items with a "*.ext" pattern for any of the name's suffixes */
+      if (g_hash_table_size (uca_model->match_suffixes) > 0)
+        for (dot = strchr (name, '.'); dot != NULL; dot = strchr (dot + 1, '.'))
+          for (sp = g_hash_table_lookup (uca_model->match_suffixes, dot); sp != NULL; sp = sp->next)
+            MARK_ITEM (GPOINTER_TO_UINT (sp->data));
+
+      /* the remaining patterns, skipping items that already matched or dropped out */
+      if (uca_model->match_specs->len > 0)
+        {
+          name_len = strlen (name);
+          name_reversed = g_utf8_strreverse (name, name_len);
+          for (i = 0; i < uca_model->match_specs->len; ++i)
+            {
+              spec = &g_array_index (uca_model->match_specs, ThunarUcaModelSpec, i);
+              if (marks[spec->item] == n && g_pattern_spec_match (spec->pspec, name_len, name, name_reversed))
+                MARK_ITEM (spec->item);
+            }
+          g_free (name_reversed);
         }
 
-      /* add the path if all files match one of the patterns */
-      if (G_UNLIKELY (n == n_files))
-        paths = g_list_append (paths, gtk_tree_path_new_from_indices (i, -1));
+#undef MARK_ITEM
     }
 
+  /* add the paths of the items that matched all files */
+  for (i = 0; i < n_items && n_alive > 0; ++i)
+    if (G_UNLIKELY (marks[i] == n_files))
+      paths = g_list_prepend (paths, gtk_tree_path_new_from_indices (i, -1));
+
   /* cleanup */
-  for (n = 0; n < n_files; ++n)
-    g_free (files[n].name);
-  g_free (files);
+  g_free (marks);
 
-  return paths;
+  return g_list_reverse (paths);
 }
 
 
@@ -1259,6 +1546,7 @@ thunar_uca_model_append (ThunarUcaModel *uca_model,
   /* append the new item */
   item = g_new0 (ThunarUcaModelItem, 1);
   uca_model->items = g_list_append (uca_model->items, item);
+  thunar_uca_model_matcher_reset (uca_model);
 
   /* determine the tree iter of the new item */
   iter->stamp = uca_model->stamp;
@@ -1308,6 +1596,9 @@ thunar_uca_model_exchange (ThunarUcaModel *uca_model,
   new_order[g_list_position (uca_model->items, list_a)] = g_list_position (uca_model->items, list_b);
   new_order[g_list_position (uca_model->items, list_b)] = g_list_position (uca_model->items, list_a);
 
+  /* the item indices in the matcher change */
+  thunar_uca_model_matcher_reset (uca_model);
+
   /* perform the exchange */
   item = list_a->data;
   list_a->data = list_b->data;
@@ -1360,6 +1651,7 @@ thunar_uca_model_remove (ThunarUcaModel *uca_model,
   item = ((GList *) iter->user_data)->data;
   uca_model->items = g_list_delete_link (uca_model->items, iter->user_data);
   thunar_uca_model_item_free (item);
+  thunar_uca_model_matcher_reset (uca_model);
 
   /* notify listeners */
   gtk_tree_model_row_deleted (GTK_TREE_MODEL (uca_model), path);
@@ -1405,6 +1697,7 @@ thunar_uca_model_update (ThunarUcaModel *uca_model,
   GtkTreePath        *path;
   guint               n, m;
   gchar              *accel_path;
+  gchar             **limits;
 
   g_return_if_fail (THUNAR_UCA_IS_MODEL (uca_model));
   g_return_if_fail (iter->stamp == uca_model->stamp);
@@ -1413,6 +1706,9 @@ thunar_uca_model_update (ThunarUcaModel *uca_model,
   item = ((GList *) iter->user_data)->data;
   thunar_uca_model_item_reset (item);
 
+  /* the patterns need to be compiled again */
+  thunar_uca_model_matcher_reset (uca_model);
+
   /* setup the new item values */
   if (G_LIKELY (name != NULL && *name != '\0'))
     item->name = g_strdup (name);
@@ -1423,7 +1719,19 @@ thunar_uca_model_update (ThunarUcaModel *uca_model,
   if (G_LIKELY (command != NULL && *command != '\0'))
     item->command = g_strdup (command);
   if (G_LIKELY (range != NULL && *range != '\0'))
-    item->range = g_strdup (range);
+    {
+      item->range = g_strdup (range);
+
+      /* parse the range once, rather than on every match */
+      limits = g_strsplit (range, "-", 2);
+      if (limits[0] != NULL && limits[1] != NULL)
+        {
+          item->has_range = TRUE;
+          item->range_lower = g_strtod (limits[0], NULL);
+          item->range_upper = g_strtod (limits[1], NULL);
+        }
+      g_strfreev (limits);
+    }
   if (G_LIKELY (description != NULL && *description != '\0'))
     item->description = g_strdup (description);
   item->types = types;
@@ -1577,6 +1885,9 @@ thunar_uca_model_save (ThunarUcaModel *uca_model,
     {
       /* yeppa, successful */
       result = TRUE;
+
+      /* don't reload our own changes when the monitor reports them */
+      uca_model->file_mtime = thunar_uca_model_get_file_mtime ();
     }
 
 done:
@@ -1589,41 +1900,21 @@ done:
 
 
 
-/**
- * thunar_uca_model_parse_argv:
- * @uca_model   : a #ThunarUcaModel.
- * @iter        : the #GtkTreeIter of the item.
- * @file_infos  : the #GList of #ThunarxFileInfo<!---->s to pass to the item.
- * @argcp       : return location for number of args.
- * @argvp       : return location for array of args.
- * @error       : return location for errors or %NULL.
- *
- * Return value: %TRUE on success, %FALSE if @error is set.
- **/
-gboolean
-thunar_uca_model_parse_argv (ThunarUcaModel *uca_model,
-                             GtkTreeIter    *iter,
-                             GList          *file_infos,
-                             gint           *argcp,
-                             gchar        ***argvp,
-                             GError        **error)
+static gchar *
+thunar_uca_model_expand_command (ThunarUcaModelItem *item,
+                                 GList              *file_infos,
+                                 GError            **error)
 {
-  ThunarUcaModelItem *item;
-  const gchar        *p;
-  GString            *command_line = g_string_new (NULL);
-  GList              *lp;
-  GSList             *uri_list = NULL;
-  gchar              *dirname;
-  gchar              *path;
-  gchar              *expanded;
-  GFile              *location;
-
-  g_return_val_if_fail (THUNAR_UCA_IS_MODEL (uca_model), FALSE);
-  g_return_val_if_fail (iter->stamp == uca_model->stamp, FALSE);
-  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+  const gchar *p;
+  GString     *command_line = g_string_new (NULL);
+  GList       *lp;
+  GSList      *uri_list = NULL;
+  gchar       *dirname;
+  gchar       *path;
+  gchar       *expanded;
+  GFile       *location;
 
   /* verify that a command is set for the item */
-  item = (ThunarUcaModelItem *) ((GList *) iter->user_data)->data;
   if (item->command == NULL || *item->command == '\0')
     {
       g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL, _("Command not configured"));
@@ -1717,22 +2008,195 @@ thunar_uca_model_parse_argv (ThunarUcaModel *uca_model,
   g_string_free (command_line, TRUE);
   g_slist_free_full (uri_list, g_free);
 
+  return expanded;
+
+error:
+  g_string_free (command_line, TRUE);
+  return NULL;
+}
+
+
+
+static gchar **
+thunar_uca_model_command_argv (gchar *expanded)
+{
+  gchar **argv;
+
   /* we run the command using the bourne shell (or the systems
    * replacement for the bourne shell), so environment variables
    * and backticks can be used for the action commands.
    */
+  argv = g_new (gchar *, 4);
+  argv[0] = g_strdup (_PATH_BSHELL);
+  argv[1] = g_strdup ("-c");
+  argv[2] = expanded;
+  argv[3] = NULL;
+
+  return argv;
+}
+
+
+
+static gsize
+thunar_uca_model_get_command_limit (void)
+{
+  gchar **environment;
+  gsize   environment_size = 0;
+  gsize   limit = THUNAR_UCA_MODEL_MAX_ARG_STRLEN;
+  glong   arg_max = -1;
+  guint   n;
+
+#if defined (HAVE_UNISTD_H) && defined (_SC_ARG_MAX)
+  arg_max = sysconf (_SC_ARG_MAX);
+#endif
+
+  /* the arguments share ARG_MAX with the environment of the child */
+  if (arg_max > 0)
+    {
+      environment = g_get_environ ();
+      for (n = 0; environment[n] != NULL; ++n)
+        environment_size += strlen (environment[n]) + 1 + sizeof (gchar *);
+      g_strfreev (environment);
+
+      if ((gsize) arg_max > environment_size + 2 * THUNAR_UCA_MODEL_ARG_HEADROOM)
+        limit = MIN (limit, (gsize) arg_max - environment_size - THUNAR_UCA_MODEL_ARG_HEADROOM);
+      else
+        limit = MIN (limit, THUNAR_UCA_MODEL_ARG_HEADROOM);
+    }
+
+  return limit;
+}
+
+
+
+/**
+ * thunar_uca_model_parse_argv:
+ * @uca_model   : a #ThunarUcaModel.
+ * @iter        : the #GtkTreeIter of the item.
+ * @file_infos  : the #GList of #ThunarxFileInfo<!---->s to pass to the item.
+ * @argcp       : return location for number of args.
+ * @argvp       : return location for array of args.
+ * @error       : return location for errors or %NULL.
+ *
+ * Return value: %TRUE on success, %FALSE if @error is set.
+ **/
+gboolean
+thunar_uca_model_parse_argv (ThunarUcaModel *uca_model,
+                             GtkTreeIter    *iter,
+                             GList          *file_infos,
+                             gint           *argcp,
+                             gchar        ***argvp,
+                             GError        **error)
+{
+  ThunarUcaModelItem *item;
+  gchar              *expanded;
+
+  g_return_val_if_fail (THUNAR_UCA_IS_MODEL (uca_model), FALSE);
+  g_return_val_if_fail (iter->stamp == uca_model->stamp, FALSE);
+  g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  item = (ThunarUcaModelItem *) ((GList *) iter->user_data)->data;
+  expanded = thunar_uca_model_expand_command (item, file_infos, error);
+  if (G_UNLIKELY (expanded == NULL))
+    return FALSE;
+
   (*argcp) = 3;
-  (*argvp) = g_new (gchar *, 4);
-  (*argvp)[0] = g_strdup (_PATH_BSHELL);
-  (*argvp)[1] = g_strdup ("-c");
-  (*argvp)[2] = expanded;
-  (*argvp)[3] = NULL;
+  (*argvp) = thunar_uca_model_command_argv (expanded);
 
   return TRUE;
-
-error:
-  g_string_free (command_line, TRUE);
-  return FALSE;
 }
 
 
+
+/**
+ * thunar_uca_model_parse_argv_batches:
+ * @uca_model   : a #ThunarUcaModel.
+ * @iter        : the #GtkTreeIter of the item.
+ * @file_infos  : the #GList of #ThunarxFileInfo<!---->s to pass to the item.
+ * @error       : return location for errors or %NULL.
+ *
+ * Like thunar_uca_model_parse_argv(), but if the command line for all of
+ * @file_infos would be too long to be executed, the files are split into
+ * batches that fit, like xargs does, and one command line is returned
+ * for every batch. Only items that take multiple files are split.
+ *
+ * The caller is responsible to free the returned list and its argument
+ * vectors using g_list_free_full() with g_strfreev().
+ *
+ * Return value: the #GList of argument vectors, or %NULL if @error is set.
+ **/
+GList *
+thunar_uca_model_parse_argv_batches (ThunarUcaModel *uca_model,
+                                     GtkTreeIter    *iter,
+                                     GList          *file_infos,
+                                     GError        **error)
+{
+  ThunarUcaModelItem *item;
+  GList              *batches = NULL;
+  GList              *first;
+  GList              *last;
+  GList              *next;
+  gchar              *expanded;
+  gsize               limit;
+  gsize               per_file;
+  guint               n_remaining;
+  guint               n_batch;
+
+  g_return_val_if_fail (THUNAR_UCA_IS_MODEL (uca_model), NULL);
+  g_return_val_if_fail (iter->stamp == uca_model->stamp, NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  item = (ThunarUcaModelItem *) ((GList *) iter->user_data)->data;
+  expanded = thunar_uca_model_expand_command (item, file_infos, error);
+  if (G_UNLIKELY (expanded == NULL))
+    return NULL;
+
+  /* the common case, everything fits into a single command line */
+  limit = thunar_uca_model_get_command_limit ();
+  n_remaining = g_list_length (file_infos);
+  if (G_LIKELY (strlen (expanded) <= limit || !item->multiple_selection || n_remaining <= 1))
+    return g_list_prepend (NULL, thunar_uca_model_command_argv (expanded));
+
+  /* guess the size of a batch from the average length per file */
+  per_file = strlen (expanded) / n_remaining + 1;
+  g_free (expanded);
+
+  for (first = file_infos; first != NULL; first = next, n_remaining -= n_batch)
+    {
+      n_batch = CLAMP ((limit - limit / 10) / per_file, 1, n_remaining);
+      for (;;)
+        {
+          /* cut the batch out of the list for the expansion */
+          last = g_list_nth (first, n_batch - 1);
+          next = last->next;
+          last->next = NULL;
+          expanded = thunar_uca_model_expand_command (item, first, error);
+          last->next = next;
+
+          if (G_UNLIKELY (expanded == NULL))
+            {
+              g_list_free_full (batches, (GDestroyNotify) g_strfreev);
+              return NULL;
+            }
+
+          if (strlen (expanded) <= limit)
+            break;
+
+          g_free (expanded);
+
+          /* not even a single file fits */
+          if (G_UNLIKELY (n_batch == 1))
+            {
+              g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_NAMETOOLONG, _("Command line too long"));
+              g_list_free_full (batches, (GDestroyNotify) g_strfreev);
+              return NULL;
+            }
+
+          n_batch /= 2;
+        }
+
+      batches = g_list_prepend (batches, thunar_uca_model_command_argv (expanded));
+    }
+
+  return g_list_reverse (batches);
+}
@@ -114,6 +114,11 @@ gboolean        thunar_uca_model_parse_argv     (ThunarUcaModel         *uca_mod
                                                  gchar                ***argvp,
                                                  GError                **error);
 
+GList          *thunar_uca_model_parse_argv_batches (ThunarUcaModel     *uca_model,
+                                                     GtkTreeIter        *iter,
+                                                     GList              *file_infos,
+                                                     GError            **error);
+
 G_END_DECLS;
 
 #endif /* !__THUNAR_UCA_MODEL_H__ */
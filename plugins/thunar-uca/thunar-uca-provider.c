@@ -36,6 +36,30 @@
 
 
 
+/* the number of batches of an action that run at the same time */
+#define THUNAR_UCA_PROVIDER_MAX_RUNNING_BATCHES (4)
+
+
+
+/* an action that runs in several batches, because the command line
+ * for all the files is too long, see thunar_uca_model_parse_argv_batches() */
+typedef struct
+{
+  ThunarUcaProvider *uca_provider;
+  GdkScreen         *screen;
+  gchar             *working_directory;
+  gchar             *icon_name;
+  gchar             *label;
+  GQueue             pending;   /* argument vectors not started yet */
+  guint              n_batches;
+  guint              n_running;
+  guint              n_failed;
+  GError            *error;     /* the first error when spawning */
+}
+ThunarUcaBatches;
+
+
+
 static void   thunar_uca_provider_menu_provider_init        (ThunarxMenuProviderIface         *iface);
 static void   thunar_uca_provider_preferences_provider_init (ThunarxPreferencesProviderIface  *iface);
 static void   thunar_uca_provider_finalize                  (GObject                          *object);
@@ -53,6 +77,9 @@ static void   thunar_uca_provider_child_watch               (ThunarUcaProvider
                                                              gint                              exit_status);
 static void   thunar_uca_provider_child_watch_destroy       (gpointer                          user_data,
                                                              GClosure                         *closure);
+static void   thunar_uca_provider_emit_changed              (const gchar                      *path);
+static void   thunar_uca_batches_child_watch                (ThunarUcaBatches                 *batches,
+                                                             gint                              exit_status);
 
 
 
@@ -401,6 +428,146 @@ thunar_uca_provider_get_folder_menu_items (ThunarxMenuProvider *menu_provider,
 
 
 
+static gchar *
+thunar_uca_provider_get_working_directory (ThunarxMenuItem *item,
+                                           GList           *files)
+{
+  GFile *location;
+  gchar *working_directory = NULL;
+  gchar *filename;
+
+  if (G_LIKELY (files != NULL))
+    {
+      /* determine the filename of the first selected file */
+      location = thunarx_file_info_get_location (files->data);
+      filename = g_file_get_path (location);
+      if (G_LIKELY (filename != NULL))
+        {
+          /* if this is a folder menu item, we just use the filename as working directory */
+          if (g_object_get_qdata (G_OBJECT (item), thunar_uca_folder_quark) != NULL)
+            {
+              working_directory = filename;
+              filename = NULL;
+            }
+          else
+            {
+              working_directory = g_path_get_dirname (filename);
+            }
+        }
+      g_free (filename);
+      g_object_unref (location);
+    }
+
+  return working_directory;
+}
+
+
+
+static void
+thunar_uca_batches_free (ThunarUcaBatches *batches)
+{
+  g_queue_clear_full (&batches->pending, (GDestroyNotify) g_strfreev);
+  g_clear_error (&batches->error);
+  g_object_unref (batches->uca_provider);
+  g_object_unref (batches->screen);
+  g_free (batches->working_directory);
+  g_free (batches->icon_name);
+  g_free (batches->label);
+  g_slice_free (ThunarUcaBatches, batches);
+}
+
+
+
+static void
+thunar_uca_batches_finish (ThunarUcaBatches *batches)
+{
+  GtkWidget *dialog;
+
+  /* the batches changed the folder, like a single command does */
+  if (batches->working_directory != NULL)
+    thunar_uca_provider_emit_changed (batches->working_directory);
+
+  /* one message for all batches that failed, the window may be gone by now */
+  if (batches->n_failed > 0)
+    {
+      dialog = gtk_message_dialog_new (NULL, 0, GTK_MESSAGE_ERROR, GTK_BUTTONS_CLOSE,
+                                       _("Failed to run action \"%s\"."), batches->label);
+      gtk_window_set_title (GTK_WINDOW (dialog), _("Error"));
+      gtk_window_set_screen (GTK_WINDOW (dialog), batches->screen);
+      if (batches->error != NULL)
+        gtk_message_dialog_format_secondary_text (GTK_MESSAGE_DIALOG (dialog), "%s.", batches->error->message);
+      else
+        gtk_message_dialog_format_secondary_text (GTK_MESSAGE_DIALOG (dialog),
+                                                  ngettext ("%u of %u batch of files failed.",
+                                                            "%u of %u batches of files failed.",
+                                                            batches->n_batches),
+                                                  batches->n_failed, batches->n_batches);
+      g_signal_connect (G_OBJECT (dialog), "response", G_CALLBACK (gtk_widget_destroy), NULL);
+      gtk_widget_show (dialog);
+    }
+
+  thunar_uca_batches_free (batches);
+}
+
+
+
+static void
+thunar_uca_batches_spawn (ThunarUcaBatches *batches)
+{
+  GClosure  *child_watch;
+  GError    *error = NULL;
+  gchar    **argv;
+  gboolean   succeed;
+
+  /* keep a bounded number of batches running, each starts the next one when it exits */
+  while (batches->n_running < THUNAR_UCA_PROVIDER_MAX_RUNNING_BATCHES
+         && (argv = g_queue_pop_head (&batches->pending)) != NULL)
+    {
+      child_watch = g_cclosure_new_swap (G_CALLBACK (thunar_uca_batches_child_watch), batches, NULL);
+      g_closure_ref (child_watch);
+      g_closure_sink (child_watch);
+
+      succeed = xfce_spawn_on_screen_with_child_watch (batches->screen, batches->working_directory,
+                                                       argv, NULL, G_SPAWN_SEARCH_PATH, FALSE,
+                                                       gtk_get_current_event_time (),
+                                                       batches->icon_name, child_watch, &error);
+      g_closure_unref (child_watch);
+      g_strfreev (argv);
+
+      if (G_LIKELY (succeed))
+        {
+          batches->n_running++;
+        }
+      else
+        {
+          batches->n_failed++;
+          if (batches->error == NULL)
+            batches->error = error;
+          else
+            g_error_free (error);
+          error = NULL;
+        }
+    }
+
+  if (batches->n_running == 0)
+    thunar_uca_batches_finish (batches);
+}
+
+
+
+static void
+thunar_uca_batches_child_watch (ThunarUcaBatches *batches,
+                                gint              exit_status)
+{
+  batches->n_running--;
+  if (exit_status != 0)
+    batches->n_failed++;
+
+  thunar_uca_batches_spawn (batches);
+}
+
+
+
 static void
 thunar_uca_provider_activated (ThunarUcaProvider *uca_provider,
                                ThunarxMenuItem   *item)
@@ -414,12 +581,12 @@ thunar_uca_provider_activated (ThunarUcaProvider *uca_provider,
   gboolean             succeed;
   GError              *error = NULL;
   GList               *files;
+  GList               *argvs;
+  GList               *lp;
+  ThunarUcaBatches    *batches;
   gchar              **argv;
   gchar               *working_directory = NULL;
-  gchar               *filename;
   gchar               *label;
-  GFile               *location;
-  gint                 argc;
   gchar               *icon_name = NULL;
   gboolean             startup_notify;
   GClosure            *child_watch;
@@ -442,10 +609,34 @@ thunar_uca_provider_activated (ThunarUcaProvider *uca_provider,
   window = thunar_uca_context_get_window (uca_context);
   files = thunar_uca_context_get_files (uca_context);
 
-  /* determine the argc/argv for the item */
-  succeed = thunar_uca_model_parse_argv (uca_provider->model, &iter, files, &argc, &argv, &error);
-  if (G_LIKELY (succeed))
+  /* determine the argv for the item, one for each batch of the files */
+  argvs = thunar_uca_model_parse_argv_batches (uca_provider->model, &iter, files, &error);
+  succeed = (argvs != NULL);
+  if (G_LIKELY (succeed && argvs->next != NULL))
+    {
+      batches = g_slice_new0 (ThunarUcaBatches);
+      batches->uca_provider = g_object_ref (uca_provider);
+      batches->screen = g_object_ref (gtk_widget_get_screen (GTK_WIDGET (window)));
+      batches->working_directory = thunar_uca_provider_get_working_directory (item, files);
+      batches->n_batches = g_list_length (argvs);
+      g_object_get (G_OBJECT (item), "label", &batches->label, NULL);
+      gtk_tree_model_get (GTK_TREE_MODEL (uca_provider->model), &iter,
+                          THUNAR_UCA_MODEL_COLUMN_ICON_NAME, &batches->icon_name,
+                          -1);
+
+      /* the batches take over the argument vectors */
+      g_queue_init (&batches->pending);
+      for (lp = argvs; lp != NULL; lp = lp->next)
+        g_queue_push_tail (&batches->pending, lp->data);
+      g_list_free (argvs);
+
+      thunar_uca_batches_spawn (batches);
+    }
+  else if (G_LIKELY (succeed))
     {
+      argv = argvs->data;
+      g_list_free (argvs);
+
       /* get the icon name and whether startup notification is active */
       gtk_tree_model_get (GTK_TREE_MODEL (uca_provider->model), &iter,
                           THUNAR_UCA_MODEL_COLUMN_ICON_NAME, &icon_name,
@@ -453,27 +644,7 @@ thunar_uca_provider_activated (ThunarUcaProvider *uca_provider,
                           -1);
 
       /* determine the working from the first file */
-      if (G_LIKELY (files != NULL))
-        {
-          /* determine the filename of the first selected file */
-          location = thunarx_file_info_get_location (files->data);
-          filename = g_file_get_path (location);
-          if (G_LIKELY (filename != NULL))
-            {
-              /* if this is a folder menu item, we just use the filename as working directory */
-              if (g_object_get_qdata (G_OBJECT (item), thunar_uca_folder_quark) != NULL)
-                {
-                  working_directory = filename;
-                  filename = NULL;
-                }
-              else
-                {
-                  working_directory = g_path_get_dirname (filename);
-                }
-            }
-          g_free (filename);
-          g_object_unref (location);
-        }
+      working_directory = thunar_uca_provider_get_working_directory (item, files);
 
       /* build closre for child watch */
       child_watch = g_cclosure_new_swap (G_CALLBACK (thunar_uca_provider_child_watch),
@@ -542,29 +713,11 @@ thunar_uca_provider_child_watch (ThunarUcaProvider *uca_provider,
                                  gint               exit_status)
 
 {
-  GFileMonitor *monitor;
-  GFile        *file;
-
   g_return_if_fail (THUNAR_UCA_IS_PROVIDER (uca_provider));
 
   /* verify that we still have a valid child_watch_path */
   if (G_LIKELY (uca_provider->child_watch_path != NULL))
-    {
-      /* determine the corresponding file */
-      file = g_file_new_for_path (uca_provider->child_watch_path);
-
-      /* schedule a changed notification on the path */
-      monitor = g_file_monitor (file, G_FILE_MONITOR_NONE, NULL, NULL);
-
-      if (monitor != NULL)
-        {
-          g_file_monitor_emit_event (monitor, file, file, G_FILE_MONITOR_EVENT_CHANGED);
-          g_object_unref (monitor);
-        }
-
-      /* release the file */
-      g_object_unref (file);
-    }
+    thunar_uca_provider_emit_changed (uca_provider->child_watch_path);
 
   thunar_uca_provider_child_watch_destroy (uca_provider, NULL);
 }
@@ -596,3 +749,27 @@ thunar_uca_provider_child_watch_destroy (gpointer  user_data,
       uca_provider->child_watch_path = NULL;
     }
 }
+
+
+
+static void
+thunar_uca_provider_emit_changed (const gchar *path)
+{
+  GFileMonitor *monitor;
+  GFile        *file;
+
+  /* determine the corresponding file */
+  file = g_file_new_for_path (path);
+
+  /* schedule a changed notification on the path */
+  monitor = g_file_monitor (file, G_FILE_MONITOR_NONE, NULL, NULL);
+
+  if (monitor != NULL)
+    {
+      g_file_monitor_emit_event (monitor, file, file, G_FILE_MONITOR_EVENT_CHANGED);
+      g_object_unref (monitor);
+    }
+
+  /* release the file */
+  g_object_unref (file);
+}
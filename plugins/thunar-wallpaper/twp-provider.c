@@ -23,6 +23,8 @@
 #include <config.h>
 #endif
 
+#include <string.h>
+
 #include <gio/gio.h>
 
 #include <gdk/gdkx.h>
@@ -49,10 +51,28 @@ static GList *twp_provider_get_file_menu_items  (ThunarxMenuProvider      *menu_
 static void   twp_action_set_wallpaper          (ThunarxMenuItem          *item,
                                                  gpointer                  user_data);
 static gint   twp_get_active_workspace_number   (GdkScreen *screen);
+static void   twp_backdrop_change_free          (gpointer                  data);
+static gint   twp_backdrop_get_int              (GHashTable               *backdrop,
+                                                 const gchar              *property,
+                                                 gint                      default_value);
+static gboolean twp_backdrop_get_bool           (GHashTable               *backdrop,
+                                                 const gchar              *property,
+                                                 gboolean                  default_value);
+static void   twp_backdrop_queue                (GPtrArray                *changes,
+                                                 GHashTable               *backdrop,
+                                                 gchar                    *property,
+                                                 GValue                   *value);
 
 static gboolean    _has_gsettings = FALSE;
 static GtkWidget   *main_window = NULL;
 
+/* a pending write to the xfce4-desktop channel */
+typedef struct
+{
+  gchar  *property;
+  GValue  value;
+} TwpBackdropChange;
+
 struct _TwpProviderClass
 {
   GObjectClass __parent__;
@@ -167,27 +187,31 @@ static void
 twp_action_set_wallpaper (ThunarxMenuItem *item,
                           gpointer         user_data)
 {
-  ThunarxFileInfo *file_info = user_data;
-  GdkDisplay      *display = gdk_display_get_default();
-  gint             screen_nr = 0;
-  gint             n_monitors;
-  gint             monitor_nr = 0;
-  gint             workspace;
-  GdkScreen       *screen;
-  GdkMonitor      *monitor;
-  gchar           *image_path_prop;
-  gchar           *image_show_prop;
-  gchar           *image_style_prop;
-  const char      *monitor_name;
-  gchar           *file_uri;
-  gchar           *escaped_file_name;
-  gchar           *file_name = NULL;
-  gchar           *hostname = NULL;
-  gchar           *command;
-  XfconfChannel   *channel;
-  gboolean         is_single_workspace;
-  gint             current_image_style;
-  const gchar     *desktop_type = NULL;
+  ThunarxFileInfo   *file_info = user_data;
+  GdkDisplay        *display = gdk_display_get_default();
+  gint               screen_nr = 0;
+  gint               n_monitors;
+  gint               monitor_nr = 0;
+  gint               workspace;
+  GdkScreen         *screen;
+  GdkMonitor        *monitor;
+  gchar             *image_path_prop;
+  gchar             *image_style_prop;
+  const char        *monitor_name;
+  gchar             *file_uri;
+  gchar             *escaped_file_name;
+  gchar             *file_name = NULL;
+  gchar             *hostname = NULL;
+  gchar             *command;
+  XfconfChannel     *channel;
+  gboolean           is_single_workspace;
+  gint               current_image_style;
+  const gchar       *desktop_type = NULL;
+  GHashTable        *backdrop;
+  GPtrArray         *changes;
+  TwpBackdropChange *change;
+  GValue             value = G_VALUE_INIT;
+  guint              n;
 
   screen = gdk_display_get_default_screen (display);
 
@@ -230,37 +254,46 @@ twp_action_set_wallpaper (ThunarxMenuItem *item,
 
       channel = xfconf_channel_get ("xfce4-desktop");
 
-      /* This is the format for xfdesktop before 4.11 */
-      image_path_prop = g_strdup_printf("/backdrop/screen%d/monitor%d/image-path", screen_nr, monitor_nr);
-      image_show_prop = g_strdup_printf("/backdrop/screen%d/monitor%d/image-show", screen_nr, monitor_nr);
-      image_style_prop = g_strdup_printf("/backdrop/screen%d/monitor%d/image-style", screen_nr, monitor_nr);
+      /* every xfconf call is a D-Bus round trip, so read all backdrop
+       * settings at once and write only what actually changes */
+      backdrop = xfconf_channel_get_properties (channel, "/backdrop");
+      changes = g_ptr_array_new_with_free_func (twp_backdrop_change_free);
 
-      /* Set the wallpaper and ensure that it's set to show */
-      xfconf_channel_set_string (channel, image_path_prop, file_name);
-      xfconf_channel_set_bool (channel, image_show_prop, TRUE);
+      /* This is the format for xfdesktop before 4.11 */
+      image_style_prop = g_strdup_printf ("/backdrop/screen%d/monitor%d/image-style", screen_nr, monitor_nr);
 
       /* If there isn't a wallpaper style set (-1), or it is set to 'None' (which is 0) then set one */
-      current_image_style = xfconf_channel_get_int (channel, image_style_prop, -1);
-      if (current_image_style <= 0 )
+      current_image_style = twp_backdrop_get_int (backdrop, image_style_prop, -1);
+      if (current_image_style <= 0)
         {
           /* Lets hope that 5 = 'Zoomed' works fine for the selected picture */
-          xfconf_channel_set_int (channel, image_style_prop, 5);
+          g_value_init (&value, G_TYPE_INT);
+          g_value_set_int (&value, 5);
+          twp_backdrop_queue (changes, backdrop, image_style_prop, &value);
+        }
+      else
+        {
+          g_free (image_style_prop);
         }
 
-      g_free(image_path_prop);
-      g_free(image_show_prop);
-      g_free(image_style_prop);
+      /* Ensure that the wallpaper is set to show */
+      g_value_init (&value, G_TYPE_BOOLEAN);
+      g_value_set_boolean (&value, TRUE);
+      twp_backdrop_queue (changes, backdrop, g_strdup_printf ("/backdrop/screen%d/monitor%d/image-show", screen_nr, monitor_nr), &value);
 
+      g_value_init (&value, G_TYPE_STRING);
+      g_value_set_string (&value, file_name);
+      twp_backdrop_queue (changes, backdrop, g_strdup_printf ("/backdrop/screen%d/monitor%d/image-path", screen_nr, monitor_nr), &value);
 
       /* Xfdesktop 4.11+ has a concept of a single-workspace-mode where
        * the same workspace is used for everything but additionally allows
        * the user to use any current workspace as the single active
        * workspace, we'll need to check if it is enabled (which by default
        * it is) and use that. */
-      is_single_workspace = xfconf_channel_get_bool (channel, "/backdrop/single-workspace-mode", TRUE);
+      is_single_workspace = twp_backdrop_get_bool (backdrop, "/backdrop/single-workspace-mode", TRUE);
       if (is_single_workspace)
         {
-          workspace = xfconf_channel_get_int (channel, "/backdrop/single-workspace-number", 0);
+          workspace = twp_backdrop_get_int (backdrop, "/backdrop/single-workspace-number", 0);
         }
 
       /* This is the format for xfdesktop post 4.11. A workspace number is
@@ -280,18 +313,35 @@ twp_action_set_wallpaper (ThunarxMenuItem *item,
           image_style_prop = g_strdup_printf("/backdrop/screen%d/monitor%d/workspace%d/image-style", screen_nr, monitor_nr, workspace);
         }
 
-      xfconf_channel_set_string (channel, image_path_prop, file_name);
-
       /* If there isn't a wallpaper style set (-1), or it is set to 'None' (which is 0) then set one */
-      current_image_style = xfconf_channel_get_int (channel, image_style_prop, -1);
+      current_image_style = twp_backdrop_get_int (backdrop, image_style_prop, -1);
       if (current_image_style <= 0)
         {
           /* Lets hope that 5 = 'Zoomed' works fine for the selected picture */
-          xfconf_channel_set_int (channel, image_style_prop, 5);
+          g_value_init (&value, G_TYPE_INT);
+          g_value_set_int (&value, 5);
+          twp_backdrop_queue (changes, backdrop, image_style_prop, &value);
+        }
+      else
+        {
+          g_free (image_style_prop);
+        }
+
+      /* xfdesktop redraws when the image changes, so that one goes last
+       * and the style is already in place by then */
+      g_value_init (&value, G_TYPE_STRING);
+      g_value_set_string (&value, file_name);
+      twp_backdrop_queue (changes, backdrop, image_path_prop, &value);
+
+      for (n = 0; n < changes->len; ++n)
+        {
+          change = g_ptr_array_index (changes, n);
+          xfconf_channel_set_property (channel, change->property, &change->value);
         }
 
-      g_free(image_path_prop);
-      g_free(image_style_prop);
+      g_ptr_array_unref (changes);
+      if (backdrop != NULL)
+        g_hash_table_destroy (backdrop);
     }
   else if (g_strcmp0 (desktop_type, "GNOME") == 0)
     {
@@ -376,3 +426,87 @@ twp_get_active_workspace_number (GdkScreen *screen)
 
   return ws_num;
 }
+
+static void
+twp_backdrop_change_free (gpointer data)
+{
+  TwpBackdropChange *change = data;
+
+  g_free (change->property);
+  g_value_unset (&change->value);
+  g_slice_free (TwpBackdropChange, change);
+}
+
+static gint
+twp_backdrop_get_int (GHashTable  *backdrop,
+                      const gchar *property,
+                      gint         default_value)
+{
+  const GValue *value;
+  GValue        int_value = G_VALUE_INIT;
+  gint          result = default_value;
+
+  value = (backdrop != NULL) ? g_hash_table_lookup (backdrop, property) : NULL;
+  if (value == NULL)
+    return default_value;
+
+  /* xfconf_channel_get_int() converts as well, e.g. from unsigned values */
+  g_value_init (&int_value, G_TYPE_INT);
+  if (g_value_transform (value, &int_value))
+    result = g_value_get_int (&int_value);
+  g_value_unset (&int_value);
+
+  return result;
+}
+
+static gboolean
+twp_backdrop_get_bool (GHashTable  *backdrop,
+                       const gchar *property,
+                       gboolean     default_value)
+{
+  const GValue *value;
+
+  value = (backdrop != NULL) ? g_hash_table_lookup (backdrop, property) : NULL;
+  if (value == NULL || !G_VALUE_HOLDS_BOOLEAN (value))
+    return default_value;
+
+  return g_value_get_boolean (value);
+}
+
+/* takes @property and the contents of @value, which is left empty for
+ * the next g_value_init() */
+static void
+twp_backdrop_queue (GPtrArray  *changes,
+                    GHashTable *backdrop,
+                    gchar      *property,
+                    GValue     *value)
+{
+  TwpBackdropChange *change;
+  const GValue      *current;
+  gboolean           unchanged = FALSE;
+
+  /* writing the same value again would still make xfdesktop reload */
+  current = (backdrop != NULL) ? g_hash_table_lookup (backdrop, property) : NULL;
+  if (current != NULL && G_VALUE_TYPE (current) == G_VALUE_TYPE (value))
+    {
+      if (G_VALUE_HOLDS_STRING (value))
+        unchanged = (g_strcmp0 (g_value_get_string (current), g_value_get_string (value)) == 0);
+      else if (G_VALUE_HOLDS_INT (value))
+        unchanged = (g_value_get_int (current) == g_value_get_int (value));
+      else if (G_VALUE_HOLDS_BOOLEAN (value))
+        unchanged = (g_value_get_boolean (current) == g_value_get_boolean (value));
+    }
+
+  if (unchanged)
+    {
+      g_free (property);
+      g_value_unset (value);
+      return;
+    }
+
+  change = g_slice_new0 (TwpBackdropChange);
+  change->property = property;
+  change->value = *value;
+  memset (value, 0, sizeof (*value));
+  g_ptr_array_add (changes, change);
+}
@@ -41,6 +41,7 @@
 #include "thunar/thunar-notify.h"
 #include "thunar/thunar-session-client.h"
 #include "thunar/thunar-preferences.h"
+#include "thunar/thunar-profile.h"
 
 
 
@@ -49,6 +50,10 @@ main (int argc, char **argv)
 {
   ThunarApplication   *application;
   GError              *error = NULL;
+  gint64               begin_time;
+
+  /* time the startup phases if requested */
+  thunar_profile_init (argc, argv);
 
   /* setup translation domain */
   xfce_textdomain (GETTEXT_PACKAGE, PACKAGE_LOCALE_DIR, "UTF-8");
@@ -64,6 +69,7 @@ main (int argc, char **argv)
 #endif
 
   /* initialize xfconf */
+  begin_time = thunar_profile_begin ();
   if (!xfconf_init (&error))
     {
       g_warning (PACKAGE_NAME ": Failed to initialize Xfconf: %s", error->message);
@@ -72,12 +78,15 @@ main (int argc, char **argv)
       /* disable get/set properties */
       thunar_preferences_xfconf_init_failed ();
     }
+  thunar_profile_end (begin_time, "xfconf-init");
 
   /* register additional transformation functions */
   thunar_g_initialize_transformations ();
 
   /* acquire a reference on the global application */
+  begin_time = thunar_profile_begin ();
   application = thunar_application_get ();
+  thunar_profile_end (begin_time, "application-init");
 
   /* use the Thunar icon as default for new windows */
   gtk_window_set_default_icon_name ("Thunar");
@@ -181,6 +181,7 @@ thunar_abstract_icon_view_init (ThunarAbstractIconView *abstract_icon_view)
 
   /* initialize the abstract icon view properties */
   exo_icon_view_set_enable_search (EXO_ICON_VIEW (view), TRUE);
+  exo_icon_view_set_search_equal_func (EXO_ICON_VIEW (view), thunar_standard_view_model_search_equal_func, NULL, NULL);
   exo_icon_view_set_selection_mode (EXO_ICON_VIEW (view), GTK_SELECTION_MULTIPLE);
 
   /* add the abstract icon renderer */
@@ -40,14 +40,15 @@
 #include "thunar/thunar-gobject-extensions.h"
 #include "thunar/thunar-gtk-extensions.h"
 #include "thunar/thunar-icon-factory.h"
-#include "thunar/thunar-io-scan-directory.h"
 #include "thunar/thunar-preferences.h"
 #include "thunar/thunar-private.h"
+#include "thunar/thunar-profile.h"
 #include "thunar/thunar-properties-dialog.h"
 #include "thunar/thunar-renamer-dialog.h"
 #include "thunar/thunar-sendto-model.h"
 #include "thunar/thunar-shortcuts-pane.h"
 #include "thunar/thunar-simple-job.h"
+#include "thunar/thunar-templates-index.h"
 #include "thunar/thunar-device-monitor.h"
 #include "thunar/thunar-tree-view.h"
 #include "thunar/thunar-util.h"
@@ -86,6 +87,21 @@
 
 
 typedef struct _ThunarActionManagerPokeData ThunarActionManagerPokeData;
+typedef struct _ThunarActionManagerCustomActions ThunarActionManagerCustomActions;
+
+
+
+/* time (in ms) spent asking menu providers per idle iteration */
+#define CUSTOM_ACTIONS_IDLE_BUDGET (8)
+
+/* selections of this many files or more skip the providers which gave no items
+ * for a similar selection recently, smaller selections are cheap to ask for and
+ * the custom actions may depend on their file names */
+#define CUSTOM_ACTIONS_CACHE_MIN_FILES (64)
+
+/* number of entries and the time (in s) the provider cache keeps them */
+#define CUSTOM_ACTIONS_CACHE_SIZE    (256)
+#define CUSTOM_ACTIONS_CACHE_MAX_AGE (60)
 
 
 
@@ -135,6 +151,11 @@ static void                    thunar_action_manager_execute_files
 static void                    thunar_action_manager_open_files                 (ThunarActionManager            *action_mgr,
                                                                                  GList                          *files,
                                                                                  GAppInfo                       *application_to_use);
+static void                    thunar_action_manager_free_file_queue            (gpointer                        data);
+static void                    thunar_action_manager_free_app_info              (gpointer                        data);
+static void                    thunar_action_manager_open_queue                 (GAppInfo                       *app_info,
+                                                                                 GQueue                         *file_queue,
+                                                                                 ThunarActionManager            *action_mgr);
 static void                    thunar_action_manager_open_paths                 (GAppInfo                       *app_info,
                                                                                  GList                          *file_list,
                                                                                  ThunarActionManager            *action_mgr);
@@ -252,6 +273,19 @@ static GQuark thunar_action_manager_file_quark;
 
 static guint action_manager_signals[LAST_SIGNAL];
 
+struct _ThunarActionManagerCustomActions
+{
+  GtkMenuShell *menu;
+  GtkWidget    *window;
+  GtkWidget    *separator;    /* ends the custom actions, shown with the first one */
+  GList        *providers;    /* providers not asked yet */
+  GList        *files;        /* selected files, or NULL for the folder menu */
+  ThunarFile   *folder;
+  gchar        *signature;    /* of the selection in the provider cache, or NULL */
+  guint         idle_id;
+  GCancellable *cancellable;  /* of the asynchronous providers, cancelled with the menu */
+};
+
 struct _ThunarActionManagerPokeData
 {
   GList        *files_to_poke; /* List of thunar-files */
@@ -645,9 +679,7 @@ thunar_action_manager_set_selected_files (ThunarComponent *component,
     g_object_unref (action_mgr->parent_folder);
   action_mgr->parent_folder = NULL;
 
-  action_mgr->files_are_selected = TRUE;
-  if (selected_files == NULL || g_list_length (selected_files) == 0)
-    action_mgr->files_are_selected = FALSE;
+  action_mgr->files_are_selected = (selected_files != NULL);
 
   action_mgr->files_to_process_trashable  = TRUE;
   action_mgr->n_files_to_process          = 0;
@@ -823,18 +855,26 @@ thunar_action_manager_open_files (ThunarActionManager *action_mgr,
                                   GList               *files,
                                   GAppInfo            *application_to_use)
 {
-  GHashTable *applications;
-  GAppInfo   *app_info;
-  GList      *lp;
+  GHashTable  *applications;
+  GHashTable  *handlers;
+  GAppInfo    *app_info;
+  GQueue      *file_queue;
+  GList       *lp;
+  const gchar *content_type;
+  gchar       *handler_key;
 
   /* allocate a hash table to associate applications to URIs. since GIO allocates
    * new GAppInfo objects every time, g_direct_hash does not work. we therefore use
    * a fake hash function to always hit the collision list of the hash table and
-   * avoid storing multiple equal GAppInfos by means of g_app_info_equal(). */
+   * avoid storing multiple equal GAppInfos by means of thunar_g_app_info_equal(). */
   applications = g_hash_table_new_full (thunar_action_manager_g_app_info_hash,
-                                        (GEqualFunc) g_app_info_equal,
+                                        (GEqualFunc) thunar_g_app_info_equal,
                                         (GDestroyNotify) g_object_unref,
-                                        (GDestroyNotify) thunar_g_list_free_full);
+                                        thunar_action_manager_free_file_queue);
+
+  /* the default application is looked up once per content type, a large
+   * selection mostly has only a few of them */
+  handlers = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, thunar_action_manager_free_app_info);
 
   for (lp = files; lp != NULL; lp = lp->next)
     {
@@ -850,40 +890,49 @@ thunar_action_manager_open_files (ThunarActionManager *action_mgr,
         }
       else
         {
-          /* determine the default application for the MIME type */
-          app_info = thunar_file_get_default_handler (lp->data);
+          /* determine the default application for the MIME type, files without
+           * a local path need an application that supports URIs */
+          app_info = NULL;
+          content_type = thunar_file_get_content_type (lp->data);
+          if (G_LIKELY (content_type != NULL))
+            {
+              handler_key = g_strconcat (g_file_peek_path (thunar_file_get_file (lp->data)) != NULL ? "path:" : "uri:", content_type, NULL);
+              if (!g_hash_table_lookup_extended (handlers, handler_key, NULL, (gpointer *) &app_info))
+                {
+                  app_info = thunar_file_get_default_handler (lp->data);
+                  g_hash_table_insert (handlers, handler_key, (app_info != NULL) ? g_object_ref (app_info) : NULL);
+                }
+              else
+                {
+                  if (app_info != NULL)
+                    g_object_ref (app_info);
+                  g_free (handler_key);
+                }
+            }
+          else
+            {
+              app_info = thunar_file_get_default_handler (lp->data);
+            }
         }
 
       /* check if we have an application here */
       if (G_LIKELY (app_info != NULL))
         {
-          /* check if we have that application already */
-          /* Not possibly to check via g_hash_table_lookup directly, since that will only compare pointers */
-          GList *keys      = g_hash_table_get_keys (applications);
-          GList *file_list = NULL;
-
-          for (GList *lp_keys = keys;  lp_keys != NULL; lp_keys = lp_keys->next)
+          /* check if we have that application already, reuse the existing
+           * appinfo instead of adding the new one to the table */
+          file_queue = g_hash_table_lookup (applications, app_info);
+          if (file_queue == NULL)
             {
-              if (thunar_g_app_info_equal (lp_keys->data, app_info))
-                {
-                  /* Reuse the existing appinfo instead of adding the new one to the list*/
-                  g_object_unref (app_info);
-                  app_info = g_object_ref (lp_keys->data);
-
-                  file_list = g_hash_table_lookup (applications, app_info);
-
-                  /* take a copy of the list as the old one will be dropped by the insert */
-                  file_list = thunar_g_list_copy_deep (file_list);
-                }
+              file_queue = g_queue_new ();
+              g_hash_table_insert (applications, app_info, file_queue);
+            }
+          else
+            {
+              g_object_unref (app_info);
             }
-
-          g_list_free (keys);
 
           /* append our new URI to the list */
-          file_list = thunar_g_list_append_deep (file_list, thunar_file_get_file (lp->data));
-
-          /* (re)insert the URI list for the application */
-          g_hash_table_insert (applications, app_info, file_list);
+          g_queue_push_tail (file_queue, g_object_ref (thunar_file_get_file (lp->data)));
         }
       else
         {
@@ -893,11 +942,39 @@ thunar_action_manager_open_files (ThunarActionManager *action_mgr,
         }
     }
 
-  /* run all collected applications */
-  g_hash_table_foreach (applications, (GHFunc) thunar_action_manager_open_paths, action_mgr);
+  /* run all collected applications, with all their files at once */
+  g_hash_table_foreach (applications, (GHFunc) thunar_action_manager_open_queue, action_mgr);
 
-  /* drop the applications hash table */
+  /* drop the hash tables */
   g_hash_table_destroy (applications);
+  g_hash_table_destroy (handlers);
+}
+
+
+
+static void
+thunar_action_manager_free_file_queue (gpointer data)
+{
+  g_queue_free_full (data, g_object_unref);
+}
+
+
+
+static void
+thunar_action_manager_free_app_info (gpointer data)
+{
+  if (data != NULL)
+    g_object_unref (data);
+}
+
+
+
+static void
+thunar_action_manager_open_queue (GAppInfo            *app_info,
+                                  GQueue              *file_queue,
+                                  ThunarActionManager *action_mgr)
+{
+  thunar_action_manager_open_paths (app_info, file_queue->head, action_mgr);
 }
 
 
@@ -2293,66 +2370,321 @@ thunar_action_manager_action_duplicate (ThunarActionManager *action_mgr)
 
 
 
+/* remembers when a menu provider gave no items for a selection signature */
+static GHashTable *custom_actions_cache = NULL;
+
+
+
+static gchar*
+thunar_action_manager_custom_actions_signature (GList      *files,
+                                                ThunarFile *folder)
+{
+  GHashTable *content_types;
+  GString    *signature;
+  GList      *types;
+  GList      *lp;
+  GFile      *location;
+  gchar      *scheme;
+  guint       n_files = 0;
+
+  /* the set of content types, the magnitude of the count and the location scheme */
+  content_types = g_hash_table_new (g_str_hash, g_str_equal);
+  for (lp = files; lp != NULL; lp = lp->next, ++n_files)
+    g_hash_table_add (content_types, (gpointer) thunar_file_get_content_type (lp->data));
+
+  location = thunar_file_get_file (folder);
+  scheme = g_file_get_uri_scheme (location);
+  signature = g_string_new (NULL);
+  g_string_append_printf (signature, "%s:%u", scheme, g_bit_storage (n_files));
+  g_free (scheme);
+
+  types = g_list_sort (g_hash_table_get_keys (content_types), (GCompareFunc) g_strcmp0);
+  for (lp = types; lp != NULL; lp = lp->next)
+    g_string_append_printf (signature, ";%s", (const gchar *) lp->data);
+  g_list_free (types);
+  g_hash_table_destroy (content_types);
+
+  return g_string_free (signature, FALSE);
+}
+
+
+
+static gchar*
+thunar_action_manager_custom_actions_cache_key (ThunarActionManagerCustomActions *custom_actions,
+                                                GObject                          *provider)
+{
+  return g_strconcat (G_OBJECT_TYPE_NAME (provider), "\n", custom_actions->signature, NULL);
+}
+
+
+
+static gboolean
+thunar_action_manager_custom_actions_cached_empty (ThunarActionManagerCustomActions *custom_actions,
+                                                   GObject                          *provider)
+{
+  gpointer  value;
+  gchar    *key;
+  gboolean  empty = FALSE;
+
+  if (custom_actions->signature == NULL || custom_actions_cache == NULL)
+    return FALSE;
+
+  key = thunar_action_manager_custom_actions_cache_key (custom_actions, provider);
+  value = g_hash_table_lookup (custom_actions_cache, key);
+  if (value != NULL)
+    {
+      /* the custom actions may have been edited meanwhile */
+      if (g_get_monotonic_time () - *((gint64 *) value) < CUSTOM_ACTIONS_CACHE_MAX_AGE * G_USEC_PER_SEC)
+        empty = TRUE;
+      else
+        g_hash_table_remove (custom_actions_cache, key);
+    }
+  g_free (key);
+
+  return empty;
+}
+
+
+
+static void
+thunar_action_manager_custom_actions_cache_empty (ThunarActionManagerCustomActions *custom_actions,
+                                                  GObject                          *provider)
+{
+  gint64 *timestamp;
+
+  if (custom_actions->signature == NULL)
+    return;
+
+  if (G_UNLIKELY (custom_actions_cache == NULL))
+    custom_actions_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+  /* start over instead of tracking the age of each entry */
+  if (g_hash_table_size (custom_actions_cache) >= CUSTOM_ACTIONS_CACHE_SIZE)
+    g_hash_table_remove_all (custom_actions_cache);
+
+  timestamp = g_new (gint64, 1);
+  *timestamp = g_get_monotonic_time ();
+  g_hash_table_replace (custom_actions_cache, thunar_action_manager_custom_actions_cache_key (custom_actions, provider), timestamp);
+}
+
+
+
+static gboolean
+thunar_action_manager_custom_actions_insert (ThunarActionManagerCustomActions *custom_actions,
+                                             GList                            *thunarx_menu_items)
+{
+  GtkWidget *gtk_menu_item;
+  GList     *children;
+  GList     *lp;
+  gint       position;
+
+  /* insert the items in front of the separator, which ends the custom actions */
+  children = gtk_container_get_children (GTK_CONTAINER (custom_actions->menu));
+  position = g_list_index (children, custom_actions->separator);
+  g_list_free (children);
+  if (G_UNLIKELY (position < 0))
+    {
+      /* the menu is gone */
+      thunarx_menu_item_list_free (thunarx_menu_items);
+      return FALSE;
+    }
+
+  for (lp = thunarx_menu_items; lp != NULL; lp = lp->next)
+    {
+      gtk_menu_item = thunar_gtk_menu_thunarx_menu_item_new (lp->data, NULL);
+      gtk_menu_shell_insert (custom_actions->menu, gtk_menu_item, position++);
+      gtk_widget_show_all (gtk_menu_item);
+
+      /* Each thunarx_menu_item will be destroyed together with its related gtk_menu_item*/
+      g_signal_connect_swapped (G_OBJECT (gtk_menu_item), "destroy", G_CALLBACK (g_object_unref), lp->data);
+      gtk_widget_show (custom_actions->separator);
+    }
+  g_list_free (thunarx_menu_items);
+
+  return TRUE;
+}
+
+
+
+static void
+thunar_action_manager_custom_actions_ready (GObject      *object,
+                                            GAsyncResult *result,
+                                            gpointer      user_data)
+{
+  ThunarActionManagerCustomActions *custom_actions;
+  GCancellable                     *cancellable = G_CANCELLABLE (user_data);
+  GError                           *error = NULL;
+  GList                            *thunarx_menu_items;
+
+  thunarx_menu_items = thunarx_menu_provider_get_menu_items_finish (THUNARX_MENU_PROVIDER (object), result, &error);
+
+  /* the menu may have been closed before the items arrived */
+  custom_actions = g_object_get_data (G_OBJECT (cancellable), I_("thunar-custom-actions"));
+  if (custom_actions == NULL || g_cancellable_is_cancelled (cancellable))
+    {
+      thunarx_menu_item_list_free (thunarx_menu_items);
+    }
+  else if (error != NULL)
+    {
+      g_debug ("Menu provider %s failed: %s", G_OBJECT_TYPE_NAME (object), error->message);
+    }
+  else
+    {
+      if (thunarx_menu_items == NULL)
+        thunar_action_manager_custom_actions_cache_empty (custom_actions, object);
+      thunar_action_manager_custom_actions_insert (custom_actions, thunarx_menu_items);
+    }
+
+  g_clear_error (&error);
+  g_object_unref (cancellable);
+}
+
+
+
+static gboolean
+thunar_action_manager_custom_actions_idle (gpointer user_data)
+{
+  ThunarActionManagerCustomActions *custom_actions = user_data;
+  GObject                          *provider;
+  GList                            *thunarx_menu_items;
+  gint64                            deadline;
+
+  deadline = g_get_monotonic_time () + CUSTOM_ACTIONS_IDLE_BUDGET * 1000;
+
+  while (custom_actions->providers != NULL && g_get_monotonic_time () < deadline)
+    {
+      provider = custom_actions->providers->data;
+      custom_actions->providers = g_list_delete_link (custom_actions->providers, custom_actions->providers);
+
+      /* skip providers which had nothing for a similar selection */
+      if (thunar_action_manager_custom_actions_cached_empty (custom_actions, provider))
+        {
+          g_object_unref (provider);
+          continue;
+        }
+
+      /* the asynchronous providers insert their items when they arrive */
+      if (thunarx_menu_provider_has_async_menu_items (THUNARX_MENU_PROVIDER (provider)))
+        {
+          if (custom_actions->files == NULL)
+            thunarx_menu_provider_get_folder_menu_items_async (THUNARX_MENU_PROVIDER (provider), custom_actions->window, THUNARX_FILE_INFO (custom_actions->folder),
+                                                               custom_actions->cancellable, thunar_action_manager_custom_actions_ready,
+                                                               g_object_ref (custom_actions->cancellable));
+          else
+            thunarx_menu_provider_get_file_menu_items_async (THUNARX_MENU_PROVIDER (provider), custom_actions->window, custom_actions->files,
+                                                             custom_actions->cancellable, thunar_action_manager_custom_actions_ready,
+                                                             g_object_ref (custom_actions->cancellable));
+          g_object_unref (provider);
+          continue;
+        }
+
+      if (custom_actions->files == NULL)
+        thunarx_menu_items = thunarx_menu_provider_get_folder_menu_items (THUNARX_MENU_PROVIDER (provider), custom_actions->window, THUNARX_FILE_INFO (custom_actions->folder));
+      else
+        thunarx_menu_items = thunarx_menu_provider_get_file_menu_items (THUNARX_MENU_PROVIDER (provider), custom_actions->window, custom_actions->files);
+
+      if (thunarx_menu_items == NULL)
+        thunar_action_manager_custom_actions_cache_empty (custom_actions, provider);
+
+      g_object_unref (provider);
+
+      if (!thunar_action_manager_custom_actions_insert (custom_actions, thunarx_menu_items))
+        {
+          g_list_free_full (custom_actions->providers, g_object_unref);
+          custom_actions->providers = NULL;
+          break;
+        }
+    }
+
+  if (custom_actions->providers != NULL)
+    return TRUE;
+
+  custom_actions->idle_id = 0;
+  return FALSE;
+}
+
+
+
+static void
+thunar_action_manager_custom_actions_free (ThunarActionManagerCustomActions *custom_actions)
+{
+  if (custom_actions->idle_id != 0)
+    g_source_remove (custom_actions->idle_id);
+
+  /* the pending asynchronous providers must not touch the freed menu */
+  g_object_set_data (G_OBJECT (custom_actions->cancellable), I_("thunar-custom-actions"), NULL);
+  g_cancellable_cancel (custom_actions->cancellable);
+  g_object_unref (custom_actions->cancellable);
+
+  g_list_free_full (custom_actions->providers, g_object_unref);
+  thunar_g_list_free_full (custom_actions->files);
+  if (custom_actions->folder != NULL)
+    g_object_unref (custom_actions->folder);
+  g_free (custom_actions->signature);
+  g_slice_free (ThunarActionManagerCustomActions, custom_actions);
+}
+
+
+
 /**
  * thunar_action_manager_append_custom_actions:
  * @action_mgr: a #ThunarActionManager instance
  * @menu      : #GtkMenuShell on which the custom actions should be appended
  *
- * Will append all custom actions which match the file-type to the provided #GtkMenuShell
- *
- * Return value: TRUE if any custom action was added
+ * Will append all custom actions which match the file-type to the provided #GtkMenuShell,
+ * followed by a separator. The menu providers are asked in idle iterations, so the menu
+ * can be shown right away and the custom actions are filled in as they arrive. Providers
+ * with asynchronous menu items are cancelled when the menu is destroyed before they answer.
  **/
-gboolean
+void
 thunar_action_manager_append_custom_actions (ThunarActionManager *action_mgr,
                                              GtkMenuShell        *menu)
 {
-  gboolean                uca_added = FALSE;
-  GtkWidget              *window;
-  GtkWidget              *gtk_menu_item;
-  ThunarxProviderFactory *provider_factory;
-  GList                  *providers;
-  GList                  *thunarx_menu_items = NULL;
-  GList                  *lp_provider;
-  GList                  *lp_item;
+  ThunarActionManagerCustomActions *custom_actions;
+  ThunarxProviderFactory           *provider_factory;
+  GList                            *providers;
+  gint64                            begin_time;
 
-  _thunar_return_val_if_fail (THUNAR_IS_ACTION_MANAGER (action_mgr), FALSE);
-  _thunar_return_val_if_fail (GTK_IS_MENU (menu), FALSE);
+  _thunar_return_if_fail (THUNAR_IS_ACTION_MANAGER (action_mgr));
+  _thunar_return_if_fail (GTK_IS_MENU (menu));
 
-  /* determine the toplevel window we belong to */
-  window = gtk_widget_get_toplevel (action_mgr->widget);
+  /* This may occur when the thunar-window is build */
+  if (G_UNLIKELY (action_mgr->files_to_process == NULL))
+    return;
 
   /* load the menu providers from the provider factory */
+  begin_time = thunar_profile_begin ();
   provider_factory = thunarx_provider_factory_get_default ();
   providers = thunarx_provider_factory_list_providers (provider_factory, THUNARX_TYPE_MENU_PROVIDER);
   g_object_unref (provider_factory);
+  thunar_profile_end (begin_time, "menu-providers");
 
   if (G_UNLIKELY (providers == NULL))
-    return FALSE;
-
-  /* This may occur when the thunar-window is build */
-  if (G_UNLIKELY (action_mgr->files_to_process == NULL))
-    return FALSE;
+    return;
 
-  /* load the menu items offered by the menu providers */
-  for (lp_provider = providers; lp_provider != NULL; lp_provider = lp_provider->next)
+  custom_actions = g_slice_new0 (ThunarActionManagerCustomActions);
+  custom_actions->menu = menu;
+  custom_actions->window = gtk_widget_get_toplevel (action_mgr->widget);
+  custom_actions->providers = providers;
+  custom_actions->folder = g_object_ref (action_mgr->current_directory);
+  custom_actions->cancellable = g_cancellable_new ();
+  g_object_set_data (G_OBJECT (custom_actions->cancellable), I_("thunar-custom-actions"), custom_actions);
+  if (action_mgr->files_are_selected)
     {
-      if (action_mgr->files_are_selected == FALSE)
-        thunarx_menu_items = thunarx_menu_provider_get_folder_menu_items (lp_provider->data, window, THUNARX_FILE_INFO (action_mgr->current_directory));
-      else
-        thunarx_menu_items = thunarx_menu_provider_get_file_menu_items (lp_provider->data, window, action_mgr->files_to_process);
+      custom_actions->files = thunar_g_list_copy_deep (action_mgr->files_to_process);
+      if (action_mgr->n_files_to_process >= CUSTOM_ACTIONS_CACHE_MIN_FILES)
+        custom_actions->signature = thunar_action_manager_custom_actions_signature (custom_actions->files, custom_actions->folder);
+    }
 
-      for (lp_item = thunarx_menu_items; lp_item != NULL; lp_item = lp_item->next)
-        {
-          gtk_menu_item = thunar_gtk_menu_thunarx_menu_item_new (lp_item->data, menu);
+  /* the separator stays hidden until a provider offers items, the pending work is freed along with it */
+  custom_actions->separator = gtk_separator_menu_item_new ();
+  gtk_widget_set_no_show_all (custom_actions->separator, TRUE);
+  gtk_menu_shell_append (menu, custom_actions->separator);
+  g_object_set_data_full (G_OBJECT (custom_actions->separator), I_("thunar-custom-actions"), custom_actions,
+                          (GDestroyNotify) thunar_action_manager_custom_actions_free);
 
-          /* Each thunarx_menu_item will be destroyed together with its related gtk_menu_item*/
-          g_signal_connect_swapped (G_OBJECT (gtk_menu_item), "destroy", G_CALLBACK (g_object_unref), lp_item->data);
-          uca_added = TRUE;
-        }
-      g_list_free (thunarx_menu_items);
-    }
-  g_list_free_full (providers, g_object_unref);
-  return uca_added;
+  /* run before the menu is drawn, so quick providers do not make it flicker */
+  custom_actions->idle_id = g_idle_add_full (G_PRIORITY_HIGH_IDLE, thunar_action_manager_custom_actions_idle, custom_actions, NULL);
 }
 
 
@@ -2370,14 +2702,17 @@ thunar_action_manager_check_uca_key_activation (ThunarActionManager *action_mgr,
   GtkAccelKey             uca_key;
   gchar                  *name, *accel_path;
   gboolean                uca_activated = FALSE;
+  gint64                  begin_time;
 
   /* determine the toplevel window we belong to */
   window = gtk_widget_get_toplevel (action_mgr->widget);
 
   /* load the menu providers from the provider factory */
+  begin_time = thunar_profile_begin ();
   provider_factory = thunarx_provider_factory_get_default ();
   providers = thunarx_provider_factory_list_providers (provider_factory, THUNARX_TYPE_MENU_PROVIDER);
   g_object_unref (provider_factory);
+  thunar_profile_end (begin_time, "menu-providers");
 
   if (G_UNLIKELY (providers == NULL))
     return uca_activated;
@@ -2731,45 +3066,6 @@ thunar_action_manager_action_create_document (ThunarActionManager *action_mgr,
 
 
 
-/* helper method in order to find the parent menu for a menu item */
-static GtkWidget *
-thunar_action_manager_create_document_submenu_templates_find_parent_menu (ThunarFile *file,
-                                                                          GList      *dirs,
-                                                                          GList      *items)
-{
-  GtkWidget *parent_menu = NULL;
-  GFile     *parent;
-  GList     *lp;
-  GList     *ip;
-
-  /* determine the parent of the file */
-  parent = g_file_get_parent (thunar_file_get_file (file));
-
-  /* check if the file has a parent at all */
-  if (parent == NULL)
-    return NULL;
-
-  /* iterate over all dirs and menu items */
-  for (lp = g_list_first (dirs), ip = g_list_first (items);
-       parent_menu == NULL && lp != NULL && ip != NULL;
-       lp = lp->next, ip = ip->next)
-    {
-      /* check if the current dir/item is the parent of our file */
-      if (g_file_equal (parent, thunar_file_get_file (lp->data)))
-        {
-          /* we want to insert an item for the file in this menu */
-          parent_menu = gtk_menu_item_get_submenu (ip->data);
-        }
-    }
-
-  /* destroy the parent GFile */
-  g_object_unref (parent);
-
-  return parent_menu;
-}
-
-
-
 /* recursive helper method in order to create menu items for all available templates */
 static gboolean
 thunar_action_manager_create_document_submenu_templates (ThunarActionManager *action_mgr,
@@ -2784,9 +3080,9 @@ thunar_action_manager_create_document_submenu_templates (ThunarActionManager *ac
   GtkWidget         *submenu;
   GtkWidget         *image;
   GtkWidget         *item;
+  GHashTable        *submenus;
+  GFile             *parent;
   GList             *lp;
-  GList             *dirs = NULL;
-  GList             *items = NULL;
   gint               scale_factor;
 
   _thunar_return_val_if_fail (THUNAR_IS_ACTION_MANAGER (action_mgr), FALSE);
@@ -2799,16 +3095,23 @@ thunar_action_manager_create_document_submenu_templates (ThunarActionManager *ac
   icon_factory = thunar_icon_factory_get_default ();
   scale_factor = gtk_widget_get_scale_factor (create_file_submenu);
 
-  /* sort items so that directories come before files and ancestors come
-   * before descendants */
-  files = g_list_sort (files, (GCompareFunc) (void (*)(void)) thunar_file_compare_by_type);
+  /* folder GFile -> the submenu of its items */
+  submenus = g_hash_table_new (g_file_hash, (GEqualFunc) g_file_equal);
 
-  for (lp = g_list_first (files); lp != NULL; lp = lp->next)
+  /* the templates index sorts directories before files and ancestors
+   * before descendants, so the parent menus exist already */
+  for (lp = files; lp != NULL; lp = lp->next)
     {
       file = lp->data;
 
       /* determine the parent menu for this file/directory */
-      parent_menu = thunar_action_manager_create_document_submenu_templates_find_parent_menu (file, dirs, items);
+      parent_menu = NULL;
+      parent = g_file_get_parent (thunar_file_get_file (file));
+      if (G_LIKELY (parent != NULL))
+        {
+          parent_menu = g_hash_table_lookup (submenus, parent);
+          g_object_unref (parent);
+        }
       if (parent_menu == NULL)
         parent_menu = create_file_submenu;
 
@@ -2832,10 +3135,9 @@ thunar_action_manager_create_document_submenu_templates (ThunarActionManager *ac
           /* allocate a new menu item for the directory */
           gtk_menu_item_set_submenu (GTK_MENU_ITEM (item), submenu);
 
-          /* prepend the directory, its item and the parent menu it should
-           * later be added to to the respective lists */
-          dirs  = g_list_prepend (dirs, file);
-          items = g_list_prepend (items, item);
+          /* remember the submenu for the items of the directory, the
+           * files list keeps the GFile alive */
+          g_hash_table_insert (submenus, thunar_file_get_file (file), submenu);
         }
       else
         {
@@ -2848,9 +3150,7 @@ thunar_action_manager_create_document_submenu_templates (ThunarActionManager *ac
       cairo_surface_destroy (surface);
     }
 
-  /* destroy lists */
-  g_list_free (dirs);
-  g_list_free (items);
+  g_hash_table_destroy (submenus);
 
   /* release the icon factory */
   g_object_unref (icon_factory);
@@ -2872,44 +3172,22 @@ thunar_action_manager_create_document_submenu_templates (ThunarActionManager *ac
 static GtkWidget*
 thunar_action_manager_create_document_submenu_new (ThunarActionManager *action_mgr)
 {
-  GList           *files = NULL;
-  GFile           *home_dir;
-  GFile           *templates_dir = NULL;
-  const gchar     *path;
+  GList           *files;
   gchar           *template_path;
   gchar           *label_text;
   GtkWidget       *submenu;
   GtkWidget       *item;
-  guint            file_scan_limit;
+  gboolean         limit_exceeded;
 
   _thunar_return_val_if_fail (THUNAR_IS_ACTION_MANAGER (action_mgr), NULL);
 
-  g_object_get (G_OBJECT (action_mgr->preferences), "misc-max-number-of-templates", &file_scan_limit, NULL);
-
-  home_dir = thunar_g_file_new_for_home ();
-  path     = g_get_user_special_dir (G_USER_DIRECTORY_TEMPLATES);
-
-  if (G_LIKELY (path != NULL))
-    templates_dir = g_file_new_for_path (path);
-
-  /* If G_USER_DIRECTORY_TEMPLATES not found, set "~/Templates" directory as default */
-  if (G_UNLIKELY (path == NULL) || G_UNLIKELY (g_file_equal (templates_dir, home_dir)))
-    {
-      if (templates_dir != NULL)
-        g_object_unref (templates_dir);
-      templates_dir = g_file_resolve_relative_path (home_dir, "Templates");
-    }
-
-  if (G_LIKELY (templates_dir != NULL))
-    {
-      /* load the ThunarFiles */
-      files = thunar_io_scan_directory (NULL, templates_dir, G_FILE_QUERY_INFO_NONE, TRUE, FALSE, TRUE, &file_scan_limit, NULL);
-    }
+  /* the templates are scanned and monitored by the index, no IO here */
+  files = thunar_templates_index_get_files (&limit_exceeded);
 
   submenu = gtk_menu_new();
   if (files == NULL)
     {
-      template_path = g_file_get_path (templates_dir);
+      template_path = g_file_get_path (thunar_templates_index_get_directory ());
       label_text = g_strdup_printf (_("No templates installed in\n\"%s\""), template_path);
       item = xfce_gtk_image_menu_item_new (label_text, NULL, NULL, NULL, NULL, NULL, GTK_MENU_SHELL (submenu));
       gtk_widget_set_sensitive (item, FALSE);
@@ -2926,7 +3204,7 @@ thunar_action_manager_create_document_submenu_new (ThunarActionManager *action_m
   xfce_gtk_image_menu_item_new_from_icon_name (_("_Empty File"), NULL, NULL, G_CALLBACK (thunar_action_manager_action_create_document),
                                                G_OBJECT (action_mgr), "text-x-generic", GTK_MENU_SHELL (submenu));
                                          
-  if (file_scan_limit == 0)
+  if (limit_exceeded)
     {
         xfce_gtk_menu_append_separator (GTK_MENU_SHELL (submenu));
         xfce_gtk_image_menu_item_new_from_icon_name (("The maximum number of templates was exceeded.\n"
@@ -2934,10 +3212,6 @@ thunar_action_manager_create_document_submenu_new (ThunarActionManager *action_m
                                                       G_OBJECT (action_mgr), "dialog-warning", GTK_MENU_SHELL (submenu));
     }
 
-
-  g_object_unref (templates_dir);
-  g_object_unref (home_dir);
-
   return submenu;
 }
 
@@ -105,7 +105,7 @@ gboolean            thunar_action_manager_append_open_section            (Thunar
                                                                           gboolean                             support_tabs,
                                                                           gboolean                             support_change_directory,
                                                                           gboolean                             force);
-gboolean            thunar_action_manager_append_custom_actions          (ThunarActionManager                 *action_mgr,
+void                thunar_action_manager_append_custom_actions          (ThunarActionManager                 *action_mgr,
                                                                           GtkMenuShell                        *menu);
 gboolean            thunar_action_manager_check_uca_key_activation       (ThunarActionManager                 *action_mgr,
                                                                           GdkEventKey                         *key_event);
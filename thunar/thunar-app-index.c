@@ -0,0 +1,472 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gio/gio.h>
+
+#include "thunar/thunar-app-index.h"
+#include "thunar/thunar-private.h"
+
+/**
+ * SECTION:thunar-app-index
+ * @Short_description: Process wide index of the applications per content type
+ * @Title: ThunarAppIndex
+ *
+ * Every GIO lookup of the applications for a content type walks the
+ * desktop file database and the mimeapps.list files again. The context
+ * menu, the "Open With" chooser and the properties dialog do many of
+ * them for the same few types, so the answers are remembered here per
+ * content type, ordered as GIO returned them.
+ *
+ * Everything is dropped when the #GAppInfoMonitor reports a change
+ * of the installed applications or associations. Thunar calls
+ * thunar_app_index_invalidate() itself after changing associations,
+ * since the monitor only reports those after a while.
+ *
+ * All functions must be called from the main thread.
+ **/
+
+
+
+typedef struct _ThunarAppIndexEntry ThunarAppIndexEntry;
+
+
+
+static void                 thunar_app_index_finalize          (GObject             *object);
+static void                 thunar_app_index_changed           (GAppInfoMonitor     *monitor,
+                                                                ThunarAppIndex      *app_index);
+static ThunarAppIndex      *thunar_app_index_get_instance      (void);
+static ThunarAppIndexEntry *thunar_app_index_lookup            (ThunarAppIndex      *app_index,
+                                                                const gchar         *content_type);
+static GAppInfo            *thunar_app_index_entry_get_default (ThunarAppIndexEntry *entry,
+                                                                gboolean             must_support_uris);
+static gboolean             thunar_app_index_entry_has         (ThunarAppIndexEntry *entry,
+                                                                GAppInfo            *app_info);
+static void                 thunar_app_index_entry_free        (gpointer             data);
+
+
+
+struct _ThunarAppIndexClass
+{
+  GObjectClass __parent__;
+};
+
+struct _ThunarAppIndex
+{
+  GObject          __parent__;
+
+  GAppInfoMonitor *monitor;
+
+  /* g_app_info_get_all(), loaded on demand */
+  GList           *all;
+  gboolean         all_loaded;
+
+  /* content type -> ThunarAppIndexEntry */
+  GHashTable      *entries;
+};
+
+struct _ThunarAppIndexEntry
+{
+  gchar      *content_type;
+
+  /* g_app_info_get_all_for_type() and the ids in it */
+  GList      *all;
+  GHashTable *ids;
+
+  /* g_app_info_get_recommended_for_type(), loaded on demand */
+  GList      *recommended;
+  gboolean    recommended_loaded;
+
+  /* g_app_info_get_default_for_type(), indexed by must_support_uris */
+  GAppInfo   *defaults[2];
+  gboolean    defaults_loaded[2];
+};
+
+
+
+static ThunarAppIndex *default_app_index = NULL;
+
+G_DEFINE_TYPE (ThunarAppIndex, thunar_app_index, G_TYPE_OBJECT)
+
+
+
+static void
+thunar_app_index_class_init (ThunarAppIndexClass *klass)
+{
+  GObjectClass *gobject_class;
+
+  gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->finalize = thunar_app_index_finalize;
+}
+
+
+
+static void
+thunar_app_index_init (ThunarAppIndex *app_index)
+{
+  app_index->entries = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, thunar_app_index_entry_free);
+
+  /* forget everything whenever applications or associations change */
+  app_index->monitor = g_app_info_monitor_get ();
+  g_signal_connect (app_index->monitor, "changed", G_CALLBACK (thunar_app_index_changed), app_index);
+}
+
+
+
+static void
+thunar_app_index_finalize (GObject *object)
+{
+  ThunarAppIndex *app_index = THUNAR_APP_INDEX (object);
+
+  g_signal_handlers_disconnect_by_data (app_index->monitor, app_index);
+  g_object_unref (app_index->monitor);
+
+  g_list_free_full (app_index->all, g_object_unref);
+  g_hash_table_destroy (app_index->entries);
+
+  (*G_OBJECT_CLASS (thunar_app_index_parent_class)->finalize) (object);
+}
+
+
+
+static void
+thunar_app_index_changed (GAppInfoMonitor *monitor,
+                          ThunarAppIndex  *app_index)
+{
+  _thunar_return_if_fail (THUNAR_IS_APP_INDEX (app_index));
+
+  thunar_app_index_invalidate ();
+}
+
+
+
+static ThunarAppIndex *
+thunar_app_index_get_instance (void)
+{
+  /* the instance lives for the rest of the process */
+  if (G_UNLIKELY (default_app_index == NULL))
+    default_app_index = g_object_new (THUNAR_TYPE_APP_INDEX, NULL);
+
+  return default_app_index;
+}
+
+
+
+static ThunarAppIndexEntry *
+thunar_app_index_lookup (ThunarAppIndex *app_index,
+                         const gchar    *content_type)
+{
+  ThunarAppIndexEntry *entry;
+  const gchar         *id;
+  GList               *lp;
+
+  entry = g_hash_table_lookup (app_index->entries, content_type);
+  if (entry != NULL)
+    return entry;
+
+  entry = g_slice_new0 (ThunarAppIndexEntry);
+  entry->content_type = g_strdup (content_type);
+  entry->all = g_app_info_get_all_for_type (content_type);
+  entry->ids = g_hash_table_new (g_str_hash, g_str_equal);
+  for (lp = entry->all; lp != NULL; lp = lp->next)
+    {
+      id = g_app_info_get_id (lp->data);
+      if (id != NULL)
+        g_hash_table_add (entry->ids, (gpointer) id);
+    }
+
+  g_hash_table_insert (app_index->entries, entry->content_type, entry);
+
+  return entry;
+}
+
+
+
+static GAppInfo *
+thunar_app_index_entry_get_default (ThunarAppIndexEntry *entry,
+                                    gboolean             must_support_uris)
+{
+  must_support_uris = !!must_support_uris;
+
+  if (!entry->defaults_loaded[must_support_uris])
+    {
+      entry->defaults[must_support_uris] = g_app_info_get_default_for_type (entry->content_type, must_support_uris);
+      entry->defaults_loaded[must_support_uris] = TRUE;
+    }
+
+  return entry->defaults[must_support_uris];
+}
+
+
+
+static gboolean
+thunar_app_index_entry_has (ThunarAppIndexEntry *entry,
+                            GAppInfo            *app_info)
+{
+  GAppInfo    *default_app_info;
+  const gchar *id;
+  GList       *lp;
+
+  /* the default application counts as well, it may be missing from the list */
+  default_app_info = thunar_app_index_entry_get_default (entry, FALSE);
+  if (default_app_info != NULL && g_app_info_equal (default_app_info, app_info))
+    return TRUE;
+
+  id = g_app_info_get_id (app_info);
+  if (id != NULL)
+    return g_hash_table_contains (entry->ids, id);
+
+  /* applications without desktop file can only be compared one by one */
+  for (lp = entry->all; lp != NULL; lp = lp->next)
+    if (g_app_info_equal (lp->data, app_info))
+      return TRUE;
+
+  return FALSE;
+}
+
+
+
+static void
+thunar_app_index_entry_free (gpointer data)
+{
+  ThunarAppIndexEntry *entry = data;
+
+  g_list_free_full (entry->all, g_object_unref);
+  g_list_free_full (entry->recommended, g_object_unref);
+  g_hash_table_destroy (entry->ids);
+
+  if (entry->defaults[0] != NULL)
+    g_object_unref (entry->defaults[0]);
+  if (entry->defaults[1] != NULL)
+    g_object_unref (entry->defaults[1]);
+
+  g_free (entry->content_type);
+  g_slice_free (ThunarAppIndexEntry, entry);
+}
+
+
+
+/**
+ * thunar_app_index_get_all:
+ *
+ * Like g_app_info_get_all(), but answered from the index.
+ *
+ * The caller is responsible to free the returned list using
+ * g_list_free_full (list, g_object_unref).
+ *
+ * Return value: the list of all installed #GAppInfo<!---->s.
+ **/
+GList *
+thunar_app_index_get_all (void)
+{
+  ThunarAppIndex *app_index = thunar_app_index_get_instance ();
+
+  if (!app_index->all_loaded)
+    {
+      app_index->all = g_app_info_get_all ();
+      app_index->all_loaded = TRUE;
+    }
+
+  return g_list_copy_deep (app_index->all, (GCopyFunc) (void (*) (void)) g_object_ref, NULL);
+}
+
+
+
+/**
+ * thunar_app_index_get_all_for_type:
+ * @content_type : a content type.
+ *
+ * Like g_app_info_get_all_for_type(), but answered from the index.
+ *
+ * The caller is responsible to free the returned list using
+ * g_list_free_full (list, g_object_unref).
+ *
+ * Return value: the list of #GAppInfo<!---->s for @content_type.
+ **/
+GList *
+thunar_app_index_get_all_for_type (const gchar *content_type)
+{
+  ThunarAppIndexEntry *entry;
+
+  _thunar_return_val_if_fail (content_type != NULL, NULL);
+
+  entry = thunar_app_index_lookup (thunar_app_index_get_instance (), content_type);
+
+  return g_list_copy_deep (entry->all, (GCopyFunc) (void (*) (void)) g_object_ref, NULL);
+}
+
+
+
+/**
+ * thunar_app_index_get_all_for_types:
+ * @content_types : a #GList of content types.
+ *
+ * Determines the applications which can open files of all the
+ * @content_types. They are ordered like the applications of the
+ * first content type, with its default application first.
+ *
+ * The caller is responsible to free the returned list using
+ * g_list_free_full (list, g_object_unref).
+ *
+ * Return value: the list of #GAppInfo<!---->s for all @content_types.
+ **/
+GList *
+thunar_app_index_get_all_for_types (GList *content_types)
+{
+  ThunarAppIndexEntry *first;
+  ThunarAppIndexEntry *entry;
+  ThunarAppIndex      *app_index;
+  GAppInfo            *default_app_info;
+  GPtrArray           *others;
+  GList               *applications = NULL;
+  GList               *lp;
+  guint                n;
+
+  if (content_types == NULL)
+    return NULL;
+
+  app_index = thunar_app_index_get_instance ();
+  first = thunar_app_index_lookup (app_index, content_types->data);
+
+  /* look up the other types once, not per application */
+  others = g_ptr_array_new ();
+  for (lp = content_types->next; lp != NULL; lp = lp->next)
+    {
+      entry = thunar_app_index_lookup (app_index, lp->data);
+      if (entry != first)
+        g_ptr_array_add (others, entry);
+    }
+
+  /* keep the applications of the first type which all other types have as well */
+  for (lp = g_list_last (first->all); lp != NULL; lp = lp->prev)
+    {
+      for (n = 0; n < others->len; ++n)
+        if (!thunar_app_index_entry_has (g_ptr_array_index (others, n), lp->data))
+          break;
+
+      if (n == others->len)
+        applications = g_list_prepend (applications, g_object_ref (lp->data));
+    }
+
+  /* move the default application of the first type in front of the list */
+  default_app_info = thunar_app_index_entry_get_default (first, FALSE);
+  if (default_app_info != NULL)
+    {
+      for (lp = applications; lp != NULL; lp = lp->next)
+        if (g_app_info_equal (lp->data, default_app_info))
+          {
+            g_object_unref (lp->data);
+            applications = g_list_delete_link (applications, lp);
+            break;
+          }
+
+      for (n = 0; n < others->len; ++n)
+        if (!thunar_app_index_entry_has (g_ptr_array_index (others, n), default_app_info))
+          break;
+
+      if (n == others->len)
+        applications = g_list_prepend (applications, g_object_ref (default_app_info));
+    }
+
+  g_ptr_array_free (others, TRUE);
+
+  return applications;
+}
+
+
+
+/**
+ * thunar_app_index_get_recommended_for_type:
+ * @content_type : a content type.
+ *
+ * Like g_app_info_get_recommended_for_type(), but answered from
+ * the index.
+ *
+ * The caller is responsible to free the returned list using
+ * g_list_free_full (list, g_object_unref).
+ *
+ * Return value: the list of recommended #GAppInfo<!---->s for @content_type.
+ **/
+GList *
+thunar_app_index_get_recommended_for_type (const gchar *content_type)
+{
+  ThunarAppIndexEntry *entry;
+
+  _thunar_return_val_if_fail (content_type != NULL, NULL);
+
+  entry = thunar_app_index_lookup (thunar_app_index_get_instance (), content_type);
+  if (!entry->recommended_loaded)
+    {
+      entry->recommended = g_app_info_get_recommended_for_type (content_type);
+      entry->recommended_loaded = TRUE;
+    }
+
+  return g_list_copy_deep (entry->recommended, (GCopyFunc) (void (*) (void)) g_object_ref, NULL);
+}
+
+
+
+/**
+ * thunar_app_index_get_default_for_type:
+ * @content_type      : a content type.
+ * @must_support_uris : whether the application must support URIs.
+ *
+ * Like g_app_info_get_default_for_type(), but answered from the index.
+ *
+ * The caller is responsible to free the returned #GAppInfo using
+ * g_object_unref().
+ *
+ * Return value: the default #GAppInfo for @content_type or %NULL.
+ **/
+GAppInfo *
+thunar_app_index_get_default_for_type (const gchar *content_type,
+                                       gboolean     must_support_uris)
+{
+  ThunarAppIndexEntry *entry;
+  GAppInfo            *app_info;
+
+  _thunar_return_val_if_fail (content_type != NULL, NULL);
+
+  entry = thunar_app_index_lookup (thunar_app_index_get_instance (), content_type);
+  app_info = thunar_app_index_entry_get_default (entry, must_support_uris);
+
+  return (app_info != NULL) ? g_object_ref (app_info) : NULL;
+}
+
+
+
+/**
+ * thunar_app_index_invalidate:
+ *
+ * Forgets everything known about the applications, to be called
+ * after changing the associations of a content type.
+ **/
+void
+thunar_app_index_invalidate (void)
+{
+  /* nothing to forget if the index was never used */
+  if (default_app_index == NULL)
+    return;
+
+  g_list_free_full (default_app_index->all, g_object_unref);
+  default_app_index->all = NULL;
+  default_app_index->all_loaded = FALSE;
+
+  g_hash_table_remove_all (default_app_index->entries);
+}
@@ -0,0 +1,47 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __THUNAR_APP_INDEX_H__
+#define __THUNAR_APP_INDEX_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS;
+
+typedef struct _ThunarAppIndexClass ThunarAppIndexClass;
+typedef struct _ThunarAppIndex      ThunarAppIndex;
+
+#define THUNAR_TYPE_APP_INDEX            (thunar_app_index_get_type ())
+#define THUNAR_APP_INDEX(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), THUNAR_TYPE_APP_INDEX, ThunarAppIndex))
+#define THUNAR_APP_INDEX_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), THUNAR_TYPE_APP_INDEX, ThunarAppIndexClass))
+#define THUNAR_IS_APP_INDEX(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), THUNAR_TYPE_APP_INDEX))
+#define THUNAR_IS_APP_INDEX_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), THUNAR_TYPE_APP_INDEX))
+#define THUNAR_APP_INDEX_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), THUNAR_TYPE_APP_INDEX, ThunarAppIndexClass))
+
+GType     thunar_app_index_get_type                 (void) G_GNUC_CONST;
+
+GList    *thunar_app_index_get_all                  (void) G_GNUC_MALLOC;
+GList    *thunar_app_index_get_all_for_type         (const gchar *content_type) G_GNUC_MALLOC;
+GList    *thunar_app_index_get_all_for_types        (GList       *content_types) G_GNUC_MALLOC;
+GList    *thunar_app_index_get_recommended_for_type (const gchar *content_type) G_GNUC_MALLOC;
+GAppInfo *thunar_app_index_get_default_for_type     (const gchar *content_type,
+                                                     gboolean     must_support_uris);
+
+void      thunar_app_index_invalidate               (void);
+
+G_END_DECLS;
+
+#endif /* !__THUNAR_APP_INDEX_H__ */
@@ -43,28 +43,46 @@
 #include <gudev/gudev.h>
 #endif
 
+#include <glib/gstdio.h>
+
 #include <libxfce4ui/libxfce4ui.h>
 
 #include "thunar/thunar-application.h"
 #include "thunar/thunar-browser.h"
 #include "thunar/thunar-dialogs.h"
+#include "thunar/thunar-folder.h"
+#include "thunar/thunar-frecency.h"
 #include "thunar/thunar-gdk-extensions.h"
+#include "thunar/thunar-gio-extensions.h"
 #include "thunar/thunar-gobject-extensions.h"
+#include "thunar/thunar-icon-factory.h"
 #include "thunar/thunar-io-jobs.h"
+#include "thunar/thunar-mount-table.h"
 #include "thunar/thunar-preferences.h"
+#include "thunar/thunar-profile.h"
 #include "thunar/thunar-private.h"
 #include "thunar/thunar-progress-dialog.h"
 #include "thunar/thunar-renamer-dialog.h"
+#include "thunar/thunar-shortcuts-model.h"
+#include "thunar/thunar-search-index.h"
+#include "thunar/thunar-templates-index.h"
 #include "thunar/thunar-thumbnail-cache.h"
 #include "thunar/thunar-thumbnailer.h"
 #include "thunar/thunar-transfer-job.h"
 #include "thunar/thunar-util.h"
 #include "thunar/thunar-view.h"
+#include "thunar/thunar-view-settings.h"
 #include "thunar/thunar-session-client.h"
 #include "thunar/thunar-dbus-service.h"
 
 #define ACCEL_MAP_PATH "Thunar/accels.scm"
 
+/* rough memory cost of a file kept in a prewarmed folder, for the budget */
+#define PREWARM_FILE_COST (2 * 1024)
+
+/* the number of frecent folders prewarmed after the tabs of the last session */
+#define PREWARM_FRECENT_LOCATIONS (10)
+
 
 
 /* option values */
@@ -78,6 +96,8 @@ static const GOptionEntry option_entries[] =
 {
   { "bulk-rename", 'B', 0, G_OPTION_ARG_NONE, NULL, N_ ("Open the bulk rename dialog"), NULL, },
   { "daemon", 0, 0, G_OPTION_ARG_NONE, NULL, N_ ("Run in daemon mode"), NULL, },
+  /* handled by thunar_profile_init() before the options are parsed */
+  { "profile-startup", 0, 0, G_OPTION_ARG_NONE, NULL, N_ ("Print the time spent in the startup phases"), NULL, },
   { "sm-client-id", 0, G_OPTION_FLAG_HIDDEN, G_OPTION_ARG_STRING, &opt_sm_client_id, NULL, NULL, },
   { "quit", 'q', 0, G_OPTION_ARG_NONE, NULL, N_ ("Quit a running Thunar instance"), NULL, },
   { "version", 'V', 0, G_OPTION_ARG_NONE, &opt_version, N_ ("Print version information and exit"), NULL, },
@@ -175,7 +195,19 @@ static void           thunar_application_volman_watch_destroy   (gpointer
 static gboolean       thunar_application_show_progress_dialog_timeout         (gpointer                user_data);
 static void           thunar_application_show_progress_dialog_timeout_destroy (gpointer                user_data);
 static GtkWidget     *thunar_application_get_progress_dialog    (ThunarApplication      *application);
+static void           thunar_application_add_job                (ThunarApplication      *application,
+                                                                 GdkScreen              *screen,
+                                                                 ThunarJob              *job,
+                                                                 const gchar            *icon_name,
+                                                                 const gchar            *title);
+static gboolean       thunar_application_resume_transfers       (gpointer                user_data);
 static void           thunar_application_process_files          (ThunarApplication      *application);
+static void           thunar_application_prewarm_start          (ThunarApplication      *application);
+static void           thunar_application_prewarm_stop           (ThunarApplication      *application);
+static gboolean       thunar_application_prewarm_idle           (gpointer                user_data);
+static void           thunar_application_prewarm_folder_loading (ThunarApplication      *application,
+                                                                 GParamSpec             *pspec,
+                                                                 ThunarFolder           *folder);
 
 
 
@@ -196,10 +228,23 @@ struct _ThunarApplication
   ThunarThumbnailCache           *thumbnail_cache;
   ThunarThumbnailer              *thumbnailer;
 
+  ThunarSearchIndex              *search_index;
+
   ThunarDBusService              *dbus_service;
 
   gboolean                        daemon;
 
+  /* caches kept warm while in daemon mode */
+  guint                           prewarm_idle_id;
+  guint                           prewarm_step;
+  guint64                         prewarm_budget;
+  guint64                         prewarm_used;
+  GList                          *prewarm_locations;
+  GList                          *prewarm_folders;
+  ThunarFolder                   *prewarm_loading;
+  ThunarIconFactory              *prewarm_icon_factory;
+  ThunarShortcutsModel           *prewarm_shortcuts_model;
+
   guint                           accel_map_load_id;
   guint                           accel_map_save_id;
   GtkAccelMap                    *accel_map;
@@ -207,6 +252,8 @@ struct _ThunarApplication
   guint                           show_progress_dialog_n_jobs_before;
   guint                           show_progress_dialog_timer_id;
 
+  guint                           resume_transfers_id;
+
 #ifdef HAVE_GUDEV
   GUdevClient                    *udev_client;
 
@@ -355,6 +402,7 @@ static void
 thunar_application_startup (GApplication *gapp)
 {
   ThunarApplication *application = THUNAR_APPLICATION (gapp);
+  gint64             begin_time = thunar_profile_begin ();
 
 #ifdef HAVE_GUDEV
   static const gchar *subsystems[] = { "block", "input", "usb", NULL };
@@ -363,6 +411,15 @@ thunar_application_startup (GApplication *gapp)
   /* initialize the application */
   application->preferences = thunar_preferences_get ();
 
+  /* load or build the filename indexes of the configured folders */
+  application->search_index = thunar_search_index_get_default ();
+
+  /* scan the templates for the "Create Document" menu in the background */
+  thunar_templates_index_load ();
+
+  /* answer the device locality of files without IO */
+  thunar_mount_table_load ();
+
 #ifdef HAVE_GUDEV
   /* establish connection with udev */
   application->udev_client = g_udev_client_new (subsystems);
@@ -383,7 +440,12 @@ thunar_application_startup (GApplication *gapp)
   /* schedule accel map init and update windows when finished */
   application->accel_map_load_id = gdk_threads_add_idle_full (G_PRIORITY_LOW, thunar_application_accel_map_init, application, NULL);
 
+  /* offer to resume the copies interrupted last time */
+  application->resume_transfers_id = gdk_threads_add_idle_full (G_PRIORITY_LOW, thunar_application_resume_transfers, application, NULL);
+
   thunar_application_load_css ();
+
+  thunar_profile_end (begin_time, "application-startup");
 }
 
 
@@ -396,6 +458,18 @@ thunar_application_shutdown (GApplication *gapp)
   /* unqueue all files waiting to be processed */
   thunar_g_list_free_full (application->files_to_launch);
 
+  /* release the prewarmed caches */
+  thunar_application_prewarm_stop (application);
+
+  /* store the buffered metadata settings */
+  thunar_g_file_flush_metadata_settings ();
+
+  /* store the pending folder visits */
+  thunar_frecency_flush ();
+
+  /* store the pending folder view settings */
+  thunar_view_settings_flush ();
+
   /* save the current accel map */
   if (G_UNLIKELY (application->accel_map_save_id != 0))
     {
@@ -406,6 +480,9 @@ thunar_application_shutdown (GApplication *gapp)
   if (G_UNLIKELY (application->accel_map_load_id != 0))
     g_source_remove (application->accel_map_load_id);
 
+  if (G_UNLIKELY (application->resume_transfers_id != 0))
+    g_source_remove (application->resume_transfers_id);
+
   if (application->accel_map != NULL)
     g_object_unref (G_OBJECT (application->accel_map));
 
@@ -437,7 +514,11 @@ thunar_application_shutdown (GApplication *gapp)
   if (application->thumbnail_cache != NULL)
     g_object_unref (G_OBJECT (application->thumbnail_cache));
 
-  /* disconnect from the preferences */
+  /* release the search index */
+  g_object_unref (G_OBJECT (application->search_index));
+
+  /* write the held back window state and disconnect from the preferences */
+  thunar_preferences_flush (application->preferences);
   g_object_unref (G_OBJECT (application->preferences));
 
   /* disconnect from the session manager */
@@ -497,6 +578,7 @@ thunar_application_command_line (GApplication            *gapp,
   GVariantDict      *options_dict = g_application_command_line_get_options_dict (command_line);
   GError            *error        = NULL;
   gchar             *cwd_list[]   = { (gchar *)".", NULL };
+  gint64             begin_time   = thunar_profile_begin ();
 
   /* retrieve arguments */
   g_variant_dict_lookup (options_dict, "bulk-rename", "b", &bulk_rename);
@@ -615,6 +697,8 @@ thunar_application_command_line (GApplication            *gapp,
     }
 
 out:
+  thunar_profile_end (begin_time, "command-line");
+
   /* cleanup */
   g_strfreev (filenames);
 
@@ -936,19 +1020,66 @@ thunar_application_launch (ThunarApplication     *application,
                            ThunarOperationLogMode log_mode,
                            GClosure              *new_files_closure)
 {
-  GtkWidget *dialog;
   GdkScreen *screen;
   ThunarJob *job;
+
+  _thunar_return_if_fail (parent == NULL || GDK_IS_SCREEN (parent) || GTK_IS_WIDGET (parent));
+
+  /* try to allocate a new job for the operation */
+  job = (*launcher) (source_file_list, target_file_list);
+
+  thunar_application_launch_job (application, parent, icon_name, title, job,
+                                 source_file_list, target_file_list,
+                                 update_source_folders, update_target_folders,
+                                 log_mode, new_files_closure);
+
+  /* drop our reference on the job */
+  g_object_unref (job);
+}
+
+
+
+/**
+ * thunar_application_launch_job:
+ * @application           : a #ThunarApplication.
+ * @parent                : a #GdkScreen, a #GtkWidget or %NULL.
+ * @icon_name             : the icon for the progress dialog.
+ * @title                 : the title for the progress dialog.
+ * @job                   : the #ThunarJob to launch.
+ * @source_file_list      : the #GFile<!---->s the @job operates on.
+ * @target_file_list      : the #GFile<!---->s the @job creates.
+ * @update_source_folders : whether to reload the parents of @source_file_list afterwards.
+ * @update_target_folders : whether to reload the parents of @target_file_list afterwards.
+ * @log_mode              : a #ThunarOperationLogMode controlling the logging of the operation.
+ * @new_files_closure     : a #GClosure to connect to the job's "new-files" signal or %NULL.
+ *
+ * Adds an already created @job to the shared progress dialog, the same way
+ * the copy, move and link operations of the @application do. The caller
+ * keeps its reference on @job.
+ **/
+void
+thunar_application_launch_job (ThunarApplication     *application,
+                               gpointer               parent,
+                               const gchar           *icon_name,
+                               const gchar           *title,
+                               ThunarJob             *job,
+                               GList                 *source_file_list,
+                               GList                 *target_file_list,
+                               gboolean               update_source_folders,
+                               gboolean               update_target_folders,
+                               ThunarOperationLogMode log_mode,
+                               GClosure              *new_files_closure)
+{
+  GdkScreen *screen;
   GList     *parent_folder_list = NULL;
 
+  _thunar_return_if_fail (THUNAR_IS_APPLICATION (application));
   _thunar_return_if_fail (parent == NULL || GDK_IS_SCREEN (parent) || GTK_IS_WIDGET (parent));
+  _thunar_return_if_fail (THUNAR_IS_JOB (job));
 
   /* parse the parent pointer */
   screen = thunar_util_parse_parent (parent, NULL);
 
-  /* try to allocate a new job for the operation */
-  job = (*launcher) (source_file_list, target_file_list);
-
   if (update_source_folders)
     parent_folder_list = g_list_concat (parent_folder_list, thunar_g_file_list_get_parents (source_file_list));
   if (update_target_folders)
@@ -965,6 +1096,20 @@ thunar_application_launch (ThunarApplication     *application,
   if (G_LIKELY (new_files_closure != NULL))
     g_signal_connect_closure (job, "new-files", new_files_closure, FALSE);
 
+  thunar_application_add_job (application, screen, job, icon_name, title);
+}
+
+
+
+static void
+thunar_application_add_job (ThunarApplication *application,
+                            GdkScreen         *screen,
+                            ThunarJob         *job,
+                            const gchar       *icon_name,
+                            const gchar       *title)
+{
+  GtkWidget *dialog;
+
   /* get the shared progress dialog */
   dialog = thunar_application_get_progress_dialog (application);
 
@@ -987,9 +1132,50 @@ thunar_application_launch (ThunarApplication     *application,
         gdk_threads_add_timeout_full (G_PRIORITY_DEFAULT, 500, thunar_application_show_progress_dialog_timeout,
                                       application, thunar_application_show_progress_dialog_timeout_destroy);
     }
+}
 
-  /* drop our reference on the job */
-  g_object_unref (job);
+
+
+static gboolean
+thunar_application_resume_transfers (gpointer user_data)
+{
+  ThunarApplication     *application = THUNAR_APPLICATION (user_data);
+  ThunarTransferJournal *journal;
+  ThunarJob             *job;
+  GError                *err = NULL;
+  GList                 *paths;
+  GList                 *lp;
+  GList                 *source_file_list;
+  GList                 *target_file_list;
+
+  application->resume_transfers_id = 0;
+
+  paths = thunar_transfer_journal_list_pending ();
+  for (lp = paths; lp != NULL; lp = lp->next)
+    {
+      journal = thunar_transfer_journal_load (lp->data, &err);
+      if (journal == NULL)
+        {
+          g_warning ("Failed to load the transfer journal: %s", err->message);
+          g_clear_error (&err);
+          g_unlink (lp->data);
+          continue;
+        }
+
+      thunar_transfer_journal_get_files (journal, &source_file_list, &target_file_list);
+      job = thunar_io_jobs_copy_files (source_file_list, target_file_list);
+      thunar_transfer_job_resume (THUNAR_TRANSFER_JOB (job), journal);
+      thunar_g_list_free_full (source_file_list);
+      thunar_g_list_free_full (target_file_list);
+
+      /* the copy shows up paused, to be continued or cancelled by the user */
+      thunar_job_pause (job);
+      thunar_application_add_job (application, NULL, job, "edit-copy", _("Resuming interrupted copy..."));
+      g_object_unref (job);
+    }
+  g_list_free_full (paths, g_free);
+
+  return FALSE;
 }
 
 
@@ -1197,6 +1383,225 @@ thunar_application_show_progress_dialog_timeout_destroy (gpointer user_data)
 
 
 
+/* content types whose icons are looked up ahead of the first window */
+static const gchar *prewarm_content_types[] =
+{
+  "inode/directory",
+  "text/plain",
+  "text/html",
+  "text/x-csrc",
+  "application/pdf",
+  "application/zip",
+  "application/x-executable",
+  "application/x-shellscript",
+  "application/x-desktop",
+  "image/png",
+  "image/jpeg",
+  "audio/mpeg",
+  "video/mp4",
+};
+
+/* icon sizes warmed for each content type, the shortcuts pane size is added */
+static const gint prewarm_icon_sizes[] =
+{
+  THUNAR_ICON_SIZE_16,
+  THUNAR_ICON_SIZE_48,
+};
+
+
+
+static void
+thunar_application_prewarm_start (ThunarApplication *application)
+{
+  gchar **tabs_left = NULL;
+  gchar **tabs_right = NULL;
+  guint   budget;
+  guint   n;
+
+  _thunar_return_if_fail (THUNAR_IS_APPLICATION (application));
+
+  /* the budget is configured in MiB, zero disables prewarming */
+  g_object_get (G_OBJECT (application->preferences), "misc-daemon-prewarm-budget", &budget, NULL);
+  if (budget == 0 || application->prewarm_idle_id != 0)
+    return;
+
+  application->prewarm_budget = (guint64) budget * 1024 * 1024;
+  application->prewarm_used = 0;
+  application->prewarm_step = 0;
+
+  /* the home folder first, then the tabs of the last session and the folders used most */
+  g_object_get (G_OBJECT (application->preferences), "last-tabs-left", &tabs_left, "last-tabs-right", &tabs_right, NULL);
+  for (n = 0; tabs_right != NULL && tabs_right[n] != NULL; ++n)
+    application->prewarm_locations = g_list_prepend (application->prewarm_locations, g_file_new_for_uri (tabs_right[n]));
+  for (n = 0; tabs_left != NULL && tabs_left[n] != NULL; ++n)
+    application->prewarm_locations = g_list_prepend (application->prewarm_locations, g_file_new_for_uri (tabs_left[n]));
+  application->prewarm_locations = g_list_reverse (application->prewarm_locations);
+  application->prewarm_locations = g_list_prepend (application->prewarm_locations, thunar_g_file_new_for_home ());
+  application->prewarm_locations = g_list_concat (application->prewarm_locations, thunar_frecency_get_top (PREWARM_FRECENT_LOCATIONS));
+  g_strfreev (tabs_left);
+  g_strfreev (tabs_right);
+
+  /* do the work in small steps, so requests to the daemon are not delayed */
+  application->prewarm_idle_id = g_idle_add_full (G_PRIORITY_LOW, thunar_application_prewarm_idle, application, NULL);
+}
+
+
+
+static void
+thunar_application_prewarm_stop (ThunarApplication *application)
+{
+  _thunar_return_if_fail (THUNAR_IS_APPLICATION (application));
+
+  if (application->prewarm_idle_id != 0)
+    {
+      g_source_remove (application->prewarm_idle_id);
+      application->prewarm_idle_id = 0;
+    }
+
+  if (application->prewarm_loading != NULL)
+    {
+      g_signal_handlers_disconnect_by_func (G_OBJECT (application->prewarm_loading), thunar_application_prewarm_folder_loading, application);
+      application->prewarm_loading = NULL;
+    }
+
+  thunar_g_list_free_full (application->prewarm_locations);
+  application->prewarm_locations = NULL;
+
+  /* windows opened meanwhile keep their own references */
+  g_list_free_full (application->prewarm_folders, g_object_unref);
+  application->prewarm_folders = NULL;
+  g_clear_object (&application->prewarm_shortcuts_model);
+  g_clear_object (&application->prewarm_icon_factory);
+}
+
+
+
+static void
+thunar_application_prewarm_folder_loading (ThunarApplication *application,
+                                           GParamSpec        *pspec,
+                                           ThunarFolder      *folder)
+{
+  guint64 cost;
+
+  _thunar_return_if_fail (THUNAR_IS_APPLICATION (application));
+  _thunar_return_if_fail (THUNAR_IS_FOLDER (folder));
+
+  if (thunar_folder_get_loading (folder))
+    return;
+
+  g_signal_handlers_disconnect_by_func (G_OBJECT (folder), thunar_application_prewarm_folder_loading, application);
+  application->prewarm_loading = NULL;
+
+  /* keep the folder, with its monitor, only if it fits into the budget */
+  cost = (guint64) g_list_length (thunar_folder_get_files (folder)) * PREWARM_FILE_COST;
+  if (application->prewarm_used + cost > application->prewarm_budget)
+    {
+      application->prewarm_folders = g_list_remove (application->prewarm_folders, folder);
+      g_object_unref (G_OBJECT (folder));
+
+      /* the budget is used up */
+      thunar_g_list_free_full (application->prewarm_locations);
+      application->prewarm_locations = NULL;
+      return;
+    }
+  application->prewarm_used += cost;
+
+  /* continue with the next location */
+  if (application->prewarm_idle_id == 0)
+    application->prewarm_idle_id = g_idle_add_full (G_PRIORITY_LOW, thunar_application_prewarm_idle, application, NULL);
+}
+
+
+
+static gboolean
+thunar_application_prewarm_idle (gpointer user_data)
+{
+  ThunarApplication *application = THUNAR_APPLICATION (user_data);
+  GtkIconTheme      *icon_theme;
+  ThunarIconSize     shortcuts_icon_size;
+  ThunarFolder      *folder;
+  ThunarFile        *file;
+  GdkPixbuf         *icon;
+  GFile             *location;
+  GIcon             *gicon;
+  const gchar      **names;
+  guint              n;
+
+  /* one content type per step, the icons stay in the factory cache */
+  if (application->prewarm_step < G_N_ELEMENTS (prewarm_content_types))
+    {
+      if (application->prewarm_icon_factory == NULL)
+        {
+          icon_theme = gtk_icon_theme_get_default ();
+          application->prewarm_icon_factory = thunar_icon_factory_get_for_icon_theme (icon_theme);
+        }
+
+      g_object_get (G_OBJECT (application->preferences), "shortcuts-icon-size", &shortcuts_icon_size, NULL);
+
+      gicon = g_content_type_get_icon (prewarm_content_types[application->prewarm_step++]);
+      if (G_IS_THEMED_ICON (gicon))
+        {
+          names = (const gchar **) g_themed_icon_get_names (G_THEMED_ICON (gicon));
+          for (n = 0; n <= G_N_ELEMENTS (prewarm_icon_sizes) && names[0] != NULL; ++n)
+            {
+              icon = thunar_icon_factory_load_icon (application->prewarm_icon_factory, names[0],
+                                                    (n < G_N_ELEMENTS (prewarm_icon_sizes)) ? prewarm_icon_sizes[n] : (gint) shortcuts_icon_size,
+                                                    1, FALSE);
+              if (G_LIKELY (icon != NULL))
+                g_object_unref (G_OBJECT (icon));
+            }
+        }
+      g_object_unref (G_OBJECT (gicon));
+
+      return TRUE;
+    }
+
+  /* load the bookmarks and volumes of the side pane */
+  if (application->prewarm_shortcuts_model == NULL)
+    {
+      application->prewarm_shortcuts_model = thunar_shortcuts_model_get_default ();
+      return TRUE;
+    }
+
+  /* start loading the next location, the folder job runs in the background */
+  while (application->prewarm_locations != NULL)
+    {
+      location = application->prewarm_locations->data;
+      application->prewarm_locations = g_list_delete_link (application->prewarm_locations, application->prewarm_locations);
+
+      file = thunar_file_get (location, NULL);
+      g_object_unref (G_OBJECT (location));
+      if (file == NULL)
+        continue;
+
+      folder = thunar_file_is_directory (file) ? thunar_folder_get_for_file (file) : NULL;
+      g_object_unref (G_OBJECT (file));
+      if (folder == NULL)
+        continue;
+
+      /* skip duplicate locations */
+      if (g_list_find (application->prewarm_folders, folder) != NULL)
+        {
+          g_object_unref (G_OBJECT (folder));
+          continue;
+        }
+
+      application->prewarm_folders = g_list_prepend (application->prewarm_folders, folder);
+      application->prewarm_loading = folder;
+      g_signal_connect_swapped (G_OBJECT (folder), "notify::loading", G_CALLBACK (thunar_application_prewarm_folder_loading), application);
+
+      /* wait for the folder, it schedules the next step */
+      application->prewarm_idle_id = 0;
+      thunar_application_prewarm_folder_loading (application, NULL, folder);
+      return FALSE;
+    }
+
+  application->prewarm_idle_id = 0;
+  return FALSE;
+}
+
+
+
 /**
  * thunar_application_get:
  *
@@ -1278,9 +1683,15 @@ thunar_application_set_daemon (ThunarApplication *application,
       g_object_notify (G_OBJECT (application), "daemon");
 
       if (daemonize)
-        g_application_hold (G_APPLICATION (application));
+        {
+          g_application_hold (G_APPLICATION (application));
+          thunar_application_prewarm_start (application);
+        }
       else
-        g_application_release (G_APPLICATION (application));
+        {
+          thunar_application_prewarm_stop (application);
+          g_application_release (G_APPLICATION (application));
+        }
     }
 }
 
@@ -1418,6 +1829,7 @@ thunar_application_open_window (ThunarApplication *application,
   gboolean   open_new_window_as_tab;
   gboolean   misc_open_new_windows_in_split_view;
   gboolean   restore_tabs;
+  gint64     begin_time;
 
   _thunar_return_val_if_fail (THUNAR_IS_APPLICATION (application), NULL);
   _thunar_return_val_if_fail (directory == NULL || THUNAR_IS_FILE (directory), NULL);
@@ -1456,10 +1868,12 @@ thunar_application_open_window (ThunarApplication *application,
   role = g_strdup_printf ("Thunar-%u-%u", (guint) time (NULL), (guint) g_random_int ());
 
   /* allocate the window */
+  begin_time = thunar_profile_begin ();
   window = g_object_new (THUNAR_TYPE_WINDOW,
                          "role", role,
                          "screen", screen,
                          NULL);
+  thunar_profile_end (begin_time, "window-construction");
 
   /* cleanup */
   g_free (role);
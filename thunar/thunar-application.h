@@ -23,6 +23,7 @@
 #ifndef __THUNAR_APPLICATION_H__
 #define __THUNAR_APPLICATION_H__
 
+#include "thunar/thunar-job.h"
 #include "thunar/thunar-job-operation.h"
 #include "thunar/thunar-window.h"
 #include "thunar/thunar-thumbnail-cache.h"
@@ -104,6 +105,18 @@ void                  thunar_application_create_file_from_template (ThunarApplic
                                                                     const gchar             *startup_id,
                                                                     ThunarOperationLogMode   log_mode);
 
+void                  thunar_application_launch_job                (ThunarApplication       *application,
+                                                                    gpointer                 parent,
+                                                                    const gchar             *icon_name,
+                                                                    const gchar             *title,
+                                                                    ThunarJob               *job,
+                                                                    GList                   *source_file_list,
+                                                                    GList                   *target_file_list,
+                                                                    gboolean                 update_source_folders,
+                                                                    gboolean                 update_target_folders,
+                                                                    ThunarOperationLogMode   log_mode,
+                                                                    GClosure                *new_files_closure);
+
 void                  thunar_application_copy_to                   (ThunarApplication       *application,
                                                                     gpointer                 parent,
                                                                     GList                   *source_file_list,
@@ -0,0 +1,204 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The cache registry knows the caches that can be rebuilt when needed, and
+ * sheds them when the system reports low memory through GMemoryMonitor. Each
+ * cache is registered with the warning level from which on it is shed, the
+ * caches cheapest to rebuild with the lowest level. On a warning, the caches
+ * up to its level are shed, in the order of their levels. The registry and
+ * the caches are only used from the main thread. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "thunar/thunar-cache-registry.h"
+#include "thunar/thunar-private.h"
+
+
+
+typedef struct
+{
+  const gchar                *name;
+  GMemoryMonitorWarningLevel  level;
+  ThunarCacheSizeFunc         size_func;
+  ThunarCacheShedFunc         shed_func;
+  gpointer                    user_data;
+}
+ThunarCacheEntry;
+
+
+
+/* the levels from which on the caches are shed, in ascending order */
+static const GMemoryMonitorWarningLevel cache_levels[] =
+{
+  G_MEMORY_MONITOR_WARNING_LEVEL_LOW,
+  G_MEMORY_MONITOR_WARNING_LEVEL_MEDIUM,
+  G_MEMORY_MONITOR_WARNING_LEVEL_CRITICAL,
+};
+
+static GMemoryMonitor *cache_monitor = NULL;
+
+/* the ThunarCacheEntry's in the order they were added */
+static GList          *cache_entries = NULL;
+
+
+
+static void
+thunar_cache_registry_low_memory_warning (GMemoryMonitor             *monitor,
+                                          GMemoryMonitorWarningLevel  level,
+                                          gpointer                    user_data)
+{
+  thunar_cache_registry_shed (level);
+}
+
+
+
+/**
+ * thunar_cache_registry_add:
+ * @name      : the static name of the cache.
+ * @level     : the #GMemoryMonitorWarningLevel from which on the cache is shed.
+ * @size_func : the function returning the memory used by the cache, or %NULL
+ *              if it is accounted by another cache.
+ * @shed_func : the function shedding the cache, or %NULL if the cache is
+ *              only accounted and shrinks with the other caches.
+ * @user_data : the data passed to @size_func and @shed_func.
+ *
+ * Registers a cache, which is shed once the system reports at least @level
+ * of memory pressure. The cache has to be removed with
+ * thunar_cache_registry_remove() before @user_data becomes invalid.
+ **/
+void
+thunar_cache_registry_add (const gchar                *name,
+                           GMemoryMonitorWarningLevel  level,
+                           ThunarCacheSizeFunc         size_func,
+                           ThunarCacheShedFunc         shed_func,
+                           gpointer                    user_data)
+{
+  ThunarCacheEntry *entry;
+
+  _thunar_return_if_fail (name != NULL);
+
+  /* start listening with the first cache */
+  if (G_UNLIKELY (cache_monitor == NULL))
+    {
+      cache_monitor = g_memory_monitor_dup_default ();
+      g_signal_connect (cache_monitor, "low-memory-warning", G_CALLBACK (thunar_cache_registry_low_memory_warning), NULL);
+    }
+
+  entry = g_slice_new (ThunarCacheEntry);
+  entry->name = name;
+  entry->level = level;
+  entry->size_func = size_func;
+  entry->shed_func = shed_func;
+  entry->user_data = user_data;
+
+  cache_entries = g_list_append (cache_entries, entry);
+}
+
+
+
+/**
+ * thunar_cache_registry_remove:
+ * @user_data : the data passed to thunar_cache_registry_add().
+ *
+ * Removes the caches registered with @user_data.
+ **/
+void
+thunar_cache_registry_remove (gpointer user_data)
+{
+  GList *lp;
+  GList *ln;
+
+  for (lp = cache_entries; lp != NULL; lp = ln)
+    {
+      ln = lp->next;
+      if (((ThunarCacheEntry *) lp->data)->user_data == user_data)
+        {
+          g_slice_free (ThunarCacheEntry, lp->data);
+          cache_entries = g_list_delete_link (cache_entries, lp);
+        }
+    }
+}
+
+
+
+/**
+ * thunar_cache_registry_shed:
+ * @level : a #GMemoryMonitorWarningLevel.
+ *
+ * Sheds the caches registered with a level up to @level, the ones
+ * with the lowest level first. This is what happens when the system
+ * reports a low memory warning of @level.
+ **/
+void
+thunar_cache_registry_shed (GMemoryMonitorWarningLevel level)
+{
+  ThunarCacheEntry *entry;
+  GList            *lp;
+  gsize             n_bytes;
+  guint             n;
+
+  for (n = 0; n < G_N_ELEMENTS (cache_levels) && (n == 0 || cache_levels[n - 1] < level); ++n)
+    {
+      for (lp = cache_entries; lp != NULL; lp = lp->next)
+        {
+          entry = lp->data;
+          if (entry->shed_func == NULL || entry->level > level)
+            continue;
+
+          /* every pass sheds the caches with a level above the previous one */
+          if (entry->level > cache_levels[n] || (n > 0 && entry->level <= cache_levels[n - 1]))
+            continue;
+
+          n_bytes = (entry->size_func != NULL) ? entry->size_func (entry->user_data) : 0;
+          entry->shed_func (entry->user_data, level);
+
+          if (entry->size_func != NULL)
+            {
+              g_debug ("Shed cache \"%s\" on memory pressure %d: %" G_GSIZE_FORMAT " of %" G_GSIZE_FORMAT " bytes left",
+                       entry->name, level, entry->size_func (entry->user_data), n_bytes);
+            }
+        }
+    }
+}
+
+
+
+/**
+ * thunar_cache_registry_foreach:
+ * @func      : the function called for every cache.
+ * @user_data : the data passed to @func.
+ *
+ * Calls @func with the name and the memory used by every registered
+ * cache which knows its size, in the order the caches were added.
+ **/
+void
+thunar_cache_registry_foreach (ThunarCacheRegistryFunc func,
+                               gpointer                user_data)
+{
+  ThunarCacheEntry *entry;
+  GList            *lp;
+
+  _thunar_return_if_fail (func != NULL);
+
+  for (lp = cache_entries; lp != NULL; lp = lp->next)
+    {
+      entry = lp->data;
+      if (entry->size_func != NULL)
+        func (entry->name, entry->size_func (entry->user_data), user_data);
+    }
+}
@@ -0,0 +1,59 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __THUNAR_CACHE_REGISTRY_H__
+#define __THUNAR_CACHE_REGISTRY_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+/**
+ * ThunarCacheSizeFunc:
+ * @user_data : the data passed to thunar_cache_registry_add().
+ *
+ * Return value: the memory used by the cache, in bytes.
+ **/
+typedef gsize (*ThunarCacheSizeFunc)     (gpointer                    user_data);
+
+/**
+ * ThunarCacheShedFunc:
+ * @user_data : the data passed to thunar_cache_registry_add().
+ * @level     : the reported #GMemoryMonitorWarningLevel.
+ *
+ * Drops what the cache can rebuild, more of it the higher @level is.
+ **/
+typedef void  (*ThunarCacheShedFunc)     (gpointer                    user_data,
+                                          GMemoryMonitorWarningLevel  level);
+
+typedef void  (*ThunarCacheRegistryFunc) (const gchar                *name,
+                                          gsize                       n_bytes,
+                                          gpointer                    user_data);
+
+void thunar_cache_registry_add     (const gchar                *name,
+                                    GMemoryMonitorWarningLevel  level,
+                                    ThunarCacheSizeFunc         size_func,
+                                    ThunarCacheShedFunc         shed_func,
+                                    gpointer                    user_data);
+void thunar_cache_registry_remove  (gpointer                    user_data);
+
+void thunar_cache_registry_shed    (GMemoryMonitorWarningLevel  level);
+void thunar_cache_registry_foreach (ThunarCacheRegistryFunc     func,
+                                    gpointer                    user_data);
+
+G_END_DECLS
+
+#endif /* !__THUNAR_CACHE_REGISTRY_H__ */
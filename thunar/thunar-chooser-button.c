@@ -24,6 +24,7 @@
 #include "config.h"
 #endif
 
+#include "thunar/thunar-app-index.h"
 #include "thunar/thunar-chooser-button.h"
 #include "thunar/thunar-chooser-dialog.h"
 #include "thunar/thunar-dialogs.h"
@@ -279,6 +280,7 @@ thunar_chooser_button_changed (GtkComboBox *combo_box)
   const gchar         *content_type;
   GAppInfo            *app_info;
   GError              *error = NULL;
+  gboolean             succeed;
 
   _thunar_return_if_fail (THUNAR_IS_CHOOSER_BUTTON (chooser_button));
   _thunar_return_if_fail (GTK_IS_LIST_STORE (chooser_button->store));
@@ -302,7 +304,9 @@ thunar_chooser_button_changed (GtkComboBox *combo_box)
       content_type = thunar_file_get_content_type (chooser_button->file);
 
       /* try to set application as default for these kind of file */
-      if (!g_app_info_set_as_default_for_type (app_info, content_type, &error))
+      succeed = g_app_info_set_as_default_for_type (app_info, content_type, &error);
+      thunar_app_index_invalidate ();
+      if (!succeed)
         {
           /* tell the user that it didn't work */
           if (g_strcmp0 (thunar_file_get_display_name (chooser_button->file), thunar_file_get_basename (chooser_button->file)) != 0)
@@ -451,11 +455,11 @@ thunar_chooser_button_file_changed (ThunarChooserButton *chooser_button,
       g_free (description);
 
       /* determine the default application for that content type */
-      app_info = g_app_info_get_default_for_type (content_type, FALSE);
+      app_info = thunar_app_index_get_default_for_type (content_type, FALSE);
       if (G_LIKELY (app_info != NULL))
         {
           /* determine all applications that claim to be able to handle the file */
-          app_infos = g_app_info_get_all_for_type (content_type);
+          app_infos = thunar_app_index_get_all_for_type (content_type);
           app_infos = g_list_sort (app_infos, thunar_chooser_button_sort_applications);
 
           /* add all possible applications */
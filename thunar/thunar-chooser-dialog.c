@@ -30,6 +30,7 @@
 #endif
 
 #include "thunar/thunar-abstract-dialog.h"
+#include "thunar/thunar-app-index.h"
 #include "thunar/thunar-application.h"
 #include "thunar/thunar-chooser-dialog.h"
 #include "thunar/thunar-chooser-model.h"
@@ -443,7 +444,7 @@ thunar_chooser_dialog_response (GtkDialog *widget,
         }
 
       /* Check if that application already exists in our list */
-      all_apps = g_app_info_get_all ();
+      all_apps = thunar_app_index_get_all ();
       for (lp = all_apps; lp != NULL; lp = lp->next)
         {
           if( g_strcmp0 (g_app_info_get_name (lp->data), g_app_info_get_name (app_info)) == 0 &&
@@ -462,7 +463,7 @@ thunar_chooser_dialog_response (GtkDialog *widget,
   if (G_UNLIKELY (app_info == NULL))
     return;
 
-  default_app = g_app_info_get_default_for_type (content_type, FALSE);
+  default_app = thunar_app_index_get_default_for_type (content_type, FALSE);
 
   /* check if we should also set the application as default or
    * if application is opened first time, set it as default application */
@@ -471,6 +472,7 @@ thunar_chooser_dialog_response (GtkDialog *widget,
     {
       /* remember the application as default for these kind of file */
       succeed = g_app_info_set_as_default_for_type (app_info, content_type, &error);
+      thunar_app_index_invalidate ();
 
       /* verify that we were successful */
       if (G_UNLIKELY (!succeed))
@@ -499,7 +501,9 @@ thunar_chooser_dialog_response (GtkDialog *widget,
   else
     {
       /* simply try to set the app as last used for this type (we do not show any errors here) */
-      if (g_app_info_set_as_last_used_for_type (app_info, content_type, NULL))
+      succeed = g_app_info_set_as_last_used_for_type (app_info, content_type, NULL);
+      thunar_app_index_invalidate ();
+      if (succeed)
         {
           /* emit "changed" on the file if we successfully changed the default application */
           thunar_file_changed (dialog->file);
@@ -851,6 +855,7 @@ thunar_chooser_dialog_action_forget (ThunarChooserDialog *dialog)
           /* Dont support this mime-type any more with that application */
           content_type = thunar_file_get_content_type (dialog->file);
           g_app_info_remove_supports_type (app_info, content_type, NULL);
+          thunar_app_index_invalidate ();
 
           /* try to delete the application from the model */
           if (!thunar_chooser_model_remove (THUNAR_CHOOSER_MODEL (model), &iter, FALSE, &error))
@@ -29,13 +29,20 @@
 #include <string.h>
 #endif
 
+#include "thunar/thunar-app-index.h"
 #include "thunar/thunar-chooser-model.h"
+#include "thunar/thunar-gio-extensions.h"
 #include "thunar/thunar-gobject-extensions.h"
 #include "thunar/thunar-icon-factory.h"
 #include "thunar/thunar-private.h"
 
 
 
+/* Number of "Other Applications" rows appended per idle run */
+#define THUNAR_CHOOSER_MODEL_CHUNK_SIZE (100)
+
+
+
 /* Property identifiers */
 enum
 {
@@ -57,6 +64,14 @@ static void     thunar_chooser_model_set_property   (GObject                  *o
                                                      const GValue             *value,
                                                      GParamSpec               *pspec);
 static void     thunar_chooser_model_reload         (ThunarChooserModel       *model);
+static void     thunar_chooser_model_load_thread    (GTask                    *task,
+                                                     gpointer                  source_object,
+                                                     gpointer                  task_data,
+                                                     GCancellable             *cancellable);
+static void     thunar_chooser_model_load_finished  (GObject                  *object,
+                                                     GAsyncResult             *result,
+                                                     gpointer                  user_data);
+static gboolean thunar_chooser_model_append_idle    (gpointer                  user_data);
 
 
 
@@ -69,7 +84,17 @@ struct _ThunarChooserModel
 {
   GtkTreeStore __parent__;
 
-  gchar *content_type;
+  gchar        *content_type;
+
+  /* the other applications are collected by a worker and
+   * appended below other_iter in chunks, replacing the
+   * placeholder row at loading_iter */
+  GCancellable *cancellable;
+  GtkTreeIter   other_iter;
+  GtkTreeIter   loading_iter;
+  gboolean      loading;
+  GList        *pending;
+  guint         append_idle_id;
 };
 
 
@@ -123,6 +148,8 @@ thunar_chooser_model_init (ThunarChooserModel *model)
   gtk_tree_store_set_column_types (GTK_TREE_STORE (model),
                                    G_N_ELEMENTS (column_types),
                                    column_types);
+
+  model->cancellable = g_cancellable_new ();
 }
 
 
@@ -143,6 +170,13 @@ thunar_chooser_model_finalize (GObject *object)
 {
   ThunarChooserModel *model = THUNAR_CHOOSER_MODEL (object);
 
+  /* stop loading the other applications */
+  g_cancellable_cancel (model->cancellable);
+  g_object_unref (model->cancellable);
+  if (model->append_idle_id != 0)
+    g_source_remove (model->append_idle_id);
+  g_list_free_full (model->pending, g_object_unref);
+
   /* free the content type */
   g_free (model->content_type);
 
@@ -195,6 +229,63 @@ thunar_chooser_model_set_property (GObject      *object,
 
 
 
+static void
+thunar_chooser_model_append_app_info (ThunarChooserModel *model,
+                                      GtkTreeIter        *parent_iter,
+                                      GAppInfo           *app_info)
+{
+  GtkTreeIter child_iter;
+
+  /* the icon is only a GIcon here, it is loaded once the row is rendered */
+  gtk_tree_store_append (GTK_TREE_STORE (model), &child_iter, parent_iter);
+  gtk_tree_store_set (GTK_TREE_STORE (model), &child_iter,
+                      THUNAR_CHOOSER_MODEL_COLUMN_NAME, g_app_info_get_name (app_info),
+                      THUNAR_CHOOSER_MODEL_COLUMN_ICON, g_app_info_get_icon (app_info),
+                      THUNAR_CHOOSER_MODEL_COLUMN_APPLICATION, app_info,
+                      THUNAR_CHOOSER_MODEL_COLUMN_WEIGHT, PANGO_WEIGHT_NORMAL,
+                      -1);
+}
+
+
+
+static void
+thunar_chooser_model_append_placeholder (ThunarChooserModel *model,
+                                         GtkTreeIter        *parent_iter,
+                                         GtkTreeIter        *child_iter,
+                                         const gchar        *text)
+{
+  gtk_tree_store_append (GTK_TREE_STORE (model), child_iter, parent_iter);
+  gtk_tree_store_set (GTK_TREE_STORE (model), child_iter,
+                      THUNAR_CHOOSER_MODEL_COLUMN_NAME, text,
+                      THUNAR_CHOOSER_MODEL_COLUMN_STYLE, PANGO_STYLE_ITALIC,
+                      THUNAR_CHOOSER_MODEL_COLUMN_WEIGHT, PANGO_WEIGHT_NORMAL,
+                      -1);
+}
+
+
+
+static void
+thunar_chooser_model_append_header (ThunarChooserModel *model,
+                                    GtkTreeIter        *parent_iter,
+                                    const gchar        *title,
+                                    const gchar        *icon_name)
+{
+  GIcon *icon;
+
+  icon = g_themed_icon_new (icon_name);
+
+  gtk_tree_store_append (GTK_TREE_STORE (model), parent_iter, NULL);
+  gtk_tree_store_set (GTK_TREE_STORE (model), parent_iter,
+                      THUNAR_CHOOSER_MODEL_COLUMN_NAME, title,
+                      THUNAR_CHOOSER_MODEL_COLUMN_ICON, icon,
+                      THUNAR_CHOOSER_MODEL_COLUMN_WEIGHT, PANGO_WEIGHT_BOLD,
+                      -1);
+
+  g_object_unref (icon);
+}
+
+
+
 static void
 thunar_chooser_model_append (ThunarChooserModel *model,
                              const gchar        *title,
@@ -203,7 +294,6 @@ thunar_chooser_model_append (ThunarChooserModel *model,
 {
   GtkTreeIter child_iter;
   GtkTreeIter parent_iter;
-  GIcon      *icon;
   GList      *lp;
   gboolean    inserted_infos = FALSE;
 
@@ -211,16 +301,7 @@ thunar_chooser_model_append (ThunarChooserModel *model,
   _thunar_return_if_fail (title != NULL);
   _thunar_return_if_fail (icon_name != NULL);
 
-  icon = g_themed_icon_new (icon_name);
-
-  gtk_tree_store_append (GTK_TREE_STORE (model), &parent_iter, NULL);
-  gtk_tree_store_set (GTK_TREE_STORE (model), &parent_iter,
-                      THUNAR_CHOOSER_MODEL_COLUMN_NAME, title,
-                      THUNAR_CHOOSER_MODEL_COLUMN_ICON, icon,
-                      THUNAR_CHOOSER_MODEL_COLUMN_WEIGHT, PANGO_WEIGHT_BOLD,
-                      -1);
-
-  g_object_unref (icon);
+  thunar_chooser_model_append_header (model, &parent_iter, title, icon_name);
 
   if (G_LIKELY (app_infos != NULL))
     {
@@ -231,14 +312,7 @@ thunar_chooser_model_append (ThunarChooserModel *model,
             continue;
 
           /* append the tree row with the program data */
-          gtk_tree_store_append (GTK_TREE_STORE (model), &child_iter, &parent_iter);
-          gtk_tree_store_set (GTK_TREE_STORE (model), &child_iter,
-                              THUNAR_CHOOSER_MODEL_COLUMN_NAME, g_app_info_get_name (lp->data),
-                              THUNAR_CHOOSER_MODEL_COLUMN_ICON, g_app_info_get_icon (lp->data),
-                              THUNAR_CHOOSER_MODEL_COLUMN_APPLICATION, lp->data,
-                              THUNAR_CHOOSER_MODEL_COLUMN_WEIGHT, PANGO_WEIGHT_NORMAL,
-                              -1);
-
+          thunar_chooser_model_append_app_info (model, &parent_iter, lp->data);
           inserted_infos = TRUE;
         }
     }
@@ -246,12 +320,7 @@ thunar_chooser_model_append (ThunarChooserModel *model,
   if (!inserted_infos)
     {
       /* tell the user that we don't have any applications for this category */
-      gtk_tree_store_append (GTK_TREE_STORE (model), &child_iter, &parent_iter);
-      gtk_tree_store_set (GTK_TREE_STORE (model), &child_iter,
-                          THUNAR_CHOOSER_MODEL_COLUMN_NAME, _("None available"),
-                          THUNAR_CHOOSER_MODEL_COLUMN_STYLE, PANGO_STYLE_ITALIC,
-                          THUNAR_CHOOSER_MODEL_COLUMN_WEIGHT, PANGO_WEIGHT_NORMAL,
-                          -1);
+      thunar_chooser_model_append_placeholder (model, &parent_iter, &child_iter, _("None available"));
     }
 }
 
@@ -279,11 +348,9 @@ sort_app_infos (gconstpointer a,
 static void
 thunar_chooser_model_reload (ThunarChooserModel *model)
 {
-  GList *all;
-  GList *lp;
-  GList *other = NULL;
   GList *recommended;
   GList *default_app = NULL;
+  GTask *task;
 
   _thunar_return_if_fail (THUNAR_IS_CHOOSER_MODEL (model));
   _thunar_return_if_fail (model->content_type != NULL);
@@ -291,7 +358,7 @@ thunar_chooser_model_reload (ThunarChooserModel *model)
   gtk_tree_store_clear (GTK_TREE_STORE (model));
 
   /* get default application for this type and append it in @default_app */
-  default_app = g_list_prepend (default_app, g_app_info_get_default_for_type (model->content_type, FALSE));
+  default_app = g_list_prepend (default_app, thunar_app_index_get_default_for_type (model->content_type, FALSE));
 
   /* If default application was already selected, then display it in Treeview */
   if (default_app->data)
@@ -303,7 +370,7 @@ thunar_chooser_model_reload (ThunarChooserModel *model)
     }
 
   /* check if we have any applications for this type */
-  recommended = g_app_info_get_all_for_type (model->content_type);
+  recommended = thunar_app_index_get_all_for_type (model->content_type);
 
   /* append them as recommended */
   recommended = g_list_sort (recommended, sort_app_infos);
@@ -312,32 +379,123 @@ thunar_chooser_model_reload (ThunarChooserModel *model)
                                "org.xfce.settings.default-applications",
                                recommended);
 
+  /* collecting all other applications means reading every desktop file of the
+   * system, so do that in a worker and keep a placeholder until it is done; the
+   * placeholder also makes sure the row can be expanded right away */
+  thunar_chooser_model_append_header (model, &model->other_iter, _("Other Applications"), "gnome-applications");
+  thunar_chooser_model_append_placeholder (model, &model->other_iter, &model->loading_iter, _("Loading..."));
+  model->loading = TRUE;
+
+  task = g_task_new (model, model->cancellable, thunar_chooser_model_load_finished, NULL);
+  g_task_set_task_data (task, recommended, (GDestroyNotify) thunar_g_list_free_full);
+  g_task_run_in_thread (task, thunar_chooser_model_load_thread);
+  g_object_unref (task);
+
+  if (default_app->data != NULL)
+    g_object_unref (default_app->data);
+  g_list_free (default_app);
+}
+
+
+
+static void
+thunar_chooser_model_load_thread (GTask        *task,
+                                  gpointer      source_object,
+                                  gpointer      task_data,
+                                  GCancellable *cancellable)
+{
+  GList *recommended = task_data;
+  GList *other = NULL;
+  GList *all;
+  GList *lp;
+
   all = g_app_info_get_all ();
-  for (lp = all; lp != NULL; lp = lp->next)
+  for (lp = all; lp != NULL && !g_cancellable_is_cancelled (cancellable); lp = lp->next)
     {
-      if (g_list_find_custom (recommended,
-                              lp->data,
-                              compare_app_infos) == NULL)
+      if (thunar_g_app_info_should_show (lp->data)
+          && g_list_find_custom (recommended, lp->data, compare_app_infos) == NULL)
         {
-          other = g_list_prepend (other, lp->data);
+          other = g_list_prepend (other, g_object_ref (lp->data));
         }
     }
+  g_list_free_full (all, g_object_unref);
 
-  /* append the other applications */
+  if (g_task_return_error_if_cancelled (task))
+    {
+      g_list_free_full (other, g_object_unref);
+      return;
+    }
+
+  /* sort here, collating a few thousand names takes a while too */
   other = g_list_sort (other, sort_app_infos);
-  thunar_chooser_model_append (model,
-                               _("Other Applications"),
-                               "gnome-applications",
-                               other);
+  g_task_return_pointer (task, other, (GDestroyNotify) thunar_g_list_free_full);
+}
 
-  if (default_app->data != NULL)
-    g_object_unref (default_app->data);
-  g_list_free (default_app);
 
-  g_list_free_full (recommended, g_object_unref);
-  g_list_free_full (all, g_object_unref);
 
-  g_list_free (other);
+static void
+thunar_chooser_model_load_finished (GObject      *object,
+                                    GAsyncResult *result,
+                                    gpointer      user_data)
+{
+  ThunarChooserModel *model = THUNAR_CHOOSER_MODEL (object);
+  GError             *error = NULL;
+  GList              *other;
+
+  other = g_task_propagate_pointer (G_TASK (result), &error);
+  if (error != NULL)
+    {
+      g_error_free (error);
+      return;
+    }
+
+  if (other == NULL)
+    {
+      /* tell the user that we don't have any other applications */
+      gtk_tree_store_set (GTK_TREE_STORE (model), &model->loading_iter,
+                          THUNAR_CHOOSER_MODEL_COLUMN_NAME, _("None available"),
+                          -1);
+      model->loading = FALSE;
+      return;
+    }
+
+  /* append the rows in chunks, to keep the dialog responsive */
+  model->pending = other;
+  model->append_idle_id = g_idle_add (thunar_chooser_model_append_idle, model);
+}
+
+
+
+static gboolean
+thunar_chooser_model_append_idle (gpointer user_data)
+{
+  ThunarChooserModel *model = THUNAR_CHOOSER_MODEL (user_data);
+  GList              *lp;
+  guint               n;
+
+  for (n = 0; model->pending != NULL && n < THUNAR_CHOOSER_MODEL_CHUNK_SIZE; ++n)
+    {
+      lp = model->pending;
+      model->pending = g_list_remove_link (model->pending, lp);
+
+      thunar_chooser_model_append_app_info (model, &model->other_iter, lp->data);
+
+      g_object_unref (lp->data);
+      g_list_free_1 (lp);
+    }
+
+  /* the parent has real children now, so it stays expanded without the placeholder */
+  if (model->loading)
+    {
+      gtk_tree_store_remove (GTK_TREE_STORE (model), &model->loading_iter);
+      model->loading = FALSE;
+    }
+
+  if (model->pending != NULL)
+    return G_SOURCE_CONTINUE;
+
+  model->append_idle_id = 0;
+  return G_SOURCE_REMOVE;
 }
 
 
@@ -415,6 +573,7 @@ thunar_chooser_model_remove (ThunarChooserModel *model,
   succeed = g_app_info_remove_supports_type (app_info,
                                              model->content_type,
                                              error);
+  thunar_app_index_invalidate ();
 
   /* try to delete the file */
   if (delete && succeed && g_app_info_delete (app_info))
@@ -57,6 +57,7 @@ enum
   TARGET_TEXT_URI_LIST,
   TARGET_GNOME_COPIED_FILES,
   TARGET_UTF8_STRING,
+  N_TARGETS
 };
 
 
@@ -87,6 +88,13 @@ static void thunar_clipboard_manager_clear_callback     (GtkClipboard
 static void thunar_clipboard_manager_transfer_files     (ThunarClipboardManager      *manager,
                                                          gboolean                     copy,
                                                          GList                       *files);
+static void thunar_clipboard_manager_release_files      (ThunarClipboardManager      *manager);
+static void thunar_clipboard_manager_paste_file_list    (ThunarClipboardManager      *manager,
+                                                         GtkWidget                   *widget,
+                                                         GFile                       *target_file,
+                                                         GList                       *file_list,
+                                                         gboolean                     copy,
+                                                         GClosure                    *new_files_closure);
 
 
 
@@ -107,6 +115,12 @@ struct _ThunarClipboardManager
 
   gboolean      files_cutted;
   GList        *files;
+
+  /* ThunarFile -> link in files, for cheap lookups and removals */
+  GHashTable   *file_links;
+
+  /* selection data generated for the current files, per target */
+  GBytes       *targets_data[N_TARGETS];
 };
 
 typedef struct
@@ -181,6 +195,7 @@ static void
 thunar_clipboard_manager_init (ThunarClipboardManager *manager)
 {
   manager->x_special_gnome_copied_files = gdk_atom_intern_static_string ("x-special/gnome-copied-files");
+  manager->file_links = g_hash_table_new (g_direct_hash, g_direct_equal);
 }
 
 
@@ -210,15 +225,10 @@ static void
 thunar_clipboard_manager_finalize (GObject *object)
 {
   ThunarClipboardManager *manager = THUNAR_CLIPBOARD_MANAGER (object);
-  GList                  *lp;
 
   /* release any pending files */
-  for (lp = manager->files; lp != NULL; lp = lp->next)
-    {
-      g_signal_handlers_disconnect_by_func (G_OBJECT (lp->data), thunar_clipboard_manager_file_destroyed, manager);
-      g_object_unref (G_OBJECT (lp->data));
-    }
-  g_list_free (manager->files);
+  thunar_clipboard_manager_release_files (manager);
+  g_hash_table_destroy (manager->file_links);
 
   /* disconnect from the clipboard */
   g_signal_handlers_disconnect_by_func (G_OBJECT (manager->clipboard), thunar_clipboard_manager_owner_changed, manager);
@@ -252,15 +262,55 @@ thunar_clipboard_manager_get_property (GObject    *object,
 
 
 
+static void
+thunar_clipboard_manager_forget_targets_data (ThunarClipboardManager *manager)
+{
+  guint n;
+
+  for (n = 0; n < N_TARGETS; n++)
+    if (manager->targets_data[n] != NULL)
+      {
+        g_bytes_unref (manager->targets_data[n]);
+        manager->targets_data[n] = NULL;
+      }
+}
+
+
+
+static void
+thunar_clipboard_manager_release_files (ThunarClipboardManager *manager)
+{
+  GList *lp;
+
+  for (lp = manager->files; lp != NULL; lp = lp->next)
+    {
+      g_signal_handlers_disconnect_by_func (G_OBJECT (lp->data), thunar_clipboard_manager_file_destroyed, manager);
+      g_object_unref (G_OBJECT (lp->data));
+    }
+  g_list_free (manager->files);
+  manager->files = NULL;
+
+  g_hash_table_remove_all (manager->file_links);
+  thunar_clipboard_manager_forget_targets_data (manager);
+}
+
+
+
 static void
 thunar_clipboard_manager_file_destroyed (ThunarFile             *file,
                                          ThunarClipboardManager *manager)
 {
+  GList *lp;
+
   _thunar_return_if_fail (THUNAR_IS_CLIPBOARD_MANAGER (manager));
-  _thunar_return_if_fail (g_list_find (manager->files, file) != NULL);
+
+  lp = g_hash_table_lookup (manager->file_links, file);
+  _thunar_return_if_fail (lp != NULL);
 
   /* remove the file from our list */
-  manager->files = g_list_remove (manager->files, file);
+  manager->files = g_list_delete_link (manager->files, lp);
+  g_hash_table_remove (manager->file_links, file);
+  thunar_clipboard_manager_forget_targets_data (manager);
 
   /* disconnect from the file */
   g_signal_handlers_disconnect_by_func (G_OBJECT (file), thunar_clipboard_manager_file_destroyed, manager);
@@ -290,6 +340,40 @@ thunar_clipboard_manager_owner_changed (GtkClipboard           *clipboard,
 
 
 
+static void
+thunar_clipboard_manager_paste_file_list (ThunarClipboardManager *manager,
+                                          GtkWidget              *widget,
+                                          GFile                  *target_file,
+                                          GList                  *file_list,
+                                          gboolean                copy,
+                                          GClosure               *new_files_closure)
+{
+  ThunarApplication *application;
+
+  application = thunar_application_get ();
+  if (G_LIKELY (copy))
+    thunar_application_copy_into (application, widget, file_list, target_file, THUNAR_OPERATION_LOG_OPERATIONS, new_files_closure);
+  else
+    thunar_application_move_into (application, widget, file_list, target_file, THUNAR_OPERATION_LOG_OPERATIONS, new_files_closure);
+  g_object_unref (G_OBJECT (application));
+
+  /* clear the clipboard if it contained "cutted data"
+   * (gtk_clipboard_clear takes care of not clearing
+   * the selection if we don't own it)
+   */
+  if (G_UNLIKELY (!copy))
+    gtk_clipboard_clear (manager->clipboard);
+
+  /* check the contents of the clipboard again if either the Xserver or
+   * our GTK+ version doesn't support the XFixes extension */
+  if (!gdk_display_supports_selection_notification (gtk_clipboard_get_display (manager->clipboard)))
+    {
+      thunar_clipboard_manager_owner_changed (manager->clipboard, NULL, manager);
+    }
+}
+
+
+
 static void
 thunar_clipboard_manager_contents_received (GtkClipboard     *clipboard,
                                             GtkSelectionData *selection_data,
@@ -297,7 +381,6 @@ thunar_clipboard_manager_contents_received (GtkClipboard     *clipboard,
 {
   ThunarClipboardPasteRequest *request = user_data;
   ThunarClipboardManager      *manager = THUNAR_CLIPBOARD_MANAGER (request->manager);
-  ThunarApplication           *application;
   gboolean                     path_copy = TRUE;
   GList                       *file_list = NULL;
   gchar                       *data;
@@ -328,27 +411,9 @@ thunar_clipboard_manager_contents_received (GtkClipboard     *clipboard,
   /* perform the action if possible */
   if (G_LIKELY (file_list != NULL))
     {
-      application = thunar_application_get ();
-      if (G_LIKELY (path_copy))
-        thunar_application_copy_into (application, request->widget, file_list, request->target_file, THUNAR_OPERATION_LOG_OPERATIONS, request->new_files_closure);
-      else
-        thunar_application_move_into (application, request->widget, file_list, request->target_file, THUNAR_OPERATION_LOG_OPERATIONS, request->new_files_closure);
-      g_object_unref (G_OBJECT (application));
+      thunar_clipboard_manager_paste_file_list (manager, request->widget, request->target_file,
+                                                file_list, path_copy, request->new_files_closure);
       thunar_g_list_free_full (file_list);
-
-      /* clear the clipboard if it contained "cutted data"
-       * (gtk_clipboard_clear takes care of not clearing
-       * the selection if we don't own it)
-       */
-      if (G_UNLIKELY (!path_copy))
-        gtk_clipboard_clear (manager->clipboard);
-
-      /* check the contents of the clipboard again if either the Xserver or
-       * our GTK+ version doesn't support the XFixes extension */
-      if (!gdk_display_supports_selection_notification (gtk_clipboard_get_display (manager->clipboard)))
-        {
-          thunar_clipboard_manager_owner_changed (manager->clipboard, NULL, manager);
-        }
     }
   else
     {
@@ -408,37 +473,38 @@ thunar_clipboard_manager_targets_received (GtkClipboard     *clipboard,
 
 
 
-static gchar *
-thunar_clipboard_manager_g_file_list_to_string (GList       *list,
-                                                const gchar *prefix,
-                                                gboolean     format_for_text,
-                                                gsize       *len)
+static GBytes *
+thunar_clipboard_manager_files_to_bytes (GList       *files,
+                                         const gchar *prefix,
+                                         const gchar *separator,
+                                         gboolean     terminate,
+                                         gboolean     format_for_text)
 {
   GString *string;
   gchar   *tmp;
   GList   *lp;
+  gsize    separator_len = strlen (separator);
 
-  /* allocate initial string */
-  string = g_string_new (prefix);
+  /* allocate the string in one go, most uris are shorter than this */
+  string = g_string_sized_new (g_list_length (files) * 128);
+  if (prefix != NULL)
+    string = g_string_append (string, prefix);
 
-  for (lp = list; lp != NULL; lp = lp->next)
+  for (lp = files; lp != NULL; lp = lp->next)
     {
       if (format_for_text)
-        tmp = g_file_get_parse_name (G_FILE (lp->data));
+        tmp = g_file_get_parse_name (thunar_file_get_file (THUNAR_FILE (lp->data)));
       else
-        tmp = g_file_get_uri (G_FILE (lp->data));
+        tmp = g_file_get_uri (thunar_file_get_file (THUNAR_FILE (lp->data)));
 
       string = g_string_append (string, tmp);
       g_free (tmp);
 
-      if (lp->next != NULL)
-        string = g_string_append_c (string, '\n');
+      if (lp->next != NULL || terminate)
+        string = g_string_append_len (string, separator, separator_len);
     }
 
-  if (len != NULL)
-    *len = string->len;
-
-  return g_string_free (string, FALSE);
+  return g_string_free_to_bytes (string);
 }
 
 
@@ -449,47 +515,49 @@ thunar_clipboard_manager_get_callback (GtkClipboard     *clipboard,
                                        guint             target_info,
                                        gpointer          user_data)
 {
-  ThunarClipboardManager  *manager = THUNAR_CLIPBOARD_MANAGER (user_data);
-  GList                   *file_list;
-  gchar                   *str;
-  gchar                  **uris;
-  const gchar             *prefix;
-  gsize                    len;
+  ThunarClipboardManager *manager = THUNAR_CLIPBOARD_MANAGER (user_data);
+  GBytes                 *bytes;
+  gconstpointer           data;
+  gsize                   len;
 
   _thunar_return_if_fail (GTK_IS_CLIPBOARD (clipboard));
   _thunar_return_if_fail (THUNAR_IS_CLIPBOARD_MANAGER (manager));
   _thunar_return_if_fail (manager->clipboard == clipboard);
+  _thunar_return_if_fail (target_info < N_TARGETS);
 
-  /* determine the path list from the file list */
-  file_list = thunar_file_list_to_thunar_g_file_list (manager->files);
-
-  switch (target_info)
+  /* the data is generated on the first request for a target and
+   * reused until the files change, clipboard managers and other
+   * applications tend to ask several times */
+  if (manager->targets_data[target_info] == NULL)
     {
-    case TARGET_TEXT_URI_LIST:
-      uris = thunar_g_file_list_to_stringv (file_list);
-      gtk_selection_data_set_uris (selection_data, uris);
-      g_strfreev (uris);
-      break;
-
-    case TARGET_GNOME_COPIED_FILES:
-      prefix = manager->files_cutted ? "cut\n" : "copy\n";
-      str = thunar_clipboard_manager_g_file_list_to_string (file_list, prefix, FALSE, &len);
-      gtk_selection_data_set (selection_data, gtk_selection_data_get_target (selection_data), 8, (guchar *) str, len);
-      g_free (str);
-      break;
-
-    case TARGET_UTF8_STRING:
-      str = thunar_clipboard_manager_g_file_list_to_string (file_list, NULL, TRUE, &len);
-      gtk_selection_data_set_text (selection_data, str, len);
-      g_free (str);
-      break;
+      switch (target_info)
+        {
+        case TARGET_TEXT_URI_LIST:
+          /* same format as gtk_selection_data_set_uris(), without the string vector */
+          bytes = thunar_clipboard_manager_files_to_bytes (manager->files, NULL, "\r\n", TRUE, FALSE);
+          break;
+
+        case TARGET_GNOME_COPIED_FILES:
+          bytes = thunar_clipboard_manager_files_to_bytes (manager->files, manager->files_cutted ? "cut\n" : "copy\n", "\n", FALSE, FALSE);
+          break;
+
+        case TARGET_UTF8_STRING:
+          bytes = thunar_clipboard_manager_files_to_bytes (manager->files, NULL, "\n", FALSE, TRUE);
+          break;
+
+        default:
+          _thunar_assert_not_reached ();
+          return;
+        }
 
-    default:
-      _thunar_assert_not_reached ();
+      manager->targets_data[target_info] = bytes;
     }
 
-  /* cleanup */
-  thunar_g_list_free_full (file_list);
+  data = g_bytes_get_data (manager->targets_data[target_info], &len);
+  if (target_info == TARGET_UTF8_STRING)
+    gtk_selection_data_set_text (selection_data, data, len);
+  else
+    gtk_selection_data_set (selection_data, gtk_selection_data_get_target (selection_data), 8, data, len);
 }
 
 
@@ -499,20 +567,13 @@ thunar_clipboard_manager_clear_callback (GtkClipboard *clipboard,
                                          gpointer      user_data)
 {
   ThunarClipboardManager *manager = THUNAR_CLIPBOARD_MANAGER (user_data);
-  GList                  *lp;
 
   _thunar_return_if_fail (GTK_IS_CLIPBOARD (clipboard));
   _thunar_return_if_fail (THUNAR_IS_CLIPBOARD_MANAGER (manager));
   _thunar_return_if_fail (manager->clipboard == clipboard);
 
   /* release the pending files */
-  for (lp = manager->files; lp != NULL; lp = lp->next)
-    {
-      g_signal_handlers_disconnect_by_func (G_OBJECT (lp->data), thunar_clipboard_manager_file_destroyed, manager);
-      g_object_unref (G_OBJECT (lp->data));
-    }
-  g_list_free (manager->files);
-  manager->files = NULL;
+  thunar_clipboard_manager_release_files (manager);
 }
 
 
@@ -526,21 +587,21 @@ thunar_clipboard_manager_transfer_files (ThunarClipboardManager *manager,
   GList      *lp;
 
   /* release any pending files */
-  for (lp = manager->files; lp != NULL; lp = lp->next)
-    {
-      g_signal_handlers_disconnect_by_func (G_OBJECT (lp->data), thunar_clipboard_manager_file_destroyed, manager);
-      g_object_unref (G_OBJECT (lp->data));
-    }
-  g_list_free (manager->files);
+  thunar_clipboard_manager_release_files (manager);
 
   /* remember the transfer operation */
   manager->files_cutted = !copy;
 
   /* setup the new file list */
-  for (lp = g_list_last (files), manager->files = NULL; lp != NULL; lp = lp->prev)
+  for (lp = g_list_last (files); lp != NULL; lp = lp->prev)
     {
+      /* skip duplicates, the table holds a single link per file */
+      if (g_hash_table_contains (manager->file_links, lp->data))
+        continue;
+
       file = THUNAR_FILE (g_object_ref (G_OBJECT (lp->data)));
       manager->files = g_list_prepend (manager->files, file);
+      g_hash_table_insert (manager->file_links, file, manager->files);
       g_signal_connect (G_OBJECT (file), "destroy", G_CALLBACK (thunar_clipboard_manager_file_destroyed), manager);
     }
 
@@ -646,7 +707,7 @@ thunar_clipboard_manager_has_cutted_file (ThunarClipboardManager *manager,
   _thunar_return_val_if_fail (THUNAR_IS_CLIPBOARD_MANAGER (manager), FALSE);
   _thunar_return_val_if_fail (THUNAR_IS_FILE (file), FALSE);
 
-  return (manager->files_cutted && g_list_find (manager->files, file) != NULL);
+  return (manager->files_cutted && g_hash_table_contains (manager->file_links, file));
 }
 
 
@@ -711,10 +772,31 @@ thunar_clipboard_manager_paste_files (ThunarClipboardManager *manager,
                                       GClosure               *new_files_closure)
 {
   ThunarClipboardPasteRequest *request;
+  GList                       *file_list;
 
   _thunar_return_if_fail (THUNAR_IS_CLIPBOARD_MANAGER (manager));
   _thunar_return_if_fail (widget == NULL || GTK_IS_WIDGET (widget));
 
+  /* the files are ours, no need to serialize them through the selection */
+  if (gtk_clipboard_get_owner (manager->clipboard) == G_OBJECT (manager)
+      && manager->files != NULL)
+    {
+      if (G_LIKELY (new_files_closure != NULL))
+        {
+          g_closure_ref (new_files_closure);
+          g_closure_sink (new_files_closure);
+        }
+
+      file_list = thunar_file_list_to_thunar_g_file_list (manager->files);
+      thunar_clipboard_manager_paste_file_list (manager, widget, target_file, file_list,
+                                                !manager->files_cutted, new_files_closure);
+      thunar_g_list_free_full (file_list);
+
+      if (G_LIKELY (new_files_closure != NULL))
+        g_closure_unref (new_files_closure);
+      return;
+    }
+
   /* prepare the paste request */
   request = g_slice_new0 (ThunarClipboardPasteRequest);
   request->manager = THUNAR_CLIPBOARD_MANAGER (g_object_ref (G_OBJECT (manager)));
@@ -0,0 +1,567 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The completion index lists the names in a folder for the completion of
+ * the path entry. The folder is enumerated in a worker thread, which hands
+ * the names over to the main thread in sorted batches of growing size, and
+ * the main thread merges them into one array sorted by a case-folded key.
+ * All names starting with a prefix are next to each other in that array,
+ * so a lookup is two binary searches, and lookups are answered from the
+ * names found so far while the folder is still enumerated. Unlike a
+ * ThunarFolder, the index creates no ThunarFile for the names. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include "thunar/thunar-completion-index.h"
+#include "thunar/thunar-private.h"
+
+
+
+/* number of folders enumerated at the same time */
+#define THUNAR_COMPLETION_INDEX_THREADS   (2)
+
+/* size of the first batch, each following one is twice as big */
+#define THUNAR_COMPLETION_INDEX_BATCH     (256)
+#define THUNAR_COMPLETION_INDEX_MAX_BATCH (16384)
+
+/* a loaded index older than this is enumerated again when requested */
+#define THUNAR_COMPLETION_INDEX_MAX_AGE   (10 * G_USEC_PER_SEC)
+
+/* number of recently requested indexes kept, for going back and forth */
+#define THUNAR_COMPLETION_INDEX_N_RECENT  (4)
+
+#define THUNAR_COMPLETION_INDEX_ATTRIBUTES G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME "," \
+                                           G_FILE_ATTRIBUTE_STANDARD_TYPE "," \
+                                           G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN "," \
+                                           G_FILE_ATTRIBUTE_STANDARD_IS_BACKUP
+
+
+
+/* Signal identifiers */
+enum
+{
+  CHANGED,
+  LAST_SIGNAL,
+};
+
+typedef enum
+{
+  THUNAR_COMPLETION_ENTRY_DIRECTORY = 1 << 0,
+  THUNAR_COMPLETION_ENTRY_HIDDEN    = 1 << 1,
+} ThunarCompletionEntryFlags;
+
+
+
+typedef struct
+{
+  gchar *key;  /* see thunar_completion_index_make_key() */
+  gchar *name; /* the display name */
+  guint  flags;
+}
+ThunarCompletionEntry;
+
+typedef struct
+{
+  ThunarCompletionIndex *index;
+  GArray                *entries;
+  gboolean               last;
+}
+ThunarCompletionBatch;
+
+
+
+static void thunar_completion_index_finalize (GObject *object);
+
+
+
+struct _ThunarCompletionIndexClass
+{
+  GObjectClass __parent__;
+};
+
+struct _ThunarCompletionIndex
+{
+  GObject       __parent__;
+
+  GFile        *directory;
+
+  /* ThunarCompletionEntry sorted by key */
+  GArray       *entries;
+
+  gboolean      loading;
+  gint64        loaded_at;
+};
+
+
+
+static guint        index_signals[LAST_SIGNAL];
+
+/* GFile -> ThunarCompletionIndex, and the recently requested indexes */
+static GHashTable  *thunar_completion_indexes = NULL;
+static GQueue       thunar_completion_recent = G_QUEUE_INIT;
+static GThreadPool *thunar_completion_pool = NULL;
+
+
+
+G_DEFINE_TYPE (ThunarCompletionIndex, thunar_completion_index, G_TYPE_OBJECT)
+
+
+
+static void
+thunar_completion_index_class_init (ThunarCompletionIndexClass *klass)
+{
+  GObjectClass *gobject_class;
+
+  gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->finalize = thunar_completion_index_finalize;
+
+  /**
+   * ThunarCompletionIndex::changed:
+   * @index : a #ThunarCompletionIndex.
+   *
+   * Emitted when more names were found, and when the
+   * enumeration of the folder finished.
+   **/
+  index_signals[CHANGED] =
+    g_signal_new (I_ ("changed"),
+                  G_TYPE_FROM_CLASS (gobject_class),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL,
+                  g_cclosure_marshal_VOID__VOID,
+                  G_TYPE_NONE, 0);
+}
+
+
+
+static void
+thunar_completion_index_entry_clear (gpointer data)
+{
+  ThunarCompletionEntry *entry = data;
+
+  g_free (entry->key);
+  g_free (entry->name);
+}
+
+
+
+static void
+thunar_completion_index_init (ThunarCompletionIndex *index)
+{
+  index->entries = g_array_new (FALSE, FALSE, sizeof (ThunarCompletionEntry));
+  g_array_set_clear_func (index->entries, thunar_completion_index_entry_clear);
+  index->loading = TRUE;
+}
+
+
+
+static void
+thunar_completion_index_finalize (GObject *object)
+{
+  ThunarCompletionIndex *index = THUNAR_COMPLETION_INDEX (object);
+
+  /* a newer index for the same folder may have replaced this one */
+  if (g_hash_table_lookup (thunar_completion_indexes, index->directory) == index)
+    g_hash_table_remove (thunar_completion_indexes, index->directory);
+
+  g_array_unref (index->entries);
+  g_object_unref (index->directory);
+
+  (*G_OBJECT_CLASS (thunar_completion_index_parent_class)->finalize) (object);
+}
+
+
+
+static gint
+thunar_completion_index_compare (gconstpointer a,
+                                 gconstpointer b)
+{
+  const ThunarCompletionEntry *entry_a = a;
+  const ThunarCompletionEntry *entry_b = b;
+  gint                         result;
+
+  result = strcmp (entry_a->key, entry_b->key);
+  if (result == 0)
+    result = strcmp (entry_a->name, entry_b->name);
+
+  return result;
+}
+
+
+
+static gboolean
+thunar_completion_index_merge (gpointer user_data)
+{
+  ThunarCompletionBatch *batch = user_data;
+  ThunarCompletionIndex *index = batch->index;
+  ThunarCompletionEntry *a;
+  ThunarCompletionEntry *b;
+  GArray                *merged;
+  guint                  i = 0;
+  guint                  j = 0;
+
+  if (batch->entries->len > 0)
+    {
+      merged = g_array_sized_new (FALSE, FALSE, sizeof (ThunarCompletionEntry), index->entries->len + batch->entries->len);
+      g_array_set_clear_func (merged, thunar_completion_index_entry_clear);
+
+      /* both are sorted, so this is linear */
+      while (i < index->entries->len && j < batch->entries->len)
+        {
+          a = &g_array_index (index->entries, ThunarCompletionEntry, i);
+          b = &g_array_index (batch->entries, ThunarCompletionEntry, j);
+          if (thunar_completion_index_compare (a, b) <= 0)
+            {
+              g_array_append_vals (merged, a, 1);
+              ++i;
+            }
+          else
+            {
+              g_array_append_vals (merged, b, 1);
+              ++j;
+            }
+        }
+      g_array_append_vals (merged, &g_array_index (index->entries, ThunarCompletionEntry, i), index->entries->len - i);
+      g_array_append_vals (merged, &g_array_index (batch->entries, ThunarCompletionEntry, j), batch->entries->len - j);
+
+      /* the strings moved to the merged array */
+      g_array_set_clear_func (index->entries, NULL);
+      g_array_unref (index->entries);
+      index->entries = merged;
+    }
+
+  if (batch->last)
+    {
+      index->loading = FALSE;
+      index->loaded_at = g_get_monotonic_time ();
+    }
+
+  if (batch->entries->len > 0 || batch->last)
+    g_signal_emit (G_OBJECT (index), index_signals[CHANGED], 0);
+
+  g_array_unref (batch->entries);
+  g_object_unref (index);
+  g_slice_free (ThunarCompletionBatch, batch);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+static void
+thunar_completion_index_deliver (ThunarCompletionIndex *index,
+                                 GArray                *entries,
+                                 gboolean               last)
+{
+  ThunarCompletionBatch *batch;
+
+  /* sorting here keeps the main thread to a linear merge */
+  g_array_sort (entries, thunar_completion_index_compare);
+
+  batch = g_slice_new (ThunarCompletionBatch);
+  batch->index = g_object_ref (index);
+  batch->entries = entries;
+  batch->last = last;
+  g_idle_add (thunar_completion_index_merge, batch);
+}
+
+
+
+static void
+thunar_completion_index_load (gpointer data,
+                              gpointer user_data)
+{
+  ThunarCompletionIndex *index = data;
+  ThunarCompletionEntry  entry;
+  GFileEnumerator       *enumerator;
+  GFileInfo             *info;
+  GArray                *entries;
+  guint                  batch_size = THUNAR_COMPLETION_INDEX_BATCH;
+
+  entries = g_array_sized_new (FALSE, FALSE, sizeof (ThunarCompletionEntry), batch_size);
+
+  enumerator = g_file_enumerate_children (index->directory, THUNAR_COMPLETION_INDEX_ATTRIBUTES,
+                                          G_FILE_QUERY_INFO_NONE, NULL, NULL);
+  if (G_LIKELY (enumerator != NULL))
+    {
+      while ((info = g_file_enumerator_next_file (enumerator, NULL, NULL)) != NULL)
+        {
+          entry.name = g_strdup (g_file_info_get_display_name (info));
+          entry.key = thunar_completion_index_make_key (entry.name);
+          entry.flags = 0;
+          if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
+            entry.flags |= THUNAR_COMPLETION_ENTRY_DIRECTORY;
+          if (g_file_info_get_is_hidden (info) || g_file_info_get_is_backup (info))
+            entry.flags |= THUNAR_COMPLETION_ENTRY_HIDDEN;
+          g_object_unref (info);
+
+          g_array_append_val (entries, entry);
+
+          /* let the first names be completed while the rest is enumerated */
+          if (entries->len >= batch_size)
+            {
+              thunar_completion_index_deliver (index, entries, FALSE);
+              batch_size = MIN (batch_size * 2, THUNAR_COMPLETION_INDEX_MAX_BATCH);
+              entries = g_array_sized_new (FALSE, FALSE, sizeof (ThunarCompletionEntry), batch_size);
+            }
+        }
+
+      g_object_unref (enumerator);
+    }
+
+  thunar_completion_index_deliver (index, entries, TRUE);
+
+  /* release the reference taken for the thread */
+  g_object_unref (index);
+}
+
+
+
+/**
+ * thunar_completion_index_get_for_file:
+ * @directory : the #GFile of a directory.
+ *
+ * Returns the #ThunarCompletionIndex for @directory. The index of a
+ * recently requested @directory is shared, a new index starts enumerating
+ * @directory in the background and emits "changed" as it finds names.
+ *
+ * The caller is responsible to free the returned object using
+ * g_object_unref() when no longer needed.
+ *
+ * Return value: the #ThunarCompletionIndex for @directory.
+ **/
+ThunarCompletionIndex *
+thunar_completion_index_get_for_file (GFile *directory)
+{
+  ThunarCompletionIndex *index;
+  GList                 *link;
+
+  _thunar_return_val_if_fail (G_IS_FILE (directory), NULL);
+
+  if (G_UNLIKELY (thunar_completion_indexes == NULL))
+    {
+      thunar_completion_indexes = g_hash_table_new (g_file_hash, (GEqualFunc) g_file_equal);
+      thunar_completion_pool = g_thread_pool_new (thunar_completion_index_load, NULL,
+                                                  THUNAR_COMPLETION_INDEX_THREADS, FALSE, NULL);
+    }
+
+  index = g_hash_table_lookup (thunar_completion_indexes, directory);
+  if (index != NULL
+      && (index->loading || g_get_monotonic_time () - index->loaded_at < THUNAR_COMPLETION_INDEX_MAX_AGE))
+    {
+      /* move it to the front of the recent indexes */
+      link = g_queue_find (&thunar_completion_recent, index);
+      if (link != NULL)
+        {
+          g_queue_unlink (&thunar_completion_recent, link);
+          g_queue_push_head_link (&thunar_completion_recent, link);
+        }
+
+      return g_object_ref (index);
+    }
+
+  /* the outdated index keeps its names for the ones still using it */
+  index = g_object_new (THUNAR_TYPE_COMPLETION_INDEX, NULL);
+  index->directory = g_object_ref (directory);
+  g_hash_table_insert (thunar_completion_indexes, index->directory, index);
+
+  g_queue_push_head (&thunar_completion_recent, g_object_ref (index));
+  while (g_queue_get_length (&thunar_completion_recent) > THUNAR_COMPLETION_INDEX_N_RECENT)
+    g_object_unref (g_queue_pop_tail (&thunar_completion_recent));
+
+  g_thread_pool_push (thunar_completion_pool, g_object_ref (index), NULL);
+
+  return index;
+}
+
+
+
+/**
+ * thunar_completion_index_get_file:
+ * @index : a #ThunarCompletionIndex.
+ *
+ * Returns the directory of @index. The returned object is owned by @index.
+ *
+ * Return value: the #GFile of the directory of @index.
+ **/
+GFile *
+thunar_completion_index_get_file (ThunarCompletionIndex *index)
+{
+  _thunar_return_val_if_fail (THUNAR_IS_COMPLETION_INDEX (index), NULL);
+  return index->directory;
+}
+
+
+
+/**
+ * thunar_completion_index_get_loading:
+ * @index : a #ThunarCompletionIndex.
+ *
+ * Tells whether the directory of @index is still being enumerated.
+ *
+ * Return value: %TRUE if more names may still be found.
+ **/
+gboolean
+thunar_completion_index_get_loading (ThunarCompletionIndex *index)
+{
+  _thunar_return_val_if_fail (THUNAR_IS_COMPLETION_INDEX (index), FALSE);
+  return index->loading;
+}
+
+
+
+/**
+ * thunar_completion_index_make_key:
+ * @prefix : a file name or the beginning of one, in UTF-8.
+ *
+ * Returns the key the names are compared with: @prefix normalized and
+ * case-folded, so that the completion ignores the case. The caller is
+ * responsible to free the returned string using g_free().
+ *
+ * Return value: the key for @prefix.
+ **/
+gchar *
+thunar_completion_index_make_key (const gchar *prefix)
+{
+  gchar *normalized;
+  gchar *key;
+
+  normalized = g_utf8_normalize (prefix, -1, G_NORMALIZE_ALL);
+  if (G_UNLIKELY (normalized == NULL))
+    return g_strdup (prefix);
+
+  key = g_utf8_casefold (normalized, -1);
+  g_free (normalized);
+
+  return key;
+}
+
+
+
+/**
+ * thunar_completion_index_lookup:
+ * @index : a #ThunarCompletionIndex.
+ * @key   : the key of a prefix, see thunar_completion_index_make_key().
+ * @first : return location for the position of the first match.
+ *
+ * Looks up the names of @index starting with @key. The matches are at
+ * the positions @first up to @first plus the number of matches, which
+ * stay valid until the main loop runs again.
+ *
+ * Return value: the number of matches.
+ **/
+guint
+thunar_completion_index_lookup (ThunarCompletionIndex *index,
+                                const gchar           *key,
+                                guint                 *first)
+{
+  ThunarCompletionEntry *entries;
+  gsize                  key_len;
+  guint                  lower, upper;
+  guint                  middle;
+  guint                  start;
+
+  _thunar_return_val_if_fail (THUNAR_IS_COMPLETION_INDEX (index), 0);
+  _thunar_return_val_if_fail (key != NULL, 0);
+  _thunar_return_val_if_fail (first != NULL, 0);
+
+  entries = (ThunarCompletionEntry *) (gpointer) index->entries->data;
+  key_len = strlen (key);
+
+  /* the first key not sorted before the prefix */
+  for (lower = 0, upper = index->entries->len; lower < upper;)
+    {
+      middle = lower + (upper - lower) / 2;
+      if (strcmp (entries[middle].key, key) < 0)
+        lower = middle + 1;
+      else
+        upper = middle;
+    }
+  start = lower;
+
+  /* and the first one after it not starting with the prefix */
+  for (upper = index->entries->len; lower < upper;)
+    {
+      middle = lower + (upper - lower) / 2;
+      if (strncmp (entries[middle].key, key, key_len) == 0)
+        lower = middle + 1;
+      else
+        upper = middle;
+    }
+
+  *first = start;
+
+  return lower - start;
+}
+
+
+
+/**
+ * thunar_completion_index_get_name:
+ * @index : a #ThunarCompletionIndex.
+ * @n     : a position returned by thunar_completion_index_lookup().
+ *
+ * Return value: the display name at @n, owned by @index.
+ **/
+const gchar *
+thunar_completion_index_get_name (ThunarCompletionIndex *index,
+                                  guint                  n)
+{
+  _thunar_return_val_if_fail (THUNAR_IS_COMPLETION_INDEX (index), NULL);
+  _thunar_return_val_if_fail (n < index->entries->len, NULL);
+  return g_array_index (index->entries, ThunarCompletionEntry, n).name;
+}
+
+
+
+/**
+ * thunar_completion_index_is_directory:
+ * @index : a #ThunarCompletionIndex.
+ * @n     : a position returned by thunar_completion_index_lookup().
+ *
+ * Return value: %TRUE if the name at @n is a directory.
+ **/
+gboolean
+thunar_completion_index_is_directory (ThunarCompletionIndex *index,
+                                      guint                  n)
+{
+  _thunar_return_val_if_fail (THUNAR_IS_COMPLETION_INDEX (index), FALSE);
+  _thunar_return_val_if_fail (n < index->entries->len, FALSE);
+  return (g_array_index (index->entries, ThunarCompletionEntry, n).flags & THUNAR_COMPLETION_ENTRY_DIRECTORY) != 0;
+}
+
+
+
+/**
+ * thunar_completion_index_is_hidden:
+ * @index : a #ThunarCompletionIndex.
+ * @n     : a position returned by thunar_completion_index_lookup().
+ *
+ * Return value: %TRUE if the name at @n is a hidden or backup file.
+ **/
+gboolean
+thunar_completion_index_is_hidden (ThunarCompletionIndex *index,
+                                   guint                  n)
+{
+  _thunar_return_val_if_fail (THUNAR_IS_COMPLETION_INDEX (index), FALSE);
+  _thunar_return_val_if_fail (n < index->entries->len, FALSE);
+  return (g_array_index (index->entries, ThunarCompletionEntry, n).flags & THUNAR_COMPLETION_ENTRY_HIDDEN) != 0;
+}
@@ -0,0 +1,301 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The count scheduler runs the jobs counting the items of the folders
+ * shown in the "Size" column. Only a few jobs run at the same time, so
+ * that a folder with thousands of sub folders does not start thousands
+ * of enumerations at once, which is especially bad on network shares.
+ * Folders the views currently show, see
+ * thunar_count_scheduler_set_visible_files(), are counted first, and
+ * waiting or running counts for folders which were scrolled away are
+ * dropped. The result is stored on the ThunarFile together with the
+ * modification time of the folder it belongs to, and the file emits
+ * "changed" when its count changed. Everything here runs in the main
+ * thread. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "thunar/thunar-count-scheduler.h"
+#include "thunar/thunar-gio-extensions.h"
+#include "thunar/thunar-io-jobs.h"
+#include "thunar/thunar-private.h"
+#include "thunar/thunar-simple-job.h"
+
+
+
+/* maximum number of folders counted at the same time */
+#define THUNAR_COUNT_SCHEDULER_MAX_RUNNING (4)
+
+
+
+typedef struct
+{
+  ThunarFile *file;
+  ThunarJob  *job;
+  guint64     mtime;
+  gboolean    failed;
+}
+ThunarCountRequest;
+
+static void thunar_count_scheduler_dispatch (void);
+
+
+
+/* waiting folders, the most recently requested first */
+static GQueue      pending_files = G_QUEUE_INIT;
+static GHashTable *pending_links = NULL;
+
+/* ThunarFile -> ThunarCountRequest of the running jobs */
+static GHashTable *running_requests = NULL;
+
+/* owner -> GList of the files it shows, and ThunarFile -> number of owners */
+static GHashTable *visible_owners = NULL;
+static GHashTable *visible_files = NULL;
+
+
+
+static void
+thunar_count_scheduler_request_free (gpointer data)
+{
+  ThunarCountRequest *request = data;
+
+  g_signal_handlers_disconnect_by_data (request->job, request);
+  g_object_unref (request->job);
+  g_object_unref (request->file);
+  g_free (request);
+}
+
+
+
+static void
+thunar_count_scheduler_init (void)
+{
+  if (G_LIKELY (pending_links != NULL))
+    return;
+
+  pending_links = g_hash_table_new (g_direct_hash, g_direct_equal);
+  running_requests = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, thunar_count_scheduler_request_free);
+  visible_owners = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) thunar_g_list_free_full);
+  visible_files = g_hash_table_new_full (g_direct_hash, g_direct_equal, g_object_unref, NULL);
+}
+
+
+
+static gboolean
+thunar_count_scheduler_is_visible (ThunarFile *file)
+{
+  /* without any view telling what it shows, everything counts as visible */
+  if (g_hash_table_size (visible_owners) == 0)
+    return TRUE;
+
+  return g_hash_table_contains (visible_files, file);
+}
+
+
+
+static void
+thunar_count_scheduler_error (ExoJob             *job,
+                              GError             *error,
+                              ThunarCountRequest *request)
+{
+  request->failed = TRUE;
+}
+
+
+
+static void
+thunar_count_scheduler_finished (ExoJob             *job,
+                                 ThunarCountRequest *request)
+{
+  GArray *param_values;
+  guint   old_count;
+  guint   count;
+
+  _thunar_return_if_fail (THUNAR_IS_FILE (request->file));
+
+  if (!exo_job_is_cancelled (job))
+    {
+      /* unreadable folders keep their count, but aren't retried until they change */
+      old_count = thunar_file_get_file_count (request->file, FALSE);
+      if (request->failed)
+        {
+          count = old_count;
+        }
+      else
+        {
+          param_values = thunar_simple_job_get_param_values (THUNAR_SIMPLE_JOB (job));
+          count = g_value_get_uint (&g_array_index (param_values, GValue, 1));
+        }
+
+      thunar_file_set_file_count (request->file, count, request->mtime);
+
+      /* the views show the new count on the next "changed" */
+      if (count != old_count)
+        thunar_file_changed (request->file);
+    }
+
+  /* releases the job and the file */
+  g_hash_table_remove (running_requests, request->file);
+
+  thunar_count_scheduler_dispatch ();
+}
+
+
+
+static void
+thunar_count_scheduler_dispatch (void)
+{
+  ThunarCountRequest *request;
+  GList              *lp;
+
+  while (g_hash_table_size (running_requests) < THUNAR_COUNT_SCHEDULER_MAX_RUNNING
+         && !g_queue_is_empty (&pending_files))
+    {
+      /* prefer the most recent visible folder */
+      for (lp = pending_files.head; lp != NULL; lp = lp->next)
+        if (thunar_count_scheduler_is_visible (lp->data))
+          break;
+      if (lp == NULL)
+        lp = pending_files.head;
+
+      request = g_new0 (ThunarCountRequest, 1);
+      request->file = lp->data; /* takes over the reference */
+      request->mtime = thunar_file_get_date (request->file, THUNAR_FILE_DATE_MODIFIED);
+      request->job = thunar_io_jobs_count_files (request->file);
+
+      g_hash_table_remove (pending_links, request->file);
+      g_queue_delete_link (&pending_files, lp);
+      g_hash_table_insert (running_requests, request->file, request);
+
+      g_signal_connect (request->job, "error", G_CALLBACK (thunar_count_scheduler_error), request);
+      g_signal_connect (request->job, "finished", G_CALLBACK (thunar_count_scheduler_finished), request);
+      exo_job_launch (EXO_JOB (request->job));
+    }
+}
+
+
+
+/**
+ * thunar_count_scheduler_queue:
+ * @file : a #ThunarFile for a directory.
+ *
+ * Schedules counting the items of @file. Requesting a folder again moves
+ * it to the front of the waiting folders, a folder which is counted
+ * already is not counted twice.
+ **/
+void
+thunar_count_scheduler_queue (ThunarFile *file)
+{
+  GList *link;
+
+  _thunar_return_if_fail (THUNAR_IS_FILE (file));
+
+  thunar_count_scheduler_init ();
+
+  if (g_hash_table_contains (running_requests, file))
+    return;
+
+  link = g_hash_table_lookup (pending_links, file);
+  if (link != NULL)
+    {
+      /* the row was drawn again, so it is likely still shown */
+      g_queue_unlink (&pending_files, link);
+      g_queue_push_head_link (&pending_files, link);
+    }
+  else
+    {
+      g_queue_push_head (&pending_files, g_object_ref (file));
+      g_hash_table_insert (pending_links, file, pending_files.head);
+    }
+
+  thunar_count_scheduler_dispatch ();
+}
+
+
+
+/**
+ * thunar_count_scheduler_set_visible_files:
+ * @owner : the view showing @files.
+ * @files : the #GList of #ThunarFile<!---->s @owner currently shows,
+ *          or %NULL if it shows none, e.g. because it is destroyed.
+ *
+ * Replaces the files shown by @owner. Waiting and running counts for
+ * folders which no view shows any longer are dropped, and shown folders
+ * are counted first.
+ **/
+void
+thunar_count_scheduler_set_visible_files (gpointer owner,
+                                          GList   *files)
+{
+  ThunarCountRequest *request;
+  GHashTableIter      iter;
+  GList              *old_files;
+  GList              *lp;
+  GList              *ln;
+  guint               n_owners;
+
+  _thunar_return_if_fail (owner != NULL);
+
+  thunar_count_scheduler_init ();
+
+  /* release the files shown before */
+  old_files = g_hash_table_lookup (visible_owners, owner);
+  for (lp = old_files; lp != NULL; lp = lp->next)
+    {
+      n_owners = GPOINTER_TO_UINT (g_hash_table_lookup (visible_files, lp->data));
+      if (n_owners > 1)
+        g_hash_table_insert (visible_files, g_object_ref (lp->data), GUINT_TO_POINTER (n_owners - 1));
+      else
+        g_hash_table_remove (visible_files, lp->data);
+    }
+
+  if (files != NULL)
+    {
+      g_hash_table_insert (visible_owners, owner, thunar_g_list_copy_deep (files));
+      for (lp = files; lp != NULL; lp = lp->next)
+        {
+          n_owners = GPOINTER_TO_UINT (g_hash_table_lookup (visible_files, lp->data));
+          g_hash_table_insert (visible_files, g_object_ref (lp->data), GUINT_TO_POINTER (n_owners + 1));
+        }
+    }
+  else
+    {
+      g_hash_table_remove (visible_owners, owner);
+    }
+
+  /* drop the waiting folders which were scrolled away, they are
+   * requested again as soon as their rows are drawn again */
+  for (lp = pending_files.head; lp != NULL; lp = ln)
+    {
+      ln = lp->next;
+      if (!thunar_count_scheduler_is_visible (lp->data))
+        {
+          g_hash_table_remove (pending_links, lp->data);
+          g_object_unref (lp->data);
+          g_queue_delete_link (&pending_files, lp);
+        }
+    }
+
+  /* and stop counting them, the slots are freed once the jobs finished */
+  g_hash_table_iter_init (&iter, running_requests);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &request))
+    if (!thunar_count_scheduler_is_visible (request->file))
+      exo_job_cancel (EXO_JOB (request->job));
+
+  thunar_count_scheduler_dispatch ();
+}
@@ -23,6 +23,9 @@
 #include "config.h"
 #endif
 
+#ifdef HAVE_ERRNO_H
+#include <errno.h>
+#endif
 #ifdef HAVE_MEMORY_H
 #include <memory.h>
 #endif
@@ -35,14 +38,21 @@
 #include <libxfce4util/libxfce4util.h>
 
 #include "thunar/thunar-application.h"
+#include "thunar/thunar-cache-registry.h"
 #include "thunar/thunar-preferences.h"
 #include "thunar/thunar-chooser-dialog.h"
 #include "thunar/thunar-dbus-service.h"
 #include "thunar/thunar-file.h"
+#include "thunar/thunar-folder.h"
 #include "thunar/thunar-gdk-extensions.h"
+#include "thunar/thunar-gio-extensions.h"
+#include "thunar/thunar-io-jobs.h"
+#include "thunar/thunar-io-trash.h"
 #include "thunar/thunar-preferences-dialog.h"
 #include "thunar/thunar-private.h"
+#include "thunar/thunar-profile.h"
 #include "thunar/thunar-properties-dialog.h"
+#include "thunar/thunar-thumbnailer.h"
 #include "thunar/thunar-util.h"
 
 
@@ -61,6 +71,24 @@ typedef enum
   THUNAR_DBUS_TRANSFER_MODE_LINK_INTO,
 } ThunarDBusTransferMode;
 
+typedef enum
+{
+  THUNAR_DBUS_BATCH_MODE_COPY,
+  THUNAR_DBUS_BATCH_MODE_MOVE,
+  THUNAR_DBUS_BATCH_MODE_LINK,
+  THUNAR_DBUS_BATCH_MODE_TRASH,
+  THUNAR_DBUS_N_BATCH_MODES,
+} ThunarDBusBatchMode;
+
+/* seconds a finished batch can still be queried */
+#define THUNAR_DBUS_BATCH_EXPIRE (300)
+
+typedef struct _ThunarDBusBatch        ThunarDBusBatch;
+typedef struct _ThunarDBusBatchRequest ThunarDBusBatchRequest;
+typedef struct _ThunarDBusShow         ThunarDBusShow;
+typedef struct _ThunarDBusShowFolder   ThunarDBusShowFolder;
+
+
 
 static void     thunar_dbus_service_finalize                    (GObject                *object);
 static gboolean thunar_dbus_service_connect_trash_bin           (ThunarDBusService      *dbus_service,
@@ -219,9 +247,53 @@ static gboolean thunar_dbus_service_unlink_files                (ThunarDBusFileM
                                                                  const gchar            *display,
                                                                  const gchar            *startup_id,
                                                                  ThunarDBusService      *dbus_service);
+static gboolean thunar_dbus_service_batch_operations            (ThunarDBusThunar       *object,
+                                                                 GDBusMethodInvocation  *invocation,
+                                                                 const gchar            *working_directory,
+                                                                 GVariant               *operations,
+                                                                 const gchar            *display,
+                                                                 const gchar            *startup_id,
+                                                                 ThunarDBusService      *dbus_service);
+static void     thunar_dbus_service_batch_resolve               (GTask                  *task,
+                                                                 gpointer                source_object,
+                                                                 gpointer                task_data,
+                                                                 GCancellable           *cancellable);
+static void     thunar_dbus_service_batch_resolved              (GObject                *source_object,
+                                                                 GAsyncResult           *result,
+                                                                 gpointer                user_data);
+static void     thunar_dbus_batch_request_free                  (gpointer                data);
+static void     thunar_dbus_batch_free                          (gpointer                data);
+static void     thunar_dbus_batch_job_percent                   (ExoJob                 *job,
+                                                                 gdouble                 percent,
+                                                                 ThunarDBusBatch        *batch);
+static void     thunar_dbus_batch_job_error                     (ExoJob                 *job,
+                                                                 GError                 *error,
+                                                                 ThunarDBusBatch        *batch);
+static void     thunar_dbus_batch_job_finished                  (ExoJob                 *job,
+                                                                 ThunarDBusBatch        *batch);
+static gboolean thunar_dbus_batch_expire                        (gpointer                user_data);
+static gboolean thunar_dbus_service_query_batch                 (ThunarDBusThunar       *object,
+                                                                 GDBusMethodInvocation  *invocation,
+                                                                 guint                   handle,
+                                                                 ThunarDBusService      *dbus_service);
+static void     thunar_dbus_show_file_ready                     (GFile                  *location,
+                                                                 ThunarFile             *file,
+                                                                 GError                 *error,
+                                                                 gpointer                user_data);
+static void     thunar_dbus_show_run                            (ThunarDBusShow         *show);
+static void     thunar_dbus_show_free                           (ThunarDBusShow         *show);
+static gboolean thunar_dbus_service_query_caches                (ThunarDBusThunar       *object,
+                                                                 GDBusMethodInvocation  *invocation,
+                                                                 ThunarDBusService      *dbus_service);
 static gboolean thunar_dbus_service_terminate                   (ThunarDBusThunar       *object,
                                                                  GDBusMethodInvocation  *invocation,
                                                                  ThunarDBusService      *dbus_service);
+static gboolean thunar_dbus_service_get_counters                (ThunarDBusDebug        *object,
+                                                                 GDBusMethodInvocation  *invocation,
+                                                                 ThunarDBusService      *dbus_service);
+static gboolean thunar_dbus_service_get_stalls                  (ThunarDBusDebug        *object,
+                                                                 GDBusMethodInvocation  *invocation,
+                                                                 ThunarDBusService      *dbus_service);
 
 static gboolean thunar_dbus_freedesktop_show_folders            (ThunarOrgFreedesktopFileManager1 *object,
                                                                  GDBusMethodInvocation            *invocation,
@@ -252,9 +324,63 @@ struct _ThunarDBusService
   ThunarDBusFileManager            *file_manager;
   ThunarDBusTrash                  *trash;
   ThunarDBusThunar                 *thunar;
+  ThunarDBusDebug                  *debug; /* only with THUNAR_DEBUG_DBUS set */
   ThunarOrgFreedesktopFileManager1 *file_manager_fdo;
 
   ThunarFile      *trash_bin;
+  gboolean         trash_full;
+
+  /* running and recently finished BatchOperations */
+  GHashTable      *batches;
+  guint            last_batch_handle;
+};
+
+struct _ThunarDBusBatchRequest
+{
+  ThunarDBusThunar      *object;
+  GDBusMethodInvocation *invocation;
+  GdkScreen             *screen;
+  gchar                 *working_directory;
+  GVariant              *operations;
+
+  /* filled in by the worker thread, one merged job per mode */
+  GList                 *source_file_list[THUNAR_DBUS_N_BATCH_MODES];
+  GList                 *target_file_list[THUNAR_DBUS_N_BATCH_MODES];
+};
+
+struct _ThunarDBusBatch
+{
+  ThunarDBusService *dbus_service;
+  ThunarJob         *jobs[THUNAR_DBUS_N_BATCH_MODES];
+  gdouble            percent[THUNAR_DBUS_N_BATCH_MODES];
+  guint              n_jobs;
+  guint              n_finished;
+  gchar             *error_message;
+  guint              expire_id;
+};
+
+/* a request to show folders and to select items in them, which
+ * waits for the ThunarFiles of all of them to be resolved */
+struct _ThunarDBusShow
+{
+  GdkScreen             *screen;
+  gchar                 *startup_id;
+  GList                 *folders;   /* ThunarDBusShowFolders, in the order of the request */
+  guint                  n_pending; /* files being resolved */
+
+  /* the DisplayFolderAndSelect call completed with the result, if any */
+  ThunarDBusFileManager *file_manager;
+  GDBusMethodInvocation *invocation;
+  GError                *error;
+};
+
+struct _ThunarDBusShowFolder
+{
+  ThunarDBusShow        *show;
+  GFile                 *location;
+  ThunarFile            *folder;    /* NULL unless resolved */
+  GList                 *files;     /* the resolved items to select */
+  gboolean               requested; /* shown even without items */
 };
 
 
@@ -304,6 +430,7 @@ thunar_dbus_service_init (ThunarDBusService *dbus_service)
   dbus_service->trash             = thunar_dbus_trash_skeleton_new ();
   dbus_service->thunar            = thunar_dbus_thunar_skeleton_new ();
   dbus_service->file_manager_fdo  = thunar_org_freedesktop_file_manager1_skeleton_new ();
+  dbus_service->batches           = g_hash_table_new_full (NULL, NULL, NULL, thunar_dbus_batch_free);
 
   connect_signals_multiple (dbus_service->file_manager, dbus_service,
                             "handle-display-application-chooser-dialog", thunar_dbus_service_display_app_chooser_dialog,
@@ -333,9 +460,21 @@ thunar_dbus_service_init (ThunarDBusService *dbus_service)
 
   connect_signals_multiple (dbus_service->thunar, dbus_service,
                             "handle-bulk-rename", thunar_dbus_service_bulk_rename,
+                            "handle-batch-operations", thunar_dbus_service_batch_operations,
+                            "handle-query-batch", thunar_dbus_service_query_batch,
+                            "handle-query-caches", thunar_dbus_service_query_caches,
                             "handle-terminate", thunar_dbus_service_terminate,
                             NULL);
 
+  /* the counters are a debugging aid nobody should rely on */
+  if (G_UNLIKELY (g_getenv ("THUNAR_DEBUG_DBUS") != NULL))
+    {
+      dbus_service->debug = thunar_dbus_debug_skeleton_new ();
+      g_signal_connect (dbus_service->debug, "handle-get-counters", G_CALLBACK (thunar_dbus_service_get_counters), dbus_service);
+      g_signal_connect (dbus_service->debug, "handle-get-stalls", G_CALLBACK (thunar_dbus_service_get_stalls), dbus_service);
+      thunar_profile_stalls_start ();
+    }
+
   connect_signals_multiple (dbus_service->file_manager_fdo, dbus_service,
                             "handle-show-folders", thunar_dbus_freedesktop_show_folders,
                             "handle-show-items", thunar_dbus_freedesktop_show_items,
@@ -354,6 +493,10 @@ thunar_dbus_service_finalize (GObject *object)
   g_object_unref (dbus_service->trash);
   g_object_unref (dbus_service->thunar);
   g_object_unref (dbus_service->file_manager_fdo);
+  if (dbus_service->debug != NULL)
+    g_object_unref (dbus_service->debug);
+
+  g_hash_table_destroy (dbus_service->batches);
 
   if (dbus_service->trash_bin)
     g_object_unref (dbus_service->trash_bin);
@@ -380,6 +523,9 @@ thunar_dbus_service_connect_trash_bin (ThunarDBusService *dbus_service,
           /* watch the trash bin for changes */
           thunar_file_watch (dbus_service->trash_bin);
 
+          /* remember the state the clients were told about */
+          dbus_service->trash_full = (thunar_file_get_item_count (dbus_service->trash_bin) > 0);
+
           /* stay informed about changes to the trash bin */
           g_signal_connect_swapped (G_OBJECT (dbus_service->trash_bin), "changed",
                                     G_CALLBACK (thunar_dbus_service_trash_bin_changed),
@@ -424,12 +570,23 @@ static void
 thunar_dbus_service_trash_bin_changed (ThunarDBusService *dbus_service,
                                        ThunarFile        *trash_bin)
 {
+  guint32 n_items;
+
   _thunar_return_if_fail (THUNAR_IS_DBUS_SERVICE (dbus_service));
   _thunar_return_if_fail (dbus_service->trash_bin == trash_bin);
   _thunar_return_if_fail (THUNAR_IS_FILE (trash_bin));
 
   /* emit the "trash-changed" signal with the new state */
   thunar_dbus_trash_emit_trash_changed (dbus_service->trash);
+
+  /* the item count comes with the reloaded info of the trash bin, so
+   * clients are only woken up when the trash turns empty or full */
+  n_items = thunar_file_get_item_count (trash_bin);
+  if (dbus_service->trash_full != (n_items > 0))
+    {
+      dbus_service->trash_full = (n_items > 0);
+      thunar_dbus_trash_emit_trash_state_changed (dbus_service->trash, dbus_service->trash_full, n_items);
+    }
 }
 
 
@@ -507,6 +664,225 @@ thunar_dbus_service_display_folder (ThunarDBusFileManager  *object,
 
 
 
+static ThunarDBusShow *
+thunar_dbus_show_new (GdkScreen   *screen,
+                      const gchar *startup_id)
+{
+  ThunarDBusShow *show;
+
+  show = g_slice_new0 (ThunarDBusShow);
+  show->screen = g_object_ref (screen);
+  show->startup_id = g_strdup (startup_id);
+
+  /* the reference of the caller, dropped by thunar_dbus_show_run() */
+  show->n_pending = 1;
+
+  return show;
+}
+
+
+
+static ThunarDBusShowFolder *
+thunar_dbus_show_get_folder (ThunarDBusShow *show,
+                             GFile          *location)
+{
+  ThunarDBusShowFolder *folder;
+  GList                *lp;
+
+  /* the items of one folder are selected together */
+  for (lp = show->folders; lp != NULL; lp = lp->next)
+    if (g_file_equal (((ThunarDBusShowFolder *) lp->data)->location, location))
+      return lp->data;
+
+  folder = g_slice_new0 (ThunarDBusShowFolder);
+  folder->show = show;
+  folder->location = g_object_ref (location);
+  show->folders = g_list_append (show->folders, folder);
+
+  show->n_pending++;
+  thunar_file_get_async (location, NULL, thunar_dbus_show_file_ready, folder);
+
+  return folder;
+}
+
+
+
+static void
+thunar_dbus_show_add_folder (ThunarDBusShow *show,
+                             GFile          *location)
+{
+  /* shown even without items to select */
+  thunar_dbus_show_get_folder (show, location)->requested = TRUE;
+}
+
+
+
+static void
+thunar_dbus_show_add_item (ThunarDBusShow *show,
+                           GFile          *location)
+{
+  ThunarDBusShowFolder *folder;
+  GFile                *parent;
+
+  parent = g_file_get_parent (location);
+  if (G_UNLIKELY (parent == NULL))
+    return;
+
+  folder = thunar_dbus_show_get_folder (show, parent);
+  g_object_unref (parent);
+
+  show->n_pending++;
+  thunar_file_get_async (location, NULL, thunar_dbus_show_file_ready, folder);
+}
+
+
+
+static void
+thunar_dbus_show_file_ready (GFile      *location,
+                             ThunarFile *file,
+                             GError     *error,
+                             gpointer    user_data)
+{
+  ThunarDBusShowFolder *folder = user_data;
+
+  if (G_LIKELY (error == NULL && file != NULL))
+    {
+      if (g_file_equal (location, folder->location))
+        folder->folder = g_object_ref (file);
+      else
+        folder->files = g_list_prepend (folder->files, g_object_ref (file));
+    }
+  else if (folder->requested && folder->show->error == NULL && g_file_equal (location, folder->location))
+    {
+      /* reported to the caller, if it waits for the result */
+      folder->show->error = (error != NULL) ? g_error_copy (error)
+                                            : g_error_new_literal (G_IO_ERROR, G_IO_ERROR_FAILED, _("Failed to open the folder"));
+    }
+
+  thunar_dbus_show_run (folder->show);
+}
+
+
+
+static GtkWidget *
+thunar_dbus_show_find_window (ThunarDBusShow *show,
+                              ThunarFile     *folder)
+{
+  ThunarApplication *application;
+  GtkWidget         *window = NULL;
+  GList             *windows;
+  GList             *lp;
+
+  application = thunar_application_get ();
+  windows = thunar_application_get_windows (application);
+  g_object_unref (application);
+
+  /* the topmost window is the last one */
+  for (lp = g_list_last (windows); lp != NULL && window == NULL; lp = lp->prev)
+    if (gtk_window_get_screen (GTK_WINDOW (lp->data)) == show->screen
+        && thunar_window_show_directory (THUNAR_WINDOW (lp->data), folder))
+      window = lp->data;
+
+  g_list_free (windows);
+
+  return window;
+}
+
+
+
+static void
+thunar_dbus_show_run (ThunarDBusShow *show)
+{
+  ThunarDBusShowFolder *folder;
+  ThunarApplication    *application;
+  GtkWidget            *window;
+  GList                *gfiles;
+  GList                *lp;
+  GList                *fp;
+
+  /* wait for all the files of the request */
+  if (--show->n_pending > 0)
+    return;
+
+  application = thunar_application_get ();
+
+  for (lp = show->folders; lp != NULL; lp = lp->next)
+    {
+      folder = lp->data;
+
+      /* nothing to show for the folders which are gone, or whose items are */
+      if (folder->folder == NULL
+          || !thunar_file_is_directory (folder->folder)
+          || (!folder->requested && folder->files == NULL))
+        continue;
+
+      /* a window already showing the folder keeps its rows, otherwise
+       * the folder starts from its snapshot if it has one */
+      window = thunar_dbus_show_find_window (show, folder->folder);
+      if (window != NULL)
+        {
+          if (show->startup_id != NULL)
+            gtk_window_set_startup_id (GTK_WINDOW (window), show->startup_id);
+          gtk_window_present (GTK_WINDOW (window));
+        }
+      else
+        {
+          window = thunar_application_open_window (application, folder->folder, show->screen, show->startup_id, FALSE);
+        }
+
+      if (folder->files != NULL)
+        {
+          gfiles = NULL;
+          for (fp = folder->files; fp != NULL; fp = fp->next)
+            gfiles = g_list_prepend (gfiles, thunar_file_get_file (fp->data));
+          thunar_window_show_and_select_files (THUNAR_WINDOW (window), gfiles);
+          g_list_free (gfiles);
+        }
+    }
+
+  g_object_unref (application);
+
+  if (show->invocation != NULL)
+    {
+      if (show->error != NULL)
+        g_dbus_method_invocation_take_error (show->invocation, g_steal_pointer (&show->error));
+      else
+        thunar_dbus_file_manager_complete_display_folder_and_select (show->file_manager, show->invocation);
+    }
+
+  thunar_dbus_show_free (show);
+}
+
+
+
+static void
+thunar_dbus_show_folder_free (gpointer data)
+{
+  ThunarDBusShowFolder *folder = data;
+
+  g_object_unref (folder->location);
+  if (folder->folder != NULL)
+    g_object_unref (folder->folder);
+  thunar_g_list_free_full (folder->files);
+  g_slice_free (ThunarDBusShowFolder, folder);
+}
+
+
+
+static void
+thunar_dbus_show_free (ThunarDBusShow *show)
+{
+  g_list_free_full (show->folders, thunar_dbus_show_folder_free);
+  if (show->file_manager != NULL)
+    g_object_unref (show->file_manager);
+  g_clear_error (&show->error);
+  g_object_unref (show->screen);
+  g_free (show->startup_id);
+  g_slice_free (ThunarDBusShow, show);
+}
+
+
+
 static gboolean
 thunar_dbus_service_display_folder_and_select (ThunarDBusFileManager  *object,
                                                GDBusMethodInvocation  *invocation,
@@ -516,49 +892,48 @@ thunar_dbus_service_display_folder_and_select (ThunarDBusFileManager  *object,
                                                const gchar            *startup_id,
                                                ThunarDBusService      *dbus_service)
 {
-  ThunarApplication *application;
-  ThunarFile        *folder;
-  GdkScreen         *screen;
-  GtkWidget         *window;
-  GFile             *gfile;
-  GList             *gfiles = NULL;
-  GError            *error = NULL;
+  ThunarDBusShow *show;
+  GdkScreen      *screen;
+  GFile          *folder;
+  GFile          *gfile;
+  GError         *error = NULL;
 
   /* verify that filename is valid */
   if (G_UNLIKELY (filename == NULL || *filename == '\0' || strchr (filename, '/') != NULL))
     {
       g_set_error (&error, G_FILE_ERROR, G_FILE_ERROR_INVAL, _("Invalid filename \"%s\""), filename);
-      goto out;
+      g_dbus_method_invocation_take_error (invocation, error);
+      return TRUE;
     }
 
-  /* parse uri and display parameters */
-  if (!thunar_dbus_service_parse_uri_and_display (dbus_service, uri, display, &folder, &screen, &error))
-    goto out;
+  /* try to open the display */
+  screen = thunar_gdk_screen_open (display, &error);
+  if (G_UNLIKELY (screen == NULL))
+    {
+      g_dbus_method_invocation_take_error (invocation, error);
+      return TRUE;
+    }
 
-  /* popup a new window for the folder */
-  application = thunar_application_get ();
-  window = thunar_application_open_window (application, folder, screen, startup_id, FALSE);
-  g_object_unref (application);
+  /* the files are resolved without blocking, the call is completed once the folder is shown */
+  show = thunar_dbus_show_new (screen, startup_id);
+  show->file_manager = g_object_ref (object);
+  show->invocation = invocation;
+  g_object_unref (screen);
+
+  folder = g_file_new_for_uri (uri);
+  thunar_dbus_show_add_folder (show, folder);
 
   /* determine the path for the filename relative to the folder */
-  gfile = g_file_resolve_relative_path (thunar_file_get_file (folder), filename);
+  gfile = g_file_resolve_relative_path (folder, filename);
   if (G_LIKELY (gfile != NULL))
     {
-      gfiles = g_list_append (gfiles, gfile);
-      thunar_window_show_and_select_files (THUNAR_WINDOW (window), gfiles);
-
-      g_list_free_full (gfiles, g_object_unref);
+      thunar_dbus_show_add_item (show, gfile);
+      g_object_unref (gfile);
     }
 
-  /* cleanup */
-  g_object_unref (screen);
   g_object_unref (folder);
 
-out:
-  if (error)
-    g_dbus_method_invocation_take_error (invocation, error);
-  else
-    thunar_dbus_file_manager_complete_display_folder_and_select (object, invocation);
+  thunar_dbus_show_run (show);
 
   return TRUE;
 }
@@ -901,8 +1276,10 @@ thunar_dbus_service_query_trash (ThunarDBusTrash        *object,
   /* connect to the trash bin on-demand */
   if (thunar_dbus_service_connect_trash_bin (dbus_service, &error))
     {
-      /* check whether the trash bin is not empty */
-      full = (thunar_file_get_item_count (dbus_service->trash_bin) > 0);
+      /* check whether the trash bin is not empty, peeking the local trash
+       * folders instead of waiting for GVfs to count all trashed items */
+      full = !thunar_io_trash_is_empty ();
+      dbus_service->trash_full = full;
     }
 
   if (error)
@@ -1491,6 +1868,595 @@ out:
 
 
 
+static gboolean
+thunar_dbus_service_batch_operations (ThunarDBusThunar       *object,
+                                      GDBusMethodInvocation  *invocation,
+                                      const gchar            *working_directory,
+                                      GVariant               *operations,
+                                      const gchar            *display,
+                                      const gchar            *startup_id,
+                                      ThunarDBusService      *dbus_service)
+{
+  ThunarDBusBatchRequest *request;
+  GdkScreen              *screen;
+  GError                 *error = NULL;
+  GTask                  *task;
+
+  /* verify that atleast one operation is given */
+  if (g_variant_n_children (operations) == 0)
+    {
+      g_set_error (&error, G_FILE_ERROR, G_FILE_ERROR_INVAL, _("At least one operation must be specified"));
+      g_dbus_method_invocation_take_error (invocation, error);
+      return TRUE;
+    }
+
+  /* try to open the screen for the display name */
+  screen = thunar_gdk_screen_open (display, &error);
+  if (screen == NULL)
+    {
+      g_dbus_method_invocation_take_error (invocation, error);
+      return TRUE;
+    }
+
+  request = g_new0 (ThunarDBusBatchRequest, 1);
+  request->object = g_object_ref (object);
+  request->invocation = invocation;
+  request->screen = screen;
+  request->operations = g_variant_ref (operations);
+
+  /* resolve relative to the given directory instead of changing the
+   * working directory of the process, which is not thread-safe
+   */
+  if (xfce_str_is_empty (working_directory))
+    request->working_directory = g_get_current_dir ();
+  else
+    request->working_directory = g_strdup (working_directory);
+
+  /* resolve and merge the filenames without blocking the main loop */
+  task = g_task_new (dbus_service, NULL, thunar_dbus_service_batch_resolved, NULL);
+  g_task_set_task_data (task, request, thunar_dbus_batch_request_free);
+  g_task_run_in_thread (task, thunar_dbus_service_batch_resolve);
+  g_object_unref (task);
+
+  return TRUE;
+}
+
+
+
+static GFile *
+thunar_dbus_service_batch_resolve_filename (const gchar  *filename_utf8,
+                                            const gchar  *working_directory,
+                                            GError      **error)
+{
+  GFile *file;
+  gchar *filename;
+
+  /* decode the filename (D-BUS uses UTF-8) */
+  filename = g_filename_from_utf8 (filename_utf8, -1, NULL, NULL, error);
+  if (filename == NULL)
+    return NULL;
+
+  file = g_file_new_for_commandline_arg_and_cwd (filename, working_directory);
+  g_free (filename);
+
+  return file;
+}
+
+
+
+static void
+thunar_dbus_service_batch_resolve (GTask        *task,
+                                   gpointer      source_object,
+                                   gpointer      task_data,
+                                   GCancellable *cancellable)
+{
+  ThunarDBusBatchRequest *request = task_data;
+  ThunarDBusBatchMode     mode;
+  GVariantIter            iter;
+  const gchar            *kind;
+  const gchar           **source_filenames;
+  const gchar            *target_filename;
+  gboolean                copy_to;
+  GError                 *err = NULL;
+  GFile                  *source_file;
+  GFile                  *target_file;
+  GFile                  *target_dir;
+  gchar                  *base_name;
+  guint                   n;
+
+  g_variant_iter_init (&iter, request->operations);
+  while (err == NULL && g_variant_iter_next (&iter, "(&s^a&s&s)", &kind, &source_filenames, &target_filename))
+    {
+      mode = THUNAR_DBUS_BATCH_MODE_COPY;
+      target_dir = NULL;
+      copy_to = FALSE;
+
+      /* determine the job this operation is merged into */
+      if (strcmp (kind, "copy-to") == 0)
+        {
+          mode = THUNAR_DBUS_BATCH_MODE_COPY;
+          copy_to = TRUE;
+          if (g_strv_length ((gchar **) source_filenames) != 1)
+            g_set_error (&err, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                         _("The number of source and target filenames must be the same"));
+        }
+      else if (strcmp (kind, "copy-into") == 0)
+        mode = THUNAR_DBUS_BATCH_MODE_COPY;
+      else if (strcmp (kind, "move-into") == 0)
+        mode = THUNAR_DBUS_BATCH_MODE_MOVE;
+      else if (strcmp (kind, "link-into") == 0)
+        mode = THUNAR_DBUS_BATCH_MODE_LINK;
+      else if (strcmp (kind, "trash") == 0)
+        mode = THUNAR_DBUS_BATCH_MODE_TRASH;
+      else
+        g_set_error (&err, G_FILE_ERROR, G_FILE_ERROR_INVAL, _("Unknown operation \"%s\""), kind);
+
+      /* resolve the target */
+      if (err == NULL && mode != THUNAR_DBUS_BATCH_MODE_TRASH)
+        {
+          if (xfce_str_is_empty (target_filename))
+            g_set_error (&err, G_FILE_ERROR, G_FILE_ERROR_INVAL, _("A destination directory must be specified"));
+          else
+            target_dir = thunar_dbus_service_batch_resolve_filename (target_filename, request->working_directory, &err);
+
+          /* moving into the trash is trashing */
+          if (target_dir != NULL && mode == THUNAR_DBUS_BATCH_MODE_MOVE && thunar_g_file_is_trash (target_dir))
+            mode = THUNAR_DBUS_BATCH_MODE_TRASH;
+        }
+
+      for (n = 0; err == NULL && source_filenames[n] != NULL; ++n)
+        {
+          source_file = thunar_dbus_service_batch_resolve_filename (source_filenames[n], request->working_directory, &err);
+          if (source_file == NULL)
+            break;
+
+          target_file = NULL;
+          if (mode == THUNAR_DBUS_BATCH_MODE_TRASH)
+            {
+              /* trash jobs have no targets */
+            }
+          else if (copy_to)
+            {
+              target_file = g_object_ref (target_dir);
+            }
+          else if (G_UNLIKELY (thunar_g_file_is_root (source_file)))
+            {
+              /* we cannot collect a root node into a directory */
+              g_set_error (&err, G_FILE_ERROR, G_FILE_ERROR_INVAL, "%s", g_strerror (EINVAL));
+            }
+          else if (mode == THUNAR_DBUS_BATCH_MODE_MOVE && thunar_g_file_is_descendant (target_dir, source_file))
+            {
+              base_name = g_file_get_basename (source_file);
+              g_set_error (&err, G_FILE_ERROR, G_FILE_ERROR_INVAL,
+                           _("The folder (%s) cannot be moved into its own subdirectory"), base_name);
+              g_free (base_name);
+            }
+          else
+            {
+              base_name = g_file_get_basename (source_file);
+              target_file = g_file_resolve_relative_path (target_dir, base_name);
+              g_free (base_name);
+            }
+
+          if (err == NULL)
+            {
+              /* lists are built in reverse and flipped once at the end */
+              request->source_file_list[mode] = g_list_prepend (request->source_file_list[mode], source_file);
+              if (target_file != NULL)
+                request->target_file_list[mode] = g_list_prepend (request->target_file_list[mode], target_file);
+            }
+          else
+            {
+              g_object_unref (source_file);
+              if (target_file != NULL)
+                g_object_unref (target_file);
+            }
+        }
+
+      if (target_dir != NULL)
+        g_object_unref (target_dir);
+      g_free (source_filenames);
+    }
+
+  if (err != NULL)
+    {
+      g_task_return_error (task, err);
+      return;
+    }
+
+  for (mode = 0; mode < THUNAR_DBUS_N_BATCH_MODES; ++mode)
+    {
+      request->source_file_list[mode] = g_list_reverse (request->source_file_list[mode]);
+      request->target_file_list[mode] = g_list_reverse (request->target_file_list[mode]);
+    }
+
+  g_task_return_boolean (task, TRUE);
+}
+
+
+
+static void
+thunar_dbus_service_batch_resolved (GObject      *source_object,
+                                    GAsyncResult *result,
+                                    gpointer      user_data)
+{
+  static const struct
+  {
+    const gchar *icon_name;
+    const gchar *title;
+    ThunarJob  *(*launcher) (GList *source_file_list, GList *target_file_list);
+    gboolean     update_source_folders;
+    gboolean     update_target_folders;
+  } modes[] =
+  {
+    { "edit-copy",         N_("Copying files..."),                 thunar_io_jobs_copy_files, FALSE, TRUE  },
+    { "stock_folder-move", N_("Moving files ..."),                 thunar_io_jobs_move_files, TRUE,  TRUE  },
+    { "insert-link",       N_("Creating symbolic links..."),       thunar_io_jobs_link_files, FALSE, TRUE  },
+    { "user-trash-full",   N_("Moving files into the trash..."),   NULL,                      TRUE,  FALSE },
+  };
+
+  ThunarDBusService      *dbus_service = THUNAR_DBUS_SERVICE (source_object);
+  ThunarDBusBatchRequest *request = g_task_get_task_data (G_TASK (result));
+  ThunarApplication      *application;
+  ThunarDBusBatch        *batch;
+  ThunarJob              *job;
+  GError                 *error = NULL;
+  guint                   handle;
+  guint                   mode;
+
+  G_STATIC_ASSERT (G_N_ELEMENTS (modes) == THUNAR_DBUS_N_BATCH_MODES);
+
+  if (!g_task_propagate_boolean (G_TASK (result), &error))
+    {
+      g_dbus_method_invocation_take_error (request->invocation, error);
+      return;
+    }
+
+  batch = g_new0 (ThunarDBusBatch, 1);
+  batch->dbus_service = dbus_service;
+
+  /* launch one job per kind of operation, they all share the progress dialog */
+  application = thunar_application_get ();
+  for (mode = 0; mode < THUNAR_DBUS_N_BATCH_MODES; ++mode)
+    {
+      if (request->source_file_list[mode] == NULL)
+        continue;
+
+      if (mode == THUNAR_DBUS_BATCH_MODE_TRASH)
+        job = thunar_io_jobs_trash_files (request->source_file_list[mode]);
+      else
+        job = (*modes[mode].launcher) (request->source_file_list[mode], request->target_file_list[mode]);
+
+      batch->jobs[batch->n_jobs] = job;
+      g_signal_connect (job, "percent", G_CALLBACK (thunar_dbus_batch_job_percent), batch);
+      g_signal_connect (job, "error", G_CALLBACK (thunar_dbus_batch_job_error), batch);
+      g_signal_connect (job, "finished", G_CALLBACK (thunar_dbus_batch_job_finished), batch);
+      batch->n_jobs++;
+
+      thunar_application_launch_job (application, request->screen,
+                                     modes[mode].icon_name, _(modes[mode].title), job,
+                                     request->source_file_list[mode], request->target_file_list[mode],
+                                     modes[mode].update_source_folders, modes[mode].update_target_folders,
+                                     THUNAR_OPERATION_LOG_NO_OPERATIONS, NULL);
+    }
+  g_object_unref (application);
+
+  /* nothing to do, e.g. only empty source lists */
+  if (G_UNLIKELY (batch->n_jobs == 0))
+    batch->expire_id = g_timeout_add_seconds (THUNAR_DBUS_BATCH_EXPIRE, thunar_dbus_batch_expire, batch);
+
+  /* handles are never 0 */
+  handle = ++dbus_service->last_batch_handle;
+  if (G_UNLIKELY (handle == 0))
+    handle = ++dbus_service->last_batch_handle;
+  g_hash_table_replace (dbus_service->batches, GUINT_TO_POINTER (handle), batch);
+
+  thunar_dbus_thunar_complete_batch_operations (request->object, request->invocation, handle);
+}
+
+
+
+static void
+thunar_dbus_batch_request_free (gpointer data)
+{
+  ThunarDBusBatchRequest *request = data;
+  guint                   mode;
+
+  for (mode = 0; mode < THUNAR_DBUS_N_BATCH_MODES; ++mode)
+    {
+      thunar_g_list_free_full (request->source_file_list[mode]);
+      thunar_g_list_free_full (request->target_file_list[mode]);
+    }
+
+  g_variant_unref (request->operations);
+  g_free (request->working_directory);
+  g_object_unref (request->screen);
+  g_object_unref (request->object);
+  g_free (request);
+}
+
+
+
+static void
+thunar_dbus_batch_free (gpointer data)
+{
+  ThunarDBusBatch *batch = data;
+  guint            n;
+
+  if (batch->expire_id != 0)
+    g_source_remove (batch->expire_id);
+
+  for (n = 0; n < batch->n_jobs; ++n)
+    {
+      g_signal_handlers_disconnect_by_data (batch->jobs[n], batch);
+      g_object_unref (batch->jobs[n]);
+    }
+
+  g_free (batch->error_message);
+  g_free (batch);
+}
+
+
+
+static void
+thunar_dbus_batch_job_percent (ExoJob          *job,
+                               gdouble          percent,
+                               ThunarDBusBatch *batch)
+{
+  guint n;
+
+  for (n = 0; n < batch->n_jobs; ++n)
+    if (EXO_JOB (batch->jobs[n]) == job)
+      batch->percent[n] = percent;
+}
+
+
+
+static void
+thunar_dbus_batch_job_error (ExoJob          *job,
+                             GError          *error,
+                             ThunarDBusBatch *batch)
+{
+  /* remember the first error, it's usually the interesting one */
+  if (batch->error_message == NULL && error != NULL)
+    batch->error_message = g_strdup (error->message);
+}
+
+
+
+static void
+thunar_dbus_batch_job_finished (ExoJob          *job,
+                                ThunarDBusBatch *batch)
+{
+  thunar_dbus_batch_job_percent (job, 100.0, batch);
+
+  /* keep the result around for a while, in case nobody asks */
+  if (++batch->n_finished == batch->n_jobs)
+    batch->expire_id = g_timeout_add_seconds (THUNAR_DBUS_BATCH_EXPIRE, thunar_dbus_batch_expire, batch);
+}
+
+
+
+static gboolean
+thunar_dbus_batch_expire (gpointer user_data)
+{
+  ThunarDBusBatch *batch = user_data;
+  GHashTableIter   iter;
+  gpointer         value;
+
+  batch->expire_id = 0;
+
+  g_hash_table_iter_init (&iter, batch->dbus_service->batches);
+  while (g_hash_table_iter_next (&iter, NULL, &value))
+    if (value == batch)
+      {
+        g_hash_table_iter_remove (&iter);
+        break;
+      }
+
+  return FALSE;
+}
+
+
+
+static gboolean
+thunar_dbus_service_query_batch (ThunarDBusThunar       *object,
+                                 GDBusMethodInvocation  *invocation,
+                                 guint                   handle,
+                                 ThunarDBusService      *dbus_service)
+{
+  ThunarDBusBatch *batch;
+  gboolean         finished;
+  gdouble          percent = 0.0;
+  guint            n;
+
+  batch = g_hash_table_lookup (dbus_service->batches, GUINT_TO_POINTER (handle));
+  if (G_UNLIKELY (batch == NULL))
+    {
+      g_dbus_method_invocation_return_error (invocation, G_FILE_ERROR, G_FILE_ERROR_NOENT,
+                                             _("Unknown batch handle %u"), handle);
+      return TRUE;
+    }
+
+  /* every job weighs the same, they don't know their sizes upfront */
+  for (n = 0; n < batch->n_jobs; ++n)
+    percent += batch->percent[n];
+  percent = (batch->n_jobs > 0) ? percent / batch->n_jobs : 100.0;
+
+  finished = (batch->n_finished == batch->n_jobs);
+
+  thunar_dbus_thunar_complete_query_batch (object, invocation, finished, percent,
+                                           (batch->error_message != NULL) ? batch->error_message : "");
+
+  /* the caller knows the result now */
+  if (finished)
+    g_hash_table_remove (dbus_service->batches, GUINT_TO_POINTER (handle));
+
+  return TRUE;
+}
+
+
+
+static void
+thunar_dbus_service_query_caches_foreach (const gchar *name,
+                                          gsize        n_bytes,
+                                          gpointer     user_data)
+{
+  GHashTable *caches = user_data;
+
+  /* caches of the same kind, like the icons of every theme, are summed up */
+  n_bytes += GPOINTER_TO_SIZE (g_hash_table_lookup (caches, name));
+  g_hash_table_insert (caches, (gpointer) name, GSIZE_TO_POINTER (n_bytes));
+}
+
+
+
+static gboolean
+thunar_dbus_service_query_caches (ThunarDBusThunar       *object,
+                                  GDBusMethodInvocation  *invocation,
+                                  ThunarDBusService      *dbus_service)
+{
+  GVariantBuilder builder;
+  GHashTableIter  iter;
+  GHashTable     *caches;
+  gpointer        name;
+  gpointer        n_bytes;
+
+  caches = g_hash_table_new (g_str_hash, g_str_equal);
+  thunar_cache_registry_foreach (thunar_dbus_service_query_caches_foreach, caches);
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{st}"));
+  g_hash_table_iter_init (&iter, caches);
+  while (g_hash_table_iter_next (&iter, &name, &n_bytes))
+    g_variant_builder_add (&builder, "{st}", name, (guint64) GPOINTER_TO_SIZE (n_bytes));
+  g_hash_table_destroy (caches);
+
+  thunar_dbus_thunar_complete_query_caches (object, invocation, g_variant_builder_end (&builder));
+
+  return TRUE;
+}
+
+
+
+static void
+thunar_dbus_service_get_counters_add (GVariantBuilder *builder,
+                                      guint64          value,
+                                      const gchar     *format,
+                                      ...)
+{
+  va_list  args;
+  gchar   *name;
+
+  va_start (args, format);
+  name = g_strdup_vprintf (format, args);
+  va_end (args);
+
+  g_variant_builder_add (builder, "{st}", name, value);
+  g_free (name);
+}
+
+
+
+static gboolean
+thunar_dbus_service_get_counters (ThunarDBusDebug        *object,
+                                  GDBusMethodInvocation  *invocation,
+                                  ThunarDBusService      *dbus_service)
+{
+  static const gchar *priority_names[THUNAR_JOB_N_PRIORITIES] = { "interactive", "visible", "background", "bulk" };
+  ThunarThumbnailer  *thumbnailer;
+  GVariantBuilder     builder;
+  GHashTableIter      iter;
+  GHashTable         *caches;
+  const guint64      *stall_counts;
+  const guint        *stall_limits;
+  gpointer            name;
+  gpointer            n_bytes;
+  guint64             n_hits;
+  guint64             n_misses;
+  guint               n_pending[N_THUMBNAIL_SIZES];
+  guint               n_running[THUNAR_JOB_N_PRIORITIES];
+  guint               n_waiting[THUNAR_JOB_N_PRIORITIES];
+  guint               n_limits;
+  guint               n_files;
+  guint               n_folders;
+  guint               n_monitored;
+  guint               n;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{st}"));
+
+  thunar_file_cache_get_stats (&n_files, &n_hits, &n_misses);
+  g_variant_builder_add (&builder, "{st}", "file_cache.files", (guint64) n_files);
+  g_variant_builder_add (&builder, "{st}", "file_cache.hits", n_hits);
+  g_variant_builder_add (&builder, "{st}", "file_cache.misses", n_misses);
+
+  thunar_folder_get_counts (&n_folders, &n_monitored);
+  g_variant_builder_add (&builder, "{st}", "folders.alive", (guint64) n_folders);
+  g_variant_builder_add (&builder, "{st}", "folders.monitored", (guint64) n_monitored);
+
+  caches = g_hash_table_new (g_str_hash, g_str_equal);
+  thunar_cache_registry_foreach (thunar_dbus_service_query_caches_foreach, caches);
+  g_hash_table_iter_init (&iter, caches);
+  while (g_hash_table_iter_next (&iter, &name, &n_bytes))
+    thunar_dbus_service_get_counters_add (&builder, GPOINTER_TO_SIZE (n_bytes), "cache.%s.bytes", (const gchar *) name);
+  g_hash_table_destroy (caches);
+
+  thumbnailer = thunar_thumbnailer_get ();
+  thunar_thumbnailer_get_pending (thumbnailer, n_pending);
+  g_object_unref (thumbnailer);
+  for (n = 0; n < N_THUMBNAIL_SIZES; n++)
+    thunar_dbus_service_get_counters_add (&builder, n_pending[n], "thumbnails.pending.%s", thunar_thumbnail_size_get_nick (n));
+
+  thunar_job_get_scheduler_stats (n_running, n_waiting);
+  for (n = 0; n < THUNAR_JOB_N_PRIORITIES; n++)
+    {
+      thunar_dbus_service_get_counters_add (&builder, n_running[n], "jobs.%s.running", priority_names[n]);
+      thunar_dbus_service_get_counters_add (&builder, n_waiting[n], "jobs.%s.waiting", priority_names[n]);
+    }
+
+  n_limits = thunar_profile_get_stalls (&stall_limits, &stall_counts);
+  for (n = 0; n < n_limits; n++)
+    thunar_dbus_service_get_counters_add (&builder, stall_counts[n], "mainloop.lateness.%u", stall_limits[n]);
+  thunar_dbus_service_get_counters_add (&builder, stall_counts[n_limits], "mainloop.lateness.inf");
+
+  thunar_dbus_debug_complete_get_counters (object, invocation, g_variant_builder_end (&builder));
+
+  return TRUE;
+}
+
+
+
+static void
+thunar_dbus_service_get_stalls_add (gint64              time,
+                                    gint64              duration,
+                                    const gchar        *source,
+                                    guint               navigation,
+                                    const gchar *const *frames,
+                                    gpointer            user_data)
+{
+  static const gchar *no_frames[] = { NULL };
+
+  g_variant_builder_add (user_data, "(xxsu^as)", time, duration, source, navigation,
+                         (frames != NULL) ? frames : no_frames);
+}
+
+
+
+static gboolean
+thunar_dbus_service_get_stalls (ThunarDBusDebug        *object,
+                                GDBusMethodInvocation  *invocation,
+                                ThunarDBusService      *dbus_service)
+{
+  GVariantBuilder builder;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE ("a(xxsuas)"));
+  thunar_profile_foreach_stall (thunar_dbus_service_get_stalls_add, &builder);
+  thunar_dbus_debug_complete_get_stalls (object, invocation, g_variant_builder_end (&builder));
+
+  return TRUE;
+}
+
+
+
 static gboolean
 thunar_dbus_service_terminate (ThunarDBusThunar       *object,
                                GDBusMethodInvocation  *invocation,
@@ -1516,32 +2482,21 @@ thunar_dbus_freedesktop_show_folders (ThunarOrgFreedesktopFileManager1 *object,
                                       const gchar                      *startup_id,
                                       ThunarDBusService                *dbus_service)
 {
-  ThunarApplication *application;
-  GdkScreen         *screen;
-  gint               n;
-  GFile             *file;
-  ThunarFile        *thunar_file;
+  ThunarDBusShow *show;
+  GFile          *file;
+  gint            n;
 
-  screen = gdk_screen_get_default ();
-  application = thunar_application_get ();
+  /* the folders are resolved and shown without blocking the caller */
+  show = thunar_dbus_show_new (gdk_screen_get_default (), startup_id);
 
   for (n = 0; uris[n] != NULL; ++n)
     {
       file = g_file_new_for_uri (uris[n]);
-      thunar_file = thunar_file_get (file, NULL);
-
+      thunar_dbus_show_add_folder (show, file);
       g_object_unref (G_OBJECT (file));
-      if (thunar_file == NULL)
-        continue;
-
-      if (thunar_file_is_directory (thunar_file))
-        thunar_application_open_window (application, thunar_file, screen,
-                                        startup_id, FALSE);
-
-      g_object_unref (G_OBJECT (thunar_file));
     }
 
-  g_object_unref (G_OBJECT (application));
+  thunar_dbus_show_run (show);
 
   thunar_org_freedesktop_file_manager1_complete_show_folders (object, invocation);
 
@@ -1557,50 +2512,22 @@ thunar_dbus_freedesktop_show_items (ThunarOrgFreedesktopFileManager1 *object,
                                     const gchar                      *startup_id,
                                     ThunarDBusService                *dbus_service)
 {
-  ThunarApplication *application;
-  GtkWidget         *window;
-  GdkScreen         *screen;
-  gint               n;
-  GList             *gfiles = NULL;
-  ThunarFile        *thunar_file = NULL;
-  ThunarFile        *thunar_folder = NULL;
-  GError            *error = NULL;
+  ThunarDBusShow *show;
+  GFile          *file;
+  gint            n;
 
-  screen = gdk_screen_get_default ();
-  application = thunar_application_get ();
+  /* "Show in folder" of IDEs and browsers, the items of one folder are
+   * selected together in a window or tab already showing it, if any */
+  show = thunar_dbus_show_new (gdk_screen_get_default (), startup_id);
 
   for (n = 0; uris[n] != NULL; ++n)
     {
-      thunar_file = thunar_file_get_for_uri (uris[n], &error);
-      if (error)
-        {
-          g_dbus_method_invocation_take_error (invocation, error);
-          continue;
-        }
-
-      thunar_folder = NULL;
-      if (G_LIKELY (thunar_file_has_parent (thunar_file)))
-        thunar_folder = thunar_file_get_parent (thunar_file, NULL);
-
-      if (thunar_folder == NULL)
-        {
-          g_object_unref (G_OBJECT (thunar_file));
-          continue;
-        }
-
-      window = thunar_application_open_window (application, thunar_folder,
-                                               screen, startup_id, FALSE);
-
-      gfiles = g_list_append (gfiles, thunar_file_get_file (thunar_file));
-      thunar_window_show_and_select_files (THUNAR_WINDOW (window), gfiles);
-
-      g_list_free (gfiles);
-      gfiles = NULL;
-      g_object_unref (G_OBJECT (thunar_file));
-      g_object_unref (G_OBJECT (thunar_folder));
+      file = g_file_new_for_uri (uris[n]);
+      thunar_dbus_show_add_item (show, file);
+      g_object_unref (G_OBJECT (file));
     }
 
-  g_object_unref (G_OBJECT (application));
+  thunar_dbus_show_run (show);
 
   thunar_org_freedesktop_file_manager1_complete_show_items (object, invocation);
   return TRUE;
@@ -1689,6 +2616,13 @@ gboolean thunar_dbus_service_export_on_connection (ThunarDBusService *service,
                                          error))
     goto fail;
 
+  if (service->debug != NULL
+      && !g_dbus_interface_skeleton_export (G_DBUS_INTERFACE_SKELETON (service->debug),
+                                            connection,
+                                            "/org/xfce/FileManager",
+                                            error))
+    goto fail;
+
   return TRUE;
 
 fail:
@@ -1697,5 +2631,7 @@ fail:
   g_dbus_interface_skeleton_unexport_from_connection (G_DBUS_INTERFACE_SKELETON (service->trash), connection);
   g_dbus_interface_skeleton_unexport_from_connection (G_DBUS_INTERFACE_SKELETON (service->thunar), connection);
   g_dbus_interface_skeleton_unexport_from_connection (G_DBUS_INTERFACE_SKELETON (service->file_manager_fdo), connection);
+  if (service->debug != NULL)
+    g_dbus_interface_skeleton_unexport_from_connection (G_DBUS_INTERFACE_SKELETON (service->debug), connection);
   return FALSE;
 }
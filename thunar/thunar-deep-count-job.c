@@ -23,6 +23,22 @@
 #include "config.h"
 #endif
 
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef HAVE_LINUX_FIEMAP_H
+#include <linux/fiemap.h>
+#endif
+#ifdef HAVE_LINUX_FS_H
+#include <linux/fs.h>
+#endif
+#ifdef HAVE_SYS_IOCTL_H
+#include <sys/ioctl.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
 #include <glib.h>
 #include <glib-object.h>
 #include <gio/gio.h>
@@ -47,11 +63,42 @@ enum
   G_FILE_ATTRIBUTE_STANDARD_TYPE "," \
   G_FILE_ATTRIBUTE_STANDARD_SIZE "," \
   G_FILE_ATTRIBUTE_STANDARD_ALLOCATED_SIZE "," \
-  G_FILE_ATTRIBUTE_ID_FILESYSTEM
+  G_FILE_ATTRIBUTE_ID_FILESYSTEM "," \
+  G_FILE_ATTRIBUTE_TIME_MODIFIED "," \
+  G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC "," \
+  G_FILE_ATTRIBUTE_UNIX_DEVICE "," \
+  G_FILE_ATTRIBUTE_UNIX_INODE "," \
+  G_FILE_ATTRIBUTE_UNIX_NLINK
+
+/* number of threads walking the folders of one job */
+#define DEEP_COUNT_THREADS (4)
+
+/* interval of the "status-update" emissions while counting */
+#define DEEP_COUNT_STATUS_INTERVAL (G_USEC_PER_SEC / 4)
+
+/* the contents of at most this many folders are remembered, and for
+ * no longer than this, since files changed in place do not change the
+ * modification time of their folder */
+#define DEEP_COUNT_CACHE_MAX_FOLDERS (16384)
+#define DEEP_COUNT_CACHE_MAX_AGE     (60 * G_USEC_PER_SEC)
+
+#if defined (HAVE_LINUX_FIEMAP_H) && defined (FS_IOC_FIEMAP)
+#define DEEP_COUNT_HAVE_FIEMAP
+
+/* number of extents asked for with one FS_IOC_FIEMAP */
+#define DEEP_COUNT_FIEMAP_EXTENTS (128)
+#endif
 
 static void     thunar_deep_count_job_finalize   (GObject                 *object);
 static gboolean thunar_deep_count_job_execute    (ExoJob                  *job,
                                                   GError                 **error);
+static void     thunar_deep_count_job_reported   (ThunarJob               *job,
+                                                  guint64                  total_size,
+                                                  guint64                  total_size_on_disk,
+                                                  guint                    file_count,
+                                                  guint                    directory_count,
+                                                  guint                    unreadable_directory_count);
+static gboolean thunar_deep_count_job_unregister (ThunarDeepCountJob      *job);
 
 
 
@@ -75,8 +122,8 @@ struct _ThunarDeepCountJob
   GList              *files;
   GFileQueryInfoFlags query_flags;
 
-  /* the time of the last "status-update" emission */
-  gint64              last_time;
+  /* whether data blocks shared by files count once for the size on disk */
+  gboolean            shared_extents;
 
   /* status information */
   guint64             total_size;
@@ -84,12 +131,106 @@ struct _ThunarDeepCountJob
   guint               file_count;
   guint               directory_count;
   guint               unreadable_directory_count;
+
+  /* the last reported status, only touched in the main thread */
+  gboolean            has_reported;
+  guint64             reported_total_size;
+  guint64             reported_total_size_on_disk;
+  guint               reported_file_count;
+  guint               reported_directory_count;
+  guint               reported_unreadable_directory_count;
+
+  /* shared jobs, see thunar_deep_count_job_get_shared() */
+  gchar              *shared_key;
+  guint               n_subscribers;
+  guint               launch_id;
+  gboolean            launched;
 };
 
 
 
+/* a hard linked file (the key is the inode) or a shared extent (the
+ * key is its physical offset), counted once per device for a walk */
+typedef struct
+{
+  guint32   device;
+  guint64   key;
+  guint64   size;
+  guint64   size_on_disk;
+}
+ThunarDeepCountShared;
+
+/* the counts of the direct children of a folder, up to date as long
+ * as the folder has the same modification time */
+typedef struct
+{
+  guint64   mtime;
+  gint64    cached_at;
+  guint64   total_size;
+  guint64   total_size_on_disk;
+  gboolean  size_on_disk_known;
+  guint     file_count;
+  gchar   **folder_names;
+  GArray   *links;
+  GArray   *extents;
+}
+ThunarDeepCountFolder;
+
+/* a compact hash set of 64 bit keys, with open addressing */
+typedef struct
+{
+  guint64  *keys;
+  gsize     size;
+  gsize     n_keys;
+  gboolean  has_zero;
+}
+ThunarDeepCountKeys;
+
+/* a folder waiting to be walked by the pool */
+typedef struct
+{
+  GFile     *file;
+  GFileInfo *info;
+  GQuark     toplevel_fs_id;
+  gboolean   toplevel_file;
+  gboolean   count_extents;
+}
+ThunarDeepCountTask;
+
+/* shared by the walking threads of one job */
+typedef struct
+{
+  ThunarDeepCountJob *job;
+  GThreadPool        *pool;
+
+  /* protected by the mutex */
+  GMutex              mutex;
+  GCond               cond;
+  guint               n_pending;    /* folders queued or being walked */
+  guint64             total_size;
+  guint64             total_size_on_disk;
+  guint               file_count;
+  guint               directory_count;
+  guint               unreadable_directory_count;
+  GError             *error;
+
+  /* device -> ThunarDeepCountKeys of the inodes and extents seen */
+  GHashTable         *inodes;
+  GHashTable         *extents;
+}
+ThunarDeepCountWalk;
+
+
+
 static guint deep_count_signals[LAST_SIGNAL];
 
+/* folder URI -> ThunarDeepCountFolder, shared by all deep count jobs */
+G_LOCK_DEFINE_STATIC (deep_count_cache);
+static GHashTable *deep_count_cache = NULL;
+
+/* key of the roots -> running ThunarDeepCountJob, main thread only */
+static GHashTable *deep_count_shared_jobs = NULL;
+
 
 
 G_DEFINE_TYPE (ThunarDeepCountJob, thunar_deep_count_job, THUNAR_TYPE_JOB)
@@ -108,6 +249,8 @@ thunar_deep_count_job_class_init (ThunarDeepCountJobClass *klass)
   job_class = EXO_JOB_CLASS (klass);
   job_class->execute = thunar_deep_count_job_execute;
 
+  klass->status_update = thunar_deep_count_job_reported;
+
   /**
    * ThunarDeepCountJob::status-update:
    * @job                        : a #ThunarJob.
@@ -150,6 +293,10 @@ thunar_deep_count_job_finalize (GObject *object)
 {
   ThunarDeepCountJob *job = THUNAR_DEEP_COUNT_JOB (object);
 
+  if (G_UNLIKELY (job->launch_id != 0))
+    g_source_remove (job->launch_id);
+  thunar_deep_count_job_unregister (job);
+
   g_list_free_full (job->files, g_object_unref);
 
   (*G_OBJECT_CLASS (thunar_deep_count_job_parent_class)->finalize) (object);
@@ -174,179 +321,668 @@ thunar_deep_count_job_status_update (ThunarDeepCountJob *job)
 
 
 
-static gboolean
-thunar_deep_count_job_process (ExoJob       *job,
-                               GFile        *file,
-                               GFileInfo    *file_info,
-                               const gchar  *toplevel_fs_id,
-                               GError      **error)
+static void
+thunar_deep_count_job_reported (ThunarJob *job,
+                                guint64    total_size,
+                                guint64    total_size_on_disk,
+                                guint      file_count,
+                                guint      directory_count,
+                                guint      unreadable_directory_count)
 {
   ThunarDeepCountJob *count_job = THUNAR_DEEP_COUNT_JOB (job);
-  GFileEnumerator    *enumerator;
-  GFileInfo          *child_info;
-  GFileInfo          *info;
-  gboolean            success = TRUE;
-  GFile              *child;
-  gint64              real_time;
-  const gchar        *fs_id;
-  gboolean            toplevel_file = (toplevel_fs_id == NULL);
 
-  _thunar_return_val_if_fail (THUNAR_IS_JOB (job), FALSE);
-  _thunar_return_val_if_fail (G_IS_FILE (file), FALSE);
-  _thunar_return_val_if_fail (file_info == NULL || G_IS_FILE_INFO (file_info), FALSE);
-  _thunar_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+  /* emissions are dispatched to the main thread, keep a copy there for
+   * the subscribers that join a shared job late */
+  count_job->has_reported = TRUE;
+  count_job->reported_total_size = total_size;
+  count_job->reported_total_size_on_disk = total_size_on_disk;
+  count_job->reported_file_count = file_count;
+  count_job->reported_directory_count = directory_count;
+  count_job->reported_unreadable_directory_count = unreadable_directory_count;
+}
+
+
+
+static void
+thunar_deep_count_folder_free (gpointer data)
+{
+  ThunarDeepCountFolder *folder = data;
+
+  g_strfreev (folder->folder_names);
+  if (folder->links != NULL)
+    g_array_unref (folder->links);
+  if (folder->extents != NULL)
+    g_array_unref (folder->extents);
+  g_free (folder);
+}
+
+
+
+static ThunarDeepCountFolder *
+thunar_deep_count_folder_new (void)
+{
+  ThunarDeepCountFolder *folder;
+
+  folder = g_new0 (ThunarDeepCountFolder, 1);
+  folder->size_on_disk_known = TRUE;
+  folder->links = g_array_new (FALSE, FALSE, sizeof (ThunarDeepCountShared));
+
+  return folder;
+}
+
+
+
+static ThunarDeepCountFolder *
+thunar_deep_count_folder_copy (const ThunarDeepCountFolder *folder)
+{
+  ThunarDeepCountFolder *copy;
+
+  copy = g_memdup2 (folder, sizeof (*folder));
+  copy->folder_names = g_strdupv (folder->folder_names);
+  copy->links = g_array_copy (folder->links);
+  copy->extents = (folder->extents != NULL) ? g_array_copy (folder->extents) : NULL;
+
+  return copy;
+}
+
+
+
+static void
+thunar_deep_count_keys_free (gpointer data)
+{
+  ThunarDeepCountKeys *keys = data;
+
+  g_free (keys->keys);
+  g_free (keys);
+}
+
+
+
+/* adds @key to @keys, returns %FALSE if it was there already */
+static gboolean
+thunar_deep_count_keys_add (ThunarDeepCountKeys *keys,
+                            guint64              key)
+{
+  guint64 *old_keys;
+  gsize    old_size;
+  gsize    mask;
+  gsize    i, n;
+
+  /* zero marks the free slots */
+  if (G_UNLIKELY (key == 0))
+    {
+      if (keys->has_zero)
+        return FALSE;
+      keys->has_zero = TRUE;
+      return TRUE;
+    }
+
+  /* grow at three quarters, open addressing gets slow beyond */
+  if ((keys->n_keys + 1) * 4 > keys->size * 3)
+    {
+      old_keys = keys->keys;
+      old_size = keys->size;
+
+      keys->size = MAX (old_size * 2, 1024);
+      keys->keys = g_new0 (guint64, keys->size);
+      keys->n_keys = 0;
+
+      for (n = 0; n < old_size; n++)
+        if (old_keys[n] != 0)
+          thunar_deep_count_keys_add (keys, old_keys[n]);
+
+      g_free (old_keys);
+    }
+
+  mask = keys->size - 1;
+  for (i = (key * G_GUINT64_CONSTANT (0x9e3779b97f4a7c15)) >> 20 & mask; keys->keys[i] != 0; i = (i + 1) & mask)
+    if (keys->keys[i] == key)
+      return FALSE;
+
+  keys->keys[i] = key;
+  keys->n_keys++;
+
+  return TRUE;
+}
+
+
+
+/* adds @key to the set of @device in @sets, returns %FALSE if it was there already */
+static gboolean
+thunar_deep_count_sets_add (GHashTable *sets,
+                            guint32     device,
+                            guint64     key)
+{
+  ThunarDeepCountKeys *keys;
+
+  keys = g_hash_table_lookup (sets, GUINT_TO_POINTER (device));
+  if (G_UNLIKELY (keys == NULL))
+    {
+      keys = g_new0 (ThunarDeepCountKeys, 1);
+      g_hash_table_insert (sets, GUINT_TO_POINTER (device), keys);
+    }
+
+  return thunar_deep_count_keys_add (keys, key);
+}
 
-  /* abort if job was already cancelled */
-  if (exo_job_is_cancelled (job))
+
+
+#ifdef DEEP_COUNT_HAVE_FIEMAP
+/* determines the size on disk of @file from its extents, the shared
+ * extents are added to @extents, the size of all others is returned in
+ * @unshared_size */
+static gboolean
+thunar_deep_count_get_extents (GFile   *file,
+                               guint32  device,
+                               guint64 *unshared_size,
+                               GArray  *extents)
+{
+  ThunarDeepCountShared  shared;
+  struct fiemap_extent  *extent;
+  struct fiemap         *fiemap;
+  const gchar           *path;
+  gboolean               succeed = TRUE;
+  gboolean               last = FALSE;
+  guint64                start = 0;
+  guint                  n;
+  gint                   fd;
+
+  path = g_file_peek_path (file);
+  if (path == NULL)
     return FALSE;
 
-  if (file_info != NULL)
+  fd = open (path, O_RDONLY | O_CLOEXEC | O_NONBLOCK);
+  if (fd < 0)
+    return FALSE;
+
+  fiemap = g_malloc0 (sizeof (struct fiemap) + DEEP_COUNT_FIEMAP_EXTENTS * sizeof (struct fiemap_extent));
+  *unshared_size = 0;
+
+  while (!last)
+    {
+      fiemap->fm_start = start;
+      fiemap->fm_length = FIEMAP_MAX_OFFSET - start;
+      fiemap->fm_flags = 0;
+      fiemap->fm_extent_count = DEEP_COUNT_FIEMAP_EXTENTS;
+      fiemap->fm_mapped_extents = 0;
+
+      if (ioctl (fd, FS_IOC_FIEMAP, fiemap) < 0)
+        {
+          succeed = FALSE;
+          break;
+        }
+
+      if (fiemap->fm_mapped_extents == 0)
+        break;
+
+      for (n = 0; n < fiemap->fm_mapped_extents; n++)
+        {
+          extent = &fiemap->fm_extents[n];
+
+          /* extents without a known location cannot be matched */
+          if ((extent->fe_flags & FIEMAP_EXTENT_SHARED) != 0
+              && (extent->fe_flags & (FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_ENCODED)) == 0)
+            {
+              shared.device = device;
+              shared.key = extent->fe_physical;
+              shared.size = 0;
+              shared.size_on_disk = extent->fe_length;
+              g_array_append_val (extents, shared);
+            }
+          else
+            {
+              *unshared_size += extent->fe_length;
+            }
+
+          start = extent->fe_logical + extent->fe_length;
+          last = (extent->fe_flags & FIEMAP_EXTENT_LAST) != 0;
+        }
+    }
+
+  g_free (fiemap);
+  close (fd);
+
+  return succeed;
+}
+#endif
+
+
+
+/* counts the non-directory @info into @folder, hard links are kept
+ * aside, they cannot be added up before the whole walk knows them */
+static void
+thunar_deep_count_folder_add_file (ThunarDeepCountFolder *folder,
+                                   GFile                 *file,
+                                   GFileInfo             *info,
+                                   gboolean               count_extents)
+{
+  ThunarDeepCountShared hard_link;
+  gboolean              size_on_disk_known = TRUE;
+  guint64               size_on_disk = 0;
+  guint64               size;
+  guint32               device;
+#ifdef DEEP_COUNT_HAVE_FIEMAP
+  guint                 n_extents;
+#endif
+
+  folder->file_count++;
+
+  size = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_SIZE);
+  device = g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_DEVICE);
+
+#ifdef DEEP_COUNT_HAVE_FIEMAP
+  if (count_extents && g_file_info_get_file_type (info) == G_FILE_TYPE_REGULAR)
     {
-      /* use the enumerator info */
-      info = g_object_ref (file_info);
+      if (folder->extents == NULL)
+        folder->extents = g_array_new (FALSE, FALSE, sizeof (ThunarDeepCountShared));
+
+      /* fall back to the allocated size, without the extents of a partial answer */
+      n_extents = folder->extents->len;
+      count_extents = thunar_deep_count_get_extents (file, device, &size_on_disk, folder->extents);
+      if (!count_extents)
+        g_array_set_size (folder->extents, n_extents);
     }
   else
+#endif
+    count_extents = FALSE;
+
+  if (!count_extents)
     {
-      /* query size and type of the current file */
-      info = g_file_query_info (file,
-                                DEEP_COUNT_FILE_INFO_NAMESPACE,
-                                count_job->query_flags,
-                                exo_job_get_cancellable (job),
-                                error);
+      if (g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_STANDARD_ALLOCATED_SIZE))
+        size_on_disk = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_ALLOCATED_SIZE);
+      else
+        size_on_disk_known = FALSE;
     }
 
-  /* abort on invalid info or cancellation */
-  if (info == NULL)
-    return FALSE;
+  if (!size_on_disk_known)
+    folder->size_on_disk_known = FALSE;
 
-  /* abort on cancellation */
-  if (exo_job_is_cancelled (job))
+  /* files with more than one name are counted once for the whole walk */
+  if (g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_NLINK) > 1)
     {
-      g_object_unref (info);
-      return FALSE;
+      hard_link.device = device;
+      hard_link.key = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_UNIX_INODE);
+      hard_link.size = size;
+      hard_link.size_on_disk = size_on_disk;
+      g_array_append_val (folder->links, hard_link);
+    }
+  else
+    {
+      folder->total_size += size;
+      folder->total_size_on_disk += size_on_disk;
     }
+}
 
-  /* only check files on the same filesystem so no remote mounts or
-   * dummy filesystems are counted */
-  fs_id = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILESYSTEM);
-  if (fs_id == NULL)
-    fs_id = "";
 
-  if (toplevel_fs_id == NULL)
+
+/* adds the counts of @folder to @walk, the walk mutex must be held */
+static void
+thunar_deep_count_walk_merge (ThunarDeepCountWalk         *walk,
+                              const ThunarDeepCountFolder *folder)
+{
+  const ThunarDeepCountShared *shared;
+  guint64                      size_on_disk = folder->total_size_on_disk;
+  guint                        n;
+
+  walk->file_count += folder->file_count;
+  walk->total_size += folder->total_size;
+
+  /* a hard linked file is counted for the first name found */
+  for (n = 0; n < folder->links->len; n++)
     {
-      /* first toplevel, so use this id */
-      toplevel_fs_id = fs_id;
+      shared = &g_array_index (folder->links, ThunarDeepCountShared, n);
+      if (thunar_deep_count_sets_add (walk->inodes, shared->device, shared->key))
+        {
+          walk->total_size += shared->size;
+          size_on_disk += shared->size_on_disk;
+        }
     }
-  else if (strcmp (fs_id, toplevel_fs_id) != 0)
+
+  /* and a shared extent for the first file using it */
+  for (n = 0; folder->extents != NULL && n < folder->extents->len; n++)
     {
-      /* release the file info */
-      g_object_unref (info);
+      shared = &g_array_index (folder->extents, ThunarDeepCountShared, n);
+      if (thunar_deep_count_sets_add (walk->extents, shared->device, shared->key))
+        size_on_disk += shared->size_on_disk;
+    }
 
-      /* other filesystem, continue */
-      return TRUE;
+  if (walk->total_size_on_disk != (guint64) -1)
+    {
+      if (folder->size_on_disk_known)
+        walk->total_size_on_disk += size_on_disk;
+      else
+        walk->total_size_on_disk = (guint64) -1;
     }
+}
+
+
+
+static gchar *
+thunar_deep_count_cache_key (GFile              *file,
+                             GFileQueryInfoFlags flags)
+{
+  gchar *uri;
+  gchar *key;
+
+  /* following symlinks gives other contents for the same folder */
+  uri = g_file_get_uri (file);
+  key = g_strdup_printf ("%d:%s", (gint) flags, uri);
+  g_free (uri);
 
-  /* recurse if we have a directory */
-  if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
+  return key;
+}
+
+
+
+static guint64
+thunar_deep_count_get_mtime (GFileInfo *info)
+{
+  return g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) * G_USEC_PER_SEC
+         + g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+}
+
+
+
+/* returns a copy of the cached folder @key if it is still up to date */
+static ThunarDeepCountFolder *
+thunar_deep_count_cache_lookup (const gchar *key,
+                                guint64      mtime)
+{
+  ThunarDeepCountFolder *folder;
+  ThunarDeepCountFolder *result = NULL;
+
+  G_LOCK (deep_count_cache);
+  if (deep_count_cache != NULL)
     {
-      /* try to read from the directory */
-      enumerator = g_file_enumerate_children (file,
-                                              DEEP_COUNT_FILE_INFO_NAMESPACE ","
-                                              G_FILE_ATTRIBUTE_STANDARD_NAME,
-                                              count_job->query_flags,
-                                              exo_job_get_cancellable (job),
-                                              error);
-
-      if (!exo_job_is_cancelled (job))
+      folder = g_hash_table_lookup (deep_count_cache, key);
+      if (folder != NULL
+          && folder->mtime == mtime
+          && g_get_monotonic_time () - folder->cached_at < DEEP_COUNT_CACHE_MAX_AGE)
         {
-          if (enumerator == NULL)
-            {
-              /* directory was unreadable */
-              count_job->unreadable_directory_count++;
-
-              if (toplevel_file
-                  && g_list_length (count_job->files) < 2)
-                {
-                  /* we only bail out if the job file is unreadable */
-                  success = FALSE;
-                }
-              else
-                {
-                  /* ignore errors from files other than the job file */
-                  g_clear_error (error);
-                }
-            }
-          else
-            {
-              /* directory was readable */
-              count_job->directory_count++;
-
-              while (!exo_job_is_cancelled (job))
-                {
-                  /* query next child info */
-                  child_info = g_file_enumerator_next_file (enumerator,
-                                                            exo_job_get_cancellable (job),
-                                                            error);
-
-                  /* abort on invalid child info (iteration ends) or cancellation */
-                  if (child_info == NULL)
-                    break;
-
-                  if (!exo_job_is_cancelled (job))
-                    {
-                      /* generate a GFile for the child */
-                      child = g_file_resolve_relative_path (file, g_file_info_get_name (child_info));
-
-                      /* recurse unless the job was cancelled before */
-                      thunar_deep_count_job_process (job, child, child_info, toplevel_fs_id, error);
-
-                      /* free resources */
-                      g_object_unref (child);
-                    }
-
-                  g_object_unref (child_info);
-                }
-            }
+          result = thunar_deep_count_folder_copy (folder);
         }
+    }
+  G_UNLOCK (deep_count_cache);
+
+  return result;
+}
+
+
+
+/* takes over @folder */
+static void
+thunar_deep_count_cache_insert (gchar                 *key,
+                                ThunarDeepCountFolder *folder)
+{
+  G_LOCK (deep_count_cache);
+  if (G_UNLIKELY (deep_count_cache == NULL))
+    deep_count_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, thunar_deep_count_folder_free);
 
-      /* destroy the enumerator */
-      if (enumerator != NULL)
-        g_object_unref (enumerator);
+  /* start over instead of tracking the least recently used folders */
+  if (g_hash_table_size (deep_count_cache) >= DEEP_COUNT_CACHE_MAX_FOLDERS)
+    g_hash_table_remove_all (deep_count_cache);
 
-      /* emit status update whenever we've finished a directory,
-       * but not more than four times per second */
-      real_time = g_get_real_time ();
-      if (real_time >= count_job->last_time)
+  folder->cached_at = g_get_monotonic_time ();
+  g_hash_table_replace (deep_count_cache, key, folder);
+  G_UNLOCK (deep_count_cache);
+}
+
+
+
+/* queues the folder @file for the pool, the walk mutex must be held */
+static void
+thunar_deep_count_walk_push (ThunarDeepCountWalk *walk,
+                             GFile               *file,
+                             GFileInfo           *info,
+                             GQuark               toplevel_fs_id,
+                             gboolean             toplevel_file,
+                             gboolean             count_extents)
+{
+  ThunarDeepCountTask *task;
+
+  task = g_slice_new0 (ThunarDeepCountTask);
+  task->file = g_object_ref (file);
+  task->info = (info != NULL) ? g_object_ref (info) : NULL;
+  task->toplevel_fs_id = toplevel_fs_id;
+  task->toplevel_file = toplevel_file;
+  task->count_extents = count_extents;
+
+  walk->n_pending++;
+  g_thread_pool_push (walk->pool, task, NULL);
+}
+
+
+
+/* reads the children of @task's folder, using the cache while the folder is unchanged */
+static ThunarDeepCountFolder *
+thunar_deep_count_walk_folder (ThunarDeepCountWalk *walk,
+                               ThunarDeepCountTask *task,
+                               GSList             **folders,
+                               GError             **error)
+{
+  ThunarDeepCountJob    *job = walk->job;
+  ThunarDeepCountFolder *folder;
+  GFileEnumerator       *enumerator;
+  GCancellable          *cancellable = exo_job_get_cancellable (EXO_JOB (job));
+  GFileInfo             *child_info;
+  GPtrArray             *names;
+  const gchar           *fs_id;
+  GError                *err = NULL;
+  GFile                 *child;
+  guint64                mtime;
+  gchar                 *key;
+  guint                  n;
+
+  /* the shared extents are not remembered, they need the files anyway */
+  mtime = task->count_extents ? 0 : thunar_deep_count_get_mtime (task->info);
+  key = thunar_deep_count_cache_key (task->file, job->query_flags);
+
+  /* only the subfolders of an unchanged folder are walked again */
+  folder = (mtime != 0) ? thunar_deep_count_cache_lookup (key, mtime) : NULL;
+  if (folder != NULL)
+    {
+      for (n = 0; folder->folder_names[n] != NULL; n++)
+        *folders = g_slist_prepend (*folders, g_file_get_child (task->file, folder->folder_names[n]));
+      g_free (key);
+      return folder;
+    }
+
+  enumerator = g_file_enumerate_children (task->file,
+                                          DEEP_COUNT_FILE_INFO_NAMESPACE ","
+                                          G_FILE_ATTRIBUTE_STANDARD_NAME,
+                                          job->query_flags,
+                                          cancellable,
+                                          error);
+  if (enumerator == NULL)
+    {
+      g_free (key);
+      return NULL;
+    }
+
+  folder = thunar_deep_count_folder_new ();
+  folder->mtime = mtime;
+  names = g_ptr_array_new ();
+
+  while (!g_cancellable_is_cancelled (cancellable)
+         && (child_info = g_file_enumerator_next_file (enumerator, cancellable, &err)) != NULL)
+    {
+      /* only count files on the same filesystem so no remote mounts or
+       * dummy filesystems are counted */
+      fs_id = g_file_info_get_attribute_string (child_info, G_FILE_ATTRIBUTE_ID_FILESYSTEM);
+      if (g_quark_try_string (fs_id != NULL ? fs_id : "") != task->toplevel_fs_id)
+        {
+          g_object_unref (child_info);
+          continue;
+        }
+
+      if (g_file_info_get_file_type (child_info) == G_FILE_TYPE_DIRECTORY)
+        {
+          /* the info of the enumerator saves a query in the pool */
+          g_ptr_array_add (names, g_strdup (g_file_info_get_name (child_info)));
+          *folders = g_slist_prepend (*folders, g_object_ref (child_info));
+        }
+      else if (task->count_extents)
+        {
+          child = g_file_get_child (task->file, g_file_info_get_name (child_info));
+          thunar_deep_count_folder_add_file (folder, child, child_info, TRUE);
+          g_object_unref (child);
+        }
+      else
         {
-          if (count_job->last_time != 0)
-            thunar_deep_count_job_status_update (count_job);
-          count_job->last_time = real_time + (G_USEC_PER_SEC / 4);
+          /* we have a regular file or at least not a directory */
+          thunar_deep_count_folder_add_file (folder, NULL, child_info, FALSE);
         }
+
+      g_object_unref (child_info);
     }
-  else
+
+  g_object_unref (enumerator);
+  g_ptr_array_add (names, NULL);
+  folder->folder_names = (gchar **) g_ptr_array_free (names, FALSE);
+
+  /* remember complete listings only, a failing child does not make
+   * the folder unreadable, as before */
+  if (err == NULL && mtime != 0 && !g_cancellable_is_cancelled (cancellable))
     {
-      /* we have a regular file or at least not a directory */
-      count_job->file_count++;
+      thunar_deep_count_cache_insert (key, thunar_deep_count_folder_copy (folder));
+      key = NULL;
+    }
+
+  g_clear_error (&err);
+  g_free (key);
+
+  return folder;
+}
+
+
+
+static void
+thunar_deep_count_walk_worker (gpointer data,
+                               gpointer user_data)
+{
+  ThunarDeepCountWalk   *walk = user_data;
+  ThunarDeepCountTask   *task = data;
+  ThunarDeepCountFolder *folder = NULL;
+  GFileInfo             *child_info;
+  GError                *err = NULL;
+  GSList                *folders = NULL;
+  GSList                *lp;
+  GFile                 *child;
+
+  /* bulk counts wait while files are copied */
+  thunar_job_yield (THUNAR_JOB (walk->job));
+
+  if (!exo_job_is_cancelled (EXO_JOB (walk->job)))
+    {
+      /* folders restored from the cache come without info */
+      if (task->info == NULL)
+        task->info = g_file_query_info (task->file,
+                                        DEEP_COUNT_FILE_INFO_NAMESPACE,
+                                        walk->job->query_flags,
+                                        exo_job_get_cancellable (EXO_JOB (walk->job)),
+                                        &err);
+
+      if (task->info != NULL)
+        folder = thunar_deep_count_walk_folder (walk, task, &folders, &err);
+    }
 
-      /* add size of the file to the total size */
-      count_job->total_size += g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_SIZE);
+  g_mutex_lock (&walk->mutex);
 
-      /* add allocated size of the file to the total allocated size */
-      if (count_job->total_size_on_disk != (guint64)-1)
+  if (folder != NULL)
+    {
+      /* directory was readable */
+      walk->directory_count++;
+      thunar_deep_count_walk_merge (walk, folder);
+
+      for (lp = folders; lp != NULL; lp = lp->next)
         {
-          if (g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_STANDARD_ALLOCATED_SIZE))
-            count_job->total_size_on_disk += g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_ALLOCATED_SIZE);
+          if (G_IS_FILE_INFO (lp->data))
+            {
+              child_info = lp->data;
+              child = g_file_get_child (task->file, g_file_info_get_name (child_info));
+              thunar_deep_count_walk_push (walk, child, child_info, task->toplevel_fs_id, FALSE, task->count_extents);
+              g_object_unref (child);
+            }
           else
-            count_job->total_size_on_disk = (guint64)-1;
+            {
+              thunar_deep_count_walk_push (walk, lp->data, NULL, task->toplevel_fs_id, FALSE, task->count_extents);
+            }
         }
+
+      thunar_deep_count_folder_free (folder);
+    }
+  else if (!exo_job_is_cancelled (EXO_JOB (walk->job)))
+    {
+      /* directory was unreadable */
+      walk->unreadable_directory_count++;
+
+      /* we only bail out if the job file is unreadable */
+      if (task->toplevel_file
+          && g_list_length (walk->job->files) < 2
+          && walk->error == NULL)
+        walk->error = g_steal_pointer (&err);
     }
 
-  /* destroy the file info */
-  g_object_unref (info);
+  if (--walk->n_pending == 0)
+    g_cond_signal (&walk->cond);
+  g_mutex_unlock (&walk->mutex);
 
-  /* we've succeeded if there was no error when loading information
-   * about the job file itself and the job was not cancelled */
-  return !exo_job_is_cancelled (job) && success;
+  g_slist_free_full (folders, g_object_unref);
+  g_clear_error (&err);
+
+  g_object_unref (task->file);
+  if (task->info != NULL)
+    g_object_unref (task->info);
+  g_slice_free (ThunarDeepCountTask, task);
+}
+
+
+
+static void
+thunar_deep_count_walk_status_update (ThunarDeepCountWalk *walk)
+{
+  ThunarDeepCountJob *job = walk->job;
+
+  /* take over the counts so far, the walk mutex must be held */
+  job->total_size = walk->total_size;
+  job->total_size_on_disk = walk->total_size_on_disk;
+  job->file_count = walk->file_count;
+  job->directory_count = walk->directory_count;
+  job->unreadable_directory_count = walk->unreadable_directory_count;
+}
+
+
+
+/* whether @file is on a filesystem where files can share extents */
+static gboolean
+thunar_deep_count_job_has_shared_extents (ThunarDeepCountJob *job,
+                                          GFile              *file)
+{
+#ifdef DEEP_COUNT_HAVE_FIEMAP
+  GFileInfo   *info;
+  const gchar *fs_type;
+  gboolean     result = FALSE;
+
+  if (!job->shared_extents || !g_file_is_native (file))
+    return FALSE;
+
+  info = g_file_query_filesystem_info (file, G_FILE_ATTRIBUTE_FILESYSTEM_TYPE,
+                                       exo_job_get_cancellable (EXO_JOB (job)), NULL);
+  if (info != NULL)
+    {
+      /* asking the other filesystems for their extents is only slower */
+      fs_type = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_FILESYSTEM_TYPE);
+      result = (g_strcmp0 (fs_type, "btrfs") == 0
+                || g_strcmp0 (fs_type, "xfs") == 0
+                || g_strcmp0 (fs_type, "bcachefs") == 0
+                || g_strcmp0 (fs_type, "ocfs2") == 0);
+      g_object_unref (info);
+    }
+
+  return result;
+#else
+  return FALSE;
+#endif
 }
 
 
@@ -355,11 +991,17 @@ static gboolean
 thunar_deep_count_job_execute (ExoJob  *job,
                                GError **error)
 {
-  ThunarDeepCountJob *count_job = THUNAR_DEEP_COUNT_JOB (job);
-  gboolean            success = TRUE;
-  GError             *err = NULL;
-  GList              *lp;
-  GFile              *gfile;
+  ThunarDeepCountJob    *count_job = THUNAR_DEEP_COUNT_JOB (job);
+  ThunarDeepCountWalk    walk = { 0, };
+  ThunarDeepCountFolder *files;
+  GFileInfo             *info;
+  const gchar           *fs_id;
+  GError                *err = NULL;
+  GList                 *lp;
+  GFile                 *gfile;
+  gboolean               count_extents;
+  gint64                 next_update;
+  gint64                 now;
 
   _thunar_return_val_if_fail (THUNAR_IS_JOB (job), FALSE);
   _thunar_return_val_if_fail (error == NULL || *error == NULL, FALSE);
@@ -368,47 +1010,102 @@ thunar_deep_count_job_execute (ExoJob  *job,
   if (exo_job_set_error_if_cancelled (job, error))
     return FALSE;
 
-  /* reset counters */
-  count_job->total_size = 0;
-  count_job->total_size_on_disk = 0;
-  count_job->file_count = 0;
-  count_job->directory_count = 0;
-  count_job->unreadable_directory_count = 0;
-  count_job->last_time = 0;
+  /* the job thread hands folders to the pool and reports the progress */
+  walk.job = count_job;
+  walk.pool = g_thread_pool_new (thunar_deep_count_walk_worker, &walk,
+                                 DEEP_COUNT_THREADS, FALSE, NULL);
+  g_mutex_init (&walk.mutex);
+  g_cond_init (&walk.cond);
+  walk.inodes = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, thunar_deep_count_keys_free);
+  walk.extents = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, thunar_deep_count_keys_free);
+
+  g_mutex_lock (&walk.mutex);
 
   /* count files, directories and compute size of the job files */
-  for (lp = count_job->files; lp != NULL; lp = lp->next)
+  for (lp = count_job->files; lp != NULL && err == NULL; lp = lp->next)
     {
       gfile = thunar_file_get_file (THUNAR_FILE (lp->data));
-      success = thunar_deep_count_job_process (job, gfile, NULL, NULL, &err);
-      if (G_UNLIKELY (!success))
-        break;
-    }
 
-  if (!success)
-    {
-      g_assert (err != NULL || exo_job_is_cancelled (job));
+      /* query size and type of the toplevel file */
+      g_mutex_unlock (&walk.mutex);
+      info = g_file_query_info (gfile,
+                                DEEP_COUNT_FILE_INFO_NAMESPACE,
+                                count_job->query_flags,
+                                exo_job_get_cancellable (job),
+                                &err);
+      count_extents = (info != NULL && thunar_deep_count_job_has_shared_extents (count_job, gfile));
+      g_mutex_lock (&walk.mutex);
+
+      if (info == NULL)
+        break;
 
-      /* set error if the job was cancelled. otherwise just propagate
-       * the results of the processing function */
-      if (exo_job_set_error_if_cancelled (job, error))
+      if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
         {
-          if (err != NULL)
-            g_error_free (err);
+          /* the toplevel sets the filesystem to stay on */
+          fs_id = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILESYSTEM);
+          thunar_deep_count_walk_push (&walk, gfile, info, g_quark_from_string (fs_id != NULL ? fs_id : ""), TRUE, count_extents);
         }
       else
         {
-          if (err != NULL)
-            g_propagate_error (error, err);
+          /* hard links among the job files count once as well */
+          files = thunar_deep_count_folder_new ();
+          thunar_deep_count_folder_add_file (files, gfile, info, count_extents);
+          thunar_deep_count_walk_merge (&walk, files);
+          thunar_deep_count_folder_free (files);
+        }
+
+      g_object_unref (info);
+    }
+
+  /* wait for the pool, emitting status updates not more than four times per second */
+  next_update = g_get_monotonic_time () + DEEP_COUNT_STATUS_INTERVAL;
+  while (walk.n_pending > 0)
+    {
+      if (!g_cond_wait_until (&walk.cond, &walk.mutex, next_update))
+        {
+          now = g_get_monotonic_time ();
+          if (now >= next_update && !exo_job_is_cancelled (job))
+            {
+              thunar_deep_count_walk_status_update (&walk);
+              g_mutex_unlock (&walk.mutex);
+              thunar_deep_count_job_status_update (count_job);
+              g_mutex_lock (&walk.mutex);
+            }
+          next_update = g_get_monotonic_time () + DEEP_COUNT_STATUS_INTERVAL;
         }
     }
-  else if (!exo_job_is_cancelled (job))
+
+  thunar_deep_count_walk_status_update (&walk);
+  if (err == NULL)
+    err = g_steal_pointer (&walk.error);
+  g_clear_error (&walk.error);
+
+  g_mutex_unlock (&walk.mutex);
+
+  g_thread_pool_free (walk.pool, FALSE, TRUE);
+  g_mutex_clear (&walk.mutex);
+  g_cond_clear (&walk.cond);
+  g_hash_table_destroy (walk.inodes);
+  g_hash_table_destroy (walk.extents);
+
+  /* set error if the job was cancelled. otherwise just propagate
+   * the results of the processing function */
+  if (exo_job_set_error_if_cancelled (job, error))
+    {
+      g_clear_error (&err);
+      return FALSE;
+    }
+
+  if (err != NULL)
     {
-      /* emit final status update at the very end of the computation */
-      thunar_deep_count_job_status_update (count_job);
+      g_propagate_error (error, err);
+      return FALSE;
     }
 
-  return success;
+  /* emit final status update at the very end of the computation */
+  thunar_deep_count_job_status_update (count_job);
+
+  return TRUE;
 }
 
 
@@ -429,3 +1126,250 @@ thunar_deep_count_job_new (GList               *files,
 
   return job;
 }
+
+
+
+/* removes @job from the shared jobs, returns %FALSE if it was not there */
+static gboolean
+thunar_deep_count_job_unregister (ThunarDeepCountJob *job)
+{
+  gboolean registered = FALSE;
+
+  if (job->shared_key == NULL)
+    return FALSE;
+
+  /* a restarted count may have taken over the key already */
+  if (deep_count_shared_jobs != NULL
+      && g_hash_table_lookup (deep_count_shared_jobs, job->shared_key) == job)
+    {
+      g_hash_table_remove (deep_count_shared_jobs, job->shared_key);
+      registered = TRUE;
+    }
+
+  g_free (job->shared_key);
+  job->shared_key = NULL;
+
+  return registered;
+}
+
+
+
+static void
+thunar_deep_count_job_shared_finished (ExoJob   *job,
+                                       gpointer  user_data)
+{
+  /* later requests have to count again */
+  thunar_deep_count_job_unregister (THUNAR_DEEP_COUNT_JOB (job));
+}
+
+
+
+static gboolean
+thunar_deep_count_job_shared_launch (gpointer user_data)
+{
+  ThunarDeepCountJob *job = THUNAR_DEEP_COUNT_JOB (user_data);
+
+  job->launch_id = 0;
+  job->launched = TRUE;
+
+  exo_job_launch (EXO_JOB (job));
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+static gint
+thunar_deep_count_job_compare_uris (gconstpointer a,
+                                    gconstpointer b)
+{
+  return g_strcmp0 (*(const gchar **) a, *(const gchar **) b);
+}
+
+
+
+/* the roots as a set, with everything else that changes the result */
+static gchar *
+thunar_deep_count_job_shared_key (GList               *files,
+                                  GFileQueryInfoFlags  flags,
+                                  gboolean             shared_extents)
+{
+  GPtrArray *uris;
+  GString   *key;
+  GList     *lp;
+  guint      n;
+
+  uris = g_ptr_array_new_with_free_func (g_free);
+  for (lp = files; lp != NULL; lp = lp->next)
+    g_ptr_array_add (uris, g_file_get_uri (thunar_file_get_file (THUNAR_FILE (lp->data))));
+  g_ptr_array_sort (uris, thunar_deep_count_job_compare_uris);
+
+  key = g_string_new (NULL);
+  g_string_append_printf (key, "%u:%d", (guint) flags, shared_extents ? 1 : 0);
+  for (n = 0; n < uris->len; n++)
+    {
+      g_string_append_c (key, '\n');
+      g_string_append (key, g_ptr_array_index (uris, n));
+    }
+
+  g_ptr_array_unref (uris);
+
+  return g_string_free (key, FALSE);
+}
+
+
+
+/**
+ * thunar_deep_count_job_get_shared:
+ * @files          : the #ThunarFile<!---->s to count.
+ * @flags          : the #GFileQueryInfoFlags for the walk.
+ * @shared_extents : see thunar_deep_count_job_set_shared_extents().
+ * @restart        : whether a job that started walking already may be reused.
+ *
+ * Subscribes to the deep count of @files, sharing one job between all
+ * requesters of the same set of roots while it runs. The job is launched
+ * from an idle source, so the caller can connect to its signals first,
+ * but a job joined late may have reported already, see
+ * thunar_deep_count_job_get_status().
+ *
+ * Pass %TRUE for @restart if the @files changed since a running job may
+ * have started, a job that did not start walking yet is reused then.
+ *
+ * The subscription must be dropped with thunar_deep_count_job_release(),
+ * not with g_object_unref() or exo_job_cancel().
+ *
+ * Return value: the #ThunarDeepCountJob counting @files.
+ **/
+ThunarDeepCountJob *
+thunar_deep_count_job_get_shared (GList               *files,
+                                  GFileQueryInfoFlags  flags,
+                                  gboolean             shared_extents,
+                                  gboolean             restart)
+{
+  ThunarDeepCountJob *job;
+  gchar              *key;
+
+  _thunar_return_val_if_fail (files != NULL, NULL);
+
+  if (G_UNLIKELY (deep_count_shared_jobs == NULL))
+    deep_count_shared_jobs = g_hash_table_new (g_str_hash, g_str_equal);
+
+  key = thunar_deep_count_job_shared_key (files, flags, shared_extents);
+
+  job = g_hash_table_lookup (deep_count_shared_jobs, key);
+  if (job != NULL && (!restart || !job->launched))
+    {
+      g_free (key);
+      job->n_subscribers++;
+      return g_object_ref (job);
+    }
+
+  /* the running job keeps its subscribers, but is not handed out anymore */
+  if (job != NULL)
+    thunar_deep_count_job_unregister (job);
+
+  job = thunar_deep_count_job_new (files, flags);
+  thunar_deep_count_job_set_shared_extents (job, shared_extents);
+  job->shared_key = key;
+  job->n_subscribers = 1;
+  g_hash_table_insert (deep_count_shared_jobs, job->shared_key, job);
+
+  /* connected before any subscriber, so the job is gone from the
+   * registry when they learn that it finished */
+  g_signal_connect (job, "finished", G_CALLBACK (thunar_deep_count_job_shared_finished), NULL);
+
+  job->launch_id = g_idle_add (thunar_deep_count_job_shared_launch, job);
+
+  return job;
+}
+
+
+
+/**
+ * thunar_deep_count_job_release:
+ * @job : a #ThunarDeepCountJob from thunar_deep_count_job_get_shared().
+ *
+ * Drops a subscription to @job and the reference that came with it. The
+ * count is cancelled when the last subscriber of a running job leaves.
+ **/
+void
+thunar_deep_count_job_release (ThunarDeepCountJob *job)
+{
+  _thunar_return_if_fail (THUNAR_IS_DEEP_COUNT_JOB (job));
+  _thunar_return_if_fail (job->n_subscribers > 0);
+
+  if (--job->n_subscribers == 0)
+    {
+      if (job->launch_id != 0)
+        {
+          g_source_remove (job->launch_id);
+          job->launch_id = 0;
+        }
+
+      /* replaced jobs are cancelled too, nobody can join them anymore */
+      thunar_deep_count_job_unregister (job);
+      if (job->launched)
+        exo_job_cancel (EXO_JOB (job));
+    }
+
+  g_object_unref (job);
+}
+
+
+
+/**
+ * thunar_deep_count_job_get_status:
+ * @job                        : a #ThunarDeepCountJob.
+ * @total_size                 : return location for the total size in bytes.
+ * @total_size_on_disk         : return location for the total allocated size in bytes.
+ * @file_count                 : return location for the number of files.
+ * @directory_count            : return location for the number of directories.
+ * @unreadable_directory_count : return location for the number of unreadable directories.
+ *
+ * Looks up the last "status-update" of @job, for subscribers that
+ * joined a running job. Must be called from the main thread.
+ *
+ * Return value: %FALSE if the @job did not report anything yet.
+ **/
+gboolean
+thunar_deep_count_job_get_status (ThunarDeepCountJob *job,
+                                  guint64            *total_size,
+                                  guint64            *total_size_on_disk,
+                                  guint              *file_count,
+                                  guint              *directory_count,
+                                  guint              *unreadable_directory_count)
+{
+  _thunar_return_val_if_fail (THUNAR_IS_DEEP_COUNT_JOB (job), FALSE);
+
+  if (!job->has_reported)
+    return FALSE;
+
+  *total_size = job->reported_total_size;
+  *total_size_on_disk = job->reported_total_size_on_disk;
+  *file_count = job->reported_file_count;
+  *directory_count = job->reported_directory_count;
+  *unreadable_directory_count = job->reported_unreadable_directory_count;
+
+  return TRUE;
+}
+
+
+
+/**
+ * thunar_deep_count_job_set_shared_extents:
+ * @job            : a #ThunarDeepCountJob.
+ * @shared_extents : whether to count shared data blocks once.
+ *
+ * If @shared_extents is %TRUE, the size on disk counts the data blocks
+ * shared by reflinked files once, on the filesystems supporting that.
+ * Hard linked files are counted once in any case. Must be called before
+ * the @job is launched.
+ **/
+void
+thunar_deep_count_job_set_shared_extents (ThunarDeepCountJob *job,
+                                          gboolean            shared_extents)
+{
+  _thunar_return_if_fail (THUNAR_IS_DEEP_COUNT_JOB (job));
+
+  job->shared_extents = shared_extents;
+}
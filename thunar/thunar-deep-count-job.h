@@ -42,6 +42,20 @@ GType               thunar_deep_count_job_get_type (void) G_GNUC_CONST;
 
 ThunarDeepCountJob *thunar_deep_count_job_new      (GList              *files,
                                                     GFileQueryInfoFlags flags) G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
+void                thunar_deep_count_job_set_shared_extents (ThunarDeepCountJob *job,
+                                                              gboolean            shared_extents);
+
+ThunarDeepCountJob *thunar_deep_count_job_get_shared (GList              *files,
+                                                      GFileQueryInfoFlags flags,
+                                                      gboolean            shared_extents,
+                                                      gboolean            restart) G_GNUC_WARN_UNUSED_RESULT;
+void                thunar_deep_count_job_release    (ThunarDeepCountJob *job);
+gboolean            thunar_deep_count_job_get_status (ThunarDeepCountJob *job,
+                                                      guint64            *total_size,
+                                                      guint64            *total_size_on_disk,
+                                                      guint              *file_count,
+                                                      guint              *directory_count,
+                                                      guint              *unreadable_directory_count);
 
 G_END_DECLS;
 
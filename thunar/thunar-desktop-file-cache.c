@@ -0,0 +1,324 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The desktop file cache keeps the parsed .desktop files together with
+ * the checksum of their contents, so the display name, the trust check
+ * and the execution of a launcher read and checksum the file once per
+ * change instead of once per use. An entry is valid as long as the
+ * modification time, the size and the inode of the file are the same.
+ * The checksum is compared with the one the file was trusted with on
+ * every lookup, so trusting a launcher takes effect right away. The
+ * cache may be used from any thread. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "thunar/thunar-cache-registry.h"
+#include "thunar/thunar-desktop-file-cache.h"
+#include "thunar/thunar-private.h"
+
+
+
+/* the attribute libxfce4ui keeps the checksum of trusted launchers in,
+ * see xfce_g_file_set_trusted() */
+#define THUNAR_DESKTOP_FILE_CACHE_CHECKSUM "metadata::xfce-exe-checksum"
+
+/* the attributes telling whether an entry is still valid, and the checksum */
+#define THUNAR_DESKTOP_FILE_CACHE_ATTRIBUTES \
+  G_FILE_ATTRIBUTE_STANDARD_SIZE "," \
+  G_FILE_ATTRIBUTE_TIME_MODIFIED "," \
+  G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC "," \
+  G_FILE_ATTRIBUTE_UNIX_INODE "," \
+  THUNAR_DESKTOP_FILE_CACHE_CHECKSUM
+
+/* the cache starts over beyond this number of files */
+#define THUNAR_DESKTOP_FILE_CACHE_MAX_ENTRIES (1024)
+
+
+
+typedef struct
+{
+  guint64 mtime;
+  guint32 mtime_usec;
+  guint64 size;
+  guint64 inode;
+}
+ThunarDesktopFileStamp;
+
+typedef struct
+{
+  ThunarDesktopFileStamp  stamp;
+  GKeyFile               *key_file;
+  gchar                  *checksum; /* SHA256 of the contents */
+  gsize                   length;   /* of the contents */
+}
+ThunarDesktopFileEntry;
+
+
+
+static GMutex      desktop_mutex;
+
+/* GFile -> ThunarDesktopFileEntry */
+static GHashTable *desktop_entries = NULL;
+
+
+
+static void
+thunar_desktop_file_entry_free (gpointer data)
+{
+  ThunarDesktopFileEntry *entry = data;
+
+  g_key_file_unref (entry->key_file);
+  g_free (entry->checksum);
+  g_slice_free (ThunarDesktopFileEntry, entry);
+}
+
+
+
+static gsize
+thunar_desktop_file_cache_size (gpointer user_data)
+{
+  ThunarDesktopFileEntry *entry;
+  GHashTableIter          iter;
+  gsize                   n_bytes = 0;
+
+  g_mutex_lock (&desktop_mutex);
+
+  /* the parsed key file takes about twice the size of the contents */
+  if (desktop_entries != NULL)
+    {
+      g_hash_table_iter_init (&iter, desktop_entries);
+      while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry))
+        n_bytes += sizeof (ThunarDesktopFileEntry) + 2 * entry->length;
+    }
+
+  g_mutex_unlock (&desktop_mutex);
+
+  return n_bytes;
+}
+
+
+
+static void
+thunar_desktop_file_cache_shed (gpointer                   user_data,
+                                GMemoryMonitorWarningLevel level)
+{
+  g_mutex_lock (&desktop_mutex);
+  if (desktop_entries != NULL)
+    g_hash_table_remove_all (desktop_entries);
+  g_mutex_unlock (&desktop_mutex);
+}
+
+
+
+/**
+ * thunar_desktop_file_cache_init:
+ *
+ * Registers the cache with the cache registry, to be called once
+ * from the main thread before the cache is used.
+ **/
+void
+thunar_desktop_file_cache_init (void)
+{
+  static gboolean registered = FALSE;
+
+  if (G_LIKELY (registered))
+    return;
+
+  /* the launchers are cheap to read again */
+  thunar_cache_registry_add ("desktop files", G_MEMORY_MONITOR_WARNING_LEVEL_LOW,
+                             thunar_desktop_file_cache_size, thunar_desktop_file_cache_shed, NULL);
+  registered = TRUE;
+}
+
+
+
+static gboolean
+thunar_desktop_file_stamp_equal (const ThunarDesktopFileStamp *a,
+                                 const ThunarDesktopFileStamp *b)
+{
+  return a->mtime == b->mtime
+      && a->mtime_usec == b->mtime_usec
+      && a->size == b->size
+      && a->inode == b->inode;
+}
+
+
+
+static ThunarDesktopFileEntry *
+thunar_desktop_file_cache_load (GFile                        *file,
+                                const ThunarDesktopFileStamp *stamp,
+                                GCancellable                 *cancellable,
+                                GError                      **error)
+{
+  ThunarDesktopFileEntry *entry;
+  GKeyFile               *key_file;
+  gchar                  *contents = NULL;
+  gsize                   length;
+
+  /* try to load the entire file into memory */
+  if (!g_file_load_contents (file, cancellable, &contents, &length, NULL, error))
+    return NULL;
+
+  /* like thunar_g_file_query_key_file(), an empty file is an empty key file */
+  key_file = g_key_file_new ();
+  if (length != 0
+      && !g_key_file_load_from_data (key_file, contents, length,
+                                     G_KEY_FILE_KEEP_COMMENTS | G_KEY_FILE_KEEP_TRANSLATIONS,
+                                     error))
+    {
+      g_key_file_unref (key_file);
+      g_free (contents);
+      return NULL;
+    }
+
+  entry = g_slice_new (ThunarDesktopFileEntry);
+  entry->stamp = *stamp;
+  entry->key_file = key_file;
+  entry->checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA256, (const guchar *) contents, length);
+  entry->length = length;
+
+  g_free (contents);
+
+  return entry;
+}
+
+
+
+/**
+ * thunar_desktop_file_cache_get_key_file:
+ * @file        : the #GFile of a .desktop file.
+ * @is_trusted  : return location for whether the user trusts the
+ *                launcher, as xfce_g_file_is_trusted() tells, or %NULL.
+ * @cancellable : a #GCancellable or %NULL.
+ * @error       : return location for errors or %NULL.
+ *
+ * Returns the parsed contents of @file, which are read only once
+ * per change of the file. The returned key file is shared and must
+ * not be modified.
+ *
+ * The caller is responsible to free the returned key file using
+ * g_key_file_unref() when no longer needed.
+ *
+ * Return value: (transfer full): the #GKeyFile of @file or %NULL on error.
+ **/
+GKeyFile *
+thunar_desktop_file_cache_get_key_file (GFile         *file,
+                                        gboolean      *is_trusted,
+                                        GCancellable  *cancellable,
+                                        GError       **error)
+{
+  ThunarDesktopFileStamp  stamp;
+  ThunarDesktopFileEntry *entry;
+  const gchar            *trusted_checksum;
+  GFileInfo              *info;
+  GKeyFile               *key_file = NULL;
+  gchar                  *checksum = NULL;
+
+  _thunar_return_val_if_fail (G_IS_FILE (file), NULL);
+  _thunar_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
+  _thunar_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  if (is_trusted != NULL)
+    *is_trusted = FALSE;
+
+  /* a stat is much cheaper than reading and checksumming the file */
+  info = g_file_query_info (file, THUNAR_DESKTOP_FILE_CACHE_ATTRIBUTES, G_FILE_QUERY_INFO_NONE, cancellable, error);
+  if (G_UNLIKELY (info == NULL))
+    return NULL;
+
+  stamp.mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+  stamp.mtime_usec = g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC);
+  stamp.size = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_SIZE);
+  stamp.inode = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_UNIX_INODE);
+
+  g_mutex_lock (&desktop_mutex);
+  if (desktop_entries != NULL)
+    {
+      entry = g_hash_table_lookup (desktop_entries, file);
+      if (entry != NULL && thunar_desktop_file_stamp_equal (&entry->stamp, &stamp))
+        {
+          key_file = g_key_file_ref (entry->key_file);
+          checksum = g_strdup (entry->checksum);
+        }
+    }
+  g_mutex_unlock (&desktop_mutex);
+
+  if (key_file == NULL)
+    {
+      /* read the file outside of the lock, other launchers may be looked up meanwhile */
+      entry = thunar_desktop_file_cache_load (file, &stamp, cancellable, error);
+      if (G_UNLIKELY (entry == NULL))
+        {
+          g_object_unref (info);
+          return NULL;
+        }
+
+      key_file = g_key_file_ref (entry->key_file);
+      checksum = g_strdup (entry->checksum);
+
+      g_mutex_lock (&desktop_mutex);
+      if (G_UNLIKELY (desktop_entries == NULL))
+        desktop_entries = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal, g_object_unref, thunar_desktop_file_entry_free);
+      else if (g_hash_table_size (desktop_entries) >= THUNAR_DESKTOP_FILE_CACHE_MAX_ENTRIES)
+        g_hash_table_remove_all (desktop_entries);
+      g_hash_table_replace (desktop_entries, g_object_ref (file), entry);
+      g_mutex_unlock (&desktop_mutex);
+    }
+
+  /* the launcher is trusted if its contents did not change since */
+  if (is_trusted != NULL)
+    {
+      trusted_checksum = g_file_info_get_attribute_string (info, THUNAR_DESKTOP_FILE_CACHE_CHECKSUM);
+      *is_trusted = (trusted_checksum != NULL && g_strcmp0 (checksum, trusted_checksum) == 0);
+    }
+
+  g_free (checksum);
+  g_object_unref (info);
+
+  return key_file;
+}
+
+
+
+/**
+ * thunar_desktop_file_cache_is_trusted:
+ * @file        : the #GFile of a .desktop file.
+ * @cancellable : a #GCancellable or %NULL.
+ *
+ * Cached version of xfce_g_file_is_trusted(), see
+ * thunar_desktop_file_cache_get_key_file().
+ *
+ * Return value: %TRUE if the user trusts the launcher @file.
+ **/
+gboolean
+thunar_desktop_file_cache_is_trusted (GFile        *file,
+                                      GCancellable *cancellable)
+{
+  GKeyFile *key_file;
+  gboolean  is_trusted;
+
+  _thunar_return_val_if_fail (G_IS_FILE (file), FALSE);
+
+  key_file = thunar_desktop_file_cache_get_key_file (file, &is_trusted, cancellable, NULL);
+  if (key_file == NULL)
+    return FALSE;
+
+  g_key_file_unref (key_file);
+
+  return is_trusted;
+}
@@ -0,0 +1,35 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __THUNAR_DESKTOP_FILE_CACHE_H__
+#define __THUNAR_DESKTOP_FILE_CACHE_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+void      thunar_desktop_file_cache_init         (void);
+
+GKeyFile *thunar_desktop_file_cache_get_key_file (GFile         *file,
+                                                  gboolean      *is_trusted,
+                                                  GCancellable  *cancellable,
+                                                  GError       **error);
+gboolean  thunar_desktop_file_cache_is_trusted   (GFile         *file,
+                                                  GCancellable  *cancellable);
+
+G_END_DECLS
+
+#endif /* !__THUNAR_DESKTOP_FILE_CACHE_H__ */
@@ -34,6 +34,20 @@
 
 
 
+/* time the pointer has to rest on a collapsed folder before it is loaded ahead */
+#define THUNAR_DETAILS_VIEW_PREFETCH_DELAY (400) /* in ms */
+
+/* the column widths are measured at most this often while rows are added or scrolled into view */
+#define THUNAR_DETAILS_VIEW_AUTOSIZE_DELAY (100) /* in ms */
+
+/* the number of rows measured across the whole folder, besides the visible ones */
+#define THUNAR_DETAILS_VIEW_AUTOSIZE_SAMPLES (64)
+
+/* the upper bound of visible rows measured, for very small fonts */
+#define THUNAR_DETAILS_VIEW_AUTOSIZE_MAX_VISIBLE (256)
+
+
+
 /* Property identifiers */
 enum
 {
@@ -102,6 +116,13 @@ static void         thunar_details_view_row_collapsed           (GtkTreeView
                                                                  GtkTreeIter            *iter,
                                                                  GtkTreePath            *path,
                                                                  ThunarDetailsView      *view);
+static gboolean     thunar_details_view_motion_notify_event     (GtkTreeView            *tree_view,
+                                                                 GdkEventMotion         *event,
+                                                                 ThunarDetailsView      *details_view);
+static gboolean     thunar_details_view_leave_notify_event      (GtkTreeView            *tree_view,
+                                                                 GdkEventCrossing       *event,
+                                                                 ThunarDetailsView      *details_view);
+static void         thunar_details_view_cancel_prefetch         (ThunarDetailsView      *details_view);
 static gboolean     thunar_details_view_select_cursor_row       (GtkTreeView            *tree_view,
                                                                  gboolean                editing,
                                                                  ThunarDetailsView      *details_view);
@@ -111,6 +132,16 @@ static void         thunar_details_view_row_changed             (GtkTreeView
                                                                  ThunarDetailsView      *details_view);
 static void         thunar_details_view_columns_changed         (ThunarColumnModel      *column_model,
                                                                  ThunarDetailsView      *details_view);
+static void         thunar_details_view_row_inserted            (GtkTreeModel           *model,
+                                                                 GtkTreePath            *path,
+                                                                 GtkTreeIter            *iter,
+                                                                 ThunarDetailsView      *details_view);
+static void         thunar_details_view_schedule_autosize       (ThunarDetailsView      *details_view,
+                                                                 gboolean                full,
+                                                                 gboolean                reset);
+static void         thunar_details_view_schedule_autosize_visible (ThunarDetailsView    *details_view);
+static void         thunar_details_view_schedule_autosize_reset (ThunarDetailsView      *details_view);
+static void         thunar_details_view_cancel_autosize         (ThunarDetailsView      *details_view);
 static void         thunar_details_view_zoom_level_changed      (ThunarDetailsView      *details_view);
 static gboolean     thunar_details_view_get_fixed_columns       (ThunarDetailsView      *details_view);
 static void         thunar_details_view_set_fixed_columns       (ThunarDetailsView      *details_view,
@@ -152,6 +183,13 @@ struct _ThunarDetailsView
   /* whether to use fixed column widths */
   gboolean           fixed_columns;
 
+  /* otherwise the widths are measured from a sample of the rows,
+   * see thunar_details_view_autosize_columns() */
+  gint               autosize_widths[THUNAR_N_VISIBLE_COLUMNS];
+  guint              autosize_timer_id;
+  gboolean           autosize_full;
+  gboolean           autosize_reset;
+
   /* whether the most recent item activation used a mouse button press */
   gboolean           button_pressed;
 
@@ -163,6 +201,10 @@ struct _ThunarDetailsView
   ExoTreeView       *tree_view;
 
   gboolean           expandable_folders;
+
+  /* the collapsed folder under the pointer, loaded ahead once the pointer rests on it */
+  GtkTreePath       *prefetch_path;
+  guint              prefetch_timer_id;
 };
 
 
@@ -276,6 +318,10 @@ thunar_details_view_init (ThunarDetailsView *details_view)
                     G_CALLBACK (thunar_details_view_row_expanded), details_view);
   g_signal_connect (G_OBJECT (details_view->tree_view), "row-collapsed",
                     G_CALLBACK (thunar_details_view_row_collapsed), details_view);
+  g_signal_connect (G_OBJECT (details_view->tree_view), "motion-notify-event",
+                    G_CALLBACK (thunar_details_view_motion_notify_event), details_view);
+  g_signal_connect (G_OBJECT (details_view->tree_view), "leave-notify-event",
+                    G_CALLBACK (thunar_details_view_leave_notify_event), details_view);
   g_signal_connect (G_OBJECT (details_view->tree_view), "select-cursor-row",
                     G_CALLBACK (thunar_details_view_select_cursor_row), details_view);
   gtk_container_add (GTK_CONTAINER (details_view), GTK_WIDGET (details_view->tree_view));
@@ -283,6 +329,7 @@ thunar_details_view_init (ThunarDetailsView *details_view)
 
   /* configure general aspects of the details view */
   gtk_tree_view_set_enable_search (GTK_TREE_VIEW (details_view->tree_view), TRUE);
+  gtk_tree_view_set_search_equal_func (GTK_TREE_VIEW (details_view->tree_view), thunar_standard_view_model_search_equal_func, NULL, NULL);
 
   /* enable rubberbanding (if supported) */
   gtk_tree_view_set_rubber_banding (GTK_TREE_VIEW (details_view->tree_view), TRUE);
@@ -300,6 +347,14 @@ thunar_details_view_init (ThunarDetailsView *details_view)
   g_signal_connect (G_OBJECT (details_view->column_model), "columns-changed", G_CALLBACK (thunar_details_view_columns_changed), details_view);
   g_signal_connect_after (G_OBJECT (THUNAR_STANDARD_VIEW (details_view)->model), "row-changed",
                           G_CALLBACK (thunar_details_view_row_changed), details_view);
+  g_signal_connect (G_OBJECT (THUNAR_STANDARD_VIEW (details_view)->model), "row-inserted",
+                    G_CALLBACK (thunar_details_view_row_inserted), details_view);
+
+  /* the rows scrolled into view may need wider columns than the measured ones */
+  g_signal_connect_swapped (G_OBJECT (gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (details_view))), "value-changed",
+                            G_CALLBACK (thunar_details_view_schedule_autosize_visible), details_view);
+  g_signal_connect_swapped (G_OBJECT (details_view->tree_view), "realize",
+                            G_CALLBACK (thunar_details_view_schedule_autosize_reset), details_view);
 
   /* allocate the shared right-aligned text renderer */
   right_aligned_renderer = g_object_new (thunar_text_renderer_get_type (), "xalign", 1.0f, NULL);
@@ -387,20 +442,19 @@ thunar_details_view_init (ThunarDetailsView *details_view)
                           "fixed-columns",
                           G_BINDING_SYNC_CREATE);
 
-  /* apply fixed column widths if we start in fixed column mode */
-  if (G_UNLIKELY (details_view->fixed_columns))
-    {
-      /* apply to all columns */
-      for (column = 0; column < THUNAR_N_VISIBLE_COLUMNS; ++column)
-        gtk_tree_view_column_set_fixed_width (details_view->columns[column], thunar_column_model_get_column_width (details_view->column_model, column));
-    }
-  else
+  /* start with the last column widths, the autosized columns are measured once the rows are there */
+  for (column = 0; column < THUNAR_N_VISIBLE_COLUMNS; ++column)
     {
-      /* Make sure the name column auto-expands */
-      gtk_tree_view_column_set_fixed_width (details_view->columns[THUNAR_COLUMN_NAME],-1);
-      gtk_tree_view_column_set_expand (details_view->columns[THUNAR_COLUMN_NAME], TRUE);
+      gtk_tree_view_column_set_sizing (details_view->columns[column], GTK_TREE_VIEW_COLUMN_FIXED);
+      gtk_tree_view_column_set_fixed_width (details_view->columns[column], thunar_column_model_get_column_width (details_view->column_model, column));
     }
 
+  /* Make sure the name column auto-expands */
+  gtk_tree_view_column_set_expand (details_view->columns[THUNAR_COLUMN_NAME], !details_view->fixed_columns);
+
+  /* the GtkTreeView doesn't need to measure the rows itself, in neither mode */
+  gtk_tree_view_set_fixed_height_mode (GTK_TREE_VIEW (details_view->tree_view), TRUE);
+
   g_signal_connect_swapped (THUNAR_STANDARD_VIEW (details_view)->preferences, "notify::misc-highlighting-enabled",
                             G_CALLBACK (thunar_details_view_highlight_option_changed), details_view);
   thunar_details_view_highlight_option_changed (details_view);
@@ -481,6 +535,11 @@ thunar_details_view_finalize (GObject *object)
   if (details_view->idle_id)
     g_source_remove (details_view->idle_id);
 
+  g_signal_handlers_disconnect_by_func (G_OBJECT (THUNAR_STANDARD_VIEW (details_view)->model), thunar_details_view_row_inserted, details_view);
+  thunar_details_view_cancel_autosize (details_view);
+
+  thunar_details_view_cancel_prefetch (details_view);
+
   g_signal_handlers_disconnect_by_func (G_OBJECT (THUNAR_STANDARD_VIEW (details_view)->preferences),
                                         thunar_details_view_highlight_option_changed, details_view);
 
@@ -709,6 +768,10 @@ thunar_details_view_notify_model (GtkTreeView       *tree_view,
    * whenever a new model is set.
    */
   gtk_tree_view_set_search_column (tree_view, THUNAR_COLUMN_NAME);
+
+  /* the columns fit the rows of the new folder, even if they are narrower */
+  if (gtk_tree_view_get_model (tree_view) != NULL)
+    thunar_details_view_schedule_autosize (details_view, TRUE, TRUE);
 }
 
 
@@ -1243,6 +1306,95 @@ thunar_details_view_row_collapsed (GtkTreeView       *tree_view,
 
 
 
+static void
+thunar_details_view_cancel_prefetch (ThunarDetailsView *details_view)
+{
+  if (details_view->prefetch_timer_id != 0)
+    {
+      g_source_remove (details_view->prefetch_timer_id);
+      details_view->prefetch_timer_id = 0;
+    }
+
+  if (details_view->prefetch_path != NULL)
+    {
+      gtk_tree_path_free (details_view->prefetch_path);
+      details_view->prefetch_path = NULL;
+    }
+}
+
+
+
+static gboolean
+thunar_details_view_prefetch_timer (gpointer user_data)
+{
+  ThunarDetailsView *details_view = THUNAR_DETAILS_VIEW (user_data);
+  GtkTreeModel      *model;
+  GtkTreeIter        iter;
+  gboolean           prefetch;
+
+  details_view->prefetch_timer_id = 0;
+
+  g_object_get (G_OBJECT (THUNAR_STANDARD_VIEW (details_view)->preferences), "misc-expandable-folders-prefetch", &prefetch, NULL);
+
+  model = gtk_tree_view_get_model (GTK_TREE_VIEW (details_view->tree_view));
+  if (prefetch
+      && THUNAR_IS_TREE_VIEW_MODEL (model)
+      && !gtk_tree_view_row_expanded (GTK_TREE_VIEW (details_view->tree_view), details_view->prefetch_path)
+      && gtk_tree_model_get_iter (model, &iter, details_view->prefetch_path))
+    thunar_tree_view_model_prefetch_subdir (THUNAR_TREE_VIEW_MODEL (model), &iter);
+
+  return FALSE;
+}
+
+
+
+static gboolean
+thunar_details_view_motion_notify_event (GtkTreeView       *tree_view,
+                                         GdkEventMotion    *event,
+                                         ThunarDetailsView *details_view)
+{
+  GtkTreePath *path = NULL;
+
+  if (!details_view->expandable_folders
+      || event->window != gtk_tree_view_get_bin_window (tree_view))
+    return FALSE;
+
+  gtk_tree_view_get_path_at_pos (tree_view, event->x, event->y, &path, NULL, NULL, NULL);
+
+  /* restart the delay whenever the pointer moves to another row */
+  if (path == NULL
+      || details_view->prefetch_path == NULL
+      || gtk_tree_path_compare (path, details_view->prefetch_path) != 0)
+    {
+      thunar_details_view_cancel_prefetch (details_view);
+      if (path != NULL)
+        {
+          details_view->prefetch_path = path;
+          details_view->prefetch_timer_id = g_timeout_add (THUNAR_DETAILS_VIEW_PREFETCH_DELAY, thunar_details_view_prefetch_timer, details_view);
+          return FALSE;
+        }
+    }
+
+  if (path != NULL)
+    gtk_tree_path_free (path);
+
+  return FALSE;
+}
+
+
+
+static gboolean
+thunar_details_view_leave_notify_event (GtkTreeView       *tree_view,
+                                        GdkEventCrossing  *event,
+                                        ThunarDetailsView *details_view)
+{
+  thunar_details_view_cancel_prefetch (details_view);
+
+  return FALSE;
+}
+
+
+
 static gboolean
 thunar_details_view_select_cursor_row (GtkTreeView            *tree_view,
                                        gboolean                editing,
@@ -1313,6 +1465,309 @@ thunar_details_view_columns_changed (ThunarColumnModel *column_model,
                                            details_view->columns[column_order[column - 1]]);
         }
     }
+
+  /* the columns shown now start from their last width */
+  thunar_details_view_schedule_autosize (details_view, TRUE, FALSE);
+}
+
+
+
+static void
+thunar_details_view_row_inserted (GtkTreeModel      *model,
+                                  GtkTreePath       *path,
+                                  GtkTreeIter       *iter,
+                                  ThunarDetailsView *details_view)
+{
+  _thunar_return_if_fail (THUNAR_IS_DETAILS_VIEW (details_view));
+
+  /* the new rows are measured in batches, a loading folder inserts many */
+  thunar_details_view_schedule_autosize (details_view, TRUE, FALSE);
+}
+
+
+
+/* advances @iter to the row below it in the tree view, if any */
+static gboolean
+thunar_details_view_autosize_next_row (GtkTreeView  *tree_view,
+                                       GtkTreeModel *model,
+                                       GtkTreeIter  *iter)
+{
+  GtkTreePath *path;
+  GtkTreeIter  next;
+  gboolean     expanded;
+
+  path = gtk_tree_model_get_path (model, iter);
+  expanded = gtk_tree_view_row_expanded (tree_view, path);
+  gtk_tree_path_free (path);
+
+  if (expanded && gtk_tree_model_iter_children (model, &next, iter))
+    {
+      *iter = next;
+      return TRUE;
+    }
+
+  for (;;)
+    {
+      next = *iter;
+      if (gtk_tree_model_iter_next (model, &next))
+        {
+          *iter = next;
+          return TRUE;
+        }
+
+      if (!gtk_tree_model_iter_parent (model, &next, iter))
+        return FALSE;
+      *iter = next;
+    }
+}
+
+
+
+static void
+thunar_details_view_autosize_measure_row (ThunarDetailsView *details_view,
+                                          GtkTreeModel      *model,
+                                          GtkTreeIter       *iter,
+                                          gint              *widths)
+{
+  GtkTreeViewColumn *expander_column;
+  GtkTreeView       *tree_view = GTK_TREE_VIEW (details_view->tree_view);
+  GtkTreePath       *path;
+  ThunarColumn       column;
+  gboolean           is_expander;
+  gboolean           is_expanded;
+  gint               horizontal_separator;
+  gint               expander_size;
+  gint               indent;
+  gint               depth;
+  gint               width;
+
+  path = gtk_tree_model_get_path (model, iter);
+  depth = gtk_tree_path_get_depth (path);
+  is_expander = gtk_tree_model_iter_has_child (model, iter);
+  is_expanded = is_expander && gtk_tree_view_row_expanded (tree_view, path);
+  gtk_tree_path_free (path);
+
+  gtk_widget_style_get (GTK_WIDGET (tree_view),
+                        "expander-size", &expander_size,
+                        "horizontal-separator", &horizontal_separator,
+                        NULL);
+
+  /* the space left of the cells in the expander column, like the GtkTreeView does */
+  indent = (depth - 1) * gtk_tree_view_get_level_indentation (tree_view);
+  if (gtk_tree_view_get_show_expanders (tree_view))
+    indent += depth * expander_size;
+  expander_column = gtk_tree_view_get_expander_column (tree_view);
+
+  for (column = 0; column < THUNAR_N_VISIBLE_COLUMNS; ++column)
+    {
+      if (!gtk_tree_view_column_get_visible (details_view->columns[column]))
+        continue;
+
+      gtk_tree_view_column_cell_set_cell_data (details_view->columns[column], model, iter, is_expander, is_expanded);
+      gtk_tree_view_column_cell_get_size (details_view->columns[column], NULL, NULL, NULL, &width, NULL);
+
+      width += horizontal_separator;
+      if (details_view->columns[column] == expander_column)
+        width += indent;
+
+      widths[column] = MAX (widths[column], width);
+    }
+}
+
+
+
+/**
+ * thunar_details_view_autosize_columns:
+ * @details_view : a #ThunarDetailsView.
+ * @full         : %FALSE to measure the visible rows only.
+ * @reset        : %TRUE to drop the widths measured before.
+ *
+ * Sizes the columns of @details_view to the rows, unless it uses fixed
+ * column widths. Instead of measuring every row, like the GtkTreeView
+ * does for autosized columns, only the visible rows are measured, and
+ * for a @full pass also a sample spread across the folder and the rows
+ * with the longest names. Since the sample may miss the widest values,
+ * the columns only grow until the next @reset, also when a wider value
+ * is scrolled into view.
+ **/
+static void
+thunar_details_view_autosize_columns (ThunarDetailsView *details_view,
+                                      gboolean           full,
+                                      gboolean           reset)
+{
+  GtkTreeView  *tree_view = GTK_TREE_VIEW (details_view->tree_view);
+  GtkTreeModel *model;
+  GtkTreePath  *start_path;
+  GtkTreePath  *end_path;
+  GtkTreePath  *path;
+  GtkTreeIter   iter;
+  ThunarColumn  column;
+  GList        *files;
+  GList        *paths;
+  GList        *lp;
+  gboolean      done;
+  gboolean      shown;
+  gint          widths[THUNAR_N_VISIBLE_COLUMNS] = { 0, };
+  gint          n_rows;
+  gint          row;
+  gint          width;
+  gint          n;
+
+  model = gtk_tree_view_get_model (tree_view);
+  if (model == NULL || details_view->fixed_columns)
+    return;
+
+  /* the rows in view, which should never be cut off */
+  if (gtk_tree_view_get_visible_range (tree_view, &start_path, &end_path))
+    {
+      if (gtk_tree_model_get_iter (model, &iter, start_path))
+        {
+          for (n = 0; n < THUNAR_DETAILS_VIEW_AUTOSIZE_MAX_VISIBLE; ++n)
+            {
+              thunar_details_view_autosize_measure_row (details_view, model, &iter, widths);
+
+              path = gtk_tree_model_get_path (model, &iter);
+              done = (gtk_tree_path_compare (path, end_path) >= 0);
+              gtk_tree_path_free (path);
+
+              if (done || !thunar_details_view_autosize_next_row (tree_view, model, &iter))
+                break;
+            }
+        }
+
+      gtk_tree_path_free (start_path);
+      gtk_tree_path_free (end_path);
+    }
+
+  if (full)
+    {
+      /* one random row of each stretch of the folder */
+      n_rows = gtk_tree_model_iter_n_children (model, NULL);
+      for (n = 0; n < MIN (n_rows, THUNAR_DETAILS_VIEW_AUTOSIZE_SAMPLES); ++n)
+        {
+          if (n_rows > THUNAR_DETAILS_VIEW_AUTOSIZE_SAMPLES)
+            row = g_random_int_range ((gint64) n * n_rows / THUNAR_DETAILS_VIEW_AUTOSIZE_SAMPLES,
+                                      (gint64) (n + 1) * n_rows / THUNAR_DETAILS_VIEW_AUTOSIZE_SAMPLES);
+          else
+            row = n;
+
+          if (gtk_tree_model_iter_nth_child (model, &iter, NULL, row))
+            thunar_details_view_autosize_measure_row (details_view, model, &iter, widths);
+        }
+
+      /* the names most likely to be cut off, as tracked by the model */
+      if (THUNAR_IS_TREE_VIEW_MODEL (model))
+        {
+          files = thunar_tree_view_model_get_long_name_files (THUNAR_TREE_VIEW_MODEL (model));
+          paths = thunar_standard_view_model_get_paths_for_files (THUNAR_STANDARD_VIEW_MODEL (model), files);
+          for (lp = paths; lp != NULL; lp = lp->next)
+            {
+              /* the rows inside of collapsed folders are not shown */
+              path = gtk_tree_path_copy (lp->data);
+              shown = (!gtk_tree_path_up (path) || gtk_tree_path_get_depth (path) == 0 || gtk_tree_view_row_expanded (tree_view, path));
+              gtk_tree_path_free (path);
+
+              if (shown && gtk_tree_model_get_iter (model, &iter, lp->data))
+                thunar_details_view_autosize_measure_row (details_view, model, &iter, widths);
+            }
+          g_list_free_full (paths, (GDestroyNotify) gtk_tree_path_free);
+          thunar_g_list_free_full (files);
+        }
+    }
+
+  for (column = 0; column < THUNAR_N_VISIBLE_COLUMNS; ++column)
+    {
+      if (!gtk_tree_view_column_get_visible (details_view->columns[column]))
+        continue;
+
+      /* the header is never cut off either */
+      gtk_widget_get_preferred_width (gtk_tree_view_column_get_button (details_view->columns[column]), NULL, &width);
+      width = MAX (width, widths[column]);
+      width = MAX (width, gtk_tree_view_column_get_min_width (details_view->columns[column]));
+
+      /* a width set by the user stays as long as the rows fit */
+      if (reset)
+        gtk_tree_view_column_set_fixed_width (details_view->columns[column], width);
+      else if (width > details_view->autosize_widths[column])
+        gtk_tree_view_column_set_fixed_width (details_view->columns[column], MAX (width, gtk_tree_view_column_get_fixed_width (details_view->columns[column])));
+      else
+        continue;
+
+      details_view->autosize_widths[column] = width;
+    }
+}
+
+
+
+static gboolean
+thunar_details_view_autosize_timer (gpointer user_data)
+{
+  ThunarDetailsView *details_view = THUNAR_DETAILS_VIEW (user_data);
+
+  details_view->autosize_timer_id = 0;
+
+  /* the cells cannot be measured before the view has its style, nor once it is destroyed */
+  if (gtk_bin_get_child (GTK_BIN (details_view)) == NULL
+      || !gtk_widget_get_realized (GTK_WIDGET (details_view->tree_view)))
+    return G_SOURCE_REMOVE;
+
+  thunar_details_view_autosize_columns (details_view, details_view->autosize_full, details_view->autosize_reset);
+  details_view->autosize_full = FALSE;
+  details_view->autosize_reset = FALSE;
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+static void
+thunar_details_view_schedule_autosize (ThunarDetailsView *details_view,
+                                       gboolean           full,
+                                       gboolean           reset)
+{
+  if (details_view->fixed_columns)
+    return;
+
+  /* the pending pass covers everything asked for meanwhile */
+  details_view->autosize_full |= full;
+  details_view->autosize_reset |= reset;
+
+  if (details_view->autosize_timer_id == 0)
+    {
+      details_view->autosize_timer_id = g_timeout_add (THUNAR_DETAILS_VIEW_AUTOSIZE_DELAY, thunar_details_view_autosize_timer, details_view);
+      g_source_set_name_by_id (details_view->autosize_timer_id, "thunar_details_view_autosize_timer");
+    }
+}
+
+
+
+static void
+thunar_details_view_schedule_autosize_visible (ThunarDetailsView *details_view)
+{
+  thunar_details_view_schedule_autosize (details_view, FALSE, FALSE);
+}
+
+
+
+static void
+thunar_details_view_schedule_autosize_reset (ThunarDetailsView *details_view)
+{
+  thunar_details_view_schedule_autosize (details_view, TRUE, TRUE);
+}
+
+
+
+static void
+thunar_details_view_cancel_autosize (ThunarDetailsView *details_view)
+{
+  if (details_view->autosize_timer_id != 0)
+    {
+      g_source_remove (details_view->autosize_timer_id);
+      details_view->autosize_timer_id = 0;
+    }
+
+  details_view->autosize_full = FALSE;
+  details_view->autosize_reset = FALSE;
 }
 
 
@@ -1338,11 +1793,8 @@ thunar_details_view_zoom_level_changed (ThunarDetailsView *details_view)
 
   _thunar_return_if_fail (THUNAR_IS_DETAILS_VIEW (details_view));
 
-  if (details_view->fixed_columns == TRUE)
-    {
-      /* disable fixed_height_mode during resize, otherwise graphical glitches can appear*/
-      gtk_tree_view_set_fixed_height_mode (GTK_TREE_VIEW (gtk_bin_get_child (GTK_BIN (details_view))), FALSE);
-    }
+  /* disable fixed_height_mode during resize, otherwise graphical glitches can appear*/
+  gtk_tree_view_set_fixed_height_mode (GTK_TREE_VIEW (gtk_bin_get_child (GTK_BIN (details_view))), FALSE);
 
   /* determine the list of tree view columns */
   for (column = 0; column < THUNAR_N_VISIBLE_COLUMNS; ++column)
@@ -1351,11 +1803,12 @@ thunar_details_view_zoom_level_changed (ThunarDetailsView *details_view)
       gtk_tree_view_column_queue_resize (details_view->columns[column]);
     }
 
-  if (details_view->fixed_columns == TRUE)
-    {
-      /* Call when idle to ensure that gtk_tree_view_column_queue_resize got finished */
-      details_view->idle_id = gdk_threads_add_idle (thunar_details_view_zoom_level_changed_reload_fixed_height, details_view);
-    }
+  /* Call when idle to ensure that gtk_tree_view_column_queue_resize got finished */
+  if (details_view->idle_id == 0)
+    details_view->idle_id = gdk_threads_add_idle (thunar_details_view_zoom_level_changed_reload_fixed_height, details_view);
+
+  /* the icons and names take a different width now */
+  thunar_details_view_schedule_autosize (details_view, TRUE, TRUE);
 }
 
 
@@ -1468,44 +1921,30 @@ thunar_details_view_set_fixed_columns (ThunarDetailsView *details_view,
       /* apply the new value */
       details_view->fixed_columns = fixed_columns;
 
-      /* disable in reverse order, otherwise graphical glitches can appear*/
-      if (!fixed_columns)
-        gtk_tree_view_set_fixed_height_mode (GTK_TREE_VIEW (gtk_bin_get_child (GTK_BIN (details_view))), FALSE);
-
-      /* apply the new setting to all columns */
-      for (column = 0; column < THUNAR_N_VISIBLE_COLUMNS; ++column)
+      /* the columns keep the fixed sizing, which the fixed height mode
+       * of the GtkTreeView requires, only their widths are measured
+       * in the autosize mode, see thunar_details_view_autosize_columns() */
+      if (G_LIKELY (fixed_columns))
         {
-          /* apply the new column mode */
-          if (G_LIKELY (fixed_columns))
+          thunar_details_view_cancel_autosize (details_view);
+
+          /* apply "width" as "fixed-width" for fixed columns mode */
+          for (column = 0; column < THUNAR_N_VISIBLE_COLUMNS; ++column)
             {
-              /* apply "width" as "fixed-width" for fixed columns mode */
               width = gtk_tree_view_column_get_width (details_view->columns[column]);
               if (G_UNLIKELY (width <= 0))
                 width = thunar_column_model_get_column_width (details_view->column_model, column);
               gtk_tree_view_column_set_fixed_width (details_view->columns[column], MAX (width, 1));
-
-              /* set column to fixed width */
-              gtk_tree_view_column_set_sizing (details_view->columns[column], GTK_TREE_VIEW_COLUMN_FIXED);
-            }
-          else
-            {
-              /* reset column to grow-only mode */
-              gtk_tree_view_column_set_sizing (details_view->columns[column], GTK_TREE_VIEW_COLUMN_GROW_ONLY);
-              gtk_tree_view_column_set_fixed_width (details_view->columns[column],-1);
             }
         }
-
-      /* for fixed columns mode, we can enable the fixed height
-       * mode to improve the performance of the GtkTreeVeiw. */
-      if (fixed_columns)
-        gtk_tree_view_set_fixed_height_mode (GTK_TREE_VIEW (gtk_bin_get_child (GTK_BIN (details_view))), TRUE);
-
-      if (fixed_columns == FALSE)
+      else
         {
-          /* Make sure the name column auto-expands */
-          gtk_tree_view_column_set_expand (details_view->columns[THUNAR_COLUMN_NAME], TRUE);
+          thunar_details_view_schedule_autosize (details_view, TRUE, TRUE);
         }
 
+      /* Make sure the name column auto-expands */
+      gtk_tree_view_column_set_expand (details_view->columns[THUNAR_COLUMN_NAME], !fixed_columns);
+
       gtk_tree_view_column_queue_resize (details_view->columns[THUNAR_COLUMN_NAME]);
 
       /* notify listeners */
@@ -52,6 +52,16 @@ enum
   PROP_HIDDEN_DEVICES
 };
 
+/* pending device notifications */
+typedef enum
+{
+  THUNAR_DEVICE_EVENT_ADDED   = 1 << 0,
+  THUNAR_DEVICE_EVENT_REMOVED = 1 << 1,
+  THUNAR_DEVICE_EVENT_CHANGED = 1 << 2
+} ThunarDeviceEventFlags;
+
+typedef struct _ThunarDeviceEvent ThunarDeviceEvent;
+
 
 
 static void           thunar_device_monitor_finalize               (GObject                *object);
@@ -63,6 +73,12 @@ static void           thunar_device_monitor_set_property           (GObject
                                                                     guint                   prop_id,
                                                                     const GValue           *value,
                                                                     GParamSpec             *pspec);
+static void           thunar_device_monitor_queue_event            (ThunarDeviceMonitor    *monitor,
+                                                                    ThunarDevice           *device,
+                                                                    ThunarDeviceEventFlags  flag);
+static void           thunar_device_monitor_flush_events           (ThunarDeviceMonitor    *monitor);
+static gboolean       thunar_device_monitor_flush_idle             (gpointer                user_data);
+static void           thunar_device_monitor_event_free             (gpointer                data);
 static void           thunar_device_monitor_update_hidden          (gpointer                key,
                                                                     gpointer                value,
                                                                     gpointer                data);
@@ -121,6 +137,17 @@ struct _ThunarDeviceMonitor
   /* user defined hidden volumes */
   ThunarPreferences  *preferences;
   gchar             **hidden_devices;
+
+  /* ThunarDevice -> ThunarDeviceEvent, in order of arrival in events */
+  GHashTable         *pending_events;
+  GQueue              events;
+  guint               flush_idle_id;
+};
+
+struct _ThunarDeviceEvent
+{
+  ThunarDevice           *device;
+  ThunarDeviceEventFlags  flags;
 };
 
 
@@ -205,6 +232,10 @@ thunar_device_monitor_init (ThunarDeviceMonitor *monitor)
   /* table for GVolume/GMount (key) -> ThunarDevice (value) */
   monitor->devices = g_hash_table_new_full (g_direct_hash, g_direct_equal, g_object_unref, g_object_unref);
 
+  /* coalesced notifications, flushed once per main loop iteration */
+  monitor->pending_events = g_hash_table_new (g_direct_hash, g_direct_equal);
+  g_queue_init (&monitor->events);
+
   /* gio volume monitor */
   monitor->volume_monitor = g_volume_monitor_get ();
 
@@ -226,6 +257,15 @@ thunar_device_monitor_init (ThunarDeviceMonitor *monitor)
     }
   g_list_free (list);
 
+  /* nobody is connected yet, the initial devices are picked up with get_devices */
+  g_queue_clear_full (&monitor->events, thunar_device_monitor_event_free);
+  g_hash_table_remove_all (monitor->pending_events);
+  if (monitor->flush_idle_id != 0)
+    {
+      g_source_remove (monitor->flush_idle_id);
+      monitor->flush_idle_id = 0;
+    }
+
   /* watch changes */
   g_signal_connect (monitor->volume_monitor, "volume-added", G_CALLBACK (thunar_device_monitor_volume_added), monitor);
   g_signal_connect (monitor->volume_monitor, "volume-removed", G_CALLBACK (thunar_device_monitor_volume_removed), monitor);
@@ -251,6 +291,12 @@ thunar_device_monitor_finalize (GObject *object)
   g_signal_handlers_disconnect_by_data (monitor->volume_monitor, monitor);
   g_object_unref (monitor->volume_monitor);
 
+  /* drop pending notifications */
+  if (monitor->flush_idle_id != 0)
+    g_source_remove (monitor->flush_idle_id);
+  g_queue_clear_full (&monitor->events, thunar_device_monitor_event_free);
+  g_hash_table_destroy (monitor->pending_events);
+
   /* clear list of devices */
   g_hash_table_destroy (monitor->devices);
 
@@ -312,6 +358,129 @@ thunar_device_monitor_set_property (GObject      *object,
 
 
 
+static void
+thunar_device_monitor_event_free (gpointer data)
+{
+  ThunarDeviceEvent *event = data;
+
+  g_object_unref (event->device);
+  g_slice_free (ThunarDeviceEvent, event);
+}
+
+
+
+static void
+thunar_device_monitor_queue_event (ThunarDeviceMonitor    *monitor,
+                                   ThunarDevice           *device,
+                                   ThunarDeviceEventFlags  flag)
+{
+  ThunarDeviceEvent *event;
+
+  _thunar_return_if_fail (THUNAR_IS_DEVICE_MONITOR (monitor));
+  _thunar_return_if_fail (THUNAR_IS_DEVICE (device));
+
+  event = g_hash_table_lookup (monitor->pending_events, device);
+  if (event == NULL)
+    {
+      event = g_slice_new0 (ThunarDeviceEvent);
+      event->device = g_object_ref (device);
+      g_hash_table_insert (monitor->pending_events, device, event);
+      g_queue_push_tail (&monitor->events, event);
+    }
+
+  switch (flag)
+    {
+    case THUNAR_DEVICE_EVENT_ADDED:
+      event->flags = THUNAR_DEVICE_EVENT_ADDED;
+      break;
+
+    case THUNAR_DEVICE_EVENT_REMOVED:
+      if ((event->flags & THUNAR_DEVICE_EVENT_ADDED) != 0)
+        {
+          /* nobody has seen this device yet, forget about it */
+          g_hash_table_remove (monitor->pending_events, device);
+          g_queue_remove (&monitor->events, event);
+          thunar_device_monitor_event_free (event);
+        }
+      else
+        {
+          /* a change is irrelevant if the device is gone */
+          event->flags = THUNAR_DEVICE_EVENT_REMOVED;
+        }
+      break;
+
+    case THUNAR_DEVICE_EVENT_CHANGED:
+      /* an addition already carries the latest state */
+      if (event->flags == 0)
+        event->flags = THUNAR_DEVICE_EVENT_CHANGED;
+      break;
+
+    default:
+      _thunar_assert_not_reached ();
+    }
+
+  if (monitor->flush_idle_id == 0 && !g_queue_is_empty (&monitor->events))
+    monitor->flush_idle_id = g_idle_add (thunar_device_monitor_flush_idle, monitor);
+}
+
+
+
+static void
+thunar_device_monitor_flush_events (ThunarDeviceMonitor *monitor)
+{
+  ThunarDeviceEvent *event;
+  GQueue             events;
+  guint              signal_id;
+
+  _thunar_return_if_fail (THUNAR_IS_DEVICE_MONITOR (monitor));
+
+  if (monitor->flush_idle_id != 0)
+    {
+      g_source_remove (monitor->flush_idle_id);
+      monitor->flush_idle_id = 0;
+    }
+
+  if (g_queue_is_empty (&monitor->events))
+    return;
+
+  /* take the batch, handlers may queue new events or flush again */
+  events = monitor->events;
+  g_queue_init (&monitor->events);
+  g_hash_table_remove_all (monitor->pending_events);
+
+  g_object_ref (monitor);
+
+  while ((event = g_queue_pop_head (&events)) != NULL)
+    {
+      if (event->flags == THUNAR_DEVICE_EVENT_ADDED)
+        signal_id = device_monitor_signals[DEVICE_ADDED];
+      else if (event->flags == THUNAR_DEVICE_EVENT_REMOVED)
+        signal_id = device_monitor_signals[DEVICE_REMOVED];
+      else
+        signal_id = device_monitor_signals[DEVICE_CHANGED];
+
+      g_signal_emit (G_OBJECT (monitor), signal_id, 0, event->device);
+      thunar_device_monitor_event_free (event);
+    }
+
+  g_object_unref (monitor);
+}
+
+
+
+static gboolean
+thunar_device_monitor_flush_idle (gpointer user_data)
+{
+  ThunarDeviceMonitor *monitor = THUNAR_DEVICE_MONITOR (user_data);
+
+  monitor->flush_idle_id = 0;
+  thunar_device_monitor_flush_events (monitor);
+
+  return FALSE;
+}
+
+
+
 static gboolean
 thunar_device_monitor_id_is_hidden (ThunarDeviceMonitor *monitor,
                                     const gchar         *id)
@@ -349,7 +518,7 @@ thunar_device_monitor_update_hidden (gpointer key,
   if (thunar_device_get_hidden (device) != hidden)
     {
       g_object_set (G_OBJECT (device), "hidden", hidden, NULL);
-      g_signal_emit (G_OBJECT (monitor), device_monitor_signals[DEVICE_CHANGED], 0, device);
+      thunar_device_monitor_queue_event (monitor, device, THUNAR_DEVICE_EVENT_CHANGED);
     }
 }
 
@@ -416,7 +585,7 @@ thunar_device_monitor_volume_removed (GVolumeMonitor      *volume_monitor,
         return;
 
       /* the device is not visble for the user */
-      g_signal_emit (G_OBJECT (monitor), device_monitor_signals[DEVICE_REMOVED], 0, device);
+      thunar_device_monitor_queue_event (monitor, device, THUNAR_DEVICE_EVENT_REMOVED);
 
       /* drop it */
       g_hash_table_remove (monitor->devices, volume);
@@ -462,7 +631,7 @@ thunar_device_monitor_volume_changed (GVolumeMonitor      *volume_monitor,
       g_hash_table_insert (monitor->devices, volume, device);
 
       /* notify */
-      g_signal_emit (G_OBJECT (monitor), device_monitor_signals[DEVICE_ADDED], 0, device);
+      thunar_device_monitor_queue_event (monitor, device, THUNAR_DEVICE_EVENT_ADDED);
     }
   else
     {
@@ -475,7 +644,7 @@ thunar_device_monitor_volume_changed (GVolumeMonitor      *volume_monitor,
         return;
 
       /* the device changed */
-      g_signal_emit (G_OBJECT (monitor), device_monitor_signals[DEVICE_CHANGED], 0, device);
+      thunar_device_monitor_queue_event (monitor, device, THUNAR_DEVICE_EVENT_CHANGED);
     }
 }
 
@@ -547,7 +716,7 @@ thunar_device_monitor_mount_added (GVolumeMonitor      *volume_monitor,
       g_hash_table_insert (monitor->devices, g_object_ref (mount), device);
 
       /* notify */
-      g_signal_emit (G_OBJECT (monitor), device_monitor_signals[DEVICE_ADDED], 0, device);
+      thunar_device_monitor_queue_event (monitor, device, THUNAR_DEVICE_EVENT_ADDED);
     }
   else
     {
@@ -559,7 +728,7 @@ thunar_device_monitor_mount_added (GVolumeMonitor      *volume_monitor,
           thunar_device_reload_file (device);
 
           /* notify */
-          g_signal_emit (G_OBJECT (monitor), device_monitor_signals[DEVICE_CHANGED], 0, device);
+          thunar_device_monitor_queue_event (monitor, device, THUNAR_DEVICE_EVENT_CHANGED);
         }
 
       g_object_unref (volume);
@@ -587,7 +756,7 @@ thunar_device_monitor_mount_removed (GVolumeMonitor      *volume_monitor,
   if (device != NULL)
     {
       /* notify */
-      g_signal_emit (G_OBJECT (monitor),device_monitor_signals[DEVICE_REMOVED], 0, device);
+      thunar_device_monitor_queue_event (monitor, device, THUNAR_DEVICE_EVENT_REMOVED);
 
       /* drop it */
       g_hash_table_remove (monitor->devices, mount);
@@ -601,6 +770,9 @@ thunar_device_monitor_mount_removed (GVolumeMonitor      *volume_monitor,
           device = g_hash_table_lookup (monitor->devices, volume);
           if (device != NULL)
             {
+              /* make sure listeners know the device before it goes */
+              thunar_device_monitor_flush_events (monitor);
+
               /* we can't get the file from the volume at this point so provide it */
               root_file = g_mount_get_root (mount);
               g_signal_emit (G_OBJECT (monitor),
@@ -633,7 +805,7 @@ thunar_device_monitor_mount_changed (GVolumeMonitor      *volume_monitor,
   if (device != NULL)
     {
       /* notify */
-      g_signal_emit (G_OBJECT (monitor), device_monitor_signals[DEVICE_CHANGED], 0, device);
+      thunar_device_monitor_queue_event (monitor, device, THUNAR_DEVICE_EVENT_CHANGED);
     }
 }
 
@@ -668,6 +840,9 @@ thunar_device_monitor_mount_pre_unmount (GVolumeMonitor      *volume_monitor,
 
   if (device != NULL)
     {
+      /* deliver pending events first, the pre-unmount must not overtake them */
+      thunar_device_monitor_flush_events (monitor);
+
       /* notify */
       root_file = g_mount_get_root (mount);
       g_signal_emit (G_OBJECT (monitor),
@@ -719,6 +894,10 @@ thunar_device_monitor_get_devices (ThunarDeviceMonitor *monitor)
 
   _thunar_return_val_if_fail (THUNAR_IS_DEVICE_MONITOR (monitor), NULL);
 
+  /* deliver queued notifications so the caller does not see them
+   * twice after connecting to the signals */
+  thunar_device_monitor_flush_events (monitor);
+
   g_hash_table_foreach (monitor->devices, thunar_device_monitor_list_prepend, &list);
 
   return list;
@@ -746,7 +925,7 @@ thunar_device_monitor_set_hidden (ThunarDeviceMonitor *monitor,
 
   /* update device */
   g_object_set (G_OBJECT (device), "hidden", hidden, NULL);
-  g_signal_emit (G_OBJECT (monitor), device_monitor_signals[DEVICE_CHANGED], 0, device);
+  thunar_device_monitor_queue_event (monitor, device, THUNAR_DEVICE_EVENT_CHANGED);
 
   /* update the device list */
   length = monitor->hidden_devices != NULL ? g_strv_length (monitor->hidden_devices) : 0;
@@ -21,6 +21,16 @@
 #include "config.h"
 #endif
 
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
 #include "thunar/thunar-device.h"
 #include "thunar/thunar-device-monitor.h"
 #include "thunar/thunar-private.h"
@@ -33,6 +43,19 @@ typedef gboolean   (*AsyncCallbackFinish) (GObject       *object,
                                            GAsyncResult  *result,
                                            GError       **error);
 
+/* g_mount_unmount_with_operation() and the eject and stop functions */
+typedef void       (*AsyncCallbackStart)  (gpointer             object,
+                                           GMountUnmountFlags   flags,
+                                           GMountOperation     *mount_operation,
+                                           GCancellable        *cancellable,
+                                           GAsyncReadyCallback  callback,
+                                           gpointer             user_data);
+
+
+
+/* interval of the writeback progress while the device is flushed, in ms */
+#define THUNAR_DEVICE_FLUSH_PROGRESS_INTERVAL (500)
+
 
 
 enum
@@ -92,6 +115,12 @@ typedef struct
   /* finish function for the async callback */
   AsyncCallbackFinish   callback_finish;
 
+  /* the unmount, eject or stop that follows the flush of the device */
+  AsyncCallbackStart    callback_start;
+  gpointer              start_object;
+  GCancellable         *cancellable;
+  guint                 flush_progress_id;
+
   /* callback for the user */
   ThunarDeviceCallback  callback;
   gpointer              user_data;
@@ -302,11 +331,160 @@ thunar_device_operation_finish (GObject      *object,
   g_signal_handler_disconnect (op->mount_operation, op->unmount_progress_signal_id);
   g_object_unref (G_OBJECT (op->mount_operation));
   g_object_unref (G_OBJECT (op->device));
+  if (op->start_object != NULL)
+    g_object_unref (op->start_object);
+  if (op->cancellable != NULL)
+    g_object_unref (op->cancellable);
   g_slice_free (ThunarDeviceOperation, op);
 }
 
 
 
+static guint64
+thunar_device_dirty_bytes (void)
+{
+  gchar  *contents;
+  gchar **lines;
+  guint64 kbytes = 0;
+  guint   n;
+
+  /* the data of all devices that was not written yet, the kernel does
+   * not tell how much of it belongs to a single file system */
+  if (!g_file_get_contents ("/proc/meminfo", &contents, NULL, NULL))
+    return 0;
+
+  lines = g_strsplit (contents, "\n", -1);
+  for (n = 0; lines[n] != NULL; ++n)
+    if (g_str_has_prefix (lines[n], "Dirty:") || g_str_has_prefix (lines[n], "Writeback:"))
+      kbytes += g_ascii_strtoull (strchr (lines[n], ':') + 1, NULL, 10);
+  g_strfreev (lines);
+  g_free (contents);
+
+  return kbytes * 1024;
+}
+
+
+
+static gboolean
+thunar_device_flush_progress (gpointer user_data)
+{
+  ThunarDeviceOperation *op = user_data;
+  gchar                 *size_string;
+  gchar                 *message;
+  guint64                dirty_bytes;
+
+  dirty_bytes = thunar_device_dirty_bytes ();
+  if (dirty_bytes > 0)
+    {
+      size_string = g_format_size (dirty_bytes);
+      /* TRANSLATORS: the first line is the summary of the notification, the second its body */
+      message = g_strdup_printf (_("Writing data to device\n%s left to write"), size_string);
+      thunar_notify_progress (op->device, message);
+      g_free (message);
+      g_free (size_string);
+    }
+
+  return G_SOURCE_CONTINUE;
+}
+
+
+
+static void
+thunar_device_flush_thread (GTask        *task,
+                            gpointer      source_object,
+                            gpointer      task_data,
+                            GCancellable *cancellable)
+{
+  const gchar *path = task_data;
+#ifdef HAVE_SYNCFS
+  gint         fd;
+
+  /* only write back the file system of the device */
+  fd = open (path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd >= 0)
+    {
+      syncfs (fd);
+      close (fd);
+      g_task_return_boolean (task, TRUE);
+      return;
+    }
+#endif
+
+  (void) path;
+  sync ();
+
+  g_task_return_boolean (task, TRUE);
+}
+
+
+
+static void
+thunar_device_flush_finish (GObject      *object,
+                            GAsyncResult *result,
+                            gpointer      user_data)
+{
+  ThunarDeviceOperation *op = user_data;
+
+  if (op->flush_progress_id != 0)
+    {
+      g_source_remove (op->flush_progress_id);
+      op->flush_progress_id = 0;
+    }
+
+  /* the unmount only has to wait for the data written since */
+  (op->callback_start) (op->start_object,
+                        G_MOUNT_UNMOUNT_NONE,
+                        op->mount_operation,
+                        op->cancellable,
+                        thunar_device_operation_finish,
+                        op);
+}
+
+
+
+static void
+thunar_device_operation_start_unmount (ThunarDeviceOperation *op,
+                                       gpointer               object,
+                                       AsyncCallbackStart     callback_start,
+                                       GCancellable          *cancellable,
+                                       gboolean               all_volumes)
+{
+  GFile *root_file;
+  GTask *task;
+  gchar *path = NULL;
+
+  /* close the views and release the monitors on the device first */
+  thunar_device_emit_pre_unmount (op->device, all_volumes);
+
+  op->callback_start = callback_start;
+  op->start_object = g_object_ref (object);
+  op->cancellable = (cancellable != NULL) ? g_object_ref (cancellable) : NULL;
+
+  root_file = thunar_device_get_root (op->device);
+  if (root_file != NULL)
+    {
+      path = g_file_get_path (root_file);
+      g_object_unref (root_file);
+    }
+
+  if (path == NULL)
+    {
+      thunar_device_flush_finish (NULL, NULL, op);
+      return;
+    }
+
+  /* write back the data of the device in a thread, the unmount would
+   * block on a slow stick without telling how much is left */
+  op->flush_progress_id = g_timeout_add (THUNAR_DEVICE_FLUSH_PROGRESS_INTERVAL, thunar_device_flush_progress, op);
+
+  task = g_task_new (NULL, NULL, thunar_device_flush_finish, op);
+  g_task_set_task_data (task, path, g_free);
+  g_task_run_in_thread (task, thunar_device_flush_thread);
+  g_object_unref (task);
+}
+
+
+
 static void
 thunar_device_emit_pre_unmount (ThunarDevice *device,
                                 gboolean      all_volumes)
@@ -769,15 +947,9 @@ thunar_device_unmount (ThunarDevice         *device,
           thunar_notify_unmount (device);
 
           /* try unmounting the mount */
-          thunar_device_emit_pre_unmount (device, FALSE);
           op = thunar_device_operation_new (device, mount_operation, callback, user_data,
                                             g_mount_unmount_with_operation_finish);
-          g_mount_unmount_with_operation (mount,
-                                          G_MOUNT_UNMOUNT_NONE,
-                                          mount_operation,
-                                          cancellable,
-                                          thunar_device_operation_finish,
-                                          op);
+          thunar_device_operation_start_unmount (op, mount, (AsyncCallbackStart) g_mount_unmount_with_operation, cancellable, FALSE);
         }
 
       g_object_unref (G_OBJECT (mount));
@@ -821,15 +993,9 @@ thunar_device_eject (ThunarDevice         *device,
               thunar_notify_eject (device);
 
               /* try to stop the drive */
-              thunar_device_emit_pre_unmount (device, TRUE);
               op = thunar_device_operation_new (device, mount_operation, callback, user_data,
                                                 g_drive_stop_finish);
-              g_drive_stop (drive,
-                            G_MOUNT_UNMOUNT_NONE,
-                            mount_operation,
-                            cancellable,
-                            thunar_device_operation_finish,
-                            op);
+              thunar_device_operation_start_unmount (op, drive, (AsyncCallbackStart) g_drive_stop, cancellable, TRUE);
 
               g_object_unref (drive);
 
@@ -842,15 +1008,9 @@ thunar_device_eject (ThunarDevice         *device,
               thunar_notify_eject (device);
 
               /* try to stop the drive */
-              thunar_device_emit_pre_unmount (device, TRUE);
               op = thunar_device_operation_new (device, mount_operation, callback, user_data,
                                                 g_drive_eject_with_operation_finish);
-              g_drive_eject_with_operation (drive,
-                                            G_MOUNT_UNMOUNT_NONE,
-                                            mount_operation,
-                                            cancellable,
-                                            thunar_device_operation_finish,
-                                            op);
+              thunar_device_operation_start_unmount (op, drive, (AsyncCallbackStart) g_drive_eject_with_operation, cancellable, TRUE);
 
               g_object_unref (drive);
 
@@ -867,15 +1027,9 @@ thunar_device_eject (ThunarDevice         *device,
           thunar_notify_eject (device);
 
           /* try ejecting the volume */
-          thunar_device_emit_pre_unmount (device, TRUE);
           op = thunar_device_operation_new (device, mount_operation, callback, user_data,
                                             g_volume_eject_with_operation_finish);
-          g_volume_eject_with_operation (volume,
-                                         G_MOUNT_UNMOUNT_NONE,
-                                         mount_operation,
-                                         cancellable,
-                                         thunar_device_operation_finish,
-                                         op);
+          thunar_device_operation_start_unmount (op, volume, (AsyncCallbackStart) g_volume_eject_with_operation, cancellable, TRUE);
 
           /* done */
           return;
@@ -902,15 +1056,9 @@ thunar_device_eject (ThunarDevice         *device,
           thunar_notify_eject (device);
 
           /* try ejecting the mount */
-          thunar_device_emit_pre_unmount (device, FALSE);
           op = thunar_device_operation_new (device, mount_operation, callback, user_data,
                                             g_mount_eject_with_operation_finish);
-          g_mount_eject_with_operation (mount,
-                                        G_MOUNT_UNMOUNT_NONE,
-                                        mount_operation,
-                                        cancellable,
-                                        thunar_device_operation_finish,
-                                        op);
+          thunar_device_operation_start_unmount (op, mount, (AsyncCallbackStart) g_mount_eject_with_operation, cancellable, FALSE);
         }
       else if (g_mount_can_unmount (mount))
         {
@@ -918,15 +1066,9 @@ thunar_device_eject (ThunarDevice         *device,
           thunar_notify_unmount (device);
 
           /* try unmounting the mount */
-          thunar_device_emit_pre_unmount (device, FALSE);
           op = thunar_device_operation_new (device, mount_operation, callback, user_data,
                                             g_mount_unmount_with_operation_finish);
-          g_mount_unmount_with_operation (mount,
-                                          G_MOUNT_UNMOUNT_NONE,
-                                          mount_operation,
-                                          cancellable,
-                                          thunar_device_operation_finish,
-                                          op);
+          thunar_device_operation_start_unmount (op, mount, (AsyncCallbackStart) g_mount_unmount_with_operation, cancellable, FALSE);
         }
 
       g_object_unref (G_OBJECT (mount));
@@ -643,6 +643,14 @@ thunar_dialogs_show_job_ask (GtkWindow        *parent,
           mnemonic = _("Replace _All");
           break;
 
+        case THUNAR_JOB_RESPONSE_REPLACE_OLDER_ALL:
+          mnemonic = _("Replace _Older");
+          break;
+
+        case THUNAR_JOB_RESPONSE_REPLACE_SMALLER_ALL:
+          mnemonic = _("Replace _Smaller");
+          break;
+
         case THUNAR_JOB_RESPONSE_SKIP:
           mnemonic = _("_Skip");
           break;
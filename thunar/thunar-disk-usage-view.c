@@ -0,0 +1,268 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "thunar/thunar-disk-usage-view.h"
+#include "thunar/thunar-disk-usage.h"
+#include "thunar/thunar-gio-extensions.h"
+#include "thunar/thunar-list-model.h"
+#include "thunar/thunar-private.h"
+
+
+
+/* delay before the files are scanned again after the folder changed */
+#define THUNAR_DISK_USAGE_VIEW_RESCAN_DELAY (500)
+
+
+
+static void         thunar_disk_usage_view_dispose         (GObject                  *object);
+static AtkObject   *thunar_disk_usage_view_get_accessible  (GtkWidget                *widget);
+static void         thunar_disk_usage_view_usage_data_func (GtkCellLayout            *layout,
+                                                            GtkCellRenderer          *cell,
+                                                            GtkTreeModel             *model,
+                                                            GtkTreeIter              *iter,
+                                                            gpointer                  data);
+static void         thunar_disk_usage_view_schedule_scan   (ThunarDiskUsageView      *disk_usage_view);
+static void         thunar_disk_usage_view_row_changed     (ThunarDiskUsageView      *disk_usage_view);
+
+
+
+struct _ThunarDiskUsageViewClass
+{
+  ThunarAbstractIconViewClass __parent__;
+};
+
+struct _ThunarDiskUsageView
+{
+  ThunarAbstractIconView __parent__;
+
+  GtkCellRenderer *usage_renderer;
+  guint            scan_timer_id;
+};
+
+
+
+G_DEFINE_TYPE (ThunarDiskUsageView, thunar_disk_usage_view, THUNAR_TYPE_ABSTRACT_ICON_VIEW)
+
+
+
+static void
+thunar_disk_usage_view_class_init (ThunarDiskUsageViewClass *klass)
+{
+  ThunarStandardViewClass *thunarstandard_view_class;
+  GtkWidgetClass          *gtkwidget_class;
+  GObjectClass            *gobject_class;
+
+  gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->dispose = thunar_disk_usage_view_dispose;
+
+  gtkwidget_class = GTK_WIDGET_CLASS (klass);
+  gtkwidget_class->get_accessible = thunar_disk_usage_view_get_accessible;
+
+  thunarstandard_view_class = THUNAR_STANDARD_VIEW_CLASS (klass);
+  thunarstandard_view_class->zoom_level_property_name = "last-disk-usage-view-zoom-level";
+}
+
+
+
+static void
+thunar_disk_usage_view_init (ThunarDiskUsageView *disk_usage_view)
+{
+  ThunarStandardView *standard_view = THUNAR_STANDARD_VIEW (disk_usage_view);
+  GtkWidget          *view = gtk_bin_get_child (GTK_BIN (disk_usage_view));
+
+  /* one folder per row, like a list */
+  exo_icon_view_set_margin (EXO_ICON_VIEW (view), 3);
+  exo_icon_view_set_layout_mode (EXO_ICON_VIEW (view), EXO_ICON_VIEW_LAYOUT_ROWS);
+  exo_icon_view_set_orientation (EXO_ICON_VIEW (view), GTK_ORIENTATION_HORIZONTAL);
+  exo_icon_view_set_columns (EXO_ICON_VIEW (view), 1);
+
+  /* setup the icon renderer */
+  g_object_set (G_OBJECT (standard_view->icon_renderer),
+                "ypad", 2u,
+                NULL);
+
+  /* setup the name renderer */
+  g_object_set (G_OBJECT (standard_view->name_renderer),
+                "xalign", 0.0f,
+                "yalign", 0.5f,
+                "ellipsize", PANGO_ELLIPSIZE_MIDDLE,
+                NULL);
+
+  /* the share of the folder in the total, with the size as text */
+  disk_usage_view->usage_renderer = gtk_cell_renderer_progress_new ();
+  g_object_set (G_OBJECT (disk_usage_view->usage_renderer),
+                "width", 240,
+                "ypad", 4u,
+                NULL);
+  gtk_cell_layout_pack_end (GTK_CELL_LAYOUT (view), disk_usage_view->usage_renderer, FALSE);
+  gtk_cell_layout_set_cell_data_func (GTK_CELL_LAYOUT (view), disk_usage_view->usage_renderer,
+                                      thunar_disk_usage_view_usage_data_func, disk_usage_view, NULL);
+
+  /* folders show and sort by everything below them */
+  thunar_list_model_set_disk_usage (THUNAR_LIST_MODEL (standard_view->model), TRUE);
+
+  /* count the sub folders once the folder is loaded, and again when it changes */
+  g_signal_connect (G_OBJECT (disk_usage_view), "notify::loading", G_CALLBACK (thunar_disk_usage_view_schedule_scan), NULL);
+  g_signal_connect_swapped (G_OBJECT (standard_view->model), "row-inserted", G_CALLBACK (thunar_disk_usage_view_schedule_scan), disk_usage_view);
+  g_signal_connect_swapped (G_OBJECT (standard_view->model), "row-deleted", G_CALLBACK (thunar_disk_usage_view_schedule_scan), disk_usage_view);
+
+  /* a grown folder changes the share of all the other rows */
+  g_signal_connect_swapped (G_OBJECT (standard_view->model), "row-changed", G_CALLBACK (thunar_disk_usage_view_row_changed), disk_usage_view);
+}
+
+
+
+static void
+thunar_disk_usage_view_dispose (GObject *object)
+{
+  ThunarDiskUsageView *disk_usage_view = THUNAR_DISK_USAGE_VIEW (object);
+
+  if (G_UNLIKELY (disk_usage_view->scan_timer_id != 0))
+    {
+      g_source_remove (disk_usage_view->scan_timer_id);
+      disk_usage_view->scan_timer_id = 0;
+    }
+
+  /* stop counting, the results stay cached */
+  thunar_disk_usage_scan (disk_usage_view, NULL);
+
+  (*G_OBJECT_CLASS (thunar_disk_usage_view_parent_class)->dispose) (object);
+}
+
+
+
+static AtkObject*
+thunar_disk_usage_view_get_accessible (GtkWidget *widget)
+{
+  AtkObject *object;
+
+  /* query the atk object for the icon view class */
+  object = (*GTK_WIDGET_CLASS (thunar_disk_usage_view_parent_class)->get_accessible) (widget);
+
+  /* set custom Atk properties for the icon view */
+  if (G_LIKELY (object != NULL))
+    {
+      atk_object_set_description (object, _("Directory listing by disk usage"));
+      atk_object_set_name (object, _("Disk usage view"));
+      atk_object_set_role (object, ATK_ROLE_DIRECTORY_PANE);
+    }
+
+  return object;
+}
+
+
+
+static void
+thunar_disk_usage_view_usage_data_func (GtkCellLayout   *layout,
+                                        GtkCellRenderer *cell,
+                                        GtkTreeModel    *model,
+                                        GtkTreeIter     *iter,
+                                        gpointer         data)
+{
+  ThunarFile *file;
+  guint64     total;
+  gchar      *size_string;
+  gint        percent = 0;
+
+  gtk_tree_model_get (model, iter,
+                      THUNAR_COLUMN_FILE, &file,
+                      THUNAR_COLUMN_SIZE, &size_string,
+                      -1);
+
+  total = thunar_disk_usage_get_total (data);
+  if (G_LIKELY (file != NULL) && total > 0)
+    percent = (gint) (thunar_disk_usage_get_size (file, NULL) * 100 / total);
+
+  g_object_set (G_OBJECT (cell),
+                "value", CLAMP (percent, 0, 100),
+                "text", size_string,
+                NULL);
+
+  g_free (size_string);
+  if (G_LIKELY (file != NULL))
+    g_object_unref (file);
+}
+
+
+
+static gboolean
+thunar_disk_usage_view_collect (GtkTreeModel *model,
+                                GtkTreePath  *path,
+                                GtkTreeIter  *iter,
+                                gpointer      data)
+{
+  GList     **files = data;
+  ThunarFile *file;
+
+  gtk_tree_model_get (model, iter, THUNAR_COLUMN_FILE, &file, -1);
+  if (G_LIKELY (file != NULL))
+    *files = g_list_prepend (*files, file);
+
+  return FALSE;
+}
+
+
+
+static gboolean
+thunar_disk_usage_view_scan_timer (gpointer user_data)
+{
+  ThunarDiskUsageView *disk_usage_view = THUNAR_DISK_USAGE_VIEW (user_data);
+  GList               *files = NULL;
+
+  disk_usage_view->scan_timer_id = 0;
+
+  /* the rows of the model, without the hidden files unless they are shown */
+  gtk_tree_model_foreach (GTK_TREE_MODEL (THUNAR_STANDARD_VIEW (disk_usage_view)->model),
+                          thunar_disk_usage_view_collect, &files);
+  files = g_list_reverse (files);
+
+  thunar_disk_usage_scan (disk_usage_view, files);
+  thunar_g_list_free_full (files);
+
+  gtk_widget_queue_draw (gtk_bin_get_child (GTK_BIN (disk_usage_view)));
+
+  return FALSE;
+}
+
+
+
+static void
+thunar_disk_usage_view_schedule_scan (ThunarDiskUsageView *disk_usage_view)
+{
+  _thunar_return_if_fail (THUNAR_IS_DISK_USAGE_VIEW (disk_usage_view));
+
+  /* wait for the folder to be loaded completely */
+  if (thunar_view_get_loading (THUNAR_VIEW (disk_usage_view)))
+    return;
+
+  /* collect the changes of a moment, e.g. when many files are added */
+  if (disk_usage_view->scan_timer_id == 0)
+    disk_usage_view->scan_timer_id = g_timeout_add (THUNAR_DISK_USAGE_VIEW_RESCAN_DELAY, thunar_disk_usage_view_scan_timer, disk_usage_view);
+}
+
+
+
+static void
+thunar_disk_usage_view_row_changed (ThunarDiskUsageView *disk_usage_view)
+{
+  _thunar_return_if_fail (THUNAR_IS_DISK_USAGE_VIEW (disk_usage_view));
+
+  gtk_widget_queue_draw (gtk_bin_get_child (GTK_BIN (disk_usage_view)));
+}
@@ -0,0 +1,38 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __THUNAR_DISK_USAGE_VIEW_H__
+#define __THUNAR_DISK_USAGE_VIEW_H__
+
+#include "thunar/thunar-abstract-icon-view.h"
+
+G_BEGIN_DECLS;
+
+typedef struct _ThunarDiskUsageViewClass ThunarDiskUsageViewClass;
+typedef struct _ThunarDiskUsageView      ThunarDiskUsageView;
+
+#define THUNAR_TYPE_DISK_USAGE_VIEW             (thunar_disk_usage_view_get_type ())
+#define THUNAR_DISK_USAGE_VIEW(obj)             (G_TYPE_CHECK_INSTANCE_CAST ((obj), THUNAR_TYPE_DISK_USAGE_VIEW, ThunarDiskUsageView))
+#define THUNAR_DISK_USAGE_VIEW_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST ((klass), THUNAR_TYPE_DISK_USAGE_VIEW, ThunarDiskUsageViewClass))
+#define THUNAR_IS_DISK_USAGE_VIEW(obj)          (G_TYPE_CHECK_INSTANCE_TYPE ((obj), THUNAR_TYPE_DISK_USAGE_VIEW))
+#define THUNAR_IS_DISK_USAGE_VIEW_CLASS(klass)  (G_TYPE_CHECK_CLASS_TYPE ((klass), THUNAR_TYPE_DISK_USAGE_VIEW))
+#define THUNAR_DISK_USAGE_VIEW_GET_CLASS(obj)   (G_TYPE_INSTANCE_GET_CLASS ((obj), THUNAR_TYPE_DISK_USAGE_VIEW, ThunarDiskUsageViewClass))
+
+GType thunar_disk_usage_view_get_type (void) G_GNUC_CONST;
+
+G_END_DECLS;
+
+#endif /* !__THUNAR_DISK_USAGE_VIEW_H__ */
@@ -0,0 +1,540 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The disk usage engine determines the cumulative size of the folders
+ * shown by the disk usage view. Each owner scans the files of one folder,
+ * see thunar_disk_usage_scan(), and the sub folders are counted by
+ * ThunarDeepCountJob<!---->s, a few at the same time. The sizes counted so
+ * far are published while the jobs run, and every update lets the file
+ * emit "changed", so the rows re-sort and redraw as the counts fill in.
+ *
+ * The results are kept per filesystem after the view went away, so
+ * opening the view again shows the last counts right away. Counts older
+ * than THUNAR_DISK_USAGE_MAX_AGE are refreshed in the background, which
+ * is cheap since the deep count job caches the unchanged folders. The
+ * counts of a filesystem are dropped once it is unmounted. Everything
+ * here runs in the main thread. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "thunar/thunar-deep-count-job.h"
+#include "thunar/thunar-disk-usage.h"
+#include "thunar/thunar-gio-extensions.h"
+#include "thunar/thunar-preferences.h"
+#include "thunar/thunar-private.h"
+
+
+
+/* maximum number of folders counted at the same time, each job walks its
+ * folder with several threads already */
+#define THUNAR_DISK_USAGE_MAX_RUNNING (2)
+
+/* counts older than this are refreshed when a folder is scanned again */
+#define THUNAR_DISK_USAGE_MAX_AGE     (30 * G_USEC_PER_SEC)
+
+/* bounds of the cache, a full filesystem is cleared, and the least
+ * recently used filesystem is dropped when there are too many */
+#define THUNAR_DISK_USAGE_MAX_ENTRIES (4096)
+#define THUNAR_DISK_USAGE_MAX_MOUNTS  (16)
+
+
+
+typedef struct
+{
+  guint64 size;
+  gint64  counted_at; /* monotonic time of the last complete count, 0 while the size is partial */
+}
+ThunarDiskUsageEntry;
+
+typedef struct
+{
+  GHashTable *entries; /* GFile -> ThunarDiskUsageEntry */
+  gint64      used_at;
+}
+ThunarDiskUsageMount;
+
+typedef struct
+{
+  GList      *files;   /* the files shown by the owner */
+  GQueue      pending; /* folders waiting to be counted */
+  GHashTable *running; /* ThunarFile -> ThunarDiskUsageRequest */
+  guint64     total;
+}
+ThunarDiskUsageScan;
+
+typedef struct
+{
+  ThunarDiskUsageScan *scan; /* NULL once the owner lost interest */
+  ThunarFile          *file;
+  ThunarDeepCountJob  *job;
+  guint64              size; /* counted so far */
+}
+ThunarDiskUsageRequest;
+
+static void thunar_disk_usage_dispatch (void);
+
+
+
+/* filesystem id -> ThunarDiskUsageMount */
+static GHashTable     *mounts = NULL;
+
+/* owner -> ThunarDiskUsageScan */
+static GHashTable     *scans = NULL;
+
+/* all ThunarDiskUsageRequest<!---->s with a running job */
+static GHashTable     *running_requests = NULL;
+
+static GVolumeMonitor *volume_monitor = NULL;
+
+
+
+static void
+thunar_disk_usage_mount_free (gpointer data)
+{
+  ThunarDiskUsageMount *mount = data;
+
+  g_hash_table_destroy (mount->entries);
+  g_free (mount);
+}
+
+
+
+static void
+thunar_disk_usage_mount_removed (GVolumeMonitor *monitor,
+                                 GMount         *gmount,
+                                 gpointer        user_data)
+{
+  ThunarDiskUsageMount *mount;
+  GHashTableIter        mount_iter;
+  GHashTableIter        iter;
+  GFile                *root;
+  GFile                *key;
+
+  /* the counts are of no use once the filesystem is gone */
+  root = g_mount_get_root (gmount);
+  g_hash_table_iter_init (&mount_iter, mounts);
+  while (g_hash_table_iter_next (&mount_iter, NULL, (gpointer *) &mount))
+    {
+      g_hash_table_iter_init (&iter, mount->entries);
+      while (g_hash_table_iter_next (&iter, (gpointer *) &key, NULL))
+        if (g_file_equal (key, root) || g_file_has_prefix (key, root))
+          g_hash_table_iter_remove (&iter);
+    }
+  g_object_unref (root);
+}
+
+
+
+static void
+thunar_disk_usage_init (void)
+{
+  if (G_LIKELY (mounts != NULL))
+    return;
+
+  mounts = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, thunar_disk_usage_mount_free);
+  scans = g_hash_table_new (g_direct_hash, g_direct_equal);
+  running_requests = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  /* kept for the lifetime of the process */
+  volume_monitor = g_volume_monitor_get ();
+  g_signal_connect (volume_monitor, "mount-removed", G_CALLBACK (thunar_disk_usage_mount_removed), NULL);
+}
+
+
+
+static ThunarDiskUsageEntry*
+thunar_disk_usage_lookup (ThunarFile *file,
+                          gboolean    create)
+{
+  ThunarDiskUsageMount *mount;
+  ThunarDiskUsageMount *oldest;
+  ThunarDiskUsageEntry *entry;
+  GHashTableIter        iter;
+  const gchar          *filesystem_id = NULL;
+  const gchar          *oldest_id = NULL;
+  const gchar          *id;
+  GFileInfo            *info;
+
+  info = thunar_file_get_info (file);
+  if (G_LIKELY (info != NULL))
+    filesystem_id = g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILESYSTEM);
+  if (G_UNLIKELY (filesystem_id == NULL))
+    filesystem_id = "";
+
+  mount = g_hash_table_lookup (mounts, filesystem_id);
+  if (mount == NULL)
+    {
+      if (!create)
+        return NULL;
+
+      if (g_hash_table_size (mounts) >= THUNAR_DISK_USAGE_MAX_MOUNTS)
+        {
+          oldest = NULL;
+          g_hash_table_iter_init (&iter, mounts);
+          while (g_hash_table_iter_next (&iter, (gpointer *) &id, (gpointer *) &mount))
+            if (oldest == NULL || mount->used_at < oldest->used_at)
+              {
+                oldest = mount;
+                oldest_id = id;
+              }
+          g_hash_table_remove (mounts, oldest_id);
+        }
+
+      mount = g_new0 (ThunarDiskUsageMount, 1);
+      mount->entries = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal, g_object_unref, g_free);
+      g_hash_table_insert (mounts, g_strdup (filesystem_id), mount);
+    }
+
+  entry = g_hash_table_lookup (mount->entries, thunar_file_get_file (file));
+  if (entry == NULL && create)
+    {
+      if (g_hash_table_size (mount->entries) >= THUNAR_DISK_USAGE_MAX_ENTRIES)
+        g_hash_table_remove_all (mount->entries);
+
+      entry = g_new0 (ThunarDiskUsageEntry, 1);
+      g_hash_table_insert (mount->entries, g_object_ref (thunar_file_get_file (file)), entry);
+    }
+
+  if (entry != NULL)
+    mount->used_at = g_get_monotonic_time ();
+
+  return entry;
+}
+
+
+
+static void
+thunar_disk_usage_scan_update_total (ThunarDiskUsageScan *scan)
+{
+  GList *lp;
+
+  scan->total = 0;
+  for (lp = scan->files; lp != NULL; lp = lp->next)
+    scan->total += thunar_disk_usage_get_size (lp->data, NULL);
+}
+
+
+
+static void
+thunar_disk_usage_request_free (ThunarDiskUsageRequest *request)
+{
+  g_signal_handlers_disconnect_by_data (request->job, request);
+  g_object_unref (request->job);
+  g_object_unref (request->file);
+  g_free (request);
+}
+
+
+
+static void
+thunar_disk_usage_request_detach (ThunarDiskUsageRequest *request)
+{
+  /* the slot is freed once the job finished */
+  exo_job_cancel (EXO_JOB (request->job));
+  request->scan = NULL;
+}
+
+
+
+static void
+thunar_disk_usage_status_update (ThunarDeepCountJob     *job,
+                                 guint64                 total_size,
+                                 guint64                 total_size_on_disk,
+                                 guint                   file_count,
+                                 guint                   directory_count,
+                                 guint                   unreadable_directory_count,
+                                 ThunarDiskUsageRequest *request)
+{
+  ThunarDiskUsageEntry *entry;
+
+  request->size = (total_size_on_disk != (guint64) -1) ? total_size_on_disk : total_size;
+
+  if (request->scan == NULL || exo_job_is_cancelled (EXO_JOB (job)))
+    return;
+
+  /* a previous count is shown until the new one completes, so that
+   * the row does not jump to the end and back */
+  entry = thunar_disk_usage_lookup (request->file, TRUE);
+  if (entry->counted_at != 0 || entry->size == request->size)
+    return;
+
+  entry->size = request->size;
+  thunar_disk_usage_scan_update_total (request->scan);
+  thunar_file_changed (request->file);
+}
+
+
+
+static void
+thunar_disk_usage_finished (ExoJob                 *job,
+                            ThunarDiskUsageRequest *request)
+{
+  ThunarDiskUsageEntry *entry;
+
+  /* the job emits the final counts right before it finishes */
+  if (request->scan != NULL && !exo_job_is_cancelled (job))
+    {
+      entry = thunar_disk_usage_lookup (request->file, TRUE);
+      entry->counted_at = g_get_monotonic_time ();
+      if (entry->size != request->size)
+        {
+          entry->size = request->size;
+          thunar_disk_usage_scan_update_total (request->scan);
+          thunar_file_changed (request->file);
+        }
+    }
+
+  if (request->scan != NULL)
+    g_hash_table_remove (request->scan->running, request->file);
+
+  g_hash_table_remove (running_requests, request);
+  thunar_disk_usage_request_free (request);
+
+  thunar_disk_usage_dispatch ();
+}
+
+
+
+static void
+thunar_disk_usage_dispatch (void)
+{
+  ThunarDiskUsageRequest *request;
+  ThunarDiskUsageScan    *scan;
+  ThunarPreferences      *preferences;
+  GHashTableIter          iter;
+  gboolean                shared_extents;
+  gboolean                dispatched;
+  GList                   files;
+
+  preferences = thunar_preferences_get ();
+  g_object_get (preferences, "misc-size-on-disk-shared-extents", &shared_extents, NULL);
+  g_object_unref (preferences);
+
+  /* take turns between the owners, so that every view makes progress */
+  do
+    {
+      dispatched = FALSE;
+      g_hash_table_iter_init (&iter, scans);
+      while (g_hash_table_size (running_requests) < THUNAR_DISK_USAGE_MAX_RUNNING
+             && g_hash_table_iter_next (&iter, NULL, (gpointer *) &scan))
+        {
+          if (g_queue_is_empty (&scan->pending))
+            continue;
+
+          request = g_new0 (ThunarDiskUsageRequest, 1);
+          request->scan = scan;
+          request->file = g_queue_pop_head (&scan->pending); /* takes over the reference */
+
+          files.data = request->file;
+          files.next = NULL;
+          files.prev = NULL;
+          request->job = thunar_deep_count_job_new (&files, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS);
+          thunar_job_set_priority (THUNAR_JOB (request->job), THUNAR_JOB_PRIORITY_BULK);
+          thunar_deep_count_job_set_shared_extents (request->job, shared_extents);
+
+          g_hash_table_insert (scan->running, request->file, request);
+          g_hash_table_add (running_requests, request);
+
+          g_signal_connect (request->job, "status-update", G_CALLBACK (thunar_disk_usage_status_update), request);
+          g_signal_connect (request->job, "finished", G_CALLBACK (thunar_disk_usage_finished), request);
+          exo_job_launch (EXO_JOB (request->job));
+
+          dispatched = TRUE;
+        }
+    }
+  while (dispatched && g_hash_table_size (running_requests) < THUNAR_DISK_USAGE_MAX_RUNNING);
+}
+
+
+
+/**
+ * thunar_disk_usage_scan:
+ * @owner : the view showing @files.
+ * @files : the #GList of #ThunarFile<!---->s shown by @owner, or %NULL
+ *          if it shows none, e.g. because it is destroyed.
+ *
+ * Replaces the files shown by @owner and counts the cumulative size of
+ * the folders among them whose size is not known or older than a few
+ * seconds. Counts of folders @owner no longer shows are stopped. While
+ * the counts run, the folders emit "changed" whenever their size grows.
+ **/
+void
+thunar_disk_usage_scan (gpointer owner,
+                        GList   *files)
+{
+  ThunarDiskUsageRequest *request;
+  ThunarDiskUsageEntry   *entry;
+  ThunarDiskUsageScan    *scan;
+  GHashTableIter          iter;
+  GHashTable             *shown;
+  GList                  *lp;
+  gint64                  now;
+
+  _thunar_return_if_fail (owner != NULL);
+
+  thunar_disk_usage_init ();
+
+  scan = g_hash_table_lookup (scans, owner);
+  if (scan == NULL)
+    {
+      if (files == NULL)
+        return;
+
+      scan = g_new0 (ThunarDiskUsageScan, 1);
+      g_queue_init (&scan->pending);
+      scan->running = g_hash_table_new (g_direct_hash, g_direct_equal);
+      g_hash_table_insert (scans, owner, scan);
+    }
+
+  /* forget the folders waiting for the previous files */
+  g_queue_free_full (&scan->pending, g_object_unref);
+  g_queue_init (&scan->pending);
+  thunar_g_list_free_full (scan->files);
+  scan->files = thunar_g_list_copy_deep (files);
+
+  /* stop the counts of the folders which are no longer shown */
+  shown = g_hash_table_new (g_direct_hash, g_direct_equal);
+  for (lp = files; lp != NULL; lp = lp->next)
+    g_hash_table_add (shown, lp->data);
+  g_hash_table_iter_init (&iter, scan->running);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &request))
+    if (!g_hash_table_contains (shown, request->file))
+      {
+        thunar_disk_usage_request_detach (request);
+        g_hash_table_iter_remove (&iter);
+      }
+  g_hash_table_destroy (shown);
+
+  if (files == NULL)
+    {
+      g_hash_table_destroy (scan->running);
+      g_hash_table_remove (scans, owner);
+      g_free (scan);
+      return;
+    }
+
+  /* queue the folders whose size is unknown or outdated */
+  now = g_get_monotonic_time ();
+  for (lp = files; lp != NULL; lp = lp->next)
+    {
+      if (!thunar_file_is_directory (lp->data)
+          || g_hash_table_contains (scan->running, lp->data))
+        continue;
+
+      entry = thunar_disk_usage_lookup (lp->data, FALSE);
+      if (entry == NULL || entry->counted_at == 0 || now - entry->counted_at > THUNAR_DISK_USAGE_MAX_AGE)
+        g_queue_push_tail (&scan->pending, g_object_ref (lp->data));
+    }
+
+  thunar_disk_usage_scan_update_total (scan);
+  thunar_disk_usage_dispatch ();
+}
+
+
+
+/**
+ * thunar_disk_usage_get_size:
+ * @file     : a #ThunarFile.
+ * @complete : return location for whether the size is final, or %NULL.
+ *
+ * Returns the cumulative size of @file on disk. For folders this is
+ * the size counted so far, or 0 if the folder was not counted yet,
+ * and @complete is set to %FALSE until the count finished.
+ *
+ * Return value: the size of @file in bytes.
+ **/
+guint64
+thunar_disk_usage_get_size (ThunarFile *file,
+                            gboolean   *complete)
+{
+  ThunarDiskUsageEntry *entry;
+  guint64               size;
+
+  _thunar_return_val_if_fail (THUNAR_IS_FILE (file), 0);
+
+  if (!thunar_file_is_directory (file))
+    {
+      if (complete != NULL)
+        *complete = TRUE;
+
+      size = thunar_file_get_size_on_disk (file);
+      return (size != (guint64) -1) ? size : thunar_file_get_size (file);
+    }
+
+  entry = (mounts != NULL) ? thunar_disk_usage_lookup (file, FALSE) : NULL;
+
+  if (complete != NULL)
+    *complete = (entry != NULL && entry->counted_at != 0);
+
+  return (entry != NULL) ? entry->size : 0;
+}
+
+
+
+/**
+ * thunar_disk_usage_get_total:
+ * @owner : the view passed to thunar_disk_usage_scan().
+ *
+ * Returns the sum of the sizes of the files shown by @owner, as far as
+ * they are counted.
+ *
+ * Return value: the total size in bytes.
+ **/
+guint64
+thunar_disk_usage_get_total (gpointer owner)
+{
+  ThunarDiskUsageScan *scan;
+
+  if (G_UNLIKELY (scans == NULL))
+    return 0;
+
+  scan = g_hash_table_lookup (scans, owner);
+  return (scan != NULL) ? scan->total : 0;
+}
+
+
+
+/**
+ * thunar_disk_usage_compare:
+ * @a              : a #ThunarFile.
+ * @b              : a #ThunarFile.
+ * @case_sensitive : whether to compare the names case sensitive.
+ *
+ * Compares @a and @b by their cumulative size on disk, see
+ * thunar_disk_usage_get_size(), and by name if the sizes are equal.
+ *
+ * Return value: -1, 0 or 1.
+ **/
+gint
+thunar_disk_usage_compare (const ThunarFile *a,
+                           const ThunarFile *b,
+                           gboolean          case_sensitive)
+{
+  guint64 size_a;
+  guint64 size_b;
+
+  size_a = thunar_disk_usage_get_size (THUNAR_FILE (a), NULL);
+  size_b = thunar_disk_usage_get_size (THUNAR_FILE (b), NULL);
+
+  if (size_a < size_b)
+    return -1;
+  else if (size_a > size_b)
+    return 1;
+
+  return thunar_file_compare_by_name (a, b, case_sensitive);
+}
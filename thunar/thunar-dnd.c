@@ -30,11 +30,18 @@
 #include "thunar/thunar-application.h"
 #include "thunar/thunar-dialogs.h"
 #include "thunar/thunar-dnd.h"
+#include "thunar/thunar-gio-extensions.h"
 #include "thunar/thunar-gtk-extensions.h"
 #include "thunar/thunar-private.h"
 
 
 
+/* the files of the drag started in this process (if any) */
+static GtkWidget *dnd_source_widget = NULL;
+static GList     *dnd_source_files = NULL;
+
+
+
 static void
 dnd_action_selected (GtkWidget     *item,
                      GdkDragAction *dnd_action_return)
@@ -290,3 +297,58 @@ thunar_dnd_perform (GtkWidget    *widget,
 
 
 
+/**
+ * thunar_dnd_set_source_files:
+ * @source_widget : the #GtkWidget a drag was started on or %NULL.
+ * @file_list     : the #GFile<!---->s being dragged.
+ *
+ * Remembers the @file_list of a drag started on @source_widget, so
+ * drop targets in this process can take the files from
+ * thunar_dnd_dup_source_files() instead of receiving them as text and
+ * parsing them again. Call it with %NULL once the drag ended.
+ **/
+void
+thunar_dnd_set_source_files (GtkWidget *source_widget,
+                             GList     *file_list)
+{
+  _thunar_return_if_fail (source_widget == NULL || GTK_IS_WIDGET (source_widget));
+
+  if (dnd_source_widget != NULL)
+    g_object_remove_weak_pointer (G_OBJECT (dnd_source_widget), (gpointer) &dnd_source_widget);
+  thunar_g_list_free_full (dnd_source_files);
+
+  dnd_source_widget = source_widget;
+  dnd_source_files = (source_widget != NULL) ? thunar_g_list_copy_deep (file_list) : NULL;
+
+  if (dnd_source_widget != NULL)
+    g_object_add_weak_pointer (G_OBJECT (dnd_source_widget), (gpointer) &dnd_source_widget);
+}
+
+
+
+/**
+ * thunar_dnd_dup_source_files:
+ * @context : the #GdkDragContext of a drag over a drop target.
+ *
+ * Looks up the files of the drag behind @context, if it was started
+ * in this process with thunar_dnd_set_source_files().
+ *
+ * The caller is responsible to free the returned list using
+ * thunar_g_list_free_full() when no longer needed.
+ *
+ * Return value: a copy of the dragged #GFile<!---->s or %NULL if
+ *               the data has to be requested from the source.
+ **/
+GList *
+thunar_dnd_dup_source_files (GdkDragContext *context)
+{
+  _thunar_return_val_if_fail (GDK_IS_DRAG_CONTEXT (context), NULL);
+
+  if (dnd_source_widget == NULL || dnd_source_files == NULL)
+    return NULL;
+
+  if (gtk_drag_get_source_widget (context) != dnd_source_widget)
+    return NULL;
+
+  return thunar_g_list_copy_deep (dnd_source_files);
+}
@@ -35,6 +35,10 @@ gboolean      thunar_dnd_perform (GtkWidget    *widget,
                                   GdkDragAction action,
                                   GClosure     *new_files_closure);
 
+void          thunar_dnd_set_source_files (GtkWidget      *source_widget,
+                                           GList          *file_list);
+GList        *thunar_dnd_dup_source_files (GdkDragContext *context) G_GNUC_WARN_UNUSED_RESULT;
+
 G_END_DECLS;
 
 #endif /* !__THUNAR_DND_H__ */
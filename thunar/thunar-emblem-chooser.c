@@ -32,13 +32,20 @@
 
 #include "thunar/thunar-application.h"
 #include "thunar/thunar-emblem-chooser.h"
+#include "thunar/thunar-gdk-extensions.h"
 #include "thunar/thunar-gobject-extensions.h"
+#include "thunar/thunar-icon-factory.h"
 #include "thunar/thunar-io-jobs.h"
 #include "thunar/thunar-private.h"
 #include "thunar/thunar-util.h"
 #include "thunar/thunar-window.h"
 
 
+/* the size of the emblem icons */
+#define THUNAR_EMBLEM_CHOOSER_ICON_SIZE (48)
+
+
+
 /* Property identifiers */
 enum
 {
@@ -62,6 +69,7 @@ static void       thunar_emblem_chooser_scale_changed   (GObject
                                                          gpointer                   user_data);
 static void       thunar_emblem_chooser_realize         (GtkWidget                 *widget);
 static void       thunar_emblem_chooser_unrealize       (GtkWidget                 *widget);
+static void       thunar_emblem_chooser_map             (GtkWidget                 *widget);
 static void       thunar_emblem_chooser_button_toggled  (GtkToggleButton           *button,
                                                          ThunarEmblemChooser       *chooser);
 static void       thunar_emblem_chooser_file_changed    (ThunarEmblemChooser       *chooser);
@@ -70,6 +78,9 @@ static void       thunar_emblem_chooser_theme_changed   (GtkIconTheme
 static void       thunar_emblem_chooser_create_buttons  (ThunarEmblemChooser       *chooser);
 static GtkWidget *thunar_emblem_chooser_create_button   (ThunarEmblemChooser       *chooser,
                                                          const gchar               *emblem);
+static gboolean   thunar_emblem_chooser_image_draw      (GtkWidget                 *image,
+                                                         cairo_t                   *cr,
+                                                         ThunarEmblemChooser       *chooser);
 static GList     *thunar_emblem_chooser_get_files       (const ThunarEmblemChooser *chooser);
 static void       thunar_emblem_chooser_set_files       (ThunarEmblemChooser       *chooser,
                                                          GList                     *files);
@@ -88,6 +99,7 @@ struct _ThunarEmblemChooser
   GtkIconTheme *icon_theme;
   GList        *files;
   GtkWidget    *table;
+  gboolean      buttons_created;
 
   ThunarJob    *emblem_change_job;
   gulong        emblem_change_job_finish_signal;
@@ -95,6 +107,18 @@ struct _ThunarEmblemChooser
 
 
 
+typedef struct
+{
+  gchar    **names;   /* the sorted emblems the user can choose, %NULL until listed */
+}
+ThunarEmblemList;
+
+
+
+static GQuark thunar_emblem_chooser_list_quark = 0;
+
+
+
 G_DEFINE_TYPE (ThunarEmblemChooser, thunar_emblem_chooser, GTK_TYPE_SCROLLED_WINDOW)
 
 
@@ -113,6 +137,9 @@ thunar_emblem_chooser_class_init (ThunarEmblemChooserClass *klass)
   gtkwidget_class = GTK_WIDGET_CLASS (klass);
   gtkwidget_class->realize = thunar_emblem_chooser_realize;
   gtkwidget_class->unrealize = thunar_emblem_chooser_unrealize;
+  gtkwidget_class->map = thunar_emblem_chooser_map;
+
+  thunar_emblem_chooser_list_quark = g_quark_from_static_string ("thunar-emblem-chooser-list");
 
   /**
    * ThunarEmblemChooser::file:
@@ -227,7 +254,104 @@ thunar_emblem_chooser_scale_changed (GObject    *object,
                                      GParamSpec *pspec,
                                      gpointer    user_data)
 {
-    gtk_widget_queue_draw (GTK_WIDGET (object));
+  ThunarEmblemChooser *chooser = THUNAR_EMBLEM_CHOOSER (object);
+  GList               *children;
+  GList               *lp;
+  GtkWidget           *child;
+
+  /* load the icons again at the new scale when they are drawn next */
+  children = gtk_container_get_children (GTK_CONTAINER (chooser->table));
+  for (lp = children; lp != NULL; lp = lp->next)
+    {
+      child = lp->data;
+      if (GTK_IS_FLOW_BOX_CHILD (child))
+        child = gtk_bin_get_child (GTK_BIN (child));
+      gtk_image_clear (GTK_IMAGE (gtk_bin_get_child (GTK_BIN (child))));
+    }
+  g_list_free (children);
+
+  gtk_widget_queue_draw (GTK_WIDGET (object));
+}
+
+
+
+static void
+thunar_emblem_list_free (gpointer data)
+{
+  ThunarEmblemList *list = data;
+
+  g_strfreev (list->names);
+  g_slice_free (ThunarEmblemList, list);
+}
+
+
+
+static void
+thunar_emblem_list_theme_changed (GtkIconTheme     *icon_theme,
+                                  ThunarEmblemList *list)
+{
+  /* listed again when the next chooser is shown */
+  g_strfreev (list->names);
+  list->names = NULL;
+}
+
+
+
+/* returns the emblems of @icon_theme shared by all choosers, listed on first use */
+static ThunarEmblemList*
+thunar_emblem_list_get (GtkIconTheme *icon_theme)
+{
+  ThunarEmblemList *list;
+
+  list = g_object_get_qdata (G_OBJECT (icon_theme), thunar_emblem_chooser_list_quark);
+  if (G_UNLIKELY (list == NULL))
+    {
+      /* connected before the handlers of the choosers, so they find the new list */
+      list = g_slice_new0 (ThunarEmblemList);
+      g_signal_connect (G_OBJECT (icon_theme), "changed", G_CALLBACK (thunar_emblem_list_theme_changed), list);
+      g_object_set_qdata_full (G_OBJECT (icon_theme), thunar_emblem_chooser_list_quark, list, thunar_emblem_list_free);
+    }
+
+  return list;
+}
+
+
+
+static const gchar * const *
+thunar_emblem_list_get_names (ThunarEmblemList *list,
+                              GtkIconTheme     *icon_theme)
+{
+  GPtrArray *names;
+  GList     *emblems;
+  GList     *lp;
+
+  if (list->names != NULL)
+    return (const gchar * const *) list->names;
+
+  /* determine the emblems for the icon theme */
+  emblems = gtk_icon_theme_list_icons (icon_theme, "Emblems");
+
+  /* sort the emblem list */
+  emblems = g_list_sort (emblems, (GCompareFunc) (void (*)(void)) g_ascii_strcasecmp);
+
+  names = g_ptr_array_new ();
+  for (lp = emblems; lp != NULL; lp = lp->next)
+    {
+      /* skip special emblems, as they cannot be selected */
+      if (strcmp (lp->data, THUNAR_FILE_EMBLEM_NAME_SYMBOLIC_LINK) != 0
+          && strcmp (lp->data, THUNAR_FILE_EMBLEM_NAME_CANT_READ) != 0
+          && strcmp (lp->data, THUNAR_FILE_EMBLEM_NAME_CANT_WRITE) != 0
+          && strcmp (lp->data, THUNAR_FILE_EMBLEM_NAME_DESKTOP) != 0)
+        g_ptr_array_add (names, lp->data);
+      else
+        g_free (lp->data);
+    }
+  g_ptr_array_add (names, NULL);
+  g_list_free (emblems);
+
+  list->names = (gchar **) g_ptr_array_free (names, FALSE);
+
+  return (const gchar * const *) list->names;
 }
 
 
@@ -242,13 +366,25 @@ thunar_emblem_chooser_realize (GtkWidget *widget)
 
   /* determine the icon theme for the new screen */
   chooser->icon_theme = gtk_icon_theme_get_for_screen (gtk_widget_get_screen (widget));
+  thunar_emblem_list_get (chooser->icon_theme);
   g_signal_connect (G_OBJECT (chooser->icon_theme), "changed",
                     G_CALLBACK (thunar_emblem_chooser_theme_changed),
                     chooser);
   g_object_ref (G_OBJECT (chooser->icon_theme));
+}
+
+
+
+static void
+thunar_emblem_chooser_map (GtkWidget *widget)
+{
+  ThunarEmblemChooser *chooser = THUNAR_EMBLEM_CHOOSER (widget);
 
-  /* create the emblem buttons */
-  thunar_emblem_chooser_create_buttons (chooser);
+  (*GTK_WIDGET_CLASS (thunar_emblem_chooser_parent_class)->map) (widget);
+
+  /* the emblem buttons are created once the emblems tab is shown */
+  if (!chooser->buttons_created)
+    thunar_emblem_chooser_create_buttons (chooser);
 }
 
 
@@ -262,6 +398,7 @@ thunar_emblem_chooser_unrealize (GtkWidget *widget)
   gtk_container_foreach (GTK_CONTAINER (chooser->table),
                          (GtkCallback) (void (*)(void)) gtk_widget_destroy,
                          NULL);
+  chooser->buttons_created = FALSE;
 
   /* release our reference on the icon theme */
   g_signal_handlers_disconnect_by_func (G_OBJECT (chooser->icon_theme), thunar_emblem_chooser_theme_changed, chooser);
@@ -452,9 +589,11 @@ thunar_emblem_chooser_theme_changed (GtkIconTheme        *icon_theme,
   gtk_container_foreach (GTK_CONTAINER (chooser->table),
                          (GtkCallback) (void (*)(void)) gtk_widget_destroy,
                          NULL);
+  chooser->buttons_created = FALSE;
 
-  /* create buttons for the new theme */
-  thunar_emblem_chooser_create_buttons (chooser);
+  /* create buttons for the new theme, or once the chooser is shown */
+  if (gtk_widget_get_mapped (GTK_WIDGET (chooser)))
+    thunar_emblem_chooser_create_buttons (chooser);
 }
 
 
@@ -462,36 +601,21 @@ thunar_emblem_chooser_theme_changed (GtkIconTheme        *icon_theme,
 static void
 thunar_emblem_chooser_create_buttons (ThunarEmblemChooser *chooser)
 {
-  GtkWidget *button;
-  GList     *emblems;
-  GList     *lp;
+  const gchar * const *names;
+  GtkWidget           *button;
+  guint                n;
 
-  /* determine the emblems for the icon theme */
-  emblems = gtk_icon_theme_list_icons (chooser->icon_theme, "Emblems");
-
-  /* sort the emblem list */
-  emblems = g_list_sort (emblems, (GCompareFunc) (void (*)(void)) g_ascii_strcasecmp);
+  chooser->buttons_created = TRUE;
 
-  /* create buttons for the emblems */
-  for (lp = emblems; lp != NULL; lp = lp->next)
+  /* create buttons for the emblems, their icons are loaded when they are drawn */
+  names = thunar_emblem_list_get_names (thunar_emblem_list_get (chooser->icon_theme), chooser->icon_theme);
+  for (n = 0; names[n] != NULL; ++n)
     {
-      /* skip special emblems, as they cannot be selected */
-      if (strcmp (lp->data, THUNAR_FILE_EMBLEM_NAME_SYMBOLIC_LINK) != 0
-          && strcmp (lp->data, THUNAR_FILE_EMBLEM_NAME_CANT_READ) != 0
-          && strcmp (lp->data, THUNAR_FILE_EMBLEM_NAME_CANT_WRITE) != 0
-          && strcmp (lp->data, THUNAR_FILE_EMBLEM_NAME_DESKTOP) != 0)
-        {
-          /* create a button and add it to the table */
-          button = thunar_emblem_chooser_create_button (chooser, lp->data);
-          if (G_LIKELY (button != NULL))
-            {
-              gtk_container_add (GTK_CONTAINER (chooser->table), button);
-              gtk_widget_show (button);
-            }
-        }
-      g_free (lp->data);
+      /* create a button and add it to the table */
+      button = thunar_emblem_chooser_create_button (chooser, names[n]);
+      gtk_container_add (GTK_CONTAINER (chooser->table), button);
+      gtk_widget_show (button);
     }
-  g_list_free (emblems);
 
   /* be sure to update the buttons according to the selected file */
   if (G_LIKELY (chooser->files != NULL))
@@ -504,24 +628,9 @@ static GtkWidget*
 thunar_emblem_chooser_create_button (ThunarEmblemChooser *chooser,
                                      const gchar         *emblem)
 {
-  GtkIconInfo     *info;
-  const gchar     *name;
-  GtkWidget       *button = NULL;
-  GtkWidget       *image;
-  GdkPixbuf       *icon;
-  gint             scale_factor;
-  cairo_surface_t *surface;
-
-  /* lookup the icon info for the emblem */
-  scale_factor = gtk_widget_get_scale_factor (GTK_WIDGET (chooser));
-  info = gtk_icon_theme_lookup_icon_for_scale (chooser->icon_theme, emblem, 48, scale_factor, GTK_ICON_LOOKUP_FORCE_SIZE);
-  if (G_UNLIKELY (info == NULL))
-    return NULL;
-
-  /* try to load the icon */
-  icon = gtk_icon_info_load_icon (info, NULL);
-  if (G_UNLIKELY (icon == NULL))
-    goto done;
+  const gchar *name;
+  GtkWidget   *button;
+  GtkWidget   *image;
 
   /* determine the display name for the emblem */
   name = (strncmp (emblem, "emblem-", 7) == 0) ? emblem + 7 : emblem;
@@ -532,22 +641,62 @@ thunar_emblem_chooser_create_button (ThunarEmblemChooser *chooser,
   g_object_set_data_full (G_OBJECT (button), I_("thunar-emblem"), g_strdup (emblem), g_free);
   g_signal_connect (G_OBJECT (button), "toggled", G_CALLBACK (thunar_emblem_chooser_button_toggled), chooser);
 
-  /* allocate the image */
-  surface = gdk_cairo_surface_create_from_pixbuf (icon, scale_factor, gtk_widget_get_window (GTK_WIDGET (chooser)));
-  image = gtk_image_new_from_surface (surface);
+  /* allocate the image, sized for the icon until it is loaded */
+  image = gtk_image_new ();
+  gtk_widget_set_size_request (image, THUNAR_EMBLEM_CHOOSER_ICON_SIZE, THUNAR_EMBLEM_CHOOSER_ICON_SIZE);
+  g_signal_connect (G_OBJECT (image), "draw", G_CALLBACK (thunar_emblem_chooser_image_draw), chooser);
   gtk_container_add (GTK_CONTAINER (button), image);
   gtk_widget_set_tooltip_text (image, name);
   gtk_widget_show (image);
 
-  g_object_unref (G_OBJECT (icon));
-  cairo_surface_destroy (surface);
-done:
-  g_object_unref (info);
   return button;
 }
 
 
 
+static gboolean
+thunar_emblem_chooser_image_draw (GtkWidget           *image,
+                                  cairo_t             *cr,
+                                  ThunarEmblemChooser *chooser)
+{
+  ThunarIconFactory *icon_factory;
+  const gchar       *emblem;
+  GtkWidget         *button;
+  GdkPixbuf         *icon;
+  gint               scale_factor;
+
+  /* the icon of a button scrolled into view for the first time */
+  if (gtk_image_get_storage_type (GTK_IMAGE (image)) != GTK_IMAGE_EMPTY)
+    return FALSE;
+
+  button = gtk_widget_get_parent (image);
+  emblem = g_object_get_data (G_OBJECT (button), I_("thunar-emblem"));
+
+  /* the factory shares the icons with the other dialogs */
+  scale_factor = gtk_widget_get_scale_factor (image);
+  icon_factory = thunar_icon_factory_get_for_icon_theme (chooser->icon_theme);
+  icon = thunar_icon_factory_load_icon (icon_factory, emblem, THUNAR_EMBLEM_CHOOSER_ICON_SIZE, scale_factor, FALSE);
+  g_object_unref (G_OBJECT (icon_factory));
+
+  if (G_UNLIKELY (icon == NULL))
+    {
+      /* listed by the theme, but cannot be loaded */
+      gtk_widget_hide (GTK_IS_FLOW_BOX_CHILD (gtk_widget_get_parent (button)) ? gtk_widget_get_parent (button) : button);
+      return TRUE;
+    }
+
+  gtk_image_set_from_surface (GTK_IMAGE (image),
+                              thunar_gdk_pixbuf_get_surface (icon,
+                                                             THUNAR_EMBLEM_CHOOSER_ICON_SIZE * scale_factor,
+                                                             THUNAR_EMBLEM_CHOOSER_ICON_SIZE * scale_factor,
+                                                             scale_factor));
+  g_object_unref (G_OBJECT (icon));
+
+  return FALSE;
+}
+
+
+
 /**
  * thunar_emblem_chooser_new:
  *
@@ -579,6 +579,8 @@ thunar_job_response_get_type (void)
         { THUNAR_JOB_RESPONSE_SKIP_ALL,    "THUNAR_JOB_RESPONSE_SKIP_ALL",    "skip-all"    },
         { THUNAR_JOB_RESPONSE_RENAME,      "THUNAR_JOB_RESPONSE_RENAME",      "rename"      },
         { THUNAR_JOB_RESPONSE_RENAME_ALL,  "THUNAR_JOB_RESPONSE_RENAME_ALL",  "rename-all " },
+        { THUNAR_JOB_RESPONSE_REPLACE_OLDER_ALL,   "THUNAR_JOB_RESPONSE_REPLACE_OLDER_ALL",   "replace-older-all"   },
+        { THUNAR_JOB_RESPONSE_REPLACE_SMALLER_ALL, "THUNAR_JOB_RESPONSE_REPLACE_SMALLER_ALL", "replace-smaller-all" },
         { 0,                               NULL,                              NULL          }
       };
 
@@ -670,6 +672,51 @@ thunar_verify_file_get_type (void)
 
 
 
+GType
+thunar_transfer_io_class_get_type (void)
+{
+  static GType type = G_TYPE_INVALID;
+
+  if (G_UNLIKELY (type == G_TYPE_INVALID))
+    {
+      static const GEnumValue values[] =
+      {
+        { THUNAR_TRANSFER_IO_CLASS_NORMAL, "THUNAR_TRANSFER_IO_CLASS_NORMAL", N_("Normal"),},
+        { THUNAR_TRANSFER_IO_CLASS_IDLE,   "THUNAR_TRANSFER_IO_CLASS_IDLE",   N_("Idle"),},
+        { 0,                               NULL,                              NULL,},
+      };
+
+      type = g_enum_register_static (I_("ThunarTransferIoClass"), values);
+    }
+
+  return type;
+}
+
+
+
+GType
+thunar_skip_identical_get_type (void)
+{
+  static GType type = G_TYPE_INVALID;
+
+  if (G_UNLIKELY (type == G_TYPE_INVALID))
+    {
+      static const GEnumValue values[] =
+      {
+        { THUNAR_SKIP_IDENTICAL_MODE_DISABLED,      "THUNAR_SKIP_IDENTICAL_MODE_DISABLED",      N_("Never"),},
+        { THUNAR_SKIP_IDENTICAL_MODE_SIZE_AND_TIME, "THUNAR_SKIP_IDENTICAL_MODE_SIZE_AND_TIME", N_("Same size and date"),},
+        { THUNAR_SKIP_IDENTICAL_MODE_CHECKSUM,      "THUNAR_SKIP_IDENTICAL_MODE_CHECKSUM",      N_("Same size, date and checksum"),},
+        { 0,                                        NULL,                                       NULL,},
+      };
+
+      type = g_enum_register_static (I_("ThunarSkipIdenticalMode"), values);
+    }
+
+  return type;
+}
+
+
+
 /**
  * thunar_status_bar_info_toggle_bit:
  * @info   : a #guint.
@@ -321,6 +321,8 @@ gboolean            thunar_zoom_level_value_from_string   (const gchar    *value
  * @THUNAR_JOB_RESPONSE_SKIP_ALL    :
  * @THUNAR_JOB_RESPONSE_RENAME      :
  * @THUNAR_JOB_RESPONSE_RENAME_ALL  :
+ * @THUNAR_JOB_RESPONSE_REPLACE_OLDER_ALL   : replace the files that are older than the new ones.
+ * @THUNAR_JOB_RESPONSE_REPLACE_SMALLER_ALL : replace the files that are smaller than the new ones.
  *
  * Possible responses for the ThunarJob::ask signal.
  **/
@@ -339,8 +341,10 @@ typedef enum /*< flags >*/
   THUNAR_JOB_RESPONSE_SKIP_ALL    = 1 << 10,
   THUNAR_JOB_RESPONSE_RENAME      = 1 << 11,
   THUNAR_JOB_RESPONSE_RENAME_ALL  = 1 << 12,
+  THUNAR_JOB_RESPONSE_REPLACE_OLDER_ALL   = 1 << 13,
+  THUNAR_JOB_RESPONSE_REPLACE_SMALLER_ALL = 1 << 14,
 } ThunarJobResponse;
-#define THUNAR_JOB_RESPONSE_MAX_INT 12
+#define THUNAR_JOB_RESPONSE_MAX_INT 14
 
 GType thunar_job_response_get_type (void) G_GNUC_CONST;
 
@@ -413,6 +417,42 @@ GType thunar_verify_file_get_type (void) G_GNUC_CONST;
 
 
 
+#define THUNAR_TYPE_TRANSFER_IO_CLASS (thunar_transfer_io_class_get_type ())
+
+/**
+ * ThunarTransferIoClass:
+ * @THUNAR_TRANSFER_IO_CLASS_NORMAL : Copy with the normal IO priority
+ * @THUNAR_TRANSFER_IO_CLASS_IDLE   : Copy only while nobody else uses the disks
+ **/
+typedef enum
+{
+  THUNAR_TRANSFER_IO_CLASS_NORMAL,
+  THUNAR_TRANSFER_IO_CLASS_IDLE,
+} ThunarTransferIoClass;
+
+GType thunar_transfer_io_class_get_type (void) G_GNUC_CONST;
+
+
+
+#define THUNAR_TYPE_SKIP_IDENTICAL_MODE (thunar_skip_identical_get_type ())
+
+/**
+ * ThunarSkipIdenticalMode:
+ * @THUNAR_SKIP_IDENTICAL_MODE_DISABLED      : Ask about every existing target
+ * @THUNAR_SKIP_IDENTICAL_MODE_SIZE_AND_TIME : Skip targets of the same size and modification time
+ * @THUNAR_SKIP_IDENTICAL_MODE_CHECKSUM      : Skip targets which also have the same checksum
+ **/
+typedef enum
+{
+  THUNAR_SKIP_IDENTICAL_MODE_DISABLED,
+  THUNAR_SKIP_IDENTICAL_MODE_SIZE_AND_TIME,
+  THUNAR_SKIP_IDENTICAL_MODE_CHECKSUM,
+} ThunarSkipIdenticalMode;
+
+GType thunar_skip_identical_get_type (void) G_GNUC_CONST;
+
+
+
 /**
  * ThunarNewTabBehavior:
  * @THUNAR_NEW_TAB_BEHAVIOR_FOLLOW_PREFERENCE   : switching to the new tab or not is controlled by a preference.
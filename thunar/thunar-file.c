@@ -56,19 +56,28 @@
 
 #include "thunarx/thunarx.h"
 
+#include "thunar/thunar-app-index.h"
 #include "thunar/thunar-application.h"
+#include "thunar/thunar-cache-registry.h"
 #include "thunar/thunar-chooser-dialog.h"
+#include "thunar/thunar-count-scheduler.h"
+#include "thunar/thunar-desktop-file-cache.h"
 #include "thunar/thunar-dialogs.h"
 #include "thunar/thunar-file.h"
+#include "thunar/thunar-folder.h"
 #include "thunar/thunar-gio-extensions.h"
 #include "thunar/thunar-gobject-extensions.h"
 #include "thunar/thunar-icon-factory.h"
+#include "thunar/thunar-inotify.h"
 #include "thunar/thunar-io-jobs.h"
+#include "thunar/thunar-mount-health.h"
 #include "thunar/thunar-preferences.h"
 #include "thunar/thunar-private.h"
+#include "thunar/thunar-reload-scheduler.h"
 #include "thunar/thunar-user.h"
 #include "thunar/thunar-util.h"
 #include "thunar/thunar-thumbnailer.h"
+#include "thunar/thunar-view-settings.h"
 
 
 
@@ -78,6 +87,12 @@
 /* Minimum delay between two 'changed' signals of the same file */
 #define FILE_CHANGED_SIGNAL_RATE_LIMIT 100 /* in milliseconds */
 
+
+
+typedef struct _ThunarFileWatch ThunarFileWatch;
+
+
+
 /* Signal identifiers */
 /* Note that the signals 'CHANGED' and 'RENAMED' are provided by THUNARX_FILE_INFO */
 enum
@@ -103,6 +118,9 @@ static gboolean           thunar_file_info_is_directory        (ThunarxFileInfo
 static GFileInfo         *thunar_file_info_get_file_info       (ThunarxFileInfo        *file_info);
 static GFileInfo         *thunar_file_info_get_filesystem_info (ThunarxFileInfo        *file_info);
 static GFile             *thunar_file_info_get_location        (ThunarxFileInfo        *file_info);
+static const gchar       *thunar_file_info_peek_name           (ThunarxFileInfo        *file_info);
+static const gchar       *thunar_file_info_peek_mime_type      (ThunarxFileInfo        *file_info);
+static GFileInfo         *thunar_file_info_peek_file_info      (ThunarxFileInfo        *file_info);
 static void               thunar_file_info_changed             (ThunarxFileInfo        *file_info);
 static gboolean           thunar_file_denies_access_permission (const ThunarFile       *file,
                                                                 ThunarFileMode          usr_permissions,
@@ -113,37 +131,99 @@ static void               thunar_file_monitor                  (GFileMonitor
                                                                 GFile                  *other_path,
                                                                 GFileMonitorEvent       event_type,
                                                                 gpointer                user_data);
+static void               thunar_file_inotify_events           (const ThunarInotifyEvent *events,
+                                                                guint                   n_events,
+                                                                gpointer                user_data);
+static gboolean           thunar_file_watch_connect            (ThunarFileWatch        *file_watch,
+                                                                GError                **error);
+static void               thunar_file_watch_disconnect         (ThunarFileWatch        *file_watch);
 static void               thunar_file_watch_reconnect          (ThunarFile             *file);
 static gboolean           thunar_file_load                     (ThunarFile             *file,
                                                                 GCancellable           *cancellable,
                                                                 GError                **error);
+static gboolean           thunar_file_load_info                (ThunarFile             *file,
+                                                                GFileInfo              *info,
+                                                                GError                 *err,
+                                                                GCancellable           *cancellable,
+                                                                GError                **error);
 static gboolean           thunar_file_is_readable              (const ThunarFile       *file);
 static gboolean           thunar_file_same_filesystem          (const ThunarFile       *file_a,
                                                                 const ThunarFile       *file_b);
 static void               thunar_file_load_content_type        (ThunarFile             *file);
+static gboolean           thunar_file_content_type_changed     (gpointer                user_data);
+static gboolean           thunar_file_name_is_ascii            (const gchar            *name,
+                                                                gboolean               *has_upper);
+static const gchar       *thunar_file_ensure_collate_key       (const ThunarFile       *file,
+                                                                gboolean                case_sensitive);
 static void               thunar_file_thumbnailing_finished    (ThunarFile             *file,
                                                                 guint                   request_id,
                                                                 ThunarThumbnailer      *thumbnailer);
 static void               thunar_file_reset_thumbnail          (ThunarFile             *file,
                                                                 ThunarThumbnailSize     size);
+static void               thunar_file_drop_set_free            (gpointer                data);
                                                   
 
 
 
-static GRecMutex G_LOCK_NAME (file_cache_mutex);
+/* Number of independently locked shards of the file cache, must be a power of two */
+#define FILE_CACHE_N_SHARDS 32
+
+
+
+typedef struct
+{
+  GRecMutex   mutex;
+  GHashTable *table;
+
+  /* lookups since the start, for thunar_file_cache_get_stats() */
+  guint64     n_hits;
+  guint64     n_misses;
+}
+ThunarFileCacheShard;
+
+/* what thunar_file_accepts_drop() needs to know about the dragged
+ * files, collected once per drag and drop target widget */
+typedef struct
+{
+  GList        *file_list;          /* the list this was collected for, not owned */
+  GHashTable   *files;              /* set of the dragged #GFile<!---->s */
+  GHashTable   *parents;            /* set of their parent #GFile<!---->s */
+  gboolean      has_trashed;
+  gboolean      movable;            /* all parents writable, no matter the target */
+  gboolean      has_filesystem_id;
+  gchar        *filesystem_id;      /* the one filesystem of the movable files */
+  GHashTable   *results;            /* target #ThunarFile -> ThunarFileDropResult */
+}
+ThunarFileDropSet;
+
+typedef struct
+{
+  GdkDragAction context_actions;
+  GdkDragAction context_suggested_action;
+  GdkDragAction actions;
+  GdkDragAction suggested_action;
+}
+ThunarFileDropResult;
+
 
 
+#define FILE_CACHE_LOCK(shard)   g_rec_mutex_lock   (&(shard)->mutex)
+#define FILE_CACHE_UNLOCK(shard) g_rec_mutex_unlock (&(shard)->mutex)
 
-#define G_REC_LOCK(name)   g_rec_mutex_lock   (&G_LOCK_NAME (name))
-#define G_REC_UNLOCK(name) g_rec_mutex_unlock (&G_LOCK_NAME (name))
 
 
+static ThunarUserManager    *user_manager;
+static ThunarFileCacheShard  file_cache[FILE_CACHE_N_SHARDS];
+static guint32               effective_user_id;
+static GQuark               thunar_file_watch_quark;
+static GQuark               thunar_file_pending_info_quark;
+static GQuark               thunar_file_drop_set_quark;
+static guint                 file_signals[LAST_SIGNAL];
 
-static ThunarUserManager *user_manager;
-static GHashTable        *file_cache;
-static guint32            effective_user_id;
-static GQuark             thunar_file_watch_quark;
-static guint              file_signals[LAST_SIGNAL];
+/* bumped whenever the thumbnail cache directory of a size changes, see thunar_file_get_thumbnail_path() */
+static GFileMonitor         *thumbnail_dir_monitors[N_THUMBNAIL_SIZES];
+static guint                 thumbnail_dir_generation[N_THUMBNAIL_SIZES];
+static gboolean              thumbnail_dir_watched[N_THUMBNAIL_SIZES];
 
 
 
@@ -158,6 +238,12 @@ typedef enum
   THUNAR_FILE_FLAG_THUMB_MASK     = 0x03,   /* storage for ThunarFileThumbState */
   THUNAR_FILE_FLAG_IN_DESTRUCTION = 1 << 2, /* for avoiding recursion during destroy */
   THUNAR_FILE_FLAG_IS_MOUNTED     = 1 << 3, /* whether this file is mounted */
+  THUNAR_FILE_FLAG_PROVISIONAL    = 1 << 4, /* info was restored from a folder snapshot */
+  THUNAR_FILE_FLAG_METADATA       = 1 << 5, /* the metadata:: attributes are loaded */
+  THUNAR_FILE_FLAG_NO_FILE_WATCH  = 1 << 6, /* the file watch could not be set */
+  THUNAR_FILE_FLAG_COUNT_VALID    = 1 << 7, /* file_count holds a count of the folder */
+  THUNAR_FILE_FLAG_THUMB_PENDING  = 1 << 8, /* listening to the thumbnailer for a request */
+  THUNAR_FILE_FLAG_URI_HASH       = 1 << 9, /* uri_hash holds the checksum of the current uri */
 }
 ThunarFileFlags;
 
@@ -171,6 +257,13 @@ struct _ThunarFileClass
                              ThunarThumbnailSize size);
 };
 
+typedef struct
+{
+  guint  format;
+  gchar *strings[THUNAR_N_VISIBLE_COLUMNS];
+}
+ThunarFileColumnStrings;
+
 struct _ThunarFile
 {
   GObject __parent__;
@@ -181,32 +274,33 @@ struct _ThunarFile
   GFileType             kind;
   GFile                *gfile;
 
-  /* The content type can be loaded as separate job or directly */
-  gchar                *content_type;
+  /* The content type can be loaded as separate job or directly. Content types
+   * and icon names repeat across files, so both are interned strings */
+  const gchar          *content_type;
+  gboolean              content_type_guessed; /* from the name only, until sniffed */
   GMutex                content_type_mutex;
 
-  gchar                *icon_name;
+  const gchar          *icon_name;
 
   gchar                *custom_icon_name;
   gchar                *display_name;
   gchar                *basename;
   const gchar          *device_type;
   gchar                *thumbnail_path[N_THUMBNAIL_SIZES];
-  ThunarFileThumbState  thumbnail_state[N_THUMBNAIL_SIZES];
+  guint                 thumbnail_miss[N_THUMBNAIL_SIZES]; /* see thunar_file_get_thumbnail_path() */
+  guint8                thumbnail_state[N_THUMBNAIL_SIZES]; /* ThunarFileThumbState */
+  guint8                uri_hash[16];                       /* MD5 of the uri, for the thumbnail paths */
   guint                 thumbnail_request_id[N_THUMBNAIL_SIZES];
 
   ThunarThumbnailer    *thumbnailer;
 
-  /* sorting */
+  /* sorting, computed on first use, see thunar_file_ensure_collate_key() */
   gchar                *collate_key;
   gchar                *collate_key_nocase;
 
   /* flags for thumbnail state etc */
   ThunarFileFlags       flags;
 
-  /* tells whether the file watch is not set */
-  gboolean              no_file_watch;
-
   /* event source id used to rate-limit file-changed signals */
   guint                 signal_changed_source_id;
 
@@ -214,15 +308,20 @@ struct _ThunarFile
   /* Note that this feature was added into #ThunarFile on purpose, because having inside #ThunarFolder caused lag when
    * there were > 10.000 files in a folder (Creation of #ThunarFolder seems to be slow) */
   guint                 file_count;
-  guint64               file_count_timestamp;
+  guint64               file_count_mtime;
+
+  /* formatted column strings, see thunar_file_get_column_string() */
+  ThunarFileColumnStrings *column_strings;
 };
 
-typedef struct
+struct _ThunarFileWatch
 {
-  GFileMonitor  *monitor;
-  guint          watch_count;
-}
-ThunarFileWatch;
+  ThunarFile         *file;
+  GFileMonitor       *monitor;
+  ThunarInotifyWatch *inotify_watch;  /* used instead of the monitor for local files */
+  ThunarFolder       *folder;         /* parent folder delivering the events, see thunar_folder_route_file_watch() */
+  guint               watch_count;
+};
 
 typedef struct
 {
@@ -272,6 +371,106 @@ weak_ref_free (GWeakRef *ref)
 }
 
 
+
+static ThunarFileCacheShard*
+thunar_file_cache_get_shard (const GFile *gfile)
+{
+  static gsize initialized = 0;
+  guint        hash;
+  guint        n;
+
+  /* allocate the ThunarFile cache tables on-demand */
+  if (g_once_init_enter (&initialized))
+    {
+      for (n = 0; n < FILE_CACHE_N_SHARDS; n++)
+        {
+          file_cache[n].table = g_hash_table_new_full (g_file_hash,
+                                                       (GEqualFunc) g_file_equal,
+                                                       (GDestroyNotify) g_object_unref,
+                                                       (GDestroyNotify) weak_ref_free);
+        }
+      g_once_init_leave (&initialized, 1);
+    }
+
+  /* mix the upper bits in, g_file_hash() of paths sharing a long
+   * prefix tends to differ mostly in those */
+  hash = g_file_hash (gfile);
+  hash ^= hash >> 16;
+
+  return &file_cache[hash & (FILE_CACHE_N_SHARDS - 1)];
+}
+
+
+
+static inline void
+thunar_file_cache_insert_unlocked (ThunarFileCacheShard *shard,
+                                   ThunarFile           *file)
+{
+  g_hash_table_insert (shard->table,
+                       g_object_ref (file->gfile),
+                       weak_ref_new (G_OBJECT (file)));
+}
+
+
+
+/* Looks up all @gfiles with a %NULL entry in @files in the cache, locking
+ * every shard at most once. If @new_files is non-%NULL, the entries of
+ * @new_files for locations that are (still) not cached are inserted and
+ * moved over to @files, the other entries are left to the caller */
+static void
+thunar_file_cache_transaction (GFile       **gfiles,
+                               const guint  *shard_ids,
+                               ThunarFile  **files,
+                               ThunarFile  **new_files,
+                               guint         n_files)
+{
+  ThunarFileCacheShard *shard;
+  GWeakRef             *ref;
+  guint                 n, m;
+
+  for (m = 0; m < FILE_CACHE_N_SHARDS; m++)
+    {
+      shard = NULL;
+
+      for (n = 0; n < n_files; n++)
+        {
+          if (shard_ids[n] != m || files[n] != NULL)
+            continue;
+
+          /* only lock shards that are actually hit */
+          if (shard == NULL)
+            {
+              shard = &file_cache[m];
+              FILE_CACHE_LOCK (shard);
+            }
+
+          ref = g_hash_table_lookup (shard->table, gfiles[n]);
+          if (ref != NULL)
+            files[n] = g_weak_ref_get (ref);
+
+          /* the insertion follows a lookup which was counted already */
+          if (new_files == NULL)
+            {
+              if (files[n] != NULL)
+                shard->n_hits++;
+              else
+                shard->n_misses++;
+            }
+
+          if (files[n] == NULL && new_files != NULL && new_files[n] != NULL)
+            {
+              thunar_file_cache_insert_unlocked (shard, new_files[n]);
+              files[n] = new_files[n];
+              new_files[n] = NULL;
+            }
+        }
+
+      if (shard != NULL)
+        FILE_CACHE_UNLOCK (shard);
+    }
+}
+
+
 #ifdef G_ENABLE_DEBUG
 #ifdef HAVE_ATEXIT
 static gboolean thunar_file_atexit_registered = FALSE;
@@ -297,22 +496,31 @@ thunar_file_atexit_foreach (gpointer key,
 static void
 thunar_file_atexit (void)
 {
-  G_REC_LOCK (file_cache_mutex);
+  guint n_leaked = 0;
+  guint n;
 
-  if (file_cache == NULL || g_hash_table_size (file_cache) == 0)
+  for (n = 0; n < FILE_CACHE_N_SHARDS; n++)
     {
-      G_REC_UNLOCK (file_cache_mutex);
-      return;
+      FILE_CACHE_LOCK (&file_cache[n]);
+      if (file_cache[n].table != NULL)
+        n_leaked += g_hash_table_size (file_cache[n].table);
+      FILE_CACHE_UNLOCK (&file_cache[n]);
     }
 
-  g_print ("--- Leaked a total of %u ThunarFile objects:\n",
-           g_hash_table_size (file_cache));
+  if (n_leaked == 0)
+    return;
 
-  g_hash_table_foreach (file_cache, thunar_file_atexit_foreach, NULL);
+  g_print ("--- Leaked a total of %u ThunarFile objects:\n", n_leaked);
 
-  g_print ("\n");
+  for (n = 0; n < FILE_CACHE_N_SHARDS; n++)
+    {
+      FILE_CACHE_LOCK (&file_cache[n]);
+      if (file_cache[n].table != NULL)
+        g_hash_table_foreach (file_cache[n].table, thunar_file_atexit_foreach, NULL);
+      FILE_CACHE_UNLOCK (&file_cache[n]);
+    }
 
-  G_REC_UNLOCK (file_cache_mutex);
+  g_print ("\n");
 }
 #endif
 #endif
@@ -337,19 +545,24 @@ thunar_file_cache_dump_foreach (gpointer gfile,
 static gboolean
 thunar_file_cache_dump (gpointer user_data)
 {
-  G_REC_LOCK (file_cache_mutex);
+  guint n;
 
-  if (file_cache != NULL)
+  for (n = 0; n < FILE_CACHE_N_SHARDS; n++)
     {
-      g_print ("--- %d ThunarFile objects in cache:\n",
-               g_hash_table_size (file_cache));
+      FILE_CACHE_LOCK (&file_cache[n]);
+
+      if (file_cache[n].table != NULL)
+        {
+          g_print ("--- %d ThunarFile objects in cache shard %u:\n",
+                   g_hash_table_size (file_cache[n].table), n);
 
-      g_hash_table_foreach (file_cache, thunar_file_cache_dump_foreach, NULL);
+          g_hash_table_foreach (file_cache[n].table, thunar_file_cache_dump_foreach, NULL);
 
-      g_print ("\n");
-    }
+          g_print ("\n");
+        }
 
-  G_REC_UNLOCK (file_cache_mutex);
+      FILE_CACHE_UNLOCK (&file_cache[n]);
+    }
 
   return TRUE;
 }
@@ -357,6 +570,26 @@ thunar_file_cache_dump (gpointer user_data)
 
 
 
+static gsize
+thunar_file_cache_size (gpointer user_data)
+{
+  gsize n_files = 0;
+  guint n;
+
+  for (n = 0; n < FILE_CACHE_N_SHARDS; n++)
+    {
+      FILE_CACHE_LOCK (&file_cache[n]);
+      if (file_cache[n].table != NULL)
+        n_files += g_hash_table_size (file_cache[n].table);
+      FILE_CACHE_UNLOCK (&file_cache[n]);
+    }
+
+  /* the object itself and about a kilobyte for its file info and strings */
+  return n_files * (sizeof (ThunarFile) + 1024);
+}
+
+
+
 static void
 thunar_file_class_init (ThunarFileClass *klass)
 {
@@ -376,8 +609,14 @@ thunar_file_class_init (ThunarFileClass *klass)
   g_timeout_add_seconds (DUMP_FILE_CACHE, thunar_file_cache_dump, NULL);
 #endif
 
+  /* the files are only accounted, they are released with the folders and views holding them */
+  thunar_cache_registry_add ("files", G_MEMORY_MONITOR_WARNING_LEVEL_CRITICAL, thunar_file_cache_size, NULL, NULL);
+  thunar_desktop_file_cache_init ();
+
   /* pre-allocate the required quarks */
   thunar_file_watch_quark = g_quark_from_static_string ("thunar-file-watch");
+  thunar_file_pending_info_quark = g_quark_from_static_string ("thunar-file-pending-info");
+  thunar_file_drop_set_quark = g_quark_from_static_string ("thunar-file-drop-set");
 
   /* grab a reference on the user manager */
   user_manager = thunar_user_manager_get_default ();
@@ -426,14 +665,13 @@ static void
 thunar_file_init (ThunarFile *file)
 {
   file->file_count = 0;
-  file->file_count_timestamp = 0;
+  file->file_count_mtime = 0;
   file->display_name = NULL;
   for (gint i = 0; i < N_THUMBNAIL_SIZES; i++)
     thunar_file_reset_thumbnail (file, i);
 
+  /* the "request-finished" handler is only connected while thumbnails are requested */
   file->thumbnailer = thunar_thumbnailer_get ();
-  
-  g_signal_connect_swapped (file->thumbnailer, "request-finished", G_CALLBACK (thunar_file_thumbnailing_finished), file);
 
   g_mutex_init (&file->content_type_mutex);
 }
@@ -453,6 +691,9 @@ thunar_file_info_init (ThunarxFileInfoIface *iface)
   iface->get_file_info = thunar_file_info_get_file_info;
   iface->get_filesystem_info = thunar_file_info_get_filesystem_info;
   iface->get_location = thunar_file_info_get_location;
+  iface->peek_name = thunar_file_info_peek_name;
+  iface->peek_mime_type = thunar_file_info_peek_mime_type;
+  iface->peek_file_info = thunar_file_info_peek_file_info;
   iface->changed = thunar_file_info_changed;
 }
 
@@ -480,7 +721,10 @@ thunar_file_dispose (GObject *object)
 static void
 thunar_file_finalize (GObject *object)
 {
-  ThunarFile *file = THUNAR_FILE (object);
+  ThunarFile           *file = THUNAR_FILE (object);
+  ThunarFile           *other_file;
+  ThunarFileCacheShard *shard;
+  GWeakRef             *ref;
 
   if (file->signal_changed_source_id != 0)
     g_source_remove (file->signal_changed_source_id);
@@ -495,15 +739,27 @@ thunar_file_finalize (GObject *object)
     }
 #endif
 
-  g_signal_handlers_disconnect_by_func (G_OBJECT (file->thumbnailer), G_CALLBACK (thunar_file_thumbnailing_finished), file);
+  if (FLAG_IS_SET (file, THUNAR_FILE_FLAG_THUMB_PENDING))
+    g_signal_handlers_disconnect_by_func (G_OBJECT (file->thumbnailer), G_CALLBACK (thunar_file_thumbnailing_finished), file);
 
   if (file->thumbnailer != NULL)
     g_object_unref (file->thumbnailer);
 
-  /* drop the entry from the cache */
-  G_REC_LOCK (file_cache_mutex);
-  g_hash_table_remove (file_cache, file->gfile);
-  G_REC_UNLOCK (file_cache_mutex);
+  /* drop the entry from the cache, unless it belongs to another
+   * (still alive) file for the same location, which happens if
+   * a batch insert lost the race against another thread */
+  shard = thunar_file_cache_get_shard (file->gfile);
+  FILE_CACHE_LOCK (shard);
+  ref = g_hash_table_lookup (shard->table, file->gfile);
+  if (ref != NULL)
+    {
+      other_file = g_weak_ref_get (ref);
+      if (other_file == NULL)
+        g_hash_table_remove (shard->table, file->gfile);
+      else
+        g_object_unref (other_file);
+    }
+  FILE_CACHE_UNLOCK (shard);
 
   /* release file info */
   if (file->info != NULL)
@@ -516,14 +772,12 @@ thunar_file_finalize (GObject *object)
   /* free the custom icon name */
   g_free (file->custom_icon_name);
 
+  /* free the memoized column strings */
+  thunar_file_clear_column_strings (file);
+
   /* content type info */
-  g_mutex_lock (&file->content_type_mutex);
-  g_free (file->content_type);
-  g_mutex_unlock (&file->content_type_mutex);
   g_mutex_clear (&file->content_type_mutex);
 
-  g_free (file->icon_name);
-
   /* free display name and basename */
   g_free (file->display_name);
   g_free (file->basename);
@@ -652,6 +906,33 @@ thunar_file_info_get_location (ThunarxFileInfo *file_info)
 
 
 
+static const gchar *
+thunar_file_info_peek_name (ThunarxFileInfo *file_info)
+{
+  _thunar_return_val_if_fail (THUNAR_IS_FILE (file_info), NULL);
+  return thunar_file_get_basename (THUNAR_FILE (file_info));
+}
+
+
+
+static const gchar *
+thunar_file_info_peek_mime_type (ThunarxFileInfo *file_info)
+{
+  _thunar_return_val_if_fail (THUNAR_IS_FILE (file_info), NULL);
+  return thunar_file_get_content_type (THUNAR_FILE (file_info));
+}
+
+
+
+static GFileInfo *
+thunar_file_info_peek_file_info (ThunarxFileInfo *file_info)
+{
+  _thunar_return_val_if_fail (THUNAR_IS_FILE (file_info), NULL);
+  return THUNAR_FILE (file_info)->info;
+}
+
+
+
 static void
 thunar_file_info_changed (ThunarxFileInfo *file_info)
 {
@@ -766,18 +1047,31 @@ void
 thunar_file_replace_file (ThunarFile *file,
                           GFile      *renamed_file)
 {
-  GFile *previous_file;
-
-  G_REC_LOCK (file_cache_mutex);
+  ThunarFileCacheShard *old_shard;
+  ThunarFileCacheShard *new_shard;
+  GFile                *previous_file;
 
   /* get the old location */
   previous_file = file->gfile;
 
+  /* both shards have to be locked during the swap, always lock
+   * them in the same order to avoid deadlocks */
+  old_shard = thunar_file_cache_get_shard (previous_file);
+  new_shard = thunar_file_cache_get_shard (renamed_file);
+  FILE_CACHE_LOCK (MIN (old_shard, new_shard));
+  if (old_shard != new_shard)
+    FILE_CACHE_LOCK (MAX (old_shard, new_shard));
+
   /* set the new file */
   file->gfile = g_object_ref (renamed_file);
 
+  /* the thumbnails of the new uri have another name */
+  FLAG_UNSET (file, THUNAR_FILE_FLAG_URI_HASH);
+  for (gint i = 0; i < N_THUMBNAIL_SIZES; i++)
+    file->thumbnail_miss[i] = 0;
+
   /* drop the previous entry from the cache */
-  g_hash_table_remove (file_cache, previous_file);
+  g_hash_table_remove (old_shard->table, previous_file);
 
   /* need to re-register the monitor handle for the new uri */
   thunar_file_watch_reconnect (file);
@@ -786,25 +1080,20 @@ thunar_file_replace_file (ThunarFile *file,
   g_object_unref (previous_file);
 
   /* insert the new entry */
-  g_hash_table_insert (file_cache,
-                       g_object_ref (file->gfile),
-                       weak_ref_new (G_OBJECT (file)));
+  thunar_file_cache_insert_unlocked (new_shard, file);
 
-  G_REC_UNLOCK (file_cache_mutex);
+  if (old_shard != new_shard)
+    FILE_CACHE_UNLOCK (MAX (old_shard, new_shard));
+  FILE_CACHE_UNLOCK (MIN (old_shard, new_shard));
 }
 
 
 
 static void
-thunar_file_monitor (GFileMonitor     *monitor,
-                     GFile            *event_path,
-                     GFile            *other_path,
-                     GFileMonitorEvent event_type,
-                     gpointer          user_data)
+thunar_file_handle_event (ThunarFile       *file,
+                          GFile            *event_path,
+                          GFileMonitorEvent event_type)
 {
-  ThunarFile *file = THUNAR_FILE (user_data);
-
-  _thunar_return_if_fail (G_IS_FILE_MONITOR (monitor));
   _thunar_return_if_fail (G_IS_FILE (event_path));
   _thunar_return_if_fail (THUNAR_IS_FILE (file));
 
@@ -842,15 +1131,111 @@ thunar_file_monitor (GFileMonitor     *monitor,
 
 
 static void
-thunar_file_watch_destroyed (gpointer data)
+thunar_file_monitor (GFileMonitor     *monitor,
+                     GFile            *event_path,
+                     GFile            *other_path,
+                     GFileMonitorEvent event_type,
+                     gpointer          user_data)
 {
-  ThunarFileWatch *file_watch = data;
+  ThunarFile *file = THUNAR_FILE (user_data);
+
+  _thunar_return_if_fail (G_IS_FILE_MONITOR (monitor));
+  _thunar_return_if_fail (THUNAR_IS_FILE (file));
+
+  thunar_file_handle_event (file, event_path, event_type);
+}
+
+
+
+static void
+thunar_file_inotify_events (const ThunarInotifyEvent *events,
+                            guint                     n_events,
+                            gpointer                  user_data)
+{
+  ThunarFile *file = THUNAR_FILE (user_data);
+
+  _thunar_return_if_fail (THUNAR_IS_FILE (file));
+
+  /* the kernel dropped events, read the file again */
+  if (n_events == 0)
+    {
+      thunar_file_reload (file);
+      return;
+    }
+
+  /* nothing to do for the file once it was deleted */
+  g_object_ref (file);
+  for (guint n = 0; n < n_events; n++)
+    {
+      thunar_file_handle_event (file, events[n].file, events[n].event_type);
+      if (events[n].event_type == G_FILE_MONITOR_EVENT_DELETED)
+        break;
+    }
+  g_object_unref (file);
+}
+
+
+
+static gboolean
+thunar_file_watch_connect (ThunarFileWatch *file_watch,
+                           GError         **error)
+{
+  ThunarFile *file = file_watch->file;
+
+  /* local files are watched through the inotify watch of their folder */
+  file_watch->inotify_watch = thunar_inotify_watch_file (file->gfile, thunar_file_inotify_events, file);
+  if (file_watch->inotify_watch != NULL)
+    return TRUE;
+
+  /* the directory monitor of an opened parent folder already sees
+   * the changes of the file, so don't spend another monitor on it */
+  file_watch->folder = thunar_folder_route_file_watch (file);
+  if (file_watch->folder != NULL)
+    return TRUE;
+
+  /* fall back to a dedicated file or directory monitor */
+  file_watch->monitor = g_file_monitor (file->gfile, G_FILE_MONITOR_WATCH_MOUNTS, NULL, error);
+  if (G_UNLIKELY (file_watch->monitor == NULL))
+    return FALSE;
+
+  /* watch monitor for file changes */
+  g_signal_connect (file_watch->monitor, "changed", G_CALLBACK (thunar_file_monitor), file);
+
+  return TRUE;
+}
+
+
 
+static void
+thunar_file_watch_disconnect (ThunarFileWatch *file_watch)
+{
   if (G_LIKELY (file_watch->monitor != NULL))
     {
       g_file_monitor_cancel (file_watch->monitor);
-      g_object_unref (file_watch->monitor);
+      g_clear_object (&file_watch->monitor);
+    }
+
+  if (file_watch->inotify_watch != NULL)
+    {
+      thunar_inotify_unwatch (file_watch->inotify_watch);
+      file_watch->inotify_watch = NULL;
+    }
+
+  if (file_watch->folder != NULL)
+    {
+      thunar_folder_unroute_file_watch (file_watch->folder, file_watch->file);
+      file_watch->folder = NULL;
     }
+}
+
+
+
+static void
+thunar_file_watch_destroyed (gpointer data)
+{
+  ThunarFileWatch *file_watch = data;
+
+  thunar_file_watch_disconnect (file_watch);
 
   g_slice_free (ThunarFileWatch, file_watch);
 }
@@ -867,19 +1252,8 @@ thunar_file_watch_reconnect (ThunarFile *file)
   if (file_watch != NULL)
     {
       /* reset the old monitor */
-      if (G_LIKELY (file_watch->monitor != NULL))
-        {
-          g_file_monitor_cancel (file_watch->monitor);
-          g_object_unref (file_watch->monitor);
-        }
-
-      /* create a file or directory monitor */
-      file_watch->monitor = g_file_monitor (file->gfile, G_FILE_MONITOR_WATCH_MOUNTS, NULL, NULL);
-      if (G_LIKELY (file_watch->monitor != NULL))
-        {
-          /* watch monitor for file changes */
-          g_signal_connect (file_watch->monitor, "changed", G_CALLBACK (thunar_file_monitor), file);
-        }
+      thunar_file_watch_disconnect (file_watch);
+      thunar_file_watch_connect (file_watch, NULL);
     }
 }
 
@@ -913,11 +1287,10 @@ thunar_file_info_clear (ThunarFile *file)
 
   /* content type */
   g_mutex_lock (&file->content_type_mutex);
-  g_free (file->content_type);
   file->content_type = NULL;
+  file->content_type_guessed = FALSE;
   g_mutex_unlock (&file->content_type_mutex);
 
-  g_free (file->icon_name);
   file->icon_name = NULL;
 
   /* device type */
@@ -936,11 +1309,15 @@ thunar_file_info_clear (ThunarFile *file)
     {
       g_free (file->thumbnail_path[i]);
       file->thumbnail_path[i] = NULL;
+      file->thumbnail_miss[i] = 0;
     }
 
   /* assume the file is mounted by default */
   FLAG_SET (file, THUNAR_FILE_FLAG_IS_MOUNTED);
 
+  /* the metadata of a new info is loaded on demand */
+  FLAG_UNSET (file, THUNAR_FILE_FLAG_METADATA);
+
   /* set thumb state to unknown */
   for (gint i = 0; i < N_THUMBNAIL_SIZES; i++)
     thunar_file_reset_thumbnail (file, i);
@@ -955,15 +1332,18 @@ thunar_file_info_reload (ThunarFile   *file,
   const gchar       *target_uri;
   const gchar       *display_name;
   gchar             *p;
-  gchar             *casefold;
   gchar             *path;
   GKeyFile          *key_file;
   gboolean           launcher_name;
+  gboolean           is_trusted;
   ThunarPreferences *preferences;
 
   _thunar_return_if_fail (THUNAR_IS_FILE (file));
   _thunar_return_if_fail (file->info == NULL || G_IS_FILE_INFO (file->info));
 
+  /* the formatted strings might be different now */
+  thunar_file_clear_column_strings (file);
+
   if (G_LIKELY (file->info != NULL))
     {
       /* this is requested so often, cache it */
@@ -1001,8 +1381,8 @@ thunar_file_info_reload (ThunarFile   *file,
     {
       /* determine the custom icon and display name for .desktop files */
 
-      /* query a key file for the .desktop file */
-      key_file = thunar_g_file_query_key_file (file->gfile, cancellable, NULL);
+      /* query a key file for the .desktop file, parsed already by the trust check */
+      key_file = thunar_desktop_file_cache_get_key_file (file->gfile, &is_trusted, cancellable, NULL);
       if (key_file != NULL)
         {
           /* read the icon name from the .desktop file */
@@ -1032,9 +1412,9 @@ thunar_file_info_reload (ThunarFile   *file,
           /* read the display name from the .desktop file (will be overwritten later
            * if it's undefined here) */
           preferences = thunar_preferences_get ();
-          g_object_get (preferences, "show-launcher-names-instead-real-filenames", &launcher_name, NULL);
+          launcher_name = thunar_preferences_peek_values (preferences)->show_launcher_names_instead_real_filenames;
           g_object_unref (preferences);
-          if (thunar_g_vfs_metadata_is_supported () && xfce_g_file_is_trusted (file->gfile, NULL, NULL) && launcher_name == TRUE)
+          if (thunar_g_vfs_metadata_is_supported () && is_trusted && launcher_name == TRUE)
             {
               g_free (file->display_name);
 
@@ -1051,8 +1431,8 @@ thunar_file_info_reload (ThunarFile   *file,
                 }
               }
 
-          /* free the key file */
-          g_key_file_free (key_file);
+          /* release the key file */
+          g_key_file_unref (key_file);
         }
     }
 
@@ -1078,55 +1458,142 @@ thunar_file_info_reload (ThunarFile   *file,
         file->display_name = thunar_g_file_get_display_name (file->gfile);
     }
 
-  /* create case sensitive collation key */
-  file->collate_key = g_utf8_collate_key_for_filename (file->display_name, -1);
+  /* the collation keys are created on the first comparison, most
+   * files in a folder are never sorted by name (or at all) */
+}
 
-  /* lowercase the display name */
-  casefold = g_utf8_casefold (file->display_name, -1);
 
-  /* if the lowercase name is equal, only peek the already hash key */
-  if (casefold != NULL && strcmp (casefold, file->display_name) != 0)
-    file->collate_key_nocase = g_utf8_collate_key_for_filename (casefold, -1);
-  else
-    file->collate_key_nocase = file->collate_key;
 
-  /* cleanup */
-  g_free (casefold);
+static gboolean
+thunar_file_name_is_ascii (const gchar *name,
+                           gboolean    *has_upper)
+{
+  const guchar *p;
+
+  *has_upper = FALSE;
+
+  for (p = (const guchar *) name; *p != '\0'; ++p)
+    {
+      if (G_UNLIKELY (*p >= 0x80))
+        return FALSE;
+      if (g_ascii_isupper (*p))
+        *has_upper = TRUE;
+    }
+
+  return TRUE;
 }
 
 
 
-static void
-thunar_file_get_async_finish (GObject      *object,
-                              GAsyncResult *result,
-                              gpointer      user_data)
+/**
+ * thunar_file_ensure_collate_key:
+ * @file           : a #ThunarFile instance.
+ * @case_sensitive : which of the two keys is requested.
+ *
+ * Creates the requested collation key of @file if this did not happen
+ * yet. The keys are published with an atomic exchange, so concurrent
+ * callers (the sort functions also run in the search and scan threads)
+ * at worst compute the same key twice and drop one of them.
+ *
+ * Return value: the collation key, owned by @file.
+ **/
+static const gchar *
+thunar_file_ensure_collate_key (const ThunarFile *file,
+                                gboolean          case_sensitive)
 {
-  ThunarFileGetData *data = user_data;
-  ThunarFile        *file;
-  GFileInfo         *file_info;
-  GError            *error = NULL;
-  GFile             *location = G_FILE (object);
-
-  _thunar_return_if_fail (G_IS_FILE (location));
-  _thunar_return_if_fail (G_IS_ASYNC_RESULT (result));
+  ThunarFile  *mutable_file = (ThunarFile *) file;
+  const gchar *key;
+  gchar       *new_key;
+  gchar       *casefold;
+  gboolean     has_upper;
 
-  /* finish querying the file information */
-  file_info = g_file_query_info_finish (location, result, &error);
+  if (G_UNLIKELY (file->display_name == NULL))
+    return NULL;
 
-  /* allocate a new file object */
-  file = g_object_new (THUNAR_TYPE_FILE, NULL);
-  file->gfile = g_object_ref (location);
+  if (case_sensitive)
+    {
+      key = g_atomic_pointer_get (&file->collate_key);
+      if (G_LIKELY (key != NULL))
+        return key;
 
-  /* reset the file */
-  thunar_file_info_clear (file);
+      new_key = g_utf8_collate_key_for_filename (file->display_name, -1);
+      if (!g_atomic_pointer_compare_and_exchange (&mutable_file->collate_key, NULL, new_key))
+        g_free (new_key);
 
-  /* set the file information */
-  file->info = file_info;
+      return g_atomic_pointer_get (&file->collate_key);
+    }
 
-  /* update the file from the information */
-  thunar_file_info_reload (file, data->cancellable);
+  key = g_atomic_pointer_get (&file->collate_key_nocase);
+  if (G_LIKELY (key != NULL))
+    return key;
 
-  /* update the mounted info */
+  /* for pure-ascii names the case folding is the ascii lowercase, which
+   * saves the unicode table lookups, and names without uppercase
+   * characters share the case sensitive key */
+  if (thunar_file_name_is_ascii (file->display_name, &has_upper))
+    casefold = has_upper ? g_ascii_strdown (file->display_name, -1) : NULL;
+  else
+    {
+      casefold = g_utf8_casefold (file->display_name, -1);
+      if (casefold != NULL && strcmp (casefold, file->display_name) == 0)
+        {
+          g_free (casefold);
+          casefold = NULL;
+        }
+    }
+
+  if (casefold != NULL)
+    {
+      new_key = g_utf8_collate_key_for_filename (casefold, -1);
+      g_free (casefold);
+
+      if (!g_atomic_pointer_compare_and_exchange (&mutable_file->collate_key_nocase, NULL, new_key))
+        g_free (new_key);
+    }
+  else
+    {
+      /* only peek the case sensitive key */
+      key = thunar_file_ensure_collate_key (file, TRUE);
+      g_atomic_pointer_compare_and_exchange (&mutable_file->collate_key_nocase, NULL, (gpointer) key);
+    }
+
+  return g_atomic_pointer_get (&file->collate_key_nocase);
+}
+
+
+
+static void
+thunar_file_get_async_finish (GObject      *object,
+                              GAsyncResult *result,
+                              gpointer      user_data)
+{
+  ThunarFileGetData    *data = user_data;
+  ThunarFileCacheShard *shard;
+  ThunarFile           *file;
+  GFileInfo            *file_info;
+  GError               *error = NULL;
+  GFile                *location = G_FILE (object);
+
+  _thunar_return_if_fail (G_IS_FILE (location));
+  _thunar_return_if_fail (G_IS_ASYNC_RESULT (result));
+
+  /* finish querying the file information */
+  file_info = g_file_query_info_finish (location, result, &error);
+
+  /* allocate a new file object */
+  file = g_object_new (THUNAR_TYPE_FILE, NULL);
+  file->gfile = g_object_ref (location);
+
+  /* reset the file */
+  thunar_file_info_clear (file);
+
+  /* set the file information */
+  file->info = file_info;
+
+  /* update the file from the information */
+  thunar_file_info_reload (file, data->cancellable);
+
+  /* update the mounted info */
   if (error != NULL
       && error->domain == G_IO_ERROR
       && error->code == G_IO_ERROR_NOT_MOUNTED)
@@ -1136,11 +1603,10 @@ thunar_file_get_async_finish (GObject      *object,
    }
 
   /* insert the file into the cache */
-  G_REC_LOCK (file_cache_mutex);
-  g_hash_table_insert (file_cache,
-                       g_object_ref (file->gfile),
-                       weak_ref_new (G_OBJECT (file)));
-  G_REC_UNLOCK (file_cache_mutex);
+  shard = thunar_file_cache_get_shard (file->gfile);
+  FILE_CACHE_LOCK (shard);
+  thunar_file_cache_insert_unlocked (shard, file);
+  FILE_CACHE_UNLOCK (shard);
 
   /* pass the loaded file and possible errors to the return function */
   (data->func) (location, file, error, data->user_data);
@@ -1179,26 +1645,74 @@ thunar_file_load (ThunarFile   *file,
                   GCancellable *cancellable,
                   GError      **error)
 {
-  GError *err = NULL;
+  GFileInfo *info;
+  GError    *err = NULL;
 
   _thunar_return_val_if_fail (THUNAR_IS_FILE (file), FALSE);
   _thunar_return_val_if_fail (error == NULL || *error == NULL, FALSE);
   _thunar_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), FALSE);
   _thunar_return_val_if_fail (G_IS_FILE (file->gfile), FALSE);
 
-  G_REC_LOCK (file_cache_mutex);
+  /* don't wait for the server of an unreachable mount */
+  if (thunar_mount_health_set_error_if_unreachable (file->gfile, error))
+    return FALSE;
+
+  /* query a new file info */
+  info = g_file_query_info (file->gfile,
+                            THUNAR_FILE_INFO_NAMESPACE,
+                            G_FILE_QUERY_INFO_NONE,
+                            cancellable, &err);
+
+  if (info == NULL)
+    {
+      /* keep the last known information if the server went away */
+      thunar_mount_health_report_error (file->gfile, err);
+      if (!thunar_mount_health_is_reachable (file->gfile))
+        {
+          g_propagate_error (error, err);
+          return FALSE;
+        }
+    }
+
+  return thunar_file_load_info (file, info, err, cancellable, error);
+}
+
+
+
+/**
+ * thunar_file_load_info:
+ * @file        : a #ThunarFile.
+ * @info        : (transfer full): the queried #GFileInfo or %NULL.
+ * @err         : (transfer full): the error of the query if @info is %NULL.
+ * @cancellable : a #GCancellable.
+ * @error       : return location for errors or %NULL.
+ *
+ * Second half of thunar_file_load(), which replaces the information
+ * of @file by the already queried @info.
+ *
+ * Return value: %TRUE on success, %FALSE on error.
+ **/
+static gboolean
+thunar_file_load_info (ThunarFile   *file,
+                       GFileInfo    *info,
+                       GError       *err,
+                       GCancellable *cancellable,
+                       GError      **error)
+{
+  ThunarFileCacheShard *shard;
+
+  _thunar_return_val_if_fail ((info == NULL) != (err == NULL), FALSE);
+
+  shard = thunar_file_cache_get_shard (file->gfile);
+  FILE_CACHE_LOCK (shard);
 
   /* remove the file from cache */
-  g_hash_table_remove (file_cache, file->gfile);
+  g_hash_table_remove (shard->table, file->gfile);
 
   /* reset the file */
   thunar_file_info_clear (file);
 
-  /* query a new file info */
-  file->info = g_file_query_info (file->gfile,
-                                  THUNARX_FILE_INFO_NAMESPACE,
-                                  G_FILE_QUERY_INFO_NONE,
-                                  cancellable, &err);
+  file->info = info;
 
   /* update the mounted info */
   if (err != NULL
@@ -1212,7 +1726,7 @@ thunar_file_load (ThunarFile   *file,
   if (err != NULL)
     {
       g_propagate_error (error, err);
-      G_REC_UNLOCK (file_cache_mutex);
+      FILE_CACHE_UNLOCK (shard);
       return FALSE;
     }
 
@@ -1221,13 +1735,9 @@ thunar_file_load (ThunarFile   *file,
 
   /* (re)insert the file into the cache */
   if (file->kind != G_FILE_TYPE_UNKNOWN)
-    {
-      g_hash_table_insert (file_cache,
-                           g_object_ref (file->gfile),
-                           weak_ref_new (G_OBJECT (file)));
-    }
+    thunar_file_cache_insert_unlocked (shard, file);
 
-  G_REC_UNLOCK (file_cache_mutex);
+  FILE_CACHE_UNLOCK (shard);
 
   return TRUE;
 }
@@ -1252,13 +1762,15 @@ ThunarFile*
 thunar_file_get (GFile   *gfile,
                  GError **error)
 {
-  ThunarFile *file;
+  ThunarFileCacheShard *shard;
+  ThunarFile           *file;
 
   _thunar_return_val_if_fail (G_IS_FILE (gfile), NULL);
 
   /* both lookup and insert must happen in the same critical section
    * because the insert is contigent upon the lookup */
-  G_REC_LOCK (file_cache_mutex);
+  shard = thunar_file_cache_get_shard (gfile);
+  FILE_CACHE_LOCK (shard);
 
   /* check if we already have a cached version of that file */
   file = thunar_file_cache_lookup (gfile);
@@ -1277,7 +1789,7 @@ thunar_file_get (GFile   *gfile,
         {
           /* Just check that it's been cached, if appropriate */
           if (file->kind != G_FILE_TYPE_UNKNOWN)
-            _thunar_assert (g_hash_table_contains (file_cache, file->gfile) == TRUE);
+            _thunar_assert (g_hash_table_contains (shard->table, file->gfile) == TRUE);
         }
       else
         {
@@ -1290,12 +1802,41 @@ thunar_file_get (GFile   *gfile,
     }
 
   /* finished related activity on the cache */
-  G_REC_UNLOCK (file_cache_mutex);
+  FILE_CACHE_UNLOCK (shard);
+
+  return file;
+}
+
+
+static ThunarFile *
+thunar_file_new_with_info (GFile     *gfile,
+                           GFileInfo *info,
+                           gboolean   not_mounted)
+{
+  ThunarFile *file;
+
+  /* allocate a new object */
+  file = g_object_new (THUNAR_TYPE_FILE, NULL);
+  file->gfile = g_object_ref (gfile);
+
+  /* reset the file */
+  thunar_file_info_clear (file);
+
+  /* set the passed info */
+  file->info = g_object_ref (info);
+
+  /* update the file from the information */
+  thunar_file_info_reload (file, NULL);
+
+  /* update the mounted info */
+  if (not_mounted)
+    FLAG_UNSET (file, THUNAR_FILE_FLAG_IS_MOUNTED);
 
   return file;
 }
 
 
+
 /**
  * thunar_file_get_with_info:
  * @uri         : an URI or an absolute filename.
@@ -1321,13 +1862,15 @@ thunar_file_get_with_info (GFile     *gfile,
                            GFileInfo *recent_info,
                            gboolean   not_mounted)
 {
-  ThunarFile *file;
+  ThunarFileCacheShard *shard;
+  ThunarFile           *file;
 
   _thunar_return_val_if_fail (G_IS_FILE (gfile), NULL);
   _thunar_return_val_if_fail (G_IS_FILE_INFO (info), NULL);
 
   /* all contingent lookups and inserts must happen in the same critical section */
-  G_REC_LOCK (file_cache_mutex);
+  shard = thunar_file_cache_get_shard (gfile);
+  FILE_CACHE_LOCK (shard);
 
   /* check if we already have a cached version of that file */
   file = thunar_file_cache_lookup (gfile);
@@ -1339,30 +1882,14 @@ thunar_file_get_with_info (GFile     *gfile,
   else
     {
       /* allocate a new object */
-      file = g_object_new (THUNAR_TYPE_FILE, NULL);
-      file->gfile = g_object_ref (gfile);
-
-      /* reset the file */
-      thunar_file_info_clear (file);
-
-      /* set the passed info */
-      file->info = g_object_ref (info);
-
-      /* update the file from the information */
-      thunar_file_info_reload (file, NULL);
-
-      /* update the mounted info */
-      if (not_mounted)
-        FLAG_UNSET (file, THUNAR_FILE_FLAG_IS_MOUNTED);
+      file = thunar_file_new_with_info (gfile, info, not_mounted);
 
       /* insert the file into the cache */
-      g_hash_table_insert (file_cache,
-                           g_object_ref (file->gfile),
-                           weak_ref_new (G_OBJECT (file)));
+      thunar_file_cache_insert_unlocked (shard, file);
     }
 
   /* done reading and writing the cache for this file instance */
-  G_REC_UNLOCK (file_cache_mutex);
+  FILE_CACHE_UNLOCK (shard);
 
   if (recent_info != NULL)
     file->recent_info = g_object_ref (recent_info);
@@ -1372,6 +1899,188 @@ thunar_file_get_with_info (GFile     *gfile,
 
 
 
+static GList *
+thunar_file_get_with_info_batch_internal (GFile    *parent,
+                                          GList    *infos,
+                                          gboolean  provisional)
+{
+  ThunarFile **files;
+  ThunarFile **new_files;
+  GFile      **gfiles;
+  GList       *result = NULL;
+  GList       *lp;
+  guint       *shard_ids;
+  guint        n_files;
+  guint        n;
+
+  n_files = g_list_length (infos);
+  if (G_UNLIKELY (n_files == 0))
+    return NULL;
+
+  gfiles = g_new (GFile *, n_files);
+  shard_ids = g_new (guint, n_files);
+  files = g_new0 (ThunarFile *, n_files);
+  new_files = g_new0 (ThunarFile *, n_files);
+
+  for (lp = infos, n = 0; lp != NULL; lp = lp->next, n++)
+    {
+      _thunar_assert (G_IS_FILE_INFO (lp->data));
+      gfiles[n] = g_file_get_child (parent, g_file_info_get_name (lp->data));
+      shard_ids[n] = thunar_file_cache_get_shard (gfiles[n]) - file_cache;
+    }
+
+  /* pick up all files which are already cached */
+  thunar_file_cache_transaction (gfiles, shard_ids, files, NULL, n_files);
+
+  /* construct the missing ones outside of the critical sections */
+  for (lp = infos, n = 0; lp != NULL; lp = lp->next, n++)
+    {
+      if (files[n] != NULL)
+        {
+          /* hand the live info to files shown from a snapshot, it is
+           * applied on the main thread by thunar_file_apply_pending_info() */
+          if (!provisional && FLAG_IS_SET (files[n], THUNAR_FILE_FLAG_PROVISIONAL))
+            g_object_set_qdata_full (G_OBJECT (files[n]), thunar_file_pending_info_quark,
+                                     g_object_ref (lp->data), g_object_unref);
+          continue;
+        }
+
+      new_files[n] = thunar_file_new_with_info (gfiles[n], lp->data, FALSE);
+      if (provisional)
+        FLAG_SET (new_files[n], THUNAR_FILE_FLAG_PROVISIONAL);
+    }
+
+  /* insert them, unless another thread was faster */
+  thunar_file_cache_transaction (gfiles, shard_ids, files, new_files, n_files);
+
+  for (n = n_files; n > 0; n--)
+    {
+      /* release the files which lost the race, see thunar_file_finalize() */
+      if (G_UNLIKELY (new_files[n - 1] != NULL))
+        g_object_unref (new_files[n - 1]);
+
+      result = g_list_prepend (result, files[n - 1]);
+      g_object_unref (gfiles[n - 1]);
+    }
+
+  g_free (gfiles);
+  g_free (shard_ids);
+  g_free (files);
+  g_free (new_files);
+
+  return result;
+}
+
+
+
+/**
+ * thunar_file_get_with_info_batch:
+ * @parent : the #GFile of the folder @infos were enumerated from.
+ * @infos  : (element-type GFileInfo): a #GList of #GFileInfo<!---->s for
+ *           children of @parent, as returned by g_file_enumerator_next_files().
+ *
+ * Batched version of thunar_file_get_with_info() for the children of
+ * @parent. The cache is queried once for the whole batch, the missing
+ * #ThunarFile<!---->s are constructed without holding any cache lock and
+ * are then inserted with a second pass over the cache, so loading big
+ * folders from several threads does not serialize on the cache.
+ *
+ * The caller is responsible to free the returned list using
+ * thunar_g_list_free_full() when no longer needed.
+ *
+ * Return value: (transfer full): the #GList of #ThunarFile<!---->s, in
+ *               the same order as @infos.
+ **/
+GList *
+thunar_file_get_with_info_batch (GFile *parent,
+                                 GList *infos)
+{
+  _thunar_return_val_if_fail (G_IS_FILE (parent), NULL);
+  return thunar_file_get_with_info_batch_internal (parent, infos, FALSE);
+}
+
+
+
+/**
+ * thunar_file_get_provisional_batch:
+ * @parent : the #GFile of the folder @infos were restored for.
+ * @infos  : (element-type GFileInfo): a #GList of #GFileInfo<!---->s
+ *           restored from a folder snapshot.
+ *
+ * Like thunar_file_get_with_info_batch(), but the newly constructed
+ * #ThunarFile<!---->s are marked as provisional. When a real listing
+ * of @parent later returns them, their up-to-date info is kept aside
+ * until thunar_file_apply_pending_info() is called for them.
+ *
+ * The caller is responsible to free the returned list using
+ * thunar_g_list_free_full() when no longer needed.
+ *
+ * Return value: (transfer full): the #GList of #ThunarFile<!---->s, in
+ *               the same order as @infos.
+ **/
+GList *
+thunar_file_get_provisional_batch (GFile *parent,
+                                   GList *infos)
+{
+  _thunar_return_val_if_fail (G_IS_FILE (parent), NULL);
+  return thunar_file_get_with_info_batch_internal (parent, infos, TRUE);
+}
+
+
+
+/**
+ * thunar_file_apply_pending_info:
+ * @file : a #ThunarFile instance.
+ *
+ * If @file was created from a folder snapshot and a real listing
+ * has delivered its info since, replaces the restored info by it.
+ * The content type is kept as long as the file did not change.
+ *
+ * This does not emit #ThunarFile::changed, the caller is expected
+ * to notify the consumers of @file.
+ *
+ * Return value: %TRUE if the info of @file was replaced.
+ **/
+gboolean
+thunar_file_apply_pending_info (ThunarFile *file)
+{
+  GFileInfo *info;
+  gchar     *content_type = NULL;
+
+  _thunar_return_val_if_fail (THUNAR_IS_FILE (file), FALSE);
+
+  if (!FLAG_IS_SET (file, THUNAR_FILE_FLAG_PROVISIONAL))
+    return FALSE;
+
+  info = g_object_steal_qdata (G_OBJECT (file), thunar_file_pending_info_quark);
+  if (info == NULL)
+    return FALSE;
+
+  FLAG_UNSET (file, THUNAR_FILE_FLAG_PROVISIONAL);
+
+  /* the content type from the snapshot is still right for an unmodified file */
+  if (file->info != NULL
+      && g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_STANDARD_TYPE)
+         == g_file_info_get_attribute_uint32 (file->info, G_FILE_ATTRIBUTE_STANDARD_TYPE)
+      && g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_SIZE)
+         == g_file_info_get_attribute_uint64 (file->info, G_FILE_ATTRIBUTE_STANDARD_SIZE)
+      && g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED)
+         == g_file_info_get_attribute_uint64 (file->info, G_FILE_ATTRIBUTE_TIME_MODIFIED))
+    content_type = thunar_file_dup_content_type (file);
+
+  thunar_file_info_clear (file);
+  file->info = info;
+  thunar_file_info_reload (file, NULL);
+
+  if (content_type != NULL)
+    thunar_file_set_content_type (file, content_type);
+  g_free (content_type);
+
+  return TRUE;
+}
+
+
+
 /**
  * thunar_file_get_for_uri:
  * @uri   : an URI or an absolute filename.
@@ -1439,7 +2148,7 @@ thunar_file_get_async (GFile            *location,
 
       /* load the file information asynchronously */
       g_file_query_info_async (location,
-                               THUNARX_FILE_INFO_NAMESPACE,
+                               THUNAR_FILE_INFO_NAMESPACE,
                                G_FILE_QUERY_INFO_NONE,
                                G_PRIORITY_DEFAULT,
                                cancellable,
@@ -1618,7 +2327,7 @@ thunar_file_execute (ThunarFile  *file,
     {
       is_secure = thunar_file_can_execute (file, NULL);
 
-      key_file = thunar_g_file_query_key_file (file->gfile, NULL, &err);
+      key_file = thunar_desktop_file_cache_get_key_file (file->gfile, NULL, NULL, &err);
       if (key_file == NULL)
         {
           g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL,
@@ -1700,7 +2409,7 @@ thunar_file_execute (ThunarFile  *file,
         }
 
       g_free (type);
-      g_key_file_free (key_file);
+      g_key_file_unref (key_file);
     }
   else /* Not a desktop file */
     {
@@ -1935,10 +2644,7 @@ thunar_file_rename (ThunarFile   *file,
                     gboolean      called_from_job,
                     GError      **error)
 {
-  GFile                *renamed_file;
-  ThunarFile           *parent_thunar_file;
-  ThunarFolder         *parent_thunar_folder;
-  gboolean              reload_file = FALSE;
+  GFile *renamed_file;
 
   _thunar_return_val_if_fail (THUNAR_IS_FILE (file), FALSE);
   _thunar_return_val_if_fail (g_utf8_validate (name, -1, NULL), FALSE);
@@ -1951,40 +2657,167 @@ thunar_file_rename (ThunarFile   *file,
   /* check if we succeeded */
   if (renamed_file != NULL)
     {
-      parent_thunar_file = thunar_file_get_parent (file, NULL);
-      if (parent_thunar_file != NULL)
+      thunar_file_renamed (file, renamed_file, called_from_job);
+      g_object_unref (renamed_file);
+      return TRUE;
+    }
+
+  return FALSE;
+}
+
+
+
+/**
+ * thunar_file_renamed:
+ * @file            : a #ThunarFile instance.
+ * @renamed_file    : the new location of @file.
+ * @called_from_job : whether this is called from a #ThunarJob.
+ *
+ * Updates @file after it was renamed to @renamed_file, for callers
+ * which rename the #GFile of @file themselves, for example
+ * asynchronously. Folders with a monitor pick up the change from
+ * the monitor, otherwise @file is reloaded here.
+ **/
+void
+thunar_file_renamed (ThunarFile *file,
+                     GFile      *renamed_file,
+                     gboolean    called_from_job)
+{
+  ThunarFile   *parent_thunar_file;
+  ThunarFolder *parent_thunar_folder;
+  gboolean      reload_file = FALSE;
+
+  _thunar_return_if_fail (THUNAR_IS_FILE (file));
+  _thunar_return_if_fail (G_IS_FILE (renamed_file));
+
+  parent_thunar_file = thunar_file_get_parent (file, NULL);
+  if (parent_thunar_file != NULL)
+    {
+      parent_thunar_folder = thunar_folder_get_for_file (parent_thunar_file);
+      if (parent_thunar_folder != NULL)
         {
-          parent_thunar_folder = thunar_folder_get_for_file (parent_thunar_file);
-          if (parent_thunar_folder != NULL)
-            {
-              /* reload file here only if folder doesn't have a monitor */
-              if (!thunar_folder_has_folder_monitor (parent_thunar_folder))
-                reload_file = TRUE;
-              g_object_unref (parent_thunar_folder);
-            }
-          g_object_unref (parent_thunar_file);
+          /* reload file here only if folder doesn't have a monitor */
+          if (!thunar_folder_has_folder_monitor (parent_thunar_folder))
+            reload_file = TRUE;
+          g_object_unref (parent_thunar_folder);
+        }
+      g_object_unref (parent_thunar_file);
+    }
+
+  if (reload_file)
+    {
+      /* replace GFile in ThunarFile for the renamed file */
+      thunar_file_replace_file (file, renamed_file);
+
+      /* reload file information */
+      thunar_file_load (file, NULL, NULL);
+
+      if (!called_from_job)
+        {
+          /* emit the file changed signal */
+          thunar_file_changed (file);
         }
+    }
+}
+
+
+
+static void
+thunar_file_drop_set_free (gpointer data)
+{
+  ThunarFileDropSet *drop_set = data;
 
-      if (reload_file)
+  g_hash_table_destroy (drop_set->files);
+  g_hash_table_destroy (drop_set->parents);
+  g_hash_table_destroy (drop_set->results);
+  g_free (drop_set->filesystem_id);
+  g_slice_free (ThunarFileDropSet, drop_set);
+}
+
+
+
+static ThunarFileDropSet *
+thunar_file_drop_set_get (GList          *file_list,
+                          GdkDragContext *context)
+{
+  ThunarFileDropSet *drop_set;
+  const gchar       *filesystem_id;
+  ThunarFile        *ofile;
+  ThunarFile        *parent_thunar_file;
+  gboolean           in_prefix = TRUE;
+  GFile             *parent_file;
+  GList             *lp;
+
+  /* the set lives as long as the drag, every drop target has its own list */
+  drop_set = g_object_get_qdata (G_OBJECT (context), thunar_file_drop_set_quark);
+  if (G_LIKELY (drop_set != NULL && drop_set->file_list == file_list))
+    return drop_set;
+
+  drop_set = g_slice_new0 (ThunarFileDropSet);
+  drop_set->file_list = file_list;
+  drop_set->files = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal, g_object_unref, NULL);
+  drop_set->parents = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal, g_object_unref, NULL);
+  drop_set->results = g_hash_table_new_full (g_direct_hash, g_direct_equal, g_object_unref, g_free);
+  drop_set->movable = TRUE;
+
+  for (lp = file_list; lp != NULL; lp = lp->next)
+    {
+      g_hash_table_add (drop_set->files, g_object_ref (lp->data));
+
+      parent_file = g_file_get_parent (lp->data);
+      if (G_LIKELY (parent_file != NULL))
+        g_hash_table_add (drop_set->parents, parent_file);
+
+      if (G_UNLIKELY (thunar_g_file_is_trashed (lp->data)))
         {
-          /* replace GFile in ThunarFile for the renamed file */
-          thunar_file_replace_file (file, renamed_file);
+          /* dropping from the trash always suggests move, the files after that do not matter */
+          drop_set->has_trashed = TRUE;
+          in_prefix = FALSE;
+        }
+
+      if (!in_prefix || !drop_set->movable)
+        continue;
+
+      /* determine the cached version of the source file */
+      ofile = thunar_file_cache_lookup (lp->data);
 
-          /* reload file information */
-          thunar_file_load (file, NULL, NULL);
+      /* fallback to non-cached version */
+      if (ofile == NULL)
+        ofile = thunar_file_get (lp->data, NULL);
 
-          if (!called_from_job)
+      /* we only can 'move' if we know the source folder is writable (i.e. the file can be
+       * deleted) and all files are on one disk, which is compared with each target later */
+      if (ofile == NULL || ofile->info == NULL)
+        {
+          drop_set->movable = FALSE;
+        }
+      else
+        {
+          parent_thunar_file = thunar_file_get_parent (ofile, NULL);
+          if (parent_thunar_file == NULL || !thunar_file_is_writable (parent_thunar_file))
+            drop_set->movable = FALSE;
+          if (parent_thunar_file != NULL)
+            g_object_unref (parent_thunar_file);
+
+          filesystem_id = g_file_info_get_attribute_string (ofile->info, G_FILE_ATTRIBUTE_ID_FILESYSTEM);
+          if (!drop_set->has_filesystem_id)
+            {
+              drop_set->filesystem_id = g_strdup (filesystem_id);
+              drop_set->has_filesystem_id = TRUE;
+            }
+          else if (g_strcmp0 (drop_set->filesystem_id, filesystem_id) != 0)
             {
-              /* emit the file changed signal */
-              thunar_file_changed (file);
+              drop_set->movable = FALSE;
             }
         }
 
-      g_object_unref (renamed_file);
-      return TRUE;
+      if (ofile != NULL)
+        g_object_unref (ofile);
     }
 
-  return FALSE;
+  g_object_set_qdata_full (G_OBJECT (context), thunar_file_drop_set_quark, drop_set, thunar_file_drop_set_free);
+
+  return drop_set;
 }
 
 
@@ -2004,6 +2837,11 @@ thunar_file_rename (ThunarFile   *file,
  * %NULL, the suggested #GdkDragAction for this drop will be stored to the
  * location pointed to by @suggested_action_return.
  *
+ * This is called for every row the pointer crosses, so what is needed of
+ * @file_list is collected once for the drag, and the answer for each
+ * @file is remembered until the drag or its actions change. The
+ * @file_list must not be modified while the drag is in progress.
+ *
  * Return value: the #GdkDragAction<!---->s supported for the drop or
  *               0 if no drop is possible.
  **/
@@ -2013,12 +2851,12 @@ thunar_file_accepts_drop (ThunarFile     *file,
                           GdkDragContext *context,
                           GdkDragAction  *suggested_action_return)
 {
-  GdkDragAction suggested_action;
-  GdkDragAction actions;
-  ThunarFile   *ofile;
-  GFile        *parent_file;
-  ThunarFile   *parent_thunar_file;
-  GList        *lp;
+  ThunarFileDropResult *result;
+  ThunarFileDropSet    *drop_set;
+  GdkDragAction         context_suggested_action;
+  GdkDragAction         context_actions;
+  GdkDragAction         suggested_action;
+  GdkDragAction         actions;
 
   _thunar_return_val_if_fail (THUNAR_IS_FILE (file), 0);
   _thunar_return_val_if_fail (GDK_IS_DRAG_CONTEXT (context), 0);
@@ -2028,10 +2866,25 @@ thunar_file_accepts_drop (ThunarFile     *file,
     return 0;
 
   /* default to whatever GTK+ thinks for the suggested action */
-  suggested_action = gdk_drag_context_get_suggested_action (context);
+  context_suggested_action = gdk_drag_context_get_suggested_action (context);
 
   /* get the possible actions */
-  actions = gdk_drag_context_get_actions (context);
+  context_actions = gdk_drag_context_get_actions (context);
+
+  /* the modifier keys change the actions of the context while dragging */
+  drop_set = thunar_file_drop_set_get (file_list, context);
+  result = g_hash_table_lookup (drop_set->results, file);
+  if (result != NULL
+      && result->context_actions == context_actions
+      && result->context_suggested_action == context_suggested_action)
+    {
+      if (G_LIKELY (suggested_action_return != NULL && result->actions != 0))
+        *suggested_action_return = result->suggested_action;
+      return result->actions;
+    }
+
+  suggested_action = context_suggested_action;
+  actions = context_actions;
 
   /* when the option to ask the user is set, make it the preferred action */
   if (G_UNLIKELY ((actions & GDK_ACTION_ASK) != 0))
@@ -2047,74 +2900,31 @@ thunar_file_accepts_drop (ThunarFile     *file,
       if (thunar_file_is_trash (file))
         actions &= ~(GDK_ACTION_COPY | GDK_ACTION_LINK);
 
-      for (lp = file_list; lp != NULL; lp = lp->next)
+      /* we cannot drop a file on itself, check whether source and destination
+       * are the same, and copy/move/link within the trash is not possible */
+      if (g_hash_table_contains (drop_set->files, file->gfile)
+          || g_hash_table_contains (drop_set->parents, file->gfile)
+          || (drop_set->has_trashed && thunar_file_is_trashed (file)))
         {
-          /* we cannot drop a file on itself */
-          if (G_UNLIKELY (g_file_equal (file->gfile, lp->data)))
-            return 0;
-
-          /* check whether source and destination are the same */
-          parent_file = g_file_get_parent (lp->data);
-          if (G_LIKELY (parent_file != NULL))
-            {
-              if (g_file_equal (file->gfile, parent_file))
-                {
-                  g_object_unref (parent_file);
-                  return 0;
-                }
-              else
-                g_object_unref (parent_file);
-            }
-
-          /* copy/move/link within the trash not possible */
-          if (G_UNLIKELY (thunar_g_file_is_trashed (lp->data) && thunar_file_is_trashed (file)))
-            return 0;
+          actions = 0;
         }
 
       /* if the source offers both copy and move and the GTK+ suggested action is copy, try to be smart telling whether
        * we should copy or move by default by checking whether the source and target are on the same disk.
        */
-      if ((actions & (GDK_ACTION_COPY | GDK_ACTION_MOVE)) != 0
-          && (suggested_action == GDK_ACTION_COPY))
+      else if ((actions & (GDK_ACTION_COPY | GDK_ACTION_MOVE)) != 0
+               && (suggested_action == GDK_ACTION_COPY))
         {
-          /* default to move as suggested action */
-          suggested_action = GDK_ACTION_MOVE;
-
-          for (lp = file_list; lp != NULL; lp = lp->next)
-            {
-              /* dropping from the trash always suggests move */
-              if (G_UNLIKELY (thunar_g_file_is_trashed (lp->data)))
-                break;
-
-              /* determine the cached version of the source file */
-              ofile = thunar_file_cache_lookup (lp->data);
-
-              /* fallback to non-cached version */
-              if (ofile == NULL)
-                ofile = thunar_file_get (lp->data, NULL);
-
-              /* we only can 'move' if we know the source folder is writable (i.e. the file can be deleted)
-               * and both the source and the target are on the same disk.
-               */
-              if (ofile == NULL) 
-                {
-                  suggested_action = GDK_ACTION_COPY;
-                  break;
-                }
-              parent_thunar_file = thunar_file_get_parent (ofile, NULL);
-              if (parent_thunar_file == NULL || !thunar_file_is_writable (parent_thunar_file) || !thunar_file_same_filesystem (file, ofile))
-                {
-                  /* default to copy and get outta here */
-                  suggested_action = GDK_ACTION_COPY;
-                  g_object_unref (parent_thunar_file);
-                  break;
-                }
-              if (parent_thunar_file != NULL)
-                g_object_unref (parent_thunar_file);
-
-              if (ofile != NULL)
-                g_object_unref (ofile);
-            }
+          /* files up to the first one in the trash decide, see thunar_file_drop_set_get() */
+          if (!drop_set->movable)
+            suggested_action = GDK_ACTION_COPY;
+          else if (!drop_set->has_filesystem_id)
+            suggested_action = GDK_ACTION_MOVE;
+          else if (file->info != NULL
+                   && g_strcmp0 (drop_set->filesystem_id, g_file_info_get_attribute_string (file->info, G_FILE_ATTRIBUTE_ID_FILESYSTEM)) == 0)
+            suggested_action = GDK_ACTION_MOVE;
+          else
+            suggested_action = GDK_ACTION_COPY;
         }
     }
   else if (thunar_file_can_execute (file, NULL))
@@ -2123,25 +2933,37 @@ thunar_file_accepts_drop (ThunarFile     *file,
       actions &= (GDK_ACTION_COPY | GDK_ACTION_MOVE | GDK_ACTION_LINK | GDK_ACTION_PRIVATE);
     }
   else
-    return 0;
+    {
+      actions = 0;
+    }
+
+  /* determine a working action */
+  if (actions == 0)
+    ;
+  else if (G_LIKELY ((suggested_action & actions) != 0))
+    ;
+  else if ((actions & GDK_ACTION_ASK) != 0)
+    suggested_action = GDK_ACTION_ASK;
+  else if ((actions & GDK_ACTION_COPY) != 0)
+    suggested_action = GDK_ACTION_COPY;
+  else if ((actions & GDK_ACTION_LINK) != 0)
+    suggested_action = GDK_ACTION_LINK;
+  else if ((actions & GDK_ACTION_MOVE) != 0)
+    suggested_action = GDK_ACTION_MOVE;
+  else
+    suggested_action = GDK_ACTION_PRIVATE;
+
+  /* remember the answer for this target */
+  result = g_new (ThunarFileDropResult, 1);
+  result->context_actions = context_actions;
+  result->context_suggested_action = context_suggested_action;
+  result->actions = actions;
+  result->suggested_action = suggested_action;
+  g_hash_table_replace (drop_set->results, g_object_ref (file), result);
 
   /* determine the preferred action based on the context */
-  if (G_LIKELY (suggested_action_return != NULL))
-    {
-      /* determine a working action */
-      if (G_LIKELY ((suggested_action & actions) != 0))
-        *suggested_action_return = suggested_action;
-      else if ((actions & GDK_ACTION_ASK) != 0)
-        *suggested_action_return = GDK_ACTION_ASK;
-      else if ((actions & GDK_ACTION_COPY) != 0)
-        *suggested_action_return = GDK_ACTION_COPY;
-      else if ((actions & GDK_ACTION_LINK) != 0)
-        *suggested_action_return = GDK_ACTION_LINK;
-      else if ((actions & GDK_ACTION_MOVE) != 0)
-        *suggested_action_return = GDK_ACTION_MOVE;
-      else
-        *suggested_action_return = GDK_ACTION_PRIVATE;
-    }
+  if (G_LIKELY (suggested_action_return != NULL && actions != 0))
+    *suggested_action_return = suggested_action;
 
   /* yeppa, we can drop here */
   return actions;
@@ -2195,37 +3017,126 @@ thunar_file_get_date (const ThunarFile  *file,
     case THUNAR_FILE_RECENCY:
       return g_file_info_get_attribute_int64 (file->recent_info ? file->recent_info : file->info, G_FILE_ATTRIBUTE_RECENT_MODIFIED);
 
-    default:
-      g_warn_if_reached ();
-      return 0;
+    default:
+      g_warn_if_reached ();
+      return 0;
+    }
+
+  return g_file_info_get_attribute_uint64 (file->info, attribute);
+}
+
+
+
+/**
+ * thunar_file_get_date_string:
+ * @file       : a #ThunarFile instance.
+ * @date_type  : the kind of date you are interested to know about @file.
+ * @date_style : the style used to format the date.
+ * @date_custom_style : custom style to apply, if @date_style is set to custom
+ *
+ * Tries to determine the @date_type of @file, and if @file supports the
+ * given @date_type, it'll be formatted as string and returned. The
+ * caller is responsible for freeing the string using the g_free()
+ * function.
+ *
+ * Return value: the @date_type of @file formatted as string.
+ **/
+gchar*
+thunar_file_get_date_string (const ThunarFile  *file,
+                             ThunarFileDateType date_type,
+                             ThunarDateStyle    date_style,
+                             const gchar       *date_custom_style)
+{
+  return thunar_util_humanize_file_time (thunar_file_get_date (file, date_type), date_style, date_custom_style);
+}
+
+
+
+/**
+ * thunar_file_get_column_string:
+ * @file   : a #ThunarFile instance.
+ * @column : a #ThunarColumn.
+ * @format : the formatting options of the caller, see
+ *           thunar_file_set_column_string().
+ *
+ * Returns the formatted string of @column for @file, if it was
+ * memoized with thunar_file_set_column_string() for the same @format
+ * and @file did not change since then.
+ *
+ * Return value: the memoized string, or %NULL if not known.
+ **/
+const gchar*
+thunar_file_get_column_string (const ThunarFile *file,
+                               ThunarColumn      column,
+                               guint             format)
+{
+  _thunar_return_val_if_fail (THUNAR_IS_FILE (file), NULL);
+  _thunar_return_val_if_fail (column < THUNAR_N_VISIBLE_COLUMNS, NULL);
+
+  if (file->column_strings == NULL || file->column_strings->format != format)
+    return NULL;
+
+  return file->column_strings->strings[column];
+}
+
+
+
+/**
+ * thunar_file_set_column_string:
+ * @file   : a #ThunarFile instance.
+ * @column : a #ThunarColumn.
+ * @format : identifies the formatting options used for @string.
+ * @string : (transfer full): the formatted string of @column.
+ *
+ * Memoizes @string as the text of @column for @file, so views don't
+ * have to format it each time they ask a model. The strings are dropped
+ * whenever @file changes.
+ **/
+void
+thunar_file_set_column_string (ThunarFile   *file,
+                               ThunarColumn  column,
+                               guint         format,
+                               gchar        *string)
+{
+  _thunar_return_if_fail (THUNAR_IS_FILE (file));
+  _thunar_return_if_fail (column < THUNAR_N_VISIBLE_COLUMNS);
+
+  /* strings formatted differently are of no use anymore */
+  if (file->column_strings != NULL && file->column_strings->format != format)
+    thunar_file_clear_column_strings (file);
+
+  if (G_UNLIKELY (file->column_strings == NULL))
+    {
+      file->column_strings = g_slice_new0 (ThunarFileColumnStrings);
+      file->column_strings->format = format;
     }
 
-  return g_file_info_get_attribute_uint64 (file->info, attribute);
+  g_free (file->column_strings->strings[column]);
+  file->column_strings->strings[column] = string;
 }
 
 
 
 /**
- * thunar_file_get_date_string:
- * @file       : a #ThunarFile instance.
- * @date_type  : the kind of date you are interested to know about @file.
- * @date_style : the style used to format the date.
- * @date_custom_style : custom style to apply, if @date_style is set to custom
- *
- * Tries to determine the @date_type of @file, and if @file supports the
- * given @date_type, it'll be formatted as string and returned. The
- * caller is responsible for freeing the string using the g_free()
- * function.
+ * thunar_file_clear_column_strings:
+ * @file : a #ThunarFile instance.
  *
- * Return value: the @date_type of @file formatted as string.
+ * Drops the strings memoized with thunar_file_set_column_string().
  **/
-gchar*
-thunar_file_get_date_string (const ThunarFile  *file,
-                             ThunarFileDateType date_type,
-                             ThunarDateStyle    date_style,
-                             const gchar       *date_custom_style)
+void
+thunar_file_clear_column_strings (ThunarFile *file)
 {
-  return thunar_util_humanize_file_time (thunar_file_get_date (file, date_type), date_style, date_custom_style);
+  guint n;
+
+  _thunar_return_if_fail (THUNAR_IS_FILE (file));
+
+  if (G_LIKELY (file->column_strings == NULL))
+    return;
+
+  for (n = 0; n < THUNAR_N_VISIBLE_COLUMNS; ++n)
+    g_free (file->column_strings->strings[n]);
+  g_slice_free (ThunarFileColumnStrings, file->column_strings);
+  file->column_strings = NULL;
 }
 
 
@@ -2510,23 +3421,133 @@ thunar_file_get_content_type (ThunarFile *file)
 
 
 
+static gboolean
+thunar_file_content_type_changed (gpointer user_data)
+{
+  ThunarFile *file = THUNAR_FILE (user_data);
+
+  file->icon_name = NULL;
+  thunar_file_changed (file);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
 /**
  * thunar_file_set_content_type:
  * @file : a #ThunarFile.
  * @content_type : The content type
  *
- * Sets the conetnt type of a #ThunarFile.
+ * Sets the conetnt type of a #ThunarFile, unless it is known already.
+ * A content type guessed from the name is replaced, and if that changes
+ * the icon of @file, ::changed is emitted from the main thread.
  **/
 void
 thunar_file_set_content_type (ThunarFile  *file,
                               const gchar *content_type)
+{
+  gboolean changed = FALSE;
+
+  _thunar_return_if_fail (THUNAR_IS_FILE (file));
+
+  g_mutex_lock (&file->content_type_mutex);
+  if (G_LIKELY (file->content_type == NULL))
+    {
+      file->content_type = g_intern_string (content_type);
+    }
+  else if (file->content_type_guessed)
+    {
+      /* interned, so the guess stays valid for those who got it */
+      changed = (strcmp (file->content_type, content_type) != 0);
+      file->content_type = g_intern_string (content_type);
+      file->content_type_guessed = FALSE;
+    }
+  g_mutex_unlock (&file->content_type_mutex);
+
+  /* the views redraw the file with the icon of its new type */
+  if (changed)
+    {
+      if (g_main_context_is_owner (g_main_context_default ()))
+        thunar_file_content_type_changed (file);
+      else
+        g_main_context_invoke_full (NULL, G_PRIORITY_DEFAULT, thunar_file_content_type_changed,
+                                    g_object_ref (file), g_object_unref);
+    }
+}
+
+
+
+/**
+ * thunar_file_set_guessed_content_type:
+ * @file         : a #ThunarFile.
+ * @content_type : the content type matching the name of @file.
+ *
+ * Like thunar_file_set_content_type(), but @content_type is shown only
+ * until a sniffed one replaces it, see thunar_file_has_content_type().
+ **/
+void
+thunar_file_set_guessed_content_type (ThunarFile  *file,
+                                      const gchar *content_type)
 {
   _thunar_return_if_fail (THUNAR_IS_FILE (file));
 
   g_mutex_lock (&file->content_type_mutex);
   if (G_LIKELY (file->content_type == NULL))
-    file->content_type = g_strdup (content_type);
+    {
+      file->content_type = g_intern_string (content_type);
+      file->content_type_guessed = TRUE;
+    }
+  g_mutex_unlock (&file->content_type_mutex);
+}
+
+
+
+/**
+ * thunar_file_has_content_type:
+ * @file : a #ThunarFile instance.
+ *
+ * Return value: %TRUE if the content type of @file is determined, and
+ *               not just guessed from its name.
+ **/
+gboolean
+thunar_file_has_content_type (ThunarFile *file)
+{
+  gboolean known;
+
+  _thunar_return_val_if_fail (THUNAR_IS_FILE (file), FALSE);
+
+  g_mutex_lock (&file->content_type_mutex);
+  known = (file->content_type != NULL && !file->content_type_guessed);
+  g_mutex_unlock (&file->content_type_mutex);
+
+  return known;
+}
+
+
+
+/**
+ * thunar_file_dup_content_type:
+ * @file : a #ThunarFile instance.
+ *
+ * Unlike thunar_file_get_content_type(), this never loads the
+ * content type of @file.
+ *
+ * Return value: a copy of the content type of @file, or %NULL if it
+ *               was not determined yet. Free with g_free().
+ **/
+gchar *
+thunar_file_dup_content_type (ThunarFile *file)
+{
+  gchar *content_type;
+
+  _thunar_return_val_if_fail (THUNAR_IS_FILE (file), NULL);
+
+  g_mutex_lock (&file->content_type_mutex);
+  content_type = g_strdup (file->content_type);
   g_mutex_unlock (&file->content_type_mutex);
+
+  return content_type;
 }
 
 
@@ -2569,10 +3590,39 @@ thunar_file_get_content_type_desc (ThunarFile *file)
 
 
 
+/**
+ * thunar_file_guess_content_type:
+ * @file      : a #ThunarFile instance.
+ * @uncertain : return location for whether the name is ambiguous.
+ *
+ * Guesses the content type of a regular @file from the globs of
+ * shared-mime-info only, without reading it. GIO does the same for local
+ * files before it sniffs their header, and sniffs only if @uncertain.
+ *
+ * Return value: the content type or %NULL, if @file is no regular file
+ *               or a symlink. Free with g_free().
+ **/
+gchar *
+thunar_file_guess_content_type (ThunarFile *file,
+                                gboolean   *uncertain)
+{
+  _thunar_return_val_if_fail (THUNAR_IS_FILE (file), NULL);
+  _thunar_return_val_if_fail (uncertain != NULL, NULL);
+
+  /* the other kinds and the symlinks get their type from the file system */
+  if (file->kind != G_FILE_TYPE_REGULAR || thunar_file_is_symlink (file))
+    return NULL;
+
+  return g_content_type_guess (thunar_file_get_basename (file), NULL, 0, uncertain);
+}
+
+
+
 static void
 thunar_file_load_content_type (ThunarFile *file)
 {
-  gchar *content_type = NULL;
+  gchar    *content_type = NULL;
+  gboolean  uncertain = FALSE;
 
   _thunar_return_if_fail (THUNAR_IS_FILE (file));
 
@@ -2587,6 +3637,21 @@ thunar_file_load_content_type (ThunarFile *file)
       return;
     }
 
+  /* the name is enough for most files. Sniffing the others would read them
+   * from the main thread, which is left to the jobs of the folder unless
+   * the file is on a local device */
+  content_type = thunar_file_guess_content_type (file, &uncertain);
+  if (content_type != NULL && (!uncertain || !thunar_g_file_is_on_local_device (file->gfile)))
+    {
+      if (uncertain)
+        thunar_file_set_guessed_content_type (file, content_type);
+      else
+        thunar_file_set_content_type (file, content_type);
+      g_free (content_type);
+      return;
+    }
+  g_free (content_type);
+
   content_type = thunar_g_file_get_content_type (file->gfile);
   thunar_file_set_content_type (file, content_type);
   g_free (content_type);
@@ -2731,7 +3796,7 @@ thunar_file_get_default_handler (const ThunarFile *file)
       must_support_uris = (path == NULL);
       g_free (path);
 
-      app_info = g_app_info_get_default_for_type (content_type, must_support_uris);
+      app_info = thunar_app_index_get_default_for_type (content_type, must_support_uris);
     }
 
   if (app_info == NULL)
@@ -3106,7 +4171,7 @@ thunar_file_can_execute (ThunarFile *file,
   /* Desktop files outside XDG_DATA_DIRS, need to be 'trusted'. */
   if (thunar_g_vfs_metadata_is_supported ())
     {
-      gboolean can_execute = xfce_g_file_is_trusted (file_to_check->gfile, NULL, NULL);
+      gboolean can_execute = thunar_desktop_file_cache_is_trusted (file_to_check->gfile, NULL);
       g_object_unref (file_to_check);
       return can_execute;
     }
@@ -3161,6 +4226,10 @@ thunar_file_is_writable (const ThunarFile *file)
   if (file->info == NULL)
     return FALSE;
 
+  /* the files of an unreachable mount are shown read-only */
+  if (!thunar_mount_health_is_reachable (file->gfile))
+    return FALSE;
+
   if (!g_file_info_has_attribute (file->info, G_FILE_ATTRIBUTE_ACCESS_CAN_WRITE))
     return TRUE;
 
@@ -3329,6 +4398,27 @@ thunar_file_get_display_name (const ThunarFile *file)
 
 
 
+/**
+ * thunar_file_get_collate_key:
+ * @file           : a #ThunarFile instance.
+ * @case_sensitive : whether the case sensitive key is requested.
+ *
+ * Returns the collation key of the display name of @file, as
+ * used by thunar_file_compare_by_name(). The key is owned by
+ * @file and valid until @file changes.
+ *
+ * Return value: the collation key of @file.
+ **/
+const gchar *
+thunar_file_get_collate_key (const ThunarFile *file,
+                             gboolean          case_sensitive)
+{
+  _thunar_return_val_if_fail (THUNAR_IS_FILE (file), NULL);
+  return thunar_file_ensure_collate_key (file, case_sensitive);
+}
+
+
+
 /**
  * thunar_file_get_deletion_date:
  * @file       : a #ThunarFile instance.
@@ -3530,79 +4620,27 @@ thunar_file_can_be_trashed (const ThunarFile *file)
 
 /**
  * thunar_file_get_file_count
- * @file    : a #ThunarFile instance.
- * @callback: a #GCallback to be executed after the file count
- * @data    : a #gpointer containing user data to pass to the callback
+ * @file   : a #ThunarFile instance.
+ * @update : whether to count the items again if @file changed.
  *
- * Returns the number of items in the directory
- * Counts the number of files in the directory as fast as possible.
- * Will use cached data to do calculations only when the file has
- * been modified since the last time its contents were counted.
+ * Returns the number of items in the directory as counted last time.
+ * If @update is %TRUE and the directory was modified since it was
+ * counted, it is counted again by the count scheduler, and @file emits
+ * "changed" once the new number differs.
  *
  * Return value: Number of files in a folder
  **/
 guint
-thunar_file_get_file_count (ThunarFile   *file,
-                            GCallback     callback,
-                            gpointer      data)
+thunar_file_get_file_count (ThunarFile *file,
+                            gboolean    update)
 {
-  GError                    *err = NULL;
-  ThunarJob                 *job;
-  GFileInfo                 *info;
-  guint64                    last_modified;
-
   _thunar_return_val_if_fail (thunar_file_is_directory (file), 0);
 
-  /* Forcefully get cached values by passing NULL as the second argument */
-  if (callback == NULL)
-    return file->file_count;
-
-  info = g_file_query_info (thunar_file_get_file (file),
-                            G_FILE_ATTRIBUTE_TIME_MODIFIED,
-                            G_FILE_QUERY_INFO_NONE,
-                            NULL,
-                            &err);
-
-  if (err != NULL)
-    {
-      g_warning ("An error occurred while trying to get file counts.");
-      return file->file_count;
-    }
-
-  last_modified = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
-  g_object_unref (info);
-
-  /* return a cached value if last time that the file count was computed is later
-   * than the last time the file was modified */
-  if (G_LIKELY (last_modified < file->file_count_timestamp))
-    {
-      /* For consistent behavior we might as well call the callback;
-       * Although the ExoJob parameter will be NULL which should be
-       * dealt with accordingly by the callback */
-      ((void (*) (ExoJob *, gpointer)) (*callback)) (NULL, data);
-      return file->file_count;
-    }
-
-  /* put the timestamp calculation at the *start* of the process to prevent another call to
-   * thunar_file_get_count starting another job on the same folder before one has ended.
-   * Divide by 1e6 to convert from microseconds to seconds */
-  file->file_count_timestamp = g_get_real_time () / (guint64) 1e6;
-
-  /* set up a job to actually enumerate over the folder's contents and get its file count */
-  job = thunar_io_jobs_count_files (file);
-
-  /* set up the signal on finish to call the callback and keep a reference on the data */
-  if (callback != NULL)
-    {
-      g_signal_connect_data (job,
-                             "finished",
-                             G_CALLBACK (callback),
-                             data,
-                             (GClosureNotify) (void (*)(void)) g_object_unref,
-                             G_CONNECT_AFTER);
-    }
-
-  exo_job_launch (EXO_JOB (job));
+  /* the modification time of the info is used on purpose, querying the
+   * folder again here would block the views on slow network shares */
+  if (update && (!FLAG_IS_SET (file, THUNAR_FILE_FLAG_COUNT_VALID)
+                 || file->file_count_mtime != thunar_file_get_date (file, THUNAR_FILE_DATE_MODIFIED)))
+    thunar_count_scheduler_queue (file);
 
   return file->file_count;
 }
@@ -3611,19 +4649,24 @@ thunar_file_get_file_count (ThunarFile   *file,
 
 /**
  * thunar_file_set_file_count
- * @file: A #ThunarFileInstance
- * @count: The value to set the file's count to
+ * @file  : A #ThunarFileInstance
+ * @count : The value to set the file's count to
+ * @mtime : the modification time of @file when it was counted.
  *
- * Set @file's count to the given number if it is a directory.
- * Does *NOT* update the file's count timestamp.
+ * Set @file's count to the given number if it is a directory. The
+ * count is up to date as long as the modification time of @file
+ * equals @mtime.
  **/
 void
 thunar_file_set_file_count (ThunarFile  *file,
-                            const guint  count)
+                            const guint  count,
+                            guint64      mtime)
 {
   _thunar_return_if_fail (thunar_file_is_directory (file));
 
   file->file_count = count;
+  file->file_count_mtime = mtime;
+  FLAG_SET (file, THUNAR_FILE_FLAG_COUNT_VALID);
 }
 
 
@@ -3650,6 +4693,8 @@ thunar_file_get_emblem_names (ThunarFile *file)
   if (file->info == NULL)
     return NULL;
 
+  thunar_file_load_metadata (file);
+
   /* determine the custom emblems and transform them to a g_list */
   emblem_names_joined = thunar_g_file_get_metadata_setting (file->gfile, file->info, THUNAR_GTYPE_STRINGV, "emblems");
   if (emblem_names_joined != NULL)
@@ -3768,73 +4813,86 @@ thunar_file_is_desktop (const ThunarFile *file)
 
 
 
-static gchar *
-thunar_file_get_thumbnail_path_real (ThunarFile         *file,
-                                     ThunarThumbnailSize thumbnail_size)
+static void
+thunar_file_thumbnail_dir_changed (GFileMonitor     *monitor,
+                                   GFile            *file,
+                                   GFile            *other_file,
+                                   GFileMonitorEvent event_type,
+                                   gpointer          user_data)
 {
-  GChecksum *checksum;
-  gchar     *filename;
-  gchar     *uri;
-  gchar     *thumbnail_path = NULL;
+  ThunarThumbnailSize thumbnail_size = GPOINTER_TO_UINT (user_data);
 
-  _thunar_return_val_if_fail (THUNAR_IS_FILE (file), NULL);
+  /* forget all cached misses of that size */
+  if (event_type != G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT)
+    thumbnail_dir_generation[thumbnail_size]++;
+}
 
-  checksum = g_checksum_new (G_CHECKSUM_MD5);
-  if (G_LIKELY (checksum != NULL))
-    {
-      uri = thunar_file_dup_uri (file);
-      g_checksum_update (checksum, (const guchar *) uri, strlen (uri));
-      g_free (uri);
 
-      filename = g_strconcat (g_checksum_get_string (checksum), ".png", NULL);
 
-      /* The thumbnail is in the format/location
-       * $XDG_CACHE_HOME/thumbnails/(nromal|large)/MD5_Hash_Of_URI.png
-       * for version 0.8.0 if XDG_CACHE_HOME is defined, otherwise
-       * /homedir/.thumbnails/(normal|large)/MD5_Hash_Of_URI.png
-       * will be used, which is also always used for versions prior
-       * to 0.7.0.
-       */
+static guint
+thunar_file_get_thumbnail_dir_generation (ThunarThumbnailSize thumbnail_size)
+{
+  gchar *path;
+  GFile *dir;
 
-      /* build and check if the thumbnail is in the new location */
-      thumbnail_path = g_build_path ("/", g_get_user_cache_dir(),
-                                           "thumbnails", thunar_thumbnail_size_get_nick (thumbnail_size),
-                                           filename, NULL);
+  /* watch the thumbnail cache directory of the size on first use, without
+   * a monitor the generation stays 0 and misses aren't cached at all */
+  if (G_UNLIKELY (!thumbnail_dir_watched[thumbnail_size]))
+    {
+      thumbnail_dir_watched[thumbnail_size] = TRUE;
 
-      if (!g_file_test(thumbnail_path, G_FILE_TEST_EXISTS))
+      path = g_build_filename (g_get_user_cache_dir (), "thumbnails", thunar_thumbnail_size_get_nick (thumbnail_size), NULL);
+      dir = g_file_new_for_path (path);
+      thumbnail_dir_monitors[thumbnail_size] = g_file_monitor_directory (dir, G_FILE_MONITOR_NONE, NULL, NULL);
+      if (thumbnail_dir_monitors[thumbnail_size] != NULL)
         {
-          /* Fallback to old version */
-          g_free(thumbnail_path);
+          g_signal_connect (thumbnail_dir_monitors[thumbnail_size], "changed",
+                            G_CALLBACK (thunar_file_thumbnail_dir_changed), GUINT_TO_POINTER (thumbnail_size));
+          thumbnail_dir_generation[thumbnail_size] = 1;
+        }
+      g_object_unref (dir);
+      g_free (path);
+    }
 
-          thumbnail_path = g_build_filename (xfce_get_homedir (),
-                                                   ".thumbnails", thunar_thumbnail_size_get_nick (thumbnail_size),
-                                                   filename, NULL);
+  return thumbnail_dir_generation[thumbnail_size];
+}
 
-          if(!g_file_test(thumbnail_path, G_FILE_TEST_EXISTS))
-            {
-              g_free(thumbnail_path);
-              thumbnail_path = NULL;
 
-              if (thunar_file_is_directory (file) == FALSE)
-                {
-                  /* Thumbnail doesn't exist in either spot, look for shared repository */
-                  uri = thunar_file_dup_uri (file);
-                  thumbnail_path = xfce_create_shared_thumbnail_path (uri, thunar_thumbnail_size_get_nick (thumbnail_size));
-                  g_free (uri);
 
-                  if (thumbnail_path != NULL && !g_file_test (thumbnail_path, G_FILE_TEST_EXISTS))
-                    {
-                      /* Thumbnail doesn't exist */
-                      g_free (thumbnail_path);
-                      thumbnail_path = NULL;
-                    }
-                }
-            }
-        }
+static gchar *
+thunar_file_get_thumbnail_path_real (ThunarFile         *file,
+                                     ThunarThumbnailSize thumbnail_size)
+{
+  GChecksum *checksum;
+  gsize      length = sizeof (file->uri_hash);
+  gchar      uri_hash[2 * sizeof (file->uri_hash) + 1];
+  gchar     *uri;
+  gchar     *thumbnail_path;
+  guint      n;
+
+  _thunar_return_val_if_fail (THUNAR_IS_FILE (file), NULL);
 
-      g_free (filename);
+  uri = thunar_file_dup_uri (file);
+
+  /* the checksum only changes with the uri */
+  if (!FLAG_IS_SET (file, THUNAR_FILE_FLAG_URI_HASH))
+    {
+      checksum = g_checksum_new (G_CHECKSUM_MD5);
+      g_checksum_update (checksum, (const guchar *) uri, strlen (uri));
+      g_checksum_get_digest (checksum, file->uri_hash, &length);
       g_checksum_free (checksum);
+      FLAG_SET (file, THUNAR_FILE_FLAG_URI_HASH);
+    }
+
+  for (n = 0; n < sizeof (file->uri_hash); n++)
+    {
+      uri_hash[2 * n] = "0123456789abcdef"[file->uri_hash[n] >> 4];
+      uri_hash[2 * n + 1] = "0123456789abcdef"[file->uri_hash[n] & 0xf];
     }
+  uri_hash[2 * n] = '\0';
+
+  thumbnail_path = thunar_util_get_thumbnail_path_for_hash (uri, uri_hash, thunar_file_is_directory (file), thumbnail_size);
+  g_free (uri);
 
   return thumbnail_path;
 }
@@ -3845,6 +4903,8 @@ const gchar *
 thunar_file_get_thumbnail_path (ThunarFile         *file,
                                 ThunarThumbnailSize thumbnail_size)
 {
+  guint generation;
+
   _thunar_return_val_if_fail (THUNAR_IS_FILE (file), NULL);
 
   /* if the thumbstate is known to be not there, return null */
@@ -3853,7 +4913,16 @@ thunar_file_get_thumbnail_path (ThunarFile         *file,
 
   /* cache the real thumbnail path */
   if (G_UNLIKELY (file->thumbnail_path[thumbnail_size] == NULL))
-    file->thumbnail_path[thumbnail_size] = thunar_file_get_thumbnail_path_real (file, thumbnail_size);
+    {
+      /* nothing was added to the thumbnail cache since the last miss */
+      generation = thunar_file_get_thumbnail_dir_generation (thumbnail_size);
+      if (generation != 0 && file->thumbnail_miss[thumbnail_size] == generation)
+        return NULL;
+
+      file->thumbnail_path[thumbnail_size] = thunar_file_get_thumbnail_path_real (file, thumbnail_size);
+      if (file->thumbnail_path[thumbnail_size] == NULL)
+        file->thumbnail_miss[thumbnail_size] = generation;
+    }
 
   return file->thumbnail_path[thumbnail_size];
 }
@@ -3875,7 +4944,7 @@ thunar_file_get_thumb_state (const ThunarFile   *file,
                              ThunarThumbnailSize size)
 {
   _thunar_return_val_if_fail (THUNAR_IS_FILE (file), THUNAR_FILE_THUMB_STATE_UNKNOWN);
-  return file->thumbnail_state[size];
+  return (ThunarFileThumbState) file->thumbnail_state[size];
 }
 
 
@@ -4099,14 +5168,14 @@ thunar_file_get_icon_name (ThunarFile          *file,
     }
 
   /* store new name, fallback to legacy names, or empty string to avoid recursion */
-  g_free (file->icon_name);
   if (G_LIKELY (icon_name != NULL))
-    file->icon_name = icon_name;
+    file->icon_name = g_intern_string (icon_name);
   else if (file->kind == G_FILE_TYPE_DIRECTORY
            && gtk_icon_theme_has_icon (icon_theme, "folder"))
-    file->icon_name = g_strdup ("folder");
+    file->icon_name = g_intern_static_string ("folder");
   else
-    file->icon_name = g_strdup ("");
+    file->icon_name = g_intern_static_string ("");
+  g_free (icon_name);
 
   return thunar_file_get_icon_name_for_state (file->icon_name, icon_state);
 }
@@ -4163,31 +5232,25 @@ thunar_file_watch (ThunarFile *file)
   file_watch = g_object_get_qdata (G_OBJECT (file), thunar_file_watch_quark);
   if (file_watch == NULL)
     {
-      file_watch = g_slice_new (ThunarFileWatch);
+      file_watch = g_slice_new0 (ThunarFileWatch);
+      file_watch->file = file;
       file_watch->watch_count = 1;
 
-      /* create a file or directory monitor */
-      file_watch->monitor = g_file_monitor (file->gfile, G_FILE_MONITOR_WATCH_MOUNTS, NULL, &error);
-
-      if (G_UNLIKELY (file_watch->monitor == NULL))
+      if (!thunar_file_watch_connect (file_watch, &error))
         {
           g_debug ("Failed to create file monitor: %s", error->message);
           g_error_free (error);
-          file->no_file_watch = TRUE;
-        }
-      else
-        {
-          /* watch monitor for file changes */
-          g_signal_connect (file_watch->monitor, "changed", G_CALLBACK (thunar_file_monitor), file);
+          FLAG_SET (file, THUNAR_FILE_FLAG_NO_FILE_WATCH);
         }
 
       /* attach to file */
       g_object_set_qdata_full (G_OBJECT (file), thunar_file_watch_quark, file_watch, thunar_file_watch_destroyed);
     }
-  else if (G_LIKELY (!file->no_file_watch))
+  else if (G_LIKELY (!FLAG_IS_SET (file, THUNAR_FILE_FLAG_NO_FILE_WATCH)))
     {
       /* increase watch count */
-      _thunar_return_if_fail (G_IS_FILE_MONITOR (file_watch->monitor));
+      _thunar_return_if_fail (G_IS_FILE_MONITOR (file_watch->monitor) || file_watch->inotify_watch != NULL
+                              || file_watch->folder != NULL);
       file_watch->watch_count++;
     }
 }
@@ -4208,7 +5271,7 @@ thunar_file_unwatch (ThunarFile *file)
 
   _thunar_return_if_fail (THUNAR_IS_FILE (file));
 
-  if (G_UNLIKELY (file->no_file_watch))
+  if (G_UNLIKELY (FLAG_IS_SET (file, THUNAR_FILE_FLAG_NO_FILE_WATCH)))
     {
       return;
     }
@@ -4228,6 +5291,57 @@ thunar_file_unwatch (ThunarFile *file)
 
 
 
+/**
+ * thunar_file_watch_event:
+ * @file       : a watched #ThunarFile instance.
+ * @event_path : the #GFile the event occurred for.
+ * @event_type : the #GFileMonitorEvent.
+ *
+ * Called by the #ThunarFolder whose directory monitor delivers
+ * the changes of @file, for the events of @file the folder
+ * does not handle itself.
+ **/
+void
+thunar_file_watch_event (ThunarFile       *file,
+                         GFile            *event_path,
+                         GFileMonitorEvent event_type)
+{
+  _thunar_return_if_fail (THUNAR_IS_FILE (file));
+  _thunar_return_if_fail (G_IS_FILE (event_path));
+
+  thunar_file_handle_event (file, event_path, event_type);
+}
+
+
+
+/**
+ * thunar_file_watch_unrouted:
+ * @file : a watched #ThunarFile instance.
+ *
+ * Called by the #ThunarFolder delivering the changes of @file
+ * once it goes away, so @file gets a monitor of its own for
+ * the remaining watches.
+ **/
+void
+thunar_file_watch_unrouted (ThunarFile *file)
+{
+  ThunarFileWatch *file_watch;
+
+  _thunar_return_if_fail (THUNAR_IS_FILE (file));
+
+  file_watch = g_object_get_qdata (G_OBJECT (file), thunar_file_watch_quark);
+  if (G_LIKELY (file_watch != NULL && file_watch->folder != NULL))
+    {
+      /* the folder already forgot about the file */
+      file_watch->folder = NULL;
+
+      if (!thunar_file_watch_connect (file_watch, NULL))
+        g_debug ("Failed to create file monitor for %s", file->display_name);
+    }
+}
+
+
+
 /**
  * thunar_file_reload:
  * @file : a #ThunarFile instance.
@@ -4250,6 +5364,10 @@ thunar_file_reload (ThunarFile *file)
 
   if (!thunar_file_load (file, NULL, NULL))
     {
+      /* the file is reloaded once the mount is reachable again */
+      if (!thunar_mount_health_is_reachable (file->gfile))
+        return TRUE;
+
       /* destroy the file if we cannot query any file information */
       thunar_file_destroy (file);
       return FALSE;
@@ -4263,13 +5381,48 @@ thunar_file_reload (ThunarFile *file)
 
 
 
-static gboolean
-thunar_file_reload_cb_once (gpointer user_data)
+/**
+ * thunar_file_reload_with_info:
+ * @file  : a #ThunarFile instance.
+ * @info  : (transfer full): a #GFileInfo queried with
+ *          %THUNAR_FILE_INFO_NAMESPACE for @file, or %NULL.
+ * @error : (transfer full): the error of the query if @info is %NULL.
+ *
+ * Same as thunar_file_reload(), but with the file information
+ * already queried elsewhere, see thunar_reload_scheduler_queue().
+ *
+ * Return value: %TRUE if @file was reloaded, %FALSE if it
+ *               was destroyed.
+ **/
+gboolean
+thunar_file_reload_with_info (ThunarFile *file,
+                              GFileInfo  *info,
+                              GError     *error)
 {
-  ThunarFile *file = user_data;
+  _thunar_return_val_if_fail (THUNAR_IS_FILE (file), FALSE);
+  _thunar_return_val_if_fail (info == NULL || G_IS_FILE_INFO (info), FALSE);
+
+  /* keep the last known information if the server went away */
+  if (info == NULL && !thunar_mount_health_is_reachable (file->gfile))
+    {
+      g_error_free (error);
+      return TRUE;
+    }
+
+  /* clear file pxmap cache */
+  thunar_icon_factory_clear_pixmap_cache (file);
+
+  if (!thunar_file_load_info (file, info, error, NULL, NULL))
+    {
+      /* destroy the file if we cannot query any file information */
+      thunar_file_destroy (file);
+      return FALSE;
+    }
+
+  /* ... and tell others */
+  thunar_file_changed (file);
 
-  thunar_file_reload (file);
-  return FALSE;
+  return TRUE;
 }
 
 
@@ -4278,8 +5431,9 @@ thunar_file_reload_cb_once (gpointer user_data)
  * thunar_file_reload_idle:
  * @file : a #ThunarFile instance.
  *
- * Schedules a single reload of the @file by calling thunar_file_reload
- * when idle.
+ * Schedules a single reload of the @file when idle. Multiple
+ * requests for the same file are merged and the file information
+ * is queried in a worker thread, see thunar_reload_scheduler_queue().
  *
  **/
 void
@@ -4287,7 +5441,7 @@ thunar_file_reload_idle (ThunarFile *file)
 {
   _thunar_return_if_fail (THUNAR_IS_FILE (file));
 
-  g_idle_add (thunar_file_reload_cb_once, file);
+  thunar_reload_scheduler_queue (file);
 }
 
 
@@ -4306,10 +5460,9 @@ thunar_file_reload_idle_unref (ThunarFile *file)
 {
   _thunar_return_if_fail (THUNAR_IS_FILE (file));
 
-  g_idle_add_full (G_PRIORITY_DEFAULT_IDLE,
-                   thunar_file_reload_cb_once,
-                   file,
-                   (GDestroyNotify) g_object_unref);
+  /* the scheduler holds its own reference */
+  thunar_reload_scheduler_queue (file);
+  g_object_unref (file);
 }
 
 
@@ -4346,74 +5499,6 @@ thunar_file_destroy (ThunarFile *file)
 
 
 
-/**
- * thunar_file_compare_by_type:
- * @a : the first #ThunarFile.
- * @b : the second #ThunarFile.
- *
- * Compares items so that directories come before files and ancestors come
- * before descendants.
- *
- * Return value: -1 if @file_a should be sorted before @file_b, 1 if
- *               @file_b should be sorted before @file_a, 0 if equal.
- **/
-gint
-thunar_file_compare_by_type (ThunarFile *a,
-                             ThunarFile *b)
-{
-  GFile *file_a;
-  GFile *file_b;
-  GFile *parent_a;
-  GFile *parent_b;
-  gint   ret = 0;
-
-  file_a = thunar_file_get_file (a);
-  file_b = thunar_file_get_file (b);
-
-  /* check whether the files are equal */
-  if (g_file_equal (file_a, file_b))
-    return 0;
-
-  /* directories always come first */
-  if (a->kind == G_FILE_TYPE_DIRECTORY
-      && b->kind != G_FILE_TYPE_DIRECTORY)
-    {
-      return -1;
-    }
-  if (a->kind != G_FILE_TYPE_DIRECTORY
-      && b->kind == G_FILE_TYPE_DIRECTORY)
-    {
-      return 1;
-    }
-
-  /* ancestors come first */
-  if (g_file_has_prefix (file_b, file_a))
-    return -1;
-  if (g_file_has_prefix (file_a, file_b))
-    return 1;
-
-  parent_a = g_file_get_parent (file_a);
-  parent_b = g_file_get_parent (file_b);
-
-  if (g_file_equal (parent_a, parent_b))
-    {
-      /* compare siblings by their display name */
-      ret = g_utf8_collate (a->display_name,
-                            b->display_name);
-    }
-  /* again, ancestors come first */
-  else if (g_file_has_prefix (file_b, parent_a))
-      ret = -1;
-  else if (g_file_has_prefix (file_a, parent_b))
-      ret = 1;
-
-  g_object_unref (parent_a);
-  g_object_unref (parent_b);
-  return ret;
-}
-
-
-
 /**
  * thunar_file_compare_by_name:
  * @file_a         : the first #ThunarFile.
@@ -4443,11 +5528,13 @@ thunar_file_compare_by_name (const ThunarFile *file_a,
 
   /* case insensitive checking */
   if (G_LIKELY (!case_sensitive))
-    result = g_strcmp0 (file_a->collate_key_nocase, file_b->collate_key_nocase);
+    result = g_strcmp0 (thunar_file_ensure_collate_key (file_a, FALSE),
+                        thunar_file_ensure_collate_key (file_b, FALSE));
 
   /* fall-back to case sensitive */
   if (result == 0)
-    result = g_strcmp0 (file_a->collate_key, file_b->collate_key);
+    result = g_strcmp0 (thunar_file_ensure_collate_key (file_a, TRUE),
+                        thunar_file_ensure_collate_key (file_b, TRUE));
 
   /* this happens in the trash */
   if (result == 0)
@@ -4508,36 +5595,171 @@ thunar_file_same_filesystem (const ThunarFile *file_a,
 ThunarFile *
 thunar_file_cache_lookup (const GFile *file)
 {
-  GWeakRef   *ref;
-  ThunarFile *cached_file;
+  ThunarFileCacheShard *shard;
+  GWeakRef             *ref;
+  ThunarFile           *cached_file;
 
   _thunar_return_val_if_fail (G_IS_FILE (file), NULL);
 
-  G_REC_LOCK (file_cache_mutex);
-
-  /* allocate the ThunarFile cache on-demand */
-  if (G_UNLIKELY (file_cache == NULL))
-    {
-      file_cache = g_hash_table_new_full (g_file_hash,
-                                          (GEqualFunc) g_file_equal,
-                                          (GDestroyNotify) g_object_unref,
-                                          (GDestroyNotify) weak_ref_free);
-    }
+  shard = thunar_file_cache_get_shard (file);
+  FILE_CACHE_LOCK (shard);
 
-  ref = g_hash_table_lookup (file_cache, file);
+  ref = g_hash_table_lookup (shard->table, file);
 
   if (ref == NULL)
     cached_file = NULL;
   else
     cached_file = g_weak_ref_get (ref);
 
-  G_REC_UNLOCK (file_cache_mutex);
+  if (cached_file != NULL)
+    shard->n_hits++;
+  else
+    shard->n_misses++;
+
+  FILE_CACHE_UNLOCK (shard);
 
   return cached_file;
 }
 
 
 
+/**
+ * thunar_file_cache_lookup_batch:
+ * @files : a #GList of #GFile<!---->s.
+ *
+ * Batched version of thunar_file_cache_lookup(). The files are
+ * grouped by cache shard, so every shard lock is taken at most
+ * once for the whole list.
+ *
+ * The returned list has the same length and order as @files,
+ * entries for which no #ThunarFile is cached are %NULL.
+ *
+ * Return value: (transfer full): a #GList of #ThunarFile<!---->s
+ *               or %NULL entries. Unref the non-%NULL entries and
+ *               free the list with g_list_free() when done.
+ **/
+GList *
+thunar_file_cache_lookup_batch (GList *files)
+{
+  ThunarFile **cached_files;
+  GFile      **gfiles;
+  GList       *result = NULL;
+  GList       *lp;
+  guint       *shard_ids;
+  guint        n_files;
+  guint        n;
+
+  n_files = g_list_length (files);
+  if (G_UNLIKELY (n_files == 0))
+    return NULL;
+
+  gfiles = g_new (GFile *, n_files);
+  shard_ids = g_new (guint, n_files);
+  cached_files = g_new0 (ThunarFile *, n_files);
+
+  for (lp = files, n = 0; lp != NULL; lp = lp->next, n++)
+    {
+      _thunar_assert (G_IS_FILE (lp->data));
+      gfiles[n] = lp->data;
+      shard_ids[n] = thunar_file_cache_get_shard (gfiles[n]) - file_cache;
+    }
+
+  thunar_file_cache_transaction (gfiles, shard_ids, cached_files, NULL, n_files);
+
+  for (n = n_files; n > 0; n--)
+    result = g_list_prepend (result, cached_files[n - 1]);
+
+  g_free (gfiles);
+  g_free (shard_ids);
+  g_free (cached_files);
+
+  return result;
+}
+
+
+
+/**
+ * thunar_file_cache_get_stats:
+ * @n_files  : return location for the number of cached files, or %NULL.
+ * @n_hits   : return location for the number of lookups which found
+ *             a file, or %NULL.
+ * @n_misses : return location for the number of lookups which found
+ *             none, or %NULL.
+ *
+ * Queries the counters of the file cache since the start.
+ **/
+void
+thunar_file_cache_get_stats (guint   *n_files,
+                             guint64 *n_hits,
+                             guint64 *n_misses)
+{
+  guint64 hits = 0;
+  guint64 misses = 0;
+  guint   files = 0;
+  guint   n;
+
+  for (n = 0; n < FILE_CACHE_N_SHARDS; n++)
+    {
+      FILE_CACHE_LOCK (&file_cache[n]);
+      if (file_cache[n].table != NULL)
+        files += g_hash_table_size (file_cache[n].table);
+      hits += file_cache[n].n_hits;
+      misses += file_cache[n].n_misses;
+      FILE_CACHE_UNLOCK (&file_cache[n]);
+    }
+
+  if (n_files != NULL)
+    *n_files = files;
+  if (n_hits != NULL)
+    *n_hits = hits;
+  if (n_misses != NULL)
+    *n_misses = misses;
+}
+
+
+
+/**
+ * thunar_file_cache_foreach:
+ * @func      : the function called with every cached #ThunarFile.
+ * @user_data : the data passed to @func.
+ *
+ * Calls @func for every #ThunarFile alive. The cache is not locked
+ * while @func runs, so it may look up and create files.
+ **/
+void
+thunar_file_cache_foreach (GFunc    func,
+                           gpointer user_data)
+{
+  GHashTableIter iter;
+  ThunarFile    *file;
+  GWeakRef      *ref;
+  GList         *files = NULL;
+  guint          n;
+
+  _thunar_return_if_fail (func != NULL);
+
+  for (n = 0; n < FILE_CACHE_N_SHARDS; n++)
+    {
+      FILE_CACHE_LOCK (&file_cache[n]);
+      if (file_cache[n].table != NULL)
+        {
+          g_hash_table_iter_init (&iter, file_cache[n].table);
+          while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &ref))
+            {
+              file = g_weak_ref_get (ref);
+              if (file != NULL)
+                files = g_list_prepend (files, file);
+            }
+        }
+      FILE_CACHE_UNLOCK (&file_cache[n]);
+    }
+
+  g_list_foreach (files, func, user_data);
+  thunar_g_list_free_full (files);
+}
+
+
+
 gchar *
 thunar_file_cached_display_name (const GFile *file)
 {
@@ -4563,15 +5785,6 @@ thunar_file_cached_display_name (const GFile *file)
 
 
 
-static gint
-compare_app_infos (gconstpointer a,
-                   gconstpointer b)
-{
-  return g_app_info_equal (G_APP_INFO (a), G_APP_INFO (b)) ? 0 : 1;
-}
-
-
-
 /**
  * thunar_file_list_get_applications:
  * @file_list : a #GList of #ThunarFile<!---->s.
@@ -4590,84 +5803,37 @@ compare_app_infos (gconstpointer a,
 GList*
 thunar_file_list_get_applications (GList *file_list)
 {
-  GList       *applications = NULL;
-  GList       *list;
+  GList       *applications;
+  GList       *content_types = NULL;
   GList       *next;
   GList       *ap;
   GList       *lp;
-  GAppInfo    *default_application;
-  const gchar *previous_type = NULL;
+  GHashTable  *seen;
   const gchar *current_type;
 
-  /* determine the set of applications that can open all files */
+  /* collect the distinct content types, in the order of the files */
+  seen = g_hash_table_new (g_str_hash, g_str_equal);
   for (lp = file_list; lp != NULL; lp = lp->next)
     {
       current_type = thunar_file_get_content_type (lp->data);
 
-      /* no need to check anything if this file has the same mimetype as the previous file */
-      if (current_type != NULL && previous_type != NULL)
-        if (G_LIKELY (g_content_type_equals (previous_type, current_type)))
-          continue;
-
-      /* store the previous type */
-      previous_type = current_type;
-
-      /* determine the list of applications that can open this file */
-      if (G_UNLIKELY (current_type != NULL))
-        {
-          list = g_app_info_get_all_for_type (current_type);
-
-          /* move any default application in front of the list */
-          default_application = g_app_info_get_default_for_type (current_type, FALSE);
-          if (G_LIKELY (default_application != NULL))
-            {
-              for (ap = list; ap != NULL; ap = ap->next)
-                {
-                  if (g_app_info_equal (ap->data, default_application))
-                    {
-                      g_object_unref (ap->data);
-                      list = g_list_delete_link (list, ap);
-                      break;
-                    }
-                }
-              list = g_list_prepend (list, default_application);
-            }
-        }
-      else
-        list = NULL;
-
-      if (G_UNLIKELY (applications == NULL))
-        {
-          /* first file, so just use the applications list */
-          applications = list;
-        }
-      else
+      /* no application can open a file without content type */
+      if (G_UNLIKELY (current_type == NULL))
         {
-          /* keep only the applications that are also present in list */
-          for (ap = applications; ap != NULL; ap = next)
-            {
-              /* grab a pointer on the next application */
-              next = ap->next;
-
-              /* check if the application is present in list */
-              if (g_list_find_custom (list, ap->data, compare_app_infos) == NULL)
-                {
-                  /* drop our reference on the application */
-                  g_object_unref (G_OBJECT (ap->data));
-
-                  /* drop this application from the list */
-                  applications = g_list_delete_link (applications, ap);
-                }
-            }
-
-          /* release the list of applications for this file */
-          g_list_free_full (list, g_object_unref);
+          g_hash_table_destroy (seen);
+          g_list_free (content_types);
+          return NULL;
         }
 
-      /* check if the set is still not empty */
-      if (G_LIKELY (applications == NULL))
-        break;
+      if (g_hash_table_add (seen, (gpointer) current_type))
+        content_types = g_list_prepend (content_types, (gpointer) current_type);
     }
+  g_hash_table_destroy (seen);
+  content_types = g_list_reverse (content_types);
+
+  /* determine the set of applications that can open all files, in one pass over the indexed applications */
+  applications = thunar_app_index_get_all_for_types (content_types);
+  g_list_free (content_types);
 
   /* remove hidden applications */
   for (ap = applications; ap != NULL; ap = next)
@@ -4690,6 +5856,128 @@ thunar_file_list_get_applications (GList *file_list)
 
 
 
+typedef struct
+{
+  ThunarFile *file;
+  gboolean    is_directory;
+  guint       depth;        /* number of path components */
+  guint       parent_id;    /* same for siblings */
+  guint       index;        /* in the unsorted list */
+  gchar      *collate_key;  /* of the display name */
+}
+ThunarFileTypeKey;
+
+
+
+static gint
+thunar_file_type_key_compare (gconstpointer a,
+                              gconstpointer b)
+{
+  const ThunarFileTypeKey *key_a = a;
+  const ThunarFileTypeKey *key_b = b;
+  gint                     ret;
+
+  /* directories always come first */
+  if (key_a->is_directory != key_b->is_directory)
+    return key_a->is_directory ? -1 : 1;
+
+  /* ancestors come first, being less deep than their descendants */
+  if (key_a->depth != key_b->depth)
+    return (key_a->depth < key_b->depth) ? -1 : 1;
+
+  /* then the children of a folder together, by their display name */
+  if (key_a->parent_id != key_b->parent_id)
+    return (key_a->parent_id < key_b->parent_id) ? -1 : 1;
+
+  ret = strcmp (key_a->collate_key, key_b->collate_key);
+  if (ret != 0)
+    return ret;
+
+  /* keep equal names in their order */
+  return (key_a->index < key_b->index) ? -1 : (key_a->index > key_b->index);
+}
+
+
+
+/**
+ * thunar_file_list_sort_by_type:
+ * @file_list : a #GList of #ThunarFile<!---->s.
+ *
+ * Sorts @file_list so that directories come before files, ancestors
+ * come before their descendants and siblings are ordered by their
+ * display name. The keys of the files are computed once, so the
+ * comparisons of the sort don't allocate.
+ *
+ * Return value: the sorted @file_list.
+ **/
+GList*
+thunar_file_list_sort_by_type (GList *file_list)
+{
+  ThunarFileTypeKey *keys;
+  GHashTable        *parent_ids;
+  const gchar       *slash;
+  gpointer           parent_id;
+  gchar             *uri;
+  guint              n_files;
+  guint              n;
+  GList             *lp;
+
+  n_files = g_list_length (file_list);
+  if (n_files < 2)
+    return file_list;
+
+  keys = g_new (ThunarFileTypeKey, n_files);
+
+  /* parent uri -> id, in the order of the first child */
+  parent_ids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  for (lp = file_list, n = 0; lp != NULL; lp = lp->next, ++n)
+    {
+      keys[n].file = lp->data;
+      keys[n].is_directory = (keys[n].file->kind == G_FILE_TYPE_DIRECTORY);
+      keys[n].index = n;
+      keys[n].collate_key = g_utf8_collate_key (keys[n].file->display_name, -1);
+
+      /* the depth and the parent follow from the slashes of the uri */
+      uri = g_file_get_uri (keys[n].file->gfile);
+      keys[n].depth = 0;
+      for (slash = strchr (uri, '/'); slash != NULL; slash = strchr (slash + 1, '/'))
+        keys[n].depth++;
+
+      slash = strrchr (uri, '/');
+      if (slash != NULL)
+        uri[slash - uri] = '\0';
+
+      if (!g_hash_table_lookup_extended (parent_ids, uri, NULL, &parent_id))
+        {
+          parent_id = GUINT_TO_POINTER (g_hash_table_size (parent_ids));
+          g_hash_table_insert (parent_ids, uri, parent_id);
+        }
+      else
+        {
+          g_free (uri);
+        }
+      keys[n].parent_id = GPOINTER_TO_UINT (parent_id);
+    }
+
+  g_hash_table_destroy (parent_ids);
+
+  qsort (keys, n_files, sizeof (ThunarFileTypeKey), thunar_file_type_key_compare);
+
+  /* reuse the links of the list */
+  for (lp = file_list, n = 0; lp != NULL; lp = lp->next, ++n)
+    {
+      lp->data = keys[n].file;
+      g_free (keys[n].collate_key);
+    }
+
+  g_free (keys);
+
+  return file_list;
+}
+
+
+
 /**
  * thunar_file_list_to_thunar_g_file_list:
  * @file_list : a #GList of #ThunarFile<!---->s.
@@ -4716,6 +6004,99 @@ thunar_file_list_to_thunar_g_file_list (GList *file_list)
 
 
 
+/**
+ * thunar_file_load_metadata:
+ * @file : a #ThunarFile instance.
+ *
+ * Loads the metadata:: attributes (emblems, highlight colors and the
+ * directory specific settings) of @file into its info, unless they are
+ * loaded already. Listing folders leaves them out, since only few files
+ * have any, so the metadata accessors of #ThunarFile call this first.
+ **/
+void
+thunar_file_load_metadata (ThunarFile *file)
+{
+  GFileAttributeType   type;
+  GFileInfo           *info;
+  gpointer             value;
+  gchar              **attributes;
+
+  _thunar_return_if_fail (THUNAR_IS_FILE (file));
+
+  if (file->info == NULL || FLAG_IS_SET (file, THUNAR_FILE_FLAG_METADATA))
+    return;
+
+  FLAG_SET (file, THUNAR_FILE_FLAG_METADATA);
+
+  info = g_file_query_info (file->gfile, THUNAR_FILE_METADATA_NAMESPACE,
+                            G_FILE_QUERY_INFO_NONE, NULL, NULL);
+  if (info == NULL)
+    return;
+
+  /* merge the attributes into the info of the file */
+  attributes = g_file_info_list_attributes (info, "metadata");
+  for (gchar **ap = attributes; ap != NULL && *ap != NULL; ++ap)
+    if (g_file_info_get_attribute_data (info, *ap, &type, &value, NULL))
+      g_file_info_set_attribute (file->info, *ap, type, value);
+  g_strfreev (attributes);
+
+  g_object_unref (info);
+}
+
+
+
+/* the directory specific settings, these are kept in thunar-view-settings.c */
+static const gchar *thunar_file_view_settings[] =
+{
+  "thunar-view-type",
+  "thunar-sort-column",
+  "thunar-sort-order",
+  "thunar-zoom-level",
+  "thunar-zoom-level-ThunarDetailsView",
+  "thunar-zoom-level-ThunarIconView",
+  "thunar-zoom-level-ThunarCompactView",
+};
+
+
+
+static gboolean
+thunar_file_is_view_setting (const gchar *setting_name)
+{
+  guint n;
+
+  for (n = 0; n < G_N_ELEMENTS (thunar_file_view_settings); ++n)
+    if (g_strcmp0 (setting_name, thunar_file_view_settings[n]) == 0)
+      return TRUE;
+
+  return FALSE;
+}
+
+
+
+static void
+thunar_file_load_view_settings (ThunarFile *file)
+{
+  gchar *value;
+  guint  n;
+
+  if (thunar_view_settings_has_directory (file->gfile))
+    return;
+
+  /* first visit of the folder, take over what its metadata remembers */
+  thunar_view_settings_add_directory (file->gfile);
+  thunar_file_load_metadata (file);
+
+  for (n = 0; n < G_N_ELEMENTS (thunar_file_view_settings); ++n)
+    {
+      value = thunar_g_file_get_metadata_setting (file->gfile, file->info, THUNAR_GTYPE_STRING, thunar_file_view_settings[n]);
+      if (value != NULL)
+        thunar_view_settings_set (file->gfile, thunar_file_view_settings[n], value);
+      g_free (value);
+    }
+}
+
+
+
 /**
  * thunar_file_get_metadata_setting:
  * @file         : a #ThunarFile instance.
@@ -4730,6 +6111,18 @@ gchar*
 thunar_file_get_metadata_setting (ThunarFile  *file,
                                   const gchar *setting_name)
 {
+  /* the directory specific settings need no metadata query */
+  if (thunar_file_is_view_setting (setting_name))
+    {
+      if (file->info == NULL)
+        return NULL;
+
+      thunar_file_load_view_settings (file);
+      return thunar_view_settings_get (file->gfile, setting_name);
+    }
+
+  thunar_file_load_metadata (file);
+
   return thunar_g_file_get_metadata_setting (file->gfile, file->info, THUNAR_GTYPE_STRING, setting_name);
 }
 
@@ -4751,6 +6144,16 @@ thunar_file_set_metadata_setting (ThunarFile  *file,
                                   const gchar *setting_value,
                                   gboolean     async)
 {
+  /* the store of the directory specific settings writes through to the metadata */
+  if (thunar_file_is_view_setting (setting_name))
+    {
+      thunar_file_load_view_settings (file);
+      thunar_view_settings_set (file->gfile, setting_name, setting_value);
+    }
+
+  /* a later load must not replace the new value with the stored one */
+  thunar_file_load_metadata (file);
+
   return thunar_g_file_set_metadata_setting (file->gfile, file->info, THUNAR_GTYPE_STRING, setting_name, setting_value, async);
 }
 
@@ -4767,6 +6170,14 @@ void
 thunar_file_clear_metadata_setting (ThunarFile  *file,
                                      const gchar *setting_name)
 {
+  if (thunar_file_is_view_setting (setting_name))
+    {
+      thunar_file_load_view_settings (file);
+      thunar_view_settings_set (file->gfile, setting_name, NULL);
+    }
+
+  thunar_file_load_metadata (file);
+
   return thunar_g_file_clear_metadata_setting (file->gfile, file->info, setting_name);
 }
 
@@ -4786,6 +6197,9 @@ thunar_file_clear_directory_specific_settings (ThunarFile *file)
   if (file->info == NULL)
     return;
 
+  thunar_view_settings_clear (file->gfile);
+  thunar_file_load_metadata (file);
+
   g_file_info_remove_attribute (file->info, "metadata::thunar-view-type");
   g_file_info_remove_attribute (file->info, "metadata::thunar-sort-column");
   g_file_info_remove_attribute (file->info, "metadata::thunar-sort-order");
@@ -4819,6 +6233,8 @@ thunar_file_clear_directory_specific_settings (ThunarFile *file)
  * @file : a #ThunarFile instance.
  *
  * Checks whether @file has any directory specific settings stored in its metadata.
+ * The settings are looked up in the store of thunar-view-settings.c, so this
+ * does not query the metadata, except on the first visit of @file.
  *
  * Return value: %TRUE if @file has any directory specific settings stored in its metadata, and %FALSE otherwise
  **/
@@ -4830,22 +6246,9 @@ thunar_file_has_directory_specific_settings (ThunarFile *file)
   if (file->info == NULL)
     return FALSE;
 
-  if (g_file_info_has_attribute (file->info, "metadata::thunar-view-type"))
-    return TRUE;
-  if (g_file_info_has_attribute (file->info, "metadata::thunar-sort-column"))
-    return TRUE;
-  if (g_file_info_has_attribute (file->info, "metadata::thunar-sort-order"))
-    return TRUE;
-  if (g_file_info_has_attribute (file->info, "metadata::thunar-zoom-level"))
-    return TRUE;
-  if (g_file_info_has_attribute (file->info, "metadata::thunar-zoom-level-ThunarDetailsView"))
-    return TRUE;
-  if (g_file_info_has_attribute (file->info, "metadata::thunar-zoom-level-ThunarIconView"))
-    return TRUE;
-  if (g_file_info_has_attribute (file->info, "metadata::thunar-zoom-level-ThunarCompactView"))
-    return TRUE;
+  thunar_file_load_view_settings (file);
 
-  return FALSE;
+  return thunar_view_settings_has_any (file->gfile);
 }
 
 
@@ -5146,8 +6549,8 @@ thunar_cmp_files_by_size_and_items_count (ThunarFile *a,
 
   if (thunar_file_is_directory (a) && thunar_file_is_directory (b))
     {
-      count_a = thunar_file_get_file_count (a, NULL, NULL);
-      count_b = thunar_file_get_file_count (b, NULL, NULL);
+      count_a = thunar_file_get_file_count (a, FALSE);
+      count_b = thunar_file_get_file_count (b, FALSE);
 
       if (count_a < count_b)
           return -1;
@@ -5234,7 +6637,9 @@ thunar_file_update_thumbnail (ThunarFile          *file,
 
   if (state == THUNAR_FILE_THUMB_STATE_READY)
     {
-      /* Try to set the internal path, so the thumbnail can be loaded from it */
+      /* Try to set the internal path, so the thumbnail can be loaded from it;
+       * the monitor of the thumbnail cache might not have seen it yet */
+      file->thumbnail_miss[size] = 0;
       thunar_file_get_thumbnail_path (file, size);
 
       if (file->thumbnail_path[size] == NULL)
@@ -5260,16 +6665,25 @@ thunar_file_thumbnailing_finished (ThunarFile        *file,
                                    guint              request_id,
                                    ThunarThumbnailer *thumbnailer)
 {
+  gboolean pending = FALSE;
+
   _thunar_return_if_fail (THUNAR_IS_FILE (file));
 
   for (gint i = 0; i < N_THUMBNAIL_SIZES; i++)
     {
-      if (file->thumbnail_request_id[i] == request_id )
-        {
-          /* reset the request id */
-          file->thumbnail_request_id[i] = 0;
-          break;
-        }
+      /* reset the request id */
+      if (file->thumbnail_request_id[i] == request_id)
+        file->thumbnail_request_id[i] = 0;
+
+      pending = pending || file->thumbnail_request_id[i] != 0;
+    }
+
+  /* stop listening once all requests are done, so that the thumbnailer
+   * does not have a handler for every file that was ever loaded */
+  if (!pending)
+    {
+      g_signal_handlers_disconnect_by_func (G_OBJECT (thumbnailer), G_CALLBACK (thunar_file_thumbnailing_finished), file);
+      FLAG_UNSET (file, THUNAR_FILE_FLAG_THUMB_PENDING);
     }
 }
 
@@ -5290,7 +6704,18 @@ thunar_file_request_thumbnail (ThunarFile          *file,
 
   file->thumbnail_state[size] = THUNAR_FILE_THUMB_STATE_LOADING;
 
+  /* listen before queueing, the request might finish right away */
+  if (!FLAG_IS_SET (file, THUNAR_FILE_FLAG_THUMB_PENDING))
+    {
+      g_signal_connect_swapped (file->thumbnailer, "request-finished", G_CALLBACK (thunar_file_thumbnailing_finished), file);
+      FLAG_SET (file, THUNAR_FILE_FLAG_THUMB_PENDING);
+    }
+
   thunar_thumbnailer_queue_file (file->thumbnailer, file, &file->thumbnail_request_id[size], size);
+
+  /* nothing was queued, drop the handler again unless other sizes are pending */
+  if (file->thumbnail_request_id[size] == 0)
+    thunar_file_thumbnailing_finished (file, 0, file->thumbnailer);
 }
 
 
@@ -5308,6 +6733,7 @@ thunar_file_reset_thumbnail (ThunarFile          *file,
   file->thumbnail_state[size] = THUNAR_FILE_THUMB_STATE_UNKNOWN;
   g_free (file->thumbnail_path[size]);
   file->thumbnail_path[size] = NULL;
+  file->thumbnail_miss[size] = 0;
   file->thumbnail_request_id[size] = 0;
 }
 
@@ -5316,6 +6742,9 @@ thunar_file_reset_thumbnail (ThunarFile          *file,
 static gboolean
 thunar_file_changed_signal_emit (gpointer data)
 {
+  /* views will ask for the column strings again */
+  thunar_file_clear_column_strings (THUNAR_FILE (data));
+
   /* emit the changed signal on thunarx level */
   thunarx_file_info_changed (THUNARX_FILE_INFO (data));
 
@@ -5346,5 +6775,6 @@ void thunar_file_changed (ThunarFile *file)
     file->signal_changed_source_id = g_timeout_add_full (G_PRIORITY_DEFAULT, FILE_CHANGED_SIGNAL_RATE_LIMIT,
                                                          thunar_file_changed_signal_emit,
                                                          file, thunar_file_changed_signal_destroy);
+    g_source_set_name_by_id (file->signal_changed_source_id, "thunar_file_changed_signal_emit");
   }
 }
\ No newline at end of file
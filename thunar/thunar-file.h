@@ -41,6 +41,31 @@ typedef struct _ThunarFile      ThunarFile;
 #define THUNAR_IS_FILE_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), THUNAR_TYPE_FILE))
 #define THUNAR_FILE_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), THUNAR_TYPE_FILE, ThunarFileClass))
 
+/* The attributes queried for every #ThunarFile. Unlike THUNARX_FILE_INFO_NAMESPACE
+ * this leaves out the metadata:: attributes, which only few files have and which
+ * are loaded on demand by thunar_file_load_metadata() */
+#define THUNAR_FILE_INFO_NAMESPACE \
+  "access::*," \
+  "id::filesystem," \
+  "mountable::can-mount,standard::target-uri," \
+  "preview::*," \
+  "standard::type,standard::is-hidden,standard::is-backup," \
+  "standard::is-symlink,standard::name,standard::display-name," \
+  "standard::size,standard::allocated-size,standard::symlink-target," \
+  "time::*," \
+  "trash::*," \
+  "recent::*," \
+  "unix::gid,unix::uid,unix::mode"
+
+/* The metadata:: attributes of THUNARX_FILE_INFO_NAMESPACE */
+#define THUNAR_FILE_METADATA_NAMESPACE \
+  "metadata::emblems," \
+  "metadata::thunar-view-type," \
+  "metadata::thunar-sort-column,metadata::thunar-sort-order," \
+  "metadata::thunar-zoom-level," \
+  "metadata::thunar-zoom-level-ThunarDetailsView,metadata::thunar-zoom-level-ThunarIconView,metadata::thunar-zoom-level-ThunarCompactView," \
+  "metadata::thunar-highlight-color-background,metadata::thunar-highlight-color-foreground"
+
 /**
  * ThunarFileDateType:
  * @THUNAR_FILE_DATE_ACCESSED : date of last access to the file.
@@ -144,6 +169,11 @@ ThunarFile       *thunar_file_get_with_info              (GFile
                                                           GFileInfo              *info,
                                                           GFileInfo              *recent_info,
                                                           gboolean                not_mounted);
+GList            *thunar_file_get_with_info_batch        (GFile                  *parent,
+                                                          GList                  *infos);
+GList            *thunar_file_get_provisional_batch      (GFile                  *parent,
+                                                          GList                  *infos);
+gboolean          thunar_file_apply_pending_info         (ThunarFile             *file);
 ThunarFile       *thunar_file_get_for_uri                (const gchar            *uri,
                                                           GError                **error);
 void              thunar_file_get_async                  (GFile                  *location,
@@ -178,6 +208,9 @@ gboolean          thunar_file_rename                     (ThunarFile
                                                           GCancellable           *cancellable,
                                                           gboolean                called_from_job,
                                                           GError                **error);
+void              thunar_file_renamed                    (ThunarFile             *file,
+                                                          GFile                  *renamed_file,
+                                                          gboolean                called_from_job);
 
 GdkDragAction     thunar_file_accepts_drop               (ThunarFile             *file,
                                                           GList                  *path_list,
@@ -191,6 +224,14 @@ gchar            *thunar_file_get_date_string            (const ThunarFile
                                                           ThunarFileDateType      date_type,
                                                           ThunarDateStyle         date_style,
                                                           const gchar            *date_custom_style) G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
+const gchar      *thunar_file_get_column_string          (const ThunarFile       *file,
+                                                          ThunarColumn            column,
+                                                          guint                   format);
+void              thunar_file_set_column_string          (ThunarFile             *file,
+                                                          ThunarColumn            column,
+                                                          guint                   format,
+                                                          gchar                  *string);
+void              thunar_file_clear_column_strings       (ThunarFile             *file);
 gchar            *thunar_file_get_mode_string            (const ThunarFile       *file) G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
 gchar            *thunar_file_get_size_string            (const ThunarFile       *file) G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
 gchar            *thunar_file_get_size_in_bytes_string   (const ThunarFile       *file) G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
@@ -207,6 +248,12 @@ ThunarUser       *thunar_file_get_user                   (const ThunarFile
 const gchar      *thunar_file_get_content_type           (ThunarFile             *file);
 void              thunar_file_set_content_type           (ThunarFile             *file,
                                                           const gchar            *content_type);
+gchar            *thunar_file_dup_content_type           (ThunarFile             *file);
+void              thunar_file_set_guessed_content_type   (ThunarFile             *file,
+                                                          const gchar            *content_type);
+gboolean          thunar_file_has_content_type           (ThunarFile             *file);
+gchar            *thunar_file_guess_content_type         (ThunarFile             *file,
+                                                          gboolean               *uncertain);
 gchar            *thunar_file_get_content_type_desc      (ThunarFile             *file);
 const gchar      *thunar_file_get_symlink_target         (const ThunarFile       *file);
 const gchar      *thunar_file_get_basename               (const ThunarFile       *file) G_GNUC_CONST;
@@ -241,6 +288,8 @@ gboolean          thunar_file_is_recent                  (const ThunarFile
 gboolean          thunar_file_is_in_recent               (const ThunarFile       *file);
 gboolean          thunar_file_is_desktop_file            (const ThunarFile       *file);
 const gchar      *thunar_file_get_display_name           (const ThunarFile       *file) G_GNUC_CONST;
+const gchar      *thunar_file_get_collate_key            (const ThunarFile       *file,
+                                                          gboolean                case_sensitive);
 
 gchar            *thunar_file_get_deletion_date          (const ThunarFile       *file,
                                                           ThunarDateStyle         date_style,
@@ -257,10 +306,10 @@ gboolean          thunar_file_can_be_trashed             (const ThunarFile
 
 
 guint             thunar_file_get_file_count             (ThunarFile             *file,
-                                                          GCallback               callback,
-                                                          gpointer                data);
+                                                          gboolean                update);
 void              thunar_file_set_file_count             (ThunarFile             *file,
-                                                          const guint             count);
+                                                          const guint             count,
+                                                          guint64                 mtime);
 
 GList            *thunar_file_get_emblem_names           (ThunarFile              *file);
 
@@ -281,28 +330,41 @@ const gchar      *thunar_file_get_device_type            (ThunarFile
 
 void              thunar_file_watch                      (ThunarFile              *file);
 void              thunar_file_unwatch                    (ThunarFile              *file);
+void              thunar_file_watch_event                (ThunarFile              *file,
+                                                          GFile                   *event_path,
+                                                          GFileMonitorEvent        event_type);
+void              thunar_file_watch_unrouted             (ThunarFile              *file);
 
 gboolean          thunar_file_reload                     (ThunarFile              *file);
+gboolean          thunar_file_reload_with_info           (ThunarFile              *file,
+                                                          GFileInfo               *info,
+                                                          GError                  *error);
 void              thunar_file_reload_idle                (ThunarFile              *file);
 void              thunar_file_reload_idle_unref          (ThunarFile              *file);
 
 void              thunar_file_destroy                    (ThunarFile              *file);
 
-gint              thunar_file_compare_by_type            (ThunarFile              *file_a,
-                                                          ThunarFile              *file_b);
 gint              thunar_file_compare_by_name            (const ThunarFile        *file_a,
                                                           const ThunarFile        *file_b,
                                                           gboolean                 case_sensitive) G_GNUC_PURE;
 
 ThunarFile       *thunar_file_cache_lookup               (const GFile             *file);
+GList            *thunar_file_cache_lookup_batch         (GList                   *files);
+void              thunar_file_cache_foreach              (GFunc                    func,
+                                                          gpointer                 user_data);
+void              thunar_file_cache_get_stats            (guint                   *n_files,
+                                                          guint64                 *n_hits,
+                                                          guint64                 *n_misses);
 gchar            *thunar_file_cached_display_name        (const GFile             *file);
 
 
 GList            *thunar_file_list_get_applications      (GList                  *file_list);
 GList            *thunar_file_list_to_thunar_g_file_list (GList                  *file_list);
+GList            *thunar_file_list_sort_by_type          (GList                  *file_list);
 
 gboolean          thunar_file_is_desktop                 (const ThunarFile *file);
 
+void              thunar_file_load_metadata              (ThunarFile             *file);
 gchar            *thunar_file_get_metadata_setting       (ThunarFile             *file,
                                                           const gchar            *setting_name);
 void              thunar_file_set_metadata_setting       (ThunarFile             *file,
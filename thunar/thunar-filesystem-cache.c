@@ -0,0 +1,578 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include <gio/gio.h>
+#ifdef HAVE_GIO_UNIX
+#include <gio/gunixmounts.h>
+#endif
+
+#include <thunarx/thunarx.h>
+
+#include "thunar/thunar-filesystem-cache.h"
+#include "thunar/thunar-private.h"
+
+/**
+ * SECTION:thunar-filesystem-cache
+ * @Short_description: Process wide cache of the free space of filesystems
+ * @Title: ThunarFilesystemCache
+ *
+ * The statusbar, the shortcuts tooltips and the properties dialog all
+ * show the free space of a filesystem. Querying it blocks for a long
+ * time on slow network mounts, so the values are kept here, one per
+ * mount, and refreshed with g_file_query_filesystem_info_async().
+ *
+ * thunar_filesystem_cache_lookup() only returns what is known and
+ * schedules a refresh if the value is older than
+ * THUNAR_FILESYSTEM_CACHE_MAX_AGE. Write events reported with
+ * thunar_filesystem_cache_file_changed() refresh the value too, but a
+ * filesystem is never queried more than once per
+ * THUNAR_FILESYSTEM_CACHE_MIN_INTERVAL. The "changed" signal is emitted
+ * whenever a new value is available.
+ **/
+
+
+
+/* Values older than this, in microseconds, are refreshed on lookup */
+#define THUNAR_FILESYSTEM_CACHE_MAX_AGE      (10 * G_USEC_PER_SEC)
+
+/* Minimum time, in milliseconds, between two queries of a filesystem */
+#define THUNAR_FILESYSTEM_CACHE_MIN_INTERVAL (2000)
+
+/* Number of remembered file -> filesystem resolutions */
+#define THUNAR_FILESYSTEM_CACHE_MAX_LOOKUPS  (512)
+
+
+
+/* signal identifiers */
+enum
+{
+  CHANGED,
+  LAST_SIGNAL
+};
+
+
+
+typedef struct _ThunarFilesystemEntry ThunarFilesystemEntry;
+
+
+
+static void                   thunar_filesystem_cache_finalize      (GObject               *object);
+static void                   thunar_filesystem_cache_mounts_reload (ThunarFilesystemCache *cache);
+static void                   thunar_filesystem_cache_mount_removed (GVolumeMonitor        *volume_monitor,
+                                                                     GMount                *mount,
+                                                                     ThunarFilesystemCache *cache);
+static ThunarFilesystemEntry *thunar_filesystem_cache_find          (ThunarFilesystemCache *cache,
+                                                                     GFile                 *file,
+                                                                     gboolean               create);
+static void                   thunar_filesystem_cache_refresh       (ThunarFilesystemCache *cache,
+                                                                     ThunarFilesystemEntry *entry);
+static void                   thunar_filesystem_entry_free          (gpointer               data);
+
+
+
+struct _ThunarFilesystemCacheClass
+{
+  GObjectClass __parent__;
+};
+
+struct _ThunarFilesystemCache
+{
+  GObject         __parent__;
+
+  GVolumeMonitor *volume_monitor;
+
+  /* roots of the mounted GMounts, longest first */
+  GList          *mount_roots;
+
+  /* filesystem root -> ThunarFilesystemEntry */
+  GHashTable     *entries;
+
+  /* file -> ThunarFilesystemEntry, to avoid resolving the mount of
+   * the same folders over and over */
+  GHashTable     *lookups;
+};
+
+struct _ThunarFilesystemEntry
+{
+  ThunarFilesystemCache *cache;
+  GFile                 *root;
+
+  guint64                fs_free;
+  guint64                fs_size;
+  gboolean               valid;
+
+  /* monotonic time of the last query */
+  gint64                 queried_at;
+
+  /* the running query, and whether another one is wanted after it */
+  GCancellable          *cancellable;
+  gboolean               dirty;
+
+  guint                  refresh_timer_id;
+};
+
+
+
+static guint                  cache_signals[LAST_SIGNAL];
+static ThunarFilesystemCache *filesystem_cache = NULL;
+
+G_DEFINE_TYPE (ThunarFilesystemCache, thunar_filesystem_cache, G_TYPE_OBJECT)
+
+
+
+static void
+thunar_filesystem_cache_class_init (ThunarFilesystemCacheClass *klass)
+{
+  GObjectClass *gobject_class;
+
+  gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->finalize = thunar_filesystem_cache_finalize;
+
+  /**
+   * ThunarFilesystemCache::changed:
+   * @cache : a #ThunarFilesystemCache.
+   * @root  : the root #GFile of the filesystem.
+   *
+   * Emitted when a new free space value for the filesystem
+   * of @root is available.
+   **/
+  cache_signals[CHANGED] =
+    g_signal_new (I_("changed"),
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL,
+                  g_cclosure_marshal_VOID__OBJECT,
+                  G_TYPE_NONE, 1, G_TYPE_FILE);
+}
+
+
+
+static void
+thunar_filesystem_cache_init (ThunarFilesystemCache *cache)
+{
+  cache->entries = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal, NULL, thunar_filesystem_entry_free);
+  cache->lookups = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal, g_object_unref, NULL);
+
+  /* the mount list only changes with the volume monitor */
+  cache->volume_monitor = g_volume_monitor_get ();
+  g_signal_connect_swapped (cache->volume_monitor, "mount-added", G_CALLBACK (thunar_filesystem_cache_mounts_reload), cache);
+  g_signal_connect_swapped (cache->volume_monitor, "mount-changed", G_CALLBACK (thunar_filesystem_cache_mounts_reload), cache);
+  g_signal_connect (cache->volume_monitor, "mount-removed", G_CALLBACK (thunar_filesystem_cache_mount_removed), cache);
+  thunar_filesystem_cache_mounts_reload (cache);
+}
+
+
+
+static void
+thunar_filesystem_cache_finalize (GObject *object)
+{
+  ThunarFilesystemCache *cache = THUNAR_FILESYSTEM_CACHE (object);
+
+  g_signal_handlers_disconnect_by_data (cache->volume_monitor, cache);
+  g_object_unref (cache->volume_monitor);
+
+  g_list_free_full (cache->mount_roots, g_object_unref);
+  g_hash_table_destroy (cache->lookups);
+  g_hash_table_destroy (cache->entries);
+
+  (*G_OBJECT_CLASS (thunar_filesystem_cache_parent_class)->finalize) (object);
+}
+
+
+
+static void
+thunar_filesystem_entry_free (gpointer data)
+{
+  ThunarFilesystemEntry *entry = data;
+
+  /* the callback of a cancelled query does not touch the entry */
+  if (entry->cancellable != NULL)
+    {
+      g_cancellable_cancel (entry->cancellable);
+      g_object_unref (entry->cancellable);
+    }
+
+  if (entry->refresh_timer_id != 0)
+    g_source_remove (entry->refresh_timer_id);
+
+  g_object_unref (entry->root);
+  g_slice_free (ThunarFilesystemEntry, entry);
+}
+
+
+
+static gint
+thunar_filesystem_cache_compare_roots (gconstpointer a,
+                                       gconstpointer b)
+{
+  gchar *uri_a = g_file_get_uri (G_FILE (a));
+  gchar *uri_b = g_file_get_uri (G_FILE (b));
+  gint   result;
+
+  /* longest first, so the first match is the innermost mount */
+  result = (gint) strlen (uri_b) - (gint) strlen (uri_a);
+
+  g_free (uri_a);
+  g_free (uri_b);
+
+  return result;
+}
+
+
+
+static void
+thunar_filesystem_cache_mounts_reload (ThunarFilesystemCache *cache)
+{
+  GList *mounts;
+  GList *lp;
+
+  _thunar_return_if_fail (THUNAR_IS_FILESYSTEM_CACHE (cache));
+
+  g_list_free_full (cache->mount_roots, g_object_unref);
+  cache->mount_roots = NULL;
+
+  mounts = g_volume_monitor_get_mounts (cache->volume_monitor);
+  for (lp = mounts; lp != NULL; lp = lp->next)
+    {
+      cache->mount_roots = g_list_prepend (cache->mount_roots, g_mount_get_root (lp->data));
+      g_object_unref (lp->data);
+    }
+  g_list_free (mounts);
+
+  cache->mount_roots = g_list_sort (cache->mount_roots, thunar_filesystem_cache_compare_roots);
+
+  /* files may resolve to another filesystem now */
+  g_hash_table_remove_all (cache->lookups);
+}
+
+
+
+static void
+thunar_filesystem_cache_mount_removed (GVolumeMonitor        *volume_monitor,
+                                       GMount                *mount,
+                                       ThunarFilesystemCache *cache)
+{
+  GFile *root;
+
+  _thunar_return_if_fail (G_IS_VOLUME_MONITOR (volume_monitor));
+  _thunar_return_if_fail (THUNAR_IS_FILESYSTEM_CACHE (cache));
+
+  /* the lookups point to the entries, drop them first */
+  thunar_filesystem_cache_mounts_reload (cache);
+
+  /* the value of an unmounted filesystem is of no use anymore */
+  root = g_mount_get_root (mount);
+  g_hash_table_remove (cache->entries, root);
+  g_object_unref (root);
+}
+
+
+
+static GFile *
+thunar_filesystem_cache_resolve_root (ThunarFilesystemCache *cache,
+                                      GFile                 *file)
+{
+  GList *lp;
+#ifdef HAVE_GIO_UNIX
+  GUnixMountEntry *mount_entry;
+  gchar           *path;
+  GFile           *root = NULL;
+#endif
+
+  /* mounts known to gio, this covers the network mounts */
+  for (lp = cache->mount_roots; lp != NULL; lp = lp->next)
+    if (g_file_equal (file, lp->data) || g_file_has_prefix (file, lp->data))
+      return g_object_ref (lp->data);
+
+#ifdef HAVE_GIO_UNIX
+  /* internal filesystems are not listed by the volume monitor */
+  path = g_file_get_path (file);
+  if (path != NULL)
+    {
+      mount_entry = g_unix_mount_for (path, NULL);
+      if (mount_entry != NULL)
+        {
+          root = g_file_new_for_path (g_unix_mount_get_mount_path (mount_entry));
+          g_unix_mount_free (mount_entry);
+        }
+      g_free (path);
+    }
+
+  if (root != NULL)
+    return root;
+#endif
+
+  /* no idea, keep a value for the file itself */
+  return g_object_ref (file);
+}
+
+
+
+static ThunarFilesystemEntry *
+thunar_filesystem_cache_find (ThunarFilesystemCache *cache,
+                              GFile                 *file,
+                              gboolean               create)
+{
+  ThunarFilesystemEntry *entry;
+  GFile                 *root;
+
+  entry = g_hash_table_lookup (cache->lookups, file);
+  if (entry != NULL)
+    return entry;
+
+  root = thunar_filesystem_cache_resolve_root (cache, file);
+  entry = g_hash_table_lookup (cache->entries, root);
+  if (entry == NULL && create)
+    {
+      entry = g_slice_new0 (ThunarFilesystemEntry);
+      entry->cache = cache;
+      entry->root = g_object_ref (root);
+      g_hash_table_insert (cache->entries, entry->root, entry);
+    }
+  g_object_unref (root);
+
+  /* remember the resolution, the table is bounded */
+  if (entry != NULL)
+    {
+      if (g_hash_table_size (cache->lookups) >= THUNAR_FILESYSTEM_CACHE_MAX_LOOKUPS)
+        g_hash_table_remove_all (cache->lookups);
+      g_hash_table_insert (cache->lookups, g_object_ref (file), entry);
+    }
+
+  return entry;
+}
+
+
+
+static void
+thunar_filesystem_cache_query_ready (GObject      *object,
+                                     GAsyncResult *result,
+                                     gpointer      user_data)
+{
+  ThunarFilesystemEntry *entry = user_data;
+  ThunarFilesystemCache *cache;
+  GFileInfo             *info;
+  GError                *error = NULL;
+  guint64                fs_free;
+  guint64                fs_size;
+
+  info = g_file_query_filesystem_info_finish (G_FILE (object), result, &error);
+  if (info == NULL && g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+      /* the entry is gone */
+      g_error_free (error);
+      return;
+    }
+
+  cache = entry->cache;
+  g_clear_object (&entry->cancellable);
+
+  if (info != NULL)
+    {
+      if (g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_FILESYSTEM_FREE)
+          && g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_FILESYSTEM_SIZE))
+        {
+          fs_free = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_FILESYSTEM_FREE);
+          fs_size = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_FILESYSTEM_SIZE);
+
+          if (!entry->valid || entry->fs_free != fs_free || entry->fs_size != fs_size)
+            {
+              entry->fs_free = fs_free;
+              entry->fs_size = fs_size;
+              entry->valid = TRUE;
+
+              g_signal_emit (G_OBJECT (cache), cache_signals[CHANGED], 0, entry->root);
+            }
+        }
+
+      g_object_unref (info);
+    }
+  else
+    {
+      g_error_free (error);
+    }
+
+  /* something was written while the query was running */
+  if (entry->dirty)
+    {
+      entry->dirty = FALSE;
+      thunar_filesystem_cache_refresh (cache, entry);
+    }
+}
+
+
+
+static gboolean
+thunar_filesystem_cache_refresh_timer (gpointer user_data)
+{
+  ThunarFilesystemEntry *entry = user_data;
+
+  entry->refresh_timer_id = 0;
+  thunar_filesystem_cache_refresh (entry->cache, entry);
+
+  return FALSE;
+}
+
+
+
+static void
+thunar_filesystem_cache_refresh (ThunarFilesystemCache *cache,
+                                 ThunarFilesystemEntry *entry)
+{
+  gint64 elapsed;
+
+  _thunar_return_if_fail (THUNAR_IS_FILESYSTEM_CACHE (cache));
+
+  /* a refresh is scheduled already */
+  if (entry->refresh_timer_id != 0)
+    return;
+
+  /* query again once the running query is done */
+  if (entry->cancellable != NULL)
+    {
+      entry->dirty = TRUE;
+      return;
+    }
+
+  /* rate limit the queries of this filesystem */
+  elapsed = (g_get_monotonic_time () - entry->queried_at) / 1000;
+  if (entry->queried_at != 0 && elapsed < THUNAR_FILESYSTEM_CACHE_MIN_INTERVAL)
+    {
+      entry->refresh_timer_id = g_timeout_add (THUNAR_FILESYSTEM_CACHE_MIN_INTERVAL - elapsed,
+                                               thunar_filesystem_cache_refresh_timer, entry);
+      return;
+    }
+
+  entry->queried_at = g_get_monotonic_time ();
+  entry->cancellable = g_cancellable_new ();
+  g_file_query_filesystem_info_async (entry->root,
+                                      THUNARX_FILESYSTEM_INFO_NAMESPACE,
+                                      G_PRIORITY_LOW,
+                                      entry->cancellable,
+                                      thunar_filesystem_cache_query_ready,
+                                      entry);
+}
+
+
+
+static ThunarFilesystemCache *
+thunar_filesystem_cache_get_instance (void)
+{
+  /* the instance, and the values, live for the rest of the process */
+  if (G_UNLIKELY (filesystem_cache == NULL))
+    filesystem_cache = g_object_new (THUNAR_TYPE_FILESYSTEM_CACHE, NULL);
+
+  return filesystem_cache;
+}
+
+
+
+/**
+ * thunar_filesystem_cache_get_default:
+ *
+ * Returns a reference to the default #ThunarFilesystemCache
+ * instance, to connect to its "changed" signal.
+ *
+ * The caller is responsible to free the returned instance
+ * using g_object_unref() when no longer needed.
+ *
+ * Return value: the default #ThunarFilesystemCache instance.
+ **/
+ThunarFilesystemCache *
+thunar_filesystem_cache_get_default (void)
+{
+  return g_object_ref (thunar_filesystem_cache_get_instance ());
+}
+
+
+
+/**
+ * thunar_filesystem_cache_lookup:
+ * @file           : a #GFile instance.
+ * @fs_free_return : return location for the amount of
+ *                   free space or %NULL.
+ * @fs_size_return : return location for the total volume size
+ *                   or %NULL.
+ *
+ * Looks up the last known amount of free space of the filesystem
+ * @file resides on. Never blocks: if there is no value yet, or the
+ * value is old, a query is started and "changed" is emitted on the
+ * default #ThunarFilesystemCache once it finished.
+ *
+ * Must be called from the main thread.
+ *
+ * Return value: %TRUE if a value is known, else %FALSE.
+ **/
+gboolean
+thunar_filesystem_cache_lookup (GFile   *file,
+                                guint64 *fs_free_return,
+                                guint64 *fs_size_return)
+{
+  ThunarFilesystemCache *cache;
+  ThunarFilesystemEntry *entry;
+
+  _thunar_return_val_if_fail (G_IS_FILE (file), FALSE);
+
+  cache = thunar_filesystem_cache_get_instance ();
+  entry = thunar_filesystem_cache_find (cache, file, TRUE);
+
+  if (!entry->valid
+      || g_get_monotonic_time () - entry->queried_at > THUNAR_FILESYSTEM_CACHE_MAX_AGE)
+    thunar_filesystem_cache_refresh (cache, entry);
+
+  if (!entry->valid)
+    return FALSE;
+
+  if (fs_free_return != NULL)
+    *fs_free_return = entry->fs_free;
+  if (fs_size_return != NULL)
+    *fs_size_return = entry->fs_size;
+
+  return TRUE;
+}
+
+
+
+/**
+ * thunar_filesystem_cache_file_changed:
+ * @file : the #GFile that was written, created or deleted.
+ *
+ * Refreshes the free space of the filesystem @file resides on,
+ * if someone asked for it before. Does nothing if there is no
+ * #ThunarFilesystemCache yet.
+ *
+ * Must be called from the main thread.
+ **/
+void
+thunar_filesystem_cache_file_changed (GFile *file)
+{
+  ThunarFilesystemEntry *entry;
+
+  _thunar_return_if_fail (G_IS_FILE (file));
+
+  if (filesystem_cache == NULL)
+    return;
+
+  entry = thunar_filesystem_cache_find (filesystem_cache, file, FALSE);
+  if (entry != NULL)
+    thunar_filesystem_cache_refresh (filesystem_cache, entry);
+}
@@ -0,0 +1,435 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The folder index keeps the sub folders of a ThunarFolder for the models
+ * showing folder hierarchies, i.e. the tree in the side pane and the
+ * expandable folders of the details view. There is at most one index per
+ * folder, so both models share the list of sub folders, its order by name
+ * and whether each sub folder has children itself, and expanding a folder
+ * in one of them makes it cheap to expand in the other. The index keeps
+ * the folder loaded as long as it is referenced. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "thunar/thunar-folder-index.h"
+#include "thunar/thunar-gio-extensions.h"
+#include "thunar/thunar-private.h"
+
+
+
+/* Signal identifiers */
+enum
+{
+  DIRECTORIES_ADDED,
+  DIRECTORIES_REMOVED,
+  LAST_SIGNAL,
+};
+
+
+
+typedef struct
+{
+  guint64  mtime;        /* of the sub folder when has_children was probed */
+  gint     has_children; /* -1 if not probed yet */
+}
+ThunarFolderIndexEntry;
+
+
+
+static void thunar_folder_index_finalize      (GObject           *object);
+static void thunar_folder_index_files_added   (ThunarFolderIndex *index,
+                                               GList             *files);
+static void thunar_folder_index_files_removed (ThunarFolderIndex *index,
+                                               GList             *files);
+static void thunar_folder_index_files_changed (ThunarFolderIndex *index,
+                                               GList             *files);
+static void thunar_folder_index_destroy       (ThunarFolderIndex *index);
+
+
+
+struct _ThunarFolderIndexClass
+{
+  GObjectClass __parent__;
+};
+
+struct _ThunarFolderIndex
+{
+  GObject       __parent__;
+
+  ThunarFolder *folder;
+
+  /* ThunarFile -> ThunarFolderIndexEntry of the sub folders */
+  GHashTable   *directories;
+
+  /* the sub folders by name, case-insensitive and case-sensitive,
+   * or NULL until they are requested again after a change */
+  GPtrArray    *sorted[2];
+};
+
+
+
+static guint  index_signals[LAST_SIGNAL];
+static GQuark thunar_folder_index_quark;
+
+
+
+G_DEFINE_TYPE (ThunarFolderIndex, thunar_folder_index, G_TYPE_OBJECT)
+
+
+
+static void
+thunar_folder_index_class_init (ThunarFolderIndexClass *klass)
+{
+  GObjectClass *gobject_class;
+
+  gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->finalize = thunar_folder_index_finalize;
+
+  /**
+   * ThunarFolderIndex::directories-added:
+   * @index       : a #ThunarFolderIndex.
+   * @directories : the #GList of the added sub folders.
+   *
+   * Emitted when the folder got new sub folders.
+   **/
+  index_signals[DIRECTORIES_ADDED] =
+    g_signal_new (I_ ("directories-added"),
+                  G_TYPE_FROM_CLASS (gobject_class),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL,
+                  g_cclosure_marshal_VOID__POINTER,
+                  G_TYPE_NONE, 1, G_TYPE_POINTER);
+
+  /**
+   * ThunarFolderIndex::directories-removed:
+   * @index       : a #ThunarFolderIndex.
+   * @directories : the #GList of the removed sub folders.
+   *
+   * Emitted when sub folders were removed from the folder.
+   **/
+  index_signals[DIRECTORIES_REMOVED] =
+    g_signal_new (I_ ("directories-removed"),
+                  G_TYPE_FROM_CLASS (gobject_class),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL,
+                  g_cclosure_marshal_VOID__POINTER,
+                  G_TYPE_NONE, 1, G_TYPE_POINTER);
+}
+
+
+
+static void
+thunar_folder_index_init (ThunarFolderIndex *index)
+{
+  index->directories = g_hash_table_new_full (g_direct_hash, g_direct_equal, g_object_unref, g_free);
+}
+
+
+
+static void
+thunar_folder_index_finalize (GObject *object)
+{
+  ThunarFolderIndex *index = THUNAR_FOLDER_INDEX (object);
+
+  /* the next request for the folder creates a new index */
+  g_object_set_qdata (G_OBJECT (index->folder), thunar_folder_index_quark, NULL);
+  g_signal_handlers_disconnect_by_data (G_OBJECT (index->folder), index);
+  g_object_unref (index->folder);
+
+  if (index->sorted[0] != NULL)
+    g_ptr_array_unref (index->sorted[0]);
+  if (index->sorted[1] != NULL)
+    g_ptr_array_unref (index->sorted[1]);
+  g_hash_table_destroy (index->directories);
+
+  (*G_OBJECT_CLASS (thunar_folder_index_parent_class)->finalize) (object);
+}
+
+
+
+static void
+thunar_folder_index_invalidate (ThunarFolderIndex *index)
+{
+  guint n;
+
+  for (n = 0; n < G_N_ELEMENTS (index->sorted); ++n)
+    if (index->sorted[n] != NULL)
+      {
+        g_ptr_array_unref (index->sorted[n]);
+        index->sorted[n] = NULL;
+      }
+}
+
+
+
+static void
+thunar_folder_index_files_added (ThunarFolderIndex *index,
+                                 GList             *files)
+{
+  ThunarFolderIndexEntry *entry;
+  GList                  *directories = NULL;
+  GList                  *lp;
+
+  for (lp = files; lp != NULL; lp = lp->next)
+    {
+      if (!thunar_file_is_directory (lp->data)
+          || g_hash_table_contains (index->directories, lp->data))
+        continue;
+
+      entry = g_new (ThunarFolderIndexEntry, 1);
+      entry->mtime = 0;
+      entry->has_children = -1;
+      g_hash_table_insert (index->directories, g_object_ref (lp->data), entry);
+
+      directories = g_list_prepend (directories, lp->data);
+    }
+
+  if (directories != NULL)
+    {
+      thunar_folder_index_invalidate (index);
+
+      directories = g_list_reverse (directories);
+      g_signal_emit (G_OBJECT (index), index_signals[DIRECTORIES_ADDED], 0, directories);
+      g_list_free (directories);
+    }
+}
+
+
+
+static void
+thunar_folder_index_files_removed (ThunarFolderIndex *index,
+                                   GList             *files)
+{
+  GList *directories = NULL;
+  GList *lp;
+
+  for (lp = files; lp != NULL; lp = lp->next)
+    if (g_hash_table_contains (index->directories, lp->data))
+      directories = g_list_prepend (directories, g_object_ref (lp->data));
+
+  if (directories != NULL)
+    {
+      for (lp = directories; lp != NULL; lp = lp->next)
+        g_hash_table_remove (index->directories, lp->data);
+      thunar_folder_index_invalidate (index);
+
+      /* the files are still referenced while the listeners see them */
+      directories = g_list_reverse (directories);
+      g_signal_emit (G_OBJECT (index), index_signals[DIRECTORIES_REMOVED], 0, directories);
+      thunar_g_list_free_full (directories);
+    }
+}
+
+
+
+static void
+thunar_folder_index_files_changed (ThunarFolderIndex *index,
+                                   GList             *files)
+{
+  GList *lp;
+
+  /* a renamed sub folder changes the order */
+  for (lp = files; lp != NULL; lp = lp->next)
+    if (g_hash_table_contains (index->directories, lp->data))
+      {
+        thunar_folder_index_invalidate (index);
+        break;
+      }
+}
+
+
+
+static void
+thunar_folder_index_destroy (ThunarFolderIndex *index)
+{
+  /* the folder is gone, and so are its sub folders */
+  g_hash_table_remove_all (index->directories);
+  thunar_folder_index_invalidate (index);
+}
+
+
+
+static gint
+thunar_folder_index_compare (gconstpointer a,
+                             gconstpointer b,
+                             gpointer      user_data)
+{
+  return thunar_file_compare_by_name (*(ThunarFile *const *) a, *(ThunarFile *const *) b,
+                                      GPOINTER_TO_INT (user_data));
+}
+
+
+
+/**
+ * thunar_folder_index_get_for_file:
+ * @file : a #ThunarFile for a directory.
+ *
+ * Returns the #ThunarFolderIndex of the sub folders of @file, which is
+ * shared by all its users. The index loads the #ThunarFolder for @file
+ * if it is not loaded yet.
+ *
+ * The caller is responsible to free the returned object using
+ * g_object_unref() when no longer needed.
+ *
+ * Return value: the #ThunarFolderIndex for @file, or %NULL if @file
+ *               is not a directory.
+ **/
+ThunarFolderIndex *
+thunar_folder_index_get_for_file (ThunarFile *file)
+{
+  ThunarFolderIndex *index;
+  ThunarFolder      *folder;
+  GList             *files;
+
+  _thunar_return_val_if_fail (THUNAR_IS_FILE (file), NULL);
+
+  folder = thunar_folder_get_for_file (file);
+  if (G_UNLIKELY (folder == NULL))
+    return NULL;
+
+  /* determine the "thunar-folder-index" quark on-demand */
+  if (G_UNLIKELY (thunar_folder_index_quark == 0))
+    thunar_folder_index_quark = g_quark_from_static_string ("thunar-folder-index");
+
+  /* check if we already know that folder */
+  index = g_object_get_qdata (G_OBJECT (folder), thunar_folder_index_quark);
+  if (G_LIKELY (index != NULL))
+    {
+      g_object_unref (folder);
+      return g_object_ref (index);
+    }
+
+  /* the index takes over the reference on the folder */
+  index = g_object_new (THUNAR_TYPE_FOLDER_INDEX, NULL);
+  index->folder = folder;
+  g_object_set_qdata (G_OBJECT (folder), thunar_folder_index_quark, index);
+
+  /* the index is connected before the models using it, so
+   * the sub folders are known before they are told about them */
+  g_signal_connect_swapped (G_OBJECT (folder), "files-added", G_CALLBACK (thunar_folder_index_files_added), index);
+  g_signal_connect_swapped (G_OBJECT (folder), "files-removed", G_CALLBACK (thunar_folder_index_files_removed), index);
+  g_signal_connect_swapped (G_OBJECT (folder), "files-changed", G_CALLBACK (thunar_folder_index_files_changed), index);
+  g_signal_connect_swapped (G_OBJECT (folder), "destroy", G_CALLBACK (thunar_folder_index_destroy), index);
+
+  /* the files loaded so far, nobody listens yet */
+  files = thunar_folder_get_files (folder);
+  thunar_folder_index_files_added (index, files);
+  g_list_free (files);
+
+  return index;
+}
+
+
+
+/**
+ * thunar_folder_index_get_folder:
+ * @index : a #ThunarFolderIndex.
+ *
+ * Returns the #ThunarFolder of @index. The returned object is owned
+ * by @index.
+ *
+ * Return value: the #ThunarFolder of @index.
+ **/
+ThunarFolder *
+thunar_folder_index_get_folder (ThunarFolderIndex *index)
+{
+  _thunar_return_val_if_fail (THUNAR_IS_FOLDER_INDEX (index), NULL);
+  return index->folder;
+}
+
+
+
+/**
+ * thunar_folder_index_get_directories:
+ * @index          : a #ThunarFolderIndex.
+ * @case_sensitive : whether the names are compared case-sensitive.
+ *
+ * Returns the sub folders of @index sorted by name. The order is kept
+ * until the sub folders change, so all users of @index sort them only
+ * once. The caller is responsible to free the returned list using
+ * g_list_free(), the files are owned by @index.
+ *
+ * Return value: the #GList of the sub folders of @index.
+ **/
+GList *
+thunar_folder_index_get_directories (ThunarFolderIndex *index,
+                                     gboolean           case_sensitive)
+{
+  GHashTableIter iter;
+  GPtrArray     *sorted;
+  gpointer       file;
+  GList         *directories = NULL;
+  guint          n;
+
+  _thunar_return_val_if_fail (THUNAR_IS_FOLDER_INDEX (index), NULL);
+
+  case_sensitive = !!case_sensitive;
+  sorted = index->sorted[case_sensitive];
+  if (sorted == NULL)
+    {
+      sorted = g_ptr_array_sized_new (g_hash_table_size (index->directories));
+      g_hash_table_iter_init (&iter, index->directories);
+      while (g_hash_table_iter_next (&iter, &file, NULL))
+        g_ptr_array_add (sorted, file);
+      g_qsort_with_data (sorted->pdata, sorted->len, sizeof (gpointer),
+                         thunar_folder_index_compare, GINT_TO_POINTER (case_sensitive));
+      index->sorted[case_sensitive] = sorted;
+    }
+
+  for (n = sorted->len; n > 0; --n)
+    directories = g_list_prepend (directories, g_ptr_array_index (sorted, n - 1));
+
+  return directories;
+}
+
+
+
+/**
+ * thunar_folder_index_has_children:
+ * @index     : a #ThunarFolderIndex.
+ * @directory : a sub folder of @index.
+ *
+ * Tells whether @directory contains anything, see
+ * thunar_g_file_has_children(). The answer is kept until
+ * @directory is modified, and is shared by all users of @index.
+ *
+ * Return value: %TRUE if @directory has children.
+ **/
+gboolean
+thunar_folder_index_has_children (ThunarFolderIndex *index,
+                                  ThunarFile        *directory)
+{
+  ThunarFolderIndexEntry *entry;
+  guint64                 mtime;
+
+  _thunar_return_val_if_fail (THUNAR_IS_FOLDER_INDEX (index), FALSE);
+  _thunar_return_val_if_fail (THUNAR_IS_FILE (directory), FALSE);
+
+  entry = g_hash_table_lookup (index->directories, directory);
+  if (G_UNLIKELY (entry == NULL))
+    return thunar_g_file_has_children (thunar_file_get_file (directory));
+
+  mtime = thunar_file_get_date (directory, THUNAR_FILE_DATE_MODIFIED);
+  if (entry->has_children < 0 || entry->mtime != mtime)
+    {
+      entry->has_children = thunar_g_file_has_children (thunar_file_get_file (directory));
+      entry->mtime = mtime;
+    }
+
+  return entry->has_children;
+}
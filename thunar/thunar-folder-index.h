@@ -0,0 +1,46 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __THUNAR_FOLDER_INDEX_H__
+#define __THUNAR_FOLDER_INDEX_H__
+
+#include "thunar/thunar-folder.h"
+
+G_BEGIN_DECLS;
+
+typedef struct _ThunarFolderIndexClass ThunarFolderIndexClass;
+typedef struct _ThunarFolderIndex      ThunarFolderIndex;
+
+#define THUNAR_TYPE_FOLDER_INDEX            (thunar_folder_index_get_type ())
+#define THUNAR_FOLDER_INDEX(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), THUNAR_TYPE_FOLDER_INDEX, ThunarFolderIndex))
+#define THUNAR_FOLDER_INDEX_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), THUNAR_TYPE_FOLDER_INDEX, ThunarFolderIndexClass))
+#define THUNAR_IS_FOLDER_INDEX(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), THUNAR_TYPE_FOLDER_INDEX))
+#define THUNAR_IS_FOLDER_INDEX_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), THUNAR_TYPE_FOLDER_INDEX))
+#define THUNAR_FOLDER_INDEX_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), THUNAR_TYPE_FOLDER_INDEX, ThunarFolderIndexClass))
+
+GType              thunar_folder_index_get_type        (void) G_GNUC_CONST;
+
+ThunarFolderIndex *thunar_folder_index_get_for_file    (ThunarFile        *file);
+
+ThunarFolder      *thunar_folder_index_get_folder      (ThunarFolderIndex *index);
+GList             *thunar_folder_index_get_directories (ThunarFolderIndex *index,
+                                                        gboolean           case_sensitive);
+gboolean           thunar_folder_index_has_children    (ThunarFolderIndex *index,
+                                                        ThunarFile        *directory);
+
+G_END_DECLS;
+
+#endif /* !__THUNAR_FOLDER_INDEX_H__ */
@@ -0,0 +1,376 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* A folder snapshot is the listing of a remote folder as it was when the
+ * ThunarFolder was last released, stored as a serialized GVariant in
+ * $XDG_CACHE_HOME/Thunar/folders/, named after the md5 of the folder URI.
+ * It is mapped and shown right away when the folder is opened again, as
+ * long as the modification time and etag of the folder did not change.
+ * The real listing runs afterwards and corrects the snapshot. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <glib/gstdio.h>
+
+#include "thunar/thunar-file.h"
+#include "thunar/thunar-folder-snapshot.h"
+#include "thunar/thunar-mount-health.h"
+#include "thunar/thunar-private.h"
+#include "thunar/thunar-util.h"
+
+
+
+/* bump on changes of the format below */
+#define THUNAR_FOLDER_SNAPSHOT_VERSION (1)
+
+/* version, folder URI, folder mtime, folder etag and per file its
+ * name, content type (empty if unknown), type, size and mtime */
+#define THUNAR_FOLDER_SNAPSHOT_ENTRIES_TYPE "a(aysutt)"
+#define THUNAR_FOLDER_SNAPSHOT_TYPE         "(usts" THUNAR_FOLDER_SNAPSHOT_ENTRIES_TYPE ")"
+
+/* smaller folders are listed quickly enough, and only this many
+ * snapshots are kept, the least recently saved are dropped */
+#define THUNAR_FOLDER_SNAPSHOT_MIN_FILES     (256)
+#define THUNAR_FOLDER_SNAPSHOT_MAX_SNAPSHOTS (64)
+
+#define THUNAR_FOLDER_SNAPSHOT_DIRECTORY_ATTRIBUTES \
+  G_FILE_ATTRIBUTE_TIME_MODIFIED "," G_FILE_ATTRIBUTE_ETAG_VALUE
+
+
+
+typedef struct
+{
+  GFile    *directory;
+  GVariant *entries;
+}
+ThunarFolderSnapshotSave;
+
+static gchar *
+thunar_folder_snapshot_get_directory (void)
+{
+  return g_build_filename (g_get_user_cache_dir (), "Thunar", "folders", NULL);
+}
+
+
+
+static gchar *
+thunar_folder_snapshot_get_path (GFile *directory)
+{
+  gchar *checksum;
+  gchar *dirname;
+  gchar *path;
+  gchar *uri;
+
+  uri = g_file_get_uri (directory);
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, uri, -1);
+  dirname = thunar_folder_snapshot_get_directory ();
+  path = g_build_filename (dirname, checksum, NULL);
+  g_free (dirname);
+  g_free (checksum);
+  g_free (uri);
+
+  return path;
+}
+
+
+
+/* whether the snapshot still describes @directory, may block on I/O */
+static gboolean
+thunar_folder_snapshot_is_valid (GFile        *directory,
+                                 guint64       mtime,
+                                 const gchar  *etag,
+                                 GCancellable *cancellable)
+{
+  GFileInfo *info;
+  GError    *error = NULL;
+  gboolean   valid;
+
+  /* the last known state is all there is while the server is away */
+  if (!thunar_mount_health_is_reachable (directory))
+    return TRUE;
+
+  info = g_file_query_info (directory, THUNAR_FOLDER_SNAPSHOT_DIRECTORY_ATTRIBUTES,
+                            G_FILE_QUERY_INFO_NONE, cancellable, &error);
+  if (info == NULL)
+    {
+      thunar_mount_health_report_error (directory, error);
+      g_error_free (error);
+      return !thunar_mount_health_is_reachable (directory);
+    }
+
+  valid = (g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED) == mtime
+           && g_strcmp0 (g_file_info_get_etag (info), *etag != '\0' ? etag : NULL) == 0);
+  g_object_unref (info);
+
+  return valid;
+}
+
+
+
+/**
+ * thunar_folder_snapshot_supported:
+ * @directory : a #GFile.
+ *
+ * Snapshots are only used for remote folders, local ones are
+ * listed faster than a snapshot could be validated.
+ *
+ * Return value: %TRUE if @directory may be restored from a snapshot.
+ **/
+gboolean
+thunar_folder_snapshot_supported (GFile *directory)
+{
+  _thunar_return_val_if_fail (G_IS_FILE (directory), FALSE);
+
+  return !g_file_is_native (directory)
+         && !g_file_has_uri_scheme (directory, "trash")
+         && !g_file_has_uri_scheme (directory, "recent");
+}
+
+
+
+/**
+ * thunar_folder_snapshot_load:
+ * @directory   : a #GFile.
+ * @cancellable : a #GCancellable or %NULL.
+ *
+ * Restores the files of @directory from its snapshot, if there is
+ * one and it is still valid. The returned files are provisional, see
+ * thunar_file_get_provisional_batch(). Invalid snapshots are removed.
+ *
+ * This queries @directory once and must not be called from the
+ * main thread.
+ *
+ * Return value: (transfer full): the #GList of #ThunarFile<!---->s
+ *               in the snapshot, free with thunar_g_list_free_full().
+ **/
+GList *
+thunar_folder_snapshot_load (GFile        *directory,
+                             GCancellable *cancellable)
+{
+  GMappedFile  *mapped_file;
+  GVariantIter  iter;
+  const gchar  *content_type;
+  const gchar  *name;
+  const gchar  *uri;
+  const gchar  *etag;
+  GPtrArray    *content_types;
+  GFileInfo    *info;
+  GVariant     *snapshot;
+  GVariant     *entries;
+  GBytes       *bytes;
+  guint64       directory_mtime;
+  guint64       size;
+  guint64       mtime;
+  GList        *infos = NULL;
+  GList        *files;
+  GList        *lp;
+  gchar        *display_name;
+  gchar        *directory_uri;
+  gchar        *path;
+  guint32       version;
+  guint32       type;
+  guint         n;
+
+  _thunar_return_val_if_fail (G_IS_FILE (directory), NULL);
+
+  path = thunar_folder_snapshot_get_path (directory);
+  mapped_file = g_mapped_file_new (path, FALSE, NULL);
+  if (mapped_file == NULL)
+    {
+      g_free (path);
+      return NULL;
+    }
+
+  bytes = g_mapped_file_get_bytes (mapped_file);
+  g_mapped_file_unref (mapped_file);
+
+  /* untrusted data is fine here, GVariant never reads out of bounds */
+  snapshot = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (THUNAR_FOLDER_SNAPSHOT_TYPE), bytes, FALSE));
+  g_bytes_unref (bytes);
+
+  g_variant_get (snapshot, "(u&st&s@" THUNAR_FOLDER_SNAPSHOT_ENTRIES_TYPE ")",
+                 &version, &uri, &directory_mtime, &etag, &entries);
+
+  /* make sure this is the snapshot of this folder and it is up to date */
+  directory_uri = g_file_get_uri (directory);
+  if (version != THUNAR_FOLDER_SNAPSHOT_VERSION
+      || g_strcmp0 (uri, directory_uri) != 0
+      || !thunar_folder_snapshot_is_valid (directory, directory_mtime, etag, cancellable))
+    {
+      if (!g_cancellable_is_cancelled (cancellable))
+        g_unlink (path);
+
+      g_free (directory_uri);
+      g_variant_unref (entries);
+      g_variant_unref (snapshot);
+      g_free (path);
+      return NULL;
+    }
+  g_free (directory_uri);
+  g_free (path);
+
+  content_types = g_ptr_array_sized_new (g_variant_n_children (entries));
+
+  g_variant_iter_init (&iter, entries);
+  while (g_variant_iter_next (&iter, "(^&ay&sutt)", &name, &content_type, &type, &size, &mtime))
+    {
+      /* skip anything that cannot be a child of the folder */
+      if (*name == '\0' || strchr (name, '/') != NULL)
+        continue;
+
+      info = g_file_info_new ();
+      g_file_info_set_name (info, name);
+      display_name = g_filename_display_name (name);
+      g_file_info_set_display_name (info, display_name);
+      g_free (display_name);
+      g_file_info_set_file_type (info, type);
+      g_file_info_set_is_hidden (info, *name == '.');
+      g_file_info_set_is_backup (info, g_str_has_suffix (name, "~"));
+      g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_SIZE, size);
+      g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED, mtime);
+
+      infos = g_list_prepend (infos, info);
+      g_ptr_array_add (content_types, (gpointer) content_type);
+    }
+
+  /* the content types were added in reverse order */
+  files = thunar_file_get_provisional_batch (directory, infos);
+  for (lp = files, n = content_types->len; lp != NULL; lp = lp->next, n--)
+    {
+      content_type = g_ptr_array_index (content_types, n - 1);
+      if (*content_type != '\0')
+        thunar_file_set_content_type (THUNAR_FILE (lp->data), content_type);
+    }
+
+  g_list_free_full (infos, g_object_unref);
+  g_ptr_array_free (content_types, TRUE);
+  g_variant_unref (entries);
+  g_variant_unref (snapshot);
+
+  return files;
+}
+
+
+
+static gpointer
+thunar_folder_snapshot_save_thread (gpointer user_data)
+{
+  ThunarFolderSnapshotSave *save = user_data;
+  GFileInfo                *info;
+  GVariant                 *snapshot;
+  gchar                    *dirname;
+  gchar                    *path;
+  gchar                    *uri;
+
+  /* the listing is only worth something together with the state of the folder */
+  info = g_file_query_info (save->directory, THUNAR_FOLDER_SNAPSHOT_DIRECTORY_ATTRIBUTES,
+                            G_FILE_QUERY_INFO_NONE, NULL, NULL);
+  if (G_LIKELY (info != NULL))
+    {
+      uri = g_file_get_uri (save->directory);
+      snapshot = g_variant_ref_sink (g_variant_new ("(ust&s@" THUNAR_FOLDER_SNAPSHOT_ENTRIES_TYPE ")",
+                                     THUNAR_FOLDER_SNAPSHOT_VERSION, uri,
+                                     g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED),
+                                     g_file_info_get_etag (info) != NULL ? g_file_info_get_etag (info) : "",
+                                     save->entries));
+
+      dirname = thunar_folder_snapshot_get_directory ();
+      path = thunar_folder_snapshot_get_path (save->directory);
+      if (g_mkdir_with_parents (dirname, 0700) == 0
+          && g_file_set_contents_full (path, g_variant_get_data (snapshot), g_variant_get_size (snapshot),
+                                       G_FILE_SET_CONTENTS_CONSISTENT, 0600, NULL))
+        thunar_util_prune_directory (dirname, THUNAR_FOLDER_SNAPSHOT_MAX_SNAPSHOTS);
+
+      g_free (path);
+      g_free (dirname);
+      g_variant_unref (snapshot);
+      g_free (uri);
+      g_object_unref (info);
+    }
+
+  g_object_unref (save->directory);
+  g_variant_unref (save->entries);
+  g_slice_free (ThunarFolderSnapshotSave, save);
+
+  return NULL;
+}
+
+
+
+/**
+ * thunar_folder_snapshot_save:
+ * @directory : a #GFile.
+ * @files     : the #GList of #ThunarFile<!---->s in @directory.
+ *
+ * Stores a snapshot of @files for the next time @directory is
+ * opened. The current state of @directory is queried and the
+ * snapshot is written in a separate thread.
+ **/
+void
+thunar_folder_snapshot_save (GFile *directory,
+                             GList *files)
+{
+  ThunarFolderSnapshotSave *save;
+  GVariantBuilder           builder;
+  GFileInfo                *info;
+  GThread                  *thread;
+  GList                    *lp;
+  gchar                    *content_type;
+
+  _thunar_return_if_fail (G_IS_FILE (directory));
+
+  if (g_list_length (files) < THUNAR_FOLDER_SNAPSHOT_MIN_FILES)
+    return;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE (THUNAR_FOLDER_SNAPSHOT_ENTRIES_TYPE));
+  for (lp = files; lp != NULL; lp = lp->next)
+    {
+      info = thunar_file_get_info (lp->data);
+      if (G_UNLIKELY (info == NULL))
+        continue;
+
+      content_type = thunar_file_dup_content_type (lp->data);
+      g_variant_builder_add (&builder, "(^aysutt)",
+                             thunar_file_get_basename (lp->data),
+                             content_type != NULL ? content_type : "",
+                             (guint32) thunar_file_get_kind (lp->data),
+                             g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_SIZE),
+                             g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED));
+      g_free (content_type);
+    }
+
+  save = g_slice_new (ThunarFolderSnapshotSave);
+  save->directory = g_object_ref (directory);
+  save->entries = g_variant_ref_sink (g_variant_builder_end (&builder));
+
+  thread = g_thread_try_new ("thunar-folder-snapshot", thunar_folder_snapshot_save_thread, save, NULL);
+  if (G_LIKELY (thread != NULL))
+    {
+      g_thread_unref (thread);
+      return;
+    }
+
+  /* no snapshot this time */
+  g_object_unref (save->directory);
+  g_variant_unref (save->entries);
+  g_slice_free (ThunarFolderSnapshotSave, save);
+}
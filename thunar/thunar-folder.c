@@ -22,17 +22,54 @@
 #include "config.h"
 #endif
 
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include "thunar/thunar-filesystem-cache.h"
 #include "thunar/thunar-folder.h"
+#include "thunar/thunar-folder-snapshot.h"
 #include "thunar/thunar-gobject-extensions.h"
+#include "thunar/thunar-inotify.h"
 #include "thunar/thunar-io-jobs.h"
 #include "thunar/thunar-job.h"
+#include "thunar/thunar-mount-health.h"
 #include "thunar/thunar-private.h"
+#include "thunar/thunar-profile.h"
+#include "thunar/thunar-search-index.h"
+#include "thunar/thunar-thumbnail-pack.h"
 
 #define DEBUG_FILE_CHANGES FALSE
 
 /* The maximum throttle interval (in ms) in which files will be added, removed or notified to be changed */
 #define THUNAR_FOLDER_UPDATE_TIMEOUT (25)
 
+/* While more than THUNAR_FOLDER_UPDATE_BURST updates arrive per interval, the interval is
+ * doubled up to THUNAR_FOLDER_UPDATE_TIMEOUT_MAX (in ms). Once the monitor added or
+ * removed more than THUNAR_FOLDER_RESCAN_THRESHOLD files in one interval, they are
+ * dropped and the folder is reloaded in one go instead */
+#define THUNAR_FOLDER_UPDATE_BURST       (64)
+#define THUNAR_FOLDER_UPDATE_TIMEOUT_MAX (800)
+#define THUNAR_FOLDER_RESCAN_THRESHOLD   (1024)
+
+/* Content types are determined first for the files the views ask for, see
+ * thunar_folder_load_content_types(). The remaining files are handled in batches of
+ * THUNAR_FOLDER_CONTENT_TYPE_BATCH at low priority, starting THUNAR_FOLDER_CONTENT_TYPE_DELAY
+ * (in ms) after they were added, so the views get the chance to ask first */
+#define THUNAR_FOLDER_CONTENT_TYPE_BATCH (128)
+#define THUNAR_FOLDER_CONTENT_TYPE_DELAY (250)
+
+/* The monitor events of a file written by a job of Thunar are held back for at most
+ * THUNAR_FOLDER_EXPECTED_TIMEOUT (in seconds), see thunar_folder_expect_changes() */
+#define THUNAR_FOLDER_EXPECTED_TIMEOUT (60)
+
+/* The basenames of the files are kept in blocks of THUNAR_FOLDER_NAMES_BLOCK bytes, which
+ * are released with the folder. The names of removed or renamed files stay in their block
+ * until more than THUNAR_FOLDER_NAMES_MIN_WASTE bytes, and more than the names still in use,
+ * are wasted, then the names are copied to new blocks, see thunar_folder_compact_names() */
+#define THUNAR_FOLDER_NAMES_BLOCK      (4096)
+#define THUNAR_FOLDER_NAMES_MIN_WASTE  (64 * 1024)
+
 /* property identifiers */
 enum
 {
@@ -74,6 +111,16 @@ static gboolean       thunar_folder_files_ready           (ThunarJob
                                                            ThunarFolder          *folder);
 static void           thunar_folder_finished              (ExoJob                *job,
                                                            ThunarFolder          *folder);
+static gboolean       thunar_folder_snapshot_ready        (ThunarJob             *job,
+                                                           GList                 *files,
+                                                           ThunarFolder          *folder);
+static void           thunar_folder_snapshot_finished     (ExoJob                *job,
+                                                           ThunarFolder          *folder);
+static void           thunar_folder_list_directory        (ThunarFolder          *folder);
+static void           thunar_folder_reachability_changed  (ThunarMountHealth     *mount_health,
+                                                           GFile                 *root,
+                                                           gboolean               reachable,
+                                                           ThunarFolder          *folder);
 static void           thunar_folder_changed               (ThunarFile            *file,
                                                            ThunarFolder          *folder);
 static void           thunar_folder_destroyed             (ThunarFile            *file,
@@ -87,8 +134,17 @@ static void           thunar_folder_monitor               (GFileMonitor
                                                            GFile                 *other_file,
                                                            GFileMonitorEvent      event_type,
                                                            gpointer               user_data);
-static void           thunar_folder_load_content_types    (ThunarFolder          *folder,
+static void           thunar_folder_inotify_events        (const ThunarInotifyEvent *events,
+                                                           guint                  n_events,
+                                                           gpointer               user_data);
+static void           thunar_folder_replay_event          (GFile                 *file,
+                                                           GFile                 *other_file,
+                                                           GFileMonitorEvent      event_type,
+                                                           gpointer               user_data);
+static void           thunar_folder_queue_content_types   (ThunarFolder          *folder,
                                                            GList                 *files);
+static void           thunar_folder_schedule_content_types (ThunarFolder         *folder,
+                                                            guint                 delay);
 static void           thunar_folder_add_file              (ThunarFolder          *folder,
                                                            ThunarFile            *file);
 static void           thunar_folder_remove_file           (ThunarFolder          *folder,
@@ -124,8 +180,29 @@ struct _ThunarFolder
   ThunarJob         *job;
   ThunarJob         *content_type_job;
 
+  /* when the job above was started, for the startup profile */
+  gint64             load_begin_time;
+
+  /* when the listing and the content_type_job were started, for a traced navigation */
+  gint64             navigation_load_time;
+  gint64             navigation_content_type_time;
+
+  /* files still waiting for their content type, the batch job working on some of them and the source starting it */
+  GHashTable        *content_type_files;
+  ThunarJob         *content_type_batch_job;
+  guint              content_type_source_id;
+
+  /* restores the files from the last visit before the job above lists the folder */
+  ThunarJob         *snapshot_job;
+
+  /* the folder was listed completely, store it for the next visit once released */
+  gboolean           save_snapshot;
+
   ThunarFile        *corresponding_file;
 
+  /* lists the folder again when its mount is reachable again */
+  ThunarMountHealth *mount_health;
+
   /* Files which were loaded a list directory jobs. The key is a ThunarFile; value is NULL (unimportant)*/
   GHashTable        *loaded_files_map;
 
@@ -141,15 +218,42 @@ struct _ThunarFolder
   /* Files inside this folder. The key is a ThunarFile; value is NULL (unimportant)*/
   GHashTable        *files_map;
 
+  /* The basenames of the files in files_map, basename -> ThunarFile and
+   * ThunarFile -> basename, both without references on the files. The
+   * tables share the names, which are owned by names_chunk */
+  GHashTable        *names_map;
+  GHashTable        *file_names;
+  GStringChunk      *names_chunk;
+  gsize              names_size;
+  gsize              names_wasted;
+
   gboolean           reload_info;
 
   guint              in_destruction : 1;
 
   GFileMonitor      *monitor;
 
+  /* used instead of the monitor for local folders */
+  ThunarInotifyWatch *inotify_watch;
+
+  /* watched files whose changes are delivered by the monitor above, see
+   * thunar_folder_route_file_watch(). The key is a ThunarFile (no reference) */
+  GHashTable        *routed_files;
+
   /* timeout source ID, used for collecting updates on files before sending the related signal */
   guint              files_update_timeout_source_id;
 
+  /* current interval of the timeout above, the updates collected in it and the time of the last flush */
+  guint              files_update_timeout;
+  guint              n_files_updates;
+  gint64             files_update_time;
+
+  /* files added or removed by the monitor during the current interval */
+  guint              n_files_events;
+
+  /* too many files came and went, the folder will be reloaded on the next flush */
+  gboolean           rescan_pending;
+
   /* List of ThunarFiles for which the thumbnail got updated recently */
   GList             *thumbnail_updated_files;
 
@@ -159,9 +263,33 @@ struct _ThunarFolder
 
 
 
+typedef struct
+{
+  GFile        *file;
+
+  /* the jobs writing the file and when the first one started */
+  guint         n_jobs;
+  gint64        time;
+
+  /* the folder that held back events of the file, and if one was a creation */
+  ThunarFolder *folder;
+  gboolean      created;
+}
+ThunarFolderExpected;
+
+
+
 static guint  folder_signals[LAST_SIGNAL];
 static GQuark thunar_folder_quark;
 
+/* the files written by jobs right now, GFile -> ThunarFolderExpected */
+static GMutex      expected_mutex;
+static GHashTable *expected_changes = NULL;
+
+/* the folders alive and the ones of them watching for changes */
+static guint  folder_n_alive = 0;
+static guint  folder_n_monitored = 0;
+
 
 
 G_DEFINE_TYPE (ThunarFolder, thunar_folder, G_TYPE_OBJECT)
@@ -174,11 +302,29 @@ thunar_folder_constructed (GObject *object)
   ThunarFolder *folder = THUNAR_FOLDER (object);
   GError       *error = NULL;
 
+  folder_n_alive++;
+
+  folder->mount_health = thunar_mount_health_get_default ();
+  g_signal_connect (folder->mount_health, "reachability-changed", G_CALLBACK (thunar_folder_reachability_changed), folder);
+
+  /* local folders share an inotify watch with the files watched inside them */
+  folder->inotify_watch = thunar_inotify_watch_directory (thunar_file_get_file (folder->corresponding_file),
+                                                          thunar_folder_inotify_events, folder);
+  if (folder->inotify_watch != NULL)
+    {
+      folder_n_monitored++;
+      G_OBJECT_CLASS (thunar_folder_parent_class)->constructed (object);
+      return;
+    }
+
   folder->monitor = g_file_monitor_directory (thunar_file_get_file (folder->corresponding_file),
                                               G_FILE_MONITOR_WATCH_MOVES, NULL, &error);
 
   if (G_LIKELY (folder->monitor != NULL))
-    g_signal_connect (folder->monitor, "changed", G_CALLBACK (thunar_folder_monitor), folder);
+    {
+      folder_n_monitored++;
+      g_signal_connect (folder->monitor, "changed", G_CALLBACK (thunar_folder_monitor), folder);
+    }
   else
     {
       g_debug ("Could not create folder monitor: %s", error->message);
@@ -334,13 +480,24 @@ thunar_folder_init (ThunarFolder *folder)
   /* If hashtable is initialized without a key_equal_func (we'd use g_direct_equal here);
    * then equality is checked similar to g_direct_equal but without the overhead of a function call */
   folder->files_map = g_hash_table_new_full (g_direct_hash, NULL, g_object_unref, NULL);
+  folder->names_map = g_hash_table_new (g_str_hash, g_str_equal);
+  folder->file_names = g_hash_table_new (g_direct_hash, NULL);
+  folder->names_chunk = g_string_chunk_new (THUNAR_FOLDER_NAMES_BLOCK);
   folder->loaded_files_map = g_hash_table_new_full (g_direct_hash, NULL, g_object_unref, NULL);
   folder->added_files_map = g_hash_table_new_full (g_direct_hash, NULL, g_object_unref, NULL);
   folder->removed_files_map = g_hash_table_new_full (g_direct_hash, NULL, g_object_unref, NULL);
   folder->changed_files_map = g_hash_table_new_full (g_direct_hash, NULL, g_object_unref, NULL);
+  folder->content_type_files = g_hash_table_new_full (g_direct_hash, NULL, g_object_unref, NULL);
+  folder->routed_files = g_hash_table_new (g_direct_hash, NULL);
 
   folder->reload_info = FALSE;
   folder->files_update_timeout_source_id = 0;
+  folder->files_update_timeout = THUNAR_FOLDER_UPDATE_TIMEOUT;
+  folder->n_files_updates = 0;
+  folder->files_update_time = 0;
+  folder->n_files_events = 0;
+  folder->rescan_pending = FALSE;
+  folder->save_snapshot = FALSE;
   folder->thumbnail_updated_files = NULL;
   folder->thumbnail_updated_timeout_source_id = 0;
 }
@@ -370,6 +527,12 @@ thunar_folder_finalize (GObject *object)
   ThunarFolder   *folder = THUNAR_FOLDER (object);
   GHashTableIter  iter;
   gpointer        key, file;
+  GList          *files;
+  GList          *lp;
+
+  folder_n_alive--;
+  if (folder->monitor != NULL || folder->inotify_watch != NULL)
+    folder_n_monitored--;
 
   /* stop any running tumbnailing timeout source */
   if (folder->thumbnail_updated_timeout_source_id != 0)
@@ -379,9 +542,36 @@ thunar_folder_finalize (GObject *object)
   if (folder->files_update_timeout_source_id != 0)
     g_source_remove (folder->files_update_timeout_source_id);
 
+  /* stop loading content types */
+  if (folder->content_type_source_id != 0)
+    g_source_remove (folder->content_type_source_id);
+
+  if (folder->content_type_job != NULL)
+    {
+      g_signal_handlers_disconnect_by_data (folder->content_type_job, folder);
+      exo_job_cancel (EXO_JOB (folder->content_type_job));
+      g_object_unref (folder->content_type_job);
+    }
+
+  if (folder->content_type_batch_job != NULL)
+    {
+      g_signal_handlers_disconnect_by_data (folder->content_type_batch_job, folder);
+      exo_job_cancel (EXO_JOB (folder->content_type_batch_job));
+      g_object_unref (folder->content_type_batch_job);
+    }
+
+  g_signal_handlers_disconnect_by_data (folder->mount_health, folder);
+  g_object_unref (folder->mount_health);
+
   if (folder->monitor != NULL)
     g_signal_handlers_disconnect_by_data (folder->monitor, folder);
 
+  if (folder->inotify_watch != NULL)
+    {
+      thunar_inotify_unwatch (folder->inotify_watch);
+      folder->inotify_watch = NULL;
+    }
+
   if (folder->corresponding_file)
     {
       thunar_file_unwatch (folder->corresponding_file);
@@ -398,9 +588,34 @@ thunar_folder_finalize (GObject *object)
       g_signal_handlers_disconnect_by_data (file, folder);
     }
 
+  /* files still watched by others need a monitor of their own now */
+  files = g_hash_table_get_keys (folder->routed_files);
+  g_hash_table_destroy (folder->routed_files);
+  folder->routed_files = NULL;
+  for (lp = files; lp != NULL; lp = lp->next)
+    thunar_file_watch_unrouted (lp->data);
+  g_list_free (files);
+
   /* release files to thumbnail if any */
   thunar_g_list_free_full (folder->thumbnail_updated_files);
 
+  /* remember the files for the next time the folder is opened, unless they were not listed completely */
+  if (folder->save_snapshot && folder->job == NULL && folder->snapshot_job == NULL
+      && g_hash_table_size (folder->added_files_map) == 0 && g_hash_table_size (folder->removed_files_map) == 0)
+    {
+      files = g_hash_table_get_keys (folder->files_map);
+      thunar_folder_snapshot_save (thunar_file_get_file (folder->corresponding_file), files);
+      g_list_free (files);
+    }
+
+  /* pack the thumbnails which were read one by one while the folder was shown */
+  if (folder->job == NULL && g_hash_table_size (folder->files_map) > 0)
+    {
+      files = g_hash_table_get_keys (folder->files_map);
+      thunar_thumbnail_pack_save (thunar_file_get_file (folder->corresponding_file), files);
+      g_list_free (files);
+    }
+
   /* cancel the pending job (if any) */
   if (G_UNLIKELY (folder->job != NULL))
     {
@@ -409,6 +624,14 @@ thunar_folder_finalize (GObject *object)
       folder->job = NULL;
     }
 
+  if (G_UNLIKELY (folder->snapshot_job != NULL))
+    {
+      g_signal_handlers_disconnect_by_data (folder->snapshot_job, folder);
+      exo_job_cancel (EXO_JOB (folder->snapshot_job));
+      g_object_unref (folder->snapshot_job);
+      folder->snapshot_job = NULL;
+    }
+
   /* disconnect from the corresponding file */
   if (G_LIKELY (folder->corresponding_file != NULL))
     {
@@ -419,10 +642,14 @@ thunar_folder_finalize (GObject *object)
 
   /* release references to the current files lists */
   g_hash_table_destroy (folder->files_map);
+  g_hash_table_destroy (folder->names_map);
+  g_hash_table_destroy (folder->file_names);
+  g_string_chunk_free (folder->names_chunk);
   g_hash_table_destroy (folder->loaded_files_map);
   g_hash_table_destroy (folder->changed_files_map);
   g_hash_table_destroy (folder->added_files_map);
   g_hash_table_destroy (folder->removed_files_map);
+  g_hash_table_destroy (folder->content_type_files);
 
   (*G_OBJECT_CLASS (thunar_folder_parent_class)->finalize) (object);
 }
@@ -487,6 +714,89 @@ thunar_folder_set_property (GObject      *object,
 }
 
 
+static void
+thunar_folder_forget_name (ThunarFolder *folder,
+                           ThunarFile   *file)
+{
+  const gchar *name;
+  gsize        length;
+
+  name = g_hash_table_lookup (folder->file_names, file);
+  if (name == NULL)
+    return;
+
+  if (g_hash_table_lookup (folder->names_map, name) == file)
+    g_hash_table_remove (folder->names_map, name);
+  g_hash_table_remove (folder->file_names, file);
+
+  /* the name stays in its block until the next compaction */
+  length = strlen (name) + 1;
+  folder->names_size -= length;
+  folder->names_wasted += length;
+}
+
+
+
+static void
+thunar_folder_compact_names (ThunarFolder *folder)
+{
+  GHashTableIter iter;
+  GStringChunk  *names_chunk;
+  GHashTable    *names_map;
+  gpointer       file;
+  gpointer       name;
+  gchar         *new_name;
+
+  /* the names of a folder without changes are never copied */
+  if (G_LIKELY (folder->names_wasted < THUNAR_FOLDER_NAMES_MIN_WASTE
+                || folder->names_wasted < folder->names_size))
+    return;
+
+  names_chunk = g_string_chunk_new (THUNAR_FOLDER_NAMES_BLOCK);
+  names_map = g_hash_table_new (g_str_hash, g_str_equal);
+
+  g_hash_table_iter_init (&iter, folder->file_names);
+  while (g_hash_table_iter_next (&iter, &file, &name))
+    {
+      new_name = g_string_chunk_insert (names_chunk, name);
+      if (g_hash_table_lookup (folder->names_map, name) == file)
+        g_hash_table_insert (names_map, new_name, file);
+      g_hash_table_iter_replace (&iter, new_name);
+    }
+
+  g_hash_table_destroy (folder->names_map);
+  g_string_chunk_free (folder->names_chunk);
+  folder->names_map = names_map;
+  folder->names_chunk = names_chunk;
+  folder->names_wasted = 0;
+}
+
+
+
+static void
+thunar_folder_remember_name (ThunarFolder *folder,
+                             ThunarFile   *file)
+{
+  const gchar *name = thunar_file_get_basename (file);
+  const gchar *old_name;
+  gchar       *new_name;
+
+  /* nothing to do unless the file was renamed */
+  old_name = g_hash_table_lookup (folder->file_names, file);
+  if (old_name != NULL && g_str_equal (old_name, name))
+    return;
+
+  thunar_folder_forget_name (folder, file);
+  thunar_folder_compact_names (folder);
+
+  new_name = g_string_chunk_insert (folder->names_chunk, name);
+  folder->names_size += strlen (name) + 1;
+  g_hash_table_insert (folder->file_names, file, new_name);
+  g_hash_table_replace (folder->names_map, new_name, file);
+}
+
+
+
 static gboolean
 _thunar_folder_remove_file (ThunarFolder *folder,
                             ThunarFile   *file)
@@ -501,7 +811,11 @@ _thunar_folder_remove_file (ThunarFolder *folder,
   /* disconnect all signals for the file */
   g_signal_handlers_disconnect_by_data (G_OBJECT (file), folder);
 
+  /* its content type is of no interest any longer */
+  g_hash_table_remove (folder->content_type_files, file);
+
   /* remove the ThunarFile from our map (the destroy method of the hashmap will to the 'g_object_unref')*/
+  thunar_folder_forget_name (folder, file);
   g_hash_table_remove (folder->files_map, file);
 
   return TRUE;
@@ -519,6 +833,7 @@ _thunar_folder_add_file (ThunarFolder *folder,
 
   /* add the ThunarFile) to the hashmap and keep a reference to it */
   g_hash_table_add (folder->files_map, g_object_ref (file));
+  thunar_folder_remember_name (folder, file);
 
   /* connect relevant signals */
   g_signal_connect_swapped (G_OBJECT (file), "changed", G_CALLBACK (thunar_folder_file_changed), folder);
@@ -540,6 +855,15 @@ _thunar_folder_files_update_timeout (gpointer data)
   GList         *files = NULL;
   GHashTableIter iter;
   gpointer       key;
+  gint64         begin_time;
+
+  /* reloading the folder sends the signals for added and removed files */
+  if (folder->rescan_pending)
+    {
+      folder->rescan_pending = FALSE;
+      thunar_folder_reload (folder, FALSE);
+      goto changed;
+    }
 
   /* send a 'files-removed' signal for all files which were removed */
   g_hash_table_iter_init (&iter, folder->removed_files_map);
@@ -565,15 +889,19 @@ _thunar_folder_files_update_timeout (gpointer data)
         files = g_list_prepend (files, file);
     }
 
-  /* start loading the content types of all added files */
-  thunar_folder_load_content_types (folder, files);
+  /* the content types of the added files are loaded later in the background */
+  thunar_folder_queue_content_types (folder, files);
 
+  /* the models insert and sort the files in the handlers */
+  begin_time = thunar_profile_navigation_now (thunar_file_get_file (folder->corresponding_file));
   g_signal_emit (G_OBJECT (folder), folder_signals[FILES_ADDED], 0, files);
+  thunar_profile_navigation_mark (thunar_file_get_file (folder->corresponding_file), begin_time, "files-added");
 
   g_list_free (files);
   files = NULL;
   g_hash_table_remove_all (folder->added_files_map);
 
+changed:
   /* send a 'changed' signal for all files which changed */
   g_hash_table_iter_init (&iter, folder->changed_files_map);
   while (g_hash_table_iter_next (&iter, &key, NULL))
@@ -590,7 +918,15 @@ _thunar_folder_files_update_timeout (gpointer data)
   files = NULL;
   g_hash_table_remove_all (folder->changed_files_map);
 
+  /* back off while the updates keep coming */
+  if (folder->n_files_updates > THUNAR_FOLDER_UPDATE_BURST)
+    folder->files_update_timeout = MIN (folder->files_update_timeout * 2, THUNAR_FOLDER_UPDATE_TIMEOUT_MAX);
+  else
+    folder->files_update_timeout = THUNAR_FOLDER_UPDATE_TIMEOUT;
 
+  folder->n_files_updates = 0;
+  folder->n_files_events = 0;
+  folder->files_update_time = g_get_monotonic_time ();
   folder->files_update_timeout_source_id = 0;
 
   return G_SOURCE_REMOVE;
@@ -598,6 +934,33 @@ _thunar_folder_files_update_timeout (gpointer data)
 
 
 
+static void
+thunar_folder_schedule_update (ThunarFolder *folder)
+{
+  folder->n_files_updates++;
+
+  /* too many files come and go to handle them one by one */
+  if (!folder->rescan_pending
+      && folder->n_files_events > THUNAR_FOLDER_RESCAN_THRESHOLD)
+    {
+      folder->rescan_pending = TRUE;
+      g_hash_table_remove_all (folder->added_files_map);
+      g_hash_table_remove_all (folder->removed_files_map);
+    }
+
+  if (folder->files_update_timeout_source_id != 0)
+    return;
+
+  /* the first update after a quiet period is shown quickly again */
+  if (g_get_monotonic_time () - folder->files_update_time > THUNAR_FOLDER_UPDATE_TIMEOUT_MAX * G_TIME_SPAN_MILLISECOND)
+    folder->files_update_timeout = THUNAR_FOLDER_UPDATE_TIMEOUT;
+
+  folder->files_update_timeout_source_id = g_timeout_add (folder->files_update_timeout, (GSourceFunc) _thunar_folder_files_update_timeout, folder);
+  g_source_set_name_by_id (folder->files_update_timeout_source_id, "_thunar_folder_files_update_timeout");
+}
+
+
+
 static void
 thunar_folder_file_changed (ThunarFolder      *folder,
                             ThunarFile        *file)
@@ -605,11 +968,13 @@ thunar_folder_file_changed (ThunarFolder      *folder,
   _thunar_return_if_fail (THUNAR_IS_FILE (file));
   _thunar_return_if_fail (THUNAR_IS_FOLDER (folder));
 
-  g_hash_table_add (folder->changed_files_map, g_object_ref (file));
+  /* a rename changes the basename */
+  if (g_hash_table_contains (folder->files_map, file))
+    thunar_folder_remember_name (folder, file);
 
-  if (folder->files_update_timeout_source_id == 0)
-    folder->files_update_timeout_source_id = g_timeout_add (THUNAR_FOLDER_UPDATE_TIMEOUT, (GSourceFunc) _thunar_folder_files_update_timeout, folder);
+  g_hash_table_add (folder->changed_files_map, g_object_ref (file));
 
+  thunar_folder_schedule_update (folder);
 }
 
 
@@ -618,14 +983,18 @@ static void
 thunar_folder_add_file (ThunarFolder *folder,
                         ThunarFile   *file)
 {
+  /* the pending reload will pick it up */
+  if (folder->rescan_pending)
+    return;
+
   /* If it possibly was removed shortly before, just undo the "remove" */
   if (g_hash_table_remove (folder->removed_files_map, file))
     return;
 
   g_hash_table_add (folder->added_files_map, g_object_ref (file));
 
-  if (folder->files_update_timeout_source_id == 0)
-    folder->files_update_timeout_source_id = g_timeout_add (THUNAR_FOLDER_UPDATE_TIMEOUT, (GSourceFunc) _thunar_folder_files_update_timeout, folder);
+  folder->n_files_events++;
+  thunar_folder_schedule_update (folder);
 }
 
 
@@ -634,14 +1003,18 @@ static void
 thunar_folder_remove_file (ThunarFolder *folder,
                            ThunarFile   *file)
 {
+  /* the pending reload will notice it is gone */
+  if (folder->rescan_pending)
+    return;
+
   /* If it possibly was added shortly before, just undo the "add" */
   if (g_hash_table_remove (folder->added_files_map, file))
     return;
 
   g_hash_table_add (folder->removed_files_map, g_object_ref (file));
 
-  if (folder->files_update_timeout_source_id == 0)
-    folder->files_update_timeout_source_id = g_timeout_add (THUNAR_FOLDER_UPDATE_TIMEOUT, (GSourceFunc) _thunar_folder_files_update_timeout, folder);
+  folder->n_files_events++;
+  thunar_folder_schedule_update (folder);
 }
 
 
@@ -662,6 +1035,12 @@ thunar_folder_error (ExoJob       *job,
   _thunar_return_if_fail (THUNAR_IS_FOLDER (folder));
   _thunar_return_if_fail (THUNAR_IS_JOB (job));
 
+  /* an incomplete listing is not worth a snapshot */
+  folder->save_snapshot = FALSE;
+
+  /* a server that went away is probed until it is back */
+  thunar_mount_health_report_error (thunar_file_get_file (folder->corresponding_file), error);
+
   /* tell the consumer about the problem */
   g_signal_emit (G_OBJECT (folder), folder_signals[ERROR], 0, error);
 }
@@ -673,47 +1052,133 @@ thunar_folder_files_ready (ThunarJob    *job,
                            GList        *files,
                            ThunarFolder *folder)
 {
-  GList *lp;
+  GList  *lp;
+  GFile  *gfile;
+  gint64  begin_time;
 
   _thunar_return_val_if_fail (THUNAR_IS_FOLDER (folder), FALSE);
   _thunar_return_val_if_fail (THUNAR_IS_JOB (job), FALSE);
 
+  gfile = thunar_file_get_file (folder->corresponding_file);
+  begin_time = thunar_profile_navigation_now (gfile);
+
   /* merge the list with the existing list of new files */
   for (lp = files; lp != NULL; lp = lp->next)
-    g_hash_table_add (folder->loaded_files_map, g_object_ref (lp->data));
+    {
+      g_hash_table_add (folder->loaded_files_map, g_object_ref (lp->data));
+
+      /* files shown from the snapshot got their real info now */
+      if (thunar_file_apply_pending_info (lp->data))
+        thunar_folder_file_changed (folder, lp->data);
+
+      /* the listing arrives in batches, show the new files of each one
+       * right away, the removed ones are known when the listing is done */
+      else if (!g_hash_table_contains (folder->files_map, lp->data)
+               && !g_hash_table_contains (folder->removed_files_map, lp->data))
+        g_hash_table_add (folder->added_files_map, g_object_ref (lp->data));
+    }
 
   thunar_g_list_free_full (files);
 
+  thunar_folder_schedule_update (folder);
+
+  thunar_profile_navigation_mark (gfile, begin_time, "files-ready");
+
   /* indicate that we took over ownership of the file list */
   return TRUE;
 }
 
 
 
-/**
- * thunar_folder_load_content_types:
- * @folder : a #ThunarFolder instance.
- * @files : a #GList of #ThunarFile's for which the content type needs to be loaded.
- *
- * Starts a job to load the content type of all files inside the folder
- **/
-void
-thunar_folder_load_content_types (ThunarFolder *folder,
-                                  GList        *files)
+static void
+thunar_folder_content_types_finished (ExoJob       *job,
+                                      ThunarFolder *folder)
 {
   _thunar_return_if_fail (THUNAR_IS_FOLDER (folder));
 
-  /* check if we are currently connect to a job */
-  if (G_UNLIKELY (folder->content_type_job != NULL))
+  g_signal_handlers_disconnect_by_data (job, folder);
+
+  if (THUNAR_JOB (job) == folder->content_type_job)
     {
-      exo_job_cancel (EXO_JOB (folder->content_type_job));
-      g_object_unref (folder->content_type_job);
       folder->content_type_job = NULL;
+      thunar_profile_navigation_mark (thunar_file_get_file (folder->corresponding_file),
+                                      folder->navigation_content_type_time, "content-types");
     }
+  else if (THUNAR_JOB (job) == folder->content_type_batch_job)
+    folder->content_type_batch_job = NULL;
 
-  /* start a new content_type_job */
-  folder->content_type_job = thunar_io_jobs_load_content_types (files);
-  exo_job_launch (EXO_JOB (folder->content_type_job));
+  g_object_unref (job);
+
+  /* continue with the next batch */
+  thunar_folder_schedule_content_types (folder, 0);
+}
+
+
+
+static gboolean
+thunar_folder_content_types_timeout (gpointer data)
+{
+  ThunarFolder   *folder = THUNAR_FOLDER (data);
+  GHashTableIter  iter;
+  GList          *files = NULL;
+  gpointer        key;
+  guint           n;
+
+  folder->content_type_source_id = 0;
+
+  /* the files requested by the views go first, and one batch at a time */
+  if (folder->content_type_job != NULL || folder->content_type_batch_job != NULL)
+    return G_SOURCE_REMOVE;
+
+  g_hash_table_iter_init (&iter, folder->content_type_files);
+  for (n = 0; n < THUNAR_FOLDER_CONTENT_TYPE_BATCH && g_hash_table_iter_next (&iter, &key, NULL); n++)
+    {
+      files = g_list_prepend (files, key);
+      g_hash_table_iter_steal (&iter);
+    }
+
+  if (files == NULL)
+    return G_SOURCE_REMOVE;
+
+  folder->content_type_batch_job = thunar_io_jobs_load_content_types (files);
+  thunar_job_set_priority (folder->content_type_batch_job, THUNAR_JOB_PRIORITY_BACKGROUND);
+  g_signal_connect (folder->content_type_batch_job, "finished", G_CALLBACK (thunar_folder_content_types_finished), folder);
+  exo_job_launch (EXO_JOB (folder->content_type_batch_job));
+
+  /* the job holds its own references */
+  thunar_g_list_free_full (files);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+static void
+thunar_folder_schedule_content_types (ThunarFolder *folder,
+                                      guint         delay)
+{
+  if (folder->content_type_source_id != 0 || g_hash_table_size (folder->content_type_files) == 0)
+    return;
+
+  if (delay > 0)
+    folder->content_type_source_id = g_timeout_add_full (G_PRIORITY_LOW, delay, thunar_folder_content_types_timeout, folder, NULL);
+  else
+    folder->content_type_source_id = g_idle_add_full (G_PRIORITY_LOW, thunar_folder_content_types_timeout, folder, NULL);
+  g_source_set_name_by_id (folder->content_type_source_id, "thunar_folder_content_types_timeout");
+}
+
+
+
+static void
+thunar_folder_queue_content_types (ThunarFolder *folder,
+                                   GList        *files)
+{
+  GList *lp;
+
+  for (lp = files; lp != NULL; lp = lp->next)
+    g_hash_table_add (folder->content_type_files, g_object_ref (lp->data));
+
+  thunar_folder_schedule_content_types (folder, THUNAR_FOLDER_CONTENT_TYPE_DELAY);
 }
 
 
@@ -729,6 +1194,8 @@ thunar_folder_finished (ExoJob       *job,
   _thunar_return_if_fail (THUNAR_IS_JOB (job));
   _thunar_return_if_fail (THUNAR_IS_FILE (folder->corresponding_file));
 
+  /* the listing is queued directly, it must not count as an event storm */
+
   /* determine all added files (files on new_files, but not on files) */
   g_hash_table_iter_init (&iter, folder->loaded_files_map);
   while (g_hash_table_iter_next (&iter, &key, NULL))
@@ -736,7 +1203,8 @@ thunar_folder_finished (ExoJob       *job,
       if (g_hash_table_contains (folder->files_map, key))
         continue;
 
-      thunar_folder_add_file (folder, key);
+      if (!g_hash_table_remove (folder->removed_files_map, key))
+        g_hash_table_add (folder->added_files_map, g_object_ref (key));
     }
 
   /* this is to handle removed files after a folder reload */
@@ -748,9 +1216,12 @@ thunar_folder_finished (ExoJob       *job,
         continue;
 
       /* will mark them to be removed on next timeout */
-      thunar_folder_remove_file (folder, THUNAR_FILE (key));
+      if (!g_hash_table_remove (folder->added_files_map, key))
+        g_hash_table_add (folder->removed_files_map, g_object_ref (key));
     }
 
+  thunar_folder_schedule_update (folder);
+
   /* drop all mappings for new_files list too */
   g_hash_table_remove_all (folder->loaded_files_map);
 
@@ -784,11 +1255,90 @@ thunar_folder_finished (ExoJob       *job,
       folder->job = NULL;
     }
 
+  thunar_profile_navigation_mark (thunar_file_get_file (folder->corresponding_file),
+                                  folder->navigation_load_time, "list-directory");
+
+  /* the startup is profiled until the first folder is loaded */
+  thunar_profile_end (folder->load_begin_time, "first-folder-load");
+  thunar_profile_report ();
+
+  /* replay a recorded burst of monitor events into the loaded folder */
+  thunar_profile_monitor_replay (thunar_file_get_file (folder->corresponding_file),
+                                 thunar_folder_replay_event, g_object_ref (folder), g_object_unref);
+
   /* tell the consumers that we have loaded the directory */
   g_object_notify (G_OBJECT (folder), "loading");
 }
 
 
+
+static gboolean
+thunar_folder_snapshot_ready (ThunarJob    *job,
+                              GList        *files,
+                              ThunarFolder *folder)
+{
+  GList *lp;
+
+  _thunar_return_val_if_fail (THUNAR_IS_FOLDER (folder), FALSE);
+  _thunar_return_val_if_fail (THUNAR_IS_JOB (job), FALSE);
+
+  /* show the files right away, the listing started afterwards corrects them */
+  for (lp = files; lp != NULL; lp = lp->next)
+    if (!g_hash_table_contains (folder->files_map, lp->data))
+      g_hash_table_add (folder->added_files_map, g_object_ref (lp->data));
+
+  thunar_folder_schedule_update (folder);
+
+  thunar_g_list_free_full (files);
+
+  /* indicate that we took over ownership of the file list */
+  return TRUE;
+}
+
+
+
+static void
+thunar_folder_snapshot_finished (ExoJob       *job,
+                                 ThunarFolder *folder)
+{
+  _thunar_return_if_fail (THUNAR_IS_FOLDER (folder));
+  _thunar_return_if_fail (THUNAR_IS_JOB (job));
+
+  g_signal_handlers_disconnect_by_data (folder->snapshot_job, folder);
+  g_object_unref (folder->snapshot_job);
+  folder->snapshot_job = NULL;
+
+  thunar_profile_navigation_mark (thunar_file_get_file (folder->corresponding_file),
+                                  folder->navigation_load_time, "load-snapshot");
+  folder->navigation_load_time = thunar_profile_navigation_now (thunar_file_get_file (folder->corresponding_file));
+
+  thunar_folder_list_directory (folder);
+}
+
+
+/* The mount of a folder went away or came back */
+static void
+thunar_folder_reachability_changed (ThunarMountHealth *mount_health,
+                                    GFile             *root,
+                                    gboolean           reachable,
+                                    ThunarFolder      *folder)
+{
+  GFile *gfile;
+
+  _thunar_return_if_fail (THUNAR_IS_MOUNT_HEALTH (mount_health));
+  _thunar_return_if_fail (THUNAR_IS_FOLDER (folder));
+
+  if (!reachable)
+    return;
+
+  /* catch up on everything missed while the mount was unreachable */
+  gfile = thunar_file_get_file (folder->corresponding_file);
+  if (g_file_equal (gfile, root) || g_file_has_prefix (gfile, root))
+    thunar_folder_reload (folder, TRUE);
+}
+
+
+
 /* The file representing the folder has changed */
 static void
 thunar_folder_changed (ThunarFile        *file,
@@ -855,7 +1405,7 @@ thunar_file_infos_equal (ThunarFile *file,
   gchar     *bname;
 
   attrs = g_file_info_list_attributes (info1, NULL);
-  info2 = g_file_query_info (event_file, THUNARX_FILE_INFO_NAMESPACE,
+  info2 = g_file_query_info (event_file, THUNAR_FILE_INFO_NAMESPACE,
                              G_FILE_QUERY_INFO_NONE, NULL, NULL);
 
   if (info1 != NULL && info2 != NULL)
@@ -898,27 +1448,87 @@ thunar_file_infos_equal (ThunarFile *file,
 
 
 
-static void
-thunar_folder_monitor (GFileMonitor     *monitor,
-                       GFile            *event_file,
-                       GFile            *other_file,
-                       GFileMonitorEvent event_type,
-                       gpointer          user_data)
+static gboolean
+thunar_folder_hold_event (ThunarFolder      *folder,
+                          GFile             *event_file,
+                          GFileMonitorEvent  event_type)
 {
-  ThunarFolder *folder = THUNAR_FOLDER (user_data);
-  ThunarFile   *file = NULL;
-  ThunarFile   *event_file_thunar = NULL;
-  ThunarFile   *other_file_thunar = NULL;
-  gboolean      event_file_thunar_in_map = FALSE;
-  gboolean      other_file_thunar_in_map = FALSE;
+  ThunarFolderExpected *expected;
+  gboolean              held = FALSE;
 
-  _thunar_return_if_fail (G_IS_FILE_MONITOR (monitor));
-  _thunar_return_if_fail (THUNAR_IS_FOLDER (folder));
-  _thunar_return_if_fail (folder->monitor == monitor);
-  _thunar_return_if_fail (THUNAR_IS_FILE (folder->corresponding_file));
-  _thunar_return_if_fail (G_IS_FILE (event_file));
+  g_mutex_lock (&expected_mutex);
 
-  if (g_file_equal (event_file, thunar_file_get_file (folder->corresponding_file)))
+  expected = (expected_changes != NULL) ? g_hash_table_lookup (expected_changes, event_file) : NULL;
+  if (expected != NULL && g_get_monotonic_time () - expected->time < THUNAR_FOLDER_EXPECTED_TIMEOUT * G_USEC_PER_SEC)
+    {
+      switch (event_type)
+        {
+        case G_FILE_MONITOR_EVENT_CREATED:
+          expected->created = TRUE;
+          held = TRUE;
+          break;
+
+        case G_FILE_MONITOR_EVENT_CHANGED:
+        case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+        case G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED:
+          held = TRUE;
+          break;
+
+        case G_FILE_MONITOR_EVENT_DELETED:
+        case G_FILE_MONITOR_EVENT_MOVED_OUT:
+          /* a failed copy was removed again, nothing to update later */
+          expected->created = FALSE;
+          if (expected->folder != NULL)
+            g_object_remove_weak_pointer (G_OBJECT (expected->folder), (gpointer *) &expected->folder);
+          expected->folder = NULL;
+          break;
+
+        default:
+          break;
+        }
+
+      if (held && expected->folder == NULL)
+        {
+          expected->folder = folder;
+          g_object_add_weak_pointer (G_OBJECT (folder), (gpointer *) &expected->folder);
+        }
+    }
+
+  g_mutex_unlock (&expected_mutex);
+
+  return held;
+}
+
+
+
+static void
+thunar_folder_handle_event (ThunarFolder     *folder,
+                            GFile            *event_file,
+                            GFile            *other_file,
+                            GFileMonitorEvent event_type)
+{
+  ThunarFile   *file = NULL;
+  ThunarFile   *event_file_thunar = NULL;
+  ThunarFile   *other_file_thunar = NULL;
+  gboolean      event_file_thunar_in_map = FALSE;
+  gboolean      other_file_thunar_in_map = FALSE;
+
+  _thunar_return_if_fail (THUNAR_IS_FOLDER (folder));
+  _thunar_return_if_fail (THUNAR_IS_FILE (folder->corresponding_file));
+  _thunar_return_if_fail (G_IS_FILE (event_file));
+
+  /* a job is still writing the file, it is updated once when the job is done */
+  if (thunar_folder_hold_event (folder, event_file, event_type))
+    return;
+
+  /* keep the filename index in sync between two crawls */
+  thunar_search_index_file_changed (event_file, other_file, event_type);
+
+  /* writes in the folder change the free space of its filesystem */
+  if (event_type != G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED)
+    thunar_filesystem_cache_file_changed (thunar_file_get_file (folder->corresponding_file));
+
+  if (g_file_equal (event_file, thunar_file_get_file (folder->corresponding_file)))
     {
       /* update/destroy the corresponding file */
       if (event_type == G_FILE_MONITOR_EVENT_DELETED)
@@ -941,11 +1551,44 @@ thunar_folder_monitor (GFileMonitor     *monitor,
       file = g_hash_table_lookup (folder->files_map, other_file_thunar);
       other_file_thunar_in_map = (file != NULL) ? TRUE : FALSE;
     }
+
+  /* the files of the folder are handled below, only forward what the
+   * switch ignores for watched files which are not (yet) listed */
+  if (event_file_thunar != NULL && !event_file_thunar_in_map
+      && g_hash_table_contains (folder->routed_files, event_file_thunar))
+    {
+      switch (event_type)
+        {
+        case G_FILE_MONITOR_EVENT_CHANGED:
+        case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+        case G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED:
+        case G_FILE_MONITOR_EVENT_PRE_UNMOUNT:
+          thunar_file_watch_event (event_file_thunar, event_file, event_type);
+          break;
+
+        case G_FILE_MONITOR_EVENT_RENAMED:
+          /* a dedicated monitor (without G_FILE_MONITOR_WATCH_MOVES) reports renames as deletion */
+          if (!other_file_thunar_in_map)
+            thunar_file_watch_event (event_file_thunar, event_file, G_FILE_MONITOR_EVENT_DELETED);
+          break;
+
+        default:
+          break;
+        }
+    }
  
   switch (event_type)
     {
       case G_FILE_MONITOR_EVENT_MOVED_IN:
       case G_FILE_MONITOR_EVENT_CREATED:
+        /* don't query new files one by one while the folder is about to be reloaded */
+        if (folder->rescan_pending && !event_file_thunar_in_map)
+          {
+            if (event_type == G_FILE_MONITOR_EVENT_MOVED_IN && other_file != NULL)
+              thunar_file_move_thumbnail_cache_file (other_file, event_file);
+            break;
+          }
+
         if (event_file_thunar == NULL)
           {
             event_file_thunar = thunar_file_get (event_file, NULL);
@@ -1092,6 +1735,92 @@ thunar_folder_monitor (GFileMonitor     *monitor,
 
 
 
+static gboolean
+thunar_folder_expected_apply (gpointer user_data)
+{
+  ThunarFolderExpected *expected = user_data;
+  ThunarFolder         *folder = expected->folder;
+
+  /* a single update for all the events that were held back */
+  if (folder != NULL)
+    {
+      g_object_remove_weak_pointer (G_OBJECT (folder), (gpointer *) &expected->folder);
+      if (!folder->in_destruction && folder->corresponding_file != NULL)
+        thunar_folder_handle_event (folder, expected->file, NULL,
+                                    expected->created ? G_FILE_MONITOR_EVENT_CREATED
+                                                      : G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT);
+    }
+
+  g_object_unref (expected->file);
+  g_slice_free (ThunarFolderExpected, expected);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+static void
+thunar_folder_monitor (GFileMonitor     *monitor,
+                       GFile            *event_file,
+                       GFile            *other_file,
+                       GFileMonitorEvent event_type,
+                       gpointer          user_data)
+{
+  ThunarFolder *folder = THUNAR_FOLDER (user_data);
+
+  _thunar_return_if_fail (G_IS_FILE_MONITOR (monitor));
+  _thunar_return_if_fail (THUNAR_IS_FOLDER (folder));
+  _thunar_return_if_fail (folder->monitor == monitor);
+
+  thunar_profile_monitor_record (thunar_file_get_file (folder->corresponding_file), event_file, other_file, event_type);
+  thunar_folder_handle_event (folder, event_file, other_file, event_type);
+}
+
+
+
+static void
+thunar_folder_inotify_events (const ThunarInotifyEvent *events,
+                              guint                     n_events,
+                              gpointer                  user_data)
+{
+  ThunarFolder *folder = THUNAR_FOLDER (user_data);
+
+  _thunar_return_if_fail (THUNAR_IS_FOLDER (folder));
+
+  /* the kernel dropped events, read the folder again */
+  if (n_events == 0)
+    {
+      thunar_folder_reload (folder, FALSE);
+      return;
+    }
+
+  g_object_ref (folder);
+  for (guint n = 0; n < n_events && folder->inotify_watch != NULL; n++)
+    {
+      thunar_profile_monitor_record (thunar_file_get_file (folder->corresponding_file),
+                                     events[n].file, events[n].other_file, events[n].event_type);
+      thunar_folder_handle_event (folder, events[n].file, events[n].other_file, events[n].event_type);
+    }
+  g_object_unref (folder);
+}
+
+
+
+static void
+thunar_folder_replay_event (GFile            *file,
+                            GFile            *other_file,
+                            GFileMonitorEvent event_type,
+                            gpointer          user_data)
+{
+  ThunarFolder *folder = THUNAR_FOLDER (user_data);
+
+  /* a recorded event, see thunar_profile_monitor_replay() */
+  if (G_LIKELY (folder->corresponding_file != NULL))
+    thunar_folder_handle_event (folder, file, other_file, event_type);
+}
+
+
+
 /**
  * thunar_folder_get_for_file:
  * @file : a #ThunarFile.
@@ -1190,6 +1919,53 @@ thunar_folder_get_files (const ThunarFolder *folder)
 
 
 
+/**
+ * thunar_folder_has_file_name:
+ * @folder : a #ThunarFolder instance.
+ * @name   : a basename, as returned by g_file_get_basename().
+ *
+ * Return value: %TRUE if @folder currently contains a file named @name.
+ **/
+gboolean
+thunar_folder_has_file_name (ThunarFolder *folder,
+                             const gchar  *name)
+{
+  _thunar_return_val_if_fail (THUNAR_IS_FOLDER (folder), FALSE);
+  _thunar_return_val_if_fail (name != NULL, FALSE);
+
+  return g_hash_table_contains (folder->names_map, name);
+}
+
+
+
+/**
+ * thunar_folder_foreach_file_name:
+ * @folder    : a #ThunarFolder instance.
+ * @func      : the function to call with the basename of every file
+ *              in @folder and @user_data. It must not change @folder.
+ * @user_data : user data for @func.
+ *
+ * Calls @func for the basenames of all files currently in @folder,
+ * in no particular order.
+ **/
+void
+thunar_folder_foreach_file_name (ThunarFolder *folder,
+                                 GFunc         func,
+                                 gpointer      user_data)
+{
+  GHashTableIter iter;
+  gpointer       name;
+
+  _thunar_return_if_fail (THUNAR_IS_FOLDER (folder));
+  _thunar_return_if_fail (func != NULL);
+
+  g_hash_table_iter_init (&iter, folder->names_map);
+  while (g_hash_table_iter_next (&iter, &name, NULL))
+    (*func) (name, user_data);
+}
+
+
+
 /**
  * thunar_folder_get_loading:
  * @folder : a #ThunarFolder instance.
@@ -1203,7 +1979,81 @@ gboolean
 thunar_folder_get_loading (const ThunarFolder *folder)
 {
   _thunar_return_val_if_fail (THUNAR_IS_FOLDER (folder), FALSE);
-  return (folder->job != NULL);
+  return (folder->job != NULL || folder->snapshot_job != NULL);
+}
+
+
+
+/**
+ * thunar_folder_route_file_watch:
+ * @file : a #ThunarFile.
+ *
+ * Lets the directory monitor of the opened parent folder of @file
+ * deliver the changes of @file, instead of a monitor of its own.
+ * Local files don't need this, they already share the inotify
+ * watch of their folder, see thunar_inotify_watch_file().
+ *
+ * Only used by thunar_file_watch(), the routing ends with
+ * thunar_folder_unroute_file_watch() or, if the folder goes
+ * away first, with thunar_file_watch_unrouted().
+ *
+ * Return value: the #ThunarFolder delivering the changes (no
+ *               reference is taken), or %NULL if the parent of
+ *               @file is not opened or has no directory monitor.
+ **/
+ThunarFolder *
+thunar_folder_route_file_watch (ThunarFile *file)
+{
+  ThunarFolder *folder = NULL;
+  ThunarFile   *parent_file;
+  GFile        *parent;
+
+  _thunar_return_val_if_fail (THUNAR_IS_FILE (file), NULL);
+
+  /* no folder opened yet */
+  if (thunar_folder_quark == 0)
+    return NULL;
+
+  parent = g_file_get_parent (thunar_file_get_file (file));
+  if (G_UNLIKELY (parent == NULL))
+    return NULL;
+
+  /* only look up, opening the folder would cost more than the monitor */
+  parent_file = thunar_file_cache_lookup (parent);
+  g_object_unref (parent);
+  if (parent_file == NULL)
+    return NULL;
+
+  folder = g_object_get_qdata (G_OBJECT (parent_file), thunar_folder_quark);
+  g_object_unref (parent_file);
+
+  if (folder == NULL || folder->monitor == NULL || folder->routed_files == NULL)
+    return NULL;
+
+  g_hash_table_add (folder->routed_files, file);
+
+  return folder;
+}
+
+
+
+/**
+ * thunar_folder_unroute_file_watch:
+ * @folder : a #ThunarFolder instance.
+ * @file   : a #ThunarFile routed through @folder.
+ *
+ * Stops delivering the changes of @file, see
+ * thunar_folder_route_file_watch().
+ **/
+void
+thunar_folder_unroute_file_watch (ThunarFolder *folder,
+                                  ThunarFile   *file)
+{
+  _thunar_return_if_fail (THUNAR_IS_FOLDER (folder));
+  _thunar_return_if_fail (THUNAR_IS_FILE (file));
+
+  if (G_LIKELY (folder->routed_files != NULL))
+    g_hash_table_remove (folder->routed_files, file);
 }
 
 
@@ -1220,7 +2070,49 @@ gboolean
 thunar_folder_has_folder_monitor (const ThunarFolder *folder)
 {
   _thunar_return_val_if_fail (THUNAR_IS_FOLDER (folder), FALSE);
-  return (folder->monitor != NULL);
+  return (folder->monitor != NULL || folder->inotify_watch != NULL);
+}
+
+
+
+/**
+ * thunar_folder_get_counts:
+ * @n_folders   : return location for the number of folders alive, or %NULL.
+ * @n_monitored : return location for the number of them with a folder
+ *                monitor, or %NULL.
+ *
+ * Counts the #ThunarFolder<!---->s currently alive.
+ **/
+void
+thunar_folder_get_counts (guint *n_folders,
+                          guint *n_monitored)
+{
+  if (n_folders != NULL)
+    *n_folders = folder_n_alive;
+  if (n_monitored != NULL)
+    *n_monitored = folder_n_monitored;
+}
+
+
+
+static void
+thunar_folder_list_directory (ThunarFolder *folder)
+{
+  /* keep showing the files known so far, the snapshot among them, until the mount
+   * is back, see thunar_folder_reachability_changed() */
+  if (!thunar_mount_health_is_reachable (thunar_file_get_file (folder->corresponding_file)))
+    {
+      folder->save_snapshot = FALSE;
+      g_object_notify (G_OBJECT (folder), "loading");
+      return;
+    }
+
+  /* start a new job */
+  folder->job = thunar_io_jobs_list_directory (thunar_file_get_file (folder->corresponding_file));
+  exo_job_launch (EXO_JOB (folder->job));
+  g_signal_connect (folder->job, "error", G_CALLBACK (thunar_folder_error), folder);
+  g_signal_connect (folder->job, "finished", G_CALLBACK (thunar_folder_finished), folder);
+  g_signal_connect (folder->job, "files-ready", G_CALLBACK (thunar_folder_files_ready), folder);
 }
 
 
@@ -1237,6 +2129,8 @@ void
 thunar_folder_reload (ThunarFolder *folder,
                       gboolean      reload_info)
 {
+  GFile *gfile;
+
   _thunar_return_if_fail (THUNAR_IS_FOLDER (folder));
 
   /* reload file info too? */
@@ -1245,6 +2139,7 @@ thunar_folder_reload (ThunarFolder *folder,
   /* stop content type loading */
   if (G_UNLIKELY (folder->content_type_job != NULL))
     {
+      g_signal_handlers_disconnect_by_data (folder->content_type_job, folder);
       exo_job_cancel (EXO_JOB (folder->content_type_job));
       g_object_unref (folder->content_type_job);
       folder->content_type_job = NULL;
@@ -1259,15 +2154,35 @@ thunar_folder_reload (ThunarFolder *folder,
       folder->job = NULL;
     }
 
+  if (G_UNLIKELY (folder->snapshot_job != NULL))
+    {
+      g_signal_handlers_disconnect_by_data (folder->snapshot_job, folder);
+      exo_job_cancel (EXO_JOB (folder->snapshot_job));
+      g_object_unref (folder->snapshot_job);
+      folder->snapshot_job = NULL;
+    }
+
   /* reset the loaded_files_map hash table */
   g_hash_table_remove_all (folder->loaded_files_map);
 
-  /* start a new job */
-  folder->job = thunar_io_jobs_list_directory (thunar_file_get_file (folder->corresponding_file));
-  exo_job_launch (EXO_JOB (folder->job));
-  g_signal_connect (folder->job, "error", G_CALLBACK (thunar_folder_error), folder);
-  g_signal_connect (folder->job, "finished", G_CALLBACK (thunar_folder_finished), folder);
-  g_signal_connect (folder->job, "files-ready", G_CALLBACK (thunar_folder_files_ready), folder);
+  gfile = thunar_file_get_file (folder->corresponding_file);
+  folder->save_snapshot = thunar_folder_snapshot_supported (gfile);
+
+  folder->load_begin_time = thunar_profile_begin ();
+  folder->navigation_load_time = thunar_profile_navigation_now (gfile);
+
+  /* show the files from the last visit of an empty folder until it is listed */
+  if (folder->save_snapshot && g_hash_table_size (folder->files_map) == 0)
+    {
+      folder->snapshot_job = thunar_io_jobs_load_folder_snapshot (gfile);
+      g_signal_connect (folder->snapshot_job, "finished", G_CALLBACK (thunar_folder_snapshot_finished), folder);
+      g_signal_connect (folder->snapshot_job, "files-ready", G_CALLBACK (thunar_folder_snapshot_ready), folder);
+      exo_job_launch (EXO_JOB (folder->snapshot_job));
+    }
+  else
+    {
+      thunar_folder_list_directory (folder);
+    }
 
   /* tell all consumers that we're loading */
   g_object_notify (G_OBJECT (folder), "loading");
@@ -1275,6 +2190,57 @@ thunar_folder_reload (ThunarFolder *folder,
 
 
 
+/**
+ * thunar_folder_load_content_types:
+ * @folder : a #ThunarFolder instance.
+ * @files  : a #GList of #ThunarFile's for which the content type is needed now.
+ *
+ * Starts a job to load the content type of @files, ahead of the other files
+ * in @folder. A job started by a previous call is cancelled, so views pass
+ * the files they currently show.
+ **/
+void
+thunar_folder_load_content_types (ThunarFolder *folder,
+                                  GList        *files)
+{
+  GList *lp;
+  GList *pending = NULL;
+
+  _thunar_return_if_fail (THUNAR_IS_FOLDER (folder));
+
+  /* check if we are currently connect to a job */
+  if (G_UNLIKELY (folder->content_type_job != NULL))
+    {
+      g_signal_handlers_disconnect_by_data (folder->content_type_job, folder);
+      exo_job_cancel (EXO_JOB (folder->content_type_job));
+      g_object_unref (folder->content_type_job);
+      folder->content_type_job = NULL;
+    }
+
+  /* only the files of this folder which still miss their content type. They stay
+   * queued in case the job gets cancelled, the batches skip them once loaded. The
+   * batches leave the ambiguous names of remote folders to the views, with the
+   * type guessed from the name until then */
+  for (lp = files; lp != NULL; lp = lp->next)
+    if (g_hash_table_contains (folder->content_type_files, lp->data)
+        || !thunar_file_has_content_type (lp->data))
+      pending = g_list_prepend (pending, lp->data);
+
+  if (pending == NULL)
+    return;
+
+  /* start a new content_type_job */
+  folder->navigation_content_type_time = thunar_profile_navigation_now (thunar_file_get_file (folder->corresponding_file));
+  folder->content_type_job = thunar_io_jobs_load_content_types (pending);
+  thunar_job_set_priority (folder->content_type_job, THUNAR_JOB_PRIORITY_VISIBLE);
+  g_signal_connect (folder->content_type_job, "finished", G_CALLBACK (thunar_folder_content_types_finished), folder);
+  exo_job_launch (EXO_JOB (folder->content_type_job));
+
+  g_list_free (pending);
+}
+
+
+
 static gboolean
 _thunar_folder_thumbnail_updated_timeout (gpointer data)
 {
@@ -1303,5 +2269,78 @@ thunar_folder_thumbnail_updated (ThunarFolder        *folder,
     g_list_prepend (folder->thumbnail_updated_files, g_object_ref (file));
 
   if (folder->thumbnail_updated_timeout_source_id == 0)
-    folder->thumbnail_updated_timeout_source_id = g_timeout_add (THUNAR_FOLDER_UPDATE_TIMEOUT, (GSourceFunc) _thunar_folder_thumbnail_updated_timeout, folder);
-}
\ No newline at end of file
+    {
+      folder->thumbnail_updated_timeout_source_id = g_timeout_add (THUNAR_FOLDER_UPDATE_TIMEOUT, (GSourceFunc) _thunar_folder_thumbnail_updated_timeout, folder);
+      g_source_set_name_by_id (folder->thumbnail_updated_timeout_source_id, "_thunar_folder_thumbnail_updated_timeout");
+    }
+}
+
+
+
+/**
+ * thunar_folder_expect_changes:
+ * @file : the #GFile a job is about to create or write.
+ *
+ * Tells the folders that a job of Thunar is writing @file. The monitor
+ * events of @file are held back until the job calls
+ * thunar_folder_expect_changes_done(), which then updates the folder
+ * of @file once, instead of reloading the file for every write, every
+ * change of its permissions and of its times. May be called from any
+ * thread.
+ **/
+void
+thunar_folder_expect_changes (GFile *file)
+{
+  ThunarFolderExpected *expected;
+
+  _thunar_return_if_fail (G_IS_FILE (file));
+
+  g_mutex_lock (&expected_mutex);
+
+  if (G_UNLIKELY (expected_changes == NULL))
+    expected_changes = g_hash_table_new (g_file_hash, (GEqualFunc) g_file_equal);
+
+  expected = g_hash_table_lookup (expected_changes, file);
+  if (expected == NULL)
+    {
+      expected = g_slice_new0 (ThunarFolderExpected);
+      expected->file = g_object_ref (file);
+      expected->time = g_get_monotonic_time ();
+      g_hash_table_insert (expected_changes, expected->file, expected);
+    }
+  expected->n_jobs++;
+
+  g_mutex_unlock (&expected_mutex);
+}
+
+
+
+/**
+ * thunar_folder_expect_changes_done:
+ * @file : a #GFile passed to thunar_folder_expect_changes() before.
+ *
+ * Tells the folders that the job is done with @file, so the events that
+ * were held back are applied in the main loop. May be called from any
+ * thread.
+ **/
+void
+thunar_folder_expect_changes_done (GFile *file)
+{
+  ThunarFolderExpected *expected;
+
+  _thunar_return_if_fail (G_IS_FILE (file));
+
+  g_mutex_lock (&expected_mutex);
+
+  expected = (expected_changes != NULL) ? g_hash_table_lookup (expected_changes, file) : NULL;
+  if (expected != NULL && --expected->n_jobs == 0)
+    g_hash_table_remove (expected_changes, file);
+  else
+    expected = NULL;
+
+  g_mutex_unlock (&expected_mutex);
+
+  /* the weak pointer on the folder is only used in the main thread */
+  if (expected != NULL)
+    g_main_context_invoke (NULL, thunar_folder_expected_apply, expected);
+}
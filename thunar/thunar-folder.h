@@ -40,12 +40,29 @@ ThunarFolder *thunar_folder_get_for_file           (ThunarFile         *file);
 
 ThunarFile   *thunar_folder_get_corresponding_file (const ThunarFolder *folder);
 GList        *thunar_folder_get_files              (const ThunarFolder *folder);
+gboolean      thunar_folder_has_file_name          (ThunarFolder       *folder,
+                                                    const gchar        *name);
+void          thunar_folder_foreach_file_name      (ThunarFolder       *folder,
+                                                    GFunc               func,
+                                                    gpointer            user_data);
 gboolean      thunar_folder_get_loading            (const ThunarFolder *folder);
 gboolean      thunar_folder_has_folder_monitor     (const ThunarFolder *folder);
+void          thunar_folder_get_counts             (guint              *n_folders,
+                                                    guint              *n_monitored);
+
+ThunarFolder *thunar_folder_route_file_watch       (ThunarFile         *file);
+void          thunar_folder_unroute_file_watch     (ThunarFolder       *folder,
+                                                    ThunarFile         *file);
 
 void          thunar_folder_reload                 (ThunarFolder       *folder,
                                                     gboolean            reload_info);
 
+void          thunar_folder_load_content_types     (ThunarFolder       *folder,
+                                                    GList              *files);
+
+void          thunar_folder_expect_changes         (GFile              *file);
+void          thunar_folder_expect_changes_done    (GFile              *file);
+
 G_END_DECLS;
 
 #endif /* !__THUNAR_FOLDER_H__ */
@@ -0,0 +1,363 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The frecency store remembers how often and how recently the folders
+ * were visited, across sessions. Every visit counts for the location,
+ * weighted by the age of the last visit, so folders used daily rank
+ * above folders that were used often long ago. The store is kept in a
+ * small text file in the cache directory of the user, one location per
+ * line, and is only used from the main thread. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <libxfce4util/libxfce4util.h>
+
+#include "thunar/thunar-frecency.h"
+#include "thunar/thunar-private.h"
+
+
+
+/* the file of the store in the cache directory */
+#define THUNAR_FRECENCY_PATH "Thunar/frecency"
+
+/* the store forgets the least used locations beyond this number */
+#define THUNAR_FRECENCY_MAX_LOCATIONS (500)
+
+/* the delay between a visit and the next write of the store, in seconds */
+#define THUNAR_FRECENCY_SAVE_DELAY (10)
+
+/* visits beyond this number don't raise the score further */
+#define THUNAR_FRECENCY_MAX_VISITS (10000)
+
+
+
+typedef struct
+{
+  GFile  *location;
+  guint   n_visits;
+  gint64  last_visit; /* in seconds since the epoch */
+}
+ThunarFrecencyEntry;
+
+
+
+/* location GFile -> ThunarFrecencyEntry */
+static GHashTable *frecency_entries = NULL;
+static guint       frecency_save_id = 0;
+
+
+
+static void
+thunar_frecency_entry_free (gpointer data)
+{
+  ThunarFrecencyEntry *entry = data;
+
+  g_object_unref (entry->location);
+  g_slice_free (ThunarFrecencyEntry, entry);
+}
+
+
+
+static guint
+thunar_frecency_entry_score (const ThunarFrecencyEntry *entry,
+                             gint64                     now)
+{
+  gint64 age;
+  guint  weight;
+
+  /* the age of the last visit in days, weighted by the same
+   * buckets the address bar of Firefox uses for its frecency */
+  age = (now - entry->last_visit) / (24 * 60 * 60);
+  if (age < 4)
+    weight = 100;
+  else if (age < 14)
+    weight = 70;
+  else if (age < 31)
+    weight = 50;
+  else if (age < 90)
+    weight = 30;
+  else
+    weight = 10;
+
+  return entry->n_visits * weight;
+}
+
+
+
+static gint
+thunar_frecency_entry_compare (gconstpointer a,
+                               gconstpointer b,
+                               gpointer      user_data)
+{
+  const ThunarFrecencyEntry *entry_a = *(ThunarFrecencyEntry *const *) a;
+  const ThunarFrecencyEntry *entry_b = *(ThunarFrecencyEntry *const *) b;
+  gint64                     now = *(const gint64 *) user_data;
+  guint                      score_a = thunar_frecency_entry_score (entry_a, now);
+  guint                      score_b = thunar_frecency_entry_score (entry_b, now);
+
+  /* highest score first, the more recent visit on a tie */
+  if (score_a != score_b)
+    return (score_a > score_b) ? -1 : 1;
+  if (entry_a->last_visit != entry_b->last_visit)
+    return (entry_a->last_visit > entry_b->last_visit) ? -1 : 1;
+  return 0;
+}
+
+
+
+static void
+thunar_frecency_load (void)
+{
+  ThunarFrecencyEntry *entry;
+  gchar              **fields;
+  gchar              **lines;
+  gchar               *contents;
+  gchar               *path;
+  guint                n;
+
+  if (G_LIKELY (frecency_entries != NULL))
+    return;
+
+  frecency_entries = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal, NULL, thunar_frecency_entry_free);
+
+  path = xfce_resource_lookup (XFCE_RESOURCE_CACHE, THUNAR_FRECENCY_PATH);
+  if (path == NULL)
+    return;
+
+  if (g_file_get_contents (path, &contents, NULL, NULL))
+    {
+      /* every line is "<visits> <last visit> <uri>", the uri contains no spaces */
+      lines = g_strsplit (contents, "\n", -1);
+      for (n = 0; lines[n] != NULL; ++n)
+        {
+          fields = g_strsplit (lines[n], " ", 3);
+          if (g_strv_length (fields) == 3 && *fields[2] != '\0')
+            {
+              entry = g_slice_new (ThunarFrecencyEntry);
+              entry->n_visits = MIN (g_ascii_strtoull (fields[0], NULL, 10), THUNAR_FRECENCY_MAX_VISITS);
+              entry->last_visit = g_ascii_strtoll (fields[1], NULL, 10);
+              entry->location = g_file_new_for_uri (fields[2]);
+              g_hash_table_replace (frecency_entries, entry->location, entry);
+            }
+          g_strfreev (fields);
+        }
+      g_strfreev (lines);
+      g_free (contents);
+    }
+
+  g_free (path);
+}
+
+
+
+static void
+thunar_frecency_save (void)
+{
+  ThunarFrecencyEntry *entry;
+  GHashTableIter       iter;
+  GString             *contents;
+  GError              *error = NULL;
+  gchar               *path;
+  gchar               *uri;
+
+  path = xfce_resource_save_location (XFCE_RESOURCE_CACHE, THUNAR_FRECENCY_PATH, TRUE);
+  if (G_UNLIKELY (path == NULL))
+    return;
+
+  contents = g_string_sized_new (64 * g_hash_table_size (frecency_entries));
+
+  g_hash_table_iter_init (&iter, frecency_entries);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry))
+    {
+      uri = g_file_get_uri (entry->location);
+      g_string_append_printf (contents, "%u %" G_GINT64_FORMAT " %s\n", entry->n_visits, entry->last_visit, uri);
+      g_free (uri);
+    }
+
+  if (!g_file_set_contents (path, contents->str, contents->len, &error))
+    {
+      g_warning ("Failed to write the folder frecency to \"%s\": %s", path, error->message);
+      g_error_free (error);
+    }
+
+  g_string_free (contents, TRUE);
+  g_free (path);
+}
+
+
+
+static gboolean
+thunar_frecency_save_timeout (gpointer user_data)
+{
+  frecency_save_id = 0;
+
+  thunar_frecency_save ();
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+static GPtrArray *
+thunar_frecency_sorted_entries (GFile *parent)
+{
+  ThunarFrecencyEntry *entry;
+  GHashTableIter       iter;
+  GPtrArray           *entries;
+  gint64               now = g_get_real_time () / G_USEC_PER_SEC;
+
+  thunar_frecency_load ();
+
+  entries = g_ptr_array_sized_new (g_hash_table_size (frecency_entries));
+
+  g_hash_table_iter_init (&iter, frecency_entries);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry))
+    if (parent == NULL || g_file_has_parent (entry->location, parent))
+      g_ptr_array_add (entries, entry);
+
+  g_ptr_array_sort_with_data (entries, thunar_frecency_entry_compare, &now);
+
+  return entries;
+}
+
+
+
+static void
+thunar_frecency_prune (void)
+{
+  GPtrArray *entries;
+  guint      n;
+
+  /* drop the least used tenth of the locations at once */
+  entries = thunar_frecency_sorted_entries (NULL);
+  for (n = THUNAR_FRECENCY_MAX_LOCATIONS * 9 / 10; n < entries->len; ++n)
+    g_hash_table_remove (frecency_entries, ((ThunarFrecencyEntry *) g_ptr_array_index (entries, n))->location);
+  g_ptr_array_free (entries, TRUE);
+}
+
+
+
+/**
+ * thunar_frecency_add_visit:
+ * @location : the #GFile of a folder.
+ *
+ * Records a visit of @location. The store is written to disk a
+ * few seconds later, so a series of visits causes a single write.
+ **/
+void
+thunar_frecency_add_visit (GFile *location)
+{
+  ThunarFrecencyEntry *entry;
+
+  _thunar_return_if_fail (G_IS_FILE (location));
+
+  thunar_frecency_load ();
+
+  entry = g_hash_table_lookup (frecency_entries, location);
+  if (entry == NULL)
+    {
+      entry = g_slice_new0 (ThunarFrecencyEntry);
+      entry->location = g_object_ref (location);
+      g_hash_table_insert (frecency_entries, entry->location, entry);
+    }
+
+  entry->n_visits = MIN (entry->n_visits + 1, THUNAR_FRECENCY_MAX_VISITS);
+  entry->last_visit = g_get_real_time () / G_USEC_PER_SEC;
+
+  if (G_UNLIKELY (g_hash_table_size (frecency_entries) > THUNAR_FRECENCY_MAX_LOCATIONS))
+    thunar_frecency_prune ();
+
+  if (frecency_save_id == 0)
+    frecency_save_id = g_timeout_add_seconds (THUNAR_FRECENCY_SAVE_DELAY, thunar_frecency_save_timeout, NULL);
+}
+
+
+
+/**
+ * thunar_frecency_get_top:
+ * @n_locations : the maximum number of locations to return.
+ *
+ * Returns the @n_locations most frecent locations, the most frecent
+ * one first. The caller is responsible to free the returned list
+ * using thunar_g_list_free_full() when no longer needed.
+ *
+ * Return value: (transfer full) (element-type GFile): the list of locations.
+ **/
+GList *
+thunar_frecency_get_top (guint n_locations)
+{
+  GPtrArray *entries;
+  GList     *locations = NULL;
+  guint      n;
+
+  entries = thunar_frecency_sorted_entries (NULL);
+  for (n = MIN (n_locations, entries->len); n > 0; --n)
+    locations = g_list_prepend (locations, g_object_ref (((ThunarFrecencyEntry *) g_ptr_array_index (entries, n - 1))->location));
+  g_ptr_array_free (entries, TRUE);
+
+  return locations;
+}
+
+
+
+/**
+ * thunar_frecency_get_children:
+ * @parent : the #GFile of a folder.
+ *
+ * Returns the visited locations directly inside @parent, the most
+ * frecent one first. The caller is responsible to free the returned
+ * list using thunar_g_list_free_full() when no longer needed.
+ *
+ * Return value: (transfer full) (element-type GFile): the list of locations.
+ **/
+GList *
+thunar_frecency_get_children (GFile *parent)
+{
+  GPtrArray *entries;
+  GList     *locations = NULL;
+  guint      n;
+
+  _thunar_return_val_if_fail (G_IS_FILE (parent), NULL);
+
+  entries = thunar_frecency_sorted_entries (parent);
+  for (n = entries->len; n > 0; --n)
+    locations = g_list_prepend (locations, g_object_ref (((ThunarFrecencyEntry *) g_ptr_array_index (entries, n - 1))->location));
+  g_ptr_array_free (entries, TRUE);
+
+  return locations;
+}
+
+
+
+/**
+ * thunar_frecency_flush:
+ *
+ * Writes the pending visits to disk right away. Called before the
+ * application quits, so the last visits are not lost.
+ **/
+void
+thunar_frecency_flush (void)
+{
+  if (frecency_save_id != 0)
+    {
+      g_source_remove (frecency_save_id);
+      frecency_save_id = 0;
+
+      thunar_frecency_save ();
+    }
+}
@@ -39,10 +39,45 @@
 
 
 
+/* maximum number of surfaces kept per pixbuf */
+#define THUNAR_GDK_MAX_SURFACES (3)
+
+
+
+typedef struct
+{
+  gint             width;
+  gint             height;
+  gint             scale_factor;
+  cairo_surface_t *surface;
+}
+ThunarGdkSurface;
+
+
+
 static const cairo_user_data_key_t cairo_key;
 
 
 
+static void
+thunar_gdk_surface_free (gpointer data)
+{
+  ThunarGdkSurface *entry = data;
+
+  cairo_surface_destroy (entry->surface);
+  g_slice_free (ThunarGdkSurface, entry);
+}
+
+
+
+static void
+thunar_gdk_surface_list_free (gpointer data)
+{
+  g_slist_free_full (data, thunar_gdk_surface_free);
+}
+
+
+
 static cairo_surface_t *
 thunar_gdk_cairo_create_surface (const GdkPixbuf *pixbuf,
                                  gint             scale_factor)
@@ -225,6 +260,94 @@ thunar_gdk_screen_open (const gchar *display_name,
 
 
 
+/**
+ * thunar_gdk_pixbuf_get_surface:
+ * @pixbuf       : a #GdkPixbuf.
+ * @max_width    : maximum width of the surface in device pixels.
+ * @max_height   : maximum height of the surface in device pixels.
+ * @scale_factor : UI scaling factor.
+ *
+ * Returns a surface for @pixbuf, scaled down to fit into @max_width and
+ * @max_height if needed. The surfaces are cached on the pixbuf, so since
+ * Thunar shares the pixbufs between all windows using the icon cache,
+ * redrawing an icon does not convert or scale anything after the first
+ * time, no matter how many views show it.
+ *
+ * The returned surface is owned by @pixbuf and must not be freed.
+ *
+ * Return value: the #cairo_surface_t for @pixbuf.
+ **/
+cairo_surface_t*
+thunar_gdk_pixbuf_get_surface (GdkPixbuf *pixbuf,
+                               gint       max_width,
+                               gint       max_height,
+                               gint       scale_factor)
+{
+  ThunarGdkSurface *entry;
+  GdkPixbuf        *scaled;
+  GSList           *surfaces;
+  GSList           *lp;
+  gdouble           ratio;
+  gint              width;
+  gint              height;
+  static GQuark     surface_quark = 0;
+
+  _thunar_return_val_if_fail (GDK_IS_PIXBUF (pixbuf), NULL);
+
+  if (G_UNLIKELY (surface_quark == 0))
+    surface_quark = g_quark_from_static_string ("thunar-gdk-surface");
+
+  /* determine the size of the surface, like exo_gdk_pixbuf_scale_down() */
+  width = gdk_pixbuf_get_width (pixbuf);
+  height = gdk_pixbuf_get_height (pixbuf);
+  if (G_UNLIKELY (width > max_width || height > max_height))
+    {
+      ratio = MAX ((gdouble) width / MAX (1, max_width), (gdouble) height / MAX (1, max_height));
+      width = MAX (1, width / ratio);
+      height = MAX (1, height / ratio);
+    }
+
+  /* peek if there is already a surface for this size and scale */
+  surfaces = g_object_get_qdata (G_OBJECT (pixbuf), surface_quark);
+  for (lp = surfaces; lp != NULL; lp = lp->next)
+    {
+      entry = lp->data;
+      if (entry->width == width && entry->height == height && entry->scale_factor == scale_factor)
+        return entry->surface;
+    }
+
+  /* create a new surface */
+  entry = g_slice_new (ThunarGdkSurface);
+  entry->width = width;
+  entry->height = height;
+  entry->scale_factor = scale_factor;
+  if (width != gdk_pixbuf_get_width (pixbuf) || height != gdk_pixbuf_get_height (pixbuf))
+    {
+      scaled = gdk_pixbuf_scale_simple (pixbuf, width, height, GDK_INTERP_BILINEAR);
+      entry->surface = thunar_gdk_cairo_create_surface (scaled, scale_factor);
+      g_object_unref (scaled);
+    }
+  else
+    {
+      entry->surface = thunar_gdk_cairo_create_surface (pixbuf, scale_factor);
+    }
+
+  /* store the surface on the pixbuf, dropping the oldest ones */
+  g_object_steal_qdata (G_OBJECT (pixbuf), surface_quark);
+  surfaces = g_slist_prepend (surfaces, entry);
+  lp = g_slist_nth (surfaces, THUNAR_GDK_MAX_SURFACES - 1);
+  if (lp != NULL && lp->next != NULL)
+    {
+      g_slist_free_full (lp->next, thunar_gdk_surface_free);
+      lp->next = NULL;
+    }
+  g_object_set_qdata_full (G_OBJECT (pixbuf), surface_quark, surfaces, thunar_gdk_surface_list_free);
+
+  return entry->surface;
+}
+
+
+
 /**
  * thunar_gdk_cairo_set_source_pixbuf:
  * cr           : a Cairo context
@@ -235,7 +358,7 @@ thunar_gdk_screen_open (const gchar *display_name,
  *
  * Works like gdk_cairo_set_source_pixbuf but we try to cache the surface
  * on the pixbuf, which is efficient within Thunar because we also share
- * the pixbufs using the icon cache.
+ * the pixbufs using the icon cache. See thunar_gdk_pixbuf_get_surface().
  **/
 void
 thunar_gdk_cairo_set_source_pixbuf (cairo_t   *cr,
@@ -245,22 +368,8 @@ thunar_gdk_cairo_set_source_pixbuf (cairo_t   *cr,
                                     gint       scale_factor)
 {
   cairo_surface_t *surface;
-  static GQuark    surface_quark = 0;
-
-  if (G_UNLIKELY (surface_quark == 0))
-    surface_quark = g_quark_from_static_string ("thunar-gdk-surface");
 
-  /* peek if there is already a surface */
-  surface = g_object_get_qdata (G_OBJECT (pixbuf), surface_quark);
-  if (surface == NULL)
-    {
-      /* create a new surface */
-      surface = thunar_gdk_cairo_create_surface (pixbuf, scale_factor);
-
-      /* store the pixbuf on the pixbuf */
-      g_object_set_qdata_full (G_OBJECT (pixbuf), surface_quark,
-                               surface, (GDestroyNotify) cairo_surface_destroy);
-    }
+  surface = thunar_gdk_pixbuf_get_surface (pixbuf, G_MAXINT, G_MAXINT, scale_factor);
 
   /* apply */
   cairo_set_source_surface (cr, surface, pixbuf_x, pixbuf_y);
@@ -25,14 +25,19 @@
 
 G_BEGIN_DECLS;
 
-GdkScreen *thunar_gdk_screen_open             (const gchar *display_name,
-                                               GError     **error);
-
-void       thunar_gdk_cairo_set_source_pixbuf (cairo_t     *cr,
-                                               GdkPixbuf   *pixbuf,
-                                               gdouble      pixbuf_x,
-                                               gdouble      pixbuf_y,
-                                               gint         scale_factor);
+GdkScreen       *thunar_gdk_screen_open             (const gchar *display_name,
+                                                     GError     **error);
+
+cairo_surface_t *thunar_gdk_pixbuf_get_surface      (GdkPixbuf   *pixbuf,
+                                                     gint         max_width,
+                                                     gint         max_height,
+                                                     gint         scale_factor);
+
+void             thunar_gdk_cairo_set_source_pixbuf (cairo_t     *cr,
+                                                     GdkPixbuf   *pixbuf,
+                                                     gdouble      pixbuf_x,
+                                                     gdouble      pixbuf_y,
+                                                     gint         scale_factor);
 
 G_END_DECLS;
 
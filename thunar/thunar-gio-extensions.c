@@ -22,17 +22,44 @@
 #include "config.h"
 #endif
 
+#ifdef HAVE_ERRNO_H
+#include <errno.h>
+#endif
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef HAVE_LINUX_FS_H
+#include <linux/fs.h>
+#endif
+#ifdef HAVE_SYS_IOCTL_H
+#include <sys/ioctl.h>
+#endif
+#ifdef HAVE_SYS_SENDFILE_H
+#include <sys/sendfile.h>
+#endif
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
 #include <gio/gio.h>
+#include <glib/gstdio.h>
 
 #ifdef HAVE_GIO_UNIX
 #include <gio/gunixmounts.h>
 #include <gio/gdesktopappinfo.h>
+#include <gio/gfiledescriptorbased.h>
 #endif
 
 #include <libxfce4util/libxfce4util.h>
 
+#include "thunar/thunar-app-index.h"
 #include "thunar/thunar-file.h"
+#include "thunar/thunar-filesystem-cache.h"
 #include "thunar/thunar-gio-extensions.h"
+#include "thunar/thunar-mount-table.h"
 #include "thunar/thunar-preferences.h"
 #include "thunar/thunar-private.h"
 #include "thunar/thunar-util.h"
@@ -74,6 +101,20 @@ device_icon_name [] =
 
 
 
+/* Delay before the buffered asynchronous metadata writes are flushed, in milliseconds */
+#define THUNAR_METADATA_FLUSH_DELAY (500)
+
+
+
+/* the write-behind buffer of the asynchronous metadata writes, with one
+ * #GFileInfo of pending attributes per file. Writes from jobs drop the
+ * attributes they make obsolete, hence the lock */
+G_LOCK_DEFINE_STATIC (metadata_pending);
+static GHashTable *metadata_pending = NULL;
+static guint       metadata_flush_id = 0;
+
+
+
 static const gchar     *guess_device_type_from_icon_name           (const gchar *icon_name);
 static       GFileInfo *thunar_g_file_get_content_type_querry_info (GFile       *gfile,
                                                                     GError      *err);
@@ -430,6 +471,10 @@ thunar_g_file_guess_device_type (GFile *file)
 
   _thunar_return_val_if_fail (G_IS_FILE (file), NULL);
 
+  /* the icon of a mountable only changes with the devices */
+  if (thunar_mount_table_lookup_device_type (file, &device_type))
+    return device_type;
+
   fileinfo = g_file_query_info (file,
                                 G_FILE_ATTRIBUTE_STANDARD_ICON,
                                 G_FILE_QUERY_INFO_NONE, NULL, NULL);
@@ -437,16 +482,15 @@ thunar_g_file_guess_device_type (GFile *file)
     return NULL;
 
   icon = G_ICON (g_file_info_get_attribute_object (fileinfo, G_FILE_ATTRIBUTE_STANDARD_ICON));
-  if (!G_IS_THEMED_ICON (icon))
+  if (G_IS_THEMED_ICON (icon))
     {
-      g_object_unref (fileinfo);
-      return NULL;
+      icon_name = g_themed_icon_get_names (G_THEMED_ICON (icon))[0];
+      device_type = guess_device_type_from_icon_name (icon_name);
     }
-
-  icon_name = g_themed_icon_get_names (G_THEMED_ICON (icon))[0];
-  device_type = guess_device_type_from_icon_name (icon_name);
   g_object_unref (fileinfo);
 
+  thunar_mount_table_remember_device_type (file, device_type);
+
   return device_type;
 }
 
@@ -603,6 +647,11 @@ thunar_g_vfs_is_uri_scheme_supported (const gchar *scheme)
  * free space was determined successfully and placed into
  * @free_space_return, else %FALSE will be returned.
  *
+ * The value comes from the #ThunarFilesystemCache, so this never
+ * blocks; %FALSE is returned until the first query of the volume
+ * finished, connect to the "changed" signal of the cache to pick
+ * up new values.
+ *
  * Return value: %TRUE if successfull, else %FALSE.
  **/
 gboolean
@@ -610,33 +659,9 @@ thunar_g_file_get_free_space (GFile   *file,
                               guint64 *fs_free_return,
                               guint64 *fs_size_return)
 {
-  GFileInfo *filesystem_info;
-  gboolean   success = FALSE;
-
   _thunar_return_val_if_fail (G_IS_FILE (file), FALSE);
 
-  filesystem_info = g_file_query_filesystem_info (file,
-                                                  THUNARX_FILESYSTEM_INFO_NAMESPACE,
-                                                  NULL, NULL);
-
-  if (filesystem_info != NULL)
-    {
-      if (fs_free_return != NULL)
-        {
-          *fs_free_return = g_file_info_get_attribute_uint64 (filesystem_info, G_FILE_ATTRIBUTE_FILESYSTEM_FREE);
-          success = g_file_info_has_attribute (filesystem_info, G_FILE_ATTRIBUTE_FILESYSTEM_FREE);
-        }
-
-      if (fs_size_return != NULL)
-        {
-          *fs_size_return = g_file_info_get_attribute_uint64 (filesystem_info, G_FILE_ATTRIBUTE_FILESYSTEM_SIZE);
-          success = g_file_info_has_attribute (filesystem_info, G_FILE_ATTRIBUTE_FILESYSTEM_SIZE);
-        }
-
-      g_object_unref (filesystem_info);
-    }
-
-  return success;
+  return thunar_filesystem_cache_lookup (file, fs_free_return, fs_size_return);
 }
 
 
@@ -687,39 +712,733 @@ thunar_g_file_list_get_type (void)
 
 
 
-/**
- * thunar_g_file_copy:
- * @source                 : input #GFile
- * @destination            : destination #GFile
- * @flags                  : set of #GFileCopyFlags
- * @use_partial            : option to use *.partial~
- * @cancellable            : (nullable): optional #GCancellable object
- * @progress_callback      : (nullable) (scope call): function to callback with progress information
- * @progress_callback_data : (clousure): user data to pass to @progress_callback
- * @error                  : (nullable): #GError to set on error
- *
- * Calls g_file_copy() if @use_partial is not enabled.
- * If enabled, copies files to *.partial~ first and then
- * renames *.partial~ into its original name.
- *
- * Return value: %TRUE on success, %FALSE otherwise.
- **/
-gboolean
-thunar_g_file_copy (GFile                *source,
-                    GFile                *destination,
-                    GFileCopyFlags        flags,
-                    gboolean              use_partial,
-                    GCancellable         *cancellable,
-                    GFileProgressCallback progress_callback,
-                    gpointer              progress_callback_data,
-                    GError              **error)
+#if defined (FICLONE) || defined (HAVE_COPY_FILE_RANGE) || (defined (HAVE_SENDFILE) && defined (HAVE_SYS_SENDFILE_H))
+#define THUNAR_G_FILE_COPY_NATIVE 1
+
+/* Bytes copied by the kernel between two progress updates. The chunk size
+ * follows the throughput, so a chunk takes about THUNAR_G_FILE_COPY_NATIVE_CHUNK_TIME
+ * (in microseconds) and pause and cancel take effect that quickly even on
+ * slow targets */
+#define THUNAR_G_FILE_COPY_NATIVE_CHUNK_MIN  (64 * 1024)
+#define THUNAR_G_FILE_COPY_NATIVE_CHUNK_MAX  (8 * 1024 * 1024)
+#define THUNAR_G_FILE_COPY_NATIVE_CHUNK_TIME (100 * 1000)
+
+#if defined (SEEK_DATA) && defined (SEEK_HOLE)
+/* the holes of sparse files are found with lseek(), and kept in the copy */
+#define THUNAR_G_FILE_COPY_NATIVE_SPARSE 1
+#endif
+
+/* the in-kernel copy methods, tried in this order */
+enum
+{
+  THUNAR_G_FILE_COPY_NATIVE_COPY_FILE_RANGE,
+  THUNAR_G_FILE_COPY_NATIVE_SENDFILE,
+  THUNAR_G_FILE_COPY_NATIVE_NONE,
+};
+
+
+
+static gssize
+thunar_g_file_copy_native_chunk (gint   method,
+                                 gint   source_fd,
+                                 gint   target_fd,
+                                 goffset offset,
+                                 gsize  length)
+{
+  switch (method)
+    {
+#ifdef HAVE_COPY_FILE_RANGE
+    case THUNAR_G_FILE_COPY_NATIVE_COPY_FILE_RANGE:
+      return copy_file_range (source_fd, NULL, target_fd, NULL, length, 0);
+#endif
+
+#if defined (HAVE_SENDFILE) && defined (HAVE_SYS_SENDFILE_H)
+    case THUNAR_G_FILE_COPY_NATIVE_SENDFILE:
+      {
+        off_t sendfile_offset = offset;
+        return sendfile (target_fd, source_fd, &sendfile_offset, length);
+      }
+#endif
+
+    default:
+      errno = ENOSYS;
+      return -1;
+    }
+}
+
+
+
+#ifdef THUNAR_G_FILE_COPY_NATIVE_SPARSE
+/* Moves both files to the next data extent of the source at or after
+ * @offset and returns its start, or the size of the source if only a hole
+ * follows. @data_end_return is set to the end of the extent. Returns -1
+ * if the file system can't tell the holes. */
+static goffset
+thunar_g_file_copy_native_next_data (gint     source_fd,
+                                     gint     target_fd,
+                                     goffset  offset,
+                                     goffset  size,
+                                     goffset *data_end_return)
+{
+  goffset data_start;
+  goffset data_end;
+
+  data_start = lseek (source_fd, offset, SEEK_DATA);
+  if (data_start < 0)
+    {
+      /* no data up to the end of the file */
+      if (errno != ENXIO)
+        return -1;
+      data_start = size;
+      data_end = size;
+    }
+  else
+    {
+      data_end = lseek (source_fd, data_start, SEEK_HOLE);
+      if (data_end < 0)
+        return -1;
+    }
+
+  /* copy_file_range() copies from and to the offsets of the files, seeking
+   * beyond the end of the target leaves a hole in it */
+  if (lseek (source_fd, data_start, SEEK_SET) < 0 || lseek (target_fd, data_start, SEEK_SET) < 0)
+    return -1;
+
+  *data_end_return = MIN (data_end, size);
+  return MIN (data_start, size);
+}
+#endif
+
+
+
+/* Copies the contents of a local regular file inside the kernel: a reflink
+ * shares the extents on btrfs/xfs, copy_file_range() and sendfile() avoid
+ * the round trip through userspace. Only the data extents of sparse files
+ * are copied, so the copy has the same holes. Fails with
+ * G_IO_ERROR_NOT_SUPPORTED, leaving no target behind, if none of that
+ * applies, so g_file_copy() can take over. */
+static gboolean
+thunar_g_file_copy_native (GFile                *source,
+                           GFile                *destination,
+                           GFileCopyFlags        flags,
+                           GCancellable         *cancellable,
+                           GFileProgressCallback progress_callback,
+                           gpointer              progress_callback_data,
+                           GError              **error)
+{
+  struct stat source_stat;
+  struct stat target_stat;
+  const gchar *source_path;
+  const gchar *target_path;
+  goffset      copied = 0;
+  goffset      written = 0;
+  goffset      data_end;
+  gboolean     sparse = FALSE;
+  gsize        chunk_size = THUNAR_G_FILE_COPY_NATIVE_CHUNK_MIN;
+  gint64       start_time;
+  gint64       elapsed;
+  gssize       n;
+  gint         source_fd;
+  gint         target_fd;
+  gint         method;
+  gint         open_flags;
+  gint         saved_errno;
+
+  source_path = g_file_peek_path (source);
+  target_path = g_file_peek_path (destination);
+
+  /* leave backups and anything but regular files to gio */
+  if (source_path == NULL || target_path == NULL || (flags & G_FILE_COPY_BACKUP) != 0
+      || ((flags & G_FILE_COPY_NOFOLLOW_SYMLINKS) ? lstat (source_path, &source_stat) : stat (source_path, &source_stat)) != 0
+      || !S_ISREG (source_stat.st_mode))
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED, "Native copy not supported");
+      return FALSE;
+    }
+
+  /* gio reports existing targets */
+  if (lstat (target_path, &target_stat) == 0
+      && ((flags & G_FILE_COPY_OVERWRITE) == 0 || !S_ISREG (target_stat.st_mode)))
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED, "Native copy not supported");
+      return FALSE;
+    }
+
+  source_fd = g_open (source_path, O_RDONLY | O_CLOEXEC, 0);
+  if (source_fd < 0)
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED, "Native copy not supported");
+      return FALSE;
+    }
+
+  open_flags = O_WRONLY | O_CREAT | O_CLOEXEC | (((flags & G_FILE_COPY_OVERWRITE) != 0) ? O_TRUNC : O_EXCL);
+  target_fd = g_open (target_path, open_flags, source_stat.st_mode & 0777);
+  if (target_fd < 0)
+    {
+      close (source_fd);
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED, "Native copy not supported");
+      return FALSE;
+    }
+
+#ifdef FICLONE
+  /* instant copy-on-write clone, if the file system supports it */
+  if (ioctl (target_fd, FICLONE, source_fd) == 0)
+    {
+      copied = source_stat.st_size;
+      method = THUNAR_G_FILE_COPY_NATIVE_NONE;
+    }
+  else
+#endif
+    {
+      method = THUNAR_G_FILE_COPY_NATIVE_COPY_FILE_RANGE;
+
+#ifdef THUNAR_G_FILE_COPY_NATIVE_SPARSE
+      /* fewer allocated blocks than the size needs means there are holes */
+      sparse = ((goffset) source_stat.st_blocks * 512 < source_stat.st_size);
+#endif
+    }
+
+  data_end = source_stat.st_size;
+
+  while (copied < source_stat.st_size && method < THUNAR_G_FILE_COPY_NATIVE_NONE)
+    {
+      if (g_cancellable_set_error_if_cancelled (cancellable, error))
+        goto failed;
+
+#ifdef THUNAR_G_FILE_COPY_NATIVE_SPARSE
+      /* skip the hole after the extent, the progress counts it as copied */
+      if (sparse && copied >= data_end)
+        {
+          n = thunar_g_file_copy_native_next_data (source_fd, target_fd, copied, source_stat.st_size, &data_end);
+          if (n < 0)
+            {
+              /* copy the rest including the holes */
+              sparse = FALSE;
+              data_end = source_stat.st_size;
+              if (lseek (source_fd, copied, SEEK_SET) < 0 || lseek (target_fd, copied, SEEK_SET) < 0)
+                {
+                  saved_errno = errno;
+                  g_set_error (error, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                               "Error seeking in file \"%s\": %s", source_path, g_strerror (saved_errno));
+                  goto failed;
+                }
+            }
+          else if (n > copied)
+            {
+              copied = n;
+              if (progress_callback != NULL)
+                progress_callback (copied, source_stat.st_size, progress_callback_data);
+            }
+          continue;
+        }
+#endif
+
+      start_time = g_get_monotonic_time ();
+      n = thunar_g_file_copy_native_chunk (method, source_fd, target_fd, copied,
+                                           MIN (data_end - copied, (goffset) chunk_size));
+      if (n < 0 && errno == EINTR)
+        continue;
+
+      if (n <= 0)
+        {
+          /* the file shrunk while copying */
+          if (n == 0)
+            break;
+
+          /* try the next method, if this one isn't supported for these files */
+          if (written == 0 && (errno == ENOSYS || errno == EXDEV || errno == EINVAL || errno == EOPNOTSUPP))
+            {
+              method++;
+              continue;
+            }
+
+          saved_errno = errno;
+          g_set_error (error, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                       "Error writing to file \"%s\": %s", target_path, g_strerror (saved_errno));
+          goto failed;
+        }
+
+      copied += n;
+      written += n;
+
+      /* size the next chunk for the time one should take at the current rate */
+      elapsed = MAX (g_get_monotonic_time () - start_time, 1);
+      chunk_size = CLAMP ((gdouble) n * THUNAR_G_FILE_COPY_NATIVE_CHUNK_TIME / elapsed,
+                          THUNAR_G_FILE_COPY_NATIVE_CHUNK_MIN, THUNAR_G_FILE_COPY_NATIVE_CHUNK_MAX);
+
+      /* the transfer job checks for pause in the callback */
+      if (progress_callback != NULL)
+        progress_callback (copied, source_stat.st_size, progress_callback_data);
+    }
+
+  /* none of the methods works here, let gio copy */
+  if (method == THUNAR_G_FILE_COPY_NATIVE_NONE && written == 0 && copied < source_stat.st_size)
+    {
+      close (source_fd);
+      close (target_fd);
+      g_unlink (target_path);
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED, "Native copy not supported");
+      return FALSE;
+    }
+
+  /* a hole at the end doesn't extend the target by itself */
+  if (sparse && copied == source_stat.st_size && ftruncate (target_fd, source_stat.st_size) != 0)
+    {
+      saved_errno = errno;
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                   "Error writing to file \"%s\": %s", target_path, g_strerror (saved_errno));
+      goto failed;
+    }
+
+  close (source_fd);
+  if (close (target_fd) != 0)
+    {
+      saved_errno = errno;
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                   "Error closing file \"%s\": %s", target_path, g_strerror (saved_errno));
+      g_unlink (target_path);
+      return FALSE;
+    }
+
+  /* reflinks report all at once */
+  if (progress_callback != NULL && method == THUNAR_G_FILE_COPY_NATIVE_NONE)
+    progress_callback (copied, source_stat.st_size, progress_callback_data);
+
+  /* like g_file_copy(), which does not fail on attributes it can't set */
+  g_file_copy_attributes (source, destination, flags, cancellable, NULL);
+
+  return TRUE;
+
+failed:
+  close (source_fd);
+  close (target_fd);
+  g_unlink (target_path);
+  return FALSE;
+}
+#endif
+
+
+
+/* Bytes read at once to compute the checksum of a file */
+#define THUNAR_G_FILE_CHECKSUM_BUFFER_SIZE (1024 * 1024)
+
+
+
+/* reads @file into @checksum */
+static gboolean
+thunar_g_file_update_checksum (GFile        *file,
+                               GChecksum    *checksum,
+                               GCancellable *cancellable,
+                               GError      **error)
+{
+  GFileInputStream *stream;
+  guchar           *buffer;
+  gssize            n;
+
+  stream = g_file_read (file, cancellable, error);
+  if (stream == NULL)
+    return FALSE;
+
+  buffer = g_malloc (THUNAR_G_FILE_CHECKSUM_BUFFER_SIZE);
+  while ((n = g_input_stream_read (G_INPUT_STREAM (stream), buffer, THUNAR_G_FILE_CHECKSUM_BUFFER_SIZE, cancellable, error)) > 0)
+    g_checksum_update (checksum, buffer, n);
+  g_free (buffer);
+
+  g_input_stream_close (G_INPUT_STREAM (stream), NULL, NULL);
+  g_object_unref (stream);
+
+  return n == 0;
+}
+
+
+
+/* Streamed copies start with blocks of this size, which are doubled
+ * as long as that raises the throughput, up to the maximum */
+#define THUNAR_G_FILE_COPY_STREAM_MIN_FILE_SIZE  (1024 * 1024)
+#define THUNAR_G_FILE_COPY_STREAM_MIN_BLOCK_SIZE (256 * 1024)
+#define THUNAR_G_FILE_COPY_STREAM_MAX_BLOCK_SIZE (16 * 1024 * 1024)
+
+/* Blocks are not grown beyond the size written in this time, in microseconds,
+ * so pause and cancel, checked between the blocks, stay responsive */
+#define THUNAR_G_FILE_COPY_STREAM_MAX_BLOCK_TIME (250 * 1000)
+
+/* Streamed files at least that big are dropped from the page cache */
+#define THUNAR_G_FILE_COPY_STREAM_DONTNEED_SIZE  (64 * 1024 * 1024)
+
+typedef struct
+{
+  guchar *data;
+  gsize   size;         /* allocated bytes, the reader fills up to it */
+  gsize   length;       /* bytes read, 0 at the end of the file */
+  GError *error;
+} ThunarGFileCopyBlock;
+
+typedef struct
+{
+  GInputStream *input;
+  GChecksum    *checksum;
+  GCancellable *cancellable;
+  GAsyncQueue  *free_blocks;
+  GAsyncQueue  *filled_blocks;
+  gint          abort;
+  gboolean      dontneed;
+} ThunarGFileCopyStream;
+
+
+
+static void
+thunar_g_file_copy_stream_fadvise (gpointer stream,
+                                   goffset  offset,
+                                   goffset  length,
+                                   gint     advice)
+{
+#if defined (HAVE_GIO_UNIX) && defined (HAVE_POSIX_FADVISE)
+  if (G_IS_FILE_DESCRIPTOR_BASED (stream))
+    posix_fadvise (g_file_descriptor_based_get_fd (G_FILE_DESCRIPTOR_BASED (stream)), offset, length, advice);
+#endif
+}
+
+
+
+/* reads the source into the free blocks, while the caller writes the filled ones */
+static gpointer
+thunar_g_file_copy_stream_reader (gpointer data)
+{
+  ThunarGFileCopyStream *stream = data;
+  ThunarGFileCopyBlock  *block;
+  goffset                offset = 0;
+
+  do
+    {
+      block = g_async_queue_pop (stream->free_blocks);
+
+      if (g_atomic_int_get (&stream->abort))
+        {
+          block->length = 0;
+        }
+      else if (g_input_stream_read_all (stream->input, block->data, block->size, &block->length,
+                                        stream->cancellable, &block->error))
+        {
+          /* the source is only read once, so its checksum is computed here */
+          if (stream->checksum != NULL)
+            g_checksum_update (stream->checksum, block->data, block->length);
+
+#ifdef POSIX_FADV_DONTNEED
+          if (stream->dontneed)
+            thunar_g_file_copy_stream_fadvise (stream->input, offset, block->length, POSIX_FADV_DONTNEED);
+#endif
+          offset += block->length;
+        }
+
+      g_async_queue_push (stream->filled_blocks, block);
+    }
+  while (block->length > 0 && block->error == NULL);
+
+  return NULL;
+}
+
+
+
+/* Copies a regular file block-wise with reading and writing overlapped in
+ * two buffers. Used for gvfs mounts, which are much faster with blocks of
+ * some megabytes than with the small buffer of g_file_copy(), and to update
+ * @checksum with the contents of the source on the way. Fails with
+ * G_IO_ERROR_NOT_SUPPORTED before creating the target if the file is not
+ * worth it. */
+static gboolean
+thunar_g_file_copy_stream (GFile                *source,
+                           GFile                *destination,
+                           GFileCopyFlags        flags,
+                           GCancellable         *cancellable,
+                           GFileProgressCallback progress_callback,
+                           gpointer              progress_callback_data,
+                           GChecksum            *checksum,
+                           GError              **error)
+{
+  ThunarGFileCopyStream stream;
+  ThunarGFileCopyBlock  blocks[2];
+  ThunarGFileCopyBlock *block;
+  GFileOutputStream    *output = NULL;
+  GFileInfo            *info;
+  GThread              *reader;
+  GError               *err = NULL;
+  goffset               total_size;
+  goffset               copied = 0;
+  gsize                 block_size = THUNAR_G_FILE_COPY_STREAM_MIN_BLOCK_SIZE;
+  gdouble               rate;
+  gdouble               last_rate = 0.0;
+  gint64                start_time;
+  gint64                elapsed;
+  gboolean              reader_done = FALSE;
+  guint                 n;
+
+  if ((flags & G_FILE_COPY_BACKUP) != 0)
+    {
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED, "Streamed copy not supported");
+      return FALSE;
+    }
+
+  info = g_file_query_info (source,
+                            G_FILE_ATTRIBUTE_STANDARD_TYPE "," G_FILE_ATTRIBUTE_STANDARD_SIZE,
+                            (flags & G_FILE_COPY_NOFOLLOW_SYMLINKS) ? G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS : G_FILE_QUERY_INFO_NONE,
+                            cancellable, NULL);
+  if (info == NULL
+      || g_file_info_get_file_type (info) != G_FILE_TYPE_REGULAR
+      || (checksum == NULL && g_file_info_get_size (info) < THUNAR_G_FILE_COPY_STREAM_MIN_FILE_SIZE))
+    {
+      g_clear_object (&info);
+      g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED, "Streamed copy not supported");
+      return FALSE;
+    }
+
+  total_size = g_file_info_get_size (info);
+  g_object_unref (info);
+
+  stream.input = G_INPUT_STREAM (g_file_read (source, cancellable, &err));
+  if (stream.input == NULL)
+    {
+      g_propagate_error (error, err);
+      return FALSE;
+    }
+
+  if ((flags & G_FILE_COPY_OVERWRITE) != 0)
+    output = g_file_replace (destination, NULL, FALSE, G_FILE_CREATE_REPLACE_DESTINATION, cancellable, &err);
+  else
+    output = g_file_create (destination, G_FILE_CREATE_NONE, cancellable, &err);
+  if (output == NULL)
+    {
+      /* backends without streaming writes may still copy themselves */
+      if (g_error_matches (err, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED))
+        g_clear_error (&err);
+      g_object_unref (stream.input);
+      if (err != NULL)
+        g_propagate_error (error, err);
+      else
+        g_set_error_literal (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED, "Streamed copy not supported");
+      return FALSE;
+    }
+
+  stream.checksum = checksum;
+  stream.cancellable = cancellable;
+  stream.free_blocks = g_async_queue_new ();
+  stream.filled_blocks = g_async_queue_new ();
+  stream.abort = FALSE;
+  stream.dontneed = (total_size >= THUNAR_G_FILE_COPY_STREAM_DONTNEED_SIZE);
+
+#ifdef POSIX_FADV_SEQUENTIAL
+  thunar_g_file_copy_stream_fadvise (stream.input, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+  for (n = 0; n < G_N_ELEMENTS (blocks); n++)
+    {
+      blocks[n].data = g_malloc (block_size);
+      blocks[n].size = block_size;
+      blocks[n].length = 0;
+      blocks[n].error = NULL;
+      g_async_queue_push (stream.free_blocks, &blocks[n]);
+    }
+
+  reader = g_thread_new ("ThunarCopyReader", thunar_g_file_copy_stream_reader, &stream);
+
+  for (;;)
+    {
+      block = g_async_queue_pop (stream.filled_blocks);
+      reader_done = (block->length == 0 || block->error != NULL);
+      if (block->error != NULL)
+        {
+          err = g_steal_pointer (&block->error);
+          break;
+        }
+      if (block->length == 0)
+        break;
+
+      start_time = g_get_monotonic_time ();
+      if (!g_output_stream_write_all (G_OUTPUT_STREAM (output), block->data, block->length, NULL, cancellable, &err))
+        break;
+
+      copied += block->length;
+      if (progress_callback != NULL)
+        progress_callback (copied, total_size, progress_callback_data);
+
+      /* grow the blocks while that pays off, the target is the bottleneck here */
+      elapsed = MAX (g_get_monotonic_time () - start_time, 1);
+      rate = (gdouble) block->length / elapsed;
+      if (elapsed > THUNAR_G_FILE_COPY_STREAM_MAX_BLOCK_TIME)
+        {
+          /* the target got slower, shrink the blocks again */
+          block_size = MAX (block_size / 2, THUNAR_G_FILE_COPY_STREAM_MIN_BLOCK_SIZE);
+          last_rate = rate;
+        }
+      else if (block->length == block->size && block_size < THUNAR_G_FILE_COPY_STREAM_MAX_BLOCK_SIZE
+               && elapsed * 2 <= THUNAR_G_FILE_COPY_STREAM_MAX_BLOCK_TIME)
+        {
+          if (rate > last_rate * 1.1)
+            block_size *= 2;
+          last_rate = rate;
+        }
+
+      if (block->size != block_size)
+        {
+          block->data = g_realloc (block->data, block_size);
+          block->size = block_size;
+        }
+
+      g_async_queue_push (stream.free_blocks, block);
+    }
+
+  /* on write errors, let the reader run into the end */
+  if (!reader_done)
+    {
+      g_atomic_int_set (&stream.abort, TRUE);
+      g_async_queue_push (stream.free_blocks, block);
+      do
+        {
+          block = g_async_queue_pop (stream.filled_blocks);
+          reader_done = (block->length == 0 || block->error != NULL);
+          g_async_queue_push (stream.free_blocks, block);
+        }
+      while (!reader_done);
+    }
+
+  g_thread_join (reader);
+
+  for (n = 0; n < G_N_ELEMENTS (blocks); n++)
+    {
+      g_clear_error (&blocks[n].error);
+      g_free (blocks[n].data);
+    }
+  g_async_queue_unref (stream.free_blocks);
+  g_async_queue_unref (stream.filled_blocks);
+
+  g_input_stream_close (stream.input, NULL, NULL);
+  g_object_unref (stream.input);
+
+  /* closing flushes the remaining data, which can fail as well */
+  if (err == NULL)
+    g_output_stream_close (G_OUTPUT_STREAM (output), cancellable, &err);
+  else
+    g_output_stream_close (G_OUTPUT_STREAM (output), NULL, NULL);
+  g_object_unref (output);
+
+  if (err != NULL)
+    {
+      g_file_delete (destination, NULL, NULL);
+      g_propagate_error (error, err);
+      return FALSE;
+    }
+
+  /* like g_file_copy(), which does not fail on attributes it can't set */
+  g_file_copy_attributes (source, destination, flags, cancellable, NULL);
+
+  return TRUE;
+}
+
+
+
+/* tries the native fast path for local files and the streamed copy for slow
+ * targets before g_file_copy(), the latter two also for checksummed copies */
+static gboolean
+thunar_g_file_copy_contents (GFile                *source,
+                             GFile                *destination,
+                             GFileCopyFlags        flags,
+                             GCancellable         *cancellable,
+                             GFileProgressCallback progress_callback,
+                             gpointer              progress_callback_data,
+                             GChecksum            *checksum,
+                             GError              **error)
+{
+  GError *err = NULL;
+
+#ifdef THUNAR_G_FILE_COPY_NATIVE
+  if (checksum == NULL && g_file_is_native (source) && g_file_is_native (destination))
+    {
+      if (thunar_g_file_copy_native (source, destination, flags, cancellable,
+                                     progress_callback, progress_callback_data, &err))
+        return TRUE;
+
+      if (!g_error_matches (err, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED))
+        {
+          g_propagate_error (error, err);
+          return FALSE;
+        }
+
+      g_clear_error (&err);
+    }
+#endif
+
+  if (checksum != NULL || !g_file_is_native (source) || !g_file_is_native (destination))
+    {
+      if (thunar_g_file_copy_stream (source, destination, flags, cancellable,
+                                     progress_callback, progress_callback_data, checksum, &err))
+        return TRUE;
+
+      if (!g_error_matches (err, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED))
+        {
+          g_propagate_error (error, err);
+          return FALSE;
+        }
+
+      g_clear_error (&err);
+    }
+
+  if (!g_file_copy (source, destination, flags, cancellable, progress_callback, progress_callback_data, error))
+    return FALSE;
+
+  /* the only case left to read the source again */
+  if (checksum != NULL)
+    return thunar_g_file_update_checksum (source, checksum, cancellable, error);
+
+  return TRUE;
+}
+
+
+
+/* returns the *.partial~ file @destination is copied to first */
+static GFile *
+thunar_g_file_get_partial (GFile  *destination,
+                           gchar **base_name_return)
+{
+  GFile *parent;
+  GFile *partial;
+  gchar *partial_name;
+  gchar *base_name;
+
+  base_name    = g_file_get_basename (destination);
+  if (base_name == NULL)
+    {
+      base_name = g_strdup ("UNNAMED");
+    }
+
+  /* limit filename length */
+  partial_name = g_strdup_printf ("%.100s.partial~", base_name);
+  parent       = g_file_get_parent (destination);
+
+  /* parent can't be NULL since destination must be a file */
+  partial      = g_file_get_child (parent, partial_name);
+  g_clear_object (&parent);
+  g_free (partial_name);
+
+  *base_name_return = base_name;
+  return partial;
+}
+
+
+
+static gboolean
+thunar_g_file_copy_real (GFile                *source,
+                         GFile                *destination,
+                         GFileCopyFlags        flags,
+                         gboolean              use_partial,
+                         GCancellable         *cancellable,
+                         GFileProgressCallback progress_callback,
+                         gpointer              progress_callback_data,
+                         GChecksum            *checksum,
+                         GError              **error)
 {
   gboolean            success;
   GFileQueryInfoFlags query_flags;
   GFileInfo          *info = NULL;
-  GFile              *parent;
   GFile              *partial;
-  gchar              *partial_name;
   gchar              *base_name;
 
   _thunar_return_val_if_fail (g_file_has_parent (destination, NULL), FALSE);
@@ -747,7 +1466,7 @@ thunar_g_file_copy (GFile                *source,
 
   if (!use_partial)
     {
-      success = g_file_copy (source, destination, flags, cancellable, progress_callback, progress_callback_data, error);
+      success = thunar_g_file_copy_contents (source, destination, flags, cancellable, progress_callback, progress_callback_data, checksum, error);
       return success;
     }
 
@@ -775,46 +1494,275 @@ thunar_g_file_copy (GFile                *source,
     }
 
   /* generate partial file name */
-  base_name    = g_file_get_basename (destination);
-  if (base_name == NULL)
+  partial = thunar_g_file_get_partial (destination, &base_name);
+
+  /* check if partial file exists */
+  if (g_file_query_exists (partial, NULL))
+    g_file_delete (partial, NULL, error);
+
+  /* copy file to .partial */
+  success = thunar_g_file_copy_contents (source, partial, flags, cancellable, progress_callback, progress_callback_data, checksum, error);
+
+  if (success)
     {
-      base_name = g_strdup ("UNNAMED");
+      /* rename .partial if done without problem */
+      success = (g_file_set_display_name (partial, base_name, NULL, error) != NULL);
     }
 
-  /* limit filename length */
-  partial_name = g_strdup_printf ("%.100s.partial~", base_name);
-  parent       = g_file_get_parent (destination);
+  if (!success)
+    {
+      /* try to remove incomplete file. */
+      /* failure is expected so error is ignored */
+      /* it must be triggered if cancelled */
+      /* thus cancellable is also ignored */
+      g_file_delete (partial, NULL, NULL);
+    }
 
-  /* parent can't be NULL since destination must be a file */
-  partial      = g_file_get_child (parent, partial_name);
-  g_clear_object (&parent);
-  g_free (partial_name);
+  g_clear_object (&partial);
+  g_free (base_name);
+  return success;
+}
 
-  /* check if partial file exists */
-  if (g_file_query_exists (partial, NULL))
-    g_file_delete (partial, NULL, error);
 
-  /* copy file to .partial */
-  success = g_file_copy (source, partial, flags, cancellable, progress_callback, progress_callback_data, error);
 
-  if (success)
-    {
-      /* rename .partial if done without problem */
-      success = (g_file_set_display_name (partial, base_name, NULL, error) != NULL);
-    }
+/**
+ * thunar_g_file_copy:
+ * @source                 : input #GFile
+ * @destination            : destination #GFile
+ * @flags                  : set of #GFileCopyFlags
+ * @use_partial            : option to use *.partial~
+ * @cancellable            : (nullable): optional #GCancellable object
+ * @progress_callback      : (nullable) (scope call): function to callback with progress information
+ * @progress_callback_data : (clousure): user data to pass to @progress_callback
+ * @error                  : (nullable): #GError to set on error
+ *
+ * Calls g_file_copy() if @use_partial is not enabled.
+ * If enabled, copies files to *.partial~ first and then
+ * renames *.partial~ into its original name.
+ *
+ * Regular files on local file systems are cloned or copied inside
+ * the kernel where possible, big files from or to other locations
+ * are streamed in adaptively sized blocks, falling back to g_file_copy().
+ *
+ * Return value: %TRUE on success, %FALSE otherwise.
+ **/
+gboolean
+thunar_g_file_copy (GFile                *source,
+                    GFile                *destination,
+                    GFileCopyFlags        flags,
+                    gboolean              use_partial,
+                    GCancellable         *cancellable,
+                    GFileProgressCallback progress_callback,
+                    gpointer              progress_callback_data,
+                    GError              **error)
+{
+  return thunar_g_file_copy_real (source, destination, flags, use_partial, cancellable,
+                                  progress_callback, progress_callback_data, NULL, error);
+}
+
+
+
+/**
+ * thunar_g_file_copy_resume:
+ * @source                 : input #GFile
+ * @destination            : destination #GFile
+ * @flags                  : set of #GFileCopyFlags
+ * @offset                 : number of bytes already copied
+ * @cancellable            : (nullable): optional #GCancellable object
+ * @progress_callback      : (nullable) (scope call): function to callback with progress information
+ * @progress_callback_data : (clousure): user data to pass to @progress_callback
+ * @error                  : (nullable): #GError to set on error
+ *
+ * Continues an interrupted thunar_g_file_copy() of a regular file with
+ * use_partial enabled: the first @offset bytes of the *.partial~ file are
+ * kept and the rest of @source is appended to it. Copies the whole file if
+ * the *.partial~ file is missing or shorter, or @source can't seek.
+ *
+ * Return value: %TRUE on success, %FALSE otherwise.
+ **/
+gboolean
+thunar_g_file_copy_resume (GFile                *source,
+                           GFile                *destination,
+                           GFileCopyFlags        flags,
+                           goffset               offset,
+                           GCancellable         *cancellable,
+                           GFileProgressCallback progress_callback,
+                           gpointer              progress_callback_data,
+                           GError              **error)
+{
+  GFileInputStream *input = NULL;
+  GFileIOStream    *iostream = NULL;
+  GOutputStream    *output;
+  GFileInfo        *info;
+  GError           *err = NULL;
+  GFile            *partial;
+  GFile            *renamed;
+  goffset           total_size = 0;
+  guchar           *buffer = NULL;
+  gchar            *base_name;
+  gssize            n;
+  goffset           partial_size = -1;
+
+  _thunar_return_val_if_fail (g_file_has_parent (destination, NULL), FALSE);
+
+  partial = thunar_g_file_get_partial (destination, &base_name);
+
+  info = g_file_query_info (partial, G_FILE_ATTRIBUTE_STANDARD_SIZE, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, cancellable, NULL);
+  if (info != NULL)
+    {
+      partial_size = g_file_info_get_size (info);
+      g_object_unref (info);
+    }
+
+  info = g_file_query_info (source, G_FILE_ATTRIBUTE_STANDARD_SIZE, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, cancellable, NULL);
+  if (info != NULL)
+    {
+      total_size = g_file_info_get_size (info);
+      g_object_unref (info);
+    }
+
+  if (offset > 0 && partial_size >= offset && total_size >= offset)
+    input = g_file_read (source, cancellable, NULL);
+
+  /* nothing to resume from */
+  if (input == NULL
+      || !g_seekable_can_seek (G_SEEKABLE (input))
+      || !g_seekable_seek (G_SEEKABLE (input), offset, G_SEEK_SET, cancellable, NULL)
+      || (iostream = g_file_open_readwrite (partial, cancellable, NULL)) == NULL
+      || !g_seekable_truncate (G_SEEKABLE (iostream), offset, cancellable, NULL)
+      || !g_seekable_seek (G_SEEKABLE (iostream), offset, G_SEEK_SET, cancellable, NULL))
+    {
+      g_clear_object (&input);
+      g_clear_object (&iostream);
+      g_object_unref (partial);
+      g_free (base_name);
+      return thunar_g_file_copy (source, destination, flags, TRUE, cancellable,
+                                 progress_callback, progress_callback_data, error);
+    }
+
+  output = g_io_stream_get_output_stream (G_IO_STREAM (iostream));
+  buffer = g_malloc (THUNAR_G_FILE_CHECKSUM_BUFFER_SIZE);
+  while ((n = g_input_stream_read (G_INPUT_STREAM (input), buffer, THUNAR_G_FILE_CHECKSUM_BUFFER_SIZE, cancellable, &err)) > 0)
+    {
+      if (!g_output_stream_write_all (output, buffer, n, NULL, cancellable, &err))
+        break;
+
+      offset += n;
+      if (progress_callback != NULL)
+        progress_callback (offset, total_size, progress_callback_data);
+    }
+  g_free (buffer);
+
+  g_input_stream_close (G_INPUT_STREAM (input), NULL, NULL);
+  g_object_unref (input);
+
+  if (err == NULL)
+    g_io_stream_close (G_IO_STREAM (iostream), cancellable, &err);
+  else
+    g_io_stream_close (G_IO_STREAM (iostream), NULL, NULL);
+  g_object_unref (iostream);
+
+  if (err == NULL)
+    {
+      g_file_copy_attributes (source, partial, flags, cancellable, NULL);
+
+      /* rename .partial if done without problem */
+      renamed = g_file_set_display_name (partial, base_name, NULL, &err);
+      g_clear_object (&renamed);
+    }
+
+  if (err != NULL)
+    {
+      /* like thunar_g_file_copy(), remove the incomplete file */
+      g_file_delete (partial, NULL, NULL);
+      g_propagate_error (error, err);
+    }
+
+  g_object_unref (partial);
+  g_free (base_name);
+
+  return err == NULL;
+}
+
+
+
+/**
+ * thunar_g_file_copy_with_checksum:
+ * @source                 : input #GFile
+ * @destination            : destination #GFile
+ * @flags                  : set of #GFileCopyFlags
+ * @use_partial            : option to use *.partial~
+ * @cancellable            : (nullable): optional #GCancellable object
+ * @progress_callback      : (nullable) (scope call): function to callback with progress information
+ * @progress_callback_data : (clousure): user data to pass to @progress_callback
+ * @checksum_type          : the #GChecksumType to compute
+ * @checksum_return        : return location for the checksum of @source
+ * @error                  : (nullable): #GError to set on error
+ *
+ * Like thunar_g_file_copy(), but computes the checksum of the @source
+ * contents while they are copied, so verifying the copy only needs to
+ * read @destination again with thunar_g_file_create_checksum().
+ *
+ * Return value: %TRUE on success, %FALSE otherwise.
+ **/
+gboolean
+thunar_g_file_copy_with_checksum (GFile                *source,
+                                  GFile                *destination,
+                                  GFileCopyFlags        flags,
+                                  gboolean              use_partial,
+                                  GCancellable         *cancellable,
+                                  GFileProgressCallback progress_callback,
+                                  gpointer              progress_callback_data,
+                                  GChecksumType         checksum_type,
+                                  gchar               **checksum_return,
+                                  GError              **error)
+{
+  GChecksum *checksum;
+  gboolean   success;
+
+  _thunar_return_val_if_fail (checksum_return != NULL, FALSE);
+
+  checksum = g_checksum_new (checksum_type);
+  success = thunar_g_file_copy_real (source, destination, flags, use_partial, cancellable,
+                                     progress_callback, progress_callback_data, checksum, error);
+  *checksum_return = success ? g_strdup (g_checksum_get_string (checksum)) : NULL;
+  g_checksum_free (checksum);
+
+  return success;
+}
+
+
 
-  if (!success)
-    {
-      /* try to remove incomplete file. */
-      /* failure is expected so error is ignored */
-      /* it must be triggered if cancelled */
-      /* thus cancellable is also ignored */
-      g_file_delete (partial, NULL, NULL);
-    }
+/**
+ * thunar_g_file_create_checksum:
+ * @file          : a #GFile
+ * @checksum_type : the #GChecksumType to compute
+ * @cancellable   : (nullable): optional #GCancellable object
+ * @error         : (nullable): optional #GError
+ *
+ * Reads @file to compute its checksum.
+ *
+ * The caller is responsible to free the returned string using g_free().
+ *
+ * Return value: the checksum as hexadecimal string or %NULL on error.
+ **/
+gchar *
+thunar_g_file_create_checksum (GFile         *file,
+                               GChecksumType  checksum_type,
+                               GCancellable  *cancellable,
+                               GError       **error)
+{
+  GChecksum *checksum;
+  gchar     *string = NULL;
 
-  g_clear_object (&partial);
-  g_free (base_name);
-  return success;
+  _thunar_return_val_if_fail (G_IS_FILE (file), NULL);
+
+  checksum = g_checksum_new (checksum_type);
+  if (thunar_g_file_update_checksum (file, checksum, cancellable, error))
+    string = g_strdup (g_checksum_get_string (checksum));
+  g_checksum_free (checksum);
+
+  return string;
 }
 
 
@@ -855,6 +1803,143 @@ thunar_g_file_compare_checksum (GFile        *file_a,
 
 
 
+/* lists of at least twice this number of URIs are parsed by several threads */
+#define THUNAR_G_FILE_LIST_PARSE_CHUNK (4096)
+
+
+
+typedef struct
+{
+  GPtrArray  *uris;
+  GFile     **files;
+}
+ThunarGFileListParse;
+
+
+
+/* like g_uri_list_extract_uris(), but cuts the URIs out of @buffer instead of copying them */
+static GPtrArray *
+thunar_g_file_list_split_uris (gchar *buffer)
+{
+  GPtrArray *uris;
+  gchar     *p = buffer;
+  gchar     *q;
+  gchar     *next;
+
+  uris = g_ptr_array_new ();
+
+  while (p != NULL)
+    {
+      next = strchr (p, '\n');
+
+      if (*p != '#')
+        {
+          while (g_ascii_isspace (*p))
+            p++;
+
+          /* the whitespace may have moved past the end of the line */
+          if (next != NULL && p > next)
+            next = strchr (p, '\n');
+
+          q = p;
+          while (*q != '\0' && *q != '\n' && *q != '\r')
+            q++;
+
+          if (q > p)
+            {
+              q--;
+              while (q > p && g_ascii_isspace (*q))
+                q--;
+
+              /* the URI ends here, the rest of the line was already looked at */
+              if (q > p)
+                {
+                  q[1] = '\0';
+                  g_ptr_array_add (uris, p);
+                }
+            }
+        }
+
+      p = (next != NULL) ? next + 1 : NULL;
+    }
+
+  return uris;
+}
+
+
+
+/* returns the value of the hex digit @c, or -1 */
+static inline gint
+thunar_g_file_list_hex_value (gchar c)
+{
+  return g_ascii_isxdigit (c) ? g_ascii_xdigit_value (c) : -1;
+}
+
+
+
+/* creates the GFile for @uri like g_file_new_for_uri(), decoding local paths in place */
+static GFile *
+thunar_g_file_new_for_list_uri (gchar *uri)
+{
+  const gchar *r;
+  gchar       *w;
+  gint         hi;
+  gint         lo;
+
+  /* only plain local URIs without a host take the fast path, see g_filename_from_uri() */
+  if (strncmp (uri, "file:///", 8) != 0)
+    return g_file_new_for_uri (uri);
+
+  /* the escapes g_filename_from_uri() refuses are left to it as well */
+  for (r = uri + 7; *r != '\0'; ++r)
+    {
+      if (*r == '#')
+        return g_file_new_for_uri (uri);
+
+      if (*r == '%')
+        {
+          hi = thunar_g_file_list_hex_value (r[1]);
+          lo = (hi >= 0) ? thunar_g_file_list_hex_value (r[2]) : -1;
+          if (lo < 0 || (hi == 0 && lo == 0) || (hi == 2 && lo == 15))
+            return g_file_new_for_uri (uri);
+          r += 2;
+        }
+    }
+
+  /* decode the path over the URI */
+  for (r = uri + 7, w = uri; *r != '\0'; ++r, ++w)
+    {
+      if (*r == '%')
+        {
+          *w = (gchar) ((g_ascii_xdigit_value (r[1]) << 4) | g_ascii_xdigit_value (r[2]));
+          r += 2;
+        }
+      else
+        {
+          *w = *r;
+        }
+    }
+  *w = '\0';
+
+  return g_file_new_for_path (uri);
+}
+
+
+
+static void
+thunar_g_file_list_parse_chunk (gpointer data,
+                                gpointer user_data)
+{
+  ThunarGFileListParse *parse = user_data;
+  guint                 n = (GPOINTER_TO_UINT (data) - 1) * THUNAR_G_FILE_LIST_PARSE_CHUNK;
+  guint                 end = MIN (n + THUNAR_G_FILE_LIST_PARSE_CHUNK, parse->uris->len);
+
+  for (; n < end; ++n)
+    parse->files[n] = thunar_g_file_new_for_list_uri (g_ptr_array_index (parse->uris, n));
+}
+
+
+
 /**
  * thunar_g_file_list_new_from_string:
  * @string : a string representation of an URI list.
@@ -872,16 +1957,44 @@ thunar_g_file_compare_checksum (GFile        *file_a,
 GList *
 thunar_g_file_list_new_from_string (const gchar *string)
 {
-  GList  *list = NULL;
-  gchar **uris;
-  gsize   n;
+  ThunarGFileListParse parse;
+  GThreadPool         *pool;
+  GList               *list = NULL;
+  gchar               *buffer;
+  guint                n;
+
+  _thunar_return_val_if_fail (string != NULL, NULL);
 
-  uris = g_uri_list_extract_uris (string);
+  /* the URIs are cut out of a copy of the string, and decoded in place */
+  buffer = g_strdup (string);
+  parse.uris = thunar_g_file_list_split_uris (buffer);
+  parse.files = g_new (GFile *, MAX (parse.uris->len, 1));
+
+  if (parse.uris->len >= 2 * THUNAR_G_FILE_LIST_PARSE_CHUNK)
+    {
+      /* a large drop or paste, creating the GFiles takes longer than splitting the list.
+       * The pool cannot take a NULL pointer, so the chunks are numbered from one */
+      pool = g_thread_pool_new (thunar_g_file_list_parse_chunk, &parse,
+                                MIN ((parse.uris->len + THUNAR_G_FILE_LIST_PARSE_CHUNK - 1) / THUNAR_G_FILE_LIST_PARSE_CHUNK,
+                                     g_get_num_processors ()),
+                                FALSE, NULL);
+      for (n = 0; n < parse.uris->len; n += THUNAR_G_FILE_LIST_PARSE_CHUNK)
+        g_thread_pool_push (pool, GUINT_TO_POINTER (n / THUNAR_G_FILE_LIST_PARSE_CHUNK + 1), NULL);
+      g_thread_pool_free (pool, FALSE, TRUE);
+    }
+  else
+    {
+      for (n = 0; n < parse.uris->len; ++n)
+        parse.files[n] = thunar_g_file_new_for_list_uri (g_ptr_array_index (parse.uris, n));
+    }
 
-  for (n = 0; uris != NULL && uris[n] != NULL; ++n)
-    list = g_list_append (list, g_file_new_for_uri (uris[n]));
+  /* g_list_append() would take quadratic time */
+  for (n = parse.uris->len; n > 0; --n)
+    list = g_list_prepend (list, parse.files[n - 1]);
 
-  g_strfreev (uris);
+  g_free (parse.files);
+  g_ptr_array_unref (parse.uris);
+  g_free (buffer);
 
   return list;
 }
@@ -1023,6 +2136,8 @@ thunar_g_app_info_launch (GAppInfo          *info,
   gchar        *new_path = NULL;
   gchar        *old_path = NULL;
   gboolean      skip_app_info_update;
+  GHashTable   *checked_types;
+  gchar        *type_key;
 
   _thunar_return_val_if_fail (G_IS_APP_INFO (info), FALSE);
   _thunar_return_val_if_fail (working_directory == NULL || G_IS_FILE (working_directory), FALSE);
@@ -1053,6 +2168,9 @@ thunar_g_app_info_launch (GAppInfo          *info,
   /* if successful, remember the application as last used for the file types */
   if (result == TRUE)
     {
+      /* the answer is the same for all files of a content type, check it once per type */
+      checked_types = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
       for (lp = path_list; lp != NULL; lp = lp->next)
         {
           gboolean update_app_info = !skip_app_info_update;
@@ -1063,6 +2181,14 @@ thunar_g_app_info_launch (GAppInfo          *info,
 
           content_type = thunar_file_get_content_type (file);
 
+          /* files without a local path may have another default application */
+          type_key = g_strconcat (g_file_peek_path (lp->data) != NULL ? "path:" : "uri:", content_type, NULL);
+          if (!g_hash_table_add (checked_types, type_key))
+            {
+              g_object_unref (file);
+              continue;
+            }
+
           /* determine default application */
           default_app_info = thunar_file_get_default_handler (file);
           if (default_app_info != NULL)
@@ -1076,7 +2202,7 @@ thunar_g_app_info_launch (GAppInfo          *info,
           if (update_app_info)
             {
               /* obtain list of last used applications */
-              recommended_app_infos = g_app_info_get_recommended_for_type (content_type);
+              recommended_app_infos = thunar_app_index_get_recommended_for_type (content_type);
               if (recommended_app_infos != NULL)
                 {
                   /* check if the application is already the last used one
@@ -1084,16 +2210,21 @@ thunar_g_app_info_launch (GAppInfo          *info,
                   if (g_app_info_equal (info, recommended_app_infos->data))
                     update_app_info = FALSE;
 
-                  g_list_free (recommended_app_infos);
+                  g_list_free_full (recommended_app_infos, g_object_unref);
                 }
             }
 
           /* emit "changed" on the file if we successfully changed the last used application */
           if (update_app_info && g_app_info_set_as_last_used_for_type (info, content_type, NULL))
-            thunar_file_changed (file);
+            {
+              thunar_app_index_invalidate ();
+              thunar_file_changed (file);
+            }
 
           g_object_unref (file);
         }
+
+      g_hash_table_destroy (checked_types);
     }
 
   /* check if we need to reset the working directory to the one Thunar was
@@ -1198,6 +2329,11 @@ thunar_g_file_is_on_local_device (GFile *file)
 
   if (g_file_has_uri_scheme (file, "file") == FALSE)
     return FALSE;
+
+  /* a prefix match of the path, without any IO */
+  if (thunar_mount_table_lookup_local (file, &is_local))
+    return is_local;
+
   for (target_file  = g_object_ref (file);
        target_file != NULL;
        target_file  = target_parent)
@@ -1439,6 +2575,64 @@ thunar_g_file_is_empty (GFile *file)
 
 
 
+/**
+ * thunar_g_file_has_children:
+ * @file : a #GFile for a directory.
+ *
+ * Checks whether the directory @file contains anything, as cheap as
+ * possible. On local filesystems, a directory with more than two links
+ * has sub folders, so it is not read at all; otherwise only the name of
+ * the first entry is read, without querying any information about it.
+ *
+ * Return value: %TRUE if @file has children, %FALSE if it is empty or
+ *               cannot be read.
+ **/
+gboolean
+thunar_g_file_has_children (GFile *file)
+{
+  GFileEnumerator *enumerator;
+  GFileInfo       *info;
+  gboolean         has_children = FALSE;
+  GStatBuf         statb;
+  gchar           *path;
+  GDir            *dir;
+
+  _thunar_return_val_if_fail (G_IS_FILE (file), FALSE);
+
+  path = g_file_get_path (file);
+  if (path != NULL)
+    {
+      /* every sub folder links back to its parent with its ".." entry,
+       * on the filesystems counting those links (btrfs keeps 1) */
+      if (g_stat (path, &statb) == 0 && S_ISDIR (statb.st_mode) && statb.st_nlink > 2)
+        has_children = TRUE;
+      else if ((dir = g_dir_open (path, 0, NULL)) != NULL)
+        {
+          /* skips "." and ".." */
+          has_children = (g_dir_read_name (dir) != NULL);
+          g_dir_close (dir);
+        }
+
+      g_free (path);
+      return has_children;
+    }
+
+  enumerator = g_file_enumerate_children (file, G_FILE_ATTRIBUTE_STANDARD_NAME,
+                                          G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                          NULL, NULL);
+  if (enumerator == NULL)
+    return FALSE;
+
+  if (g_file_enumerator_iterate (enumerator, &info, NULL, NULL, NULL) && info != NULL)
+    has_children = TRUE;
+
+  g_object_unref (enumerator);
+
+  return has_children;
+}
+
+
+
 static GFileInfo*
 thunar_g_file_get_content_type_querry_info (GFile *gfile,
                                             GError *err)
@@ -1629,6 +2823,107 @@ thunar_g_file_info_get_attribute (GFileInfo   *info,
 
 
 
+static void
+thunar_g_file_flush_metadata (gboolean async)
+{
+  GHashTableIter  iter;
+  GHashTable     *pending;
+  gpointer        file;
+  gpointer        info;
+
+  G_LOCK (metadata_pending);
+  pending = g_steal_pointer (&metadata_pending);
+  G_UNLOCK (metadata_pending);
+
+  if (pending == NULL)
+    return;
+
+  /* a single write per file, with all of its pending attributes */
+  g_hash_table_iter_init (&iter, pending);
+  while (g_hash_table_iter_next (&iter, &file, &info))
+    {
+      if (!g_file_info_has_namespace (info, "metadata"))
+        continue;
+
+      if (async)
+        {
+          g_file_set_attributes_async (file, info,
+                                       G_FILE_QUERY_INFO_NONE,
+                                       G_PRIORITY_DEFAULT,
+                                       NULL,
+                                       thunar_g_file_set_metadata_setting_finish,
+                                       NULL);
+        }
+      else
+        {
+          g_file_set_attributes_from_info (file, info,
+                                           G_FILE_QUERY_INFO_NONE,
+                                           NULL,
+                                           NULL);
+        }
+    }
+
+  g_hash_table_destroy (pending);
+}
+
+
+
+static gboolean
+thunar_g_file_flush_metadata_timeout (gpointer user_data)
+{
+  G_LOCK (metadata_pending);
+  metadata_flush_id = 0;
+  G_UNLOCK (metadata_pending);
+
+  thunar_g_file_flush_metadata (TRUE);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+/* forgets a buffered write of @attr_name for @file, which a direct write replaces */
+static void
+thunar_g_file_drop_pending_metadata (GFile       *file,
+                                     const gchar *attr_name)
+{
+  GFileInfo *pending;
+
+  G_LOCK (metadata_pending);
+  if (metadata_pending != NULL)
+    {
+      pending = g_hash_table_lookup (metadata_pending, file);
+      if (pending != NULL)
+        g_file_info_remove_attribute (pending, attr_name);
+    }
+  G_UNLOCK (metadata_pending);
+}
+
+
+
+/**
+ * thunar_g_file_flush_metadata_settings:
+ *
+ * Writes the buffered asynchronous metadata settings of all files right
+ * away, blocking until they are stored. Called before the application
+ * quits, so the last changes are not lost.
+ **/
+void
+thunar_g_file_flush_metadata_settings (void)
+{
+  G_LOCK (metadata_pending);
+  if (metadata_flush_id != 0)
+    {
+      g_source_remove (metadata_flush_id);
+      metadata_flush_id = 0;
+    }
+  G_UNLOCK (metadata_pending);
+
+  thunar_g_file_flush_metadata (FALSE);
+}
+
+
+
 /**
  * thunar_g_file_set_metadata_setting:
  * @file          : a #GFile instance.
@@ -1636,10 +2931,14 @@ thunar_g_file_info_get_attribute (GFileInfo   *info,
  * @type          : #ThunarGType of the metadata
  * @setting_name  : the name of the setting to set
  * @setting_value : the value to set
- * @async         : whether g_file_set_attributes_async or g_file_set_attributes_from_info should be used
+ * @async         : whether the write is buffered or stored right away
  *
  * Sets the setting @setting_name of @file to @setting_value and stores it in
  * the @file<!---->s metadata.
+ *
+ * Asynchronous writes are buffered for a moment and flushed with a single
+ * write per file, so that a later write of the same setting replaces the
+ * pending one instead of reaching the metadata daemon as well.
  **/
 void
 thunar_g_file_set_metadata_setting (GFile       *file,
@@ -1663,27 +2962,90 @@ thunar_g_file_set_metadata_setting (GFile       *file,
   if (setting_value)
     thunar_g_file_info_set_attribute (info, type, attr_name, setting_value);
 
-  /* send meta data to the daemon. this call is needed to store the new value of
-   * the attribute in the file system */
-  info_new = g_file_info_new ();
-  thunar_g_file_info_set_attribute (info_new, type, attr_name, setting_value);
   if (async)
     {
-      g_file_set_attributes_async (file, info_new,
-                                   G_FILE_QUERY_INFO_NONE,
-                                   G_PRIORITY_DEFAULT,
-                                   NULL,
-                                   thunar_g_file_set_metadata_setting_finish,
-                                   NULL);
+      /* queue the value for the daemon, replacing any pending one */
+      G_LOCK (metadata_pending);
+      if (metadata_pending == NULL)
+        metadata_pending = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal, g_object_unref, g_object_unref);
+
+      info_new = g_hash_table_lookup (metadata_pending, file);
+      if (info_new == NULL)
+        {
+          info_new = g_file_info_new ();
+          g_hash_table_insert (metadata_pending, g_object_ref (file), info_new);
+        }
+      thunar_g_file_info_set_attribute (info_new, type, attr_name, setting_value);
+
+      if (metadata_flush_id == 0)
+        metadata_flush_id = g_timeout_add (THUNAR_METADATA_FLUSH_DELAY, thunar_g_file_flush_metadata_timeout, NULL);
+      G_UNLOCK (metadata_pending);
     }
   else
     {
+      /* send meta data to the daemon. this call is needed to store the new value of
+       * the attribute in the file system */
+      thunar_g_file_drop_pending_metadata (file, attr_name);
+      info_new = g_file_info_new ();
+      thunar_g_file_info_set_attribute (info_new, type, attr_name, setting_value);
       g_file_set_attributes_from_info (file, info_new,
                                        G_FILE_QUERY_INFO_NONE,
                                        NULL,
                                        NULL);
+      g_object_unref (G_OBJECT (info_new));
     }
   g_free (attr_name);
+}
+
+
+
+/**
+ * thunar_g_file_set_metadata_settings:
+ * @file                : a #GFile instance.
+ * @info                : Additional #GFileInfo instance to update
+ * @type                : #ThunarGType of the metadata
+ * @setting_value_pairs : a #GList of %NULL-terminated string arrays,
+ *                        holding a setting name and its value each
+ *
+ * Sets all settings of @setting_value_pairs for @file, and stores them in
+ * the @file<!---->s metadata with a single write.
+ **/
+void
+thunar_g_file_set_metadata_settings (GFile       *file,
+                                     GFileInfo   *info,
+                                     ThunarGType  type,
+                                     GList       *setting_value_pairs)
+{
+  GFileInfo *info_new;
+  gchar     *attr_name;
+  gchar    **pair;
+  GList     *lp;
+
+  _thunar_return_if_fail (G_IS_FILE (file));
+  _thunar_return_if_fail (G_IS_FILE_INFO (info));
+
+  if (setting_value_pairs == NULL)
+    return;
+
+  info_new = g_file_info_new ();
+  for (lp = setting_value_pairs; lp != NULL; lp = lp->next)
+    {
+      pair = lp->data;
+      attr_name = g_strdup_printf ("metadata::%s", pair[0]);
+
+      /* update the in-memory info, like thunar_g_file_set_metadata_setting() */
+      if (pair[1] != NULL)
+        thunar_g_file_info_set_attribute (info, type, attr_name, pair[1]);
+
+      thunar_g_file_drop_pending_metadata (file, attr_name);
+      thunar_g_file_info_set_attribute (info_new, type, attr_name, pair[1]);
+      g_free (attr_name);
+    }
+
+  g_file_set_attributes_from_info (file, info_new,
+                                   G_FILE_QUERY_INFO_NONE,
+                                   NULL,
+                                   NULL);
   g_object_unref (G_OBJECT (info_new));
 }
 
@@ -1718,6 +3080,7 @@ thunar_g_file_clear_metadata_setting (GFile       *file,
     }
 
   g_file_info_remove_attribute (info, attr_name);
+  thunar_g_file_drop_pending_metadata (file, attr_name);
   g_file_set_attribute (file, attr_name, G_FILE_ATTRIBUTE_TYPE_INVALID,
                         NULL, G_FILE_QUERY_INFO_NONE, NULL, NULL);
   g_free (attr_name);
@@ -1725,6 +3088,59 @@ thunar_g_file_clear_metadata_setting (GFile       *file,
 
 
 
+/**
+ * thunar_g_file_clear_metadata_settings:
+ * @file          : a #GFile instance.
+ * @info          : Additional #GFileInfo instance to update
+ * @setting_names : a #GList of setting names
+ *
+ * Clears all metadata settings of @setting_names which are set for @file,
+ * with a single write.
+ **/
+void
+thunar_g_file_clear_metadata_settings (GFile     *file,
+                                       GFileInfo *info,
+                                       GList     *setting_names)
+{
+  GFileInfo *info_new = NULL;
+  gchar     *attr_name;
+  GList     *lp;
+
+  _thunar_return_if_fail (G_IS_FILE (file));
+
+  if (info == NULL)
+    return;
+
+  for (lp = setting_names; lp != NULL; lp = lp->next)
+    {
+      attr_name = g_strdup_printf ("metadata::%s", (const gchar *) lp->data);
+
+      if (g_file_info_has_attribute (info, attr_name))
+        {
+          g_file_info_remove_attribute (info, attr_name);
+          thunar_g_file_drop_pending_metadata (file, attr_name);
+
+          /* an invalid attribute type unsets the attribute */
+          if (info_new == NULL)
+            info_new = g_file_info_new ();
+          g_file_info_set_attribute (info_new, attr_name, G_FILE_ATTRIBUTE_TYPE_INVALID, NULL);
+        }
+
+      g_free (attr_name);
+    }
+
+  if (info_new == NULL)
+    return;
+
+  g_file_set_attributes_from_info (file, info_new,
+                                   G_FILE_QUERY_INFO_NONE,
+                                   NULL,
+                                   NULL);
+  g_object_unref (G_OBJECT (info_new));
+}
+
+
+
 /**
  * thunar_file_get_metadata_setting:
  * @file         : a #GFile instance.
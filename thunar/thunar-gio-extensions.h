@@ -86,11 +86,37 @@ gboolean     thunar_g_file_copy                     (GFile                *sourc
                                                      gpointer              progress_callback_data,
                                                      GError              **error);
 
+gboolean     thunar_g_file_copy_resume              (GFile                *source,
+                                                     GFile                *destination,
+                                                     GFileCopyFlags        flags,
+                                                     goffset               offset,
+                                                     GCancellable         *cancellable,
+                                                     GFileProgressCallback progress_callback,
+                                                     gpointer              progress_callback_data,
+                                                     GError              **error);
+
+gboolean     thunar_g_file_copy_with_checksum       (GFile                *source,
+                                                     GFile                *destination,
+                                                     GFileCopyFlags        flags,
+                                                     gboolean              use_partial,
+                                                     GCancellable         *cancellable,
+                                                     GFileProgressCallback progress_callback,
+                                                     gpointer              progress_callback_data,
+                                                     GChecksumType         checksum_type,
+                                                     gchar               **checksum_return,
+                                                     GError              **error);
+
+gchar       *thunar_g_file_create_checksum          (GFile                *file,
+                                                     GChecksumType         checksum_type,
+                                                     GCancellable         *cancellable,
+                                                     GError              **error);
+
 gboolean     thunar_g_file_compare_checksum         (GFile                *file_a,
                                                      GFile                *file_b,
                                                      GCancellable         *cancellable,
                                                      GError              **error);
 gboolean     thunar_g_file_is_empty                 (GFile                *file);
+gboolean     thunar_g_file_has_children             (GFile                *file);
 
 /**
  * THUNAR_TYPE_G_FILE_LIST:
@@ -138,9 +164,17 @@ void         thunar_g_file_set_metadata_setting        (GFile             *file,
                                                         const gchar       *setting_name,
                                                         const gchar       *setting_value,
                                                         gboolean           async);
+void         thunar_g_file_set_metadata_settings       (GFile             *file,
+                                                        GFileInfo         *info,
+                                                        ThunarGType        type,
+                                                        GList             *setting_value_pairs);
 void         thunar_g_file_clear_metadata_setting      (GFile             *file,
                                                         GFileInfo         *info,
                                                         const gchar       *setting_name);
+void         thunar_g_file_clear_metadata_settings     (GFile             *file,
+                                                        GFileInfo         *info,
+                                                        GList             *setting_names);
+void         thunar_g_file_flush_metadata_settings     (void);
  gchar      *thunar_g_file_get_metadata_setting        (GFile             *file,
                                                         GFileInfo         *info,
                                                         ThunarGType        type,
@@ -21,6 +21,7 @@
 #include "config.h"
 #endif
 
+#include "thunar/thunar-frecency.h"
 #include "thunar/thunar-gobject-extensions.h"
 #include "thunar/thunar-gtk-extensions.h"
 #include "thunar/thunar-history.h"
@@ -278,6 +279,9 @@ thunar_history_set_current_directory (ThunarNavigator *navigator,
   /* notify listeners */
   if (current_directory != NULL)
     {
+      /* remember the visit across sessions */
+      thunar_frecency_add_visit (thunar_file_get_file (current_directory));
+
       g_object_notify (G_OBJECT (history), "current-directory");
       g_signal_emit (G_OBJECT (history), history_signals[HISTORY_CHANGED], 0, history);
     }
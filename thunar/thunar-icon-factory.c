@@ -30,16 +30,27 @@
 #include <string.h>
 #endif
 
+#include "thunar/thunar-cache-registry.h"
 #include "thunar/thunar-gobject-extensions.h"
 #include "thunar/thunar-icon-factory.h"
 #include "thunar/thunar-preferences.h"
 #include "thunar/thunar-private.h"
+#include "thunar/thunar-thumbnail-pack.h"
 #include "thunar/thunar-util.h"
 
 
 
-/* the timeout until the sweeper is run (in seconds) */
-#define THUNAR_ICON_FACTORY_SWEEP_TIMEOUT (30)
+/* icons up to this size (in device pixels) are kept for the lifetime of the factory */
+#define THUNAR_ICON_FACTORY_SMALL_ICON_SIZE (32)
+
+/* maximum memory (in bytes) used by the larger cached icons */
+#define THUNAR_ICON_FACTORY_CACHE_BUDGET (32 * 1024 * 1024)
+
+/* maximum number of threads decoding thumbnails in the background */
+#define THUNAR_ICON_FACTORY_DECODE_THREADS (4)
+
+/* maximum number of decoded thumbnail sizes kept per file */
+#define THUNAR_ICON_FACTORY_MAX_THUMBNAILS (4)
 
 
 
@@ -56,11 +67,11 @@ enum
 
 
 
-typedef struct _ThunarIconKey ThunarIconKey;
+typedef struct _ThunarIconKey   ThunarIconKey;
+typedef struct _ThunarIconEntry ThunarIconEntry;
 
 
 
-static void       thunar_icon_factory_dispose               (GObject                  *object);
 static void       thunar_icon_factory_finalize              (GObject                  *object);
 static void       thunar_icon_factory_get_property          (GObject                  *object,
                                                              guint                     prop_id,
@@ -74,12 +85,14 @@ static gboolean   thunar_icon_factory_changed               (GSignalInvocationHi
                                                              guint                     n_param_values,
                                                              const GValue             *param_values,
                                                              gpointer                  user_data);
-static gboolean   thunar_icon_factory_sweep_timer           (gpointer                  user_data);
-static void       thunar_icon_factory_sweep_timer_destroy   (gpointer                  user_data);
 static GdkPixbuf *thunar_icon_factory_load_from_file        (ThunarIconFactory        *factory,
                                                              const gchar              *path,
                                                              gint                      size,
                                                              gint                      scale_factor);
+static GdkPixbuf *thunar_icon_factory_load_image            (const gchar              *path,
+                                                             gint                      size,
+                                                             gint                      scale_factor,
+                                                             gboolean                  draw_frames);
 static GdkPixbuf *thunar_icon_factory_lookup_icon           (ThunarIconFactory        *factory,
                                                              const gchar              *name,
                                                              gint                      size,
@@ -88,10 +101,27 @@ static GdkPixbuf *thunar_icon_factory_lookup_icon           (ThunarIconFactory
 static guint      thunar_icon_key_hash                      (gconstpointer             data);
 static gboolean   thunar_icon_key_equal                     (gconstpointer             a,
                                                              gconstpointer             b);
-static void       thunar_icon_key_free                      (gpointer                  data);
+static void       thunar_icon_entry_free                    (gpointer                  data);
 static GdkPixbuf *thunar_icon_factory_load_fallback         (ThunarIconFactory        *factory,
                                                              gint                      size,
                                                              gint                      scale_factor);
+static void       thunar_icon_factory_reload_finished       (GObject                  *object,
+                                                             GAsyncResult             *result,
+                                                             gpointer                  user_data);
+static void       thunar_icon_factory_decode_thumbnail      (gpointer                  data,
+                                                             gpointer                  user_data);
+static GdkPixbuf *thunar_icon_factory_load_file_icon_real   (ThunarIconFactory        *factory,
+                                                             ThunarFile               *file,
+                                                             ThunarFileIconState       icon_state,
+                                                             gint                      icon_size,
+                                                             gint                      scale_factor,
+                                                             gboolean                  deferred);
+static gsize      thunar_icon_factory_cache_size            (gpointer                  user_data);
+static void       thunar_icon_factory_cache_shed            (gpointer                  user_data,
+                                                             GMemoryMonitorWarningLevel level);
+static gsize      thunar_icon_factory_thumbnails_size       (gpointer                  user_data);
+static void       thunar_icon_factory_thumbnails_shed       (gpointer                  user_data,
+                                                             GMemoryMonitorWarningLevel level);
 
 
 
@@ -106,8 +136,19 @@ struct _ThunarIconFactory
 
   ThunarPreferences   *preferences;
 
+  /* small icons, never dropped but reloaded when the theme changes */
   GHashTable          *icon_cache;
 
+  /* larger icons, dropped least recently used first once over budget */
+  GHashTable          *lru_cache;
+  GQueue               lru_queue;
+  gsize                lru_size;
+
+  /* cache statistics */
+  guint64              n_hits;
+  guint64              n_misses;
+  guint64              n_evictions;
+
   GtkIconTheme        *icon_theme;
 
   ThunarThumbnailMode  thumbnail_mode;
@@ -119,12 +160,14 @@ struct _ThunarIconFactory
   /* maximum file size (in bytes) allowed to be thumbnailed */
   guint64              thumbnail_max_file_size;
 
-  guint                sweep_timer_id;
-
   gulong               changed_hook_id;
 
   /* stamp that gets bumped when the theme changes */
   guint                theme_stamp;
+
+  /* number of icons being reloaded from a new theme */
+  guint                n_reloads;
+  guint                redraw_id;
 };
 
 struct _ThunarIconKey
@@ -134,6 +177,16 @@ struct _ThunarIconKey
   gint   scale_factor;
 };
 
+struct _ThunarIconEntry
+{
+  ThunarIconKey  key;
+  GdkPixbuf     *pixbuf;
+  gsize          size;   /* in bytes */
+  GList          link;   /* in the lru_queue, most recently used first */
+  guint          stamp;  /* theme_stamp the icon was loaded with */
+  guint          reload_stamp;
+};
+
 typedef struct
 {
   ThunarFileIconState   icon_state;
@@ -144,10 +197,47 @@ typedef struct
 }
 ThunarIconStore;
 
+typedef struct
+{
+  gint                  icon_size;
+  gint                  scale_factor;
+  gboolean              draw_frames;
+  guint                 serial;       /* of the pending decode request, 0 once it finished */
+  GdkPixbuf            *icon;         /* the decoded thumbnail, or %NULL if there is none */
+}
+ThunarIconThumbnail;
+
+typedef struct
+{
+  ThunarFile           *file;
+  gchar                *uri;
+  gboolean              is_directory;
+  guint64               mtime;
+  ThunarThumbnailSize   thumbnail_size;
+  gint                  icon_size;
+  gint                  scale_factor;
+  gboolean              draw_frames;
+  guint                 serial;
+  GdkPixbuf            *icon;
+}
+ThunarIconDecode;
+
+typedef struct
+{
+  ThunarIconFactory    *factory;
+  ThunarIconKey         key;
+  guint                 stamp;
+}
+ThunarIconReload;
+
 
 
 static GQuark thunar_icon_factory_quark = 0;
 static GQuark thunar_icon_factory_store_quark = 0;
+static GQuark thunar_icon_factory_thumbnails_quark = 0;
+
+/* shared by all factories, decodes cached thumbnails off the main thread */
+static GThreadPool *thunar_icon_factory_decode_pool = NULL;
 
 
 
@@ -161,9 +251,13 @@ thunar_icon_factory_class_init (ThunarIconFactoryClass *klass)
   GObjectClass *gobject_class;
 
   thunar_icon_factory_store_quark = g_quark_from_static_string ("thunar-icon-factory-store");
+  thunar_icon_factory_thumbnails_quark = g_quark_from_static_string ("thunar-icon-factory-thumbnails");
+
+  /* the decoded thumbnails of all files are shed once memory gets scarce */
+  thunar_cache_registry_add ("thumbnails", G_MEMORY_MONITOR_WARNING_LEVEL_MEDIUM,
+                             thunar_icon_factory_thumbnails_size, thunar_icon_factory_thumbnails_shed, NULL);
 
   gobject_class = G_OBJECT_CLASS (klass);
-  gobject_class->dispose = thunar_icon_factory_dispose;
   gobject_class->finalize = thunar_icon_factory_finalize;
   gobject_class->get_property = thunar_icon_factory_get_property;
   gobject_class->set_property = thunar_icon_factory_set_property;
@@ -249,43 +343,41 @@ thunar_icon_factory_init (ThunarIconFactory *factory)
   factory->thumbnail_size = THUNAR_THUMBNAIL_SIZE_NORMAL;
 
   /* connect emission hook for the "changed" signal on the GtkIconTheme class. We use the emission
-   * hook way here, because that way we can make sure that the icon cache is definetly cleared
+   * hook way here, because that way we can make sure that the icon cache is definetly outdated
    * before any other part of the application gets notified about the icon theme change.
    */
   factory->changed_hook_id = g_signal_add_emission_hook (g_signal_lookup ("changed", GTK_TYPE_ICON_THEME),
                                                          0, thunar_icon_factory_changed, factory, NULL);
 
-  /* allocate the hash table for the icon cache */
+  /* allocate the hash tables for the icon caches, the entries own their keys */
   factory->icon_cache = g_hash_table_new_full (thunar_icon_key_hash, thunar_icon_key_equal,
-                                               thunar_icon_key_free, g_object_unref);
+                                               NULL, thunar_icon_entry_free);
+  factory->lru_cache = g_hash_table_new_full (thunar_icon_key_hash, thunar_icon_key_equal,
+                                              NULL, thunar_icon_entry_free);
+  g_queue_init (&factory->lru_queue);
+
+  /* the icons are loaded again from the theme, which is cheap */
+  thunar_cache_registry_add ("icons", G_MEMORY_MONITOR_WARNING_LEVEL_LOW,
+                             thunar_icon_factory_cache_size, thunar_icon_factory_cache_shed, factory);
 }
 
 
 
 static void
-thunar_icon_factory_dispose (GObject *object)
+thunar_icon_factory_finalize (GObject *object)
 {
   ThunarIconFactory *factory = THUNAR_ICON_FACTORY (object);
 
   _thunar_return_if_fail (THUNAR_IS_ICON_FACTORY (factory));
 
-  if (G_UNLIKELY (factory->sweep_timer_id != 0))
-    g_source_remove (factory->sweep_timer_id);
-
-  (*G_OBJECT_CLASS (thunar_icon_factory_parent_class)->dispose) (object);
-}
-
-
-
-static void
-thunar_icon_factory_finalize (GObject *object)
-{
-  ThunarIconFactory *factory = THUNAR_ICON_FACTORY (object);
+  thunar_cache_registry_remove (factory);
 
-  _thunar_return_if_fail (THUNAR_IS_ICON_FACTORY (factory));
+  if (factory->redraw_id != 0)
+    g_source_remove (factory->redraw_id);
 
-  /* clear the icon cache hash table */
+  /* clear the icon cache hash tables */
   g_hash_table_destroy (factory->icon_cache);
+  g_hash_table_destroy (factory->lru_cache);
 
   /* remove the "changed" emission hook from the GtkIconTheme class */
   g_signal_remove_emission_hook (g_signal_lookup ("changed", GTK_TYPE_ICON_THEME), factory->changed_hook_id);
@@ -385,10 +477,9 @@ thunar_icon_factory_changed (GSignalInvocationHint *ihint,
 {
   ThunarIconFactory *factory = THUNAR_ICON_FACTORY (user_data);
 
-  /* drop all items from the icon cache */
-  g_hash_table_remove_all (factory->icon_cache);
-
-  /* bump the stamp so all file icons are reloaded */
+  /* bump the stamp so all file icons are reloaded. The cached icons are
+   * kept and shown until they are reloaded, when they are drawn next, see
+   * thunar_icon_factory_reload(), so the visible ones come first */
   factory->theme_stamp++;
 
   /* keep the emission hook alive */
@@ -397,36 +488,287 @@ thunar_icon_factory_changed (GSignalInvocationHint *ihint,
 
 
 
-static gboolean
-thunar_icon_check_sweep (ThunarIconKey *key,
-                         GdkPixbuf     *pixbuf)
+static void
+thunar_icon_factory_evict (ThunarIconFactory *factory)
+{
+  ThunarIconEntry *entry;
+  GList           *lp;
+
+  /* drop the least recently used icons until we are within budget */
+  while (factory->lru_size > THUNAR_ICON_FACTORY_CACHE_BUDGET
+         && (lp = g_queue_peek_tail_link (&factory->lru_queue)) != NULL)
+    {
+      entry = lp->data;
+      g_queue_unlink (&factory->lru_queue, lp);
+      factory->lru_size -= entry->size;
+      factory->n_evictions++;
+
+      /* frees the entry */
+      g_hash_table_remove (factory->lru_cache, &entry->key);
+    }
+}
+
+
+
+static gsize
+thunar_icon_factory_cache_size (gpointer user_data)
+{
+  ThunarIconFactory *factory = THUNAR_ICON_FACTORY (user_data);
+  ThunarIconEntry   *entry;
+  GHashTableIter     iter;
+  gsize              n_bytes = factory->lru_size;
+
+  g_hash_table_iter_init (&iter, factory->icon_cache);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry))
+    n_bytes += entry->size;
+
+  return n_bytes;
+}
+
+
+
+static void
+thunar_icon_factory_cache_shed (gpointer                   user_data,
+                                GMemoryMonitorWarningLevel level)
+{
+  ThunarIconFactory *factory = THUNAR_ICON_FACTORY (user_data);
+
+  /* the larger icons go first */
+  factory->n_evictions += g_hash_table_size (factory->lru_cache);
+  g_hash_table_remove_all (factory->lru_cache);
+  g_queue_init (&factory->lru_queue);
+  factory->lru_size = 0;
+
+  /* the small ones are used by every view, and only dropped when nearly out of memory */
+  if (level >= G_MEMORY_MONITOR_WARNING_LEVEL_CRITICAL)
+    g_hash_table_remove_all (factory->icon_cache);
+}
+
+
+
+static inline gboolean
+thunar_icon_key_is_small (const ThunarIconKey *key)
+{
+  return key->size * key->scale_factor <= THUNAR_ICON_FACTORY_SMALL_ICON_SIZE;
+}
+
+
+
+static ThunarIconEntry*
+thunar_icon_factory_cache_find (ThunarIconFactory   *factory,
+                                const ThunarIconKey *key)
+{
+  if (thunar_icon_key_is_small (key))
+    return g_hash_table_lookup (factory->icon_cache, key);
+  else
+    return g_hash_table_lookup (factory->lru_cache, key);
+}
+
+
+
+static ThunarIconEntry*
+thunar_icon_factory_cache_lookup (ThunarIconFactory   *factory,
+                                  const ThunarIconKey *key)
+{
+  ThunarIconEntry *entry;
+
+  entry = thunar_icon_factory_cache_find (factory, key);
+  if (entry != NULL && !thunar_icon_key_is_small (key))
+    {
+      /* move the icon to the front */
+      g_queue_unlink (&factory->lru_queue, &entry->link);
+      g_queue_push_head_link (&factory->lru_queue, &entry->link);
+    }
+
+  if (entry != NULL)
+    factory->n_hits++;
+  else
+    factory->n_misses++;
+
+  return entry;
+}
+
+
+
+static void
+thunar_icon_factory_cache_insert (ThunarIconFactory *factory,
+                                  const gchar       *name,
+                                  gint               size,
+                                  gint               scale_factor,
+                                  GdkPixbuf         *pixbuf)
+{
+  ThunarIconEntry *entry;
+
+  entry = g_slice_new0 (ThunarIconEntry);
+  entry->key.size = size;
+  entry->key.scale_factor = scale_factor;
+  entry->key.name = g_strdup (name);
+  entry->pixbuf = pixbuf;
+  entry->size = gdk_pixbuf_get_byte_length (pixbuf);
+  entry->link.data = entry;
+  entry->stamp = factory->theme_stamp;
+  entry->reload_stamp = factory->theme_stamp;
+
+  if (thunar_icon_key_is_small (&entry->key))
+    {
+      /* insert the new icon into the cache */
+      g_hash_table_insert (factory->icon_cache, &entry->key, entry);
+    }
+  else
+    {
+      g_hash_table_insert (factory->lru_cache, &entry->key, entry);
+      g_queue_push_head_link (&factory->lru_queue, &entry->link);
+      factory->lru_size += entry->size;
+
+      thunar_icon_factory_evict (factory);
+    }
+}
+
+
+
+static void
+thunar_icon_factory_cache_remove (ThunarIconFactory *factory,
+                                  ThunarIconEntry   *entry)
+{
+  if (thunar_icon_key_is_small (&entry->key))
+    {
+      g_hash_table_remove (factory->icon_cache, &entry->key);
+    }
+  else
+    {
+      g_queue_unlink (&factory->lru_queue, &entry->link);
+      factory->lru_size -= entry->size;
+
+      /* frees the entry */
+      g_hash_table_remove (factory->lru_cache, &entry->key);
+    }
+}
+
+
+
+static void
+thunar_icon_factory_cache_update (ThunarIconFactory *factory,
+                                  ThunarIconEntry   *entry,
+                                  GdkPixbuf         *pixbuf)
 {
-  return (G_OBJECT (pixbuf)->ref_count == 1);
+  g_object_unref (entry->pixbuf);
+  entry->pixbuf = g_object_ref (pixbuf);
+  entry->stamp = factory->theme_stamp;
+
+  if (thunar_icon_key_is_small (&entry->key))
+    {
+      entry->size = gdk_pixbuf_get_byte_length (pixbuf);
+    }
+  else
+    {
+      factory->lru_size -= entry->size;
+      entry->size = gdk_pixbuf_get_byte_length (pixbuf);
+      factory->lru_size += entry->size;
+
+      thunar_icon_factory_evict (factory);
+    }
 }
 
 
 
 static gboolean
-thunar_icon_factory_sweep_timer (gpointer user_data)
+thunar_icon_factory_redraw (gpointer user_data)
 {
   ThunarIconFactory *factory = THUNAR_ICON_FACTORY (user_data);
+  GList             *toplevels;
+  GList             *lp;
 
-  _thunar_return_val_if_fail (THUNAR_IS_ICON_FACTORY (factory), FALSE);
+  factory->redraw_id = 0;
 
-  /* ditch all icons whose ref_count is 1 */
-  g_hash_table_foreach_remove (factory->icon_cache,
-                               (GHRFunc) (void (*)(void)) thunar_icon_check_sweep,
-                               factory);
+  /* only the visible icons are drawn again, the others are reloaded when they get visible */
+  toplevels = gtk_window_list_toplevels ();
+  for (lp = toplevels; lp != NULL; lp = lp->next)
+    gtk_widget_queue_draw (lp->data);
+  g_list_free (toplevels);
 
-  return FALSE;
+  return G_SOURCE_REMOVE;
 }
 
 
 
 static void
-thunar_icon_factory_sweep_timer_destroy (gpointer user_data)
+thunar_icon_factory_reload_finished (GObject      *object,
+                                     GAsyncResult *result,
+                                     gpointer      user_data)
 {
-  THUNAR_ICON_FACTORY (user_data)->sweep_timer_id = 0;
+  ThunarIconReload  *reload = user_data;
+  ThunarIconFactory *factory = reload->factory;
+  ThunarIconEntry   *entry;
+  GdkPixbuf         *pixbuf;
+
+  pixbuf = gtk_icon_info_load_icon_finish (GTK_ICON_INFO (object), result, NULL);
+
+  factory->n_reloads--;
+
+  /* the theme may have changed again meanwhile, or the icon may have been dropped */
+  entry = thunar_icon_factory_cache_find (factory, &reload->key);
+  if (reload->stamp == factory->theme_stamp && entry != NULL && entry->stamp != factory->theme_stamp)
+    {
+      if (G_LIKELY (pixbuf != NULL))
+        thunar_icon_factory_cache_update (factory, entry, pixbuf);
+      else
+        thunar_icon_factory_cache_remove (factory, entry);
+
+      /* draw the icons that finished in this main loop iteration at once */
+      if (factory->redraw_id == 0)
+        factory->redraw_id = g_idle_add (thunar_icon_factory_redraw, factory);
+    }
+
+  if (pixbuf != NULL)
+    g_object_unref (pixbuf);
+  g_free (reload->key.name);
+  g_object_unref (factory);
+  g_slice_free (ThunarIconReload, reload);
+}
+
+
+
+/* loads the outdated icon of @entry from the new theme, which may drop @entry */
+static void
+thunar_icon_factory_reload (ThunarIconFactory *factory,
+                            ThunarIconEntry   *entry)
+{
+  ThunarIconReload *reload;
+  GtkIconInfo      *icon_info;
+
+  /* already being reloaded */
+  if (entry->reload_stamp == factory->theme_stamp)
+    return;
+  entry->reload_stamp = factory->theme_stamp;
+
+  /* files are no part of the theme */
+  if (G_UNLIKELY (g_path_is_absolute (entry->key.name)))
+    {
+      entry->stamp = factory->theme_stamp;
+      return;
+    }
+
+  /* the lookup is cheap, it is loading the image which takes the time */
+  icon_info = gtk_icon_theme_lookup_icon_for_scale (factory->icon_theme, entry->key.name, entry->key.size,
+                                                    entry->key.scale_factor, GTK_ICON_LOOKUP_FORCE_SIZE);
+  if (G_UNLIKELY (icon_info == NULL))
+    {
+      /* the new theme has no such icon, look for a fallback next time */
+      thunar_icon_factory_cache_remove (factory, entry);
+      return;
+    }
+
+  reload = g_slice_new (ThunarIconReload);
+  reload->factory = g_object_ref (factory);
+  reload->key.name = g_strdup (entry->key.name);
+  reload->key.size = entry->key.size;
+  reload->key.scale_factor = entry->key.scale_factor;
+  reload->stamp = factory->theme_stamp;
+
+  /* decodes the image in a thread */
+  factory->n_reloads++;
+  gtk_icon_info_load_icon_async (icon_info, NULL, thunar_icon_factory_reload_finished, reload);
+  g_object_unref (icon_info);
 }
 
 
@@ -501,13 +843,14 @@ thunar_icon_factory_get_thumbnail_frame (void)
 
 
 
+/* NOTE: may be called from any thread, as long as the frame was loaded before */
 static GdkPixbuf*
-thunar_icon_factory_load_from_file (ThunarIconFactory *factory,
-                                    const gchar       *path,
-                                    gint               size,
-                                    gint               scale_factor)
+thunar_icon_factory_fit_image (GdkPixbuf *pixbuf,
+                               gboolean   is_thumbnail,
+                               gint       size,
+                               gint       scale_factor,
+                               gboolean   draw_frames)
 {
-  GdkPixbuf *pixbuf;
   GdkPixbuf *frame;
   GdkPixbuf *tmp;
   gboolean   needs_frame;
@@ -517,10 +860,6 @@ thunar_icon_factory_load_from_file (ThunarIconFactory *factory,
   gint       height;
   gint       scaled_size = size * scale_factor;
 
-  _thunar_return_val_if_fail (THUNAR_IS_ICON_FACTORY (factory), NULL);
-
-  /* try to load the image from the file */
-  pixbuf = gdk_pixbuf_new_from_file (path, NULL);
   if (G_LIKELY (pixbuf != NULL))
     {
       /* determine the dimensions of the pixbuf */
@@ -528,13 +867,12 @@ thunar_icon_factory_load_from_file (ThunarIconFactory *factory,
       height = gdk_pixbuf_get_height (pixbuf);
 
       needs_frame = FALSE;
-      if (factory->thumbnail_draw_frames)
+      if (draw_frames)
         {
           /* check if we want to add a frame to the image (we really don't
            * want to do this for icons displayed in the details view).
            * */
-          needs_frame = (strstr (path, G_DIR_SEPARATOR_S ".cache/thumbnails" G_DIR_SEPARATOR_S) != NULL)
-                && (size >= 32) && thumbnail_needs_frame (pixbuf, width, height, size);
+          needs_frame = is_thumbnail && (size >= 32) && thumbnail_needs_frame (pixbuf, width, height, size);
         }
 
       /* be sure to make framed thumbnails fit into the size */
@@ -574,6 +912,311 @@ thunar_icon_factory_load_from_file (ThunarIconFactory *factory,
 
 
 
+/* NOTE: may be called from any thread, as long as the frame was loaded before */
+static GdkPixbuf*
+thunar_icon_factory_load_image (const gchar *path,
+                                gint         size,
+                                gint         scale_factor,
+                                gboolean     draw_frames)
+{
+  gboolean is_thumbnail;
+
+  is_thumbnail = (strstr (path, G_DIR_SEPARATOR_S ".cache/thumbnails" G_DIR_SEPARATOR_S) != NULL);
+
+  /* try to load the image from the file */
+  return thunar_icon_factory_fit_image (gdk_pixbuf_new_from_file (path, NULL), is_thumbnail, size, scale_factor, draw_frames);
+}
+
+
+
+/* NOTE: may be called from any thread, as long as the frame was loaded before */
+static GdkPixbuf*
+thunar_icon_factory_load_image_from_bytes (GBytes  *bytes,
+                                           gint     size,
+                                           gint     scale_factor,
+                                           gboolean draw_frames)
+{
+  GInputStream *stream;
+  GdkPixbuf    *pixbuf;
+
+  stream = g_memory_input_stream_new_from_bytes (bytes);
+  pixbuf = gdk_pixbuf_new_from_stream (stream, NULL, NULL);
+  g_object_unref (stream);
+
+  return thunar_icon_factory_fit_image (pixbuf, TRUE, size, scale_factor, draw_frames);
+}
+
+
+
+static GdkPixbuf*
+thunar_icon_factory_load_from_file (ThunarIconFactory *factory,
+                                    const gchar       *path,
+                                    gint               size,
+                                    gint               scale_factor)
+{
+  _thunar_return_val_if_fail (THUNAR_IS_ICON_FACTORY (factory), NULL);
+
+  return thunar_icon_factory_load_image (path, size, scale_factor, factory->thumbnail_draw_frames);
+}
+
+
+
+static gint
+thunar_icon_decode_compare (gconstpointer a,
+                            gconstpointer b,
+                            gpointer      user_data)
+{
+  const ThunarIconDecode *a_decode = a;
+  const ThunarIconDecode *b_decode = b;
+
+  /* the most recent request was drawn last, so it is decoded first */
+  if (a_decode->serial == b_decode->serial)
+    return 0;
+  return (a_decode->serial > b_decode->serial) ? -1 : 1;
+}
+
+
+
+static void
+thunar_icon_thumbnail_free (gpointer data)
+{
+  ThunarIconThumbnail *thumbnail = data;
+
+  if (thumbnail->icon != NULL)
+    g_object_unref (thumbnail->icon);
+  g_slice_free (ThunarIconThumbnail, thumbnail);
+}
+
+
+
+static void
+thunar_icon_thumbnails_free (gpointer data)
+{
+  g_slist_free_full (data, thunar_icon_thumbnail_free);
+}
+
+
+
+static void
+thunar_icon_factory_thumbnails_size_foreach (gpointer data,
+                                             gpointer user_data)
+{
+  ThunarIconThumbnail *thumbnail;
+  GSList              *lp;
+  gsize               *n_bytes = user_data;
+
+  for (lp = g_object_get_qdata (G_OBJECT (data), thunar_icon_factory_thumbnails_quark); lp != NULL; lp = lp->next)
+    {
+      thumbnail = lp->data;
+      if (thumbnail->icon != NULL)
+        *n_bytes += gdk_pixbuf_get_byte_length (thumbnail->icon);
+    }
+}
+
+
+
+static gsize
+thunar_icon_factory_thumbnails_size (gpointer user_data)
+{
+  gsize n_bytes = 0;
+
+  thunar_file_cache_foreach (thunar_icon_factory_thumbnails_size_foreach, &n_bytes);
+
+  return n_bytes;
+}
+
+
+
+static void
+thunar_icon_factory_thumbnails_shed_foreach (gpointer data,
+                                             gpointer user_data)
+{
+  /* the files shown are decoded again when they are drawn next */
+  if (g_object_get_qdata (G_OBJECT (data), thunar_icon_factory_thumbnails_quark) != NULL)
+    thunar_icon_factory_clear_pixmap_cache (data);
+}
+
+
+
+static void
+thunar_icon_factory_thumbnails_shed (gpointer                   user_data,
+                                     GMemoryMonitorWarningLevel level)
+{
+  thunar_file_cache_foreach (thunar_icon_factory_thumbnails_shed_foreach, NULL);
+}
+
+
+
+static ThunarIconThumbnail*
+thunar_icon_factory_find_thumbnail (ThunarIconFactory *factory,
+                                    ThunarFile        *file,
+                                    gint               icon_size,
+                                    gint               scale_factor)
+{
+  ThunarIconThumbnail *thumbnail;
+  GSList              *lp;
+
+  for (lp = g_object_get_qdata (G_OBJECT (file), thunar_icon_factory_thumbnails_quark); lp != NULL; lp = lp->next)
+    {
+      thumbnail = lp->data;
+      if (thumbnail->icon_size == icon_size
+          && thumbnail->scale_factor == scale_factor
+          && thumbnail->draw_frames == factory->thumbnail_draw_frames)
+        return thumbnail;
+    }
+
+  return NULL;
+}
+
+
+
+static gboolean
+thunar_icon_factory_decode_finished (gpointer data)
+{
+  ThunarIconDecode    *decode = data;
+  ThunarIconThumbnail *thumbnail;
+  GSList              *lp;
+
+  /* the thumbnails are dropped when the file changes, so a stale result finds no request */
+  for (lp = g_object_get_qdata (G_OBJECT (decode->file), thunar_icon_factory_thumbnails_quark); lp != NULL; lp = lp->next)
+    {
+      thumbnail = lp->data;
+      if (thumbnail->serial == decode->serial)
+        {
+          thumbnail->serial = 0;
+          thumbnail->icon = g_steal_pointer (&decode->icon);
+
+          /* let the views redraw the file with its thumbnail */
+          if (thumbnail->icon != NULL)
+            g_signal_emit_by_name (decode->file, "thumbnail-updated", decode->thumbnail_size);
+          break;
+        }
+    }
+
+  if (decode->icon != NULL)
+    g_object_unref (decode->icon);
+  g_object_unref (decode->file);
+  g_free (decode->uri);
+  g_slice_free (ThunarIconDecode, decode);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+static void
+thunar_icon_factory_decode_thumbnail (gpointer data,
+                                      gpointer user_data)
+{
+  ThunarIconDecode *decode = data;
+  GBytes           *bytes;
+  gchar            *path;
+
+  /* a revisited folder may have all its thumbnails in a single pack */
+  if (decode->mtime != 0 && !decode->is_directory)
+    {
+      bytes = thunar_thumbnail_pack_lookup (decode->uri, decode->thumbnail_size, decode->mtime);
+      if (bytes != NULL)
+        {
+          decode->icon = thunar_icon_factory_load_image_from_bytes (bytes, decode->icon_size, decode->scale_factor, decode->draw_frames);
+          g_bytes_unref (bytes);
+        }
+
+      if (decode->icon != NULL)
+        {
+          g_idle_add (thunar_icon_factory_decode_finished, decode);
+          return;
+        }
+    }
+
+  path = thunar_util_get_thumbnail_path (decode->uri, decode->is_directory, decode->thumbnail_size);
+
+  /* leave outdated thumbnails to the thumbnailer, which was asked for a new one already */
+  if (path != NULL && (decode->mtime == 0 || !thunar_util_thumbnail_is_stale (path, decode->mtime)))
+    decode->icon = thunar_icon_factory_load_image (path, decode->icon_size, decode->scale_factor, decode->draw_frames);
+
+  g_free (path);
+
+  g_idle_add (thunar_icon_factory_decode_finished, decode);
+}
+
+
+
+/* returns the decoded thumbnail of @file, or %NULL if there is none or it is still being decoded */
+static GdkPixbuf*
+thunar_icon_factory_lookup_thumbnail (ThunarIconFactory  *factory,
+                                      ThunarFile         *file,
+                                      ThunarThumbnailSize thumbnail_size,
+                                      gint                icon_size,
+                                      gint                scale_factor,
+                                      gboolean           *pending)
+{
+  ThunarIconThumbnail *thumbnail;
+  ThunarIconDecode    *decode;
+  static guint         serial = 0;
+  GSList              *thumbnails;
+  GSList              *lp;
+
+  *pending = FALSE;
+
+  thumbnail = thunar_icon_factory_find_thumbnail (factory, file, icon_size, scale_factor);
+  if (thumbnail != NULL)
+    {
+      *pending = (thumbnail->serial != 0);
+      return (thumbnail->icon != NULL) ? g_object_ref (thumbnail->icon) : NULL;
+    }
+
+  if (G_UNLIKELY (thunar_icon_factory_decode_pool == NULL))
+    {
+      thunar_icon_factory_decode_pool = g_thread_pool_new (thunar_icon_factory_decode_thumbnail, NULL,
+                                                           MIN (THUNAR_ICON_FACTORY_DECODE_THREADS, (gint) g_get_num_processors ()),
+                                                           FALSE, NULL);
+      g_thread_pool_set_sort_function (thunar_icon_factory_decode_pool, thunar_icon_decode_compare, NULL);
+    }
+
+  /* the workers only read the frame, so load it here */
+  if (factory->thumbnail_draw_frames)
+    thunar_icon_factory_get_thumbnail_frame ();
+
+  if (G_UNLIKELY (++serial == 0))
+    ++serial;
+
+  thumbnail = g_slice_new0 (ThunarIconThumbnail);
+  thumbnail->icon_size = icon_size;
+  thumbnail->scale_factor = scale_factor;
+  thumbnail->draw_frames = factory->thumbnail_draw_frames;
+  thumbnail->serial = serial;
+
+  /* remember the request, dropping the oldest sizes */
+  thumbnails = g_object_steal_qdata (G_OBJECT (file), thunar_icon_factory_thumbnails_quark);
+  thumbnails = g_slist_prepend (thumbnails, thumbnail);
+  lp = g_slist_nth (thumbnails, THUNAR_ICON_FACTORY_MAX_THUMBNAILS - 1);
+  if (lp != NULL)
+    {
+      g_slist_free_full (lp->next, thunar_icon_thumbnail_free);
+      lp->next = NULL;
+    }
+  g_object_set_qdata_full (G_OBJECT (file), thunar_icon_factory_thumbnails_quark,
+                           thumbnails, thunar_icon_thumbnails_free);
+
+  decode = g_slice_new0 (ThunarIconDecode);
+  decode->file = g_object_ref (file);
+  decode->uri = thunar_file_dup_uri (file);
+  decode->is_directory = thunar_file_is_directory (file);
+  decode->mtime = thunar_file_get_date (file, THUNAR_FILE_DATE_MODIFIED);
+  decode->thumbnail_size = thumbnail_size;
+  decode->icon_size = icon_size;
+  decode->scale_factor = scale_factor;
+  decode->draw_frames = factory->thumbnail_draw_frames;
+  decode->serial = serial;
+  g_thread_pool_push (thunar_icon_factory_decode_pool, decode, NULL);
+
+  *pending = TRUE;
+  return NULL;
+}
+
+
+
 static GdkPixbuf*
 thunar_icon_factory_lookup_icon (ThunarIconFactory *factory,
                                  const gchar       *name,
@@ -581,10 +1224,10 @@ thunar_icon_factory_lookup_icon (ThunarIconFactory *factory,
                                  gint               scale_factor,
                                  gboolean           wants_default)
 {
-  ThunarIconKey  lookup_key;
-  ThunarIconKey *key;
-  GtkIconInfo   *icon_info;
-  GdkPixbuf     *pixbuf = NULL;
+  ThunarIconKey    lookup_key;
+  ThunarIconEntry *entry;
+  GtkIconInfo     *icon_info;
+  GdkPixbuf       *pixbuf = NULL;
 
   _thunar_return_val_if_fail (THUNAR_IS_ICON_FACTORY (factory), NULL);
   _thunar_return_val_if_fail (name != NULL && *name != '\0', NULL);
@@ -596,7 +1239,18 @@ thunar_icon_factory_lookup_icon (ThunarIconFactory *factory,
   lookup_key.scale_factor = scale_factor;
 
   /* check if we already have a cached version of the icon */
-  if (!g_hash_table_lookup_extended (factory->icon_cache, &lookup_key, NULL, (gpointer) &pixbuf))
+  entry = thunar_icon_factory_cache_lookup (factory, &lookup_key);
+  if (entry != NULL)
+    {
+      pixbuf = g_object_ref (entry->pixbuf);
+
+      /* keep showing the icon of the previous theme until the new one is loaded */
+      if (G_UNLIKELY (entry->stamp != factory->theme_stamp))
+        thunar_icon_factory_reload (factory, entry);
+
+      return pixbuf;
+    }
+  else
     {
       /* check if we have to load a file instead of a themed icon */
       if (G_UNLIKELY (g_path_is_absolute (name)))
@@ -632,22 +1286,8 @@ thunar_icon_factory_lookup_icon (ThunarIconFactory *factory,
             return thunar_icon_factory_load_fallback (factory, size, scale_factor);
         }
 
-      /* generate a key for the new cached icon */
-      key = g_slice_new (ThunarIconKey);
-      key->size = size;
-      key->scale_factor = scale_factor;
-      key->name = g_strdup (name);
-
       /* insert the new icon into the cache */
-      g_hash_table_insert (factory->icon_cache, key, pixbuf);
-    }
-
-  /* schedule the sweeper */
-  if (G_UNLIKELY (factory->sweep_timer_id == 0))
-    {
-      factory->sweep_timer_id = g_timeout_add_seconds_full (G_PRIORITY_LOW, THUNAR_ICON_FACTORY_SWEEP_TIMEOUT,
-                                                            thunar_icon_factory_sweep_timer, factory,
-                                                            thunar_icon_factory_sweep_timer_destroy);
+      thunar_icon_factory_cache_insert (factory, name, size, scale_factor, pixbuf);
     }
 
   return GDK_PIXBUF (g_object_ref (G_OBJECT (pixbuf)));
@@ -692,12 +1332,13 @@ thunar_icon_key_equal (gconstpointer a,
 
 
 static void
-thunar_icon_key_free (gpointer data)
+thunar_icon_entry_free (gpointer data)
 {
-  ThunarIconKey *key = data;
+  ThunarIconEntry *entry = data;
 
-  g_free (key->name);
-  g_slice_free (ThunarIconKey, key);
+  g_free (entry->key.name);
+  g_object_unref (entry->pixbuf);
+  g_slice_free (ThunarIconEntry, entry);
 }
 
 
@@ -888,34 +1529,25 @@ thunar_icon_factory_load_icon (ThunarIconFactory        *factory,
 
 
 
-/**
- * thunar_icon_factory_load_file_icon:
- * @factory      : a #ThunarIconFactory instance.
- * @file         : a #ThunarFile.
- * @icon_state   : the desired icon state.
- * @icon_size    : the desired icon size.
- * @scale_factor : the UI scale factor.
- *
- * The caller is responsible to free the returned object using
- * g_object_unref() when no longer needed.
- *
- * Return value: the #GdkPixbuf icon.
- **/
-GdkPixbuf*
-thunar_icon_factory_load_file_icon (ThunarIconFactory  *factory,
-                                    ThunarFile         *file,
-                                    ThunarFileIconState icon_state,
-                                    gint                icon_size,
-                                    gint                scale_factor)
+static GdkPixbuf*
+thunar_icon_factory_load_file_icon_real (ThunarIconFactory  *factory,
+                                         ThunarFile         *file,
+                                         ThunarFileIconState icon_state,
+                                         gint                icon_size,
+                                         gint                scale_factor,
+                                         gboolean            deferred)
 {
-  GInputStream    *stream;
-  GtkIconInfo     *icon_info;
-  const gchar     *thumbnail_path;
-  GdkPixbuf       *icon = NULL;
-  GIcon           *gicon;
-  const gchar     *icon_name;
-  const gchar     *custom_icon;
-  ThunarIconStore *store;
+  GInputStream        *stream;
+  GtkIconInfo         *icon_info;
+  const gchar         *thumbnail_path;
+  GdkPixbuf           *icon = NULL;
+  GIcon               *gicon;
+  const gchar         *icon_name;
+  const gchar         *custom_icon;
+  ThunarIconStore     *store;
+  ThunarIconThumbnail *thumbnail;
+  ThunarThumbnailSize  thumbnail_size;
+  gboolean             pending = FALSE;
 
   _thunar_return_val_if_fail (THUNAR_IS_ICON_FACTORY (factory), NULL);
   _thunar_return_val_if_fail (THUNAR_IS_FILE (file), NULL);
@@ -996,16 +1628,35 @@ thunar_icon_factory_load_file_icon (ThunarIconFactory  *factory,
         }
       else
         {
-          if (thunar_file_get_size (file) < factory->thumbnail_max_file_size || factory->thumbnail_max_file_size == 0) /* 0 = unlimited */
+          thumbnail_size = thunar_icon_size_to_thumbnail_size (icon_size * scale_factor);
+
+          if ((thunar_file_get_size (file) < factory->thumbnail_max_file_size || factory->thumbnail_max_file_size == 0) /* 0 = unlimited */
+              && thunar_file_get_thumb_state (file, thumbnail_size) != THUNAR_FILE_THUMB_STATE_NONE)
             {
-              /* we have no preview icon but the thumbnail should be ready. determine
-               * the filename of the thumbnail */
-              thumbnail_path = thunar_file_get_thumbnail_path (file, thunar_icon_size_to_thumbnail_size (icon_size * scale_factor));
-
-              /* check if we have a valid path */
-              if (thumbnail_path != NULL)
-                /* try to load the thumbnail */
-                icon = thunar_icon_factory_load_from_file (factory, thumbnail_path, icon_size, scale_factor);
+              if (deferred)
+                {
+                  /* decode the thumbnail in the background, and show the themed icon meanwhile */
+                  icon = thunar_icon_factory_lookup_thumbnail (factory, file, thumbnail_size, icon_size, scale_factor, &pending);
+                }
+              else
+                {
+                  /* take the thumbnail decoded in the background, if any */
+                  thumbnail = thunar_icon_factory_find_thumbnail (factory, file, icon_size, scale_factor);
+                  if (thumbnail != NULL && thumbnail->icon != NULL)
+                    icon = g_object_ref (thumbnail->icon);
+                }
+
+              if (icon == NULL && !deferred)
+                {
+                  /* we have no preview icon but the thumbnail should be ready. determine
+                   * the filename of the thumbnail */
+                  thumbnail_path = thunar_file_get_thumbnail_path (file, thumbnail_size);
+
+                  /* check if we have a valid path */
+                  if (thumbnail_path != NULL)
+                    /* try to load the thumbnail */
+                    icon = thunar_icon_factory_load_from_file (factory, thumbnail_path, icon_size, scale_factor);
+                }
             }
         }
     }
@@ -1017,7 +1668,9 @@ thunar_icon_factory_load_file_icon (ThunarIconFactory  *factory,
       icon = thunar_icon_factory_load_icon (factory, icon_name, icon_size, scale_factor, TRUE);
     }
 
-  if (G_LIKELY (icon != NULL))
+  /* don't remember the themed icon while the thumbnail is being decoded,
+   * or while it may still be the one of the previous theme */
+  if (G_LIKELY (icon != NULL && !pending && factory->n_reloads == 0))
     {
       store = g_slice_new (ThunarIconStore);
       store->icon_size = icon_size;
@@ -1035,6 +1688,102 @@ thunar_icon_factory_load_file_icon (ThunarIconFactory  *factory,
 
 
 
+/**
+ * thunar_icon_factory_load_file_icon:
+ * @factory      : a #ThunarIconFactory instance.
+ * @file         : a #ThunarFile.
+ * @icon_state   : the desired icon state.
+ * @icon_size    : the desired icon size.
+ * @scale_factor : the UI scale factor.
+ *
+ * The caller is responsible to free the returned object using
+ * g_object_unref() when no longer needed.
+ *
+ * Return value: the #GdkPixbuf icon.
+ **/
+GdkPixbuf*
+thunar_icon_factory_load_file_icon (ThunarIconFactory  *factory,
+                                    ThunarFile         *file,
+                                    ThunarFileIconState icon_state,
+                                    gint                icon_size,
+                                    gint                scale_factor)
+{
+  return thunar_icon_factory_load_file_icon_real (factory, file, icon_state, icon_size, scale_factor, FALSE);
+}
+
+
+
+/**
+ * thunar_icon_factory_load_file_icon_deferred:
+ * @factory      : a #ThunarIconFactory instance.
+ * @file         : a #ThunarFile.
+ * @icon_state   : the desired icon state.
+ * @icon_size    : the desired icon size.
+ * @scale_factor : the UI scale factor.
+ *
+ * Like thunar_icon_factory_load_file_icon(), but never reads a thumbnail
+ * on the calling thread. Cached thumbnails are decoded in the background
+ * instead, while the themed icon of @file is returned. Once a thumbnail
+ * is ready, @file emits "thumbnail-updated" so it can be drawn again.
+ *
+ * The caller is responsible to free the returned object using
+ * g_object_unref() when no longer needed.
+ *
+ * Return value: the #GdkPixbuf icon.
+ **/
+GdkPixbuf*
+thunar_icon_factory_load_file_icon_deferred (ThunarIconFactory  *factory,
+                                             ThunarFile         *file,
+                                             ThunarFileIconState icon_state,
+                                             gint                icon_size,
+                                             gint                scale_factor)
+{
+  return thunar_icon_factory_load_file_icon_real (factory, file, icon_state, icon_size, scale_factor, TRUE);
+}
+
+
+
+/**
+ * thunar_icon_factory_peek_file_icon:
+ * @factory    : a #ThunarIconFactory instance.
+ * @file       : a #ThunarFile.
+ * @icon_state : the desired icon state.
+ * @icon_size  : return location for the size the icon was loaded at.
+ *
+ * Returns the icon last loaded for @file in @icon_state, whatever its
+ * size, without loading anything. Meant to be scaled while the zoom
+ * level changes, until the icon is loaded at the new size.
+ *
+ * The caller is responsible to free the returned object using
+ * g_object_unref() when no longer needed.
+ *
+ * Return value: the #GdkPixbuf icon, or %NULL if there is none.
+ **/
+GdkPixbuf*
+thunar_icon_factory_peek_file_icon (ThunarIconFactory  *factory,
+                                    ThunarFile         *file,
+                                    ThunarFileIconState icon_state,
+                                    gint               *icon_size)
+{
+  ThunarIconStore *store;
+
+  _thunar_return_val_if_fail (THUNAR_IS_ICON_FACTORY (factory), NULL);
+  _thunar_return_val_if_fail (THUNAR_IS_FILE (file), NULL);
+  _thunar_return_val_if_fail (icon_size != NULL, NULL);
+
+  store = g_object_get_qdata (G_OBJECT (file), thunar_icon_factory_store_quark);
+  if (store == NULL
+      || store->icon_state != icon_state
+      || store->stamp != factory->theme_stamp)
+    return NULL;
+
+  *icon_size = store->icon_size;
+
+  return g_object_ref (store->icon);
+}
+
+
+
 /**
  * thunar_icon_factory_clear_pixmap_cache:
  * @file : a #ThunarFile.
@@ -1049,4 +1798,41 @@ thunar_icon_factory_clear_pixmap_cache (ThunarFile *file)
   /* unset the data */
   if (thunar_icon_factory_store_quark != 0)
     g_object_set_qdata (G_OBJECT (file), thunar_icon_factory_store_quark, NULL);
+
+  /* drop the decoded thumbnails, pending decodes are ignored when they finish */
+  if (thunar_icon_factory_thumbnails_quark != 0)
+    g_object_set_qdata (G_OBJECT (file), thunar_icon_factory_thumbnails_quark, NULL);
+}
+
+
+
+/**
+ * thunar_icon_factory_get_cache_stats:
+ * @factory     : a #ThunarIconFactory instance.
+ * @n_hits      : return location for the number of cache hits, or %NULL.
+ * @n_misses    : return location for the number of cache misses, or %NULL.
+ * @n_evictions : return location for the number of icons dropped to stay
+ *                within the cache budget, or %NULL.
+ * @n_bytes     : return location for the memory used by the larger
+ *                cached icons, or %NULL.
+ *
+ * Queries the icon cache counters of @factory since it was created.
+ **/
+void
+thunar_icon_factory_get_cache_stats (ThunarIconFactory *factory,
+                                     guint64           *n_hits,
+                                     guint64           *n_misses,
+                                     guint64           *n_evictions,
+                                     gsize             *n_bytes)
+{
+  _thunar_return_if_fail (THUNAR_IS_ICON_FACTORY (factory));
+
+  if (n_hits != NULL)
+    *n_hits = factory->n_hits;
+  if (n_misses != NULL)
+    *n_misses = factory->n_misses;
+  if (n_evictions != NULL)
+    *n_evictions = factory->n_evictions;
+  if (n_bytes != NULL)
+    *n_bytes = factory->lru_size;
 }
@@ -56,8 +56,25 @@ GdkPixbuf             *thunar_icon_factory_load_file_icon     (ThunarIconFactory
                                                                gint                      icon_size,
                                                                gint                      scale_factor);
 
+GdkPixbuf             *thunar_icon_factory_load_file_icon_deferred (ThunarIconFactory   *factory,
+                                                                    ThunarFile          *file,
+                                                                    ThunarFileIconState  icon_state,
+                                                                    gint                 icon_size,
+                                                                    gint                 scale_factor);
+
+GdkPixbuf             *thunar_icon_factory_peek_file_icon     (ThunarIconFactory        *factory,
+                                                               ThunarFile               *file,
+                                                               ThunarFileIconState       icon_state,
+                                                               gint                     *icon_size);
+
 void                   thunar_icon_factory_clear_pixmap_cache (ThunarFile               *file);
 
+void                   thunar_icon_factory_get_cache_stats    (ThunarIconFactory        *factory,
+                                                               guint64                  *n_hits,
+                                                               guint64                  *n_misses,
+                                                               guint64                  *n_evictions,
+                                                               gsize                    *n_bytes);
+
 G_END_DECLS;
 
 #endif /* !__THUNAR_ICON_FACTORY_H__ */
@@ -31,6 +31,11 @@
 
 
 
+/* maximum number of composited icons kept per icon */
+#define THUNAR_ICON_RENDERER_MAX_COMPOSITES (8)
+
+
+
 enum
 {
   PROP_0,
@@ -43,6 +48,7 @@ enum
   PROP_ROUNDED_CORNERS,
   PROP_HIGHLIGHTING_ENABLED,
   PROP_IMAGE_PREVIEW_ENABLED,
+  PROP_ZOOMING,
 };
 
 
@@ -73,6 +79,29 @@ static void thunar_icon_renderer_render        (GtkCellRenderer         *rendere
 
 
 
+typedef struct
+{
+  gchar           *emblems;      /* newline separated emblem names, or %NULL */
+  gint             size;
+  gint             width;        /* of the cell */
+  gint             height;
+  gint             scale_factor;
+  gdouble          alpha;
+  guint            insensitive : 1;
+  guint            lighten : 1;
+  guint            selected : 1;
+  GdkRGBA          insensitive_color;
+  GdkRGBA          selected_color;
+  cairo_surface_t *surface;
+}
+ThunarIconComposite;
+
+
+
+static const GdkRGBA lighten_color = { .15, .15, .15, 1.0 };
+
+
+
 G_DEFINE_TYPE (ThunarIconRenderer, thunar_icon_renderer, GTK_TYPE_CELL_RENDERER)
 
 
@@ -210,6 +239,19 @@ thunar_icon_renderer_class_init (ThunarIconRendererClass *klass)
                                    g_param_spec_boolean ("image-preview-enabled", "image-preview-enabled", "image-preview-enabled",
                                                          FALSE,
                                                          EXO_PARAM_READWRITE));
+
+  /**
+   * ThunarIconRenderer:zooming:
+   *
+   * Whether the size was changed just now. The icons loaded at the
+   * previous size are scaled meanwhile, and no thumbnails are
+   * requested for the new size.
+   **/
+  g_object_class_install_property (gobject_class,
+                                   PROP_ZOOMING,
+                                   g_param_spec_boolean ("zooming", "zooming", "zooming",
+                                                         FALSE,
+                                                         EXO_PARAM_READWRITE));
 }
 
 
@@ -286,6 +328,10 @@ thunar_icon_renderer_get_property (GObject    *object,
       g_value_set_boolean (value, icon_renderer->highlighting_enabled);
       break;
 
+    case PROP_ZOOMING:
+      g_value_set_boolean (value, icon_renderer->zooming);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -345,6 +391,10 @@ thunar_icon_renderer_set_property (GObject      *object,
       icon_renderer->image_preview_enabled = g_value_get_boolean (value);
       break;
 
+    case PROP_ZOOMING:
+      icon_renderer->zooming = g_value_get_boolean (value);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -389,20 +439,17 @@ thunar_icon_renderer_get_preferred_height (GtkCellRenderer *renderer,
 
 
 static void
-thunar_icon_renderer_color_insensitive (cairo_t   *cr,
-                                        GtkWidget *widget)
+thunar_icon_renderer_color_mask (cairo_t          *cr,
+                                 const GdkRGBA    *color,
+                                 cairo_operator_t  op)
 {
   cairo_pattern_t *source;
-  GdkRGBA          *color;
-  GtkStyleContext *context = gtk_widget_get_style_context (widget);
 
   cairo_save (cr);
 
   source = cairo_pattern_reference (cairo_get_source (cr));
-  gtk_style_context_get (context, GTK_STATE_FLAG_INSENSITIVE, GTK_STYLE_PROPERTY_COLOR, &color, NULL);
   gdk_cairo_set_source_rgba (cr, color);
-  gdk_rgba_free (color);
-  cairo_set_operator (cr, CAIRO_OPERATOR_MULTIPLY);
+  cairo_set_operator (cr, op);
 
   cairo_mask (cr, source);
 
@@ -413,47 +460,263 @@ thunar_icon_renderer_color_insensitive (cairo_t   *cr,
 
 
 static void
-thunar_icon_renderer_color_selected (cairo_t   *cr,
-                                     GtkWidget *widget)
+thunar_icon_renderer_composite_free (gpointer data)
 {
-  cairo_pattern_t *source;
-  GtkStateFlags    state;
-  GdkRGBA          *color;
-  GtkStyleContext *context = gtk_widget_get_style_context (widget);
+  ThunarIconComposite *composite = data;
 
-  cairo_save (cr);
+  g_free (composite->emblems);
+  cairo_surface_destroy (composite->surface);
+  g_slice_free (ThunarIconComposite, composite);
+}
 
-  source = cairo_pattern_reference (cairo_get_source (cr));
-  state = gtk_widget_has_focus (widget) ? GTK_STATE_FLAG_SELECTED : GTK_STATE_FLAG_ACTIVE;
-  gtk_style_context_get (context, state, GTK_STYLE_PROPERTY_BACKGROUND_COLOR, &color, NULL);
-  gdk_cairo_set_source_rgba (cr, color);
-  gdk_rgba_free (color);
-  cairo_set_operator (cr, CAIRO_OPERATOR_MULTIPLY);
 
-  cairo_mask (cr, source);
 
-  cairo_pattern_destroy (source);
-  cairo_restore (cr);
+static void
+thunar_icon_renderer_composite_list_free (gpointer data)
+{
+  g_slist_free_full (data, thunar_icon_renderer_composite_free);
+}
+
+
+
+static gboolean
+thunar_icon_renderer_composite_equal (const ThunarIconComposite *a,
+                                      const ThunarIconComposite *b)
+{
+  return a->size == b->size
+      && a->width == b->width
+      && a->height == b->height
+      && a->scale_factor == b->scale_factor
+      && a->alpha == b->alpha
+      && a->insensitive == b->insensitive
+      && a->lighten == b->lighten
+      && a->selected == b->selected
+      && (!a->insensitive || gdk_rgba_equal (&a->insensitive_color, &b->insensitive_color))
+      && (!a->selected || gdk_rgba_equal (&a->selected_color, &b->selected_color))
+      && g_strcmp0 (a->emblems, b->emblems) == 0;
 }
 
 
 
 static void
-thunar_icon_renderer_color_lighten (cairo_t   *cr,
-                                    GtkWidget *widget)
+thunar_icon_renderer_paint_emblems (ThunarIconRenderer        *icon_renderer,
+                                    cairo_t                   *cr,
+                                    ThunarIconFactory         *icon_factory,
+                                    const ThunarIconComposite *composite,
+                                    const GdkRectangle        *icon_area)
 {
-  cairo_pattern_t *source;
+  cairo_surface_t *surface;
+  GdkRectangle     emblem_area;
+  GdkPixbuf       *emblem;
+  gchar          **emblems;
+  gint             max_emblems;
+  gint             emblem_size;
+  gint             position;
+  gint             scale_factor = composite->scale_factor;
+  gint             n;
+
+  /* render up to four emblems for sizes from 48 onwards, else up to 2 emblems */
+  max_emblems = (icon_renderer->size < 48) ? 2 : 4;
+
+  /* calculate the emblem size */
+  emblem_size = MIN ((2 * icon_renderer->size) / 3, 32);
+
+  /* render the emblems */
+  emblems = g_strsplit (composite->emblems, "\n", -1);
+  for (n = 0, position = 0; emblems[n] != NULL && position < max_emblems; ++n)
+    {
+      /* check if we have the emblem in the icon theme */
+      emblem = thunar_icon_factory_load_icon (icon_factory, emblems[n], emblem_size, scale_factor, FALSE);
+      if (G_UNLIKELY (emblem == NULL))
+        continue;
 
-  cairo_save (cr);
+      /* get the cached surface of the emblem, shrinking insane emblems */
+      surface = thunar_gdk_pixbuf_get_surface (emblem, emblem_size * scale_factor, emblem_size * scale_factor, scale_factor);
 
-  source = cairo_pattern_reference (cairo_get_source (cr));
-  cairo_set_source_rgb (cr, .15, .15, .15);
-  cairo_set_operator (cr, CAIRO_OPERATOR_COLOR_DODGE);
+      /* determine the dimensions of the emblem */
+      emblem_area.width = cairo_image_surface_get_width (surface) / scale_factor;
+      emblem_area.height = cairo_image_surface_get_height (surface) / scale_factor;
 
-  cairo_mask (cr, source);
+      /* determine a good position for the emblem, depending on the position index */
+      switch (position)
+        {
+        case 0: /* right/bottom */
+          emblem_area.x = MIN (icon_area->x + icon_area->width - emblem_area.width / 2,
+                               composite->width - emblem_area.width);
+          emblem_area.y = MIN (icon_area->y + icon_area->height - emblem_area.height / 2,
+                               composite->height - emblem_area.height);
+          break;
+
+        case 1: /* left/bottom */
+          emblem_area.x = MAX (icon_area->x - emblem_area.width / 2, 0);
+          emblem_area.y = MIN (icon_area->y + icon_area->height - emblem_area.height / 2,
+                               composite->height - emblem_area.height);
+          break;
+
+        case 2: /* left/top */
+          emblem_area.x = MAX (icon_area->x - emblem_area.width / 2, 0);
+          emblem_area.y = MAX (icon_area->y - emblem_area.height / 2, 0);
+          break;
+
+        case 3: /* right/top */
+          emblem_area.x = MIN (icon_area->x + icon_area->width - emblem_area.width / 2,
+                               composite->width - emblem_area.width);
+          emblem_area.y = MAX (icon_area->y - emblem_area.height / 2, 0);
+          break;
+
+        default:
+          _thunar_assert_not_reached ();
+        }
 
-  cairo_pattern_destroy (source);
-  cairo_restore (cr);
+      /* render the emblem */
+      cairo_set_source_surface (cr, surface, emblem_area.x, emblem_area.y);
+      cairo_paint (cr);
+
+      /* paint the lighten mask */
+      if (composite->lighten)
+        thunar_icon_renderer_color_mask (cr, &lighten_color, CAIRO_OPERATOR_COLOR_DODGE);
+
+      /* paint the selected mask */
+      if (composite->selected)
+        thunar_icon_renderer_color_mask (cr, &composite->selected_color, CAIRO_OPERATOR_MULTIPLY);
+
+      /* release the emblem */
+      g_object_unref (G_OBJECT (emblem));
+
+      /* advance the position index */
+      ++position;
+    }
+  g_strfreev (emblems);
+}
+
+
+
+static cairo_surface_t*
+thunar_icon_renderer_get_composite (ThunarIconRenderer        *icon_renderer,
+                                    ThunarIconFactory         *icon_factory,
+                                    GdkPixbuf                 *icon,
+                                    cairo_surface_t           *surface,
+                                    const ThunarIconComposite *key)
+{
+  ThunarIconComposite *composite;
+  GdkRectangle         icon_area;
+  GSList              *composites;
+  GSList              *lp;
+  cairo_t             *cr;
+  static GQuark        composite_quark = 0;
+
+  if (G_UNLIKELY (composite_quark == 0))
+    composite_quark = g_quark_from_static_string ("thunar-icon-renderer-composite");
+
+  /* look for a composite of the same emblems and state on the icon */
+  composites = g_object_get_qdata (G_OBJECT (icon), composite_quark);
+  for (lp = composites; lp != NULL; lp = lp->next)
+    if (thunar_icon_renderer_composite_equal (lp->data, key))
+      return ((ThunarIconComposite *) lp->data)->surface;
+
+  composite = g_slice_dup (ThunarIconComposite, key);
+  composite->emblems = g_strdup (key->emblems);
+  composite->surface = cairo_image_surface_create (CAIRO_FORMAT_ARGB32,
+                                                   key->width * key->scale_factor,
+                                                   key->height * key->scale_factor);
+  cairo_surface_set_device_scale (composite->surface, key->scale_factor, key->scale_factor);
+
+  /* the icon is centered in the cell */
+  icon_area.width = cairo_image_surface_get_width (surface) / key->scale_factor;
+  icon_area.height = cairo_image_surface_get_height (surface) / key->scale_factor;
+  icon_area.x = (key->width - icon_area.width) / 2;
+  icon_area.y = (key->height - icon_area.height) / 2;
+
+  cr = cairo_create (composite->surface);
+
+  /* render the icon */
+  cairo_set_source_surface (cr, surface, icon_area.x, icon_area.y);
+  cairo_paint_with_alpha (cr, key->alpha);
+
+  /* check if we should render an insensitive icon */
+  if (G_UNLIKELY (key->insensitive))
+    thunar_icon_renderer_color_mask (cr, &key->insensitive_color, CAIRO_OPERATOR_MULTIPLY);
+
+  /* paint the lighten mask */
+  if (key->lighten)
+    thunar_icon_renderer_color_mask (cr, &lighten_color, CAIRO_OPERATOR_COLOR_DODGE);
+
+  /* paint the selected mask */
+  if (key->selected)
+    thunar_icon_renderer_color_mask (cr, &key->selected_color, CAIRO_OPERATOR_MULTIPLY);
+
+  /* render the emblems */
+  if (key->emblems != NULL)
+    thunar_icon_renderer_paint_emblems (icon_renderer, cr, icon_factory, composite, &icon_area);
+
+  cairo_destroy (cr);
+
+  /* store the composite on the icon, dropping the oldest ones */
+  g_object_steal_qdata (G_OBJECT (icon), composite_quark);
+  composites = g_slist_prepend (composites, composite);
+  lp = g_slist_nth (composites, THUNAR_ICON_RENDERER_MAX_COMPOSITES - 1);
+  if (lp != NULL && lp->next != NULL)
+    {
+      g_slist_free_full (lp->next, thunar_icon_renderer_composite_free);
+      lp->next = NULL;
+    }
+  g_object_set_qdata_full (G_OBJECT (icon), composite_quark, composites, thunar_icon_renderer_composite_list_free);
+
+  return composite->surface;
+}
+
+
+
+static void
+thunar_icon_renderer_paint_surface (cairo_t         *cr,
+                                    cairo_surface_t *surface,
+                                    gint             x,
+                                    gint             y,
+                                    gdouble          zoom)
+{
+  if (G_LIKELY (zoom == 1.0))
+    {
+      cairo_set_source_surface (cr, surface, x, y);
+      cairo_paint (cr);
+    }
+  else
+    {
+      /* an icon of the previous zoom level, until the new one is loaded */
+      cairo_save (cr);
+      cairo_translate (cr, x, y);
+      cairo_scale (cr, zoom, zoom);
+      cairo_set_source_surface (cr, surface, 0, 0);
+      cairo_paint (cr);
+      cairo_restore (cr);
+    }
+}
+
+
+
+static gchar*
+thunar_icon_renderer_get_emblems (ThunarIconRenderer *icon_renderer)
+{
+  GString *names;
+  GList   *emblems;
+  GList   *lp;
+
+  /* determine the emblems of the file (if any) */
+  emblems = thunar_file_get_emblem_names (icon_renderer->file);
+  if (G_LIKELY (emblems == NULL))
+    return NULL;
+
+  names = g_string_new (NULL);
+  for (lp = emblems; lp != NULL; lp = lp->next)
+    {
+      if (lp != emblems)
+        g_string_append_c (names, '\n');
+      g_string_append (names, lp->data);
+    }
+
+  /* release the emblem name list */
+  g_list_free_full (emblems, g_free);
+
+  return g_string_free (names, FALSE);
 }
 
 
@@ -469,23 +732,20 @@ thunar_icon_renderer_render (GtkCellRenderer     *renderer,
   ThunarClipboardManager *clipboard;
   ThunarFileIconState     icon_state;
   ThunarIconRenderer     *icon_renderer = THUNAR_ICON_RENDERER (renderer);
+  ThunarIconComposite     key = { 0, };
   ThunarIconFactory      *icon_factory;
+  GtkStyleContext        *context;
   GtkIconTheme           *icon_theme;
-  GdkRectangle            emblem_area;
-  GdkRectangle            icon_area;
   GdkRectangle            clip_area;
-  GdkPixbuf              *emblem;
-  GdkPixbuf              *icon;
-  GdkPixbuf              *temp;
-  GList                  *emblems;
-  GList                  *lp;
+  GdkRectangle            icon_area;
+  GdkPixbuf              *icon = NULL;
+  GdkRGBA                *color;
+  cairo_surface_t        *surface;
+  gdouble                 zoom = 1.0;
   gint                    scale_factor;
-  gint                    max_emblems;
-  gint                    position;
-  gdouble                 alpha;
-  gint                    emblem_size;
-  gboolean                color_selected;
-  gboolean                color_lighten;
+  gint                    icon_size;
+  gint                    width;
+  gint                    height;
   gboolean                is_expanded;
 
   if (G_UNLIKELY (icon_renderer->file == NULL))
@@ -510,12 +770,25 @@ thunar_icon_renderer_render (GtkCellRenderer     *renderer,
   icon_theme = gtk_icon_theme_get_for_screen (gtk_widget_get_screen (widget));
   icon_factory = thunar_icon_factory_get_for_icon_theme (icon_theme);
   scale_factor = gtk_widget_get_scale_factor (widget);
-  thunar_file_request_thumbnail (icon_renderer->file, thunar_icon_size_to_thumbnail_size (icon_renderer->size * scale_factor));
+  icon_size = icon_renderer->size;
+
+  if (G_UNLIKELY (icon_renderer->zooming))
+    {
+      /* scale the icon of the previous size until the zoom level settles */
+      icon = thunar_icon_factory_peek_file_icon (icon_factory, icon_renderer->file, icon_state, &icon_size);
+      if (icon != NULL)
+        zoom = (gdouble) icon_renderer->size / icon_size;
+    }
+  else
+    {
+      thunar_file_request_thumbnail (icon_renderer->file, thunar_icon_size_to_thumbnail_size (icon_renderer->size * scale_factor));
 
-  if (icon_renderer->image_preview_enabled)
-    thunar_file_request_thumbnail (icon_renderer->file, THUNAR_THUMBNAIL_SIZE_XX_LARGE);
+      if (icon_renderer->image_preview_enabled)
+        thunar_file_request_thumbnail (icon_renderer->file, THUNAR_THUMBNAIL_SIZE_XX_LARGE);
+    }
 
-  icon = thunar_icon_factory_load_file_icon (icon_factory, icon_renderer->file, icon_state, icon_renderer->size, scale_factor);
+  if (icon == NULL)
+    icon = thunar_icon_factory_load_file_icon_deferred (icon_factory, icon_renderer->file, icon_state, icon_renderer->size, scale_factor);
   if (G_UNLIKELY (icon == NULL))
     {
       g_object_unref (G_OBJECT (icon_factory));
@@ -526,172 +799,83 @@ thunar_icon_renderer_render (GtkCellRenderer     *renderer,
   if (G_UNLIKELY (icon_state == THUNAR_FILE_ICON_STATE_DROP))
     flags |= GTK_CELL_RENDERER_PRELIT;
 
-  /* determine the real icon size */
-  icon_area.width = gdk_pixbuf_get_width (icon) / scale_factor;
-  icon_area.height = gdk_pixbuf_get_height (icon) / scale_factor;
+  /* the cell as it was at the size of the icon */
+  width = MAX (1, cell_area->width / zoom);
+  height = MAX (1, cell_area->height / zoom);
 
-  /* scale down the icon on-demand */
-  if (G_UNLIKELY (icon_area.width > cell_area->width || icon_area.height > cell_area->height))
-    {
-      /* scale down to fit */
-      temp = exo_gdk_pixbuf_scale_down (icon, TRUE, MAX (1, cell_area->width * scale_factor), MAX (1, cell_area->height * scale_factor));
-      g_object_unref (G_OBJECT (icon));
-      icon = temp;
-
-      /* determine the icon dimensions again */
-      icon_area.width = gdk_pixbuf_get_width (icon) / scale_factor;
-      icon_area.height = gdk_pixbuf_get_height (icon) / scale_factor;
-    }
+  /* get the cached surface of the icon, scaled down to fit the cell */
+  surface = thunar_gdk_pixbuf_get_surface (icon, width * scale_factor, height * scale_factor, scale_factor);
+
+  /* determine the real icon size */
+  icon_area.width = cairo_image_surface_get_width (surface) * zoom / scale_factor;
+  icon_area.height = cairo_image_surface_get_height (surface) * zoom / scale_factor;
 
   icon_area.x = cell_area->x + (cell_area->width - icon_area.width) / 2;
   icon_area.y = cell_area->y + (cell_area->height - icon_area.height) / 2;
 
-  /* bools for cairo transformations */
-  color_selected = (flags & GTK_CELL_RENDERER_SELECTED) != 0 && icon_renderer->follow_state;
-  color_lighten = (flags & GTK_CELL_RENDERER_PRELIT) != 0 && icon_renderer->follow_state;
+  /* everything that changes how the icon looks */
+  key.size = icon_size;
+  key.width = width;
+  key.height = height;
+  key.scale_factor = scale_factor;
+  key.selected = (flags & GTK_CELL_RENDERER_SELECTED) != 0 && icon_renderer->follow_state;
+  key.lighten = (flags & GTK_CELL_RENDERER_PRELIT) != 0 && icon_renderer->follow_state;
+  key.insensitive = (gtk_widget_get_state_flags (widget) == GTK_STATE_FLAG_INSENSITIVE || !gtk_cell_renderer_get_sensitive (renderer));
+  key.emblems = G_LIKELY (icon_renderer->emblems) ? thunar_icon_renderer_get_emblems (icon_renderer) : NULL;
+
+  /* use a translucent icon to represent cutted and hidden files to the user */
+  clipboard = thunar_clipboard_manager_get_for_display (gtk_widget_get_display (widget));
+  if (thunar_clipboard_manager_has_cutted_file (clipboard, icon_renderer->file) && thunar_file_is_writable (icon_renderer->file))
+    {
+      /* 50% translucent for cutted files */
+      key.alpha = 0.50;
+    }
+  else if (thunar_file_is_hidden (icon_renderer->file))
+    {
+      /* 75% translucent for hidden files */
+      key.alpha = 0.75;
+    }
+  else
+    {
+      key.alpha = 1.00;
+    }
+  g_object_unref (G_OBJECT (clipboard));
 
-  /* check whether the icon is affected by the expose event */
-  if (gdk_rectangle_intersect (&clip_area, &icon_area, NULL))
+  if (key.alpha == 1.00 && !key.insensitive && !key.lighten && !key.selected && key.emblems == NULL)
     {
-      /* use a translucent icon to represent cutted and hidden files to the user */
-      clipboard = thunar_clipboard_manager_get_for_display (gtk_widget_get_display (widget));
-      if (thunar_clipboard_manager_has_cutted_file (clipboard, icon_renderer->file) && thunar_file_is_writable (icon_renderer->file))
-        {
-          /* 50% translucent for cutted files */
-          alpha = 0.50;
-        }
-      else if (thunar_file_is_hidden (icon_renderer->file))
+      /* plain icon, check whether it is affected by the expose event */
+      if (gdk_rectangle_intersect (&clip_area, &icon_area, NULL))
+        thunar_icon_renderer_paint_surface (cr, surface, icon_area.x, icon_area.y, zoom);
+    }
+  else if (gdk_rectangle_intersect (&clip_area, cell_area, NULL))
+    {
+      context = gtk_widget_get_style_context (widget);
+
+      if (G_UNLIKELY (key.insensitive))
         {
-          /* 75% translucent for hidden files */
-          alpha = 0.75;
+          gtk_style_context_get (context, GTK_STATE_FLAG_INSENSITIVE, GTK_STYLE_PROPERTY_COLOR, &color, NULL);
+          key.insensitive_color = *color;
+          gdk_rgba_free (color);
         }
-      else
+
+      if (key.selected)
         {
-          alpha = 1.00;
+          gtk_style_context_get (context, gtk_widget_has_focus (widget) ? GTK_STATE_FLAG_SELECTED : GTK_STATE_FLAG_ACTIVE,
+                                 GTK_STYLE_PROPERTY_BACKGROUND_COLOR, &color, NULL);
+          key.selected_color = *color;
+          gdk_rgba_free (color);
         }
-      g_object_unref (G_OBJECT (clipboard));
-
-      /* render the invalid parts of the icon */
-      thunar_gdk_cairo_set_source_pixbuf (cr, icon, icon_area.x, icon_area.y, scale_factor);
-      cairo_paint_with_alpha (cr, alpha);
-
-      /* check if we should render an insensitive icon */
-      if (G_UNLIKELY (gtk_widget_get_state_flags (widget) == GTK_STATE_FLAG_INSENSITIVE || !gtk_cell_renderer_get_sensitive (renderer)))
-        thunar_icon_renderer_color_insensitive(cr,widget);
-
-      /* paint the lighten mask */
-      if (color_lighten)
-        thunar_icon_renderer_color_lighten (cr, widget);
 
-      /* paint the selected mask */
-      if (color_selected)
-        thunar_icon_renderer_color_selected (cr, widget);
+      /* render the icon with its emblems and state, composited only once */
+      surface = thunar_icon_renderer_get_composite (icon_renderer, icon_factory, icon, surface, &key);
+      thunar_icon_renderer_paint_surface (cr, surface, cell_area->x, cell_area->y, zoom);
     }
 
+  g_free (key.emblems);
+
   /* release the file's icon */
   g_object_unref (G_OBJECT (icon));
 
-  /* check if we should render emblems as well */
-  if (G_LIKELY (icon_renderer->emblems))
-    {
-      /* display the primary emblem as well (if any) */
-      emblems = thunar_file_get_emblem_names (icon_renderer->file);
-      if (G_UNLIKELY (emblems != NULL))
-        {
-          /* render up to four emblems for sizes from 48 onwards, else up to 2 emblems */
-          max_emblems = (icon_renderer->size < 48) ? 2 : 4;
-
-          /* render the emblems */
-          for (lp = emblems, position = 0; lp != NULL && position < max_emblems; lp = lp->next)
-            {
-              /* calculate the emblem size */
-              emblem_size = MIN ((2 * icon_renderer->size) / 3, 32);
-
-              /* check if we have the emblem in the icon theme */
-              emblem = thunar_icon_factory_load_icon (icon_factory, lp->data, emblem_size, scale_factor, FALSE);
-              if (G_UNLIKELY (emblem == NULL))
-                continue;
-
-              /* determine the dimensions of the emblem */
-              emblem_area.width = gdk_pixbuf_get_width (emblem) / scale_factor;
-              emblem_area.height = gdk_pixbuf_get_height (emblem) / scale_factor;
-
-              /* shrink insane emblems */
-              if (G_UNLIKELY (MAX (emblem_area.width, emblem_area.height) > emblem_size))
-                {
-                  /* scale down the emblem */
-                  temp = exo_gdk_pixbuf_scale_ratio (emblem, emblem_size * scale_factor);
-                  g_object_unref (G_OBJECT (emblem));
-                  emblem = temp;
-
-                  /* determine the size again */
-                  emblem_area.width = gdk_pixbuf_get_width (emblem) / scale_factor;
-                  emblem_area.height = gdk_pixbuf_get_height (emblem) / scale_factor;
-                }
-
-              /* determine a good position for the emblem, depending on the position index */
-              switch (position)
-                {
-                case 0: /* right/bottom */
-                  emblem_area.x = MIN (icon_area.x + icon_area.width - emblem_area.width / 2,
-                                       cell_area->x + cell_area->width - emblem_area.width);
-                  emblem_area.y = MIN (icon_area.y + icon_area.height - emblem_area.height / 2,
-                                       cell_area->y + cell_area->height -emblem_area.height);
-                  break;
-
-                case 1: /* left/bottom */
-                  emblem_area.x = MAX (icon_area.x - emblem_area.width / 2,
-                                       cell_area->x);
-                  emblem_area.y = MIN (icon_area.y + icon_area.height - emblem_area.height / 2,
-                                       cell_area->y + cell_area->height -emblem_area.height);
-                  break;
-
-                case 2: /* left/top */
-                  emblem_area.x = MAX (icon_area.x - emblem_area.width / 2,
-                                       cell_area->x);
-                  emblem_area.y = MAX (icon_area.y - emblem_area.height / 2,
-                                       cell_area->y);
-                  break;
-
-                case 3: /* right/top */
-                  emblem_area.x = MIN (icon_area.x + icon_area.width - emblem_area.width / 2,
-                                       cell_area->x + cell_area->width - emblem_area.width);
-                  emblem_area.y = MAX (icon_area.y - emblem_area.height / 2,
-                                       cell_area->y);
-                  break;
-
-                default:
-                  _thunar_assert_not_reached ();
-                }
-
-              /* render the emblem */
-              if (gdk_rectangle_intersect (&clip_area, &emblem_area, NULL))
-                {
-                  /* render the invalid parts of the icon */
-                  thunar_gdk_cairo_set_source_pixbuf (cr, emblem, emblem_area.x, emblem_area.y, scale_factor);
-                  cairo_paint (cr);
-
-                  /* paint the lighten mask */
-                  if (color_lighten)
-                    thunar_icon_renderer_color_lighten (cr, widget);
-
-                  /* paint the selected mask */
-                  if (color_selected)
-                    thunar_icon_renderer_color_selected (cr, widget);
-                }
-
-              /* release the emblem */
-              g_object_unref (G_OBJECT (emblem));
-
-              /* advance the position index */
-              ++position;
-            }
-
-          /* release the emblem name list */
-          g_list_free_full (emblems, g_free);
-        }
-    }
-
   /* release our reference on the icon factory */
   g_object_unref (G_OBJECT (icon_factory));
 }
@@ -0,0 +1,618 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_ERRNO_H
+#include <errno.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_SYS_INOTIFY_H
+#include <sys/inotify.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_SYS_INOTIFY_H
+#include <glib-unix.h>
+#endif
+
+#include "thunar/thunar-inotify.h"
+#include "thunar/thunar-private.h"
+
+/**
+ * SECTION:thunar-inotify
+ * @Short_description: Shared inotify watches for local folders and files
+ * @Title: ThunarInotify
+ *
+ * Watches local folders and files with a single inotify descriptor, which
+ * is read from the main loop. Every folder takes one inotify watch, shared
+ * by the #ThunarFolder showing it and by all the #ThunarFile<!---->s inside
+ * it, which are watched through their parent folder.
+ *
+ * The events read at once are delivered in one batch per watch, folder
+ * watches before file watches, renames within a folder are paired to
+ * %G_FILE_MONITOR_EVENT_RENAMED and moves between two watched folders to
+ * %G_FILE_MONITOR_EVENT_MOVED_OUT and %G_FILE_MONITOR_EVENT_MOVED_IN, like
+ * #GFileMonitor does with %G_FILE_MONITOR_WATCH_MOVES. File watches see
+ * renames and moves as the file being deleted or created, like a #GFileMonitor
+ * of a file does.
+ *
+ * The functions return %NULL where inotify is not available, for files
+ * without a local path and when the kernel refuses another watch, and the
+ * callers use a #GFileMonitor instead.
+ **/
+
+
+
+#ifdef HAVE_SYS_INOTIFY_H
+
+/* Events which are watched for */
+#define THUNAR_INOTIFY_MASK (IN_CREATE | IN_DELETE | IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB   \
+                             | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF \
+                             | IN_UNMOUNT | IN_ONLYDIR | IN_EXCL_UNLINK)
+
+/* Size of the buffer events are read into, and the maximum number
+ * of reads in one main loop iteration */
+#define THUNAR_INOTIFY_BUFFER_SIZE (64 * 1024)
+#define THUNAR_INOTIFY_MAX_READS   (16)
+
+/* Minimum interval between two change events of the same file, the
+ * change done hint after a file was written is always delivered */
+#define THUNAR_INOTIFY_CHANGED_INTERVAL (800 * G_TIME_SPAN_MILLISECOND)
+
+
+
+typedef struct
+{
+  gint        wd;
+  gchar      *path;
+  GFile      *directory;
+  GList      *watches;
+  GHashTable *changed;  /* name -> time of the last change event delivered */
+}
+ThunarInotifyDirectory;
+
+typedef struct
+{
+  ThunarInotifyEvent      event;
+  ThunarInotifyDirectory *directory;
+  gchar                  *name;        /* NULL for the directory itself */
+  gchar                  *other_name;  /* new name of renames */
+  guint32                 cookie;
+}
+ThunarInotifyPending;
+
+struct _ThunarInotifyWatch
+{
+  ThunarInotifyDirectory *directory;
+  gchar                  *name;        /* NULL for directory watches */
+  ThunarInotifyFunc       func;        /* NULL once unwatched */
+  gpointer                user_data;
+  guint                   ref_count;
+  GArray                 *events;      /* batch being collected */
+};
+
+
+
+static gint        inotify_fd = -1;
+static gboolean    inotify_failed = FALSE;
+static GHashTable *inotify_paths = NULL;  /* path -> ThunarInotifyDirectory */
+static GHashTable *inotify_wds = NULL;    /* wd -> ThunarInotifyDirectory */
+
+
+
+static void
+thunar_inotify_directory_free (ThunarInotifyDirectory *directory)
+{
+  /* the kernel removes the watch of deleted folders itself */
+  if (directory->wd >= 0)
+    {
+      inotify_rm_watch (inotify_fd, directory->wd);
+      g_hash_table_remove (inotify_wds, GINT_TO_POINTER (directory->wd));
+      g_hash_table_remove (inotify_paths, directory->path);
+    }
+
+  g_hash_table_destroy (directory->changed);
+  g_object_unref (directory->directory);
+  g_free (directory->path);
+  g_slice_free (ThunarInotifyDirectory, directory);
+}
+
+
+
+static void
+thunar_inotify_watch_unref (ThunarInotifyWatch *watch)
+{
+  if (--watch->ref_count > 0)
+    return;
+
+  watch->directory->watches = g_list_remove (watch->directory->watches, watch);
+  if (watch->directory->watches == NULL)
+    thunar_inotify_directory_free (watch->directory);
+
+  if (watch->events != NULL)
+    g_array_free (watch->events, TRUE);
+  g_free (watch->name);
+  g_slice_free (ThunarInotifyWatch, watch);
+}
+
+
+
+static GFileMonitorEvent
+thunar_inotify_event_type (guint32 mask)
+{
+  if ((mask & IN_CREATE) != 0)
+    return G_FILE_MONITOR_EVENT_CREATED;
+  if ((mask & (IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF)) != 0)
+    return G_FILE_MONITOR_EVENT_DELETED;
+  if ((mask & IN_MOVED_FROM) != 0)
+    return G_FILE_MONITOR_EVENT_MOVED_OUT;
+  if ((mask & IN_MOVED_TO) != 0)
+    return G_FILE_MONITOR_EVENT_MOVED_IN;
+  if ((mask & IN_CLOSE_WRITE) != 0)
+    return G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT;
+  if ((mask & IN_ATTRIB) != 0)
+    return G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED;
+  if ((mask & IN_UNMOUNT) != 0)
+    return G_FILE_MONITOR_EVENT_UNMOUNTED;
+
+  return G_FILE_MONITOR_EVENT_CHANGED;
+}
+
+
+
+/* drops change events of files which were reported changed just before */
+static gboolean
+thunar_inotify_skip_changed (ThunarInotifyDirectory *directory,
+                             const gchar            *name,
+                             gint64                  now)
+{
+  gpointer last;
+
+  if (g_hash_table_lookup_extended (directory->changed, name, NULL, &last)
+      && now - *((gint64 *) last) < THUNAR_INOTIFY_CHANGED_INTERVAL)
+    return TRUE;
+
+  g_hash_table_insert (directory->changed, g_strdup (name), g_memdup2 (&now, sizeof (now)));
+  return FALSE;
+}
+
+
+
+static void
+thunar_inotify_expire_changed (gint64 now)
+{
+  ThunarInotifyDirectory *directory;
+  GHashTableIter          iter;
+  GHashTableIter          changed_iter;
+  gpointer                last;
+
+  g_hash_table_iter_init (&iter, inotify_wds);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &directory))
+    {
+      g_hash_table_iter_init (&changed_iter, directory->changed);
+      while (g_hash_table_iter_next (&changed_iter, NULL, &last))
+        if (now - *((gint64 *) last) >= THUNAR_INOTIFY_CHANGED_INTERVAL)
+          g_hash_table_iter_remove (&changed_iter);
+    }
+}
+
+
+
+static void
+thunar_inotify_parse (const struct inotify_event *event,
+                      GArray                     *pending,
+                      GHashTable                 *moves,
+                      gboolean                   *overflow,
+                      gint64                      now)
+{
+  ThunarInotifyDirectory *directory;
+  ThunarInotifyPending    item = { { 0, }, };
+  ThunarInotifyPending   *from;
+  const gchar            *name = event->len > 0 ? event->name : NULL;
+  gpointer                index;
+
+  if ((event->mask & IN_Q_OVERFLOW) != 0)
+    {
+      *overflow = TRUE;
+      return;
+    }
+
+  directory = g_hash_table_lookup (inotify_wds, GINT_TO_POINTER (event->wd));
+  if (directory == NULL)
+    return;
+
+  /* the kernel dropped the watch, following a delete or unmount */
+  if ((event->mask & IN_IGNORED) != 0)
+    {
+      g_hash_table_remove (inotify_wds, GINT_TO_POINTER (directory->wd));
+      g_hash_table_remove (inotify_paths, directory->path);
+      directory->wd = -1;
+      return;
+    }
+
+  item.event.event_type = thunar_inotify_event_type (event->mask);
+
+  if (item.event.event_type == G_FILE_MONITOR_EVENT_CHANGED
+      && name != NULL && thunar_inotify_skip_changed (directory, name, now))
+    return;
+
+  /* pair the second half of a move with the first one */
+  if (item.event.event_type == G_FILE_MONITOR_EVENT_MOVED_IN
+      && event->cookie != 0
+      && g_hash_table_lookup_extended (moves, GUINT_TO_POINTER (event->cookie), NULL, &index))
+    {
+      from = &g_array_index (pending, ThunarInotifyPending, GPOINTER_TO_UINT (index));
+      g_hash_table_remove (moves, GUINT_TO_POINTER (event->cookie));
+
+      if (from->directory == directory)
+        {
+          from->event.event_type = G_FILE_MONITOR_EVENT_RENAMED;
+          from->event.other_file = g_file_get_child (directory->directory, name);
+          from->other_name = g_strdup (name);
+          return;
+        }
+
+      from->event.other_file = g_file_get_child (directory->directory, name);
+      item.event.other_file = g_object_ref (from->event.file);
+    }
+
+  item.directory = directory;
+  item.name = g_strdup (name);
+  item.cookie = event->cookie;
+  item.event.file = (name != NULL) ? g_file_get_child (directory->directory, name) : g_object_ref (directory->directory);
+
+  if (item.event.event_type == G_FILE_MONITOR_EVENT_MOVED_OUT && event->cookie != 0)
+    g_hash_table_insert (moves, GUINT_TO_POINTER (event->cookie), GUINT_TO_POINTER (pending->len));
+
+  g_array_append_val (pending, item);
+}
+
+
+
+static void
+thunar_inotify_queue (ThunarInotifyWatch       *watch,
+                      GPtrArray                *watches,
+                      const ThunarInotifyEvent *event)
+{
+  if (watch->func == NULL)
+    return;
+
+  if (watch->events == NULL)
+    {
+      watch->events = g_array_new (FALSE, FALSE, sizeof (ThunarInotifyEvent));
+      watch->ref_count++;
+      g_ptr_array_add (watches, watch);
+    }
+
+  g_array_append_vals (watch->events, event, 1);
+}
+
+
+
+static void
+thunar_inotify_dispatch (GArray   *pending,
+                         gboolean  overflow)
+{
+  ThunarInotifyDirectory *directory;
+  ThunarInotifyPending   *item;
+  ThunarInotifyWatch     *watch;
+  ThunarInotifyEvent      event;
+  GHashTableIter          iter;
+  GPtrArray              *directory_watches = g_ptr_array_new ();
+  GPtrArray              *file_watches = g_ptr_array_new ();
+  GArray                 *events;
+  GList                  *lp;
+
+  /* sort the events into the batches of the watches */
+  for (guint n = 0; n < pending->len; n++)
+    {
+      item = &g_array_index (pending, ThunarInotifyPending, n);
+      for (lp = item->directory->watches; lp != NULL; lp = lp->next)
+        {
+          watch = lp->data;
+          if (watch->name == NULL)
+            {
+              thunar_inotify_queue (watch, directory_watches, &item->event);
+            }
+          else if (g_strcmp0 (watch->name, item->name) == 0)
+            {
+              event = item->event;
+              if (event.event_type == G_FILE_MONITOR_EVENT_RENAMED
+                  || event.event_type == G_FILE_MONITOR_EVENT_MOVED_OUT)
+                event.event_type = G_FILE_MONITOR_EVENT_DELETED;
+              else if (event.event_type == G_FILE_MONITOR_EVENT_MOVED_IN)
+                event.event_type = G_FILE_MONITOR_EVENT_CREATED;
+              event.other_file = NULL;
+              thunar_inotify_queue (watch, file_watches, &event);
+            }
+          else if (g_strcmp0 (watch->name, item->other_name) == 0)
+            {
+              event.event_type = G_FILE_MONITOR_EVENT_CREATED;
+              event.file = item->event.other_file;
+              event.other_file = NULL;
+              thunar_inotify_queue (watch, file_watches, &event);
+            }
+        }
+    }
+
+  /* folders first, which follow renames of their files */
+  g_ptr_array_extend_and_steal (directory_watches, file_watches);
+  for (guint n = 0; n < directory_watches->len; n++)
+    {
+      watch = g_ptr_array_index (directory_watches, n);
+      events = g_steal_pointer (&watch->events);
+      if (watch->func != NULL)
+        (*watch->func) ((const ThunarInotifyEvent *) events->data, events->len, watch->user_data);
+      g_array_free (events, TRUE);
+    }
+
+  /* all watches have to read their files again after an overflow */
+  if (G_UNLIKELY (overflow))
+    {
+      g_hash_table_iter_init (&iter, inotify_wds);
+      while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &directory))
+        for (lp = directory->watches; lp != NULL; lp = lp->next)
+          {
+            watch = lp->data;
+            watch->ref_count++;
+            g_ptr_array_add (directory_watches, watch);
+          }
+
+      for (guint n = 0; n < directory_watches->len; n++)
+        {
+          watch = g_ptr_array_index (directory_watches, n);
+          if (watch->func != NULL)
+            (*watch->func) (NULL, 0, watch->user_data);
+        }
+    }
+
+  for (guint n = 0; n < directory_watches->len; n++)
+    thunar_inotify_watch_unref (g_ptr_array_index (directory_watches, n));
+  g_ptr_array_free (directory_watches, TRUE);
+}
+
+
+
+static gboolean
+thunar_inotify_read (gint         fd,
+                     GIOCondition condition,
+                     gpointer     user_data)
+{
+  union
+  {
+    struct inotify_event event;
+    gchar                data[THUNAR_INOTIFY_BUFFER_SIZE];
+  }                     buffer;
+  const struct inotify_event *event;
+  ThunarInotifyPending *item;
+  GHashTable           *moves;
+  gboolean              overflow = FALSE;
+  GArray               *pending;
+  gssize                n_bytes;
+  gssize                offset;
+  gint64                now = g_get_monotonic_time ();
+
+  pending = g_array_new (FALSE, FALSE, sizeof (ThunarInotifyPending));
+  moves = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  thunar_inotify_expire_changed (now);
+
+  for (guint n = 0; n < THUNAR_INOTIFY_MAX_READS; n++)
+    {
+      n_bytes = read (fd, buffer.data, sizeof (buffer.data));
+      if (n_bytes <= 0)
+        break;
+
+      for (offset = 0; offset < n_bytes; offset += sizeof (struct inotify_event) + event->len)
+        {
+          event = (const struct inotify_event *) (buffer.data + offset);
+          thunar_inotify_parse (event, pending, moves, &overflow, now);
+        }
+    }
+
+  thunar_inotify_dispatch (pending, overflow);
+
+  for (guint n = 0; n < pending->len; n++)
+    {
+      item = &g_array_index (pending, ThunarInotifyPending, n);
+      g_object_unref (item->event.file);
+      if (item->event.other_file != NULL)
+        g_object_unref (item->event.other_file);
+      g_free (item->name);
+      g_free (item->other_name);
+    }
+
+  g_array_free (pending, TRUE);
+  g_hash_table_destroy (moves);
+
+  return G_SOURCE_CONTINUE;
+}
+
+
+
+static ThunarInotifyDirectory *
+thunar_inotify_get_directory (GFile *file)
+{
+  ThunarInotifyDirectory *directory;
+  const gchar            *path;
+  gint                    wd;
+
+  path = g_file_peek_path (file);
+  if (path == NULL || inotify_failed)
+    return NULL;
+
+  if (G_UNLIKELY (inotify_fd < 0))
+    {
+      inotify_fd = inotify_init1 (IN_NONBLOCK | IN_CLOEXEC);
+      if (inotify_fd < 0)
+        {
+          g_debug ("Failed to initialize inotify: %s", g_strerror (errno));
+          inotify_failed = TRUE;
+          return NULL;
+        }
+
+      g_unix_fd_add (inotify_fd, G_IO_IN, thunar_inotify_read, NULL);
+      inotify_paths = g_hash_table_new (g_str_hash, g_str_equal);
+      inotify_wds = g_hash_table_new (g_direct_hash, g_direct_equal);
+    }
+
+  directory = g_hash_table_lookup (inotify_paths, path);
+  if (directory != NULL)
+    return directory;
+
+  wd = inotify_add_watch (inotify_fd, path, THUNAR_INOTIFY_MASK);
+  if (wd < 0)
+    return NULL;
+
+  /* another path of a folder which is watched already */
+  if (g_hash_table_contains (inotify_wds, GINT_TO_POINTER (wd)))
+    return NULL;
+
+  directory = g_slice_new0 (ThunarInotifyDirectory);
+  directory->wd = wd;
+  directory->path = g_strdup (path);
+  directory->directory = g_object_ref (file);
+  directory->changed = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  g_hash_table_insert (inotify_paths, directory->path, directory);
+  g_hash_table_insert (inotify_wds, GINT_TO_POINTER (wd), directory);
+
+  return directory;
+}
+
+
+
+static ThunarInotifyWatch *
+thunar_inotify_watch_new (GFile             *directory_file,
+                          gchar             *name,
+                          ThunarInotifyFunc  func,
+                          gpointer           user_data)
+{
+  ThunarInotifyDirectory *directory;
+  ThunarInotifyWatch     *watch;
+
+  directory = thunar_inotify_get_directory (directory_file);
+  if (directory == NULL)
+    {
+      g_free (name);
+      return NULL;
+    }
+
+  watch = g_slice_new0 (ThunarInotifyWatch);
+  watch->directory = directory;
+  watch->name = name;
+  watch->func = func;
+  watch->user_data = user_data;
+  watch->ref_count = 1;
+  directory->watches = g_list_prepend (directory->watches, watch);
+
+  return watch;
+}
+#endif /* HAVE_SYS_INOTIFY_H */
+
+
+
+/**
+ * thunar_inotify_watch_directory:
+ * @directory : a local folder.
+ * @func      : the function to pass the events to.
+ * @user_data : data to pass to @func.
+ *
+ * Watches @directory and its children.
+ *
+ * Return value: the watch, or %NULL if @directory cannot be
+ *               watched with inotify.
+ **/
+ThunarInotifyWatch *
+thunar_inotify_watch_directory (GFile             *directory,
+                                ThunarInotifyFunc  func,
+                                gpointer           user_data)
+{
+  _thunar_return_val_if_fail (G_IS_FILE (directory), NULL);
+  _thunar_return_val_if_fail (func != NULL, NULL);
+
+#ifdef HAVE_SYS_INOTIFY_H
+  return thunar_inotify_watch_new (directory, NULL, func, user_data);
+#else
+  return NULL;
+#endif
+}
+
+
+
+/**
+ * thunar_inotify_watch_file:
+ * @file      : a local file.
+ * @func      : the function to pass the events to.
+ * @user_data : data to pass to @func.
+ *
+ * Watches @file through the inotify watch of its parent folder.
+ *
+ * Return value: the watch, or %NULL if @file cannot be
+ *               watched with inotify.
+ **/
+ThunarInotifyWatch *
+thunar_inotify_watch_file (GFile             *file,
+                           ThunarInotifyFunc  func,
+                           gpointer           user_data)
+{
+#ifdef HAVE_SYS_INOTIFY_H
+  ThunarInotifyWatch *watch;
+  GFile              *parent;
+#endif
+
+  _thunar_return_val_if_fail (G_IS_FILE (file), NULL);
+  _thunar_return_val_if_fail (func != NULL, NULL);
+
+#ifdef HAVE_SYS_INOTIFY_H
+  parent = g_file_get_parent (file);
+  if (parent == NULL)
+    return NULL;
+
+  watch = thunar_inotify_watch_new (parent, g_file_get_basename (file), func, user_data);
+  g_object_unref (parent);
+
+  return watch;
+#else
+  return NULL;
+#endif
+}
+
+
+
+/**
+ * thunar_inotify_unwatch:
+ * @watch : a #ThunarInotifyWatch.
+ *
+ * Stops @watch. It may be called from the function of any watch,
+ * @watch will not get any more events then.
+ **/
+void
+thunar_inotify_unwatch (ThunarInotifyWatch *watch)
+{
+  _thunar_return_if_fail (watch != NULL);
+
+#ifdef HAVE_SYS_INOTIFY_H
+  watch->func = NULL;
+  thunar_inotify_watch_unref (watch);
+#endif
+}
@@ -0,0 +1,56 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __THUNAR_INOTIFY_H__
+#define __THUNAR_INOTIFY_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct _ThunarInotifyWatch ThunarInotifyWatch;
+typedef struct _ThunarInotifyEvent ThunarInotifyEvent;
+
+struct _ThunarInotifyEvent
+{
+  GFileMonitorEvent  event_type;
+  GFile             *file;
+  GFile             *other_file;  /* for renames and moves, or %NULL */
+};
+
+/**
+ * ThunarInotifyFunc:
+ * @events    : the events which occurred, in order.
+ * @n_events  : the number of @events, 0 if the kernel dropped events
+ *              and the watched files have to be read again.
+ * @user_data : the data passed to thunar_inotify_watch_directory()
+ *              or thunar_inotify_watch_file().
+ **/
+typedef void (*ThunarInotifyFunc) (const ThunarInotifyEvent *events,
+                                   guint                     n_events,
+                                   gpointer                  user_data);
+
+ThunarInotifyWatch *thunar_inotify_watch_directory (GFile              *directory,
+                                                    ThunarInotifyFunc   func,
+                                                    gpointer            user_data);
+ThunarInotifyWatch *thunar_inotify_watch_file      (GFile              *file,
+                                                    ThunarInotifyFunc   func,
+                                                    gpointer            user_data);
+void                thunar_inotify_unwatch         (ThunarInotifyWatch *watch);
+
+G_END_DECLS
+
+#endif /* !__THUNAR_INOTIFY_H__ */
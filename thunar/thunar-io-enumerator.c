@@ -0,0 +1,764 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/* The enumerator lists the children of a folder like a GFileEnumerator.
+ * Local folders on Linux are read without GIO: the entries come in big
+ * getdents64() batches, and statx() is asked only for the fields of the
+ * requested attributes, or not called at all if the type of the entry is
+ * all that is needed. The infos get the attributes the GIO enumerator
+ * would set, except the access rights, which are computed from the mode
+ * and the groups of the user instead of one access() call per right and
+ * file, so ACLs are not considered for them. Other folders, and attributes
+ * beyond THUNAR_FILE_INFO_NAMESPACE, are left to the GIO enumerator. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#if defined (HAVE_LINUX) && defined (HAVE_STATX) && defined (HAVE_SYS_SYSCALL_H) \
+ && defined (HAVE_DIRENT_H) && defined (HAVE_FCNTL_H) && defined (HAVE_UNISTD_H)
+#define THUNAR_IO_ENUMERATOR_NATIVE 1
+#endif
+
+#ifdef THUNAR_IO_ENUMERATOR_NATIVE
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <sys/syscall.h>
+#ifdef HAVE_SYS_SYSMACROS_H
+#include <sys/sysmacros.h>
+#endif
+#include <unistd.h>
+#endif
+
+#include <libxfce4util/libxfce4util.h>
+
+#include "thunar/thunar-io-enumerator.h"
+#include "thunar/thunar-private.h"
+
+
+
+#ifdef THUNAR_IO_ENUMERATOR_NATIVE
+
+/* the size of the buffer for the entries of one getdents64() call */
+#define THUNAR_IO_ENUMERATOR_BUFFER_SIZE (64 * 1024)
+
+/* the attributes which are set for local files */
+#define THUNAR_IO_ENUMERATOR_NATIVE_ATTRIBUTES \
+  "access::*,id::filesystem,time::*,unix::gid,unix::uid,unix::mode," \
+  "standard::type,standard::is-hidden,standard::is-backup,standard::is-symlink," \
+  "standard::name,standard::display-name,standard::size,standard::allocated-size," \
+  "standard::symlink-target,standard::target-uri," \
+  "mountable::*,preview::*,recent::*,trash::*"
+
+/* the attributes which need nothing but the directory entry, the ones
+ * of the last line are never set for local files */
+#define THUNAR_IO_ENUMERATOR_DIRENT_ATTRIBUTES \
+  "standard::type,standard::is-hidden,standard::is-backup," \
+  "standard::name,standard::display-name," \
+  "standard::target-uri,mountable::*,preview::*,recent::*,trash::*"
+
+/* the fields of the files queried from statx() for the other attributes */
+#define THUNAR_IO_ENUMERATOR_STATX_MASK \
+  (STATX_TYPE | STATX_MODE | STATX_UID | STATX_GID | STATX_SIZE | STATX_BLOCKS \
+   | STATX_ATIME | STATX_MTIME | STATX_CTIME | STATX_BTIME)
+
+
+
+/* the entries returned by getdents64(), which older C libraries don't wrap */
+typedef struct
+{
+  guint64 d_ino;
+  gint64  d_off;
+  gushort d_reclen;
+  guchar  d_type;
+  gchar   d_name[];
+}
+ThunarIoDirent;
+
+#endif /* THUNAR_IO_ENUMERATOR_NATIVE */
+
+struct _ThunarIoEnumerator
+{
+  /* the GIO enumerator, or %NULL if the folder is read natively */
+  GFileEnumerator *gio_enumerator;
+
+#ifdef THUNAR_IO_ENUMERATOR_NATIVE
+  GFile           *directory;
+  gint             fd;
+  gboolean         follow_symlinks;
+
+  /* the entries of the last getdents64() call */
+  gchar           *buffer;
+  gsize            buffer_len;
+  gsize            buffer_pos;
+  gboolean         eof;
+
+  /* reported by the next call, after the infos read before it */
+  GError          *pending_error;
+
+  /* the statx() fields needed, 0 if the entries are enough */
+  guint            stat_mask;
+
+  /* the names listed in the .hidden file of the folder, or %NULL */
+  GHashTable      *hidden_names;
+
+  /* the user and the folder, for the access rights */
+  uid_t            uid;
+  gid_t            gid;
+  gid_t           *groups;
+  gint             n_groups;
+  gboolean         read_only;
+  gboolean         dir_writable;
+  gboolean         dir_sticky;
+  uid_t            dir_owner;
+  gint             dir_has_trash; /* -1 if not known yet */
+#endif
+};
+
+
+
+#ifdef THUNAR_IO_ENUMERATOR_NATIVE
+static gboolean
+thunar_io_enumerator_matches_only (GFileAttributeMatcher *matcher,
+                                   const gchar           *attributes)
+{
+  GFileAttributeMatcher *supported;
+  GFileAttributeMatcher *rest;
+  gchar                 *rest_string;
+  gboolean               matches_only;
+
+  supported = g_file_attribute_matcher_new (attributes);
+  rest = g_file_attribute_matcher_subtract (matcher, supported);
+  rest_string = g_file_attribute_matcher_to_string (rest);
+  matches_only = (rest_string == NULL || *rest_string == '\0');
+  g_free (rest_string);
+  g_file_attribute_matcher_unref (rest);
+  g_file_attribute_matcher_unref (supported);
+
+  return matches_only;
+}
+
+
+
+static void
+thunar_io_enumerator_load_hidden (ThunarIoEnumerator *enumerator,
+                                  const gchar        *path)
+{
+  gchar  *contents;
+  gchar  *hidden_path;
+  gchar **lines;
+  guint   n;
+
+  /* the names in the .hidden file are hidden like the dot files */
+  hidden_path = g_build_filename (path, ".hidden", NULL);
+  if (g_file_get_contents (hidden_path, &contents, NULL, NULL))
+    {
+      enumerator->hidden_names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+      lines = g_strsplit (contents, "\n", -1);
+      for (n = 0; lines[n] != NULL; ++n)
+        if (*lines[n] != '\0')
+          g_hash_table_add (enumerator->hidden_names, g_steal_pointer (&lines[n]));
+      g_strfreev (lines);
+      g_free (contents);
+    }
+  g_free (hidden_path);
+}
+
+
+
+static gboolean
+thunar_io_enumerator_open_native (ThunarIoEnumerator  *enumerator,
+                                  GFile               *directory,
+                                  const gchar         *attributes,
+                                  GFileQueryInfoFlags  flags)
+{
+  GFileAttributeMatcher *matcher;
+  struct statvfs         fs_info;
+  struct stat            dir_info;
+  gchar                 *path;
+  gint                   n_groups;
+
+  if (!g_file_is_native (directory))
+    return FALSE;
+
+  matcher = g_file_attribute_matcher_new (attributes);
+  if (!thunar_io_enumerator_matches_only (matcher, THUNAR_IO_ENUMERATOR_NATIVE_ATTRIBUTES))
+    {
+      g_file_attribute_matcher_unref (matcher);
+      return FALSE;
+    }
+
+  path = g_file_get_path (directory);
+  if (G_UNLIKELY (path == NULL))
+    {
+      g_file_attribute_matcher_unref (matcher);
+      return FALSE;
+    }
+
+  /* errors opening the folder are reported by the GIO enumerator */
+  enumerator->fd = open (path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (enumerator->fd < 0 || fstat (enumerator->fd, &dir_info) != 0)
+    {
+      if (enumerator->fd >= 0)
+        close (enumerator->fd);
+      enumerator->fd = -1;
+      g_file_attribute_matcher_unref (matcher);
+      g_free (path);
+      return FALSE;
+    }
+
+  enumerator->directory = g_object_ref (directory);
+  enumerator->follow_symlinks = (flags & G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS) == 0;
+  enumerator->buffer = g_malloc (THUNAR_IO_ENUMERATOR_BUFFER_SIZE);
+  enumerator->dir_has_trash = -1;
+
+  if (!thunar_io_enumerator_matches_only (matcher, THUNAR_IO_ENUMERATOR_DIRENT_ATTRIBUTES))
+    {
+      enumerator->stat_mask = THUNAR_IO_ENUMERATOR_STATX_MASK;
+
+      enumerator->uid = getuid ();
+      enumerator->gid = getgid ();
+      n_groups = getgroups (0, NULL);
+      if (n_groups > 0)
+        {
+          enumerator->groups = g_new (gid_t, n_groups);
+          enumerator->n_groups = MAX (getgroups (n_groups, enumerator->groups), 0);
+        }
+
+      enumerator->read_only = (fstatvfs (enumerator->fd, &fs_info) == 0 && (fs_info.f_flag & ST_RDONLY) != 0);
+      enumerator->dir_writable = (access (path, W_OK) == 0);
+      enumerator->dir_sticky = (dir_info.st_mode & S_ISVTX) != 0;
+      enumerator->dir_owner = dir_info.st_uid;
+    }
+
+  if (g_file_attribute_matcher_matches (matcher, G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN))
+    thunar_io_enumerator_load_hidden (enumerator, path);
+
+  g_file_attribute_matcher_unref (matcher);
+  g_free (path);
+
+  return TRUE;
+}
+
+
+
+static GFileType
+thunar_io_enumerator_type_from_mode (guint mode)
+{
+  if (S_ISREG (mode))
+    return G_FILE_TYPE_REGULAR;
+  else if (S_ISDIR (mode))
+    return G_FILE_TYPE_DIRECTORY;
+  else if (S_ISLNK (mode))
+    return G_FILE_TYPE_SYMBOLIC_LINK;
+  else if (S_ISCHR (mode) || S_ISBLK (mode) || S_ISFIFO (mode) || S_ISSOCK (mode))
+    return G_FILE_TYPE_SPECIAL;
+  else
+    return G_FILE_TYPE_UNKNOWN;
+}
+
+
+
+static GFileType
+thunar_io_enumerator_type_from_dirent (guchar d_type)
+{
+  switch (d_type)
+    {
+    case DT_REG:
+      return G_FILE_TYPE_REGULAR;
+    case DT_DIR:
+      return G_FILE_TYPE_DIRECTORY;
+    case DT_LNK:
+      return G_FILE_TYPE_SYMBOLIC_LINK;
+    case DT_CHR:
+    case DT_BLK:
+    case DT_FIFO:
+    case DT_SOCK:
+      return G_FILE_TYPE_SPECIAL;
+    default:
+      return G_FILE_TYPE_UNKNOWN;
+    }
+}
+
+
+
+static gboolean
+thunar_io_enumerator_has_right (ThunarIoEnumerator *enumerator,
+                                const struct statx *stx,
+                                guint               right)
+{
+  gint n;
+
+  /* root may do anything, but execute only what anybody may execute */
+  if (enumerator->uid == 0)
+    return (right != S_IXOTH) || S_ISDIR (stx->stx_mode) || (stx->stx_mode & (S_IXUSR | S_IXGRP | S_IXOTH)) != 0;
+
+  if (stx->stx_uid == enumerator->uid)
+    return (stx->stx_mode & (right << 6)) != 0;
+
+  if (stx->stx_gid == enumerator->gid)
+    return (stx->stx_mode & (right << 3)) != 0;
+  for (n = 0; n < enumerator->n_groups; ++n)
+    if (stx->stx_gid == enumerator->groups[n])
+      return (stx->stx_mode & (right << 3)) != 0;
+
+  return (stx->stx_mode & right) != 0;
+}
+
+
+
+static void
+thunar_io_enumerator_set_access (ThunarIoEnumerator *enumerator,
+                                 GFileInfo          *info,
+                                 const gchar        *name,
+                                 const struct statx *stx)
+{
+  GFileInfo *trash_info;
+  GFile     *file;
+  gboolean   writable;
+
+  g_file_info_set_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_READ,
+                                     thunar_io_enumerator_has_right (enumerator, stx, S_IROTH));
+  g_file_info_set_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_WRITE,
+                                     !enumerator->read_only && thunar_io_enumerator_has_right (enumerator, stx, S_IWOTH));
+  g_file_info_set_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_EXECUTE,
+                                     thunar_io_enumerator_has_right (enumerator, stx, S_IXOTH));
+
+  /* deleting and renaming is up to the folder, like in GIO */
+  writable = enumerator->dir_writable;
+  if (writable && enumerator->dir_sticky)
+    writable = (enumerator->uid == 0 || stx->stx_uid == enumerator->uid || enumerator->dir_owner == enumerator->uid);
+
+  g_file_info_set_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_DELETE, writable);
+  g_file_info_set_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_RENAME, writable);
+
+  /* whether the file system of the folder has a trash is asked from GIO
+   * for one file, the answer holds for all the files it may delete */
+  if (writable && enumerator->dir_has_trash < 0)
+    {
+      file = g_file_get_child (enumerator->directory, name);
+      trash_info = g_file_query_info (file, G_FILE_ATTRIBUTE_ACCESS_CAN_TRASH, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, NULL, NULL);
+      if (trash_info != NULL)
+        {
+          enumerator->dir_has_trash = g_file_info_get_attribute_boolean (trash_info, G_FILE_ATTRIBUTE_ACCESS_CAN_TRASH);
+          g_object_unref (trash_info);
+        }
+      g_object_unref (file);
+    }
+
+  g_file_info_set_attribute_boolean (info, G_FILE_ATTRIBUTE_ACCESS_CAN_TRASH, writable && enumerator->dir_has_trash > 0);
+}
+
+
+
+static gchar *
+thunar_io_enumerator_read_link (ThunarIoEnumerator *enumerator,
+                                const gchar        *name,
+                                gsize               size_hint)
+{
+  gssize  len;
+  gchar  *target;
+  gsize   size = MAX (size_hint + 1, 256);
+
+  for (;;)
+    {
+      target = g_malloc (size);
+      len = readlinkat (enumerator->fd, name, target, size);
+      if (len < 0)
+        {
+          g_free (target);
+          return NULL;
+        }
+      if ((gsize) len < size)
+        {
+          target[len] = '\0';
+          return target;
+        }
+
+      /* the link changed in between, try again with more room */
+      g_free (target);
+      size *= 2;
+    }
+}
+
+
+
+static GFileInfo *
+thunar_io_enumerator_native_info (ThunarIoEnumerator *enumerator,
+                                  const gchar        *name,
+                                  guchar              d_type,
+                                  GError            **error)
+{
+  struct statx  stx;
+  struct statx  target_stx;
+  GFileInfo    *info;
+  GFileType     type;
+  gboolean      is_symlink = FALSE;
+  gboolean      have_stat = FALSE;
+  gchar        *display_name;
+  gchar        *encoded_name;
+  gchar        *target = NULL;
+  gchar        *id;
+  gsize         len;
+  guint         mask;
+  gint          saved_errno;
+
+  /* the entry alone tells the type, unless a link has to be followed */
+  type = thunar_io_enumerator_type_from_dirent (d_type);
+  if (enumerator->stat_mask != 0
+      || d_type == DT_UNKNOWN
+      || (d_type == DT_LNK && enumerator->follow_symlinks))
+    {
+      mask = (enumerator->stat_mask != 0) ? enumerator->stat_mask : STATX_TYPE;
+      if (statx (enumerator->fd, name, AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT, mask, &stx) == 0)
+        {
+          have_stat = TRUE;
+        }
+      else
+        {
+          saved_errno = errno;
+
+          /* the file is gone already, like GIO skip it */
+          if (saved_errno == ENOENT)
+            return NULL;
+
+          /* like GIO, only the name is known of files which may not be looked at */
+          if (saved_errno != EACCES)
+            {
+              g_set_error (error, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                           "Error when getting information for file \"%s\": %s",
+                           name, g_strerror (saved_errno));
+              return NULL;
+            }
+        }
+    }
+
+  if (have_stat)
+    {
+      is_symlink = S_ISLNK (stx.stx_mode);
+      if (is_symlink && enumerator->stat_mask != 0)
+        target = thunar_io_enumerator_read_link (enumerator, name, stx.stx_size);
+
+      /* the attributes of a link are the ones of its target, if any */
+      if (is_symlink
+          && enumerator->follow_symlinks
+          && statx (enumerator->fd, name, AT_NO_AUTOMOUNT, mask, &target_stx) == 0)
+        stx = target_stx;
+
+      type = thunar_io_enumerator_type_from_mode (stx.stx_mode);
+    }
+
+  info = g_file_info_new ();
+  g_file_info_set_name (info, name);
+  g_file_info_set_file_type (info, type);
+
+  display_name = g_filename_display_name (name);
+  if (G_UNLIKELY (strstr (display_name, "\357\277\275") != NULL))
+    {
+      /* the same marker for names in another encoding as in GIO */
+      encoded_name = g_strconcat (display_name, _(" (invalid encoding)"), NULL);
+      g_free (display_name);
+      display_name = encoded_name;
+    }
+  g_file_info_set_display_name (info, display_name);
+  g_free (display_name);
+
+  g_file_info_set_is_hidden (info, name[0] == '.'
+                             || (enumerator->hidden_names != NULL && g_hash_table_contains (enumerator->hidden_names, name)));
+  len = strlen (name);
+  g_file_info_set_is_backup (info, type == G_FILE_TYPE_REGULAR && len > 0 && name[len - 1] == '~');
+
+  if (enumerator->stat_mask == 0 || !have_stat)
+    return info;
+
+  g_file_info_set_is_symlink (info, is_symlink);
+  if (target != NULL)
+    {
+      g_file_info_set_symlink_target (info, target);
+      g_free (target);
+    }
+
+  g_file_info_set_size (info, stx.stx_size);
+  g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_ALLOCATED_SIZE, stx.stx_blocks * G_GUINT64_CONSTANT (512));
+
+  g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_MODE, stx.stx_mode);
+  g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_UID, stx.stx_uid);
+  g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_GID, stx.stx_gid);
+
+  g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED, stx.stx_mtime.tv_sec);
+  g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED_USEC, stx.stx_mtime.tv_nsec / 1000);
+  g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_ACCESS, stx.stx_atime.tv_sec);
+  g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_ACCESS_USEC, stx.stx_atime.tv_nsec / 1000);
+  g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_CHANGED, stx.stx_ctime.tv_sec);
+  g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_CHANGED_USEC, stx.stx_ctime.tv_nsec / 1000);
+  if ((stx.stx_mask & STATX_BTIME) != 0)
+    {
+      g_file_info_set_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_CREATED, stx.stx_btime.tv_sec);
+      g_file_info_set_attribute_uint32 (info, G_FILE_ATTRIBUTE_TIME_CREATED_USEC, stx.stx_btime.tv_nsec / 1000);
+    }
+
+  /* the same id as GIO uses for local file systems */
+  id = g_strdup_printf ("l%" G_GUINT64_FORMAT, (guint64) makedev (stx.stx_dev_major, stx.stx_dev_minor));
+  g_file_info_set_attribute_string (info, G_FILE_ATTRIBUTE_ID_FILESYSTEM, id);
+  g_free (id);
+
+  thunar_io_enumerator_set_access (enumerator, info, name, &stx);
+
+  return info;
+}
+
+
+
+static GFileInfo *
+thunar_io_enumerator_next_native (ThunarIoEnumerator *enumerator,
+                                  GError            **error)
+{
+  ThunarIoDirent *entry;
+  GFileInfo      *info;
+  GError         *err = NULL;
+  glong           n;
+
+  if (G_UNLIKELY (enumerator->pending_error != NULL))
+    {
+      g_propagate_error (error, g_steal_pointer (&enumerator->pending_error));
+      return NULL;
+    }
+
+  for (;;)
+    {
+      if (enumerator->buffer_pos >= enumerator->buffer_len)
+        {
+          if (enumerator->eof)
+            return NULL;
+
+          n = syscall (SYS_getdents64, enumerator->fd, enumerator->buffer, THUNAR_IO_ENUMERATOR_BUFFER_SIZE);
+          if (G_UNLIKELY (n < 0))
+            {
+              if (errno == EINTR)
+                continue;
+
+              g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errno),
+                           "Error while reading directory: %s", g_strerror (errno));
+              enumerator->eof = TRUE;
+              return NULL;
+            }
+          else if (n == 0)
+            {
+              enumerator->eof = TRUE;
+              return NULL;
+            }
+
+          enumerator->buffer_len = n;
+          enumerator->buffer_pos = 0;
+        }
+
+      entry = (ThunarIoDirent *) (enumerator->buffer + enumerator->buffer_pos);
+      enumerator->buffer_pos += entry->d_reclen;
+
+      if (strcmp (entry->d_name, ".") == 0 || strcmp (entry->d_name, "..") == 0)
+        continue;
+
+      info = thunar_io_enumerator_native_info (enumerator, entry->d_name, entry->d_type, &err);
+      if (G_UNLIKELY (err != NULL))
+        {
+          g_propagate_error (error, err);
+          return NULL;
+        }
+      else if (G_LIKELY (info != NULL))
+        {
+          return info;
+        }
+    }
+}
+#endif /* THUNAR_IO_ENUMERATOR_NATIVE */
+
+
+
+/**
+ * thunar_io_enumerator_new:
+ * @directory   : the #GFile of a folder.
+ * @attributes  : the attributes to query for the children of @directory.
+ * @flags       : the #GFileQueryInfoFlags of the queries.
+ * @cancellable : a #GCancellable, or %NULL.
+ * @error       : return location for errors, or %NULL.
+ *
+ * Starts to list the children of @directory, like
+ * g_file_enumerate_children() does. Local folders are read without
+ * GIO if the attributes allow it, see the top of this file.
+ *
+ * Return value: the new #ThunarIoEnumerator, to be freed with
+ *               thunar_io_enumerator_free(), or %NULL on error.
+ **/
+ThunarIoEnumerator *
+thunar_io_enumerator_new (GFile               *directory,
+                          const gchar         *attributes,
+                          GFileQueryInfoFlags  flags,
+                          GCancellable        *cancellable,
+                          GError             **error)
+{
+  ThunarIoEnumerator *enumerator;
+
+  _thunar_return_val_if_fail (G_IS_FILE (directory), NULL);
+  _thunar_return_val_if_fail (attributes != NULL, NULL);
+  _thunar_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  enumerator = g_slice_new0 (ThunarIoEnumerator);
+
+#ifdef THUNAR_IO_ENUMERATOR_NATIVE
+  enumerator->fd = -1;
+  if (thunar_io_enumerator_open_native (enumerator, directory, attributes, flags))
+    return enumerator;
+#endif
+
+  enumerator->gio_enumerator = g_file_enumerate_children (directory, attributes, flags, cancellable, error);
+  if (G_UNLIKELY (enumerator->gio_enumerator == NULL))
+    {
+      thunar_io_enumerator_free (enumerator);
+      return NULL;
+    }
+
+  return enumerator;
+}
+
+
+
+/**
+ * thunar_io_enumerator_next_file:
+ * @enumerator  : a #ThunarIoEnumerator.
+ * @cancellable : a #GCancellable, or %NULL.
+ * @error       : return location for errors, or %NULL.
+ *
+ * Like g_file_enumerator_next_file().
+ *
+ * Return value: (transfer full): the #GFileInfo of the next child, or
+ *               %NULL at the end or on error.
+ **/
+GFileInfo *
+thunar_io_enumerator_next_file (ThunarIoEnumerator *enumerator,
+                                GCancellable       *cancellable,
+                                GError            **error)
+{
+  _thunar_return_val_if_fail (enumerator != NULL, NULL);
+
+  if (enumerator->gio_enumerator != NULL)
+    return g_file_enumerator_next_file (enumerator->gio_enumerator, cancellable, error);
+
+#ifdef THUNAR_IO_ENUMERATOR_NATIVE
+  if (g_cancellable_set_error_if_cancelled (cancellable, error))
+    return NULL;
+
+  return thunar_io_enumerator_next_native (enumerator, error);
+#else
+  return NULL;
+#endif
+}
+
+
+
+/**
+ * thunar_io_enumerator_next_files:
+ * @enumerator  : a #ThunarIoEnumerator.
+ * @n_files     : the maximum number of infos to return.
+ * @cancellable : a #GCancellable, or %NULL.
+ * @error       : return location for errors, or %NULL.
+ *
+ * Like g_file_enumerator_next_files(). An error after some children
+ * were listed is returned by the next call.
+ *
+ * Return value: (transfer full) (element-type GFileInfo): the #GFileInfo<!---->s
+ *               of the next children, %NULL at the end or on error.
+ **/
+GList *
+thunar_io_enumerator_next_files (ThunarIoEnumerator *enumerator,
+                                 guint               n_files,
+                                 GCancellable       *cancellable,
+                                 GError            **error)
+{
+#ifdef THUNAR_IO_ENUMERATOR_NATIVE
+  GFileInfo *info;
+  GError    *err = NULL;
+  GList     *infos = NULL;
+  guint      n;
+#endif
+
+  _thunar_return_val_if_fail (enumerator != NULL, NULL);
+
+  if (enumerator->gio_enumerator != NULL)
+    return g_file_enumerator_next_files (enumerator->gio_enumerator, n_files, cancellable, error);
+
+#ifdef THUNAR_IO_ENUMERATOR_NATIVE
+  if (g_cancellable_set_error_if_cancelled (cancellable, error))
+    return NULL;
+
+  for (n = 0; n < n_files; ++n)
+    {
+      info = thunar_io_enumerator_next_native (enumerator, &err);
+      if (info == NULL)
+        break;
+      infos = g_list_prepend (infos, info);
+    }
+
+  if (G_UNLIKELY (err != NULL))
+    {
+      if (infos != NULL)
+        enumerator->pending_error = err;
+      else
+        g_propagate_error (error, err);
+    }
+
+  return g_list_reverse (infos);
+#else
+  return NULL;
+#endif
+}
+
+
+
+/**
+ * thunar_io_enumerator_free:
+ * @enumerator : a #ThunarIoEnumerator.
+ *
+ * Closes @enumerator and releases its resources.
+ **/
+void
+thunar_io_enumerator_free (ThunarIoEnumerator *enumerator)
+{
+  _thunar_return_if_fail (enumerator != NULL);
+
+  if (enumerator->gio_enumerator != NULL)
+    g_object_unref (enumerator->gio_enumerator);
+
+#ifdef THUNAR_IO_ENUMERATOR_NATIVE
+  if (enumerator->fd >= 0)
+    close (enumerator->fd);
+  if (enumerator->directory != NULL)
+    g_object_unref (enumerator->directory);
+  if (enumerator->hidden_names != NULL)
+    g_hash_table_destroy (enumerator->hidden_names);
+  if (enumerator->pending_error != NULL)
+    g_error_free (enumerator->pending_error);
+  g_free (enumerator->buffer);
+  g_free (enumerator->groups);
+#endif
+
+  g_slice_free (ThunarIoEnumerator, enumerator);
+}
@@ -0,0 +1,43 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __THUNAR_IO_ENUMERATOR_H__
+#define __THUNAR_IO_ENUMERATOR_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct _ThunarIoEnumerator ThunarIoEnumerator;
+
+ThunarIoEnumerator *thunar_io_enumerator_new        (GFile               *directory,
+                                                     const gchar         *attributes,
+                                                     GFileQueryInfoFlags  flags,
+                                                     GCancellable        *cancellable,
+                                                     GError             **error);
+GFileInfo          *thunar_io_enumerator_next_file  (ThunarIoEnumerator  *enumerator,
+                                                     GCancellable        *cancellable,
+                                                     GError             **error);
+GList              *thunar_io_enumerator_next_files (ThunarIoEnumerator  *enumerator,
+                                                     guint                n_files,
+                                                     GCancellable        *cancellable,
+                                                     GError             **error);
+void                thunar_io_enumerator_free       (ThunarIoEnumerator  *enumerator);
+
+G_END_DECLS
+
+#endif /* !__THUNAR_IO_ENUMERATOR_H__ */
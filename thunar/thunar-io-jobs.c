@@ -22,9 +22,24 @@
 #include "config.h"
 #endif
 
+#ifdef HAVE_DIRENT_H
+#include <dirent.h>
+#endif
 #ifdef HAVE_ERRNO_H
 #include <errno.h>
 #endif
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
 
 #include <gio/gio.h>
 #include <glib/gstdio.h>
@@ -32,10 +47,15 @@
 #include "thunar/thunar-application.h"
 #include "thunar/thunar-enum-types.h"
 #include "thunar/thunar-file.h"
+#include "thunar/thunar-folder-snapshot.h"
 #include "thunar/thunar-gio-extensions.h"
+#include "thunar/thunar-io-enumerator.h"
 #include "thunar/thunar-io-jobs-util.h"
 #include "thunar/thunar-io-jobs.h"
 #include "thunar/thunar-io-scan-directory.h"
+#include "thunar/thunar-io-trash.h"
+#include "thunar/thunar-recent-index.h"
+#include "thunar/thunar-search-index.h"
 #include "thunar/thunar-job.h"
 #include "thunar/thunar-private.h"
 #include "thunar/thunar-simple-job.h"
@@ -118,6 +138,488 @@ _tij_delete_file (GFile        *file,
 }
 
 
+#if defined (HAVE_DIRENT_H) && defined (HAVE_FCNTL_H) && defined (HAVE_FDOPENDIR) \
+ && defined (HAVE_FSTATAT) && defined (HAVE_OPENAT) && defined (HAVE_UNLINKAT)
+#define THUNAR_UNLINK_NATIVE 1
+
+/* Local trees nested deeper are left to the GIO code path, since every
+ * level of the depth-first walks keeps its folder descriptor open */
+#define THUNAR_NATIVE_MAX_DEPTH 128
+
+
+
+typedef struct
+{
+  ThunarJob            *job;
+  ThunarThumbnailCache *thumbnail_cache;
+  guint                 n_processed;
+}
+ThunarUnlinkContext;
+
+
+
+static DIR *
+_tij_native_opendir (gint         parent_fd,
+                     const gchar *name)
+{
+  DIR *dir;
+  gint fd;
+  gint saved_errno;
+
+  fd = openat (parent_fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (fd < 0)
+    return NULL;
+
+  dir = fdopendir (fd);
+  if (dir == NULL)
+    {
+      saved_errno = errno;
+      close (fd);
+      errno = saved_errno;
+    }
+
+  return dir;
+}
+
+
+
+static gboolean
+_tij_native_is_directory (DIR           *dir,
+                          struct dirent *entry)
+{
+  struct stat statb;
+
+#ifdef _DIRENT_HAVE_D_TYPE
+  if (entry->d_type != DT_UNKNOWN)
+    return entry->d_type == DT_DIR;
+#endif
+
+  return fstatat (dirfd (dir), entry->d_name, &statb, AT_SYMLINK_NOFOLLOW) == 0
+         && S_ISDIR (statb.st_mode);
+}
+
+
+
+/* counts the entries of the tree @name, failing for trees which cannot be
+ * read or are nested too deeply, so that nothing is deleted from them here */
+static gboolean
+_tij_native_count (ThunarJob   *job,
+                   gint         parent_fd,
+                   const gchar *name,
+                   guint        depth,
+                   guint       *n_files)
+{
+  struct dirent *entry;
+  gboolean       succeed = TRUE;
+  DIR           *dir;
+
+  *n_files += 1;
+
+  if (depth > THUNAR_NATIVE_MAX_DEPTH)
+    return FALSE;
+
+  dir = _tij_native_opendir (parent_fd, name);
+  if (dir == NULL)
+    return FALSE;
+
+  while (succeed && !exo_job_is_cancelled (EXO_JOB (job)) && (entry = readdir (dir)) != NULL)
+    {
+      if (strcmp (entry->d_name, ".") == 0 || strcmp (entry->d_name, "..") == 0)
+        continue;
+
+      if (_tij_native_is_directory (dir, entry))
+        succeed = _tij_native_count (job, dirfd (dir), entry->d_name, depth + 1, n_files);
+      else
+        *n_files += 1;
+    }
+
+  closedir (dir);
+
+  return succeed;
+}
+
+
+
+/* removes @name below the folder @parent_fd, which is @parent, and
+ * for folders everything below it first. For errors the user is asked
+ * whether to skip the file, FALSE is only returned when cancelled */
+static gboolean
+_tij_unlink_tree (ThunarUnlinkContext *context,
+                  gint                 parent_fd,
+                  GFile               *parent,
+                  const gchar         *name,
+                  gboolean             is_directory)
+{
+  ThunarJobResponse  response;
+  struct dirent     *entry;
+  GFile             *file;
+  gchar             *display_name;
+  gint64             start_time;
+  DIR               *dir;
+
+  if (is_directory)
+    {
+      file = g_file_get_child (parent, name);
+      start_time = g_get_monotonic_time ();
+      dir = _tij_native_opendir (parent_fd, name);
+      if (dir != NULL)
+        thunar_job_stats_latency (context->job, THUNAR_JOB_IO_OPEN, start_time);
+
+      /* reading a folder which we failed to open is reported by the rmdir below */
+      while (dir != NULL && (entry = readdir (dir)) != NULL)
+        {
+          if (exo_job_is_cancelled (EXO_JOB (context->job)))
+            break;
+
+          if (strcmp (entry->d_name, ".") == 0 || strcmp (entry->d_name, "..") == 0)
+            continue;
+
+          _tij_unlink_tree (context, dirfd (dir), file, entry->d_name,
+                            _tij_native_is_directory (dir, entry));
+        }
+
+      if (dir != NULL)
+        closedir (dir);
+      g_object_unref (file);
+    }
+
+  if (exo_job_is_cancelled (EXO_JOB (context->job)))
+    return FALSE;
+
+  /* update progress information */
+  thunar_job_processing_name (context->job, name, context->n_processed++);
+
+again:
+  start_time = g_get_monotonic_time ();
+  if (unlinkat (parent_fd, name, is_directory ? AT_REMOVEDIR : 0) == 0)
+    {
+      thunar_job_stats_latency (context->job, THUNAR_JOB_IO_DELETE, start_time);
+      thunar_job_stats_files (context->job, 1);
+
+      /* only files can have thumbnails */
+      if (!is_directory)
+        {
+          file = g_file_get_child (parent, name);
+          thunar_thumbnail_cache_delete_file (context->thumbnail_cache, file);
+          g_object_unref (file);
+        }
+
+      return TRUE;
+    }
+
+  /* ask the user whether he wants to skip this file */
+  display_name = g_filename_display_name (name);
+  response = thunar_job_ask_skip (context->job,
+                                  _("Could not delete file \"%s\": %s"),
+                                  display_name, g_strerror (errno));
+  g_free (display_name);
+
+  /* check whether to retry */
+  if (response == THUNAR_JOB_RESPONSE_RETRY)
+    goto again;
+
+  return !exo_job_is_cancelled (EXO_JOB (context->job));
+}
+
+
+
+/* removes the trashed items of the local trash folder @trash_dir together
+ * with their *.trashinfo files, keeping the trash folder layout itself */
+static void
+_tij_unlink_trash_dir (ThunarUnlinkContext *context,
+                       const gchar         *trash_dir)
+{
+  struct dirent *entry;
+  struct stat    statb;
+  GFile         *files;
+  gchar         *path;
+  gchar         *info_name;
+  DIR           *dir;
+  gint           trash_fd;
+  gint           info_fd;
+
+  trash_fd = open (trash_dir, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (trash_fd < 0)
+    return;
+
+  dir = _tij_native_opendir (trash_fd, "files");
+  info_fd = openat (trash_fd, "info", O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+
+  if (dir != NULL)
+    {
+      path = g_build_filename (trash_dir, "files", NULL);
+      files = g_file_new_for_path (path);
+      g_free (path);
+
+      while ((entry = readdir (dir)) != NULL)
+        {
+          if (strcmp (entry->d_name, ".") == 0 || strcmp (entry->d_name, "..") == 0)
+            continue;
+
+          if (!_tij_unlink_tree (context, dirfd (dir), files, entry->d_name,
+                                 _tij_native_is_directory (dir, entry)))
+            break;
+
+          /* drop the info of items which are gone, skipped ones keep it */
+          if (info_fd >= 0 && fstatat (dirfd (dir), entry->d_name, &statb, AT_SYMLINK_NOFOLLOW) != 0 && errno == ENOENT)
+            {
+              info_name = g_strconcat (entry->d_name, ".trashinfo", NULL);
+              unlinkat (info_fd, info_name, 0);
+              g_free (info_name);
+            }
+        }
+
+      g_object_unref (files);
+      closedir (dir);
+    }
+
+  /* the cached folder sizes are stale now */
+  unlinkat (trash_fd, "directorysizes", 0);
+
+  if (info_fd >= 0)
+    close (info_fd);
+  close (trash_fd);
+}
+
+
+
+/* deletes the local trees of @file_list straight from their folder streams,
+ * without collecting them first, and returns the files left to the GIO path.
+ * The trash root is emptied from the local trash folders */
+static GList *
+_tij_unlink_native (ThunarJob            *job,
+                    GList                *file_list,
+                    ThunarThumbnailCache *thumbnail_cache)
+{
+  ThunarUnlinkContext context = { job, thumbnail_cache, 0 };
+  GList              *native_list = NULL;
+  GList              *remaining_list = NULL;
+  GList              *trash_dirs = NULL;
+  GList              *lp;
+  GFile              *parent;
+  gchar              *base_name;
+  gboolean            empty_trash = FALSE;
+  GFileType           file_type;
+  guint               n_files = 0;
+  guint               n_counted;
+  gint64              start_time;
+  gint                parent_fd;
+
+  /* count the files of the trees we can delete */
+  for (lp = file_list; lp != NULL && !exo_job_is_cancelled (EXO_JOB (job)); lp = lp->next)
+    {
+      if (thunar_g_file_is_trash (lp->data) && thunar_g_file_is_root (lp->data))
+        {
+          /* the trash root itself is never removed, only its items */
+          empty_trash = TRUE;
+          continue;
+        }
+
+      parent = g_file_get_parent (lp->data);
+      parent_fd = -1;
+      n_counted = 0;
+
+      if (g_file_is_native (lp->data) && parent != NULL && !thunar_g_file_is_root (lp->data))
+        {
+          start_time = g_get_monotonic_time ();
+          file_type = g_file_query_file_type (lp->data, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, NULL);
+          thunar_job_stats_latency (job, THUNAR_JOB_IO_STAT, start_time);
+
+          if (file_type == G_FILE_TYPE_DIRECTORY)
+            parent_fd = open (g_file_peek_path (parent), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        }
+
+      base_name = g_file_get_basename (lp->data);
+      if (parent_fd >= 0 && _tij_native_count (job, parent_fd, base_name, 0, &n_counted))
+        {
+          native_list = g_list_prepend (native_list, lp->data);
+          n_files += n_counted;
+        }
+      else
+        {
+          remaining_list = thunar_g_list_prepend_deep (remaining_list, lp->data);
+        }
+      g_free (base_name);
+
+      if (parent_fd >= 0)
+        close (parent_fd);
+      if (parent != NULL)
+        g_object_unref (parent);
+    }
+
+  if (native_list != NULL)
+    thunar_job_set_n_total_files (job, n_files);
+
+  /* remove them */
+  native_list = g_list_reverse (native_list);
+  for (lp = native_list; lp != NULL && !exo_job_is_cancelled (EXO_JOB (job)); lp = lp->next)
+    {
+      parent = g_file_get_parent (lp->data);
+      parent_fd = open (g_file_peek_path (parent), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+      if (parent_fd >= 0)
+        {
+          base_name = g_file_get_basename (lp->data);
+          _tij_unlink_tree (&context, parent_fd, parent, base_name, TRUE);
+          g_free (base_name);
+          close (parent_fd);
+        }
+      g_object_unref (parent);
+    }
+
+  g_list_free (native_list);
+
+  /* empty the trash folders, without asking GVfs about every item in them */
+  if (empty_trash)
+    trash_dirs = thunar_io_trash_get_dirs ();
+  for (lp = trash_dirs; lp != NULL && !exo_job_is_cancelled (EXO_JOB (job)); lp = lp->next)
+    _tij_unlink_trash_dir (&context, lp->data);
+  g_list_free_full (trash_dirs, g_free);
+
+  return g_list_reverse (remaining_list);
+}
+#endif
+
+
+
+#if defined (HAVE_FCNTL_H) && defined (HAVE_OPENAT) && defined (HAVE_MKDIRAT) && defined (HAVE_SYMLINKAT)
+#define THUNAR_CREATE_NATIVE 1
+
+/* Scripts creating folder skeletons or many links send their targets
+ * in batches, mostly into the same few folders. The native path keeps
+ * the descriptor of the last parent folder open and creates the files
+ * relative to it, any failure is left to the GIO code path, which then
+ * reports the error or asks about the collision */
+typedef struct
+{
+  GFile *parent;
+  gint   parent_fd;
+}
+ThunarCreateContext;
+
+
+
+static void
+_tij_create_context_clear (ThunarCreateContext *context)
+{
+  if (context->parent_fd >= 0)
+    close (context->parent_fd);
+  context->parent_fd = -1;
+
+  if (context->parent != NULL)
+    g_object_unref (context->parent);
+  context->parent = NULL;
+}
+
+
+
+static gint
+_tij_create_context_get_parent_fd (ThunarCreateContext *context,
+                                   GFile               *file)
+{
+  GFile *parent;
+  gchar *name;
+  gint   parent_fd = -1;
+
+  parent = g_file_get_parent (file);
+  if (G_UNLIKELY (parent == NULL))
+    return -1;
+
+  if (context->parent != NULL && g_file_equal (context->parent, parent))
+    {
+      g_object_unref (parent);
+      return context->parent_fd;
+    }
+
+  /* a skeleton usually continues in the folder that was just created */
+  if (context->parent_fd >= 0 && g_file_has_parent (parent, context->parent))
+    {
+      name = g_file_get_basename (parent);
+      parent_fd = openat (context->parent_fd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+      g_free (name);
+    }
+  else if (g_file_is_native (parent))
+    {
+      parent_fd = open (g_file_peek_path (parent), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    }
+
+  /* failures are remembered too, the GIO path handles those files */
+  _tij_create_context_clear (context);
+  context->parent = parent;
+  context->parent_fd = parent_fd;
+
+  return parent_fd;
+}
+
+
+
+static gboolean
+_tij_native_mkdir (ThunarCreateContext *context,
+                   GFile               *file)
+{
+  gboolean result;
+  gchar   *name;
+  gint     parent_fd;
+
+  parent_fd = _tij_create_context_get_parent_fd (context, file);
+  if (parent_fd < 0)
+    return FALSE;
+
+  name = g_file_get_basename (file);
+  result = (mkdirat (parent_fd, name, 0777) == 0);
+  g_free (name);
+
+  return result;
+}
+
+
+
+static gboolean
+_tij_native_create (ThunarCreateContext *context,
+                    GFile               *file)
+{
+  gchar *name;
+  gint   parent_fd;
+  gint   fd;
+
+  parent_fd = _tij_create_context_get_parent_fd (context, file);
+  if (parent_fd < 0)
+    return FALSE;
+
+  name = g_file_get_basename (file);
+  fd = openat (parent_fd, name, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0666);
+  g_free (name);
+
+  if (fd < 0)
+    return FALSE;
+
+  close (fd);
+  return TRUE;
+}
+
+
+
+static gboolean
+_tij_native_symlink (ThunarCreateContext *context,
+                     GFile               *file,
+                     const gchar         *symlink_target)
+{
+  gboolean result;
+  gchar   *name;
+  gint     parent_fd;
+
+  parent_fd = _tij_create_context_get_parent_fd (context, file);
+  if (parent_fd < 0)
+    return FALSE;
+
+  name = g_file_get_basename (file);
+  result = (symlinkat (symlink_target, parent_fd, name) == 0);
+  g_free (name);
+
+  return result;
+}
+#endif
+
+
 
 static gboolean
 _thunar_io_jobs_create (ThunarJob  *job,
@@ -137,6 +639,9 @@ _thunar_io_jobs_create (ThunarJob  *job,
   GFileInputStream       *template_stream = NULL;
   ThunarJobOperation     *operation = NULL;
   ThunarOperationLogMode  log_mode;
+#ifdef THUNAR_CREATE_NATIVE
+  ThunarCreateContext     context = { NULL, -1 };
+#endif
 
   _thunar_return_val_if_fail (THUNAR_IS_JOB (job), FALSE);
   _thunar_return_val_if_fail (param_values != NULL, FALSE);
@@ -177,6 +682,16 @@ _thunar_io_jobs_create (ThunarJob  *job,
       /* update progress information */
       thunar_job_processing_file (THUNAR_JOB (job), lp, n_processed);
 
+#ifdef THUNAR_CREATE_NATIVE
+      /* empty files need no stream */
+      if (template_stream == NULL && _tij_native_create (&context, lp->data))
+        {
+          if (log_mode == THUNAR_OPERATION_LOG_OPERATIONS)
+            thunar_job_operation_add (operation, template_file, lp->data);
+          continue;
+        }
+#endif
+
     again:
       /* try to create the file */
       stream = g_file_create (lp->data,
@@ -279,6 +794,10 @@ _thunar_io_jobs_create (ThunarJob  *job,
   if (template_stream != NULL)
     g_object_unref (template_stream);
 
+#ifdef THUNAR_CREATE_NATIVE
+  _tij_create_context_clear (&context);
+#endif
+
   /* check if we have failed */
   if (err != NULL)
     {
@@ -336,6 +855,9 @@ _thunar_io_jobs_mkdir (ThunarJob  *job,
   guint                  n_processed = 0;
   ThunarJobOperation     *operation = NULL;
   ThunarOperationLogMode  log_mode;
+#ifdef THUNAR_CREATE_NATIVE
+  ThunarCreateContext     context = { NULL, -1 };
+#endif
 
   _thunar_return_val_if_fail (THUNAR_IS_JOB (job), FALSE);
   _thunar_return_val_if_fail (param_values != NULL, FALSE);
@@ -361,6 +883,15 @@ _thunar_io_jobs_mkdir (ThunarJob  *job,
       /* update progress information */
       thunar_job_processing_file (THUNAR_JOB (job), lp, n_processed);
 
+#ifdef THUNAR_CREATE_NATIVE
+      if (_tij_native_mkdir (&context, lp->data))
+        {
+          if (log_mode == THUNAR_OPERATION_LOG_OPERATIONS)
+            thunar_job_operation_add (operation, NULL, lp->data);
+          continue;
+        }
+#endif
+
     again:
       /* try to create the directory */
       if (!g_file_make_directory (lp->data, exo_job_get_cancellable (EXO_JOB (job)), &err))
@@ -442,6 +973,10 @@ _thunar_io_jobs_mkdir (ThunarJob  *job,
 
     } /* end for all files */
 
+#ifdef THUNAR_CREATE_NATIVE
+  _tij_create_context_clear (&context);
+#endif
+
   /* check if we have failed */
   if (err != NULL)
     {
@@ -493,9 +1028,11 @@ _thunar_io_jobs_unlink (ThunarJob  *job,
   GFileInfo            *info;
   GError               *err = NULL;
   GList                *file_list;
+  GList                *remaining_list;
   GList                *lp;
   gchar                *base_name;
   gchar                *display_name;
+  gint64                start_time;
   guint                 n_processed = 0;
 
   _thunar_return_val_if_fail (THUNAR_IS_JOB (job), FALSE);
@@ -507,10 +1044,23 @@ _thunar_io_jobs_unlink (ThunarJob  *job,
   file_list = g_value_get_boxed (&g_array_index (param_values, GValue, 0));
 
   /* tell the user that we're preparing to unlink the files */
-  exo_job_info_message (EXO_JOB (job), _("Preparing..."));
+  thunar_job_info_message (THUNAR_JOB (job), _("Preparing..."));
+
+  /* take a reference on the thumbnail cache */
+  application = thunar_application_get ();
+  thumbnail_cache = thunar_application_get_thumbnail_cache (application);
+  g_object_unref (application);
+
+#ifdef THUNAR_UNLINK_NATIVE
+  /* local folders are removed without a list of everything below them */
+  remaining_list = _tij_unlink_native (job, file_list, thumbnail_cache);
+#else
+  remaining_list = thunar_g_list_copy_deep (file_list);
+#endif
 
   /* recursively collect files for removal, not following any symlinks */
-  file_list = _tij_collect_nofollow (job, file_list, TRUE, &err);
+  file_list = _tij_collect_nofollow (job, remaining_list, TRUE, &err);
+  thunar_g_list_free_full (remaining_list);
 
   /* free the file list and fail if there was an error or the job was cancelled */
   if (err != NULL || exo_job_is_cancelled (EXO_JOB (job)))
@@ -520,17 +1070,14 @@ _thunar_io_jobs_unlink (ThunarJob  *job,
       else
         g_propagate_error (error, err);
 
+      g_object_unref (thumbnail_cache);
       thunar_g_list_free_full (file_list);
       return FALSE;
     }
 
   /* we know the total list of files to process */
-  thunar_job_set_total_files (THUNAR_JOB (job), file_list);
-
-  /* take a reference on the thumbnail cache */
-  application = thunar_application_get ();
-  thumbnail_cache = thunar_application_get_thumbnail_cache (application);
-  g_object_unref (application);
+  if (file_list != NULL)
+    thunar_job_set_total_files (THUNAR_JOB (job), file_list);
 
   /* remove all the files */
   for (lp = file_list;
@@ -548,8 +1095,12 @@ _thunar_io_jobs_unlink (ThunarJob  *job,
 
     again:
       /* try to delete the file */
+      start_time = g_get_monotonic_time ();
       if (_tij_delete_file (lp->data, exo_job_get_cancellable (EXO_JOB (job)), &err))
         {
+          thunar_job_stats_latency (job, THUNAR_JOB_IO_DELETE, start_time);
+          thunar_job_stats_files (job, 1);
+
           /* notify the thumbnail cache that the corresponding thumbnail can also
            * be deleted now */
           thunar_thumbnail_cache_delete_file (thumbnail_cache, lp->data);
@@ -621,6 +1172,26 @@ thunar_io_jobs_unlink_files (GList *file_list)
 
 
 
+static ThunarJob *
+thunar_io_jobs_transfer_files (GList                *source_file_list,
+                               GList                *target_file_list,
+                               ThunarTransferJobType type)
+{
+  ThunarPreferences *preferences;
+  ThunarJob         *job;
+
+  job = thunar_transfer_job_new (source_file_list, target_file_list, type);
+
+  /* the transfer job itself knows nothing about the preferences */
+  preferences = thunar_preferences_get ();
+  thunar_transfer_job_bind_preferences (THUNAR_TRANSFER_JOB (job), G_OBJECT (preferences));
+  g_object_unref (preferences);
+
+  return job;
+}
+
+
+
 ThunarJob *
 thunar_io_jobs_move_files (GList *source_file_list,
                            GList *target_file_list)
@@ -631,8 +1202,8 @@ thunar_io_jobs_move_files (GList *source_file_list,
   _thunar_return_val_if_fail (target_file_list != NULL, NULL);
   _thunar_return_val_if_fail (g_list_length (source_file_list) == g_list_length (target_file_list), NULL);
 
-  job = thunar_transfer_job_new (source_file_list, target_file_list,
-                                 THUNAR_TRANSFER_JOB_MOVE);
+  job = thunar_io_jobs_transfer_files (source_file_list, target_file_list,
+                                       THUNAR_TRANSFER_JOB_MOVE);
   thunar_job_set_pausable (job, TRUE);
 
   return job;
@@ -650,8 +1221,8 @@ thunar_io_jobs_copy_files (GList *source_file_list,
   _thunar_return_val_if_fail (target_file_list != NULL, NULL);
   _thunar_return_val_if_fail (g_list_length (source_file_list) == g_list_length (target_file_list), NULL);
 
-  job = thunar_transfer_job_new (source_file_list, target_file_list,
-                                 THUNAR_TRANSFER_JOB_COPY);
+  job = thunar_io_jobs_transfer_files (source_file_list, target_file_list,
+                                       THUNAR_TRANSFER_JOB_COPY);
   thunar_job_set_pausable (job, TRUE);
 
   return job;
@@ -759,6 +1330,10 @@ _thunar_io_jobs_link (ThunarJob  *job,
   guint                   n_processed = 0;
   ThunarJobOperation     *operation = NULL;
   ThunarOperationLogMode  log_mode;
+#ifdef THUNAR_CREATE_NATIVE
+  ThunarCreateContext     context = { NULL, -1 };
+  gchar                  *symlink_target;
+#endif
 
   _thunar_return_val_if_fail (THUNAR_IS_JOB (job), FALSE);
   _thunar_return_val_if_fail (param_values != NULL, FALSE);
@@ -792,8 +1367,22 @@ _thunar_io_jobs_link (ThunarJob  *job,
       /* update progress information */
       thunar_job_processing_file (THUNAR_JOB (job), sp, n_processed);
 
+      real_target_file = NULL;
+
+#ifdef THUNAR_CREATE_NATIVE
+      /* links onto themselves need a duplicate name, left to the GIO path */
+      if (!g_file_equal (sp->data, tp->data) && !exo_job_is_cancelled (EXO_JOB (job)))
+        {
+          symlink_target = thunar_g_file_get_link_path_for_symlink (sp->data, tp->data);
+          if (symlink_target != NULL && _tij_native_symlink (&context, tp->data, symlink_target))
+            real_target_file = g_object_ref (tp->data);
+          g_free (symlink_target);
+        }
+#endif
+
       /* try to create the symbolic link */
-      real_target_file = _thunar_io_jobs_link_file (job, sp->data, tp->data, &err);
+      if (real_target_file == NULL)
+        real_target_file = _thunar_io_jobs_link_file (job, sp->data, tp->data, &err);
       if (real_target_file != NULL)
         {
           /* queue the file for the folder update unless it was skipped */
@@ -817,6 +1406,10 @@ _thunar_io_jobs_link (ThunarJob  *job,
         }
     }
 
+#ifdef THUNAR_CREATE_NATIVE
+  _tij_create_context_clear (&context);
+#endif
+
   /* release the thumbnail cache */
   g_object_unref (thumbnail_cache);
 
@@ -857,10 +1450,207 @@ thunar_io_jobs_link_files (GList *source_file_list,
 
 
 
-static gboolean
-_thunar_io_jobs_trash (ThunarJob  *job,
-                       GArray     *param_values,
-                       GError    **error)
+#if defined (THUNAR_UNLINK_NATIVE) && defined (HAVE_RENAMEAT)
+#define THUNAR_TRASH_NATIVE 1
+
+
+
+/* the home trash folders, kept open for all files of a trash job, and
+ * the folder of the last trashed file, since most share their folder */
+typedef struct
+{
+  GFile *trash;
+  dev_t  device;
+  gint   files_fd;
+  gint   info_fd;
+  GFile *parent;
+  gint   parent_fd;
+}
+ThunarTrashContext;
+
+
+
+static void
+_tij_trash_context_open (ThunarTrashContext *context)
+{
+  struct stat statb;
+  gchar      *trash_dir;
+  gchar      *path;
+
+  context->trash = NULL;
+  context->files_fd = -1;
+  context->info_fd = -1;
+  context->parent = NULL;
+  context->parent_fd = -1;
+
+  /* create the home trash layout if needed, like g_file_trash() does */
+  trash_dir = thunar_io_trash_get_home_dir ();
+  path = g_build_filename (trash_dir, "files", NULL);
+  if (g_mkdir_with_parents (path, 0700) == 0)
+    context->files_fd = open (path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  g_free (path);
+
+  path = g_build_filename (trash_dir, "info", NULL);
+  if (context->files_fd >= 0 && g_mkdir_with_parents (path, 0700) == 0)
+    context->info_fd = open (path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  g_free (path);
+
+  if (context->info_fd >= 0 && fstat (context->files_fd, &statb) == 0)
+    {
+      context->trash = g_file_new_for_path (trash_dir);
+      context->device = statb.st_dev;
+    }
+  g_free (trash_dir);
+}
+
+
+
+static void
+_tij_trash_context_close (ThunarTrashContext *context)
+{
+  if (context->files_fd >= 0)
+    close (context->files_fd);
+  if (context->info_fd >= 0)
+    close (context->info_fd);
+  if (context->parent_fd >= 0)
+    close (context->parent_fd);
+  if (context->parent != NULL)
+    g_object_unref (context->parent);
+  if (context->trash != NULL)
+    g_object_unref (context->trash);
+}
+
+
+
+static gboolean
+_tij_native_write_all (gint         fd,
+                       const gchar *contents,
+                       gsize        length)
+{
+  gssize n;
+
+  while (length > 0)
+    {
+      n = write (fd, contents, length);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        return FALSE;
+
+      contents += n;
+      length -= n;
+    }
+
+  return TRUE;
+}
+
+
+
+/* moves @file into the home trash, writing its *.trashinfo through the open
+ * info folder. Returns FALSE, without a trace in the trash, for files on
+ * other volumes or for any failure, which are then left to g_file_trash() */
+static gboolean
+_tij_trash_file_native (ThunarTrashContext *context,
+                        GFile              *file)
+{
+  struct stat  statb;
+  GDateTime   *date;
+  gboolean     succeed = FALSE;
+  GFile       *parent;
+  gchar       *base_name;
+  gchar       *trash_name = NULL;
+  gchar       *info_name = NULL;
+  gchar       *escaped;
+  gchar       *date_string;
+  gchar       *contents;
+  guint        n;
+  gint         fd = -1;
+
+  if (context->trash == NULL || !g_file_is_native (file))
+    return FALSE;
+
+  /* the trash cannot be trashed into itself */
+  if (g_file_equal (file, context->trash) || g_file_has_prefix (file, context->trash))
+    return FALSE;
+
+  parent = g_file_get_parent (file);
+  if (parent == NULL)
+    return FALSE;
+
+  /* reuse the folder of the previous file */
+  if (context->parent == NULL || !g_file_equal (parent, context->parent))
+    {
+      if (context->parent_fd >= 0)
+        close (context->parent_fd);
+      if (context->parent != NULL)
+        g_object_unref (context->parent);
+
+      context->parent = g_object_ref (parent);
+      context->parent_fd = open (g_file_peek_path (parent), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    }
+  g_object_unref (parent);
+
+  if (context->parent_fd < 0)
+    return FALSE;
+
+  /* renaming only works on the volume of the home trash */
+  base_name = g_file_get_basename (file);
+  if (fstatat (context->parent_fd, base_name, &statb, AT_SYMLINK_NOFOLLOW) != 0
+      || statb.st_dev != context->device)
+    {
+      g_free (base_name);
+      return FALSE;
+    }
+
+  /* claim a free name in the trash by creating its info file */
+  for (n = 1; fd < 0; ++n)
+    {
+      g_free (trash_name);
+      g_free (info_name);
+
+      trash_name = (n == 1) ? g_strdup (base_name) : g_strdup_printf ("%s.%u", base_name, n);
+      info_name = g_strconcat (trash_name, ".trashinfo", NULL);
+
+      fd = openat (context->info_fd, info_name, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, 0600);
+      if (fd < 0 && errno != EEXIST)
+        break;
+    }
+
+  if (fd >= 0)
+    {
+      escaped = g_uri_escape_string (g_file_peek_path (file), "/", FALSE);
+      date = g_date_time_new_now_local ();
+      date_string = g_date_time_format (date, "%Y-%m-%dT%H:%M:%S");
+      contents = g_strdup_printf ("[Trash Info]\nPath=%s\nDeletionDate=%s\n", escaped, date_string);
+
+      succeed = _tij_native_write_all (fd, contents, strlen (contents));
+      succeed = (close (fd) == 0) && succeed;
+      succeed = succeed && renameat (context->parent_fd, base_name, context->files_fd, trash_name) == 0;
+
+      /* don't leave an info file without its item */
+      if (!succeed)
+        unlinkat (context->info_fd, info_name, 0);
+
+      g_free (contents);
+      g_free (date_string);
+      g_date_time_unref (date);
+      g_free (escaped);
+    }
+
+  g_free (info_name);
+  g_free (trash_name);
+  g_free (base_name);
+
+  return succeed;
+}
+#endif
+
+
+
+static gboolean
+_thunar_io_jobs_trash (ThunarJob  *job,
+                       GArray     *param_values,
+                       GError    **error)
 {
   ThunarThumbnailCache   *thumbnail_cache;
   ThunarApplication      *application;
@@ -870,6 +1660,9 @@ _thunar_io_jobs_trash (ThunarJob  *job,
   GError                 *err = NULL;
   GList                  *file_list;
   GList                  *lp;
+#ifdef THUNAR_TRASH_NATIVE
+  ThunarTrashContext      context;
+#endif
 
   _thunar_return_val_if_fail (THUNAR_IS_JOB (job), FALSE);
   _thunar_return_val_if_fail (param_values != NULL, FALSE);
@@ -881,6 +1674,11 @@ _thunar_io_jobs_trash (ThunarJob  *job,
   if (exo_job_set_error_if_cancelled (EXO_JOB (job), error))
     return FALSE;
 
+#ifdef THUNAR_TRASH_NATIVE
+  /* open the home trash once for all files */
+  _tij_trash_context_open (&context);
+#endif
+
   /* take a reference on the thumbnail cache */
   application = thunar_application_get ();
   thumbnail_cache = thunar_application_get_thumbnail_cache (application);
@@ -896,7 +1694,10 @@ _thunar_io_jobs_trash (ThunarJob  *job,
       _thunar_assert (G_IS_FILE (lp->data));
 
       /* trash the file or folder */
-      g_file_trash (lp->data, exo_job_get_cancellable (EXO_JOB (job)), &err);
+#ifdef THUNAR_TRASH_NATIVE
+      if (!_tij_trash_file_native (&context, lp->data))
+#endif
+        g_file_trash (lp->data, exo_job_get_cancellable (EXO_JOB (job)), &err);
 
       if (err != NULL)
         {
@@ -918,6 +1719,10 @@ _thunar_io_jobs_trash (ThunarJob  *job,
       thunar_thumbnail_cache_cleanup_file (thumbnail_cache, lp->data);
     }
 
+#ifdef THUNAR_TRASH_NATIVE
+  _tij_trash_context_close (&context);
+#endif
+
   /* release the thumbnail cache */
   g_object_unref (thumbnail_cache);
 
@@ -967,29 +1772,447 @@ thunar_io_jobs_restore_files (GList *source_file_list,
   _thunar_return_val_if_fail (target_file_list != NULL, NULL);
   _thunar_return_val_if_fail (g_list_length (source_file_list) == g_list_length (target_file_list), NULL);
 
-  job = thunar_transfer_job_new (source_file_list, target_file_list,
-                                 THUNAR_TRANSFER_JOB_MOVE);
+  job = thunar_io_jobs_transfer_files (source_file_list, target_file_list,
+                                       THUNAR_TRANSFER_JOB_MOVE);
 
   return job;
 }
 
 
 
+/* returns the consistent mode for a folder of @mode, in which the owner may read
+ * and enter the folder, and everybody else who may read it may enter it */
+static inline ThunarFileMode
+_tij_fixed_folder_mode (guint32 mode)
+{
+  mode = (mode & 07777) | THUNAR_FILE_MODE_USR_READ | THUNAR_FILE_MODE_USR_EXEC;
+  mode = ((mode & THUNAR_FILE_MODE_GRP_READ) != 0) ? (mode | THUNAR_FILE_MODE_GRP_EXEC) : (mode & ~THUNAR_FILE_MODE_GRP_EXEC);
+  mode = ((mode & THUNAR_FILE_MODE_OTH_READ) != 0) ? (mode | THUNAR_FILE_MODE_OTH_EXEC) : (mode & ~THUNAR_FILE_MODE_OTH_EXEC);
+  return mode;
+}
+
+
+
+#if defined (THUNAR_UNLINK_NATIVE) && defined (HAVE_FCHMODAT) && defined (HAVE_FCHOWNAT)
+#define THUNAR_ATTRIB_NATIVE 1
+
+
+
+/* number of threads changing the folders of the local trees */
+#define THUNAR_ATTRIB_NATIVE_THREADS (4)
+
+/* the progress of the local trees is reported this often, in microseconds */
+#define THUNAR_ATTRIB_NATIVE_UPDATE_INTERVAL (250 * 1000)
+
+
+
+typedef struct _ThunarAttribFolder ThunarAttribFolder;
+
+typedef struct
+{
+  ThunarJob      *job;
+  guint           n_processed;  /* atomic */
+
+  /* change the mode if TRUE, otherwise the owner */
+  gboolean        change_mode;
+  ThunarFileMode  dir_mask;
+  ThunarFileMode  dir_mode;
+  ThunarFileMode  file_mask;
+  ThunarFileMode  file_mode;
+
+  /* TRUE to let the execute bits of folders follow their read bits, see thunar_io_jobs_fix_folder_permissions() */
+  gboolean        fix_folders;
+
+  /* for the owner, -1 to leave unchanged */
+  gint            uid;
+  gint            gid;
+
+  /* the folders are walked by a pool of threads */
+  GThreadPool    *pool;
+  GMutex          mutex;
+  GCond           cond;
+  guint           n_pending;
+  gchar          *current_path;
+
+  /* the user is asked about one failure at a time */
+  GMutex          ask_mutex;
+}
+ThunarAttribContext;
+
+struct _ThunarAttribFolder
+{
+  ThunarAttribFolder *parent;
+  gchar              *path;
+  struct stat         statb;
+  gboolean            change_last;  /* the folder is changed after its contents */
+  gint                n_pending;    /* the listing and the subfolders not done yet, atomic */
+};
+
+
+
+/* changes the mode or owner of @name below the folder @parent_fd, unless it
+ * already has them. FALSE is only returned when the job was cancelled */
+static gboolean
+_tij_attrib_change (ThunarAttribContext *context,
+                    gint                 parent_fd,
+                    const gchar         *name,
+                    const struct stat   *statb)
+{
+  ThunarJobResponse  response;
+  ThunarFileMode     mask;
+  ThunarFileMode     mode;
+  ThunarFileMode     new_mode;
+  const gchar       *message;
+  gchar             *display_name;
+  gint               result;
+
+again:
+  if (context->change_mode)
+    {
+      /* symlinks have no permissions of their own */
+      if (S_ISLNK (statb->st_mode))
+        return TRUE;
+
+      if (context->fix_folders)
+        {
+          /* the files are fine whatever their mode */
+          if (!S_ISDIR (statb->st_mode))
+            return TRUE;
+          new_mode = _tij_fixed_folder_mode (statb->st_mode);
+        }
+      else
+        {
+          if (S_ISDIR (statb->st_mode))
+            {
+              mask = context->dir_mask;
+              mode = context->dir_mode;
+            }
+          else
+            {
+              mask = context->file_mask;
+              mode = context->file_mode;
+            }
+          new_mode = ((statb->st_mode & ~mask) | mode) & 07777;
+        }
+
+      /* no syscall for the entries which are right already */
+      if (new_mode == (statb->st_mode & 07777))
+        return TRUE;
+
+      result = fchmodat (parent_fd, name, new_mode, 0);
+      message = _("Failed to change the permissions of \"%s\": %s");
+    }
+  else
+    {
+      if ((context->uid < 0 || statb->st_uid == (uid_t) context->uid)
+          && (context->gid < 0 || statb->st_gid == (gid_t) context->gid))
+        return TRUE;
+
+      result = fchownat (parent_fd, name, (uid_t) context->uid, (gid_t) context->gid, AT_SYMLINK_NOFOLLOW);
+      message = G_LIKELY (context->uid >= 0) ? _("Failed to change the owner of \"%s\": %s")
+        : _("Failed to change the group of \"%s\": %s");
+    }
+
+  if (result == 0)
+    return TRUE;
+
+  /* ask the user whether to skip/retry this file, the other threads wait meanwhile */
+  display_name = g_filename_display_name (name);
+  g_mutex_lock (&context->ask_mutex);
+  response = thunar_job_ask_skip (context->job, message, display_name, g_strerror (errno));
+  g_mutex_unlock (&context->ask_mutex);
+  g_free (display_name);
+
+  /* check whether to retry */
+  if (response == THUNAR_JOB_RESPONSE_RETRY)
+    goto again;
+
+  return !exo_job_is_cancelled (EXO_JOB (context->job));
+}
+
+
+
+static void
+_tij_attrib_push (ThunarAttribContext *context,
+                  ThunarAttribFolder  *parent,
+                  gchar               *path,
+                  const struct stat   *statb)
+{
+  ThunarAttribFolder *folder;
+
+  /* folders are changed after their contents, so taking away our own access
+   * does not stop the walk, unless we need the new mode to enter them */
+  folder = g_slice_new (ThunarAttribFolder);
+  folder->parent = parent;
+  folder->path = path;
+  folder->statb = *statb;
+  folder->change_last = (statb->st_mode & (S_IRUSR | S_IXUSR)) == (S_IRUSR | S_IXUSR);
+  folder->n_pending = 1;
+
+  if (!folder->change_last)
+    _tij_attrib_change (context, AT_FDCWD, path, statb);
+
+  if (parent != NULL)
+    g_atomic_int_inc (&parent->n_pending);
+
+  g_mutex_lock (&context->mutex);
+  context->n_pending++;
+  g_thread_pool_push (context->pool, folder, NULL);
+  g_mutex_unlock (&context->mutex);
+}
+
+
+
+/* called once the listing or a subfolder of @folder is done */
+static void
+_tij_attrib_folder_done (ThunarAttribContext *context,
+                         ThunarAttribFolder  *folder)
+{
+  ThunarAttribFolder *parent;
+
+  while (folder != NULL && g_atomic_int_dec_and_test (&folder->n_pending))
+    {
+      if (folder->change_last && !exo_job_is_cancelled (EXO_JOB (context->job)))
+        _tij_attrib_change (context, AT_FDCWD, folder->path, &folder->statb);
+
+      parent = folder->parent;
+      g_free (folder->path);
+      g_slice_free (ThunarAttribFolder, folder);
+      folder = parent;
+    }
+}
+
+
+
+static void
+_tij_attrib_worker (gpointer data,
+                    gpointer user_data)
+{
+  ThunarAttribContext *context = user_data;
+  ThunarAttribFolder  *folder = data;
+  struct dirent       *entry;
+  struct stat          statb;
+  DIR                 *dir = NULL;
+
+  if (!exo_job_is_cancelled (EXO_JOB (context->job)))
+    {
+      g_mutex_lock (&context->mutex);
+      g_free (context->current_path);
+      context->current_path = g_strdup (folder->path);
+      g_mutex_unlock (&context->mutex);
+
+      dir = _tij_native_opendir (AT_FDCWD, folder->path);
+    }
+
+  while (dir != NULL && !exo_job_is_cancelled (EXO_JOB (context->job)) && (entry = readdir (dir)) != NULL)
+    {
+      if (strcmp (entry->d_name, ".") == 0 || strcmp (entry->d_name, "..") == 0)
+        continue;
+
+      g_atomic_int_inc (&context->n_processed);
+
+      /* the file vanished since it was counted */
+      if (fstatat (dirfd (dir), entry->d_name, &statb, AT_SYMLINK_NOFOLLOW) != 0)
+        continue;
+
+      /* the subfolders go to the pool, so the subtrees are walked in parallel */
+      if (S_ISDIR (statb.st_mode))
+        _tij_attrib_push (context, folder, g_build_filename (folder->path, entry->d_name, NULL), &statb);
+      else
+        _tij_attrib_change (context, dirfd (dir), entry->d_name, &statb);
+    }
+
+  if (dir != NULL)
+    closedir (dir);
+
+  _tij_attrib_folder_done (context, folder);
+
+  g_mutex_lock (&context->mutex);
+  if (--context->n_pending == 0)
+    g_cond_signal (&context->cond);
+  g_mutex_unlock (&context->mutex);
+}
+
+
+
+/* reports the folder being changed, and the time left by the rate so far */
+static void
+_tij_attrib_progress (ThunarAttribContext *context,
+                      guint                n_total,
+                      gint64               start_time,
+                      gchar               *path)
+{
+  GString *message;
+  gchar   *display_name;
+  gdouble  rate;
+  gulong   remaining_time = 0;
+  guint    n_processed;
+  gint64   elapsed;
+
+  n_processed = MIN ((guint) g_atomic_int_get (&context->n_processed), n_total);
+
+  elapsed = g_get_monotonic_time () - start_time;
+  if (n_processed > 0 && elapsed > 0)
+    {
+      rate = n_processed / (elapsed / (gdouble) G_USEC_PER_SEC);
+      remaining_time = (gulong) ((n_total - n_processed) / rate);
+    }
+
+  display_name = g_filename_display_basename (path);
+  message = g_string_new (display_name);
+  g_free (display_name);
+
+  if (remaining_time > 0)
+    {
+      /* insert long dash */
+      g_string_append (message, " \xE2\x80\x94 ");
+
+      if (remaining_time > 60 * 60)
+        {
+          remaining_time = (gulong) (remaining_time / (60 * 60));
+          g_string_append_printf (message, ngettext ("%lu hour remaining", "%lu hours remaining", remaining_time), remaining_time);
+        }
+      else if (remaining_time > 60)
+        {
+          remaining_time = (gulong) (remaining_time / 60);
+          g_string_append_printf (message, ngettext ("%lu minute remaining", "%lu minutes remaining", remaining_time), remaining_time);
+        }
+      else
+        {
+          g_string_append_printf (message, ngettext ("%lu second remaining", "%lu seconds remaining", remaining_time), remaining_time);
+        }
+    }
+
+  thunar_job_info_message (THUNAR_JOB (context->job), "%s", message->str);
+  thunar_job_percent (THUNAR_JOB (context->job), (n_processed * 100.0) / MAX (n_total, 1));
+
+  g_string_free (message, TRUE);
+}
+
+
+
+/* changes the local trees of @file_list straight from their folder streams,
+ * without collecting them first, and returns the files left to the GIO path */
+static GList *
+_tij_attrib_native (ThunarAttribContext *context,
+                    GList               *file_list)
+{
+  struct stat statb;
+  GList      *native_list = NULL;
+  GList      *remaining_list = NULL;
+  GList      *lp;
+  GFile      *parent;
+  gchar      *base_name;
+  gchar      *path;
+  guint       n_files = 0;
+  guint       n_counted;
+  gint64      start_time;
+  gint64      end_time;
+  gint        parent_fd;
+
+  /* count the files of the trees we can walk, which is fast since nothing but the
+   * folders is read, and tells how far the change got */
+  for (lp = file_list; lp != NULL && !exo_job_is_cancelled (EXO_JOB (context->job)); lp = lp->next)
+    {
+      parent = g_file_get_parent (lp->data);
+      parent_fd = -1;
+      n_counted = 0;
+
+      if (g_file_is_native (lp->data) && parent != NULL
+          && g_file_query_file_type (lp->data, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, NULL) == G_FILE_TYPE_DIRECTORY)
+        parent_fd = open (g_file_peek_path (parent), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+      base_name = g_file_get_basename (lp->data);
+      if (parent_fd >= 0 && _tij_native_count (context->job, parent_fd, base_name, 0, &n_counted))
+        {
+          native_list = g_list_prepend (native_list, lp->data);
+          n_files += n_counted;
+        }
+      else
+        {
+          remaining_list = thunar_g_list_prepend_deep (remaining_list, lp->data);
+        }
+      g_free (base_name);
+
+      if (parent_fd >= 0)
+        close (parent_fd);
+      if (parent != NULL)
+        g_object_unref (parent);
+    }
+
+  if (native_list == NULL)
+    return g_list_reverse (remaining_list);
+
+  thunar_job_set_n_total_files (context->job, n_files);
+
+  context->pool = g_thread_pool_new (_tij_attrib_worker, context, THUNAR_ATTRIB_NATIVE_THREADS, FALSE, NULL);
+  g_mutex_init (&context->mutex);
+  g_cond_init (&context->cond);
+  g_mutex_init (&context->ask_mutex);
+
+  /* change them */
+  native_list = g_list_reverse (native_list);
+  for (lp = native_list; lp != NULL && !exo_job_is_cancelled (EXO_JOB (context->job)); lp = lp->next)
+    {
+      g_atomic_int_inc (&context->n_processed);
+
+      path = g_file_get_path (lp->data);
+      if (fstatat (AT_FDCWD, path, &statb, AT_SYMLINK_NOFOLLOW) == 0 && S_ISDIR (statb.st_mode))
+        _tij_attrib_push (context, NULL, path, &statb);
+      else
+        g_free (path);
+    }
+
+  /* wait for the pool, reporting the progress not more than four times per second */
+  start_time = g_get_monotonic_time ();
+  g_mutex_lock (&context->mutex);
+  while (context->n_pending > 0)
+    {
+      end_time = g_get_monotonic_time () + THUNAR_ATTRIB_NATIVE_UPDATE_INTERVAL;
+      if (!g_cond_wait_until (&context->cond, &context->mutex, end_time) && context->current_path != NULL)
+        {
+          path = g_strdup (context->current_path);
+          g_mutex_unlock (&context->mutex);
+          _tij_attrib_progress (context, n_files, start_time, path);
+          g_free (path);
+          g_mutex_lock (&context->mutex);
+        }
+    }
+  g_mutex_unlock (&context->mutex);
+
+  g_thread_pool_free (context->pool, FALSE, TRUE);
+  g_mutex_clear (&context->mutex);
+  g_cond_clear (&context->cond);
+  g_mutex_clear (&context->ask_mutex);
+  g_free (context->current_path);
+
+  g_list_free (native_list);
+
+  return g_list_reverse (remaining_list);
+}
+#endif
+
+
+
 static gboolean
 _thunar_io_jobs_chown (ThunarJob  *job,
                        GArray     *param_values,
                        GError    **error)
 {
-  ThunarJobResponse response;
-  const gchar      *message;
-  GFileInfo        *info;
-  gboolean          recursive;
-  GError           *err = NULL;
-  GList            *file_list;
-  GList            *lp;
-  gint              uid;
-  gint              gid;
-  guint             n_processed = 0;
+  ThunarJobResponse   response;
+  const gchar        *message;
+  GFileInfo          *info;
+  gboolean            recursive;
+  GError             *err = NULL;
+  GList              *file_list;
+  GList              *lp;
+  gint                uid;
+  gint                gid;
+  guint               n_processed = 0;
+#ifdef THUNAR_ATTRIB_NATIVE
+  ThunarAttribContext context = { 0, };
+  GList              *remaining_list;
+#endif
 
   _thunar_return_val_if_fail (THUNAR_IS_JOB (job), FALSE);
   _thunar_return_val_if_fail (param_values != NULL, FALSE);
@@ -1005,7 +2228,19 @@ _thunar_io_jobs_chown (ThunarJob  *job,
 
   /* collect the files for the chown operation */
   if (recursive)
-    file_list = _tij_collect_nofollow (job, file_list, FALSE, &err);
+    {
+#ifdef THUNAR_ATTRIB_NATIVE
+      /* local folders are changed without a list of everything below them */
+      context.job = job;
+      context.uid = uid;
+      context.gid = gid;
+      remaining_list = _tij_attrib_native (&context, file_list);
+      file_list = _tij_collect_nofollow (job, remaining_list, FALSE, &err);
+      thunar_g_list_free_full (remaining_list);
+#else
+      file_list = _tij_collect_nofollow (job, file_list, FALSE, &err);
+#endif
+    }
   else
     file_list = thunar_g_list_copy_deep (file_list);
 
@@ -1016,7 +2251,8 @@ _thunar_io_jobs_chown (ThunarJob  *job,
     }
 
   /* we know the total list of files to process */
-  thunar_job_set_total_files (THUNAR_JOB (job), file_list);
+  if (file_list != NULL)
+    thunar_job_set_total_files (THUNAR_JOB (job), file_list);
 
   /* change the ownership of all files */
   for (lp = file_list; lp != NULL && err == NULL; lp = lp->next, n_processed++)
@@ -1026,7 +2262,9 @@ _thunar_io_jobs_chown (ThunarJob  *job,
 
       /* try to query information about the file */
       info = g_file_query_info (lp->data,
-                                G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME,
+                                G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME ","
+                                G_FILE_ATTRIBUTE_UNIX_UID ","
+                                G_FILE_ATTRIBUTE_UNIX_GID,
                                 G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
                                 exo_job_get_cancellable (EXO_JOB (job)),
                                 &err);
@@ -1034,6 +2272,16 @@ _thunar_io_jobs_chown (ThunarJob  *job,
       if (err != NULL)
         break;
 
+      /* skip files which already have the owner */
+      if ((uid >= 0 && g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_UNIX_UID)
+           && g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_UID) == (guint32) uid)
+          || (gid >= 0 && g_file_info_has_attribute (info, G_FILE_ATTRIBUTE_UNIX_GID)
+              && g_file_info_get_attribute_uint32 (info, G_FILE_ATTRIBUTE_UNIX_GID) == (guint32) gid))
+        {
+          g_object_unref (info);
+          continue;
+        }
+
     retry_chown:
       if (uid >= 0)
         {
@@ -1118,25 +2366,30 @@ _thunar_io_jobs_chmod (ThunarJob  *job,
                        GArray     *param_values,
                        GError    **error)
 {
-  ThunarJobResponse response;
-  GFileInfo        *info;
-  gboolean          recursive;
-  GError           *err = NULL;
-  GList            *file_list;
-  GList            *lp;
-  guint             n_processed = 0;
-  ThunarFileMode    dir_mask;
-  ThunarFileMode    dir_mode;
-  ThunarFileMode    file_mask;
-  ThunarFileMode    file_mode;
-  ThunarFileMode    mask;
-  ThunarFileMode    mode;
-  ThunarFileMode    old_mode;
-  ThunarFileMode    new_mode;
+  ThunarJobResponse   response;
+  GFileInfo          *info;
+  gboolean            recursive;
+  GError             *err = NULL;
+  GList              *file_list;
+  GList              *lp;
+  guint               n_processed = 0;
+  ThunarFileMode      dir_mask;
+  ThunarFileMode      dir_mode;
+  ThunarFileMode      file_mask;
+  ThunarFileMode      file_mode;
+  ThunarFileMode      mask;
+  ThunarFileMode      mode;
+  ThunarFileMode      old_mode;
+  ThunarFileMode      new_mode;
+  gboolean            fix_folders;
+#ifdef THUNAR_ATTRIB_NATIVE
+  ThunarAttribContext context = { 0, };
+  GList              *remaining_list;
+#endif
 
   _thunar_return_val_if_fail (THUNAR_IS_JOB (job), FALSE);
   _thunar_return_val_if_fail (param_values != NULL, FALSE);
-  _thunar_return_val_if_fail (param_values->len == 6, FALSE);
+  _thunar_return_val_if_fail (param_values->len == 7, FALSE);
   _thunar_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
   file_list = g_value_get_boxed (&g_array_index (param_values, GValue, 0));
@@ -1145,10 +2398,29 @@ _thunar_io_jobs_chmod (ThunarJob  *job,
   file_mask = g_value_get_flags (&g_array_index (param_values, GValue, 3));
   file_mode = g_value_get_flags (&g_array_index (param_values, GValue, 4));
   recursive = g_value_get_boolean (&g_array_index (param_values, GValue, 5));
+  fix_folders = g_value_get_boolean (&g_array_index (param_values, GValue, 6));
 
   /* collect the files for the chown operation */
   if (recursive)
-    file_list = _tij_collect_nofollow (job, file_list, FALSE, &err);
+    {
+#ifdef THUNAR_ATTRIB_NATIVE
+      /* local folders are changed without a list of everything below them */
+      context.job = job;
+      context.change_mode = TRUE;
+      context.fix_folders = fix_folders;
+      context.uid = -1;
+      context.gid = -1;
+      context.dir_mask = dir_mask;
+      context.dir_mode = dir_mode;
+      context.file_mask = file_mask;
+      context.file_mode = file_mode;
+      remaining_list = _tij_attrib_native (&context, file_list);
+      file_list = _tij_collect_nofollow (job, remaining_list, FALSE, &err);
+      thunar_g_list_free_full (remaining_list);
+#else
+      file_list = _tij_collect_nofollow (job, file_list, FALSE, &err);
+#endif
+    }
   else
     file_list = thunar_g_list_copy_deep (file_list);
 
@@ -1159,7 +2431,8 @@ _thunar_io_jobs_chmod (ThunarJob  *job,
     }
 
   /* we know the total list of files to process */
-  thunar_job_set_total_files (THUNAR_JOB (job), file_list);
+  if (file_list != NULL)
+    thunar_job_set_total_files (THUNAR_JOB (job), file_list);
 
   /* change the ownership of all files */
   for (lp = file_list; lp != NULL && err == NULL; lp = lp->next, n_processed++)
@@ -1197,9 +2470,13 @@ _thunar_io_jobs_chmod (ThunarJob  *job,
 
       /* generate the new mode, taking the old mode (which contains file type
        * information) into account */
-      new_mode = ((old_mode & ~mask) | mode) & 07777;
+      if (fix_folders)
+        new_mode = (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY) ? _tij_fixed_folder_mode (old_mode) : (old_mode & 07777);
+      else
+        new_mode = ((old_mode & ~mask) | mode) & 07777;
 
-      if (old_mode != new_mode)
+      /* the old mode also contains the file type */
+      if ((old_mode & 07777) != new_mode)
         {
           /* try to change the file mode */
           g_file_set_attribute_uint32 (lp->data,
@@ -1260,25 +2537,219 @@ thunar_io_jobs_change_mode (GList         *files,
   /* files are released when the list if destroyed */
   g_list_foreach (files, (GFunc) (void (*)(void)) g_object_ref, NULL);
 
-  return thunar_simple_job_new (_thunar_io_jobs_chmod, 6,
+  return thunar_simple_job_new (_thunar_io_jobs_chmod, 7,
                                 THUNAR_TYPE_G_FILE_LIST, files,
                                 THUNAR_TYPE_FILE_MODE, dir_mask,
                                 THUNAR_TYPE_FILE_MODE, dir_mode,
                                 THUNAR_TYPE_FILE_MODE, file_mask,
                                 THUNAR_TYPE_FILE_MODE, file_mode,
-                                G_TYPE_BOOLEAN, recursive);
+                                G_TYPE_BOOLEAN, recursive,
+                                G_TYPE_BOOLEAN, FALSE);
+}
+
+
+
+/**
+ * thunar_io_jobs_fix_folder_permissions:
+ * @files : the folders to fix.
+ *
+ * Makes the permissions of the @files and the folders below them
+ * consistent: the owner may read and enter every folder, and the
+ * group and the others may enter the folders which they may read.
+ * The files in the folders are left alone.
+ *
+ * Return value: the newly allocated #ThunarJob.
+ **/
+ThunarJob *
+thunar_io_jobs_fix_folder_permissions (GList *files)
+{
+  _thunar_return_val_if_fail (files != NULL, NULL);
+
+  /* files are released when the list if destroyed */
+  g_list_foreach (files, (GFunc) (void (*)(void)) g_object_ref, NULL);
+
+  return thunar_simple_job_new (_thunar_io_jobs_chmod, 7,
+                                THUNAR_TYPE_G_FILE_LIST, files,
+                                THUNAR_TYPE_FILE_MODE, 0,
+                                THUNAR_TYPE_FILE_MODE, 0,
+                                THUNAR_TYPE_FILE_MODE, 0,
+                                THUNAR_TYPE_FILE_MODE, 0,
+                                G_TYPE_BOOLEAN, TRUE,
+                                G_TYPE_BOOLEAN, TRUE);
+}
+
+
+
+/* The listing of a folder is handed out in batches, the first one is
+ * small to show the first screen soon, the later ones grow up to the
+ * maximum to limit the view updates */
+#define THUNAR_IO_JOBS_LS_BATCH_MIN (64)
+#define THUNAR_IO_JOBS_LS_BATCH_MAX (4096)
+
+
+
+static void
+_thunar_io_jobs_ls_emit (ThunarJob *job,
+                         GList     *file_list)
+{
+  /* emit the "files-ready" signal */
+  if (G_LIKELY (file_list != NULL)
+      && !thunar_job_files_ready (THUNAR_JOB (job), file_list))
+    {
+      /* none of the handlers took over the file list, so it's up to us
+       * to destroy it */
+      thunar_g_list_free_full (file_list);
+    }
+}
+
+
+
+static gboolean
+_thunar_io_jobs_ls_stream (ThunarJob  *job,
+                           GFile      *directory,
+                           GError    **error)
+{
+  ThunarIoEnumerator *enumerator;
+  GCancellable       *cancellable;
+  GError             *err = NULL;
+  GList              *infos;
+  GList              *file_list;
+  guint               n_batch = THUNAR_IO_JOBS_LS_BATCH_MIN;
+
+  cancellable = exo_job_get_cancellable (EXO_JOB (job));
+
+  enumerator = thunar_io_enumerator_new (directory, THUNAR_FILE_INFO_NAMESPACE,
+                                         G_FILE_QUERY_INFO_NONE, cancellable, &err);
+  if (G_UNLIKELY (enumerator == NULL))
+    {
+      g_propagate_error (error, err);
+      return FALSE;
+    }
+
+  while (!exo_job_is_cancelled (EXO_JOB (job)))
+    {
+      /* remote backends answer a whole batch with one round trip */
+      infos = thunar_io_enumerator_next_files (enumerator, n_batch, cancellable, &err);
+      if (infos == NULL)
+        {
+          /* ignore the entries which failed, like thunar_io_scan_directory() */
+          if (err != NULL && g_error_matches (err, G_IO_ERROR, G_IO_ERROR_FAILED))
+            {
+              g_warning ("Error while scanning directory: %s", err->message);
+              g_clear_error (&err);
+              continue;
+            }
+          break;
+        }
+
+      file_list = thunar_file_get_with_info_batch (directory, infos);
+      g_list_free_full (infos, g_object_unref);
+
+      /* the first screen is shown after the first small batch, the
+       * rest follows in bigger batches, to limit the view updates */
+      _thunar_io_jobs_ls_emit (job, file_list);
+      n_batch = MIN (n_batch * 4, THUNAR_IO_JOBS_LS_BATCH_MAX);
+    }
+
+  thunar_io_enumerator_free (enumerator);
+
+  if (err != NULL)
+    {
+      g_propagate_error (error, err);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+
+
+static gboolean
+_thunar_io_jobs_ls (ThunarJob  *job,
+                    GArray     *param_values,
+                    GError    **error)
+{
+  GError *err = NULL;
+  GFile  *directory;
+  GList  *file_list = NULL;
+
+  _thunar_return_val_if_fail (THUNAR_IS_JOB (job), FALSE);
+  _thunar_return_val_if_fail (param_values != NULL, FALSE);
+  _thunar_return_val_if_fail (param_values->len == 1, FALSE);
+  _thunar_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (exo_job_set_error_if_cancelled (EXO_JOB (job), error))
+    return FALSE;
+
+  /* determine the directory to list */
+  directory = g_value_get_object (&g_array_index (param_values, GValue, 0));
+
+  /* make sure the object is valid */
+  _thunar_assert (G_IS_FILE (directory));
+
+  if (!g_file_has_uri_scheme (directory, "recent"))
+    {
+      /* stream the directory contents (non-recursively) in batches */
+      if (!_thunar_io_jobs_ls_stream (job, directory, &err))
+        {
+          g_propagate_error (error, err);
+          return FALSE;
+        }
+    }
+  else
+    {
+      /* the recent files come from the recent index, with their targets queried at once */
+      file_list = thunar_io_scan_directory (job, directory,
+                                            G_FILE_QUERY_INFO_NONE,
+                                            FALSE, FALSE, TRUE, NULL, &err);
+
+      /* abort on errors or cancellation */
+      if (err != NULL)
+        {
+          g_propagate_error (error, err);
+          return FALSE;
+        }
+      else if (exo_job_set_error_if_cancelled (EXO_JOB (job), &err))
+        {
+          g_propagate_error (error, err);
+          return FALSE;
+        }
+
+      _thunar_io_jobs_ls_emit (job, file_list);
+    }
+
+  /* there should be no errors here */
+  _thunar_assert (err == NULL);
+
+  /* propagate cancellation error */
+  if (exo_job_set_error_if_cancelled (EXO_JOB (job), &err))
+    {
+      g_propagate_error (error, err);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+
+
+ThunarJob *
+thunar_io_jobs_list_directory (GFile *directory)
+{
+  _thunar_return_val_if_fail (G_IS_FILE (directory), NULL);
+
+  return thunar_simple_job_new (_thunar_io_jobs_ls, 1, G_TYPE_FILE, directory);
 }
 
 
 
 static gboolean
-_thunar_io_jobs_ls (ThunarJob  *job,
-                    GArray     *param_values,
-                    GError    **error)
+_thunar_io_jobs_load_folder_snapshot (ThunarJob  *job,
+                                      GArray     *param_values,
+                                      GError    **error)
 {
-  GError *err = NULL;
-  GFile  *directory;
-  GList  *file_list = NULL;
+  GFile *directory;
+  GList *file_list;
 
   _thunar_return_val_if_fail (THUNAR_IS_JOB (job), FALSE);
   _thunar_return_val_if_fail (param_values != NULL, FALSE);
@@ -1288,62 +2759,38 @@ _thunar_io_jobs_ls (ThunarJob  *job,
   if (exo_job_set_error_if_cancelled (EXO_JOB (job), error))
     return FALSE;
 
-  /* determine the directory to list */
   directory = g_value_get_object (&g_array_index (param_values, GValue, 0));
-
-  /* make sure the object is valid */
   _thunar_assert (G_IS_FILE (directory));
 
-  /* collect directory contents (non-recursively) */
-  file_list = thunar_io_scan_directory (job, directory,
-                                        G_FILE_QUERY_INFO_NONE,
-                                        FALSE, FALSE, TRUE, NULL, &err);
-
-  /* abort on errors or cancellation */
-  if (err != NULL)
-    {
-      g_propagate_error (error, err);
-      return FALSE;
-    }
-  else if (exo_job_set_error_if_cancelled (EXO_JOB (job), &err))
-    {
-      g_propagate_error (error, err);
-      return FALSE;
-    }
-
-  /* check if we have any files to report */
+  /* a missing or outdated snapshot is no error, the listing follows anyway */
+  file_list = thunar_folder_snapshot_load (directory, exo_job_get_cancellable (EXO_JOB (job)));
   if (G_LIKELY (file_list != NULL))
     {
-      /* emit the "files-ready" signal */
       if (!thunar_job_files_ready (THUNAR_JOB (job), file_list))
-        {
-          /* none of the handlers took over the file list, so it's up to us
-           * to destroy it */
-          thunar_g_list_free_full (file_list);
-        }
-    }
-
-  /* there should be no errors here */
-  _thunar_assert (err == NULL);
-
-  /* propagate cancellation error */
-  if (exo_job_set_error_if_cancelled (EXO_JOB (job), &err))
-    {
-      g_propagate_error (error, err);
-      return FALSE;
+        thunar_g_list_free_full (file_list);
     }
 
-  return TRUE;
+  return !exo_job_set_error_if_cancelled (EXO_JOB (job), error);
 }
 
 
 
+/**
+ * thunar_io_jobs_load_folder_snapshot:
+ * @directory : a #GFile.
+ *
+ * Restores the files of @directory from its snapshot, see
+ * thunar_folder_snapshot_load(), and emits them with the
+ * "files-ready" signal.
+ *
+ * Return value: the #ThunarJob, which has to be launched.
+ **/
 ThunarJob *
-thunar_io_jobs_list_directory (GFile *directory)
+thunar_io_jobs_load_folder_snapshot (GFile *directory)
 {
   _thunar_return_val_if_fail (G_IS_FILE (directory), NULL);
 
-  return thunar_simple_job_new (_thunar_io_jobs_ls, 1, G_TYPE_FILE, directory);
+  return thunar_simple_job_new (_thunar_io_jobs_load_folder_snapshot, 1, G_TYPE_FILE, directory);
 }
 
 
@@ -1445,15 +2892,18 @@ _thunar_io_jobs_count (ThunarJob *job,
                        GArray    *param_values,
                        GError   **error)
 {
+  GCancellable    *cancellable;
   GError          *err = NULL;
   ThunarFile      *file;
   GFileEnumerator *enumerator;
+  GFileInfo       *child_info;
   guint            count;
 
   _thunar_return_val_if_fail (THUNAR_IS_JOB (job), FALSE);
   _thunar_return_val_if_fail (param_values != NULL, FALSE);
-  _thunar_return_val_if_fail (param_values->len == 1, FALSE);
+  _thunar_return_val_if_fail (param_values->len == 2, FALSE);
   _thunar_return_val_if_fail (G_VALUE_HOLDS (&g_array_index (param_values, GValue, 0), THUNAR_TYPE_FILE), FALSE);
+  _thunar_return_val_if_fail (G_VALUE_HOLDS_UINT (&g_array_index (param_values, GValue, 1)), FALSE);
   _thunar_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
   file = THUNAR_FILE (g_value_get_object (&g_array_index (param_values, GValue, 0)));
@@ -1461,9 +2911,11 @@ _thunar_io_jobs_count (ThunarJob *job,
   if (file == NULL)
     return FALSE;
 
-  enumerator = g_file_enumerate_children (thunar_file_get_file (file), NULL,
+  /* only the names are needed, which avoids a stat per child on most backends */
+  cancellable = exo_job_get_cancellable (EXO_JOB (job));
+  enumerator = g_file_enumerate_children (thunar_file_get_file (file), G_FILE_ATTRIBUTE_STANDARD_NAME,
                                           G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
-                                          NULL, &err);
+                                          cancellable, &err);
   if (err != NULL)
     {
       g_propagate_error (error, err);
@@ -1471,64 +2923,328 @@ _thunar_io_jobs_count (ThunarJob *job,
     }
 
   count = 0;
-  for (GFileInfo *child_info = g_file_enumerator_next_file (enumerator, NULL, &err);
-       child_info != NULL;
-       child_info = g_file_enumerator_next_file (enumerator, NULL, &err))
+  while ((child_info = g_file_enumerator_next_file (enumerator, cancellable, &err)) != NULL)
     {
-      if (err != NULL)
-        {
-          g_propagate_error (error, err);
-          return FALSE;
-        }
-
       count++;
       g_object_unref (child_info);
     }
 
-  thunar_file_set_file_count (file, count);
-
   g_object_unref (enumerator);
 
+  if (err != NULL)
+    {
+      g_propagate_error (error, err);
+      return FALSE;
+    }
+
+  /* the result is picked up by the count scheduler once the job finished */
+  g_value_set_uint (&g_array_index (param_values, GValue, 1), count);
+
   return TRUE;
 }
 
 
 
+/**
+ * thunar_io_jobs_count_files:
+ * @file : a #ThunarFile for a directory.
+ *
+ * Counts the children of @file. When the job succeeded, the number of
+ * children is the second parameter value of the #ThunarSimpleJob.
+ *
+ * Return value: (transfer full): the newly allocated #ThunarJob.
+ **/
 ThunarJob *
 thunar_io_jobs_count_files (ThunarFile *file)
 {
   _thunar_return_val_if_fail (THUNAR_IS_FILE (file), NULL);
 
-  return thunar_simple_job_new (_thunar_io_jobs_count, 1,
-                                THUNAR_TYPE_FILE, file);
+  return thunar_simple_job_new (_thunar_io_jobs_count, 2,
+                                THUNAR_TYPE_FILE, file,
+                                G_TYPE_UINT, 0);
+}
+
+
+
+static GList *
+_thunar_search_folder_get_files (GFile        *directory,
+                                 GList        *matches,
+                                 GCancellable *cancellable)
+{
+  GFileInfo *info;
+  GList     *cached_files;
+  GList     *files = NULL;
+  GList     *infos = NULL;
+  GList     *lp, *lq;
+
+  /* pick up the matches which are already known to thunar */
+  cached_files = thunar_file_cache_lookup_batch (matches);
+
+  for (lp = cached_files, lq = matches; lp != NULL; lp = lp->next, lq = lq->next)
+    {
+      if (lp->data != NULL)
+        {
+          files = g_list_prepend (files, lp->data);
+          continue;
+        }
+
+      /* the enumerator only queried what's required for matching */
+      info = g_file_query_info (lq->data, THUNAR_FILE_INFO_NAMESPACE,
+                                G_FILE_QUERY_INFO_NONE, cancellable, NULL);
+      if (G_LIKELY (info != NULL))
+        infos = g_list_prepend (infos, info);
+    }
+
+  /* construct the others with a single cache transaction */
+  files = g_list_concat (thunar_file_get_with_info_batch (directory, infos), files);
+
+  g_list_free_full (infos, g_object_unref);
+  g_list_free (cached_files);
+
+  return files;
+}
+
+
+
+/* Maximum number of threads crawling the folder tree during a recursive search */
+#define THUNAR_SEARCH_MAX_WORKERS 8
+
+/* Search results are handed to the model once this many are
+ * pending or the oldest of them waited for the given latency */
+#define THUNAR_SEARCH_RESULTS_BATCH_SIZE 256
+#define THUNAR_SEARCH_RESULTS_LATENCY    (50 * G_TIME_SPAN_MILLISECOND)
+
+
+
+typedef struct
+{
+  GMutex  mutex;
+  GQueue  directories; /* GFile */
+}
+ThunarSearchDeque;
+
+typedef struct
+{
+  ThunarStandardViewModel            *model;
+  ThunarJob                          *job;
+  gchar                             **search_query_c_terms;
+  ThunarSearchMatcher                *matcher;
+  enum ThunarStandardViewModelSearch  search_type;
+  gboolean                            show_hidden;
+
+  /* every worker owns a deque of directories to scan. Found
+   * subdirectories are pushed to and taken from the tail of the
+   * own deque (depth-first), idle workers steal from the head of
+   * the other deques */
+  ThunarSearchDeque                  *deques;
+  guint                               n_workers;
+
+  /* number of directories queued or being scanned */
+  gint                                n_pending;
+
+  /* idle workers sleep here until new directories are queued */
+  GMutex                              idle_mutex;
+  GCond                               idle_cond;
+
+  /* results not yet handed to the model */
+  GMutex                              results_mutex;
+  GList                              *results;
+  guint                               n_results;
+  gint64                              results_time; /* when the oldest result was added */
+}
+ThunarSearchContext;
+
+typedef struct
+{
+  ThunarSearchContext *context;
+  guint                index;
+}
+ThunarSearchWorker;
+
+
+
+static void
+_thunar_search_push_directory (ThunarSearchContext *context,
+                               guint                index,
+                               GFile               *directory)
+{
+  g_atomic_int_inc (&context->n_pending);
+
+  g_mutex_lock (&context->deques[index].mutex);
+  g_queue_push_tail (&context->deques[index].directories, g_object_ref (directory));
+  g_mutex_unlock (&context->deques[index].mutex);
+
+  /* wake up an idle worker */
+  g_mutex_lock (&context->idle_mutex);
+  g_cond_signal (&context->idle_cond);
+  g_mutex_unlock (&context->idle_mutex);
+}
+
+
+
+static GFile *
+_thunar_search_take_directory (ThunarSearchContext *context,
+                               guint                index)
+{
+  ThunarSearchDeque *deque;
+  GFile             *directory;
+  guint              n;
+
+  /* look in the own deque first */
+  deque = &context->deques[index];
+  g_mutex_lock (&deque->mutex);
+  directory = g_queue_pop_tail (&deque->directories);
+  g_mutex_unlock (&deque->mutex);
+
+  /* otherwise steal the oldest (likely biggest) subtree of another worker */
+  for (n = 1; directory == NULL && n < context->n_workers; n++)
+    {
+      deque = &context->deques[(index + n) % context->n_workers];
+      g_mutex_lock (&deque->mutex);
+      directory = g_queue_pop_head (&deque->directories);
+      g_mutex_unlock (&deque->mutex);
+    }
+
+  return directory;
+}
+
+
+
+static void
+_thunar_search_flush_results (ThunarSearchContext *context,
+                              GList               *files,
+                              gboolean             force)
+{
+  GList  *results = NULL;
+  gint64  now;
+
+  now = g_get_monotonic_time ();
+
+  g_mutex_lock (&context->results_mutex);
+
+  if (files != NULL)
+    {
+      if (context->results == NULL)
+        context->results_time = now;
+      context->n_results += g_list_length (files);
+      context->results = g_list_concat (files, context->results);
+    }
+
+  /* take the pending results if they are enough or old enough */
+  if (context->results != NULL
+      && (force
+          || context->n_results >= THUNAR_SEARCH_RESULTS_BATCH_SIZE
+          || now - context->results_time >= THUNAR_SEARCH_RESULTS_LATENCY))
+    {
+      results = context->results;
+      context->results = NULL;
+      context->n_results = 0;
+    }
+
+  g_mutex_unlock (&context->results_mutex);
+
+  /* the model accepts search results from any thread */
+  if (results != NULL)
+    {
+      if (exo_job_is_cancelled (EXO_JOB (context->job)))
+        thunar_g_list_free_full (results);
+      else
+        thunar_standard_view_model_add_search_files (context->model, results);
+    }
+}
+
+
+
+static void
+_thunar_search_folder_flush_matches (ThunarSearchContext *context,
+                                     GFile               *directory,
+                                     GList              **matches)
+{
+  GCancellable *cancellable;
+
+  cancellable = exo_job_get_cancellable (EXO_JOB (context->job));
+
+  /* create the ThunarFiles for the matches at once */
+  if (*matches != NULL && !exo_job_is_cancelled (EXO_JOB (context->job)))
+    _thunar_search_flush_results (context, _thunar_search_folder_get_files (directory, *matches, cancellable), FALSE);
+
+  g_list_free_full (*matches, g_object_unref);
+  *matches = NULL;
+}
+
+
+
+static void
+_thunar_search_recent (ThunarSearchContext *context,
+                       guint                index)
+{
+  ThunarRecentIndexItem *item;
+  GCancellable          *cancellable;
+  GList                 *items;
+  GList                 *files = NULL;
+  GList                 *lp;
+
+  cancellable = exo_job_get_cancellable (EXO_JOB (context->job));
+
+  /* the targets come with the full info, so no ThunarFile needs another query */
+  items = thunar_recent_index_get_items (THUNAR_FILE_INFO_NAMESPACE, G_FILE_QUERY_INFO_NONE, cancellable);
+
+  for (lp = items; lp != NULL && !exo_job_is_cancelled (EXO_JOB (context->job)); lp = lp->next)
+    {
+      item = lp->data;
+
+      /* respect last-show-hidden, same logic as thunar_file_is_hidden() */
+      if (context->show_hidden == FALSE
+          && (g_file_info_get_attribute_boolean (item->info, G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN)
+              || g_file_info_get_attribute_boolean (item->info, G_FILE_ATTRIBUTE_STANDARD_IS_BACKUP)))
+        continue;
+
+      /* the folders below recent folders are searched as usual */
+      if (g_file_info_get_file_type (item->info) == G_FILE_TYPE_DIRECTORY
+          && !g_file_info_get_is_symlink (item->info)
+          && context->search_type == THUNAR_STANDARD_VIEW_MODEL_SEARCH_RECURSIVE)
+        _thunar_search_push_directory (context, index, item->file);
+
+      if (thunar_util_search_matcher_match (context->matcher, g_file_info_get_display_name (item->info))
+          && thunar_util_search_matcher_match_info (context->matcher, item->info))
+        files = g_list_prepend (files, thunar_file_get_with_info (item->file, item->info, item->recent_info, FALSE));
+    }
+
+  thunar_recent_index_items_free (items);
+
+  _thunar_search_flush_results (context, files, FALSE);
 }
 
 
 
 static void
-_thunar_search_folder (ThunarStandardViewModel           *model,
-                       ThunarJob                         *job,
-                       gchar                             *uri,
-                       gchar                            **search_query_c_terms,
-                       enum ThunarStandardViewModelSearch search_type,
-                       gboolean                           show_hidden)
+_thunar_search_folder (ThunarSearchContext *context,
+                       guint                index,
+                       GFile               *directory)
 {
   GCancellable    *cancellable;
   GFileEnumerator *enumerator;
-  GFile           *directory;
-  GList           *files_found = NULL; /* contains the matching files in this folder only */
-  const gchar *namespace;
-  const gchar *display_name;
-  gchar       *display_name_c; /* converted to ignore case */
+  GList           *matches = NULL; /* matching children of the folder not turned into ThunarFiles yet */
+  guint            n_matches = 0;
+  const gchar     *namespace;
 
-  cancellable = exo_job_get_cancellable (EXO_JOB (job));
-  directory = g_file_new_for_uri (uri);
+  /* `recent:///` is listed from the recent index */
+  if (thunar_g_file_is_in_recent (directory))
+    {
+      _thunar_search_recent (context, index);
+      return;
+    }
+
+  cancellable = exo_job_get_cancellable (EXO_JOB (context->job));
+  /* the size and modification time come with the same stat() call
+   * as the type, so the search predicates are free to evaluate */
   namespace = G_FILE_ATTRIBUTE_STANDARD_TYPE ","
-              G_FILE_ATTRIBUTE_STANDARD_TARGET_URI ","
               G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME ","
               G_FILE_ATTRIBUTE_STANDARD_IS_BACKUP ","
               G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN ","
-              G_FILE_ATTRIBUTE_STANDARD_NAME ", recent::*";
+              G_FILE_ATTRIBUTE_STANDARD_NAME ","
+              G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+              G_FILE_ATTRIBUTE_TIME_MODIFIED;
 
   /* The directory enumerator MUST NOT follow symlinks itself, meaning that any symlinks that
    * g_file_enumerator_next_file() emits are the actual symlink entries. This prevents one
@@ -1541,7 +3257,7 @@ _thunar_search_folder (ThunarStandardViewModel           *model,
     return;
 
   /* go through every file in the folder and check if it matches */
-  while (exo_job_is_cancelled (EXO_JOB (job)) == FALSE)
+  while (exo_job_is_cancelled (EXO_JOB (context->job)) == FALSE)
     {
       GFile     *file;
       GFileInfo *info;
@@ -1552,19 +3268,10 @@ _thunar_search_folder (ThunarStandardViewModel           *model,
       if (G_UNLIKELY (info == NULL))
         break;
 
-      if (g_file_has_uri_scheme (directory, "recent"))
-        {
-          file = g_file_new_for_uri (g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_STANDARD_TARGET_URI));
-          g_object_unref (info);
-          info = g_file_query_info (file, namespace, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, cancellable, NULL);
-          if (G_UNLIKELY (info == NULL))
-            break;
-        }
-      else
-        file = g_file_get_child (directory, g_file_info_get_name (info));
+      file = g_file_get_child (directory, g_file_info_get_name (info));
 
       /* respect last-show-hidden */
-      if (show_hidden == FALSE)
+      if (context->show_hidden == FALSE)
         {
           /* same logic as thunar_file_is_hidden() */
           if (g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN)
@@ -1578,33 +3285,120 @@ _thunar_search_folder (ThunarStandardViewModel           *model,
 
       type = g_file_info_get_file_type (info);
 
-      /* handle directories */
-      if (type == G_FILE_TYPE_DIRECTORY && search_type == THUNAR_STANDARD_VIEW_MODEL_SEARCH_RECURSIVE)
-        {
-          _thunar_search_folder (model, job, g_file_get_uri (file), search_query_c_terms, search_type, show_hidden);
-        }
+      /* queue directories for the worker pool */
+      if (type == G_FILE_TYPE_DIRECTORY && context->search_type == THUNAR_STANDARD_VIEW_MODEL_SEARCH_RECURSIVE)
+        _thunar_search_push_directory (context, index, file);
 
-      /* prepare entry display name */
-      display_name = g_file_info_get_display_name (info);
-      display_name_c = thunar_g_utf8_normalize_for_search (display_name, TRUE, TRUE);
+      /* search for all substrings, and check the attributes on the info we
+       * already have, before any ThunarFile is built for the entry */
+      if (thunar_util_search_matcher_match (context->matcher, g_file_info_get_display_name (info))
+          && thunar_util_search_matcher_match_info (context->matcher, info))
+        {
+          matches = g_list_prepend (matches, g_object_ref (file));
 
-      /* search for all substrings */
-      if (thunar_util_search_terms_match (search_query_c_terms, display_name_c))
-        files_found = g_list_prepend (files_found, thunar_file_get (file, NULL));
+          /* don't hold back the results of huge folders */
+          if (++n_matches >= THUNAR_SEARCH_RESULTS_BATCH_SIZE)
+            {
+              _thunar_search_folder_flush_matches (context, directory, &matches);
+              n_matches = 0;
+            }
+        }
 
       /* free memory */
-      g_free (display_name_c);
       g_object_unref (file);
       g_object_unref (info);
     }
 
   g_object_unref (enumerator);
-  g_object_unref (directory);
 
-  if (exo_job_is_cancelled (EXO_JOB (job)))
-    return;
+  _thunar_search_folder_flush_matches (context, directory, &matches);
+}
+
+
+
+static void
+_thunar_search_index_get_files (ThunarSearchContext *context,
+                                GList               *matches)
+{
+  ThunarFile *file;
+  GList      *cached_files;
+  GList      *files;
+  GList      *next;
+  GList      *lp, *lq;
+
+  /* convert the indexed matches in batches, so the first results show up quickly */
+  while (matches != NULL && !exo_job_is_cancelled (EXO_JOB (context->job)))
+    {
+      next = g_list_nth (matches, THUNAR_SEARCH_RESULTS_BATCH_SIZE);
+      if (next != NULL)
+        next->prev->next = NULL;
+
+      files = NULL;
+      cached_files = thunar_file_cache_lookup_batch (matches);
+      for (lp = cached_files, lq = matches; lp != NULL; lp = lp->next, lq = lq->next)
+        {
+          file = (lp->data != NULL) ? lp->data : thunar_file_get (lq->data, NULL);
+          if (G_LIKELY (file != NULL))
+            files = g_list_prepend (files, file);
+        }
+      g_list_free (cached_files);
+
+      _thunar_search_flush_results (context, files, FALSE);
+
+      thunar_g_list_free_full (matches);
+      if (next != NULL)
+        next->prev = NULL;
+      matches = next;
+    }
+
+  thunar_g_list_free_full (matches);
+}
+
+
+
+static gpointer
+_thunar_search_worker (gpointer user_data)
+{
+  ThunarSearchWorker  *worker = user_data;
+  ThunarSearchContext *context = worker->context;
+  GFile               *directory;
+
+  while (!exo_job_is_cancelled (EXO_JOB (context->job)))
+    {
+      directory = _thunar_search_take_directory (context, worker->index);
+      if (directory != NULL)
+        {
+          _thunar_search_folder (context, worker->index, directory);
+          g_object_unref (directory);
+
+          /* wake up everybody if this was the last directory, so they can quit */
+          if (g_atomic_int_dec_and_test (&context->n_pending))
+            {
+              g_mutex_lock (&context->idle_mutex);
+              g_cond_broadcast (&context->idle_cond);
+              g_mutex_unlock (&context->idle_mutex);
+            }
+
+          continue;
+        }
+
+      /* don't let results age while the workers are blocked on IO */
+      _thunar_search_flush_results (context, NULL, FALSE);
 
-  thunar_standard_view_model_add_search_files (model, files_found);
+      /* nothing to do right now, either all directories are scanned or
+       * the others are still busy and may queue new directories. The
+       * timeout covers missed wake-ups and job cancellation */
+      g_mutex_lock (&context->idle_mutex);
+      if (g_atomic_int_get (&context->n_pending) == 0)
+        {
+          g_mutex_unlock (&context->idle_mutex);
+          break;
+        }
+      g_cond_wait_until (&context->idle_cond, &context->idle_mutex, g_get_monotonic_time () + 50 * G_TIME_SPAN_MILLISECOND);
+      g_mutex_unlock (&context->idle_mutex);
+    }
+
+  return NULL;
 }
 
 
@@ -1614,41 +3408,105 @@ _thunar_job_search_directory (ThunarJob *job,
                               GArray    *param_values,
                               GError   **error)
 {
-  ThunarStandardViewModel           *model;
+  ThunarSearchContext                context;
+  ThunarSearchWorker                 workers[THUNAR_SEARCH_MAX_WORKERS];
+  GThread                           *threads[THUNAR_SEARCH_MAX_WORKERS];
   ThunarFile                        *directory;
   const char                        *search_query_c;
-  gchar                            **search_query_c_terms;
   gboolean                           is_source_device_local;
   ThunarRecursiveSearchMode          mode;
-  gboolean                           show_hidden;
-  enum ThunarStandardViewModelSearch search_type;
-  gchar                             *directory_uri;
-
-  search_type = THUNAR_STANDARD_VIEW_MODEL_SEARCH_NON_RECURSIVE;
+  GList                             *matches;
+  GList                             *predicates;
+  guint                              n;
 
   if (exo_job_set_error_if_cancelled (EXO_JOB (job), error))
     return FALSE;
 
-  model = g_value_get_object (&g_array_index (param_values, GValue, 0));
+  context.job = job;
+  context.search_type = THUNAR_STANDARD_VIEW_MODEL_SEARCH_NON_RECURSIVE;
+  context.model = g_value_get_object (&g_array_index (param_values, GValue, 0));
   search_query_c = g_value_get_string (&g_array_index (param_values, GValue, 1));
   directory = g_value_get_object (&g_array_index (param_values, GValue, 2));
   mode = g_value_get_enum (&g_array_index (param_values, GValue, 3));
-  show_hidden = g_value_get_boolean (&g_array_index (param_values, GValue, 4));
+  context.show_hidden = g_value_get_boolean (&g_array_index (param_values, GValue, 4));
 
-  search_query_c_terms = thunar_util_split_search_query (search_query_c, error);
-  if (search_query_c_terms == NULL)
+  predicates = NULL;
+  context.search_query_c_terms = thunar_util_split_search_query (search_query_c, &predicates, error);
+  if (context.search_query_c_terms == NULL)
     return FALSE;
 
+  /* compile the terms once for all the names to match */
+  context.matcher = thunar_util_search_matcher_new (context.search_query_c_terms, predicates);
+
   is_source_device_local = thunar_g_file_is_on_local_device (thunar_file_get_file (directory));
   if (mode == THUNAR_RECURSIVE_SEARCH_ALWAYS || (mode == THUNAR_RECURSIVE_SEARCH_LOCAL && is_source_device_local))
-    search_type = THUNAR_STANDARD_VIEW_MODEL_SEARCH_RECURSIVE;
+    context.search_type = THUNAR_STANDARD_VIEW_MODEL_SEARCH_RECURSIVE;
+
+  /* a non-recursive search only scans a single directory. Searches
+   * mostly wait for IO, so use more workers than processors */
+  if (context.search_type == THUNAR_STANDARD_VIEW_MODEL_SEARCH_RECURSIVE)
+    context.n_workers = CLAMP (g_get_num_processors () * 2, 2, THUNAR_SEARCH_MAX_WORKERS);
+  else
+    context.n_workers = 1;
+
+  context.n_pending = 0;
+  g_mutex_init (&context.idle_mutex);
+  g_cond_init (&context.idle_cond);
+  g_mutex_init (&context.results_mutex);
+  context.results = NULL;
+  context.n_results = 0;
+  context.results_time = 0;
+  context.deques = g_new (ThunarSearchDeque, context.n_workers);
+  for (n = 0; n < context.n_workers; n++)
+    {
+      g_mutex_init (&context.deques[n].mutex);
+      g_queue_init (&context.deques[n].directories);
+    }
+
+  /* answer recursive searches from the filename index if it covers the folder */
+  if (context.search_type == THUNAR_STANDARD_VIEW_MODEL_SEARCH_RECURSIVE
+      && thunar_search_index_search (thunar_file_get_file (directory), context.matcher, context.show_hidden,
+                                     exo_job_get_cancellable (EXO_JOB (job)), &matches))
+    {
+      _thunar_search_index_get_files (&context, matches);
+    }
+  else
+    {
+      _thunar_search_push_directory (&context, 0, thunar_file_get_file (directory));
 
-  directory_uri = thunar_file_dup_uri (directory);
+      /* the job thread itself is the first worker */
+      for (n = 0; n < context.n_workers; n++)
+        {
+          workers[n].context = &context;
+          workers[n].index = n;
+          threads[n] = NULL;
+          if (n > 0)
+            threads[n] = g_thread_try_new ("thunar-search", _thunar_search_worker, &workers[n], NULL);
+        }
+
+      _thunar_search_worker (&workers[0]);
+
+      for (n = 1; n < context.n_workers; n++)
+        if (threads[n] != NULL)
+          g_thread_join (threads[n]);
+    }
+
+  /* hand over the remaining results */
+  _thunar_search_flush_results (&context, NULL, TRUE);
+  g_mutex_clear (&context.results_mutex);
 
-  _thunar_search_folder (model, job, directory_uri, search_query_c_terms, search_type, show_hidden);
+  /* release directories left over after cancellation */
+  for (n = 0; n < context.n_workers; n++)
+    {
+      g_queue_clear_full (&context.deques[n].directories, g_object_unref);
+      g_mutex_clear (&context.deques[n].mutex);
+    }
+  g_free (context.deques);
+  g_cond_clear (&context.idle_cond);
+  g_mutex_clear (&context.idle_mutex);
 
-  g_free (directory_uri);
-  g_strfreev (search_query_c_terms);
+  thunar_util_search_matcher_free (context.matcher);
+  g_strfreev (context.search_query_c_terms);
 
   return TRUE;
 }
@@ -1693,9 +3551,9 @@ _thunar_io_jobs_clear_metadata_for_files (ThunarJob *job,
   infos = g_value_get_pointer (&g_array_index (param_values, GValue, 1));
   setting_names = g_value_get_pointer (&g_array_index (param_values, GValue, 2));
 
+  /* one write per file, with all of its settings */
   for (GList *gfile = gfiles, *info = infos; gfile != NULL && info != NULL; gfile = gfile->next, info = info->next)
-    for (GList *sn = setting_names; sn != NULL; sn = sn->next)
-      thunar_g_file_clear_metadata_setting (gfile->data, info->data, sn->data);
+    thunar_g_file_clear_metadata_settings (gfile->data, info->data, setting_names);
 
   g_list_free_full (gfiles, g_object_unref);
   g_list_free_full (infos, g_object_unref);
@@ -1742,6 +3600,8 @@ thunar_io_jobs_clear_metadata_for_files (GList *files,
 
   for (GList *lp = files; lp != NULL; lp = lp->next)
     {
+      /* the job only clears settings which are present in the info */
+      thunar_file_load_metadata (THUNAR_FILE (lp->data));
       gfiles = g_list_prepend (gfiles, g_object_ref (thunar_file_get_file (THUNAR_FILE (lp->data))));
       infos = g_list_prepend (infos, g_object_ref (thunar_file_get_info (THUNAR_FILE (lp->data))));
     }
@@ -1767,11 +3627,9 @@ _thunar_io_jobs_set_metadata_for_files (ThunarJob *job,
   type = g_value_get_int (&g_array_index (param_values, GValue, 2));
   setting_value_pairs = g_value_get_pointer (&g_array_index (param_values, GValue, 3));
 
+  /* one write per file, with all of its settings */
   for (GList *gfile = gfiles, *info = infos; gfile != NULL && info != NULL; gfile = gfile->next, info = info->next)
-    for (GList *sn = setting_value_pairs; sn != NULL; sn = sn->next)
-      thunar_g_file_set_metadata_setting (gfile->data, info->data, type,
-                                          ((gchar **) sn->data)[0],
-                                          ((gchar **) sn->data)[1], FALSE);
+    thunar_g_file_set_metadata_settings (gfile->data, info->data, type, setting_value_pairs);
 
   g_list_free_full (gfiles, g_object_unref);
   g_list_free_full (infos, g_object_unref);
@@ -1830,6 +3688,8 @@ thunar_io_jobs_set_metadata_for_files (GList       *files,
 
   for (GList *lp = files; lp != NULL; lp = lp->next)
     {
+      /* a later load would race with the values set by the job */
+      thunar_file_load_metadata (THUNAR_FILE (lp->data));
       gfiles = g_list_prepend (gfiles, g_object_ref (thunar_file_get_file (THUNAR_FILE (lp->data))));
       infos = g_list_prepend (infos, g_object_ref (thunar_file_get_info (THUNAR_FILE (lp->data))));
     }
@@ -1843,29 +3703,89 @@ thunar_io_jobs_set_metadata_for_files (GList       *files,
 
 
 
+/* how many bytes a background batch may read from a remote folder to sniff the
+ * files whose names are ambiguous, GIO reads about THUNAR_IO_JOBS_SNIFF_SIZE of each */
+#define THUNAR_IO_JOBS_SNIFF_BUDGET (256 * 1024)
+#define THUNAR_IO_JOBS_SNIFF_SIZE   (4096)
+
+
+
 static gboolean
 _thunar_job_load_content_types (ThunarJob *job,
                                 GArray    *param_values,
                                 GError   **error)
 {
-  GList *thunar_files;
+  GList    *thunar_files;
+  GFile    *parent = NULL;
+  GFile    *g_file;
+  gchar    *content_type;
+  gboolean  uncertain;
+  gboolean  is_local = TRUE;
+  gboolean  visible;
+  gsize     budget = THUNAR_IO_JOBS_SNIFF_BUDGET;
 
   if (exo_job_set_error_if_cancelled (EXO_JOB (job), error))
     return FALSE;
 
   thunar_files = g_value_get_boxed (&g_array_index (param_values, GValue, 0));
 
+  /* the files the views show are sniffed wherever they are */
+  visible = (thunar_job_get_priority (job) <= THUNAR_JOB_PRIORITY_VISIBLE);
+
   for (GList *lp = thunar_files; lp != NULL; lp = lp->next)
     {
-      gchar *content_type;
-      GFile       *g_file;
+      /* background batches wait while files are copied */
+      thunar_job_yield (job);
+      if (exo_job_is_cancelled (EXO_JOB (job)))
+        break;
+
+      /* already known, e.g. from a folder snapshot */
+      if (thunar_file_has_content_type (THUNAR_FILE (lp->data)))
+        continue;
 
       g_file = thunar_file_get_file (THUNAR_FILE (lp->data));
+
+      /* most names are unambiguous, which needs no round trip at all */
+      content_type = thunar_file_guess_content_type (THUNAR_FILE (lp->data), &uncertain);
+      if (content_type != NULL && !uncertain)
+        {
+          thunar_file_set_content_type (THUNAR_FILE (lp->data), content_type);
+          g_free (content_type);
+          continue;
+        }
+
+      if (content_type != NULL && !visible)
+        {
+          /* the files of a batch are usually siblings */
+          if (parent == NULL || !g_file_has_parent (g_file, parent))
+            {
+              if (parent != NULL)
+                g_object_unref (parent);
+              parent = g_file_get_parent (g_file);
+              is_local = thunar_g_file_is_on_local_device (g_file);
+            }
+
+          /* the guess is shown until the row becomes visible */
+          if (!is_local && budget < THUNAR_IO_JOBS_SNIFF_SIZE)
+            {
+              thunar_file_set_guessed_content_type (THUNAR_FILE (lp->data), content_type);
+              g_free (content_type);
+              continue;
+            }
+
+          if (!is_local)
+            budget -= THUNAR_IO_JOBS_SNIFF_SIZE;
+        }
+      g_free (content_type);
+
       content_type = thunar_g_file_get_content_type (g_file);
       thunar_file_set_content_type (THUNAR_FILE (lp->data), content_type);
       g_free (content_type);
     }
 
+  if (parent != NULL)
+    g_object_unref (parent);
+
   return TRUE;
 }
 
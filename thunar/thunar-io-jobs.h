@@ -50,11 +50,13 @@ ThunarJob *thunar_io_jobs_change_mode      (GList                 *files,
                                             ThunarFileMode         file_mask,
                                             ThunarFileMode         file_mode,
                                             gboolean               recursive) G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
+ThunarJob *thunar_io_jobs_fix_folder_permissions (GList           *files) G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
 ThunarJob *thunar_io_jobs_list_directory   (GFile                 *directory) G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
+ThunarJob *thunar_io_jobs_load_folder_snapshot (GFile             *directory) G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
 ThunarJob *thunar_io_jobs_rename_file      (ThunarFile            *file,
                                             const gchar           *display_name,
                                             ThunarOperationLogMode log_mode) G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
-ThunarJob *thunar_io_jobs_count_files      (ThunarFile            *file);
+ThunarJob *thunar_io_jobs_count_files      (ThunarFile            *file) G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
 ThunarJob *thunar_io_jobs_search_directory (ThunarStandardViewModel *model,
                                             const gchar             *search_query,
                                             ThunarFile              *directory);
@@ -27,9 +27,127 @@
 #include <exo/exo.h>
 
 #include "thunar/thunar-gio-extensions.h"
+#include "thunar/thunar-io-enumerator.h"
 #include "thunar/thunar-job.h"
 #include "thunar/thunar-private.h"
 #include "thunar/thunar-io-scan-directory.h"
+#include "thunar/thunar-recent-index.h"
+
+
+
+/* Number of enumerated children turned into #ThunarFile<!---->s at once */
+#define SCAN_DIRECTORY_BATCH_SIZE 128
+
+
+
+static GList *
+thunar_io_scan_directory_flush_batch (GFile  *file,
+                                      GList **batch,
+                                      GList  *files)
+{
+  GList *thunar_files;
+  GList *lp;
+
+  if (*batch == NULL)
+    return files;
+
+  /* the batch was collected in reverse */
+  *batch = g_list_reverse (*batch);
+  thunar_files = thunar_file_get_with_info_batch (file, *batch);
+
+  /* prepend the ThunarFiles, the references are taken over */
+  for (lp = thunar_files; lp != NULL; lp = lp->next)
+    files = g_list_prepend (files, lp->data);
+  g_list_free (thunar_files);
+
+  g_list_free_full (*batch, g_object_unref);
+  *batch = NULL;
+
+  return files;
+}
+
+
+
+static GList *
+thunar_io_scan_directory_recent (ThunarJob          *job,
+                                 GFileQueryInfoFlags flags,
+                                 gboolean            recursively,
+                                 gboolean            unlinking,
+                                 gboolean            return_thunar_files,
+                                 guint              *n_files_max,
+                                 GError            **error)
+{
+  ThunarRecentIndexItem *item;
+  GCancellable          *cancellable = NULL;
+  ThunarFile            *thunar_file;
+  const gchar           *namespace;
+  GError                *err = NULL;
+  GList                 *items;
+  GList                 *files = NULL;
+  GList                 *lp;
+
+  if (job != NULL)
+    cancellable = exo_job_get_cancellable (EXO_JOB (job));
+
+  if (return_thunar_files)
+    namespace = THUNAR_FILE_INFO_NAMESPACE;
+  else
+    namespace = G_FILE_ATTRIBUTE_STANDARD_TYPE ","
+                G_FILE_ATTRIBUTE_STANDARD_NAME;
+
+  /* the entries come with their targets, queried all at once */
+  items = thunar_recent_index_get_items (namespace, flags, cancellable);
+
+  for (lp = items; lp != NULL && err == NULL; lp = lp->next)
+    {
+      if (job != NULL && exo_job_is_cancelled (EXO_JOB (job)))
+        break;
+
+      if (G_UNLIKELY (n_files_max != NULL))
+        {
+          if (*n_files_max == 0)
+            break;
+          else
+            (*n_files_max)--;
+        }
+
+      item = lp->data;
+      if (return_thunar_files)
+        {
+          thunar_file = thunar_file_get_with_info (item->file, item->info, item->recent_info, FALSE);
+          files = thunar_g_list_prepend_deep (files, thunar_file);
+          g_object_unref (G_OBJECT (thunar_file));
+        }
+      else
+        {
+          files = thunar_g_list_prepend_deep (files, item->file);
+        }
+
+      /* the targets are regular folders, their children are scanned as usual */
+      if (recursively && g_file_info_get_file_type (item->info) == G_FILE_TYPE_DIRECTORY)
+        files = g_list_concat (thunar_io_scan_directory (job, item->file, flags, recursively,
+                                                         unlinking, return_thunar_files, n_files_max, &err),
+                               files);
+    }
+
+  thunar_recent_index_items_free (items);
+
+  if (G_UNLIKELY (err != NULL))
+    {
+      g_propagate_error (error, err);
+      thunar_g_list_free_full (files);
+      return NULL;
+    }
+  else if (job != NULL && exo_job_set_error_if_cancelled (EXO_JOB (job), &err))
+    {
+      g_propagate_error (error, err);
+      thunar_g_list_free_full (files);
+      return NULL;
+    }
+
+  return files;
+}
+
 
 
 /**
@@ -57,18 +175,19 @@ thunar_io_scan_directory (ThunarJob          *job,
                           guint              *n_files_max,
                           GError            **error)
 {
-  GFileEnumerator *enumerator;
-  GFileInfo       *info;
-  GFileInfo       *recent_info;
-  GFileType        type;
-  GError          *err = NULL;
-  GFile           *child_file;
-  GList           *child_files = NULL;
-  GList           *files = NULL;
-  const gchar     *namespace;
-  ThunarFile      *thunar_file;
-  gboolean         is_mounted;
-  GCancellable    *cancellable = NULL;
+  ThunarIoEnumerator *enumerator;
+  GFileInfo          *info;
+  GFileType           type;
+  GError             *err = NULL;
+  GFile              *child_file;
+  GList              *child_files = NULL;
+  GList              *files = NULL;
+  GList              *batch = NULL;
+  guint               n_batch = 0;
+  const gchar        *namespace;
+  ThunarFile         *thunar_file;
+  gboolean            is_mounted;
+  GCancellable       *cancellable = NULL;
 
   _thunar_return_val_if_fail (G_IS_FILE (file), NULL);
   _thunar_return_val_if_fail (error == NULL || *error == NULL, NULL);
@@ -89,6 +208,11 @@ thunar_io_scan_directory (ThunarJob          *job,
       return NULL;
     }
 
+  /* `recent:///` is listed from the recent index, without a lookup per entry */
+  if (thunar_g_file_is_in_recent (file))
+    return thunar_io_scan_directory_recent (job, flags, recursively, unlinking,
+                                            return_thunar_files, n_files_max, error);
+
   if (job != NULL)
     cancellable = exo_job_get_cancellable (EXO_JOB (job));
 
@@ -105,14 +229,14 @@ thunar_io_scan_directory (ThunarJob          *job,
 
   /* determine the namespace */
   if (return_thunar_files)
-    namespace = THUNARX_FILE_INFO_NAMESPACE;
+    namespace = THUNAR_FILE_INFO_NAMESPACE;
   else
     namespace = G_FILE_ATTRIBUTE_STANDARD_TYPE ","
-                G_FILE_ATTRIBUTE_STANDARD_NAME ", recent::*";
+                G_FILE_ATTRIBUTE_STANDARD_NAME;
 
   /* try to read from the direectory */
-  enumerator = g_file_enumerate_children (file, namespace,
-                                          flags, cancellable, &err);
+  enumerator = thunar_io_enumerator_new (file, namespace,
+                                         flags, cancellable, &err);
 
   /* abort if there was an error or the job was cancelled */
   if (err != NULL)
@@ -125,7 +249,7 @@ thunar_io_scan_directory (ThunarJob          *job,
   while (job == NULL || !exo_job_is_cancelled (EXO_JOB (job)))
     {
       /* query info of the child */
-      info = g_file_enumerator_next_file (enumerator, cancellable, &err);
+      info = thunar_io_enumerator_next_file (enumerator, cancellable, &err);
 
       /* break when end of enumerator is reached */
       if (G_UNLIKELY (info == NULL && err == NULL))
@@ -169,33 +293,36 @@ thunar_io_scan_directory (ThunarJob          *job,
             }
         }
 
-      /* check if we are scanning `recent:///` */
-      if (g_file_has_uri_scheme (file, "recent"))
+      if (return_thunar_files && is_mounted)
         {
-          /* create Gfile using the target URI */
-          child_file = g_file_new_for_uri (g_file_info_get_attribute_string (info, G_FILE_ATTRIBUTE_STANDARD_TARGET_URI));
-
-          /* create new file info using Gfile*/
-          recent_info = info;
-          info = g_file_query_info (child_file, namespace, flags, cancellable, &err);
-
-          if (G_UNLIKELY (info == NULL))
+          /* queue the info, the ThunarFiles are created in batches */
+          batch = g_list_prepend (batch, g_object_ref (info));
+          if (++n_batch >= SCAN_DIRECTORY_BATCH_SIZE)
             {
-              g_object_unref (recent_info);
-              break;
+              files = thunar_io_scan_directory_flush_batch (file, &batch, files);
+              n_batch = 0;
             }
+
+          child_file = NULL;
         }
       else
         {
           /* create GFile for the child */
           child_file = g_file_get_child (file, g_file_info_get_name (info));
-          recent_info = NULL;
         }
 
-      if (return_thunar_files)
+      if (child_file == NULL)
+        {
+          /* queued above */
+        }
+      else if (return_thunar_files)
         {
+          /* keep the list in enumeration order */
+          files = thunar_io_scan_directory_flush_batch (file, &batch, files);
+          n_batch = 0;
+
           /* Prepend the ThunarFile */
-          thunar_file = thunar_file_get_with_info (child_file, info, recent_info, !is_mounted);
+          thunar_file = thunar_file_get_with_info (child_file, info, NULL, !is_mounted);
           files = thunar_g_list_prepend_deep (files, thunar_file);
           g_object_unref (G_OBJECT (thunar_file));
         }
@@ -210,6 +337,15 @@ thunar_io_scan_directory (ThunarJob          *job,
           && is_mounted
           && g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
         {
+          if (child_file == NULL)
+            {
+              /* the children have to end up in front of their parent */
+              files = thunar_io_scan_directory_flush_batch (file, &batch, files);
+              n_batch = 0;
+
+              child_file = g_file_get_child (file, g_file_info_get_name (info));
+            }
+
           child_files = thunar_io_scan_directory (job, child_file, flags, recursively,
                                                   unlinking, return_thunar_files, n_files_max, &err);
 
@@ -218,12 +354,16 @@ thunar_io_scan_directory (ThunarJob          *job,
           files = g_list_concat (child_files, files);
         }
 
-      g_object_unref (child_file);
+      if (child_file != NULL)
+        g_object_unref (child_file);
       g_object_unref (info);
     }
 
+  /* create the ThunarFiles for the remaining queued infos */
+  files = thunar_io_scan_directory_flush_batch (file, &batch, files);
+
   /* release the enumerator */
-  g_object_unref (enumerator);
+  thunar_io_enumerator_free (enumerator);
 
   if (G_UNLIKELY (err != NULL))
     {
@@ -0,0 +1,199 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_SYS_TYPES_H
+#include <sys/types.h>
+#endif
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#include <glib/gstdio.h>
+#include <gio/gio.h>
+#ifdef HAVE_GIO_UNIX
+#include <gio/gunixmounts.h>
+#endif
+
+#include "thunar/thunar-io-trash.h"
+#include "thunar/thunar-private.h"
+
+
+
+/**
+ * SECTION:thunar-io-trash
+ * @Short_description: Locates the local trash folders
+ * @Title: ThunarIoTrash
+ *
+ * The trash of local volumes follows the layout of the freedesktop.org
+ * trash specification, with the trashed items in the "files" and their
+ * *.trashinfo files in the "info" folder of each trash folder. These
+ * helpers find the trash folders of the user, so that they can be
+ * queried and emptied without going through the GVfs trash:// backend.
+ */
+
+
+
+static gboolean
+thunar_io_trash_is_valid_dir (const gchar *path)
+{
+  struct stat statb;
+
+  /* the trash folder must be a real folder owned by the user */
+  return g_lstat (path, &statb) == 0
+         && S_ISDIR (statb.st_mode)
+         && statb.st_uid == getuid ();
+}
+
+
+
+#ifdef HAVE_GIO_UNIX
+static GList *
+thunar_io_trash_prepend_topdir (GList       *dirs,
+                                const gchar *mount_path)
+{
+  struct stat statb;
+  gchar      *path;
+  gchar      *name;
+
+  /* $topdir/.Trash/$uid, where $topdir/.Trash must have the sticky bit and must not be a link */
+  name = g_strdup_printf ("%u", (guint) getuid ());
+  path = g_build_filename (mount_path, ".Trash", NULL);
+  if (g_lstat (path, &statb) == 0 && S_ISDIR (statb.st_mode) && (statb.st_mode & S_ISVTX) != 0)
+    {
+      g_free (path);
+      path = g_build_filename (mount_path, ".Trash", name, NULL);
+      if (thunar_io_trash_is_valid_dir (path))
+        dirs = g_list_prepend (dirs, g_steal_pointer (&path));
+    }
+  g_free (path);
+  g_free (name);
+
+  /* $topdir/.Trash-$uid */
+  name = g_strdup_printf (".Trash-%u", (guint) getuid ());
+  path = g_build_filename (mount_path, name, NULL);
+  if (thunar_io_trash_is_valid_dir (path))
+    dirs = g_list_prepend (dirs, g_steal_pointer (&path));
+  g_free (path);
+  g_free (name);
+
+  return dirs;
+}
+#endif
+
+
+
+/**
+ * thunar_io_trash_get_home_dir:
+ *
+ * Returns the path of the home trash, $XDG_DATA_HOME/Trash, whether
+ * it does exist or not.
+ *
+ * The caller is responsible to free the returned string using g_free()
+ * when no longer needed.
+ *
+ * Return value: the path of the home trash folder.
+ **/
+gchar *
+thunar_io_trash_get_home_dir (void)
+{
+  return g_build_filename (g_get_user_data_dir (), "Trash", NULL);
+}
+
+
+
+/**
+ * thunar_io_trash_get_dirs:
+ *
+ * Collects the existing trash folders of the user, the home trash and
+ * those in the top folders of the mounted local volumes.
+ *
+ * The caller is responsible to free the returned list using
+ * g_list_free_full() with g_free().
+ *
+ * Return value: the list of trash folder paths.
+ **/
+GList *
+thunar_io_trash_get_dirs (void)
+{
+  GList *dirs = NULL;
+  gchar *path;
+#ifdef HAVE_GIO_UNIX
+  GList *mounts;
+  GList *lp;
+#endif
+
+  path = thunar_io_trash_get_home_dir ();
+  if (thunar_io_trash_is_valid_dir (path))
+    dirs = g_list_prepend (dirs, g_steal_pointer (&path));
+  g_free (path);
+
+#ifdef HAVE_GIO_UNIX
+  /* the same mounts GVfs looks at for its trash:// backend */
+  mounts = g_unix_mounts_get (NULL);
+  for (lp = mounts; lp != NULL; lp = lp->next)
+    {
+      if (!g_unix_mount_is_system_internal (lp->data))
+        dirs = thunar_io_trash_prepend_topdir (dirs, g_unix_mount_get_mount_path (lp->data));
+    }
+  g_list_free_full (mounts, (GDestroyNotify) g_unix_mount_free);
+#endif
+
+  return g_list_reverse (dirs);
+}
+
+
+
+/**
+ * thunar_io_trash_is_empty:
+ *
+ * Checks whether none of the trash folders of the user holds any
+ * trashed item, reading at most a single entry of each "files" folder.
+ *
+ * Return value: %TRUE if the trash is empty.
+ **/
+gboolean
+thunar_io_trash_is_empty (void)
+{
+  gboolean is_empty = TRUE;
+  GList   *dirs;
+  GList   *lp;
+  GDir    *dir;
+  gchar   *path;
+
+  dirs = thunar_io_trash_get_dirs ();
+  for (lp = dirs; is_empty && lp != NULL; lp = lp->next)
+    {
+      path = g_build_filename (lp->data, "files", NULL);
+      dir = g_dir_open (path, 0, NULL);
+      if (dir != NULL)
+        {
+          /* "." and ".." are never returned */
+          is_empty = (g_dir_read_name (dir) == NULL);
+          g_dir_close (dir);
+        }
+      g_free (path);
+    }
+  g_list_free_full (dirs, g_free);
+
+  return is_empty;
+}
@@ -0,0 +1,30 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __THUNAR_IO_TRASH_H__
+#define __THUNAR_IO_TRASH_H__
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+gchar   *thunar_io_trash_get_home_dir (void) G_GNUC_MALLOC;
+GList   *thunar_io_trash_get_dirs     (void) G_GNUC_MALLOC;
+gboolean thunar_io_trash_is_empty     (void);
+
+G_END_DECLS
+
+#endif /* !__THUNAR_IO_TRASH_H__ */
@@ -29,8 +29,13 @@
  * @Short_description: Manages the logging of job operations (copy, move etc.) and undoing and redoing them
  * @Title: ThunarJobOperationHistory
  *
- * The single #ThunarJobOperationHistory instance stores all job operations in a #GList
- * and manages tools to manage the list and the next/previous operations which can be undone/redone */
+ * The single #ThunarJobOperationHistory instance stores all job operations in a #GQueue
+ * and manages tools to manage the list and the next/previous operations which can be undone/redone.
+ * Besides the number of operations set in the preferences, the history is limited to
+ * THUNAR_JOB_OPERATION_HISTORY_MAX_SIZE bytes; the oldest operations are dropped first. */
+
+/* memory the locations of the operations in the history may use, the latest operation is always kept */
+#define THUNAR_JOB_OPERATION_HISTORY_MAX_SIZE (64 * 1024 * 1024)
 
 /* property identifiers */
 enum
@@ -53,9 +58,10 @@ struct _ThunarJobOperationHistory
 {
   GObject  __parent__;
 
-  /* List of job operations which were logged */
-  GList   *job_operation_list;
+  /* List of job operations which were logged, and the memory they use */
+  GQueue   job_operation_list;
   gint     job_operation_list_max_size;
+  gsize    job_operation_list_size;
 
   /* since the job operation list, lp_undo and lp_redo all refer to the same memory locations,
    * which may be accessed by different threads, we need to protect this memory with a mutex */
@@ -107,7 +113,8 @@ thunar_job_operation_history_init (ThunarJobOperationHistory *self)
 {
   ThunarPreferences *preferences;
 
-  self->job_operation_list = NULL;
+  g_queue_init (&self->job_operation_list);
+  self->job_operation_list_size = 0;
   self->lp_undo = NULL;
   self->lp_redo = NULL;
 
@@ -127,7 +134,7 @@ thunar_job_operation_history_finalize (GObject *object)
 
   _thunar_return_if_fail (THUNAR_IS_JOB_OPERATION_HISTORY (history));
 
-  g_list_free_full (history->job_operation_list, g_object_unref);
+  g_queue_clear_full (&history->job_operation_list, g_object_unref);
 
   g_mutex_clear (&history->job_operation_list_mutex);
 
@@ -202,7 +209,7 @@ thunar_job_operation_history_get_default (void)
 void
 thunar_job_operation_history_commit (ThunarJobOperation *job_operation)
 {
-  GList* new_list = NULL;
+  ThunarJobOperation *operation;
 
   _thunar_return_if_fail (THUNAR_IS_JOB_OPERATION (job_operation));
 
@@ -213,32 +220,39 @@ thunar_job_operation_history_commit (ThunarJobOperation *job_operation)
       thunar_job_operation_set_end_timestamp (job_operation, g_get_real_time () / (gint64) 1e6);
     }
 
+  /* no more files are added, drop the lookup tables */
+  thunar_job_operation_compact (job_operation);
+
   g_mutex_lock (&job_operation_history->job_operation_list_mutex);
 
   /* When a new operation is added, drop all previous operations which were undone from the list */
   if (job_operation_history->lp_redo != NULL)
     {
-      for (GList* lp = job_operation_history->job_operation_list;
-           lp != NULL && lp != job_operation_history->lp_redo;
-           lp = lp->next)
-        new_list = g_list_append (new_list, g_object_ref (lp->data));
-      g_list_free_full (job_operation_history->job_operation_list, g_object_unref);
-      job_operation_history->job_operation_list = new_list;
+      while (job_operation_history->job_operation_list.tail != job_operation_history->lp_undo)
+        {
+          operation = g_queue_pop_tail (&job_operation_history->job_operation_list);
+          job_operation_history->job_operation_list_size -= MIN (job_operation_history->job_operation_list_size, thunar_job_operation_get_size (operation));
+          g_object_unref (operation);
+        }
     }
 
   /* Add the new operation to our list */
-  job_operation_history->job_operation_list = g_list_append (job_operation_history->job_operation_list, g_object_ref (job_operation));
+  g_queue_push_tail (&job_operation_history->job_operation_list, g_object_ref (job_operation));
+  job_operation_history->job_operation_list_size += thunar_job_operation_get_size (job_operation);
 
   /* reset the undo pointer to latest operation and clear the redo pointer */
-  job_operation_history->lp_undo = g_list_last (job_operation_history->job_operation_list);
+  job_operation_history->lp_undo = job_operation_history->job_operation_list.tail;
   job_operation_history->lp_redo = NULL;
 
-  /* Limit the size of the list */
-  if (job_operation_history->job_operation_list_max_size != -1 && g_list_length (job_operation_history->job_operation_list) > (guint)(job_operation_history->job_operation_list_max_size))
+  /* Limit the number of operations and the memory they use, never dropping the new one */
+  while (job_operation_history->job_operation_list.length > 1
+         && ((job_operation_history->job_operation_list_max_size != -1
+              && job_operation_history->job_operation_list.length > (guint) job_operation_history->job_operation_list_max_size)
+             || job_operation_history->job_operation_list_size > THUNAR_JOB_OPERATION_HISTORY_MAX_SIZE))
     {
-      GList* first = g_list_first (job_operation_history->job_operation_list);
-      job_operation_history->job_operation_list = g_list_remove_link (job_operation_history->job_operation_list, first);
-      g_list_free_full (first, g_object_unref);
+      operation = g_queue_pop_head (&job_operation_history->job_operation_list);
+      job_operation_history->job_operation_list_size -= MIN (job_operation_history->job_operation_list_size, thunar_job_operation_get_size (operation));
+      g_object_unref (operation);
     }
 
   g_mutex_unlock (&job_operation_history->job_operation_list_mutex);
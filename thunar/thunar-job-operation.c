@@ -16,10 +16,13 @@
  * this program; if not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <string.h>
+
 #include "thunar/thunar-application.h"
 #include "thunar/thunar-io-jobs.h"
 #include "thunar/thunar-job-operation.h"
 #include "thunar/thunar-private.h"
+#include "thunar/thunar-renamer-executor.h"
 
 /**
  * SECTION:thunar-job-operation
@@ -29,23 +32,77 @@
  * The #ThunarJobOperation class represents a single 'job operation', a file operation like copying, moving
  * trashing, renaming etc. and its source/target locations.
  *
+ * The locations are kept in a tree of uri components shared by all files of the operation, so
+ * the folders common to many files are stored only once. The tree can be shared with the inverse
+ * operation, and the lookup table used while files are added is dropped by
+ * thunar_job_operation_compact() once the operation is complete.
  */
 
-static void                   thunar_job_operation_finalize           (GObject            *object);
-static gint                   thunar_job_operation_is_ancestor        (gconstpointer       descendant,
-                                                                       gconstpointer       ancestor);
-static void                   thunar_job_operation_restore_from_trash (ThunarJobOperation *operation,
-                                                                       GError            **error);
+/* number of tree nodes allocated at once */
+#define THUNAR_JOB_OPERATION_NODES_PER_BLOCK (256)
+
+/* the node was added as a source file */
+#define THUNAR_JOB_OPERATION_NODE_SOURCE     (1 << 0)
+
+
+
+typedef struct _ThunarJobOperationNode ThunarJobOperationNode;
+typedef struct _ThunarJobOperationTree ThunarJobOperationTree;
+
+
+
+static void                    thunar_job_operation_finalize           (GObject                *object);
+static ThunarJobOperationTree *thunar_job_operation_tree_new           (void);
+static ThunarJobOperationTree *thunar_job_operation_tree_ref           (ThunarJobOperationTree *tree);
+static void                    thunar_job_operation_tree_unref         (ThunarJobOperationTree *tree);
+static ThunarJobOperationNode *thunar_job_operation_tree_lookup        (ThunarJobOperationTree *tree,
+                                                                        GFile                  *file,
+                                                                        gboolean                create,
+                                                                        gboolean               *below_source);
+static gchar                  *thunar_job_operation_node_get_uri       (ThunarJobOperationNode *node);
+static GList                  *thunar_job_operation_get_files          (GPtrArray              *nodes);
+static void                    thunar_job_operation_restore_from_trash (ThunarJobOperation     *operation,
+                                                                        GError                **error);
+static void                    thunar_job_operation_rename_files       (GList                  *source_file_list,
+                                                                        GList                  *target_file_list);
+
+
+
+struct _ThunarJobOperationNode
+{
+  ThunarJobOperationNode *parent;
+  const gchar            *name;  /* one component of the uri, NULL for the root */
+  guint                   flags;
+};
+
+struct _ThunarJobOperationTree
+{
+  gint                    ref_count;
+
+  ThunarJobOperationNode  root;
+
+  /* nodes are allocated in blocks, so they never move */
+  GSList                 *blocks;
+  guint                   block_used;
+  guint                   n_nodes;
 
+  GStringChunk           *names;
+  gsize                   names_size;
 
+  /* set of nodes, for looking up the child of a node by name, NULL when not needed */
+  GHashTable             *children;
+};
 
 struct _ThunarJobOperation
 {
   GObject                 __parent__;
 
   ThunarJobOperationKind  operation_kind;
-  GList                  *source_file_list;
-  GList                  *target_file_list;
+
+  /* the source and target locations, as nodes of the tree */
+  ThunarJobOperationTree *tree;
+  GPtrArray              *sources;
+  GPtrArray              *targets;
 
   /* Files overwritten as a part of an operation */
   GList                  *overwritten_files;
@@ -77,8 +134,9 @@ static void
 thunar_job_operation_init (ThunarJobOperation *self)
 {
   self->operation_kind = THUNAR_JOB_OPERATION_KIND_COPY;
-  self->source_file_list = NULL;
-  self->target_file_list = NULL;
+  self->tree = NULL;
+  self->sources = g_ptr_array_new ();
+  self->targets = g_ptr_array_new ();
   self->overwritten_files = NULL;
 }
 
@@ -91,8 +149,10 @@ thunar_job_operation_finalize (GObject *object)
 
   op = THUNAR_JOB_OPERATION (object);
 
-  g_list_free_full (op->source_file_list, g_object_unref);
-  g_list_free_full (op->target_file_list, g_object_unref);
+  if (op->tree != NULL)
+    thunar_job_operation_tree_unref (op->tree);
+  g_ptr_array_unref (op->sources);
+  g_ptr_array_unref (op->targets);
   g_list_free_full (op->overwritten_files, g_object_unref);
 
   (*G_OBJECT_CLASS (thunar_job_operation_parent_class)->finalize) (object);
@@ -100,6 +160,202 @@ thunar_job_operation_finalize (GObject *object)
 
 
 
+static guint
+thunar_job_operation_node_hash (gconstpointer key)
+{
+  const ThunarJobOperationNode *node = key;
+
+  return g_direct_hash (node->parent) ^ g_str_hash (node->name);
+}
+
+
+
+static gboolean
+thunar_job_operation_node_equal (gconstpointer a,
+                                 gconstpointer b)
+{
+  const ThunarJobOperationNode *node_a = a;
+  const ThunarJobOperationNode *node_b = b;
+
+  return node_a->parent == node_b->parent && strcmp (node_a->name, node_b->name) == 0;
+}
+
+
+
+static ThunarJobOperationTree *
+thunar_job_operation_tree_new (void)
+{
+  ThunarJobOperationTree *tree;
+
+  tree = g_slice_new0 (ThunarJobOperationTree);
+  tree->ref_count = 1;
+  tree->names = g_string_chunk_new (4096);
+
+  return tree;
+}
+
+
+
+static ThunarJobOperationTree *
+thunar_job_operation_tree_ref (ThunarJobOperationTree *tree)
+{
+  g_atomic_int_inc (&tree->ref_count);
+  return tree;
+}
+
+
+
+static void
+thunar_job_operation_tree_unref (ThunarJobOperationTree *tree)
+{
+  if (!g_atomic_int_dec_and_test (&tree->ref_count))
+    return;
+
+  if (tree->children != NULL)
+    g_hash_table_destroy (tree->children);
+  g_slist_free_full (tree->blocks, g_free);
+  g_string_chunk_free (tree->names);
+  g_slice_free (ThunarJobOperationTree, tree);
+}
+
+
+
+static ThunarJobOperationNode *
+thunar_job_operation_tree_new_node (ThunarJobOperationTree *tree,
+                                    ThunarJobOperationNode *parent,
+                                    const gchar            *name)
+{
+  ThunarJobOperationNode *node;
+  gsize                   length = strlen (name) + 1;
+
+  if (tree->blocks == NULL || tree->block_used == THUNAR_JOB_OPERATION_NODES_PER_BLOCK)
+    {
+      tree->blocks = g_slist_prepend (tree->blocks, g_new (ThunarJobOperationNode, THUNAR_JOB_OPERATION_NODES_PER_BLOCK));
+      tree->block_used = 0;
+    }
+
+  node = (ThunarJobOperationNode *) tree->blocks->data + tree->block_used++;
+  node->parent = parent;
+  node->name = g_string_chunk_insert_len (tree->names, name, length - 1);
+  node->flags = 0;
+
+  tree->n_nodes++;
+  tree->names_size += length;
+
+  return node;
+}
+
+
+
+static ThunarJobOperationNode *
+thunar_job_operation_tree_lookup (ThunarJobOperationTree *tree,
+                                  GFile                  *file,
+                                  gboolean                create,
+                                  gboolean               *below_source)
+{
+  ThunarJobOperationNode *node = &tree->root;
+  ThunarJobOperationNode *child;
+  ThunarJobOperationNode  probe;
+  GSList                 *lp;
+  gchar                  *uri;
+  gchar                  *component;
+  gchar                  *slash;
+  guint                   n;
+  guint                   n_used;
+
+  /* (re)build the lookup table of a compacted tree */
+  if (G_UNLIKELY (tree->children == NULL))
+    {
+      tree->children = g_hash_table_new (thunar_job_operation_node_hash, thunar_job_operation_node_equal);
+      for (lp = tree->blocks, n_used = tree->block_used; lp != NULL; lp = lp->next, n_used = THUNAR_JOB_OPERATION_NODES_PER_BLOCK)
+        for (n = 0; n < n_used; n++)
+          g_hash_table_add (tree->children, (ThunarJobOperationNode *) lp->data + n);
+    }
+
+  if (below_source != NULL)
+    *below_source = FALSE;
+
+  /* walk the components of the uri, splitting at each slash */
+  uri = g_file_get_uri (file);
+  for (component = uri; node != NULL; component = slash + 1)
+    {
+      /* only the ancestors count, re-adding a source is fine */
+      if (below_source != NULL && (node->flags & THUNAR_JOB_OPERATION_NODE_SOURCE) != 0)
+        *below_source = TRUE;
+
+      slash = strchr (component, '/');
+      if (slash != NULL)
+        *slash = '\0';
+
+      probe.parent = node;
+      probe.name = component;
+      child = g_hash_table_lookup (tree->children, &probe);
+      if (child == NULL && create)
+        {
+          child = thunar_job_operation_tree_new_node (tree, node, component);
+          g_hash_table_add (tree->children, child);
+        }
+
+      node = child;
+      if (slash == NULL)
+        break;
+    }
+  g_free (uri);
+
+  return node;
+}
+
+
+
+static gchar *
+thunar_job_operation_node_get_uri (ThunarJobOperationNode *node)
+{
+  ThunarJobOperationNode *np;
+  gchar                  *uri;
+  gchar                  *p;
+  gsize                   length = 0;
+  gsize                   n;
+
+  for (np = node; np->parent != NULL; np = np->parent)
+    length += strlen (np->name) + 1;
+
+  /* fill in the components back to front, separated by slashes */
+  uri = g_malloc (length);
+  p = uri + length - 1;
+  *p = '\0';
+  for (np = node; np->parent != NULL; np = np->parent)
+    {
+      n = strlen (np->name);
+      p -= n;
+      memcpy (p, np->name, n);
+      if (np->parent->parent != NULL)
+        *(--p) = '/';
+    }
+
+  return uri;
+}
+
+
+
+static GList *
+thunar_job_operation_get_files (GPtrArray *nodes)
+{
+  GList *files = NULL;
+  gchar *uri;
+  guint  n;
+
+  for (n = nodes->len; n > 0; n--)
+    {
+      uri = thunar_job_operation_node_get_uri (g_ptr_array_index (nodes, n - 1));
+      files = g_list_prepend (files, g_file_new_for_uri (uri));
+      g_free (uri);
+    }
+
+  return files;
+}
+
+
+
 /**
  * thunar_job_operation_new:
  * @kind: The kind of operation being created.
@@ -137,26 +393,91 @@ thunar_job_operation_add (ThunarJobOperation *job_operation,
                           GFile              *source_file,
                           GFile              *target_file)
 {
+  ThunarJobOperationNode *node;
+  gboolean                below_source = FALSE;
 
   _thunar_return_if_fail (THUNAR_IS_JOB_OPERATION (job_operation));
   _thunar_return_if_fail (source_file == NULL || G_IS_FILE (source_file));
   _thunar_return_if_fail (target_file == NULL || G_IS_FILE (target_file));
 
+  if (job_operation->tree == NULL)
+    job_operation->tree = thunar_job_operation_tree_new ();
+
   /* When a directory has a file operation applied to it (for e.g. deletion),
    * the operation will also automatically get applied to its descendants.
    * If the descendant of a that directory is then found, it will try to apply the operation
    * to it again then, meaning the operation is attempted multiple times on the same file.
    *
    * So to avoid such issues on executing a job operation, if the source file is
-   * a descendant of an existing file, do not add it to the job operation. */
-  if (g_list_find_custom (job_operation->source_file_list, source_file, thunar_job_operation_is_ancestor) != NULL)
-    return;
-
-  /* Don't add NULL files to the list, since it causes memory management issues on object destruction */
+   * a descendant of an existing file, do not add it to the job operation. The nodes
+   * of the ancestors are marked, so this only walks the path of the file. */
   if (source_file != NULL)
-    job_operation->source_file_list = g_list_append (job_operation->source_file_list, g_object_ref (source_file));
+    {
+      thunar_job_operation_tree_lookup (job_operation->tree, source_file, FALSE, &below_source);
+      if (below_source)
+        return;
+
+      node = thunar_job_operation_tree_lookup (job_operation->tree, source_file, TRUE, NULL);
+      node->flags |= THUNAR_JOB_OPERATION_NODE_SOURCE;
+      g_ptr_array_add (job_operation->sources, node);
+    }
+
   if (target_file != NULL)
-    job_operation->target_file_list = g_list_append (job_operation->target_file_list, g_object_ref (target_file));
+    g_ptr_array_add (job_operation->targets, thunar_job_operation_tree_lookup (job_operation->tree, target_file, TRUE, NULL));
+}
+
+
+
+/**
+ * thunar_job_operation_compact:
+ * @job_operation: a #ThunarJobOperation
+ *
+ * Releases the memory only needed while files are added to @job_operation.
+ * Files can still be added afterwards, at a higher cost.
+ **/
+void
+thunar_job_operation_compact (ThunarJobOperation *job_operation)
+{
+  _thunar_return_if_fail (THUNAR_IS_JOB_OPERATION (job_operation));
+
+  if (job_operation->tree != NULL && job_operation->tree->children != NULL)
+    {
+      g_hash_table_destroy (job_operation->tree->children);
+      job_operation->tree->children = NULL;
+    }
+}
+
+
+
+/**
+ * thunar_job_operation_get_size:
+ * @job_operation: a #ThunarJobOperation
+ *
+ * Estimates the memory used to store the locations of @job_operation.
+ * A tree shared with another operation is counted for both.
+ *
+ * Return value: the size in bytes.
+ **/
+gsize
+thunar_job_operation_get_size (ThunarJobOperation *job_operation)
+{
+  gsize size;
+
+  _thunar_return_val_if_fail (THUNAR_IS_JOB_OPERATION (job_operation), 0);
+
+  size = sizeof (ThunarJobOperation);
+  size += (job_operation->sources->len + job_operation->targets->len) * sizeof (gpointer);
+  size += g_list_length (job_operation->overwritten_files) * (sizeof (GList) + 128);
+
+  if (job_operation->tree != NULL)
+    {
+      size += sizeof (ThunarJobOperationTree) + job_operation->tree->names_size;
+      size += job_operation->tree->n_nodes * sizeof (ThunarJobOperationNode);
+      if (job_operation->tree->children != NULL)
+        size += job_operation->tree->n_nodes * 2 * sizeof (gpointer);
+    }
+
+  return size;
 }
 
 
@@ -275,7 +596,7 @@ thunar_job_operation_empty (ThunarJobOperation *job_operation)
 {
   _thunar_return_val_if_fail (THUNAR_IS_JOB_OPERATION (job_operation), TRUE);
 
-  if (job_operation->source_file_list == NULL && job_operation->target_file_list == NULL)
+  if (job_operation->sources->len == 0 && job_operation->targets->len == 0)
     return TRUE;
 
   return FALSE;
@@ -319,48 +640,48 @@ thunar_job_operation_new_invert (ThunarJobOperation *job_operation)
 
   _thunar_return_val_if_fail (THUNAR_IS_JOB_OPERATION (job_operation), NULL);
 
+  inverted_operation = g_object_new (THUNAR_TYPE_JOB_OPERATION, NULL);
+
+  /* the inverse refers to the same locations */
+  if (job_operation->tree != NULL)
+    inverted_operation->tree = thunar_job_operation_tree_ref (job_operation->tree);
+
   switch (job_operation->operation_kind)
     {
       case THUNAR_JOB_OPERATION_KIND_COPY:
-        inverted_operation = g_object_new (THUNAR_TYPE_JOB_OPERATION, NULL);
         inverted_operation->operation_kind = THUNAR_JOB_OPERATION_KIND_DELETE;
-        inverted_operation->source_file_list = thunar_g_list_copy_deep (job_operation->target_file_list);
+        g_ptr_array_extend (inverted_operation->sources, job_operation->targets, NULL, NULL);
         break;
 
       case THUNAR_JOB_OPERATION_KIND_MOVE:
-        inverted_operation = g_object_new (THUNAR_TYPE_JOB_OPERATION, NULL);
         inverted_operation->operation_kind = THUNAR_JOB_OPERATION_KIND_MOVE;
-        inverted_operation->source_file_list = thunar_g_list_copy_deep (job_operation->target_file_list);
-        inverted_operation->target_file_list = thunar_g_list_copy_deep (job_operation->source_file_list);
+        g_ptr_array_extend (inverted_operation->sources, job_operation->targets, NULL, NULL);
+        g_ptr_array_extend (inverted_operation->targets, job_operation->sources, NULL, NULL);
         break;
 
       case THUNAR_JOB_OPERATION_KIND_RENAME:
-        inverted_operation = g_object_new (THUNAR_TYPE_JOB_OPERATION, NULL);
         inverted_operation->operation_kind = THUNAR_JOB_OPERATION_KIND_RENAME;
-        inverted_operation->source_file_list = thunar_g_list_copy_deep (job_operation->target_file_list);
-        inverted_operation->target_file_list = thunar_g_list_copy_deep (job_operation->source_file_list);
+        g_ptr_array_extend (inverted_operation->sources, job_operation->targets, NULL, NULL);
+        g_ptr_array_extend (inverted_operation->targets, job_operation->sources, NULL, NULL);
         break;
 
       case THUNAR_JOB_OPERATION_KIND_TRASH:
-        inverted_operation = g_object_new (THUNAR_TYPE_JOB_OPERATION, NULL);
         inverted_operation->operation_kind = THUNAR_JOB_OPERATION_KIND_RESTORE;
-        inverted_operation->target_file_list = thunar_g_list_copy_deep (job_operation->source_file_list);
+        g_ptr_array_extend (inverted_operation->targets, job_operation->sources, NULL, NULL);
         inverted_operation->start_timestamp = job_operation->start_timestamp;
         inverted_operation->end_timestamp = job_operation->end_timestamp;
         break;
 
       case THUNAR_JOB_OPERATION_KIND_CREATE_FILE:
       case THUNAR_JOB_OPERATION_KIND_CREATE_FOLDER:
-        inverted_operation = g_object_new (THUNAR_TYPE_JOB_OPERATION, NULL);
         inverted_operation->operation_kind = THUNAR_JOB_OPERATION_KIND_DELETE;
-        inverted_operation->source_file_list = thunar_g_list_copy_deep (job_operation->target_file_list);
+        g_ptr_array_extend (inverted_operation->sources, job_operation->targets, NULL, NULL);
         break;
 
       case THUNAR_JOB_OPERATION_KIND_LINK:
-        inverted_operation = g_object_new (THUNAR_TYPE_JOB_OPERATION, NULL);
         inverted_operation->operation_kind = THUNAR_JOB_OPERATION_KIND_UNLINK;
-        inverted_operation->source_file_list = thunar_g_list_copy_deep (job_operation->target_file_list);
-        inverted_operation->target_file_list = thunar_g_list_copy_deep (job_operation->source_file_list);
+        g_ptr_array_extend (inverted_operation->sources, job_operation->targets, NULL, NULL);
+        g_ptr_array_extend (inverted_operation->targets, job_operation->sources, NULL, NULL);
         break;
 
       default:
@@ -373,7 +694,60 @@ thunar_job_operation_new_invert (ThunarJobOperation *job_operation)
 
 
 
-/* thunar_job_operation_execute:
+static void
+thunar_job_operation_rename_failed (ThunarRenamerExecutor *executor,
+                                    ThunarFile            *file,
+                                    const gchar           *name,
+                                    GError                *error,
+                                    gpointer               user_data)
+{
+  g_warning ("Error while renaming files: %s\n", error->message);
+}
+
+
+
+static void
+thunar_job_operation_rename_files (GList *source_file_list,
+                                   GList *target_file_list)
+{
+  ThunarRenamerExecutor *executor;
+  ThunarFile            *thunar_file;
+  GList                 *pairs = NULL;
+  GError                *err = NULL;
+  gchar                 *display_name;
+
+  for (GList *slp = source_file_list, *tlp = target_file_list;
+       slp != NULL && tlp != NULL;
+       slp = slp->next, tlp = tlp->next)
+    {
+      thunar_file = thunar_file_get (slp->data, &err);
+      if (thunar_file == NULL)
+        {
+          if (err != NULL)
+            g_warning ("Error while renaming files: %s\n", err->message);
+          g_clear_error (&err);
+          continue;
+        }
+
+      display_name = thunar_g_file_get_display_name (tlp->data);
+      pairs = g_list_prepend (pairs, thunar_renamer_pair_new (thunar_file, display_name));
+      g_free (display_name);
+      g_object_unref (thunar_file);
+    }
+
+  /* the executor keeps itself alive until all files are renamed */
+  executor = thunar_renamer_executor_new (pairs);
+  g_signal_connect (G_OBJECT (executor), "failed", G_CALLBACK (thunar_job_operation_rename_failed), NULL);
+  thunar_renamer_executor_start (executor);
+  g_object_unref (executor);
+
+  thunar_renamer_pair_list_free (pairs);
+}
+
+
+
+/**
+ * thunar_job_operation_execute:
  * @job_operation: a #ThunarJobOperation
  * @error: A #GError to propagate any errors encountered.
  *
@@ -394,16 +768,25 @@ thunar_job_operation_execute (ThunarJobOperation *job_operation,
   gchar             *display_name;
   GFile             *template_file;
   gboolean           operation_canceled = FALSE;
+  GList             *source_file_list;
+  GList             *target_file_list;
+  GHashTable        *parent_dirs;
+  GList             *parent_dir_list;
+  GList             *link_list;
 
   _thunar_return_val_if_fail (THUNAR_IS_JOB_OPERATION (job_operation), FALSE);
 
   application = thunar_application_get ();
 
+  /* the GFiles only exist while the operation runs */
+  source_file_list = thunar_job_operation_get_files (job_operation->sources);
+  target_file_list = thunar_job_operation_get_files (job_operation->targets);
+
   switch (job_operation->operation_kind)
     {
       case THUNAR_JOB_OPERATION_KIND_DELETE:
       case THUNAR_JOB_OPERATION_KIND_UNLINK:
-        for (GList *lp = job_operation->source_file_list; lp != NULL; lp = lp->next)
+        for (GList *lp = source_file_list; lp != NULL; lp = lp->next)
           {
             if (!G_IS_FILE (lp->data))
               {
@@ -425,8 +808,9 @@ thunar_job_operation_execute (ThunarJobOperation *job_operation,
                 continue;
               }
 
-            thunar_file_list = g_list_append (thunar_file_list, thunar_file);
+            thunar_file_list = g_list_prepend (thunar_file_list, thunar_file);
           }
+        thunar_file_list = g_list_reverse (thunar_file_list);
 
         if (thunar_file_list == NULL)
           {
@@ -443,12 +827,16 @@ thunar_job_operation_execute (ThunarJobOperation *job_operation,
         break;
 
       case THUNAR_JOB_OPERATION_KIND_MOVE:
-        /* ensure that all the targets have parent directories which exist */
-        for (GList *lp = job_operation->target_file_list; lp != NULL; lp = lp->next)
+        /* ensure that all the targets have parent directories which exist,
+         * checking each directory only once */
+        parent_dirs = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal, g_object_unref, NULL);
+        for (GList *lp = target_file_list; lp != NULL; lp = lp->next)
           {
             parent_dir = g_file_get_parent (lp->data);
+            if (parent_dir == NULL || !g_hash_table_add (parent_dirs, parent_dir))
+              continue;
+
             g_file_make_directory_with_parents (parent_dir, NULL, &err);
-            g_object_unref (parent_dir);
 
             if (err != NULL)
             {
@@ -464,18 +852,31 @@ thunar_job_operation_execute (ThunarJobOperation *job_operation,
                          "Aborting operation\n",
                          err->message);
               g_propagate_error (error, err);
+              g_hash_table_unref (parent_dirs);
+              thunar_g_list_free_full (source_file_list);
+              thunar_g_list_free_full (target_file_list);
               g_object_unref (application);
               return operation_canceled;
             }
           }
+        g_hash_table_unref (parent_dirs);
 
+        /* all files are moved back by a single job */
         thunar_application_move_files (application, NULL,
-                                       job_operation->source_file_list, job_operation->target_file_list,
+                                       source_file_list, target_file_list,
                                        THUNAR_OPERATION_LOG_NO_OPERATIONS, NULL);
         break;
 
       case THUNAR_JOB_OPERATION_KIND_RENAME:
-        for (GList *slp = job_operation->source_file_list, *tlp = job_operation->target_file_list;
+        /* the files of a bulk rename may take over each other's names, let the
+         * executor order the renames, and break cycles */
+        if (source_file_list != NULL && source_file_list->next != NULL)
+          {
+            thunar_job_operation_rename_files (source_file_list, target_file_list);
+            break;
+          }
+
+        for (GList *slp = source_file_list, *tlp = target_file_list;
              slp != NULL && tlp != NULL;
              slp = slp->next, tlp = tlp->next)
           {
@@ -514,23 +915,23 @@ thunar_job_operation_execute (ThunarJobOperation *job_operation,
 
       case THUNAR_JOB_OPERATION_KIND_COPY:
         thunar_application_copy_to (application, NULL,
-                                   job_operation->source_file_list, job_operation->target_file_list,
+                                   source_file_list, target_file_list,
                                    THUNAR_OPERATION_LOG_NO_OPERATIONS, NULL);
         break;
 
       case THUNAR_JOB_OPERATION_KIND_CREATE_FILE:
         template_file = NULL;
-        if (job_operation->source_file_list != NULL)
-          template_file = job_operation->source_file_list->data;
+        if (source_file_list != NULL)
+          template_file = source_file_list->data;
         thunar_application_creat (application, NULL,
-                                  job_operation->target_file_list,
+                                  target_file_list,
                                   template_file,
                                   NULL, THUNAR_OPERATION_LOG_NO_OPERATIONS);
         break;
 
       case THUNAR_JOB_OPERATION_KIND_CREATE_FOLDER:
         thunar_application_mkdir (application, NULL,
-                                  job_operation->target_file_list,
+                                  target_file_list,
                                   NULL,  THUNAR_OPERATION_LOG_NO_OPERATIONS);
         break;
 
@@ -539,19 +940,41 @@ thunar_job_operation_execute (ThunarJobOperation *job_operation,
         /* Since we as well need to update the timestamps, we have to use THUNAR_OPERATION_LOG_ONLY_TIMESTAMPS */
         /* 'thunar_job_operation_history_update_trash_timestamps' will then take care on update the existing job operation instead of adding a new one */
         thunar_application_trash (application, NULL,
-                                  job_operation->source_file_list,
+                                  source_file_list,
                                   THUNAR_OPERATION_LOG_ONLY_TIMESTAMPS);
         break;
 
       case THUNAR_JOB_OPERATION_KIND_LINK:
-        for (GList* target_file = job_operation->target_file_list; target_file != NULL; target_file = target_file->next)
+        /* launch one job per target directory, linking the sources whose links were created there */
+        parent_dirs = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal, g_object_unref, NULL);
+        parent_dir_list = NULL;
+        for (GList *slp = source_file_list, *tlp = target_file_list;
+             slp != NULL && tlp != NULL;
+             slp = slp->next, tlp = tlp->next)
           {
-            GFile* target_folder = g_file_get_parent (target_file->data);
+            parent_dir = g_file_get_parent (tlp->data);
+            if (parent_dir == NULL)
+              continue;
+
+            link_list = g_hash_table_lookup (parent_dirs, parent_dir);
+            if (link_list == NULL)
+              parent_dir_list = g_list_prepend (parent_dir_list, g_object_ref (parent_dir));
+
+            /* the lists are built back to front, and reversed below */
+            g_hash_table_insert (parent_dirs, parent_dir, g_list_prepend (link_list, slp->data));
+          }
+
+        parent_dir_list = g_list_reverse (parent_dir_list);
+        for (GList *lp = parent_dir_list; lp != NULL; lp = lp->next)
+          {
+            link_list = g_list_reverse (g_hash_table_lookup (parent_dirs, lp->data));
             thunar_application_link_into (application, NULL,
-                                          job_operation->source_file_list, target_folder,
+                                          link_list, lp->data,
                                           THUNAR_OPERATION_LOG_NO_OPERATIONS, NULL);
-            g_object_unref (target_folder);
+            g_list_free (link_list);
           }
+        g_hash_table_unref (parent_dirs);
+        g_list_free_full (parent_dir_list, g_object_unref);
         break;
 
       default:
@@ -559,33 +982,14 @@ thunar_job_operation_execute (ThunarJobOperation *job_operation,
         break;
     }
 
+  thunar_g_list_free_full (source_file_list);
+  thunar_g_list_free_full (target_file_list);
   g_object_unref (application);
   return operation_canceled;
 }
 
 
 
-/* thunar_job_operation_is_ancestor:
- * @ancestor:     potential ancestor of @descendant. A #GFile
- * @descendant:   potential descendant of @ancestor. A #GFile
- *
- * Helper function for #g_list_find_custom.
- *
- * Return value: %0 if @ancestor is actually the ancestor of @descendant,
- *               %1 otherwise
- **/
-static gint
-thunar_job_operation_is_ancestor (gconstpointer ancestor,
-                                  gconstpointer descendant)
-{
-  if (thunar_g_file_is_descendant (G_FILE (descendant), G_FILE (ancestor)))
-    return 0;
-  else
-    return 1;
-}
-
-
-
 /* thunar_job_operation_compare:
  * @operation1: First operation for comparison
  * @operation2: Second operation for comparison
@@ -596,34 +1000,58 @@ thunar_job_operation_is_ancestor (gconstpointer ancestor,
  * Return value: %0 if both operations match
  *               %1 otherwise
  **/
+static gboolean
+thunar_job_operation_nodes_equal (GPtrArray *nodes1,
+                                  GPtrArray *nodes2,
+                                  gboolean   same_tree)
+{
+  gchar    *uri1;
+  gchar    *uri2;
+  gboolean  equal;
+
+  if (nodes1->len != nodes2->len)
+    return FALSE;
+
+  for (guint n = 0; n < nodes1->len; n++)
+    {
+      /* nodes of the same tree are unique per location */
+      if (same_tree)
+        {
+          if (g_ptr_array_index (nodes1, n) != g_ptr_array_index (nodes2, n))
+            return FALSE;
+          continue;
+        }
+
+      uri1 = thunar_job_operation_node_get_uri (g_ptr_array_index (nodes1, n));
+      uri2 = thunar_job_operation_node_get_uri (g_ptr_array_index (nodes2, n));
+      equal = (strcmp (uri1, uri2) == 0);
+      g_free (uri1);
+      g_free (uri2);
+
+      if (!equal)
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+
+
 gint
 thunar_job_operation_compare (ThunarJobOperation *operation1,
                               ThunarJobOperation *operation2)
 {
+  gboolean same_tree = (operation1->tree == operation2->tree);
+
   if (operation1->operation_kind != operation2->operation_kind)
     return 1;
 
-  if (g_list_length (operation1->source_file_list) != g_list_length (operation2->source_file_list))
+  if (!thunar_job_operation_nodes_equal (operation1->sources, operation2->sources, same_tree))
     return 1;
 
-  if (g_list_length (operation1->target_file_list) != g_list_length (operation2->target_file_list))
+  if (!thunar_job_operation_nodes_equal (operation1->targets, operation2->targets, same_tree))
     return 1;
 
-  for (GList *lp1 = operation1->source_file_list, *lp2 = operation2->source_file_list;
-      lp1 != NULL && lp2 != NULL;
-      lp1 = lp1->next, lp2 = lp2->next)
-    {
-      if (!g_file_equal (lp1->data,lp2->data))
-        return 1;
-    }
-
-  for (GList *lp1 =operation1->target_file_list, *lp2 = operation2->target_file_list;
-      lp1 != NULL && lp2 != NULL;
-      lp1 = lp1->next, lp2 = lp2->next)
-    {
-      if (!g_file_equal (lp1->data,lp2->data))
-        return 1;
-    }
   return 0;
 }
 
@@ -642,18 +1070,20 @@ thunar_job_operation_restore_from_trash (ThunarJobOperation  *operation,
   GFileEnumerator   *enumerator;
   GFileInfo         *info;
   GFile             *trash;
-  GFile             *trashed_file;
   GFile             *original_file;
+  GFile             *parent;
+  GFile             *parent_resolved;
   const char        *original_path;
   GDateTime         *date;
   GError            *err = NULL;
   gint64             deletion_time;
-  gpointer           lookup;
   GHashTable        *files_trashed;
+  GHashTable        *parents_resolved;
   ThunarApplication *application;
   GList             *source_file_list = NULL;
   GList             *target_file_list = NULL;
-
+  GList             *trashed_file_list;
+  gchar             *basename;
 
   /* enumerate over the files in the trash */
   trash = g_file_new_for_uri ("trash:///");
@@ -667,7 +1097,6 @@ thunar_job_operation_restore_from_trash (ThunarJobOperation  *operation,
   if (err != NULL)
     {
       g_object_unref (trash);
-      g_object_unref (enumerator);
 
       g_propagate_error (error, err);
       return;
@@ -676,81 +1105,103 @@ thunar_job_operation_restore_from_trash (ThunarJobOperation  *operation,
   /* set up a hash table for the files we deleted */
   files_trashed = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal, g_object_unref, NULL);
 
+  /* the trashed files usually share a few parent directories, resolve each of them once */
+  parents_resolved = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal, g_object_unref, g_object_unref);
+
   /* add all the files that were deleted in the hash table so we can check if a file
    * was deleted as a part of this operation or not in constant time. */
-  for (GList *lp = operation->target_file_list; lp != NULL; lp = lp->next)
-  {
-    GFile *parent = g_file_get_parent (lp->data);
-    gchar *real_path = NULL;
-    
-    /* Try to resolve symlinks, otherwise Gfiles wont match */
-    /* (All files located in trash have symlinks resolved) */
-    if (parent != NULL)
-      {
-        GFile *parent_resolved = NULL;
-        gchar *basename = g_file_get_basename (lp->data);
-        parent_resolved = thunar_g_file_resolve_symlink (parent);
-        g_object_unref (parent);
-        if (parent_resolved != NULL && basename != NULL)
-          real_path = g_build_filename (g_file_get_path (parent_resolved), basename, NULL);
-        g_free (basename);
-        g_object_unref (parent_resolved);
-      }
-
-    if (real_path != NULL)
-      g_hash_table_add (files_trashed, g_file_new_for_path (real_path));
-    else
-      g_hash_table_add (files_trashed, g_object_ref (lp->data));
-    g_free (real_path);
-  }
-
-  /* iterate over the files in the trash, adding them to source and target lists of
-   * the files which are to be restored and their original paths */
-  for (info = g_file_enumerator_next_file (enumerator, NULL, &err); info != NULL; info = g_file_enumerator_next_file (enumerator, NULL, &err))
+  trashed_file_list = thunar_job_operation_get_files (operation->targets);
+  for (GList *lp = trashed_file_list; lp != NULL; lp = lp->next)
     {
-      if (err != NULL)
+      /* Try to resolve symlinks, otherwise Gfiles wont match */
+      /* (All files located in trash have symlinks resolved) */
+      parent = g_file_get_parent (lp->data);
+      if (parent != NULL)
         {
-          g_object_unref (trash);
-          g_object_unref (enumerator);
-          g_hash_table_unref (files_trashed);
-          g_object_unref (info);
+          parent_resolved = g_hash_table_lookup (parents_resolved, parent);
+          if (parent_resolved == NULL)
+            {
+              parent_resolved = thunar_g_file_resolve_symlink (parent);
+              if (parent_resolved == NULL)
+                parent_resolved = g_object_ref (parent);
+              g_hash_table_insert (parents_resolved, g_object_ref (parent), parent_resolved);
+            }
+          g_object_unref (parent);
 
-          g_propagate_error (error, err);
-          return;
+          basename = g_file_get_basename (lp->data);
+          g_hash_table_add (files_trashed, g_file_get_child (parent_resolved, basename));
+          g_free (basename);
         }
+      else
+        {
+          g_hash_table_add (files_trashed, g_object_ref (lp->data));
+        }
+    }
+  thunar_g_list_free_full (trashed_file_list);
+  g_hash_table_unref (parents_resolved);
+
+  /* iterate over the files in the trash once, adding them to source and target lists of
+   * the files which are to be restored and their original paths */
+  while (g_hash_table_size (files_trashed) > 0)
+    {
+      info = g_file_enumerator_next_file (enumerator, NULL, &err);
+      if (info == NULL)
+        break;
 
       /* get the original path of the file before deletion */
       original_path = g_file_info_get_attribute_byte_string (info, G_FILE_ATTRIBUTE_TRASH_ORIG_PATH);
-      original_file = g_file_new_for_path (original_path);
+      date = g_file_info_get_deletion_date (info);
+      if (original_path == NULL || date == NULL)
+        {
+          if (date != NULL)
+            g_date_time_unref (date);
+          g_object_unref (info);
+          continue;
+        }
 
       /* get the deletion date reported by the file */
-      date = g_file_info_get_deletion_date (info);
       deletion_time = g_date_time_to_unix (date);
       g_date_time_unref (date);
 
-      /* see if we deleted the file in this session */
-      lookup = g_hash_table_lookup (files_trashed, original_file);
-
       /* if we deleted the file in this session, and the current file we're looking at was deleted
-       * during the time the operation occurred, we conclude we found the right file */
-      if (lookup != NULL && operation->start_timestamp <= deletion_time && deletion_time <= operation->end_timestamp)
+       * during the time the operation occurred, we conclude we found the right file. Each file
+       * is restored once, so the scan stops as soon as all of them were found */
+      if (operation->start_timestamp <= deletion_time && deletion_time <= operation->end_timestamp)
         {
-          trashed_file = g_file_get_child (trash, g_file_info_get_name (info));
-
-          source_file_list = thunar_g_list_append_deep (source_file_list, trashed_file);
-          target_file_list = thunar_g_list_append_deep (target_file_list, original_file);
-
+          original_file = g_file_new_for_path (original_path);
+          if (g_hash_table_remove (files_trashed, original_file))
+            {
+              source_file_list = g_list_prepend (source_file_list, g_file_get_child (trash, g_file_info_get_name (info)));
+              target_file_list = g_list_prepend (target_file_list, original_file);
+            }
+          else
+            {
+              g_object_unref (original_file);
+            }
         }
 
-      g_object_unref (original_file);
+      g_object_unref (info);
     }
 
   g_object_unref (trash);
   g_object_unref (enumerator);
+  g_hash_table_unref (files_trashed);
+
+  if (err != NULL)
+    {
+      thunar_g_list_free_full (source_file_list);
+      thunar_g_list_free_full (target_file_list);
+
+      g_propagate_error (error, err);
+      return;
+    }
 
   if (source_file_list != NULL && target_file_list != NULL)
     {
-      /* restore the lists asynchronously using a move operation */
+      source_file_list = g_list_reverse (source_file_list);
+      target_file_list = g_list_reverse (target_file_list);
+
+      /* restore all files asynchronously using a single move operation */
       application = thunar_application_get ();
       thunar_application_move_files (application, NULL, source_file_list, target_file_list, THUNAR_OPERATION_LOG_NO_OPERATIONS, NULL);
       g_object_unref (application);
@@ -758,8 +1209,6 @@ thunar_job_operation_restore_from_trash (ThunarJobOperation  *operation,
       thunar_g_list_free_full (source_file_list);
       thunar_g_list_free_full (target_file_list);
     }
-
-  g_hash_table_unref (files_trashed);
 }
 
 
@@ -775,6 +1224,6 @@ thunar_job_operation_restore_from_trash (ThunarJobOperation  *operation,
 gchar*
 thunar_job_operation_get_action_text (ThunarJobOperation *job_operation)
 {
-  guint  files_count = job_operation->source_file_list == NULL ? 0 : g_list_length (job_operation->source_file_list);
+  guint  files_count = job_operation->sources->len;
   return g_strdup_printf (ngettext ("%d file", "%d files", files_count), files_count);
 }
@@ -31,6 +31,8 @@ ThunarJobOperation     *thunar_job_operation_new                   (ThunarJobOpe
 void                    thunar_job_operation_add                   (ThunarJobOperation    *job_operation,
                                                                     GFile                 *source_file,
                                                                     GFile                 *target_file);
+void                    thunar_job_operation_compact               (ThunarJobOperation    *job_operation);
+gsize                   thunar_job_operation_get_size              (ThunarJobOperation    *job_operation);
 void                    thunar_job_operation_overwrite             (ThunarJobOperation    *job_operation,
                                                                     GFile                 *overwritten_file);
 ThunarJobOperation     *thunar_job_operation_new_invert            (ThunarJobOperation    *job_operation);
@@ -52,15 +52,75 @@ enum
   LAST_SIGNAL,
 };
 
+/* how many jobs of a class are admitted at the same time, see thunar_job_yield() */
+#define THUNAR_JOB_BACKGROUND_SLOTS (2)
+#define THUNAR_JOB_BULK_SLOTS       (1)
+
+/* how often waiting jobs look at cancellation and pausing again */
+#define THUNAR_JOB_YIELD_INTERVAL   (500 * G_TIME_SPAN_MILLISECOND)
+
+/* the events a job queues for the main loop, see thunar_job_push_event() */
+#define THUNAR_JOB_EVENT_RING_SIZE      (128)
+#define THUNAR_JOB_EVENT_DRAIN_INTERVAL (16)   /* ms, about once per frame */
+#define THUNAR_JOB_EVENT_RING_FULL_WAIT (1000) /* us */
+
+/* the latency histograms have a bucket per power of ten from below
+ * 10 us up to 1 s and above, see thunar_job_stats_latency() */
+#define THUNAR_JOB_STATS_N_BUCKETS      (7)
+#define THUNAR_JOB_STATS_FIRST_BUCKET   (10) /* us */
+
+
+
+typedef enum
+{
+  THUNAR_JOB_EVENT_PERCENT,
+  THUNAR_JOB_EVENT_INFO_MESSAGE,
+  THUNAR_JOB_EVENT_FILES_READY,
+} ThunarJobEventType;
+
+/* a slot of the bounded ring of the job. Its sequence tells the owner:
+ * the slot at position pos is free for a producer when the sequence is
+ * pos, and ready for the main loop when it is pos + 1. The main loop
+ * returns the slot with pos + THUNAR_JOB_EVENT_RING_SIZE. The transfer
+ * jobs report progress from the GIO callbacks too, so more than one
+ * thread may produce */
+typedef struct
+{
+  gint               sequence;
+  ThunarJobEventType type;
+  gdouble            percent;
+  gpointer           data; /* the message or the file list, owned by the slot */
+} ThunarJobEvent;
+
+typedef struct
+{
+  guint64 counts[THUNAR_JOB_STATS_N_BUCKETS];
+  guint64 n_samples;
+  gint64  total_time; /* us */
+  gint64  max_time;   /* us */
+} ThunarJobHistogram;
+
 
 
 static void              thunar_job_finalize            (GObject            *object);
+static void              thunar_job_finished            (ExoJob             *job);
+static void              thunar_job_release             (ThunarJob          *job);
+static gboolean          thunar_job_may_run             (ThunarJob          *job);
 static ThunarJobResponse thunar_job_real_ask            (ThunarJob          *job,
                                                          const gchar        *message,
                                                          ThunarJobResponse   choices);
 static ThunarJobResponse thunar_job_real_ask_replace    (ThunarJob          *job,
                                                          ThunarFile         *source_file,
                                                          ThunarFile         *target_file);
+static void              thunar_job_push_event          (ThunarJob          *job,
+                                                         ThunarJobEventType  type,
+                                                         gdouble             percent,
+                                                         gpointer            data);
+static void              thunar_job_schedule_drain      (ThunarJob          *job);
+static gboolean          thunar_job_drain_timeout       (gpointer            user_data);
+static void              thunar_job_drain_events        (ThunarJob          *job);
+static void              thunar_job_stats_ask           (ThunarJob          *job,
+                                                         gint64              start_time);
 
 
 
@@ -76,12 +136,41 @@ struct _ThunarJobPrivate
   gboolean                  paused; /* the job has been manually paused using the UI */
   gboolean                  frozen; /* the job has been automaticaly paused regarding some parallel copy behavior */
   ThunarOperationLogMode    log_mode;
+
+  /* scheduling, protected by the scheduler_mutex */
+  ThunarJobPriority         priority;
+  gboolean                  admitted;   /* holds one of the slots of its class */
+  gboolean                  preempting; /* running interactive job, the background ones wait for it */
+
+  /* events for the main loop, instead of a round trip for each of them */
+  ThunarJobEvent            events[THUNAR_JOB_EVENT_RING_SIZE];
+  gint                      event_head; /* next slot of the producers */
+  guint                     event_tail; /* next slot of the main loop */
+  gint                      drain_scheduled;
+
+  /* IO statistics of the job threads, protected by the stats_mutex */
+  GMutex                    stats_mutex;
+  gint64                    stats_start_time; /* us, the first counted operation */
+  gint64                    stats_end_time;   /* us, 0 while running */
+  guint64                   stats_n_files;
+  guint64                   stats_n_read;     /* byte */
+  guint64                   stats_n_written;  /* byte */
+  gint64                    stats_ask_time;   /* us, waiting for the user */
+  guint                     stats_n_asks;
+  ThunarJobHistogram        stats_latency[THUNAR_JOB_N_IO_OPERATIONS];
 };
 
 
 
 static guint job_signals[LAST_SIGNAL];
 
+/* the jobs of all windows share the budget of their class */
+static GMutex scheduler_mutex;
+static GCond  scheduler_cond;
+static guint  scheduler_n_admitted[THUNAR_JOB_N_PRIORITIES];
+static guint  scheduler_n_preempting = 0;
+static guint  scheduler_n_waiting[THUNAR_JOB_N_PRIORITIES];
+
 
 
 G_DEFINE_ABSTRACT_TYPE_WITH_PRIVATE (ThunarJob, thunar_job, EXO_TYPE_JOB)
@@ -104,10 +193,14 @@ static void
 thunar_job_class_init (ThunarJobClass *klass)
 {
   GObjectClass *gobject_class;
+  ExoJobClass  *exojob_class;
 
   gobject_class = G_OBJECT_CLASS (klass);
   gobject_class->finalize = thunar_job_finalize;
 
+  exojob_class = EXO_JOB_CLASS (klass);
+  exojob_class->finished = thunar_job_finished;
+
   klass->ask = thunar_job_real_ask;
   klass->ask_replace = thunar_job_real_ask_replace;
 
@@ -240,6 +333,8 @@ thunar_job_class_init (ThunarJobClass *klass)
 static void
 thunar_job_init (ThunarJob *job)
 {
+  guint n;
+
   job->priv = thunar_job_get_instance_private (job);
   job->priv->earlier_ask_create_response = 0;
   job->priv->earlier_ask_overwrite_response = 0;
@@ -249,6 +344,22 @@ thunar_job_init (ThunarJob *job)
   job->priv->pausable = FALSE;
   job->priv->paused = FALSE;
   job->priv->frozen = FALSE;
+  job->priv->priority = THUNAR_JOB_PRIORITY_INTERACTIVE;
+  job->priv->admitted = FALSE;
+  job->priv->preempting = FALSE;
+
+  for (n = 0; n < THUNAR_JOB_EVENT_RING_SIZE; n++)
+    job->priv->events[n].sequence = n;
+  job->priv->event_head = 0;
+  job->priv->event_tail = 0;
+  job->priv->drain_scheduled = FALSE;
+
+  g_mutex_init (&job->priv->stats_mutex);
+
+  /* the queued events come before the result of the job, this
+   * handler is connected ahead of the ones of the job's owner */
+  g_signal_connect (G_OBJECT (job), "error", G_CALLBACK (thunar_job_drain_events), NULL);
+  g_signal_connect (G_OBJECT (job), "finished", G_CALLBACK (thunar_job_drain_events), NULL);
 }
 
 
@@ -256,11 +367,221 @@ thunar_job_init (ThunarJob *job)
 static void
 thunar_job_finalize (GObject *object)
 {
+  ThunarJob      *job = THUNAR_JOB (object);
+  ThunarJobEvent *event;
+  guint           pos;
+
+  /* in case the job never finished */
+  thunar_job_release (job);
+
+  /* release the events nobody received */
+  for (pos = job->priv->event_tail;; pos++)
+    {
+      event = &job->priv->events[pos % THUNAR_JOB_EVENT_RING_SIZE];
+      if ((gint) ((guint) event->sequence - (pos + 1)) < 0)
+        break;
+
+      if (event->type == THUNAR_JOB_EVENT_FILES_READY)
+        thunar_g_list_free_full (event->data);
+      else
+        g_free (event->data);
+
+      event->sequence = pos + THUNAR_JOB_EVENT_RING_SIZE;
+    }
+
+  g_mutex_clear (&job->priv->stats_mutex);
+
   (*G_OBJECT_CLASS (thunar_job_parent_class)->finalize) (object);
 }
 
 
 
+static void
+thunar_job_finished (ExoJob *job)
+{
+  ThunarJobPrivate *priv = THUNAR_JOB (job)->priv;
+
+  /* leave the slot to the next job of the class */
+  thunar_job_release (THUNAR_JOB (job));
+
+  /* the rates of the summary stop here */
+  g_mutex_lock (&priv->stats_mutex);
+  priv->stats_end_time = g_get_monotonic_time ();
+  g_mutex_unlock (&priv->stats_mutex);
+}
+
+
+
+static void
+thunar_job_release (ThunarJob *job)
+{
+  g_mutex_lock (&scheduler_mutex);
+
+  if (job->priv->admitted)
+    {
+      job->priv->admitted = FALSE;
+      scheduler_n_admitted[job->priv->priority]--;
+    }
+
+  if (job->priv->preempting)
+    {
+      job->priv->preempting = FALSE;
+      scheduler_n_preempting--;
+    }
+
+  g_cond_broadcast (&scheduler_cond);
+  g_mutex_unlock (&scheduler_mutex);
+}
+
+
+
+/* the producer side of the event ring, may run in any thread */
+static void
+thunar_job_push_event (ThunarJob          *job,
+                       ThunarJobEventType  type,
+                       gdouble             percent,
+                       gpointer            data)
+{
+  ThunarJobPrivate *priv = job->priv;
+  ThunarJobEvent   *event;
+  guint             pos;
+  gint              diff;
+
+  /* claim a slot, see the comment on ThunarJobEvent */
+  for (pos = (guint) g_atomic_int_get (&priv->event_head);;)
+    {
+      event = &priv->events[pos % THUNAR_JOB_EVENT_RING_SIZE];
+      diff = (gint) ((guint) g_atomic_int_get (&event->sequence) - pos);
+
+      if (diff == 0)
+        {
+          if (g_atomic_int_compare_and_exchange (&priv->event_head, (gint) pos, (gint) (pos + 1)))
+            break;
+        }
+      else if (diff < 0)
+        {
+          /* the ring is full, give the main loop time to catch up */
+          thunar_job_schedule_drain (job);
+          g_usleep (THUNAR_JOB_EVENT_RING_FULL_WAIT);
+        }
+
+      pos = (guint) g_atomic_int_get (&priv->event_head);
+    }
+
+  event->type = type;
+  event->percent = percent;
+  event->data = data;
+
+  /* publish the slot to the main loop */
+  g_atomic_int_set (&event->sequence, (gint) (pos + 1));
+
+  thunar_job_schedule_drain (job);
+}
+
+
+
+static void
+thunar_job_schedule_drain (ThunarJob *job)
+{
+  GSource *source;
+
+  /* one drain per frame for all the events queued meanwhile, the source is
+   * named before it is attached, since it may run right away */
+  if (g_atomic_int_compare_and_exchange (&job->priv->drain_scheduled, FALSE, TRUE))
+    {
+      source = g_timeout_source_new (THUNAR_JOB_EVENT_DRAIN_INTERVAL);
+      g_source_set_name (source, "thunar_job_drain_timeout");
+      g_source_set_callback (source, thunar_job_drain_timeout, g_object_ref (job), g_object_unref);
+      g_source_attach (source, NULL);
+      g_source_unref (source);
+    }
+}
+
+
+
+static gboolean
+thunar_job_drain_timeout (gpointer user_data)
+{
+  ThunarJob *job = THUNAR_JOB (user_data);
+
+  /* the events pushed from now on schedule another drain */
+  g_atomic_int_set (&job->priv->drain_scheduled, FALSE);
+
+  thunar_job_drain_events (job);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+/* the consumer side of the event ring, runs in the main loop only */
+static void
+thunar_job_drain_events (ThunarJob *job)
+{
+  ThunarJobPrivate *priv = job->priv;
+  ThunarJobEvent   *event;
+  gboolean          handled;
+  gboolean          cancelled;
+  gboolean          has_percent = FALSE;
+  gdouble           percent = 0.0;
+  gchar            *message = NULL;
+  guint             pos;
+
+  _thunar_return_if_fail (THUNAR_IS_JOB (job));
+
+  cancelled = exo_job_is_cancelled (EXO_JOB (job));
+
+  for (pos = priv->event_tail;; pos++)
+    {
+      event = &priv->events[pos % THUNAR_JOB_EVENT_RING_SIZE];
+      if ((gint) ((guint) g_atomic_int_get (&event->sequence) - (pos + 1)) < 0)
+        break;
+
+      switch (event->type)
+        {
+        case THUNAR_JOB_EVENT_PERCENT:
+          /* only the latest progress is worth a redraw */
+          percent = event->percent;
+          has_percent = TRUE;
+          break;
+
+        case THUNAR_JOB_EVENT_INFO_MESSAGE:
+          g_free (message);
+          message = event->data;
+          break;
+
+        case THUNAR_JOB_EVENT_FILES_READY:
+          handled = FALSE;
+          if (!cancelled)
+            g_signal_emit (job, job_signals[FILES_READY], 0, event->data, &handled);
+
+          /* none of the handlers took over the file list */
+          if (!handled)
+            thunar_g_list_free_full (event->data);
+          break;
+        }
+
+      event->data = NULL;
+
+      /* hand the slot back to the producers */
+      g_atomic_int_set (&event->sequence, (gint) (pos + THUNAR_JOB_EVENT_RING_SIZE));
+    }
+
+  priv->event_tail = pos;
+
+  if (message != NULL)
+    {
+      if (!cancelled)
+        g_signal_emit_by_name (job, "info-message", message);
+      g_free (message);
+    }
+
+  if (has_percent && !cancelled)
+    g_signal_emit_by_name (job, "percent", percent);
+}
+
+
+
 static ThunarJobResponse
 thunar_job_real_ask (ThunarJob        *job,
                      const gchar      *message,
@@ -323,6 +644,7 @@ _thunar_job_ask_valist (ThunarJob        *job,
                         ThunarJobResponse choices)
 {
   ThunarJobResponse response;
+  gint64            start_time;
   gchar            *text;
   gchar            *message;
 
@@ -337,7 +659,9 @@ _thunar_job_ask_valist (ThunarJob        *job,
   g_free (text);
 
   /* send the question and wait for the answer */
+  start_time = g_get_monotonic_time ();
   exo_job_emit (EXO_JOB (job), job_signals[ASK], 0, message, choices, &response);
+  thunar_job_stats_ask (job, start_time);
   g_free (message);
 
   /* cancel the job as per users request */
@@ -506,6 +830,41 @@ thunar_job_ask_create (ThunarJob   *job,
 
 
 
+/* resolves a conflict by the "Replace Older" or "Replace Smaller"
+ * @policy in the job thread, comparing the two files */
+static ThunarJobResponse
+thunar_job_resolve_replace (ThunarJob         *job,
+                            GFile             *source_path,
+                            GFile             *target_path,
+                            ThunarJobResponse  policy)
+{
+  ThunarJobResponse response = THUNAR_JOB_RESPONSE_SKIP;
+  const gchar      *attribute;
+  GFileInfo        *source_info;
+  GFileInfo        *target_info;
+
+  attribute = (policy == THUNAR_JOB_RESPONSE_REPLACE_OLDER_ALL)
+              ? G_FILE_ATTRIBUTE_TIME_MODIFIED
+              : G_FILE_ATTRIBUTE_STANDARD_SIZE;
+
+  source_info = g_file_query_info (source_path, attribute, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                   exo_job_get_cancellable (EXO_JOB (job)), NULL);
+  target_info = g_file_query_info (target_path, attribute, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                   exo_job_get_cancellable (EXO_JOB (job)), NULL);
+
+  /* only a strictly newer or larger file replaces the existing one */
+  if (source_info != NULL && target_info != NULL
+      && g_file_info_get_attribute_uint64 (source_info, attribute) > g_file_info_get_attribute_uint64 (target_info, attribute))
+    response = THUNAR_JOB_RESPONSE_REPLACE;
+
+  g_clear_object (&source_info);
+  g_clear_object (&target_info);
+
+  return response;
+}
+
+
+
 ThunarJobResponse
 thunar_job_ask_replace (ThunarJob *job,
                         GFile     *source_path,
@@ -515,6 +874,7 @@ thunar_job_ask_replace (ThunarJob *job,
   ThunarJobResponse response;
   ThunarFile       *source_file;
   ThunarFile       *target_file;
+  gint64            start_time;
 
   _thunar_return_val_if_fail (THUNAR_IS_JOB (job), THUNAR_JOB_RESPONSE_CANCEL);
   _thunar_return_val_if_fail (G_IS_FILE (source_path), THUNAR_JOB_RESPONSE_CANCEL);
@@ -535,6 +895,11 @@ thunar_job_ask_replace (ThunarJob *job,
   if (G_UNLIKELY (job->priv->earlier_ask_overwrite_response == THUNAR_JOB_RESPONSE_SKIP_ALL))
     return THUNAR_JOB_RESPONSE_SKIP;
 
+  /* check if the user said "Replace Older" or "Replace Smaller" earlier */
+  if (G_UNLIKELY (job->priv->earlier_ask_overwrite_response == THUNAR_JOB_RESPONSE_REPLACE_OLDER_ALL
+                  || job->priv->earlier_ask_overwrite_response == THUNAR_JOB_RESPONSE_REPLACE_SMALLER_ALL))
+    return thunar_job_resolve_replace (job, source_path, target_path, job->priv->earlier_ask_overwrite_response);
+
   source_file = thunar_file_get (source_path, error);
 
   if (G_UNLIKELY (source_file == NULL))
@@ -548,8 +913,10 @@ thunar_job_ask_replace (ThunarJob *job,
       return THUNAR_JOB_RESPONSE_SKIP;
     }
 
+  start_time = g_get_monotonic_time ();
   exo_job_emit (EXO_JOB (job), job_signals[ASK_REPLACE], 0,
                 source_file, target_file, &response);
+  thunar_job_stats_ask (job, start_time);
 
   g_object_unref (source_file);
   g_object_unref (target_file);
@@ -572,6 +939,69 @@ thunar_job_ask_replace (ThunarJob *job,
 
 
 
+/**
+ * thunar_job_ask_conflicts:
+ * @job         : a #ThunarJob.
+ * @n_conflicts : the number of files the job is going to find in
+ *                the destination already.
+ *
+ * Asks the user once how to resolve all the conflicts of @job, found
+ * by a scan before the transfer starts. thunar_job_ask_replace() then
+ * resolves every conflict by this decision in the job thread, without
+ * a round trip to the main loop per file.
+ *
+ * Return value: the response of the user, %THUNAR_JOB_RESPONSE_NO
+ *               to be asked for every conflict.
+ **/
+ThunarJobResponse
+thunar_job_ask_conflicts (ThunarJob *job,
+                          guint64    n_conflicts)
+{
+  ThunarJobResponse response;
+  gint64            start_time;
+  gchar            *message;
+
+  _thunar_return_val_if_fail (THUNAR_IS_JOB (job), THUNAR_JOB_RESPONSE_CANCEL);
+
+  /* check if the user already cancelled the job */
+  if (G_UNLIKELY (exo_job_is_cancelled (EXO_JOB (job))))
+    return THUNAR_JOB_RESPONSE_CANCEL;
+
+  /* the user already decided for all files */
+  if (job->priv->earlier_ask_overwrite_response != 0)
+    return job->priv->earlier_ask_overwrite_response;
+
+  message = g_strdup_printf (ngettext ("%" G_GUINT64_FORMAT " file already exists in the destination.\n\n"
+                                       "Do you want to resolve all conflicts the same way?",
+                                       "%" G_GUINT64_FORMAT " files already exist in the destination.\n\n"
+                                       "Do you want to resolve all conflicts the same way?",
+                                       n_conflicts),
+                             n_conflicts);
+
+  start_time = g_get_monotonic_time ();
+  exo_job_emit (EXO_JOB (job), job_signals[ASK], 0, message,
+                THUNAR_JOB_RESPONSE_REPLACE_ALL
+                | THUNAR_JOB_RESPONSE_REPLACE_OLDER_ALL
+                | THUNAR_JOB_RESPONSE_REPLACE_SMALLER_ALL
+                | THUNAR_JOB_RESPONSE_RENAME_ALL
+                | THUNAR_JOB_RESPONSE_SKIP_ALL
+                | THUNAR_JOB_RESPONSE_NO
+                | THUNAR_JOB_RESPONSE_CANCEL,
+                &response);
+  thunar_job_stats_ask (job, start_time);
+  g_free (message);
+
+  /* remember the decision for the conflicts ahead */
+  if (response == THUNAR_JOB_RESPONSE_CANCEL)
+    exo_job_cancel (EXO_JOB (job));
+  else if (response != THUNAR_JOB_RESPONSE_NO)
+    job->priv->earlier_ask_overwrite_response = response;
+
+  return response;
+}
+
+
+
 ThunarJobResponse
 thunar_job_ask_skip (ThunarJob   *job,
                      const gchar *format,
@@ -657,12 +1087,12 @@ gboolean
 thunar_job_files_ready (ThunarJob *job,
                         GList     *file_list)
 {
-  gboolean handled = FALSE;
-
   _thunar_return_val_if_fail (THUNAR_IS_JOB (job), FALSE);
 
-  exo_job_emit (EXO_JOB (job), job_signals[FILES_READY], 0, file_list, &handled);
-  return handled;
+  /* the ring owns the list from now on, and releases it if no handler
+   * takes it over, so the job doesn't wait for the main loop */
+  thunar_job_push_event (job, THUNAR_JOB_EVENT_FILES_READY, 0.0, file_list);
+  return TRUE;
 }
 
 
@@ -671,8 +1101,8 @@ void
 thunar_job_new_files (ThunarJob   *job,
                       const GList *file_list)
 {
-  ThunarFile  *file;
-  const GList *lp;
+  GList *cached_files;
+  GList *lp;
 
   _thunar_return_if_fail (THUNAR_IS_JOB (job));
 
@@ -680,14 +1110,13 @@ thunar_job_new_files (ThunarJob   *job,
   if (G_LIKELY (file_list != NULL))
     {
       /* schedule a reload of cached files when idle */
-      for (lp = file_list; lp != NULL; lp = lp->next)
+      cached_files = thunar_file_cache_lookup_batch ((GList *) file_list);
+      for (lp = cached_files; lp != NULL; lp = lp->next)
         {
-          file = thunar_file_cache_lookup (lp->data);
-          if (file != NULL)
-            {
-              thunar_file_reload_idle_unref (file);
-            }
+          if (lp->data != NULL)
+            thunar_file_reload_idle_unref (lp->data);
         }
+      g_list_free (cached_files);
 
       /* emit the "new-files" signal */
       exo_job_emit (EXO_JOB (job), job_signals[NEW_FILES], 0, file_list);
@@ -710,6 +1139,17 @@ thunar_job_set_total_files (ThunarJob *job,
 
 
 
+void
+thunar_job_set_n_total_files (ThunarJob *job,
+                              guint      n_total_files)
+{
+  _thunar_return_if_fail (THUNAR_IS_JOB (job));
+
+  job->priv->n_total_files = n_total_files;
+}
+
+
+
 void
 thunar_job_set_pausable (ThunarJob *job,
                          gboolean   pausable)
@@ -743,6 +1183,11 @@ thunar_job_resume (ThunarJob *job)
 {
   _thunar_return_if_fail (THUNAR_IS_JOB (job));
   job->priv->paused = FALSE;
+
+  /* wake the job if it waits in thunar_job_yield() */
+  g_mutex_lock (&scheduler_mutex);
+  g_cond_broadcast (&scheduler_cond);
+  g_mutex_unlock (&scheduler_mutex);
 }
 
 
@@ -785,13 +1230,170 @@ thunar_job_is_frozen (ThunarJob *job)
 
 
 
+/**
+ * thunar_job_set_priority:
+ * @job      : a #ThunarJob.
+ * @priority : the #ThunarJobPriority of @job.
+ *
+ * Sets the class of @job, which has to happen before it is launched.
+ * Jobs are %THUNAR_JOB_PRIORITY_INTERACTIVE unless told otherwise.
+ **/
+void
+thunar_job_set_priority (ThunarJob         *job,
+                         ThunarJobPriority  priority)
+{
+  _thunar_return_if_fail (THUNAR_IS_JOB (job));
+  _thunar_return_if_fail (priority < THUNAR_JOB_N_PRIORITIES);
+  _thunar_return_if_fail (!job->priv->admitted);
+
+  job->priv->priority = priority;
+}
+
+
+
+ThunarJobPriority
+thunar_job_get_priority (ThunarJob *job)
+{
+  _thunar_return_val_if_fail (THUNAR_IS_JOB (job), THUNAR_JOB_PRIORITY_INTERACTIVE);
+  return job->priv->priority;
+}
+
+
+
+static gboolean
+thunar_job_may_run (ThunarJob *job)
+{
+  guint slots;
+
+  switch (job->priv->priority)
+    {
+    case THUNAR_JOB_PRIORITY_INTERACTIVE:
+      /* running, so the background work has to wait */
+      if (!job->priv->preempting)
+        {
+          job->priv->preempting = TRUE;
+          scheduler_n_preempting++;
+        }
+      return TRUE;
+
+    case THUNAR_JOB_PRIORITY_VISIBLE:
+      return TRUE;
+
+    case THUNAR_JOB_PRIORITY_BACKGROUND:
+    case THUNAR_JOB_PRIORITY_BULK:
+    default:
+      if (scheduler_n_preempting > 0)
+        return FALSE;
+
+      if (!job->priv->admitted)
+        {
+          slots = (job->priv->priority == THUNAR_JOB_PRIORITY_BULK) ? THUNAR_JOB_BULK_SLOTS : THUNAR_JOB_BACKGROUND_SLOTS;
+          if (scheduler_n_admitted[job->priv->priority] >= slots)
+            return FALSE;
+
+          job->priv->admitted = TRUE;
+          scheduler_n_admitted[job->priv->priority]++;
+        }
+      return TRUE;
+    }
+}
+
+
+
+/**
+ * thunar_job_yield:
+ * @job : a #ThunarJob.
+ *
+ * Called by the worker thread of @job between two pieces of work. Blocks
+ * while @job is paused. Background and bulk jobs also wait here while an
+ * interactive job which calls this function runs, and until one of the
+ * few slots of their class is free, so they don't compete with the copy
+ * the user waits for. Returns right away once @job is cancelled.
+ *
+ * Return value: %TRUE if the function waited.
+ **/
+gboolean
+thunar_job_yield (ThunarJob *job)
+{
+  gboolean waited = FALSE;
+
+  _thunar_return_val_if_fail (THUNAR_IS_JOB (job), FALSE);
+
+  g_mutex_lock (&scheduler_mutex);
+
+  while (!exo_job_is_cancelled (EXO_JOB (job)))
+    {
+      if (job->priv->paused)
+        {
+          /* a paused copy does not hold back the background work */
+          if (job->priv->preempting)
+            {
+              job->priv->preempting = FALSE;
+              scheduler_n_preempting--;
+              g_cond_broadcast (&scheduler_cond);
+            }
+        }
+      else if (thunar_job_may_run (job))
+        {
+          break;
+        }
+
+      if (!waited)
+        {
+          waited = TRUE;
+          scheduler_n_waiting[job->priv->priority]++;
+        }
+      g_cond_wait_until (&scheduler_cond, &scheduler_mutex, g_get_monotonic_time () + THUNAR_JOB_YIELD_INTERVAL);
+    }
+
+  if (waited)
+    scheduler_n_waiting[job->priv->priority]--;
+
+  g_mutex_unlock (&scheduler_mutex);
+
+  return waited;
+}
+
+
+
+/**
+ * thunar_job_get_scheduler_stats:
+ * @n_running : return location for the number of running jobs per
+ *              #ThunarJobPriority.
+ * @n_waiting : return location for the number of jobs waiting in
+ *              thunar_job_yield() per #ThunarJobPriority.
+ *
+ * Counts the jobs of all windows known to the scheduler. Only the
+ * interactive jobs which hold back the background work and the
+ * background and bulk jobs holding one of their slots are counted
+ * as running, the visible jobs are never limited.
+ **/
+void
+thunar_job_get_scheduler_stats (guint n_running[THUNAR_JOB_N_PRIORITIES],
+                                guint n_waiting[THUNAR_JOB_N_PRIORITIES])
+{
+  guint n;
+
+  g_mutex_lock (&scheduler_mutex);
+
+  for (n = 0; n < THUNAR_JOB_N_PRIORITIES; n++)
+    {
+      n_running[n] = scheduler_n_admitted[n];
+      n_waiting[n] = scheduler_n_waiting[n];
+    }
+  n_running[THUNAR_JOB_PRIORITY_INTERACTIVE] = scheduler_n_preempting;
+
+  g_mutex_unlock (&scheduler_mutex);
+}
+
+
+
 void
 thunar_job_processing_file (ThunarJob *job,
                             GList     *current_file,
                             guint      n_processed)
 {
   gchar *base_name;
-  gchar *display_name;
 
   _thunar_return_if_fail (THUNAR_IS_JOB (job));
   _thunar_return_if_fail (current_file != NULL);
@@ -801,15 +1403,311 @@ thunar_job_processing_file (ThunarJob *job,
     return;
 
   base_name = g_file_get_basename (current_file->data);
-  display_name = g_filename_display_name (base_name);
+  thunar_job_processing_name (job, base_name, n_processed);
   g_free (base_name);
+}
 
-  exo_job_info_message (EXO_JOB (job), "%s", display_name);
-  g_free (display_name);
+
+
+void
+thunar_job_processing_name (ThunarJob   *job,
+                            const gchar *base_name,
+                            guint        n_processed)
+{
+  gchar *display_name;
+
+  _thunar_return_if_fail (THUNAR_IS_JOB (job));
+  _thunar_return_if_fail (base_name != NULL);
+
+  /* emit only if n_processed is a multiple of 8 */
+  if ((n_processed % 8) != 0)
+    return;
+
+  display_name = g_filename_display_name (base_name);
+  thunar_job_push_event (job, THUNAR_JOB_EVENT_INFO_MESSAGE, 0.0, display_name);
 
   /* verify that we have total files set */
   if (G_LIKELY (job->priv->n_total_files > 0))
-    exo_job_percent (EXO_JOB (job), (n_processed * 100.0) / job->priv->n_total_files);
+    thunar_job_percent (job, (n_processed * 100.0) / job->priv->n_total_files);
+}
+
+
+
+/**
+ * thunar_job_info_message:
+ * @job    : a #ThunarJob.
+ * @format : a printf-style format string.
+ * @...    : the parameters for @format.
+ *
+ * Like exo_job_info_message(), but the message is queued for the
+ * main loop instead of waiting for it. Messages queued between two
+ * main loop frames replace each other.
+ **/
+void
+thunar_job_info_message (ThunarJob   *job,
+                         const gchar *format,
+                         ...)
+{
+  va_list var_args;
+  gchar  *message;
+
+  _thunar_return_if_fail (THUNAR_IS_JOB (job));
+  _thunar_return_if_fail (format != NULL);
+
+  va_start (var_args, format);
+  message = g_strdup_vprintf (format, var_args);
+  va_end (var_args);
+
+  thunar_job_push_event (job, THUNAR_JOB_EVENT_INFO_MESSAGE, 0.0, message);
+}
+
+
+
+/**
+ * thunar_job_percent:
+ * @job     : a #ThunarJob.
+ * @percent : the percentage of completeness.
+ *
+ * Like exo_job_percent(), but the progress is queued for the main
+ * loop instead of waiting for it. Only the latest progress between
+ * two main loop frames is emitted.
+ **/
+void
+thunar_job_percent (ThunarJob *job,
+                    gdouble    percent)
+{
+  _thunar_return_if_fail (THUNAR_IS_JOB (job));
+
+  thunar_job_push_event (job, THUNAR_JOB_EVENT_PERCENT, CLAMP (percent, 0.0, 100.0), NULL);
+}
+
+
+
+/* counts the time @job waited for the answer to a question since @start_time */
+static void
+thunar_job_stats_ask (ThunarJob *job,
+                      gint64     start_time)
+{
+  ThunarJobPrivate *priv = job->priv;
+
+  g_mutex_lock (&priv->stats_mutex);
+  priv->stats_ask_time += MAX (g_get_monotonic_time () - start_time, 0);
+  priv->stats_n_asks++;
+  g_mutex_unlock (&priv->stats_mutex);
+}
+
+
+
+/**
+ * thunar_job_stats_latency:
+ * @job        : a #ThunarJob.
+ * @operation  : the #ThunarJobIoOperation which just completed.
+ * @start_time : the g_get_monotonic_time() when @operation started.
+ *
+ * Counts one @operation of @job, which took from @start_time until
+ * now, in the latency histogram of the operation. May be called from
+ * any thread.
+ **/
+void
+thunar_job_stats_latency (ThunarJob           *job,
+                          ThunarJobIoOperation operation,
+                          gint64               start_time)
+{
+  ThunarJobPrivate   *priv;
+  ThunarJobHistogram *histogram;
+  gint64              elapsed;
+  gint64              limit;
+  guint               bucket;
+
+  _thunar_return_if_fail (THUNAR_IS_JOB (job));
+  _thunar_return_if_fail (operation < THUNAR_JOB_N_IO_OPERATIONS);
+
+  priv = job->priv;
+  elapsed = MAX (g_get_monotonic_time () - start_time, 0);
+
+  /* the power of ten of the latency */
+  for (bucket = 0, limit = THUNAR_JOB_STATS_FIRST_BUCKET;
+       elapsed >= limit && bucket < THUNAR_JOB_STATS_N_BUCKETS - 1;
+       bucket++, limit *= 10)
+    ;
+
+  g_mutex_lock (&priv->stats_mutex);
+
+  if (priv->stats_start_time == 0)
+    priv->stats_start_time = start_time;
+
+  histogram = &priv->stats_latency[operation];
+  histogram->counts[bucket]++;
+  histogram->n_samples++;
+  histogram->total_time += elapsed;
+  histogram->max_time = MAX (histogram->max_time, elapsed);
+
+  g_mutex_unlock (&priv->stats_mutex);
+}
+
+
+
+/**
+ * thunar_job_stats_bytes:
+ * @job       : a #ThunarJob.
+ * @n_read    : the number of bytes read since the last call.
+ * @n_written : the number of bytes written since the last call.
+ *
+ * Adds to the data @job read and wrote. May be called from any thread.
+ **/
+void
+thunar_job_stats_bytes (ThunarJob *job,
+                        guint64    n_read,
+                        guint64    n_written)
+{
+  ThunarJobPrivate *priv;
+
+  _thunar_return_if_fail (THUNAR_IS_JOB (job));
+
+  priv = job->priv;
+
+  g_mutex_lock (&priv->stats_mutex);
+
+  if (priv->stats_start_time == 0)
+    priv->stats_start_time = g_get_monotonic_time ();
+
+  priv->stats_n_read += n_read;
+  priv->stats_n_written += n_written;
+
+  g_mutex_unlock (&priv->stats_mutex);
+}
+
+
+
+/**
+ * thunar_job_stats_files:
+ * @job     : a #ThunarJob.
+ * @n_files : the number of files @job just completed.
+ *
+ * Adds to the files @job completed. May be called from any thread.
+ **/
+void
+thunar_job_stats_files (ThunarJob *job,
+                        guint64    n_files)
+{
+  ThunarJobPrivate *priv;
+
+  _thunar_return_if_fail (THUNAR_IS_JOB (job));
+
+  priv = job->priv;
+
+  g_mutex_lock (&priv->stats_mutex);
+
+  if (priv->stats_start_time == 0)
+    priv->stats_start_time = g_get_monotonic_time ();
+
+  priv->stats_n_files += n_files;
+
+  g_mutex_unlock (&priv->stats_mutex);
+}
+
+
+
+/**
+ * thunar_job_get_stats_summary:
+ * @job : a #ThunarJob.
+ *
+ * Describes the IO statistics of @job so far: the files per second,
+ * the bytes read and written per second, the time spent waiting for
+ * the answers of the user, which the rates don't include, and a
+ * latency histogram for each operation @job did. The columns of the
+ * histograms are lined up for a monospace font.
+ *
+ * The caller is responsible to free the returned string using g_free()
+ * when no longer needed.
+ *
+ * Return value: the summary of the statistics of @job.
+ **/
+gchar *
+thunar_job_get_stats_summary (ThunarJob *job)
+{
+  static const gchar *bucket_names[THUNAR_JOB_STATS_N_BUCKETS] = { "<10us", "<100us", "<1ms", "<10ms", "<100ms", "<1s", ">=1s" };
+  ThunarJobPrivate   *priv;
+  ThunarJobHistogram *histogram;
+  const gchar        *operation_names[THUNAR_JOB_N_IO_OPERATIONS];
+  GString            *summary;
+  gdouble             seconds = 0.0;
+  gint64              end_time;
+  gchar              *size;
+  gchar              *rate;
+  guint               n;
+  guint               bucket;
+
+  _thunar_return_val_if_fail (THUNAR_IS_JOB (job), NULL);
+
+  operation_names[THUNAR_JOB_IO_OPEN] = _("Open");
+  operation_names[THUNAR_JOB_IO_STAT] = _("Stat");
+  operation_names[THUNAR_JOB_IO_CREATE] = _("Create");
+  operation_names[THUNAR_JOB_IO_CLOSE] = _("Close");
+  operation_names[THUNAR_JOB_IO_DELETE] = _("Delete");
+
+  priv = job->priv;
+  summary = g_string_new (NULL);
+
+  g_mutex_lock (&priv->stats_mutex);
+
+  /* the rates leave out the time the job waited for the user */
+  if (priv->stats_start_time > 0)
+    {
+      end_time = (priv->stats_end_time > 0) ? priv->stats_end_time : g_get_monotonic_time ();
+      seconds = MAX (end_time - priv->stats_start_time - priv->stats_ask_time, 0) / (gdouble) G_TIME_SPAN_SECOND;
+    }
+
+  g_string_append_printf (summary, _("Elapsed: %.1f s"), seconds);
+  g_string_append_c (summary, '\n');
+
+  g_string_append_printf (summary, _("Files: %" G_GUINT64_FORMAT " (%.1f/s)"),
+                          priv->stats_n_files, seconds > 0.0 ? priv->stats_n_files / seconds : 0.0);
+  g_string_append_c (summary, '\n');
+
+  size = g_format_size (priv->stats_n_read);
+  rate = g_format_size (seconds > 0.0 ? priv->stats_n_read / seconds : 0.0);
+  g_string_append_printf (summary, _("Read: %s (%s/s)"), size, rate);
+  g_string_append_c (summary, '\n');
+  g_free (size);
+  g_free (rate);
+
+  size = g_format_size (priv->stats_n_written);
+  rate = g_format_size (seconds > 0.0 ? priv->stats_n_written / seconds : 0.0);
+  g_string_append_printf (summary, _("Written: %s (%s/s)"), size, rate);
+  g_string_append_c (summary, '\n');
+  g_free (size);
+  g_free (rate);
+
+  g_string_append_printf (summary, ngettext ("Waiting for answers: %.1f s (%u question)",
+                                             "Waiting for answers: %.1f s (%u questions)",
+                                             priv->stats_n_asks),
+                          priv->stats_ask_time / (gdouble) G_TIME_SPAN_SECOND, priv->stats_n_asks);
+  g_string_append_c (summary, '\n');
+
+  /* a histogram row for each operation the job did */
+  g_string_append_printf (summary, "\n%-8s", _("Latency"));
+  for (bucket = 0; bucket < THUNAR_JOB_STATS_N_BUCKETS; bucket++)
+    g_string_append_printf (summary, " %7s", bucket_names[bucket]);
+  g_string_append_printf (summary, " %9s %9s", _("avg ms"), _("max ms"));
+
+  for (n = 0; n < THUNAR_JOB_N_IO_OPERATIONS; n++)
+    {
+      histogram = &priv->stats_latency[n];
+      if (histogram->n_samples == 0)
+        continue;
+
+      g_string_append_printf (summary, "\n%-8s", operation_names[n]);
+      for (bucket = 0; bucket < THUNAR_JOB_STATS_N_BUCKETS; bucket++)
+        g_string_append_printf (summary, " %7" G_GUINT64_FORMAT, histogram->counts[bucket]);
+      g_string_append_printf (summary, " %9.2f %9.2f",
+                              histogram->total_time / (gdouble) histogram->n_samples / G_TIME_SPAN_MILLISECOND,
+                              histogram->max_time / (gdouble) G_TIME_SPAN_MILLISECOND);
+    }
+
+  g_mutex_unlock (&priv->stats_mutex);
+
+  return g_string_free (summary, FALSE);
 }
 
 
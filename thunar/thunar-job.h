@@ -32,6 +32,44 @@
 
 G_BEGIN_DECLS
 
+/**
+ * ThunarJobPriority:
+ * @THUNAR_JOB_PRIORITY_INTERACTIVE : operations the user waits for, like copying files.
+ * @THUNAR_JOB_PRIORITY_VISIBLE     : work for what a view shows right now.
+ * @THUNAR_JOB_PRIORITY_BACKGROUND  : work nobody waits for, like loading content types ahead.
+ * @THUNAR_JOB_PRIORITY_BULK        : long scans of whole folder trees.
+ *
+ * The class of a #ThunarJob, see thunar_job_yield().
+ **/
+typedef enum
+{
+  THUNAR_JOB_PRIORITY_INTERACTIVE,
+  THUNAR_JOB_PRIORITY_VISIBLE,
+  THUNAR_JOB_PRIORITY_BACKGROUND,
+  THUNAR_JOB_PRIORITY_BULK,
+  THUNAR_JOB_N_PRIORITIES,
+} ThunarJobPriority;
+
+/**
+ * ThunarJobIoOperation:
+ * @THUNAR_JOB_IO_OPEN   : opening a file, until its first data is written.
+ * @THUNAR_JOB_IO_STAT   : querying the information of a file.
+ * @THUNAR_JOB_IO_CREATE : creating a folder or a link.
+ * @THUNAR_JOB_IO_CLOSE  : finishing a file after its last data was written.
+ * @THUNAR_JOB_IO_DELETE : removing a file or a folder.
+ *
+ * The operations whose latencies a #ThunarJob counts, see thunar_job_stats_latency().
+ **/
+typedef enum
+{
+  THUNAR_JOB_IO_OPEN,
+  THUNAR_JOB_IO_STAT,
+  THUNAR_JOB_IO_CREATE,
+  THUNAR_JOB_IO_CLOSE,
+  THUNAR_JOB_IO_DELETE,
+  THUNAR_JOB_N_IO_OPERATIONS,
+} ThunarJobIoOperation;
+
 typedef struct _ThunarJobPrivate ThunarJobPrivate;
 typedef struct _ThunarJobClass   ThunarJobClass;
 typedef struct _ThunarJob        ThunarJob;
@@ -69,6 +107,8 @@ struct _ThunarJob
 GType             thunar_job_get_type               (void) G_GNUC_CONST;
 void              thunar_job_set_total_files        (ThunarJob       *job,
                                                      GList           *total_files);
+void              thunar_job_set_n_total_files      (ThunarJob       *job,
+                                                     guint            n_total_files);
 void              thunar_job_set_pausable           (ThunarJob       *job,
                                                      gboolean         pausable);
 gboolean          thunar_job_is_pausable            (ThunarJob       *job);
@@ -78,9 +118,32 @@ void              thunar_job_freeze                 (ThunarJob       *job);
 void              thunar_job_unfreeze               (ThunarJob       *job);
 gboolean          thunar_job_is_paused              (ThunarJob       *job);
 gboolean          thunar_job_is_frozen              (ThunarJob       *job);
+void              thunar_job_set_priority           (ThunarJob       *job,
+                                                     ThunarJobPriority priority);
+ThunarJobPriority thunar_job_get_priority           (ThunarJob       *job);
+gboolean          thunar_job_yield                  (ThunarJob       *job);
+void              thunar_job_get_scheduler_stats    (guint            n_running[THUNAR_JOB_N_PRIORITIES],
+                                                     guint            n_waiting[THUNAR_JOB_N_PRIORITIES]);
 void              thunar_job_processing_file        (ThunarJob       *job,
                                                      GList           *current_file,
                                                      guint            n_processed);
+void              thunar_job_processing_name        (ThunarJob       *job,
+                                                     const gchar     *base_name,
+                                                     guint            n_processed);
+void              thunar_job_info_message           (ThunarJob       *job,
+                                                     const gchar     *format,
+                                                     ...) G_GNUC_PRINTF (2, 3);
+void              thunar_job_percent                (ThunarJob       *job,
+                                                     gdouble          percent);
+void              thunar_job_stats_latency          (ThunarJob       *job,
+                                                     ThunarJobIoOperation operation,
+                                                     gint64           start_time);
+void              thunar_job_stats_bytes            (ThunarJob       *job,
+                                                     guint64          n_read,
+                                                     guint64          n_written);
+void              thunar_job_stats_files            (ThunarJob       *job,
+                                                     guint64          n_files);
+gchar            *thunar_job_get_stats_summary      (ThunarJob       *job) G_GNUC_MALLOC;
 
 ThunarJobResponse thunar_job_ask_create             (ThunarJob       *job,
                                                      const gchar     *format,
@@ -95,6 +158,8 @@ ThunarJobResponse thunar_job_ask_replace            (ThunarJob       *job,
                                                      GFile           *source_path,
                                                      GFile           *target_path,
                                                      GError         **error);
+ThunarJobResponse thunar_job_ask_conflicts          (ThunarJob       *job,
+                                                     guint64          n_conflicts);
 ThunarJobResponse thunar_job_ask_skip               (ThunarJob       *job,
                                                      const gchar     *format,
                                                      ...);
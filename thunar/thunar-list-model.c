@@ -33,19 +33,38 @@
 #include <libxfce4util/libxfce4util.h>
 
 #include "thunar/thunar-application.h"
+#include "thunar/thunar-disk-usage.h"
 #include "thunar/thunar-file.h"
+#include "thunar/thunar-gio-extensions.h"
 #include "thunar/thunar-gobject-extensions.h"
 #include "thunar/thunar-list-model.h"
 #include "thunar/thunar-preferences.h"
 #include "thunar/thunar-private.h"
 #include "thunar/thunar-user.h"
-#include "thunar/thunar-simple-job.h"
 #include "thunar/thunar-util.h"
 #include "thunar/thunar-standard-view-model.h"
 #include "thunar/thunar-io-jobs.h"
 
 
 
+/* Time budget for inserting queued files while loading a folder, per main loop iteration */
+#define THUNAR_LIST_MODEL_INSERT_BUDGET (8 * 1000) /* in microseconds */
+
+/* Minimum number of rows for which the positions of the rows are cached in a flat index */
+#define THUNAR_LIST_MODEL_ROW_INDEX_THRESHOLD 10000
+
+/* Minimum number of row lookups, in 1/n of the number of rows, before (re)building the index */
+#define THUNAR_LIST_MODEL_ROW_INDEX_AMORTIZE  32
+
+/* Minimum number of rows to spread sorting over multiple threads, and the maximum number of threads */
+#define THUNAR_LIST_MODEL_PARALLEL_SORT_THRESHOLD 50000
+#define THUNAR_LIST_MODEL_MAX_SORT_THREADS        4
+
+/* Number of sort orders remembered for the current rows, so switching back is free */
+#define THUNAR_LIST_MODEL_SORT_CACHE_SIZE 4
+
+
+
 /* Property identifiers */
 enum
 {
@@ -134,6 +153,7 @@ static gint               thunar_list_model_cmp_func                    (gconstp
                                                                          gconstpointer                 b,
                                                                          gpointer                      user_data);
 static void               thunar_list_model_sort                        (ThunarListModel              *store);
+static void               thunar_list_model_sort_cache_clear            (ThunarListModel              *store);
 static void               thunar_list_model_files_changed               (ThunarFolder                 *folder,
                                                                          GList                        *files,
                                                                          ThunarListModel              *store);
@@ -153,6 +173,22 @@ static void               thunar_list_model_files_removed               (ThunarF
                                                                          ThunarListModel              *store);
 static void               thunar_list_model_insert_files                (ThunarListModel              *store,
                                                                          GList                        *files);
+static void               thunar_list_model_row_index_invalidate        (ThunarListModel              *store);
+static GSequenceIter     *thunar_list_model_row_at                      (ThunarListModel              *store,
+                                                                         gint                          position);
+static gint               thunar_list_model_row_position                (ThunarListModel              *store,
+                                                                         GSequenceIter                *row);
+static void               thunar_list_model_queue_files                 (ThunarListModel              *store,
+                                                                         GList                        *files);
+static gboolean           thunar_list_model_queue_idle                  (gpointer                      user_data);
+static void               thunar_list_model_queue_idle_destroy          (gpointer                      user_data);
+static void               thunar_list_model_cancel_queue                (ThunarListModel              *store);
+static void               thunar_list_model_finish_loading              (ThunarListModel              *store);
+static void               thunar_list_model_merge_files                 (ThunarListModel              *store,
+                                                                         GSList                       *files);
+static gboolean           thunar_list_model_filter_matches              (ThunarListModel              *store,
+                                                                         ThunarFile                   *file);
+static void               thunar_list_model_clear_filter                (ThunarListModel              *store);
 
 static gboolean           thunar_list_model_get_case_sensitive          (ThunarListModel              *store);
 static void               thunar_list_model_set_case_sensitive          (ThunarListModel              *store,
@@ -172,7 +208,8 @@ static void               thunar_list_model_search_finished             (ThunarJ
                                                                          ThunarListModel              *store);
 static void               thunar_list_model_add_search_files (ThunarStandardViewModel *model,
                                                               GList                   *files);
-static gboolean           thunar_list_model_update_search_files (ThunarListModel *model);
+static void               thunar_list_model_insert_search_files (GList    *files,
+                                                                 gpointer  user_data);
 
 static gint               thunar_list_model_get_folder_item_count       (ThunarListModel              *store);
 static void               thunar_list_model_set_folder_item_count       (ThunarListModel              *store,
@@ -181,8 +218,6 @@ static gboolean           thunar_list_model_get_loading                 (ThunarL
 static void               thunar_list_model_set_loading                 (ThunarListModel              *store,
                                                                          gboolean                      loading);
 
-static void               thunar_list_model_file_count_callback         (ExoJob                       *job,
-                                                                         gpointer                      model);
 static ThunarFolder      *thunar_list_model_get_folder                  (ThunarStandardViewModel      *store);
 static void               thunar_list_model_set_folder                  (ThunarStandardViewModel      *store,
                                                                          ThunarFolder                 *folder,
@@ -202,6 +237,64 @@ static GList             *thunar_list_model_get_paths_for_files (ThunarStandardV
 static ThunarJob         *thunar_list_model_get_job                     (ThunarStandardViewModel      *store);
 static void               thunar_list_model_set_job                     (ThunarStandardViewModel      *store,
                                                                          ThunarJob                    *job);
+static ThunarStandardViewModelTotals
+                         *thunar_list_model_get_totals                  (ThunarStandardViewModel      *store);
+
+typedef enum
+{
+  THUNAR_LIST_MODEL_SORT_BY_NAME,  /* compare the collate keys */
+  THUNAR_LIST_MODEL_SORT_BY_VALUE, /* compare the numeric value, then the collate keys */
+  THUNAR_LIST_MODEL_SORT_BY_FUNC,  /* no precomputed key, use the sort function */
+}
+ThunarListModelSortType;
+
+/* everything required to compare two rows, precomputed
+ * and stored in one flat array when sorting the model */
+typedef struct
+{
+  guint64        prefix;        /* first bytes of collate_key, see thunar_list_model_collate_prefix() */
+  guint64        prefix_nocase; /* same for collate_key_nocase */
+  const gchar   *collate_key;
+  const gchar   *collate_key_nocase;
+  guint64        value;
+  ThunarFile    *file;
+  GSequenceIter *row;
+  gint           position;
+  gboolean       is_directory;
+}
+ThunarListModelSortKey;
+
+typedef struct
+{
+  ThunarListModelSortType type;
+  ThunarSortFunc          sort_func;
+  ThunarFileDateType      date_type;
+  gboolean                case_sensitive;
+  gboolean                folders_first;
+  gint                    sort_sign;
+}
+ThunarListModelSortContext;
+
+typedef struct
+{
+  ThunarListModelSortKey     *keys;
+  gint                        n_keys;
+  ThunarListModelSortContext *context;
+}
+ThunarListModelSortChunk;
+
+/* the rows in the order of one sort setting, always ascending; the
+ * descending order is the same backwards, with the folders in front */
+typedef struct
+{
+  ThunarSortFunc   sort_func;
+  gboolean         case_sensitive;
+  gboolean         folders_first;
+  GSequenceIter  **rows;
+  gint             n_rows;
+  gint             n_directories;
+}
+ThunarListModelSortPermutation;
 
 struct _ThunarListModelClass
 {
@@ -227,10 +320,25 @@ struct _ThunarListModel
 
   GSequence               *rows;
   GSList                  *hidden;
+
+  /* running counts of the rows for the statusbar text */
+  ThunarStandardViewModelTotals *totals;
+
+  /* for big folders, GtkTreeView's constant position lookups are served
+   * from a flat index over the rows instead of walking the GSequence.
+   * The index is dropped on changes and rebuilt once enough lookups
+   * were made to pay off the rebuild.
+   */
+  GPtrArray               *row_index;      /* position -> GSequenceIter */
+  GHashTable              *row_positions;  /* GSequenceIter -> position + 1 */
+  guint                    row_index_lookups;
   ThunarFolder            *folder;
   gboolean                 show_hidden : 1;
   ThunarFolderItemCount    folder_item_count;
   gboolean                 file_size_binary : 1;
+
+  /* folders show and sort by their cumulative size, see thunar-disk-usage.c */
+  gboolean                 disk_usage : 1;
   ThunarDateStyle          date_style;
   char                    *date_custom_style;
 
@@ -240,6 +348,17 @@ struct _ThunarListModel
    */
   gchar **search_terms;
 
+  /* a query that only concerns the names of the files in the folder
+   * filters the files already loaded instead of starting a search job.
+   * The files not matching the filter are stashed aside, like the
+   * hidden files, and typing on refines the filter over the rows.
+   */
+  gchar               *filter_query; /* normalized */
+  gchar              **filter_terms;
+  ThunarSearchMatcher *filter_matcher;
+  GHashTable          *filtered;
+  guint                filter_done_id;
+
   /* ids for the "row-inserted" and "row-deleted" signals
    * of GtkTreeModel to speed up folder changing.
    */
@@ -251,21 +370,28 @@ struct _ThunarListModel
   gint           sort_sign;   /* 1 = ascending, -1 descending */
   ThunarSortFunc sort_func;
 
-  /* searching runs in a separate thread which incrementally inserts results (files)
-   * in the files_to_add list.
-   * Periodically the main thread takes all the files in the files_to_add list
-   * and adds them in the model. The list is then emptied.
-   */
-  ThunarJob     *recursive_search_job;
-  GList         *files_to_add;
-  GMutex         mutex_files_to_add;
-
-  /* used to stop the periodic call to thunar_list_model_add_search_files when the search is finished/canceled */
-  guint          update_search_results_timeout_id;
+  /* searching runs in a separate thread which incrementally pushes results (files)
+   * into the results channel, which periodically hands them to the model */
+  ThunarJob                      *recursive_search_job;
+  ThunarStandardViewModelResults *search_results;
 
   /* Tells if the model is yet loading the set folder */
   gboolean       loading;
 
+  /* while loading, files are queued and appended to the rows in
+   * time-sliced chunks from an idle source, without keeping the
+   * rows sorted. The rows are sorted once the folder is loaded.
+   */
+  GQueue         queued_files;
+  guint          queue_idle_id;
+  gboolean       rows_unsorted;
+
+  /* the recently applied ThunarListModelSortPermutations, the most
+   * recent first; only valid as long as no row is added, removed or
+   * changed, see thunar_list_model_sort_cache_clear()
+   */
+  GQueue         sort_cache;
+
   /* indicates that file was removed or sorted */
   gboolean       file_was_removed;
   gboolean       file_was_sorted;
@@ -415,6 +541,7 @@ thunar_list_model_standard_view_model_init (ThunarStandardViewModelIface *iface)
   iface->set_file_size_binary = thunar_list_model_set_file_size_binary;
   iface->set_folders_first = thunar_list_model_set_folders_first;
   iface->add_search_files = thunar_list_model_add_search_files;
+  iface->get_totals = thunar_list_model_get_totals;
 }
 
 
@@ -477,7 +604,11 @@ thunar_list_model_init (ThunarListModel *store)
   store->sort_sign = 1;
   store->sort_func = thunar_file_compare_by_name;
   store->rows = g_sequence_new (g_object_unref);
-  g_mutex_init (&store->mutex_files_to_add);
+  store->totals = thunar_standard_view_model_totals_new ();
+  store->search_results = thunar_standard_view_model_results_new (thunar_list_model_insert_search_files, store);
+  store->filtered = g_hash_table_new_full (g_direct_hash, g_direct_equal, g_object_unref, NULL);
+  g_queue_init (&store->queued_files);
+  g_queue_init (&store->sort_cache);
 
   store->loading = FALSE;
 }
@@ -501,22 +632,20 @@ thunar_list_model_finalize (GObject *object)
   ThunarListModel *store = THUNAR_LIST_MODEL (object);
 
   thunar_list_model_cancel_search_job (store);
+  thunar_standard_view_model_results_free (store->search_results);
 
-  if (store->update_search_results_timeout_id > 0)
-    {
-      g_source_remove (store->update_search_results_timeout_id);
-      store->update_search_results_timeout_id = 0;
-    }
-  thunar_g_list_free_full (store->files_to_add);
-  store->files_to_add = NULL;
-
+  thunar_list_model_row_index_invalidate (store);
+  thunar_list_model_sort_cache_clear (store);
   g_sequence_free (store->rows);
-  g_mutex_clear (&store->mutex_files_to_add);
+  thunar_standard_view_model_totals_free (store->totals);
 
   g_free (store->date_custom_style);
 
   g_strfreev (store->search_terms);
 
+  thunar_list_model_clear_filter (store);
+  g_hash_table_destroy (store->filtered);
+
   (*G_OBJECT_CLASS (thunar_list_model_parent_class)->finalize) (object);
 }
 
@@ -721,7 +850,7 @@ thunar_list_model_get_iter (GtkTreeModel *model,
 
   /* determine the row for the path */
   offset = gtk_tree_path_get_indices (path)[0];
-  row = g_sequence_get_iter_at_pos (store->rows, offset);
+  row = thunar_list_model_row_at (store, offset);
 
   if (!g_sequence_iter_is_end (row))
     {
@@ -743,7 +872,7 @@ thunar_list_model_get_path (GtkTreeModel *model,
   _thunar_return_val_if_fail (THUNAR_IS_LIST_MODEL (model), NULL);
   _thunar_return_val_if_fail (iter->stamp == THUNAR_LIST_MODEL (model)->stamp, NULL);
 
-  idx = g_sequence_iter_get_position (iter->user_data);
+  idx = thunar_list_model_row_position (THUNAR_LIST_MODEL (model), iter->user_data);
   if (G_LIKELY (idx >= 0))
     return gtk_tree_path_new_from_indices (idx, -1);
 
@@ -752,6 +881,30 @@ thunar_list_model_get_path (GtkTreeModel *model,
 
 
 
+static gboolean
+thunar_list_model_memoize_column (ThunarFile *file,
+                                   gint        column)
+{
+  switch (column)
+    {
+    case THUNAR_COLUMN_GROUP:
+    case THUNAR_COLUMN_OWNER:
+    case THUNAR_COLUMN_PERMISSIONS:
+    case THUNAR_COLUMN_SIZE_IN_BYTES:
+    case THUNAR_COLUMN_TYPE:
+      return TRUE;
+
+    case THUNAR_COLUMN_SIZE:
+      /* item counts and free space change without the file changing */
+      return !thunar_file_is_mountable (file) && !thunar_file_is_directory (file);
+
+    default:
+      return FALSE;
+    }
+}
+
+
+
 static void
 thunar_list_model_get_value (GtkTreeModel *model,
                              GtkTreeIter  *iter,
@@ -766,9 +919,14 @@ thunar_list_model_get_value (GtkTreeModel *model,
   ThunarFile   *file;
   ThunarFolder *folder;
   gchar        *str;
+  const gchar  *memoized;
+  gchar        *size_string;
   guint32       item_count;
+  guint64       size;
+  gboolean      complete;
   GFile        *g_file;
   GFile        *g_file_parent;
+  gboolean      memoize;
 
   _thunar_return_if_fail (THUNAR_IS_LIST_MODEL (model));
   _thunar_return_if_fail (iter->stamp == (THUNAR_LIST_MODEL (model))->stamp);
@@ -805,6 +963,19 @@ thunar_list_model_get_value (GtkTreeModel *model,
   file = g_sequence_get (iter->user_data);
   _thunar_return_if_fail (THUNAR_IS_FILE (file));
 
+  /* reuse the string formatted for an earlier query, until the file changes */
+  memoize = thunar_list_model_memoize_column (file, column);
+  if (memoize)
+    {
+      memoized = thunar_file_get_column_string (file, column, THUNAR_LIST_MODEL (model)->file_size_binary);
+      if (memoized != NULL)
+        {
+          g_value_init (value, G_TYPE_STRING);
+          g_value_set_string (value, memoized);
+          return;
+        }
+    }
+
   switch (column)
     {
     case THUNAR_COLUMN_DATE_CREATED:
@@ -890,7 +1061,9 @@ thunar_list_model_get_value (GtkTreeModel *model,
       group = thunar_file_get_group (file);
       if (G_LIKELY (group != NULL))
         {
-          g_value_set_string (value, thunar_group_get_name (group));
+          /* don't block the redraw on the name service, and don't keep the placeholder */
+          g_value_set_string (value, thunar_group_peek_name (group));
+          memoize = memoize && thunar_group_is_resolved (group);
           g_object_unref (G_OBJECT (group));
         }
       else
@@ -914,9 +1087,10 @@ thunar_list_model_get_value (GtkTreeModel *model,
       user = thunar_file_get_user (file);
       if (G_LIKELY (user != NULL))
         {
-          /* determine sane display name for the owner */
-          name = thunar_user_get_name (user);
-          real_name = thunar_user_get_real_name (user);
+          /* determine sane display name for the owner, see the group above */
+          name = thunar_user_peek_name (user);
+          real_name = thunar_user_peek_real_name (user);
+          memoize = memoize && thunar_user_is_resolved (user);
           if(G_LIKELY (real_name != NULL))
             {
               if(strcmp (name, real_name) == 0)
@@ -952,6 +1126,18 @@ thunar_list_model_get_value (GtkTreeModel *model,
           g_object_unref (g_file);
           break;
         }
+      else if (thunar_file_is_directory (file) && THUNAR_LIST_MODEL (model)->disk_usage)
+        {
+          size = thunar_disk_usage_get_size (file, &complete);
+          size_string = g_format_size_full (size, THUNAR_LIST_MODEL (model)->file_size_binary ? G_FORMAT_SIZE_IEC_UNITS : G_FORMAT_SIZE_DEFAULT);
+          if (complete)
+            g_value_take_string (value, size_string);
+          else
+            {
+              g_value_take_string (value, g_strdup_printf (_("%s (counting)"), size_string));
+              g_free (size_string);
+            }
+        }
       else if (thunar_file_is_directory (file))
         {
           /* If the option is set to never show folder sizes as item counts, then just give the folder's binary size */
@@ -961,7 +1147,7 @@ thunar_list_model_get_value (GtkTreeModel *model,
           /* If the option is set to always show folder sizes as item counts, then give the folder's item count */
           else if (THUNAR_LIST_MODEL (model)->folder_item_count == THUNAR_FOLDER_ITEM_COUNT_ALWAYS)
             {
-              item_count = thunar_file_get_file_count (file, G_CALLBACK (thunar_list_model_file_count_callback), model);
+              item_count = thunar_file_get_file_count (file, TRUE);
               g_value_take_string (value, g_strdup_printf (ngettext ("%u item", "%u items", item_count), item_count));
             }
 
@@ -971,7 +1157,7 @@ thunar_list_model_get_value (GtkTreeModel *model,
             {
               if (thunar_file_is_local (file))
                 {
-                  item_count = thunar_file_get_file_count (file, G_CALLBACK (thunar_list_model_file_count_callback), model);
+                  item_count = thunar_file_get_file_count (file, TRUE);
                   g_value_take_string (value, g_strdup_printf (ngettext ("%u item", "%u items", item_count), item_count));
                 }
               else
@@ -1016,6 +1202,9 @@ thunar_list_model_get_value (GtkTreeModel *model,
       _thunar_assert_not_reached ();
       break;
     }
+
+  if (memoize)
+    thunar_file_set_column_string (file, column, THUNAR_LIST_MODEL (model)->file_size_binary, g_value_dup_string (value));
 }
 
 
@@ -1089,7 +1278,7 @@ thunar_list_model_iter_nth_child (GtkTreeModel *model,
 
   if (G_LIKELY (parent == NULL))
     {
-      row = g_sequence_get_iter_at_pos (store->rows, n);
+      row = thunar_list_model_row_at (store, n);
       if (g_sequence_iter_is_end (row))
         return FALSE;
 
@@ -1147,7 +1336,8 @@ thunar_list_model_get_sort_column_id (GtkTreeSortable *sortable,
     *sort_column_id = THUNAR_COLUMN_NAME;
   else if (store->sort_func == thunar_cmp_files_by_permissions)
     *sort_column_id = THUNAR_COLUMN_PERMISSIONS;
-  else if (store->sort_func == thunar_cmp_files_by_size || store->sort_func == (ThunarSortFunc) thunar_cmp_files_by_size_and_items_count)
+  else if (store->sort_func == thunar_cmp_files_by_size || store->sort_func == (ThunarSortFunc) thunar_cmp_files_by_size_and_items_count
+           || store->sort_func == thunar_disk_usage_compare)
     *sort_column_id = THUNAR_COLUMN_SIZE;
   else if (store->sort_func == thunar_cmp_files_by_size_in_bytes)
     *sort_column_id = THUNAR_COLUMN_SIZE_IN_BYTES;
@@ -1242,6 +1432,11 @@ thunar_list_model_set_sort_column_id (GtkTreeSortable *sortable,
       break;
 
     case THUNAR_COLUMN_SIZE:
+      if (store->disk_usage)
+        {
+          store->sort_func = thunar_disk_usage_compare;
+          break;
+        }
       store->sort_func = (store->folder_item_count != THUNAR_FOLDER_ITEM_COUNT_NEVER) ? (ThunarSortFunc) thunar_cmp_files_by_size_and_items_count : thunar_cmp_files_by_size;
       break;
 
@@ -1325,48 +1520,401 @@ thunar_list_model_cmp_func (gconstpointer a,
 
 
 
+static inline guint64
+thunar_list_model_collate_prefix (const gchar *collate_key)
+{
+  guint64 prefix = 0;
+  guint   n;
+
+  /* pack the first 8 bytes of the key big-endian into an integer,
+   * padded with zeros. strcmp() compares unsigned bytes and a key
+   * never contains a nul byte before its end, so two different
+   * prefixes order exactly like their keys and only equal prefixes
+   * need the full string comparison */
+  if (G_LIKELY (collate_key != NULL))
+    for (n = 0; n < sizeof (prefix) && collate_key[n] != '\0'; ++n)
+      prefix |= (guint64) (guchar) collate_key[n] << (8 * (sizeof (prefix) - 1 - n));
+
+  return prefix;
+}
+
+
+
+static gint
+thunar_list_model_sort_key_cmp (gconstpointer a,
+                                gconstpointer b,
+                                gpointer      user_data)
+{
+  const ThunarListModelSortKey     *key_a = a;
+  const ThunarListModelSortKey     *key_b = b;
+  const ThunarListModelSortContext *context = user_data;
+  gint                              result = 0;
+
+  /* see thunar_list_model_cmp_func() */
+  if (G_LIKELY (context->folders_first) && key_a->is_directory != key_b->is_directory)
+    return key_a->is_directory ? -1 : 1;
+
+  if (G_UNLIKELY (context->type == THUNAR_LIST_MODEL_SORT_BY_FUNC))
+    return (*context->sort_func) (key_a->file, key_b->file, context->case_sensitive) * context->sort_sign;
+
+  if (context->type == THUNAR_LIST_MODEL_SORT_BY_VALUE && key_a->value != key_b->value)
+    return (key_a->value < key_b->value ? -1 : 1) * context->sort_sign;
+
+  /* same as thunar_file_compare_by_name(), without touching the files;
+   * most rows are already settled by the integer prefixes */
+  if (G_LIKELY (!context->case_sensitive))
+    {
+      if (key_a->prefix_nocase != key_b->prefix_nocase)
+        return (key_a->prefix_nocase < key_b->prefix_nocase ? -1 : 1) * context->sort_sign;
+      result = g_strcmp0 (key_a->collate_key_nocase, key_b->collate_key_nocase);
+    }
+  if (result == 0)
+    {
+      if (key_a->prefix != key_b->prefix)
+        return (key_a->prefix < key_b->prefix ? -1 : 1) * context->sort_sign;
+      result = g_strcmp0 (key_a->collate_key, key_b->collate_key);
+    }
+
+  /* let the file sort out the rare case of equal names (e.g. in the trash) */
+  if (G_UNLIKELY (result == 0))
+    result = thunar_file_compare_by_name (key_a->file, key_b->file, TRUE);
+
+  return result * context->sort_sign;
+}
+
+
+
+static gpointer
+thunar_list_model_sort_chunk (gpointer user_data)
+{
+  ThunarListModelSortChunk *chunk = user_data;
+
+  g_qsort_with_data (chunk->keys, chunk->n_keys, sizeof (ThunarListModelSortKey),
+                     thunar_list_model_sort_key_cmp, chunk->context);
+
+  return NULL;
+}
+
+
+
+static void
+thunar_list_model_sort_keys (ThunarListModelSortKey     *keys,
+                             gint                        n_keys,
+                             ThunarListModelSortContext *context)
+{
+  ThunarListModelSortChunk  chunks[THUNAR_LIST_MODEL_MAX_SORT_THREADS];
+  GThread                  *threads[THUNAR_LIST_MODEL_MAX_SORT_THREADS];
+  ThunarListModelSortKey   *buffer;
+  ThunarListModelSortKey   *src, *dst, *tmp;
+  gint                      n_threads = 1;
+  gint                      chunk_size;
+  gint                      width;
+  gint                      lo, mid, hi;
+  gint                      i, j, k;
+  gint                      n;
+
+  /* the sort function may touch the files in ways that are not
+   * safe outside the main thread, only split the keyed sorts */
+  if (context->type != THUNAR_LIST_MODEL_SORT_BY_FUNC
+      && n_keys >= THUNAR_LIST_MODEL_PARALLEL_SORT_THRESHOLD)
+    n_threads = CLAMP ((gint) g_get_num_processors (), 1, THUNAR_LIST_MODEL_MAX_SORT_THREADS);
+
+  if (n_threads <= 1)
+    {
+      g_qsort_with_data (keys, n_keys, sizeof (ThunarListModelSortKey),
+                         thunar_list_model_sort_key_cmp, context);
+      return;
+    }
+
+  /* sort equally sized chunks in parallel, the main thread takes the last one */
+  chunk_size = (n_keys + n_threads - 1) / n_threads;
+  for (n = 0; n < n_threads; n++)
+    {
+      chunks[n].keys = keys + n * chunk_size;
+      chunks[n].n_keys = MIN (chunk_size, n_keys - n * chunk_size);
+      chunks[n].context = context;
+
+      threads[n] = NULL;
+      if (n < n_threads - 1)
+        threads[n] = g_thread_try_new ("thunar-sort", thunar_list_model_sort_chunk, &chunks[n], NULL);
+      if (threads[n] == NULL)
+        thunar_list_model_sort_chunk (&chunks[n]);
+    }
+
+  for (n = 0; n < n_threads; n++)
+    if (threads[n] != NULL)
+      g_thread_join (threads[n]);
+
+  /* merge the sorted chunks bottom-up, keeping the sort stable */
+  buffer = g_new (ThunarListModelSortKey, n_keys);
+  src = keys;
+  dst = buffer;
+  for (width = chunk_size; width < n_keys; width *= 2)
+    {
+      for (lo = 0; lo < n_keys; lo += 2 * width)
+        {
+          mid = MIN (lo + width, n_keys);
+          hi = MIN (lo + 2 * width, n_keys);
+
+          for (i = lo, j = mid, k = lo; k < hi; k++)
+            {
+              if (j >= hi || (i < mid && thunar_list_model_sort_key_cmp (&src[i], &src[j], context) <= 0))
+                dst[k] = src[i++];
+              else
+                dst[k] = src[j++];
+            }
+        }
+
+      tmp = src;
+      src = dst;
+      dst = tmp;
+    }
+
+  if (src != keys)
+    memcpy (keys, src, n_keys * sizeof (ThunarListModelSortKey));
+
+  g_free (buffer);
+}
+
+
+
+static void
+thunar_list_model_sort_context_init (ThunarListModel            *store,
+                                     ThunarListModelSortContext *context)
+{
+  context->sort_func = store->sort_func;
+  context->date_type = THUNAR_FILE_DATE_MODIFIED;
+  context->case_sensitive = store->sort_case_sensitive;
+  context->folders_first = store->sort_folders_first;
+  context->sort_sign = store->sort_sign;
+
+  /* check which of the sort functions can be replaced by precomputed keys */
+  context->type = THUNAR_LIST_MODEL_SORT_BY_VALUE;
+  if (store->sort_func == thunar_file_compare_by_name)
+    context->type = THUNAR_LIST_MODEL_SORT_BY_NAME;
+  else if (store->sort_func == thunar_cmp_files_by_date_created)
+    context->date_type = THUNAR_FILE_DATE_CREATED;
+  else if (store->sort_func == thunar_cmp_files_by_date_accessed)
+    context->date_type = THUNAR_FILE_DATE_ACCESSED;
+  else if (store->sort_func == thunar_cmp_files_by_date_modified)
+    context->date_type = THUNAR_FILE_DATE_MODIFIED;
+  else if (store->sort_func == thunar_cmp_files_by_date_deleted)
+    context->date_type = THUNAR_FILE_DATE_DELETED;
+  else if (store->sort_func == thunar_cmp_files_by_recency)
+    context->date_type = THUNAR_FILE_RECENCY;
+  else if (store->sort_func != thunar_cmp_files_by_size
+           && store->sort_func != thunar_cmp_files_by_size_in_bytes
+           && store->sort_func != thunar_disk_usage_compare)
+    context->type = THUNAR_LIST_MODEL_SORT_BY_FUNC;
+}
+
+
+
+static void
+thunar_list_model_sort_key_init (ThunarListModelSortKey           *key,
+                                 const ThunarListModelSortContext *context,
+                                 ThunarFile                       *file,
+                                 GSequenceIter                    *row,
+                                 gint                              position)
+{
+  key->file = file;
+  key->row = row;
+  key->position = position;
+  key->is_directory = thunar_file_is_directory (file);
+  key->collate_key = thunar_file_get_collate_key (file, TRUE);
+  key->collate_key_nocase = thunar_file_get_collate_key (file, FALSE);
+  key->prefix = thunar_list_model_collate_prefix (key->collate_key);
+  key->prefix_nocase = thunar_list_model_collate_prefix (key->collate_key_nocase);
+
+  if (context->type != THUNAR_LIST_MODEL_SORT_BY_VALUE)
+    key->value = 0;
+  else if (context->sort_func == thunar_cmp_files_by_size
+           || context->sort_func == thunar_cmp_files_by_size_in_bytes)
+    key->value = thunar_file_get_size (file);
+  else if (context->sort_func == thunar_disk_usage_compare)
+    key->value = thunar_disk_usage_get_size (file, NULL);
+  else
+    key->value = thunar_file_get_date (file, context->date_type);
+}
+
+
+
+static gint
+thunar_list_model_sort_permutation_index (const ThunarListModelSortPermutation *permutation,
+                                          gint                                  n,
+                                          gint                                  sort_sign)
+{
+  gint n_directories = permutation->folders_first ? permutation->n_directories : 0;
+
+  if (sort_sign > 0)
+    return n;
+
+  /* reverse the folders and the files on their own, the mapping is its own inverse */
+  if (n < n_directories)
+    return n_directories - 1 - n;
+
+  return permutation->n_rows - 1 - n + n_directories;
+}
+
+
+
+static void
+thunar_list_model_sort_permutation_free (gpointer data)
+{
+  ThunarListModelSortPermutation *permutation = data;
+
+  g_free (permutation->rows);
+  g_slice_free (ThunarListModelSortPermutation, permutation);
+}
+
+
+
+static void
+thunar_list_model_sort_cache_clear (ThunarListModel *store)
+{
+  g_queue_clear_full (&store->sort_cache, thunar_list_model_sort_permutation_free);
+}
+
+
+
+static ThunarListModelSortPermutation *
+thunar_list_model_sort_cache_lookup (ThunarListModel                  *store,
+                                     const ThunarListModelSortContext *context)
+{
+  ThunarListModelSortPermutation *permutation;
+  GList                          *lp;
+
+  for (lp = store->sort_cache.head; lp != NULL; lp = lp->next)
+    {
+      permutation = lp->data;
+      if (permutation->sort_func == context->sort_func
+          && permutation->case_sensitive == context->case_sensitive
+          && permutation->folders_first == context->folders_first)
+        {
+          /* keep the most recently used order in front */
+          g_queue_unlink (&store->sort_cache, lp);
+          g_queue_push_head_link (&store->sort_cache, lp);
+          return permutation;
+        }
+    }
+
+  return NULL;
+}
+
+
+
+static void
+thunar_list_model_sort_cache_add (ThunarListModel                  *store,
+                                  const ThunarListModelSortContext *context,
+                                  const ThunarListModelSortKey     *keys,
+                                  gint                              n_keys)
+{
+  ThunarListModelSortPermutation *permutation;
+  gint                            n;
+
+  permutation = g_slice_new (ThunarListModelSortPermutation);
+  permutation->sort_func = context->sort_func;
+  permutation->case_sensitive = context->case_sensitive;
+  permutation->folders_first = context->folders_first;
+  permutation->rows = g_new (GSequenceIter *, n_keys);
+  permutation->n_rows = n_keys;
+  permutation->n_directories = 0;
+
+  for (n = 0; n < n_keys; ++n)
+    if (keys[n].is_directory)
+      permutation->n_directories++;
+
+  /* remember the keys in ascending order */
+  for (n = 0; n < n_keys; ++n)
+    permutation->rows[thunar_list_model_sort_permutation_index (permutation, n, context->sort_sign)] = keys[n].row;
+
+  g_queue_push_head (&store->sort_cache, permutation);
+  while (store->sort_cache.length > THUNAR_LIST_MODEL_SORT_CACHE_SIZE)
+    thunar_list_model_sort_permutation_free (g_queue_pop_tail (&store->sort_cache));
+}
+
+
+
 static void
 thunar_list_model_sort (ThunarListModel *store)
 {
-  GtkTreePath    *path;
-  GSequenceIter **old_order;
-  gint           *new_order;
-  gint            n;
-  gint            length;
-  GSequenceIter  *row;
+  ThunarListModelSortPermutation *permutation;
+  ThunarListModelSortContext      context;
+  ThunarListModelSortKey         *keys;
+  GtkTreePath                    *path;
+  GHashTable                     *positions;
+  GSequenceIter                  *row;
+  GSequenceIter                  *end;
+  gint                           *new_order;
+  gint                            n;
+  gint                            length;
 
   _thunar_return_if_fail (THUNAR_IS_LIST_MODEL (store));
 
+  /* rows appended from now on are unsorted again */
+  store->rows_unsorted = FALSE;
+
   length = g_sequence_get_length (store->rows);
   if (G_UNLIKELY (length <= 1))
     return;
 
   /* be sure to not overuse the stack */
   if (G_LIKELY (length < STACK_ALLOC_LIMIT))
+    new_order = g_newa (gint, length);
+  else
+    new_order = g_new (gint, length);
+
+  thunar_list_model_sort_context_init (store, &context);
+
+  keys = g_new (ThunarListModelSortKey, length);
+
+  permutation = thunar_list_model_sort_cache_lookup (store, &context);
+  if (permutation != NULL && permutation->n_rows == length)
     {
-      old_order = g_newa (GSequenceIter *, length);
-      new_order = g_newa (gint, length);
+      /* the rows did not change since they were sorted this way, only
+       * look up the current positions of the rows, nothing is compared */
+      positions = g_hash_table_new (g_direct_hash, g_direct_equal);
+      row = g_sequence_get_begin_iter (store->rows);
+      for (n = 0; n < length; ++n)
+        {
+          g_hash_table_insert (positions, row, GINT_TO_POINTER (n));
+          row = g_sequence_iter_next (row);
+        }
+
+      for (n = 0; n < length; ++n)
+        {
+          keys[n].row = permutation->rows[thunar_list_model_sort_permutation_index (permutation, n, context.sort_sign)];
+          keys[n].position = GPOINTER_TO_INT (g_hash_table_lookup (positions, keys[n].row));
+        }
+
+      g_hash_table_destroy (positions);
     }
   else
     {
-      old_order = g_new (GSequenceIter *, length);
-      new_order = g_new (gint, length);
+      /* collect the keys of all rows in their current order */
+      row = g_sequence_get_begin_iter (store->rows);
+      for (n = 0; n < length; ++n)
+        {
+          thunar_list_model_sort_key_init (&keys[n], &context, g_sequence_get (row), row, n);
+          row = g_sequence_iter_next (row);
+        }
+
+      /* sort */
+      thunar_list_model_sort_keys (keys, length, &context);
+      thunar_list_model_sort_cache_add (store, &context, keys, length);
     }
 
-  /* store old order */
-  row = g_sequence_get_begin_iter (store->rows);
+  /* apply the permutation by moving the rows to the end in their new
+   * order, that way all iters stay valid; new_order[newpos] = oldpos */
+  end = g_sequence_get_end_iter (store->rows);
   for (n = 0; n < length; ++n)
     {
-      old_order[n] = row;
-      row = g_sequence_iter_next (row);
+      g_sequence_move (keys[n].row, end);
+      new_order[n] = keys[n].position;
     }
 
-  /* sort */
-  g_sequence_sort (store->rows, thunar_list_model_cmp_func, store);
-
-  /* new_order[newpos] = oldpos */
-  for (n = 0; n < length; ++n)
-    new_order[g_sequence_iter_get_position (old_order[n])] = n;
+  g_free (keys);
+  thunar_list_model_row_index_invalidate (store);
 
   /* tell the view about the new item order */
   path = gtk_tree_path_new_first ();
@@ -1375,10 +1923,7 @@ thunar_list_model_sort (ThunarListModel *store)
 
   /* clean up if we used the heap */
   if (G_UNLIKELY (length >= STACK_ALLOC_LIMIT))
-    {
-      g_free (old_order);
-      g_free (new_order);
-    }
+    g_free (new_order);
 }
 
 
@@ -1409,10 +1954,10 @@ thunar_list_model_files_changed (ThunarFolder    *folder,
       file = lp->data;
       row = g_sequence_get_begin_iter (store->rows);
       end = g_sequence_get_end_iter (store->rows);
+      found = FALSE;
 
       while (row != end)
         {
-          pos_before = g_sequence_iter_get_position (row);
           if (G_UNLIKELY (g_sequence_get (row) == file))
             {
               found = TRUE;
@@ -1431,17 +1976,34 @@ thunar_list_model_files_changed (ThunarFolder    *folder,
                   return;
                 }
 
+              /* the file was renamed to a name not matching the filter */
+              if (!thunar_list_model_filter_matches (store, file))
+                {
+                  node.data = file;
+                  node.next = NULL;
+                  node.prev = NULL;
+                  thunar_list_model_files_removed (store->folder, &node, store);
+                  g_hash_table_add (store->filtered, g_object_ref (file));
+                  break;
+                }
+
+              /* the size or type of the file may have changed */
+              thunar_standard_view_model_totals_changed (store->totals, file);
+              thunar_list_model_sort_cache_clear (store);
+
               /* generate the iterator for this row */
               GTK_TREE_ITER_INIT (iter, store->stamp, row);
               
               /* check if the sorting changed */
-              pos_before = g_sequence_iter_get_position (row);
+              pos_before = thunar_list_model_row_position (store, row);
               g_sequence_sort_changed (row, thunar_list_model_cmp_func, store);
               pos_after = g_sequence_iter_get_position (row);
 
               /* if 'g_sequence_sort_changed' changed the sorting, the positions will differ now */
               if (pos_after != pos_before)
                 {
+                  thunar_list_model_row_index_invalidate (store);
+
                   /* do swap sorting here since its much faster than a complete sort */
                   length = g_sequence_get_length (store->rows);
                   if (G_LIKELY (length < STACK_ALLOC_LIMIT))
@@ -1490,6 +2052,22 @@ thunar_list_model_files_changed (ThunarFolder    *folder,
       if (found)
         continue;
 
+      /* maybe this file was renamed to a name matching the filter,
+       * or is a hidden file now, which belongs to the hidden list */
+      if (g_hash_table_contains (store->filtered, file))
+        {
+          if (thunar_list_model_filter_matches (store, file)
+              || (!store->show_hidden && thunar_file_is_hidden (file)))
+            {
+              node.data = file;
+              node.next = NULL;
+              node.prev = NULL;
+              g_hash_table_remove (store->filtered, file);
+              thunar_list_model_insert_files (store, &node);
+            }
+          continue;
+        }
+
       /* maybe this file was a hidden file but now it's not
       * in such a case we need to emit a "files-added" for this file
       * and remove it from the hidden list */
@@ -1547,8 +2125,9 @@ thunar_list_model_notify_loading (ThunarFolder    *folder,
   _thunar_return_if_fail (THUNAR_IS_FOLDER (folder));
   _thunar_return_if_fail (THUNAR_IS_LIST_MODEL (model));
 
-  if (!thunar_folder_get_loading (folder))
-    thunar_list_model_set_loading (model, FALSE);
+  /* if files are still queued, the idle source finishes loading */
+  if (!thunar_folder_get_loading (folder) && model->queue_idle_id == 0)
+    thunar_list_model_finish_loading (model);
 }
 
 
@@ -1567,7 +2146,11 @@ thunar_list_model_files_added (ThunarFolder    *folder,
   /* pass the list directly if not currently showing search results */
   if (store->search_terms == NULL)
     {
-      thunar_list_model_insert_files (store, files);
+      /* stream the files into the model while the folder is loading */
+      if (store->loading)
+        thunar_list_model_queue_files (store, files);
+      else
+        thunar_list_model_insert_files (store, files);
       return;
     }
 
@@ -1637,11 +2220,19 @@ thunar_list_model_insert_files (ThunarListModel *store,
           else
             g_object_unref (file);
         }
+      else if (!thunar_list_model_filter_matches (store, file))
+        {
+          /* the set takes over the reference */
+          g_hash_table_add (store->filtered, file);
+        }
       else
         {
           /* insert the file */
           row = g_sequence_insert_sorted (store->rows, file,
                                           thunar_list_model_cmp_func, store);
+          thunar_list_model_row_index_invalidate (store);
+          thunar_list_model_sort_cache_clear (store);
+          thunar_standard_view_model_totals_add (store->totals, file);
 
           if (has_handler)
             {
@@ -1664,41 +2255,269 @@ thunar_list_model_insert_files (ThunarListModel *store,
 
 
 static void
-thunar_list_model_files_removed (ThunarFolder    *folder,
-                                 GList           *files,
-                                 ThunarListModel *store)
+thunar_list_model_row_index_invalidate (ThunarListModel *store)
 {
-  GList         *lp;
-  GSequenceIter *row;
-  GSequenceIter *end;
-  GSequenceIter *next;
-  GtkTreePath   *path;
-  gboolean       found;
-  gboolean       search_mode;
-
-  /* drop all the referenced files from the model */
-  search_mode = (store->search_terms != NULL);
-  for (lp = files; lp != NULL; lp = lp->next)
+  if (store->row_index != NULL)
     {
-      row = g_sequence_get_begin_iter (store->rows);
-      end = g_sequence_get_end_iter (store->rows);
+      g_ptr_array_unref (store->row_index);
+      g_hash_table_destroy (store->row_positions);
+      store->row_index = NULL;
+      store->row_positions = NULL;
+    }
 
-      found = FALSE;
+  store->row_index_lookups = 0;
+}
 
-      while (row != end)
-        {
-          next = g_sequence_iter_next (row);
 
-          if (g_sequence_get (row) == lp->data)
+
+static gboolean
+thunar_list_model_row_index_ensure (ThunarListModel *store)
+{
+  GSequenceIter *row;
+  GSequenceIter *end;
+  guint          length;
+
+  if (G_LIKELY (store->row_index != NULL))
+    return TRUE;
+
+  /* small folders do fine with the GSequence lookups */
+  length = g_sequence_get_length (store->rows);
+  if (length < THUNAR_LIST_MODEL_ROW_INDEX_THRESHOLD)
+    return FALSE;
+
+  /* building the index is O(n), only do it once plenty of lookups
+   * were made since the last change, so a row change followed by
+   * a few redraws does not rebuild it over and over again */
+  if (++store->row_index_lookups < length / THUNAR_LIST_MODEL_ROW_INDEX_AMORTIZE)
+    return FALSE;
+
+  store->row_index = g_ptr_array_sized_new (length);
+  store->row_positions = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+  end = g_sequence_get_end_iter (store->rows);
+  for (row = g_sequence_get_begin_iter (store->rows); row != end; row = g_sequence_iter_next (row))
+    {
+      g_ptr_array_add (store->row_index, row);
+      g_hash_table_insert (store->row_positions, row, GUINT_TO_POINTER (store->row_index->len));
+    }
+
+  return TRUE;
+}
+
+
+
+static GSequenceIter *
+thunar_list_model_row_at (ThunarListModel *store,
+                          gint             position)
+{
+  if (thunar_list_model_row_index_ensure (store))
+    {
+      if (position >= 0 && (guint) position < store->row_index->len)
+        return g_ptr_array_index (store->row_index, position);
+      return g_sequence_get_end_iter (store->rows);
+    }
+
+  return g_sequence_get_iter_at_pos (store->rows, position);
+}
+
+
+
+static gint
+thunar_list_model_row_position (ThunarListModel *store,
+                                GSequenceIter   *row)
+{
+  guint position;
+
+  if (thunar_list_model_row_index_ensure (store))
+    {
+      position = GPOINTER_TO_UINT (g_hash_table_lookup (store->row_positions, row));
+      if (G_LIKELY (position > 0))
+        return position - 1;
+    }
+
+  return g_sequence_iter_get_position (row);
+}
+
+
+
+static void
+thunar_list_model_queue_files (ThunarListModel *store,
+                               GList           *files)
+{
+  GList *lp;
+
+  for (lp = files; lp != NULL; lp = lp->next)
+    {
+      _thunar_return_if_fail (THUNAR_IS_FILE (lp->data));
+      g_queue_push_tail (&store->queued_files, g_object_ref (lp->data));
+    }
+
+  /* use an idle priority below redrawing, so the view stays
+   * responsive (and scrollable) while the rows are added */
+  if (store->queue_idle_id == 0 && !g_queue_is_empty (&store->queued_files))
+    {
+      store->queue_idle_id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE, thunar_list_model_queue_idle,
+                                              store, thunar_list_model_queue_idle_destroy);
+      g_source_set_name_by_id (store->queue_idle_id, "thunar_list_model_queue_idle");
+    }
+}
+
+
+
+static gboolean
+thunar_list_model_queue_idle (gpointer user_data)
+{
+  ThunarListModel *store = THUNAR_LIST_MODEL (user_data);
+  GtkTreePath     *path;
+  GtkTreeIter      iter;
+  ThunarFile      *file;
+  GSequenceIter   *row;
+  gboolean         has_handler;
+  gint64           deadline;
+  gint            *indices;
+  guint            n;
+
+  deadline = g_get_monotonic_time () + THUNAR_LIST_MODEL_INSERT_BUDGET;
+
+  /* see thunar_list_model_insert_files() */
+  path = gtk_tree_path_new_first ();
+  indices = gtk_tree_path_get_indices (path);
+
+  /* check if we have any handlers connected for "row-inserted" */
+  has_handler = g_signal_has_handler_pending (G_OBJECT (store), store->row_inserted_id, 0, FALSE);
+
+  for (n = 1; ; n++)
+    {
+      /* take over the reference of the queue */
+      file = g_queue_pop_head (&store->queued_files);
+      if (file == NULL)
+        break;
+
+      if (!store->show_hidden && thunar_file_is_hidden (file))
+        {
+          store->hidden = g_slist_prepend (store->hidden, file);
+        }
+      else if (!thunar_list_model_filter_matches (store, file))
+        {
+          g_hash_table_add (store->filtered, file);
+        }
+      else
+        {
+          /* append the file, the rows are sorted once loading has finished */
+          indices[0] = g_sequence_get_length (store->rows);
+          row = g_sequence_append (store->rows, file);
+          thunar_standard_view_model_totals_add (store->totals, file);
+          thunar_list_model_sort_cache_clear (store);
+          store->rows_unsorted = TRUE;
+
+          /* appending keeps the index valid */
+          if (store->row_index != NULL)
+            {
+              g_ptr_array_add (store->row_index, row);
+              g_hash_table_insert (store->row_positions, row, GUINT_TO_POINTER (store->row_index->len));
+            }
+
+          if (has_handler)
+            {
+              GTK_TREE_ITER_INIT (iter, store->stamp, row);
+              gtk_tree_model_row_inserted (GTK_TREE_MODEL (store), path, &iter);
+            }
+        }
+
+      /* don't ask for the time on every single file */
+      if ((n % 32) == 0 && g_get_monotonic_time () >= deadline)
+        break;
+    }
+
+  gtk_tree_path_free (path);
+
+  /* number of visible files may have changed */
+  g_object_notify_by_pspec (G_OBJECT (store), list_model_props[PROP_NUM_FILES]);
+
+  /* continue with the next chunk in the next iteration */
+  if (!g_queue_is_empty (&store->queued_files))
+    return TRUE;
+
+  /* all files are in the model, finish if the folder is loaded as well */
+  if (store->folder == NULL || !thunar_folder_get_loading (store->folder))
+    thunar_list_model_finish_loading (store);
+
+  return FALSE;
+}
+
+
+
+static void
+thunar_list_model_queue_idle_destroy (gpointer user_data)
+{
+  THUNAR_LIST_MODEL (user_data)->queue_idle_id = 0;
+}
+
+
+
+static void
+thunar_list_model_cancel_queue (ThunarListModel *store)
+{
+  if (store->queue_idle_id != 0)
+    g_source_remove (store->queue_idle_id);
+
+  g_queue_clear_full (&store->queued_files, g_object_unref);
+}
+
+
+
+static void
+thunar_list_model_finish_loading (ThunarListModel *store)
+{
+  /* sort everything that was streamed in at once */
+  if (store->rows_unsorted)
+    thunar_list_model_sort (store);
+
+  thunar_list_model_set_loading (store, FALSE);
+}
+
+
+
+static void
+thunar_list_model_files_removed (ThunarFolder    *folder,
+                                 GList           *files,
+                                 ThunarListModel *store)
+{
+  GList         *lp;
+  GList         *queued;
+  GSequenceIter *row;
+  GSequenceIter *end;
+  GSequenceIter *next;
+  GtkTreePath   *path;
+  gboolean       found;
+  gboolean       search_mode;
+
+  /* drop all the referenced files from the model */
+  search_mode = (store->search_terms != NULL);
+  for (lp = files; lp != NULL; lp = lp->next)
+    {
+      row = g_sequence_get_begin_iter (store->rows);
+      end = g_sequence_get_end_iter (store->rows);
+
+      found = FALSE;
+
+      while (row != end)
+        {
+          next = g_sequence_iter_next (row);
+
+          if (g_sequence_get (row) == lp->data)
             {
               /* indicate that file was removed from this model */
               store->file_was_removed = TRUE;
 
               /* setup path for "row-deleted" */
-              path = gtk_tree_path_new_from_indices (g_sequence_iter_get_position (row), -1);
+              path = gtk_tree_path_new_from_indices (thunar_list_model_row_position (store, row), -1);
 
               /* remove file from the model */
+              thunar_standard_view_model_totals_remove (store->totals, lp->data);
               g_sequence_remove (row);
+              thunar_list_model_row_index_invalidate (store);
+              thunar_list_model_sort_cache_clear (store);
 
               /* notify the view(s) */
               gtk_tree_model_row_deleted (GTK_TREE_MODEL (store), path);
@@ -1713,9 +2532,25 @@ thunar_list_model_files_removed (ThunarFolder    *folder,
           row = next;
         }
 
+      /* maybe the file is not in the rows yet */
+      if (!found && store->queue_idle_id != 0)
+        {
+          queued = g_queue_find (&store->queued_files, lp->data);
+          if (queued != NULL)
+            {
+              g_object_unref (queued->data);
+              g_queue_delete_link (&store->queued_files, queued);
+              continue;
+            }
+        }
+
       /* check if the file was found */
       if (!found)
         {
+          /* file does not match the filter */
+          if (g_hash_table_remove (store->filtered, lp->data))
+            continue;
+
           if (search_mode == FALSE)
             {
               /* file is hidden */
@@ -1935,36 +2770,29 @@ thunar_list_model_set_job (ThunarStandardViewModel  *model,
 
 
 
-static void
-thunar_list_model_add_search_files (ThunarStandardViewModel *model,
-                                    GList                   *files)
+static ThunarStandardViewModelTotals *
+thunar_list_model_get_totals (ThunarStandardViewModel *model)
 {
-  ThunarListModel *_model = THUNAR_LIST_MODEL (model);
-
-  g_mutex_lock (&_model->mutex_files_to_add);
-
-  _model->files_to_add = g_list_concat (_model->files_to_add, files);
-
-  g_mutex_unlock (&_model->mutex_files_to_add);
+  ThunarListModel *store = THUNAR_LIST_MODEL (model);
+  return store->totals;
 }
 
 
 
-static gboolean
-thunar_list_model_update_search_files (ThunarListModel *model)
+static void
+thunar_list_model_add_search_files (ThunarStandardViewModel *model,
+                                    GList                   *files)
 {
-  g_mutex_lock (&model->mutex_files_to_add);
+  thunar_standard_view_model_results_push (THUNAR_LIST_MODEL (model)->search_results, files);
+}
 
-  if (model->files_to_add != NULL)
-    {
-      thunar_list_model_insert_files (model, model->files_to_add);
-      g_list_free (model->files_to_add);
-      model->files_to_add = NULL;
-    }
 
-  g_mutex_unlock (&model->mutex_files_to_add);
 
-  return TRUE;
+static void
+thunar_list_model_insert_search_files (GList    *files,
+                                       gpointer  user_data)
+{
+  thunar_list_model_insert_files (THUNAR_LIST_MODEL (user_data), files);
 }
 
 
@@ -2004,17 +2832,253 @@ thunar_list_model_search_finished (ThunarJob       *job,
       store->recursive_search_job = NULL;
     }
 
-  if (store->update_search_results_timeout_id > 0)
+  thunar_standard_view_model_results_stop (store->search_results, TRUE);
+
+  g_signal_emit_by_name (store, "search-done");
+}
+
+
+
+static gboolean
+thunar_list_model_filter_matches (ThunarListModel *store,
+                                  ThunarFile      *file)
+{
+  return store->filter_matcher == NULL
+      || thunar_util_search_matcher_match (store->filter_matcher, thunar_file_get_display_name (file));
+}
+
+
+
+/* returns the normalized query, the terms and the matcher for
+ * @search_query if its results are the files in @folder whose
+ * names match, or %FALSE if the query needs a search job */
+static gboolean
+thunar_list_model_filter_parse (ThunarFolder         *folder,
+                                const gchar          *search_query,
+                                gchar               **query_return,
+                                gchar              ***terms_return,
+                                ThunarSearchMatcher **matcher_return)
+{
+  ThunarRecursiveSearchMode mode;
+  ThunarSearchMatcher      *matcher;
+  ThunarPreferences        *preferences;
+  GList                    *predicates = NULL;
+  GFile                    *location;
+  gchar                   **terms;
+  gchar                    *query;
+
+  /* a recursive search finds files beyond the folder */
+  preferences = thunar_preferences_get ();
+  g_object_get (G_OBJECT (preferences), "misc-recursive-search", &mode, NULL);
+  g_object_unref (preferences);
+
+  location = thunar_file_get_file (thunar_folder_get_corresponding_file (folder));
+  if (mode == THUNAR_RECURSIVE_SEARCH_ALWAYS || (mode == THUNAR_RECURSIVE_SEARCH_LOCAL && thunar_g_file_is_on_local_device (location)))
+    return FALSE;
+
+  query = thunar_g_utf8_normalize_for_search (search_query, TRUE, TRUE);
+  terms = thunar_util_split_search_query (query, &predicates, NULL);
+  if (terms == NULL)
+    {
+      g_free (query);
+      return FALSE;
+    }
+
+  /* the predicates need the attributes of the files, which the folder does not load */
+  matcher = thunar_util_search_matcher_new (terms, predicates);
+  if (thunar_util_search_matcher_has_predicates (matcher))
+    {
+      thunar_util_search_matcher_free (matcher);
+      g_strfreev (terms);
+      g_free (query);
+      return FALSE;
+    }
+
+  *query_return = query;
+  *terms_return = terms;
+  *matcher_return = matcher;
+
+  return TRUE;
+}
+
+
+
+static void
+thunar_list_model_take_filter (ThunarListModel     *store,
+                               gchar               *query,
+                               gchar              **terms,
+                               ThunarSearchMatcher *matcher)
+{
+  /* the matcher refers to the terms */
+  thunar_util_search_matcher_free (store->filter_matcher);
+  g_strfreev (store->filter_terms);
+  g_free (store->filter_query);
+
+  store->filter_query = query;
+  store->filter_terms = terms;
+  store->filter_matcher = matcher;
+}
+
+
+
+static void
+thunar_list_model_clear_filter (ThunarListModel *store)
+{
+  thunar_list_model_take_filter (store, NULL, NULL, NULL);
+  g_hash_table_remove_all (store->filtered);
+
+  if (store->filter_done_id != 0)
     {
-      thunar_list_model_update_search_files (store);
-      g_source_remove (store->update_search_results_timeout_id);
-      store->update_search_results_timeout_id = 0;
+      g_source_remove (store->filter_done_id);
+      store->filter_done_id = 0;
     }
+}
+
 
-  thunar_g_list_free_full (store->files_to_add);
-  store->files_to_add = NULL;
 
+static gboolean
+thunar_list_model_filter_done (gpointer user_data)
+{
+  ThunarListModel *store = THUNAR_LIST_MODEL (user_data);
+
+  store->filter_done_id = 0;
+
+  /* filtering is done right away, but the view only
+   * expects the results once the search was set up */
   g_signal_emit_by_name (store, "search-done");
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+static void
+thunar_list_model_filter_rows (ThunarListModel *store)
+{
+  GtkTreePath   *path;
+  ThunarFile    *file;
+  GSequenceIter *row;
+  GSequenceIter *next;
+  GSequenceIter *end;
+  gboolean       has_handler;
+  gint          *indices;
+  gint           position;
+
+  if (store->filter_matcher == NULL)
+    return;
+
+  /* check if we have any handlers connected for "row-deleted" */
+  has_handler = g_signal_has_handler_pending (G_OBJECT (store), store->row_deleted_id, 0, FALSE);
+
+  /* see thunar_list_model_set_show_hidden() */
+  path = gtk_tree_path_new_first ();
+  indices = gtk_tree_path_get_indices (path);
+
+  row = g_sequence_get_begin_iter (store->rows);
+  end = g_sequence_get_end_iter (store->rows);
+
+  for (position = 0; row != end; row = next)
+    {
+      next = g_sequence_iter_next (row);
+
+      file = g_sequence_get (row);
+      if (!thunar_list_model_filter_matches (store, file))
+        {
+          g_hash_table_add (store->filtered, g_object_ref (file));
+
+          thunar_standard_view_model_totals_remove (store->totals, file);
+          g_sequence_remove (row);
+          thunar_list_model_row_index_invalidate (store);
+          thunar_list_model_sort_cache_clear (store);
+
+          if (has_handler)
+            {
+              indices[0] = position;
+              gtk_tree_model_row_deleted (GTK_TREE_MODEL (store), path);
+            }
+        }
+      else
+        {
+          ++position;
+        }
+    }
+
+  gtk_tree_path_free (path);
+}
+
+
+
+static void
+thunar_list_model_unfilter_files (ThunarListModel *store)
+{
+  GHashTableIter iter;
+  ThunarFile    *file;
+  GSList        *files = NULL;
+
+  g_hash_table_iter_init (&iter, store->filtered);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &file, NULL))
+    if (thunar_list_model_filter_matches (store, file))
+      {
+        /* the list takes over the reference of the set */
+        files = g_slist_prepend (files, file);
+        g_hash_table_iter_steal (&iter);
+      }
+
+  thunar_list_model_merge_files (store, files);
+}
+
+
+
+/* applies the @search_query to the rows of the current folder, returns
+ * %FALSE if the model has to be reloaded for the query instead */
+static gboolean
+thunar_list_model_set_filter (ThunarListModel *store,
+                              const gchar     *search_query)
+{
+  ThunarSearchMatcher *matcher;
+  gboolean             refine;
+  gchar              **terms;
+  gchar               *query;
+
+  /* search results are not the files of the folder */
+  if (store->search_terms != NULL)
+    return FALSE;
+
+  if (search_query == NULL || *search_query == '\0')
+    {
+      /* reloading a folder that is not filtered is up to the caller */
+      if (store->filter_matcher == NULL)
+        return FALSE;
+
+      /* bring back all the filtered files */
+      thunar_list_model_take_filter (store, NULL, NULL, NULL);
+      thunar_list_model_unfilter_files (store);
+    }
+  else
+    {
+      if (!thunar_list_model_filter_parse (store->folder, search_query, &query, &terms, &matcher))
+        return FALSE;
+
+      /* appending to the query only narrows the results, since every
+       * term of the previous query is a prefix of a term of the new one,
+       * so only the visible rows need to be rescanned */
+      refine = (store->filter_query != NULL && g_str_has_prefix (query, store->filter_query));
+      thunar_list_model_take_filter (store, query, terms, matcher);
+
+      thunar_list_model_filter_rows (store);
+      if (!refine)
+        thunar_list_model_unfilter_files (store);
+
+      if (store->filter_done_id == 0)
+        {
+          store->filter_done_id = g_idle_add (thunar_list_model_filter_done, store);
+          g_source_set_name_by_id (store->filter_done_id, "thunar_list_model_filter_done");
+        }
+    }
+
+  g_object_notify_by_pspec (G_OBJECT (store), list_model_props[PROP_NUM_FILES]);
+
+  return TRUE;
 }
 
 
@@ -2048,28 +3112,36 @@ thunar_list_model_set_folder (ThunarStandardViewModel *model,
                               gchar                   *search_query)
 {
   ThunarListModel   *store = THUNAR_LIST_MODEL (model);
+  ThunarSearchMatcher *filter_matcher;
   GtkTreePath   *path;
   gboolean       has_handler;
   GList         *files;
   GSequenceIter *row;
   GSequenceIter *end;
   GSequenceIter *next;
+  gchar        **filter_terms;
+  gchar         *filter_query;
 
   _thunar_return_if_fail (THUNAR_IS_LIST_MODEL (store));
   _thunar_return_if_fail (folder == NULL || THUNAR_IS_FOLDER (folder));
 
+  if (search_query != NULL)
+    g_strstrip (search_query);
+
+  /* changing the query on the names of the files in the current
+   * folder filters the rows in place, there is nothing to load */
+  if (folder != NULL && folder == store->folder && thunar_list_model_set_filter (store, search_query))
+    return;
+
   /* unlink from the previously active folder (if any) */
   if (G_LIKELY (store->folder != NULL))
     {
       thunar_list_model_cancel_search_job (store);
+      thunar_standard_view_model_results_stop (store->search_results, FALSE);
 
-      if (store->update_search_results_timeout_id > 0)
-        {
-          g_source_remove (store->update_search_results_timeout_id);
-          store->update_search_results_timeout_id = 0;
-        }
-      thunar_g_list_free_full (store->files_to_add);
-      store->files_to_add = NULL;
+      /* drop the files not yet streamed into the model */
+      thunar_list_model_cancel_queue (store);
+      store->rows_unsorted = FALSE;
 
       /* check if we have any handlers connected for "row-deleted" */
       has_handler = g_signal_has_handler_pending (G_OBJECT (store), store->row_deleted_id, 0, FALSE);
@@ -2078,12 +3150,15 @@ thunar_list_model_set_folder (ThunarStandardViewModel *model,
       end = g_sequence_get_end_iter (store->rows);
 
       /* remove existing entries */
+      thunar_standard_view_model_totals_clear (store->totals);
       path = gtk_tree_path_new_first ();
       while (row != end)
         {
           /* remove the row from the list */
           next = g_sequence_iter_next (row);
           g_sequence_remove (row);
+          thunar_list_model_row_index_invalidate (store);
+          thunar_list_model_sort_cache_clear (store);
           row = next;
 
           /* notify the view(s) if they're actually
@@ -2098,6 +3173,9 @@ thunar_list_model_set_folder (ThunarStandardViewModel *model,
       g_slist_free_full (store->hidden, g_object_unref);
       store->hidden = NULL;
 
+      /* remove filtered entries */
+      thunar_list_model_clear_filter (store);
+
       /* reset the information that file was removed or sorted */
       store->file_was_removed = FALSE;
       store->file_was_sorted = FALSE;
@@ -2129,8 +3207,24 @@ thunar_list_model_set_folder (ThunarStandardViewModel *model,
       /* get the already loaded files or search for files matching the search_query
        * don't start searching if the query is empty, that would be a waste of resources
        */
-      if (search_query == NULL || strlen (g_strstrip (search_query)) == 0)
+      if (search_query == NULL || strlen (search_query) == 0)
+        {
+          files = thunar_folder_get_files (folder);
+          thunar_list_model_set_loading (store, TRUE);
+
+          if (store->search_terms != NULL)
+            {
+              g_strfreev (store->search_terms);
+              store->search_terms = NULL;
+            }
+        }
+      else if (thunar_list_model_filter_parse (folder, search_query, &filter_query, &filter_terms, &filter_matcher))
         {
+          /* only the files matching the filter become rows */
+          thunar_list_model_take_filter (store, filter_query, filter_terms, filter_matcher);
+          store->filter_done_id = g_idle_add (thunar_list_model_filter_done, store);
+          g_source_set_name_by_id (store->filter_done_id, "thunar_list_model_filter_done");
+
           files = thunar_folder_get_files (folder);
           thunar_list_model_set_loading (store, TRUE);
 
@@ -2146,7 +3240,7 @@ thunar_list_model_set_folder (ThunarStandardViewModel *model,
 
           search_query_c = thunar_g_utf8_normalize_for_search (search_query, TRUE, TRUE);
           g_strfreev (store->search_terms);
-          store->search_terms = thunar_util_split_search_query (search_query_c, NULL);
+          store->search_terms = thunar_util_split_search_query (search_query_c, NULL, NULL);
           if (store->search_terms != NULL)
             {
               /* search the current folder
@@ -2157,17 +3251,21 @@ thunar_list_model_set_folder (ThunarStandardViewModel *model,
               g_signal_connect (store->recursive_search_job, "error", G_CALLBACK (thunar_list_model_search_error), NULL);
               g_signal_connect (store->recursive_search_job, "finished", G_CALLBACK (thunar_list_model_search_finished), store);
 
-              /* add new results to the model every X ms */
-              store->update_search_results_timeout_id = g_timeout_add (500, G_SOURCE_FUNC (thunar_list_model_update_search_files), store);
+              /* add new results to the model every X ms, the search job
+               * itself already bounds the size and latency of its batches */
+              thunar_standard_view_model_results_start (store->search_results);
             }
           g_free (search_query_c);
           files = NULL;
         }
 
-      /* insert the files */
+      /* insert the files, streamed in chunks while loading */
       if (files != NULL)
         {
-          thunar_list_model_insert_files (store, files);
+          if (store->loading)
+            thunar_list_model_queue_files (store, files);
+          else
+            thunar_list_model_insert_files (store, files);
           g_list_free (files);
         }
 
@@ -2256,6 +3354,118 @@ thunar_list_model_get_show_hidden (ThunarStandardViewModel *model)
 
 
 
+/* inserts the @files into the sorted rows, taking over the
+ * references of the files and the list */
+static void
+thunar_list_model_merge_files (ThunarListModel *store,
+                               GSList          *files)
+{
+  ThunarListModelSortContext  context;
+  ThunarListModelSortKey     *keys;
+  ThunarListModelSortKey      row_key;
+  GtkTreePath                *path;
+  GtkTreeIter                 iter;
+  GSequenceIter              *row;
+  GSequenceIter              *end;
+  gboolean                    has_handler;
+  gboolean                    row_key_valid = FALSE;
+  GSList                     *lp;
+  gint                       *indices;
+  gint                        n_keys;
+  gint                        position;
+  gint                        n;
+
+  n_keys = g_slist_length (files);
+  if (G_UNLIKELY (n_keys == 0))
+    return;
+
+  /* sort the files once with the keys of thunar_list_model_sort() */
+  thunar_list_model_sort_context_init (store, &context);
+  keys = g_new (ThunarListModelSortKey, n_keys);
+  for (lp = files, n = 0; lp != NULL; lp = lp->next, ++n)
+    thunar_list_model_sort_key_init (&keys[n], &context, lp->data, NULL, n);
+  thunar_list_model_sort_keys (keys, n_keys, &context);
+
+  /* check if we have any handlers connected for "row-inserted" */
+  has_handler = g_signal_has_handler_pending (G_OBJECT (store), store->row_inserted_id, 0, FALSE);
+
+  path = gtk_tree_path_new_first ();
+  indices = gtk_tree_path_get_indices (path);
+
+  /* merge the two sorted runs in a single walk over the rows; rows that
+   * are still streamed in are unsorted anyway and sorted once loading
+   * finished, so the files are simply appended then */
+  row = g_sequence_get_begin_iter (store->rows);
+  end = g_sequence_get_end_iter (store->rows);
+  position = 0;
+  if (store->rows_unsorted)
+    {
+      row = end;
+      position = g_sequence_get_length (store->rows);
+    }
+
+  for (n = 0; n < n_keys; ++n)
+    {
+      /* skip the rows sorting before this file, equal rows stay in front */
+      for (; row != end; row = g_sequence_iter_next (row), ++position, row_key_valid = FALSE)
+        {
+          if (!row_key_valid)
+            thunar_list_model_sort_key_init (&row_key, &context, g_sequence_get (row), row, position);
+          row_key_valid = TRUE;
+
+          if (thunar_list_model_sort_key_cmp (&row_key, &keys[n], &context) > 0)
+            break;
+        }
+
+      /* the row takes over the reference of the list */
+      keys[n].row = g_sequence_insert_before (row, keys[n].file);
+      thunar_list_model_row_index_invalidate (store);
+      thunar_list_model_sort_cache_clear (store);
+      thunar_standard_view_model_totals_add (store->totals, keys[n].file);
+
+      /* tell the view about the new row, the positions ascend */
+      if (has_handler)
+        {
+          GTK_TREE_ITER_INIT (iter, store->stamp, keys[n].row);
+          indices[0] = position;
+          gtk_tree_model_row_inserted (GTK_TREE_MODEL (store), path, &iter);
+        }
+
+      /* the row in front of the next file is behind the one just inserted */
+      ++position;
+    }
+
+  gtk_tree_path_free (path);
+  g_free (keys);
+
+  g_slist_free (files);
+}
+
+
+
+static void
+thunar_list_model_show_hidden_files (ThunarListModel *store)
+{
+  GSList *files = NULL;
+  GSList *lp;
+
+  /* the hidden files not matching the filter are stashed with the filtered files */
+  for (lp = store->hidden; lp != NULL; lp = lp->next)
+    {
+      if (thunar_list_model_filter_matches (store, lp->data))
+        files = g_slist_prepend (files, lp->data);
+      else
+        g_hash_table_add (store->filtered, lp->data);
+    }
+
+  g_slist_free (store->hidden);
+  store->hidden = NULL;
+
+  thunar_list_model_merge_files (store, files);
+}
+
+
+
 /**
  * thunar_list_model_set_show_hidden:
  * @store       : a #ThunarListModel.
@@ -2265,14 +3475,16 @@ static void
 thunar_list_model_set_show_hidden (ThunarStandardViewModel *model,
                                    gboolean                 show_hidden)
 {
-  ThunarListModel   *store = THUNAR_LIST_MODEL (model);
-  GtkTreePath   *path;
-  GtkTreeIter    iter;
-  ThunarFile    *file;
-  GSList        *lp;
-  GSequenceIter *row;
-  GSequenceIter *next;
-  GSequenceIter *end;
+  ThunarListModel *store = THUNAR_LIST_MODEL (model);
+  GHashTableIter   iter;
+  GtkTreePath     *path;
+  ThunarFile      *file;
+  GSequenceIter   *row;
+  GSequenceIter   *next;
+  GSequenceIter   *end;
+  gboolean         has_handler;
+  gint            *indices;
+  gint             position;
 
   _thunar_return_if_fail (THUNAR_IS_LIST_MODEL (store));
 
@@ -2284,33 +3496,24 @@ thunar_list_model_set_show_hidden (ThunarStandardViewModel *model,
 
   if (store->show_hidden)
     {
-      for (lp = store->hidden; lp != NULL; lp = lp->next)
-        {
-          file = THUNAR_FILE (lp->data);
-
-          /* insert file in the sorted position */
-          row = g_sequence_insert_sorted (store->rows, file,
-                                          thunar_list_model_cmp_func, store);
-
-          GTK_TREE_ITER_INIT (iter, store->stamp, row);
-
-          /* tell the view about the new row */
-          path = gtk_tree_path_new_from_indices (g_sequence_iter_get_position (row), -1);
-          gtk_tree_model_row_inserted (GTK_TREE_MODEL (store), path, &iter);
-          gtk_tree_path_free (path);
-        }
-      g_slist_free (store->hidden);
-      store->hidden = NULL;
+      thunar_list_model_show_hidden_files (store);
     }
   else
     {
       _thunar_assert (store->hidden == NULL);
 
-      /* remove all hidden files */
+      /* check if we have any handlers connected for "row-deleted" */
+      has_handler = g_signal_has_handler_pending (G_OBJECT (store), store->row_deleted_id, 0, FALSE);
+
+      /* remove all hidden files in one pass, the position of the
+       * next row is counted along instead of looked up every time */
+      path = gtk_tree_path_new_first ();
+      indices = gtk_tree_path_get_indices (path);
+
       row = g_sequence_get_begin_iter (store->rows);
       end = g_sequence_get_end_iter (store->rows);
 
-      while (row != end)
+      for (position = 0; row != end; row = next)
         {
           next = g_sequence_iter_next (row);
 
@@ -2320,20 +3523,37 @@ thunar_list_model_set_show_hidden (ThunarStandardViewModel *model,
               /* store file in the list */
               store->hidden = g_slist_prepend (store->hidden, g_object_ref (file));
 
-              /* setup path for "row-deleted" */
-              path = gtk_tree_path_new_from_indices (g_sequence_iter_get_position (row), -1);
-
               /* remove file from the model */
+              thunar_standard_view_model_totals_remove (store->totals, file);
               g_sequence_remove (row);
+              thunar_list_model_row_index_invalidate (store);
+              thunar_list_model_sort_cache_clear (store);
 
-              /* notify the view(s) */
-              gtk_tree_model_row_deleted (GTK_TREE_MODEL (store), path);
-              gtk_tree_path_free (path);
+              /* notify the view(s), the following rows move up to this position */
+              if (has_handler)
+                {
+                  indices[0] = position;
+                  gtk_tree_model_row_deleted (GTK_TREE_MODEL (store), path);
+                }
+            }
+          else
+            {
+              ++position;
             }
 
-          row = next;
           _thunar_assert (end == g_sequence_get_end_iter (store->rows));
         }
+
+      gtk_tree_path_free (path);
+
+      /* the hidden files not matching the filter are stashed with the hidden files now */
+      g_hash_table_iter_init (&iter, store->filtered);
+      while (g_hash_table_iter_next (&iter, (gpointer *) &file, NULL))
+        if (thunar_file_is_hidden (file))
+          {
+            store->hidden = g_slist_prepend (store->hidden, file);
+            g_hash_table_iter_steal (&iter);
+          }
     }
 
   /* notify listeners about the new setting */
@@ -2587,26 +3807,33 @@ thunar_list_model_get_paths_for_files (ThunarStandardViewModel *model,
 
 
 
-static void
-thunar_list_model_file_count_callback (ExoJob  *job,
-                                       gpointer model)
+/**
+ * thunar_list_model_set_disk_usage:
+ * @store      : a #ThunarListModel.
+ * @disk_usage : whether folders show their cumulative size.
+ *
+ * If @disk_usage is %TRUE, the #THUNAR_COLUMN_SIZE of folders is the
+ * size of everything below the folder as counted by thunar-disk-usage.c,
+ * and sorting by size uses that size as well.
+ **/
+void
+thunar_list_model_set_disk_usage (ThunarListModel *store,
+                                  gboolean         disk_usage)
 {
-  ThunarListModel *store = THUNAR_LIST_MODEL (model);
+  gint        sort_column;
+  GtkSortType sort_order;
 
-  GArray     *param_values;
-  ThunarFile *file;
-  GList      *files = NULL;
+  _thunar_return_if_fail (THUNAR_IS_LIST_MODEL (store));
 
-  if (job == NULL)
+  if (store->disk_usage == disk_usage)
     return;
 
-  param_values = thunar_simple_job_get_param_values (THUNAR_SIMPLE_JOB (job));
-  file = THUNAR_FILE (g_value_get_object (&g_array_index (param_values, GValue, 0)));
+  store->disk_usage = disk_usage;
 
-  if (file == NULL)
-    return;
+  gtk_tree_model_foreach (GTK_TREE_MODEL (store), (GtkTreeModelForeachFunc) (void (*)(void)) gtk_tree_model_row_changed, NULL);
 
-  files = g_list_append (files, file);
-  thunar_list_model_files_changed (store->folder, files, store);
-  g_list_free (files);
+  /* pick the matching size comparison and re-sort */
+  if (thunar_list_model_get_sort_column_id (GTK_TREE_SORTABLE (store), &sort_column, &sort_order)
+      && sort_column == THUNAR_COLUMN_SIZE)
+    thunar_list_model_set_sort_column_id (GTK_TREE_SORTABLE (store), sort_column, sort_order);
 }
@@ -40,6 +40,9 @@ ThunarStandardViewModel *thunar_list_model_new                    (void);
 
 void                     thunar_list_model_check_file_in_model_before_use (ThunarListModel *model);
 
+void                     thunar_list_model_set_disk_usage         (ThunarListModel *store,
+                                                                   gboolean         disk_usage);
+
 
 G_END_DECLS;
 
@@ -116,6 +116,7 @@ static gboolean       thunar_location_button_drag_motion            (GtkWidget
 static gboolean       thunar_location_button_enter_timeout          (gpointer                    user_data);
 static void           thunar_location_button_enter_timeout_destroy  (gpointer                    user_data);
 static void           thunar_location_button_clicked                (ThunarLocationButton       *button);
+static void           thunar_location_button_cancel_location        (ThunarLocationButton       *location_button);
 
 
 
@@ -143,6 +144,10 @@ struct _ThunarLocationButton
   guint               drop_data_ready : 1;
   guint               drop_occurred : 1;
 
+  /* the location while its file is being resolved */
+  GFile              *location;
+  GCancellable       *location_cancellable;
+
   /* public properties */
   ThunarFile         *file;
 };
@@ -288,6 +293,7 @@ thunar_location_button_finalize (GObject *object)
 
   /* disconnect from the file */
   thunar_location_button_set_file (location_button, NULL);
+  thunar_location_button_cancel_location (location_button);
 
   (*G_OBJECT_CLASS (thunar_location_button_parent_class)->finalize) (object);
 }
@@ -470,6 +476,40 @@ thunar_location_button_file_destroy (ThunarLocationButton *location_button,
 
 
 
+static void
+thunar_location_button_cancel_location (ThunarLocationButton *location_button)
+{
+  if (location_button->location_cancellable != NULL)
+    {
+      g_cancellable_cancel (location_button->location_cancellable);
+      g_clear_object (&location_button->location_cancellable);
+    }
+
+  g_clear_object (&location_button->location);
+}
+
+
+
+static void
+thunar_location_button_location_ready (GFile      *location,
+                                       ThunarFile *file,
+                                       GError     *error,
+                                       gpointer    user_data)
+{
+  ThunarLocationButton *location_button;
+
+  /* the button may be gone already */
+  if (error != NULL && g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    return;
+
+  location_button = THUNAR_LOCATION_BUTTON (user_data);
+  _thunar_return_if_fail (location_button->location != NULL);
+
+  thunar_location_button_set_file (location_button, file);
+}
+
+
+
 static void
 thunar_location_button_apply_label_size (ThunarLocationButton *location_button)
 {
@@ -897,6 +937,13 @@ thunar_location_button_set_file (ThunarLocationButton *location_button,
   _thunar_return_if_fail (THUNAR_IS_LOCATION_BUTTON (location_button));
   _thunar_return_if_fail (file == NULL || THUNAR_IS_FILE (file));
 
+  /* a pending lookup is replaced by the file */
+  if (location_button->location != NULL)
+    {
+      thunar_location_button_cancel_location (location_button);
+      gtk_widget_set_sensitive (GTK_WIDGET (location_button), TRUE);
+    }
+
   /* check if we already use that file */
   if (G_UNLIKELY (location_button->file == file))
     return;
@@ -939,6 +986,79 @@ thunar_location_button_set_file (ThunarLocationButton *location_button,
 
 
 
+/**
+ * thunar_location_button_get_location:
+ * @location_button : a #ThunarLocationButton.
+ *
+ * Returns the location of @location_button, also while its
+ * #ThunarFile is still being resolved.
+ *
+ * Return value: (transfer none) (nullable): the #GFile for @location_button.
+ **/
+GFile*
+thunar_location_button_get_location (ThunarLocationButton *location_button)
+{
+  _thunar_return_val_if_fail (THUNAR_IS_LOCATION_BUTTON (location_button), NULL);
+
+  if (location_button->location != NULL)
+    return location_button->location;
+  else if (location_button->file != NULL)
+    return thunar_file_get_file (location_button->file);
+  else
+    return NULL;
+}
+
+
+
+/**
+ * thunar_location_button_set_location:
+ * @location_button : a #ThunarLocationButton.
+ * @location        : a #GFile.
+ *
+ * Sets the file for @location_button to the #ThunarFile for
+ * @location. Unless that file is already known, @location_button
+ * shows the base name of @location and stays insensitive until
+ * the file is resolved in the background.
+ **/
+void
+thunar_location_button_set_location (ThunarLocationButton *location_button,
+                                     GFile                *location)
+{
+  gchar *basename;
+  gchar *display_name;
+
+  _thunar_return_if_fail (THUNAR_IS_LOCATION_BUTTON (location_button));
+  _thunar_return_if_fail (G_IS_FILE (location));
+
+  /* check if we already use that location */
+  if (location_button->location != NULL && g_file_equal (location_button->location, location))
+    return;
+  if (location_button->file != NULL && g_file_equal (thunar_file_get_file (location_button->file), location))
+    return;
+
+  thunar_location_button_set_file (location_button, NULL);
+
+  location_button->location = g_object_ref (location);
+  location_button->location_cancellable = g_cancellable_new ();
+
+  /* show a placeholder until the file is resolved */
+  basename = g_file_get_basename (location);
+  display_name = g_filename_display_name (basename != NULL ? basename : "");
+  gtk_label_set_text (GTK_LABEL (location_button->label), display_name);
+  gtk_widget_show (location_button->label);
+  gtk_widget_hide (location_button->image);
+  gtk_widget_set_sensitive (GTK_WIDGET (location_button), FALSE);
+  g_free (display_name);
+  g_free (basename);
+
+  /* cached files are returned right away, the cancellable is cancelled when the
+   * button is finalized, so there is no need to hold a reference meanwhile */
+  thunar_file_get_async (location, location_button->location_cancellable,
+                         thunar_location_button_location_ready, location_button);
+}
+
+
+
 /**
  * thunar_location_button_clicked:
  * @location_button : a #ThunarLocationButton.
@@ -42,6 +42,10 @@ ThunarFile *thunar_location_button_get_file   (ThunarLocationButton *location_bu
 void        thunar_location_button_set_file   (ThunarLocationButton *location_button,
                                                ThunarFile           *file);
 
+GFile      *thunar_location_button_get_location (ThunarLocationButton *location_button);
+void        thunar_location_button_set_location (ThunarLocationButton *location_button,
+                                                 GFile                *location);
+
 G_END_DECLS;
 
 #endif /* !__THUNAR_LOCATION_BUTTON_H__ */
@@ -97,7 +97,7 @@ static void           thunar_location_buttons_forall                      (GtkCo
                                                                            GtkCallback                 callback,
                                                                            gpointer                    callback_data);
 static GtkWidget     *thunar_location_buttons_make_button                 (ThunarLocationButtons      *buttons,
-                                                                           ThunarFile                 *file);
+                                                                           GFile                      *location);
 static void           thunar_location_buttons_remove_1                    (GtkContainer               *container,
                                                                            GtkWidget                  *widget);
 static gboolean       thunar_location_buttons_draw                        (GtkWidget                  *buttons,
@@ -367,10 +367,10 @@ thunar_location_buttons_get_current_directory (ThunarNavigator *navigator)
 
 
 static inline gboolean
-eglible_for_fake_root (ThunarFile *file)
+eglible_for_fake_root (GFile *location)
 {
   /* use 'Home' as fake root button */
-  return thunar_file_is_home (file);
+  return location != NULL && thunar_g_file_is_home (location);
 
   /* TODO: mounted devices */
 }
@@ -382,9 +382,12 @@ thunar_location_buttons_set_current_directory (ThunarNavigator *navigator,
                                                ThunarFile      *current_directory)
 {
   ThunarLocationButtons *buttons = THUNAR_LOCATION_BUTTONS (navigator);
-  ThunarFile            *file_parent;
-  ThunarFile            *file;
   GtkWidget             *button;
+  GFile                 *button_location;
+  GFile                 *location;
+  GFile                 *parent;
+  GList                 *locations = NULL;
+  GList                 *shared = NULL;
   GList                 *lp;
 
   _thunar_return_if_fail (current_directory == NULL || THUNAR_IS_FILE (current_directory));
@@ -404,20 +407,47 @@ thunar_location_buttons_set_current_directory (ThunarNavigator *navigator,
         }
     }
 
-  if (G_LIKELY (buttons->current_directory != NULL))
+  /* find the deepest button the new path shares with the current one, the
+   * locations below it are collected from the root to the new directory */
+  if (G_LIKELY (current_directory != NULL))
     {
-      /* remove all buttons */
-      g_object_unref (G_OBJECT (buttons->current_directory));
-
-      while (buttons->list != NULL)
-        gtk_container_remove (GTK_CONTAINER (buttons), buttons->list->data);
+      for (location = g_object_ref (thunar_file_get_file (current_directory)); location != NULL; location = parent)
+        {
+          for (lp = buttons->list; lp != NULL; lp = lp->next)
+            {
+              button_location = thunar_location_button_get_location (lp->data);
+              if (button_location != NULL && g_file_equal (button_location, location))
+                break;
+            }
+
+          if (lp != NULL)
+            {
+              shared = lp;
+              g_object_unref (location);
+              break;
+            }
+
+          parent = g_file_get_parent (location);
+          locations = g_list_prepend (locations, location);
+        }
 
-      /* clear scroll positions and fake root button */
-      buttons->first_visible_button = NULL;
-      buttons->last_visible_button = NULL;
-      buttons->fake_root_button = NULL;
+      /* the current directory may still be resolved by its button */
+      if (shared != NULL && locations == NULL)
+        thunar_location_button_set_file (shared->data, current_directory);
     }
 
+  if (G_LIKELY (buttons->current_directory != NULL))
+    g_object_unref (G_OBJECT (buttons->current_directory));
+
+  /* remove the buttons below the shared path */
+  while (buttons->list != shared)
+    gtk_container_remove (GTK_CONTAINER (buttons), buttons->list->data);
+
+  /* clear scroll positions and fake root button */
+  buttons->first_visible_button = NULL;
+  buttons->last_visible_button = NULL;
+  buttons->fake_root_button = NULL;
+
   buttons->current_directory = current_directory;
 
   /* regenerate the button list */
@@ -425,26 +455,31 @@ thunar_location_buttons_set_current_directory (ThunarNavigator *navigator,
     {
       g_object_ref (G_OBJECT (current_directory));
 
-      /* add the new buttons */
-      for (file = current_directory; file != NULL; file = file_parent)
+      /* add buttons for the new locations only, the files of the parent
+       * folders are resolved by the buttons in the background */
+      for (lp = locations; lp != NULL; lp = lp->next)
         {
-          button = thunar_location_buttons_make_button (buttons, file);
-          buttons->list = g_list_append (buttons->list, button);
+          button = thunar_location_buttons_make_button (buttons, lp->data);
+          buttons->list = g_list_prepend (buttons->list, button);
           gtk_container_add (GTK_CONTAINER (buttons), button);
           gtk_widget_show (button);
+        }
 
-          /* use 'Home' as fake root button */
-          if (!buttons->fake_root_button && eglible_for_fake_root (file))
-            buttons->fake_root_button = g_list_last (buttons->list);
-
-          /* continue with the parent (if any) */
-          file_parent = thunar_file_get_parent (file, NULL);
+      for (lp = buttons->list; lp != NULL; lp = lp->next)
+        {
+          /* update the state of the shared buttons (making sure to not recurse with the "clicked" handler) */
+          g_signal_handlers_block_by_func (G_OBJECT (lp->data), thunar_location_buttons_clicked, buttons);
+          gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (lp->data), thunar_location_button_get_file (lp->data) == current_directory);
+          g_signal_handlers_unblock_by_func (G_OBJECT (lp->data), thunar_location_buttons_clicked, buttons);
 
-          if (G_LIKELY (file != current_directory))
-            g_object_unref (G_OBJECT (file));
+          /* use 'Home' as fake root button */
+          if (!buttons->fake_root_button && eglible_for_fake_root (thunar_location_button_get_location (lp->data)))
+            buttons->fake_root_button = lp;
         }
     }
 
+  g_list_free_full (locations, g_object_unref);
+
   g_object_notify (G_OBJECT (buttons), "current-directory");
 }
 
@@ -928,18 +963,18 @@ thunar_location_buttons_forall (GtkContainer *container,
 
 static GtkWidget*
 thunar_location_buttons_make_button (ThunarLocationButtons *buttons,
-                                     ThunarFile            *file)
+                                     GFile                 *location)
 {
   GtkWidget *button;
 
   /* allocate the button */
   button = thunar_location_button_new ();
 
-  /* connect to the file */
-  thunar_location_button_set_file (THUNAR_LOCATION_BUTTON (button), file);
-
-  /* the current directory is active */
-  gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON (button), (file == buttons->current_directory));
+  /* connect to the file, the current directory is known already */
+  if (g_file_equal (location, thunar_file_get_file (buttons->current_directory)))
+    thunar_location_button_set_file (THUNAR_LOCATION_BUTTON (button), buttons->current_directory);
+  else
+    thunar_location_button_set_location (THUNAR_LOCATION_BUTTON (button), location);
 
   /* connect signal handlers */
   g_signal_connect (G_OBJECT (button), "location-button-clicked", G_CALLBACK (thunar_location_buttons_clicked), buttons);
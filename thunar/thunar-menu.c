@@ -335,11 +335,9 @@ thunar_menu_add_sections (ThunarMenu         *menu,
   if (item_added)
      xfce_gtk_menu_append_separator (GTK_MENU_SHELL (menu));
 
+  /* the custom actions bring their own separator */
   if (menu_sections & THUNAR_MENU_SECTION_CUSTOM_ACTIONS)
-    {
-      if (thunar_action_manager_append_custom_actions (menu->action_mgr, GTK_MENU_SHELL (menu)))
-         xfce_gtk_menu_append_separator (GTK_MENU_SHELL (menu));
-    }
+    thunar_action_manager_append_custom_actions (menu->action_mgr, GTK_MENU_SHELL (menu));
 
   if (menu_sections & THUNAR_MENU_SECTION_MOUNTABLE)
     {
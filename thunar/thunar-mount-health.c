@@ -0,0 +1,637 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include <gio/gio.h>
+
+#include <libxfce4util/libxfce4util.h>
+
+#include "thunar/thunar-job.h"
+#include "thunar/thunar-marshal.h"
+#include "thunar/thunar-mount-health.h"
+#include "thunar/thunar-private.h"
+#include "thunar/thunar-simple-job.h"
+
+/**
+ * SECTION:thunar-mount-health
+ * @Short_description: Tracks which network mounts are reachable
+ * @Title: ThunarMountHealth
+ *
+ * When the server of a network mount goes away, every query on its
+ * files blocks until the connection times out. Whoever sees such an
+ * error passes it to thunar_mount_health_report_error(), which marks
+ * the mount of the file as unreachable. From then on the queries of
+ * the #ThunarFile<!---->s and #ThunarFolder<!---->s on that mount
+ * fail right away, see thunar_mount_health_set_error_if_unreachable(),
+ * and the files keep the information they had.
+ *
+ * The root of an unreachable mount is probed with a #ThunarJob in the
+ * background, with growing intervals between the probes. Once a probe
+ * succeeds, "reachability-changed" is emitted and the folders on the
+ * mount are listed again.
+ *
+ * The state may be checked and reported from any thread, the probes
+ * and the signal run in the main thread.
+ **/
+
+
+
+/* the first and the longest interval between two probes, in seconds */
+#define THUNAR_MOUNT_HEALTH_PROBE_INTERVAL_MIN (2)
+#define THUNAR_MOUNT_HEALTH_PROBE_INTERVAL_MAX (60)
+
+/* a probe not answered within this time, in seconds, failed */
+#define THUNAR_MOUNT_HEALTH_PROBE_TIMEOUT      (5)
+
+
+
+/* signal identifiers */
+enum
+{
+  REACHABILITY_CHANGED,
+  LAST_SIGNAL
+};
+
+
+
+typedef struct _ThunarMountProbe ThunarMountProbe;
+
+
+
+static void thunar_mount_health_finalize      (GObject           *object);
+static void thunar_mount_health_mounts_reload (ThunarMountHealth *health);
+static void thunar_mount_health_mount_removed (GVolumeMonitor    *volume_monitor,
+                                               GMount            *mount,
+                                               ThunarMountHealth *health);
+static void thunar_mount_health_probe_free    (ThunarMountProbe  *probe);
+static void thunar_mount_health_probe_backoff (ThunarMountProbe  *probe);
+
+
+
+struct _ThunarMountHealthClass
+{
+  GObjectClass __parent__;
+};
+
+struct _ThunarMountHealth
+{
+  GObject         __parent__;
+
+  GVolumeMonitor *volume_monitor;
+};
+
+struct _ThunarMountProbe
+{
+  GFile     *root;
+
+  /* seconds until the next probe, doubled after each failure */
+  guint      interval;
+  guint      timer_id;
+
+  /* the running probe and the source giving up on it */
+  ThunarJob *job;
+  guint      timeout_id;
+  gboolean   failed;
+};
+
+
+
+static guint              health_signals[LAST_SIGNAL];
+static ThunarMountHealth *mount_health = NULL;
+
+/* protects the roots and the probes, which are looked up from the jobs */
+static GMutex             health_mutex;
+
+/* roots of the mounted GMounts, longest first */
+static GList             *health_mount_roots = NULL;
+
+/* root GFile of an unreachable mount -> ThunarMountProbe */
+static GHashTable        *health_probes = NULL;
+
+/* the number of probes, to skip the lock while everything is reachable */
+static gint               health_n_unreachable = 0;
+
+G_DEFINE_TYPE (ThunarMountHealth, thunar_mount_health, G_TYPE_OBJECT)
+
+
+
+static void
+thunar_mount_health_class_init (ThunarMountHealthClass *klass)
+{
+  GObjectClass *gobject_class;
+
+  gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->finalize = thunar_mount_health_finalize;
+
+  /**
+   * ThunarMountHealth::reachability-changed:
+   * @health    : a #ThunarMountHealth.
+   * @root      : the root #GFile of the mount.
+   * @reachable : whether the mount is reachable now.
+   *
+   * Emitted when the mount of @root was marked unreachable, and
+   * when a probe found it to be back.
+   **/
+  health_signals[REACHABILITY_CHANGED] =
+    g_signal_new (I_("reachability-changed"),
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL,
+                  _thunar_marshal_VOID__OBJECT_BOOLEAN,
+                  G_TYPE_NONE, 2, G_TYPE_FILE, G_TYPE_BOOLEAN);
+}
+
+
+
+static void
+thunar_mount_health_init (ThunarMountHealth *health)
+{
+  /* the mount list only changes with the volume monitor */
+  health->volume_monitor = g_volume_monitor_get ();
+  g_signal_connect_swapped (health->volume_monitor, "mount-added", G_CALLBACK (thunar_mount_health_mounts_reload), health);
+  g_signal_connect_swapped (health->volume_monitor, "mount-changed", G_CALLBACK (thunar_mount_health_mounts_reload), health);
+  g_signal_connect (health->volume_monitor, "mount-removed", G_CALLBACK (thunar_mount_health_mount_removed), health);
+  thunar_mount_health_mounts_reload (health);
+}
+
+
+
+static void
+thunar_mount_health_finalize (GObject *object)
+{
+  ThunarMountHealth *health = THUNAR_MOUNT_HEALTH (object);
+
+  g_signal_handlers_disconnect_by_data (health->volume_monitor, health);
+  g_object_unref (health->volume_monitor);
+
+  (*G_OBJECT_CLASS (thunar_mount_health_parent_class)->finalize) (object);
+}
+
+
+
+static gint
+thunar_mount_health_compare_roots (gconstpointer a,
+                                   gconstpointer b)
+{
+  gchar *uri_a = g_file_get_uri (G_FILE (a));
+  gchar *uri_b = g_file_get_uri (G_FILE (b));
+  gint   result;
+
+  /* longest first, so the first match is the innermost mount */
+  result = (gint) strlen (uri_b) - (gint) strlen (uri_a);
+
+  g_free (uri_a);
+  g_free (uri_b);
+
+  return result;
+}
+
+
+
+static void
+thunar_mount_health_mounts_reload (ThunarMountHealth *health)
+{
+  GList *mounts;
+  GList *roots = NULL;
+  GList *lp;
+
+  _thunar_return_if_fail (THUNAR_IS_MOUNT_HEALTH (health));
+
+  mounts = g_volume_monitor_get_mounts (health->volume_monitor);
+  for (lp = mounts; lp != NULL; lp = lp->next)
+    {
+      roots = g_list_prepend (roots, g_mount_get_root (lp->data));
+      g_object_unref (lp->data);
+    }
+  g_list_free (mounts);
+
+  roots = g_list_sort (roots, thunar_mount_health_compare_roots);
+
+  g_mutex_lock (&health_mutex);
+  lp = health_mount_roots;
+  health_mount_roots = roots;
+  g_mutex_unlock (&health_mutex);
+
+  g_list_free_full (lp, g_object_unref);
+}
+
+
+
+static void
+thunar_mount_health_mount_removed (GVolumeMonitor    *volume_monitor,
+                                   GMount            *mount,
+                                   ThunarMountHealth *health)
+{
+  ThunarMountProbe *probe;
+  GFile            *root;
+
+  _thunar_return_if_fail (G_IS_VOLUME_MONITOR (volume_monitor));
+  _thunar_return_if_fail (THUNAR_IS_MOUNT_HEALTH (health));
+
+  thunar_mount_health_mounts_reload (health);
+
+  /* the files of an unmounted mount are gone, no need to probe it */
+  root = g_mount_get_root (mount);
+  g_mutex_lock (&health_mutex);
+  probe = (health_probes != NULL) ? g_hash_table_lookup (health_probes, root) : NULL;
+  if (probe != NULL)
+    {
+      g_hash_table_remove (health_probes, root);
+      g_atomic_int_add (&health_n_unreachable, -1);
+    }
+  g_mutex_unlock (&health_mutex);
+  g_object_unref (root);
+
+  if (probe != NULL)
+    thunar_mount_health_probe_free (probe);
+}
+
+
+
+static ThunarMountHealth *
+thunar_mount_health_get_instance (void)
+{
+  /* the instance lives for the rest of the process */
+  if (G_UNLIKELY (mount_health == NULL))
+    mount_health = g_object_new (THUNAR_TYPE_MOUNT_HEALTH, NULL);
+
+  return mount_health;
+}
+
+
+
+/* must be called with the health_mutex held */
+static ThunarMountProbe *
+thunar_mount_health_find (GFile *file)
+{
+  GHashTableIter    iter;
+  ThunarMountProbe *probe;
+
+  if (health_probes == NULL)
+    return NULL;
+
+  g_hash_table_iter_init (&iter, health_probes);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &probe))
+    if (g_file_equal (file, probe->root) || g_file_has_prefix (file, probe->root))
+      return probe;
+
+  return NULL;
+}
+
+
+
+/* must be called with the health_mutex held */
+static GFile *
+thunar_mount_health_resolve_root (GFile *file)
+{
+  GFile *parent;
+  GFile *root;
+  GList *lp;
+
+  /* mounts known to gio, this covers the network mounts */
+  for (lp = health_mount_roots; lp != NULL; lp = lp->next)
+    if (g_file_equal (file, lp->data) || g_file_has_prefix (file, lp->data))
+      return g_object_ref (lp->data);
+
+  /* a local file outside of the mounts is on a local disk */
+  if (g_file_is_native (file))
+    return NULL;
+
+  /* else the server part of the location, like sftp://host/ */
+  root = g_object_ref (file);
+  while ((parent = g_file_get_parent (root)) != NULL)
+    {
+      g_object_unref (root);
+      root = parent;
+    }
+
+  return root;
+}
+
+
+
+static void
+thunar_mount_health_probe_stop (ThunarMountProbe *probe)
+{
+  if (probe->timeout_id != 0)
+    {
+      g_source_remove (probe->timeout_id);
+      probe->timeout_id = 0;
+    }
+
+  if (probe->job != NULL)
+    {
+      g_signal_handlers_disconnect_by_data (probe->job, probe);
+      exo_job_cancel (EXO_JOB (probe->job));
+      g_object_unref (probe->job);
+      probe->job = NULL;
+    }
+}
+
+
+
+static void
+thunar_mount_health_probe_free (ThunarMountProbe *probe)
+{
+  thunar_mount_health_probe_stop (probe);
+
+  if (probe->timer_id != 0)
+    g_source_remove (probe->timer_id);
+
+  g_object_unref (probe->root);
+  g_slice_free (ThunarMountProbe, probe);
+}
+
+
+
+static gboolean
+thunar_mount_health_probe_job (ThunarJob *job,
+                               GArray    *param_values,
+                               GError   **error)
+{
+  GFileInfo *info;
+  GFile     *root;
+
+  root = g_value_get_object (&g_array_index (param_values, GValue, 0));
+
+  /* the cheapest query that still needs an answer of the server */
+  info = g_file_query_info (root, G_FILE_ATTRIBUTE_STANDARD_TYPE, G_FILE_QUERY_INFO_NONE,
+                            exo_job_get_cancellable (EXO_JOB (job)), error);
+  if (info == NULL)
+    return FALSE;
+
+  g_object_unref (info);
+
+  return TRUE;
+}
+
+
+
+static void
+thunar_mount_health_probe_error (ExoJob           *job,
+                                 GError           *error,
+                                 ThunarMountProbe *probe)
+{
+  probe->failed = TRUE;
+}
+
+
+
+static void
+thunar_mount_health_probe_finished (ExoJob           *job,
+                                    ThunarMountProbe *probe)
+{
+  GFile *root;
+
+  thunar_mount_health_probe_stop (probe);
+
+  if (probe->failed)
+    {
+      thunar_mount_health_probe_backoff (probe);
+      return;
+    }
+
+  /* the mount is back, the files may be queried again */
+  root = g_object_ref (probe->root);
+  g_mutex_lock (&health_mutex);
+  g_hash_table_remove (health_probes, root);
+  g_atomic_int_add (&health_n_unreachable, -1);
+  g_mutex_unlock (&health_mutex);
+
+  thunar_mount_health_probe_free (probe);
+
+  g_signal_emit (G_OBJECT (thunar_mount_health_get_instance ()), health_signals[REACHABILITY_CHANGED], 0, root, TRUE);
+  g_object_unref (root);
+}
+
+
+
+static gboolean
+thunar_mount_health_probe_timeout (gpointer user_data)
+{
+  ThunarMountProbe *probe = user_data;
+
+  /* the job may hang in the IO of the mount, leave it behind */
+  probe->timeout_id = 0;
+  thunar_mount_health_probe_stop (probe);
+  thunar_mount_health_probe_backoff (probe);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+static gboolean
+thunar_mount_health_probe_start (gpointer user_data)
+{
+  ThunarMountProbe *probe = user_data;
+
+  probe->timer_id = 0;
+  probe->failed = FALSE;
+
+  /* the probe is scheduled next to the jobs of the views */
+  probe->job = thunar_simple_job_new (thunar_mount_health_probe_job, 1, G_TYPE_FILE, probe->root);
+  thunar_job_set_priority (probe->job, THUNAR_JOB_PRIORITY_VISIBLE);
+  g_signal_connect (probe->job, "error", G_CALLBACK (thunar_mount_health_probe_error), probe);
+  g_signal_connect (probe->job, "finished", G_CALLBACK (thunar_mount_health_probe_finished), probe);
+  exo_job_launch (EXO_JOB (probe->job));
+
+  probe->timeout_id = g_timeout_add_seconds (THUNAR_MOUNT_HEALTH_PROBE_TIMEOUT, thunar_mount_health_probe_timeout, probe);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+static void
+thunar_mount_health_probe_backoff (ThunarMountProbe *probe)
+{
+  probe->timer_id = g_timeout_add_seconds (probe->interval, thunar_mount_health_probe_start, probe);
+  probe->interval = MIN (probe->interval * 2, THUNAR_MOUNT_HEALTH_PROBE_INTERVAL_MAX);
+}
+
+
+
+static gboolean
+thunar_mount_health_unreachable_idle (gpointer user_data)
+{
+  ThunarMountProbe *probe;
+  GFile            *root = user_data;
+
+  g_mutex_lock (&health_mutex);
+  probe = g_hash_table_lookup (health_probes, root);
+  g_mutex_unlock (&health_mutex);
+
+  /* start probing, unless the mount is gone already */
+  if (probe != NULL && probe->timer_id == 0 && probe->job == NULL)
+    {
+      thunar_mount_health_probe_backoff (probe);
+      g_signal_emit (G_OBJECT (thunar_mount_health_get_instance ()), health_signals[REACHABILITY_CHANGED], 0, root, FALSE);
+    }
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+/**
+ * thunar_mount_health_get_default:
+ *
+ * Returns a reference to the default #ThunarMountHealth
+ * instance, to connect to its "reachability-changed" signal.
+ * Must be called from the main thread.
+ *
+ * The caller is responsible to free the returned instance
+ * using g_object_unref() when no longer needed.
+ *
+ * Return value: the default #ThunarMountHealth instance.
+ **/
+ThunarMountHealth *
+thunar_mount_health_get_default (void)
+{
+  return g_object_ref (thunar_mount_health_get_instance ());
+}
+
+
+
+/**
+ * thunar_mount_health_is_reachable:
+ * @file : a #GFile.
+ *
+ * Tells whether the mount of @file is not known to be unreachable.
+ * Never blocks, and is cheap while all mounts are reachable.
+ *
+ * Return value: %FALSE if the mount of @file is unreachable.
+ **/
+gboolean
+thunar_mount_health_is_reachable (GFile *file)
+{
+  gboolean reachable;
+
+  _thunar_return_val_if_fail (G_IS_FILE (file), TRUE);
+
+  if (G_LIKELY (g_atomic_int_get (&health_n_unreachable) == 0))
+    return TRUE;
+
+  g_mutex_lock (&health_mutex);
+  reachable = (thunar_mount_health_find (file) == NULL);
+  g_mutex_unlock (&health_mutex);
+
+  return reachable;
+}
+
+
+
+/**
+ * thunar_mount_health_set_error_if_unreachable:
+ * @file  : a #GFile.
+ * @error : return location for errors or %NULL.
+ *
+ * To be called before any blocking IO on @file. If the mount of
+ * @file is unreachable, @error is set to %G_IO_ERROR_HOST_UNREACHABLE,
+ * so the caller can fail right away instead of waiting for the
+ * connection to time out.
+ *
+ * Return value: %TRUE if @error was set, else %FALSE.
+ **/
+gboolean
+thunar_mount_health_set_error_if_unreachable (GFile   *file,
+                                              GError **error)
+{
+  gchar *display_name;
+
+  _thunar_return_val_if_fail (G_IS_FILE (file), FALSE);
+  _thunar_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  if (thunar_mount_health_is_reachable (file))
+    return FALSE;
+
+  display_name = g_file_get_parse_name (file);
+  g_set_error (error, G_IO_ERROR, G_IO_ERROR_HOST_UNREACHABLE,
+               _("The server of \"%s\" is not reachable"), display_name);
+  g_free (display_name);
+
+  return TRUE;
+}
+
+
+
+/**
+ * thunar_mount_health_report_error:
+ * @file  : a #GFile.
+ * @error : the error of an IO operation on @file, or %NULL.
+ *
+ * Marks the mount of @file as unreachable if @error tells that
+ * the server did not answer, and starts probing the mount until
+ * it answers again. Other errors are ignored.
+ *
+ * May be called from any thread.
+ **/
+void
+thunar_mount_health_report_error (GFile        *file,
+                                  const GError *error)
+{
+  ThunarMountProbe *probe;
+  GFile            *root = NULL;
+
+  _thunar_return_if_fail (G_IS_FILE (file));
+
+  if (error == NULL || error->domain != G_IO_ERROR)
+    return;
+
+  switch (error->code)
+    {
+    case G_IO_ERROR_TIMED_OUT:
+    case G_IO_ERROR_HOST_NOT_FOUND:
+    case G_IO_ERROR_HOST_UNREACHABLE:
+    case G_IO_ERROR_NETWORK_UNREACHABLE:
+    case G_IO_ERROR_CONNECTION_REFUSED:
+    case G_IO_ERROR_CONNECTION_CLOSED:
+    case G_IO_ERROR_NOT_CONNECTED:
+      break;
+
+    default:
+      return;
+    }
+
+  g_mutex_lock (&health_mutex);
+  if (G_UNLIKELY (health_probes == NULL))
+    health_probes = g_hash_table_new (g_file_hash, (GEqualFunc) g_file_equal);
+
+  if (thunar_mount_health_find (file) == NULL)
+    {
+      root = thunar_mount_health_resolve_root (file);
+      if (root != NULL)
+        {
+          probe = g_slice_new0 (ThunarMountProbe);
+          probe->root = g_object_ref (root);
+          probe->interval = THUNAR_MOUNT_HEALTH_PROBE_INTERVAL_MIN;
+          g_hash_table_insert (health_probes, probe->root, probe);
+          g_atomic_int_inc (&health_n_unreachable);
+        }
+    }
+  g_mutex_unlock (&health_mutex);
+
+  /* the probes and the signal belong to the main thread */
+  if (root != NULL)
+    g_main_context_invoke_full (NULL, G_PRIORITY_DEFAULT, thunar_mount_health_unreachable_idle, root, g_object_unref);
+}
@@ -0,0 +1,49 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __THUNAR_MOUNT_HEALTH_H__
+#define __THUNAR_MOUNT_HEALTH_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS;
+
+typedef struct _ThunarMountHealthClass ThunarMountHealthClass;
+typedef struct _ThunarMountHealth      ThunarMountHealth;
+
+#define THUNAR_TYPE_MOUNT_HEALTH            (thunar_mount_health_get_type ())
+#define THUNAR_MOUNT_HEALTH(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), THUNAR_TYPE_MOUNT_HEALTH, ThunarMountHealth))
+#define THUNAR_MOUNT_HEALTH_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), THUNAR_TYPE_MOUNT_HEALTH, ThunarMountHealthClass))
+#define THUNAR_IS_MOUNT_HEALTH(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), THUNAR_TYPE_MOUNT_HEALTH))
+#define THUNAR_IS_MOUNT_HEALTH_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), THUNAR_TYPE_MOUNT_HEALTH))
+#define THUNAR_MOUNT_HEALTH_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), THUNAR_TYPE_MOUNT_HEALTH, ThunarMountHealthClass))
+
+GType              thunar_mount_health_get_type                 (void) G_GNUC_CONST;
+
+ThunarMountHealth *thunar_mount_health_get_default              (void);
+
+gboolean           thunar_mount_health_is_reachable             (GFile         *file);
+
+gboolean           thunar_mount_health_set_error_if_unreachable (GFile         *file,
+                                                                 GError       **error);
+
+void               thunar_mount_health_report_error             (GFile         *file,
+                                                                 const GError  *error);
+
+G_END_DECLS;
+
+#endif /* !__THUNAR_MOUNT_HEALTH_H__ */
@@ -0,0 +1,310 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/* The mount table answers whether a path is on a local device without
+ * any IO, for the copy policy of the transfer jobs and the recursive
+ * search. The mount points of the volume monitor are kept in a tree
+ * of path components, so a lookup walks the path of the file once and
+ * ends at the innermost mount point. The table is built in the main
+ * thread when the application starts, and built again whenever the
+ * ThunarDeviceMonitor reports a device change. Lookups may happen in
+ * any thread. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include "thunar/thunar-device-monitor.h"
+#include "thunar/thunar-mount-table.h"
+#include "thunar/thunar-private.h"
+
+
+
+typedef struct _ThunarMountNode ThunarMountNode;
+struct _ThunarMountNode
+{
+  /* path component -> ThunarMountNode, or %NULL for a leaf */
+  GHashTable *children;
+
+  /* a mount point ends at this node, and whether it is a local device */
+  gboolean    is_mount_point;
+  gboolean    is_local;
+};
+
+
+
+static ThunarDeviceMonitor *mount_table_monitor = NULL;
+static GVolumeMonitor      *mount_table_volume_monitor = NULL;
+
+/* protects the tree and the device types, which are used from the jobs */
+static GMutex               mount_table_mutex;
+
+/* the node of "/", %NULL until the table is loaded */
+static ThunarMountNode     *mount_table_root = NULL;
+
+/* uri -> the device type of thunar_g_file_guess_device_type(), which may be %NULL */
+static GHashTable          *mount_table_device_types = NULL;
+
+
+
+static void
+thunar_mount_node_free (gpointer data)
+{
+  ThunarMountNode *node = data;
+
+  if (node->children != NULL)
+    g_hash_table_destroy (node->children);
+  g_slice_free (ThunarMountNode, node);
+}
+
+
+
+static void
+thunar_mount_node_insert (ThunarMountNode *root,
+                          const gchar     *path,
+                          gboolean         is_local)
+{
+  ThunarMountNode *node = root;
+  ThunarMountNode *child;
+  gchar          **components;
+  guint            n;
+
+  components = g_strsplit (path, G_DIR_SEPARATOR_S, -1);
+  for (n = 0; components[n] != NULL; ++n)
+    {
+      /* "//" and the leading and trailing separators */
+      if (*components[n] == '\0')
+        continue;
+
+      if (node->children == NULL)
+        node->children = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, thunar_mount_node_free);
+
+      child = g_hash_table_lookup (node->children, components[n]);
+      if (child == NULL)
+        {
+          child = g_slice_new0 (ThunarMountNode);
+          g_hash_table_insert (node->children, g_strdup (components[n]), child);
+        }
+      node = child;
+    }
+  g_strfreev (components);
+
+  node->is_mount_point = TRUE;
+  node->is_local = is_local;
+}
+
+
+
+static void
+thunar_mount_table_reload (void)
+{
+  ThunarMountNode *old_root;
+  ThunarMountNode *root;
+  GList           *mounts;
+  GList           *lp;
+  GFile           *mount_root;
+  gchar           *path;
+
+  root = g_slice_new0 (ThunarMountNode);
+
+  mounts = g_volume_monitor_get_mounts (mount_table_volume_monitor);
+  for (lp = mounts; lp != NULL; lp = lp->next)
+    {
+      mount_root = g_mount_get_root (lp->data);
+      path = g_file_get_path (mount_root);
+      if (path != NULL)
+        {
+          /* mount points which cannot be unmounted are local devices,
+           * attached devices like USB disks, fuse mounts, Samba shares
+           * or PTP devices can always be unmounted and are considered slow */
+          thunar_mount_node_insert (root, path, !g_mount_can_unmount (lp->data));
+          g_free (path);
+        }
+      g_object_unref (mount_root);
+      g_object_unref (lp->data);
+    }
+  g_list_free (mounts);
+
+  g_mutex_lock (&mount_table_mutex);
+  old_root = mount_table_root;
+  g_atomic_pointer_set (&mount_table_root, root);
+  g_hash_table_remove_all (mount_table_device_types);
+  g_mutex_unlock (&mount_table_mutex);
+
+  if (old_root != NULL)
+    thunar_mount_node_free (old_root);
+}
+
+
+
+/**
+ * thunar_mount_table_load:
+ *
+ * Builds the mount table, to be called from the main thread when
+ * the application starts. Later changes are picked up by the table
+ * itself.
+ **/
+void
+thunar_mount_table_load (void)
+{
+  if (G_LIKELY (mount_table_monitor != NULL))
+    return;
+
+  mount_table_device_types = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  mount_table_volume_monitor = g_volume_monitor_get ();
+
+  /* the device monitor coalesces the events of the volume monitor */
+  mount_table_monitor = thunar_device_monitor_get ();
+  g_signal_connect_swapped (mount_table_monitor, "device-added", G_CALLBACK (thunar_mount_table_reload), NULL);
+  g_signal_connect_swapped (mount_table_monitor, "device-removed", G_CALLBACK (thunar_mount_table_reload), NULL);
+  g_signal_connect_swapped (mount_table_monitor, "device-changed", G_CALLBACK (thunar_mount_table_reload), NULL);
+
+  thunar_mount_table_reload ();
+}
+
+
+
+/**
+ * thunar_mount_table_lookup_local:
+ * @file            : a #GFile.
+ * @is_local_return : return location for whether @file is on a local device.
+ *
+ * Finds the innermost mount point of @file, see
+ * thunar_g_file_is_on_local_device() for what makes a local device.
+ * The file is not required to exist. Never blocks on IO.
+ *
+ * Return value: %FALSE if the table is not loaded yet or @file has
+ *               no local path, and @is_local_return was not set.
+ **/
+gboolean
+thunar_mount_table_lookup_local (GFile    *file,
+                                 gboolean *is_local_return)
+{
+  ThunarMountNode *node;
+  gchar           *path;
+  gchar           *component;
+  gchar           *end;
+  gboolean         is_local = TRUE;
+
+  _thunar_return_val_if_fail (G_IS_FILE (file), FALSE);
+  _thunar_return_val_if_fail (is_local_return != NULL, FALSE);
+
+  if (g_atomic_pointer_get (&mount_table_root) == NULL)
+    return FALSE;
+
+  path = g_file_get_path (file);
+  if (path == NULL)
+    return FALSE;
+
+  g_mutex_lock (&mount_table_mutex);
+
+  /* files outside of the mounts are on the local partitions */
+  node = mount_table_root;
+  for (component = path; node != NULL && node->children != NULL; component = end)
+    {
+      while (*component == G_DIR_SEPARATOR)
+        component++;
+      if (*component == '\0')
+        break;
+
+      /* terminate the component in place, the path is a copy */
+      end = strchr (component, G_DIR_SEPARATOR);
+      if (end != NULL)
+        *end++ = '\0';
+      else
+        end = component + strlen (component);
+
+      node = g_hash_table_lookup (node->children, component);
+      if (node != NULL && node->is_mount_point)
+        is_local = node->is_local;
+    }
+
+  g_mutex_unlock (&mount_table_mutex);
+
+  g_free (path);
+
+  *is_local_return = is_local;
+
+  return TRUE;
+}
+
+
+
+/**
+ * thunar_mount_table_lookup_device_type:
+ * @file               : a #GFile.
+ * @device_type_return : return location for the device type.
+ *
+ * Looks up the device type of @file remembered with
+ * thunar_mount_table_remember_device_type(). The remembered types are
+ * forgotten whenever a device changes.
+ *
+ * Return value: %TRUE if @device_type_return was set, which may be
+ *               to %NULL, else %FALSE.
+ **/
+gboolean
+thunar_mount_table_lookup_device_type (GFile        *file,
+                                       const gchar **device_type_return)
+{
+  gpointer  device_type;
+  gboolean  found = FALSE;
+  gchar    *uri;
+
+  _thunar_return_val_if_fail (G_IS_FILE (file), FALSE);
+  _thunar_return_val_if_fail (device_type_return != NULL, FALSE);
+
+  if (g_atomic_pointer_get (&mount_table_root) == NULL)
+    return FALSE;
+
+  uri = g_file_get_uri (file);
+
+  g_mutex_lock (&mount_table_mutex);
+  found = g_hash_table_lookup_extended (mount_table_device_types, uri, NULL, &device_type);
+  g_mutex_unlock (&mount_table_mutex);
+
+  g_free (uri);
+
+  if (found)
+    *device_type_return = device_type;
+
+  return found;
+}
+
+
+
+/**
+ * thunar_mount_table_remember_device_type:
+ * @file        : a #GFile.
+ * @device_type : the device type of @file, a static string or %NULL.
+ *
+ * Remembers the device type of @file until a device changes.
+ **/
+void
+thunar_mount_table_remember_device_type (GFile       *file,
+                                         const gchar *device_type)
+{
+  _thunar_return_if_fail (G_IS_FILE (file));
+
+  if (g_atomic_pointer_get (&mount_table_root) == NULL)
+    return;
+
+  g_mutex_lock (&mount_table_mutex);
+  g_hash_table_replace (mount_table_device_types, g_file_get_uri (file), (gpointer) device_type);
+  g_mutex_unlock (&mount_table_mutex);
+}
@@ -0,0 +1,35 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __THUNAR_MOUNT_TABLE_H__
+#define __THUNAR_MOUNT_TABLE_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+void     thunar_mount_table_load                 (void);
+gboolean thunar_mount_table_lookup_local         (GFile        *file,
+                                                  gboolean     *is_local_return);
+gboolean thunar_mount_table_lookup_device_type   (GFile        *file,
+                                                  const gchar **device_type_return);
+void     thunar_mount_table_remember_device_type (GFile        *file,
+                                                  const gchar  *device_type);
+
+G_END_DECLS
+
+#endif /* !__THUNAR_MOUNT_TABLE_H__ */
@@ -203,6 +203,27 @@ thunar_pango_attr_list_small (void)
 
 
 
+/**
+ * thunar_pango_attr_list_small_monospace:
+ *
+ * Returns a #PangoAttrList for rendering small text in a
+ * monospace font, for columns lined up with spaces.
+ * The returned list is owned by the callee and must
+ * not be freed or modified by the caller.
+ *
+ * Return value: a #PangoAttrList for rendering small monospace text.
+ **/
+PangoAttrList*
+thunar_pango_attr_list_small_monospace (void)
+{
+  static PangoAttrList *attr_list = NULL;
+  if (G_UNLIKELY (attr_list == NULL))
+    attr_list = thunar_pango_attr_list_wrap (pango_attr_scale_new (PANGO_SCALE_SMALL), pango_attr_family_new ("monospace"), NULL);
+  return attr_list;
+}
+
+
+
 /**
  * thunar_pango_attr_list_underline_single:
  *
@@ -33,6 +33,7 @@ PangoAttrList *thunar_pango_attr_disable_hyphens        (void) G_GNUC_CONST;
 PangoAttrList *thunar_pango_attr_list_italic            (void) G_GNUC_CONST;
 PangoAttrList *thunar_pango_attr_list_small_italic      (void) G_GNUC_CONST;
 PangoAttrList *thunar_pango_attr_list_small             (void) G_GNUC_CONST;
+PangoAttrList *thunar_pango_attr_list_small_monospace   (void) G_GNUC_CONST;
 PangoAttrList *thunar_pango_attr_list_underline_single  (void) G_GNUC_CONST;
 
 G_END_DECLS;
@@ -38,10 +38,12 @@
 
 #include <gdk/gdkkeysyms.h>
 
+#include "thunar/thunar-completion-index.h"
+#include "thunar/thunar-frecency.h"
+#include "thunar/thunar-gio-extensions.h"
 #include "thunar/thunar-gobject-extensions.h"
 #include "thunar/thunar-icon-factory.h"
 #include "thunar/thunar-icon-renderer.h"
-#include "thunar/thunar-list-model.h"
 #include "thunar/thunar-path-entry.h"
 #include "thunar/thunar-private.h"
 #include "thunar/thunar-util.h"
@@ -51,6 +53,10 @@
 
 #define ICON_MARGIN (2)
 
+/* the maximum number of rows in the completion model, the popup only shows
+ * the first few of them anyway and the user narrows the list by typing */
+#define MAX_COMPLETION_ROWS (100)
+
 
 
 enum
@@ -59,6 +65,15 @@ enum
   PROP_CURRENT_FILE,
 };
 
+/* Columns of the completion model */
+enum
+{
+  COMPLETION_COLUMN_FILE,
+  COMPLETION_COLUMN_NAME,
+  COMPLETION_COLUMN_IS_DIRECTORY,
+  N_COMPLETION_COLUMNS,
+};
+
 
 
 static void     thunar_path_entry_editable_init                 (GtkEditableInterface *iface);
@@ -96,6 +111,13 @@ static void     thunar_path_entry_drag_data_get                 (GtkWidget
 static void     thunar_path_entry_activate                      (GtkEntry             *entry);
 static void     thunar_path_entry_changed                       (GtkEditable          *editable);
 static void     thunar_path_entry_update_icon                   (ThunarPathEntry      *path_entry);
+static void     thunar_path_entry_set_completion_index          (ThunarPathEntry      *path_entry,
+                                                                 GFile                *directory);
+static void     thunar_path_entry_completion_index_changed      (ThunarPathEntry      *path_entry);
+static ThunarFile *thunar_path_entry_completion_file           (ThunarPathEntry      *path_entry,
+                                                                 const gchar          *name);
+static GHashTable *thunar_path_entry_frecent_names             (ThunarPathEntry      *path_entry);
+static void     thunar_path_entry_update_completion             (ThunarPathEntry      *path_entry);
 static void     thunar_path_entry_do_insert_text                (GtkEditable          *editable,
                                                                  const gchar          *new_text,
                                                                  gint                  new_text_length,
@@ -105,7 +127,7 @@ static void     thunar_path_entry_common_prefix_append          (ThunarPathEntry
                                                                  gboolean              highlight);
 static void     thunar_path_entry_common_prefix_lookup          (ThunarPathEntry      *path_entry,
                                                                  gchar               **prefix_return,
-                                                                 ThunarFile          **file_return);
+                                                                 gboolean             *is_directory_return);
 static gboolean thunar_path_entry_match_func                    (GtkEntryCompletion   *completion,
                                                                  const gchar          *key,
                                                                  GtkTreeIter          *iter,
@@ -146,6 +168,7 @@ struct _ThunarPathEntry
   guint              in_change : 1;
   guint              has_completion : 1;
   guint              check_completion_idle_id;
+  ThunarCompletionIndex *completion_index;
 
   gboolean           search_mode;
 };
@@ -231,7 +254,7 @@ thunar_path_entry_init (ThunarPathEntry *path_entry)
 {
   GtkEntryCompletion *completion;
   GtkCellRenderer    *renderer;
-  ThunarStandardViewModel *store;
+  GtkListStore       *store;
 
   path_entry->check_completion_idle_id = 0;
   path_entry->working_directory = NULL;
@@ -245,19 +268,16 @@ thunar_path_entry_init (ThunarPathEntry *path_entry)
   /* add the icon renderer to the entry completion */
   renderer = g_object_new (THUNAR_TYPE_ICON_RENDERER, "size", 16, NULL);
   gtk_cell_layout_pack_start (GTK_CELL_LAYOUT (completion), renderer, FALSE);
-  gtk_cell_layout_add_attribute (GTK_CELL_LAYOUT (completion), renderer, "file", THUNAR_COLUMN_FILE);
+  gtk_cell_layout_add_attribute (GTK_CELL_LAYOUT (completion), renderer, "file", COMPLETION_COLUMN_FILE);
 
   /* add the text renderer to the entry completion */
   renderer = gtk_cell_renderer_text_new ();
   gtk_cell_layout_pack_start (GTK_CELL_LAYOUT (completion), renderer, TRUE);
-  gtk_cell_layout_add_attribute (GTK_CELL_LAYOUT (completion), renderer, "text", THUNAR_COLUMN_NAME);
-
-  /* allocate a new list mode for the completion */
-  store = thunar_list_model_new ();
-  thunar_list_model_check_file_in_model_before_use (THUNAR_LIST_MODEL (store));
-  thunar_standard_view_model_set_show_hidden (store, TRUE);
-  thunar_standard_view_model_set_folders_first (store, TRUE);
-  gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (store), THUNAR_COLUMN_FILE_NAME, GTK_SORT_ASCENDING);
+  gtk_cell_layout_add_attribute (GTK_CELL_LAYOUT (completion), renderer, "text", COMPLETION_COLUMN_NAME);
+
+  /* allocate a new list store for the completion, it only holds the names matching
+   * the entered prefix, which thunar_path_entry_update_completion() looks up */
+  store = gtk_list_store_new (N_COMPLETION_COLUMNS, THUNAR_TYPE_FILE, G_TYPE_STRING, G_TYPE_BOOLEAN);
   gtk_entry_completion_set_model (completion, GTK_TREE_MODEL (store));
   g_object_unref (G_OBJECT (store));
 
@@ -315,6 +335,9 @@ thunar_path_entry_finalize (GObject *object)
   if (G_UNLIKELY (path_entry->check_completion_idle_id != 0))
     g_source_remove (path_entry->check_completion_idle_id);
 
+  /* release the completion index */
+  thunar_path_entry_set_completion_index (path_entry, NULL);
+
   (*G_OBJECT_CLASS (thunar_path_entry_parent_class)->finalize) (object);
 }
 
@@ -573,10 +596,7 @@ thunar_path_entry_activate (GtkEntry *entry)
 static void
 thunar_path_entry_changed (GtkEditable *editable)
 {
-  GtkEntryCompletion *completion;
   ThunarPathEntry    *path_entry = THUNAR_PATH_ENTRY (editable);
-  ThunarFolder       *folder;
-  GtkTreeModel       *model;
   const gchar        *text;
   gchar              *scheme;
   ThunarFile         *current_folder;
@@ -645,9 +665,6 @@ thunar_path_entry_changed (GtkEditable *editable)
   current_folder = (folder_path != NULL) ? thunar_file_get (folder_path, NULL) : NULL;
   current_file = (file_path != NULL) ? thunar_file_get (file_path, NULL) : NULL;
 
-  /* determine the entry completion */
-  completion = gtk_entry_get_completion (GTK_ENTRY (path_entry));
-
   /* update the current folder if required */
   if (current_folder != path_entry->current_folder)
     {
@@ -658,26 +675,11 @@ thunar_path_entry_changed (GtkEditable *editable)
       if (G_LIKELY (current_folder != NULL))
         g_object_ref (G_OBJECT (current_folder));
 
-      /* try to open the current-folder file as folder */
+      /* enumerate the names of the current folder for the completion in the background */
       if (current_folder != NULL && thunar_file_is_directory (current_folder))
-        folder = thunar_folder_get_for_file (current_folder);
+        thunar_path_entry_set_completion_index (path_entry, thunar_file_get_file (current_folder));
       else
-        folder = NULL;
-
-      /* set the new folder for the completion model, but disconnect the model from the
-       * completion first, because GtkEntryCompletion has become very slow recently when
-       * updating the model being used (https://bugzilla.xfce.org/show_bug.cgi?id=1681).
-       */
-      model = gtk_entry_completion_get_model (completion);
-      g_object_ref (G_OBJECT (model));
-      gtk_entry_completion_set_model (completion, NULL);
-      thunar_standard_view_model_set_folder (THUNAR_STANDARD_VIEW_MODEL (model), folder, NULL);
-      gtk_entry_completion_set_model (completion, model);
-      g_object_unref (G_OBJECT (model));
-
-      /* cleanup */
-      if (G_LIKELY (folder != NULL))
-        g_object_unref (G_OBJECT (folder));
+        thunar_path_entry_set_completion_index (path_entry, NULL);
 
       /* we most likely need a new icon */
       update_icon = TRUE;
@@ -706,6 +708,9 @@ thunar_path_entry_changed (GtkEditable *editable)
   if (update_icon)
     thunar_path_entry_update_icon (path_entry);
 
+  /* look up the names matching the new text */
+  thunar_path_entry_update_completion (path_entry);
+
   /* cleanup */
   if (G_LIKELY (current_folder != NULL))
     g_object_unref (G_OBJECT (current_folder));
@@ -718,6 +723,204 @@ thunar_path_entry_changed (GtkEditable *editable)
 }
 
 
+
+static void
+thunar_path_entry_set_completion_index (ThunarPathEntry *path_entry,
+                                        GFile           *directory)
+{
+  _thunar_return_if_fail (THUNAR_IS_PATH_ENTRY (path_entry));
+  _thunar_return_if_fail (directory == NULL || G_IS_FILE (directory));
+
+  /* check if we already have the index for the directory */
+  if (path_entry->completion_index != NULL)
+    {
+      if (directory != NULL && g_file_equal (directory, thunar_completion_index_get_file (path_entry->completion_index)))
+        return;
+
+      /* release the previous index */
+      g_signal_handlers_disconnect_by_func (G_OBJECT (path_entry->completion_index), thunar_path_entry_completion_index_changed, path_entry);
+      g_object_unref (G_OBJECT (path_entry->completion_index));
+      path_entry->completion_index = NULL;
+    }
+
+  /* the index enumerates the directory in the background and emits "changed" as it finds names */
+  if (G_LIKELY (directory != NULL))
+    {
+      path_entry->completion_index = thunar_completion_index_get_for_file (directory);
+      g_signal_connect_swapped (G_OBJECT (path_entry->completion_index), "changed",
+                                G_CALLBACK (thunar_path_entry_completion_index_changed), path_entry);
+    }
+}
+
+
+
+static void
+thunar_path_entry_completion_index_changed (ThunarPathEntry *path_entry)
+{
+  _thunar_return_if_fail (THUNAR_IS_PATH_ENTRY (path_entry));
+
+  /* look up the entered prefix again, including the names found meanwhile */
+  thunar_path_entry_update_completion (path_entry);
+
+  /* refilter the popup if the user is typing */
+  if (gtk_widget_has_focus (GTK_WIDGET (path_entry)))
+    gtk_entry_completion_complete (gtk_entry_get_completion (GTK_ENTRY (path_entry)));
+}
+
+
+
+static ThunarFile*
+thunar_path_entry_completion_file (ThunarPathEntry *path_entry,
+                                   const gchar     *name)
+{
+  ThunarFile *file;
+  GFile      *directory;
+  GFile      *child;
+
+  directory = thunar_completion_index_get_file (path_entry->completion_index);
+  child = g_file_get_child_for_display_name (directory, name, NULL);
+  if (G_UNLIKELY (child == NULL))
+    return NULL;
+
+  /* the file is only needed for the icon, so avoid querying remote locations
+   * for every row and leave the icon empty for files not loaded yet */
+  file = thunar_file_cache_lookup (child);
+  if (file != NULL)
+    g_object_ref (G_OBJECT (file));
+  else if (g_file_is_native (child))
+    file = thunar_file_get (child, NULL);
+
+  g_object_unref (G_OBJECT (child));
+
+  return file;
+}
+
+
+
+static GHashTable*
+thunar_path_entry_frecent_names (ThunarPathEntry *path_entry)
+{
+  GHashTable *names;
+  GList      *locations;
+  GList      *lp;
+  gchar      *basename;
+
+  names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+  /* the display names of the visited folders in the completed folder */
+  locations = thunar_frecency_get_children (thunar_completion_index_get_file (path_entry->completion_index));
+  for (lp = locations; lp != NULL; lp = lp->next)
+    {
+      basename = g_file_get_basename (lp->data);
+      if (G_LIKELY (basename != NULL))
+        g_hash_table_add (names, g_filename_display_name (basename));
+      g_free (basename);
+    }
+  thunar_g_list_free_full (locations);
+
+  return names;
+}
+
+
+
+static void
+thunar_path_entry_update_completion (ThunarPathEntry *path_entry)
+{
+  GtkEntryCompletion *completion;
+  GtkTreeModel       *model;
+  GtkTreeIter         iter;
+  const gchar        *text;
+  const gchar        *last_slash;
+  const gchar        *name;
+  ThunarFile         *file;
+  gboolean            is_directory;
+  GHashTable         *frecent_names;
+  GList              *previous_files = NULL;
+  gchar              *key;
+  guint               n_matches = 0;
+  guint               n_rows = 0;
+  guint               first = 0;
+  guint               pass;
+  guint               n;
+
+  _thunar_return_if_fail (THUNAR_IS_PATH_ENTRY (path_entry));
+
+  completion = gtk_entry_get_completion (GTK_ENTRY (path_entry));
+  model = gtk_entry_completion_get_model (completion);
+  if (G_UNLIKELY (model == NULL))
+    return;
+
+  /* keep the files of the previous rows alive, so the cache still knows the ones listed again */
+  if (gtk_tree_model_get_iter_first (model, &iter))
+    {
+      do
+        {
+          gtk_tree_model_get (model, &iter, COMPLETION_COLUMN_FILE, &file, -1);
+          if (G_LIKELY (file != NULL))
+            previous_files = g_list_prepend (previous_files, file);
+        }
+      while (gtk_tree_model_iter_next (model, &iter));
+    }
+
+  /* refill the model, but disconnect it from the completion first, because
+   * GtkEntryCompletion has become very slow recently when updating the model
+   * being used (https://bugzilla.xfce.org/show_bug.cgi?id=1681).
+   */
+  g_object_ref (G_OBJECT (model));
+  gtk_entry_completion_set_model (completion, NULL);
+  gtk_list_store_clear (GTK_LIST_STORE (model));
+
+  if (path_entry->completion_index != NULL && !path_entry->search_mode)
+    {
+      /* the prefix is the text after the last slash */
+      text = gtk_entry_get_text (GTK_ENTRY (path_entry));
+      last_slash = strrchr (text, G_DIR_SEPARATOR);
+      if (G_LIKELY (last_slash != NULL))
+        text = last_slash + 1;
+
+      key = thunar_completion_index_make_key (text);
+      n_matches = thunar_completion_index_lookup (path_entry->completion_index, key, &first);
+      g_free (key);
+
+      /* list the folders first, the frequently visited ones before the others */
+      frecent_names = thunar_path_entry_frecent_names (path_entry);
+      for (pass = (g_hash_table_size (frecent_names) > 0) ? 0 : 1; pass < 3; ++pass)
+        for (n = first; n < first + n_matches && n_rows < MAX_COMPLETION_ROWS; ++n)
+          {
+            is_directory = thunar_completion_index_is_directory (path_entry->completion_index, n);
+            if (is_directory != (pass < 2))
+              continue;
+
+            /* hidden files only if the user started typing their name */
+            if (*text == '\0' && thunar_completion_index_is_hidden (path_entry->completion_index, n))
+              continue;
+
+            name = thunar_completion_index_get_name (path_entry->completion_index, n);
+            if (pass < 2 && g_hash_table_contains (frecent_names, name) != (pass == 0))
+              continue;
+
+            file = thunar_path_entry_completion_file (path_entry, name);
+            gtk_list_store_insert_with_values (GTK_LIST_STORE (model), NULL, -1,
+                                               COMPLETION_COLUMN_FILE, file,
+                                               COMPLETION_COLUMN_NAME, name,
+                                               COMPLETION_COLUMN_IS_DIRECTORY, is_directory,
+                                               -1);
+            if (G_LIKELY (file != NULL))
+              g_object_unref (G_OBJECT (file));
+            ++n_rows;
+          }
+      g_hash_table_destroy (frecent_names);
+    }
+
+  gtk_entry_completion_set_model (completion, model);
+  g_object_unref (G_OBJECT (model));
+
+  /* cleanup */
+  g_list_free_full (previous_files, g_object_unref);
+}
+
+
+
 static void
 thunar_path_entry_update_icon (ThunarPathEntry *path_entry)
 {
@@ -812,7 +1015,7 @@ thunar_path_entry_common_prefix_append (ThunarPathEntry *path_entry,
 {
   const gchar *last_slash;
   const gchar *text;
-  ThunarFile  *file;
+  gboolean     is_directory;
   gchar       *prefix;
   gchar       *tmp;
   gint         prefix_length;
@@ -821,21 +1024,14 @@ thunar_path_entry_common_prefix_append (ThunarPathEntry *path_entry,
   gint         base;
 
   /* determine the common prefix */
-  thunar_path_entry_common_prefix_lookup (path_entry, &prefix, &file);
+  thunar_path_entry_common_prefix_lookup (path_entry, &prefix, &is_directory);
 
-  /* check if we should append a slash to the prefix */
-  if (G_LIKELY (file != NULL))
+  /* we only append slashes for directories */
+  if (G_LIKELY (prefix != NULL && is_directory))
     {
-      /* we only append slashes for directories */
-      if (thunar_file_is_directory (file) && file != path_entry->current_file)
-        {
-          tmp = g_strconcat (prefix, G_DIR_SEPARATOR_S, NULL);
-          g_free (prefix);
-          prefix = tmp;
-        }
-
-      /* release the file */
-      g_object_unref (G_OBJECT (file));
+      tmp = g_strconcat (prefix, G_DIR_SEPARATOR_S, NULL);
+      g_free (prefix);
+      prefix = tmp;
     }
 
   /* check if we have a common prefix */
@@ -907,17 +1103,19 @@ thunar_path_entry_has_prefix_casefolded (const gchar *string,
 static void
 thunar_path_entry_common_prefix_lookup (ThunarPathEntry *path_entry,
                                         gchar          **prefix_return,
-                                        ThunarFile     **file_return)
+                                        gboolean        *is_directory_return)
 {
-  GtkTreeModel *model;
-  GtkTreeIter   iter;
-  const gchar  *text;
-  const gchar  *s;
-  gchar        *name;
-  gchar        *t;
+  const gchar *text;
+  const gchar *name;
+  const gchar *s;
+  gchar       *key;
+  gchar       *t;
+  guint        n_matches;
+  guint        first;
+  guint        n;
 
   *prefix_return = NULL;
-  *file_return = NULL;
+  *is_directory_return = FALSE;
 
   /* lookup the last slash character in the entry text */
   text = gtk_entry_get_text (GTK_ENTRY (path_entry));
@@ -927,48 +1125,41 @@ thunar_path_entry_common_prefix_lookup (ThunarPathEntry *path_entry,
   else if (G_LIKELY (s != NULL))
     text = s + 1;
 
-  /* check all items in the model */
-  model = gtk_entry_completion_get_model (gtk_entry_get_completion (GTK_ENTRY (path_entry)));
-  if (gtk_tree_model_get_iter_first (model, &iter))
+  /* nothing to complete without the names of the folder */
+  if (G_UNLIKELY (path_entry->completion_index == NULL))
+    return;
+
+  /* check all names sharing the entered prefix */
+  key = thunar_completion_index_make_key (text);
+  n_matches = thunar_completion_index_lookup (path_entry->completion_index, key, &first);
+  g_free (key);
+
+  for (n = first; n < first + n_matches; ++n)
     {
-      do
-        {
-          /* determine the real file name for the iter */
-          gtk_tree_model_get (model, &iter, THUNAR_COLUMN_FILE_NAME, &name, -1);
+      name = thunar_completion_index_get_name (path_entry->completion_index, n);
 
-          /* check if we have a valid prefix here */
-          if (thunar_path_entry_has_prefix_casefolded (name, text))
-            {
-              /* check if we're the first to match */
-              if (*prefix_return == NULL)
-                {
-                  /* remember the prefix */
-                  *prefix_return = g_strdup (name);
-
-                  /* determine the file for the iter */
-                  gtk_tree_model_get (model, &iter, THUNAR_COLUMN_FILE, file_return, -1);
-                }
-              else
-                {
-                  /* we already have another prefix, so determine the common part */
-                  for (s = name, t = *prefix_return; *s != '\0' && *s == *t; ++s, ++t)
-                    ;
-                  *t = '\0';
-
-                  /* release the file, since it's not a unique match */
-                  if (G_LIKELY (*file_return != NULL))
-                    {
-                      g_object_unref (G_OBJECT (*file_return));
-                      *file_return = NULL;
-                    }
-                }
-            }
+      /* check if we're the first to match */
+      if (*prefix_return == NULL)
+        {
+          /* remember the prefix */
+          *prefix_return = g_strdup (name);
+          *is_directory_return = thunar_completion_index_is_directory (path_entry->completion_index, n);
+        }
+      else
+        {
+          /* we already have another prefix, so determine the common part */
+          for (s = name, t = *prefix_return; *s != '\0' && *s == *t; ++s, ++t)
+            ;
+          *t = '\0';
 
-          /* cleanup */
-          g_free (name);
+          /* not a unique match */
+          *is_directory_return = FALSE;
         }
-      while (gtk_tree_model_iter_next (model, &iter));
     }
+
+  /* no slash for a folder whose name was entered completely already */
+  if (*prefix_return != NULL && strcmp (*prefix_return, text) == 0)
+    *is_directory_return = FALSE;
 }
 
 
@@ -982,7 +1173,6 @@ thunar_path_entry_match_func (GtkEntryCompletion *completion,
   GtkTreeModel    *model;
   ThunarPathEntry *path_entry;
   const gchar     *last_slash;
-  ThunarFile      *file;
   gboolean         matched;
   gchar           *text_normalized;
   gchar           *name_normalized;
@@ -1009,10 +1199,8 @@ thunar_path_entry_match_func (GtkEntryCompletion *completion,
   last_slash = strrchr (text_normalized, G_DIR_SEPARATOR);
   if (G_UNLIKELY (last_slash != NULL && last_slash[1] == '\0'))
     {
-      /* check if the file is hidden */
-      gtk_tree_model_get (model, iter, THUNAR_COLUMN_FILE, &file, -1);
-      matched = !thunar_file_is_hidden (file);
-      g_object_unref (G_OBJECT (file));
+      /* hidden files were not added to the model for an empty prefix */
+      matched = TRUE;
     }
   else
     {
@@ -1022,7 +1210,7 @@ thunar_path_entry_match_func (GtkEntryCompletion *completion,
         last_slash += 1;
 
       /* determine the real file name for the iter */
-      gtk_tree_model_get (model, iter, THUNAR_COLUMN_FILE_NAME, &name, -1);
+      gtk_tree_model_get (model, iter, COMPLETION_COLUMN_NAME, &name, -1);
       name_normalized = g_utf8_normalize (name, -1, G_NORMALIZE_ALL);
       if (G_LIKELY (name_normalized != NULL))
         g_free (name);
@@ -1056,19 +1244,19 @@ thunar_path_entry_match_selected (GtkEntryCompletion *completion,
   ThunarPathEntry *path_entry = THUNAR_PATH_ENTRY (user_data);
   const gchar     *last_slash;
   const gchar     *text;
-  ThunarFile      *file;
+  gboolean         is_directory;
   gchar           *real_name;
   gchar           *tmp;
   gint             offset;
 
-  /* determine the file for the iterator */
-  gtk_tree_model_get (model, iter, THUNAR_COLUMN_FILE, &file, -1);
-
-  /* determine the real name for the file */
-  gtk_tree_model_get (model, iter, THUNAR_COLUMN_FILE_NAME, &real_name, -1);
+  /* determine the real name for the iterator */
+  gtk_tree_model_get (model, iter,
+                      COMPLETION_COLUMN_NAME, &real_name,
+                      COMPLETION_COLUMN_IS_DIRECTORY, &is_directory,
+                      -1);
 
   /* append a slash if we have a folder here */
-  if (G_LIKELY (thunar_file_is_directory (file)))
+  if (G_LIKELY (is_directory))
     {
       tmp = g_strconcat (real_name, G_DIR_SEPARATOR_S, NULL);
       g_free (real_name);
@@ -1093,7 +1281,6 @@ thunar_path_entry_match_selected (GtkEntryCompletion *completion,
   gtk_editable_set_position (GTK_EDITABLE (path_entry), -1);
 
   /* cleanup */
-  g_object_unref (G_OBJECT (file));
   g_free (real_name);
 
   return TRUE;
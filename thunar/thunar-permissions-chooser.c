@@ -1137,13 +1137,12 @@ static void
 thunar_permissions_chooser_fixperm_clicked (ThunarPermissionsChooser *chooser,
                                             GtkWidget                *button)
 {
-  ThunarFileMode mode;
-  GtkWidget     *dialog;
-  GtkWidget     *window;
-  ThunarJob     *job;
-  gint           response;
-  GList         *lp;
-  GList          file_list;
+  GtkWidget *dialog;
+  GtkWidget *window;
+  ThunarJob *job;
+  gint       response;
+  GList     *lp;
+  GList     *file_list = NULL;
 
   _thunar_return_if_fail (THUNAR_IS_PERMISSIONS_CHOOSER (chooser));
   _thunar_return_if_fail (chooser->fixperm_button == button);
@@ -1182,30 +1181,19 @@ thunar_permissions_chooser_fixperm_clicked (ThunarPermissionsChooser *chooser,
       for (lp = chooser->files; lp != NULL; lp = lp->next)
         {
           /* skip files that are fine */
-          if (!thunar_permissions_chooser_is_fixable_directory (THUNAR_FILE (lp->data)))
-            continue;
-
-          /* determine the current mode */
-          mode = thunar_file_get_mode (THUNAR_FILE (lp->data));
-
-          /* determine the new mode (making sure the owner can read/enter the folder) */
-          mode = (THUNAR_FILE_MODE_USR_READ | THUNAR_FILE_MODE_USR_EXEC)
-               | (((mode & THUNAR_FILE_MODE_GRP_READ) != 0) ? THUNAR_FILE_MODE_GRP_EXEC : 0)
-               | (((mode & THUNAR_FILE_MODE_OTH_READ) != 0) ? THUNAR_FILE_MODE_OTH_EXEC : 0);
-
-          file_list.prev = NULL;
-          file_list.data = thunar_file_get_file (THUNAR_FILE (lp->data));
-          file_list.next = NULL;
+          if (thunar_permissions_chooser_is_fixable_directory (THUNAR_FILE (lp->data)))
+            file_list = g_list_prepend (file_list, thunar_file_get_file (THUNAR_FILE (lp->data)));
+        }
 
-          /* try to allocate the new job */
-          job = thunar_io_jobs_change_mode (&file_list,
-                                            0511, mode, 0000, 0000, FALSE);
-          exo_job_launch (EXO_JOB (job));
+      /* one job fixes all the folders and the folders below them */
+      file_list = g_list_reverse (file_list);
+      job = thunar_io_jobs_fix_folder_permissions (file_list);
+      g_list_free (file_list);
+      exo_job_launch (EXO_JOB (job));
 
-          /* handle the job */
-          thunar_permissions_chooser_job_start (chooser, job, FALSE);
-          g_object_unref (job);
-        }
+      /* handle the job */
+      thunar_permissions_chooser_job_start (chooser, job, TRUE);
+      g_object_unref (job);
     }
 }
 
@@ -64,6 +64,7 @@ enum
   PROP_LAST_DETAILS_VIEW_FIXED_COLUMNS,
   PROP_LAST_DETAILS_VIEW_VISIBLE_COLUMNS,
   PROP_LAST_DETAILS_VIEW_ZOOM_LEVEL,
+  PROP_LAST_DISK_USAGE_VIEW_ZOOM_LEVEL,
   PROP_LAST_ICON_VIEW_ZOOM_LEVEL,
   PROP_LAST_LOCATION_BAR,
   PROP_LAST_MENUBAR_VISIBLE,
@@ -102,16 +103,19 @@ enum
   PROP_MISC_RECURSIVE_PERMISSIONS,
   PROP_MISC_RECURSIVE_SEARCH,
   PROP_MISC_REMEMBER_GEOMETRY,
+  PROP_MISC_SEARCH_INDEX_ROOTS,
   PROP_MISC_SHOW_ABOUT_TEMPLATES,
   PROP_MISC_SHOW_DELETE_ACTION,
   PROP_MISC_SINGLE_CLICK,
   PROP_MISC_SINGLE_CLICK_TIMEOUT,
+  PROP_MISC_SIZE_ON_DISK_SHARED_EXTENTS,
   PROP_MISC_SMALL_TOOLBAR_ICONS,
   PROP_MISC_TAB_CLOSE_MIDDLE_CLICK,
   PROP_MISC_TEXT_BESIDE_ICONS,
   PROP_MISC_THUMBNAIL_MODE,
   PROP_MISC_THUMBNAIL_DRAW_FRAMES,
   PROP_MISC_THUMBNAIL_MAX_FILE_SIZE,
+  PROP_MISC_THUMBNAIL_REMOTE_BUDGET,
   PROP_MISC_FILE_SIZE_BINARY,
   PROP_MISC_CONFIRM_CLOSE_MULTIPLE_TABS,
   PROP_MISC_STATUS_BAR_ACTIVE_INFO,
@@ -119,6 +123,9 @@ enum
   PROP_MISC_WINDOW_ICON,
   PROP_MISC_TRANSFER_USE_PARTIAL,
   PROP_MISC_TRANSFER_VERIFY_FILE,
+  PROP_MISC_TRANSFER_IO_CLASS,
+  PROP_MISC_TRANSFER_BANDWIDTH_LIMIT,
+  PROP_MISC_TRANSFER_SKIP_IDENTICAL,
   PROP_MISC_IMAGE_PREVIEW_FULL,
   PROP_SHORTCUTS_ICON_EMBLEMS,
   PROP_SHORTCUTS_ICON_SIZE,
@@ -134,12 +141,19 @@ enum
   PROP_MISC_MAX_NUMBER_OF_TEMPLATES,
   PROP_SHOW_LAUNCHER_NAMES_INSTEAD_REAL_FILENAMES,
   PROP_MISC_EXPANDABLE_FOLDERS,
+  PROP_MISC_EXPANDABLE_FOLDERS_PREFETCH,
+  PROP_MISC_DAEMON_PREWARM_BUDGET,
+  PROP_MISC_SUSPEND_BACKGROUND_TABS_TIMEOUT,
   N_PROPERTIES,
 };
 
 
 
 static void     thunar_preferences_finalize           (GObject                *object);
+static void     thunar_preferences_notify             (GObject                *object,
+                                                       GParamSpec             *pspec);
+static void     thunar_preferences_update_values      (ThunarPreferences      *preferences,
+                                                       GParamSpec             *pspec);
 static void     thunar_preferences_get_property       (GObject                *object,
                                                        guint                   prop_id,
                                                        GValue                 *value,
@@ -153,6 +167,11 @@ static void     thunar_preferences_prop_changed       (XfconfChannel          *c
                                                        const GValue           *value,
                                                        ThunarPreferences      *preferences);
 static void     thunar_preferences_load_rc_file       (ThunarPreferences      *preferences);
+static void     thunar_preferences_store              (ThunarPreferences      *preferences,
+                                                       GParamSpec             *pspec,
+                                                       const GValue           *value);
+static gboolean thunar_preferences_flush_timeout      (gpointer                user_data);
+static void     thunar_preferences_value_free         (gpointer                data);
 
 
 
@@ -168,10 +187,23 @@ struct _ThunarPreferences
   XfconfChannel *channel;
 
   gulong         property_changed_id;
+
+  /* plain copies for the hot paths, see thunar_preferences_peek_values() */
+  ThunarPreferencesValues values;
+
+  /* "last-*" values not written to xfconf yet, GParamSpec -> GValue */
+  GHashTable    *pending_writes;
+  guint          flush_source_id;
 };
 
 
 
+/* the "last-*" state changes while dragging and resizing, it is written
+ * to xfconf once it did not change for this many milliseconds */
+#define THUNAR_PREFERENCES_WRITE_DELAY (1000)
+
+
+
 /* don't do anything in case xfconf_init() failed */
 static gboolean no_xfconf = FALSE;
 
@@ -194,6 +226,7 @@ thunar_preferences_class_init (ThunarPreferencesClass *klass)
   gobject_class->finalize = thunar_preferences_finalize;
   gobject_class->get_property = thunar_preferences_get_property;
   gobject_class->set_property = thunar_preferences_set_property;
+  gobject_class->notify = thunar_preferences_notify;
 
   /**
    * ThunarPreferences:default-view:
@@ -376,6 +409,19 @@ thunar_preferences_class_init (ThunarPreferencesClass *klass)
                          THUNAR_ZOOM_LEVEL_38_PERCENT,
                          EXO_PARAM_READWRITE);
 
+  /**
+   * ThunarPreferences:last-disk-usage-view-zoom-level:
+   *
+   * The last selected #ThunarZoomLevel for the #ThunarDiskUsageView.
+   **/
+  preferences_props[PROP_LAST_DISK_USAGE_VIEW_ZOOM_LEVEL] =
+      g_param_spec_enum ("last-disk-usage-view-zoom-level",
+                         "LastDiskUsageViewZoomLevel",
+                         NULL,
+                         THUNAR_TYPE_ZOOM_LEVEL,
+                         THUNAR_ZOOM_LEVEL_38_PERCENT,
+                         EXO_PARAM_READWRITE);
+
   /**
    * ThunarPreferences:last-icon-view-zoom-level:
    *
@@ -869,6 +915,21 @@ thunar_preferences_class_init (ThunarPreferencesClass *klass)
                             TRUE,
                             EXO_PARAM_READWRITE);
 
+  /**
+   * ThunarPreferences:misc-search-index-roots:
+   *
+   * Semicolon separated list of absolute paths of local folders to
+   * keep a filename index for. Recursive searches within these folders
+   * are answered from the index instead of crawling the file system.
+   * Empty by default, which disables the index.
+   **/
+  preferences_props[PROP_MISC_SEARCH_INDEX_ROOTS] =
+      g_param_spec_string ("misc-search-index-roots",
+                           "MiscSearchIndexRoots",
+                           NULL,
+                           "",
+                           EXO_PARAM_READWRITE);
+
   /**
    * ThunarPreferences:misc-show-about-templates:
    *
@@ -922,6 +983,20 @@ thunar_preferences_class_init (ThunarPreferencesClass *klass)
                          0u, G_MAXUINT, 500u,
                          EXO_PARAM_READWRITE);
 
+  /**
+   * ThunarPreferences:misc-size-on-disk-shared-extents:
+   *
+   * Whether the size on disk of folders counts data blocks shared between
+   * files, e.g. reflinked copies on btrfs or xfs, only once. This asks the
+   * filesystem for the extents of every file, which is slower.
+   **/
+  preferences_props[PROP_MISC_SIZE_ON_DISK_SHARED_EXTENTS] =
+      g_param_spec_boolean ("misc-size-on-disk-shared-extents",
+                            "MiscSizeOnDiskSharedExtents",
+                            NULL,
+                            FALSE,
+                            EXO_PARAM_READWRITE);
+
   /**
    * ThunarPreferences:misc-small-toolbar-icons:
    *
@@ -1000,6 +1075,20 @@ thunar_preferences_class_init (ThunarPreferencesClass *klass)
                            0, G_MAXUINT64, 0,
                            EXO_PARAM_READWRITE);
 
+  /**
+   * ThunarPreferences:misc-thumbnail-remote-budget:
+   *
+   * The most data in MiB per minute the thumbnailer fetches from
+   * one remote location, less if the location is slow. 0 means
+   * no limit is in place.
+   **/
+  preferences_props[PROP_MISC_THUMBNAIL_REMOTE_BUDGET] =
+    g_param_spec_uint ("misc-thumbnail-remote-budget",
+                       "MiscThumbnailRemoteBudget",
+                       NULL,
+                       0u, G_MAXUINT, 64u,
+                       EXO_PARAM_READWRITE);
+
   /**
    * ThunarPreferences:misc-file-size-binary:
    *
@@ -1063,6 +1152,47 @@ thunar_preferences_class_init (ThunarPreferencesClass *klass)
                        THUNAR_VERIFY_FILE_MODE_DISABLED,
                        EXO_PARAM_READWRITE);
 
+  /**
+   * ThunarPreferences:misc-transfer-io-class:
+   *
+   * The IO priority new copies and moves start with, which can
+   * be changed for each of them in the progress dialog.
+   **/
+  preferences_props[PROP_MISC_TRANSFER_IO_CLASS] =
+    g_param_spec_enum ("misc-transfer-io-class",
+                       "MiscTransferIoClass",
+                       NULL,
+                       THUNAR_TYPE_TRANSFER_IO_CLASS,
+                       THUNAR_TRANSFER_IO_CLASS_NORMAL,
+                       EXO_PARAM_READWRITE);
+
+  /**
+   * ThunarPreferences:misc-transfer-bandwidth-limit:
+   *
+   * The maximum rate of a copy or move in KiB per second,
+   * 0 for no limit.
+   **/
+  preferences_props[PROP_MISC_TRANSFER_BANDWIDTH_LIMIT] =
+    g_param_spec_uint ("misc-transfer-bandwidth-limit",
+                       "MiscTransferBandwidthLimit",
+                       NULL,
+                       0u, G_MAXUINT, 0u,
+                       EXO_PARAM_READWRITE);
+
+  /**
+   * ThunarPreferences:misc-transfer-skip-identical:
+   *
+   * Whether copies skip the existing files which are identical to
+   * their source, instead of asking to replace them.
+   **/
+  preferences_props[PROP_MISC_TRANSFER_SKIP_IDENTICAL] =
+    g_param_spec_enum ("misc-transfer-skip-identical",
+                       "MiscTransferSkipIdentical",
+                       NULL,
+                       THUNAR_TYPE_SKIP_IDENTICAL_MODE,
+                       THUNAR_SKIP_IDENTICAL_MODE_DISABLED,
+                       EXO_PARAM_READWRITE);
+
   /**
    * ThunarPreferences:misc-image-preview-mode:
    *
@@ -1275,6 +1405,50 @@ thunar_preferences_class_init (ThunarPreferencesClass *klass)
                             FALSE,
                             EXO_PARAM_READWRITE);
 
+  /**
+   * ThunarPreferences:misc-expandable-folders-prefetch:
+   *
+   * If true, the details view with expandable folders starts loading a
+   * local folder while the pointer rests on it, so that expanding it
+   * shows its contents right away.
+   **/
+  preferences_props[PROP_MISC_EXPANDABLE_FOLDERS_PREFETCH] =
+      g_param_spec_boolean ("misc-expandable-folders-prefetch",
+                            "MiscExpandableFoldersPrefetch",
+                            NULL,
+                            TRUE,
+                            EXO_PARAM_READWRITE);
+
+  /**
+   * ThunarPreferences:misc-daemon-prewarm-budget:
+   *
+   * The memory in MiB that Thunar may spend in daemon mode on keeping the
+   * home folder and the folders of the last session loaded, so that the
+   * first window opens right away. 0 disables prewarming.
+   **/
+  preferences_props[PROP_MISC_DAEMON_PREWARM_BUDGET] =
+      g_param_spec_uint ("misc-daemon-prewarm-budget",
+                         "MiscDaemonPrewarmBudget",
+                         NULL,
+                         0, G_MAXUINT,
+                         32,
+                         EXO_PARAM_READWRITE);
+
+  /**
+   * ThunarPreferences:misc-suspend-background-tabs-timeout:
+   *
+   * The number of seconds after which a tab that is not shown releases
+   * its folder, keeping only its location, selection and scroll position.
+   * 0 keeps background tabs loaded.
+   **/
+  preferences_props[PROP_MISC_SUSPEND_BACKGROUND_TABS_TIMEOUT] =
+      g_param_spec_uint ("misc-suspend-background-tabs-timeout",
+                         "MiscSuspendBackgroundTabsTimeout",
+                         NULL,
+                         0, G_MAXUINT,
+                         600,
+                         EXO_PARAM_READWRITE);
+
   /**
    * ThunarPreferences:show-launcher-names-instead-real-filenames:
    *
@@ -1298,9 +1472,14 @@ thunar_preferences_init (ThunarPreferences *preferences)
 {
   const gchar check_prop[] = "/last-view";
 
+  preferences->pending_writes = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, thunar_preferences_value_free);
+
   /* don't set a channel if xfconf init failed */
   if (no_xfconf)
-    return;
+    {
+      thunar_preferences_update_values (preferences, NULL);
+      return;
+    }
 
   /* load the channel */
   preferences->channel = xfconf_channel_get ("thunar");
@@ -1319,6 +1498,8 @@ thunar_preferences_init (ThunarPreferences *preferences)
   preferences->property_changed_id =
     g_signal_connect (G_OBJECT (preferences->channel), "property-changed",
                       G_CALLBACK (thunar_preferences_prop_changed), preferences);
+
+  thunar_preferences_update_values (preferences, NULL);
 }
 
 
@@ -1328,14 +1509,51 @@ thunar_preferences_finalize (GObject *object)
 {
   ThunarPreferences *preferences = THUNAR_PREFERENCES (object);
 
+  /* write what is still pending */
+  thunar_preferences_flush (preferences);
+  g_hash_table_destroy (preferences->pending_writes);
+
   /* disconnect from the updates */
-  g_signal_handler_disconnect (preferences->channel, preferences->property_changed_id);
+  if (preferences->channel != NULL)
+    g_signal_handler_disconnect (preferences->channel, preferences->property_changed_id);
 
   (*G_OBJECT_CLASS (thunar_preferences_parent_class)->finalize) (object);
 }
 
 
 
+static void
+thunar_preferences_notify (GObject    *object,
+                           GParamSpec *pspec)
+{
+  /* both our own writes and the ones of other processes end up here */
+  thunar_preferences_update_values (THUNAR_PREFERENCES (object), pspec);
+
+  if (G_OBJECT_CLASS (thunar_preferences_parent_class)->notify != NULL)
+    (*G_OBJECT_CLASS (thunar_preferences_parent_class)->notify) (object, pspec);
+}
+
+
+
+static void
+thunar_preferences_update_values (ThunarPreferences *preferences,
+                                  GParamSpec        *pspec)
+{
+  ThunarPreferencesValues *values = &preferences->values;
+
+  /* refresh the copy of @pspec, or all of them if it is NULL */
+  if (pspec == NULL || pspec == preferences_props[PROP_MISC_STATUS_BAR_ACTIVE_INFO])
+    g_object_get (G_OBJECT (preferences), "misc-status-bar-active-info", &values->misc_status_bar_active_info, NULL);
+  if (pspec == NULL || pspec == preferences_props[PROP_MISC_IMAGE_SIZE_IN_STATUSBAR])
+    g_object_get (G_OBJECT (preferences), "misc-image-size-in-statusbar", &values->misc_image_size_in_statusbar, NULL);
+  if (pspec == NULL || pspec == preferences_props[PROP_MISC_HORIZONTAL_WHEEL_NAVIGATES])
+    g_object_get (G_OBJECT (preferences), "misc-horizontal-wheel-navigates", &values->misc_horizontal_wheel_navigates, NULL);
+  if (pspec == NULL || pspec == preferences_props[PROP_SHOW_LAUNCHER_NAMES_INSTEAD_REAL_FILENAMES])
+    g_object_get (G_OBJECT (preferences), "show-launcher-names-instead-real-filenames", &values->show_launcher_names_instead_real_filenames, NULL);
+}
+
+
+
 static void
 thunar_preferences_get_property (GObject    *object,
                                  guint       prop_id,
@@ -1346,6 +1564,7 @@ thunar_preferences_get_property (GObject    *object,
   GValue              src = { 0, };
   gchar               prop_name[64];
   gchar             **array;
+  const GValue       *pending;
 
   /* only set defaults if channel is not set */
   if (G_UNLIKELY (preferences->channel == NULL))
@@ -1354,6 +1573,14 @@ thunar_preferences_get_property (GObject    *object,
       return;
     }
 
+  /* a value that is not written yet is the current one */
+  pending = g_hash_table_lookup (preferences->pending_writes, pspec);
+  if (pending != NULL)
+    {
+      g_value_copy (pending, value);
+      return;
+    }
+
   /* build property name */
   g_snprintf (prop_name, sizeof (prop_name), "/%s", g_param_spec_get_name (pspec));
 
@@ -1386,15 +1613,67 @@ thunar_preferences_set_property (GObject      *object,
                                  const GValue *value,
                                  GParamSpec   *pspec)
 {
-  ThunarPreferences  *preferences = THUNAR_PREFERENCES (object);
-  GValue              dst = { 0, };
-  gchar               prop_name[64];
-  gchar             **array;
+  ThunarPreferences *preferences = THUNAR_PREFERENCES (object);
+  GValue            *pending;
 
   /* leave if the channel is not set */
   if (G_UNLIKELY (preferences->channel == NULL))
     return;
 
+  /* the session state is written once it settled, the settings right away */
+  if (g_str_has_prefix (g_param_spec_get_name (pspec), "last-"))
+    {
+      pending = g_new0 (GValue, 1);
+      g_value_init (pending, G_VALUE_TYPE (value));
+      g_value_copy (value, pending);
+      g_hash_table_replace (preferences->pending_writes, pspec, pending);
+
+      /* restart the window on every change */
+      if (preferences->flush_source_id != 0)
+        g_source_remove (preferences->flush_source_id);
+      preferences->flush_source_id = g_timeout_add (THUNAR_PREFERENCES_WRITE_DELAY, thunar_preferences_flush_timeout, preferences);
+    }
+  else
+    {
+      thunar_preferences_store (preferences, pspec, value);
+    }
+}
+
+
+
+static void
+thunar_preferences_value_free (gpointer data)
+{
+  GValue *value = data;
+
+  g_value_unset (value);
+  g_free (value);
+}
+
+
+
+static gboolean
+thunar_preferences_flush_timeout (gpointer user_data)
+{
+  ThunarPreferences *preferences = THUNAR_PREFERENCES (user_data);
+
+  preferences->flush_source_id = 0;
+  thunar_preferences_flush (preferences);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+static void
+thunar_preferences_store (ThunarPreferences *preferences,
+                          GParamSpec        *pspec,
+                          const GValue      *value)
+{
+  GValue   dst = { 0, };
+  gchar    prop_name[64];
+  gchar  **array;
+
   /* build property name */
   g_snprintf (prop_name, sizeof (prop_name), "/%s", g_param_spec_get_name (pspec));
 
@@ -1438,10 +1717,14 @@ thunar_preferences_prop_changed (XfconfChannel     *channel,
 {
   GParamSpec *pspec;
 
-  /* check if the property exists and emit change */
+  /* check if the property exists and emit change, a value
+   * held back here is older than the one written elsewhere */
   pspec = g_object_class_find_property (G_OBJECT_GET_CLASS (preferences), prop_name + 1);
   if (G_LIKELY (pspec != NULL))
-    g_object_notify_by_pspec (G_OBJECT (preferences), pspec);
+    {
+      g_hash_table_remove (preferences->pending_writes, pspec);
+      g_object_notify_by_pspec (G_OBJECT (preferences), pspec);
+    }
 }
 
 
@@ -1568,6 +1851,58 @@ thunar_preferences_get (void)
 
 
 
+/**
+ * thunar_preferences_peek_values:
+ * @preferences : a #ThunarPreferences.
+ *
+ * Returns plain copies of the preferences which are read often, like on
+ * every statusbar update. They are refreshed whenever @preferences
+ * notifies a change, so reading them skips the property lookup and the
+ * #GValue of g_object_get(). The fields are single words written from
+ * the main thread, other threads may read them without locking.
+ *
+ * Return value: the values, owned by @preferences.
+ **/
+const ThunarPreferencesValues *
+thunar_preferences_peek_values (ThunarPreferences *preferences)
+{
+  _thunar_return_val_if_fail (THUNAR_IS_PREFERENCES (preferences), NULL);
+  return &preferences->values;
+}
+
+
+
+/**
+ * thunar_preferences_flush:
+ * @preferences : a #ThunarPreferences.
+ *
+ * Writes the "last-*" values which were set on @preferences but are
+ * still held back, so they are not lost when Thunar quits.
+ **/
+void
+thunar_preferences_flush (ThunarPreferences *preferences)
+{
+  GHashTableIter iter;
+  gpointer       key, value;
+
+  _thunar_return_if_fail (THUNAR_IS_PREFERENCES (preferences));
+
+  if (preferences->flush_source_id != 0)
+    {
+      g_source_remove (preferences->flush_source_id);
+      preferences->flush_source_id = 0;
+    }
+
+  g_hash_table_iter_init (&iter, preferences->pending_writes);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    {
+      thunar_preferences_store (preferences, key, value);
+      g_hash_table_iter_remove (&iter);
+    }
+}
+
+
+
 void
 thunar_preferences_xfconf_init_failed (void)
 {
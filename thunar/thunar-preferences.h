@@ -27,6 +27,20 @@ G_BEGIN_DECLS;
 typedef struct _ThunarPreferencesClass ThunarPreferencesClass;
 typedef struct _ThunarPreferences      ThunarPreferences;
 
+/**
+ * ThunarPreferencesValues:
+ *
+ * Copies of the preferences read in hot paths, kept up to date by
+ * the #ThunarPreferences. See thunar_preferences_peek_values().
+ **/
+typedef struct
+{
+  guint    misc_status_bar_active_info;
+  gboolean misc_image_size_in_statusbar;
+  gboolean misc_horizontal_wheel_navigates;
+  gboolean show_launcher_names_instead_real_filenames;
+} ThunarPreferencesValues;
+
 #define THUNAR_TYPE_PREFERENCES             (thunar_preferences_get_type ())
 #define THUNAR_PREFERENCES(obj)             (G_TYPE_CHECK_INSTANCE_CAST ((obj), THUNAR_TYPE_PREFERENCES, ThunarPreferences))
 #define THUNAR_PREFERENCES_CLASS(klass)     (G_TYPE_CHECK_CLASS_CAST ((klass), THUNAR_TYPE_PREFERENCES, ThunarPreferencesClass))
@@ -38,6 +52,11 @@ GType              thunar_preferences_get_type           (void) G_GNUC_CONST;
 
 ThunarPreferences *thunar_preferences_get                (void);
 
+const ThunarPreferencesValues *
+                   thunar_preferences_peek_values        (ThunarPreferences *preferences);
+
+void               thunar_preferences_flush              (ThunarPreferences *preferences);
+
 void               thunar_preferences_xfconf_init_failed (void);
 
 G_END_DECLS;
@@ -0,0 +1,1167 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Startup profiling. With --profile-startup or THUNAR_PROFILE_STARTUP set in
+ * the environment, the phases of the startup are timed with the monotonic
+ * clock until the first folder is loaded, then a breakdown is printed to
+ * stderr. The phases are also sent to sysprof when built with it, and if
+ * THUNAR_PROFILE_STARTUP names a file, they are written to it in the trace
+ * event format, which Perfetto and chrome://tracing load.
+ *
+ * Navigations are traced with THUNAR_PROFILE_NAVIGATION set in the
+ * environment. Every change of the directory of a view gets an id, and the
+ * stages of loading that directory are summed up until the view first paints
+ * it. Each navigation is then reported as one line of JSON, on stderr or
+ * appended to the file named by THUNAR_PROFILE_NAVIGATION, and the stages
+ * are sent to sysprof with the id in their message.
+ *
+ * The events of the folder monitors are recorded to the file named by
+ * THUNAR_PROFILE_MONITOR, with their timing. A trace named by
+ * THUNAR_PROFILE_MONITOR_REPLAY is replayed into the folders once they
+ * are loaded, to measure how the views cope with bursts of events seen
+ * in the field, like those of a build or a checkout.
+ *
+ * With THUNAR_PROFILE_WATCHDOG set, a thread watches the main loop and
+ * records the stack and the source name of the dispatches which stall it,
+ * for G_MESSAGES_DEBUG and the GetStalls method of the debug interface. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_EXECINFO_H
+#include <execinfo.h>
+#endif
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+#ifdef HAVE_SIGNAL_H
+#include <signal.h>
+#endif
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_SYSPROF
+#include <sysprof-capture.h>
+#endif
+
+#include <glib/gstdio.h>
+
+#include "thunar/thunar-profile.h"
+
+
+
+/* the main loop watchdog, see thunar_profile_watchdog_start() */
+#define THUNAR_PROFILE_WATCHDOG_THRESHOLD (250) /* ms, unless THUNAR_PROFILE_WATCHDOG names one */
+#define THUNAR_PROFILE_WATCHDOG_RING_SIZE (32)
+#define THUNAR_PROFILE_WATCHDOG_FRAMES    (48)
+#define THUNAR_PROFILE_WATCHDOG_SOURCE    (64)
+
+#if defined(HAVE_EXECINFO_H) && defined(HAVE_BACKTRACE) && defined(HAVE_PTHREAD_H) && defined(HAVE_SIGNAL_H)
+#define THUNAR_PROFILE_WATCHDOG_SAMPLER 1
+#endif
+
+
+
+typedef struct
+{
+  const gchar *phase;
+  gint64       begin_time;
+  gint64       end_time;
+} ThunarProfileMark;
+
+
+
+static gboolean  profile_enabled = FALSE;
+static gint64    profile_origin = 0;
+static gchar    *profile_trace_path = NULL;
+static GArray   *profile_marks = NULL;
+
+typedef struct
+{
+  guint   id;
+  gint64  begin_time;
+  GArray *stages;
+} ThunarProfileNavigation;
+
+typedef struct
+{
+  const gchar *stage;
+  gint64       duration;
+  guint        count;
+} ThunarProfileStage;
+
+static gint        navigation_enabled = -1;
+static gchar      *navigation_trace_path = NULL;
+static GHashTable *navigations = NULL;
+static guint       navigation_last_id = 0;
+
+
+
+/**
+ * thunar_profile_init:
+ * @argc : the number of arguments in @argv.
+ * @argv : the command line arguments of the process.
+ *
+ * Enables the startup profiling if @argv contains --profile-startup
+ * or THUNAR_PROFILE_STARTUP is set. This has to be called first in
+ * main(), so the phases are timed relative to the process start.
+ **/
+void
+thunar_profile_init (gint    argc,
+                     gchar **argv)
+{
+  const gchar *value;
+  gint         n;
+
+  value = g_getenv ("THUNAR_PROFILE_STARTUP");
+  if (value != NULL)
+    {
+      profile_enabled = TRUE;
+
+      /* any value but a plain "1" is the file to write the trace to */
+      if (*value != '\0' && strcmp (value, "1") != 0)
+        profile_trace_path = g_strdup (value);
+    }
+
+  for (n = 1; n < argc && !profile_enabled; ++n)
+    if (strcmp (argv[n], "--profile-startup") == 0)
+      profile_enabled = TRUE;
+
+  /* any value but a number is the default threshold */
+  value = g_getenv ("THUNAR_PROFILE_WATCHDOG");
+  if (value != NULL)
+    {
+      n = atoi (value);
+      thunar_profile_watchdog_start ((n > 1) ? (guint) n : THUNAR_PROFILE_WATCHDOG_THRESHOLD);
+    }
+
+  if (profile_enabled)
+    {
+      profile_origin = g_get_monotonic_time ();
+      profile_marks = g_array_new (FALSE, FALSE, sizeof (ThunarProfileMark));
+    }
+}
+
+
+
+/**
+ * thunar_profile_enabled:
+ *
+ * Return value: %TRUE if the startup is profiled and not reported yet.
+ **/
+gboolean
+thunar_profile_enabled (void)
+{
+  return profile_enabled;
+}
+
+
+
+/**
+ * thunar_profile_begin:
+ *
+ * Returns the start time for thunar_profile_end(), or 0 if the startup
+ * is not profiled.
+ *
+ * Return value: the monotonic time or 0.
+ **/
+gint64
+thunar_profile_begin (void)
+{
+  return profile_enabled ? g_get_monotonic_time () : 0;
+}
+
+
+
+/**
+ * thunar_profile_end:
+ * @begin_time : the time returned by thunar_profile_begin().
+ * @phase      : the static name of the phase.
+ *
+ * Records the startup @phase which took from @begin_time until now.
+ **/
+void
+thunar_profile_end (gint64       begin_time,
+                    const gchar *phase)
+{
+  ThunarProfileMark mark;
+
+  if (!profile_enabled || begin_time == 0)
+    return;
+
+  mark.phase = phase;
+  mark.begin_time = begin_time;
+  mark.end_time = g_get_monotonic_time ();
+  g_array_append_val (profile_marks, mark);
+
+#ifdef HAVE_SYSPROF
+  /* both use the monotonic clock, sysprof in nanoseconds */
+  sysprof_collector_mark (mark.begin_time * 1000, (mark.end_time - mark.begin_time) * 1000,
+                          "thunar", phase, NULL);
+#endif
+}
+
+
+
+static void
+thunar_profile_write_trace (void)
+{
+  ThunarProfileMark *mark;
+  GString           *trace;
+  GError            *error = NULL;
+  guint              n;
+
+  trace = g_string_new ("{\"traceEvents\":[");
+  for (n = 0; n < profile_marks->len; ++n)
+    {
+      mark = &g_array_index (profile_marks, ThunarProfileMark, n);
+      g_string_append_printf (trace,
+                              "%s{\"name\":\"%s\",\"cat\":\"startup\",\"ph\":\"X\","
+                              "\"ts\":%" G_GINT64_FORMAT ",\"dur\":%" G_GINT64_FORMAT ",\"pid\":%d,\"tid\":%d}",
+                              (n > 0) ? "," : "", mark->phase,
+                              mark->begin_time - profile_origin, mark->end_time - mark->begin_time,
+                              (gint) getpid (), (gint) getpid ());
+    }
+  g_string_append (trace, "]}\n");
+
+  if (!g_file_set_contents (profile_trace_path, trace->str, trace->len, &error))
+    {
+      g_warning ("Failed to write the startup trace to \"%s\": %s", profile_trace_path, error->message);
+      g_error_free (error);
+    }
+
+  g_string_free (trace, TRUE);
+}
+
+
+
+/**
+ * thunar_profile_report:
+ *
+ * Prints the recorded phases to stderr, writes the trace file if one was
+ * requested, and stops profiling. Does nothing if the startup is not
+ * profiled or was reported already.
+ **/
+void
+thunar_profile_report (void)
+{
+  ThunarProfileMark *mark;
+  guint              n;
+
+  if (!profile_enabled)
+    return;
+
+  g_printerr ("Thunar startup profile (ms since start, duration in ms):\n");
+  for (n = 0; n < profile_marks->len; ++n)
+    {
+      mark = &g_array_index (profile_marks, ThunarProfileMark, n);
+      g_printerr ("  %8.1f  %8.1f  %s\n",
+                  (mark->begin_time - profile_origin) / 1000.0,
+                  (mark->end_time - mark->begin_time) / 1000.0,
+                  mark->phase);
+    }
+  g_printerr ("  %8.1f            total\n", (g_get_monotonic_time () - profile_origin) / 1000.0);
+
+  if (profile_trace_path != NULL)
+    thunar_profile_write_trace ();
+
+  /* only the startup is profiled */
+  profile_enabled = FALSE;
+  g_array_free (profile_marks, TRUE);
+  profile_marks = NULL;
+  g_free (profile_trace_path);
+  profile_trace_path = NULL;
+}
+
+
+
+static void
+thunar_profile_navigation_free (gpointer data)
+{
+  ThunarProfileNavigation *navigation = data;
+
+  g_array_free (navigation->stages, TRUE);
+  g_slice_free (ThunarProfileNavigation, navigation);
+}
+
+
+
+static gboolean
+thunar_profile_navigation_enabled (void)
+{
+  const gchar *value;
+
+  if (G_LIKELY (navigation_enabled >= 0))
+    return navigation_enabled;
+
+  value = g_getenv ("THUNAR_PROFILE_NAVIGATION");
+  navigation_enabled = (value != NULL);
+  if (navigation_enabled)
+    {
+      /* any value but a plain "1" is the file to append the reports to */
+      if (*value != '\0' && strcmp (value, "1") != 0)
+        navigation_trace_path = g_strdup (value);
+
+      navigations = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal, g_object_unref, thunar_profile_navigation_free);
+    }
+
+  return navigation_enabled;
+}
+
+
+
+/**
+ * thunar_profile_navigation_begin:
+ * @directory : the directory a view changes to.
+ *
+ * Starts tracing the navigation to @directory, replacing a navigation
+ * to it which did not finish. Does nothing unless navigations are traced.
+ *
+ * Return value: the id of the navigation or 0.
+ **/
+guint
+thunar_profile_navigation_begin (GFile *directory)
+{
+  ThunarProfileNavigation *navigation;
+
+  if (G_LIKELY (!thunar_profile_navigation_enabled ()))
+    return 0;
+
+  navigation = g_slice_new (ThunarProfileNavigation);
+  navigation->id = ++navigation_last_id;
+  navigation->begin_time = g_get_monotonic_time ();
+  navigation->stages = g_array_new (FALSE, FALSE, sizeof (ThunarProfileStage));
+  g_hash_table_replace (navigations, g_object_ref (directory), navigation);
+
+  return navigation->id;
+}
+
+
+
+/**
+ * thunar_profile_navigation_now:
+ * @directory : a directory.
+ *
+ * Returns the start time for thunar_profile_navigation_mark(), or 0 if
+ * no navigation to @directory is traced.
+ *
+ * Return value: the monotonic time or 0.
+ **/
+gint64
+thunar_profile_navigation_now (GFile *directory)
+{
+  if (G_LIKELY (navigations == NULL)
+      || g_hash_table_size (navigations) == 0
+      || !g_hash_table_contains (navigations, directory))
+    return 0;
+
+  return g_get_monotonic_time ();
+}
+
+
+
+/**
+ * thunar_profile_navigation_mark:
+ * @directory  : the directory of the navigation.
+ * @begin_time : the time returned by thunar_profile_navigation_now().
+ * @stage      : the static name of the stage.
+ *
+ * Adds the time from @begin_time until now to the @stage of the
+ * navigation to @directory.
+ **/
+void
+thunar_profile_navigation_mark (GFile       *directory,
+                                gint64       begin_time,
+                                const gchar *stage)
+{
+  ThunarProfileNavigation *navigation;
+  ThunarProfileStage      *entry;
+  ThunarProfileStage       new_entry;
+  gint64                   end_time;
+  guint                    n;
+
+  if (begin_time == 0 || navigations == NULL)
+    return;
+
+  navigation = g_hash_table_lookup (navigations, directory);
+  if (navigation == NULL)
+    return;
+
+  end_time = g_get_monotonic_time ();
+
+  for (n = 0; n < navigation->stages->len; ++n)
+    {
+      entry = &g_array_index (navigation->stages, ThunarProfileStage, n);
+      if (strcmp (entry->stage, stage) == 0)
+        break;
+    }
+
+  if (n == navigation->stages->len)
+    {
+      new_entry.stage = stage;
+      new_entry.duration = 0;
+      new_entry.count = 0;
+      g_array_append_val (navigation->stages, new_entry);
+      entry = &g_array_index (navigation->stages, ThunarProfileStage, n);
+    }
+
+  entry->duration += end_time - begin_time;
+  entry->count++;
+
+#ifdef HAVE_SYSPROF
+  sysprof_collector_mark_printf (begin_time * 1000, (end_time - begin_time) * 1000,
+                                 "thunar-navigation", stage, "navigation %u", navigation->id);
+#endif
+}
+
+
+
+/**
+ * thunar_profile_navigation_end:
+ * @directory : the directory of the navigation.
+ *
+ * Finishes the navigation to @directory, usually when the view painted
+ * it for the first time, and reports its stages.
+ **/
+void
+thunar_profile_navigation_end (GFile *directory)
+{
+  ThunarProfileNavigation *navigation;
+  ThunarProfileStage      *entry;
+  GString                 *report;
+  gchar                   *uri;
+  FILE                    *fp;
+  guint                    n;
+
+  if (navigations == NULL)
+    return;
+
+  navigation = g_hash_table_lookup (navigations, directory);
+  if (navigation == NULL)
+    return;
+
+  uri = g_file_get_uri (directory);
+  report = g_string_new (NULL);
+  g_string_append_printf (report, "{\"navigation\":%u,\"directory\":\"", navigation->id);
+  for (n = 0; uri[n] != '\0'; ++n)
+    {
+      /* uris are escaped already, only quotes and backslashes are left */
+      if (uri[n] == '"' || uri[n] == '\\')
+        g_string_append_c (report, '\\');
+      g_string_append_c (report, uri[n]);
+    }
+  g_string_append_printf (report, "\",\"total_ms\":%.1f,\"stages\":{",
+                          (g_get_monotonic_time () - navigation->begin_time) / 1000.0);
+  for (n = 0; n < navigation->stages->len; ++n)
+    {
+      entry = &g_array_index (navigation->stages, ThunarProfileStage, n);
+      g_string_append_printf (report, "%s\"%s\":{\"ms\":%.1f,\"count\":%u}",
+                              (n > 0) ? "," : "", entry->stage, entry->duration / 1000.0, entry->count);
+    }
+  g_string_append (report, "}}\n");
+
+  fp = NULL;
+  if (navigation_trace_path != NULL)
+    {
+      fp = g_fopen (navigation_trace_path, "a");
+      if (G_UNLIKELY (fp == NULL))
+        g_warning ("Failed to open \"%s\" for the navigation trace", navigation_trace_path);
+    }
+
+  if (fp != NULL)
+    {
+      fputs (report->str, fp);
+      fclose (fp);
+    }
+  else
+    {
+      g_printerr ("%s", report->str);
+    }
+
+  g_string_free (report, TRUE);
+  g_free (uri);
+
+  g_hash_table_remove (navigations, directory);
+}
+
+
+
+/* the interval of the main loop stall probe, in milliseconds */
+#define THUNAR_PROFILE_STALL_INTERVAL (100)
+
+/* the upper bounds of the buckets of the stall histogram, in milliseconds,
+ * a last bucket takes the stalls beyond the last bound */
+static const guint stall_limits[] = { 16, 50, 100, 250, 1000 };
+static guint64     stall_counts[G_N_ELEMENTS (stall_limits) + 1];
+static gint64      stall_expected_time = 0;
+static guint       stall_probe_id = 0;
+
+
+
+static gboolean
+thunar_profile_stall_probe (gpointer user_data)
+{
+  gint64 now = g_get_monotonic_time ();
+  gint64 lateness;
+  guint  n;
+
+  /* how much later than asked for the main loop got to dispatch the probe */
+  lateness = MAX (now - stall_expected_time, 0) / 1000;
+  for (n = 0; n < G_N_ELEMENTS (stall_limits) && lateness >= stall_limits[n]; ++n)
+    ;
+  stall_counts[n]++;
+
+  stall_expected_time = now + THUNAR_PROFILE_STALL_INTERVAL * 1000;
+
+  return G_SOURCE_CONTINUE;
+}
+
+
+
+/**
+ * thunar_profile_stalls_start:
+ *
+ * Starts probing the main loop for stalls, see thunar_profile_get_stalls().
+ * The probe is a high priority timeout, which runs ten times a second.
+ **/
+void
+thunar_profile_stalls_start (void)
+{
+  if (stall_probe_id != 0)
+    return;
+
+  stall_expected_time = g_get_monotonic_time () + THUNAR_PROFILE_STALL_INTERVAL * 1000;
+  stall_probe_id = g_timeout_add_full (G_PRIORITY_HIGH, THUNAR_PROFILE_STALL_INTERVAL,
+                                       thunar_profile_stall_probe, NULL, NULL);
+}
+
+
+
+/**
+ * thunar_profile_get_stalls:
+ * @limits : return location for the upper bounds of the buckets, in
+ *           milliseconds.
+ * @counts : return location for the number of probes per bucket, which
+ *           has one bucket more than @limits for the longer stalls.
+ *
+ * Returns the histogram of how late the main loop dispatched the probe
+ * started by thunar_profile_stalls_start(). Only to be used from the
+ * main thread.
+ *
+ * Return value: the number of bounds in @limits.
+ **/
+guint
+thunar_profile_get_stalls (const guint   **limits,
+                           const guint64 **counts)
+{
+  *limits = stall_limits;
+  *counts = stall_counts;
+
+  return G_N_ELEMENTS (stall_limits);
+}
+
+
+
+/* a recorded event of the folder monitors */
+typedef struct
+{
+  gint64            time;       /* us since the first recorded event */
+  GFileMonitorEvent event_type;
+  gchar            *directory;  /* uri */
+  GFile            *file;
+  GFile            *other_file;
+} ThunarProfileMonitorEvent;
+
+/* a replay of the events of one directory */
+typedef struct
+{
+  GPtrArray               *events;
+  guint                    next;
+  gint64                   origin;
+  ThunarProfileMonitorFunc func;
+  gpointer                 user_data;
+  GDestroyNotify           destroy;
+  gint64                   handle_time;
+  gint64                   handle_max;
+  guint                    n_dispatches;
+  guint64                  stalls[G_N_ELEMENTS (stall_limits) + 1];
+} ThunarProfileMonitorReplay;
+
+static gint    monitor_record_enabled = -1;
+static FILE   *monitor_record_fp = NULL;
+static gint64  monitor_record_origin = 0;
+static guint   monitor_record_flush_id = 0;
+static gint    monitor_replay_enabled = -1;
+static GArray *monitor_replay_events = NULL;
+
+
+
+static gboolean
+thunar_profile_monitor_flush (gpointer user_data)
+{
+  monitor_record_flush_id = 0;
+  fflush (monitor_record_fp);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+/**
+ * thunar_profile_monitor_record:
+ * @directory  : the directory of the monitor.
+ * @file       : the file of the event.
+ * @other_file : the other file of the event or %NULL.
+ * @event_type : the type of the event.
+ *
+ * Appends the event to the file named by THUNAR_PROFILE_MONITOR, if set
+ * in the environment. Each event is one line with the time in
+ * microseconds since the first event, the event type, and the uris of
+ * @directory, @file and @other_file, or "-", separated by tabs. Those
+ * traces are replayed with THUNAR_PROFILE_MONITOR_REPLAY, see
+ * thunar_profile_monitor_replay().
+ **/
+void
+thunar_profile_monitor_record (GFile            *directory,
+                               GFile            *file,
+                               GFile            *other_file,
+                               GFileMonitorEvent event_type)
+{
+  const gchar *value;
+  gchar       *directory_uri;
+  gchar       *file_uri;
+  gchar       *other_uri;
+  gint64       now;
+
+  if (G_UNLIKELY (monitor_record_enabled < 0))
+    {
+      value = g_getenv ("THUNAR_PROFILE_MONITOR");
+      monitor_record_enabled = (value != NULL && *value != '\0');
+      if (monitor_record_enabled)
+        {
+          monitor_record_fp = g_fopen (value, "a");
+          if (G_UNLIKELY (monitor_record_fp == NULL))
+            {
+              g_warning ("Failed to open \"%s\" for the monitor trace", value);
+              monitor_record_enabled = FALSE;
+            }
+        }
+    }
+
+  if (G_LIKELY (!monitor_record_enabled))
+    return;
+
+  now = g_get_monotonic_time ();
+  if (monitor_record_origin == 0)
+    monitor_record_origin = now;
+
+  directory_uri = g_file_get_uri (directory);
+  file_uri = g_file_get_uri (file);
+  other_uri = (other_file != NULL) ? g_file_get_uri (other_file) : NULL;
+
+  /* uris are escaped, so they have no tabs or newlines */
+  fprintf (monitor_record_fp, "%" G_GINT64_FORMAT "\t%d\t%s\t%s\t%s\n",
+           now - monitor_record_origin, (gint) event_type,
+           directory_uri, file_uri, (other_uri != NULL) ? other_uri : "-");
+
+  g_free (directory_uri);
+  g_free (file_uri);
+  g_free (other_uri);
+
+  /* the bursts are written out together */
+  if (monitor_record_flush_id == 0)
+    monitor_record_flush_id = g_timeout_add_seconds (1, thunar_profile_monitor_flush, NULL);
+}
+
+
+
+static void
+thunar_profile_monitor_event_clear (gpointer data)
+{
+  ThunarProfileMonitorEvent *event = data;
+
+  g_free (event->directory);
+  g_object_unref (event->file);
+  if (event->other_file != NULL)
+    g_object_unref (event->other_file);
+}
+
+
+
+static void
+thunar_profile_monitor_load (const gchar *path)
+{
+  ThunarProfileMonitorEvent event;
+  GError                   *error = NULL;
+  gchar                    *contents;
+  gchar                   **lines;
+  gchar                   **fields;
+  guint                     n;
+
+  monitor_replay_events = g_array_new (FALSE, FALSE, sizeof (ThunarProfileMonitorEvent));
+  g_array_set_clear_func (monitor_replay_events, thunar_profile_monitor_event_clear);
+
+  if (!g_file_get_contents (path, &contents, NULL, &error))
+    {
+      g_warning ("Failed to read the monitor trace \"%s\": %s", path, error->message);
+      g_error_free (error);
+      return;
+    }
+
+  lines = g_strsplit (contents, "\n", -1);
+  for (n = 0; lines[n] != NULL; ++n)
+    {
+      fields = g_strsplit (lines[n], "\t", 5);
+      if (g_strv_length (fields) == 5)
+        {
+          event.time = g_ascii_strtoll (fields[0], NULL, 10);
+          event.event_type = (GFileMonitorEvent) g_ascii_strtoll (fields[1], NULL, 10);
+          event.directory = g_strdup (fields[2]);
+          event.file = g_file_new_for_uri (fields[3]);
+          event.other_file = (strcmp (fields[4], "-") != 0) ? g_file_new_for_uri (fields[4]) : NULL;
+          g_array_append_val (monitor_replay_events, event);
+        }
+      g_strfreev (fields);
+    }
+
+  g_strfreev (lines);
+  g_free (contents);
+}
+
+
+
+static void
+thunar_profile_monitor_report (ThunarProfileMonitorReplay *replay)
+{
+  const guint64 *counts;
+  const guint   *limits;
+  guint          n_limits;
+  guint          n;
+
+  g_printerr ("Thunar monitor replay: %u events in %u dispatches, %.1f ms (trace %.1f ms)\n",
+              replay->events->len, replay->n_dispatches,
+              (g_get_monotonic_time () - replay->origin) / 1000.0,
+              ((ThunarProfileMonitorEvent *) g_ptr_array_index (replay->events, replay->events->len - 1))->time / 1000.0);
+  g_printerr ("  handling %.1f ms, longest dispatch %.1f ms\n",
+              replay->handle_time / 1000.0, replay->handle_max / 1000.0);
+
+  /* the stalls during the replay */
+  n_limits = thunar_profile_get_stalls (&limits, &counts);
+  g_printerr ("  main loop stalls:");
+  for (n = 0; n <= n_limits; ++n)
+    {
+      if (n < n_limits)
+        g_printerr (" <%ums:%" G_GUINT64_FORMAT, limits[n], counts[n] - replay->stalls[n]);
+      else
+        g_printerr (" more:%" G_GUINT64_FORMAT, counts[n] - replay->stalls[n]);
+    }
+  g_printerr ("\n");
+}
+
+
+
+static gboolean
+thunar_profile_monitor_dispatch (gpointer user_data)
+{
+  ThunarProfileMonitorReplay *replay = user_data;
+  ThunarProfileMonitorEvent  *event;
+  gint64                      begin_time;
+  gint64                      end_time;
+  gint64                      delay;
+
+  /* the events which are due are handled together, like a burst of the monitor */
+  begin_time = g_get_monotonic_time ();
+  for (; replay->next < replay->events->len; replay->next++)
+    {
+      event = g_ptr_array_index (replay->events, replay->next);
+      if (replay->origin + event->time > begin_time)
+        break;
+
+      (*replay->func) (event->file, event->other_file, event->event_type, replay->user_data);
+    }
+  end_time = g_get_monotonic_time ();
+
+  replay->handle_time += end_time - begin_time;
+  replay->handle_max = MAX (replay->handle_max, end_time - begin_time);
+  replay->n_dispatches++;
+
+  if (replay->next < replay->events->len)
+    {
+      event = g_ptr_array_index (replay->events, replay->next);
+      delay = MAX (replay->origin + event->time - end_time, 0) / 1000;
+      g_timeout_add_full (G_PRIORITY_DEFAULT, delay, thunar_profile_monitor_dispatch, replay, NULL);
+      return G_SOURCE_REMOVE;
+    }
+
+  thunar_profile_monitor_report (replay);
+
+  if (replay->destroy != NULL)
+    (*replay->destroy) (replay->user_data);
+  g_ptr_array_free (replay->events, TRUE);
+  g_slice_free (ThunarProfileMonitorReplay, replay);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+/**
+ * thunar_profile_monitor_replay:
+ * @directory : a loaded directory.
+ * @func      : the function handling the events of @directory.
+ * @user_data : the data for @func.
+ * @destroy   : the function to release @user_data, or %NULL.
+ *
+ * Replays the events of @directory from the trace named by
+ * THUNAR_PROFILE_MONITOR_REPLAY with their recorded timing, if that is
+ * set in the environment, and reports the time spent in @func and the
+ * main loop stalls meanwhile to stderr. The events of a directory are
+ * replayed once per process. @destroy is called when the replay ends,
+ * or right away if there is nothing to replay.
+ **/
+void
+thunar_profile_monitor_replay (GFile                   *directory,
+                               ThunarProfileMonitorFunc func,
+                               gpointer                 user_data,
+                               GDestroyNotify           destroy)
+{
+  ThunarProfileMonitorReplay *replay;
+  ThunarProfileMonitorEvent  *event;
+  const guint64              *counts;
+  const guint                *limits;
+  const gchar                *value;
+  GPtrArray                  *events;
+  gchar                      *uri;
+  guint                       n_limits;
+  guint                       n;
+
+  if (G_UNLIKELY (monitor_replay_enabled < 0))
+    {
+      value = g_getenv ("THUNAR_PROFILE_MONITOR_REPLAY");
+      monitor_replay_enabled = (value != NULL && *value != '\0');
+      if (monitor_replay_enabled)
+        thunar_profile_monitor_load (value);
+    }
+
+  events = NULL;
+  if (G_UNLIKELY (monitor_replay_enabled))
+    {
+      uri = g_file_get_uri (directory);
+      for (n = 0; n < monitor_replay_events->len; ++n)
+        {
+          event = &g_array_index (monitor_replay_events, ThunarProfileMonitorEvent, n);
+          if (event->directory[0] == '\0' || strcmp (event->directory, uri) != 0)
+            continue;
+
+          if (events == NULL)
+            events = g_ptr_array_new ();
+          g_ptr_array_add (events, event);
+
+          /* replayed only once, the folder is loaded again after a reload */
+          g_free (event->directory);
+          event->directory = g_strdup ("");
+        }
+      g_free (uri);
+    }
+
+  if (G_LIKELY (events == NULL))
+    {
+      if (destroy != NULL)
+        (*destroy) (user_data);
+      return;
+    }
+
+  replay = g_slice_new0 (ThunarProfileMonitorReplay);
+  replay->events = events;
+  replay->func = func;
+  replay->user_data = user_data;
+  replay->destroy = destroy;
+
+  /* the stalls are counted from here on */
+  thunar_profile_stalls_start ();
+  n_limits = thunar_profile_get_stalls (&limits, &counts);
+  memcpy (replay->stalls, counts, (n_limits + 1) * sizeof (guint64));
+
+  /* the trace starts with the first event of this directory */
+  replay->origin = g_get_monotonic_time () - ((ThunarProfileMonitorEvent *) g_ptr_array_index (events, 0))->time;
+  g_idle_add (thunar_profile_monitor_dispatch, replay);
+}
+
+
+
+/* what the main thread was doing when the watchdog found it stalled */
+typedef struct
+{
+  gint64   time;        /* us since the watchdog started */
+  gint64   duration;    /* us */
+  gchar    source[THUNAR_PROFILE_WATCHDOG_SOURCE];
+  guint    navigation;
+  gchar  **frames;
+} ThunarProfileStall;
+
+static GMutex             watchdog_mutex;
+static gint64             watchdog_origin = 0;
+static gint64             watchdog_beat = 0; /* protected by the watchdog_mutex */
+static gint64             watchdog_threshold = 0;
+static ThunarProfileStall watchdog_stalls[THUNAR_PROFILE_WATCHDOG_RING_SIZE];
+static guint              watchdog_n_stalls = 0; /* protected by the watchdog_mutex */
+
+#ifdef THUNAR_PROFILE_WATCHDOG_SAMPLER
+/* written by the signal handler in the main thread */
+static pthread_t          watchdog_main_thread;
+static gpointer           watchdog_frames[THUNAR_PROFILE_WATCHDOG_FRAMES];
+static gint               watchdog_n_frames = 0;
+static gchar              watchdog_source[THUNAR_PROFILE_WATCHDOG_SOURCE];
+static gint               watchdog_sampled = 0;
+
+
+
+static void
+thunar_profile_watchdog_sample (gint signum)
+{
+  const gchar *name = NULL;
+  GSource     *source;
+  guint        n;
+
+  /* only functions which don't allocate or lock, so the main thread can be
+   * interrupted anywhere. The first backtrace() was done by the watchdog
+   * start, which loaded its unwinder */
+  watchdog_n_frames = backtrace (watchdog_frames, THUNAR_PROFILE_WATCHDOG_FRAMES);
+
+  /* the source the main loop dispatches, named with g_source_set_name() */
+  source = g_main_current_source ();
+  if (source != NULL)
+    name = g_source_get_name (source);
+  for (n = 0; name != NULL && name[n] != '\0' && n < sizeof (watchdog_source) - 1; ++n)
+    watchdog_source[n] = name[n];
+  watchdog_source[n] = '\0';
+
+  g_atomic_int_set (&watchdog_sampled, 1);
+}
+#endif
+
+
+
+static gboolean
+thunar_profile_watchdog_beat (gpointer user_data)
+{
+  g_mutex_lock (&watchdog_mutex);
+  watchdog_beat = g_get_monotonic_time ();
+  g_mutex_unlock (&watchdog_mutex);
+
+  return G_SOURCE_CONTINUE;
+}
+
+
+
+static void
+thunar_profile_watchdog_record (gint64 begin_time,
+                                gint64 end_time,
+                                gint   n_frames)
+{
+  ThunarProfileStall *stall;
+  GString            *report;
+#ifdef THUNAR_PROFILE_WATCHDOG_SAMPLER
+  gchar             **symbols;
+#endif
+  guint               n;
+
+  g_mutex_lock (&watchdog_mutex);
+
+  /* the oldest stall makes room */
+  stall = &watchdog_stalls[watchdog_n_stalls % THUNAR_PROFILE_WATCHDOG_RING_SIZE];
+  g_strfreev (stall->frames);
+
+  stall->time = begin_time - watchdog_origin;
+  stall->duration = end_time - begin_time;
+  stall->navigation = g_atomic_int_get (&navigation_last_id);
+  stall->source[0] = '\0';
+  stall->frames = NULL;
+
+#ifdef THUNAR_PROFILE_WATCHDOG_SAMPLER
+  if (n_frames > 0)
+    {
+      g_strlcpy (stall->source, watchdog_source, sizeof (stall->source));
+      stall->frames = g_new0 (gchar *, n_frames + 1);
+
+      /* the symbols are resolved in the watchdog thread, the strings of
+       * backtrace_symbols() are in one block with the array */
+      symbols = backtrace_symbols (watchdog_frames, n_frames);
+      for (n = 0; symbols != NULL && n < (guint) n_frames; ++n)
+        stall->frames[n] = g_strdup (symbols[n]);
+      free (symbols);
+    }
+#endif
+
+  watchdog_n_stalls++;
+
+  /* shown with G_MESSAGES_DEBUG=thunar */
+  report = g_string_new (NULL);
+  g_string_append_printf (report, "main loop stalled for %.1f ms in %s, navigation %u",
+                          stall->duration / 1000.0,
+                          (stall->source[0] != '\0') ? stall->source : "an unnamed source",
+                          stall->navigation);
+  for (n = 0; stall->frames != NULL && stall->frames[n] != NULL; ++n)
+    g_string_append_printf (report, "\n  #%u %s", n, stall->frames[n]);
+
+  g_mutex_unlock (&watchdog_mutex);
+
+  g_debug ("%s", report->str);
+  g_string_free (report, TRUE);
+}
+
+
+
+static gpointer
+thunar_profile_watchdog_thread (gpointer user_data)
+{
+  gboolean stalled = FALSE;
+  gint64   stall_begin = 0;
+  gint64   beat;
+  gint64   now;
+  gint     n_frames = 0;
+#ifdef THUNAR_PROFILE_WATCHDOG_SAMPLER
+  guint    n;
+#endif
+
+  for (;;)
+    {
+      g_usleep (watchdog_threshold / 4);
+
+      g_mutex_lock (&watchdog_mutex);
+      beat = watchdog_beat;
+      g_mutex_unlock (&watchdog_mutex);
+
+      /* the main loop did not run yet */
+      if (beat == 0)
+        continue;
+
+      now = g_get_monotonic_time ();
+
+      if (!stalled && now - beat > watchdog_threshold)
+        {
+          stalled = TRUE;
+          stall_begin = beat;
+          n_frames = 0;
+
+#ifdef THUNAR_PROFILE_WATCHDOG_SAMPLER
+          /* ask the main thread where it is, while it still is there */
+          g_atomic_int_set (&watchdog_sampled, 0);
+          pthread_kill (watchdog_main_thread, SIGPROF);
+          for (n = 0; n < 100 && !g_atomic_int_get (&watchdog_sampled); ++n)
+            g_usleep (1000);
+          if (g_atomic_int_get (&watchdog_sampled))
+            n_frames = watchdog_n_frames;
+#endif
+        }
+      else if (stalled && beat > stall_begin)
+        {
+          /* the stall is over, the beat comes right after the dispatch */
+          stalled = FALSE;
+          thunar_profile_watchdog_record (stall_begin, beat, n_frames);
+        }
+    }
+
+  return NULL;
+}
+
+
+
+/**
+ * thunar_profile_watchdog_start:
+ * @threshold : the duration of a stall, in milliseconds.
+ *
+ * Starts a thread watching the main loop, which is called by
+ * thunar_profile_init() if THUNAR_PROFILE_WATCHDOG is set in the
+ * environment, to the threshold or "1" for the default. If the main
+ * loop does not dispatch the heartbeat of the watchdog for @threshold,
+ * the main thread is interrupted to sample its stack and the name of
+ * the source it dispatches. The stalls are logged with g_debug() and
+ * kept for thunar_profile_foreach_stall().
+ **/
+void
+thunar_profile_watchdog_start (guint threshold)
+{
+#ifdef THUNAR_PROFILE_WATCHDOG_SAMPLER
+  struct sigaction action;
+#endif
+  guint id;
+
+  if (watchdog_threshold != 0)
+    return;
+
+  watchdog_threshold = (gint64) MAX (threshold, 10) * 1000;
+  watchdog_origin = g_get_monotonic_time ();
+
+#ifdef THUNAR_PROFILE_WATCHDOG_SAMPLER
+  watchdog_main_thread = pthread_self ();
+
+  /* loads the unwinder, which would allocate in the signal handler */
+  watchdog_n_frames = backtrace (watchdog_frames, THUNAR_PROFILE_WATCHDOG_FRAMES);
+  watchdog_n_frames = 0;
+
+  memset (&action, 0, sizeof (action));
+  action.sa_handler = thunar_profile_watchdog_sample;
+  action.sa_flags = SA_RESTART;
+  sigemptyset (&action.sa_mask);
+  sigaction (SIGPROF, &action, NULL);
+#endif
+
+  /* a high priority beat is late only if a dispatch takes long */
+  id = g_timeout_add_full (G_PRIORITY_HIGH, watchdog_threshold / 4000, thunar_profile_watchdog_beat, NULL, NULL);
+  g_source_set_name_by_id (id, "thunar_profile_watchdog_beat");
+
+  g_thread_unref (g_thread_new ("thunar-watchdog", thunar_profile_watchdog_thread, NULL));
+}
+
+
+
+/**
+ * thunar_profile_foreach_stall:
+ * @func      : the function to call for every stall.
+ * @user_data : the data for @func.
+ *
+ * Calls @func for the stalls the watchdog recorded, the oldest first.
+ * Only the latest stalls are kept.
+ **/
+void
+thunar_profile_foreach_stall (ThunarProfileStallFunc func,
+                              gpointer               user_data)
+{
+  ThunarProfileStall *stall;
+  guint               n;
+
+  g_mutex_lock (&watchdog_mutex);
+
+  n = (watchdog_n_stalls > THUNAR_PROFILE_WATCHDOG_RING_SIZE) ? watchdog_n_stalls - THUNAR_PROFILE_WATCHDOG_RING_SIZE : 0;
+  for (; n < watchdog_n_stalls; ++n)
+    {
+      stall = &watchdog_stalls[n % THUNAR_PROFILE_WATCHDOG_RING_SIZE];
+      (*func) (stall->time, stall->duration, stall->source, stall->navigation,
+               (const gchar *const *) stall->frames, user_data);
+    }
+
+  g_mutex_unlock (&watchdog_mutex);
+}
@@ -0,0 +1,72 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __THUNAR_PROFILE_H__
+#define __THUNAR_PROFILE_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS;
+
+void     thunar_profile_init    (gint         argc,
+                                 gchar      **argv);
+gboolean thunar_profile_enabled (void);
+
+gint64   thunar_profile_begin   (void);
+void     thunar_profile_end     (gint64       begin_time,
+                                 const gchar *phase);
+
+void     thunar_profile_report  (void);
+
+guint    thunar_profile_navigation_begin (GFile       *directory);
+gint64   thunar_profile_navigation_now   (GFile       *directory);
+void     thunar_profile_navigation_mark  (GFile       *directory,
+                                          gint64       begin_time,
+                                          const gchar *stage);
+void     thunar_profile_navigation_end   (GFile       *directory);
+
+void     thunar_profile_stalls_start     (void);
+guint    thunar_profile_get_stalls       (const guint   **limits,
+                                          const guint64 **counts);
+
+typedef void (*ThunarProfileMonitorFunc) (GFile            *file,
+                                          GFile            *other_file,
+                                          GFileMonitorEvent event_type,
+                                          gpointer          user_data);
+
+void     thunar_profile_monitor_record   (GFile                   *directory,
+                                          GFile                   *file,
+                                          GFile                   *other_file,
+                                          GFileMonitorEvent        event_type);
+void     thunar_profile_monitor_replay   (GFile                   *directory,
+                                          ThunarProfileMonitorFunc func,
+                                          gpointer                 user_data,
+                                          GDestroyNotify           destroy);
+
+typedef void (*ThunarProfileStallFunc) (gint64             time,
+                                        gint64             duration,
+                                        const gchar       *source,
+                                        guint              navigation,
+                                        const gchar *const *frames,
+                                        gpointer           user_data);
+
+void     thunar_profile_watchdog_start   (guint                   threshold);
+void     thunar_profile_foreach_stall    (ThunarProfileStallFunc  func,
+                                          gpointer                user_data);
+
+G_END_DECLS;
+
+#endif /* !__THUNAR_PROFILE_H__ */
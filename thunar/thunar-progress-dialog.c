@@ -35,12 +35,20 @@
 
 #define SCROLLVIEW_THRESHOLD 5
 
+/* the number of waiting views shown until the user asks for all of them */
+#define WAITING_VIEWS_VISIBLE 5
+
 
 
 static void     thunar_progress_dialog_dispose            (GObject              *object);
 static void     thunar_progress_dialog_finalize           (GObject              *object);
 static gboolean thunar_progress_dialog_closed             (ThunarProgressDialog *dialog);
 static gint     thunar_progress_dialog_n_views            (ThunarProgressDialog *dialog);
+static GList   *thunar_progress_dialog_list_waiting_jobs  (ThunarProgressDialog *dialog);
+static gboolean thunar_progress_dialog_merge_job          (ThunarProgressDialog *dialog,
+                                                           ThunarTransferJob    *job);
+static void     thunar_progress_dialog_update_waiting     (ThunarProgressDialog *dialog);
+static void     thunar_progress_dialog_show_waiting       (ThunarProgressDialog *dialog);
 
 
 
@@ -57,6 +65,11 @@ struct _ThunarProgressDialog
   GtkWidget     *vbox;
   GtkWidget     *content_box;
 
+  /* summary of the waiting views that are not shown */
+  GtkWidget     *waiting_box;
+  GtkWidget     *waiting_label;
+  gboolean       waiting_expanded;
+
   /* List of running views, type ThunarProgressView */
   GList         *views;
   /* List of waiting views, type ThunarProgressView */
@@ -90,6 +103,8 @@ thunar_progress_dialog_class_init (ThunarProgressDialogClass *klass)
 static void
 thunar_progress_dialog_init (ThunarProgressDialog *dialog)
 {
+  GtkWidget *button;
+
   dialog->views = NULL;
   dialog->views_waiting = NULL;
 
@@ -111,6 +126,19 @@ thunar_progress_dialog_init (ThunarProgressDialog *dialog)
   gtk_container_set_border_width (GTK_CONTAINER (dialog->content_box), 12);
   gtk_container_add (GTK_CONTAINER (dialog->vbox), dialog->content_box);
   gtk_widget_show (dialog->content_box);
+
+  /* scripts may queue hundreds of copies, which can't all be shown */
+  dialog->waiting_box = gtk_box_new (GTK_ORIENTATION_HORIZONTAL, 12);
+  gtk_box_pack_end (GTK_BOX (dialog->content_box), dialog->waiting_box, FALSE, TRUE, 0);
+
+  dialog->waiting_label = g_object_new (GTK_TYPE_LABEL, "xalign", 0.0f, NULL);
+  gtk_box_pack_start (GTK_BOX (dialog->waiting_box), dialog->waiting_label, TRUE, TRUE, 0);
+  gtk_widget_show (dialog->waiting_label);
+
+  button = gtk_button_new_with_mnemonic (_("_Show All"));
+  g_signal_connect_swapped (button, "clicked", G_CALLBACK (thunar_progress_dialog_show_waiting), dialog);
+  gtk_box_pack_start (GTK_BOX (dialog->waiting_box), button, FALSE, FALSE, 0);
+  gtk_widget_show (button);
 }
 
 
@@ -167,6 +195,52 @@ thunar_progress_dialog_n_views (ThunarProgressDialog *dialog)
 
 
 
+static void
+thunar_progress_dialog_update_waiting (ThunarProgressDialog *dialog)
+{
+  GList *lp;
+  gchar *text;
+  guint  n_views = 0;
+  guint  n_hidden;
+
+  _thunar_return_if_fail (THUNAR_IS_PROGRESS_DIALOG (dialog));
+
+  /* the running views are always shown */
+  for (lp = dialog->views; lp != NULL; lp = lp->next)
+    gtk_widget_show (lp->data);
+
+  /* only the first waiting views are realized, unless the user expanded them */
+  for (lp = dialog->views_waiting; lp != NULL; lp = lp->next, ++n_views)
+    gtk_widget_set_visible (lp->data, dialog->waiting_expanded || n_views < WAITING_VIEWS_VISIBLE);
+
+  if (!dialog->waiting_expanded && n_views > WAITING_VIEWS_VISIBLE)
+    {
+      n_hidden = n_views - WAITING_VIEWS_VISIBLE;
+      text = g_strdup_printf (ngettext ("%u more operation is waiting",
+                                        "%u more operations are waiting", n_hidden), n_hidden);
+      gtk_label_set_text (GTK_LABEL (dialog->waiting_label), text);
+      gtk_widget_show (dialog->waiting_box);
+      g_free (text);
+    }
+  else
+    {
+      gtk_widget_hide (dialog->waiting_box);
+    }
+}
+
+
+
+static void
+thunar_progress_dialog_show_waiting (ThunarProgressDialog *dialog)
+{
+  _thunar_return_if_fail (THUNAR_IS_PROGRESS_DIALOG (dialog));
+
+  dialog->waiting_expanded = TRUE;
+  thunar_progress_dialog_update_waiting (dialog);
+}
+
+
+
 static void
 thunar_progress_dialog_view_needs_attention (ThunarProgressDialog *dialog,
                                              ThunarProgressView   *view)
@@ -198,6 +272,7 @@ thunar_progress_dialog_launch_view (ThunarProgressDialog *dialog,
       dialog->views_waiting = g_list_remove_link (dialog->views_waiting, view_lp);
       dialog->views         = g_list_concat (view_lp, dialog->views);
       thunar_progress_view_launch_job (THUNAR_PROGRESS_VIEW (view_lp->data));
+      thunar_progress_dialog_update_waiting (dialog);
     }
   else
     {
@@ -210,6 +285,38 @@ thunar_progress_dialog_launch_view (ThunarProgressDialog *dialog,
 
 
 
+static void
+thunar_progress_dialog_pause_device (ThunarProgressDialog *dialog,
+                                     ThunarProgressView   *view)
+{
+  ThunarJob *job;
+  ThunarJob *other;
+  GList     *views;
+  GList     *lp;
+
+  _thunar_return_if_fail (THUNAR_IS_PROGRESS_DIALOG (dialog));
+  _thunar_return_if_fail (THUNAR_IS_PROGRESS_VIEW (view));
+
+  job = thunar_progress_view_get_job (view);
+  if (!THUNAR_IS_TRANSFER_JOB (job))
+    return;
+
+  /* the waiting jobs would take over the devices once a running one finishes */
+  views = g_list_concat (g_list_copy (dialog->views), g_list_copy (dialog->views_waiting));
+  for (lp = views; lp != NULL; lp = lp->next)
+    {
+      other = thunar_progress_view_get_job (lp->data);
+      if (lp->data != view
+          && THUNAR_IS_TRANSFER_JOB (other)
+          && !thunar_job_is_paused (other)
+          && thunar_transfer_job_shares_device (THUNAR_TRANSFER_JOB (job), THUNAR_TRANSFER_JOB (other)))
+        thunar_progress_view_pause_job (lp->data);
+    }
+  g_list_free (views);
+}
+
+
+
 static void
 launch_waiting_jobs (ThunarProgressDialog *dialog)
 {
@@ -217,6 +324,7 @@ launch_waiting_jobs (ThunarProgressDialog *dialog)
   GList             *lp           = NULL;
   GList             *next         = NULL;
   GList             *job_list;
+  GList             *waiting_list = NULL;
   ThunarTransferJob *transfer_job;
 
   lp = dialog->views_waiting;
@@ -227,7 +335,7 @@ launch_waiting_jobs (ThunarProgressDialog *dialog)
     {
       next         = lp->next;
       transfer_job = THUNAR_TRANSFER_JOB (thunar_progress_view_get_job (THUNAR_PROGRESS_VIEW (lp->data)));
-      if (thunar_transfer_job_can_start (transfer_job, job_list))
+      if (thunar_transfer_job_can_start (transfer_job, job_list, waiting_list))
         {
           launched = TRUE;
 
@@ -238,9 +346,17 @@ launch_waiting_jobs (ThunarProgressDialog *dialog)
 
           job_list = g_list_prepend (job_list, thunar_progress_view_get_job (THUNAR_PROGRESS_VIEW (lp->data)));
         }
+      else
+        {
+          /* the jobs after this one have to wait for it on its devices */
+          waiting_list = g_list_prepend (waiting_list, transfer_job);
+        }
       lp = next;
     }
   g_list_free (job_list);
+  g_list_free (waiting_list);
+
+  thunar_progress_dialog_update_waiting (dialog);
 
   if (launched == FALSE)
     g_warning ("Waiting jobs cannot be launched");
@@ -341,6 +457,45 @@ thunar_progress_dialog_list_jobs (ThunarProgressDialog *dialog)
 
 
 
+static GList *
+thunar_progress_dialog_list_waiting_jobs (ThunarProgressDialog *dialog)
+{
+  GList     *jobs = NULL;
+  GList     *l;
+  ThunarJob *job;
+
+  for (l = dialog->views_waiting; l != NULL; l = l->next)
+    {
+      job = thunar_progress_view_get_job (THUNAR_PROGRESS_VIEW (l->data));
+      if (job != NULL && !exo_job_is_cancelled (EXO_JOB (job)))
+        jobs = g_list_append (jobs, job);
+    }
+  return jobs;
+}
+
+
+
+static gboolean
+thunar_progress_dialog_merge_job (ThunarProgressDialog *dialog,
+                                  ThunarTransferJob    *job)
+{
+  ThunarJob *waiting_job;
+  GList     *lp;
+
+  for (lp = dialog->views_waiting; lp != NULL; lp = lp->next)
+    {
+      waiting_job = thunar_progress_view_get_job (lp->data);
+      if (THUNAR_IS_TRANSFER_JOB (waiting_job)
+          && !thunar_job_is_paused (waiting_job)
+          && thunar_transfer_job_merge (THUNAR_TRANSFER_JOB (waiting_job), job))
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+
+
 void
 thunar_progress_dialog_add_job (ThunarProgressDialog *dialog,
                                 ThunarJob            *job,
@@ -350,25 +505,35 @@ thunar_progress_dialog_add_job (ThunarProgressDialog *dialog,
   GtkWidget *viewport;
   GtkWidget *view;
   GList     *job_list;
+  GList     *waiting_list;
+  gboolean   can_start;
 
   _thunar_return_if_fail (THUNAR_IS_PROGRESS_DIALOG (dialog));
   _thunar_return_if_fail (THUNAR_IS_JOB (job));
   _thunar_return_if_fail (g_utf8_validate (title, -1, NULL));
 
+  /* Check if the job can start */
+  job_list = thunar_progress_dialog_list_jobs (dialog);
+  waiting_list = thunar_progress_dialog_list_waiting_jobs (dialog);
+  can_start = !THUNAR_IS_TRANSFER_JOB (job)
+              || thunar_transfer_job_can_start (THUNAR_TRANSFER_JOB (job), job_list, waiting_list);
+  g_list_free (job_list);
+  g_list_free (waiting_list);
+
+  /* a copy waiting for the same devices as a queued one is done by that one */
+  if (!can_start && thunar_progress_dialog_merge_job (dialog, THUNAR_TRANSFER_JOB (job)))
+    return;
+
   view = thunar_progress_view_new_with_job (job);
   thunar_progress_view_set_icon_name (THUNAR_PROGRESS_VIEW (view), icon_name);
   thunar_progress_view_set_title (THUNAR_PROGRESS_VIEW (view), title);
   gtk_box_pack_start (GTK_BOX (dialog->content_box), view, FALSE, TRUE, 0);
-  gtk_widget_show (view);
 
   /* use the first job's icon-name for the dialog */
   if (dialog->views == NULL)
     gtk_window_set_icon_name (GTK_WINDOW (dialog), icon_name);
 
-  /* Check if the job can start */
-  job_list = thunar_progress_dialog_list_jobs (dialog);
-  if (!THUNAR_IS_TRANSFER_JOB (job)
-      || thunar_transfer_job_can_start (THUNAR_TRANSFER_JOB (job), job_list))
+  if (can_start)
     {
       dialog->views = g_list_append (dialog->views, view);
       thunar_progress_view_launch_job (THUNAR_PROGRESS_VIEW (view));
@@ -377,7 +542,8 @@ thunar_progress_dialog_add_job (ThunarProgressDialog *dialog,
     {
       dialog->views_waiting = g_list_append (dialog->views_waiting, view);
     }
-  g_list_free (job_list);
+
+  thunar_progress_dialog_update_waiting (dialog);
 
   /* check if we need to wrap the views in a scroll window (starting
    * at SCROLLVIEW_THRESHOLD parallel operations */
@@ -411,6 +577,9 @@ thunar_progress_dialog_add_job (ThunarProgressDialog *dialog,
 
   g_signal_connect_swapped (view, "force-launch",
                             G_CALLBACK (thunar_progress_dialog_launch_view), dialog);
+
+  g_signal_connect_swapped (view, "pause-device",
+                            G_CALLBACK (thunar_progress_dialog_pause_device), dialog);
 }
 
 
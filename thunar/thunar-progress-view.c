@@ -25,6 +25,7 @@
 #include <exo/exo.h>
 
 #include "thunar/thunar-dialogs.h"
+#include "thunar/thunar-enum-types.h"
 #include "thunar/thunar-gobject-extensions.h"
 #include "thunar/thunar-job.h"
 #include "thunar/thunar-pango-extensions.h"
@@ -35,6 +36,11 @@
 
 
 
+/* the views apply the progress of their jobs at most this often, in ms */
+#define THUNAR_PROGRESS_VIEW_REFRESH_INTERVAL (250)
+
+
+
 enum
 {
   PROP_0,
@@ -55,9 +61,17 @@ static void              thunar_progress_view_set_property (GObject            *
                                                             guint               prop_id,
                                                             const GValue       *value,
                                                             GParamSpec         *pspec);
-static void              thunar_progress_view_pause_job    (ThunarProgressView *view);
+static void              thunar_progress_view_pause_clicked (ThunarProgressView *view);
 static void              thunar_progress_view_unpause_job  (ThunarProgressView *view);
 static void              thunar_progress_view_cancel_job   (ThunarProgressView *view);
+static gboolean          thunar_progress_view_io_class_to_active   (GBinding     *binding,
+                                                                    const GValue *src_value,
+                                                                    GValue       *dst_value,
+                                                                    gpointer      user_data);
+static gboolean          thunar_progress_view_io_class_from_active (GBinding     *binding,
+                                                                    const GValue *src_value,
+                                                                    GValue       *dst_value,
+                                                                    gpointer      user_data);
 static ThunarJobResponse thunar_progress_view_ask          (ThunarProgressView *view,
                                                             const gchar        *message,
                                                             ThunarJobResponse   choices,
@@ -83,6 +97,10 @@ static void              thunar_progress_view_unfrozen     (ThunarProgressView *
                                                             ExoJob             *job);
 static void              thunar_progress_view_set_job      (ThunarProgressView *view,
                                                             ThunarJob          *job);
+static void              thunar_progress_view_queue_refresh (ThunarProgressView *view);
+static void              thunar_progress_view_refresh      (ThunarProgressView *view);
+static void              thunar_progress_view_update_details (ThunarProgressView *view);
+static void              thunar_progress_view_copy_details (ThunarProgressView *view);
 
 
 
@@ -100,13 +118,22 @@ struct _ThunarProgressView
   GtkWidget *progress_bar;
   GtkWidget *progress_label;
   GtkWidget *message_label;
+  GtkWidget *details_expander;
+  GtkWidget *details_label;
   GtkWidget *pause_button;
   GtkWidget *unpause_button;
+  GtkWidget *background_button;
+  GBinding  *background_binding;
 
   gboolean   launched;
 
   gchar     *icon_name;
   gchar     *title;
+
+  /* the latest progress of the job, not shown yet */
+  gboolean   refresh_queued;
+  gchar     *pending_message;
+  gdouble    pending_percent;
 };
 
 
@@ -115,6 +142,13 @@ G_DEFINE_TYPE (ThunarProgressView, thunar_progress_view, GTK_TYPE_BOX)
 
 
 
+/* the views with progress to show at the next refresh, all views share
+ * a single timeout so many jobs don't keep the main loop busy */
+static GSList *refresh_views = NULL;
+static guint   refresh_id = 0;
+
+
+
 static void
 thunar_progress_view_class_init (ThunarProgressViewClass *klass)
 {
@@ -174,6 +208,17 @@ thunar_progress_view_class_init (ThunarProgressViewClass *klass)
                 G_TYPE_NONE,
                 0);
 
+  /* the user asked to pause all jobs on the devices of this one */
+  g_signal_new ("pause-device",
+                THUNAR_TYPE_PROGRESS_VIEW,
+                G_SIGNAL_RUN_LAST | G_SIGNAL_NO_HOOKS,
+                0,
+                NULL,
+                NULL,
+                g_cclosure_marshal_VOID__VOID,
+                G_TYPE_NONE,
+                0);
+
   g_signal_new ("force-launch",
                 THUNAR_TYPE_PROGRESS_VIEW,
                 G_SIGNAL_RUN_LAST | G_SIGNAL_NO_HOOKS,
@@ -192,6 +237,7 @@ thunar_progress_view_init (ThunarProgressView *view)
 {
   GtkWidget *image;
   GtkWidget *label;
+  GtkWidget *button;
   GtkWidget *cancel_button;
   GtkWidget *vbox;
   GtkWidget *vbox2;
@@ -199,6 +245,8 @@ thunar_progress_view_init (ThunarProgressView *view)
   GtkWidget *hbox;
 
   view->launched = FALSE;
+  view->background_binding = NULL;
+  view->pending_percent = -1.0;
 
   gtk_orientable_set_orientation (GTK_ORIENTABLE (view), GTK_ORIENTATION_VERTICAL);
 
@@ -235,7 +283,8 @@ thunar_progress_view_init (ThunarProgressView *view)
 
   view->pause_button = gtk_button_new_from_icon_name ("media-playback-pause-symbolic", GTK_ICON_SIZE_BUTTON);
   gtk_button_set_relief (GTK_BUTTON (view->pause_button), GTK_RELIEF_NONE);
-  g_signal_connect_swapped (view->pause_button, "clicked", G_CALLBACK (thunar_progress_view_pause_job), view);
+  gtk_widget_set_tooltip_text (view->pause_button, _("Pause (Shift+click to pause all operations on the same devices)"));
+  g_signal_connect_swapped (view->pause_button, "clicked", G_CALLBACK (thunar_progress_view_pause_clicked), view);
   gtk_box_pack_start (GTK_BOX (hbox), view->pause_button, FALSE, FALSE, 0);
   gtk_widget_set_can_focus (view->pause_button, FALSE);
   gtk_widget_hide (view->pause_button);
@@ -247,6 +296,15 @@ thunar_progress_view_init (ThunarProgressView *view)
   gtk_widget_set_can_focus (view->unpause_button, FALSE);
   gtk_widget_hide (view->unpause_button);
 
+  view->background_button = gtk_toggle_button_new ();
+  gtk_button_set_image (GTK_BUTTON (view->background_button),
+                        gtk_image_new_from_icon_name ("media-seek-backward-symbolic", GTK_ICON_SIZE_BUTTON));
+  gtk_button_set_relief (GTK_BUTTON (view->background_button), GTK_RELIEF_NONE);
+  gtk_widget_set_tooltip_text (view->background_button, _("Copy in the background, only while the disks are idle"));
+  gtk_box_pack_start (GTK_BOX (hbox), view->background_button, FALSE, FALSE, 0);
+  gtk_widget_set_can_focus (view->background_button, FALSE);
+  gtk_widget_hide (view->background_button);
+
   cancel_button = gtk_button_new_from_icon_name ("media-playback-stop-symbolic", GTK_ICON_SIZE_BUTTON);
   gtk_button_set_relief (GTK_BUTTON (cancel_button), GTK_RELIEF_NONE);
   g_signal_connect_swapped (cancel_button, "clicked", G_CALLBACK (thunar_progress_view_cancel_job), view);
@@ -272,6 +330,30 @@ thunar_progress_view_init (ThunarProgressView *view)
   gtk_box_pack_start (GTK_BOX (vbox3), view->progress_label, FALSE, TRUE, 0);
   gtk_widget_show (view->progress_label);
 
+  /* the IO statistics of the job, to tell why it is slow */
+  view->details_expander = gtk_expander_new_with_mnemonic (_("_Details"));
+  g_signal_connect_swapped (view->details_expander, "notify::expanded", G_CALLBACK (thunar_progress_view_update_details), view);
+  gtk_box_pack_start (GTK_BOX (vbox3), view->details_expander, FALSE, TRUE, 0);
+  gtk_widget_show (view->details_expander);
+
+  vbox = gtk_box_new (GTK_ORIENTATION_VERTICAL, 3);
+  gtk_container_add (GTK_CONTAINER (view->details_expander), vbox);
+  gtk_widget_show (vbox);
+
+  view->details_label = g_object_new (GTK_TYPE_LABEL, "xalign", 0.0f, "selectable", TRUE, NULL);
+  gtk_label_set_attributes (GTK_LABEL (view->details_label), thunar_pango_attr_list_small_monospace ());
+  gtk_widget_set_can_focus (view->details_label, FALSE);
+  gtk_box_pack_start (GTK_BOX (vbox), view->details_label, FALSE, TRUE, 0);
+  gtk_widget_show (view->details_label);
+
+  button = gtk_button_new_with_mnemonic (_("_Copy Summary"));
+  gtk_widget_set_tooltip_text (button, _("Copy the statistics of this operation to the clipboard"));
+  gtk_widget_set_halign (button, GTK_ALIGN_START);
+  g_signal_connect_swapped (button, "clicked", G_CALLBACK (thunar_progress_view_copy_details), view);
+  gtk_box_pack_start (GTK_BOX (vbox), button, FALSE, FALSE, 0);
+  gtk_widget_set_can_focus (button, FALSE);
+  gtk_widget_show (button);
+
   /* connect the view title to the action label */
   g_object_bind_property (G_OBJECT (view), "title",
                           G_OBJECT (label), "label",
@@ -287,6 +369,7 @@ thunar_progress_view_finalize (GObject *object)
 
   g_free (view->icon_name);
   g_free (view->title);
+  g_free (view->pending_message);
 
   (*G_OBJECT_CLASS (thunar_progress_view_parent_class)->finalize) (object);
 }
@@ -305,6 +388,13 @@ thunar_progress_view_dispose (GObject *object)
       thunar_progress_view_set_job (view, NULL);
     }
 
+  /* drop the progress that was not shown yet */
+  if (view->refresh_queued)
+    {
+      refresh_views = g_slist_remove (refresh_views, view);
+      view->refresh_queued = FALSE;
+    }
+
   (*G_OBJECT_CLASS (thunar_progress_view_parent_class)->dispose) (object);
 }
 
@@ -371,6 +461,28 @@ thunar_progress_view_set_property (GObject      *object,
 
 
 static void
+thunar_progress_view_pause_clicked (ThunarProgressView *view)
+{
+  GdkModifierType state;
+
+  _thunar_return_if_fail (THUNAR_IS_PROGRESS_VIEW (view));
+
+  thunar_progress_view_pause_job (view);
+
+  /* free the disks for something urgent */
+  if (gtk_get_current_event_state (&state) && (state & GDK_SHIFT_MASK) != 0)
+    g_signal_emit_by_name (view, "pause-device");
+}
+
+
+
+/**
+ * thunar_progress_view_pause_job:
+ * @view : a #ThunarProgressView.
+ *
+ * Pauses the job of @view, like the pause button does.
+ **/
+void
 thunar_progress_view_pause_job (ThunarProgressView *view)
 {
   _thunar_return_if_fail (THUNAR_IS_PROGRESS_VIEW (view));
@@ -443,6 +555,9 @@ thunar_progress_view_cancel_job (ThunarProgressView *view)
       g_signal_handlers_disconnect_matched (view->job, G_SIGNAL_MATCH_FUNC, 0, 0, NULL,
                                             thunar_progress_view_info_message, NULL);
 
+      /* show the last progress before the status text replaces it */
+      thunar_progress_view_refresh (view);
+
       /* update the status text */
       gtk_label_set_text (GTK_LABEL (view->progress_label), _("Cancelling..."));
 
@@ -454,6 +569,30 @@ thunar_progress_view_cancel_job (ThunarProgressView *view)
 
 
 
+static gboolean
+thunar_progress_view_io_class_to_active (GBinding     *binding,
+                                         const GValue *src_value,
+                                         GValue       *dst_value,
+                                         gpointer      user_data)
+{
+  g_value_set_boolean (dst_value, g_value_get_enum (src_value) == THUNAR_TRANSFER_IO_CLASS_IDLE);
+  return TRUE;
+}
+
+
+
+static gboolean
+thunar_progress_view_io_class_from_active (GBinding     *binding,
+                                           const GValue *src_value,
+                                           GValue       *dst_value,
+                                           gpointer      user_data)
+{
+  g_value_set_enum (dst_value, g_value_get_boolean (src_value) ? THUNAR_TRANSFER_IO_CLASS_IDLE : THUNAR_TRANSFER_IO_CLASS_NORMAL);
+  return TRUE;
+}
+
+
+
 static ThunarJobResponse
 thunar_progress_view_ask (ThunarProgressView *view,
                           const gchar        *message,
@@ -535,10 +674,17 @@ static void
 thunar_progress_view_finished (ThunarProgressView *view,
                                ExoJob             *job)
 {
+  gchar *summary;
+
   _thunar_return_if_fail (THUNAR_IS_PROGRESS_VIEW (view));
   _thunar_return_if_fail (THUNAR_IS_JOB (job));
   _thunar_return_if_fail (view->job == THUNAR_JOB (job));
 
+  /* the view goes away with the job, keep its summary in the debug log */
+  summary = thunar_job_get_stats_summary (THUNAR_JOB (job));
+  g_debug ("%s finished:\n%s", view->title != NULL ? view->title : "Job", summary);
+  g_free (summary);
+
   /* emit finished signal to notify others that the job is finished */
   g_signal_emit_by_name (view, "finished");
 }
@@ -555,7 +701,10 @@ thunar_progress_view_info_message (ThunarProgressView *view,
   _thunar_return_if_fail (THUNAR_IS_JOB (job));
   _thunar_return_if_fail (view->job == THUNAR_JOB (job));
 
-  gtk_label_set_text (GTK_LABEL (view->message_label), message);
+  /* copies of many small files send a message per file */
+  g_free (view->pending_message);
+  view->pending_message = g_strdup (message);
+  thunar_progress_view_queue_refresh (view);
 }
 
 
@@ -565,23 +714,131 @@ thunar_progress_view_percent (ThunarProgressView *view,
                               gdouble             percent,
                               ExoJob             *job)
 {
-  gchar *text;
-
   _thunar_return_if_fail (THUNAR_IS_PROGRESS_VIEW (view));
   _thunar_return_if_fail (percent >= 0.0 && percent <= 100.0);
   _thunar_return_if_fail (THUNAR_IS_JOB (job));
   _thunar_return_if_fail (view->job == THUNAR_JOB (job));
 
-  /* update progressbar */
-  gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (view->progress_bar), percent / 100.0);
+  view->pending_percent = percent;
+  thunar_progress_view_queue_refresh (view);
+}
+
+
+
+static gboolean
+thunar_progress_view_refresh_timeout (gpointer user_data)
+{
+  GSList *views;
+  GSList *lp;
+
+  refresh_id = 0;
+
+  views = g_steal_pointer (&refresh_views);
+  for (lp = views; lp != NULL; lp = lp->next)
+    {
+      THUNAR_PROGRESS_VIEW (lp->data)->refresh_queued = FALSE;
+      thunar_progress_view_refresh (lp->data);
+    }
+  g_slist_free (views);
+
+  return G_SOURCE_REMOVE;
+}
+
 
-  /* set progress text */
-  if (THUNAR_IS_TRANSFER_JOB (job))
-    text = thunar_transfer_job_get_status (THUNAR_TRANSFER_JOB (job));
-  else
-    text = g_strdup_printf ("%.2f%%", percent);
 
-  gtk_label_set_text (GTK_LABEL (view->progress_label), text);
+static void
+thunar_progress_view_queue_refresh (ThunarProgressView *view)
+{
+  if (!view->refresh_queued)
+    {
+      view->refresh_queued = TRUE;
+      refresh_views = g_slist_prepend (refresh_views, view);
+    }
+
+  if (refresh_id == 0)
+    refresh_id = g_timeout_add (THUNAR_PROGRESS_VIEW_REFRESH_INTERVAL, thunar_progress_view_refresh_timeout, NULL);
+}
+
+
+
+static void
+thunar_progress_view_refresh (ThunarProgressView *view)
+{
+  gchar *text;
+
+  _thunar_return_if_fail (THUNAR_IS_PROGRESS_VIEW (view));
+
+  if (view->refresh_queued)
+    {
+      refresh_views = g_slist_remove (refresh_views, view);
+      view->refresh_queued = FALSE;
+    }
+
+  if (view->pending_message != NULL)
+    {
+      gtk_label_set_text (GTK_LABEL (view->message_label), view->pending_message);
+      g_clear_pointer (&view->pending_message, g_free);
+    }
+
+  if (view->pending_percent >= 0.0 && view->job != NULL)
+    {
+      /* update progressbar */
+      gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (view->progress_bar), view->pending_percent / 100.0);
+
+      /* set progress text */
+      if (THUNAR_IS_TRANSFER_JOB (view->job))
+        text = thunar_transfer_job_get_status (THUNAR_TRANSFER_JOB (view->job));
+      else
+        text = g_strdup_printf ("%.2f%%", view->pending_percent);
+
+      gtk_label_set_text (GTK_LABEL (view->progress_label), text);
+      g_free (text);
+
+      view->pending_percent = -1.0;
+    }
+
+  thunar_progress_view_update_details (view);
+}
+
+
+
+static void
+thunar_progress_view_update_details (ThunarProgressView *view)
+{
+  gchar *summary;
+
+  _thunar_return_if_fail (THUNAR_IS_PROGRESS_VIEW (view));
+
+  /* the summary is only formatted while the details are shown */
+  if (view->job == NULL || !gtk_expander_get_expanded (GTK_EXPANDER (view->details_expander)))
+    return;
+
+  summary = thunar_job_get_stats_summary (view->job);
+  gtk_label_set_text (GTK_LABEL (view->details_label), summary);
+  g_free (summary);
+}
+
+
+
+static void
+thunar_progress_view_copy_details (ThunarProgressView *view)
+{
+  GtkClipboard *clipboard;
+  gchar        *summary;
+  gchar        *text;
+
+  _thunar_return_if_fail (THUNAR_IS_PROGRESS_VIEW (view));
+
+  if (view->job == NULL)
+    return;
+
+  /* the summary as of now, with the operation it belongs to */
+  summary = thunar_job_get_stats_summary (view->job);
+  text = g_strconcat (view->title != NULL ? view->title : "", "\n", summary, "\n", NULL);
+  g_free (summary);
+
+  clipboard = gtk_clipboard_get_for_display (gtk_widget_get_display (GTK_WIDGET (view)), GDK_SELECTION_CLIPBOARD);
+  gtk_clipboard_set_text (clipboard, text, -1);
   g_free (text);
 }
 
@@ -597,7 +854,8 @@ thunar_progress_view_frozen (ThunarProgressView *view,
 
   if (THUNAR_IS_TRANSFER_JOB (job))
     {
-      /* update the UI */
+      /* update the UI, the progress before came first */
+      thunar_progress_view_refresh (view);
       gtk_widget_hide (view->pause_button);
       gtk_widget_show (view->unpause_button);
       gtk_label_set_text (GTK_LABEL (view->progress_label), _("Job queued"));
@@ -616,7 +874,8 @@ thunar_progress_view_unfrozen (ThunarProgressView *view,
 
   if (THUNAR_IS_TRANSFER_JOB (job))
     {
-      /* update the UI */
+      /* update the UI, the progress before came first */
+      thunar_progress_view_refresh (view);
       gtk_widget_hide (view->unpause_button);
       gtk_widget_show (view->pause_button);
       gtk_label_set_text (GTK_LABEL (view->progress_label), _("Resuming job..."));
@@ -692,6 +951,12 @@ thunar_progress_view_set_job (ThunarProgressView *view,
       g_signal_handlers_disconnect_by_data (view->job, view);
       g_object_unref (G_OBJECT (view->job));
     }
+  if (view->background_binding != NULL)
+    {
+      g_binding_unbind (view->background_binding);
+      view->background_binding = NULL;
+      gtk_widget_hide (view->background_button);
+    }
 
   /* activate the new job */
   view->job = job;
@@ -713,6 +978,18 @@ thunar_progress_view_set_job (ThunarProgressView *view,
         {
           gtk_widget_show (view->unpause_button);
         }
+
+      /* copies and moves may be sent to the background */
+      if (THUNAR_IS_TRANSFER_JOB (job))
+        {
+          view->background_binding = g_object_bind_property_full (job, "io-class",
+                                                                  view->background_button, "active",
+                                                                  G_BINDING_SYNC_CREATE | G_BINDING_BIDIRECTIONAL,
+                                                                  thunar_progress_view_io_class_to_active,
+                                                                  thunar_progress_view_io_class_from_active,
+                                                                  NULL, NULL);
+          gtk_widget_show (view->background_button);
+        }
     }
 
   g_object_notify (G_OBJECT (view), "job");
@@ -763,6 +1040,15 @@ thunar_progress_view_launch_job (ThunarProgressView *view)
 
   view->launched = TRUE;
 
-  gtk_widget_hide (view->unpause_button);
-  gtk_widget_show (view->pause_button);
+  /* jobs may be launched paused, like resumed copies */
+  if (thunar_job_is_paused (view->job))
+    {
+      gtk_widget_hide (view->pause_button);
+      gtk_widget_show (view->unpause_button);
+    }
+  else
+    {
+      gtk_widget_hide (view->unpause_button);
+      gtk_widget_show (view->pause_button);
+    }
 }
@@ -47,6 +47,7 @@ void       thunar_progress_view_set_title     (ThunarProgressView *view,
                                                const gchar        *title);
 ThunarJob *thunar_progress_view_get_job       (ThunarProgressView *view);
 void       thunar_progress_view_launch_job    (ThunarProgressView *view);
+void       thunar_progress_view_pause_job     (ThunarProgressView *view);
 
 G_END_DECLS;
 
@@ -42,6 +42,7 @@
 #include "thunar/thunar-chooser-button.h"
 #include "thunar/thunar-dialogs.h"
 #include "thunar/thunar-emblem-chooser.h"
+#include "thunar/thunar-filesystem-cache.h"
 #include "thunar/thunar-gio-extensions.h"
 #include "thunar/thunar-gobject-extensions.h"
 #include "thunar/thunar-gtk-extensions.h"
@@ -108,7 +109,27 @@ static gboolean thunar_properties_dialog_name_focus_out_event (GtkWidget
 static void     thunar_properties_dialog_icon_button_clicked  (GtkWidget                   *button,
                                                                ThunarPropertiesDialog      *dialog);
 static void     thunar_properties_dialog_update               (ThunarPropertiesDialog      *dialog);
+static void     thunar_properties_dialog_queue_update         (ThunarPropertiesDialog      *dialog);
+static gboolean thunar_properties_dialog_update_idle          (gpointer                     user_data);
+static void     thunar_properties_dialog_aggregate_free       (gpointer                     data);
+static void     thunar_properties_dialog_aggregate_thread     (GTask                       *task,
+                                                               gpointer                     source_object,
+                                                               gpointer                     task_data,
+                                                               GCancellable                *cancellable);
+static void     thunar_properties_dialog_aggregate_finished   (GObject                     *object,
+                                                               GAsyncResult                *result,
+                                                               gpointer                     user_data);
+static void     thunar_properties_dialog_filesystem_changed   (ThunarFilesystemCache       *filesystem_cache,
+                                                               GFile                       *root,
+                                                               ThunarPropertiesDialog      *dialog);
 static void     thunar_properties_dialog_update_providers     (ThunarPropertiesDialog      *dialog);
+static void     thunar_properties_dialog_page_switched        (GtkNotebook                 *notebook,
+                                                               GtkWidget                   *page,
+                                                               guint                        page_num,
+                                                               ThunarPropertiesDialog      *dialog);
+static void     thunar_properties_dialog_page_label_changed   (ThunarxPropertyPage         *page,
+                                                               GParamSpec                  *pspec,
+                                                               ThunarPropertiesDialog      *dialog);
 static GList   *thunar_properties_dialog_get_files            (ThunarPropertiesDialog      *dialog);
 static void     thunar_properties_dialog_reset_highlight      (ThunarPropertiesDialog      *dialog);
 static void     thunar_properties_dialog_apply_highlight      (ThunarPropertiesDialog      *dialog);
@@ -131,6 +152,15 @@ struct _ThunarPropertiesDialogClass
   gboolean (*reload) (ThunarPropertiesDialog *dialog);
 };
 
+typedef struct
+{
+  GList    *files;
+  gchar    *content_type;
+  gboolean  mixed_types;
+  GVolume  *volume;
+  gboolean  mixed_volumes;
+} ThunarPropertiesAggregate;
+
 struct _ThunarPropertiesDialog
 {
   ThunarAbstractDialog    __parent__;
@@ -140,10 +170,20 @@ struct _ThunarPropertiesDialog
 
   ThunarPreferences      *preferences;
 
+  /* capacity and free space of folders */
+  ThunarFilesystemCache  *filesystem_cache;
+
   GList                  *files;
   gboolean                file_size_binary;
   gboolean                show_file_highlight_tab;
 
+  /* coalesces "changed" bursts of the displayed files */
+  guint                   update_idle_id;
+
+  /* content type and volume of a multi-file selection
+   * are collected in a worker, see update_multiple() */
+  GCancellable           *aggregate_cancellable;
+
   XfceFilenameInput      *name_entry;
 
   GtkWidget              *notebook;
@@ -290,6 +330,10 @@ thunar_properties_dialog_init (ThunarPropertiesDialog *dialog)
   g_signal_connect_swapped (G_OBJECT (dialog->preferences), "notify::misc-file-size-binary",
                             G_CALLBACK (thunar_properties_dialog_reload), dialog);
 
+  /* the free space is filled in once it is known */
+  dialog->filesystem_cache = thunar_filesystem_cache_get_default ();
+  g_signal_connect (G_OBJECT (dialog->filesystem_cache), "changed",
+                    G_CALLBACK (thunar_properties_dialog_filesystem_changed), dialog);
 
   dialog->provider_factory = thunarx_provider_factory_get_default ();
 
@@ -326,6 +370,7 @@ thunar_properties_dialog_constructed (GObject *object)
   dialog->notebook = gtk_notebook_new ();
   gtk_container_set_border_width (GTK_CONTAINER (dialog->notebook), 6);
   gtk_box_pack_start (GTK_BOX (gtk_dialog_get_content_area (GTK_DIALOG (dialog))), dialog->notebook, TRUE, TRUE, 0);
+  g_signal_connect (G_OBJECT (dialog->notebook), "switch-page", G_CALLBACK (thunar_properties_dialog_page_switched), dialog);
   gtk_widget_show (dialog->notebook);
 
   grid = gtk_grid_new ();
@@ -943,6 +988,9 @@ thunar_properties_dialog_finalize (GObject *object)
   g_signal_handlers_disconnect_by_func (dialog->preferences, thunar_properties_dialog_reload, dialog);
   g_object_unref (dialog->preferences);
 
+  /* disconnect from the filesystem cache */
+  g_signal_handlers_disconnect_by_func (dialog->filesystem_cache, thunar_properties_dialog_filesystem_changed, dialog);
+  g_object_unref (dialog->filesystem_cache);
 
   /* release the provider property pages */
   g_list_free_full (dialog->provider_pages, g_object_unref);
@@ -1221,6 +1269,7 @@ static void
 thunar_properties_dialog_update_providers (ThunarPropertiesDialog *dialog)
 {
   GtkWidget *label_widget;
+  GtkWidget *page;
   GList     *providers;
   GList     *pages = NULL;
   GList     *tmp;
@@ -1240,9 +1289,10 @@ thunar_properties_dialog_update_providers (ThunarPropertiesDialog *dialog)
       g_list_free (providers);
     }
 
-  /* destroy any previous set pages */
+  /* destroy any previous set pages, which cancels their loading */
   for (lp = dialog->provider_pages; lp != NULL; lp = lp->next)
     {
+      g_signal_handlers_disconnect_by_func (G_OBJECT (lp->data), thunar_properties_dialog_page_label_changed, dialog);
       gtk_widget_destroy (GTK_WIDGET (lp->data));
       g_object_unref (G_OBJECT (lp->data));
     }
@@ -1256,7 +1306,44 @@ thunar_properties_dialog_update_providers (ThunarPropertiesDialog *dialog)
       gtk_notebook_append_page (GTK_NOTEBOOK (dialog->notebook), GTK_WIDGET (lp->data), label_widget);
       g_object_ref (G_OBJECT (lp->data));
       gtk_widget_show (lp->data);
+
+      /* pages may find their real title only when they are loaded */
+      g_signal_connect (G_OBJECT (lp->data), "notify::label-widget", G_CALLBACK (thunar_properties_dialog_page_label_changed), dialog);
     }
+
+  /* the pages are filled when they are opened, or right away if one of them
+   * took the place of the current page */
+  page = gtk_notebook_get_nth_page (GTK_NOTEBOOK (dialog->notebook), gtk_notebook_get_current_page (GTK_NOTEBOOK (dialog->notebook)));
+  if (THUNARX_IS_PROPERTY_PAGE (page))
+    thunarx_property_page_load (THUNARX_PROPERTY_PAGE (page));
+}
+
+
+
+static void
+thunar_properties_dialog_page_switched (GtkNotebook            *notebook,
+                                        GtkWidget              *page,
+                                        guint                   page_num,
+                                        ThunarPropertiesDialog *dialog)
+{
+  _thunar_return_if_fail (THUNAR_IS_PROPERTIES_DIALOG (dialog));
+
+  /* build the page of an extension when the user first opens it */
+  if (THUNARX_IS_PROPERTY_PAGE (page))
+    thunarx_property_page_load (THUNARX_PROPERTY_PAGE (page));
+}
+
+
+
+static void
+thunar_properties_dialog_page_label_changed (ThunarxPropertyPage    *page,
+                                             GParamSpec             *pspec,
+                                             ThunarPropertiesDialog *dialog)
+{
+  _thunar_return_if_fail (THUNAR_IS_PROPERTIES_DIALOG (dialog));
+  _thunar_return_if_fail (THUNARX_IS_PROPERTY_PAGE (page));
+
+  gtk_notebook_set_tab_label (GTK_NOTEBOOK (dialog->notebook), GTK_WIDGET (page), thunarx_property_page_get_label_widget (page));
 }
 
 
@@ -1555,23 +1642,16 @@ thunar_properties_dialog_update_single (ThunarPropertiesDialog *dialog)
 static void
 thunar_properties_dialog_update_multiple (ThunarPropertiesDialog *dialog)
 {
-  ThunarFile  *file;
-  GString     *names_string;
-  gboolean     first_file = TRUE;
-  GList       *lp;
-  const gchar *content_type = NULL;
-  const gchar *tmp;
-  gchar       *str;
-  GVolume     *volume = NULL;
-  GVolume     *tmp_volume;
-  GIcon       *gicon;
-  gchar       *volume_name;
-  gchar       *volume_id;
-  gchar       *volume_label;
-  gchar       *display_name;
-  ThunarFile  *parent_file = NULL;
-  ThunarFile  *tmp_parent;
-  gboolean     has_trashed_files = FALSE;
+  ThunarPropertiesAggregate *aggregate;
+  ThunarFile                *file;
+  GString                   *names_string;
+  gboolean                   first_file = TRUE;
+  GList                     *lp;
+  GTask                     *task;
+  gchar                     *display_name;
+  GFile                     *parent = NULL;
+  GFile                     *tmp_parent;
+  gboolean                   has_trashed_files = FALSE;
 
   _thunar_return_if_fail (THUNAR_IS_PROPERTIES_DIALOG (dialog));
   _thunar_return_if_fail (g_list_length (dialog->files) > 1);
@@ -1592,7 +1672,8 @@ thunar_properties_dialog_update_multiple (ThunarPropertiesDialog *dialog)
 
   names_string = g_string_new (NULL);
 
-  /* collect data of the selected files */
+  /* collect the data that is already known for the selected files, this
+   * must stay cheap since the loop runs over the whole selection */
   for (lp = dialog->files; lp != NULL; lp = lp->next)
     {
       _thunar_assert (THUNAR_IS_FILE (lp->data));
@@ -1603,53 +1684,18 @@ thunar_properties_dialog_update_multiple (ThunarPropertiesDialog *dialog)
         g_string_append (names_string, ", ");
       g_string_append (names_string, thunar_file_get_basename (file));
 
-      /* update the content type */
-      if (first_file)
-        {
-          content_type = thunar_file_get_content_type (file);
-        }
-      else if (content_type != NULL)
-        {
-          /* check the types match */
-          tmp = thunar_file_get_content_type (file);
-          if (tmp == NULL || !g_content_type_equals (content_type, tmp))
-            content_type = NULL;
-        }
-
-      /* check if all selected files are on the same volume */
-      tmp_volume = thunar_file_get_volume (file);
-      if (first_file)
-        {
-          volume = tmp_volume;
-        }
-      else if (tmp_volume != NULL)
-        {
-          /* we only display information if the files are on the same volume */
-          if (tmp_volume != volume)
-            {
-              if (volume != NULL)
-                g_object_unref (G_OBJECT (volume));
-              volume = NULL;
-            }
-
-          g_object_unref (G_OBJECT (tmp_volume));
-        }
-
-      /* check if all files have the same parent */
-      tmp_parent = thunar_file_get_parent (file, NULL);
+      /* check if all files have the same parent, compare the locations
+       * so no parent #ThunarFile has to be looked up for each file */
+      tmp_parent = g_file_get_parent (thunar_file_get_file (file));
       if (first_file)
         {
-          parent_file = tmp_parent;
+          parent = tmp_parent;
         }
       else if (tmp_parent != NULL)
         {
           /* we only display the location if they are all equal */
-          if (!g_file_equal (thunar_file_get_file (parent_file), thunar_file_get_file (tmp_parent)))
-            {
-              if (parent_file != NULL)
-                g_object_unref (G_OBJECT (parent_file));
-              parent_file = NULL;
-            }
+          if (parent != NULL && !g_file_equal (parent, tmp_parent))
+            g_clear_object (&parent);
 
           g_object_unref (G_OBJECT (tmp_parent));
         }
@@ -1668,52 +1714,199 @@ thunar_properties_dialog_update_multiple (ThunarPropertiesDialog *dialog)
   /* hide the permissions chooser for trashed files */
   gtk_widget_set_visible (dialog->permissions_chooser, !has_trashed_files);
 
-  /* update the content type */
-  if (content_type != NULL
-      && !g_content_type_equals (content_type, "inode/symlink"))
+  /* update the file or folder location (parent) */
+  if (G_UNLIKELY (parent != NULL))
     {
-      str = g_content_type_get_description (content_type);
-      gtk_widget_set_tooltip_text (dialog->kind_ebox, content_type);
-      gtk_label_set_text (GTK_LABEL (dialog->kind_label), str);
-      g_free (str);
+      display_name = g_file_get_parse_name (parent);
+      gtk_label_set_text (GTK_LABEL (dialog->location_label), display_name);
+      gtk_widget_show (dialog->location_label);
+      g_object_unref (G_OBJECT (parent));
+      g_free (display_name);
     }
   else
     {
-      gtk_label_set_text (GTK_LABEL (dialog->kind_label), _("mixed"));
+      gtk_widget_hide (dialog->location_label);
     }
 
-  /* update the file or folder location (parent) */
-  if (G_UNLIKELY (parent_file != NULL))
+  /* the content types may have to be sniffed and the volumes need a mount
+   * lookup per file, so collect them in a worker and show a placeholder
+   * until the result is in */
+  if (dialog->aggregate_cancellable != NULL)
     {
-      display_name = g_file_get_parse_name (thunar_file_get_file (parent_file));
-      gtk_label_set_text (GTK_LABEL (dialog->location_label), display_name);
-      gtk_widget_show (dialog->location_label);
-      g_object_unref (G_OBJECT (parent_file));
-      g_free (display_name);
+      g_cancellable_cancel (dialog->aggregate_cancellable);
+      g_object_unref (dialog->aggregate_cancellable);
+    }
+  dialog->aggregate_cancellable = g_cancellable_new ();
+
+  gtk_label_set_text (GTK_LABEL (dialog->kind_label), _("Calculating..."));
+  gtk_widget_set_tooltip_text (dialog->kind_ebox, NULL);
+  gtk_widget_hide (dialog->volume_label);
+
+  aggregate = g_slice_new0 (ThunarPropertiesAggregate);
+  aggregate->files = thunar_g_list_copy_deep (dialog->files);
+
+  task = g_task_new (dialog, dialog->aggregate_cancellable, thunar_properties_dialog_aggregate_finished, NULL);
+  g_task_set_task_data (task, aggregate, thunar_properties_dialog_aggregate_free);
+  g_task_run_in_thread (task, thunar_properties_dialog_aggregate_thread);
+  g_object_unref (task);
+}
+
+
+
+static void
+thunar_properties_dialog_aggregate_free (gpointer data)
+{
+  ThunarPropertiesAggregate *aggregate = data;
+
+  thunar_g_list_free_full (aggregate->files);
+  g_free (aggregate->content_type);
+  if (aggregate->volume != NULL)
+    g_object_unref (aggregate->volume);
+  g_slice_free (ThunarPropertiesAggregate, aggregate);
+}
+
+
+
+static void
+thunar_properties_dialog_aggregate_thread (GTask        *task,
+                                           gpointer      source_object,
+                                           gpointer      task_data,
+                                           GCancellable *cancellable)
+{
+  ThunarPropertiesAggregate *aggregate = task_data;
+  ThunarFile                *file;
+  GVolume                   *volume;
+  GMount                    *mount;
+  gboolean                   first_file = TRUE;
+  GList                     *lp;
+  gchar                     *content_type;
+
+  for (lp = aggregate->files; lp != NULL; lp = lp->next)
+    {
+      /* nothing left to find out once both differ */
+      if (aggregate->mixed_types && aggregate->mixed_volumes)
+        break;
+
+      if (g_cancellable_is_cancelled (cancellable))
+        break;
+
+      file = THUNAR_FILE (lp->data);
+
+      /* update the content type, sniffed types are stored on the file
+       * the same way the content type job of the folders does it */
+      if (!aggregate->mixed_types)
+        {
+          content_type = thunar_file_dup_content_type (file);
+          if (content_type == NULL)
+            {
+              content_type = thunar_g_file_get_content_type (thunar_file_get_file (file));
+              thunar_file_set_content_type (file, content_type);
+            }
+
+          if (first_file)
+            {
+              aggregate->content_type = content_type;
+              content_type = NULL;
+            }
+          else if (content_type == NULL || aggregate->content_type == NULL
+                   || !g_content_type_equals (aggregate->content_type, content_type))
+            {
+              aggregate->mixed_types = TRUE;
+            }
+
+          g_free (content_type);
+        }
+
+      /* check if all selected files are on the same volume */
+      if (!aggregate->mixed_volumes)
+        {
+          volume = NULL;
+          mount = g_file_find_enclosing_mount (thunar_file_get_file (file), cancellable, NULL);
+          if (mount != NULL)
+            {
+              volume = g_mount_get_volume (mount);
+              g_object_unref (mount);
+            }
+
+          if (first_file)
+            {
+              aggregate->volume = volume;
+              aggregate->mixed_volumes = (volume == NULL);
+              volume = NULL;
+            }
+          else if (volume != NULL && volume != aggregate->volume)
+            {
+              /* we only display information if the files are on the same volume */
+              aggregate->mixed_volumes = TRUE;
+            }
+
+          if (volume != NULL)
+            g_object_unref (volume);
+        }
+
+      first_file = FALSE;
+    }
+
+  if (g_task_return_error_if_cancelled (task))
+    return;
+
+  g_task_return_boolean (task, TRUE);
+}
+
+
+
+static void
+thunar_properties_dialog_aggregate_finished (GObject      *object,
+                                             GAsyncResult *result,
+                                             gpointer      user_data)
+{
+  ThunarPropertiesDialog    *dialog = THUNAR_PROPERTIES_DIALOG (object);
+  ThunarPropertiesAggregate *aggregate;
+  GIcon                     *gicon;
+  gchar                     *volume_name;
+  gchar                     *volume_id;
+  gchar                     *volume_label;
+  gchar                     *str;
+
+  _thunar_return_if_fail (THUNAR_IS_PROPERTIES_DIALOG (dialog));
+
+  /* superseded by a newer update or the dialog went away */
+  if (!g_task_propagate_boolean (G_TASK (result), NULL))
+    return;
+
+  aggregate = g_task_get_task_data (G_TASK (result));
+
+  /* update the content type */
+  if (!aggregate->mixed_types
+      && aggregate->content_type != NULL
+      && !g_content_type_equals (aggregate->content_type, "inode/symlink"))
+    {
+      str = g_content_type_get_description (aggregate->content_type);
+      gtk_widget_set_tooltip_text (dialog->kind_ebox, aggregate->content_type);
+      gtk_label_set_text (GTK_LABEL (dialog->kind_label), str);
+      g_free (str);
     }
   else
     {
-      gtk_widget_hide (dialog->location_label);
+      gtk_label_set_text (GTK_LABEL (dialog->kind_label), _("mixed"));
     }
 
   /* update the volume */
-  if (G_LIKELY (volume != NULL))
+  if (G_LIKELY (!aggregate->mixed_volumes && aggregate->volume != NULL))
     {
-      gicon = g_volume_get_icon (volume);
+      gicon = g_volume_get_icon (aggregate->volume);
       gtk_image_set_from_gicon (GTK_IMAGE (dialog->volume_image), gicon, GTK_ICON_SIZE_MENU);
       if (G_LIKELY (gicon != NULL))
         g_object_unref (gicon);
 
-      volume_name = g_volume_get_name (volume);
-      volume_id = g_volume_get_identifier (volume, G_VOLUME_IDENTIFIER_KIND_UNIX_DEVICE);
+      volume_name = g_volume_get_name (aggregate->volume);
+      volume_id = g_volume_get_identifier (aggregate->volume, G_VOLUME_IDENTIFIER_KIND_UNIX_DEVICE);
       volume_label = g_strdup_printf ("%s (%s)", volume_name, volume_id);
       gtk_label_set_text (GTK_LABEL (dialog->volume_label), volume_label);
       gtk_widget_show (dialog->volume_label);
       g_free (volume_name);
       g_free (volume_id);
       g_free (volume_label);
-
-      g_object_unref (G_OBJECT (volume));
     }
   else
     {
@@ -1723,6 +1916,32 @@ thunar_properties_dialog_update_multiple (ThunarPropertiesDialog *dialog)
 
 
 
+static void
+thunar_properties_dialog_filesystem_changed (ThunarFilesystemCache  *filesystem_cache,
+                                             GFile                  *root,
+                                             ThunarPropertiesDialog *dialog)
+{
+  ThunarFile *file;
+  GFile      *location;
+
+  _thunar_return_if_fail (THUNAR_IS_FILESYSTEM_CACHE (filesystem_cache));
+  _thunar_return_if_fail (THUNAR_IS_PROPERTIES_DIALOG (dialog));
+
+  /* only a single folder shows the free space */
+  if (dialog->files == NULL || dialog->files->next != NULL)
+    return;
+
+  file = THUNAR_FILE (dialog->files->data);
+  if (!thunar_file_is_directory (file))
+    return;
+
+  location = thunar_file_get_file (file);
+  if (g_file_equal (location, root) || g_file_has_prefix (location, root))
+    thunar_properties_dialog_update (dialog);
+}
+
+
+
 static void
 thunar_properties_dialog_update (ThunarPropertiesDialog *dialog)
 {
@@ -1760,6 +1979,34 @@ thunar_properties_dialog_update (ThunarPropertiesDialog *dialog)
 
 
 
+static void
+thunar_properties_dialog_queue_update (ThunarPropertiesDialog *dialog)
+{
+  _thunar_return_if_fail (THUNAR_IS_PROPERTIES_DIALOG (dialog));
+
+  /* a copy or a chmod on a large selection emits "changed" for every
+   * file, update the dialog only once for the whole burst */
+  if (dialog->update_idle_id == 0)
+    dialog->update_idle_id = g_idle_add (thunar_properties_dialog_update_idle, dialog);
+}
+
+
+
+static gboolean
+thunar_properties_dialog_update_idle (gpointer user_data)
+{
+  ThunarPropertiesDialog *dialog = THUNAR_PROPERTIES_DIALOG (user_data);
+
+  dialog->update_idle_id = 0;
+
+  if (dialog->files != NULL)
+    thunar_properties_dialog_update (dialog);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
 /**
  * thunar_properties_dialog_new:
  * @parent: transient window or NULL;
@@ -1836,13 +2083,26 @@ thunar_properties_dialog_set_files (ThunarPropertiesDialog *dialog,
       thunar_file_unwatch (file);
 
       /* unregister handlers */
-      g_signal_handlers_disconnect_by_func (G_OBJECT (file), thunar_properties_dialog_update, dialog);
+      g_signal_handlers_disconnect_by_func (G_OBJECT (file), thunar_properties_dialog_queue_update, dialog);
       g_signal_handlers_disconnect_by_func (G_OBJECT (file), gtk_widget_destroy, dialog);
 
       g_object_unref (G_OBJECT (file));
     }
   g_list_free (dialog->files);
 
+  /* drop pending work for the previous files */
+  if (dialog->update_idle_id != 0)
+    {
+      g_source_remove (dialog->update_idle_id);
+      dialog->update_idle_id = 0;
+    }
+
+  if (dialog->aggregate_cancellable != NULL)
+    {
+      g_cancellable_cancel (dialog->aggregate_cancellable);
+      g_clear_object (&dialog->aggregate_cancellable);
+    }
+
   /* activate the new list */
   dialog->files = g_list_copy (files);
 
@@ -1856,7 +2116,7 @@ thunar_properties_dialog_set_files (ThunarPropertiesDialog *dialog,
       thunar_file_watch (file);
 
       /* install signal handlers */
-      g_signal_connect_swapped (G_OBJECT (file), "changed", G_CALLBACK (thunar_properties_dialog_update), dialog);
+      g_signal_connect_swapped (G_OBJECT (file), "changed", G_CALLBACK (thunar_properties_dialog_queue_update), dialog);
       g_signal_connect_swapped (G_OBJECT (file), "destroy", G_CALLBACK (gtk_widget_destroy), dialog);
     }
 
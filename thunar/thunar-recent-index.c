@@ -0,0 +1,312 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The recent index keeps the entries of recently-used.xbel, so listing
+ * `recent:///` needs neither the recent backend of GVfs nor a separate
+ * lookup of the target of every entry. The file is parsed again only
+ * when its modification time or size changed, and the entries of the
+ * previous parse are kept for the locations still listed. The targets
+ * are queried by a pool of threads. The index may be used from any
+ * thread. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <glib/gstdio.h>
+
+#include "thunar/thunar-private.h"
+#include "thunar/thunar-recent-index.h"
+
+
+
+/* the number of threads querying the targets of the entries at once */
+#define THUNAR_RECENT_INDEX_QUERY_THREADS (8)
+
+
+
+typedef struct
+{
+  GFile  *file;
+  gint64  modified; /* of the entry, in seconds since the epoch */
+}
+ThunarRecentIndexEntry;
+
+typedef struct
+{
+  const gchar         *attributes;
+  GFileQueryInfoFlags  flags;
+  GCancellable        *cancellable;
+}
+ThunarRecentIndexQuery;
+
+
+
+static GMutex      recent_mutex;
+
+/* the sorted ThunarRecentIndexEntries of the last parse, the most recent one first */
+static GPtrArray  *recent_entries = NULL;
+
+/* the state of recently-used.xbel at the last parse */
+static guint64     recent_mtime = 0;
+static goffset     recent_size = -1;
+
+
+
+static void
+thunar_recent_index_entry_free (gpointer data)
+{
+  ThunarRecentIndexEntry *entry = data;
+
+  g_object_unref (entry->file);
+  g_slice_free (ThunarRecentIndexEntry, entry);
+}
+
+
+
+static gint
+thunar_recent_index_entry_compare (gconstpointer a,
+                                   gconstpointer b)
+{
+  const ThunarRecentIndexEntry *entry_a = *(ThunarRecentIndexEntry *const *) a;
+  const ThunarRecentIndexEntry *entry_b = *(ThunarRecentIndexEntry *const *) b;
+
+  if (entry_a->modified != entry_b->modified)
+    return (entry_a->modified > entry_b->modified) ? -1 : 1;
+  return 0;
+}
+
+
+
+static GPtrArray *
+thunar_recent_index_parse (const gchar *path)
+{
+  ThunarRecentIndexEntry *entry;
+  GBookmarkFile          *bookmarks;
+  GHashTable             *previous;
+  GPtrArray              *entries;
+  GDateTime              *modified;
+  gchar                 **uris;
+  GFile                  *file;
+  gsize                   n_uris = 0;
+  gsize                   n;
+
+  entries = g_ptr_array_new_with_free_func (thunar_recent_index_entry_free);
+
+  bookmarks = g_bookmark_file_new ();
+  if (!g_bookmark_file_load_from_file (bookmarks, path, NULL))
+    {
+      g_bookmark_file_free (bookmarks);
+      return entries;
+    }
+
+  /* keep the GFiles of the entries still listed */
+  previous = g_hash_table_new (g_file_hash, (GEqualFunc) g_file_equal);
+  if (recent_entries != NULL)
+    for (n = 0; n < recent_entries->len; ++n)
+      {
+        entry = g_ptr_array_index (recent_entries, n);
+        g_hash_table_insert (previous, entry->file, entry);
+      }
+
+  uris = g_bookmark_file_get_uris (bookmarks, &n_uris);
+  for (n = 0; n < n_uris; ++n)
+    {
+      /* like the recent backend of GVfs, only local files are listed */
+      file = g_file_new_for_uri (uris[n]);
+      if (!g_file_is_native (file))
+        {
+          g_object_unref (file);
+          continue;
+        }
+
+      entry = g_hash_table_lookup (previous, file);
+      if (entry != NULL)
+        {
+          g_object_unref (file);
+          file = g_object_ref (entry->file);
+        }
+
+      entry = g_slice_new (ThunarRecentIndexEntry);
+      entry->file = file;
+      modified = g_bookmark_file_get_modified_date_time (bookmarks, uris[n], NULL);
+      entry->modified = (modified != NULL) ? g_date_time_to_unix (modified) : 0;
+      g_ptr_array_add (entries, entry);
+    }
+
+  g_ptr_array_sort (entries, thunar_recent_index_entry_compare);
+
+  g_hash_table_destroy (previous);
+  g_strfreev (uris);
+  g_bookmark_file_free (bookmarks);
+
+  return entries;
+}
+
+
+
+/* returns the entries of the index, parsed again if the file changed */
+static GPtrArray *
+thunar_recent_index_get_entries (void)
+{
+  GPtrArray *entries;
+  GStatBuf   statb;
+  guint64    mtime = 0;
+  goffset    size = -1;
+  gchar     *path;
+
+  path = g_build_filename (g_get_user_data_dir (), "recently-used.xbel", NULL);
+  if (g_stat (path, &statb) == 0)
+    {
+      mtime = statb.st_mtime;
+      size = statb.st_size;
+    }
+
+  g_mutex_lock (&recent_mutex);
+
+  if (recent_entries == NULL || recent_mtime != mtime || recent_size != size)
+    {
+      entries = (size >= 0) ? thunar_recent_index_parse (path) : g_ptr_array_new_with_free_func (thunar_recent_index_entry_free);
+      if (recent_entries != NULL)
+        g_ptr_array_unref (recent_entries);
+      recent_entries = entries;
+      recent_mtime = mtime;
+      recent_size = size;
+    }
+
+  entries = g_ptr_array_ref (recent_entries);
+
+  g_mutex_unlock (&recent_mutex);
+
+  g_free (path);
+
+  return entries;
+}
+
+
+
+static void
+thunar_recent_index_query_worker (gpointer data,
+                                  gpointer user_data)
+{
+  ThunarRecentIndexItem  *item = data;
+  ThunarRecentIndexQuery *query = user_data;
+
+  if (!g_cancellable_is_cancelled (query->cancellable))
+    item->info = g_file_query_info (item->file, query->attributes, query->flags, query->cancellable, NULL);
+}
+
+
+
+/**
+ * thunar_recent_index_get_items:
+ * @attributes  : the attributes to query for the targets of the entries.
+ * @flags       : the #GFileQueryInfoFlags for the query.
+ * @cancellable : a #GCancellable or %NULL.
+ *
+ * Returns the files listed in `recent:///`, the most recently used one
+ * first. The targets of the entries are queried in parallel, the ones
+ * that don't exist anymore are left out. Blocks until all the targets
+ * were queried, so it is to be called from a job.
+ *
+ * The caller is responsible to free the returned list using
+ * thunar_recent_index_items_free() when no longer needed.
+ *
+ * Return value: (transfer full) (element-type ThunarRecentIndexItem): the list of items.
+ **/
+GList *
+thunar_recent_index_get_items (const gchar         *attributes,
+                               GFileQueryInfoFlags  flags,
+                               GCancellable        *cancellable)
+{
+  ThunarRecentIndexQuery  query;
+  ThunarRecentIndexEntry *entry;
+  ThunarRecentIndexItem  *items;
+  GThreadPool            *pool;
+  GPtrArray              *entries;
+  GList                  *list = NULL;
+  guint                   n;
+
+  _thunar_return_val_if_fail (attributes != NULL, NULL);
+  _thunar_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
+
+  entries = thunar_recent_index_get_entries ();
+  if (entries->len == 0)
+    {
+      g_ptr_array_unref (entries);
+      return NULL;
+    }
+
+  items = g_new0 (ThunarRecentIndexItem, entries->len);
+  for (n = 0; n < entries->len; ++n)
+    items[n].file = ((ThunarRecentIndexEntry *) g_ptr_array_index (entries, n))->file;
+
+  /* one stat after the other is slow for long histories, on a slow disk above all */
+  query.attributes = attributes;
+  query.flags = flags;
+  query.cancellable = cancellable;
+  pool = g_thread_pool_new (thunar_recent_index_query_worker, &query,
+                            MIN (entries->len, THUNAR_RECENT_INDEX_QUERY_THREADS), FALSE, NULL);
+  for (n = 0; n < entries->len; ++n)
+    g_thread_pool_push (pool, &items[n], NULL);
+  g_thread_pool_free (pool, FALSE, TRUE);
+
+  for (n = entries->len; n > 0; --n)
+    {
+      if (items[n - 1].info == NULL)
+        continue;
+
+      entry = g_ptr_array_index (entries, n - 1);
+
+      items[n - 1].file = g_object_ref (entry->file);
+      items[n - 1].recent_info = g_file_info_new ();
+      g_file_info_set_attribute_int64 (items[n - 1].recent_info, G_FILE_ATTRIBUTE_RECENT_MODIFIED, entry->modified);
+
+      list = g_list_prepend (list, g_slice_dup (ThunarRecentIndexItem, &items[n - 1]));
+    }
+
+  g_free (items);
+  g_ptr_array_unref (entries);
+
+  return list;
+}
+
+
+
+static void
+thunar_recent_index_item_free (gpointer data)
+{
+  ThunarRecentIndexItem *item = data;
+
+  g_object_unref (item->file);
+  g_object_unref (item->info);
+  g_object_unref (item->recent_info);
+  g_slice_free (ThunarRecentIndexItem, item);
+}
+
+
+
+/**
+ * thunar_recent_index_items_free:
+ * @items : a list returned by thunar_recent_index_get_items().
+ *
+ * Frees the @items and the list.
+ **/
+void
+thunar_recent_index_items_free (GList *items)
+{
+  g_list_free_full (items, thunar_recent_index_item_free);
+}
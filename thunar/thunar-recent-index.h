@@ -0,0 +1,39 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __THUNAR_RECENT_INDEX_H__
+#define __THUNAR_RECENT_INDEX_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct
+{
+  GFile     *file;        /* the target of the entry */
+  GFileInfo *info;        /* of the target, with the queried attributes */
+  GFileInfo *recent_info; /* the recent:: attributes of the entry */
+}
+ThunarRecentIndexItem;
+
+GList *thunar_recent_index_get_items  (const gchar         *attributes,
+                                       GFileQueryInfoFlags  flags,
+                                       GCancellable        *cancellable) G_GNUC_MALLOC;
+void   thunar_recent_index_items_free (GList               *items);
+
+G_END_DECLS
+
+#endif /* !__THUNAR_RECENT_INDEX_H__ */
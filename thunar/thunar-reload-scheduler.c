@@ -0,0 +1,238 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The reload scheduler collects the files to reload when idle, see
+ * thunar_file_reload_idle(). A file queued several times is reloaded
+ * once, and the file information of all files queued until the next
+ * idle run is queried in a single worker thread, ordered by uri so
+ * the files of one directory are queried one after the other. The
+ * results are applied in the main thread in one go, which emits
+ * "changed" (or "destroy") for each file. Files queued while a batch
+ * is being queried wait for the next batch. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include "thunar/thunar-mount-health.h"
+#include "thunar/thunar-private.h"
+#include "thunar/thunar-reload-scheduler.h"
+
+
+
+typedef struct
+{
+  ThunarFile *file;
+  GFile      *gfile;  /* location of the file when the batch was started */
+  gchar      *uri;
+  GFileInfo  *info;
+  GError     *error;
+}
+ThunarReloadRequest;
+
+static void thunar_reload_scheduler_schedule (void);
+
+
+
+/* ThunarFile (with reference) -> NULL, the files waiting for the next batch */
+static GHashTable *pending_files = NULL;
+
+/* idle source starting the next batch and whether a batch is running */
+static guint       dispatch_idle_id = 0;
+static gboolean    batch_running = FALSE;
+
+
+
+static void
+thunar_reload_scheduler_request_free (gpointer data)
+{
+  ThunarReloadRequest *request = data;
+
+  if (request->info != NULL)
+    g_object_unref (request->info);
+  if (request->error != NULL)
+    g_error_free (request->error);
+  g_object_unref (request->gfile);
+  g_object_unref (request->file);
+  g_free (request->uri);
+  g_slice_free (ThunarReloadRequest, request);
+}
+
+
+
+static gint
+thunar_reload_scheduler_request_compare (gconstpointer a,
+                                         gconstpointer b)
+{
+  const ThunarReloadRequest *request_a = *(const ThunarReloadRequest **) a;
+  const ThunarReloadRequest *request_b = *(const ThunarReloadRequest **) b;
+
+  return strcmp (request_a->uri, request_b->uri);
+}
+
+
+
+static void
+thunar_reload_scheduler_thread (GTask        *task,
+                                gpointer      source_object,
+                                gpointer      task_data,
+                                GCancellable *cancellable)
+{
+  GPtrArray           *requests = task_data;
+  ThunarReloadRequest *request;
+  guint                n;
+
+  /* siblings next to each other, so remote backends and the
+   * kernel's dentry cache see one directory at a time */
+  for (n = 0; n < requests->len; n++)
+    {
+      request = g_ptr_array_index (requests, n);
+      request->uri = g_file_get_uri (request->gfile);
+    }
+  g_ptr_array_sort (requests, thunar_reload_scheduler_request_compare);
+
+  for (n = 0; n < requests->len; n++)
+    {
+      request = g_ptr_array_index (requests, n);
+
+      /* the files of an unreachable mount would block the whole batch */
+      if (thunar_mount_health_set_error_if_unreachable (request->gfile, &request->error))
+        continue;
+
+      request->info = g_file_query_info (request->gfile,
+                                         THUNAR_FILE_INFO_NAMESPACE,
+                                         G_FILE_QUERY_INFO_NONE,
+                                         cancellable, &request->error);
+      if (request->info == NULL)
+        thunar_mount_health_report_error (request->gfile, request->error);
+    }
+
+  g_task_return_boolean (task, TRUE);
+}
+
+
+
+static void
+thunar_reload_scheduler_finished (GObject      *source_object,
+                                  GAsyncResult *result,
+                                  gpointer      user_data)
+{
+  GPtrArray           *requests = g_task_get_task_data (G_TASK (result));
+  ThunarReloadRequest *request;
+  guint                n;
+
+  batch_running = FALSE;
+
+  for (n = 0; n < requests->len; n++)
+    {
+      request = g_ptr_array_index (requests, n);
+
+      /* renamed while the batch was running, the information
+       * belongs to the old location */
+      if (!g_file_equal (request->gfile, thunar_file_get_file (request->file)))
+        {
+          thunar_reload_scheduler_queue (request->file);
+          continue;
+        }
+
+      /* both are taken over by the file */
+      thunar_file_reload_with_info (request->file, request->info, request->error);
+      request->info = NULL;
+      request->error = NULL;
+    }
+
+  /* start the batch of the files queued while this one was running */
+  if (g_hash_table_size (pending_files) > 0)
+    thunar_reload_scheduler_schedule ();
+}
+
+
+
+static gboolean
+thunar_reload_scheduler_dispatch (gpointer user_data)
+{
+  ThunarReloadRequest *request;
+  GHashTableIter       iter;
+  GPtrArray           *requests;
+  gpointer             file;
+  GTask               *task;
+
+  dispatch_idle_id = 0;
+
+  /* the running batch restarts the scheduling when it is done */
+  if (batch_running)
+    return G_SOURCE_REMOVE;
+
+  requests = g_ptr_array_new_full (g_hash_table_size (pending_files), thunar_reload_scheduler_request_free);
+
+  /* take over the references of the pending files */
+  g_hash_table_iter_init (&iter, pending_files);
+  while (g_hash_table_iter_next (&iter, &file, NULL))
+    {
+      request = g_slice_new0 (ThunarReloadRequest);
+      request->file = file;
+      request->gfile = g_object_ref (thunar_file_get_file (file));
+      g_ptr_array_add (requests, request);
+      g_hash_table_iter_steal (&iter);
+    }
+
+  batch_running = TRUE;
+
+  task = g_task_new (NULL, NULL, thunar_reload_scheduler_finished, NULL);
+  g_task_set_task_data (task, requests, (GDestroyNotify) g_ptr_array_unref);
+  g_task_run_in_thread (task, thunar_reload_scheduler_thread);
+  g_object_unref (task);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+static void
+thunar_reload_scheduler_schedule (void)
+{
+  if (dispatch_idle_id == 0 && !batch_running)
+    dispatch_idle_id = g_idle_add (thunar_reload_scheduler_dispatch, NULL);
+}
+
+
+
+/**
+ * thunar_reload_scheduler_queue:
+ * @file : a #ThunarFile.
+ *
+ * Reloads @file when idle, together with all other files queued
+ * until then. Queuing a file which already waits for its reload
+ * does nothing. A reference on @file is held until it is reloaded.
+ **/
+void
+thunar_reload_scheduler_queue (ThunarFile *file)
+{
+  _thunar_return_if_fail (THUNAR_IS_FILE (file));
+
+  if (G_UNLIKELY (pending_files == NULL))
+    pending_files = g_hash_table_new_full (g_direct_hash, g_direct_equal, g_object_unref, NULL);
+
+  if (g_hash_table_contains (pending_files, file))
+    return;
+
+  g_hash_table_add (pending_files, g_object_ref (file));
+  thunar_reload_scheduler_schedule ();
+}
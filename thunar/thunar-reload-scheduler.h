@@ -0,0 +1,28 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __THUNAR_RELOAD_SCHEDULER_H__
+#define __THUNAR_RELOAD_SCHEDULER_H__
+
+#include "thunar/thunar-file.h"
+
+G_BEGIN_DECLS
+
+void thunar_reload_scheduler_queue (ThunarFile *file);
+
+G_END_DECLS
+
+#endif /* !__THUNAR_RELOAD_SCHEDULER_H__ */
@@ -136,6 +136,7 @@ static void        thunar_renamer_dialog_row_activated         (GtkTreeView
                                                                 ThunarRenamerDialog      *renamer_dialog);
 static void        thunar_renamer_dialog_selection_changed     (GtkTreeSelection         *selection,
                                                                 ThunarRenamerDialog      *renamer_dialog);
+static void        thunar_renamer_dialog_update_visible_range  (ThunarRenamerDialog      *renamer_dialog);
 static ThunarFile *thunar_renamer_dialog_get_current_directory (ThunarRenamerDialog      *renamer_dialog);
 static void        thunar_renamer_dialog_set_current_directory (ThunarRenamerDialog      *renamer_dialog,
                                                                 ThunarFile               *current_directory);
@@ -436,6 +437,12 @@ thunar_renamer_dialog_init (ThunarRenamerDialog *renamer_dialog)
   gtk_container_add (GTK_CONTAINER (swin), renamer_dialog->tree_view);
   gtk_widget_show (renamer_dialog->tree_view);
 
+  /* let the model update the visible rows first */
+  g_signal_connect_object (G_OBJECT (gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (renamer_dialog->tree_view))), "value-changed",
+                           G_CALLBACK (thunar_renamer_dialog_update_visible_range), renamer_dialog, G_CONNECT_SWAPPED);
+  g_signal_connect_object (G_OBJECT (gtk_scrollable_get_vadjustment (GTK_SCROLLABLE (renamer_dialog->tree_view))), "changed",
+                           G_CALLBACK (thunar_renamer_dialog_update_visible_range), renamer_dialog, G_CONNECT_SWAPPED);
+
   /* create the tree view column for the old file name */
   renamer_dialog->name_column = column = gtk_tree_view_column_new ();
   gtk_tree_view_column_set_spacing (column, 2);
@@ -1685,6 +1692,30 @@ thunar_renamer_dialog_selection_changed (GtkTreeSelection    *selection,
 
 
 
+static void
+thunar_renamer_dialog_update_visible_range (ThunarRenamerDialog *renamer_dialog)
+{
+  GtkTreePath *start_path;
+  GtkTreePath *end_path;
+
+  _thunar_return_if_fail (THUNAR_IS_RENAMER_DIALOG (renamer_dialog));
+
+  if (gtk_tree_view_get_visible_range (GTK_TREE_VIEW (renamer_dialog->tree_view), &start_path, &end_path))
+    {
+      thunar_renamer_model_set_visible_range (renamer_dialog->model,
+                                              gtk_tree_path_get_indices (start_path)[0],
+                                              gtk_tree_path_get_indices (end_path)[0]);
+      gtk_tree_path_free (start_path);
+      gtk_tree_path_free (end_path);
+    }
+  else
+    {
+      thunar_renamer_model_set_visible_range (renamer_dialog->model, -1, -1);
+    }
+}
+
+
+
 /**
  * thunar_renamer_dialog_get_current_directory:
  * @renamer_dialog : a #ThunarRenamerDialog.
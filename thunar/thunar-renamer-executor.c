@@ -0,0 +1,681 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* ThunarRenamerExecutor renames a list of #ThunarRenamerPair<!---->s.
+ *
+ * A pair can only be renamed after the pair whose file currently uses the
+ * new name was renamed itself. Since all new names are distinct, every pair
+ * waits for at most one other pair, so the pairs form chains and cycles,
+ * like A->B, B->C or A->B, B->A. Each cycle is broken by renaming one of
+ * its files to a temporary name first. All pairs that are not waiting for
+ * another one are renamed asynchronously, at most
+ * THUNAR_RENAMER_EXECUTOR_MAX_RUNNING at a time, which hides the latency
+ * of remote file systems. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <libxfce4util/libxfce4util.h>
+
+#include "thunar/thunar-job-operation-history.h"
+#include "thunar/thunar-private.h"
+#include "thunar/thunar-renamer-executor.h"
+
+
+
+/* the maximum number of renames running at the same time */
+#define THUNAR_RENAMER_EXECUTOR_MAX_RUNNING (16)
+
+
+
+/* Signal identifiers */
+enum
+{
+  FAILED,
+  FINISHED,
+  PROGRESS,
+  LAST_SIGNAL,
+};
+
+
+
+typedef struct _ThunarRenamerTask ThunarRenamerTask;
+
+
+
+static void     thunar_renamer_executor_finalize        (GObject               *object);
+static void     thunar_renamer_executor_task_free       (gpointer               data);
+static void     thunar_renamer_executor_plan            (ThunarRenamerExecutor *executor);
+static void     thunar_renamer_executor_dispatch        (ThunarRenamerExecutor *executor);
+static void     thunar_renamer_executor_release_waiting (ThunarRenamerExecutor *executor,
+                                                         ThunarRenamerTask     *task);
+static void     thunar_renamer_executor_rename_ready    (GObject               *source_object,
+                                                         GAsyncResult          *result,
+                                                         gpointer               user_data);
+
+
+
+struct _ThunarRenamerExecutorClass
+{
+  GObjectClass __parent__;
+};
+
+struct _ThunarRenamerExecutor
+{
+  GObject       __parent__;
+
+  /* all tasks, in the order of the pairs */
+  GPtrArray    *tasks;
+
+  /* tasks which can be renamed right now */
+  GQueue        ready;
+
+  /* failed tasks which were not reported yet */
+  GQueue        failures;
+  gboolean      reporting;
+
+  GCancellable *cancellable;
+  guint         n_running;
+  guint         n_processed;
+  guint         n_renamed;
+
+  gboolean      started;
+  gboolean      cancelled;
+  gboolean      finished;
+};
+
+struct _ThunarRenamerTask
+{
+  ThunarRenamerExecutor *executor;
+
+  ThunarFile            *file;
+  gchar                 *name;         /* the new name of the file */
+  gchar                 *temp_name;    /* a temporary name, if the task breaks a cycle */
+
+  GFile                 *old_location;
+  GFile                 *location;     /* the current location of the file */
+  GError                *error;
+
+  ThunarRenamerTask     *blocker;      /* the task whose file uses the new name, while planning */
+  ThunarRenamerTask     *waiting;      /* the task waiting for this one to free its name */
+  guint                  mark;         /* for detecting cycles while planning */
+
+  guint                  blocked : 1;  /* the new name is still in use */
+  guint                  moved : 1;    /* the file was moved away from its old name */
+  guint                  at_temp : 1;  /* the file uses its temporary name */
+  guint                  renamed : 1;  /* the file uses its new name */
+};
+
+
+
+static guint executor_signals[LAST_SIGNAL];
+
+
+
+G_DEFINE_TYPE (ThunarRenamerExecutor, thunar_renamer_executor, G_TYPE_OBJECT)
+
+
+
+static void
+thunar_renamer_executor_class_init (ThunarRenamerExecutorClass *klass)
+{
+  GObjectClass *gobject_class;
+
+  gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->finalize = thunar_renamer_executor_finalize;
+
+  /**
+   * ThunarRenamerExecutor::failed:
+   * @executor : a #ThunarRenamerExecutor.
+   * @file     : the #ThunarFile which could not be renamed.
+   * @name     : the new name of @file.
+   * @error    : a #GError describing the failure.
+   *
+   * Emitted when a file could not be renamed. No further renames are
+   * started while the handlers run, so they can safely ask the user
+   * and cancel the @executor.
+   **/
+  executor_signals[FAILED] =
+    g_signal_new (I_("failed"),
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL,
+                  NULL,
+                  G_TYPE_NONE, 3,
+                  THUNAR_TYPE_FILE, G_TYPE_STRING, G_TYPE_POINTER);
+
+  /**
+   * ThunarRenamerExecutor::finished:
+   * @executor : a #ThunarRenamerExecutor.
+   *
+   * Emitted once all renames are done, or after the @executor
+   * was cancelled and the running renames returned.
+   **/
+  executor_signals[FINISHED] =
+    g_signal_new (I_("finished"),
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL,
+                  g_cclosure_marshal_VOID__VOID,
+                  G_TYPE_NONE, 0);
+
+  /**
+   * ThunarRenamerExecutor::progress:
+   * @executor : a #ThunarRenamerExecutor.
+   *
+   * Emitted whenever another file was processed.
+   **/
+  executor_signals[PROGRESS] =
+    g_signal_new (I_("progress"),
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL,
+                  g_cclosure_marshal_VOID__VOID,
+                  G_TYPE_NONE, 0);
+}
+
+
+
+static void
+thunar_renamer_executor_init (ThunarRenamerExecutor *executor)
+{
+  executor->tasks = g_ptr_array_new_with_free_func (thunar_renamer_executor_task_free);
+  executor->cancellable = g_cancellable_new ();
+  g_queue_init (&executor->ready);
+  g_queue_init (&executor->failures);
+}
+
+
+
+static void
+thunar_renamer_executor_finalize (GObject *object)
+{
+  ThunarRenamerExecutor *executor = THUNAR_RENAMER_EXECUTOR (object);
+
+  /* running renames hold a reference */
+  _thunar_assert (executor->n_running == 0);
+
+  g_queue_clear (&executor->ready);
+  g_queue_clear (&executor->failures);
+  g_ptr_array_unref (executor->tasks);
+  g_object_unref (executor->cancellable);
+
+  (*G_OBJECT_CLASS (thunar_renamer_executor_parent_class)->finalize) (object);
+}
+
+
+
+static void
+thunar_renamer_executor_task_free (gpointer data)
+{
+  ThunarRenamerTask *task = data;
+
+  g_object_unref (task->file);
+  g_object_unref (task->old_location);
+  g_object_unref (task->location);
+  g_free (task->name);
+  g_free (task->temp_name);
+  if (task->error != NULL)
+    g_error_free (task->error);
+  g_slice_free (ThunarRenamerTask, task);
+}
+
+
+
+static gchar *
+thunar_renamer_executor_make_key (GFile       *location,
+                                  const gchar *name)
+{
+  GFile *parent;
+  gchar *uri = NULL;
+  gchar *key;
+
+  /* files can only block each other in the same directory */
+  parent = g_file_get_parent (location);
+  if (G_LIKELY (parent != NULL))
+    {
+      uri = g_file_get_uri (parent);
+      g_object_unref (parent);
+    }
+
+  key = g_strconcat (uri != NULL ? uri : "", "/", name, NULL);
+  g_free (uri);
+
+  return key;
+}
+
+
+
+static void
+thunar_renamer_executor_plan (ThunarRenamerExecutor *executor)
+{
+  ThunarRenamerTask *task;
+  ThunarRenamerTask *tp;
+  GHashTable        *sources;
+  gchar             *key;
+  guint              n;
+
+  /* index the tasks by the current path of their file */
+  sources = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  for (n = 0; n < executor->tasks->len; n++)
+    {
+      task = g_ptr_array_index (executor->tasks, n);
+      g_hash_table_insert (sources, thunar_renamer_executor_make_key (task->location, thunar_file_get_basename (task->file)), task);
+    }
+
+  /* each task waits for the task whose file uses its new name */
+  for (n = 0; n < executor->tasks->len; n++)
+    {
+      task = g_ptr_array_index (executor->tasks, n);
+      key = thunar_renamer_executor_make_key (task->location, task->name);
+      tp = g_hash_table_lookup (sources, key);
+      g_free (key);
+
+      /* a second task for the same name is not ordered, it will fail with an error */
+      if (tp != NULL && tp != task && tp->waiting == NULL)
+        {
+          task->blocker = tp;
+          task->blocked = TRUE;
+          tp->waiting = task;
+        }
+    }
+  g_hash_table_destroy (sources);
+
+  /* follow the blockers from each task, marking the tasks of this walk with
+   * n + 1. Reaching a task marked in the same walk closes a cycle */
+  for (n = 0; n < executor->tasks->len; n++)
+    {
+      for (tp = g_ptr_array_index (executor->tasks, n); tp != NULL && tp->mark == 0; tp = tp->blocker)
+        tp->mark = n + 1;
+
+      if (tp != NULL && tp->mark == n + 1)
+        {
+          /* break the cycle by moving the file of this task out of the way first */
+          tp->temp_name = g_strdup_printf (".%s.%08x.tmp", thunar_file_get_basename (tp->file), g_random_int ());
+        }
+    }
+
+  /* queue everything that can be renamed right away */
+  for (n = 0; n < executor->tasks->len; n++)
+    {
+      task = g_ptr_array_index (executor->tasks, n);
+      task->blocker = NULL;
+      if (!task->blocked || task->temp_name != NULL)
+        g_queue_push_tail (&executor->ready, task);
+    }
+}
+
+
+
+static void
+thunar_renamer_executor_check_finished (ThunarRenamerExecutor *executor)
+{
+  if (executor->finished || executor->reporting || executor->n_running > 0)
+    return;
+
+  if (!executor->cancelled && !g_queue_is_empty (&executor->ready))
+    return;
+
+  executor->finished = TRUE;
+  g_signal_emit (executor, executor_signals[FINISHED], 0);
+
+  /* release the reference taken in thunar_renamer_executor_start() */
+  g_object_unref (executor);
+}
+
+
+
+static void
+thunar_renamer_executor_dispatch (ThunarRenamerExecutor *executor)
+{
+  ThunarRenamerTask *task;
+  const gchar       *name;
+
+  while (!executor->cancelled && !executor->reporting
+         && executor->n_running < THUNAR_RENAMER_EXECUTOR_MAX_RUNNING)
+    {
+      task = g_queue_pop_head (&executor->ready);
+      if (task == NULL)
+        break;
+
+      /* a task breaking a cycle first moves to its temporary name */
+      if (task->temp_name != NULL && !task->at_temp)
+        name = task->temp_name;
+      else
+        name = task->name;
+
+      executor->n_running++;
+      g_object_ref (executor);
+      g_file_set_display_name_async (task->location, name, G_PRIORITY_DEFAULT, executor->cancellable,
+                                     thunar_renamer_executor_rename_ready, task);
+    }
+
+  thunar_renamer_executor_check_finished (executor);
+}
+
+
+
+static void
+thunar_renamer_executor_release_waiting (ThunarRenamerExecutor *executor,
+                                         ThunarRenamerTask     *task)
+{
+  ThunarRenamerTask *waiting = task->waiting;
+
+  if (waiting == NULL)
+    return;
+
+  task->waiting = NULL;
+  waiting->blocked = FALSE;
+
+  /* a task breaking a cycle was queued for its temporary name already,
+   * it is queued again once that finished */
+  if (waiting->temp_name == NULL || waiting->at_temp)
+    g_queue_push_tail (&executor->ready, waiting);
+}
+
+
+
+static void
+thunar_renamer_executor_report (ThunarRenamerExecutor *executor)
+{
+  ThunarRenamerTask *task;
+
+  /* the handlers may run a nested main loop, failures of the running
+   * renames are queued and reported afterwards */
+  if (executor->reporting)
+    return;
+
+  executor->reporting = TRUE;
+  while (!executor->cancelled && (task = g_queue_pop_head (&executor->failures)) != NULL)
+    g_signal_emit (executor, executor_signals[FAILED], 0, task->file, task->name, task->error);
+  executor->reporting = FALSE;
+}
+
+
+
+static void
+thunar_renamer_executor_rename_ready (GObject      *source_object,
+                                      GAsyncResult *result,
+                                      gpointer      user_data)
+{
+  ThunarRenamerTask     *task = user_data;
+  ThunarRenamerExecutor *executor = task->executor;
+  GFile                 *renamed_file;
+
+  renamed_file = g_file_set_display_name_finish (G_FILE (source_object), result, &task->error);
+  executor->n_running--;
+
+  if (renamed_file != NULL)
+    {
+      g_object_unref (task->location);
+      task->location = renamed_file;
+      thunar_file_renamed (task->file, renamed_file, FALSE);
+
+      if (task->temp_name != NULL && !task->at_temp)
+        {
+          /* continue with the new name once it is free */
+          task->at_temp = TRUE;
+          if (!task->blocked)
+            g_queue_push_tail (&executor->ready, task);
+        }
+      else
+        {
+          task->renamed = TRUE;
+          executor->n_renamed++;
+          executor->n_processed++;
+        }
+    }
+  else
+    {
+      executor->n_processed++;
+
+      /* failures caused by cancelling are not reported */
+      if (!g_error_matches (task->error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        g_queue_push_tail (&executor->failures, task);
+    }
+
+  /* the old name of the file is free now, or will never be, either way the
+   * waiting task can be tried, it fails on its own if the name is still used */
+  if (!task->moved)
+    {
+      task->moved = TRUE;
+      thunar_renamer_executor_release_waiting (executor, task);
+    }
+
+  if (task->renamed || task->error != NULL)
+    g_signal_emit (executor, executor_signals[PROGRESS], 0);
+
+  thunar_renamer_executor_report (executor);
+  thunar_renamer_executor_dispatch (executor);
+
+  /* release the reference of the rename */
+  g_object_unref (executor);
+}
+
+
+
+/**
+ * thunar_renamer_executor_new:
+ * @pairs : a #GList of #ThunarRenamerPair<!---->s.
+ *
+ * Allocates a new #ThunarRenamerExecutor which renames the
+ * files of @pairs to their new names once started.
+ *
+ * Return value: the newly allocated #ThunarRenamerExecutor.
+ **/
+ThunarRenamerExecutor *
+thunar_renamer_executor_new (GList *pairs)
+{
+  ThunarRenamerExecutor *executor;
+  ThunarRenamerPair     *pair;
+  ThunarRenamerTask     *task;
+  GList                 *lp;
+
+  executor = g_object_new (THUNAR_TYPE_RENAMER_EXECUTOR, NULL);
+
+  for (lp = pairs; lp != NULL; lp = lp->next)
+    {
+      pair = lp->data;
+
+      task = g_slice_new0 (ThunarRenamerTask);
+      task->executor = executor;
+      task->file = g_object_ref (pair->file);
+      task->name = g_strdup (pair->name);
+      task->old_location = g_object_ref (thunar_file_get_file (pair->file));
+      task->location = g_object_ref (task->old_location);
+      g_ptr_array_add (executor->tasks, task);
+    }
+
+  return executor;
+}
+
+
+
+/**
+ * thunar_renamer_executor_start:
+ * @executor : a #ThunarRenamerExecutor.
+ *
+ * Orders the renames and starts them. The @executor keeps itself
+ * alive until it emitted the "finished" signal, which may happen
+ * before this function returns if there is nothing to do.
+ **/
+void
+thunar_renamer_executor_start (ThunarRenamerExecutor *executor)
+{
+  _thunar_return_if_fail (THUNAR_IS_RENAMER_EXECUTOR (executor));
+  _thunar_return_if_fail (!executor->started);
+
+  executor->started = TRUE;
+
+  /* released once finished */
+  g_object_ref (executor);
+
+  thunar_renamer_executor_plan (executor);
+  thunar_renamer_executor_dispatch (executor);
+}
+
+
+
+/**
+ * thunar_renamer_executor_cancel:
+ * @executor : a #ThunarRenamerExecutor.
+ *
+ * Starts no further renames and cancels the running ones. The
+ * "finished" signal is emitted once the running renames returned.
+ **/
+void
+thunar_renamer_executor_cancel (ThunarRenamerExecutor *executor)
+{
+  _thunar_return_if_fail (THUNAR_IS_RENAMER_EXECUTOR (executor));
+
+  if (executor->cancelled)
+    return;
+
+  executor->cancelled = TRUE;
+  g_cancellable_cancel (executor->cancellable);
+
+  if (executor->started)
+    thunar_renamer_executor_check_finished (executor);
+}
+
+
+
+/**
+ * thunar_renamer_executor_is_finished:
+ * @executor : a #ThunarRenamerExecutor.
+ *
+ * Return value: %TRUE if @executor emitted the "finished" signal.
+ **/
+gboolean
+thunar_renamer_executor_is_finished (ThunarRenamerExecutor *executor)
+{
+  _thunar_return_val_if_fail (THUNAR_IS_RENAMER_EXECUTOR (executor), TRUE);
+  return executor->finished;
+}
+
+
+
+/**
+ * thunar_renamer_executor_get_n_total:
+ * @executor : a #ThunarRenamerExecutor.
+ *
+ * Return value: the number of files to rename.
+ **/
+guint
+thunar_renamer_executor_get_n_total (ThunarRenamerExecutor *executor)
+{
+  _thunar_return_val_if_fail (THUNAR_IS_RENAMER_EXECUTOR (executor), 0);
+  return executor->tasks->len;
+}
+
+
+
+/**
+ * thunar_renamer_executor_get_n_processed:
+ * @executor : a #ThunarRenamerExecutor.
+ *
+ * Return value: the number of files renamed or failed so far.
+ **/
+guint
+thunar_renamer_executor_get_n_processed (ThunarRenamerExecutor *executor)
+{
+  _thunar_return_val_if_fail (THUNAR_IS_RENAMER_EXECUTOR (executor), 0);
+  return executor->n_processed;
+}
+
+
+
+/**
+ * thunar_renamer_executor_get_n_renamed:
+ * @executor : a #ThunarRenamerExecutor.
+ *
+ * Return value: the number of files renamed so far.
+ **/
+guint
+thunar_renamer_executor_get_n_renamed (ThunarRenamerExecutor *executor)
+{
+  _thunar_return_val_if_fail (THUNAR_IS_RENAMER_EXECUTOR (executor), 0);
+  return executor->n_renamed;
+}
+
+
+
+/**
+ * thunar_renamer_executor_get_undo_pairs:
+ * @executor : a #ThunarRenamerExecutor.
+ *
+ * Returns the pairs which rename the files renamed by @executor
+ * back to their old names. The caller is responsible to free the
+ * list using thunar_renamer_pair_list_free().
+ *
+ * Return value: the #GList of #ThunarRenamerPair<!---->s.
+ **/
+GList *
+thunar_renamer_executor_get_undo_pairs (ThunarRenamerExecutor *executor)
+{
+  ThunarRenamerTask *task;
+  GList             *pairs = NULL;
+  gchar             *old_name;
+  guint              n;
+
+  _thunar_return_val_if_fail (THUNAR_IS_RENAMER_EXECUTOR (executor), NULL);
+
+  for (n = executor->tasks->len; n > 0; n--)
+    {
+      task = g_ptr_array_index (executor->tasks, n - 1);
+      if (!task->renamed)
+        continue;
+
+      old_name = g_file_get_basename (task->old_location);
+      pairs = g_list_prepend (pairs, thunar_renamer_pair_new (task->file, old_name));
+      g_free (old_name);
+    }
+
+  return pairs;
+}
+
+
+
+/**
+ * thunar_renamer_executor_commit_operation:
+ * @executor : a #ThunarRenamerExecutor.
+ *
+ * Adds a single rename operation for all files renamed
+ * by @executor to the #ThunarJobOperationHistory.
+ **/
+void
+thunar_renamer_executor_commit_operation (ThunarRenamerExecutor *executor)
+{
+  ThunarJobOperation *operation;
+  ThunarRenamerTask  *task;
+  guint               n;
+
+  _thunar_return_if_fail (THUNAR_IS_RENAMER_EXECUTOR (executor));
+
+  if (executor->n_renamed == 0)
+    return;
+
+  operation = thunar_job_operation_new (THUNAR_JOB_OPERATION_KIND_RENAME);
+  for (n = 0; n < executor->tasks->len; n++)
+    {
+      task = g_ptr_array_index (executor->tasks, n);
+      if (task->renamed)
+        thunar_job_operation_add (operation, task->old_location, task->location);
+    }
+  thunar_job_operation_history_commit (operation);
+  g_object_unref (operation);
+}
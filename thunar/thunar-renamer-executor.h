@@ -0,0 +1,51 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __THUNAR_RENAMER_EXECUTOR_H__
+#define __THUNAR_RENAMER_EXECUTOR_H__
+
+#include "thunar/thunar-renamer-pair.h"
+
+G_BEGIN_DECLS;
+
+typedef struct _ThunarRenamerExecutorClass ThunarRenamerExecutorClass;
+typedef struct _ThunarRenamerExecutor      ThunarRenamerExecutor;
+
+#define THUNAR_TYPE_RENAMER_EXECUTOR            (thunar_renamer_executor_get_type ())
+#define THUNAR_RENAMER_EXECUTOR(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), THUNAR_TYPE_RENAMER_EXECUTOR, ThunarRenamerExecutor))
+#define THUNAR_RENAMER_EXECUTOR_CLASS(klass)    (G_TYPE_CHECK_CLASS_CAST ((klass), THUNAR_TYPE_RENAMER_EXECUTOR, ThunarRenamerExecutorClass))
+#define THUNAR_IS_RENAMER_EXECUTOR(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), THUNAR_TYPE_RENAMER_EXECUTOR))
+#define THUNAR_IS_RENAMER_EXECUTOR_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), THUNAR_TYPE_RENAMER_EXECUTOR))
+#define THUNAR_RENAMER_EXECUTOR_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), THUNAR_TYPE_RENAMER_EXECUTOR, ThunarRenamerExecutorClass))
+
+GType                  thunar_renamer_executor_get_type         (void) G_GNUC_CONST;
+
+ThunarRenamerExecutor *thunar_renamer_executor_new              (GList                 *pairs) G_GNUC_MALLOC;
+
+void                   thunar_renamer_executor_start            (ThunarRenamerExecutor *executor);
+void                   thunar_renamer_executor_cancel           (ThunarRenamerExecutor *executor);
+gboolean               thunar_renamer_executor_is_finished      (ThunarRenamerExecutor *executor);
+
+guint                  thunar_renamer_executor_get_n_total      (ThunarRenamerExecutor *executor);
+guint                  thunar_renamer_executor_get_n_processed  (ThunarRenamerExecutor *executor);
+guint                  thunar_renamer_executor_get_n_renamed    (ThunarRenamerExecutor *executor);
+
+GList                 *thunar_renamer_executor_get_undo_pairs   (ThunarRenamerExecutor *executor) G_GNUC_MALLOC;
+void                   thunar_renamer_executor_commit_operation (ThunarRenamerExecutor *executor);
+
+G_END_DECLS;
+
+#endif /* !__THUNAR_RENAMER_EXECUTOR_H__ */
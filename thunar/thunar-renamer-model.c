@@ -38,6 +38,12 @@
 
 #define THUNAR_RENAMER_MODEL_ITEM(item) ((ThunarRenamerModelItem *) (item))
 
+/* the time an update pass may block the main loop at once, in microseconds */
+#define THUNAR_RENAMER_MODEL_UPDATE_TIME (10 * 1000)
+
+/* the number of items handed to the renamer at once */
+#define THUNAR_RENAMER_MODEL_BATCH_SIZE (128)
+
 
 
 /* Property identifiers */
@@ -109,11 +115,24 @@ static void                    thunar_renamer_model_file_destroyed      (ThunarR
 static void                    thunar_renamer_model_invalidate_all      (ThunarRenamerModel      *renamer_model);
 static void                    thunar_renamer_model_invalidate_item     (ThunarRenamerModel      *renamer_model,
                                                                          ThunarRenamerModelItem  *item);
-static gboolean                thunar_renamer_model_conflict_item       (ThunarRenamerModel      *renamer_model,
+static gboolean                thunar_renamer_model_register_item       (ThunarRenamerModel      *renamer_model,
+                                                                         ThunarRenamerModelItem  *item);
+static void                    thunar_renamer_model_unregister_item     (ThunarRenamerModel      *renamer_model,
                                                                          ThunarRenamerModelItem  *item);
-static gchar                  *thunar_renamer_model_process_item        (ThunarRenamerModel      *renamer_model,
+static gchar                  *thunar_renamer_model_item_get_text       (ThunarRenamerModel      *renamer_model,
                                                                          ThunarRenamerModelItem  *item,
-                                                                         guint                    idx);
+                                                                         ThunarRenamerMode       *mode_return);
+static gchar                  *thunar_renamer_model_item_get_name       (ThunarRenamerModelItem  *item,
+                                                                         ThunarRenamerMode        mode,
+                                                                         gchar                   *text);
+static void                    thunar_renamer_model_update_item         (ThunarRenamerModel      *renamer_model,
+                                                                         GList                   *lp,
+                                                                         guint                    idx,
+                                                                         gchar                   *name);
+static guint                   thunar_renamer_model_update_items        (ThunarRenamerModel      *renamer_model,
+                                                                         GList                  **lp_return,
+                                                                         guint                    idx,
+                                                                         guint                    n_items);
 static gboolean                thunar_renamer_model_update_idle         (gpointer                 user_data);
 static void                    thunar_renamer_model_update_idle_destroy (gpointer                 user_data);
 static ThunarRenamerModelItem *thunar_renamer_model_item_new            (ThunarFile              *file) G_GNUC_MALLOC;
@@ -157,6 +176,21 @@ struct _ThunarRenamerModel
 
   /* the idle source used to update the model */
   guint              update_idle_id;
+
+  /* position of the running update pass, NULL to start a new pass */
+  GList             *update_lp;
+  guint              update_idx;
+
+  /* TRUE if the conflict state of an item changed behind the pass */
+  gboolean           update_again;
+
+  /* the rows visible in the view, updated first */
+  gint               visible_start;
+  gint               visible_end;
+
+  /* maps the new path of the items to a #GQueue of the items,
+   * more than one item in a queue is a conflict */
+  GHashTable        *names;
 };
 
 struct _ThunarRenamerModelItem
@@ -164,9 +198,12 @@ struct _ThunarRenamerModelItem
   ThunarFile *file;
   gchar      *name;
   guint64     date_changed;
+  gchar      *key;          /* the new path of the item, owned by the names table */
+  GList      *key_link;     /* the link of the item in the queue of the key */
   guint       changed : 1;  /* if the file changed */
   guint       conflict : 1; /* if the item conflicts with another item */
   guint       dirty : 1;    /* if the item must be updated */
+  guint       notify : 1;   /* if the conflict state changed, and the row must be redrawn */
 };
 
 
@@ -272,6 +309,10 @@ thunar_renamer_model_init (ThunarRenamerModel *renamer_model)
 #ifndef NDEBUG
   renamer_model->stamp = g_random_int ();
 #endif
+
+  renamer_model->visible_start = -1;
+  renamer_model->visible_end = -1;
+  renamer_model->names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, (GDestroyNotify) g_queue_free);
 }
 
 
@@ -286,10 +327,11 @@ thunar_renamer_model_finalize (GObject *object)
   thunar_renamer_model_set_renamer (renamer_model, NULL);
 
   /* release all items */
-  for (lp = renamer_model->items; renamer_model->items != NULL; renamer_model->items = renamer_model->items->next)
+  for (lp = renamer_model->items; lp != NULL; lp = lp->next)
     thunar_renamer_model_release_item (renamer_model, lp->data);
- 
+
   g_list_free (renamer_model->items);
+  g_hash_table_destroy (renamer_model->names);
 
   /* be sure to cancel any pending update idle source (must be last!) */
   if (G_UNLIKELY (renamer_model->update_idle_id != 0))
@@ -682,7 +724,7 @@ thunar_renamer_model_invalidate_all (ThunarRenamerModel *renamer_model)
 {
   GList *lp;
 
-  /* invalidate all items in the model */
+  /* invalidate all items in the model, this also cancels a running pass */
   for (lp = renamer_model->items; lp != NULL; lp = lp->next)
     thunar_renamer_model_invalidate_item (renamer_model, lp->data);
 }
@@ -693,15 +735,22 @@ static void
 thunar_renamer_model_invalidate_item (ThunarRenamerModel     *renamer_model,
                                       ThunarRenamerModelItem *item)
 {
+  /* dirty items do not take part in conflicts */
+  thunar_renamer_model_unregister_item (renamer_model, item);
+
   /* mark the item as dirty */
   item->dirty = TRUE;
 
+  /* the running pass may have passed the item, or use outdated indices, restart it */
+  renamer_model->update_lp = NULL;
+
   /* check if the update idle source is already running and not frozen */
   if (G_UNLIKELY (renamer_model->update_idle_id == 0 && !renamer_model->frozen))
     {
       /* schedule the update idle source */
       renamer_model->update_idle_id = g_idle_add_full (G_PRIORITY_LOW, thunar_renamer_model_update_idle,
                                                        renamer_model, thunar_renamer_model_update_idle_destroy);
+      g_source_set_name_by_id (renamer_model->update_idle_id, "thunar_renamer_model_update_idle");
 
       /* notify listeners that we're updating */
       g_object_notify (G_OBJECT (renamer_model), "can-rename");
@@ -710,95 +759,121 @@ thunar_renamer_model_invalidate_item (ThunarRenamerModel     *renamer_model,
 
 
 
-static gboolean
-trm_same_directory (ThunarFile *a,
-                    ThunarFile *b)
+static gchar *
+thunar_renamer_model_item_key (ThunarRenamerModelItem *item)
 {
-  GFile    *parent_a;
-  GFile    *parent_b;
-  gboolean  result;
+  GFile *parent;
+  gchar *uri = NULL;
+  gchar *key;
 
-  /* determine the parent paths for both files */
-  parent_a = g_file_get_parent (thunar_file_get_file (a));
-  parent_b = g_file_get_parent (thunar_file_get_file (b));
-
-  /* check if both files have the same parent */
-  result = (parent_a != NULL && parent_b != NULL && g_file_equal (parent_a, parent_b));
+  /* items can only conflict with items in the same directory */
+  parent = g_file_get_parent (thunar_file_get_file (item->file));
+  if (G_LIKELY (parent != NULL))
+    {
+      uri = g_file_get_uri (parent);
+      g_object_unref (parent);
+    }
 
-  if (parent_a != NULL)
-    g_object_unref (parent_a);
-  if (parent_b != NULL)
-    g_object_unref (parent_b);
+  key = g_strconcat (uri != NULL ? uri : "", "/",
+                     item->name != NULL ? item->name : thunar_file_get_basename (item->file),
+                     NULL);
+  g_free (uri);
 
-  return result;
+  return key;
 }
 
 
 
 static gboolean
-thunar_renamer_model_conflict_item (ThunarRenamerModel     *renamer_model,
+thunar_renamer_model_register_item (ThunarRenamerModel     *renamer_model,
                                     ThunarRenamerModelItem *item)
 {
   ThunarRenamerModelItem *oitem;
-  GtkTreePath            *path;
-  GtkTreeIter             iter;
-  gboolean                conflict = FALSE;
-  GList                  *lp;
+  GQueue                 *queue;
+  gpointer                key;
 
-  for (lp = renamer_model->items; lp != NULL; lp = lp->next)
+  /* drop the previous path, if the item was invalidated while being processed */
+  thunar_renamer_model_unregister_item (renamer_model, item);
+
+  /* lookup the items which end up with the same path */
+  key = thunar_renamer_model_item_key (item);
+  if (g_hash_table_lookup_extended (renamer_model->names, key, (gpointer *) &item->key, (gpointer *) &queue))
     {
-      /* check if this item is dirty or the item we're about to check */
-      oitem = THUNAR_RENAMER_MODEL_ITEM (lp->data);
-      if (G_UNLIKELY (oitem == item || oitem->dirty))
-        continue;
+      g_free (key);
+    }
+  else
+    {
+      queue = g_queue_new ();
+      item->key = key;
+      g_hash_table_insert (renamer_model->names, key, queue);
+    }
 
-      /* check if this other item conflicts with the item in question (can only conflict if in same directory) */
-      if (trm_same_directory (item->file, oitem->file)
-          && ((item->name != NULL && oitem->name == NULL && strcmp (item->name, thunar_file_get_basename (oitem->file)) == 0)
-           || (item->name == NULL && oitem->name != NULL && strcmp (thunar_file_get_basename (item->file), oitem->name) == 0)
-           || (item->name != NULL && oitem->name != NULL && strcmp (item->name, oitem->name) == 0)))
+  /* a single other item did not conflict so far, all items
+   * of a longer queue are already in conflict state */
+  if (queue->length == 1)
+    {
+      oitem = g_queue_peek_head (queue);
+      if (G_LIKELY (!oitem->conflict))
         {
-          /* check if the other item is already in conflict state */
-          if (G_LIKELY (!oitem->conflict))
-            {
-              /* set to conflict state */
-              oitem->conflict = TRUE;
-
-              /* determine iter for other item */
-              GTK_TREE_ITER_INIT (iter, renamer_model->stamp, lp);
-
-              /* emit "row-changed" for the other item */
-              path = gtk_tree_model_get_path (GTK_TREE_MODEL (renamer_model), &iter);
-              gtk_tree_model_row_changed (GTK_TREE_MODEL (renamer_model), path, &iter);
-              gtk_tree_path_free (path);
-            }
-
-          /* this item conflicts */
-          conflict = TRUE;
+          oitem->conflict = TRUE;
+          oitem->notify = TRUE;
+          renamer_model->update_again = TRUE;
         }
     }
 
-  return conflict;
+  g_queue_push_tail (queue, item);
+  item->key_link = queue->tail;
+
+  /* the item conflicts if any other item has the same path */
+  return (queue->length > 1);
+}
+
+
+
+static void
+thunar_renamer_model_unregister_item (ThunarRenamerModel     *renamer_model,
+                                      ThunarRenamerModelItem *item)
+{
+  ThunarRenamerModelItem *oitem;
+  GQueue                 *queue;
+
+  if (item->key == NULL)
+    return;
+
+  queue = g_hash_table_lookup (renamer_model->names, item->key);
+  g_queue_delete_link (queue, item->key_link);
+
+  if (queue->length == 0)
+    {
+      /* releases the key and the queue */
+      g_hash_table_remove (renamer_model->names, item->key);
+    }
+  else if (queue->length == 1)
+    {
+      /* the remaining item no longer conflicts */
+      oitem = g_queue_peek_head (queue);
+      if (G_LIKELY (oitem->conflict))
+        {
+          oitem->conflict = FALSE;
+          oitem->notify = TRUE;
+          renamer_model->update_again = TRUE;
+        }
+    }
+
+  item->key = NULL;
+  item->key_link = NULL;
 }
 
 
 
 static gchar*
-thunar_renamer_model_process_item (ThunarRenamerModel     *renamer_model,
-                                   ThunarRenamerModelItem *item,
-                                   guint                   idx)
+thunar_renamer_model_item_get_text (ThunarRenamerModel     *renamer_model,
+                                    ThunarRenamerModelItem *item,
+                                    ThunarRenamerMode      *mode_return)
 {
   ThunarRenamerMode mode;
   const gchar      *file_name;
   const gchar      *dot;
-  gchar            *name = NULL;
-  gchar            *prefix;
-  gchar            *extension;
-  gchar            *text;
-
-  /* no new name if no renamer is set */
-  if (G_UNLIKELY (renamer_model->renamer == NULL))
-    return NULL;
 
   /* determine the current file name of the file */
   file_name = thunar_file_get_basename (item->file);
@@ -807,53 +882,74 @@ thunar_renamer_model_process_item (ThunarRenamerModel     *renamer_model,
   dot = thunar_util_str_get_extension (file_name);
 
   /* if we don't have a dot, then no "Extension only" rename can take place */
-  if (G_LIKELY (dot != NULL || renamer_model->mode != THUNAR_RENAMER_MODE_EXTENSION))
+  if (G_UNLIKELY (dot == NULL && renamer_model->mode == THUNAR_RENAMER_MODE_EXTENSION))
+    return NULL;
+
+  /* now, for "Name only", we need a dot, otherwise treat everything as name */
+  if (renamer_model->mode == THUNAR_RENAMER_MODE_NAME && dot == NULL)
+    mode = THUNAR_RENAMER_MODE_BOTH;
+  else
+    mode = renamer_model->mode;
+
+  *mode_return = mode;
+
+  /* determine the part of the file name the renamer is applied to */
+  switch (mode)
     {
-      /* now, for "Name only", we need a dot, otherwise treat everything as name */
-      if (renamer_model->mode == THUNAR_RENAMER_MODE_NAME && dot == NULL)
-        mode = THUNAR_RENAMER_MODE_BOTH;
-      else
-        mode = renamer_model->mode;
+    case THUNAR_RENAMER_MODE_NAME:
+      return g_strndup (file_name, (dot - file_name));
 
-      /* determine the new name according to the mode */
-      switch (mode)
-        {
-        case THUNAR_RENAMER_MODE_NAME:
-          /* determine the name part of the display name */
-          text = g_strndup (file_name, (dot - file_name));
+    case THUNAR_RENAMER_MODE_EXTENSION:
+      return g_strdup (dot + 1);
 
-          /* determine the new name */
-          prefix = thunarx_renamer_process (renamer_model->renamer, THUNARX_FILE_INFO (item->file), text, idx);
+    case THUNAR_RENAMER_MODE_BOTH:
+      return g_strdup (file_name);
 
-          /* determine the new full name */
-          name = g_strconcat (prefix, dot, NULL);
+    default:
+      _thunar_assert_not_reached ();
+      return NULL;
+    }
+}
 
-          /* release the temporary strings */
-          g_free (prefix);
-          g_free (text);
-          break;
 
-        case THUNAR_RENAMER_MODE_EXTENSION:
-          /* determine the new extension */
-          extension = thunarx_renamer_process (renamer_model->renamer, THUNARX_FILE_INFO (item->file), dot + 1, idx);
 
-          prefix = g_strndup (file_name, (dot - file_name) + 1);
-          name = g_strconcat (prefix, extension, NULL);
-          g_free (prefix);
+static gchar*
+thunar_renamer_model_item_get_name (ThunarRenamerModelItem *item,
+                                    ThunarRenamerMode       mode,
+                                    gchar                  *text)
+{
+  const gchar *file_name;
+  const gchar *dot;
+  gchar       *prefix;
+  gchar       *name;
 
-          /* release the extension */
-          g_free (extension);
-          break;
+  /* determine the current file name of the file */
+  file_name = thunar_file_get_basename (item->file);
+  dot = thunar_util_str_get_extension (file_name);
 
-        case THUNAR_RENAMER_MODE_BOTH:
-          /* determine the new full name */
-          name = thunarx_renamer_process (renamer_model->renamer, THUNARX_FILE_INFO (item->file), file_name, idx);
-          break;
+  /* determine the new full name from the processed @text */
+  switch (mode)
+    {
+    case THUNAR_RENAMER_MODE_NAME:
+      name = g_strconcat (text, dot, NULL);
+      g_free (text);
+      break;
 
-        default:
-          _thunar_assert_not_reached ();
-          break;
-        }
+    case THUNAR_RENAMER_MODE_EXTENSION:
+      prefix = g_strndup (file_name, (dot - file_name) + 1);
+      name = g_strconcat (prefix, text, NULL);
+      g_free (prefix);
+      g_free (text);
+      break;
+
+    case THUNAR_RENAMER_MODE_BOTH:
+      name = text;
+      break;
+
+    default:
+      _thunar_assert_not_reached ();
+      name = text;
+      break;
     }
 
   /* check if the new name is equal to the old one */
@@ -869,81 +965,185 @@ thunar_renamer_model_process_item (ThunarRenamerModel     *renamer_model,
 
 
 
-static gboolean
-thunar_renamer_model_update_idle (gpointer user_data)
+static void
+thunar_renamer_model_update_item (ThunarRenamerModel *renamer_model,
+                                  GList              *lp,
+                                  guint               idx,
+                                  gchar              *name)
 {
-  ThunarRenamerModelItem *item;
-  ThunarRenamerModel     *renamer_model = THUNAR_RENAMER_MODEL (user_data);
+  ThunarRenamerModelItem *item = THUNAR_RENAMER_MODEL_ITEM (lp->data);
   GtkTreePath            *path;
   GtkTreeIter             iter;
-  gboolean                changed = FALSE;
+  gboolean                changed;
   gboolean                conflict;
-  guint                   idx;
-  gchar                  *name;
+
+  /* check if the conflict state was changed by another item */
+  changed = item->notify;
+  item->notify = FALSE;
+
+  /* check if this item is dirty */
+  if (item->dirty)
+    {
+      /* check if the file changed */
+      changed |= item->changed;
+
+      /* mark as valid, since we're updating right now */
+      item->changed = FALSE;
+      item->dirty = FALSE;
+
+      /* apply the new name for the item */
+      if (g_strcmp0 (item->name, name) != 0)
+        {
+          /* apply new name */
+          g_free (item->name);
+          item->name = name;
+
+          /* the item changed */
+          changed = TRUE;
+        }
+      else
+        {
+          /* release temporary name */
+          g_free (name);
+        }
+
+      /* check if this item conflicts with any other item */
+      conflict = thunar_renamer_model_register_item (renamer_model, item);
+      if (item->conflict != conflict)
+        {
+          /* apply the new state */
+          item->conflict = conflict;
+
+          /* the item changed */
+          changed = TRUE;
+        }
+    }
+
+  /* check if the item changed */
+  if (G_LIKELY (changed))
+    {
+      /* generate the iter for the item */
+      GTK_TREE_ITER_INIT (iter, renamer_model->stamp, lp);
+
+      /* emit "row-changed" for this item */
+      path = gtk_tree_path_new_from_indices (idx, -1);
+      gtk_tree_model_row_changed (GTK_TREE_MODEL (renamer_model), path, &iter);
+      gtk_tree_path_free (path);
+    }
+}
+
+
+
+static guint
+thunar_renamer_model_update_items (ThunarRenamerModel  *renamer_model,
+                                   GList              **lp_return,
+                                   guint                idx,
+                                   guint                n_items)
+{
+  ThunarRenamerModelItem *item;
+  ThunarRenamerMode       modes[THUNAR_RENAMER_MODEL_BATCH_SIZE];
+  ThunarxFileInfo        *files[THUNAR_RENAMER_MODEL_BATCH_SIZE];
+  const gchar            *texts[THUNAR_RENAMER_MODEL_BATCH_SIZE];
+  gchar                  *names[THUNAR_RENAMER_MODEL_BATCH_SIZE];
+  guint                   indices[THUNAR_RENAMER_MODEL_BATCH_SIZE];
+  gint                    slots[THUNAR_RENAMER_MODEL_BATCH_SIZE];
+  gchar                  *text;
   GList                  *lp;
+  guint                   n_batch = 0;
+  guint                   n;
+
+  n_items = MIN (n_items, THUNAR_RENAMER_MODEL_BATCH_SIZE);
+
+  /* collect the texts of the dirty items, so the renamer can process them at once */
+  for (lp = *lp_return, n = 0; lp != NULL && n < n_items; lp = lp->next, ++n)
+    {
+      item = THUNAR_RENAMER_MODEL_ITEM (lp->data);
+      slots[n] = -1;
+
+      /* no new name if no renamer is set */
+      if (!item->dirty || G_UNLIKELY (renamer_model->renamer == NULL))
+        continue;
+
+      text = thunar_renamer_model_item_get_text (renamer_model, item, &modes[n_batch]);
+      if (G_UNLIKELY (text == NULL))
+        continue;
+
+      files[n_batch] = THUNARX_FILE_INFO (item->file);
+      texts[n_batch] = text;
+      indices[n_batch] = idx + n;
+      slots[n] = n_batch++;
+    }
+
+  if (n_batch > 0)
+    {
+      thunarx_renamer_process_batch (renamer_model->renamer, files, texts, indices, n_batch, names);
+
+      /* release the temporary texts */
+      for (n = 0; n < n_batch; ++n)
+        g_free ((gchar *) texts[n]);
+    }
+
+  /* apply the new names and conflict states */
+  for (lp = *lp_return, n = 0; lp != NULL && n < n_items; lp = lp->next, ++n)
+    {
+      item = THUNAR_RENAMER_MODEL_ITEM (lp->data);
+      thunar_renamer_model_update_item (renamer_model, lp, idx + n,
+                                        (slots[n] >= 0) ? thunar_renamer_model_item_get_name (item, modes[slots[n]], names[slots[n]]) : NULL);
+    }
+
+  *lp_return = lp;
+
+  return n;
+}
+
+
+
+static gboolean
+thunar_renamer_model_update_idle (gpointer user_data)
+{
+  ThunarRenamerModel *renamer_model = THUNAR_RENAMER_MODEL (user_data);
+  gint64              deadline;
+  guint               idx;
+  GList              *lp;
 
   /* don't do anything if the model is frozen */
-  if (G_LIKELY (!renamer_model->frozen))
+  if (G_UNLIKELY (renamer_model->frozen))
+    return FALSE;
+
+  deadline = g_get_monotonic_time () + THUNAR_RENAMER_MODEL_UPDATE_TIME;
+
+  /* a new pass first updates the rows the user can see */
+  if (renamer_model->update_lp == NULL)
     {
-      /* process the first dirty item */
-      for (idx = 0, lp = renamer_model->items; !changed && lp != NULL; ++idx, lp = lp->next)
+      renamer_model->update_again = FALSE;
+
+      if (renamer_model->visible_start >= 0)
         {
-          /* check if this item is dirty */
-          item = THUNAR_RENAMER_MODEL_ITEM (lp->data);
-          if (G_LIKELY (!item->dirty))
-            continue;
-
-          /* check if the file changed */
-          changed = item->changed;
-
-          /* mark as valid, since we're updating right now */
-          item->changed = FALSE;
-          item->dirty = FALSE;
-
-          /* determine the new name for the item */
-          name = thunar_renamer_model_process_item (renamer_model, item, idx);
-          if (g_strcmp0 (item->name, name) != 0)
-            {
-              /* apply new name */
-              g_free (item->name);
-              item->name = name;
-
-              /* the item changed */
-              changed = TRUE;
-            }
-          else
-            {
-              /* release temporary name */
-              g_free (name);
-            }
-
-          /* check if this item conflicts with any other item */
-          conflict = thunar_renamer_model_conflict_item (renamer_model, item);
-          if (item->conflict != conflict)
-            {
-              /* apply the new state */
-              item->conflict = conflict;
-
-              /* the item changed */
-              changed = TRUE;
-            }
-
-          /* check if the item changed */
-          if (G_LIKELY (changed))
-            {
-              /* generate the iter for the item */
-              GTK_TREE_ITER_INIT (iter, renamer_model->stamp, lp);
-
-              /* emit "row-changed" for this item */
-              path = gtk_tree_path_new_from_indices (idx, -1);
-              gtk_tree_model_row_changed (GTK_TREE_MODEL (renamer_model), path, &iter);
-              gtk_tree_path_free (path);
-            }
+          for (idx = renamer_model->visible_start, lp = g_list_nth (renamer_model->items, idx);
+               lp != NULL && idx <= (guint) renamer_model->visible_end;)
+            idx += thunar_renamer_model_update_items (renamer_model, &lp, idx, renamer_model->visible_end - idx + 1);
         }
+
+      renamer_model->update_lp = renamer_model->items;
+      renamer_model->update_idx = 0;
     }
 
-  /* keep the idle source as long as any item changed */
-  return changed;
+  /* continue with all items, until the time slice is used up */
+  for (lp = renamer_model->update_lp, idx = renamer_model->update_idx;
+       lp != NULL && g_get_monotonic_time () < deadline;)
+    {
+      idx += thunar_renamer_model_update_items (renamer_model, &lp, idx, THUNAR_RENAMER_MODEL_BATCH_SIZE);
+
+      /* the renamer changed while processing the items, start over */
+      if (G_UNLIKELY (renamer_model->update_lp == NULL))
+        return TRUE;
+    }
+
+  renamer_model->update_lp = lp;
+  renamer_model->update_idx = idx;
+
+  /* another pass is needed if the conflict state of an item changed behind this one */
+  return (lp != NULL || renamer_model->update_again);
 }
 
 
@@ -951,8 +1151,9 @@ thunar_renamer_model_update_idle (gpointer user_data)
 static void
 thunar_renamer_model_update_idle_destroy (gpointer user_data)
 {
-  /* reset the update idle id... */
+  /* reset the update idle id and the pass... */
   THUNAR_RENAMER_MODEL (user_data)->update_idle_id = 0;
+  THUNAR_RENAMER_MODEL (user_data)->update_lp = NULL;
 
   /* ...and notify listeners */
   g_object_notify (G_OBJECT (user_data), "can-rename");
@@ -979,6 +1180,11 @@ static void
 thunar_renamer_model_release_item (ThunarRenamerModel     *renamer_model,
                                   ThunarRenamerModelItem  *item)
 {
+  thunar_renamer_model_unregister_item (renamer_model, item);
+
+  /* the running pass may point to the item */
+  renamer_model->update_lp = NULL;
+
   thunar_file_unwatch (item->file);
   g_signal_handlers_disconnect_by_data (item->file, renamer_model);
 
@@ -1262,6 +1468,28 @@ thunar_renamer_model_set_renamer (ThunarRenamerModel *renamer_model,
 
 
 
+/**
+ * thunar_renamer_model_set_visible_range:
+ * @renamer_model : a #ThunarRenamerModel.
+ * @start_index   : the index of the first visible row, or -1.
+ * @end_index     : the index of the last visible row, or -1.
+ *
+ * Tells @renamer_model which rows are currently visible
+ * in the view, so these are updated before all other rows.
+ **/
+void
+thunar_renamer_model_set_visible_range (ThunarRenamerModel *renamer_model,
+                                        gint                start_index,
+                                        gint                end_index)
+{
+  _thunar_return_if_fail (THUNAR_IS_RENAMER_MODEL (renamer_model));
+
+  renamer_model->visible_start = start_index;
+  renamer_model->visible_end = end_index;
+}
+
+
+
 /**
  * thunar_renamer_model_insert:
  * @renamer_model : a #ThunarRenamerModel.
@@ -55,27 +55,31 @@ typedef enum
   THUNAR_RENAMER_MODEL_N_COLUMNS,
 } ThunarRenamerModelColumn;
 
-GType                thunar_renamer_model_get_type       (void) G_GNUC_CONST;
-
-ThunarRenamerModel  *thunar_renamer_model_new            (void) G_GNUC_MALLOC;
-
-ThunarRenamerMode    thunar_renamer_model_get_mode       (ThunarRenamerModel *renamer_model);
-
-ThunarxRenamer      *thunar_renamer_model_get_renamer    (ThunarRenamerModel *renamer_model);
-void                 thunar_renamer_model_set_renamer    (ThunarRenamerModel *renamer_model,
-                                                          ThunarxRenamer     *renamer);
-
-void                 thunar_renamer_model_insert         (ThunarRenamerModel *renamer_model,
-                                                          ThunarFile         *file,
-                                                          gint                position);
-void                 thunar_renamer_model_reorder        (ThunarRenamerModel *renamer_model,
-                                                          GList              *tree_paths,
-                                                          gint                position);
-void                 thunar_renamer_model_sort           (ThunarRenamerModel *renamer_model,
-                                                          GtkSortType         sort_order);
-void                 thunar_renamer_model_clear          (ThunarRenamerModel *renamer_model);
-void                 thunar_renamer_model_remove         (ThunarRenamerModel *renamer_model,
-                                                          GtkTreePath        *path);
+GType                thunar_renamer_model_get_type          (void) G_GNUC_CONST;
+
+ThunarRenamerModel  *thunar_renamer_model_new               (void) G_GNUC_MALLOC;
+
+ThunarRenamerMode    thunar_renamer_model_get_mode          (ThunarRenamerModel *renamer_model);
+
+ThunarxRenamer      *thunar_renamer_model_get_renamer       (ThunarRenamerModel *renamer_model);
+void                 thunar_renamer_model_set_renamer       (ThunarRenamerModel *renamer_model,
+                                                             ThunarxRenamer     *renamer);
+
+void                 thunar_renamer_model_set_visible_range (ThunarRenamerModel *renamer_model,
+                                                             gint                start_index,
+                                                             gint                end_index);
+
+void                 thunar_renamer_model_insert            (ThunarRenamerModel *renamer_model,
+                                                             ThunarFile         *file,
+                                                             gint                position);
+void                 thunar_renamer_model_reorder           (ThunarRenamerModel *renamer_model,
+                                                             GList              *tree_paths,
+                                                             gint                position);
+void                 thunar_renamer_model_sort              (ThunarRenamerModel *renamer_model,
+                                                             GtkSortType         sort_order);
+void                 thunar_renamer_model_clear             (ThunarRenamerModel *renamer_model);
+void                 thunar_renamer_model_remove            (ThunarRenamerModel *renamer_model,
+                                                             GtkTreePath        *path);
 
 
 /**
@@ -22,28 +22,26 @@
 #endif
 
 #include "thunar/thunar-private.h"
+#include "thunar/thunar-renamer-executor.h"
 #include "thunar/thunar-renamer-progress.h"
 #include "thunar/thunar-util.h"
 
 
 
-/* Signal identifiers */
-enum
-{
-  FINISHED,
-  LAST_SIGNAL,
-};
-
-
-
 static void     thunar_renamer_progress_finalize          (GObject               *object);
 static void     thunar_renamer_progress_destroy           (GtkWidget             *object);
-static gboolean thunar_renamer_progress_next_idle         (gpointer               user_data);
-static void     thunar_renamer_progress_next_idle_destroy (gpointer               user_data);
+static void     thunar_renamer_progress_update            (ThunarRenamerProgress *renamer_progress);
+static void     thunar_renamer_progress_failed            (ThunarRenamerExecutor *executor,
+                                                           ThunarFile            *file,
+                                                           const gchar           *name,
+                                                           GError                *error,
+                                                           ThunarRenamerProgress *renamer_progress);
+static void     thunar_renamer_progress_finished          (ThunarRenamerProgress *renamer_progress);
 static void     thunar_renamer_progress_run_helper        (ThunarRenamerProgress *renamer_progress,
                                                            GList                 *pairs);
 static void     thunar_renamer_progress_run_error_dialog  (ThunarRenamerProgress *renamer_progress,
-                                                           ThunarRenamerPair     *pair,
+                                                           ThunarFile            *file,
+                                                           const gchar           *name,
                                                            GError                *error);
 
 
@@ -55,22 +53,17 @@ struct _ThunarRenamerProgressClass
 
 struct _ThunarRenamerProgress
 {
-  GtkAlignment __parent__;
-  GtkWidget   *bar;
+  GtkAlignment           __parent__;
+  GtkWidget             *bar;
 
-  GList       *pairs_renamed_current_run; /* list of pairs renamed in a given run */
-  GList       *pairs_renamed_all_runs;    /* list of pairs renamed across all runs */
-  GList       *pairs_failed_current_run;
-  GList       *pairs_pending_current_run;
-  gboolean     show_dialog_on_error;
-  gboolean     pairs_undo;                /* whether we're undoing previous changes */
+  /* renames the pairs of the current run */
+  ThunarRenamerExecutor *executor;
 
-  /* the user may cancel the renaming operation while there are still failed pairs and runs remaining */
-  gboolean     cancel_all_remaining_runs;
+  gboolean               pairs_undo;   /* whether we're undoing previous changes */
+  gboolean               pairs_revert; /* whether the user asked to undo the changes */
 
   /* internal main loop for the _rename() method */
-  guint        next_idle_id;
-  GMainLoop   *next_idle_loop;
+  GMainLoop             *run_loop;
 };
 
 
@@ -113,12 +106,8 @@ thunar_renamer_progress_finalize (GObject *object)
   ThunarRenamerProgress *renamer_progress = THUNAR_RENAMER_PROGRESS (object);
 
   /* make sure we're not finalized while the main loop is active */
-  _thunar_assert (renamer_progress->next_idle_id == 0);
-  _thunar_assert (renamer_progress->next_idle_loop == NULL);
-
-  /* release the pairs */
-  thunar_renamer_pair_list_free (renamer_progress->pairs_renamed_current_run);
-  thunar_renamer_pair_list_free (renamer_progress->pairs_pending_current_run);
+  _thunar_assert (renamer_progress->run_loop == NULL);
+  _thunar_assert (renamer_progress->executor == NULL);
 
   (*G_OBJECT_CLASS (thunar_renamer_progress_parent_class)->finalize) (object);
 }
@@ -140,18 +129,20 @@ thunar_renamer_progress_destroy (GtkWidget *object)
 
 static void
 thunar_renamer_progress_run_error_dialog (ThunarRenamerProgress *renamer_progress,
-                                          ThunarRenamerPair     *pair,
+                                          ThunarFile            *file,
+                                          const gchar           *name,
                                           GError                *error)
 {
   gchar     *oldname;
   GtkWindow *toplevel;
   GtkWidget *message;
   gint       response;
+  guint      n_remaining;
 
-  if (g_strcmp0(thunar_file_get_display_name (pair->file), thunar_file_get_basename (pair->file)) != 0)
-    oldname = g_strconcat (thunar_file_get_display_name (pair->file), " (", thunar_file_get_basename (pair->file), ")", NULL);
+  if (g_strcmp0(thunar_file_get_display_name (file), thunar_file_get_basename (file)) != 0)
+    oldname = g_strconcat (thunar_file_get_display_name (file), " (", thunar_file_get_basename (file), ")", NULL);
   else
-    oldname = g_strdup (thunar_file_get_display_name (pair->file));
+    oldname = g_strdup (thunar_file_get_display_name (file));
 
   /* determine the toplevel widget */
   toplevel = (GtkWindow *) gtk_widget_get_toplevel (GTK_WIDGET (renamer_progress));
@@ -163,15 +154,19 @@ thunar_renamer_progress_run_error_dialog (ThunarRenamerProgress *renamer_progres
                                     GTK_MESSAGE_ERROR,
                                     GTK_BUTTONS_NONE,
                                     _("Failed to rename \"%s\" to \"%s\"."),
-                                    oldname, pair->name);
+                                    oldname, name);
 
   gtk_window_set_title (GTK_WINDOW (message), _("Error"));
 
   /* release old name */
   g_free (oldname);
 
+  /* determine the files which are not processed yet */
+  n_remaining = thunar_renamer_executor_get_n_total (renamer_progress->executor)
+                - thunar_renamer_executor_get_n_processed (renamer_progress->executor);
+
   /* check if we should provide undo */
-  if (!renamer_progress->pairs_undo && renamer_progress->pairs_renamed_all_runs != NULL)
+  if (!renamer_progress->pairs_undo && thunar_renamer_executor_get_n_renamed (renamer_progress->executor) > 0)
     {
       gtk_message_dialog_format_secondary_text (GTK_MESSAGE_DIALOG (message),
                                                 _("You can either choose to skip this file and continue to rename the "
@@ -183,7 +178,7 @@ thunar_renamer_progress_run_error_dialog (ThunarRenamerProgress *renamer_progres
       gtk_dialog_add_button (GTK_DIALOG (message), _("_Skip This File"), GTK_RESPONSE_ACCEPT);
       gtk_dialog_set_default_response (GTK_DIALOG (message), GTK_RESPONSE_ACCEPT);
     }
-  else if (renamer_progress->pairs_pending_current_run != NULL)
+  else if (n_remaining > 0)
     {
       gtk_message_dialog_format_secondary_text (GTK_MESSAGE_DIALOG (message),
                                                 _("Do you want to skip this file and continue to rename the "
@@ -202,18 +197,14 @@ thunar_renamer_progress_run_error_dialog (ThunarRenamerProgress *renamer_progres
   response = gtk_dialog_run (GTK_DIALOG (message));
   if (response == GTK_RESPONSE_REJECT)
     {
-      /* undo previous changes */
-      renamer_progress->pairs_undo = TRUE;
-
-      /* release the todo pairs and use the done as todo */
-      thunar_renamer_pair_list_free (renamer_progress->pairs_pending_current_run);
-      renamer_progress->pairs_pending_current_run = renamer_progress->pairs_renamed_all_runs;
-      renamer_progress->pairs_renamed_all_runs = NULL;
+      /* undo previous changes, once the running renames returned */
+      renamer_progress->pairs_revert = TRUE;
+      thunar_renamer_executor_cancel (renamer_progress->executor);
     }
   else if (response != GTK_RESPONSE_ACCEPT)
     {
-      /* canceled, just exit the main loop */
-      g_main_loop_quit (renamer_progress->next_idle_loop);
+      /* canceled, stop renaming */
+      thunar_renamer_executor_cancel (renamer_progress->executor);
     }
 
   /* destroy the dialog */
@@ -222,79 +213,48 @@ thunar_renamer_progress_run_error_dialog (ThunarRenamerProgress *renamer_progres
 
 
 
-static gboolean
-thunar_renamer_progress_next_idle (gpointer user_data)
+static void
+thunar_renamer_progress_update (ThunarRenamerProgress *renamer_progress)
 {
-  ThunarRenamerProgress *renamer_progress = THUNAR_RENAMER_PROGRESS (user_data);
-  ThunarRenamerPair     *pair;
-  GError                *error = NULL;
-  gchar                 *oldname;
-  gchar                  text[128];
-  guint                  n_pairs_processed;
-  guint                  n_total;
-  GList                 *first;
-
-  /* check if we have still pairs to go */
-  if (G_LIKELY (renamer_progress->pairs_pending_current_run != NULL))
-    {
-      /* pop the first pair from the todo list */
-      first = g_list_first (renamer_progress->pairs_pending_current_run);
-      pair = first->data;
-      renamer_progress->pairs_pending_current_run = g_list_delete_link (renamer_progress->pairs_pending_current_run, first);
-
-      /* determine the done/todo items */
-      n_pairs_processed = g_list_length (renamer_progress->pairs_renamed_current_run) + g_list_length (renamer_progress->pairs_failed_current_run) + 1;
-      n_total = n_pairs_processed + g_list_length (renamer_progress->pairs_pending_current_run);
-
-      /* update the progress bar text */
-      g_snprintf (text, sizeof (text), "%d/%d", n_pairs_processed, n_total);
-      gtk_progress_bar_set_text (GTK_PROGRESS_BAR (renamer_progress->bar), text);
-
-      /* update the progress bar fraction */
-      gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (renamer_progress->bar), CLAMP ((gdouble) n_pairs_processed / MAX (n_total, 1), 0.0, 1.0));
-
-      /* try to rename the file */
-      if (!thunar_file_rename (pair->file, pair->name, NULL, FALSE, &error))
-        {
-          /* add pair to the list of failed pairs */
-          renamer_progress->pairs_failed_current_run = g_list_prepend (renamer_progress->pairs_failed_current_run, pair);
-
-          /* check if error dialog box is to de displayed*/
-          if (renamer_progress->show_dialog_on_error)
-            thunar_renamer_progress_run_error_dialog (renamer_progress, pair, error);
-
-          /* clear the error */
-          g_clear_error (&error);
-        }
-      else
-        {
-          /* remember the old file name (for undo) */
-          oldname = g_strdup (thunar_file_get_basename (pair->file));
-
-          /* replace the newname with the oldname for the pair (-> undo) */
-          g_free (pair->name);
-          pair->name = oldname;
-
-          /* move the pair to the list of completed pairs */
-          renamer_progress->pairs_renamed_current_run = g_list_prepend (renamer_progress->pairs_renamed_current_run, pair);
-          renamer_progress->pairs_renamed_all_runs = g_list_prepend (renamer_progress->pairs_renamed_all_runs, thunar_renamer_pair_copy (pair));
-        }
-    }
+  gchar text[128];
+  guint n_pairs_processed;
+  guint n_total;
+
+  /* determine the done/todo items */
+  n_pairs_processed = thunar_renamer_executor_get_n_processed (renamer_progress->executor);
+  n_total = thunar_renamer_executor_get_n_total (renamer_progress->executor);
+
+  /* update the progress bar text */
+  g_snprintf (text, sizeof (text), "%u/%u", n_pairs_processed, n_total);
+  gtk_progress_bar_set_text (GTK_PROGRESS_BAR (renamer_progress->bar), text);
+
+  /* update the progress bar fraction */
+  gtk_progress_bar_set_fraction (GTK_PROGRESS_BAR (renamer_progress->bar), CLAMP ((gdouble) n_pairs_processed / MAX (n_total, 1), 0.0, 1.0));
+}
 
-  /* be sure to cancel the internal loop once we're done */
-  if (G_UNLIKELY (renamer_progress->pairs_pending_current_run == NULL))
-    g_main_loop_quit (renamer_progress->next_idle_loop);
 
-  /* keep the idle source alive as long as we have anything to do */
-  return (renamer_progress->pairs_pending_current_run != NULL);
+
+static void
+thunar_renamer_progress_failed (ThunarRenamerExecutor *executor,
+                                ThunarFile            *file,
+                                const gchar           *name,
+                                GError                *error,
+                                ThunarRenamerProgress *renamer_progress)
+{
+  _thunar_return_if_fail (THUNAR_IS_RENAMER_PROGRESS (renamer_progress));
+  _thunar_return_if_fail (renamer_progress->executor == executor);
+
+  thunar_renamer_progress_run_error_dialog (renamer_progress, file, name, error);
 }
 
 
 
 static void
-thunar_renamer_progress_next_idle_destroy (gpointer user_data)
+thunar_renamer_progress_finished (ThunarRenamerProgress *renamer_progress)
 {
-  THUNAR_RENAMER_PROGRESS (user_data)->next_idle_id = 0;
+  /* leave the internal main loop */
+  if (G_LIKELY (renamer_progress->run_loop != NULL))
+    g_main_loop_quit (renamer_progress->run_loop);
 }
 
 
@@ -325,11 +285,14 @@ thunar_renamer_progress_cancel (ThunarRenamerProgress *renamer_progress)
 {
   _thunar_return_if_fail (THUNAR_IS_RENAMER_PROGRESS (renamer_progress));
 
-  /* exit the internal main loop (if any) */
-  if (G_UNLIKELY (renamer_progress->next_idle_loop != NULL))
-    g_main_loop_quit (renamer_progress->next_idle_loop);
+  /* stop renaming, without reverting the renamed files */
+  renamer_progress->pairs_revert = FALSE;
+  if (renamer_progress->executor != NULL)
+    thunar_renamer_executor_cancel (renamer_progress->executor);
 
-  renamer_progress->cancel_all_remaining_runs = TRUE;
+  /* exit the internal main loop (if any) */
+  if (G_UNLIKELY (renamer_progress->run_loop != NULL))
+    g_main_loop_quit (renamer_progress->run_loop);
 }
 
 
@@ -346,7 +309,7 @@ gboolean
 thunar_renamer_progress_running (ThunarRenamerProgress *renamer_progress)
 {
   _thunar_return_val_if_fail (THUNAR_IS_RENAMER_PROGRESS (renamer_progress), FALSE);
-  return (renamer_progress->next_idle_loop != NULL);
+  return (renamer_progress->run_loop != NULL);
 }
 
 
@@ -357,7 +320,8 @@ thunar_renamer_progress_running (ThunarRenamerProgress *renamer_progress)
  * @pair_list        : a #GList of #ThunarRenamePair<!---->s.
  *
  * Renames all #ThunarRenamePair<!---->s in the specified @pair_list
- * using the @renamer_progress.
+ * using a #ThunarRenamerExecutor, which is kept in @renamer_progress
+ * afterwards for the caller to inspect.
  *
  * A helper function to be used by thunar_renamer_progress_run function.
  * This method starts a new main loop, and returns only after the
@@ -368,45 +332,25 @@ thunar_renamer_progress_run_helper (ThunarRenamerProgress *renamer_progress,
                                     GList                 *pairs)
 {
   _thunar_return_if_fail (THUNAR_IS_RENAMER_PROGRESS (renamer_progress));
+  _thunar_return_if_fail (renamer_progress->executor == NULL);
 
-  /* make sure we're not already renaming */
-  if (G_UNLIKELY (renamer_progress->next_idle_id != 0
-      || renamer_progress->next_idle_loop != NULL))
-    return;
-
-  /* make sure to release the list of completed items */
-  thunar_renamer_pair_list_free (renamer_progress->pairs_renamed_current_run);
-  renamer_progress->pairs_renamed_current_run = NULL;
+  renamer_progress->executor = thunar_renamer_executor_new (pairs);
+  g_signal_connect_swapped (G_OBJECT (renamer_progress->executor), "progress", G_CALLBACK (thunar_renamer_progress_update), renamer_progress);
+  g_signal_connect (G_OBJECT (renamer_progress->executor), "failed", G_CALLBACK (thunar_renamer_progress_failed), renamer_progress);
+  g_signal_connect_swapped (G_OBJECT (renamer_progress->executor), "finished", G_CALLBACK (thunar_renamer_progress_finished), renamer_progress);
 
-  /* make sure to release the list of failed items */
-  thunar_renamer_pair_list_free (renamer_progress->pairs_failed_current_run);
-  renamer_progress->pairs_failed_current_run = NULL;
+  thunar_renamer_progress_update (renamer_progress);
 
-  /* set the pairs on the todo list */
-  thunar_renamer_pair_list_free (renamer_progress->pairs_pending_current_run);
-  renamer_progress->pairs_pending_current_run = thunar_renamer_pair_list_copy (pairs);
+  /* start renaming, and run the inner main loop until done */
+  renamer_progress->run_loop = g_main_loop_new (NULL, FALSE);
+  thunar_renamer_executor_start (renamer_progress->executor);
+  if (!thunar_renamer_executor_is_finished (renamer_progress->executor))
+    g_main_loop_run (renamer_progress->run_loop);
+  g_main_loop_unref (renamer_progress->run_loop);
+  renamer_progress->run_loop = NULL;
 
-  /* schedule the idle source */
-  renamer_progress->next_idle_id = g_idle_add_full (G_PRIORITY_LOW, thunar_renamer_progress_next_idle,
-                                                    renamer_progress, thunar_renamer_progress_next_idle_destroy);
-
-  /* run the inner main loop */
-  renamer_progress->next_idle_loop = g_main_loop_new (NULL, FALSE);
-  g_main_loop_run (renamer_progress->next_idle_loop);
-  g_main_loop_unref (renamer_progress->next_idle_loop);
-  renamer_progress->next_idle_loop = NULL;
-
-  /* be sure to cancel any pending idle source */
-  if (G_UNLIKELY (renamer_progress->next_idle_id != 0))
-    g_source_remove (renamer_progress->next_idle_id);
-
-  /* release the list of completed items */
-  thunar_renamer_pair_list_free (renamer_progress->pairs_renamed_current_run);
-  renamer_progress->pairs_renamed_current_run = NULL;
-
-  /* release the list of todo items */
-  thunar_renamer_pair_list_free (renamer_progress->pairs_pending_current_run);
-  renamer_progress->pairs_pending_current_run = NULL;
+  /* renames still running after a "destroy" are not reported anymore */
+  g_signal_handlers_disconnect_by_data (G_OBJECT (renamer_progress->executor), renamer_progress);
 }
 
 
@@ -419,72 +363,51 @@ thunar_renamer_progress_run_helper (ThunarRenamerProgress *renamer_progress,
  * Renames all #ThunarRenamePair<!---->s in the specified @pair_list
  * using the @renamer_progress.
  *
- * This method uses thunar_renamer_progress_run_helper function to
- * rename all the given pairs. It first tries to rename all the pairs
- * and stores all the failed pairs. Then it sorts the failed pairs in
- * ascending order and again tries to rename them. If still some pairs
- * are left then it sorts them in descending order and then tries to
- * rename them.
+ * The pairs are renamed concurrently, in the order required by files
+ * which take over the name of another file of the list, see
+ * #ThunarRenamerExecutor. If the user decides to revert the changes
+ * after an error, the renamed files get their old names back. Else
+ * the renamed files are added to the undo history as one operation.
  **/
 void
 thunar_renamer_progress_run (ThunarRenamerProgress *renamer_progress,
                              GList                 *pairs)
 {
+  GList *undo_pairs;
+
   _thunar_return_if_fail (THUNAR_IS_RENAMER_PROGRESS (renamer_progress));
 
   /* make sure we're not already renaming */
-  if (G_UNLIKELY (renamer_progress->next_idle_id != 0
-      || renamer_progress->next_idle_loop != NULL))
+  if (G_UNLIKELY (renamer_progress->run_loop != NULL))
     return;
 
   /* take an additional reference on the progress */
   g_object_ref (G_OBJECT (renamer_progress));
 
-  /* initialize all the boolean variables to false */
-  renamer_progress->show_dialog_on_error = FALSE;
-  renamer_progress->cancel_all_remaining_runs = FALSE;
   renamer_progress->pairs_undo = FALSE;
+  renamer_progress->pairs_revert = FALSE;
 
-  /* make sure to release the list of total renamed items first */
-  thunar_renamer_pair_list_free (renamer_progress->pairs_renamed_all_runs);
-  renamer_progress->pairs_renamed_all_runs = NULL;
-
-  /* try to rename all the files for the first time */
+  /* try to rename all the files */
   thunar_renamer_progress_run_helper (renamer_progress, pairs);
-  pairs = NULL;
-
-  /**
-   * while renaming a file, the new name can match with an existing file name, which is yet to be renamed.
-   * by sorting them in ascending and descending sort, files causing such conflicts will be renamed first, and thus renamer can work.
-   * try to rename all the failed files after sorting them in ascending order.
-   **/
-  if (!renamer_progress->cancel_all_remaining_runs && renamer_progress->pairs_failed_current_run != NULL)
-    {
-      GList *temp_pairs;
-      temp_pairs = thunar_renamer_pair_list_copy (renamer_progress->pairs_failed_current_run);
-      temp_pairs = g_list_sort (temp_pairs, thunar_renamer_pair_compare_ascending);
-      thunar_renamer_progress_run_helper (renamer_progress, temp_pairs);
-    }
 
-  /* try to rename all the failed files after sorting them in descending order */
-  if (!renamer_progress->cancel_all_remaining_runs && renamer_progress->pairs_failed_current_run != NULL)
+  if (renamer_progress->pairs_revert)
     {
-      GList *temp_pairs;
+      /* rename the files back to their previous names */
+      undo_pairs = thunar_renamer_executor_get_undo_pairs (renamer_progress->executor);
+      g_clear_object (&renamer_progress->executor);
 
-      /* make sure to show the error dialog box */
-      renamer_progress->show_dialog_on_error = TRUE;
-
-      temp_pairs = thunar_renamer_pair_list_copy (renamer_progress->pairs_failed_current_run);
-      temp_pairs = g_list_sort (temp_pairs, thunar_renamer_pair_compare_descending);
-      thunar_renamer_progress_run_helper (renamer_progress, temp_pairs);
+      renamer_progress->pairs_undo = TRUE;
+      thunar_renamer_progress_run_helper (renamer_progress, undo_pairs);
+      thunar_renamer_pair_list_free (undo_pairs);
+    }
+  else
+    {
+      /* allow to undo the renamed files from the history */
+      thunar_renamer_executor_commit_operation (renamer_progress->executor);
     }
 
-  /* release the list of completed items */
-  thunar_renamer_pair_list_free (renamer_progress->pairs_failed_current_run);
-  renamer_progress->pairs_failed_current_run = NULL;
+  g_clear_object (&renamer_progress->executor);
 
   /* release the additional reference on the progress */
   g_object_unref (G_OBJECT (renamer_progress));
 }
-
-
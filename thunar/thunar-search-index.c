@@ -0,0 +1,1062 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include <libxfce4util/libxfce4util.h>
+
+#include "thunar/thunar-gobject-extensions.h"
+#include "thunar/thunar-preferences.h"
+#include "thunar/thunar-private.h"
+#include "thunar/thunar-search-index.h"
+#include "thunar/thunar-util.h"
+
+/**
+ * SECTION:thunar-search-index
+ * @Short_description: Persistent filename index for recursive searches
+ * @Title: ThunarSearchIndex
+ *
+ * The single #ThunarSearchIndex instance keeps the (path, normalized display name,
+ * type, mtime) of every file below the folders listed in the "misc-search-index-roots"
+ * preference. Recursive searches below one of these roots are answered from the
+ * index instead of crawling the file system.
+ *
+ * The index of each root is stored in the user's cache directory, rebuilt
+ * periodically in a background thread and updated in between from the
+ * file monitors of the folders opened in thunar.
+ **/
+
+
+
+/* Minimum age of an index, in seconds, before the root is crawled again */
+#define THUNAR_SEARCH_INDEX_RESCAN_INTERVAL (6 * 60 * 60)
+
+/* Interval, in seconds, for checking the age of the indexes */
+#define THUNAR_SEARCH_INDEX_CHECK_INTERVAL  (10 * 60)
+
+/* Delay, in seconds, before writing an index modified by file monitor events */
+#define THUNAR_SEARCH_INDEX_SAVE_DELAY      30
+
+/* The first record of every index file */
+#define THUNAR_SEARCH_INDEX_MAGIC           "thunar-search-index-1"
+
+#define THUNAR_SEARCH_INDEX_ATTRIBUTES      G_FILE_ATTRIBUTE_STANDARD_TYPE "," \
+                                            G_FILE_ATTRIBUTE_STANDARD_NAME "," \
+                                            G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME "," \
+                                            G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN "," \
+                                            G_FILE_ATTRIBUTE_STANDARD_IS_BACKUP "," \
+                                            G_FILE_ATTRIBUTE_TIME_MODIFIED
+
+
+
+typedef struct _ThunarSearchIndexEntry ThunarSearchIndexEntry;
+typedef struct _ThunarSearchIndexRoot  ThunarSearchIndexRoot;
+
+
+
+static void     thunar_search_index_finalize      (GObject               *object);
+static void     thunar_search_index_roots_changed (ThunarSearchIndex     *index);
+static gboolean thunar_search_index_check         (gpointer               user_data);
+static void     thunar_search_index_schedule_save (ThunarSearchIndex     *index,
+                                                   ThunarSearchIndexRoot *root);
+static void     thunar_search_index_root_unref    (ThunarSearchIndexRoot *root);
+
+
+
+struct _ThunarSearchIndex
+{
+  GObject            __parent__;
+
+  ThunarPreferences *preferences;
+
+  /* protects the list of roots, which is read by the search jobs */
+  GMutex             mutex;
+  GList             *roots;
+
+  guint              check_timer_id;
+  guint              save_timer_id;
+};
+
+struct _ThunarSearchIndexEntry
+{
+  gchar     *path;   /* relative to the root */
+  gchar     *name_c; /* display name, normalized for searching */
+  GFileType  type;
+  gsize      hidden_length; /* length of the path up to its last hidden component, 0 if none */
+  guint64    mtime;
+};
+
+struct _ThunarSearchIndexRoot
+{
+  gint          ref_count;
+
+  GFile        *file;
+  gchar        *cache_path;
+  GCancellable *cancellable;
+
+  /* protects everything below, the entries are replaced by the crawler */
+  GMutex        mutex;
+  GHashTable   *entries;   /* relative path -> ThunarSearchIndexEntry, NULL until available */
+  gint64        scan_time; /* real time of the last crawl */
+  gboolean      scanning;
+  gboolean      dirty;
+};
+
+
+
+static ThunarSearchIndex *search_index;
+
+G_DEFINE_TYPE (ThunarSearchIndex, thunar_search_index, G_TYPE_OBJECT)
+
+
+
+static void
+thunar_search_index_class_init (ThunarSearchIndexClass *klass)
+{
+  GObjectClass *gobject_class;
+
+  gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->finalize = thunar_search_index_finalize;
+}
+
+
+
+static void
+thunar_search_index_init (ThunarSearchIndex *index)
+{
+  g_mutex_init (&index->mutex);
+
+  index->preferences = thunar_preferences_get ();
+  g_signal_connect_swapped (G_OBJECT (index->preferences), "notify::misc-search-index-roots",
+                            G_CALLBACK (thunar_search_index_roots_changed), index);
+
+  thunar_search_index_roots_changed (index);
+
+  index->check_timer_id = g_timeout_add_seconds (THUNAR_SEARCH_INDEX_CHECK_INTERVAL, thunar_search_index_check, index);
+}
+
+
+
+static void
+thunar_search_index_finalize (GObject *object)
+{
+  ThunarSearchIndex *index = THUNAR_SEARCH_INDEX (object);
+  GList             *lp;
+
+  g_signal_handlers_disconnect_by_data (G_OBJECT (index->preferences), index);
+  g_object_unref (G_OBJECT (index->preferences));
+
+  if (index->check_timer_id != 0)
+    g_source_remove (index->check_timer_id);
+  if (index->save_timer_id != 0)
+    g_source_remove (index->save_timer_id);
+
+  /* stop the crawlers, a running crawler holds its own reference on the root */
+  for (lp = index->roots; lp != NULL; lp = lp->next)
+    g_cancellable_cancel (((ThunarSearchIndexRoot *) lp->data)->cancellable);
+  g_list_free_full (index->roots, (GDestroyNotify) thunar_search_index_root_unref);
+
+  g_mutex_clear (&index->mutex);
+
+  (*G_OBJECT_CLASS (thunar_search_index_parent_class)->finalize) (object);
+}
+
+
+
+static void
+thunar_search_index_entry_free (gpointer data)
+{
+  ThunarSearchIndexEntry *entry = data;
+
+  g_free (entry->path);
+  g_free (entry->name_c);
+  g_slice_free (ThunarSearchIndexEntry, entry);
+}
+
+
+
+static GHashTable *
+thunar_search_index_entries_new (void)
+{
+  /* the key is owned by the entry */
+  return g_hash_table_new_full (g_str_hash, g_str_equal, NULL, thunar_search_index_entry_free);
+}
+
+
+
+static ThunarSearchIndexEntry *
+thunar_search_index_entry_new (const gchar            *path,
+                               GFileInfo              *info,
+                               ThunarSearchIndexEntry *parent)
+{
+  ThunarSearchIndexEntry *entry;
+
+  entry = g_slice_new (ThunarSearchIndexEntry);
+  entry->path = g_strdup (path);
+  entry->name_c = thunar_g_utf8_normalize_for_search (g_file_info_get_display_name (info), TRUE, TRUE);
+  entry->type = g_file_info_get_file_type (info);
+
+  /* same logic as thunar_file_is_hidden() */
+  if (g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_STANDARD_IS_HIDDEN)
+      || g_file_info_get_attribute_boolean (info, G_FILE_ATTRIBUTE_STANDARD_IS_BACKUP))
+    entry->hidden_length = strlen (path);
+  else
+    entry->hidden_length = (parent != NULL) ? parent->hidden_length : 0;
+
+  entry->mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+
+  return entry;
+}
+
+
+
+static ThunarSearchIndexRoot *
+thunar_search_index_root_new (GFile *file)
+{
+  ThunarSearchIndexRoot *root;
+  gchar                 *checksum;
+  gchar                 *spec;
+  gchar                 *uri;
+
+  root = g_slice_new0 (ThunarSearchIndexRoot);
+  root->ref_count = 1;
+  root->file = g_object_ref (file);
+  root->cancellable = g_cancellable_new ();
+  g_mutex_init (&root->mutex);
+
+  /* the index files are named after the root, like thumbnails */
+  uri = g_file_get_uri (file);
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, uri, -1);
+  spec = g_strconcat ("Thunar/search-index/", checksum, NULL);
+  root->cache_path = xfce_resource_save_location (XFCE_RESOURCE_CACHE, spec, TRUE);
+  g_free (spec);
+  g_free (checksum);
+  g_free (uri);
+
+  return root;
+}
+
+
+
+static ThunarSearchIndexRoot *
+thunar_search_index_root_ref (ThunarSearchIndexRoot *root)
+{
+  g_atomic_int_inc (&root->ref_count);
+  return root;
+}
+
+
+
+static void
+thunar_search_index_root_unref (ThunarSearchIndexRoot *root)
+{
+  if (!g_atomic_int_dec_and_test (&root->ref_count))
+    return;
+
+  if (root->entries != NULL)
+    g_hash_table_destroy (root->entries);
+  g_mutex_clear (&root->mutex);
+  g_object_unref (root->cancellable);
+  g_object_unref (root->file);
+  g_free (root->cache_path);
+  g_slice_free (ThunarSearchIndexRoot, root);
+}
+
+
+
+static GHashTable *
+thunar_search_index_root_load (ThunarSearchIndexRoot *root,
+                               gint64                *scan_time)
+{
+  ThunarSearchIndexEntry *entry;
+  GHashTable             *entries;
+  const gchar            *p, *end;
+  const gchar            *fields[5];
+  gchar                  *contents;
+  gsize                   length;
+  guint                   n;
+
+  if (root->cache_path == NULL || !g_file_get_contents (root->cache_path, &contents, &length, NULL))
+    return NULL;
+
+  /* the file is a sequence of nul-terminated fields, starting
+   * with the magic and the scan time, followed by the type,
+   * hidden length, mtime, path and normalized name of every entry */
+  p = contents;
+  end = contents + length;
+  if (length == 0 || end[-1] != '\0' || strcmp (p, THUNAR_SEARCH_INDEX_MAGIC) != 0)
+    {
+      g_free (contents);
+      return NULL;
+    }
+  p += strlen (p) + 1;
+  if (p >= end)
+    {
+      g_free (contents);
+      return NULL;
+    }
+  *scan_time = g_ascii_strtoll (p, NULL, 10);
+  p += strlen (p) + 1;
+
+  entries = thunar_search_index_entries_new ();
+  while (p < end)
+    {
+      for (n = 0; n < G_N_ELEMENTS (fields); n++)
+        {
+          if (G_UNLIKELY (p >= end))
+            break;
+          fields[n] = p;
+          p += strlen (p) + 1;
+        }
+
+      /* truncated file */
+      if (G_UNLIKELY (n < G_N_ELEMENTS (fields)))
+        break;
+
+      entry = g_slice_new (ThunarSearchIndexEntry);
+      entry->type = g_ascii_strtoull (fields[0], NULL, 10);
+      entry->hidden_length = g_ascii_strtoull (fields[1], NULL, 10);
+      entry->mtime = g_ascii_strtoull (fields[2], NULL, 10);
+      entry->path = g_strdup (fields[3]);
+      entry->name_c = g_strdup (fields[4]);
+      g_hash_table_replace (entries, entry->path, entry);
+    }
+
+  g_free (contents);
+
+  return entries;
+}
+
+
+
+static void
+thunar_search_index_root_save (ThunarSearchIndexRoot *root)
+{
+  ThunarSearchIndexEntry *entry;
+  GHashTableIter          iter;
+  GString                *contents;
+
+  if (root->cache_path == NULL)
+    return;
+
+  g_mutex_lock (&root->mutex);
+
+  if (root->entries == NULL)
+    {
+      g_mutex_unlock (&root->mutex);
+      return;
+    }
+
+  contents = g_string_sized_new (g_hash_table_size (root->entries) * 64);
+  g_string_append_len (contents, THUNAR_SEARCH_INDEX_MAGIC, sizeof (THUNAR_SEARCH_INDEX_MAGIC));
+  g_string_append_printf (contents, "%" G_GINT64_FORMAT, root->scan_time);
+  g_string_append_c (contents, '\0');
+
+  g_hash_table_iter_init (&iter, root->entries);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry))
+    {
+      g_string_append_printf (contents, "%u%c%" G_GSIZE_FORMAT "%c%" G_GUINT64_FORMAT "%c",
+                              (guint) entry->type, '\0', entry->hidden_length, '\0', entry->mtime, '\0');
+      g_string_append_len (contents, entry->path, strlen (entry->path) + 1);
+      g_string_append_len (contents, entry->name_c, strlen (entry->name_c) + 1);
+    }
+
+  root->dirty = FALSE;
+
+  g_mutex_unlock (&root->mutex);
+
+  g_file_set_contents (root->cache_path, contents->str, contents->len, NULL);
+  g_string_free (contents, TRUE);
+}
+
+
+
+static GHashTable *
+thunar_search_index_root_crawl (ThunarSearchIndexRoot *root)
+{
+  ThunarSearchIndexEntry *entry;
+  ThunarSearchIndexEntry *parent;
+  GFileEnumerator        *enumerator;
+  GHashTable             *entries;
+  GFileInfo              *info;
+  GQueue                  directories = G_QUEUE_INIT;
+  GFile                  *directory;
+  gchar                  *path;
+
+  entries = thunar_search_index_entries_new ();
+
+  /* walk the tree breadth first, remembering the entries still to enumerate */
+  g_queue_push_tail (&directories, NULL);
+  while (!g_queue_is_empty (&directories))
+    {
+      parent = g_queue_pop_head (&directories);
+      if (g_cancellable_is_cancelled (root->cancellable))
+        continue;
+
+      directory = (parent == NULL) ? g_object_ref (root->file) : g_file_resolve_relative_path (root->file, parent->path);
+
+      /* never follow symlinks, to prevent loops */
+      enumerator = g_file_enumerate_children (directory, THUNAR_SEARCH_INDEX_ATTRIBUTES,
+                                              G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                              root->cancellable, NULL);
+      if (enumerator == NULL)
+        {
+          g_object_unref (directory);
+          continue;
+        }
+
+      for (;;)
+        {
+          info = g_file_enumerator_next_file (enumerator, root->cancellable, NULL);
+          if (info == NULL)
+            break;
+
+          if (parent == NULL)
+            path = g_strdup (g_file_info_get_name (info));
+          else
+            path = g_build_filename (parent->path, g_file_info_get_name (info), NULL);
+
+          entry = thunar_search_index_entry_new (path, info, parent);
+          g_hash_table_replace (entries, entry->path, entry);
+
+          if (entry->type == G_FILE_TYPE_DIRECTORY)
+            g_queue_push_tail (&directories, entry);
+
+          g_free (path);
+          g_object_unref (info);
+        }
+
+      g_object_unref (enumerator);
+      g_object_unref (directory);
+    }
+
+  if (g_cancellable_is_cancelled (root->cancellable))
+    {
+      g_hash_table_destroy (entries);
+      return NULL;
+    }
+
+  return entries;
+}
+
+
+
+static gpointer
+thunar_search_index_root_update_thread (gpointer user_data)
+{
+  ThunarSearchIndexRoot *root = user_data;
+  GHashTable            *entries;
+  gboolean               loaded;
+  gint64                 scan_time = 0;
+
+  /* pick up the index of the last session first */
+  g_mutex_lock (&root->mutex);
+  loaded = (root->entries != NULL);
+  g_mutex_unlock (&root->mutex);
+
+  if (!loaded)
+    {
+      entries = thunar_search_index_root_load (root, &scan_time);
+      if (entries != NULL)
+        {
+          g_mutex_lock (&root->mutex);
+          root->entries = entries;
+          root->scan_time = scan_time;
+          g_mutex_unlock (&root->mutex);
+        }
+    }
+  else
+    {
+      g_mutex_lock (&root->mutex);
+      scan_time = root->scan_time;
+      g_mutex_unlock (&root->mutex);
+    }
+
+  /* crawl the root if the index is missing or too old */
+  if (g_get_real_time () / G_USEC_PER_SEC - scan_time >= THUNAR_SEARCH_INDEX_RESCAN_INTERVAL)
+    {
+      scan_time = g_get_real_time () / G_USEC_PER_SEC;
+      entries = thunar_search_index_root_crawl (root);
+      if (entries != NULL)
+        {
+          g_mutex_lock (&root->mutex);
+          if (root->entries != NULL)
+            g_hash_table_destroy (root->entries);
+          root->entries = entries;
+          root->scan_time = scan_time;
+          g_mutex_unlock (&root->mutex);
+
+          thunar_search_index_root_save (root);
+        }
+    }
+
+  g_mutex_lock (&root->mutex);
+  root->scanning = FALSE;
+  g_mutex_unlock (&root->mutex);
+
+  thunar_search_index_root_unref (root);
+
+  return NULL;
+}
+
+
+
+static void
+thunar_search_index_root_update (ThunarSearchIndexRoot *root)
+{
+  GThread *thread;
+
+  g_mutex_lock (&root->mutex);
+  if (root->scanning)
+    {
+      g_mutex_unlock (&root->mutex);
+      return;
+    }
+  root->scanning = TRUE;
+  g_mutex_unlock (&root->mutex);
+
+  thread = g_thread_try_new ("thunar-search-index", thunar_search_index_root_update_thread,
+                             thunar_search_index_root_ref (root), NULL);
+  if (G_LIKELY (thread != NULL))
+    {
+      g_thread_unref (thread);
+      return;
+    }
+
+  g_mutex_lock (&root->mutex);
+  root->scanning = FALSE;
+  g_mutex_unlock (&root->mutex);
+  thunar_search_index_root_unref (root);
+}
+
+
+
+static void
+thunar_search_index_roots_changed (ThunarSearchIndex *index)
+{
+  ThunarSearchIndexRoot *root;
+  GList                 *roots = NULL;
+  GList                 *old_roots;
+  GList                 *lp;
+  GFile                 *file;
+  gchar                 *roots_string;
+  gchar                **paths;
+  guint                  n;
+
+  g_object_get (G_OBJECT (index->preferences), "misc-search-index-roots", &roots_string, NULL);
+  paths = g_strsplit (roots_string != NULL ? roots_string : "", ";", -1);
+  g_free (roots_string);
+
+  g_mutex_lock (&index->mutex);
+  old_roots = index->roots;
+
+  for (n = 0; paths[n] != NULL; n++)
+    {
+      g_strstrip (paths[n]);
+      if (!g_path_is_absolute (paths[n]))
+        continue;
+
+      file = g_file_new_for_path (paths[n]);
+
+      /* keep the index of roots which are still configured */
+      for (lp = old_roots, root = NULL; lp != NULL; lp = lp->next)
+        if (g_file_equal (((ThunarSearchIndexRoot *) lp->data)->file, file))
+          {
+            root = lp->data;
+            old_roots = g_list_delete_link (old_roots, lp);
+            break;
+          }
+
+      if (root == NULL)
+        root = thunar_search_index_root_new (file);
+
+      roots = g_list_append (roots, root);
+      g_object_unref (file);
+    }
+
+  index->roots = roots;
+  g_mutex_unlock (&index->mutex);
+
+  g_strfreev (paths);
+
+  /* stop indexing the roots that are no longer configured */
+  for (lp = old_roots; lp != NULL; lp = lp->next)
+    g_cancellable_cancel (((ThunarSearchIndexRoot *) lp->data)->cancellable);
+  g_list_free_full (old_roots, (GDestroyNotify) thunar_search_index_root_unref);
+
+  /* load or build the indexes of new roots */
+  for (lp = roots; lp != NULL; lp = lp->next)
+    thunar_search_index_root_update (lp->data);
+}
+
+
+
+static gboolean
+thunar_search_index_check (gpointer user_data)
+{
+  ThunarSearchIndex *index = THUNAR_SEARCH_INDEX (user_data);
+  GList             *lp;
+
+  /* the update threads only crawl the roots with an outdated index */
+  for (lp = index->roots; lp != NULL; lp = lp->next)
+    thunar_search_index_root_update (lp->data);
+
+  return G_SOURCE_CONTINUE;
+}
+
+
+
+static gpointer
+thunar_search_index_root_save_thread (gpointer user_data)
+{
+  ThunarSearchIndexRoot *root = user_data;
+
+  thunar_search_index_root_save (root);
+  thunar_search_index_root_unref (root);
+
+  return NULL;
+}
+
+
+
+static gboolean
+thunar_search_index_save (gpointer user_data)
+{
+  ThunarSearchIndex     *index = THUNAR_SEARCH_INDEX (user_data);
+  ThunarSearchIndexRoot *root;
+  GThread               *thread;
+  gboolean               dirty;
+  GList                 *lp;
+
+  index->save_timer_id = 0;
+
+  for (lp = index->roots; lp != NULL; lp = lp->next)
+    {
+      root = lp->data;
+
+      /* a running crawl saves the index anyway */
+      g_mutex_lock (&root->mutex);
+      dirty = root->dirty && !root->scanning;
+      g_mutex_unlock (&root->mutex);
+
+      /* writing millions of entries takes a moment, do it in the background */
+      if (dirty)
+        {
+          thread = g_thread_try_new ("thunar-search-index", thunar_search_index_root_save_thread,
+                                     thunar_search_index_root_ref (root), NULL);
+          if (G_LIKELY (thread != NULL))
+            g_thread_unref (thread);
+          else
+            thunar_search_index_root_unref (root);
+        }
+    }
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+static void
+thunar_search_index_schedule_save (ThunarSearchIndex     *index,
+                                   ThunarSearchIndexRoot *root)
+{
+  root->dirty = TRUE;
+
+  if (index->save_timer_id == 0)
+    index->save_timer_id = g_timeout_add_seconds (THUNAR_SEARCH_INDEX_SAVE_DELAY, thunar_search_index_save, index);
+}
+
+
+
+/* must be called with the root locked */
+static void
+thunar_search_index_root_remove (ThunarSearchIndexRoot *root,
+                                 const gchar           *path)
+{
+  GHashTableIter iter;
+  const gchar   *key;
+  gsize          length;
+
+  if (!g_hash_table_remove (root->entries, path))
+    return;
+
+  /* drop everything below a removed folder */
+  length = strlen (path);
+  g_hash_table_iter_init (&iter, root->entries);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &key, NULL))
+    if (strncmp (key, path, length) == 0 && key[length] == G_DIR_SEPARATOR)
+      g_hash_table_iter_remove (&iter);
+}
+
+
+
+/* must be called with the root locked */
+static void
+thunar_search_index_root_move (ThunarSearchIndexRoot  *root,
+                               const gchar            *path,
+                               ThunarSearchIndexEntry *new_entry)
+{
+  ThunarSearchIndexEntry *entry;
+  GHashTableIter          iter;
+  GPtrArray              *moved;
+  gchar                  *moved_path;
+  gsize                   length;
+  gsize                   new_length;
+  guint                   n;
+
+  /* pick up the entries of the folder contents */
+  moved = g_ptr_array_new ();
+  length = strlen (path);
+  g_hash_table_iter_init (&iter, root->entries);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry))
+    if (strncmp (entry->path, path, length) == 0 && entry->path[length] == G_DIR_SEPARATOR)
+      {
+        g_ptr_array_add (moved, entry);
+        g_hash_table_iter_steal (&iter);
+      }
+
+  /* and re-insert them with their new path */
+  new_length = strlen (new_entry->path);
+  for (n = 0; n < moved->len; n++)
+    {
+      entry = g_ptr_array_index (moved, n);
+      moved_path = g_strconcat (new_entry->path, entry->path + length, NULL);
+      g_free (entry->path);
+      entry->path = moved_path;
+
+      /* hidden components below the folder keep their position relative to it */
+      if (entry->hidden_length > length)
+        entry->hidden_length = entry->hidden_length - length + new_length;
+      else
+        entry->hidden_length = new_entry->hidden_length;
+
+      g_hash_table_replace (root->entries, entry->path, entry);
+    }
+
+  g_ptr_array_free (moved, TRUE);
+}
+
+
+
+/* must be called with the root locked */
+static ThunarSearchIndexEntry *
+thunar_search_index_root_add (ThunarSearchIndexRoot *root,
+                              GFile                 *file,
+                              const gchar           *path)
+{
+  ThunarSearchIndexEntry *entry;
+  ThunarSearchIndexEntry *parent = NULL;
+  GFileInfo              *info;
+  gchar                  *parent_path;
+
+  info = g_file_query_info (file, THUNAR_SEARCH_INDEX_ATTRIBUTES, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, NULL, NULL);
+  if (info == NULL)
+    return NULL;
+
+  parent_path = g_path_get_dirname (path);
+  if (strcmp (parent_path, ".") != 0)
+    parent = g_hash_table_lookup (root->entries, parent_path);
+  g_free (parent_path);
+
+  entry = thunar_search_index_entry_new (path, info, parent);
+  g_hash_table_replace (root->entries, entry->path, entry);
+
+  g_object_unref (info);
+
+  return entry;
+}
+
+
+
+/* returns a locked root containing @file and the path of @file relative to it */
+static ThunarSearchIndexRoot *
+thunar_search_index_lock_root (ThunarSearchIndex *index,
+                               GFile             *file,
+                               gchar            **path)
+{
+  ThunarSearchIndexRoot *root;
+  GList                 *lp;
+
+  for (lp = index->roots; lp != NULL; lp = lp->next)
+    {
+      root = lp->data;
+      if (g_file_has_prefix (file, root->file))
+        {
+          g_mutex_lock (&root->mutex);
+          if (root->entries == NULL)
+            {
+              g_mutex_unlock (&root->mutex);
+              return NULL;
+            }
+
+          *path = g_file_get_relative_path (root->file, file);
+          return root;
+        }
+    }
+
+  return NULL;
+}
+
+
+
+/**
+ * thunar_search_index_get_default:
+ *
+ * Returns a reference to the default #ThunarSearchIndex
+ * instance, which starts indexing the configured roots.
+ *
+ * The caller is responsible to free the returned instance
+ * using g_object_unref() when no longer needed.
+ *
+ * Return value: the default #ThunarSearchIndex instance.
+ **/
+ThunarSearchIndex *
+thunar_search_index_get_default (void)
+{
+  if (G_UNLIKELY (search_index == NULL))
+    {
+      search_index = g_object_new (THUNAR_TYPE_SEARCH_INDEX, NULL);
+      g_object_add_weak_pointer (G_OBJECT (search_index), (gpointer) &search_index);
+    }
+  else
+    {
+      /* take a reference for the caller */
+      g_object_ref (G_OBJECT (search_index));
+    }
+
+  return search_index;
+}
+
+
+
+/**
+ * thunar_search_index_file_changed:
+ * @event_file : the #GFile the monitor event is about.
+ * @other_file : the new #GFile for renames and moves, or %NULL.
+ * @event_type : the #GFileMonitorEvent.
+ *
+ * Updates the index for an event of a #GFileMonitor, to keep it
+ * valid between two crawls of its root. Does nothing if there is
+ * no index or @event_file is not below one of the indexed roots.
+ *
+ * Must be called from the main thread.
+ **/
+void
+thunar_search_index_file_changed (GFile            *event_file,
+                                  GFile            *other_file,
+                                  GFileMonitorEvent event_type)
+{
+  ThunarSearchIndexEntry *entry;
+  ThunarSearchIndexRoot *root;
+  ThunarSearchIndexRoot *other_root;
+  gchar                 *path = NULL;
+  gchar                 *other_path = NULL;
+
+  _thunar_return_if_fail (G_IS_FILE (event_file));
+
+  if (search_index == NULL || search_index->roots == NULL)
+    return;
+
+  switch (event_type)
+    {
+    case G_FILE_MONITOR_EVENT_CREATED:
+    case G_FILE_MONITOR_EVENT_MOVED_IN:
+    case G_FILE_MONITOR_EVENT_CHANGES_DONE_HINT:
+    case G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED:
+      root = thunar_search_index_lock_root (search_index, event_file, &path);
+      if (root == NULL)
+        break;
+      thunar_search_index_root_add (root, event_file, path);
+
+      /* the contents of a moved in folder are only known after the next crawl */
+      if (event_type == G_FILE_MONITOR_EVENT_MOVED_IN)
+        root->scan_time = 0;
+
+      thunar_search_index_schedule_save (search_index, root);
+      g_mutex_unlock (&root->mutex);
+      break;
+
+    case G_FILE_MONITOR_EVENT_DELETED:
+    case G_FILE_MONITOR_EVENT_MOVED_OUT:
+      root = thunar_search_index_lock_root (search_index, event_file, &path);
+      if (root == NULL)
+        break;
+      thunar_search_index_root_remove (root, path);
+      thunar_search_index_schedule_save (search_index, root);
+      g_mutex_unlock (&root->mutex);
+      break;
+
+    case G_FILE_MONITOR_EVENT_RENAMED:
+      if (other_file == NULL)
+        break;
+
+      root = thunar_search_index_lock_root (search_index, event_file, &path);
+      if (root != NULL)
+        {
+          /* only renames within the root can keep the folder contents */
+          other_path = g_file_get_relative_path (root->file, other_file);
+          if (other_path != NULL)
+            {
+              thunar_search_index_root_remove (root, other_path);
+              entry = thunar_search_index_root_add (root, other_file, other_path);
+              if (entry != NULL)
+                thunar_search_index_root_move (root, path, entry);
+              thunar_search_index_root_remove (root, path);
+            }
+          else
+            {
+              thunar_search_index_root_remove (root, path);
+            }
+          thunar_search_index_schedule_save (search_index, root);
+          g_mutex_unlock (&root->mutex);
+        }
+
+      /* renamed into another root */
+      if (other_path == NULL)
+        {
+          other_root = thunar_search_index_lock_root (search_index, other_file, &other_path);
+          if (other_root != NULL)
+            {
+              thunar_search_index_root_add (other_root, other_file, other_path);
+              other_root->scan_time = 0;
+              thunar_search_index_schedule_save (search_index, other_root);
+              g_mutex_unlock (&other_root->mutex);
+            }
+        }
+      break;
+
+    default:
+      break;
+    }
+
+  g_free (path);
+  g_free (other_path);
+}
+
+
+
+/**
+ * thunar_search_index_search:
+ * @directory            : the #GFile of the folder to search recursively.
+ * @matcher              : the compiled search terms.
+ * @show_hidden          : whether to include hidden files and the contents of hidden folders.
+ * @cancellable          : a #GCancellable or %NULL.
+ * @matches              : return location for the list of matching #GFile<!---->s.
+ *
+ * Searches @directory and its subfolders for files matching
+ * @matcher, using the index of the root containing
+ * @directory. The caller must free the returned @matches with
+ * thunar_g_list_free_full().
+ *
+ * May be called from any thread.
+ *
+ * Return value: %FALSE if @directory is not covered by an available
+ *               index or the query has predicates on attributes the
+ *               index doesn't know, in which case @matches is not set.
+ **/
+gboolean
+thunar_search_index_search (GFile                     *directory,
+                            const ThunarSearchMatcher *matcher,
+                            gboolean                   show_hidden,
+                            GCancellable              *cancellable,
+                            GList                    **matches)
+{
+  ThunarSearchIndexEntry *entry;
+  ThunarSearchIndexRoot  *root = NULL;
+  GHashTableIter          iter;
+  GPtrArray              *paths;
+  GList                  *lp;
+  gchar                  *path = NULL;
+  gsize                   length = 0;
+  guint                   n;
+
+  _thunar_return_val_if_fail (G_IS_FILE (directory), FALSE);
+  _thunar_return_val_if_fail (matches != NULL, FALSE);
+
+  if (search_index == NULL || thunar_util_search_matcher_has_predicates (matcher))
+    return FALSE;
+
+  g_mutex_lock (&search_index->mutex);
+
+  for (lp = search_index->roots; lp != NULL; lp = lp->next)
+    {
+      if (g_file_equal (directory, ((ThunarSearchIndexRoot *) lp->data)->file)
+          || g_file_has_prefix (directory, ((ThunarSearchIndexRoot *) lp->data)->file))
+        {
+          root = lp->data;
+          break;
+        }
+    }
+
+  if (root == NULL)
+    {
+      g_mutex_unlock (&search_index->mutex);
+      return FALSE;
+    }
+
+  g_mutex_lock (&root->mutex);
+  g_mutex_unlock (&search_index->mutex);
+
+  if (root->entries == NULL)
+    {
+      g_mutex_unlock (&root->mutex);
+      return FALSE;
+    }
+
+  path = g_file_get_relative_path (root->file, directory);
+  if (path != NULL)
+    length = strlen (path);
+
+  paths = g_ptr_array_new ();
+  g_hash_table_iter_init (&iter, root->entries);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry))
+    {
+      /* only look below the searched folder */
+      if (path != NULL && (strncmp (entry->path, path, length) != 0 || entry->path[length] != G_DIR_SEPARATOR))
+        continue;
+
+      if (!thunar_util_search_matcher_match_normalized (matcher, entry->name_c))
+        continue;
+
+      /* like the crawling search, only skip what's hidden below
+       * the searched folder, not the folder itself */
+      if (!show_hidden && entry->hidden_length > length)
+        continue;
+
+      g_ptr_array_add (paths, g_strdup (entry->path));
+
+      if (G_UNLIKELY (g_cancellable_is_cancelled (cancellable)))
+        break;
+    }
+
+  g_mutex_unlock (&root->mutex);
+
+  *matches = NULL;
+  for (n = paths->len; n > 0; n--)
+    {
+      *matches = g_list_prepend (*matches, g_file_resolve_relative_path (root->file, g_ptr_array_index (paths, n - 1)));
+      g_free (g_ptr_array_index (paths, n - 1));
+    }
+
+  g_ptr_array_free (paths, TRUE);
+  g_free (path);
+
+  return TRUE;
+}
@@ -0,0 +1,43 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __THUNAR_SEARCH_INDEX_H__
+#define __THUNAR_SEARCH_INDEX_H__
+
+#include <gio/gio.h>
+
+#include "thunar/thunar-util.h"
+
+G_BEGIN_DECLS
+
+#define THUNAR_TYPE_SEARCH_INDEX (thunar_search_index_get_type ())
+G_DECLARE_FINAL_TYPE (ThunarSearchIndex, thunar_search_index, THUNAR, SEARCH_INDEX, GObject)
+
+ThunarSearchIndex *thunar_search_index_get_default  (void);
+
+void               thunar_search_index_file_changed (GFile               *event_file,
+                                                     GFile               *other_file,
+                                                     GFileMonitorEvent    event_type);
+
+gboolean           thunar_search_index_search       (GFile                     *directory,
+                                                     const ThunarSearchMatcher *matcher,
+                                                     gboolean                   show_hidden,
+                                                     GCancellable              *cancellable,
+                                                     GList                    **matches);
+
+G_END_DECLS
+
+#endif /* !__THUNAR_SEARCH_INDEX_H__ */
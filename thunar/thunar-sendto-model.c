@@ -45,6 +45,7 @@ static void thunar_sendto_model_event      (GFileMonitor           *monitor,
                                             GFile                  *other_file,
                                             GFileMonitorEvent       event_type,
                                             gpointer                user_data);
+static gboolean thunar_sendto_model_reload (gpointer                user_data);
 
 
 
@@ -58,6 +59,7 @@ struct _ThunarSendtoModel
   GObject __parent__;
   GList  *monitors;
   GList  *handlers;
+  guint   reload_id;
   guint   loaded : 1;
 };
 
@@ -92,6 +94,9 @@ thunar_sendto_model_finalize (GObject *object)
   ThunarSendtoModel *sendto_model = THUNAR_SENDTO_MODEL (object);
   GList             *lp;
 
+  if (G_UNLIKELY (sendto_model->reload_id != 0))
+    g_source_remove (sendto_model->reload_id);
+
   /* release the handlers */
   g_list_free_full (sendto_model->handlers, g_object_unref);
 
@@ -189,6 +194,21 @@ thunar_sendto_model_event (GFileMonitor     *monitor,
 {
   ThunarSendtoModel *sendto_model = THUNAR_SENDTO_MODEL (user_data);
 
+  /* installing a package sends several events at once, parse the
+   * .desktop files again only once they are all in */
+  if (sendto_model->reload_id == 0)
+    sendto_model->reload_id = g_timeout_add (250, thunar_sendto_model_reload, sendto_model);
+}
+
+
+
+static gboolean
+thunar_sendto_model_reload (gpointer user_data)
+{
+  ThunarSendtoModel *sendto_model = THUNAR_SENDTO_MODEL (user_data);
+
+  sendto_model->reload_id = 0;
+
   /* release the previously loaded handlers */
   if (G_LIKELY (sendto_model->handlers != NULL))
     {
@@ -198,6 +218,8 @@ thunar_sendto_model_event (GFileMonitor     *monitor,
 
   /* reload the handlers for the model */
   thunar_sendto_model_load (sendto_model);
+
+  return G_SOURCE_REMOVE;
 }
 
 
@@ -216,17 +238,12 @@ thunar_sendto_model_get_default (void)
 {
   static ThunarSendtoModel *sendto_model = NULL;
 
+  /* the model is kept for the lifetime of the process, the monitors keep
+   * it current, so the .desktop files are not parsed for every menu */
   if (G_UNLIKELY (sendto_model == NULL))
-    {
-      sendto_model = g_object_new (THUNAR_TYPE_SENDTO_MODEL, NULL);
-      g_object_add_weak_pointer (G_OBJECT (sendto_model), (gpointer) &sendto_model);
-    }
-  else
-    {
-      g_object_ref (G_OBJECT (sendto_model));
-    }
+    sendto_model = g_object_new (THUNAR_TYPE_SENDTO_MODEL, NULL);
 
-  return sendto_model;
+  return g_object_ref (G_OBJECT (sendto_model));
 }
 
 
@@ -257,9 +274,14 @@ thunar_sendto_model_get_matching (ThunarSendtoModel *sendto_model,
   gchar       **datadirs;
   gchar        *dir;
   GList        *handlers = NULL;
+  GList        *content_types = NULL;
+  GHashTable   *seen_types;
   GList        *hp;
   GList        *fp;
+  GList        *tp;
   guint         n;
+  gboolean      has_remote_files = FALSE;
+  gboolean      has_untyped_files = FALSE;
   const gchar **mime_types;
   const gchar  *content_type;
 
@@ -297,38 +319,44 @@ thunar_sendto_model_get_matching (ThunarSendtoModel *sendto_model,
       thunar_sendto_model_load (sendto_model);
     }
 
+  /* a selection has a lot of files but only a few content types, so
+   * the handlers are matched against the distinct types only */
+  seen_types = g_hash_table_new (g_str_hash, g_str_equal);
+  for (fp = files; fp != NULL; fp = fp->next)
+    {
+      if (!has_remote_files && !thunar_file_is_local (fp->data))
+        has_remote_files = TRUE;
+
+      content_type = thunar_file_get_content_type (fp->data);
+      if (G_UNLIKELY (content_type == NULL))
+        has_untyped_files = TRUE;
+      else if (g_hash_table_add (seen_types, (gpointer) content_type))
+        content_types = g_list_prepend (content_types, (gpointer) content_type);
+    }
+
   /* test all handlers */
   for (hp = sendto_model->handlers; hp != NULL; hp = hp->next)
     {
       /* FIXME Ignore GAppInfos which don't support multiple file arguments */
 
       /* ignore the handler if it doesn't support URIs, but we don't have a local file */
-      if (!g_app_info_supports_uris (hp->data))
-        {
-          /* check if we have any non-local files */
-          for (fp = files; fp != NULL; fp = fp->next)
-            if (!thunar_file_is_local (fp->data))
-              break;
-
-          /* check if the test failed */
-          if (G_UNLIKELY (fp != NULL))
-            continue;
-        }
+      if (has_remote_files && !g_app_info_supports_uris (hp->data))
+        continue;
 
       /* check if we need to test mime types for this handler */
       mime_types = g_object_get_data (G_OBJECT (hp->data), "mime-types");
       if (mime_types != NULL)
         {
-          /* each file must match atleast one of the specified mime types */
-          for (fp = files; fp != NULL; fp = fp->next)
+          /* files without a content type match no mime type */
+          if (has_untyped_files)
+            continue;
+
+          /* each content type must match atleast one of the specified mime types */
+          for (tp = content_types; tp != NULL; tp = tp->next)
             {
-              /* each file must be supported by one of the mime types */
               for (n = 0; mime_types[n] != NULL; ++n)
-                {
-                  content_type = thunar_file_get_content_type (fp->data);
-                  if (g_content_type_equals (content_type, mime_types[n]))
-                    break;
-                }
+                if (g_content_type_equals (tp->data, mime_types[n]))
+                  break;
 
               /* check if all mime types failed */
               if (mime_types[n] == NULL)
@@ -336,7 +364,7 @@ thunar_sendto_model_get_matching (ThunarSendtoModel *sendto_model,
             }
 
           /* check if the test failed */
-          if (G_UNLIKELY (fp != NULL))
+          if (G_UNLIKELY (tp != NULL))
             continue;
         }
 
@@ -344,6 +372,9 @@ thunar_sendto_model_get_matching (ThunarSendtoModel *sendto_model,
       handlers = g_list_prepend (handlers, g_object_ref (G_OBJECT (hp->data)));
     }
 
+  g_list_free (content_types);
+  g_hash_table_destroy (seen_types);
+
   return handlers;
 }
 
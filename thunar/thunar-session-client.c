@@ -303,7 +303,7 @@ thunar_session_client_restore (ThunarSessionClient *session_client)
       thunar_application_take_window (application, GTK_WINDOW (window));
       gtk_widget_show (window);
 
-      /* open tabs */
+      /* open tabs, only the active one loads its folder right away */
       if (!thunar_window_set_directories (THUNAR_WINDOW (window), uris, active_tab))
         {
           /* no tabs were opened */
@@ -216,7 +216,7 @@ thunar_shortcuts_icon_renderer_render (GtkCellRenderer     *renderer,
   GdkRectangle                 clip_area;
   GtkIconInfo                 *icon_info;
   GdkPixbuf                   *icon = NULL;
-  GdkPixbuf                   *temp;
+  cairo_surface_t             *surface;
   GIcon                       *gicon;
   gdouble                      alpha;
   gint                         scale_factor;
@@ -254,22 +254,12 @@ thunar_shortcuts_icon_renderer_render (GtkCellRenderer     *renderer,
       /* render the icon (if any) */
       if (G_LIKELY (icon != NULL))
         {
-          /* determine the real icon size */
-          icon_area.width = gdk_pixbuf_get_width (icon) / scale_factor;
-          icon_area.height = gdk_pixbuf_get_height (icon) / scale_factor;
+          /* get the cached surface of the icon, scaled down to fit the cell */
+          surface = thunar_gdk_pixbuf_get_surface (icon, MAX (1, cell_area->width * scale_factor), MAX (1, cell_area->height * scale_factor), scale_factor);
 
-          /* scale down the icon on-demand */
-          if (G_UNLIKELY (icon_area.width > cell_area->width || icon_area.height > cell_area->height))
-            {
-              /* scale down to fit */
-              temp = exo_gdk_pixbuf_scale_down (icon, TRUE, MAX (1, cell_area->width * scale_factor), MAX (1, cell_area->height * scale_factor));
-              g_object_unref (G_OBJECT (icon));
-              icon = temp;
-
-              /* determine the icon dimensions again */
-              icon_area.width = gdk_pixbuf_get_width (icon) / scale_factor;
-              icon_area.height = gdk_pixbuf_get_height (icon) / scale_factor;
-            }
+          /* determine the real icon size */
+          icon_area.width = cairo_image_surface_get_width (surface) / scale_factor;
+          icon_area.height = cairo_image_surface_get_height (surface) / scale_factor;
 
           /* 50% translucent for unmounted volumes */
           if (shortcuts_icon_renderer->device != NULL
@@ -285,7 +275,7 @@ thunar_shortcuts_icon_renderer_render (GtkCellRenderer     *renderer,
           if (gdk_rectangle_intersect (&clip_area, &icon_area, NULL))
             {
               /* render the invalid parts of the icon */
-              thunar_gdk_cairo_set_source_pixbuf (cr, icon, icon_area.x, icon_area.y, scale_factor);
+              cairo_set_source_surface (cr, surface, icon_area.x, icon_area.y);
               cairo_paint_with_alpha (cr, alpha);
             }
 
@@ -42,6 +42,8 @@
 #include "thunar/thunar-file.h"
 #include "thunar/thunar-shortcuts-model.h"
 #include "thunar/thunar-device-monitor.h"
+#include "thunar/thunar-filesystem-cache.h"
+#include "thunar/thunar-gio-extensions.h"
 #include "thunar/thunar-preferences.h"
 #include "thunar/thunar-util.h"
 #include "thunar/thunar-private.h"
@@ -49,13 +51,20 @@
 #define SPINNER_CYCLE_DURATION 1000
 #define SPINNER_NUM_STEPS      12
 
+/* the disk usage of the devices is taken from the ThunarFilesystemCache, never in
+ * the getters. New values of the cache are picked up after DISK_USAGE_DELAY (in ms),
+ * and every DISK_USAGE_INTERVAL (in seconds) the cache is asked to refresh old ones */
+#define DISK_USAGE_DELAY       250
+#define DISK_USAGE_INTERVAL    30
+
 
 
 #define THUNAR_SHORTCUT(obj) ((ThunarShortcut *) (obj))
 
 
 
-typedef struct _ThunarShortcut ThunarShortcut;
+typedef struct _ThunarShortcut        ThunarShortcut;
+typedef struct _ThunarShortcutResolve ThunarShortcutResolve;
 
 
 
@@ -125,6 +134,20 @@ static void               thunar_shortcuts_model_add_shortcut       (ThunarShort
                                                                      ThunarShortcut            *shortcut);
 static void               thunar_shortcuts_model_remove_shortcut    (ThunarShortcutsModel      *model,
                                                                      ThunarShortcut            *shortcut);
+static void               thunar_shortcuts_model_unlink_shortcut    (ThunarShortcutsModel      *model,
+                                                                     ThunarShortcut            *shortcut);
+static void               thunar_shortcuts_model_shortcut_changed   (ThunarShortcutsModel      *model,
+                                                                     ThunarShortcut            *shortcut);
+static void               thunar_shortcuts_model_shortcut_busy      (ThunarShortcutsModel      *model,
+                                                                     ThunarShortcut            *shortcut,
+                                                                     gboolean                   busy);
+static void               thunar_shortcuts_model_resort             (ThunarShortcutsModel      *model);
+static void               thunar_shortcuts_model_resolve            (ThunarShortcutsModel      *model,
+                                                                     ThunarShortcut            *shortcut);
+static void               thunar_shortcuts_model_resolve_finish     (GObject                   *object,
+                                                                     GAsyncResult              *result,
+                                                                     gpointer                   user_data);
+static gboolean           thunar_shortcuts_model_resolve_timeout    (gpointer                   user_data);
 static gboolean           thunar_shortcuts_model_load               (gpointer                   data);
 static void               thunar_shortcuts_model_save               (ThunarShortcutsModel      *model);
 static void               thunar_shortcuts_model_monitor            (GFileMonitor              *monitor,
@@ -147,6 +170,15 @@ static void               thunar_shortcuts_model_file_destroyed     (ThunarFile
                                                                      ThunarShortcutsModel      *model);
 static void               thunar_shortcut_free                      (ThunarShortcut            *shortcut,
                                                                      ThunarShortcutsModel      *model);
+static gboolean           thunar_shortcuts_model_busy_timeout       (gpointer                   data);
+static gboolean           thunar_shortcuts_model_update_disk_usage  (ThunarShortcutsModel      *model,
+                                                                     ThunarShortcut            *shortcut);
+static void               thunar_shortcuts_model_refresh_disk_usage (ThunarShortcutsModel      *model);
+static gboolean           thunar_shortcuts_model_disk_usage_timeout (gpointer                   data);
+static void               thunar_shortcuts_model_filesystem_changed (ThunarFilesystemCache     *filesystem_cache,
+                                                                     GFile                     *root,
+                                                                     ThunarShortcutsModel      *model);
+static void               thunar_shortcuts_model_busy_timeout_destroyed (gpointer               data);
 
 
 
@@ -181,6 +213,11 @@ struct _ThunarShortcutsModel
   guint                 bookmarks_idle_id;
 
   guint                 busy_timeout_id;
+
+  /* the disk usage of the devices, see DISK_USAGE_DELAY */
+  ThunarFilesystemCache *filesystem_cache;
+  guint                 disk_usage_timeout_id;
+  guint                 disk_usage_interval_id;
 };
 
 struct _ThunarShortcut
@@ -190,6 +227,7 @@ struct _ThunarShortcut
   gchar               *name;
   GIcon               *gicon;
   gchar               *tooltip;
+  gchar               *disk_usage;
   gint                 sort_id;
 
   guint                busy : 1;
@@ -200,6 +238,34 @@ struct _ThunarShortcut
   ThunarDevice        *device;
 
   guint                hidden : 1;
+
+  /* bookmark that is still being resolved to a ThunarFile */
+  ThunarShortcutResolve *resolve;
+};
+
+struct _ThunarShortcutResolve
+{
+  ThunarShortcutsModel *model;
+  ThunarShortcut       *shortcut;
+  GCancellable         *cancellable;
+  guint                 timeout_id;
+};
+
+
+
+/* how long the spinner is shown for a bookmark that is being
+ * resolved; the bookmark keeps its placeholder after the timeout,
+ * but is still filled in when the server responds eventually
+ */
+static const struct
+{
+  const gchar *scheme;
+  guint        timeout; /* seconds */
+} resolve_timeouts[] =
+{
+  { "file",     5 },
+  { "computer", 2 },
+  { "recent",   2 },
 };
 
 
@@ -291,6 +357,12 @@ thunar_shortcuts_model_init (ThunarShortcutsModel *model)
                           model,              "file-size-binary",
                           G_BINDING_SYNC_CREATE);
 
+  /* the disk usage of the devices, before they are loaded */
+  model->filesystem_cache = thunar_filesystem_cache_get_default ();
+  g_signal_connect (G_OBJECT (model->filesystem_cache), "changed",
+                    G_CALLBACK (thunar_shortcuts_model_filesystem_changed), model);
+  model->disk_usage_interval_id = g_timeout_add_seconds (DISK_USAGE_INTERVAL, thunar_shortcuts_model_disk_usage_timeout, model);
+
   /* load volumes */
   thunar_shortcuts_model_shortcut_devices (model);
 
@@ -321,6 +393,13 @@ thunar_shortcuts_model_finalize (GObject *object)
   if (model->bookmarks_idle_id != 0)
     g_source_remove (model->bookmarks_idle_id);
 
+  /* stop the disk usage updates */
+  if (model->disk_usage_timeout_id != 0)
+    g_source_remove (model->disk_usage_timeout_id);
+  g_source_remove (model->disk_usage_interval_id);
+  g_signal_handlers_disconnect_by_func (model->filesystem_cache, thunar_shortcuts_model_filesystem_changed, model);
+  g_object_unref (model->filesystem_cache);
+
   /* disable monitoring for the shortcuts */
   for (lp = model->shortcuts; lp != NULL; lp=lp->next)
     {
@@ -438,6 +517,7 @@ thunar_shortcuts_model_set_property (GObject      *object,
 
     case PROP_FILE_SIZE_BINARY:
       model->file_size_binary = g_value_get_boolean (value);
+      thunar_shortcuts_model_refresh_disk_usage (model);
       break;
 
     default:
@@ -514,6 +594,9 @@ thunar_shortcuts_model_get_column_type (GtkTreeModel *tree_model,
 
     case THUNAR_SHORTCUTS_MODEL_COLUMN_HIDDEN:
       return G_TYPE_BOOLEAN;
+
+    case THUNAR_SHORTCUTS_MODEL_COLUMN_DISK_USAGE:
+      return G_TYPE_STRING;
     }
 
   _thunar_assert_not_reached ();
@@ -575,8 +658,6 @@ thunar_shortcuts_model_get_value (GtkTreeModel *tree_model,
   ThunarShortcut *shortcut;
   GFile          *file;
   gboolean        can_eject;
-  gboolean        file_size_binary;
-  gchar          *disk_usage;
   gchar          *device_name;
   gchar          *device_id;
   gchar          *location;
@@ -658,18 +739,15 @@ thunar_shortcuts_model_get_value (GtkTreeModel *tree_model,
                   location = tmp;
                 }
 
-              file_size_binary = THUNAR_SHORTCUTS_MODEL (tree_model)->file_size_binary;
-              disk_usage = thunar_g_file_get_free_space_string (file, file_size_binary);
-
-              if (disk_usage != NULL)
-                tooltip = g_strdup_printf ("%s\n%s", location, disk_usage);
+              /* the last known disk usage, see thunar_shortcuts_model_update_disk_usage() */
+              if (shortcut->disk_usage != NULL)
+                tooltip = g_strdup_printf ("%s\n%s", location, shortcut->disk_usage);
               else
                 tooltip = g_strdup_printf ("%s", location);
 
               g_value_take_string (value, tooltip);
 
               g_free (location);
-              g_free (disk_usage);
 
               g_object_unref (file);
             }
@@ -793,6 +871,11 @@ thunar_shortcuts_model_get_value (GtkTreeModel *tree_model,
       g_value_set_boolean (value, FALSE);
       break;
 
+    case THUNAR_SHORTCUTS_MODEL_COLUMN_DISK_USAGE:
+      g_value_init (value, G_TYPE_STRING);
+      g_value_set_static_string (value, shortcut->disk_usage);
+      break;
+
     default:
       _thunar_assert_not_reached ();
     }
@@ -1257,6 +1340,9 @@ thunar_shortcuts_model_add_shortcut_with_path (ThunarShortcutsModel *model,
       g_signal_connect (G_OBJECT (shortcut->file), "changed", G_CALLBACK (thunar_shortcuts_model_file_changed), model);
     }
 
+  /* the cached disk usage of devices, if any, and a query of it otherwise */
+  thunar_shortcuts_model_update_disk_usage (model, shortcut);
+
   if (path == NULL)
     {
       /* insert the new shortcut to the shortcuts list */
@@ -1294,10 +1380,34 @@ thunar_shortcuts_model_add_shortcut (ThunarShortcutsModel *model,
 static void
 thunar_shortcuts_model_remove_shortcut (ThunarShortcutsModel *model,
                                         ThunarShortcut       *shortcut)
+{
+  gboolean needs_save;
+
+  if (G_LIKELY (g_list_find (model->shortcuts, shortcut) != NULL))
+    {
+      /* check if we need to save */
+      needs_save = (shortcut->group == THUNAR_SHORTCUT_GROUP_PLACES_BOOKMARKS);
+
+      /* unlink and free the shortcut */
+      thunar_shortcuts_model_unlink_shortcut (model, shortcut);
+
+      /* the shortcuts list was changed, so write the gtk bookmarks file */
+      if (needs_save)
+        thunar_shortcuts_model_save (model);
+
+      /* update header visibility */
+      thunar_shortcuts_model_header_visibility (model);
+    }
+}
+
+
+
+static void
+thunar_shortcuts_model_unlink_shortcut (ThunarShortcutsModel *model,
+                                        ThunarShortcut       *shortcut)
 {
   GtkTreePath *path;
   gint         idx;
-  gboolean     needs_save;
 
   /* determine the index of the shortcut */
   idx = g_list_index (model->shortcuts, shortcut);
@@ -1318,19 +1428,118 @@ thunar_shortcuts_model_remove_shortcut (ThunarShortcutsModel *model,
       gtk_tree_model_row_deleted (GTK_TREE_MODEL (model), path);
       gtk_tree_path_free (path);
 
-      /* check if we need to save */
-      needs_save = (shortcut->group == THUNAR_SHORTCUT_GROUP_PLACES_BOOKMARKS);
-
       /* actually free the shortcut */
       thunar_shortcut_free (shortcut, model);
+    }
+}
 
-      /* the shortcuts list was changed, so write the gtk bookmarks file */
-      if (needs_save)
-        thunar_shortcuts_model_save (model);
 
-      /* update header visibility */
-      thunar_shortcuts_model_header_visibility (model);
+
+static void
+thunar_shortcuts_model_shortcut_changed (ThunarShortcutsModel *model,
+                                         ThunarShortcut       *shortcut)
+{
+  GtkTreeIter  iter;
+  GtkTreePath *path;
+  GList       *lp;
+
+  lp = g_list_find (model->shortcuts, shortcut);
+  if (G_UNLIKELY (lp == NULL))
+    return;
+
+  /* generate an iterator for the path */
+  GTK_TREE_ITER_INIT (iter, model->stamp, lp);
+
+  /* notify the views about the change */
+  path = gtk_tree_path_new_from_indices (g_list_position (model->shortcuts, lp), -1);
+  gtk_tree_model_row_changed (GTK_TREE_MODEL (model), path, &iter);
+  gtk_tree_path_free (path);
+}
+
+
+
+static void
+thunar_shortcuts_model_shortcut_busy (ThunarShortcutsModel *model,
+                                      ThunarShortcut       *shortcut,
+                                      gboolean              busy)
+{
+  if (G_LIKELY (shortcut->busy != busy))
+    {
+      shortcut->busy = busy;
+
+      if (busy && model->busy_timeout_id == 0)
+        {
+          /* start the global cycle timeout */
+          model->busy_timeout_id =
+            gdk_threads_add_timeout_full (G_PRIORITY_DEFAULT,
+                                          SPINNER_CYCLE_DURATION / SPINNER_NUM_STEPS,
+                                          thunar_shortcuts_model_busy_timeout, model,
+                                          thunar_shortcuts_model_busy_timeout_destroyed);
+        }
+      else if (!busy)
+        {
+          thunar_shortcuts_model_shortcut_changed (model, shortcut);
+        }
+    }
+}
+
+
+
+static gint
+thunar_shortcuts_model_resort_func (gconstpointer a,
+                                    gconstpointer b,
+                                    gpointer      user_data)
+{
+  const ThunarShortcut *shortcut_a = a;
+  const ThunarShortcut *shortcut_b = b;
+  GHashTable           *positions = user_data;
+
+  /* only the bookmarks are reordered, everything else keeps its row */
+  if (shortcut_a->group == THUNAR_SHORTCUT_GROUP_PLACES_BOOKMARKS
+      && shortcut_b->group == THUNAR_SHORTCUT_GROUP_PLACES_BOOKMARKS)
+    return thunar_shortcuts_model_sort_func (a, b);
+
+  return GPOINTER_TO_INT (g_hash_table_lookup (positions, a))
+       - GPOINTER_TO_INT (g_hash_table_lookup (positions, b));
+}
+
+
+
+static void
+thunar_shortcuts_model_resort (ThunarShortcutsModel *model)
+{
+  GHashTable  *positions;
+  GtkTreePath *path;
+  gboolean     changed = FALSE;
+  GList       *lp;
+  gint        *new_order;
+  gint         n;
+
+  /* remember where the shortcuts are now */
+  positions = g_hash_table_new (g_direct_hash, g_direct_equal);
+  for (lp = model->shortcuts, n = 0; lp != NULL; lp = lp->next, ++n)
+    g_hash_table_insert (positions, lp->data, GINT_TO_POINTER (n));
+
+  /* the sort moves the links along with the data, so iters persist */
+  model->shortcuts = g_list_sort_with_data (model->shortcuts, thunar_shortcuts_model_resort_func, positions);
+
+  new_order = g_new (gint, MAX (n, 1));
+  for (lp = model->shortcuts, n = 0; lp != NULL; lp = lp->next, ++n)
+    {
+      new_order[n] = GPOINTER_TO_INT (g_hash_table_lookup (positions, lp->data));
+      changed |= (new_order[n] != n);
+    }
+
+  /* only tell the views if something actually moved */
+  if (changed)
+    {
+      path = gtk_tree_path_new ();
+      gtk_tree_model_rows_reordered (GTK_TREE_MODEL (model), path, NULL, new_order);
+      gtk_tree_path_free (path);
     }
+
+  g_free (new_order);
+  g_hash_table_destroy (positions);
 }
 
 
@@ -1351,46 +1560,143 @@ thunar_shortcuts_model_local_file (GFile *gfile)
 
 
 
+static void
+thunar_shortcuts_model_resolve (ThunarShortcutsModel *model,
+                                ThunarShortcut       *shortcut)
+{
+  ThunarShortcutResolve *resolve;
+  ThunarFile            *file;
+  guint                  timeout = 0;
+  guint                  n;
+
+  _thunar_return_if_fail (THUNAR_IS_SHORTCUTS_MODEL (model));
+  _thunar_return_if_fail (shortcut->file == NULL && shortcut->resolve == NULL);
+
+  /* use an already known file right away */
+  file = thunar_file_cache_lookup (shortcut->location);
+  if (file != NULL)
+    {
+      shortcut->file = file;
+      g_clear_object (&shortcut->gicon);
+
+      thunar_file_watch (shortcut->file);
+      g_signal_connect (G_OBJECT (shortcut->file), "destroy", G_CALLBACK (thunar_shortcuts_model_file_destroyed), model);
+      g_signal_connect (G_OBJECT (shortcut->file), "changed", G_CALLBACK (thunar_shortcuts_model_file_changed), model);
+
+      thunar_shortcuts_model_shortcut_changed (model, shortcut);
+      return;
+    }
+
+  for (n = 0; n < G_N_ELEMENTS (resolve_timeouts); ++n)
+    if (g_file_has_uri_scheme (shortcut->location, resolve_timeouts[n].scheme))
+      timeout = resolve_timeouts[n].timeout;
+
+  resolve = g_slice_new0 (ThunarShortcutResolve);
+  resolve->model = model;
+  resolve->shortcut = shortcut;
+  resolve->cancellable = g_cancellable_new ();
+  if (timeout > 0)
+    resolve->timeout_id = g_timeout_add_seconds (timeout, thunar_shortcuts_model_resolve_timeout, resolve);
+  shortcut->resolve = resolve;
+
+  /* query the info in the background, bookmarks are resolved in
+   * parallel and a dead server only stalls its own bookmark
+   */
+  g_file_query_info_async (shortcut->location,
+                           THUNAR_FILE_INFO_NAMESPACE,
+                           G_FILE_QUERY_INFO_NONE,
+                           G_PRIORITY_DEFAULT,
+                           resolve->cancellable,
+                           thunar_shortcuts_model_resolve_finish,
+                           resolve);
+
+  thunar_shortcuts_model_shortcut_busy (model, shortcut, TRUE);
+}
+
+
+
+static void
+thunar_shortcuts_model_resolve_finish (GObject      *object,
+                                       GAsyncResult *result,
+                                       gpointer      user_data)
+{
+  ThunarShortcutResolve *resolve = user_data;
+  ThunarShortcutsModel  *model;
+  ThunarShortcut        *shortcut;
+  GFileInfo             *info;
+
+  info = g_file_query_info_finish (G_FILE (object), result, NULL);
+
+  /* the shortcut was removed while we were waiting */
+  if (g_cancellable_is_cancelled (resolve->cancellable))
+    goto out;
+
+  model = resolve->model;
+  shortcut = resolve->shortcut;
+  shortcut->resolve = NULL;
+
+  if (resolve->timeout_id != 0)
+    g_source_remove (resolve->timeout_id);
+
+  /* without info the placeholder stays, like for a missing folder */
+  if (info != NULL)
+    {
+      shortcut->file = thunar_file_get_with_info (shortcut->location, info, NULL, FALSE);
+      g_clear_object (&shortcut->gicon);
+
+      thunar_file_watch (shortcut->file);
+      g_signal_connect (G_OBJECT (shortcut->file), "destroy", G_CALLBACK (thunar_shortcuts_model_file_destroyed), model);
+      g_signal_connect (G_OBJECT (shortcut->file), "changed", G_CALLBACK (thunar_shortcuts_model_file_changed), model);
+    }
+
+  /* stopping the spinner emits row-changed only if it was still running */
+  if (shortcut->busy)
+    thunar_shortcuts_model_shortcut_busy (model, shortcut, FALSE);
+  else
+    thunar_shortcuts_model_shortcut_changed (model, shortcut);
+
+out:
+  if (info != NULL)
+    g_object_unref (info);
+  g_object_unref (resolve->cancellable);
+  g_slice_free (ThunarShortcutResolve, resolve);
+}
+
+
+
+static gboolean
+thunar_shortcuts_model_resolve_timeout (gpointer user_data)
+{
+  ThunarShortcutResolve *resolve = user_data;
+
+  /* keep waiting in the background, but show the placeholder as idle */
+  resolve->timeout_id = 0;
+  thunar_shortcuts_model_shortcut_busy (resolve->model, resolve->shortcut, FALSE);
+
+  return FALSE;
+}
+
+
+
 static void
 thunar_shortcuts_model_load_line (GFile       *file_path,
                                   const gchar *name,
                                   gint         row_num,
                                   gpointer     user_data)
 {
-  ThunarShortcutsModel *model = THUNAR_SHORTCUTS_MODEL (user_data);
-  ThunarShortcut       *shortcut;
-  ThunarFile           *file;
+  GList          **bookmarks = user_data;
+  ThunarShortcut  *shortcut;
 
   _thunar_return_if_fail (G_IS_FILE (file_path));
-  _thunar_return_if_fail (THUNAR_IS_SHORTCUTS_MODEL (model));
   _thunar_return_if_fail (name == NULL || g_utf8_validate (name, -1, NULL));
 
   shortcut = g_slice_new0 (ThunarShortcut);
   shortcut->group = THUNAR_SHORTCUT_GROUP_PLACES_BOOKMARKS;
   shortcut->location = g_object_ref (file_path);
-
-  /* handle local and remote files differently */
-  /* If we dont have a thunar-file, we need to set the gicon manually */
-  if (thunar_shortcuts_model_local_file (file_path))
-    {
-      /* try to open the file corresponding to the uri */
-      file = thunar_file_get (file_path, NULL);
-      if (G_UNLIKELY (file == NULL))
-          shortcut->gicon = g_themed_icon_new ("folder");
-      else
-          shortcut->file = file;
-    }
-  else
-    {
-      shortcut->gicon = g_themed_icon_new ("folder-remote");
-    }
-
   shortcut->sort_id = row_num;
-  shortcut->hidden = thunar_shortcuts_model_get_hidden (model, shortcut);
   shortcut->name = g_strdup (name);
 
-  /* append the shortcut to the list */
-  thunar_shortcuts_model_add_shortcut (model, shortcut);
+  *bookmarks = g_list_prepend (*bookmarks, shortcut);
 }
 
 
@@ -1399,38 +1705,86 @@ static gboolean
 thunar_shortcuts_model_load (gpointer data)
 {
   ThunarShortcutsModel *model = THUNAR_SHORTCUTS_MODEL (data);
+  ThunarShortcut       *shortcut;
+  ThunarShortcut       *bookmark;
+  GList                *bookmarks = NULL;
+  GList                *lp, *lnext;
+  GList                *bp;
 
   _thunar_return_val_if_fail (THUNAR_IS_SHORTCUTS_MODEL (model), FALSE);
 
   /* parse the bookmarks */
   thunar_util_load_bookmarks (model->bookmarks_file,
                               thunar_shortcuts_model_load_line,
-                              model);
+                              &bookmarks);
+  bookmarks = g_list_reverse (bookmarks);
 
-  /* update the visibility */
-  thunar_shortcuts_model_header_visibility (model);
+  /* only apply the difference to the current bookmarks, so
+   * unchanged ones keep their (possibly pending) files
+   */
+  for (lp = model->shortcuts; lp != NULL; lp = lnext)
+    {
+      lnext = lp->next;
+      shortcut = THUNAR_SHORTCUT (lp->data);
+      if (shortcut->group != THUNAR_SHORTCUT_GROUP_PLACES_BOOKMARKS)
+        continue;
 
-  model->bookmarks_idle_id = 0;
+      for (bp = bookmarks; bp != NULL; bp = bp->next)
+        if (g_file_equal (THUNAR_SHORTCUT (bp->data)->location, shortcut->location))
+          break;
 
-  return FALSE;
-}
+      if (bp == NULL)
+        {
+          /* the bookmark is gone */
+          thunar_shortcuts_model_unlink_shortcut (model, shortcut);
+          continue;
+        }
+
+      /* still there, pick up a new position and name */
+      bookmark = THUNAR_SHORTCUT (bp->data);
+      shortcut->sort_id = bookmark->sort_id;
+      if (g_strcmp0 (shortcut->name, bookmark->name) != 0)
+        {
+          g_free (shortcut->name);
+          shortcut->name = g_strdup (bookmark->name);
+          thunar_shortcuts_model_shortcut_changed (model, shortcut);
+        }
 
+      bookmarks = g_list_delete_link (bookmarks, bp);
+      thunar_shortcut_free (bookmark, model);
+    }
 
+  /* move the remaining bookmarks to their new positions */
+  thunar_shortcuts_model_resort (model);
 
-static gboolean
-thunar_shortcuts_model_reload (gpointer data)
-{
-  ThunarShortcutsModel *model = THUNAR_SHORTCUTS_MODEL (data);
-  GList                *lp;
+  /* add the new bookmarks as placeholders and resolve them in the background */
+  for (bp = bookmarks; bp != NULL; bp = bp->next)
+    {
+      shortcut = THUNAR_SHORTCUT (bp->data);
 
-  _thunar_return_val_if_fail (THUNAR_IS_SHORTCUTS_MODEL (model), FALSE);
+      /* handle local and remote files differently */
+      /* If we dont have a thunar-file, we need to set the gicon manually */
+      if (thunar_shortcuts_model_local_file (shortcut->location))
+        shortcut->gicon = g_themed_icon_new ("folder");
+      else
+        shortcut->gicon = g_themed_icon_new ("folder-remote");
 
-  /* drop all existing user-defined shortcuts from the model */
-  for (lp = model->shortcuts; lp != NULL; lp = lp->next)
-    thunar_shortcuts_model_remove_shortcut (model, THUNAR_SHORTCUT (lp->data));
+      shortcut->hidden = thunar_shortcuts_model_get_hidden (model, shortcut);
+
+      /* append the shortcut to the list */
+      thunar_shortcuts_model_add_shortcut (model, shortcut);
+
+      if (thunar_shortcuts_model_local_file (shortcut->location))
+        thunar_shortcuts_model_resolve (model, shortcut);
+    }
+  g_list_free (bookmarks);
+
+  /* update the visibility */
+  thunar_shortcuts_model_header_visibility (model);
+
+  model->bookmarks_idle_id = 0;
 
-  /* load new bookmarks */
-  return thunar_shortcuts_model_load (data);
+  return FALSE;
 }
 
 
@@ -1453,7 +1807,7 @@ thunar_shortcuts_model_monitor (GFileMonitor     *monitor,
 
   /* reload the shortcuts model */
   if (model->bookmarks_idle_id == 0)
-    model->bookmarks_idle_id = g_idle_add (thunar_shortcuts_model_reload, model);
+    model->bookmarks_idle_id = g_idle_add (thunar_shortcuts_model_load, model);
 }
 
 
@@ -1649,6 +2003,9 @@ thunar_shortcuts_model_device_changed (ThunarDeviceMonitor  *device_monitor,
             }
         }
 
+      /* the device might be mounted elsewhere now */
+      thunar_shortcuts_model_update_disk_usage (model, shortcut);
+
       /* hidden state */
       if (shortcut->hidden != thunar_device_get_hidden (device))
         {
@@ -1759,6 +2116,15 @@ static void
 thunar_shortcut_free (ThunarShortcut       *shortcut,
                       ThunarShortcutsModel *model)
 {
+  /* abandon a pending resolve, its callback only releases itself */
+  if (G_UNLIKELY (shortcut->resolve != NULL))
+    {
+      if (shortcut->resolve->timeout_id != 0)
+        g_source_remove (shortcut->resolve->timeout_id);
+      shortcut->resolve->timeout_id = 0;
+      g_cancellable_cancel (shortcut->resolve->cancellable);
+    }
+
   if (G_LIKELY (shortcut->file != NULL))
     g_object_unref (shortcut->file);
 
@@ -1773,6 +2139,7 @@ thunar_shortcut_free (ThunarShortcut       *shortcut,
 
   g_free (shortcut->name);
   g_free (shortcut->tooltip);
+  g_free (shortcut->disk_usage);
 
   /* release the shortcut itself */
   g_slice_free (ThunarShortcut, shortcut);
@@ -1829,6 +2196,109 @@ thunar_shortcuts_model_busy_timeout_destroyed (gpointer data)
 
 
 
+/* takes the disk usage of @shortcut from the filesystem cache, which
+ * never blocks, and returns %TRUE if it changed */
+static gboolean
+thunar_shortcuts_model_update_disk_usage (ThunarShortcutsModel *model,
+                                          ThunarShortcut       *shortcut)
+{
+  GFile *file;
+  gchar *disk_usage = NULL;
+
+  if ((shortcut->group & THUNAR_SHORTCUT_GROUP_DEVICES) == 0)
+    return FALSE;
+
+  if (shortcut->device != NULL)
+    file = thunar_device_get_root (shortcut->device);
+  else if (shortcut->file != NULL)
+    file = g_object_ref (thunar_file_get_file (shortcut->file));
+  else
+    file = NULL;
+
+  if (file != NULL)
+    {
+      disk_usage = thunar_g_file_get_free_space_string (file, model->file_size_binary);
+      g_object_unref (file);
+    }
+
+  if (g_strcmp0 (disk_usage, shortcut->disk_usage) == 0)
+    {
+      g_free (disk_usage);
+      return FALSE;
+    }
+
+  g_free (shortcut->disk_usage);
+  shortcut->disk_usage = disk_usage;
+
+  return TRUE;
+}
+
+
+
+static void
+thunar_shortcuts_model_refresh_disk_usage (ThunarShortcutsModel *model)
+{
+  GtkTreeIter  iter;
+  GtkTreePath *path;
+  GList       *lp;
+  gint         idx;
+
+  for (lp = model->shortcuts, idx = 0; lp != NULL; lp = lp->next, idx++)
+    {
+      if (!thunar_shortcuts_model_update_disk_usage (model, lp->data))
+        continue;
+
+      GTK_TREE_ITER_INIT (iter, model->stamp, lp);
+
+      path = gtk_tree_path_new_from_indices (idx, -1);
+      gtk_tree_model_row_changed (GTK_TREE_MODEL (model), path, &iter);
+      gtk_tree_path_free (path);
+    }
+}
+
+
+
+static gboolean
+thunar_shortcuts_model_disk_usage_timeout (gpointer data)
+{
+  ThunarShortcutsModel *model = THUNAR_SHORTCUTS_MODEL (data);
+
+  /* the lookups ask the cache to refresh the values that are too old */
+  thunar_shortcuts_model_refresh_disk_usage (model);
+
+  return G_SOURCE_CONTINUE;
+}
+
+
+
+static gboolean
+thunar_shortcuts_model_disk_usage_delay (gpointer data)
+{
+  ThunarShortcutsModel *model = THUNAR_SHORTCUTS_MODEL (data);
+
+  model->disk_usage_timeout_id = 0;
+  thunar_shortcuts_model_refresh_disk_usage (model);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+static void
+thunar_shortcuts_model_filesystem_changed (ThunarFilesystemCache *filesystem_cache,
+                                           GFile                 *root,
+                                           ThunarShortcutsModel  *model)
+{
+  _thunar_return_if_fail (THUNAR_IS_FILESYSTEM_CACHE (filesystem_cache));
+  _thunar_return_if_fail (THUNAR_IS_SHORTCUTS_MODEL (model));
+
+  /* the writes of a job change the values often, update the rows once for all of them */
+  if (model->disk_usage_timeout_id == 0)
+    model->disk_usage_timeout_id = g_timeout_add (DISK_USAGE_DELAY, thunar_shortcuts_model_disk_usage_delay, model);
+}
+
+
+
 /**
  * thunar_shortcuts_model_get_default:
  *
@@ -2256,15 +2726,12 @@ thunar_shortcuts_model_set_busy (ThunarShortcutsModel *model,
 {
   ThunarShortcut *shortcut;
   GList          *lp;
-  guint           idx;
-  GtkTreeIter     iter;
-  GtkTreePath    *path;
 
   _thunar_return_if_fail (THUNAR_IS_SHORTCUTS_MODEL (model));
   _thunar_return_if_fail (THUNAR_IS_DEVICE (device));
 
   /* get the device */
-  for (lp = model->shortcuts, idx = 0; lp != NULL; lp = lp->next, idx++)
+  for (lp = model->shortcuts; lp != NULL; lp = lp->next)
     if (THUNAR_SHORTCUT (lp->data)->device == device)
       break;
 
@@ -2274,30 +2741,7 @@ thunar_shortcuts_model_set_busy (ThunarShortcutsModel *model,
   shortcut = lp->data;
   _thunar_assert (shortcut->device == device);
 
-  if (G_LIKELY (shortcut->busy != busy))
-    {
-      shortcut->busy = busy;
-
-      if (busy && model->busy_timeout_id == 0)
-        {
-          /* start the global cycle timeout */
-          model->busy_timeout_id =
-            gdk_threads_add_timeout_full (G_PRIORITY_DEFAULT,
-                                          SPINNER_CYCLE_DURATION / SPINNER_NUM_STEPS,
-                                          thunar_shortcuts_model_busy_timeout, model,
-                                          thunar_shortcuts_model_busy_timeout_destroyed);
-        }
-      else if (!busy)
-        {
-          /* generate an iterator for the path */
-          GTK_TREE_ITER_INIT (iter, model->stamp, lp);
-
-          /* notify the views about the change */
-          path = gtk_tree_path_new_from_indices (idx, -1);
-          gtk_tree_model_row_changed (GTK_TREE_MODEL (model), path, &iter);
-          gtk_tree_path_free (path);
-        }
-    }
+  thunar_shortcuts_model_shortcut_busy (model, shortcut, busy);
 }
 
 
@@ -53,6 +53,7 @@ typedef enum
   THUNAR_SHORTCUTS_MODEL_COLUMN_BUSY,
   THUNAR_SHORTCUTS_MODEL_COLUMN_BUSY_PULSE,
   THUNAR_SHORTCUTS_MODEL_COLUMN_HIDDEN,
+  THUNAR_SHORTCUTS_MODEL_COLUMN_DISK_USAGE,
   THUNAR_SHORTCUTS_MODEL_N_COLUMNS,
 } ThunarShortcutsModelColumn;
 
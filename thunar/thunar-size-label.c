@@ -62,6 +62,10 @@ static gboolean thunar_size_label_button_press_event    (GtkWidget            *e
                                                          GdkEventButton       *event,
                                                          ThunarSizeLabel      *size_label);
 static void     thunar_size_label_files_changed         (ThunarSizeLabel      *size_label);
+static void     thunar_size_label_file_changed          (ThunarFile           *file,
+                                                         ThunarSizeLabel      *size_label);
+static void     thunar_size_label_refresh               (ThunarSizeLabel      *size_label,
+                                                         gboolean              restart);
 static void     thunar_size_label_error                 (ExoJob               *job,
                                                          const GError         *error,
                                                          ThunarSizeLabel      *size_label);
@@ -213,8 +217,7 @@ thunar_size_label_finalize (GObject *object)
   if (G_UNLIKELY (size_label->job != NULL))
     {
       g_signal_handlers_disconnect_by_data (G_OBJECT (size_label->job), size_label);
-      exo_job_cancel (EXO_JOB (size_label->job));
-      g_object_unref (size_label->job);
+      thunar_deep_count_job_release (size_label->job);
     }
 
   /* reset the file property */
@@ -296,12 +299,12 @@ thunar_size_label_button_press_event (GtkWidget       *ebox,
   /* left button press on the spinner cancels the calculation */
   if (G_LIKELY (event->button == 1))
     {
-      /* cancel the pending job (if any) */
+      /* cancel the pending job (if any), other labels
+       * counting the same files keep it running */
       if (G_UNLIKELY (size_label->job != NULL))
         {
           g_signal_handlers_disconnect_by_data (size_label->job, size_label);
-          exo_job_cancel (EXO_JOB (size_label->job));
-          g_object_unref (size_label->job);
+          thunar_deep_count_job_release (size_label->job);
           size_label->job = NULL;
         }
 
@@ -323,9 +326,40 @@ thunar_size_label_button_press_event (GtkWidget       *ebox,
 
 static void
 thunar_size_label_files_changed (ThunarSizeLabel *size_label)
+{
+  _thunar_return_if_fail (THUNAR_IS_SIZE_LABEL (size_label));
+
+  /* a count of the same files that is running already will do */
+  thunar_size_label_refresh (size_label, FALSE);
+}
+
+
+
+static void
+thunar_size_label_file_changed (ThunarFile      *file,
+                                ThunarSizeLabel *size_label)
+{
+  _thunar_return_if_fail (THUNAR_IS_FILE (file));
+  _thunar_return_if_fail (THUNAR_IS_SIZE_LABEL (size_label));
+
+  /* a running count may have missed the change, start over */
+  thunar_size_label_refresh (size_label, TRUE);
+}
+
+
+
+static void
+thunar_size_label_refresh (ThunarSizeLabel *size_label,
+                           gboolean         restart)
 {
   gchar             *size_string;
   guint64            size;
+  guint64            total_size;
+  guint64            total_size_on_disk;
+  guint              file_count;
+  guint              directory_count;
+  guint              unreadable_directory_count;
+  gboolean           shared_extents;
 
   _thunar_return_if_fail (THUNAR_IS_SIZE_LABEL (size_label));
   _thunar_return_if_fail (size_label->files != NULL);
@@ -335,8 +369,7 @@ thunar_size_label_files_changed (ThunarSizeLabel *size_label)
   if (G_UNLIKELY (size_label->job != NULL))
     {
       g_signal_handlers_disconnect_by_data (size_label->job, size_label);
-      exo_job_cancel (EXO_JOB (size_label->job));
-      g_object_unref (size_label->job);
+      thunar_deep_count_job_release (size_label->job);
       size_label->job = NULL;
     }
 
@@ -344,8 +377,11 @@ thunar_size_label_files_changed (ThunarSizeLabel *size_label)
   if (size_label->files->next != NULL
       || thunar_file_is_directory (THUNAR_FILE (size_label->files->data)))
     {
-      /* schedule a new job to determine the total size of the directory (not following symlinks) */
-      size_label->job = thunar_deep_count_job_new (size_label->files, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS);
+      /* subscribe to the job determining the total size of the directory (not following
+       * symlinks), the properties dialogs of other windows may be counting the same files */
+      g_object_get (size_label->preferences, "misc-size-on-disk-shared-extents", &shared_extents, NULL);
+      size_label->job = thunar_deep_count_job_get_shared (size_label->files, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                                          shared_extents, restart);
       g_signal_connect (size_label->job, "error", G_CALLBACK (thunar_size_label_error), size_label);
       g_signal_connect (size_label->job, "finished", G_CALLBACK (thunar_size_label_finished), size_label);
       g_signal_connect (size_label->job, "status-update", G_CALLBACK (thunar_size_label_status_update), size_label);
@@ -355,8 +391,14 @@ thunar_size_label_files_changed (ThunarSizeLabel *size_label)
       gtk_spinner_start (GTK_SPINNER (size_label->spinner));
       gtk_widget_show (size_label->spinner);
 
-      /* launch the job */
-      exo_job_launch (EXO_JOB (size_label->job));
+      /* catch up with a job that was running already */
+      if (thunar_deep_count_job_get_status (size_label->job, &total_size, &total_size_on_disk,
+                                            &file_count, &directory_count, &unreadable_directory_count))
+        {
+          thunar_size_label_status_update (size_label->job, total_size, total_size_on_disk,
+                                           file_count, directory_count, unreadable_directory_count,
+                                           size_label);
+        }
     }
   else
     {
@@ -416,7 +458,7 @@ thunar_size_label_finished (ExoJob          *job,
 
   /* disconnect from the job */
   g_signal_handlers_disconnect_by_data (size_label->job, size_label);
-  g_object_unref (size_label->job);
+  thunar_deep_count_job_release (size_label->job);
   size_label->job = NULL;
 }
 
@@ -533,7 +575,7 @@ thunar_size_label_set_files (ThunarSizeLabel *size_label,
     {
       _thunar_assert (THUNAR_IS_FILE (lp->data));
 
-      g_signal_handlers_disconnect_by_func (G_OBJECT (lp->data), thunar_size_label_files_changed, size_label);
+      g_signal_handlers_disconnect_by_func (G_OBJECT (lp->data), thunar_size_label_file_changed, size_label);
       g_object_unref (G_OBJECT (lp->data));
     }
   g_list_free (size_label->files);
@@ -546,7 +588,7 @@ thunar_size_label_set_files (ThunarSizeLabel *size_label,
       _thunar_assert (THUNAR_IS_FILE (lp->data));
 
       g_object_ref (G_OBJECT (lp->data));
-      g_signal_connect_swapped (G_OBJECT (lp->data), "changed", G_CALLBACK (thunar_size_label_files_changed), size_label);
+      g_signal_connect (G_OBJECT (lp->data), "changed", G_CALLBACK (thunar_size_label_file_changed), size_label);
     }
 
   if (size_label->files != NULL)
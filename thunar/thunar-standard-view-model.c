@@ -21,13 +21,31 @@
 #include "config.h"
 #endif
 
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
 #include "thunar/thunar-private.h"
 #include "thunar/thunar-standard-view-model.h"
 #include "thunar/thunar-preferences.h"
 #include "thunar/thunar-util.h"
 #include "thunar/thunar-gobject-extensions.h"
 
-static void thunar_standard_view_model_class_init (gpointer klass);
+/* Interval for handing the results of a running search to the model */
+#define THUNAR_STANDARD_VIEW_MODEL_RESULTS_INTERVAL 50 /* in milliseconds */
+
+typedef struct _ThunarStandardViewModelTotalsEntry ThunarStandardViewModelTotalsEntry;
+
+
+
+static void        thunar_standard_view_model_class_init                    (gpointer                       klass);
+static gchar      *thunar_standard_view_model_get_statusbar_text_for_counts (ThunarStandardViewModel       *model,
+                                                                             guint                          folder_count,
+                                                                             guint                          non_folder_count,
+                                                                             guint64                        size_summary,
+                                                                             ThunarFile                    *last_modified_file,
+                                                                             gboolean                       show_file_size_binary_format);
+static ThunarFile *thunar_standard_view_model_totals_get_last_modified      (ThunarStandardViewModelTotals *totals);
 
 GType
 thunar_standard_view_model_get_type (void)
@@ -55,15 +73,97 @@ thunar_standard_view_model_get_type (void)
   return type__static;
 }
 
+typedef enum
+{
+  MATCH_GLOB,      /* anything else, handled by the GPatternSpec */
+  MATCH_EXACT,     /* no wildcards at all */
+  MATCH_PREFIX,    /* "literal*" */
+  MATCH_SUFFIX,    /* "*literal", e.g. "*.log" */
+  MATCH_SUBSTRING, /* "*literal*" */
+} MatchKind;
+
 struct _MatchForeach
 {
   GList        *paths;
   GPatternSpec *pspec;
   gboolean      match_diacritics;
   gboolean      case_sensitive;
+
+  /* the pattern without its leading and trailing '*', for the
+   * kinds which don't need the GPatternSpec */
+  MatchKind     kind;
+  gchar        *literal;
+  gsize         literal_len;
+
+  /* reused to fold the case of plain ASCII names */
+  GString      *buffer;
 };
 
+struct _ThunarStandardViewModelTotals
+{
+  /* ThunarFile -> ThunarStandardViewModelTotalsEntry */
+  GHashTable *entries;
+
+  guint       n_folders;
+  guint       n_non_folders;
+  guint64     size;
+
+  /* the most recently modified file, only recomputed once the
+   * current one leaves or ages, NULL if there are no entries */
+  ThunarFile *last_modified_file;
+  guint64     last_modified_date;
+  gboolean    last_modified_valid;
+};
+
+struct _ThunarStandardViewModelTotalsEntry
+{
+  gboolean is_directory;
+  guint64  size;
+  guint64  date;
+};
+
+struct _ThunarStandardViewModelResults
+{
+  /* the files pushed by the search job and not handed to the model yet */
+  GMutex                             mutex;
+  GList                             *files;
+
+  guint                              timer_id;
+
+  ThunarStandardViewModelResultsFunc func;
+  gpointer                           user_data;
+};
+
+/* the state of the type-ahead find of the views, attached to the model */
+typedef struct
+{
+  /* ThunarFile -> ThunarStandardViewModelTypeaheadName, the files are not
+   * referenced, the display name tells if an entry is still valid */
+  GHashTable *names;
+  GHashTable *previous_names;
+
+  /* the folded names of all the rows in strcmp() order, NULL when outdated */
+  GPtrArray  *sorted;
+
+  /* the last key and whether any row starts with it */
+  gchar      *key;
+  gchar      *key_folded;
+  gsize       key_folded_len;
+  gboolean    key_matches;
+}
+ThunarStandardViewModelTypeahead;
+
+typedef struct
+{
+  gchar *display_name;
+  gchar *folded;
+}
+ThunarStandardViewModelTypeaheadName;
+
+
+
 static guint       model_signals[THUNAR_STANDARD_VIEW_MODEL_LAST_SIGNAL];
+static GQuark      model_typeahead_quark;
 
 static void thunar_standard_view_model_class_init (gpointer klass)
 {
@@ -444,30 +544,13 @@ thunar_standard_view_model_get_statusbar_text_for_files (ThunarStandardViewModel
                                                          GList                   *files,
                                                          gboolean                 show_file_size_binary_format)
 {
-  guint64            size_summary = 0;
-  gint               folder_count = 0;
-  gint               non_folder_count = 0;
-  GList             *lp;
-  GList             *text_list = NULL;
-  gchar             *size_string = NULL;
-  gchar             *temp_string = NULL;
-  gchar             *folder_text = NULL;
-  gchar             *non_folder_text = NULL;
-  ThunarPreferences *preferences;
-  guint              active;
-  guint64            last_modified_date = 0;
-  guint64            temp_last_modified_date;
-  ThunarFile        *last_modified_file = NULL;
-  gboolean           show_size, show_size_in_bytes, show_last_modified;
-  ThunarDateStyle    date_style;
-  gchar             *date_custom_style;
-
-  preferences = thunar_preferences_get ();
-  g_object_get (G_OBJECT (preferences), "misc-status-bar-active-info", &active, NULL);
-  show_size = thunar_status_bar_info_check_active (active, THUNAR_STATUS_BAR_INFO_SIZE);
-  show_size_in_bytes = thunar_status_bar_info_check_active (active, THUNAR_STATUS_BAR_INFO_SIZE_IN_BYTES);
-  show_last_modified = thunar_status_bar_info_check_active (active, THUNAR_STATUS_BAR_INFO_LAST_MODIFIED);
-  g_object_unref (preferences);
+  guint64     size_summary = 0;
+  guint       folder_count = 0;
+  guint       non_folder_count = 0;
+  GList      *lp;
+  guint64     last_modified_date = 0;
+  guint64     temp_last_modified_date;
+  ThunarFile *last_modified_file = NULL;
 
   /* analyze files */
   for (lp = files; lp != NULL; lp = lp->next)
@@ -490,6 +573,69 @@ thunar_standard_view_model_get_statusbar_text_for_files (ThunarStandardViewModel
         }
     }
 
+  return thunar_standard_view_model_get_statusbar_text_for_counts (model, folder_count, non_folder_count, size_summary,
+                                                                   last_modified_file, show_file_size_binary_format);
+}
+
+
+
+/**
+ * thunar_standard_view_model_get_statusbar_text_for_totals:
+ * @totals                       : the running totals of the model.
+ * @show_file_size_binary_format : weather the file size should be displayed in binary format
+ *
+ * Generates the statusbar text for all files in @model from its
+ * running @totals, without walking the rows.
+ *
+ * The caller is reponsible to free the returned text using
+ * g_free() when it's no longer needed.
+ *
+ * Return value: the statusbar text for all files in @model.
+ **/
+static gchar *
+thunar_standard_view_model_get_statusbar_text_for_totals (ThunarStandardViewModel       *model,
+                                                          ThunarStandardViewModelTotals *totals,
+                                                          gboolean                       show_last_modified,
+                                                          gboolean                       show_file_size_binary_format)
+{
+  ThunarFile *last_modified_file = NULL;
+
+  /* only look for the newest file if it is going to be shown */
+  if (show_last_modified)
+    last_modified_file = thunar_standard_view_model_totals_get_last_modified (totals);
+
+  return thunar_standard_view_model_get_statusbar_text_for_counts (model, totals->n_folders, totals->n_non_folders, totals->size,
+                                                                   last_modified_file, show_file_size_binary_format);
+}
+
+
+
+static gchar *
+thunar_standard_view_model_get_statusbar_text_for_counts (ThunarStandardViewModel *model,
+                                                          guint                    folder_count,
+                                                          guint                    non_folder_count,
+                                                          guint64                  size_summary,
+                                                          ThunarFile              *last_modified_file,
+                                                          gboolean                 show_file_size_binary_format)
+{
+  GList             *text_list = NULL;
+  gchar             *size_string = NULL;
+  gchar             *temp_string = NULL;
+  gchar             *folder_text = NULL;
+  gchar             *non_folder_text = NULL;
+  ThunarPreferences *preferences;
+  guint              active;
+  gboolean           show_size, show_size_in_bytes, show_last_modified;
+  ThunarDateStyle    date_style;
+  gchar             *date_custom_style;
+
+  preferences = thunar_preferences_get ();
+  active = thunar_preferences_peek_values (preferences)->misc_status_bar_active_info;
+  show_size = thunar_status_bar_info_check_active (active, THUNAR_STATUS_BAR_INFO_SIZE);
+  show_size_in_bytes = thunar_status_bar_info_check_active (active, THUNAR_STATUS_BAR_INFO_SIZE_IN_BYTES);
+  show_last_modified = thunar_status_bar_info_check_active (active, THUNAR_STATUS_BAR_INFO_LAST_MODIFIED);
+  g_object_unref (preferences);
+
   if (non_folder_count > 0)
     {
       if (show_size == TRUE)
@@ -545,11 +691,14 @@ thunar_standard_view_model_get_statusbar_text_for_files (ThunarStandardViewModel
 
 /**
  * thunar_standard_view_model_get_statusbar_text:
- * @store          : a #ThunarListModel instance.
- * @selected_items : the list of selected items (as GtkTreePath's).
+ * @store            : a #ThunarListModel instance.
+ * @selected_items   : the list of selected items (as GtkTreePath's).
+ * @selection_totals : running totals of the selected files or %NULL.
  *
  * Generates the statusbar text for @store with the given
- * @selected_items.
+ * @selected_items. If @selection_totals accounts for as many
+ * files as there are @selected_items, a multiple selection is
+ * summarized from it instead of looking at every selected file.
  *
  * This function is used by the #ThunarStandardView (and thereby
  * implicitly by #ThunarIconView and #ThunarDetailsView) to
@@ -563,8 +712,9 @@ thunar_standard_view_model_get_statusbar_text_for_files (ThunarStandardViewModel
  *               @selected_items.
  **/
 gchar *
-thunar_standard_view_model_get_statusbar_text (ThunarStandardViewModel *model,
-                                               GList                   *selected_items)
+thunar_standard_view_model_get_statusbar_text (ThunarStandardViewModel       *model,
+                                               GList                         *selected_items,
+                                               ThunarStandardViewModelTotals *selection_totals)
 {
   const gchar       *content_type;
   const gchar       *original_path;
@@ -584,7 +734,7 @@ thunar_standard_view_model_get_statusbar_text (ThunarStandardViewModel *model,
   GList             *relevant_files = NULL;
   guint              active;
   gboolean           show_size, show_size_in_bytes, show_filetype, show_display_name, show_last_modified;
-  gboolean           has_next;
+  ThunarStandardViewModelTotals *totals;
   ThunarDateStyle    date_style;
   gchar             *date_custom_style;
   gchar             *date_string;
@@ -592,7 +742,7 @@ thunar_standard_view_model_get_statusbar_text (ThunarStandardViewModel *model,
   _thunar_return_val_if_fail (THUNAR_IS_STANDARD_VIEW_MODEL (model), NULL);
 
   preferences = thunar_preferences_get ();
-  g_object_get (G_OBJECT (preferences), "misc-status-bar-active-info", &active, NULL);
+  active = thunar_preferences_peek_values (preferences)->misc_status_bar_active_info;
   show_size = thunar_status_bar_info_check_active (active, THUNAR_STATUS_BAR_INFO_SIZE);
   show_size_in_bytes = thunar_status_bar_info_check_active (active, THUNAR_STATUS_BAR_INFO_SIZE_IN_BYTES);
   show_filetype = thunar_status_bar_info_check_active (active, THUNAR_STATUS_BAR_INFO_FILETYPE);
@@ -602,20 +752,13 @@ thunar_standard_view_model_get_statusbar_text (ThunarStandardViewModel *model,
 
   if (selected_items == NULL) /* nothing selected */
     {
-      /* build a GList of all files */
-      has_next = gtk_tree_model_get_iter_first (GTK_TREE_MODEL (model), &iter);
-      while (has_next)
-        {
-          _file = thunar_standard_view_model_get_file (model, &iter);
-          if (_file != NULL)
-            relevant_files = g_list_append (relevant_files, _file);
-          has_next = gtk_tree_model_iter_next (GTK_TREE_MODEL (model), &iter);
-        }
+      /* the models keep running totals of their rows, so there is no need to walk them */
+      totals = (*THUNAR_STANDARD_VIEW_MODEL_GET_IFACE (model)->get_totals) (model);
 
       /* try to determine a file for the current folder */
       folder = thunar_standard_view_model_get_folder (model);
       file = (folder != NULL) ? thunar_folder_get_corresponding_file (folder) : NULL;
-      temp_string = thunar_standard_view_model_get_statusbar_text_for_files (model, relevant_files, show_file_size_binary_format);
+      temp_string = thunar_standard_view_model_get_statusbar_text_for_totals (model, totals, show_last_modified, show_file_size_binary_format);
       text_list = g_list_append (text_list, temp_string);
 
       /* check if we can determine the amount of free space for the volume */
@@ -627,8 +770,6 @@ thunar_standard_view_model_get_statusbar_text (ThunarStandardViewModel *model,
           text_list = g_list_append (text_list, temp_string);
           g_free (size_string);
         }
-
-      g_list_free_full (relevant_files, g_object_unref);
     }
   else if (selected_items->next == NULL) /* only one item selected */
     {
@@ -700,7 +841,7 @@ thunar_standard_view_model_get_statusbar_text (ThunarStandardViewModel *model,
         {
           /* check if the size should be visible in the statusbar, disabled by
            * default to avoid high i/o  */
-          g_object_get (preferences, "misc-image-size-in-statusbar", &show_image_size, NULL);
+          show_image_size = thunar_preferences_peek_values (preferences)->misc_image_size_in_statusbar;
           if (show_image_size)
             {
               /* check if we can determine the dimension of this file (only for image files) */
@@ -727,18 +868,30 @@ thunar_standard_view_model_get_statusbar_text (ThunarStandardViewModel *model,
   else /* more than one item selected */
     {
       gchar *selected_string;
-      /* build GList of files from selection */
-      for (lp = selected_items; lp != NULL; lp = lp->next)
+
+      /* the view keeps totals of its selection, but they may lag behind
+       * the selected items until its debounced selection handler ran */
+      if (selection_totals != NULL
+          && selection_totals->n_folders + selection_totals->n_non_folders == g_list_length (selected_items))
+        {
+          selected_string = thunar_standard_view_model_get_statusbar_text_for_totals (model, selection_totals, show_last_modified, show_file_size_binary_format);
+        }
+      else
         {
-          gtk_tree_model_get_iter (GTK_TREE_MODEL (model), &iter, lp->data);
-          _file = thunar_standard_view_model_get_file (model, &iter);
-          if (_file != NULL)
-            relevant_files = g_list_append (relevant_files, _file);
+          /* build GList of files from selection */
+          for (lp = selected_items; lp != NULL; lp = lp->next)
+            {
+              gtk_tree_model_get_iter (GTK_TREE_MODEL (model), &iter, lp->data);
+              _file = thunar_standard_view_model_get_file (model, &iter);
+              if (_file != NULL)
+                relevant_files = g_list_prepend (relevant_files, _file);
+            }
+          relevant_files = g_list_reverse (relevant_files);
+          selected_string = thunar_standard_view_model_get_statusbar_text_for_files (model, relevant_files, show_file_size_binary_format);
+          g_list_free_full (relevant_files, g_object_unref);
         }
-      selected_string = thunar_standard_view_model_get_statusbar_text_for_files (model, relevant_files, show_file_size_binary_format);
       temp_string = g_strdup_printf (_ ("Selection: %s"), selected_string);
       text_list = g_list_append (text_list, temp_string);
-      g_list_free_full (relevant_files, g_object_unref);
       g_free (selected_string);
     }
 
@@ -750,6 +903,339 @@ thunar_standard_view_model_get_statusbar_text (ThunarStandardViewModel *model,
 
 
 
+/**
+ * thunar_standard_view_model_totals_new:
+ *
+ * Allocates an empty set of running totals, which an implementation
+ * of #ThunarStandardViewModel updates whenever a top level row is
+ * inserted, removed or changed and hands out from its get_totals
+ * method, so that the statusbar text does not need to walk all rows.
+ *
+ * Return value: the newly allocated totals, free with
+ *               thunar_standard_view_model_totals_free().
+ **/
+ThunarStandardViewModelTotals *
+thunar_standard_view_model_totals_new (void)
+{
+  ThunarStandardViewModelTotals *totals;
+
+  totals = g_new0 (ThunarStandardViewModelTotals, 1);
+  totals->entries = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+  totals->last_modified_valid = TRUE;
+
+  return totals;
+}
+
+
+
+void
+thunar_standard_view_model_totals_free (ThunarStandardViewModelTotals *totals)
+{
+  if (totals == NULL)
+    return;
+
+  g_hash_table_destroy (totals->entries);
+  g_free (totals);
+}
+
+
+
+void
+thunar_standard_view_model_totals_clear (ThunarStandardViewModelTotals *totals)
+{
+  _thunar_return_if_fail (totals != NULL);
+
+  g_hash_table_remove_all (totals->entries);
+  totals->n_folders = 0;
+  totals->n_non_folders = 0;
+  totals->size = 0;
+  totals->last_modified_file = NULL;
+  totals->last_modified_date = 0;
+  totals->last_modified_valid = TRUE;
+}
+
+
+
+static void
+thunar_standard_view_model_totals_account (ThunarStandardViewModelTotals      *totals,
+                                           ThunarStandardViewModelTotalsEntry *entry,
+                                           gboolean                            add)
+{
+  if (entry->is_directory)
+    {
+      if (add)
+        totals->n_folders++;
+      else
+        totals->n_folders--;
+    }
+  else
+    {
+      if (add)
+        {
+          totals->n_non_folders++;
+          totals->size += entry->size;
+        }
+      else
+        {
+          totals->n_non_folders--;
+          totals->size -= entry->size;
+        }
+    }
+}
+
+
+
+/**
+ * thunar_standard_view_model_totals_add:
+ * @totals : a #ThunarStandardViewModelTotals.
+ * @file   : the #ThunarFile of the inserted row.
+ *
+ * Accounts for a new top level row showing @file. Adding a @file
+ * which is already accounted for is the same as
+ * thunar_standard_view_model_totals_changed().
+ **/
+void
+thunar_standard_view_model_totals_add (ThunarStandardViewModelTotals *totals,
+                                       ThunarFile                    *file)
+{
+  ThunarStandardViewModelTotalsEntry *entry;
+
+  _thunar_return_if_fail (totals != NULL);
+  _thunar_return_if_fail (THUNAR_IS_FILE (file));
+
+  entry = g_hash_table_lookup (totals->entries, file);
+  if (entry != NULL)
+    {
+      /* undo the previous state of the file */
+      thunar_standard_view_model_totals_account (totals, entry, FALSE);
+    }
+  else
+    {
+      entry = g_new (ThunarStandardViewModelTotalsEntry, 1);
+      g_hash_table_insert (totals->entries, file, entry);
+    }
+
+  entry->is_directory = thunar_file_is_directory (file);
+  entry->size = (!entry->is_directory && thunar_file_is_regular (file)) ? thunar_file_get_size (file) : 0;
+  entry->date = thunar_file_get_date (file, THUNAR_FILE_DATE_MODIFIED);
+  thunar_standard_view_model_totals_account (totals, entry, TRUE);
+
+  if (totals->last_modified_valid)
+    {
+      if (totals->last_modified_file == NULL || totals->last_modified_date <= entry->date)
+        {
+          totals->last_modified_file = file;
+          totals->last_modified_date = entry->date;
+        }
+      else if (totals->last_modified_file == file)
+        {
+          /* the newest file got older, some other file may be newer now */
+          totals->last_modified_valid = FALSE;
+        }
+    }
+}
+
+
+
+/**
+ * thunar_standard_view_model_totals_remove:
+ * @totals : a #ThunarStandardViewModelTotals.
+ * @file   : the #ThunarFile of the removed row.
+ *
+ * Stops accounting for the top level row showing @file, does
+ * nothing if @file is not accounted for.
+ **/
+void
+thunar_standard_view_model_totals_remove (ThunarStandardViewModelTotals *totals,
+                                          ThunarFile                    *file)
+{
+  ThunarStandardViewModelTotalsEntry *entry;
+
+  _thunar_return_if_fail (totals != NULL);
+
+  entry = g_hash_table_lookup (totals->entries, file);
+  if (entry == NULL)
+    return;
+
+  thunar_standard_view_model_totals_account (totals, entry, FALSE);
+  g_hash_table_remove (totals->entries, file);
+
+  if (totals->last_modified_file == file)
+    {
+      totals->last_modified_file = NULL;
+      totals->last_modified_valid = FALSE;
+    }
+}
+
+
+
+/**
+ * thunar_standard_view_model_totals_changed:
+ * @totals : a #ThunarStandardViewModelTotals.
+ * @file   : the #ThunarFile of the changed row.
+ *
+ * Updates the totals after the size, type or modification time
+ * of an accounted for @file may have changed.
+ **/
+void
+thunar_standard_view_model_totals_changed (ThunarStandardViewModelTotals *totals,
+                                           ThunarFile                    *file)
+{
+  _thunar_return_if_fail (totals != NULL);
+  _thunar_return_if_fail (THUNAR_IS_FILE (file));
+
+  if (g_hash_table_contains (totals->entries, file))
+    thunar_standard_view_model_totals_add (totals, file);
+}
+
+
+
+/**
+ * thunar_standard_view_model_totals_set_files:
+ * @totals : a #ThunarStandardViewModelTotals.
+ * @files  : a #GList of #ThunarFile<!---->s.
+ *
+ * Makes @totals account for exactly the @files. Only the files which
+ * were not accounted for before and the ones missing from @files are
+ * looked at, so replacing a large set with a slightly different one
+ * stays cheap.
+ **/
+void
+thunar_standard_view_model_totals_set_files (ThunarStandardViewModelTotals *totals,
+                                             GList                         *files)
+{
+  ThunarStandardViewModelTotalsEntry *entry;
+  GHashTableIter                      iter;
+  GHashTable                         *wanted;
+  gpointer                            file;
+  GList                              *lp;
+
+  _thunar_return_if_fail (totals != NULL);
+
+  if (files == NULL)
+    {
+      thunar_standard_view_model_totals_clear (totals);
+      return;
+    }
+
+  wanted = g_hash_table_new (g_direct_hash, g_direct_equal);
+  for (lp = files; lp != NULL; lp = lp->next)
+    {
+      g_hash_table_add (wanted, lp->data);
+      if (!g_hash_table_contains (totals->entries, lp->data))
+        thunar_standard_view_model_totals_add (totals, lp->data);
+    }
+
+  /* drop the files which are not part of the set anymore */
+  if (g_hash_table_size (totals->entries) > g_hash_table_size (wanted))
+    {
+      g_hash_table_iter_init (&iter, totals->entries);
+      while (g_hash_table_iter_next (&iter, &file, (gpointer *) &entry))
+        if (!g_hash_table_contains (wanted, file))
+          {
+            thunar_standard_view_model_totals_account (totals, entry, FALSE);
+            if (totals->last_modified_file == file)
+              {
+                totals->last_modified_file = NULL;
+                totals->last_modified_valid = FALSE;
+              }
+            g_hash_table_iter_remove (&iter);
+          }
+    }
+
+  g_hash_table_destroy (wanted);
+}
+
+
+
+static ThunarFile *
+thunar_standard_view_model_totals_get_last_modified (ThunarStandardViewModelTotals *totals)
+{
+  ThunarStandardViewModelTotalsEntry *entry;
+  GHashTableIter                      iter;
+  gpointer                            file;
+
+  if (!totals->last_modified_valid)
+    {
+      /* the newest file left or aged since the last call, look for the one now */
+      totals->last_modified_file = NULL;
+      totals->last_modified_date = 0;
+
+      g_hash_table_iter_init (&iter, totals->entries);
+      while (g_hash_table_iter_next (&iter, &file, (gpointer *) &entry))
+        if (totals->last_modified_file == NULL || totals->last_modified_date <= entry->date)
+          {
+            totals->last_modified_file = file;
+            totals->last_modified_date = entry->date;
+          }
+
+      totals->last_modified_valid = TRUE;
+    }
+
+  return totals->last_modified_file;
+}
+
+
+
+static MatchKind
+_thunar_standard_view_model_match_kind (const gchar *pattern,
+                                        gchar      **literal_return)
+{
+  gsize     len = strlen (pattern);
+  gboolean  leading, trailing;
+  gchar    *literal;
+
+  leading = (len > 0 && pattern[0] == '*');
+  trailing = (len > (leading ? 1 : 0) && pattern[len - 1] == '*');
+
+  /* strip the leading and trailing '*' and look for other wildcards */
+  literal = g_strndup (pattern + (leading ? 1 : 0), len - (leading ? 1 : 0) - (trailing ? 1 : 0));
+  if (strchr (literal, '*') != NULL || strchr (literal, '?') != NULL)
+    {
+      g_free (literal);
+      *literal_return = NULL;
+      return MATCH_GLOB;
+    }
+
+  *literal_return = literal;
+  if (leading && trailing)
+    return MATCH_SUBSTRING;
+  else if (leading)
+    return MATCH_SUFFIX;
+  else if (trailing)
+    return MATCH_PREFIX;
+  else
+    return MATCH_EXACT;
+}
+
+
+
+static gboolean
+_thunar_standard_view_model_match_name (struct _MatchForeach *mf,
+                                        const gchar          *name,
+                                        gsize                 len)
+{
+  switch (mf->kind)
+    {
+    case MATCH_EXACT:
+      return len == mf->literal_len && memcmp (name, mf->literal, len) == 0;
+
+    case MATCH_PREFIX:
+      return len >= mf->literal_len && memcmp (name, mf->literal, mf->literal_len) == 0;
+
+    case MATCH_SUFFIX:
+      return len >= mf->literal_len && memcmp (name + len - mf->literal_len, mf->literal, mf->literal_len) == 0;
+
+    case MATCH_SUBSTRING:
+      return strstr (name, mf->literal) != NULL;
+
+    default:
+      return g_pattern_spec_match (mf->pspec, len, name, NULL);
+    }
+}
+
+
+
 static gboolean
 _thunar_standard_view_model_match_pattern_foreach (GtkTreeModel *model,
                                                    GtkTreePath  *path,
@@ -758,6 +1244,7 @@ _thunar_standard_view_model_match_pattern_foreach (GtkTreeModel *model,
 {
   ThunarFile           *file;
   const gchar          *display_name;
+  const gchar          *p;
   gchar                *normalized_display_name;
   gboolean              name_matched;
   struct _MatchForeach *mf = (struct _MatchForeach *) data;
@@ -767,11 +1254,37 @@ _thunar_standard_view_model_match_pattern_foreach (GtkTreeModel *model,
     return FALSE;
 
   display_name = thunar_file_get_display_name (file);
-  normalized_display_name = thunar_g_utf8_normalize_for_search (display_name,
-                                                                !mf->match_diacritics,
-                                                                !mf->case_sensitive);
-  name_matched = g_pattern_spec_match_string (mf->pspec, normalized_display_name);
-  g_free (normalized_display_name);
+
+  /* plain ASCII names are left alone by the normalization, apart from
+   * their case, so skip the expensive Unicode handling for them */
+  for (p = display_name; *p != '\0' && ((guchar) *p) < 0x80; ++p)
+    ;
+
+  if (G_LIKELY (*p == '\0'))
+    {
+      if (mf->case_sensitive)
+        {
+          name_matched = _thunar_standard_view_model_match_name (mf, display_name, p - display_name);
+        }
+      else
+        {
+          g_string_truncate (mf->buffer, 0);
+          for (p = display_name; *p != '\0'; ++p)
+            g_string_append_c (mf->buffer, g_ascii_tolower (*p));
+          name_matched = _thunar_standard_view_model_match_name (mf, mf->buffer->str, mf->buffer->len);
+        }
+    }
+  else
+    {
+      normalized_display_name = thunar_g_utf8_normalize_for_search (display_name,
+                                                                    !mf->match_diacritics,
+                                                                    !mf->case_sensitive);
+      name_matched = normalized_display_name != NULL
+                     && _thunar_standard_view_model_match_name (mf, normalized_display_name, strlen (normalized_display_name));
+      g_free (normalized_display_name);
+    }
+
+  g_object_unref (file);
 
   if (name_matched)
     mf->paths = g_list_prepend (mf->paths, gtk_tree_path_copy (path));
@@ -810,21 +1323,445 @@ thunar_standard_view_model_get_paths_for_pattern (ThunarStandardViewModel *model
   _thunar_return_val_if_fail (THUNAR_IS_STANDARD_VIEW_MODEL (model), NULL);
   _thunar_return_val_if_fail (g_utf8_validate (pattern, -1, NULL), NULL);
 
-  /* compile the pattern */
+  /* compile the pattern, simple patterns like "*.log" are matched without the GPatternSpec */
   normalized_pattern = thunar_g_utf8_normalize_for_search (pattern, !match_diacritics, !case_sensitive);
-  mf.pspec = g_pattern_spec_new (normalized_pattern);
+  mf.kind = _thunar_standard_view_model_match_kind (normalized_pattern, &mf.literal);
+  mf.literal_len = (mf.literal != NULL) ? strlen (mf.literal) : 0;
+  mf.pspec = (mf.kind == MATCH_GLOB) ? g_pattern_spec_new (normalized_pattern) : NULL;
   g_free (normalized_pattern);
 
   mf.paths = NULL;
   mf.case_sensitive = case_sensitive;
   mf.match_diacritics = match_diacritics;
+  mf.buffer = g_string_sized_new (256);
 
   /* find all rows that match the given pattern */
   gtk_tree_model_foreach (GTK_TREE_MODEL (model),
                           _thunar_standard_view_model_match_pattern_foreach, &mf);
 
   /* release the pattern */
-  g_pattern_spec_free (mf.pspec);
+  if (mf.pspec != NULL)
+    g_pattern_spec_free (mf.pspec);
+  g_free (mf.literal);
+  g_string_free (mf.buffer, TRUE);
 
   return mf.paths;
 }
+
+
+
+/**
+ * thunar_standard_view_model_results_new:
+ * @func      : the function which inserts a batch of results into the model.
+ * @user_data : the data passed to @func.
+ *
+ * Allocates the channel between a search job and the model showing its
+ * results. The job pushes its results from its threads, and while the
+ * channel is started, the main loop hands the pending results to @func
+ * at a fixed interval, so the model inserts them in a few big batches.
+ *
+ * Return value: the newly allocated channel, free with
+ *               thunar_standard_view_model_results_free().
+ **/
+ThunarStandardViewModelResults *
+thunar_standard_view_model_results_new (ThunarStandardViewModelResultsFunc func,
+                                        gpointer                           user_data)
+{
+  ThunarStandardViewModelResults *results;
+
+  _thunar_return_val_if_fail (func != NULL, NULL);
+
+  results = g_new0 (ThunarStandardViewModelResults, 1);
+  g_mutex_init (&results->mutex);
+  results->func = func;
+  results->user_data = user_data;
+
+  return results;
+}
+
+
+
+void
+thunar_standard_view_model_results_free (ThunarStandardViewModelResults *results)
+{
+  if (results == NULL)
+    return;
+
+  thunar_standard_view_model_results_stop (results, FALSE);
+  g_mutex_clear (&results->mutex);
+  g_free (results);
+}
+
+
+
+static void
+thunar_standard_view_model_results_flush (ThunarStandardViewModelResults *results)
+{
+  GList *files;
+
+  g_mutex_lock (&results->mutex);
+  files = results->files;
+  results->files = NULL;
+  g_mutex_unlock (&results->mutex);
+
+  /* the job can go on pushing while the model inserts the batch */
+  if (files != NULL)
+    {
+      (*results->func) (files, results->user_data);
+      thunar_g_list_free_full (files);
+    }
+}
+
+
+
+static gboolean
+thunar_standard_view_model_results_timer (gpointer user_data)
+{
+  thunar_standard_view_model_results_flush (user_data);
+
+  return G_SOURCE_CONTINUE;
+}
+
+
+
+/**
+ * thunar_standard_view_model_results_start:
+ * @results : a #ThunarStandardViewModelResults.
+ *
+ * Starts handing the pushed results to the model, to be called when
+ * the search job is launched.
+ **/
+void
+thunar_standard_view_model_results_start (ThunarStandardViewModelResults *results)
+{
+  _thunar_return_if_fail (results != NULL);
+
+  if (results->timer_id == 0)
+    results->timer_id = g_timeout_add (THUNAR_STANDARD_VIEW_MODEL_RESULTS_INTERVAL,
+                                       thunar_standard_view_model_results_timer, results);
+}
+
+
+
+/**
+ * thunar_standard_view_model_results_stop:
+ * @results : a #ThunarStandardViewModelResults.
+ * @flush   : whether the pending results are handed to the model.
+ *
+ * Stops handing the pushed results to the model. With @flush, the
+ * pending results are inserted right away, e.g. when the search job
+ * finished. Otherwise they are dropped, e.g. when the search changed.
+ **/
+void
+thunar_standard_view_model_results_stop (ThunarStandardViewModelResults *results,
+                                         gboolean                        flush)
+{
+  _thunar_return_if_fail (results != NULL);
+
+  if (results->timer_id != 0)
+    {
+      g_source_remove (results->timer_id);
+      results->timer_id = 0;
+
+      if (flush)
+        thunar_standard_view_model_results_flush (results);
+    }
+
+  g_mutex_lock (&results->mutex);
+  thunar_g_list_free_full (results->files);
+  results->files = NULL;
+  g_mutex_unlock (&results->mutex);
+}
+
+
+
+/**
+ * thunar_standard_view_model_results_push:
+ * @results : a #ThunarStandardViewModelResults.
+ * @files   : (transfer full): the #ThunarFile<!---->s found by the search.
+ *
+ * Queues @files for the next batch of the model. May be called from
+ * any thread.
+ **/
+void
+thunar_standard_view_model_results_push (ThunarStandardViewModelResults *results,
+                                         GList                          *files)
+{
+  _thunar_return_if_fail (results != NULL);
+
+  /* the order does not matter, the model sorts the rows */
+  g_mutex_lock (&results->mutex);
+  results->files = g_list_concat (files, results->files);
+  g_mutex_unlock (&results->mutex);
+}
+
+
+
+/* the same folding as the default search of GtkTreeView */
+static gchar *
+thunar_standard_view_model_typeahead_fold (const gchar *str)
+{
+  gchar *normalized;
+  gchar *folded;
+
+  normalized = g_utf8_normalize (str, -1, G_NORMALIZE_ALL);
+  if (G_UNLIKELY (normalized == NULL))
+    return g_strdup ("");
+
+  folded = g_utf8_casefold (normalized, -1);
+  g_free (normalized);
+
+  return folded;
+}
+
+
+
+static void
+thunar_standard_view_model_typeahead_name_free (gpointer data)
+{
+  ThunarStandardViewModelTypeaheadName *name = data;
+
+  g_free (name->display_name);
+  g_free (name->folded);
+  g_slice_free (ThunarStandardViewModelTypeaheadName, name);
+}
+
+
+
+static void
+thunar_standard_view_model_typeahead_free (gpointer data)
+{
+  ThunarStandardViewModelTypeahead *typeahead = data;
+
+  g_hash_table_destroy (typeahead->names);
+  if (typeahead->sorted != NULL)
+    g_ptr_array_unref (typeahead->sorted);
+  g_free (typeahead->key);
+  g_free (typeahead->key_folded);
+  g_slice_free (ThunarStandardViewModelTypeahead, typeahead);
+}
+
+
+
+static void
+thunar_standard_view_model_typeahead_invalidate (ThunarStandardViewModelTypeahead *typeahead)
+{
+  /* rebuilt on the next key, the names of the unchanged files are kept */
+  if (typeahead->sorted != NULL)
+    {
+      g_ptr_array_unref (typeahead->sorted);
+      typeahead->sorted = NULL;
+    }
+
+  g_free (typeahead->key);
+  typeahead->key = NULL;
+}
+
+
+
+static void
+thunar_standard_view_model_typeahead_row_changed (GtkTreeModel                     *model,
+                                                  GtkTreePath                      *path,
+                                                  GtkTreeIter                      *iter,
+                                                  ThunarStandardViewModelTypeahead *typeahead)
+{
+  ThunarStandardViewModelTypeaheadName *name;
+  ThunarFile                           *file;
+
+  /* most changes are about e.g. thumbnails, only a new name matters */
+  if (typeahead->sorted == NULL)
+    return;
+
+  file = thunar_standard_view_model_get_file (THUNAR_STANDARD_VIEW_MODEL (model), iter);
+  if (file == NULL)
+    return;
+
+  name = g_hash_table_lookup (typeahead->names, file);
+  if (name == NULL || g_strcmp0 (name->display_name, thunar_file_get_display_name (file)) != 0)
+    thunar_standard_view_model_typeahead_invalidate (typeahead);
+
+  g_object_unref (file);
+}
+
+
+
+static const gchar *
+thunar_standard_view_model_typeahead_lookup (ThunarStandardViewModelTypeahead *typeahead,
+                                             ThunarFile                       *file)
+{
+  ThunarStandardViewModelTypeaheadName *name;
+  const gchar                          *display_name;
+
+  display_name = thunar_file_get_display_name (file);
+
+  name = g_hash_table_lookup (typeahead->names, file);
+
+  /* while rebuilding, the entries of the rows still there are taken over */
+  if (name == NULL && typeahead->previous_names != NULL)
+    {
+      name = g_hash_table_lookup (typeahead->previous_names, file);
+      if (name != NULL)
+        {
+          g_hash_table_steal (typeahead->previous_names, file);
+          g_hash_table_insert (typeahead->names, file, name);
+        }
+    }
+
+  if (G_UNLIKELY (name == NULL || g_strcmp0 (name->display_name, display_name) != 0))
+    {
+      name = g_slice_new (ThunarStandardViewModelTypeaheadName);
+      name->display_name = g_strdup (display_name);
+      name->folded = thunar_standard_view_model_typeahead_fold (display_name);
+      g_hash_table_replace (typeahead->names, file, name);
+    }
+
+  return name->folded;
+}
+
+
+
+static gboolean
+thunar_standard_view_model_typeahead_collect (GtkTreeModel *model,
+                                              GtkTreePath  *path,
+                                              GtkTreeIter  *iter,
+                                              gpointer      user_data)
+{
+  ThunarStandardViewModelTypeahead *typeahead = user_data;
+  ThunarFile                       *file;
+
+  file = thunar_standard_view_model_get_file (THUNAR_STANDARD_VIEW_MODEL (model), iter);
+  if (file != NULL)
+    {
+      g_ptr_array_add (typeahead->sorted, g_strdup (thunar_standard_view_model_typeahead_lookup (typeahead, file)));
+      g_object_unref (file);
+    }
+
+  return FALSE;
+}
+
+
+
+static gint
+thunar_standard_view_model_typeahead_compare (gconstpointer a,
+                                              gconstpointer b)
+{
+  return strcmp (*(const gchar *const *) a, *(const gchar *const *) b);
+}
+
+
+
+static ThunarStandardViewModelTypeahead *
+thunar_standard_view_model_typeahead_get (GtkTreeModel *model)
+{
+  ThunarStandardViewModelTypeahead *typeahead;
+
+  if (G_UNLIKELY (model_typeahead_quark == 0))
+    model_typeahead_quark = g_quark_from_static_string ("thunar-standard-view-model-typeahead");
+
+  typeahead = g_object_get_qdata (G_OBJECT (model), model_typeahead_quark);
+  if (G_LIKELY (typeahead != NULL))
+    return typeahead;
+
+  typeahead = g_slice_new0 (ThunarStandardViewModelTypeahead);
+  typeahead->names = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+                                            thunar_standard_view_model_typeahead_name_free);
+  g_object_set_qdata_full (G_OBJECT (model), model_typeahead_quark, typeahead,
+                           thunar_standard_view_model_typeahead_free);
+
+  /* any change of the rows may change the set of names */
+  g_signal_connect_swapped (model, "row-inserted", G_CALLBACK (thunar_standard_view_model_typeahead_invalidate), typeahead);
+  g_signal_connect_swapped (model, "row-deleted", G_CALLBACK (thunar_standard_view_model_typeahead_invalidate), typeahead);
+  g_signal_connect (model, "row-changed", G_CALLBACK (thunar_standard_view_model_typeahead_row_changed), typeahead);
+
+  return typeahead;
+}
+
+
+
+/**
+ * thunar_standard_view_model_search_equal_func:
+ * @model     : a #ThunarStandardViewModel.
+ * @column    : the search column, unused.
+ * @key       : the text typed by the user.
+ * @iter      : the row to compare.
+ * @user_data : unused.
+ *
+ * The #GtkTreeViewSearchEqualFunc for the type-ahead find of the views,
+ * which matches the rows whose display name starts with @key like the
+ * default one, but without fetching and folding the name of every row
+ * on every key. The folded names are kept per file, and a binary search
+ * in their sorted array tells right away when no row matches at all,
+ * so the view only walks its rows up to the first match.
+ *
+ * Return value: %FALSE if the row at @iter matches @key.
+ **/
+gboolean
+thunar_standard_view_model_search_equal_func (GtkTreeModel *model,
+                                              gint          column,
+                                              const gchar  *key,
+                                              GtkTreeIter  *iter,
+                                              gpointer      user_data)
+{
+  ThunarStandardViewModelTypeahead *typeahead;
+  ThunarFile                       *file;
+  const gchar                      *folded;
+  gboolean                          matches;
+  guint                             lower, upper, middle;
+
+  _thunar_return_val_if_fail (THUNAR_IS_STANDARD_VIEW_MODEL (model), TRUE);
+  _thunar_return_val_if_fail (key != NULL, TRUE);
+
+  typeahead = thunar_standard_view_model_typeahead_get (model);
+
+  /* a new key, the view calls this for the same key on consecutive rows */
+  if (typeahead->key == NULL || strcmp (typeahead->key, key) != 0)
+    {
+      if (typeahead->sorted == NULL)
+        {
+          /* the entries of the files gone are dropped */
+          typeahead->previous_names = typeahead->names;
+          typeahead->names = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+                                                    thunar_standard_view_model_typeahead_name_free);
+
+          typeahead->sorted = g_ptr_array_new_with_free_func (g_free);
+          gtk_tree_model_foreach (model, thunar_standard_view_model_typeahead_collect, typeahead);
+
+          g_hash_table_destroy (typeahead->previous_names);
+          typeahead->previous_names = NULL;
+
+          g_ptr_array_sort (typeahead->sorted, thunar_standard_view_model_typeahead_compare);
+        }
+
+      g_free (typeahead->key);
+      g_free (typeahead->key_folded);
+      typeahead->key = g_strdup (key);
+      typeahead->key_folded = thunar_standard_view_model_typeahead_fold (key);
+      typeahead->key_folded_len = strlen (typeahead->key_folded);
+
+      /* the first name not sorting before the key is the only candidate */
+      for (lower = 0, upper = typeahead->sorted->len; lower < upper;)
+        {
+          middle = lower + (upper - lower) / 2;
+          if (strcmp (g_ptr_array_index (typeahead->sorted, middle), typeahead->key_folded) < 0)
+            lower = middle + 1;
+          else
+            upper = middle;
+        }
+      typeahead->key_matches = (lower < typeahead->sorted->len
+                                && strncmp (g_ptr_array_index (typeahead->sorted, lower),
+                                            typeahead->key_folded, typeahead->key_folded_len) == 0);
+    }
+
+  if (!typeahead->key_matches)
+    return TRUE;
+
+  file = thunar_standard_view_model_get_file (THUNAR_STANDARD_VIEW_MODEL (model), iter);
+  if (G_UNLIKELY (file == NULL))
+    return TRUE;
+
+  folded = thunar_standard_view_model_typeahead_lookup (typeahead, file);
+  matches = (strncmp (folded, typeahead->key_folded, typeahead->key_folded_len) == 0);
+  g_object_unref (file);
+
+  return !matches;
+}
@@ -55,8 +55,10 @@
 
 G_BEGIN_DECLS;
 
-typedef struct _ThunarStandardViewModelIface ThunarStandardViewModelIface;
-typedef struct _ThunarStandardViewModel      ThunarStandardViewModel;
+typedef struct _ThunarStandardViewModelIface  ThunarStandardViewModelIface;
+typedef struct _ThunarStandardViewModel       ThunarStandardViewModel;
+typedef struct _ThunarStandardViewModelTotals ThunarStandardViewModelTotals;
+typedef struct _ThunarStandardViewModelResults ThunarStandardViewModelResults;
 
 typedef enum ThunarStandardViewModelSearch
 {
@@ -76,6 +78,9 @@ typedef gint (*ThunarSortFunc) (const ThunarFile *a,
                                 const ThunarFile *b,
                                 gboolean          case_sensitive);
 
+typedef void (*ThunarStandardViewModelResultsFunc) (GList   *files,
+                                                    gpointer user_data);
+
 #define THUNAR_TYPE_STANDARD_VIEW_MODEL            (thunar_standard_view_model_get_type ())
 #define THUNAR_STANDARD_VIEW_MODEL(obj)            (G_TYPE_CHECK_INSTANCE_CAST ((obj), THUNAR_TYPE_STANDARD_VIEW_MODEL, ThunarStandardViewModel))
 #define THUNAR_IS_STANDARD_VIEW_MODEL(obj)         (G_TYPE_CHECK_INSTANCE_TYPE ((obj), THUNAR_TYPE_STANDARD_VIEW_MODEL))
@@ -111,6 +116,8 @@ struct _ThunarStandardViewModelIface
                                               ThunarJob                *job);
   void             (*add_search_files)       (ThunarStandardViewModel  *model,
                                               GList                    *files);
+  ThunarStandardViewModelTotals
+                  *(*get_totals)             (ThunarStandardViewModel  *model);
 };
 
 GType            thunar_standard_view_model_get_type               (void) G_GNUC_CONST;
@@ -142,14 +149,44 @@ GList           *thunar_standard_view_model_get_paths_for_pattern  (ThunarStanda
                                                                     gboolean                  case_sensitive,
                                                                     gboolean                  match_diacritics);
 
-gchar           *thunar_standard_view_model_get_statusbar_text     (ThunarStandardViewModel  *model,
-                                                                    GList                    *selected_items);
+gchar           *thunar_standard_view_model_get_statusbar_text     (ThunarStandardViewModel       *model,
+                                                                    GList                         *selected_items,
+                                                                    ThunarStandardViewModelTotals *selection_totals);
 ThunarJob       *thunar_standard_view_model_get_job                (ThunarStandardViewModel  *model);
 void             thunar_standard_view_model_set_job                (ThunarStandardViewModel  *model,
                                                                     ThunarJob                *job);
 void             thunar_standard_view_model_add_search_files       (ThunarStandardViewModel  *model,
                                                                     GList                    *files);
 
+gboolean         thunar_standard_view_model_search_equal_func      (GtkTreeModel             *model,
+                                                                    gint                      column,
+                                                                    const gchar              *key,
+                                                                    GtkTreeIter              *iter,
+                                                                    gpointer                  user_data);
+
+/* running counts of a set of files, like the top level rows of a model or the selection of a view */
+ThunarStandardViewModelTotals *thunar_standard_view_model_totals_new       (void) G_GNUC_MALLOC;
+void                           thunar_standard_view_model_totals_free      (ThunarStandardViewModelTotals *totals);
+void                           thunar_standard_view_model_totals_clear     (ThunarStandardViewModelTotals *totals);
+void                           thunar_standard_view_model_totals_add       (ThunarStandardViewModelTotals *totals,
+                                                                            ThunarFile                    *file);
+void                           thunar_standard_view_model_totals_remove    (ThunarStandardViewModelTotals *totals,
+                                                                            ThunarFile                    *file);
+void                           thunar_standard_view_model_totals_changed   (ThunarStandardViewModelTotals *totals,
+                                                                            ThunarFile                    *file);
+void                           thunar_standard_view_model_totals_set_files (ThunarStandardViewModelTotals *totals,
+                                                                            GList                         *files);
+
+/* the files found by a search job, handed to the model in batches from the main loop */
+ThunarStandardViewModelResults *thunar_standard_view_model_results_new   (ThunarStandardViewModelResultsFunc func,
+                                                                          gpointer                           user_data) G_GNUC_MALLOC;
+void                            thunar_standard_view_model_results_free  (ThunarStandardViewModelResults    *results);
+void                            thunar_standard_view_model_results_start (ThunarStandardViewModelResults    *results);
+void                            thunar_standard_view_model_results_stop  (ThunarStandardViewModelResults    *results,
+                                                                          gboolean                           flush);
+void                            thunar_standard_view_model_results_push  (ThunarStandardViewModelResults    *results,
+                                                                          GList                             *files);
+
 G_END_DECLS;
 
 #endif /* __THUNAR_STANDARD_VIEW_MODEL__ */
@@ -36,10 +36,13 @@
 
 #include "thunar/thunar-action-manager.h"
 #include "thunar/thunar-application.h"
+#include "thunar/thunar-cache-registry.h"
+#include "thunar/thunar-count-scheduler.h"
 #include "thunar/thunar-menu.h"
 #include "thunar/thunar-dialogs.h"
 #include "thunar/thunar-dnd.h"
 #include "thunar/thunar-enum-types.h"
+#include "thunar/thunar-filesystem-cache.h"
 #include "thunar/thunar-gio-extensions.h"
 #include "thunar/thunar-gobject-extensions.h"
 #include "thunar/thunar-gtk-extensions.h"
@@ -49,10 +52,13 @@
 #include "thunar/thunar-marshal.h"
 #include "thunar/thunar-pango-extensions.h"
 #include "thunar/thunar-private.h"
+#include "thunar/thunar-profile.h"
 #include "thunar/thunar-properties-dialog.h"
 #include "thunar/thunar-renamer-dialog.h"
 #include "thunar/thunar-simple-job.h"
 #include "thunar/thunar-standard-view.h"
+#include "thunar/thunar-thumbnailer.h"
+#include "thunar/thunar-user.h"
 #include "thunar/thunar-util.h"
 #include "thunar/thunar-details-view.h"
 
@@ -62,6 +68,20 @@
 
 #define THUNAR_STANDARD_VIEW_SELECTION_CHANGED_DELAY_MS 10
 
+/* the visible files are handed to the folder for loading their content types this
+ * long after scrolling or loading files, at most the given number of them */
+#define THUNAR_STANDARD_VIEW_VISIBLE_FILES_DELAY_MS  100
+#define THUNAR_STANDARD_VIEW_VISIBLE_FILES_MAX       1024
+
+/* the files beyond the visible range in the scroll direction are prefetched,
+ * one screen ahead and more when scrolling fast, at most the given number */
+#define THUNAR_STANDARD_VIEW_PREFETCH_SCREENS_MAX    3
+#define THUNAR_STANDARD_VIEW_PREFETCH_FILES_MAX      256
+
+/* the icons are loaded at a new zoom level once it did not change for this long,
+ * the ones of the previous zoom level are scaled meanwhile */
+#define THUNAR_STANDARD_VIEW_ZOOM_SETTLE_DELAY_MS    250
+
 
 
 /* Property identifiers */
@@ -85,6 +105,7 @@ enum
   PROP_SORT_ORDER_DEFAULT,
   PROP_ACCEL_GROUP,
   PROP_MODEL_TYPE,
+  PROP_SUSPENDED,
   N_PROPERTIES
 };
 
@@ -127,6 +148,8 @@ static void                 thunar_standard_view_scale_changed              (GOb
                                                                              gpointer                  user_data);
 static void                 thunar_standard_view_realize                    (GtkWidget                *widget);
 static void                 thunar_standard_view_unrealize                  (GtkWidget                *widget);
+static void                 thunar_standard_view_map                        (GtkWidget                *widget);
+static void                 thunar_standard_view_unmap                      (GtkWidget                *widget);
 static void                 thunar_standard_view_grab_focus                 (GtkWidget                *widget);
 static gboolean             thunar_standard_view_draw                       (GtkWidget                *widget,
                                                                              cairo_t                  *cr);
@@ -177,6 +200,9 @@ static void                 thunar_standard_view_current_directory_destroy  (Thu
                                                                              ThunarStandardView       *standard_view);
 static void                 thunar_standard_view_current_directory_changed  (ThunarFile               *current_directory,
                                                                              ThunarStandardView       *standard_view);
+static void                 thunar_standard_view_filesystem_changed         (ThunarFilesystemCache    *filesystem_cache,
+                                                                             GFile                    *root,
+                                                                             ThunarStandardView       *standard_view);
 static GList               *thunar_standard_view_get_selected_files_view    (ThunarView               *view);
 static void                 thunar_standard_view_set_selected_files_view    (ThunarView               *view,
                                                                              GList                    *selected_files);
@@ -247,6 +273,10 @@ static void                 thunar_standard_view_rows_reordered             (Thu
                                                                              GtkTreeIter              *iter,
                                                                              gpointer                  new_order,
                                                                              ThunarStandardView       *standard_view);
+static void                 thunar_standard_view_row_changed                (ThunarStandardViewModel  *model,
+                                                                             GtkTreePath              *path,
+                                                                             GtkTreeIter              *iter,
+                                                                             ThunarStandardView       *standard_view);
 static void                 thunar_standard_view_error                      (ThunarStandardViewModel          *model,
                                                                              const GError             *error,
                                                                              ThunarStandardView       *standard_view);
@@ -282,6 +312,22 @@ static void                 thunar_standard_view_cell_layout_data_func
                                                                                     GtkTreeIter              *iter,
                                                                                     gpointer                  data);
 static void                 thunar_standard_view_set_model                  (ThunarStandardView       *standard_view);
+static void                 thunar_standard_view_schedule_visible_files     (ThunarStandardView       *standard_view);
+static void                 thunar_standard_view_select_paths               (ThunarStandardView       *standard_view,
+                                                                             GList                    *paths);
+static void                 thunar_standard_view_files_added                (ThunarStandardView       *standard_view,
+                                                                             GList                    *files);
+static gboolean             thunar_standard_view_early_selection_idle       (gpointer                  user_data);
+static GList               *thunar_standard_view_prefetch_files             (ThunarStandardView       *standard_view,
+                                                                             GtkTreePath              *start_path,
+                                                                             GtkTreePath              *end_path);
+static gboolean             thunar_standard_view_suspend_timer              (gpointer                  user_data);
+static void                 thunar_standard_view_suspend                    (ThunarStandardView       *standard_view);
+static void                 thunar_standard_view_suspend_shed               (gpointer                  user_data,
+                                                                             GMemoryMonitorWarningLevel level);
+static void                 thunar_standard_view_resume                     (ThunarStandardView       *standard_view);
+static gboolean             thunar_standard_view_background_load_idle       (gpointer                  user_data);
+static void                 thunar_standard_view_background_load_next       (void);
 
 struct _ThunarStandardViewPrivate
 {
@@ -293,6 +339,7 @@ struct _ThunarStandardViewPrivate
 
   /* zoom-level support */
   ThunarZoomLevel         zoom_level;
+  guint                   zoom_settle_timer_id;
 
   /* directory specific settings */
   gboolean                directory_specific_settings;
@@ -312,6 +359,30 @@ struct _ThunarStandardViewPrivate
   gint                    drag_x;
   gint                    drag_y;
 
+  /* visibility driven content type loading and thumbnailing */
+  guint                   visible_files_timer_id;
+  ThunarThumbnailer      *thumbnailer;
+
+  /* the first visible row on the last update, -1 if unknown, and the
+   * direction of the last scroll: 1 downwards, -1 upwards */
+  gint                    visible_start;
+  gint                    scroll_direction;
+
+  /* free space shown in the statusbar */
+  ThunarFilesystemCache  *filesystem_cache;
+
+  /* owner and group names arrive asynchronously */
+  ThunarUserManager      *user_manager;
+
+  /* background tabs release their folder after a while, the
+   * selection is kept aside until the tab is shown again */
+  guint                   suspend_timer_id;
+  gboolean                suspended;
+  GList                  *suspended_selection;
+
+  /* id of the traced navigation to the current directory until it is painted */
+  guint                   navigation_id;
+
   /* drop site support */
   guint                   drop_data_ready : 1; /* whether the drop data was received already */
   guint                   drop_highlight : 1;
@@ -340,8 +411,14 @@ struct _ThunarStandardViewPrivate
 
   /* #GList of currently selected #ThunarFile<!---->s */
   GList                  *selected_files;
+
+  /* running totals of the selected_files for the statusbar text */
+  ThunarStandardViewModelTotals *selection_totals;
   guint                   restore_selection_idle_id;
 
+  /* applies the selection of a loading view once its rows exist */
+  guint                   early_selection_idle_id;
+
   /* row insert and delete signal IDs, for blocking/unblocking */
   gulong                  row_deleted_id;
 
@@ -415,6 +492,12 @@ static const GtkTargetEntry drop_targets[] =
 static guint       standard_view_signals[LAST_SIGNAL];
 static GParamSpec *standard_view_props[N_PROPERTIES] = { NULL, };
 
+/* views created suspended, which load one after another when the
+ * application is idle, unless they are shown earlier */
+static GQueue              background_loads = G_QUEUE_INIT;
+static ThunarStandardView *background_loading = NULL;
+static guint               background_load_id = 0;
+
 
 
 G_DEFINE_ABSTRACT_TYPE_WITH_CODE (ThunarStandardView, thunar_standard_view, GTK_TYPE_SCROLLED_WINDOW,
@@ -543,6 +626,8 @@ thunar_standard_view_class_init (ThunarStandardViewClass *klass)
   gtkwidget_class = GTK_WIDGET_CLASS (klass);
   gtkwidget_class->realize = thunar_standard_view_realize;
   gtkwidget_class->unrealize = thunar_standard_view_unrealize;
+  gtkwidget_class->map = thunar_standard_view_map;
+  gtkwidget_class->unmap = thunar_standard_view_unmap;
   gtkwidget_class->grab_focus = thunar_standard_view_grab_focus;
   gtkwidget_class->draw = thunar_standard_view_draw;
 
@@ -699,6 +784,20 @@ thunar_standard_view_class_init (ThunarStandardViewClass *klass)
                           G_TYPE_NONE,
                           EXO_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY);
 
+  /**
+   * ThunarStandardView:suspended:
+   *
+   * Whether the view starts without loading its first directory. The
+   * folder is loaded when the view is shown, or in the background once
+   * the application is idle. Used for the tabs of a restored session.
+   **/
+  standard_view_props[PROP_SUSPENDED] =
+      g_param_spec_boolean ("suspended",
+                            "Suspended",
+                            NULL,
+                            FALSE,
+                            EXO_PARAM_WRITABLE | G_PARAM_CONSTRUCT_ONLY);
+
   /* override ThunarComponent's properties */
   g_iface = g_type_default_interface_peek (THUNAR_TYPE_COMPONENT);
   standard_view_props[PROP_SELECTED_FILES] =
@@ -801,6 +900,7 @@ thunar_standard_view_init (ThunarStandardView *standard_view)
   standard_view->priv = thunar_standard_view_get_instance_private (standard_view);
 
   standard_view->priv->selection_changed_timeout_source = 0;
+  standard_view->priv->selection_totals = thunar_standard_view_model_totals_new ();
 
   /* allocate the scroll_to_files mapping (directory GFile -> first visible child GFile) */
   standard_view->priv->scroll_to_files = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal, g_object_unref, g_object_unref);
@@ -808,6 +908,22 @@ thunar_standard_view_init (ThunarStandardView *standard_view)
   /* grab a reference on the preferences */
   standard_view->preferences = thunar_preferences_get ();
 
+  /* grab a reference on the thumbnailer, to tell it which files are shown */
+  standard_view->priv->thumbnailer = thunar_thumbnailer_get ();
+  standard_view->priv->visible_start = -1;
+  standard_view->priv->scroll_direction = 1;
+
+  /* a background tab releases its folder right away when memory gets scarce */
+  thunar_cache_registry_add ("folders", G_MEMORY_MONITOR_WARNING_LEVEL_MEDIUM, NULL, thunar_standard_view_suspend_shed, standard_view);
+
+  /* the free space in the statusbar arrives asynchronously */
+  standard_view->priv->filesystem_cache = thunar_filesystem_cache_get_default ();
+  g_signal_connect (standard_view->priv->filesystem_cache, "changed", G_CALLBACK (thunar_standard_view_filesystem_changed), standard_view);
+
+  /* so do the names of owners and groups */
+  standard_view->priv->user_manager = thunar_user_manager_get_default ();
+  g_signal_connect_swapped (standard_view->priv->user_manager, "changed", G_CALLBACK (thunar_standard_view_queue_redraw), standard_view);
+
   /* initialize the scrolled window */
   gtk_scrolled_window_set_policy (GTK_SCROLLED_WINDOW (standard_view),
                                   GTK_POLICY_AUTOMATIC,
@@ -921,6 +1037,10 @@ thunar_standard_view_constructor (GType                  type,
   /* setup support to navigate using a horizontal mouse wheel and the back and forward buttons */
   g_signal_connect (G_OBJECT (view), "scroll-event", G_CALLBACK (thunar_standard_view_scroll_event), object);
 
+  /* the content types of the files which become visible are loaded first */
+  g_signal_connect_swapped (G_OBJECT (gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (object))), "value-changed",
+                            G_CALLBACK (thunar_standard_view_schedule_visible_files), object);
+
   /* need to catch certain keys for the internal view widget */
   g_signal_connect (G_OBJECT (view), "key-press-event", G_CALLBACK (thunar_standard_view_key_press_event), object);
 
@@ -954,6 +1074,8 @@ thunar_standard_view_dispose (GObject *object)
 {
   ThunarStandardView *standard_view = THUNAR_STANDARD_VIEW (object);
 
+  thunar_cache_registry_remove (standard_view);
+
   /* unregister the "loading" binding */
   if (G_UNLIKELY (standard_view->loading_binding != NULL))
     {
@@ -969,12 +1091,65 @@ thunar_standard_view_dispose (GObject *object)
   if (G_UNLIKELY (standard_view->priv->drag_timer_id != 0))
     g_source_remove (standard_view->priv->drag_timer_id);
 
-  /* disconnect from file */
+  if (G_UNLIKELY (standard_view->priv->visible_files_timer_id != 0))
+    {
+      g_source_remove (standard_view->priv->visible_files_timer_id);
+      standard_view->priv->visible_files_timer_id = 0;
+    }
+
+  if (G_UNLIKELY (standard_view->priv->zoom_settle_timer_id != 0))
+    {
+      g_source_remove (standard_view->priv->zoom_settle_timer_id);
+      standard_view->priv->zoom_settle_timer_id = 0;
+    }
+
+  /* a closed tab is not suspended anymore */
+  if (standard_view->priv->suspend_timer_id != 0)
+    {
+      g_source_remove (standard_view->priv->suspend_timer_id);
+      standard_view->priv->suspend_timer_id = 0;
+    }
+  g_queue_remove (&background_loads, standard_view);
+  if (background_loading == standard_view)
+    {
+      background_loading = NULL;
+      thunar_standard_view_background_load_next ();
+    }
+  thunar_g_list_free_full (standard_view->priv->suspended_selection);
+  standard_view->priv->suspended_selection = NULL;
+
+  /* neither are pending thumbnails and folder item counts */
+  thunar_count_scheduler_set_visible_files (standard_view, NULL);
+  if (standard_view->priv->thumbnailer != NULL)
+    {
+      thunar_thumbnailer_set_visible_files (standard_view->priv->thumbnailer, standard_view, NULL);
+      g_clear_object (&standard_view->priv->thumbnailer);
+    }
+
+  if (standard_view->priv->filesystem_cache != NULL)
+    {
+      g_signal_handlers_disconnect_by_data (standard_view->priv->filesystem_cache, standard_view);
+      g_clear_object (&standard_view->priv->filesystem_cache);
+    }
+
+  if (standard_view->priv->user_manager != NULL)
+    {
+      g_signal_handlers_disconnect_by_data (standard_view->priv->user_manager, standard_view);
+      g_clear_object (&standard_view->priv->user_manager);
+    }
+
+  /* disconnect from file, a suspended view holds no folder */
   if (standard_view->priv->current_directory != NULL)
     {
-      ThunarFolder *folder = thunar_folder_get_for_file (standard_view->priv->current_directory);
-      g_signal_handlers_disconnect_by_data (folder, standard_view);
-      g_object_unref (folder);
+      if (G_UNLIKELY (standard_view->priv->navigation_id != 0))
+        thunar_profile_navigation_end (thunar_file_get_file (standard_view->priv->current_directory));
+
+      if (!standard_view->priv->suspended)
+        {
+          ThunarFolder *folder = thunar_folder_get_for_file (standard_view->priv->current_directory);
+          g_signal_handlers_disconnect_by_data (folder, standard_view);
+          g_object_unref (folder);
+        }
 
       g_signal_handlers_disconnect_by_data (standard_view->priv->current_directory, standard_view);
       g_object_unref (standard_view->priv->current_directory);
@@ -1011,6 +1186,7 @@ thunar_standard_view_finalize (GObject *object)
 
   /* release the selected_files list (if any) */
   thunar_g_list_free_full (standard_view->priv->selected_files);
+  thunar_standard_view_model_totals_free (standard_view->priv->selection_totals);
 
   /* release the drag path list (just in case the drag-end wasn't fired before) */
   thunar_g_list_free_full (standard_view->priv->drag_g_file_list);
@@ -1048,6 +1224,8 @@ thunar_standard_view_finalize (GObject *object)
   /* remove selection restore timeout */
   if (standard_view->priv->restore_selection_idle_id != 0)
     g_source_remove (standard_view->priv->restore_selection_idle_id);
+  if (standard_view->priv->early_selection_idle_id != 0)
+    g_source_remove (standard_view->priv->early_selection_idle_id);
 
   /* free the statusbar text (if any) */
   if (standard_view->priv->statusbar_text_idle_id != 0)
@@ -1212,6 +1390,11 @@ thunar_standard_view_set_property (GObject      *object,
       (*THUNAR_STANDARD_VIEW_GET_CLASS (standard_view)->set_model) (standard_view);
       break;
 
+    case PROP_SUSPENDED:
+      /* applies to the first directory only, see thunar_standard_view_set_current_directory() */
+      standard_view->priv->suspended = g_value_get_boolean (value);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1277,6 +1460,207 @@ thunar_standard_view_unrealize (GtkWidget *widget)
 
 
 
+static void
+thunar_standard_view_map (GtkWidget *widget)
+{
+  ThunarStandardView *standard_view = THUNAR_STANDARD_VIEW (widget);
+
+  /* the tab is shown again, so it's not idle anymore */
+  if (standard_view->priv->suspend_timer_id != 0)
+    {
+      g_source_remove (standard_view->priv->suspend_timer_id);
+      standard_view->priv->suspend_timer_id = 0;
+    }
+
+  /* reload the folder before the first frame is drawn */
+  if (G_UNLIKELY (standard_view->priv->suspended))
+    thunar_standard_view_resume (standard_view);
+
+  GTK_WIDGET_CLASS (thunar_standard_view_parent_class)->map (widget);
+}
+
+
+
+static void
+thunar_standard_view_unmap (GtkWidget *widget)
+{
+  ThunarStandardView *standard_view = THUNAR_STANDARD_VIEW (widget);
+  guint               timeout;
+
+  GTK_WIDGET_CLASS (thunar_standard_view_parent_class)->unmap (widget);
+
+  /* a background tab releases its folder once it was hidden for a while */
+  g_object_get (G_OBJECT (standard_view->preferences), "misc-suspend-background-tabs-timeout", &timeout, NULL);
+  if (timeout > 0 && standard_view->priv->suspend_timer_id == 0 && !standard_view->priv->suspended)
+    standard_view->priv->suspend_timer_id = g_timeout_add_seconds (timeout, thunar_standard_view_suspend_timer, standard_view);
+}
+
+
+
+static gboolean
+thunar_standard_view_suspend_timer (gpointer user_data)
+{
+  ThunarStandardView *standard_view = THUNAR_STANDARD_VIEW (user_data);
+
+  standard_view->priv->suspend_timer_id = 0;
+
+  if (!gtk_widget_get_mapped (GTK_WIDGET (standard_view)))
+    thunar_standard_view_suspend (standard_view);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+static void
+thunar_standard_view_suspend (ThunarStandardView *standard_view)
+{
+  ThunarFolder *folder;
+
+  _thunar_return_if_fail (THUNAR_IS_STANDARD_VIEW (standard_view));
+
+  /* search results and views waiting for new files can't be rebuilt from the folder */
+  if (standard_view->priv->suspended
+      || standard_view->priv->current_directory == NULL
+      || standard_view->priv->active_search
+      || standard_view->priv->new_files_path_list != NULL)
+    return;
+
+  /* remember the first visible file and the selection */
+  thunar_standard_view_scroll_position_save (standard_view);
+  standard_view->priv->suspended_selection = thunar_g_list_copy_deep (standard_view->priv->selected_files);
+
+  /* stop listening to the folder */
+  folder = thunar_folder_get_for_file (standard_view->priv->current_directory);
+  g_signal_handlers_disconnect_by_data (folder, standard_view);
+  g_object_unref (folder);
+
+  /* drop the rows, which releases the folder and its monitor unless another view shares it */
+  g_object_set (G_OBJECT (gtk_bin_get_child (GTK_BIN (standard_view))), "model", NULL, NULL);
+  g_signal_handler_block (standard_view->model, standard_view->priv->row_deleted_id);
+  thunar_standard_view_model_set_folder (standard_view->model, NULL, NULL);
+  g_signal_handler_unblock (standard_view->model, standard_view->priv->row_deleted_id);
+  g_object_set (G_OBJECT (gtk_bin_get_child (GTK_BIN (standard_view))), "model", standard_view->model, NULL);
+
+  standard_view->priv->suspended = TRUE;
+
+  /* released before it finished loading in the background */
+  if (background_loading == standard_view)
+    {
+      background_loading = NULL;
+      thunar_standard_view_background_load_next ();
+    }
+}
+
+
+
+static void
+thunar_standard_view_suspend_shed (gpointer                   user_data,
+                                   GMemoryMonitorWarningLevel level)
+{
+  ThunarStandardView *standard_view = THUNAR_STANDARD_VIEW (user_data);
+
+  /* the files of the folder are accounted by the file cache */
+  if (!gtk_widget_get_mapped (GTK_WIDGET (standard_view)))
+    {
+      if (standard_view->priv->suspend_timer_id != 0)
+        {
+          g_source_remove (standard_view->priv->suspend_timer_id);
+          standard_view->priv->suspend_timer_id = 0;
+        }
+
+      thunar_standard_view_suspend (standard_view);
+    }
+}
+
+
+
+static void
+thunar_standard_view_resume (ThunarStandardView *standard_view)
+{
+  ThunarFolder *folder;
+  ThunarFile   *file;
+  GFile        *first_file;
+  GList        *selected_files;
+
+  _thunar_return_if_fail (THUNAR_IS_STANDARD_VIEW (standard_view));
+  _thunar_return_if_fail (THUNAR_IS_FILE (standard_view->priv->current_directory));
+
+  standard_view->priv->suspended = FALSE;
+
+  /* shown before its turn in the background */
+  g_queue_remove (&background_loads, standard_view);
+
+  /* reopen the folder, which starts from its snapshot if it has one */
+  g_object_set (G_OBJECT (gtk_bin_get_child (GTK_BIN (standard_view))), "model", NULL, NULL);
+  folder = thunar_folder_get_for_file (standard_view->priv->current_directory);
+  g_signal_connect_swapped (folder, "thumbnails-updated", G_CALLBACK (thunar_standard_view_queue_redraw), standard_view);
+  g_signal_connect_swapped (folder, "files-added", G_CALLBACK (thunar_standard_view_schedule_visible_files), standard_view);
+  g_signal_connect_swapped (folder, "files-added", G_CALLBACK (thunar_standard_view_files_added), standard_view);
+  g_signal_connect_swapped (folder, "thumbnails-updated", G_CALLBACK (thunar_standard_view_schedule_visible_files), standard_view);
+  g_signal_handler_block (standard_view->model, standard_view->priv->row_deleted_id);
+  thunar_standard_view_model_set_folder (standard_view->model, folder, NULL);
+  g_signal_handler_unblock (standard_view->model, standard_view->priv->row_deleted_id);
+  g_object_unref (G_OBJECT (folder));
+  g_object_set (G_OBJECT (gtk_bin_get_child (GTK_BIN (standard_view))), "model", standard_view->model, NULL);
+
+  /* reapply the selection, this is deferred until the folder finished loading */
+  selected_files = standard_view->priv->suspended_selection;
+  standard_view->priv->suspended_selection = NULL;
+  thunar_component_set_selected_files (THUNAR_COMPONENT (standard_view), selected_files);
+  thunar_g_list_free_full (selected_files);
+
+  /* and scroll back to the first file that was visible */
+  first_file = g_hash_table_lookup (standard_view->priv->scroll_to_files, thunar_file_get_file (standard_view->priv->current_directory));
+  if (first_file != NULL)
+    {
+      file = thunar_file_cache_lookup (first_file);
+      if (G_LIKELY (file != NULL))
+        {
+          thunar_view_scroll_to_file (THUNAR_VIEW (standard_view), file, FALSE, TRUE, 0.0f, 0.0f);
+          g_object_unref (file);
+        }
+    }
+}
+
+
+
+static gboolean
+thunar_standard_view_background_load_idle (gpointer user_data)
+{
+  ThunarStandardView *standard_view;
+
+  background_load_id = 0;
+
+  /* the queue only holds suspended views that were not shown yet */
+  standard_view = g_queue_pop_head (&background_loads);
+  if (standard_view == NULL)
+    return G_SOURCE_REMOVE;
+
+  /* one folder at a time, so a session with many remote tabs doesn't
+   * flood the network, the next one starts when this one is loaded */
+  background_loading = standard_view;
+  thunar_standard_view_resume (standard_view);
+  if (!standard_view->loading)
+    {
+      background_loading = NULL;
+      thunar_standard_view_background_load_next ();
+    }
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+static void
+thunar_standard_view_background_load_next (void)
+{
+  if (background_load_id == 0 && !g_queue_is_empty (&background_loads))
+    background_load_id = g_idle_add_full (G_PRIORITY_LOW, thunar_standard_view_background_load_idle, NULL, NULL);
+}
+
+
+
 static void
 thunar_standard_view_grab_focus (GtkWidget *widget)
 {
@@ -1299,6 +1683,14 @@ thunar_standard_view_draw (GtkWidget      *widget,
   result = (*GTK_WIDGET_CLASS (thunar_standard_view_parent_class)->draw) (widget, cr);
   cairo_restore (cr);
 
+  /* a traced navigation ends with the first paint of the loaded folder */
+  if (G_UNLIKELY (THUNAR_STANDARD_VIEW (widget)->priv->navigation_id != 0)
+      && !THUNAR_STANDARD_VIEW (widget)->loading)
+    {
+      THUNAR_STANDARD_VIEW (widget)->priv->navigation_id = 0;
+      thunar_profile_navigation_end (thunar_file_get_file (THUNAR_STANDARD_VIEW (widget)->priv->current_directory));
+    }
+
   /* render the folder drop shadow */
   if (G_UNLIKELY (THUNAR_STANDARD_VIEW (widget)->priv->drop_highlight))
     {
@@ -1333,14 +1725,62 @@ thunar_standard_view_get_selected_files_view (ThunarView *view)
 
 
 
+static void
+thunar_standard_view_select_paths (ThunarStandardView *standard_view,
+                                   GList              *paths)
+{
+  GtkTreePath *first_path;
+  GList       *lp;
+
+  /* unselect all previously selected files */
+  (*THUNAR_STANDARD_VIEW_GET_CLASS (standard_view)->unselect_all) (standard_view);
+
+  if (G_UNLIKELY (paths == NULL))
+    return;
+
+  /* determine the first path */
+  for (first_path = paths->data, lp = paths; lp != NULL; lp = lp->next)
+    {
+      /* check if this path is located before the current first_path */
+      if (gtk_tree_path_compare (lp->data, first_path) < 0)
+        first_path = lp->data;
+    }
+
+  /* place the cursor on the first selected path (must be first for GtkTreeView) */
+  (*THUNAR_STANDARD_VIEW_GET_CLASS (standard_view)->set_cursor) (standard_view, first_path, FALSE);
+
+  /* if we don't block the selection changed then for each new selection,
+   * selection_changed handler will be called. selection_changed handler
+   * runs in O(n) time where it iterates over all the n selected paths.
+   * Since we select each file one by one, we will have a worst case
+   * time complexity ~ O(n^2); but instead if we call the handler after
+   * all the necessary files have been selected then time comp = O(n) */
+  (*THUNAR_STANDARD_VIEW_GET_CLASS (standard_view)->block_selection) (standard_view);
+
+  /* select the given tree paths paths */
+  for (lp = paths; lp != NULL; lp = lp->next)
+    {
+      /* select the path */
+      (*THUNAR_STANDARD_VIEW_GET_CLASS (standard_view)->select_path) (standard_view, lp->data);
+    }
+
+  (*THUNAR_STANDARD_VIEW_GET_CLASS (standard_view)->unblock_selection) (standard_view);
+
+  /* call the selection_changed call since we had previously blocked selection */
+  thunar_standard_view_selection_changed (standard_view);
+
+  /* scroll to the first path (previously determined) */
+  (*THUNAR_STANDARD_VIEW_GET_CLASS (standard_view)->scroll_to_path) (standard_view, first_path, FALSE, 0.0f, 0.0f);
+}
+
+
+
 static void
 thunar_standard_view_set_selected_files_component (ThunarComponent *component,
                                                    GList           *selected_files)
 {
   ThunarStandardView *standard_view = THUNAR_STANDARD_VIEW (component);
-  GtkTreePath        *first_path = NULL;
   GList              *paths;
-  GList              *lp;
 
   /* release the previous selected files list (if any) */
   if (G_UNLIKELY (standard_view->priv->selected_files != NULL))
@@ -1361,50 +1801,12 @@ thunar_standard_view_set_selected_files_component (ThunarComponent *component,
       if (G_UNLIKELY (standard_view->model == NULL))
         return;
 
-      /* unselect all previously selected files */
-      (*THUNAR_STANDARD_VIEW_GET_CLASS (standard_view)->unselect_all) (standard_view);
-
       /* determine the tree paths for the given files */
       paths = thunar_standard_view_model_get_paths_for_files (standard_view->model, selected_files);
-      if (G_LIKELY (paths != NULL))
-        {
-          /* determine the first path */
-          for (first_path = paths->data, lp = paths; lp != NULL; lp = lp->next)
-            {
-              /* check if this path is located before the current first_path */
-              if (gtk_tree_path_compare (lp->data, first_path) < 0)
-                first_path = lp->data;
-            }
-
-          /* place the cursor on the first selected path (must be first for GtkTreeView) */
-          (*THUNAR_STANDARD_VIEW_GET_CLASS (standard_view)->set_cursor) (standard_view, first_path, FALSE);
-
-          /* if we don't block the selection changed then for each new selection,
-           * selection_changed handler will be called. selection_changed handler
-           * runs in O(n) time where it iterates over all the n selected paths.
-           * Since we select each file one by one, we will have a worst case
-           * time complexity ~ O(n^2); but instead if we call the handler after
-           * all the necessary files have been selected then time comp = O(n) */
-          (*THUNAR_STANDARD_VIEW_GET_CLASS (standard_view)->block_selection) (standard_view);
-
-          /* select the given tree paths paths */
-          for (first_path = paths->data, lp = paths; lp != NULL; lp = lp->next)
-            {
-              /* select the path */
-              (*THUNAR_STANDARD_VIEW_GET_CLASS (standard_view)->select_path) (standard_view, lp->data);
-            }
-
-          (*THUNAR_STANDARD_VIEW_GET_CLASS (standard_view)->unblock_selection) (standard_view);
-
-          /* call the selection_changed call since we had previously blocked selection */
-          thunar_standard_view_selection_changed (standard_view);
-
-          /* scroll to the first path (previously determined) */
-          (*THUNAR_STANDARD_VIEW_GET_CLASS (standard_view)->scroll_to_path) (standard_view, first_path, FALSE, 0.0f, 0.0f);
+      thunar_standard_view_select_paths (standard_view, paths);
 
-          /* release the tree paths */
-          g_list_free_full (paths, (GDestroyNotify) gtk_tree_path_free);
-        }
+      /* release the tree paths */
+      g_list_free_full (paths, (GDestroyNotify) gtk_tree_path_free);
     }
 }
 
@@ -1513,6 +1915,8 @@ thunar_standard_view_set_current_directory (ThunarNavigator *navigator,
 {
   ThunarStandardView *standard_view = THUNAR_STANDARD_VIEW (navigator);
   ThunarFolder       *folder;
+  gint64              begin_time;
+  gboolean            load_later;
 
   _thunar_return_if_fail (THUNAR_IS_STANDARD_VIEW (standard_view));
   _thunar_return_if_fail (current_directory == NULL || THUNAR_IS_FILE (current_directory));
@@ -1521,20 +1925,40 @@ thunar_standard_view_set_current_directory (ThunarNavigator *navigator,
   if (standard_view->priv->current_directory == current_directory)
     return;
 
-  /* store the current scroll position */
-  if (current_directory != NULL)
+  /* a view created suspended defers loading its first directory */
+  load_later = (standard_view->priv->suspended && standard_view->priv->current_directory == NULL);
+
+  /* store the current scroll position, a suspended view already did */
+  if (current_directory != NULL && !standard_view->priv->suspended)
     thunar_standard_view_scroll_position_save (standard_view);
 
   /* release previous directory */
   if (standard_view->priv->current_directory != NULL)
     {
-      folder = thunar_folder_get_for_file (standard_view->priv->current_directory);
+      /* report the unfinished navigation to it */
+      if (G_UNLIKELY (standard_view->priv->navigation_id != 0))
+        {
+          standard_view->priv->navigation_id = 0;
+          thunar_profile_navigation_end (thunar_file_get_file (standard_view->priv->current_directory));
+        }
+
       g_signal_handlers_disconnect_by_data (standard_view->priv->current_directory, standard_view);
-      g_signal_handlers_disconnect_by_data (folder, standard_view);
-      g_object_unref (folder);
+      if (!standard_view->priv->suspended)
+        {
+          folder = thunar_folder_get_for_file (standard_view->priv->current_directory);
+          g_signal_handlers_disconnect_by_data (folder, standard_view);
+          g_object_unref (folder);
+        }
       g_object_unref (standard_view->priv->current_directory);
     }
 
+  /* the new directory is loaded right away, the stashed selection belonged to the old one */
+  standard_view->priv->suspended = load_later;
+  if (!load_later)
+    g_queue_remove (&background_loads, standard_view);
+  thunar_g_list_free_full (standard_view->priv->suspended_selection);
+  standard_view->priv->suspended_selection = NULL;
+
   /* check if we want to reset the directory */
   if (G_UNLIKELY (current_directory == NULL))
     {
@@ -1559,10 +1983,14 @@ thunar_standard_view_set_current_directory (ThunarNavigator *navigator,
 
   /* take ref on new directory */
   standard_view->priv->current_directory = g_object_ref (current_directory);
+  if (!load_later)
+    standard_view->priv->navigation_id = thunar_profile_navigation_begin (thunar_file_get_file (current_directory));
   g_signal_connect (G_OBJECT (current_directory), "destroy", G_CALLBACK (thunar_standard_view_current_directory_destroy), standard_view);
   g_signal_connect (G_OBJECT (current_directory), "changed", G_CALLBACK (thunar_standard_view_current_directory_changed), standard_view);
 
   /* scroll to top-left when changing folder */
+  standard_view->priv->visible_start = -1;
+  standard_view->priv->scroll_direction = 1;
   gtk_adjustment_set_value (gtk_scrolled_window_get_hadjustment (GTK_SCROLLED_WINDOW (standard_view)), 0.0);
   gtk_adjustment_set_value (gtk_scrolled_window_get_vadjustment (GTK_SCROLLED_WINDOW (standard_view)), 0.0);
 
@@ -1573,23 +2001,40 @@ thunar_standard_view_set_current_directory (ThunarNavigator *navigator,
   if (standard_view->priv->directory_specific_settings)
     thunar_standard_view_apply_directory_specific_settings (standard_view, current_directory);
 
-  /* We drop the model from the view as a simple optimization to speed up
-   * the process of disconnecting the model data from the view.
-   */
-  g_object_set (G_OBJECT (gtk_bin_get_child (GTK_BIN (standard_view))), "model", NULL, NULL);
-
-  /* open the new directory as folder */
-  folder = thunar_folder_get_for_file (current_directory);
-  g_signal_connect_swapped (folder, "thumbnails-updated", G_CALLBACK (thunar_standard_view_queue_redraw), standard_view);
-
-  /* apply the new folder, ignore removal of any old files */
-  g_signal_handler_block (standard_view->model, standard_view->priv->row_deleted_id);
-  thunar_standard_view_model_set_folder (standard_view->model, folder, NULL);
-  g_signal_handler_unblock (standard_view->model, standard_view->priv->row_deleted_id);
-  g_object_unref (G_OBJECT (folder));
+  /* the folder is opened when the view is shown, or by the background loads */
+  if (G_UNLIKELY (load_later))
+    {
+      g_queue_push_tail (&background_loads, standard_view);
+      if (background_load_id == 0 && background_loading == NULL)
+        thunar_standard_view_background_load_next ();
+    }
+  else
+    {
+      /* We drop the model from the view as a simple optimization to speed up
+       * the process of disconnecting the model data from the view.
+       */
+      g_object_set (G_OBJECT (gtk_bin_get_child (GTK_BIN (standard_view))), "model", NULL, NULL);
 
-  /* reconnect our model to the view */
-  g_object_set (G_OBJECT (gtk_bin_get_child (GTK_BIN (standard_view))), "model", standard_view->model, NULL);
+      /* open the new directory as folder */
+      begin_time = thunar_profile_navigation_now (thunar_file_get_file (current_directory));
+      folder = thunar_folder_get_for_file (current_directory);
+      g_signal_connect_swapped (folder, "thumbnails-updated", G_CALLBACK (thunar_standard_view_queue_redraw), standard_view);
+      g_signal_connect_swapped (folder, "files-added", G_CALLBACK (thunar_standard_view_schedule_visible_files), standard_view);
+      g_signal_connect_swapped (folder, "files-added", G_CALLBACK (thunar_standard_view_files_added), standard_view);
+      g_signal_connect_swapped (folder, "thumbnails-updated", G_CALLBACK (thunar_standard_view_schedule_visible_files), standard_view);
+      thunar_profile_navigation_mark (thunar_file_get_file (current_directory), begin_time, "open-folder");
+
+      /* apply the new folder, ignore removal of any old files */
+      begin_time = thunar_profile_navigation_now (thunar_file_get_file (current_directory));
+      g_signal_handler_block (standard_view->model, standard_view->priv->row_deleted_id);
+      thunar_standard_view_model_set_folder (standard_view->model, folder, NULL);
+      g_signal_handler_unblock (standard_view->model, standard_view->priv->row_deleted_id);
+      g_object_unref (G_OBJECT (folder));
+      thunar_profile_navigation_mark (thunar_file_get_file (current_directory), begin_time, "model-set-folder");
+
+      /* reconnect our model to the view */
+      g_object_set (G_OBJECT (gtk_bin_get_child (GTK_BIN (standard_view))), "model", standard_view->model, NULL);
+    }
 
   /* notify all listeners about the new/old current directory */
   g_object_notify_by_pspec (G_OBJECT (standard_view), standard_view_props[PROP_CURRENT_DIRECTORY]);
@@ -1656,6 +2101,20 @@ thunar_standard_view_set_loading (ThunarStandardView *standard_view,
   /* check if we're done loading */
   if (!loading)
     {
+      /* let the next background tab load its folder */
+      if (background_loading == standard_view)
+        {
+          background_loading = NULL;
+          thunar_standard_view_background_load_next ();
+        }
+
+      /* the selection is applied right now */
+      if (standard_view->priv->early_selection_idle_id != 0)
+        {
+          g_source_remove (standard_view->priv->early_selection_idle_id);
+          standard_view->priv->early_selection_idle_id = 0;
+        }
+
       /* remember and reset the file list */
       selected_files = standard_view->priv->selected_files;
       standard_view->priv->selected_files = NULL;
@@ -1739,7 +2198,8 @@ thunar_standard_view_get_statusbar_text (ThunarView *view)
       if (items == NULL && standard_view->loading)
         return _("Loading folder contents...");
 
-      standard_view->priv->statusbar_text = thunar_standard_view_model_get_statusbar_text (standard_view->model, items);
+      standard_view->priv->statusbar_text = thunar_standard_view_model_get_statusbar_text (standard_view->model, items,
+                                                                                          standard_view->priv->selection_totals);
       g_list_free_full (items, (GDestroyNotify) gtk_tree_path_free);
     }
 
@@ -1773,6 +2233,25 @@ thunar_standard_view_get_zoom_level (ThunarView *view)
 
 
 
+static gboolean
+thunar_standard_view_zoom_settle_timer (gpointer user_data)
+{
+  ThunarStandardView *standard_view = THUNAR_STANDARD_VIEW (user_data);
+
+  standard_view->priv->zoom_settle_timer_id = 0;
+
+  /* load the visible icons at the new size, the others once they are drawn */
+  g_object_set (G_OBJECT (standard_view->icon_renderer), "zooming", FALSE, NULL);
+  gtk_widget_queue_draw (GTK_WIDGET (standard_view));
+
+  /* request the thumbnails of the new size */
+  thunar_standard_view_schedule_visible_files (standard_view);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
 static void
 thunar_standard_view_set_zoom_level (ThunarView     *view,
                                      ThunarZoomLevel zoom_level)
@@ -1800,6 +2279,16 @@ thunar_standard_view_set_zoom_level (ThunarView     *view,
 
       standard_view->priv->zoom_level = zoom_level;
 
+      /* a shown folder is drawn with the scaled icons first, the wheel may zoom several levels at once */
+      if (gtk_widget_get_mapped (GTK_WIDGET (standard_view)))
+        {
+          g_object_set (G_OBJECT (standard_view->icon_renderer), "zooming", TRUE, NULL);
+          if (standard_view->priv->zoom_settle_timer_id != 0)
+            g_source_remove (standard_view->priv->zoom_settle_timer_id);
+          standard_view->priv->zoom_settle_timer_id =
+            g_timeout_add (THUNAR_STANDARD_VIEW_ZOOM_SETTLE_DELAY_MS, thunar_standard_view_zoom_settle_timer, standard_view);
+        }
+
       g_object_notify_by_pspec (G_OBJECT (standard_view), standard_view_props[PROP_ZOOM_LEVEL]);
     }
 }
@@ -2242,6 +2731,27 @@ thunar_standard_view_update_statusbar_text (ThunarStandardView *standard_view)
 
 
 
+static void
+thunar_standard_view_filesystem_changed (ThunarFilesystemCache *filesystem_cache,
+                                         GFile                 *root,
+                                         ThunarStandardView    *standard_view)
+{
+  GFile *directory;
+
+  _thunar_return_if_fail (THUNAR_IS_FILESYSTEM_CACHE (filesystem_cache));
+  _thunar_return_if_fail (THUNAR_IS_STANDARD_VIEW (standard_view));
+
+  if (standard_view->priv->current_directory == NULL)
+    return;
+
+  /* refresh the free space if it is about the shown folder */
+  directory = thunar_file_get_file (standard_view->priv->current_directory);
+  if (g_file_equal (directory, root) || g_file_has_prefix (directory, root))
+    thunar_standard_view_update_statusbar_text (standard_view);
+}
+
+
+
 /*
  * Find a fallback directory we can navigate to if the directory gets
  * deleted. It first tries the parent folders, and finally if none can
@@ -2483,11 +2993,15 @@ thunar_standard_view_select_by_pattern (ThunarView *view)
       if (paths != NULL)
         THUNAR_STANDARD_VIEW_GET_CLASS (standard_view)->set_cursor (standard_view, g_list_last (paths)->data, FALSE);
 
+      /* select all matches in one go, instead of handling a selection change per match */
+      THUNAR_STANDARD_VIEW_GET_CLASS (standard_view)->block_selection (standard_view);
       for (lp = paths; lp != NULL; lp = lp->next)
         {
           THUNAR_STANDARD_VIEW_GET_CLASS (standard_view)->select_path (standard_view, lp->data);
           gtk_tree_path_free (lp->data);
         }
+      THUNAR_STANDARD_VIEW_GET_CLASS (standard_view)->unblock_selection (standard_view);
+      thunar_standard_view_selection_changed (standard_view);
       g_list_free (paths);
       g_free (pattern_extended);
     }
@@ -2689,6 +3203,208 @@ thunar_standard_view_motion_notify_event (GtkWidget          *view,
 
 
 
+static GList*
+thunar_standard_view_prefetch_files (ThunarStandardView *standard_view,
+                                     GtkTreePath        *start_path,
+                                     GtkTreePath        *end_path)
+{
+  GtkTreeIter iter;
+  ThunarFile *file;
+  GList      *files = NULL;
+  gint        n_visible;
+  gint        n_prefetch;
+  gint        start;
+  gint        delta;
+  gint        n;
+
+  /* the rows moved since the last update tell the direction and speed of scrolling */
+  start = gtk_tree_path_get_indices (start_path)[0];
+  n_visible = MAX (gtk_tree_path_get_indices (end_path)[0] - start + 1, 1);
+  delta = (standard_view->priv->visible_start >= 0) ? start - standard_view->priv->visible_start : 0;
+  standard_view->priv->visible_start = start;
+
+  /* on a reversal, the files prefetched the other way are no longer wanted */
+  if (delta != 0)
+    standard_view->priv->scroll_direction = (delta > 0) ? 1 : -1;
+
+  n_prefetch = n_visible * CLAMP (1 + ABS (delta) / n_visible, 1, THUNAR_STANDARD_VIEW_PREFETCH_SCREENS_MAX);
+  n_prefetch = MIN (n_prefetch, THUNAR_STANDARD_VIEW_PREFETCH_FILES_MAX);
+
+  /* collect the files following the visible range, the nearest first */
+  if (!gtk_tree_model_get_iter (GTK_TREE_MODEL (standard_view->model), &iter,
+                                (standard_view->priv->scroll_direction > 0) ? end_path : start_path))
+    return NULL;
+
+  for (n = 0; n < n_prefetch; n++)
+    {
+      if (standard_view->priv->scroll_direction > 0)
+        {
+          if (!gtk_tree_model_iter_next (GTK_TREE_MODEL (standard_view->model), &iter))
+            break;
+        }
+      else
+        {
+          if (!gtk_tree_model_iter_previous (GTK_TREE_MODEL (standard_view->model), &iter))
+            break;
+        }
+
+      file = thunar_standard_view_model_get_file (standard_view->model, &iter);
+      if (G_LIKELY (file != NULL))
+        files = g_list_prepend (files, file);
+    }
+
+  return g_list_reverse (files);
+}
+
+
+
+static gboolean
+thunar_standard_view_visible_files_timer (gpointer user_data)
+{
+  ThunarStandardView *standard_view = THUNAR_STANDARD_VIEW (user_data);
+  ThunarThumbnailSize thumbnail_size;
+  ThunarFolder       *folder;
+  GtkTreePath        *start_path;
+  GtkTreePath        *end_path;
+  GtkTreePath        *path;
+  GtkTreeIter         iter;
+  ThunarFile         *file;
+  gboolean            loading = FALSE;
+  GList              *prefetch_files;
+  GList              *files = NULL;
+  GList              *lp;
+  gint                icon_size;
+  gboolean            zooming;
+  guint               n;
+
+  standard_view->priv->visible_files_timer_id = 0;
+
+  folder = thunar_standard_view_model_get_folder (standard_view->model);
+  if (G_UNLIKELY (folder == NULL)
+      || !(*THUNAR_STANDARD_VIEW_GET_CLASS (standard_view)->get_visible_range) (standard_view, &start_path, &end_path))
+    {
+      /* nothing is shown, so no thumbnail or item count is urgent */
+      thunar_thumbnailer_set_visible_files (standard_view->priv->thumbnailer, standard_view, NULL);
+      thunar_count_scheduler_set_visible_files (standard_view, NULL);
+      return G_SOURCE_REMOVE;
+    }
+
+  /* collect the files from the start to the end of the visible range, the
+   * children of expanded folders in between are left to the folders */
+  if (gtk_tree_model_get_iter (GTK_TREE_MODEL (standard_view->model), &iter, start_path))
+    {
+      path = gtk_tree_path_copy (start_path);
+      for (n = 0; n < THUNAR_STANDARD_VIEW_VISIBLE_FILES_MAX && gtk_tree_path_compare (path, end_path) <= 0; n++)
+        {
+          file = thunar_standard_view_model_get_file (standard_view->model, &iter);
+          if (G_LIKELY (file != NULL))
+            files = g_list_prepend (files, file);
+
+          if (!gtk_tree_model_iter_next (GTK_TREE_MODEL (standard_view->model), &iter))
+            break;
+          gtk_tree_path_next (path);
+        }
+      gtk_tree_path_free (path);
+    }
+
+  thunar_count_scheduler_set_visible_files (standard_view, files);
+
+  /* the thumbnails of the prefetched files are requested once the visible
+   * ones are done, so they don't delay what is on screen */
+  g_object_get (G_OBJECT (standard_view->icon_renderer), "size", &icon_size, "zooming", &zooming, NULL);
+  thumbnail_size = thunar_icon_size_to_thumbnail_size (icon_size * gtk_widget_get_scale_factor (GTK_WIDGET (standard_view)));
+  for (lp = files; lp != NULL && !loading; lp = lp->next)
+    loading = (thunar_file_get_thumb_state (lp->data, thumbnail_size) == THUNAR_FILE_THUMB_STATE_LOADING);
+
+  /* no thumbnails of a zoom level the user may only pass through */
+  prefetch_files = thunar_standard_view_prefetch_files (standard_view, start_path, end_path);
+  if (!loading && !zooming)
+    {
+      for (lp = prefetch_files; lp != NULL; lp = lp->next)
+        if (thunar_icon_factory_get_show_thumbnail (standard_view->icon_factory, lp->data))
+          thunar_file_request_thumbnail (lp->data, thumbnail_size);
+    }
+
+  /* the content types of the visible files are loaded first, the prefetched ones
+   * count as visible for the thumbnailer, which drops the requests for the other
+   * files, e.g. the ones prefetched before the scroll direction reversed */
+  files = g_list_concat (files, prefetch_files);
+  thunar_folder_load_content_types (folder, files);
+  thunar_thumbnailer_set_visible_files (standard_view->priv->thumbnailer, standard_view, files);
+
+  thunar_g_list_free_full (files);
+  gtk_tree_path_free (start_path);
+  gtk_tree_path_free (end_path);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+static void
+thunar_standard_view_schedule_visible_files (ThunarStandardView *standard_view)
+{
+  _thunar_return_if_fail (THUNAR_IS_STANDARD_VIEW (standard_view));
+
+  if (standard_view->priv->visible_files_timer_id != 0 || standard_view->priv->thumbnailer == NULL)
+    return;
+
+  standard_view->priv->visible_files_timer_id =
+    g_timeout_add (THUNAR_STANDARD_VIEW_VISIBLE_FILES_DELAY_MS, thunar_standard_view_visible_files_timer, standard_view);
+}
+
+
+
+static void
+thunar_standard_view_files_added (ThunarStandardView *standard_view,
+                                  GList              *files)
+{
+  GList *lp;
+
+  _thunar_return_if_fail (THUNAR_IS_STANDARD_VIEW (standard_view));
+
+  /* the selection of a loading view waits for the end of the loading,
+   * unless the files to select show up sooner */
+  if (!standard_view->loading
+      || standard_view->priv->selected_files == NULL
+      || standard_view->priv->early_selection_idle_id != 0)
+    return;
+
+  for (lp = standard_view->priv->selected_files; lp != NULL; lp = lp->next)
+    if (g_list_find (files, lp->data) != NULL)
+      {
+        /* the model inserts the rows for the files after this handler */
+        standard_view->priv->early_selection_idle_id = g_idle_add (thunar_standard_view_early_selection_idle, standard_view);
+        break;
+      }
+}
+
+
+
+static gboolean
+thunar_standard_view_early_selection_idle (gpointer user_data)
+{
+  ThunarStandardView *standard_view = THUNAR_STANDARD_VIEW (user_data);
+  GList              *paths;
+
+  standard_view->priv->early_selection_idle_id = 0;
+
+  if (!standard_view->loading || standard_view->priv->selected_files == NULL)
+    return G_SOURCE_REMOVE;
+
+  /* "Show in folder" is about a few files of a folder which is usually
+   * not loaded yet, so they are selected once all of them have rows.
+   * The selection is applied again when the loading finished */
+  paths = thunar_standard_view_model_get_paths_for_files (standard_view->model, standard_view->priv->selected_files);
+  if (g_list_length (paths) == g_list_length (standard_view->priv->selected_files))
+    thunar_standard_view_select_paths (standard_view, paths);
+  g_list_free_full (paths, (GDestroyNotify) gtk_tree_path_free);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
 static gboolean
 thunar_standard_view_scroll_event (GtkWidget          *view,
                                    GdkEventScroll     *event,
@@ -2718,7 +3434,7 @@ thunar_standard_view_scroll_event (GtkWidget          *view,
   if (G_UNLIKELY (scrolling_direction == GDK_SCROLL_LEFT || scrolling_direction == GDK_SCROLL_RIGHT))
     {
       /* check if we should use the horizontal mouse wheel for navigation */
-      g_object_get (G_OBJECT (standard_view->preferences), "misc-horizontal-wheel-navigates", &misc_horizontal_wheel_navigates, NULL);
+      misc_horizontal_wheel_navigates = thunar_preferences_peek_values (standard_view->preferences)->misc_horizontal_wheel_navigates;
       if (G_UNLIKELY (misc_horizontal_wheel_navigates))
         {
           if (scrolling_direction == GDK_SCROLL_LEFT)
@@ -2855,6 +3571,22 @@ thunar_standard_view_drag_drop (GtkWidget          *view,
    */
   standard_view->priv->drop_occurred = TRUE;
 
+  /* drags from this process need no round trip through the selection */
+  if (target == gdk_atom_intern_static_string ("text/uri-list"))
+    {
+      if (!standard_view->priv->drop_data_ready)
+        {
+          standard_view->priv->drop_file_list = thunar_dnd_dup_source_files (context);
+          standard_view->priv->drop_data_ready = (standard_view->priv->drop_file_list != NULL);
+        }
+
+      if (standard_view->priv->drop_data_ready)
+        {
+          thunar_standard_view_drag_data_received (view, context, x, y, NULL, TARGET_TEXT_URI_LIST, timestamp, standard_view);
+          return TRUE;
+        }
+    }
+
   /* request the drag data from the source (initiates
    * saving in case of XdndDirectSave).
    */
@@ -3272,6 +4004,13 @@ thunar_standard_view_drag_motion (GtkWidget          *view,
   ThunarFile   *file = NULL;
   GdkAtom       target;
 
+  /* drags from this process hand over their files directly */
+  if (G_UNLIKELY (!standard_view->priv->drop_data_ready))
+    {
+      standard_view->priv->drop_file_list = thunar_dnd_dup_source_files (context);
+      standard_view->priv->drop_data_ready = (standard_view->priv->drop_file_list != NULL);
+    }
+
   /* request the drop data on-demand (if we don't have it already) */
   if (G_UNLIKELY (!standard_view->priv->drop_data_ready))
     {
@@ -3365,6 +4104,10 @@ thunar_standard_view_drag_begin (GtkWidget          *view,
 
   /* query the list of selected URIs */
   standard_view->priv->drag_g_file_list = thunar_file_list_to_thunar_g_file_list (standard_view->priv->selected_files);
+
+  /* the text/uri-list is only built if a target outside the process asks for it */
+  thunar_dnd_set_source_files (view, standard_view->priv->drag_g_file_list);
+
   if (G_LIKELY (standard_view->priv->drag_g_file_list != NULL))
     {
       /* determine the first selected file */
@@ -3433,6 +4176,7 @@ thunar_standard_view_drag_end (GtkWidget          *view,
     g_source_remove (standard_view->priv->drag_scroll_timer_id);
 
   /* release the list of dragged URIs */
+  thunar_dnd_set_source_files (NULL, NULL);
   thunar_g_list_free_full (standard_view->priv->drag_g_file_list);
   standard_view->priv->drag_g_file_list = NULL;
 }
@@ -3497,6 +4241,32 @@ thunar_standard_view_rows_reordered (ThunarStandardViewModel *model,
 
 
 
+static void
+thunar_standard_view_row_changed (ThunarStandardViewModel *model,
+                                  GtkTreePath             *path,
+                                  GtkTreeIter             *iter,
+                                  ThunarStandardView      *standard_view)
+{
+  ThunarFile *file;
+
+  _thunar_return_if_fail (THUNAR_IS_STANDARD_VIEW_MODEL (model));
+  _thunar_return_if_fail (THUNAR_IS_STANDARD_VIEW (standard_view));
+
+  /* nothing to keep up to date */
+  if (standard_view->priv->selected_files == NULL)
+    return;
+
+  /* a selected file may have changed its size or type */
+  file = thunar_standard_view_model_get_file (model, iter);
+  if (file != NULL)
+    {
+      thunar_standard_view_model_totals_changed (standard_view->priv->selection_totals, file);
+      g_object_unref (file);
+    }
+}
+
+
+
 static void
 thunar_standard_view_select_after_row_deleted (ThunarStandardViewModel *model,
                                                GtkTreePath             *path,
@@ -3870,6 +4640,20 @@ thunar_standard_view_queue_popup (ThunarStandardView *standard_view,
 
 
 
+static gboolean
+thunar_standard_view_same_files (GList *a,
+                                 GList *b)
+{
+  /* the selections come in the order of the rows */
+  for (; a != NULL && b != NULL; a = a->next, b = b->next)
+    if (a->data != b->data)
+      return FALSE;
+
+  return (a == NULL && b == NULL);
+}
+
+
+
 static gboolean
 _thunar_standard_view_selection_changed (ThunarStandardView *standard_view)
 {
@@ -3892,9 +4676,6 @@ _thunar_standard_view_selection_changed (ThunarStandardView *standard_view)
       standard_view->priv->new_files_closure = NULL;
     }
 
-  /* release the previously selected files */
-  thunar_g_list_free_full (standard_view->priv->selected_files);
-
   /* determine the new list of selected files (replacing GtkTreePath's with ThunarFile's) */
   selected_thunar_files = (*THUNAR_STANDARD_VIEW_GET_CLASS (standard_view)->get_selected_items) (standard_view);
   for (lp = selected_thunar_files; lp != NULL; lp = lp->next)
@@ -3915,7 +4696,23 @@ _thunar_standard_view_selection_changed (ThunarStandardView *standard_view)
         }
     }
 
-  /* and setup the new selected files list */
+  standard_view->priv->selection_changed_timeout_source = 0;
+
+  /* this also runs whenever the number of rows changed, which leaves the
+   * selection as it is most of the time. The consumers of "selected-files"
+   * walk and copy the whole list, so they are only told about real changes */
+  if (thunar_standard_view_same_files (selected_thunar_files, standard_view->priv->selected_files))
+    {
+      thunar_g_list_free_full (selected_thunar_files);
+      thunar_standard_view_update_statusbar_text (standard_view);
+      return FALSE;
+    }
+
+  /* only account for the files whose selection state changed */
+  thunar_standard_view_model_totals_set_files (standard_view->priv->selection_totals, selected_thunar_files);
+
+  /* release the previously selected files and setup the new selected files list */
+  thunar_g_list_free_full (standard_view->priv->selected_files);
   standard_view->priv->selected_files = selected_thunar_files;
 
   /* update the statusbar text */
@@ -3924,8 +4721,6 @@ _thunar_standard_view_selection_changed (ThunarStandardView *standard_view)
   /* emit notification for "selected-files" */
   g_object_notify_by_pspec (G_OBJECT (standard_view), standard_view_props[PROP_SELECTED_FILES]);
 
-  standard_view->priv->selection_changed_timeout_source = 0;
-
   return FALSE;
 }
 
@@ -4441,6 +5236,7 @@ thunar_standard_view_set_model (ThunarStandardView *standard_view)
       g_signal_handlers_disconnect_by_data (G_OBJECT (standard_view->model), standard_view);
       g_object_unref (G_OBJECT (standard_view->model));
       standard_view->model = NULL;
+      thunar_standard_view_model_totals_clear (standard_view->priv->selection_totals);
       if (G_LIKELY (standard_view->loading_binding != NULL))
         {
           /* this will free it as well */
@@ -4452,6 +5248,7 @@ thunar_standard_view_set_model (ThunarStandardView *standard_view)
   standard_view->model = g_object_new (standard_view->priv->model_type, NULL);
   standard_view->priv->row_deleted_id = g_signal_connect_after (G_OBJECT (standard_view->model), "row-deleted", G_CALLBACK (thunar_standard_view_select_after_row_deleted), standard_view);
   g_signal_connect (G_OBJECT (standard_view->model), "rows-reordered", G_CALLBACK (thunar_standard_view_rows_reordered), standard_view);
+  g_signal_connect (G_OBJECT (standard_view->model), "row-changed", G_CALLBACK (thunar_standard_view_row_changed), standard_view);
   g_signal_connect (G_OBJECT (standard_view->model), "error", G_CALLBACK (thunar_standard_view_error), standard_view);
   g_signal_connect (G_OBJECT (standard_view->model), "search-done", G_CALLBACK (thunar_standard_view_search_done), standard_view);
   g_object_bind_property (G_OBJECT (standard_view->preferences), "misc-case-sensitive", G_OBJECT (standard_view->model), "case-sensitive", G_BINDING_SYNC_CREATE);
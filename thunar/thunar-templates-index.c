@@ -0,0 +1,384 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* The templates index keeps the files of the templates folder for the
+ * "Create Document" menu, so building the menu needs no IO. The folder
+ * is scanned in a worker when the application starts and again whenever
+ * one of the monitors on the folder and its sub folders reports a
+ * change, or the "misc-max-number-of-templates" preference changes.
+ * Everything except the scan itself runs in the main thread. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "thunar/thunar-gio-extensions.h"
+#include "thunar/thunar-io-scan-directory.h"
+#include "thunar/thunar-preferences.h"
+#include "thunar/thunar-private.h"
+#include "thunar/thunar-templates-index.h"
+
+
+
+/* delay between a change in the templates folder and the new scan */
+#define THUNAR_TEMPLATES_INDEX_RELOAD_DELAY (500)
+
+
+
+typedef struct
+{
+  GList    *files;
+  gboolean  limit_exceeded;
+}
+ThunarTemplatesScan;
+
+static void thunar_templates_index_reload (void);
+
+
+
+static GFile             *templates_dir = NULL;
+static ThunarPreferences *templates_preferences = NULL;
+
+/* the sorted ThunarFiles of the last scan */
+static GList             *templates_files = NULL;
+static gboolean           templates_loaded = FALSE;
+static gboolean           templates_limit_exceeded = FALSE;
+
+static GCancellable      *templates_cancellable = NULL;
+static guint              templates_reload_id = 0;
+
+/* folder GFile -> GFileMonitor */
+static GHashTable        *templates_monitors = NULL;
+
+
+
+static void
+thunar_templates_index_scan_free (gpointer data)
+{
+  ThunarTemplatesScan *scan = data;
+
+  thunar_g_list_free_full (scan->files);
+  g_free (scan);
+}
+
+
+
+static ThunarTemplatesScan *
+thunar_templates_index_scan (guint file_scan_limit)
+{
+  ThunarTemplatesScan *scan;
+
+  scan = g_new0 (ThunarTemplatesScan, 1);
+  scan->files = thunar_io_scan_directory (NULL, templates_dir, G_FILE_QUERY_INFO_NONE, TRUE, FALSE, TRUE, &file_scan_limit, NULL);
+  scan->limit_exceeded = (file_scan_limit == 0);
+
+  return scan;
+}
+
+
+
+static void
+thunar_templates_index_scan_thread (GTask        *task,
+                                    gpointer      source_object,
+                                    gpointer      task_data,
+                                    GCancellable *cancellable)
+{
+  ThunarTemplatesScan *scan;
+
+  scan = thunar_templates_index_scan (GPOINTER_TO_UINT (task_data));
+
+  if (g_task_return_error_if_cancelled (task))
+    {
+      thunar_templates_index_scan_free (scan);
+      return;
+    }
+
+  g_task_return_pointer (task, scan, thunar_templates_index_scan_free);
+}
+
+
+
+static gboolean
+thunar_templates_index_reload_timeout (gpointer user_data)
+{
+  templates_reload_id = 0;
+
+  thunar_templates_index_reload ();
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+static void
+thunar_templates_index_schedule_reload (void)
+{
+  /* an unpacked archive of templates sends a lot of events at once */
+  if (templates_reload_id == 0)
+    templates_reload_id = g_timeout_add (THUNAR_TEMPLATES_INDEX_RELOAD_DELAY, thunar_templates_index_reload_timeout, NULL);
+}
+
+
+
+static void
+thunar_templates_index_limit_changed (void)
+{
+  /* a new limit may show more templates or less */
+  thunar_templates_index_schedule_reload ();
+}
+
+
+
+static void
+thunar_templates_index_monitor_changed (GFileMonitor      *monitor,
+                                        GFile             *file,
+                                        GFile             *other_file,
+                                        GFileMonitorEvent  event_type,
+                                        gpointer           user_data)
+{
+  switch (event_type)
+    {
+    case G_FILE_MONITOR_EVENT_CREATED:
+    case G_FILE_MONITOR_EVENT_DELETED:
+    case G_FILE_MONITOR_EVENT_MOVED:
+    case G_FILE_MONITOR_EVENT_MOVED_IN:
+    case G_FILE_MONITOR_EVENT_MOVED_OUT:
+    case G_FILE_MONITOR_EVENT_RENAMED:
+    case G_FILE_MONITOR_EVENT_ATTRIBUTE_CHANGED:
+      thunar_templates_index_schedule_reload ();
+      break;
+
+    default:
+      break;
+    }
+}
+
+
+
+static void
+thunar_templates_index_monitor (GFile *folder)
+{
+  GFileMonitor *monitor;
+
+  if (g_hash_table_contains (templates_monitors, folder))
+    return;
+
+  /* GIO monitors are not recursive, so every sub folder gets its own */
+  monitor = g_file_monitor_directory (folder, G_FILE_MONITOR_WATCH_MOVES, NULL, NULL);
+  if (G_UNLIKELY (monitor == NULL))
+    return;
+
+  g_signal_connect (monitor, "changed", G_CALLBACK (thunar_templates_index_monitor_changed), NULL);
+  g_hash_table_insert (templates_monitors, g_object_ref (folder), monitor);
+}
+
+
+
+static void
+thunar_templates_index_monitor_free (gpointer data)
+{
+  GFileMonitor *monitor = data;
+
+  g_signal_handlers_disconnect_by_func (monitor, thunar_templates_index_monitor_changed, NULL);
+  g_file_monitor_cancel (monitor);
+  g_object_unref (monitor);
+}
+
+
+
+static void
+thunar_templates_index_take_scan (ThunarTemplatesScan *scan)
+{
+  GList *lp;
+
+  thunar_g_list_free_full (templates_files);
+
+  /* sort items so that directories come before files and ancestors come
+   * before descendants, the menu is built in this order */
+  templates_files = thunar_file_list_sort_by_type (g_steal_pointer (&scan->files));
+  templates_limit_exceeded = scan->limit_exceeded;
+  templates_loaded = TRUE;
+
+  /* follow the folders of this scan only */
+  g_hash_table_remove_all (templates_monitors);
+  thunar_templates_index_monitor (templates_dir);
+  for (lp = templates_files; lp != NULL; lp = lp->next)
+    if (thunar_file_is_directory (lp->data))
+      thunar_templates_index_monitor (thunar_file_get_file (lp->data));
+}
+
+
+
+static void
+thunar_templates_index_scan_finished (GObject      *object,
+                                      GAsyncResult *result,
+                                      gpointer      user_data)
+{
+  ThunarTemplatesScan *scan;
+
+  /* superseded by a newer scan */
+  scan = g_task_propagate_pointer (G_TASK (result), NULL);
+  if (scan == NULL)
+    return;
+
+  thunar_templates_index_take_scan (scan);
+  thunar_templates_index_scan_free (scan);
+}
+
+
+
+static void
+thunar_templates_index_cancel (void)
+{
+  if (templates_cancellable != NULL)
+    {
+      g_cancellable_cancel (templates_cancellable);
+      g_clear_object (&templates_cancellable);
+    }
+}
+
+
+
+static void
+thunar_templates_index_reload (void)
+{
+  GTask *task;
+  guint  file_scan_limit;
+
+  thunar_templates_index_cancel ();
+  templates_cancellable = g_cancellable_new ();
+
+  g_object_get (G_OBJECT (templates_preferences), "misc-max-number-of-templates", &file_scan_limit, NULL);
+
+  task = g_task_new (NULL, templates_cancellable, thunar_templates_index_scan_finished, NULL);
+  g_task_set_task_data (task, GUINT_TO_POINTER (file_scan_limit), NULL);
+  g_task_run_in_thread (task, thunar_templates_index_scan_thread);
+  g_object_unref (task);
+}
+
+
+
+static void
+thunar_templates_index_init (void)
+{
+  const gchar *path;
+  GFile       *home_dir;
+
+  if (G_LIKELY (templates_dir != NULL))
+    return;
+
+  home_dir = thunar_g_file_new_for_home ();
+  path     = g_get_user_special_dir (G_USER_DIRECTORY_TEMPLATES);
+
+  if (G_LIKELY (path != NULL))
+    templates_dir = g_file_new_for_path (path);
+
+  /* If G_USER_DIRECTORY_TEMPLATES not found, set "~/Templates" directory as default */
+  if (G_UNLIKELY (path == NULL) || G_UNLIKELY (g_file_equal (templates_dir, home_dir)))
+    {
+      if (templates_dir != NULL)
+        g_object_unref (templates_dir);
+      templates_dir = g_file_resolve_relative_path (home_dir, "Templates");
+    }
+
+  g_object_unref (home_dir);
+
+  templates_monitors = g_hash_table_new_full (g_file_hash, (GEqualFunc) g_file_equal,
+                                              g_object_unref, thunar_templates_index_monitor_free);
+
+  templates_preferences = thunar_preferences_get ();
+  g_signal_connect_swapped (G_OBJECT (templates_preferences), "notify::misc-max-number-of-templates",
+                            G_CALLBACK (thunar_templates_index_limit_changed), NULL);
+}
+
+
+
+/**
+ * thunar_templates_index_load:
+ *
+ * Starts scanning the templates folder in the background, to be
+ * called when the application starts. Later changes are picked up
+ * by the index itself.
+ **/
+void
+thunar_templates_index_load (void)
+{
+  thunar_templates_index_init ();
+
+  if (!templates_loaded && templates_cancellable == NULL)
+    thunar_templates_index_reload ();
+}
+
+
+
+/**
+ * thunar_templates_index_get_directory:
+ *
+ * Returns the templates folder of the user, which is not required
+ * to exist.
+ *
+ * Return value: (transfer none): the #GFile of the templates folder.
+ **/
+GFile *
+thunar_templates_index_get_directory (void)
+{
+  thunar_templates_index_init ();
+
+  return templates_dir;
+}
+
+
+
+/**
+ * thunar_templates_index_get_files:
+ * @limit_exceeded : return location for whether the templates folder
+ *                   contains more than "misc-max-number-of-templates"
+ *                   files, or %NULL.
+ *
+ * Returns the files in the templates folder and its sub folders, the
+ * directories before the files and the ancestors before their
+ * descendants. If the background scan did not finish yet, the folder
+ * is scanned right away.
+ *
+ * The caller is responsible to free the returned list using
+ * thunar_g_list_free_full() when no longer needed.
+ *
+ * Return value: (transfer full): the #ThunarFile<!---->s of the templates.
+ **/
+GList *
+thunar_templates_index_get_files (gboolean *limit_exceeded)
+{
+  ThunarTemplatesScan *scan;
+  guint                file_scan_limit;
+
+  thunar_templates_index_init ();
+
+  /* the menu is wanted before the first scan is done */
+  if (G_UNLIKELY (!templates_loaded))
+    {
+      thunar_templates_index_cancel ();
+
+      g_object_get (G_OBJECT (templates_preferences), "misc-max-number-of-templates", &file_scan_limit, NULL);
+      scan = thunar_templates_index_scan (file_scan_limit);
+      thunar_templates_index_take_scan (scan);
+      thunar_templates_index_scan_free (scan);
+    }
+
+  if (limit_exceeded != NULL)
+    *limit_exceeded = templates_limit_exceeded;
+
+  return thunar_g_list_copy_deep (templates_files);
+}
@@ -21,11 +21,25 @@
 #include "config.h"
 #endif
 
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include "thunar/thunar-private.h"
 #include "thunar/thunar-text-renderer.h"
 #include "thunar/thunar-util.h"
 
 
 
+/* maximum number of laid out labels kept per renderer */
+#define THUNAR_TEXT_RENDERER_MAX_LAYOUTS (4096)
+
+/* maximum number of label sizes kept per wrap width, and of wrap widths */
+#define THUNAR_TEXT_RENDERER_MAX_SIZES       (65536)
+#define THUNAR_TEXT_RENDERER_MAX_WRAP_WIDTHS (4)
+
+
+
 enum
 {
   PROP_0,
@@ -37,6 +51,8 @@ enum
 
 
 static void thunar_text_renderer_finalize       (GObject               *object);
+static void thunar_text_renderer_notify         (GObject               *object,
+                                                 GParamSpec            *pspec);
 static void thunar_text_renderer_get_property   (GObject               *object,
                                                  guint                  prop_id,
                                                  GValue                *value,
@@ -51,19 +67,25 @@ static void thunar_text_renderer_render         (GtkCellRenderer       *renderer
                                                  const GdkRectangle    *background_area,
                                                  const GdkRectangle    *cell_area,
                                                  GtkCellRendererState   flags);
+static void thunar_text_renderer_get_preferred_width            (GtkCellRenderer *cell,
+                                                                 GtkWidget       *widget,
+                                                                 gint            *minimum,
+                                                                 gint            *natural);
+static void thunar_text_renderer_get_preferred_height           (GtkCellRenderer *cell,
+                                                                 GtkWidget       *widget,
+                                                                 gint            *minimum,
+                                                                 gint            *natural);
+static void thunar_text_renderer_get_preferred_height_for_width (GtkCellRenderer *cell,
+                                                                 GtkWidget       *widget,
+                                                                 gint             width,
+                                                                 gint            *minimum,
+                                                                 gint            *natural);
 
 
 
 struct _ThunarTextRendererClass
 {
   GtkCellRendererTextClass __parent__;
-
-  void (*default_render_function) (GtkCellRenderer      *cell,
-                                   cairo_t              *cr,
-                                   GtkWidget            *widget,
-                                   const GdkRectangle   *background_area,
-                                   const GdkRectangle   *cell_area,
-                                   GtkCellRendererState  flags);
 };
 
 struct _ThunarTextRenderer
@@ -73,6 +95,62 @@ struct _ThunarTextRenderer
   gchar               *highlight_color;
   gboolean             rounded_corners;
   gboolean             highlighting_enabled;
+
+  /* laid out labels and their sizes, shared by all cells. They are
+   * dropped once a property changes the layout, or the font or style
+   * of the widget changes the pango context */
+  GHashTable          *layouts;
+
+  /* the sizes are much smaller than the layouts, so more of them are
+   * kept, one table per wrap width: a large folder is not measured
+   * again when the window is resized, or the zoom level changed back */
+  GHashTable          *sizes;
+  GHashTable          *wrap_width_sizes;
+  PangoContext        *context;
+  guint                context_serial;
+
+  /* the layout properties, read again once they changed */
+  gboolean             settings_valid;
+  PangoAttrList       *attributes;
+  PangoEllipsizeMode   ellipsize;
+  PangoWrapMode        wrap_mode;
+  PangoAlignment       alignment;
+  gint                 wrap_width;
+  gboolean             single_paragraph;
+};
+
+typedef struct
+{
+  PangoLayout         *layout;
+  PangoRectangle       natural_rect;    /* unwrapped logical extents, in pixels */
+  gint                 text_width;      /* unwrapped logical width, in pango units */
+}
+ThunarTextLayout;
+
+typedef struct
+{
+  /* cached size requests, -1 if not known yet */
+  gint                 width_minimum;
+  gint                 width_natural;
+  gint                 height_minimum;
+  gint                 height_natural;
+  gint                 for_width;
+  gint                 for_width_minimum;
+  gint                 for_width_natural;
+}
+ThunarTextSize;
+
+
+
+/* properties which do not change how a label is laid out */
+static const gchar *thunar_text_renderer_paint_properties[] =
+{
+  "text", "foreground", "foreground-rgba", "foreground-gdk", "foreground-set",
+  "background", "background-rgba", "background-gdk", "background-set",
+  "cell-background", "cell-background-rgba", "cell-background-gdk", "cell-background-set",
+  "highlight-color", "highlighting-enabled", "rounded-corners",
+  "mode", "sensitive", "visible", "editable", "editable-set", "is-expanded", "is-expander",
+  "yalign",
 };
 
 
@@ -88,12 +166,15 @@ thunar_text_renderer_class_init (ThunarTextRendererClass *klass)
   GtkCellRendererClass *cell_class = GTK_CELL_RENDERER_CLASS (klass);
 
   object_class->finalize = thunar_text_renderer_finalize;
+  object_class->notify = thunar_text_renderer_notify;
 
   object_class->get_property = thunar_text_renderer_get_property;
   object_class->set_property = thunar_text_renderer_set_property;
 
-  klass->default_render_function = cell_class->render;
   cell_class->render = thunar_text_renderer_render;
+  cell_class->get_preferred_width = thunar_text_renderer_get_preferred_width;
+  cell_class->get_preferred_height = thunar_text_renderer_get_preferred_height;
+  cell_class->get_preferred_height_for_width = thunar_text_renderer_get_preferred_height_for_width;
 
   /**
    * ThunarTextRenderer:highlight-color:
@@ -136,10 +217,31 @@ thunar_text_renderer_class_init (ThunarTextRendererClass *klass)
 
 
 
+static void
+thunar_text_layout_free (gpointer data)
+{
+  ThunarTextLayout *text_layout = data;
+
+  g_object_unref (text_layout->layout);
+  g_slice_free (ThunarTextLayout, text_layout);
+}
+
+
+
+static void
+thunar_text_size_free (gpointer data)
+{
+  g_slice_free (ThunarTextSize, data);
+}
+
+
+
 static void
 thunar_text_renderer_init (ThunarTextRenderer *text_renderer)
 {
   text_renderer->highlight_color = NULL;
+  text_renderer->layouts = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, thunar_text_layout_free);
+  text_renderer->wrap_width_sizes = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) g_hash_table_unref);
 }
 
 
@@ -151,11 +253,45 @@ thunar_text_renderer_finalize (GObject *object)
 
   g_free (text_renderer->highlight_color);
 
+  g_hash_table_destroy (text_renderer->layouts);
+  g_hash_table_destroy (text_renderer->wrap_width_sizes);
+  if (text_renderer->context != NULL)
+    g_object_unref (text_renderer->context);
+  if (text_renderer->attributes != NULL)
+    pango_attr_list_unref (text_renderer->attributes);
+
   G_OBJECT_CLASS (thunar_text_renderer_parent_class)->finalize (object);
 }
 
 
 
+static void
+thunar_text_renderer_notify (GObject    *object,
+                             GParamSpec *pspec)
+{
+  ThunarTextRenderer *text_renderer = THUNAR_TEXT_RENDERER (object);
+  guint               n;
+
+  if (G_OBJECT_CLASS (thunar_text_renderer_parent_class)->notify != NULL)
+    (*G_OBJECT_CLASS (thunar_text_renderer_parent_class)->notify) (object, pspec);
+
+  /* the text and colors are set for every cell, they don't invalidate anything */
+  for (n = 0; n < G_N_ELEMENTS (thunar_text_renderer_paint_properties); ++n)
+    if (strcmp (pspec->name, thunar_text_renderer_paint_properties[n]) == 0)
+      return;
+
+  /* everything else might change the layouts */
+  text_renderer->settings_valid = FALSE;
+  text_renderer->sizes = NULL;
+  g_hash_table_remove_all (text_renderer->layouts);
+
+  /* the sizes of the other wrap widths stay valid on zoom changes */
+  if (strcmp (pspec->name, "wrap-width") != 0)
+    g_hash_table_remove_all (text_renderer->wrap_width_sizes);
+}
+
+
+
 static void
 thunar_text_renderer_get_property (GObject    *object,
                                    guint       prop_id,
@@ -235,6 +371,248 @@ thunar_text_renderer_new (void)
 
 
 
+static void
+thunar_text_renderer_validate (ThunarTextRenderer *text_renderer,
+                               GtkWidget          *widget)
+{
+  PangoAlignment align;
+  PangoContext  *context;
+  gboolean       align_set;
+  gboolean       ellipsize_set;
+  gfloat         xalign;
+
+  /* drop all layouts and sizes if the font or style of the widget changed */
+  context = gtk_widget_get_pango_context (widget);
+  if (context != text_renderer->context || pango_context_get_serial (context) != text_renderer->context_serial)
+    {
+      g_hash_table_remove_all (text_renderer->layouts);
+      g_hash_table_remove_all (text_renderer->wrap_width_sizes);
+      text_renderer->sizes = NULL;
+      if (text_renderer->context != NULL)
+        g_object_unref (text_renderer->context);
+      text_renderer->context = g_object_ref (context);
+      text_renderer->context_serial = pango_context_get_serial (context);
+
+      /* the alignment might depend on the text direction */
+      text_renderer->settings_valid = FALSE;
+    }
+
+  /* read the layout properties again, if they changed */
+  if (G_UNLIKELY (!text_renderer->settings_valid))
+    {
+      if (text_renderer->attributes != NULL)
+        pango_attr_list_unref (text_renderer->attributes);
+
+      g_object_get (text_renderer,
+                    "attributes", &text_renderer->attributes,
+                    "ellipsize", &text_renderer->ellipsize,
+                    "ellipsize-set", &ellipsize_set,
+                    "wrap-mode", &text_renderer->wrap_mode,
+                    "wrap-width", &text_renderer->wrap_width,
+                    "alignment", &align,
+                    "align-set", &align_set,
+                    "single-paragraph-mode", &text_renderer->single_paragraph,
+                    NULL);
+
+      if (!ellipsize_set)
+        text_renderer->ellipsize = PANGO_ELLIPSIZE_NONE;
+
+      /* like GtkCellRendererText, follow the x alignment unless an alignment was set */
+      if (!align_set)
+        {
+          gtk_cell_renderer_get_alignment (GTK_CELL_RENDERER (text_renderer), &xalign, NULL);
+          if (gtk_widget_get_direction (widget) == GTK_TEXT_DIR_RTL)
+            align = (xalign < 0.5) ? PANGO_ALIGN_RIGHT : PANGO_ALIGN_LEFT;
+          else
+            align = (xalign > 0.5) ? PANGO_ALIGN_RIGHT : PANGO_ALIGN_LEFT;
+        }
+      text_renderer->alignment = align;
+
+      text_renderer->settings_valid = TRUE;
+    }
+
+  /* pick the sizes for the current wrap width */
+  if (G_UNLIKELY (text_renderer->sizes == NULL))
+    {
+      text_renderer->sizes = g_hash_table_lookup (text_renderer->wrap_width_sizes, GINT_TO_POINTER (text_renderer->wrap_width));
+      if (text_renderer->sizes == NULL)
+        {
+          if (g_hash_table_size (text_renderer->wrap_width_sizes) >= THUNAR_TEXT_RENDERER_MAX_WRAP_WIDTHS)
+            g_hash_table_remove_all (text_renderer->wrap_width_sizes);
+
+          text_renderer->sizes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, thunar_text_size_free);
+          g_hash_table_insert (text_renderer->wrap_width_sizes, GINT_TO_POINTER (text_renderer->wrap_width), text_renderer->sizes);
+        }
+    }
+}
+
+
+
+static ThunarTextSize*
+thunar_text_renderer_get_size (ThunarTextRenderer *text_renderer,
+                               GtkWidget          *widget,
+                               const gchar        *text)
+{
+  ThunarTextSize *text_size;
+
+  thunar_text_renderer_validate (text_renderer, widget);
+
+  /* check if we already measured this text */
+  text_size = g_hash_table_lookup (text_renderer->sizes, text);
+  if (G_LIKELY (text_size != NULL))
+    return text_size;
+
+  /* keep the number of sizes bounded */
+  if (g_hash_table_size (text_renderer->sizes) >= THUNAR_TEXT_RENDERER_MAX_SIZES)
+    g_hash_table_remove_all (text_renderer->sizes);
+
+  text_size = g_slice_new (ThunarTextSize);
+  text_size->width_minimum = -1;
+  text_size->height_minimum = -1;
+  text_size->for_width = -1;
+
+  g_hash_table_insert (text_renderer->sizes, g_strdup (text), text_size);
+
+  return text_size;
+}
+
+
+
+static ThunarTextLayout*
+thunar_text_renderer_get_layout (ThunarTextRenderer *text_renderer,
+                                 GtkWidget          *widget,
+                                 const gchar        *text)
+{
+  ThunarTextLayout *text_layout;
+  PangoAttrList    *attributes;
+  PangoRectangle    rect;
+
+  thunar_text_renderer_validate (text_renderer, widget);
+
+  /* check if we already laid out this text */
+  text_layout = g_hash_table_lookup (text_renderer->layouts, text);
+  if (G_LIKELY (text_layout != NULL))
+    return text_layout;
+
+  /* keep the number of layouts bounded */
+  if (g_hash_table_size (text_renderer->layouts) >= THUNAR_TEXT_RENDERER_MAX_LAYOUTS)
+    g_hash_table_remove_all (text_renderer->layouts);
+
+  text_layout = g_slice_new (ThunarTextLayout);
+  text_layout->layout = gtk_widget_create_pango_layout (widget, text);
+
+  attributes = (text_renderer->attributes != NULL) ? pango_attr_list_copy (text_renderer->attributes) : pango_attr_list_new ();
+  pango_layout_set_attributes (text_layout->layout, attributes);
+  pango_attr_list_unref (attributes);
+
+  pango_layout_set_single_paragraph_mode (text_layout->layout, text_renderer->single_paragraph);
+  pango_layout_set_ellipsize (text_layout->layout, text_renderer->ellipsize);
+  pango_layout_set_alignment (text_layout->layout, text_renderer->alignment);
+  pango_layout_set_width (text_layout->layout, -1);
+  pango_layout_set_wrap (text_layout->layout, (text_renderer->wrap_width != -1) ? text_renderer->wrap_mode : PANGO_WRAP_CHAR);
+
+  /* remember the size of the unwrapped text */
+  pango_layout_get_extents (text_layout->layout, NULL, &rect);
+  text_layout->text_width = rect.width;
+  pango_layout_get_pixel_extents (text_layout->layout, NULL, &text_layout->natural_rect);
+
+  g_hash_table_insert (text_renderer->layouts, g_strdup (text), text_layout);
+
+  return text_layout;
+}
+
+
+
+static void
+thunar_text_renderer_get_preferred_width (GtkCellRenderer *cell,
+                                          GtkWidget       *widget,
+                                          gint            *minimum,
+                                          gint            *natural)
+{
+  ThunarTextRenderer *text_renderer = THUNAR_TEXT_RENDERER (cell);
+  ThunarTextSize     *text_size;
+  gchar              *text;
+
+  g_object_get (cell, "text", &text, NULL);
+  text_size = thunar_text_renderer_get_size (text_renderer, widget, (text != NULL) ? text : "");
+  g_free (text);
+
+  /* measure it like GtkCellRendererText, but only once per wrap width */
+  if (text_size->width_minimum < 0)
+    {
+      (*GTK_CELL_RENDERER_CLASS (thunar_text_renderer_parent_class)->get_preferred_width) (cell, widget,
+                                                                                          &text_size->width_minimum,
+                                                                                          &text_size->width_natural);
+    }
+
+  if (minimum != NULL)
+    *minimum = text_size->width_minimum;
+  if (natural != NULL)
+    *natural = text_size->width_natural;
+}
+
+
+
+static void
+thunar_text_renderer_get_preferred_height (GtkCellRenderer *cell,
+                                           GtkWidget       *widget,
+                                           gint            *minimum,
+                                           gint            *natural)
+{
+  ThunarTextRenderer *text_renderer = THUNAR_TEXT_RENDERER (cell);
+  ThunarTextSize     *text_size;
+  gchar              *text;
+
+  g_object_get (cell, "text", &text, NULL);
+  text_size = thunar_text_renderer_get_size (text_renderer, widget, (text != NULL) ? text : "");
+  g_free (text);
+
+  if (text_size->height_minimum < 0)
+    {
+      (*GTK_CELL_RENDERER_CLASS (thunar_text_renderer_parent_class)->get_preferred_height) (cell, widget,
+                                                                                           &text_size->height_minimum,
+                                                                                           &text_size->height_natural);
+    }
+
+  if (minimum != NULL)
+    *minimum = text_size->height_minimum;
+  if (natural != NULL)
+    *natural = text_size->height_natural;
+}
+
+
+
+static void
+thunar_text_renderer_get_preferred_height_for_width (GtkCellRenderer *cell,
+                                                     GtkWidget       *widget,
+                                                     gint             width,
+                                                     gint            *minimum,
+                                                     gint            *natural)
+{
+  ThunarTextRenderer *text_renderer = THUNAR_TEXT_RENDERER (cell);
+  ThunarTextSize     *text_size;
+  gchar              *text;
+
+  g_object_get (cell, "text", &text, NULL);
+  text_size = thunar_text_renderer_get_size (text_renderer, widget, (text != NULL) ? text : "");
+  g_free (text);
+
+  if (text_size->for_width != width)
+    {
+      (*GTK_CELL_RENDERER_CLASS (thunar_text_renderer_parent_class)->get_preferred_height_for_width) (cell, widget, width,
+                                                                                                     &text_size->for_width_minimum,
+                                                                                                     &text_size->for_width_natural);
+      text_size->for_width = width;
+    }
+
+  if (minimum != NULL)
+    *minimum = text_size->for_width_minimum;
+  if (natural != NULL)
+    *natural = text_size->for_width_natural;
+}
+
+
+
 static void
 thunar_text_renderer_render (GtkCellRenderer      *cell,
                              cairo_t              *cr,
@@ -243,11 +621,96 @@ thunar_text_renderer_render (GtkCellRenderer      *cell,
                              const GdkRectangle   *cell_area,
                              GtkCellRendererState  flags)
 {
-  if (THUNAR_TEXT_RENDERER (cell)->highlighting_enabled)
+  ThunarTextRenderer *text_renderer = THUNAR_TEXT_RENDERER (cell);
+  ThunarTextLayout   *text_layout;
+  PangoRectangle      rect;
+  gboolean            foreground_set;
+  gboolean            background_set;
+  GdkRGBA            *foreground;
+  GdkRGBA            *background;
+  gchar              *text;
+  gfloat              xalign;
+  gfloat              yalign;
+  gint                x_offset;
+  gint                y_offset;
+  gint                xpad;
+  gint                ypad;
+
+  if (text_renderer->highlighting_enabled)
     thunar_util_clip_view_background (cell, cr, background_area, widget, flags);
 
-  /* we only needed to manipulate the background_area, otherwise everything remains the same.
-     Hence, we are simply running the original render function now */
-  THUNAR_TEXT_RENDERER_GET_CLASS (THUNAR_TEXT_RENDERER (cell))
-    ->default_render_function (cell, cr, widget, background_area, cell_area, flags);
+  g_object_get (cell,
+                "text", &text,
+                "foreground-set", &foreground_set,
+                "foreground-rgba", &foreground,
+                "background-set", &background_set,
+                "background-rgba", &background,
+                NULL);
+
+  /* reuse the layout of the label, its size only changes if the cell got narrower than the text */
+  text_layout = thunar_text_renderer_get_layout (text_renderer, widget, (text != NULL) ? text : "");
+  g_free (text);
+
+  gtk_cell_renderer_get_padding (cell, &xpad, &ypad);
+  gtk_cell_renderer_get_alignment (cell, &xalign, &yalign);
+
+  /* the rest follows what GtkCellRendererText does */
+  if (text_renderer->wrap_width != -1)
+    {
+      pango_layout_set_width (text_layout->layout, MIN ((cell_area->width - xpad * 2) * PANGO_SCALE, text_layout->text_width));
+      pango_layout_get_pixel_extents (text_layout->layout, NULL, &rect);
+    }
+  else
+    {
+      rect = text_layout->natural_rect;
+    }
+
+  rect.height = MIN (rect.height, cell_area->height - 2 * ypad);
+  rect.width  = MIN (rect.width, cell_area->width - 2 * xpad);
+
+  if (gtk_widget_get_direction (widget) == GTK_TEXT_DIR_RTL)
+    x_offset = (1.0 - xalign) * (cell_area->width - (rect.width + (2 * xpad)));
+  else
+    x_offset = xalign * (cell_area->width - (rect.width + (2 * xpad)));
+  if (text_renderer->ellipsize != PANGO_ELLIPSIZE_NONE || text_renderer->wrap_width != -1)
+    x_offset = MAX (x_offset, 0);
+
+  y_offset = yalign * (cell_area->height - (rect.height + (2 * ypad)));
+  y_offset = MAX (y_offset, 0);
+
+  if (background_set && (flags & GTK_CELL_RENDERER_SELECTED) == 0)
+    {
+      gdk_cairo_rectangle (cr, background_area);
+      gdk_cairo_set_source_rgba (cr, background);
+      cairo_fill (cr);
+    }
+
+  if (text_renderer->ellipsize != PANGO_ELLIPSIZE_NONE)
+    pango_layout_set_width (text_layout->layout, (cell_area->width - x_offset - 2 * xpad) * PANGO_SCALE);
+
+  cairo_save (cr);
+
+  gdk_cairo_rectangle (cr, cell_area);
+  cairo_clip (cr);
+
+  /* the foreground color is not part of the layout, so it can be shared */
+  if (foreground_set && (flags & GTK_CELL_RENDERER_SELECTED) == 0)
+    {
+      gdk_cairo_set_source_rgba (cr, foreground);
+      cairo_move_to (cr, cell_area->x + x_offset + xpad, cell_area->y + y_offset + ypad);
+      pango_cairo_show_layout (cr, text_layout->layout);
+    }
+  else
+    {
+      gtk_render_layout (gtk_widget_get_style_context (widget), cr,
+                         cell_area->x + x_offset + xpad, cell_area->y + y_offset + ypad,
+                         text_layout->layout);
+    }
+
+  cairo_restore (cr);
+
+  if (foreground != NULL)
+    gdk_rgba_free (foreground);
+  if (background != NULL)
+    gdk_rgba_free (background);
 }
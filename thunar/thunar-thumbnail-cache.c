@@ -30,11 +30,19 @@
 
 #include "thunar/thunar-private.h"
 #include "thunar/thunar-thumbnail-cache.h"
+#include "thunar/thunar-thumbnail-pack.h"
 #include "thunar/thunar-file.h"
 
 #define _thumbnail_cache_lock(cache)   g_mutex_lock (&((cache)->lock))
 #define _thumbnail_cache_unlock(cache) g_mutex_unlock (&((cache)->lock))
 
+/* delay before queued operations are sent, to collect a batch */
+#define THUNAR_THUMBNAIL_CACHE_QUEUE_DELAY (250)
+
+/* maximum number of files per D-Bus call and of calls running at once */
+#define THUNAR_THUMBNAIL_CACHE_CHUNK_SIZE  (512)
+#define THUNAR_THUMBNAIL_CACHE_MAX_CALLS   (2)
+
 
 
 static void thunar_thumbnail_cache_finalize (GObject *object);
@@ -48,6 +56,30 @@ enum
   THUNAR_THUMBNAIL_CACHE_PROXY_FAILED
 };
 
+typedef enum
+{
+  THUNAR_THUMBNAIL_CACHE_OP_MOVE,
+  THUNAR_THUMBNAIL_CACHE_OP_COPY,
+  THUNAR_THUMBNAIL_CACHE_OP_DELETE,
+  THUNAR_THUMBNAIL_CACHE_OP_CLEANUP,
+} ThunarThumbnailCacheOpType;
+
+typedef struct
+{
+  ThunarThumbnailCacheOpType  type;
+  GFile                      *source;  /* %NULL for deletes and cleanups */
+  GFile                      *file;    /* the target, or the file to delete or clean up */
+}
+ThunarThumbnailCacheOp;
+
+typedef struct
+{
+  ThunarThumbnailCache       *cache;
+  ThunarThumbnailCacheOpType  type;
+  GList                      *targets;  /* files which might have a thumbnail now */
+}
+ThunarThumbnailCacheCall;
+
 struct _ThunarThumbnailCacheClass
 {
   GObjectClass __parent__;
@@ -60,19 +92,13 @@ struct _ThunarThumbnailCache
   ThunarThumbnailCacheDBus *cache_proxy;
   int                       proxy_state;
 
-  GList      *move_source_queue;
-  GList      *move_target_queue;
-  guint       move_queue_idle_id;
+  /* operations not sent yet, in order, and the last one for each file */
+  GQueue      queue;
+  GHashTable *queued_files;
+  guint       queue_idle_id;
 
-  GList      *copy_source_queue;
-  GList      *copy_target_queue;
-  guint       copy_queue_idle_id;
-
-  GList      *delete_queue;
-  guint       delete_queue_idle_id;
-
-  GList      *cleanup_queue;
-  guint       cleanup_queue_idle_id;
+  /* number of D-Bus calls waiting for a reply */
+  guint       n_calls;
 
   GMutex      lock;
 };
@@ -97,6 +123,19 @@ thunar_thumbnail_cache_class_init (ThunarThumbnailCacheClass *klass)
 
 
 
+static void
+thunar_thumbnail_cache_op_free (gpointer data)
+{
+  ThunarThumbnailCacheOp *op = data;
+
+  if (op->source != NULL)
+    g_object_unref (op->source);
+  g_object_unref (op->file);
+  g_slice_free (ThunarThumbnailCacheOp, op);
+}
+
+
+
 static void
 thunar_thumbnail_cache_finalize (GObject *object)
 {
@@ -105,27 +144,11 @@ thunar_thumbnail_cache_finalize (GObject *object)
   /* acquire a cache lock */
   _thumbnail_cache_lock (cache);
 
-  /* drop the move queue idle and all queued files */
-  if (cache->move_queue_idle_id > 0)
-    g_source_remove (cache->move_queue_idle_id);
-  g_list_free_full (cache->move_source_queue, g_object_unref);
-  g_list_free_full (cache->move_target_queue, g_object_unref);
-
-  /* drop the copy queue idle and all queued files */
-  if (cache->copy_queue_idle_id > 0)
-    g_source_remove (cache->copy_queue_idle_id);
-  g_list_free_full (cache->copy_source_queue, g_object_unref);
-  g_list_free_full (cache->copy_target_queue, g_object_unref);
-
-  /* drop the delete queue idle and all queued files */
-  if (cache->delete_queue_idle_id > 0)
-    g_source_remove (cache->delete_queue_idle_id);
-  g_list_free_full (cache->delete_queue, g_object_unref);
-
-  /* drop the cleanup queue idle and all queued files */
-  if (cache->cleanup_queue_idle_id > 0)
-    g_source_remove (cache->cleanup_queue_idle_id);
-  g_list_free_full (cache->cleanup_queue, g_object_unref);
+  /* drop the queue idle and all queued operations */
+  if (cache->queue_idle_id > 0)
+    g_source_remove (cache->queue_idle_id);
+  g_hash_table_destroy (cache->queued_files);
+  g_queue_clear_full (&cache->queue, thunar_thumbnail_cache_op_free);
 
   /* check if we have a valid cache proxy */
   if (cache->cache_proxy != NULL)
@@ -142,24 +165,52 @@ thunar_thumbnail_cache_finalize (GObject *object)
 
 
 
+static void thunar_thumbnail_cache_process_queue (ThunarThumbnailCache *cache);
+
+
+
 static void
-thunar_thumbnail_cache_copy_async_reply (ThunarThumbnailCacheDBus *proxy,
-                                         GAsyncResult             *res,
-                                         gpointer                  user_data)
+thunar_thumbnail_cache_async_reply (GObject      *proxy,
+                                    GAsyncResult *res,
+                                    gpointer      user_data)
 {
-  GList      *li;
-  ThunarFile *file;
-  GError     *error = NULL;
+  ThunarThumbnailCacheCall *call = user_data;
+  ThunarThumbnailCache     *cache = call->cache;
+  const gchar              *method;
+  GList                    *li;
+  ThunarFile               *file;
+  GError                   *error = NULL;
+  gboolean                  succeed;
 
   _thunar_return_if_fail (THUNAR_IS_THUMBNAIL_CACHE_DBUS (proxy));
 
-  if (!thunar_thumbnail_cache_dbus_call_copy_finish (proxy, res, &error))
+  switch (call->type)
     {
-      g_warning ("ThunarThumbnailCache: failed to call Copy(): %s", error->message);
+    case THUNAR_THUMBNAIL_CACHE_OP_MOVE:
+      method = "Move";
+      succeed = thunar_thumbnail_cache_dbus_call_move_finish (THUNAR_THUMBNAIL_CACHE_DBUS (proxy), res, &error);
+      break;
+    case THUNAR_THUMBNAIL_CACHE_OP_COPY:
+      method = "Copy";
+      succeed = thunar_thumbnail_cache_dbus_call_copy_finish (THUNAR_THUMBNAIL_CACHE_DBUS (proxy), res, &error);
+      break;
+    case THUNAR_THUMBNAIL_CACHE_OP_DELETE:
+      method = "Delete";
+      succeed = thunar_thumbnail_cache_dbus_call_delete_finish (THUNAR_THUMBNAIL_CACHE_DBUS (proxy), res, &error);
+      break;
+    default:
+      method = "Cleanup";
+      succeed = thunar_thumbnail_cache_dbus_call_cleanup_finish (THUNAR_THUMBNAIL_CACHE_DBUS (proxy), res, &error);
+      break;
+    }
+
+  if (!succeed)
+    {
+      g_warning ("ThunarThumbnailCache: failed to call %s(): %s", method, error->message);
     }
   g_clear_error (&error);
 
-  for (li = user_data; li != NULL; li = li->next)
+  for (li = call->targets; li != NULL; li = li->next)
     {
       file = thunar_file_cache_lookup (G_FILE (li->data));
 
@@ -171,196 +222,134 @@ thunar_thumbnail_cache_copy_async_reply (ThunarThumbnailCacheDBus *proxy,
         }
     }
 
-  g_list_free_full (user_data, g_object_unref);
+  /* send the next chunk now that tumblerd replied */
+  _thumbnail_cache_lock (cache);
+  cache->n_calls--;
+  thunar_thumbnail_cache_process_queue (cache);
+  _thumbnail_cache_unlock (cache);
+
+  g_list_free_full (call->targets, g_object_unref);
+  g_object_unref (cache);
+  g_slice_free (ThunarThumbnailCacheCall, call);
 }
 
 
 
+/* NOTE: assumes the lock is being held by the caller */
 static void
-thunar_thumbnail_cache_move_async_reply (ThunarThumbnailCacheDBus *proxy,
-                                         GAsyncResult             *res,
-                                         gpointer                  user_data)
+thunar_thumbnail_cache_forget_op (ThunarThumbnailCache *cache,
+                                  GList                *link)
 {
-  GList      *li;
-  ThunarFile *file;
-  GError     *error = NULL;
-
-  _thunar_return_if_fail (THUNAR_IS_THUMBNAIL_CACHE_DBUS (proxy));
-
-  if (!thunar_thumbnail_cache_dbus_call_move_finish (proxy, res, &error))
-    {
-      g_warning ("ThunarThumbnailCache: failed to call Move(): %s", error->message);
-    }
-  g_clear_error (&error);
+  ThunarThumbnailCacheOp *op = link->data;
 
-  for (li = user_data; li != NULL; li = li->next)
-    {
-      file = thunar_file_cache_lookup (G_FILE (li->data));
-
-      if (G_LIKELY (file != NULL))
-        {
-          /* if visible, let the view know there might be a thumb */
-          thunar_file_changed (file);
-          g_object_unref (file);
-        }
-    }
-
-  g_list_free_full (user_data, g_object_unref);
+  /* only the last operation of a file is in the table */
+  if (g_hash_table_lookup (cache->queued_files, op->file) == link)
+    g_hash_table_remove (cache->queued_files, op->file);
 }
 
 
 
+/* NOTE: assumes the lock is being held by the caller */
 static void
-thunar_thumbnail_cache_move_async (ThunarThumbnailCache *cache,
-                                   const gchar         **source_uris,
-                                   const gchar         **target_uris,
-                                   gpointer              user_data)
+thunar_thumbnail_cache_send_chunk (ThunarThumbnailCache *cache)
 {
-  _thunar_return_if_fail (THUNAR_IS_THUMBNAIL_CACHE (cache));
-  _thunar_return_if_fail (source_uris != NULL);
-  _thunar_return_if_fail (target_uris != NULL);
-
-  /* request a thumbnail cache update asynchronously */
-  thunar_thumbnail_cache_dbus_call_move (cache->cache_proxy,
-                                         source_uris, target_uris,
-                                         NULL,
-                                         (GAsyncReadyCallback)thunar_thumbnail_cache_move_async_reply,
-                                         user_data);
-}
+  ThunarThumbnailCacheCall *call;
+  ThunarThumbnailCacheOp   *op;
+  GPtrArray                *source_uris;
+  GPtrArray                *uris;
+  GList                    *link;
+
+  call = g_slice_new0 (ThunarThumbnailCacheCall);
+  call->cache = g_object_ref (cache);
+  call->type = ((ThunarThumbnailCacheOp *) g_queue_peek_head (&cache->queue))->type;
+
+  source_uris = g_ptr_array_new_with_free_func (g_free);
+  uris = g_ptr_array_new_with_free_func (g_free);
+
+  /* take the following operations of the same kind, in order */
+  while (uris->len < THUNAR_THUMBNAIL_CACHE_CHUNK_SIZE
+         && (link = g_queue_peek_head_link (&cache->queue)) != NULL
+         && ((ThunarThumbnailCacheOp *) link->data)->type == call->type)
+    {
+      op = link->data;
+      thunar_thumbnail_cache_forget_op (cache, link);
+      g_queue_delete_link (&cache->queue, link);
 
+      if (op->source != NULL)
+        g_ptr_array_add (source_uris, g_file_get_uri (op->source));
+      g_ptr_array_add (uris, g_file_get_uri (op->file));
 
+      if (call->type == THUNAR_THUMBNAIL_CACHE_OP_MOVE || call->type == THUNAR_THUMBNAIL_CACHE_OP_COPY)
+        call->targets = g_list_prepend (call->targets, g_object_ref (op->file));
 
-static void
-thunar_thumbnail_cache_copy_async (ThunarThumbnailCache *cache,
-                                   const gchar         **source_uris,
-                                   const gchar         **target_uris,
-                                   gpointer              user_data)
-{
-  _thunar_return_if_fail (THUNAR_IS_THUMBNAIL_CACHE (cache));
-  _thunar_return_if_fail (source_uris != NULL);
-  _thunar_return_if_fail (target_uris != NULL);
-
-  /* request a thumbnail cache update asynchronously */
-  thunar_thumbnail_cache_dbus_call_copy (cache->cache_proxy,
-                                         source_uris, target_uris,
-                                         NULL,
-                                         (GAsyncReadyCallback)thunar_thumbnail_cache_copy_async_reply,
-                                         user_data);
-}
+      thunar_thumbnail_cache_op_free (op);
+    }
 
+  /* NULL-terminate the URI arrays */
+  g_ptr_array_add (source_uris, NULL);
+  g_ptr_array_add (uris, NULL);
 
+  switch (call->type)
+    {
+    case THUNAR_THUMBNAIL_CACHE_OP_MOVE:
+      thunar_thumbnail_cache_dbus_call_move (cache->cache_proxy,
+                                             (const gchar *const *) source_uris->pdata,
+                                             (const gchar *const *) uris->pdata,
+                                             NULL, thunar_thumbnail_cache_async_reply, call);
+      break;
+    case THUNAR_THUMBNAIL_CACHE_OP_COPY:
+      thunar_thumbnail_cache_dbus_call_copy (cache->cache_proxy,
+                                             (const gchar *const *) source_uris->pdata,
+                                             (const gchar *const *) uris->pdata,
+                                             NULL, thunar_thumbnail_cache_async_reply, call);
+      break;
+    case THUNAR_THUMBNAIL_CACHE_OP_DELETE:
+      thunar_thumbnail_cache_dbus_call_delete (cache->cache_proxy,
+                                               (const gchar *const *) uris->pdata,
+                                               NULL, thunar_thumbnail_cache_async_reply, call);
+      break;
+    case THUNAR_THUMBNAIL_CACHE_OP_CLEANUP:
+      thunar_thumbnail_cache_dbus_call_cleanup (cache->cache_proxy,
+                                                (const gchar *const *) uris->pdata, 0,
+                                                NULL, thunar_thumbnail_cache_async_reply, call);
+      break;
+    }
 
-static void
-thunar_thumbnail_cache_delete_async (ThunarThumbnailCache *cache,
-                                     const gchar         **uris)
-{
-  _thunar_return_if_fail (THUNAR_IS_THUMBNAIL_CACHE (cache));
-  _thunar_return_if_fail (uris != NULL);
+  cache->n_calls++;
 
-  /* request a thumbnail cache update asynchronously */
-  thunar_thumbnail_cache_dbus_call_delete (cache->cache_proxy, uris,
-                                           NULL, NULL, NULL);
+  g_ptr_array_free (source_uris, TRUE);
+  g_ptr_array_free (uris, TRUE);
 }
 
 
 
+/* NOTE: assumes the lock is being held by the caller */
 static void
-thunar_thumbnail_cache_cleanup_async (ThunarThumbnailCache *cache,
-                                      const gchar *const    *base_uris)
+thunar_thumbnail_cache_process_queue (ThunarThumbnailCache *cache)
 {
   _thunar_return_if_fail (THUNAR_IS_THUMBNAIL_CACHE (cache));
-  _thunar_return_if_fail (base_uris != NULL);
 
-  /* request a thumbnail cache update asynchronously */
-  thunar_thumbnail_cache_dbus_call_cleanup (cache->cache_proxy,
-                                            (const gchar **)base_uris, 0,
-                                            NULL, NULL, NULL);
+  if (cache->proxy_state != THUNAR_THUMBNAIL_CACHE_PROXY_AVAILABLE)
+    return;
+
+  /* don't flood tumblerd, the rest is sent as the replies come in */
+  while (cache->n_calls < THUNAR_THUMBNAIL_CACHE_MAX_CALLS && !g_queue_is_empty (&cache->queue))
+    thunar_thumbnail_cache_send_chunk (cache);
 }
 
 
 
 static gboolean
-thunar_thumbnail_cache_process_queue (ThunarThumbnailCache *cache,
-                                      gboolean              copy_async)
+thunar_thumbnail_cache_process_queue_timeout (gpointer user_data)
 {
-  GList  *sp;
-  GList  *tp;
-  gchar **source_uris;
-  gchar **target_uris;
-  guint   n_uris;
-  guint   n;
-  GList  *source_queue;
-  GList  *target_queue;
+  ThunarThumbnailCache *cache = THUNAR_THUMBNAIL_CACHE (user_data);
 
   _thunar_return_val_if_fail (THUNAR_IS_THUMBNAIL_CACHE (cache), FALSE);
 
   /* acquire a cache lock */
   _thumbnail_cache_lock (cache);
 
-  /* steal the lists */
-  if (copy_async)
-    {
-      source_queue = cache->copy_source_queue;
-      cache->copy_source_queue = NULL;
-      target_queue = cache->copy_target_queue;
-      cache->copy_target_queue = NULL;
-    }
-  else
-    {
-      source_queue = cache->move_source_queue;
-      cache->move_source_queue = NULL;
-      target_queue = cache->move_target_queue;
-      cache->move_target_queue = NULL;
-    }
-
-  /* compute how many URIs there are */
-  n_uris = g_list_length (source_queue);
-
-  /* allocate a string array for the URIs */
-  source_uris = g_new0 (gchar *, n_uris + 1);
-  target_uris = g_new0 (gchar *, n_uris + 1);
-
-  /* fill URI array with file URIs from the move queue */
-  for (n = 0,
-       sp = g_list_last (source_queue),
-       tp = g_list_last (target_queue);
-       sp != NULL && tp != NULL;
-       sp = sp->prev, tp = tp->prev, ++n)
-    {
-      source_uris[n] = g_file_get_uri (sp->data);
-      target_uris[n] = g_file_get_uri (tp->data);
-
-      /* release the source object */
-      g_object_unref (sp->data);
-    }
-
-  /* NULL-terminate the URI arrays */
-  source_uris[n] = NULL;
-  target_uris[n] = NULL;
-
-  if (copy_async)
-    {
-      /* asynchronously copy the thumbnails */
-      thunar_thumbnail_cache_copy_async (cache,
-                                         (const gchar **)source_uris,
-                                         (const gchar **)target_uris,
-                                         target_queue);
-    }
-  else
-    {
-      /* asynchronously move the thumbnails */
-      thunar_thumbnail_cache_move_async (cache,
-                                         (const gchar **)source_uris,
-                                         (const gchar **)target_uris,
-                                         target_queue);
-    }
-
-  /* free the URI arrays */
-  g_strfreev (source_uris);
-  g_strfreev (target_uris);
-
-  /* release the move queue lists */
-  g_list_free (source_queue);
+  thunar_thumbnail_cache_process_queue (cache);
 
   /* release the cache lock */
   _thumbnail_cache_unlock (cache);
@@ -370,148 +359,135 @@ thunar_thumbnail_cache_process_queue (ThunarThumbnailCache *cache,
 
 
 
-static gboolean
-thunar_thumbnail_cache_process_move_queue (gpointer user_data)
-{
-  return thunar_thumbnail_cache_process_queue (user_data, FALSE);
-}
-
-
-
 static void
-thunar_thumbnail_cache_process_move_queue_destroy (gpointer user_data)
-{
-  THUNAR_THUMBNAIL_CACHE (user_data)->move_queue_idle_id = 0;
-}
-
-
-
-static gboolean
-thunar_thumbnail_cache_process_copy_queue (gpointer user_data)
+thunar_thumbnail_cache_process_queue_destroy (gpointer user_data)
 {
-  return thunar_thumbnail_cache_process_queue (user_data, TRUE);
+  THUNAR_THUMBNAIL_CACHE (user_data)->queue_idle_id = 0;
 }
 
 
 
+/* NOTE: assumes the lock is being held by the caller */
 static void
-thunar_thumbnail_cache_process_copy_queue_destroy (gpointer user_data)
-{
-  THUNAR_THUMBNAIL_CACHE (user_data)->copy_queue_idle_id = 0;
-}
-
-
-
-static gboolean
-thunar_thumbnail_cache_process_delete_queue (gpointer user_data)
+thunar_thumbnail_cache_schedule (ThunarThumbnailCache *cache)
 {
-  ThunarThumbnailCache *cache = user_data;
-  GList  *lp;
-  gchar **uris;
-  guint   n_uris;
-  guint   n;
-
-  _thunar_return_val_if_fail (THUNAR_IS_THUMBNAIL_CACHE (cache), FALSE);
-
-  /* acquire a cache lock */
-  _thumbnail_cache_lock (cache);
-
-  /* compute how many URIs there are */
-  n_uris = g_list_length (cache->delete_queue);
-
-  /* allocate a string array for the URIs */
-  uris = g_new0 (gchar *, n_uris + 1);
-
-  /* fill URI array with file URIs from the delete queue */
-  for (lp = g_list_last (cache->delete_queue), n = 0; lp != NULL; lp = lp->prev, ++n)
+  /* the timeout is not restarted, so a long transfer is sent while it is running */
+  if (cache->proxy_state == THUNAR_THUMBNAIL_CACHE_PROXY_AVAILABLE && cache->queue_idle_id == 0)
     {
-      uris[n] = g_file_get_uri (lp->data);
-
-      /* release the file object */
-      g_object_unref (lp->data);
+      cache->queue_idle_id =
+        g_timeout_add_full (G_PRIORITY_DEFAULT_IDLE, THUNAR_THUMBNAIL_CACHE_QUEUE_DELAY,
+                            thunar_thumbnail_cache_process_queue_timeout,
+                            cache, thunar_thumbnail_cache_process_queue_destroy);
     }
+}
 
-  /* NULL-terminate the URI array */
-  uris[n] = NULL;
-
-  /* asynchronously delete the thumbnails */
-  thunar_thumbnail_cache_delete_async (cache, (const gchar **)uris);
 
-  /* free the URI array */
-  g_strfreev (uris);
 
-  /* release the delete queue list */
-  g_list_free (cache->delete_queue);
-  cache->delete_queue = NULL;
+/* NOTE: assumes the lock is being held by the caller */
+static void
+thunar_thumbnail_cache_push_op (ThunarThumbnailCache       *cache,
+                                ThunarThumbnailCacheOpType  type,
+                                GFile                      *source,
+                                GFile                      *file)
+{
+  ThunarThumbnailCacheOp *op;
 
-  /* reset the delete queue idle ID */
-  cache->delete_queue_idle_id = 0;
+  op = g_slice_new (ThunarThumbnailCacheOp);
+  op->type = type;
+  op->source = (source != NULL) ? g_object_ref (source) : NULL;
+  op->file = g_object_ref (file);
 
-  /* release the cache lock */
-  _thumbnail_cache_unlock (cache);
+  g_queue_push_tail (&cache->queue, op);
+  g_hash_table_insert (cache->queued_files, op->file, g_queue_peek_tail_link (&cache->queue));
 
-  return FALSE;
+  thunar_thumbnail_cache_schedule (cache);
 }
 
 
 
-static gboolean
-thunar_thumbnail_cache_process_cleanup_queue (gpointer user_data)
+/* NOTE: assumes the lock is being held by the caller */
+static void
+thunar_thumbnail_cache_queue_op (ThunarThumbnailCache       *cache,
+                                 ThunarThumbnailCacheOpType  type,
+                                 GFile                      *source,
+                                 GFile                      *file)
 {
-  ThunarThumbnailCache *cache = user_data;
-  GList  *lp;
-  gchar **uris;
-  guint   n_uris;
-  guint   n;
-
-  _thunar_return_val_if_fail (THUNAR_IS_THUMBNAIL_CACHE (cache), FALSE);
-
-  /* acquire a cache lock */
-  _thumbnail_cache_lock (cache);
+  ThunarThumbnailCacheOp *previous;
+  GList                  *link;
 
-  /* compute how many URIs there are */
-  n_uris = g_list_length (cache->cleanup_queue);
-
-  /* allocate a string array for the URIs */
-  uris = g_new0 (gchar *, n_uris + 1);
-
-#ifndef NDEBUG
-  g_debug ("cleanup:");
-#endif
+  /* nothing will be sent anyway */
+  if (cache->proxy_state == THUNAR_THUMBNAIL_CACHE_PROXY_FAILED)
+    return;
 
-  /* fill URI array with file URIs from the cleanup queue */
-  for (lp = g_list_last (cache->cleanup_queue), n = 0; lp != NULL; lp = lp->prev, ++n)
+  switch (type)
     {
-      uris[n] = g_file_get_uri (lp->data);
-
-#ifndef NDEBUG
-      g_debug ("  %s", uris[n]);
-#endif
+    case THUNAR_THUMBNAIL_CACHE_OP_MOVE:
+      /* a file moved or copied here before is moved on, so R->S, S->T becomes R->T */
+      link = g_hash_table_lookup (cache->queued_files, source);
+      previous = (link != NULL) ? link->data : NULL;
+      if (previous != NULL
+          && (previous->type == THUNAR_THUMBNAIL_CACHE_OP_MOVE || previous->type == THUNAR_THUMBNAIL_CACHE_OP_COPY)
+          && !g_hash_table_contains (cache->queued_files, file))
+        {
+          g_hash_table_remove (cache->queued_files, previous->file);
+          g_object_unref (previous->file);
+          previous->file = g_object_ref (file);
+          g_hash_table_insert (cache->queued_files, previous->file, link);
+          return;
+        }
+      break;
+
+    case THUNAR_THUMBNAIL_CACHE_OP_COPY:
+      /* the same copy twice */
+      link = g_hash_table_lookup (cache->queued_files, file);
+      previous = (link != NULL) ? link->data : NULL;
+      if (previous != NULL && previous->type == type && g_file_equal (previous->source, source))
+        return;
+      break;
+
+    case THUNAR_THUMBNAIL_CACHE_OP_DELETE:
+      link = g_hash_table_lookup (cache->queued_files, file);
+      previous = (link != NULL) ? link->data : NULL;
+      if (previous == NULL)
+        break;
+
+      if (previous->type == THUNAR_THUMBNAIL_CACHE_OP_DELETE)
+        {
+          /* deleted twice */
+          return;
+        }
+      else if (previous->type == THUNAR_THUMBNAIL_CACHE_OP_MOVE
+               && !g_hash_table_contains (cache->queued_files, previous->source))
+        {
+          /* R->S then delete S is just delete R */
+          g_hash_table_remove (cache->queued_files, previous->file);
+          g_object_unref (previous->file);
+          previous->type = THUNAR_THUMBNAIL_CACHE_OP_DELETE;
+          previous->file = g_steal_pointer (&previous->source);
+          g_hash_table_insert (cache->queued_files, previous->file, link);
+        }
+      else if (previous->type == THUNAR_THUMBNAIL_CACHE_OP_COPY)
+        {
+          /* the copy is moot, but an older thumbnail of the file may still be around */
+          thunar_thumbnail_cache_forget_op (cache, link);
+          g_queue_delete_link (&cache->queue, link);
+          thunar_thumbnail_cache_op_free (previous);
+          break;
+        }
+      else
+        break;
+      return;
 
-      /* release the file object */
-      g_object_unref (lp->data);
+    case THUNAR_THUMBNAIL_CACHE_OP_CLEANUP:
+      /* cleaned up twice */
+      link = g_hash_table_lookup (cache->queued_files, file);
+      previous = (link != NULL) ? link->data : NULL;
+      if (previous != NULL && previous->type == type)
+        return;
+      break;
     }
 
-  /* NULL-terminate the URI array */
-  uris[n] = NULL;
-
-  /* asynchronously cleanup the thumbnails */
-  thunar_thumbnail_cache_cleanup_async (cache, (const gchar *const *)uris);
-
-  /* free the URI array */
-  g_strfreev (uris);
-
-  /* release the cleanup queue list */
-  g_list_free (cache->cleanup_queue);
-  cache->cleanup_queue = NULL;
-
-  /* reset the cleanup queue idle ID */
-  cache->cleanup_queue_idle_id = 0;
-
-  /* release the cache lock */
-  _thumbnail_cache_unlock (cache);
-
-  return FALSE;
+  thunar_thumbnail_cache_push_op (cache, type, source, file);
 }
 
 
@@ -530,12 +506,21 @@ thunar_thumbnail_cache_move_file (ThunarThumbnailCache *cache,
                                   GFile                *target_file)
 {
   GFileInfo *file_info;
+  GFile     *target_parent;
   gboolean   is_symlink = TRUE;
 
   _thunar_return_if_fail (THUNAR_IS_THUMBNAIL_CACHE (cache));
   _thunar_return_if_fail (G_IS_FILE (source_file));
   _thunar_return_if_fail (G_IS_FILE (target_file));
 
+  /* the packed thumbnails of the target folder might belong to the replaced files */
+  target_parent = g_file_get_parent (target_file);
+  if (target_parent != NULL)
+    {
+      thunar_thumbnail_pack_invalidate (target_parent);
+      g_object_unref (target_parent);
+    }
+
   /* For some weird reason, gio will spam criticals, when we dont query is-hidden/is-backup. So lets just querry all standard attributes */
   file_info = g_file_query_info (target_file, "standard::*", G_FILE_QUERY_INFO_NONE, NULL, NULL);
 
@@ -556,30 +541,8 @@ thunar_thumbnail_cache_move_file (ThunarThumbnailCache *cache,
   /* acquire a cache lock */
   _thumbnail_cache_lock (cache);
 
-  /* check if we have a valid proxy for the cache service */
-  if (cache->proxy_state != THUNAR_THUMBNAIL_CACHE_PROXY_FAILED)
-    {
-      /* add the files to the move queue */
-      cache->move_source_queue = g_list_prepend (cache->move_source_queue,
-                                                 g_object_ref (source_file));
-      cache->move_target_queue = g_list_prepend (cache->move_target_queue,
-                                                 g_object_ref (target_file));
-    }
-
-  if (cache->proxy_state == THUNAR_THUMBNAIL_CACHE_PROXY_AVAILABLE)
-    {
-      /* cancel any pending timeout to process the move queue */
-      if (cache->move_queue_idle_id > 0)
-        {
-          g_source_remove (cache->move_queue_idle_id);
-          cache->move_queue_idle_id = 0;
-        }
-
-      /* process the move queue in a 250ms timeout */
-      cache->move_queue_idle_id =
-        g_timeout_add_full (G_PRIORITY_DEFAULT_IDLE, 250, thunar_thumbnail_cache_process_move_queue,
-                            cache, thunar_thumbnail_cache_process_move_queue_destroy);
-    }
+  /* queue the move */
+  thunar_thumbnail_cache_queue_op (cache, THUNAR_THUMBNAIL_CACHE_OP_MOVE, source_file, target_file);
 
   /* release the cache lock */
   _thumbnail_cache_unlock (cache);
@@ -593,12 +556,21 @@ thunar_thumbnail_cache_copy_file (ThunarThumbnailCache *cache,
                                   GFile                *target_file)
 {
   GFileInfo *file_info;
+  GFile     *target_parent;
   gboolean   is_symlink = TRUE;
 
   _thunar_return_if_fail (THUNAR_IS_THUMBNAIL_CACHE (cache));
   _thunar_return_if_fail (G_IS_FILE (source_file));
   _thunar_return_if_fail (G_IS_FILE (target_file));
 
+  /* the packed thumbnails of the target folder might belong to the replaced files */
+  target_parent = g_file_get_parent (target_file);
+  if (target_parent != NULL)
+    {
+      thunar_thumbnail_pack_invalidate (target_parent);
+      g_object_unref (target_parent);
+    }
+
   /* For some weird reason, gio will spam criticals, when we dont query is-hidden/is-backup. So lets just querry all standard attributes */
   file_info = g_file_query_info (target_file, "standard::*", G_FILE_QUERY_INFO_NONE, NULL, NULL);
 
@@ -616,30 +588,8 @@ thunar_thumbnail_cache_copy_file (ThunarThumbnailCache *cache,
   /* acquire a cache lock */
   _thumbnail_cache_lock (cache);
 
-  /* check if we have a valid proxy for the cache service */
-  if (cache->proxy_state != THUNAR_THUMBNAIL_CACHE_PROXY_FAILED)
-    {
-      /* add the files to the copy queues */
-      cache->copy_source_queue = g_list_prepend (cache->copy_source_queue,
-                                                 g_object_ref (source_file));
-      cache->copy_target_queue = g_list_prepend (cache->copy_target_queue,
-                                                 g_object_ref (target_file));
-    }
-
-  if (cache->proxy_state == THUNAR_THUMBNAIL_CACHE_PROXY_AVAILABLE)
-    {
-      /* cancel any pending timeout to process the copy queue */
-      if (cache->copy_queue_idle_id > 0)
-        {
-          g_source_remove (cache->copy_queue_idle_id);
-          cache->copy_queue_idle_id = 0;
-        }
-
-      /* process the copy queue in a 250ms timeout */
-      cache->copy_queue_idle_id =
-        g_timeout_add_full (G_PRIORITY_DEFAULT_IDLE, 500, thunar_thumbnail_cache_process_copy_queue,
-                            cache, thunar_thumbnail_cache_process_copy_queue_destroy);
-    }
+  /* queue the copy */
+  thunar_thumbnail_cache_queue_op (cache, THUNAR_THUMBNAIL_CACHE_OP_COPY, source_file, target_file);
 
   /* release the cache lock */
   _thumbnail_cache_unlock (cache);
@@ -657,26 +607,8 @@ thunar_thumbnail_cache_delete_file (ThunarThumbnailCache *cache,
   /* acquire a cache lock */
   _thumbnail_cache_lock (cache);
 
-  /* check if we have a valid proxy for the cache service */
-  if (cache->proxy_state != THUNAR_THUMBNAIL_CACHE_PROXY_FAILED)
-    {
-      /* add the file to the delete queue */
-      cache->delete_queue = g_list_prepend (cache->delete_queue, g_object_ref (file));
-    }
-
-  if (cache->proxy_state == THUNAR_THUMBNAIL_CACHE_PROXY_AVAILABLE)
-    {
-      /* cancel any pending timeout to process the delete queue */
-      if (cache->delete_queue_idle_id > 0)
-        {
-          g_source_remove (cache->delete_queue_idle_id);
-          cache->delete_queue_idle_id = 0;
-        }
-
-      /* process the delete queue in a 250ms timeout */
-      cache->delete_queue_idle_id =
-        g_timeout_add (500, thunar_thumbnail_cache_process_delete_queue, cache);
-    }
+  /* queue the delete */
+  thunar_thumbnail_cache_queue_op (cache, THUNAR_THUMBNAIL_CACHE_OP_DELETE, NULL, file);
 
   /* release the cache lock */
   _thumbnail_cache_unlock (cache);
@@ -694,26 +626,8 @@ thunar_thumbnail_cache_cleanup_file (ThunarThumbnailCache *cache,
   /* acquire a cache lock */
   _thumbnail_cache_lock (cache);
 
-  /* check if we have a valid proxy for the cache service */
-  if (cache->proxy_state != THUNAR_THUMBNAIL_CACHE_PROXY_FAILED)
-    {
-      /* add the file to the cleanup queue */
-      cache->cleanup_queue = g_list_prepend (cache->cleanup_queue, g_object_ref (file));
-    }
-
-  if (cache->proxy_state == THUNAR_THUMBNAIL_CACHE_PROXY_AVAILABLE)
-    {
-      /* cancel any pending timeout to process the cleanup queue */
-      if (cache->cleanup_queue_idle_id > 0)
-        {
-          g_source_remove (cache->cleanup_queue_idle_id);
-          cache->cleanup_queue_idle_id = 0;
-        }
-
-      /* process the cleanup queue in a 250ms timeout */
-      cache->cleanup_queue_idle_id =
-        g_timeout_add (1000, thunar_thumbnail_cache_process_cleanup_queue, cache);
-    }
+  /* queue the cleanup */
+  thunar_thumbnail_cache_queue_op (cache, THUNAR_THUMBNAIL_CACHE_OP_CLEANUP, NULL, file);
 
   /* release the cache lock */
   _thumbnail_cache_unlock (cache);
@@ -746,27 +660,17 @@ thunar_thumbnail_cache_proxy_created (GObject      *source,
 
   g_clear_error (&error);
 
-  /* process the move queue in a 250ms timeout */
-  if (cache->move_source_queue)
-      cache->move_queue_idle_id =
-        g_timeout_add_full (G_PRIORITY_DEFAULT_IDLE, 250, thunar_thumbnail_cache_process_move_queue,
-                            cache, thunar_thumbnail_cache_process_move_queue_destroy);
-
-  /* process the copy queue in a 250ms timeout */
-  if (cache->copy_source_queue)
-      cache->copy_queue_idle_id =
-        g_timeout_add_full (G_PRIORITY_DEFAULT_IDLE, 500, thunar_thumbnail_cache_process_copy_queue,
-                            cache, thunar_thumbnail_cache_process_copy_queue_destroy);
-
-  /* process the delete queue in a 250ms timeout */
-  if (cache->delete_queue)
-      cache->delete_queue_idle_id =
-        g_timeout_add (500, thunar_thumbnail_cache_process_delete_queue, cache);
-
-  /* process the cleanup queue in a 250ms timeout */
-  if (cache->cleanup_queue)
-      cache->cleanup_queue_idle_id =
-        g_timeout_add (1000, thunar_thumbnail_cache_process_cleanup_queue, cache);
+  /* send what was queued while connecting, or drop it if there is no service */
+  if (cache->proxy_state == THUNAR_THUMBNAIL_CACHE_PROXY_AVAILABLE)
+    {
+      if (!g_queue_is_empty (&cache->queue))
+        thunar_thumbnail_cache_schedule (cache);
+    }
+  else
+    {
+      g_hash_table_remove_all (cache->queued_files);
+      g_queue_clear_full (&cache->queue, thunar_thumbnail_cache_op_free);
+    }
 
   _thumbnail_cache_unlock (cache);
 
@@ -782,6 +686,9 @@ thunar_thumbnail_cache_init (ThunarThumbnailCache *cache)
   /* create a new mutex for accessing the cache from different threads */
   g_mutex_init (&cache->lock);
 
+  g_queue_init (&cache->queue);
+  cache->queued_files = g_hash_table_new (g_file_hash, (GEqualFunc) g_file_equal);
+
   /* add an additional reference to keep us alive while tre proxy initializes */
   g_object_ref (cache);
 
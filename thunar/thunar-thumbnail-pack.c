@@ -0,0 +1,540 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* A thumbnail pack holds the cached thumbnails of one size for the files of
+ * one local folder, stored as a serialized GVariant in
+ * $XDG_CACHE_HOME/Thunar/thumbnails/, named after the md5 of the folder URI
+ * and the thumbnail size. A pack is written when a folder, whose thumbnails
+ * were read one by one from the thumbnail cache, is released, and mapped as
+ * a whole the next time its thumbnails are drawn. The PNG data is stored as
+ * is, together with the modification time of the file it belongs to, so
+ * outdated entries are skipped and read from the thumbnail cache again. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <glib/gstdio.h>
+
+#include "thunar/thunar-file.h"
+#include "thunar/thunar-private.h"
+#include "thunar/thunar-thumbnail-pack.h"
+#include "thunar/thunar-util.h"
+
+
+
+/* bump on changes of the format below */
+#define THUNAR_THUMBNAIL_PACK_VERSION (1)
+
+/* version, folder URI and per file the md5 of its URI, its mtime and the thumbnail PNG */
+#define THUNAR_THUMBNAIL_PACK_ENTRIES_TYPE "a(stay)"
+#define THUNAR_THUMBNAIL_PACK_TYPE         "(us" THUNAR_THUMBNAIL_PACK_ENTRIES_TYPE ")"
+
+/* only folders this large whose thumbnails were missed this often are packed */
+#define THUNAR_THUMBNAIL_PACK_MIN_FILES  (256)
+#define THUNAR_THUMBNAIL_PACK_MIN_MISSES (128)
+
+/* limits of a single thumbnail and of a whole pack, in bytes */
+#define THUNAR_THUMBNAIL_PACK_MAX_ENTRY_SIZE (256 * 1024)
+#define THUNAR_THUMBNAIL_PACK_MAX_SIZE       (64 * 1024 * 1024)
+
+/* packs kept on disk and mapped at the same time */
+#define THUNAR_THUMBNAIL_PACK_MAX_PACKS  (32)
+#define THUNAR_THUMBNAIL_PACK_MAX_LOADED (8)
+
+
+
+typedef struct
+{
+  GVariant   *entries;   /* %NULL if the folder has no pack */
+  GHashTable *index;     /* md5 of the file URI -> position in entries */
+  guint       n_misses;  /* lookups which found no valid entry */
+}
+ThunarThumbnailPack;
+
+typedef struct
+{
+  gchar     *directory_uri;
+  GPtrArray *uris;
+  GArray    *mtimes;
+  guint      sizes;      /* mask of the thumbnail sizes to pack */
+  guint      serial;
+}
+ThunarThumbnailPackSave;
+
+
+
+/* folder URI and size -> ThunarThumbnailPack, a counter bumped on invalidation
+ * and the last invalidated folder, which has no packs until one is written */
+static GHashTable *thunar_thumbnail_packs = NULL;
+static guint       thunar_thumbnail_packs_serial = 0;
+static gchar      *thunar_thumbnail_packs_invalidated = NULL;
+G_LOCK_DEFINE_STATIC (thunar_thumbnail_packs);
+
+
+
+static void
+thunar_thumbnail_pack_free (gpointer data)
+{
+  ThunarThumbnailPack *pack = data;
+
+  if (pack->entries != NULL)
+    g_variant_unref (pack->entries);
+  if (pack->index != NULL)
+    g_hash_table_destroy (pack->index);
+  g_slice_free (ThunarThumbnailPack, pack);
+}
+
+
+
+/* the URI of the folder containing @uri, as used for the pack names */
+static gchar *
+thunar_thumbnail_pack_get_directory_uri (const gchar *uri)
+{
+  const gchar *slash;
+
+  slash = strrchr (uri, '/');
+  if (G_UNLIKELY (slash == NULL))
+    return g_strdup (uri);
+
+  return g_strndup (uri, slash - uri);
+}
+
+
+
+static gchar *
+thunar_thumbnail_pack_get_key (const gchar         *directory_uri,
+                               ThunarThumbnailSize  thumbnail_size)
+{
+  return g_strdup_printf ("%s\n%d", directory_uri, thumbnail_size);
+}
+
+
+
+static gchar *
+thunar_thumbnail_pack_get_dirname (void)
+{
+  return g_build_filename (g_get_user_cache_dir (), "Thunar", "thumbnails", NULL);
+}
+
+
+
+static gchar *
+thunar_thumbnail_pack_get_path (const gchar         *directory_uri,
+                                ThunarThumbnailSize  thumbnail_size)
+{
+  gchar *checksum;
+  gchar *dirname;
+  gchar *filename;
+  gchar *path;
+
+  checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, directory_uri, -1);
+  filename = g_strconcat (checksum, "-", thunar_thumbnail_size_get_nick (thumbnail_size), NULL);
+  dirname = thunar_thumbnail_pack_get_dirname ();
+  path = g_build_filename (dirname, filename, NULL);
+  g_free (dirname);
+  g_free (filename);
+  g_free (checksum);
+
+  return path;
+}
+
+
+
+/* NOTE: assumes the lock is held by the caller */
+static ThunarThumbnailPack *
+thunar_thumbnail_pack_load (const gchar         *directory_uri,
+                            ThunarThumbnailSize  thumbnail_size)
+{
+  ThunarThumbnailPack *pack;
+  GMappedFile         *mapped_file;
+  GVariantIter         iter;
+  const gchar         *checksum;
+  const gchar         *uri;
+  GVariant            *variant;
+  GBytes              *bytes;
+  guint32              version;
+  guint                n;
+  gchar               *path;
+
+  pack = g_slice_new0 (ThunarThumbnailPack);
+
+  path = thunar_thumbnail_pack_get_path (directory_uri, thumbnail_size);
+  mapped_file = g_mapped_file_new (path, FALSE, NULL);
+  g_free (path);
+  if (mapped_file == NULL)
+    return pack;
+
+  bytes = g_mapped_file_get_bytes (mapped_file);
+  g_mapped_file_unref (mapped_file);
+
+  /* untrusted data is fine here, GVariant never reads out of bounds */
+  variant = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE (THUNAR_THUMBNAIL_PACK_TYPE), bytes, FALSE));
+  g_bytes_unref (bytes);
+
+  g_variant_get (variant, "(u&s@" THUNAR_THUMBNAIL_PACK_ENTRIES_TYPE ")", &version, &uri, &pack->entries);
+  if (version != THUNAR_THUMBNAIL_PACK_VERSION || g_strcmp0 (uri, directory_uri) != 0)
+    {
+      g_clear_pointer (&pack->entries, g_variant_unref);
+      g_variant_unref (variant);
+      return pack;
+    }
+  g_variant_unref (variant);
+
+  /* the keys point into the mapped pack, which the entries keep alive */
+  pack->index = g_hash_table_new (g_str_hash, g_str_equal);
+  g_variant_iter_init (&iter, pack->entries);
+  for (n = 0; g_variant_iter_next (&iter, "(&st@ay)", &checksum, NULL, NULL); n++)
+    g_hash_table_insert (pack->index, (gpointer) checksum, GUINT_TO_POINTER (n));
+
+  return pack;
+}
+
+
+
+/**
+ * thunar_thumbnail_pack_lookup:
+ * @uri            : the URI of a file.
+ * @thumbnail_size : the #ThunarThumbnailSize of the thumbnail.
+ * @mtime          : the modification time of the file.
+ *
+ * Looks up the thumbnail of @uri in the pack of its folder. Entries made
+ * for another @mtime are ignored. May be called from any thread.
+ *
+ * Return value: (transfer full): the PNG data of the thumbnail, or %NULL
+ *               if the pack has no valid thumbnail for @uri.
+ **/
+GBytes *
+thunar_thumbnail_pack_lookup (const gchar         *uri,
+                              ThunarThumbnailSize  thumbnail_size,
+                              guint64              mtime)
+{
+  ThunarThumbnailPack *pack;
+  GVariant            *data;
+  GBytes              *bytes = NULL;
+  gpointer             position;
+  guint64              entry_mtime;
+  gchar               *directory_uri;
+  gchar               *checksum;
+  gchar               *key;
+
+  _thunar_return_val_if_fail (uri != NULL, NULL);
+
+  directory_uri = thunar_thumbnail_pack_get_directory_uri (uri);
+  key = thunar_thumbnail_pack_get_key (directory_uri, thumbnail_size);
+
+  G_LOCK (thunar_thumbnail_packs);
+
+  if (G_UNLIKELY (thunar_thumbnail_packs == NULL))
+    thunar_thumbnail_packs = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, thunar_thumbnail_pack_free);
+
+  pack = g_hash_table_lookup (thunar_thumbnail_packs, key);
+  if (pack == NULL)
+    {
+      /* keep the number of mapped packs bounded */
+      if (g_hash_table_size (thunar_thumbnail_packs) >= THUNAR_THUMBNAIL_PACK_MAX_LOADED)
+        g_hash_table_remove_all (thunar_thumbnail_packs);
+
+      pack = thunar_thumbnail_pack_load (directory_uri, thumbnail_size);
+      g_hash_table_insert (thunar_thumbnail_packs, g_steal_pointer (&key), pack);
+    }
+
+  if (pack->index != NULL)
+    {
+      checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, uri, -1);
+      if (g_hash_table_lookup_extended (pack->index, checksum, NULL, &position))
+        {
+          g_variant_get_child (pack->entries, GPOINTER_TO_UINT (position), "(&st@ay)", NULL, &entry_mtime, &data);
+          if (entry_mtime == mtime)
+            bytes = g_variant_get_data_as_bytes (data);
+          g_variant_unref (data);
+        }
+      g_free (checksum);
+    }
+
+  if (bytes == NULL)
+    pack->n_misses++;
+
+  G_UNLOCK (thunar_thumbnail_packs);
+
+  g_free (key);
+  g_free (directory_uri);
+
+  return bytes;
+}
+
+
+
+/* drops the mapped packs of @directory_uri, the lock must be held */
+static void
+thunar_thumbnail_pack_forget (const gchar *directory_uri)
+{
+  gchar *key;
+  gint   size;
+
+  if (thunar_thumbnail_packs == NULL)
+    return;
+
+  for (size = 0; size < N_THUMBNAIL_SIZES; size++)
+    {
+      key = thunar_thumbnail_pack_get_key (directory_uri, size);
+      g_hash_table_remove (thunar_thumbnail_packs, key);
+      g_free (key);
+    }
+}
+
+
+
+static GVariant *
+thunar_thumbnail_pack_build (ThunarThumbnailPackSave *save,
+                             ThunarThumbnailSize      thumbnail_size)
+{
+  GVariantBuilder builder;
+  const gchar    *uri;
+  guint64         mtime;
+  gsize           total = 0;
+  gsize           length;
+  gchar          *contents;
+  gchar          *checksum;
+  gchar          *path;
+  guint           n;
+
+  g_variant_builder_init (&builder, G_VARIANT_TYPE (THUNAR_THUMBNAIL_PACK_ENTRIES_TYPE));
+  for (n = 0; n < save->uris->len; n++)
+    {
+      uri = g_ptr_array_index (save->uris, n);
+      mtime = g_array_index (save->mtimes, guint64, n);
+
+      path = thunar_util_get_thumbnail_path (uri, FALSE, thumbnail_size);
+      if (path != NULL
+          && !thunar_util_thumbnail_is_stale (path, mtime)
+          && g_file_get_contents (path, &contents, &length, NULL))
+        {
+          if (length <= THUNAR_THUMBNAIL_PACK_MAX_ENTRY_SIZE && total + length <= THUNAR_THUMBNAIL_PACK_MAX_SIZE)
+            {
+              checksum = g_compute_checksum_for_string (G_CHECKSUM_MD5, uri, -1);
+              g_variant_builder_add (&builder, "(st@ay)", checksum, mtime,
+                                     g_variant_new_from_data (G_VARIANT_TYPE_BYTESTRING, contents, length,
+                                                              TRUE, g_free, contents));
+              g_free (checksum);
+              total += length;
+            }
+          else
+            g_free (contents);
+        }
+      g_free (path);
+    }
+
+  return g_variant_ref_sink (g_variant_new ("(us@" THUNAR_THUMBNAIL_PACK_ENTRIES_TYPE ")",
+                                            THUNAR_THUMBNAIL_PACK_VERSION, save->directory_uri,
+                                            g_variant_builder_end (&builder)));
+}
+
+
+
+static gpointer
+thunar_thumbnail_pack_save_thread (gpointer user_data)
+{
+  ThunarThumbnailPackSave *save = user_data;
+  GVariant                *variant;
+  gboolean                 valid;
+  gchar                   *dirname;
+  gchar                   *path;
+  gint                     size;
+
+  dirname = thunar_thumbnail_pack_get_dirname ();
+  for (size = 0; size < N_THUMBNAIL_SIZES; size++)
+    {
+      if ((save->sizes & (1u << size)) == 0)
+        continue;
+
+      variant = thunar_thumbnail_pack_build (save, size);
+      path = thunar_thumbnail_pack_get_path (save->directory_uri, size);
+
+      /* files may have been moved into the folder while the pack was built */
+      G_LOCK (thunar_thumbnail_packs);
+      valid = (save->serial == thunar_thumbnail_packs_serial);
+      if (valid
+          && g_mkdir_with_parents (dirname, 0700) == 0
+          && g_file_set_contents_full (path, g_variant_get_data (variant), g_variant_get_size (variant),
+                                       G_FILE_SET_CONTENTS_CONSISTENT, 0600, NULL))
+        {
+          thunar_thumbnail_pack_forget (save->directory_uri);
+          g_clear_pointer (&thunar_thumbnail_packs_invalidated, g_free);
+        }
+      G_UNLOCK (thunar_thumbnail_packs);
+
+      g_free (path);
+      g_variant_unref (variant);
+    }
+
+  thunar_util_prune_directory (dirname, THUNAR_THUMBNAIL_PACK_MAX_PACKS);
+  g_free (dirname);
+
+  g_free (save->directory_uri);
+  g_ptr_array_free (save->uris, TRUE);
+  g_array_free (save->mtimes, TRUE);
+  g_slice_free (ThunarThumbnailPackSave, save);
+
+  return NULL;
+}
+
+
+
+/**
+ * thunar_thumbnail_pack_save:
+ * @directory : a #GFile.
+ * @files     : the #GList of #ThunarFile<!---->s in @directory.
+ *
+ * Packs the cached thumbnails of @files, for each size at which many of
+ * them had to be read from the thumbnail cache one by one. The thumbnails
+ * are read and the packs are written in a separate thread.
+ **/
+void
+thunar_thumbnail_pack_save (GFile *directory,
+                            GList *files)
+{
+  ThunarThumbnailPackSave *save;
+  ThunarThumbnailPack     *pack;
+  GThread                 *thread;
+  guint64                  mtime;
+  GList                   *lp;
+  gchar                   *directory_uri;
+  gchar                   *key;
+  gchar                   *uri;
+  guint                    sizes = 0;
+  guint                    serial;
+  gint                     size;
+
+  _thunar_return_if_fail (G_IS_FILE (directory));
+
+  if (files == NULL || !g_file_is_native (directory) || g_list_length (files) < THUNAR_THUMBNAIL_PACK_MIN_FILES)
+    return;
+
+  uri = thunar_file_dup_uri (files->data);
+  directory_uri = thunar_thumbnail_pack_get_directory_uri (uri);
+  g_free (uri);
+
+  G_LOCK (thunar_thumbnail_packs);
+  serial = thunar_thumbnail_packs_serial;
+  for (size = 0; thunar_thumbnail_packs != NULL && size < N_THUMBNAIL_SIZES; size++)
+    {
+      key = thunar_thumbnail_pack_get_key (directory_uri, size);
+      pack = g_hash_table_lookup (thunar_thumbnail_packs, key);
+      if (pack != NULL && pack->n_misses >= THUNAR_THUMBNAIL_PACK_MIN_MISSES)
+        {
+          pack->n_misses = 0;
+          sizes |= 1u << size;
+        }
+      g_free (key);
+    }
+  G_UNLOCK (thunar_thumbnail_packs);
+
+  if (sizes == 0)
+    {
+      g_free (directory_uri);
+      return;
+    }
+
+  save = g_slice_new (ThunarThumbnailPackSave);
+  save->directory_uri = directory_uri;
+  save->uris = g_ptr_array_new_with_free_func (g_free);
+  save->mtimes = g_array_new (FALSE, FALSE, sizeof (guint64));
+  save->sizes = sizes;
+  save->serial = serial;
+
+  for (lp = files; lp != NULL; lp = lp->next)
+    {
+      if (!thunar_file_is_regular (lp->data))
+        continue;
+
+      mtime = thunar_file_get_date (lp->data, THUNAR_FILE_DATE_MODIFIED);
+      g_ptr_array_add (save->uris, thunar_file_dup_uri (lp->data));
+      g_array_append_val (save->mtimes, mtime);
+    }
+
+  thread = g_thread_try_new ("thunar-thumbnail-pack", thunar_thumbnail_pack_save_thread, save, NULL);
+  if (G_LIKELY (thread != NULL))
+    {
+      g_thread_unref (thread);
+      return;
+    }
+
+  /* no pack this time */
+  g_free (save->directory_uri);
+  g_ptr_array_free (save->uris, TRUE);
+  g_array_free (save->mtimes, TRUE);
+  g_slice_free (ThunarThumbnailPackSave, save);
+}
+
+
+
+/**
+ * thunar_thumbnail_pack_invalidate:
+ * @directory : a #GFile.
+ *
+ * Removes the packs of @directory, because files were moved or copied
+ * into it and the thumbnails stored for their names may be outdated.
+ * May be called from any thread.
+ **/
+void
+thunar_thumbnail_pack_invalidate (GFile *directory)
+{
+  GFile *child;
+  gchar *directory_uri;
+  gchar *path;
+  gchar *uri;
+  gint   size;
+
+  _thunar_return_if_fail (G_IS_FILE (directory));
+
+  if (!g_file_is_native (directory))
+    return;
+
+  /* name the folder the way lookups derive it from their file URIs */
+  child = g_file_get_child (directory, "_");
+  uri = g_file_get_uri (child);
+  directory_uri = thunar_thumbnail_pack_get_directory_uri (uri);
+  g_object_unref (child);
+  g_free (uri);
+
+  G_LOCK (thunar_thumbnail_packs);
+
+  /* mass transfers invalidate the same folder over and over */
+  if (g_strcmp0 (directory_uri, thunar_thumbnail_packs_invalidated) != 0)
+    {
+      thunar_thumbnail_packs_serial++;
+      thunar_thumbnail_pack_forget (directory_uri);
+
+      for (size = 0; size < N_THUMBNAIL_SIZES; size++)
+        {
+          path = thunar_thumbnail_pack_get_path (directory_uri, size);
+          g_unlink (path);
+          g_free (path);
+        }
+
+      g_free (thunar_thumbnail_packs_invalidated);
+      thunar_thumbnail_packs_invalidated = g_steal_pointer (&directory_uri);
+    }
+
+  G_UNLOCK (thunar_thumbnail_packs);
+
+  g_free (directory_uri);
+}
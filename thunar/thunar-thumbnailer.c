@@ -23,6 +23,10 @@
 #include "config.h"
 #endif
 
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
 #include <libxfce4util/libxfce4util.h>
 
 #include "thunar/thunar-thumbnailer-proxy.h"
@@ -73,6 +77,30 @@
  * The Finished signal handler looks up the internal request ID based on
  * the D-Bus thumbnailer handle. It then drops all corresponding information
  * from handle_request_mapping and request_handle_mapping.
+ *
+ *
+ * Visibility
+ * ==========
+ *
+ * Only THUNAR_THUMBNAILER_MAX_RUNNING_JOBS requests are sent to tumbler at
+ * once, the other ones wait in jobs_waiting. The views tell which files they
+ * currently show with thunar_thumbnailer_set_visible_files(), waiting jobs
+ * with visible files are sent first, otherwise the most recent ones. Jobs
+ * without any visible files are dequeued, their files become _UNKNOWN again
+ * and are requested anew once they are drawn.
+ *
+ *
+ * Remote budgets
+ * ==============
+ *
+ * Tumbler reads the files of remote locations over the network, so each
+ * location, its scheme and host, gets a budget of bytes per minute within
+ * misc-thumbnail-remote-budget, lowered to a share of the throughput the
+ * requests for that location got so far. thunar_thumbnailer_apply_budget()
+ * sends the visible files first and among them the cheap ones, photos whose
+ * embedded thumbnail tumbler takes and small files. The files beyond the
+ * budget wait in deferred and become _UNKNOWN again once the budget refilled,
+ * so the ones still drawn are requested anew.
  */
 
 
@@ -96,6 +124,23 @@ typedef enum
 
 typedef struct _ThunarThumbnailerJob  ThunarThumbnailerJob;
 
+/* maximum number of requests handed to tumbler at the same time */
+#define THUNAR_THUMBNAILER_MAX_RUNNING_JOBS (2)
+
+/* the budget of a remote location is this share of its measured throughput,
+ * but not below the minimum, in bytes per minute */
+#define THUNAR_THUMBNAILER_REMOTE_SHARE      (0.25)
+#define THUNAR_THUMBNAILER_REMOTE_MIN_BUDGET (4.0 * 1024 * 1024)
+
+/* what tumbler reads of photos for the thumbnail embedded in their EXIF
+ * data, and of folders for their cover image, in bytes */
+#define THUNAR_THUMBNAILER_EMBEDDED_COST     (128 * 1024)
+
+/* deferred files are released to be requested again after at least
+ * and at most this long, in seconds */
+#define THUNAR_THUMBNAILER_DEFER_MIN_WAIT    (1)
+#define THUNAR_THUMBNAILER_DEFER_MAX_WAIT    (60)
+
 /* Signal identifiers */
 enum
 {
@@ -109,6 +154,7 @@ enum
   PROP_0,
   PROP_THUMBNAIL_SIZE,
   PROP_THUMBNAIL_MAX_FILE_SIZE,
+  PROP_THUMBNAIL_REMOTE_BUDGET,
 };
 
 
@@ -129,6 +175,7 @@ static void                   thunar_thumbnailer_thumbnailer_ready      (GDBusPr
                                                                          guint32                     handle,
                                                                          const gchar               **uris,
                                                                          ThunarThumbnailer          *thumbnailer);
+static void                   thunar_thumbnailer_send_waiting_jobs      (ThunarThumbnailer          *thumbnailer);
 static void                   thunar_thumbnailer_get_property           (GObject                    *object,
                                                                          guint                       prop_id,
                                                                          GValue                     *value,
@@ -160,6 +207,13 @@ struct _ThunarThumbnailer
   /* running jobs */
   GSList     *jobs;
 
+  /* jobs waiting for a running one to finish, the most recent first */
+  GQueue      jobs_waiting;
+
+  /* files shown by the views: owner -> GList of ThunarFile, and ThunarFile -> number of owners */
+  GHashTable *visible_owners;
+  GHashTable *visible_files;
+
   GMutex      lock;
 
   /* cached MIME types -> URI schemes for which thumbs can be generated */
@@ -179,8 +233,33 @@ struct _ThunarThumbnailer
 
   /* Id's of the timeout sources per size, used to agrregate requets */
   guint                 jobs_to_queue_source_id[N_THUMBNAIL_SIZES];
+
+  /* most MiB per minute fetched from a remote location, 0 for no limit */
+  guint                 remote_budget;
+
+  /* location key -> ThunarThumbnailerMount, see thunar_thumbnailer_apply_budget() */
+  GHashTable           *mounts;
+
+  /* files beyond the budget per size, and the source releasing them */
+  GList                *deferred[N_THUMBNAIL_SIZES];
+  guint                 deferred_source_id;
 };
 
+typedef struct
+{
+  gdouble tokens;      /* byte, negative after a file bigger than the rest of the budget */
+  gint64  refill_time; /* us */
+  gdouble rate;        /* byte/s, measured from the requests, 0 before the first */
+} ThunarThumbnailerMount;
+
+typedef struct
+{
+  ThunarFile *file;
+  gchar      *mount_key;
+  guint64     cost;
+  gboolean    visible;
+} ThunarThumbnailerCandidate;
+
 struct _ThunarThumbnailerJob
 {
   ThunarThumbnailer *thumbnailer;
@@ -188,6 +267,9 @@ struct _ThunarThumbnailerJob
   /* if this job is cancelled */
   guint              cancelled : 1;
 
+  /* if the Queue call was sent off */
+  guint              sent : 1;
+
   /* data is saved here in case the queueing is delayed */
   /* If this is NULL, the request has been sent off. */
   GList             *files; /* element type: ThunarFile */
@@ -200,6 +282,11 @@ struct _ThunarThumbnailerJob
 
   /* used to override the thumbnail size of ThunarThumbnailer */
   ThunarThumbnailSize thumbnail_size;
+
+  /* the remote location charged first, for measuring its throughput */
+  gchar             *mount_key;
+  guint64            mount_bytes;
+  gint64             sent_time;
 };
 
 static guint thumbnailer_signals[LAST_SIGNAL];
@@ -262,6 +349,19 @@ thunar_thumbnailer_class_init (ThunarThumbnailerClass *klass)
                                                         "thumbnail-max-file-size",
                                                         0, G_MAXUINT64, 0,
                                                         EXO_PARAM_READWRITE));
+
+  /**
+   * ThunarThumbnailer:thumbnail-remote-budget:
+   *
+   * Most MiB per minute fetched from a remote location, 0 for no limit
+   **/
+  g_object_class_install_property (gobject_class,
+                                   PROP_THUMBNAIL_REMOTE_BUDGET,
+                                   g_param_spec_uint ("thumbnail-remote-budget",
+                                                      "thumbnail-remote-budget",
+                                                      "thumbnail-remote-budget",
+                                                      0, G_MAXUINT, 64,
+                                                      EXO_PARAM_READWRITE));
 }
 
 
@@ -284,6 +384,10 @@ thunar_thumbnailer_get_property (GObject    *object,
       g_value_set_uint64 (value, thumbnailer->thumbnail_max_file_size);
       break;
 
+    case PROP_THUMBNAIL_REMOTE_BUDGET:
+      g_value_set_uint (value, thumbnailer->remote_budget);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -310,6 +414,10 @@ thunar_thumbnailer_set_property (GObject      *object,
       thumbnailer->thumbnail_max_file_size = g_value_get_uint64 (value);
       break;
 
+    case PROP_THUMBNAIL_REMOTE_BUDGET:
+      thumbnailer->remote_budget = g_value_get_uint (value);
+      break;
+
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -325,6 +433,7 @@ thunar_thumbnailer_free_job (ThunarThumbnailerJob *job)
   if (job->thumbnailer && job->thumbnailer->thumbnailer_proxy && job->handle)
     thunar_thumbnailer_dbus_call_dequeue (job->thumbnailer->thumbnailer_proxy, job->handle, NULL, NULL, NULL);
 
+  g_free (job->mount_key);
   g_slice_free (ThunarThumbnailerJob, job);
 }
 
@@ -339,6 +448,7 @@ thunar_thumbnailer_queue_async_reply (GObject      *proxy,
   ThunarThumbnailer    *thumbnailer;
   GError               *error = NULL;
   guint                 handle;
+  GList                *lp;
 
   _thunar_return_if_fail (THUNAR_IS_THUMBNAILER_DBUS (proxy));
   _thunar_return_if_fail (job != NULL);
@@ -375,8 +485,18 @@ thunar_thumbnailer_queue_async_reply (GObject      *proxy,
   else
     {
       g_warning ("ThunarThumbnailer: Queue failed: %s", error->message);
+
+      /* release its slot, the files won't get a thumbnail */
+      for (lp = job->files; lp != NULL; lp = lp->next)
+        thunar_file_update_thumbnail (lp->data, THUNAR_FILE_THUMB_STATE_NONE, job->thumbnail_size);
+      g_signal_emit (G_OBJECT (thumbnailer), thumbnailer_signals[REQUEST_FINISHED], 0, job->request);
+      thumbnailer->jobs = g_slist_remove (thumbnailer->jobs, job);
+      thunar_thumbnailer_free_job (job);
     }
 
+  /* a cancelled or failed job made room for the next request */
+  thunar_thumbnailer_send_waiting_jobs (thumbnailer);
+
   _thumbnailer_unlock (thumbnailer);
   g_clear_error (&error);
 
@@ -386,6 +506,265 @@ thunar_thumbnailer_queue_async_reply (GObject      *proxy,
 
 
 
+/* the remote location tumbler fetches @file from, its scheme and host */
+static gchar *
+thunar_thumbnailer_mount_key (ThunarFile *file)
+{
+  gchar *uri;
+  gchar *p;
+
+  uri = thunar_file_dup_uri (file);
+  p = strstr (uri, "://");
+  if (p != NULL && (p = strchr (p + 3, '/')) != NULL)
+    *p = '\0';
+
+  return uri;
+}
+
+
+
+/* the bytes tumbler probably reads of @file for a thumbnail of @size */
+static guint64
+thunar_thumbnailer_remote_cost (ThunarFile          *file,
+                                ThunarThumbnailSize  size)
+{
+  const gchar *content_type;
+  guint64      file_size;
+
+  if (thunar_file_is_directory (file))
+    return THUNAR_THUMBNAILER_EMBEDDED_COST;
+
+  file_size = thunar_file_get_size (file);
+
+  /* normal thumbnails of photos come from their EXIF data at the start of the file */
+  content_type = thunar_file_get_content_type (file);
+  if (size == THUNAR_THUMBNAIL_SIZE_NORMAL && content_type != NULL
+      && (strcmp (content_type, "image/jpeg") == 0 || strcmp (content_type, "image/tiff") == 0))
+    return MIN (file_size, THUNAR_THUMBNAILER_EMBEDDED_COST);
+
+  return file_size;
+}
+
+
+
+/* NOTE: assumes the lock is being held by the caller */
+static gdouble
+thunar_thumbnailer_mount_budget (ThunarThumbnailer      *thumbnailer,
+                                 ThunarThumbnailerMount *mount)
+{
+  gdouble budget;
+
+  /* bytes per minute, a slow location gets a share of what it delivers */
+  budget = thumbnailer->remote_budget * 1024.0 * 1024.0;
+  if (mount->rate > 0.0)
+    budget = MIN (budget, MAX (mount->rate * 60.0 * THUNAR_THUMBNAILER_REMOTE_SHARE, THUNAR_THUMBNAILER_REMOTE_MIN_BUDGET));
+
+  return budget;
+}
+
+
+
+/* NOTE: assumes the lock is being held by the caller */
+static ThunarThumbnailerMount *
+thunar_thumbnailer_get_mount (ThunarThumbnailer *thumbnailer,
+                              const gchar       *mount_key)
+{
+  ThunarThumbnailerMount *mount;
+  gdouble                 budget;
+  gint64                  now;
+
+  now = g_get_monotonic_time ();
+
+  mount = g_hash_table_lookup (thumbnailer->mounts, mount_key);
+  if (mount == NULL)
+    {
+      /* a new location starts with the full budget of a minute */
+      mount = g_new0 (ThunarThumbnailerMount, 1);
+      mount->tokens = thumbnailer->remote_budget * 1024.0 * 1024.0;
+      mount->refill_time = now;
+      g_hash_table_insert (thumbnailer->mounts, g_strdup (mount_key), mount);
+      return mount;
+    }
+
+  /* refill for the time since the last request, up to the budget of a minute */
+  budget = thunar_thumbnailer_mount_budget (thumbnailer, mount);
+  mount->tokens = MIN (mount->tokens + budget * (now - mount->refill_time) / (60.0 * G_USEC_PER_SEC), budget);
+  mount->refill_time = now;
+
+  return mount;
+}
+
+
+
+static gint
+thunar_thumbnailer_candidate_compare (gconstpointer a,
+                                      gconstpointer b)
+{
+  const ThunarThumbnailerCandidate *candidate_a = a;
+  const ThunarThumbnailerCandidate *candidate_b = b;
+
+  /* the visible files first, and among them the cheap ones */
+  if (candidate_a->visible != candidate_b->visible)
+    return candidate_a->visible ? -1 : 1;
+  if (candidate_a->cost != candidate_b->cost)
+    return candidate_a->cost < candidate_b->cost ? -1 : 1;
+  return 0;
+}
+
+
+
+/* NOTE: assumes the lock is being held by the caller */
+static void
+thunar_thumbnailer_measure_mount (ThunarThumbnailer    *thumbnailer,
+                                  ThunarThumbnailerJob *job)
+{
+  ThunarThumbnailerMount *mount;
+  gdouble                 seconds;
+  gdouble                 rate;
+
+  if (job->mount_key == NULL || job->mount_bytes == 0 || job->sent_time == 0)
+    return;
+
+  mount = g_hash_table_lookup (thumbnailer->mounts, job->mount_key);
+  if (mount == NULL)
+    return;
+
+  /* tumbler also spends time on decoding, so this is on the safe side */
+  seconds = MAX (g_get_monotonic_time () - job->sent_time, 1) / (gdouble) G_USEC_PER_SEC;
+  rate = job->mount_bytes / seconds;
+
+  if (mount->rate > 0.0)
+    mount->rate += 0.3 * (rate - mount->rate);
+  else
+    mount->rate = rate;
+}
+
+
+
+static gboolean
+thunar_thumbnailer_release_deferred (gpointer user_data)
+{
+  ThunarThumbnailer *thumbnailer = THUNAR_THUMBNAILER (user_data);
+  GList             *deferred;
+  GList             *lp;
+  gint               i;
+
+  _thumbnailer_lock (thumbnailer);
+
+  thumbnailer->deferred_source_id = 0;
+
+  /* the files still drawn are requested again, and charged again */
+  for (i = 0; i < N_THUMBNAIL_SIZES; i++)
+    {
+      deferred = g_steal_pointer (&thumbnailer->deferred[i]);
+      for (lp = deferred; lp != NULL; lp = lp->next)
+        thunar_file_update_thumbnail (lp->data, THUNAR_FILE_THUMB_STATE_UNKNOWN, i);
+      g_list_free_full (deferred, g_object_unref);
+    }
+
+  _thumbnailer_unlock (thumbnailer);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+/* NOTE: assumes the lock is being held by the caller. Charges the remote
+ * files among @files, which are sent for @job, to the budgets of their
+ * locations and returns the files to send now. The others wait in deferred */
+static GList *
+thunar_thumbnailer_apply_budget (ThunarThumbnailer   *thumbnailer,
+                                 ThunarThumbnailerJob *job,
+                                 GList               *files,
+                                 ThunarThumbnailSize  thumbnail_size)
+{
+  ThunarThumbnailerCandidate *candidate;
+  ThunarThumbnailerMount     *mount;
+  ThunarThumbnailerCandidate  new_candidate;
+  GArray                     *candidates;
+  GList                      *send_files = NULL;
+  GList                      *lp;
+  gdouble                     wait;
+  gdouble                     min_wait = THUNAR_THUMBNAILER_DEFER_MAX_WAIT;
+  gboolean                    deferred = FALSE;
+  gboolean                    all_visible;
+  guint                       n;
+
+  if (thumbnailer->remote_budget == 0)
+    return files;
+
+  all_visible = (g_hash_table_size (thumbnailer->visible_owners) == 0);
+  candidates = g_array_new (FALSE, FALSE, sizeof (ThunarThumbnailerCandidate));
+
+  /* local files are free */
+  for (lp = files; lp != NULL; lp = lp->next)
+    {
+      if (thunar_file_is_local (lp->data))
+        {
+          send_files = g_list_prepend (send_files, lp->data);
+          continue;
+        }
+
+      new_candidate.file = lp->data;
+      new_candidate.mount_key = thunar_thumbnailer_mount_key (lp->data);
+      new_candidate.cost = thunar_thumbnailer_remote_cost (lp->data, thumbnail_size);
+      new_candidate.visible = all_visible || g_hash_table_contains (thumbnailer->visible_files, lp->data);
+      g_array_append_val (candidates, new_candidate);
+    }
+  g_list_free (files);
+
+  g_array_sort (candidates, thunar_thumbnailer_candidate_compare);
+
+  for (n = 0; n < candidates->len; n++)
+    {
+      candidate = &g_array_index (candidates, ThunarThumbnailerCandidate, n);
+      mount = thunar_thumbnailer_get_mount (thumbnailer, candidate->mount_key);
+
+      /* a file bigger than what is left is sent while anything is, the debt comes off the next minute */
+      if (mount->tokens > 0.0)
+        {
+          mount->tokens -= candidate->cost;
+          send_files = g_list_prepend (send_files, candidate->file);
+
+          if (job->mount_key == NULL)
+            job->mount_key = g_strdup (candidate->mount_key);
+          if (strcmp (job->mount_key, candidate->mount_key) == 0)
+            job->mount_bytes += candidate->cost;
+        }
+      else
+        {
+          /* the file keeps loading until the budget refilled, outside of the job */
+          thumbnailer->deferred[thumbnail_size] = g_list_prepend (thumbnailer->deferred[thumbnail_size], candidate->file);
+          deferred = TRUE;
+
+          lp = g_list_find (job->files, candidate->file);
+          if (lp != NULL)
+            {
+              g_object_unref (lp->data);
+              job->files = g_list_delete_link (job->files, lp);
+            }
+
+          wait = (1.0 - mount->tokens) * 60.0 / thunar_thumbnailer_mount_budget (thumbnailer, mount);
+          min_wait = MIN (min_wait, wait);
+        }
+
+      g_free (candidate->mount_key);
+    }
+
+  g_array_free (candidates, TRUE);
+
+  if (deferred && thumbnailer->deferred_source_id == 0)
+    {
+      thumbnailer->deferred_source_id =
+        g_timeout_add_seconds (CLAMP ((guint) min_wait, THUNAR_THUMBNAILER_DEFER_MIN_WAIT, THUNAR_THUMBNAILER_DEFER_MAX_WAIT),
+                               thunar_thumbnailer_release_deferred, thumbnailer);
+    }
+
+  return g_list_reverse (send_files);
+}
+
+
+
 /* NOTE: assumes that the lock is held by the caller */
 static gboolean
 thunar_thumbnailer_begin_job (ThunarThumbnailer *thumbnailer,
@@ -464,6 +843,10 @@ thunar_thumbnailer_begin_job (ThunarThumbnailer *thumbnailer,
         }
     }
 
+  /* remote files within the budgets of their locations */
+  supported_files = thunar_thumbnailer_apply_budget (thumbnailer, job, g_list_reverse (supported_files), thumbnail_size);
+  n_items = g_list_length (supported_files);
+
   /* check if we have any supported files */
   if (n_items > 0)
     {
@@ -485,6 +868,8 @@ thunar_thumbnailer_begin_job (ThunarThumbnailer *thumbnailer,
 
       /* increase the reference count while the dbus call is running */
       g_object_ref (thumbnailer);
+      job->sent = TRUE;
+      job->sent_time = g_get_monotonic_time ();
 
       /* queue the request - asynchronously, of course */
       thunar_thumbnailer_dbus_call_queue (thumbnailer->thumbnailer_proxy,
@@ -537,11 +922,24 @@ thunar_thumbnailer_init (ThunarThumbnailer *thumbnailer)
       thumbnailer->jobs_to_queue_source_id[i] = 0;
     }
 
+  g_queue_init (&thumbnailer->jobs_waiting);
+  thumbnailer->visible_owners = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, (GDestroyNotify) thunar_g_list_free_full);
+  thumbnailer->visible_files = g_hash_table_new_full (g_direct_hash, g_direct_equal, g_object_unref, NULL);
+
+  thumbnailer->remote_budget = 64;
+  thumbnailer->mounts = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
   g_object_bind_property (G_OBJECT (thumbnailer->preferences),
                           "misc-thumbnail-max-file-size",
                           G_OBJECT (thumbnailer),
                           "thumbnail-max-file-size",
                           G_BINDING_SYNC_CREATE);
+
+  g_object_bind_property (G_OBJECT (thumbnailer->preferences),
+                          "misc-thumbnail-remote-budget",
+                          G_OBJECT (thumbnailer),
+                          "thumbnail-remote-budget",
+                          G_BINDING_SYNC_CREATE);
 }
 
 
@@ -573,6 +971,16 @@ thunar_thumbnailer_finalize (GObject *object)
 
   /* remove all jobs */
   g_slist_free_full (thumbnailer->jobs, (GDestroyNotify)thunar_thumbnailer_free_job);
+  g_queue_clear_full (&thumbnailer->jobs_waiting, (GDestroyNotify)thunar_thumbnailer_free_job);
+
+  g_hash_table_destroy (thumbnailer->visible_owners);
+  g_hash_table_destroy (thumbnailer->visible_files);
+
+  if (thumbnailer->deferred_source_id != 0)
+    g_source_remove (thumbnailer->deferred_source_id);
+  for (gint i = 0; i < N_THUMBNAIL_SIZES; i++)
+    g_list_free_full (thumbnailer->deferred[i], g_object_unref);
+  g_hash_table_destroy (thumbnailer->mounts);
 
   /* release the thumbnailer proxy */
   if (thumbnailer->thumbnailer_proxy != NULL)
@@ -713,6 +1121,7 @@ thunar_thumbnailer_received_supported_types (ThunarThumbnailerDBus  *proxy,
         }
     }
   thumbnailer->jobs = g_slist_remove_all (thumbnailer->jobs, NULL);
+  thunar_thumbnailer_send_waiting_jobs (thumbnailer);
 
   g_clear_error (&error);
 
@@ -972,6 +1381,9 @@ thunar_thumbnailer_thumbnailer_finished (GDBusProxy        *proxy,
           /* this job is finished, forget about the handle */
           job->handle = 0;
 
+          /* the throughput of the location lowers its budget */
+          thunar_thumbnailer_measure_mount (thumbnailer, job);
+
           /* tell everybody we're done here */
           g_signal_emit (G_OBJECT (thumbnailer), thumbnailer_signals[REQUEST_FINISHED], 0, job->request);
 
@@ -983,11 +1395,103 @@ thunar_thumbnailer_thumbnailer_finished (GDBusProxy        *proxy,
         }
     }
 
+  /* there is room for the next request now */
+  thunar_thumbnailer_send_waiting_jobs (thumbnailer);
+
   _thumbnailer_unlock (thumbnailer);
 }
 
 
 
+/* NOTE: assumes the lock is being held by the caller */
+static gboolean
+thunar_thumbnailer_job_is_visible (ThunarThumbnailer    *thumbnailer,
+                                   ThunarThumbnailerJob *job)
+{
+  GList *lp;
+
+  /* without any view telling what it shows, everything counts as visible */
+  if (g_hash_table_size (thumbnailer->visible_owners) == 0)
+    return TRUE;
+
+  for (lp = job->files; lp != NULL; lp = lp->next)
+    if (g_hash_table_contains (thumbnailer->visible_files, lp->data))
+      return TRUE;
+
+  return FALSE;
+}
+
+
+
+/* NOTE: assumes the lock is being held by the caller */
+static void
+thunar_thumbnailer_send_waiting_jobs (ThunarThumbnailer *thumbnailer)
+{
+  ThunarThumbnailerJob *job;
+  GList                *lp;
+
+  while (g_slist_length (thumbnailer->jobs) < THUNAR_THUMBNAILER_MAX_RUNNING_JOBS
+         && !g_queue_is_empty (&thumbnailer->jobs_waiting))
+    {
+      /* prefer the most recent job with visible files */
+      for (lp = thumbnailer->jobs_waiting.head; lp != NULL; lp = lp->next)
+        if (thunar_thumbnailer_job_is_visible (thumbnailer, lp->data))
+          break;
+
+      if (lp == NULL)
+        lp = thumbnailer->jobs_waiting.head;
+
+      job = lp->data;
+      g_queue_delete_link (&thumbnailer->jobs_waiting, lp);
+
+      if (thunar_thumbnailer_begin_job (thumbnailer, job))
+        {
+          thumbnailer->jobs = g_slist_prepend (thumbnailer->jobs, job);
+          continue;
+        }
+
+      for (lp = job->files; lp != NULL; lp = lp->next)
+        {
+          /* This job failed .. inform all files which are waiting for the result */
+          thunar_file_update_thumbnail (lp->data, THUNAR_FILE_THUMB_STATE_NONE, job->thumbnail_size);
+        }
+
+      /* tell everybody we're done for that job */
+      g_signal_emit (G_OBJECT (thumbnailer), thumbnailer_signals[REQUEST_FINISHED], 0, job->request);
+
+      /* and drop it */
+      thunar_thumbnailer_free_job (job);
+    }
+}
+
+
+
+/* NOTE: assumes the lock is being held by the caller */
+static void
+thunar_thumbnailer_drop_job (ThunarThumbnailer    *thumbnailer,
+                             ThunarThumbnailerJob *job)
+{
+  GList *lp;
+
+  /* forget the request, so the files are requested again once they are drawn */
+  g_signal_emit (G_OBJECT (thumbnailer), thumbnailer_signals[REQUEST_FINISHED], 0, job->request);
+  for (lp = job->files; lp != NULL; lp = lp->next)
+    thunar_file_update_thumbnail (lp->data, THUNAR_FILE_THUMB_STATE_UNKNOWN, job->thumbnail_size);
+
+  if (job->sent && job->handle == 0)
+    {
+      /* the reply to the Queue call dequeues and releases it */
+      job->cancelled = TRUE;
+      return;
+    }
+
+  /* dequeues it from tumbler if it was sent */
+  thumbnailer->jobs = g_slist_remove (thumbnailer->jobs, job);
+  thunar_thumbnailer_free_job (job);
+}
+
+
+
 /**
  * thunar_thumbnailer_get:
  *
@@ -1021,32 +1525,15 @@ thunar_thumbnailer_queue_job_after_timeout (gpointer user_data)
   ThunarThumbnailerJob *job = user_data;
   ThunarThumbnailer    *thumbnailer = THUNAR_THUMBNAILER (job->thumbnailer);
   ThunarThumbnailSize   thumbnail_size = job->thumbnail_size;
-  gboolean              success = FALSE;
 
   _thunar_return_val_if_fail (THUNAR_IS_THUMBNAILER (thumbnailer), G_SOURCE_REMOVE);
 
   /* acquire the thumbnailer lock */
   _thumbnailer_lock (thumbnailer);
 
-  success = thunar_thumbnailer_begin_job (thumbnailer, job);
-  if (success)
-    {
-      thumbnailer->jobs = g_slist_prepend (thumbnailer->jobs, job);
-    }
-  else
-    {
-      for (GList* lp = job->files; lp != NULL; lp = lp->next)
-        {
-          /* This job failed .. inform all files which are waiting for the result */
-          thunar_file_update_thumbnail (lp->data, THUNAR_FILE_THUMB_STATE_NONE, job->thumbnail_size);
-        }
-
-      /* tell everybody we're done for that job */
-      g_signal_emit (G_OBJECT (thumbnailer), thumbnailer_signals[REQUEST_FINISHED], 0, job->request);
-
-      /* and drop it */
-      thunar_thumbnailer_free_job (job);
-    }
+  /* the files of the most recent request were just drawn, so they come first */
+  g_queue_push_head (&thumbnailer->jobs_waiting, job);
+  thunar_thumbnailer_send_waiting_jobs (thumbnailer);
 
   thumbnailer->jobs_to_queue[thumbnail_size] = NULL;
   thumbnailer->jobs_to_queue_source_id[thumbnail_size] = 0;
@@ -1114,6 +1601,7 @@ thunar_thumbnailer_dequeue (ThunarThumbnailer *thumbnailer,
 {
   ThunarThumbnailerJob *job;
   GSList               *lp;
+  GList                *wp;
 
   _thunar_return_if_fail (THUNAR_IS_THUMBNAILER (thumbnailer));
 
@@ -1142,6 +1630,154 @@ thunar_thumbnailer_dequeue (ThunarThumbnailer *thumbnailer,
         }
     }
 
+  /* the request may not have been sent yet */
+  for (wp = thumbnailer->jobs_waiting.head; lp == NULL && wp != NULL; wp = wp->next)
+    {
+      job = wp->data;
+      if (job->request == request)
+        {
+          g_queue_delete_link (&thumbnailer->jobs_waiting, wp);
+          thunar_thumbnailer_free_job (job);
+          break;
+        }
+    }
+
+  thunar_thumbnailer_send_waiting_jobs (thumbnailer);
+
   /* release the thumbnailer lock */
   _thumbnailer_unlock (thumbnailer);
 }
+
+
+
+/**
+ * thunar_thumbnailer_set_visible_files:
+ * @thumbnailer : a #ThunarThumbnailer.
+ * @owner       : the view showing @files.
+ * @files       : the #GList of #ThunarFile<!---->s @owner currently shows,
+ *                or %NULL if it shows none, e.g. because it is destroyed.
+ *
+ * Replaces the files shown by @owner. Pending thumbnail requests for files
+ * which no view shows any longer are dropped, and requests for shown files
+ * are sent to the thumbnailer first.
+ **/
+void
+thunar_thumbnailer_set_visible_files (ThunarThumbnailer *thumbnailer,
+                                      gpointer           owner,
+                                      GList             *files)
+{
+  ThunarThumbnailerJob *job;
+  GSList               *jobs;
+  GSList               *sp;
+  GList                *old_files;
+  GList                *lp;
+  GList                *ln;
+  guint                 n_owners;
+
+  _thunar_return_if_fail (THUNAR_IS_THUMBNAILER (thumbnailer));
+  _thunar_return_if_fail (owner != NULL);
+
+  _thumbnailer_lock (thumbnailer);
+
+  /* release the files shown before */
+  old_files = g_hash_table_lookup (thumbnailer->visible_owners, owner);
+  for (lp = old_files; lp != NULL; lp = lp->next)
+    {
+      n_owners = GPOINTER_TO_UINT (g_hash_table_lookup (thumbnailer->visible_files, lp->data));
+      if (n_owners > 1)
+        g_hash_table_insert (thumbnailer->visible_files, g_object_ref (lp->data), GUINT_TO_POINTER (n_owners - 1));
+      else
+        g_hash_table_remove (thumbnailer->visible_files, lp->data);
+    }
+
+  if (files != NULL)
+    {
+      g_hash_table_insert (thumbnailer->visible_owners, owner, thunar_g_list_copy_deep (files));
+      for (lp = files; lp != NULL; lp = lp->next)
+        {
+          n_owners = GPOINTER_TO_UINT (g_hash_table_lookup (thumbnailer->visible_files, lp->data));
+          g_hash_table_insert (thumbnailer->visible_files, g_object_ref (lp->data), GUINT_TO_POINTER (n_owners + 1));
+        }
+    }
+  else
+    {
+      g_hash_table_remove (thumbnailer->visible_owners, owner);
+    }
+
+  /* drop the jobs which became useless, running ones are dequeued from tumbler */
+  for (lp = thumbnailer->jobs_waiting.head; lp != NULL; lp = ln)
+    {
+      ln = lp->next;
+      job = lp->data;
+      if (thunar_thumbnailer_job_is_visible (thumbnailer, job))
+        continue;
+
+      g_queue_delete_link (&thumbnailer->jobs_waiting, lp);
+      thunar_thumbnailer_drop_job (thumbnailer, job);
+    }
+
+  jobs = g_slist_copy (thumbnailer->jobs);
+  for (sp = jobs; sp != NULL; sp = sp->next)
+    {
+      job = sp->data;
+      if (!job->cancelled && !thunar_thumbnailer_job_is_visible (thumbnailer, job))
+        thunar_thumbnailer_drop_job (thumbnailer, job);
+    }
+  g_slist_free (jobs);
+
+  thunar_thumbnailer_send_waiting_jobs (thumbnailer);
+
+  _thumbnailer_unlock (thumbnailer);
+}
+
+
+
+static void
+thunar_thumbnailer_count_job (ThunarThumbnailer    *thumbnailer,
+                              ThunarThumbnailerJob *job,
+                              guint                *n_files)
+{
+  ThunarThumbnailSize thumbnail_size;
+
+  if (job == NULL || job->cancelled)
+    return;
+
+  thumbnail_size = job->thumbnail_size == THUNAR_THUMBNAIL_SIZE_DEFAULT ? thumbnailer->thumbnail_size : job->thumbnail_size;
+  n_files[thumbnail_size] += g_list_length (job->files);
+}
+
+
+
+/**
+ * thunar_thumbnailer_get_pending:
+ * @thumbnailer : a #ThunarThumbnailer.
+ * @n_files     : return location for the number of files per
+ *                #ThunarThumbnailSize.
+ *
+ * Counts the files of the thumbnail requests which are running, waiting
+ * or about to be queued, per thumbnail size.
+ **/
+void
+thunar_thumbnailer_get_pending (ThunarThumbnailer *thumbnailer,
+                                guint              n_files[N_THUMBNAIL_SIZES])
+{
+  GSList *sp;
+  GList  *lp;
+  guint   i;
+
+  _thunar_return_if_fail (THUNAR_IS_THUMBNAILER (thumbnailer));
+
+  for (i = 0; i < N_THUMBNAIL_SIZES; i++)
+    n_files[i] = 0;
+
+  _thumbnailer_lock (thumbnailer);
+
+  for (sp = thumbnailer->jobs; sp != NULL; sp = sp->next)
+    thunar_thumbnailer_count_job (thumbnailer, sp->data, n_files);
+  for (lp = thumbnailer->jobs_waiting.head; lp != NULL; lp = lp->next)
+    thunar_thumbnailer_count_job (thumbnailer, lp->data, n_files);
+  for (i = 0; i < N_THUMBNAIL_SIZES; i++)
+    thunar_thumbnailer_count_job (thumbnailer, thumbnailer->jobs_to_queue[i], n_files);
+
+  _thumbnailer_unlock (thumbnailer);
+}
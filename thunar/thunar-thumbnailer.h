@@ -35,16 +35,21 @@ typedef struct _ThunarThumbnailer      ThunarThumbnailer;
 #define THUNAR_IS_THUMBNAILER_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), THUNAR_TYPE_THUMBNAILER))
 #define THUNAR_THUMBNAILER_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), THUNAR_TYPE_THUMBNAILER, ThunarThumbnailerClass))
 
-GType              thunar_thumbnailer_get_type        (void) G_GNUC_CONST;
-
-ThunarThumbnailer *thunar_thumbnailer_get             (void) G_GNUC_MALLOC;
-
-void               thunar_thumbnailer_queue_file      (ThunarThumbnailer        *thumbnailer,
-                                                       ThunarFile               *file,
-                                                       guint                    *request,
-                                                       ThunarThumbnailSize       size);
-void               thunar_thumbnailer_dequeue         (ThunarThumbnailer        *thumbnailer,
-                                                       guint                     request);
+GType              thunar_thumbnailer_get_type          (void) G_GNUC_CONST;
+
+ThunarThumbnailer *thunar_thumbnailer_get               (void) G_GNUC_MALLOC;
+
+void               thunar_thumbnailer_queue_file        (ThunarThumbnailer        *thumbnailer,
+                                                         ThunarFile               *file,
+                                                         guint                    *request,
+                                                         ThunarThumbnailSize       size);
+void               thunar_thumbnailer_dequeue           (ThunarThumbnailer        *thumbnailer,
+                                                         guint                     request);
+void               thunar_thumbnailer_set_visible_files (ThunarThumbnailer        *thumbnailer,
+                                                         gpointer                  owner,
+                                                         GList                    *files);
+void               thunar_thumbnailer_get_pending       (ThunarThumbnailer        *thumbnailer,
+                                                         guint                     n_files[N_THUMBNAIL_SIZES]);
 
 G_END_DECLS
 
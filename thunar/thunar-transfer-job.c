@@ -23,24 +23,120 @@
 #include "config.h"
 #endif
 
+#ifdef HAVE_SYS_TYPES_H
+#include <sys/types.h>
+#endif
+#ifdef HAVE_SYS_STAT_H
+#include <sys/stat.h>
+#endif
+#ifdef HAVE_SYS_SYSMACROS_H
+#include <sys/sysmacros.h>
+#endif
+#ifdef HAVE_DIRENT_H
+#include <dirent.h>
+#endif
+#ifdef HAVE_ERRNO_H
+#include <errno.h>
+#endif
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+#if defined (HAVE_LINUX) && defined (HAVE_SYS_SYSCALL_H)
+#include <sys/syscall.h>
+#endif
+
 #include <gio/gio.h>
 
 #include "thunar/thunar-application.h"
+#include "thunar/thunar-enum-types.h"
+#include "thunar/thunar-folder.h"
 #include "thunar/thunar-gio-extensions.h"
 #include "thunar/thunar-io-scan-directory.h"
 #include "thunar/thunar-io-jobs-util.h"
+#include "thunar/thunar-io-trash.h"
 #include "thunar/thunar-job.h"
 #include "thunar/thunar-job-operation-history.h"
-#include "thunar/thunar-preferences.h"
 #include "thunar/thunar-private.h"
 #include "thunar/thunar-thumbnail-cache.h"
 #include "thunar/thunar-transfer-job.h"
+#include "thunar/thunar-transfer-journal.h"
 
 
 
 /* seconds before we show the transfer rate + remaining time */
 #define MINIMUM_TRANSFER_TIME (2 * G_USEC_PER_SEC) /* 2 seconds */
 
+/* the rates are sampled over windows of fixed length and smoothed with an
+ * exponentially weighted moving average with this time constant */
+#define RATE_SAMPLE_INTERVAL     (G_USEC_PER_SEC)      /* 1 second */
+#define RATE_TIME_CONSTANT       5.0                   /* seconds */
+
+/* interval of the percent signals, which block the job until the main loop
+ * handled them, and the minimum interval when a big file was finished */
+#define PROGRESS_INTERVAL        (G_USEC_PER_SEC / 2)  /* 500ms */
+#define PROGRESS_MIN_INTERVAL    (G_USEC_PER_SEC / 10) /* 100ms */
+
+/* regular files up to this size are copied by a pool of threads, since their
+ * transfer is dominated by the latency of the file system operations */
+#define SMALL_FILE_SIZE          (128 * 1024) /* bytes */
+#define SMALL_FILE_THREADS       8
+#define SMALL_FILE_PIPELINE_SIZE 64           /* maximum number of files in flight */
+
+/* copied files are verified against the checksum of their source computed
+ * during the copy, by reading them again while the next files are copied */
+#define VERIFY_CHECKSUM_TYPE     G_CHECKSUM_MD5
+#define VERIFY_THREADS           2
+#define VERIFY_PENDING_SIZE      16           /* maximum number of files being verified */
+
+/* FAT file systems, common on camera cards, store modification times in
+ * steps of two seconds, so identical files may differ by that much */
+#define IDENTICAL_MTIME_TOLERANCE 2           /* seconds */
+
+/* copied files of at least this size are checked for holes, which count
+ * for the progress but are not written, see thunar_g_file_copy() */
+#define SPARSE_FILE_MIN_SIZE     (1024 * 1024) /* bytes */
+
+#if defined (HAVE_DIRENT_H) && defined (HAVE_FCNTL_H) && defined (HAVE_FDOPENDIR) && defined (HAVE_FSTATAT)
+/* local folders are collected by stat()ing their entries from this many threads */
+#define COLLECT_NATIVE           1
+#define COLLECT_THREADS          4
+#endif
+
+#if defined (HAVE_FCNTL_H) && defined (HAVE_FSTATAT) && defined (HAVE_RENAMEAT) && defined (HAVE_UNLINKAT)
+/* the items of the home trash are restored by renaming them back */
+#define UNTRASH_NATIVE           1
+#define UNTRASH_INFO_MAX_SIZE    (16 * 1024) /* bytes */
+#endif
+
+/* copies of at least this size keep a journal to be resumed after a crash */
+#define JOURNAL_MIN_SIZE         (G_GUINT64_CONSTANT (1) << 30) /* bytes */
+
+/* copies running into at least this number of conflicts ask once for all of them */
+#define BATCH_CONFLICTS_MIN      2
+
+/* number of jobs which may transfer from or to the same solid state device at
+ * once, rotational and remote devices only take one job to avoid seek storms */
+#define SOLID_STATE_DEVICE_JOBS  4
+
+/* a bandwidth limited job may transfer this much ahead of its rate after
+ * a pause, and sleeps its debt away in steps of at most this length */
+#define BANDWIDTH_BURST          0.5                   /* seconds */
+#define BANDWIDTH_SLEEP_STEP     (G_USEC_PER_SEC / 10) /* 100ms */
+
+#if defined (HAVE_LINUX) && defined (HAVE_SYS_SYSCALL_H) && defined (SYS_ioprio_set) && defined (SYS_ioprio_get)
+/* the IO priority is set for the copying threads, see ioprio_set(2) */
+#define TRANSFER_IOPRIO             1
+#define TRANSFER_IOPRIO_WHO_PROCESS 1
+#define TRANSFER_IOPRIO_CLASS_SHIFT 13
+#define TRANSFER_IOPRIO_CLASS_IDLE  3
+#endif
+
 
 
 /* Property identifiers */
@@ -51,11 +147,19 @@ enum
   PROP_PARALLEL_COPY_MODE,
   PROP_TRANSFER_USE_PARTIAL,
   PROP_TRANSFER_VERIFY_FILE,
+  PROP_IO_CLASS,
+  PROP_BANDWIDTH_LIMIT,
+  PROP_TRANSFER_SKIP_IDENTICAL,
 };
 
 
 
 typedef struct _ThunarTransferNode ThunarTransferNode;
+typedef struct _ThunarTransferTask ThunarTransferTask;
+typedef struct _ThunarTransferVerification ThunarTransferVerification;
+typedef struct _ThunarTransferCollect ThunarTransferCollect;
+typedef struct _ThunarTransferPart ThunarTransferPart;
+typedef struct _ThunarTransferUntrash ThunarTransferUntrash;
 
 
 
@@ -72,7 +176,13 @@ static void     thunar_transfer_job_set_property (GObject      *object,
 static void     thunar_transfer_job_finalize     (GObject                *object);
 static gboolean thunar_transfer_job_execute      (ExoJob                 *job,
                                                   GError                **error);
+static gboolean thunar_transfer_job_transfer     (ExoJob                 *job,
+                                                  GError                **error);
 static void     thunar_transfer_node_free        (gpointer                data);
+static void     thunar_transfer_verification_free (gpointer               data);
+static void     thunar_transfer_part_free        (gpointer                data);
+static guint64  thunar_transfer_node_get_size    (ThunarTransferNode     *node);
+static guint64  thunar_transfer_node_get_n_files (ThunarTransferNode     *node);
 
 
 
@@ -89,24 +199,67 @@ struct _ThunarTransferJob
   GList                  *source_node_list;
   gchar                  *source_device_fs_id;
   gboolean                is_source_device_local;
+  guint                   source_device_max_jobs;
   GList                  *target_file_list;
   gchar                  *target_device_fs_id;
   gboolean                is_target_device_local;
+  guint                   target_device_max_jobs;
+  gboolean                device_info_filled;
 
   gint64                  start_time;              /* us(microseconds) */
   gint64                  last_update_time;        /* us */
+  gint64                  last_sample_time;        /* us */
   guint64                 last_total_progress;     /* byte */
+  guint64                 last_n_completed_files;
 
   guint64                 total_size;              /* byte */
   guint64                 total_progress;          /* byte */
   guint64                 file_progress;           /* byte */
   guint64                 transfer_rate;           /* byte/s */
+  guint64                 n_total_files;
+  guint64                 n_completed_files;
+  gdouble                 files_rate;              /* files/s */
+  guint64                 identical_size;          /* byte, skipped as identical */
+  guint64                 hole_size;               /* byte, holes of sparse files */
 
-  ThunarPreferences      *preferences;
+  GObject                *preferences;
   gboolean                file_size_binary;
   ThunarParallelCopyMode  parallel_copy_mode;
   ThunarUsePartialMode    transfer_use_partial;
   ThunarVerifyFileMode    transfer_verify_file;
+  ThunarTransferIoClass   io_class;
+  guint                   bandwidth_limit;         /* KiB/s, 0 for none */
+  ThunarSkipIdenticalMode transfer_skip_identical;
+
+  /* token bucket of the bandwidth limit, see thunar_transfer_job_throttle() */
+  gdouble                 bandwidth_tokens;        /* byte */
+  gint64                  bandwidth_time;          /* us, 0 while not limited */
+
+  /* IO priority of the job thread, see thunar_transfer_job_apply_io_class() */
+  ThunarTransferIoClass   io_class_applied;
+  gint                    io_prio_saved;
+
+  /* pool copying small files, see thunar_transfer_job_pipeline_push() */
+  GThreadPool            *pipeline_pool;
+  GMutex                  pipeline_mutex;
+  GCond                   pipeline_cond;
+
+  /* pool reading back copied files, see thunar_transfer_job_verify_push() */
+  GThreadPool            *verify_pool;
+  GQueue                  verify_queue;
+
+  /* latencies of the copy in ttj_copy_file(), see thunar_transfer_job_progress() */
+  gint64                  copy_start_time;         /* us, 0 while not copying */
+  gint64                  copy_data_time;          /* us, the last data written */
+  gboolean                copy_has_data;
+
+  /* progress record of big copies, and the target being copied */
+  ThunarTransferJournal  *journal;
+  GFile                  *journal_target;
+
+  /* copies merged into this one, see thunar_transfer_job_merge() */
+  GList                  *parts;
+  guint                   current_part;            /* 0 for the own files */
 };
 
 struct _ThunarTransferNode
@@ -116,6 +269,72 @@ struct _ThunarTransferNode
   GFile              *source_file;
   gboolean            replace_confirmed;
   gboolean            rename_confirmed;
+
+  /* the merged copy of a toplevel node, %NULL for the files of the job itself */
+  ThunarTransferPart *part;
+
+  /* determined by thunar_transfer_job_collect_node() */
+  GFileType           type;
+  guint64             size;
+};
+
+struct _ThunarTransferTask
+{
+  ThunarTransferNode *node;
+  GFile              *target_file;
+  gboolean            use_partial;
+
+  /* latencies of the copy, only used by the pool thread */
+  ThunarJob          *job;
+  gint64              start_time;  /* us */
+  gint64              data_time;   /* us, the last data written, 0 before */
+
+  /* set by the pool thread, protected by the pipeline mutex */
+  GError             *error;
+  gboolean            done;
+};
+
+struct _ThunarTransferCollect
+{
+  ThunarTransferJob  *job;
+  GThreadPool        *pool;
+
+  /* protected by the mutex */
+  GMutex              mutex;
+  GCond               cond;
+  guint               n_pending;    /* folders queued or being scanned */
+  guint64             total_size;
+  guint64             n_files;
+  GError             *error;
+};
+
+struct _ThunarTransferPart
+{
+  ThunarTransferJob  *job;          /* the merged job, which is not launched itself */
+  guint               index;        /* 1 for the first merged job */
+  ThunarJobOperation *operation;    /* the undo record of the merged job */
+  GList              *new_files;
+};
+
+struct _ThunarTransferUntrash
+{
+  GList              *sp;           /* the link of the node in source_node_list */
+  GList              *tp;           /* the link of the target in target_file_list */
+  gchar              *name;         /* in the files folder of the home trash */
+};
+
+struct _ThunarTransferVerification
+{
+  GFile              *source_file;
+  GFile              *target_file;
+  gchar              *checksum;
+  gboolean            use_partial;
+  guint64             size;        /* byte, read back by the pool thread */
+
+  /* set by the pool thread, protected by the pipeline mutex */
+  gchar              *target_checksum;
+  GError             *error;
+  gboolean            done;
 };
 
 
@@ -193,6 +412,50 @@ thunar_transfer_job_class_init (ThunarTransferJobClass *klass)
                                                       THUNAR_TYPE_VERIFY_FILE_MODE,
                                                       THUNAR_VERIFY_FILE_MODE_DISABLED,
                                                       EXO_PARAM_READWRITE));
+
+  /**
+   * ThunarTransferJob:io-class:
+   *
+   * The IO priority of the threads copying the files, which
+   * may change while the job is running.
+   **/
+  g_object_class_install_property (gobject_class,
+                                   PROP_IO_CLASS,
+                                   g_param_spec_enum ("io-class",
+                                                      "IoClass",
+                                                      NULL,
+                                                      THUNAR_TYPE_TRANSFER_IO_CLASS,
+                                                      THUNAR_TRANSFER_IO_CLASS_NORMAL,
+                                                      EXO_PARAM_READWRITE));
+
+  /**
+   * ThunarTransferJob:bandwidth-limit:
+   *
+   * The maximum transfer rate of the job in KiB per second,
+   * 0 for no limit.
+   **/
+  g_object_class_install_property (gobject_class,
+                                   PROP_BANDWIDTH_LIMIT,
+                                   g_param_spec_uint ("bandwidth-limit",
+                                                      "BandwidthLimit",
+                                                      NULL,
+                                                      0u, G_MAXUINT, 0u,
+                                                      EXO_PARAM_READWRITE));
+
+  /**
+   * ThunarTransferJob:transfer-skip-identical:
+   *
+   * Whether to skip existing targets which are identical to their
+   * source, instead of asking to replace them.
+   **/
+  g_object_class_install_property (gobject_class,
+                                   PROP_TRANSFER_SKIP_IDENTICAL,
+                                   g_param_spec_enum ("transfer-skip-identical",
+                                                      "TransferSkipIdentical",
+                                                      NULL,
+                                                      THUNAR_TYPE_SKIP_IDENTICAL_MODE,
+                                                      THUNAR_SKIP_IDENTICAL_MODE_DISABLED,
+                                                      EXO_PARAM_READWRITE));
 }
 
 
@@ -200,34 +463,58 @@ thunar_transfer_job_class_init (ThunarTransferJobClass *klass)
 static void
 thunar_transfer_job_init (ThunarTransferJob *job)
 {
-  job->preferences = thunar_preferences_get ();
-  g_object_bind_property (job->preferences, "misc-file-size-binary",
-                          job,              "file-size-binary",
-                          G_BINDING_SYNC_CREATE);
-  g_object_bind_property (job->preferences, "misc-parallel-copy-mode",
-                          job,              "parallel-copy-mode",
-                          G_BINDING_SYNC_CREATE);
-  g_object_bind_property (job->preferences, "misc-transfer-use-partial",
-                          job,              "transfer-use-partial",
-                          G_BINDING_SYNC_CREATE);
-  g_object_bind_property (job->preferences, "misc-transfer-verify-file",
-                          job,              "transfer-verify-file",
-                          G_BINDING_SYNC_CREATE);
+  /* the defaults of the properties, until preferences are bound */
+  job->preferences = NULL;
+  job->file_size_binary = TRUE;
+  job->parallel_copy_mode = THUNAR_PARALLEL_COPY_MODE_ONLY_LOCAL;
+  job->transfer_use_partial = THUNAR_USE_PARTIAL_MODE_DISABLED;
+  job->transfer_verify_file = THUNAR_VERIFY_FILE_MODE_DISABLED;
+  job->io_class = THUNAR_TRANSFER_IO_CLASS_NORMAL;
+  job->bandwidth_limit = 0;
+  job->transfer_skip_identical = THUNAR_SKIP_IDENTICAL_MODE_DISABLED;
+
+  job->bandwidth_tokens = 0.0;
+  job->bandwidth_time = 0;
+  job->io_class_applied = THUNAR_TRANSFER_IO_CLASS_NORMAL;
+  job->io_prio_saved = -1;
 
   job->type = 0;
   job->source_node_list = NULL;
   job->source_device_fs_id = NULL;
   job->is_source_device_local = FALSE;
+  job->source_device_max_jobs = 1;
   job->target_file_list = NULL;
   job->target_device_fs_id = NULL;
   job->is_target_device_local = FALSE;
+  job->target_device_max_jobs = 1;
+  job->device_info_filled = FALSE;
   job->total_size = 0;
   job->total_progress = 0;
   job->file_progress = 0;
   job->last_update_time = 0;
+  job->last_sample_time = 0;
   job->last_total_progress = 0;
+  job->last_n_completed_files = 0;
   job->transfer_rate = 0;
+  job->n_total_files = 0;
+  job->n_completed_files = 0;
+  job->files_rate = 0.0;
+  job->identical_size = 0;
+  job->hole_size = 0;
   job->start_time = 0;
+
+  job->pipeline_pool = NULL;
+  g_mutex_init (&job->pipeline_mutex);
+  g_cond_init (&job->pipeline_cond);
+
+  job->verify_pool = NULL;
+  g_queue_init (&job->verify_queue);
+
+  job->journal = NULL;
+  job->journal_target = NULL;
+
+  job->parts = NULL;
+  job->current_part = 0;
 }
 
 
@@ -237,14 +524,32 @@ thunar_transfer_job_finalize (GObject *object)
 {
   ThunarTransferJob *job = THUNAR_TRANSFER_JOB (object);
 
+  /* all tasks are completed by the job itself, so this doesn't block */
+  if (job->pipeline_pool != NULL)
+    g_thread_pool_free (job->pipeline_pool, FALSE, TRUE);
+  if (job->verify_pool != NULL)
+    g_thread_pool_free (job->verify_pool, FALSE, TRUE);
+  g_queue_clear_full (&job->verify_queue, thunar_transfer_verification_free);
+
+  /* the job ended one way or the other, only crashes leave the journal behind */
+  if (job->journal != NULL)
+    {
+      thunar_transfer_journal_remove (job->journal);
+      thunar_transfer_journal_free (job->journal);
+    }
+  g_mutex_clear (&job->pipeline_mutex);
+  g_cond_clear (&job->pipeline_cond);
+
   g_list_free_full (job->source_node_list, thunar_transfer_node_free);
+  g_list_free_full (job->parts, thunar_transfer_part_free);
 
   g_free (job->source_device_fs_id);
   g_free (job->target_device_fs_id);
 
   thunar_g_list_free_full (job->target_file_list);
 
-  g_object_unref (job->preferences);
+  if (job->preferences != NULL)
+    g_object_unref (job->preferences);
 
   (*G_OBJECT_CLASS (thunar_transfer_job_parent_class)->finalize) (object);
 }
@@ -273,6 +578,15 @@ thunar_transfer_job_get_property (GObject     *object,
     case PROP_TRANSFER_VERIFY_FILE:
       g_value_set_enum (value, job->transfer_verify_file);
       break;
+    case PROP_IO_CLASS:
+      g_value_set_enum (value, job->io_class);
+      break;
+    case PROP_BANDWIDTH_LIMIT:
+      g_value_set_uint (value, job->bandwidth_limit);
+      break;
+    case PROP_TRANSFER_SKIP_IDENTICAL:
+      g_value_set_enum (value, job->transfer_skip_identical);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -303,6 +617,15 @@ thunar_transfer_job_set_property (GObject      *object,
     case PROP_TRANSFER_VERIFY_FILE:
       job->transfer_verify_file = g_value_get_enum (value);
       break;
+    case PROP_IO_CLASS:
+      job->io_class = g_value_get_enum (value);
+      break;
+    case PROP_BANDWIDTH_LIMIT:
+      job->bandwidth_limit = g_value_get_uint (value);
+      break;
+    case PROP_TRANSFER_SKIP_IDENTICAL:
+      job->transfer_skip_identical = g_value_get_enum (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -315,14 +638,158 @@ static void
 thunar_transfer_job_check_pause (ThunarTransferJob *job)
 {
   _thunar_return_if_fail (THUNAR_IS_TRANSFER_JOB (job));
-  while (thunar_job_is_paused (THUNAR_JOB (job)) && !exo_job_is_cancelled (EXO_JOB (job)))
+
+  /* the time spent paused says nothing about the transfer rate */
+  if (thunar_job_yield (THUNAR_JOB (job)))
+    {
+      job->last_sample_time = g_get_real_time ();
+      job->last_total_progress = job->total_progress;
+      job->last_n_completed_files = job->n_completed_files;
+    }
+}
+
+
+
+/* switches the calling thread to the idle IO class, returning the priority
+ * to restore with thunar_transfer_job_leave_io_class(), or -1 if the class
+ * was left alone */
+static gint
+thunar_transfer_job_enter_io_class (ThunarTransferIoClass io_class)
+{
+#ifdef TRANSFER_IOPRIO
+  gint io_prio;
+
+  if (io_class != THUNAR_TRANSFER_IO_CLASS_IDLE)
+    return -1;
+
+  /* the thread ids of linux are processes to ioprio_set(), 0 is the caller */
+  io_prio = syscall (SYS_ioprio_get, TRANSFER_IOPRIO_WHO_PROCESS, 0);
+  if (io_prio < 0)
+    return -1;
+
+  if (syscall (SYS_ioprio_set, TRANSFER_IOPRIO_WHO_PROCESS, 0,
+               TRANSFER_IOPRIO_CLASS_IDLE << TRANSFER_IOPRIO_CLASS_SHIFT) < 0)
+    return -1;
+
+  return io_prio;
+#else
+  return -1;
+#endif
+}
+
+
+
+static void
+thunar_transfer_job_leave_io_class (gint io_prio)
+{
+#ifdef TRANSFER_IOPRIO
+  if (io_prio >= 0)
+    syscall (SYS_ioprio_set, TRANSFER_IOPRIO_WHO_PROCESS, 0, io_prio);
+#endif
+}
+
+
+
+/* follows the io-class of the job in the job thread, it may be changed
+ * from the progress dialog while the job is running */
+static void
+thunar_transfer_job_apply_io_class (ThunarTransferJob *job)
+{
+  ThunarTransferIoClass io_class = job->io_class;
+
+  if (G_LIKELY (io_class == job->io_class_applied))
+    return;
+
+  thunar_transfer_job_leave_io_class (job->io_prio_saved);
+  job->io_prio_saved = thunar_transfer_job_enter_io_class (io_class);
+  job->io_class_applied = io_class;
+}
+
+
+
+/* waits until the transferred @n_bytes are within the bandwidth limit
+ * of the job, a token bucket which fills with the limit per second */
+static void
+thunar_transfer_job_throttle (ThunarTransferJob *job,
+                              guint64            n_bytes)
+{
+  gdouble rate;
+  gdouble burst;
+  gint64  current_time;
+  gint64  wait_time;
+
+  if (G_LIKELY (job->bandwidth_limit == 0))
+    {
+      job->bandwidth_time = 0;
+      return;
+    }
+
+  rate = job->bandwidth_limit * 1024.0;
+  burst = rate * BANDWIDTH_BURST;
+
+  /* a new limit starts with a full bucket */
+  current_time = g_get_monotonic_time ();
+  if (job->bandwidth_time == 0)
+    job->bandwidth_tokens = burst;
+  else
+    job->bandwidth_tokens += rate * (current_time - job->bandwidth_time) / G_USEC_PER_SEC;
+  job->bandwidth_tokens = MIN (job->bandwidth_tokens, burst) - n_bytes;
+  job->bandwidth_time = current_time;
+
+  /* sleep in steps, to answer canceling and pausing in time */
+  while (job->bandwidth_tokens < 0.0 && !exo_job_is_cancelled (EXO_JOB (job)))
     {
-      g_usleep (500 * 1000); /* 500ms pause */
+      wait_time = -job->bandwidth_tokens / rate * G_USEC_PER_SEC;
+      g_usleep (CLAMP (wait_time, 1, BANDWIDTH_SLEEP_STEP));
+      thunar_transfer_job_check_pause (job);
+
+      current_time = g_get_monotonic_time ();
+      job->bandwidth_tokens = MIN (job->bandwidth_tokens + rate * (current_time - job->bandwidth_time) / G_USEC_PER_SEC, burst);
+      job->bandwidth_time = current_time;
     }
 }
 
 
 
+static void
+thunar_transfer_job_update_rates (ThunarTransferJob *job,
+                                  gint64             current_time)
+{
+  gint64  expired_time = current_time - job->last_sample_time;
+  gdouble seconds;
+  gdouble weight;
+  gdouble transfer_rate;
+  gdouble files_rate;
+
+  if (expired_time < RATE_SAMPLE_INTERVAL)
+    return;
+
+  /* windows longer than the sample interval weigh in by their length */
+  seconds = (gdouble) expired_time / G_USEC_PER_SEC;
+  weight = seconds / (seconds + RATE_TIME_CONSTANT);
+
+  transfer_rate = job->total_progress > job->last_total_progress
+                  ? (job->total_progress - job->last_total_progress) / seconds : 0.0;
+  files_rate = (job->n_completed_files - job->last_n_completed_files) / seconds;
+
+  /* the first sample starts the averages */
+  if (job->transfer_rate > 0)
+    job->transfer_rate = job->transfer_rate + weight * (transfer_rate - job->transfer_rate);
+  else
+    job->transfer_rate = transfer_rate;
+
+  if (job->files_rate > 0.0)
+    job->files_rate += weight * (files_rate - job->files_rate);
+  else
+    job->files_rate = files_rate;
+
+  job->last_sample_time = current_time;
+  job->last_total_progress = job->total_progress;
+  job->last_n_completed_files = job->n_completed_files;
+}
+
+
+
 static void
 thunar_transfer_job_progress (goffset  current_num_bytes,
                               goffset  total_num_bytes,
@@ -332,11 +799,32 @@ thunar_transfer_job_progress (goffset  current_num_bytes,
   guint64            new_percentage;
   gint64             current_time;
   gint64             expired_time;
-  guint64            transfer_rate;
 
   _thunar_return_if_fail (THUNAR_IS_TRANSFER_JOB (job));
 
   thunar_transfer_job_check_pause (job);
+  thunar_transfer_job_apply_io_class (job);
+
+  if (job->journal_target != NULL)
+    thunar_transfer_journal_progress (job->journal, job->journal_target, current_num_bytes);
+
+  if (current_num_bytes > (goffset) job->file_progress)
+    {
+      thunar_transfer_job_throttle (job, current_num_bytes - job->file_progress);
+
+      /* copies read what they write */
+      thunar_job_stats_bytes (THUNAR_JOB (job), current_num_bytes - job->file_progress,
+                              current_num_bytes - job->file_progress);
+    }
+
+  /* opening lasts until the first data of the copy arrived */
+  if (job->copy_start_time > 0)
+    {
+      if (!job->copy_has_data)
+        thunar_job_stats_latency (THUNAR_JOB (job), THUNAR_JOB_IO_OPEN, job->copy_start_time);
+      job->copy_has_data = TRUE;
+      job->copy_data_time = g_get_monotonic_time ();
+    }
 
   if (G_LIKELY (job->total_size > 0))
     {
@@ -353,34 +841,177 @@ thunar_transfer_job_progress (goffset  current_num_bytes,
       current_time = g_get_real_time ();
       expired_time = current_time - job->last_update_time;
 
+      thunar_transfer_job_update_rates (job, current_time);
+
       /* notify callers not more then every 500ms */
       /* force update after transfer when it took more than (approx.) 500ms */
       /* the actual code checks if (file size [byte]) > (transfer rate [byte/s]) * (0.5 [s]) */
       /* which means that the file is bigger than what is transferred in 500ms on average */
-      if (expired_time > (500 * 1000)
-          || (current_num_bytes == total_num_bytes && total_num_bytes > (goffset) (job->transfer_rate / 2)))
+      if (expired_time > PROGRESS_INTERVAL
+          || (expired_time > PROGRESS_MIN_INTERVAL
+              && current_num_bytes == total_num_bytes && total_num_bytes > (goffset) (job->transfer_rate / 2)))
         {
-          /* calculate the transfer rate in the last expired time */
-          transfer_rate = (job->total_progress - job->last_total_progress) / ((gfloat) expired_time / G_USEC_PER_SEC);
-
-          /* take the average of the last 10 rates (5 sec), so the output is less jumpy */
-          if (job->transfer_rate > 0)
-            job->transfer_rate = ((job->transfer_rate * 10) + transfer_rate) / 11;
-          else
-            job->transfer_rate = transfer_rate;
-
           /* emit the percent signal */
-          exo_job_percent (EXO_JOB (job), new_percentage);
+          thunar_job_percent (THUNAR_JOB (job), new_percentage);
 
           /* update internals */
           job->last_update_time = current_time;
-          job->last_total_progress = job->total_progress;
         }
     }
 }
 
 
 
+#ifdef COLLECT_NATIVE
+static GFileType
+thunar_transfer_job_collect_file_type (mode_t mode)
+{
+  if (S_ISDIR (mode))
+    return G_FILE_TYPE_DIRECTORY;
+  else if (S_ISREG (mode))
+    return G_FILE_TYPE_REGULAR;
+  else if (S_ISLNK (mode))
+    return G_FILE_TYPE_SYMBOLIC_LINK;
+  else
+    return G_FILE_TYPE_SPECIAL;
+}
+
+
+
+/* scans a local folder for its children, stat()ing them relative to the folder,
+ * and queues the subfolders to be scanned by the other threads of the pool */
+static void
+thunar_transfer_job_collect_worker (gpointer data,
+                                    gpointer user_data)
+{
+  ThunarTransferCollect *collect = user_data;
+  ThunarTransferNode    *node = data;
+  ThunarTransferNode    *child_node;
+  struct dirent         *entry;
+  struct stat            statb;
+  GError                *err = NULL;
+  GSList                *folders = NULL;
+  guint64                total_size = 0;
+  guint64                n_files = 0;
+  DIR                   *dir = NULL;
+  gint                   fd;
+  gint                   saved_errno;
+
+  thunar_transfer_job_check_pause (collect->job);
+
+  fd = open (g_file_peek_path (node->source_file), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd >= 0)
+    {
+      dir = fdopendir (fd);
+      if (dir == NULL)
+        close (fd);
+    }
+
+  if (dir == NULL)
+    {
+      saved_errno = errno;
+      g_set_error (&err, G_IO_ERROR, g_io_error_from_errno (saved_errno),
+                   _("Failed to open \"%s\": %s"),
+                   g_file_peek_path (node->source_file), g_strerror (saved_errno));
+    }
+
+  while (dir != NULL && (entry = readdir (dir)) != NULL)
+    {
+      if (exo_job_set_error_if_cancelled (EXO_JOB (collect->job), &err))
+        break;
+
+      if (strcmp (entry->d_name, ".") == 0 || strcmp (entry->d_name, "..") == 0)
+        continue;
+
+      /* the entry was removed in between */
+      if (fstatat (dirfd (dir), entry->d_name, &statb, AT_SYMLINK_NOFOLLOW) != 0)
+        continue;
+
+      /* allocate a new transfer node for the child */
+      child_node = g_slice_new0 (ThunarTransferNode);
+      child_node->source_file = g_file_get_child (node->source_file, entry->d_name);
+      child_node->replace_confirmed = node->replace_confirmed;
+      child_node->rename_confirmed = FALSE;
+      child_node->type = thunar_transfer_job_collect_file_type (statb.st_mode);
+      child_node->size = statb.st_size;
+      total_size += child_node->size;
+      n_files++;
+
+      /* hook the child node into the child list */
+      child_node->next = node->children;
+      node->children = child_node;
+
+      if (child_node->type == G_FILE_TYPE_DIRECTORY)
+        folders = g_slist_prepend (folders, child_node);
+    }
+
+  if (dir != NULL)
+    closedir (dir);
+
+  g_mutex_lock (&collect->mutex);
+  collect->total_size += total_size;
+  collect->n_files += n_files;
+  if (err != NULL && collect->error == NULL)
+    collect->error = g_steal_pointer (&err);
+  g_clear_error (&err);
+
+  /* no need to go on once one folder failed */
+  if (collect->error == NULL)
+    {
+      collect->n_pending += g_slist_length (folders);
+      for (GSList *lp = folders; lp != NULL; lp = lp->next)
+        g_thread_pool_push (collect->pool, lp->data, NULL);
+    }
+
+  if (--collect->n_pending == 0)
+    g_cond_signal (&collect->cond);
+  g_mutex_unlock (&collect->mutex);
+
+  g_slist_free (folders);
+}
+
+
+
+/* collects the tree below the local folder @node with a pool of threads */
+static gboolean
+thunar_transfer_job_collect_native (ThunarTransferJob  *job,
+                                    ThunarTransferNode *node,
+                                    GError            **error)
+{
+  ThunarTransferCollect collect = { 0, };
+
+  collect.job = job;
+  collect.pool = g_thread_pool_new (thunar_transfer_job_collect_worker, &collect,
+                                    COLLECT_THREADS, FALSE, NULL);
+  g_mutex_init (&collect.mutex);
+  g_cond_init (&collect.cond);
+  collect.n_pending = 1;
+
+  g_mutex_lock (&collect.mutex);
+  g_thread_pool_push (collect.pool, node, NULL);
+  while (collect.n_pending > 0)
+    g_cond_wait (&collect.cond, &collect.mutex);
+  g_mutex_unlock (&collect.mutex);
+
+  g_thread_pool_free (collect.pool, FALSE, TRUE);
+  g_mutex_clear (&collect.mutex);
+  g_cond_clear (&collect.cond);
+
+  job->total_size += collect.total_size;
+  job->n_total_files += collect.n_files;
+
+  if (collect.error != NULL)
+    {
+      g_propagate_error (error, collect.error);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+#endif
+
+
+
 static gboolean
 thunar_transfer_job_collect_node (ThunarTransferJob  *job,
                                   ThunarTransferNode *node,
@@ -409,7 +1040,19 @@ thunar_transfer_job_collect_node (ThunarTransferJob  *job,
   if (G_UNLIKELY (info == NULL))
     return FALSE;
 
-  job->total_size += g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_SIZE);
+  node->type = g_file_info_get_file_type (info);
+  node->size = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_SIZE);
+  job->total_size += node->size;
+  job->n_total_files++;
+
+#ifdef COLLECT_NATIVE
+  /* local folders don't need a full file info for every file below them */
+  if (node->type == G_FILE_TYPE_DIRECTORY && g_file_peek_path (node->source_file) != NULL)
+    {
+      g_object_unref (info);
+      return thunar_transfer_job_collect_native (job, node, error);
+    }
+#endif
 
   /* check if we have a directory here */
   if (g_file_info_get_file_type (info) == G_FILE_TYPE_DIRECTORY)
@@ -456,58 +1099,372 @@ thunar_transfer_job_collect_node (ThunarTransferJob  *job,
 
 
 
+static void
+thunar_transfer_job_verify_worker (gpointer data,
+                                   gpointer user_data)
+{
+  ThunarTransferVerification *verification = data;
+  ThunarTransferJob          *job = THUNAR_TRANSFER_JOB (user_data);
+  GError                     *err = NULL;
+  gchar                      *checksum = NULL;
+
+  if (!exo_job_set_error_if_cancelled (EXO_JOB (job), &err))
+    {
+      checksum = thunar_g_file_create_checksum (verification->target_file, VERIFY_CHECKSUM_TYPE,
+                                                exo_job_get_cancellable (EXO_JOB (job)), &err);
+      if (checksum != NULL)
+        thunar_job_stats_bytes (THUNAR_JOB (job), verification->size, 0);
+    }
+
+  g_mutex_lock (&job->pipeline_mutex);
+  verification->target_checksum = checksum;
+  verification->error = err;
+  verification->done = TRUE;
+  g_cond_broadcast (&job->pipeline_cond);
+  g_mutex_unlock (&job->pipeline_mutex);
+}
+
+
+
 static gboolean
-ttj_copy_file (ThunarTransferJob  *job,
-               ThunarJobOperation *operation,
-               GFile              *source_file,
-               GFile              *target_file,
-               GFileCopyFlags      copy_flags,
-               GError            **error)
+thunar_transfer_job_verify_pool_init (ThunarTransferJob *job)
 {
-  GFileInfo *info;
-  GFileType  source_type;
-  GFileType  target_type;
-  gboolean   target_exists;
-  gboolean   use_partial;
-  gboolean   verify_file;
-  gboolean   add_to_operation = TRUE;
-  GError    *err = NULL;
+  if (G_UNLIKELY (job->verify_pool == NULL))
+    job->verify_pool = g_thread_pool_new (thunar_transfer_job_verify_worker, job,
+                                          VERIFY_THREADS, FALSE, NULL);
 
-  _thunar_return_val_if_fail (THUNAR_IS_TRANSFER_JOB (job), FALSE);
-  _thunar_return_val_if_fail (G_IS_FILE (source_file), FALSE);
-  _thunar_return_val_if_fail (G_IS_FILE (target_file), FALSE);
-  _thunar_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+  return job->verify_pool != NULL;
+}
 
-  /* reset the file progress */
-  job->file_progress = 0;
 
-  if (exo_job_set_error_if_cancelled (EXO_JOB (job), error))
-    return FALSE;
-  thunar_transfer_job_check_pause (job);
 
-  source_type = g_file_query_file_type (source_file, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
-                                        exo_job_get_cancellable (EXO_JOB (job)));
+/* queues reading back @target_file, which is compared to the @checksum of
+ * its source by thunar_transfer_job_verify_collect() */
+static gboolean
+thunar_transfer_job_verify_push (ThunarTransferJob *job,
+                                 GFile             *source_file,
+                                 GFile             *target_file,
+                                 const gchar       *checksum,
+                                 gboolean           use_partial)
+{
+  ThunarTransferVerification *verification;
 
-  if (exo_job_set_error_if_cancelled (EXO_JOB (job), error))
+  if (!thunar_transfer_job_verify_pool_init (job))
     return FALSE;
-  thunar_transfer_job_check_pause (job);
 
-  target_type = g_file_query_file_type (target_file, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
-                                        exo_job_get_cancellable (EXO_JOB (job)));
+  verification = g_slice_new0 (ThunarTransferVerification);
+  verification->source_file = g_object_ref (source_file);
+  verification->target_file = g_object_ref (target_file);
+  verification->checksum = g_strdup (checksum);
+  verification->use_partial = use_partial;
+  verification->size = job->file_progress;
 
-  if (exo_job_set_error_if_cancelled (EXO_JOB (job), error))
-    return FALSE;
-  thunar_transfer_job_check_pause (job);
+  g_queue_push_tail (&job->verify_queue, verification);
+  g_thread_pool_push (job->verify_pool, verification, NULL);
 
-  /* check if the target is a symlink and we are in overwrite mode */
+  return TRUE;
+}
+
+
+
+/* copies @source_file again after a failed verification of @target_file,
+ * this time verifying it right away */
+static gboolean
+thunar_transfer_job_verify_recopy (ThunarTransferJob *job,
+                                   GFile             *source_file,
+                                   GFile             *target_file,
+                                   gboolean           use_partial,
+                                   GError           **error)
+{
+  gboolean  is_equal = FALSE;
+  gchar    *checksum;
+  gchar    *target_checksum;
+
+  if (!thunar_g_file_copy_with_checksum (source_file, target_file,
+                                         G_FILE_COPY_NOFOLLOW_SYMLINKS | G_FILE_COPY_OVERWRITE,
+                                         use_partial, exo_job_get_cancellable (EXO_JOB (job)),
+                                         NULL, NULL, VERIFY_CHECKSUM_TYPE, &checksum, error))
+    return FALSE;
+
+  target_checksum = thunar_g_file_create_checksum (target_file, VERIFY_CHECKSUM_TYPE,
+                                                   exo_job_get_cancellable (EXO_JOB (job)), error);
+  if (target_checksum != NULL)
+    {
+      is_equal = (g_strcmp0 (checksum, target_checksum) == 0);
+      if (!is_equal)
+        g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_AGAIN,
+                     "Copied file does not match with the original");
+    }
+
+  g_free (checksum);
+  g_free (target_checksum);
+
+  return is_equal;
+}
+
+
+
+/* Picks up the results of the verifications in the order of the copies,
+ * all of them if @wait is set, otherwise the finished ones. A mismatch is
+ * reported to the user, who may copy the file again. */
+static gboolean
+thunar_transfer_job_verify_collect (ThunarTransferJob *job,
+                                    gboolean           wait,
+                                    GError           **error)
+{
+  ThunarTransferVerification *verification;
+  ThunarJobResponse           response;
+  GError                     *err = NULL;
+  gboolean                    is_equal;
+
+  while (err == NULL && (verification = g_queue_peek_head (&job->verify_queue)) != NULL)
+    {
+      g_mutex_lock (&job->pipeline_mutex);
+      while (!verification->done
+             && (wait || g_queue_get_length (&job->verify_queue) > VERIFY_PENDING_SIZE))
+        g_cond_wait (&job->pipeline_cond, &job->pipeline_mutex);
+      g_mutex_unlock (&job->pipeline_mutex);
+
+      /* the next ones are still reading */
+      if (!verification->done)
+        break;
+
+      g_queue_pop_head (&job->verify_queue);
+
+      if (verification->error != NULL)
+        {
+          err = g_steal_pointer (&verification->error);
+          is_equal = TRUE;
+        }
+      else
+        {
+          is_equal = (g_strcmp0 (verification->checksum, verification->target_checksum) == 0);
+        }
+
+      while (!is_equal && err == NULL)
+        {
+          /* same error as for the files verified right after the copy */
+          response = thunar_job_ask_skip (THUNAR_JOB (job), "%s",
+                                          "Copied file does not match with the original");
+          if (G_UNLIKELY (response != THUNAR_JOB_RESPONSE_RETRY))
+            {
+              exo_job_set_error_if_cancelled (EXO_JOB (job), &err);
+              break;
+            }
+
+          is_equal = thunar_transfer_job_verify_recopy (job, verification->source_file,
+                                                        verification->target_file,
+                                                        verification->use_partial, &err);
+          if (g_error_matches (err, G_FILE_ERROR, G_FILE_ERROR_AGAIN))
+            g_clear_error (&err);
+        }
+
+      thunar_transfer_verification_free (verification);
+    }
+
+  if (err != NULL)
+    {
+      g_propagate_error (error, err);
+      return FALSE;
+    }
+
+  return TRUE;
+}
+
+
+
+/* reads @source_file and @target_file at once, the target by a thread of
+ * the verification pool, and compares their checksums */
+static gboolean
+thunar_transfer_job_compare_contents (ThunarTransferJob *job,
+                                      GFile             *source_file,
+                                      GFile             *target_file)
+{
+  ThunarTransferVerification *verification;
+  gboolean                    is_equal = FALSE;
+  gchar                      *checksum;
+
+  if (!thunar_transfer_job_verify_pool_init (job))
+    return FALSE;
+
+  verification = g_slice_new0 (ThunarTransferVerification);
+  verification->source_file = g_object_ref (source_file);
+  verification->target_file = g_object_ref (target_file);
+  g_thread_pool_push (job->verify_pool, verification, NULL);
+
+  checksum = thunar_g_file_create_checksum (source_file, VERIFY_CHECKSUM_TYPE,
+                                            exo_job_get_cancellable (EXO_JOB (job)), NULL);
+
+  g_mutex_lock (&job->pipeline_mutex);
+  while (!verification->done)
+    g_cond_wait (&job->pipeline_cond, &job->pipeline_mutex);
+  g_mutex_unlock (&job->pipeline_mutex);
+
+  if (checksum != NULL && verification->target_checksum != NULL)
+    is_equal = (g_strcmp0 (checksum, verification->target_checksum) == 0);
+
+  g_free (checksum);
+  thunar_transfer_verification_free (verification);
+
+  return is_equal;
+}
+
+
+
+/* checks whether the existing @target_file is the same as @source_file,
+ * so the copy can skip it, and accounts it as done if so */
+static gboolean
+thunar_transfer_job_skip_identical (ThunarTransferJob *job,
+                                    GFile             *source_file,
+                                    GFile             *target_file)
+{
+  GFileInfo *source_info;
+  GFileInfo *target_info;
+  gboolean   is_identical = FALSE;
+  guint64    size = 0;
+  gint64     source_mtime;
+  gint64     target_mtime;
+
+  if (job->transfer_skip_identical == THUNAR_SKIP_IDENTICAL_MODE_DISABLED)
+    return FALSE;
+
+  source_info = g_file_query_info (source_file,
+                                   G_FILE_ATTRIBUTE_STANDARD_TYPE ","
+                                   G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+                                   G_FILE_ATTRIBUTE_TIME_MODIFIED,
+                                   G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                   exo_job_get_cancellable (EXO_JOB (job)), NULL);
+  target_info = g_file_query_info (target_file,
+                                   G_FILE_ATTRIBUTE_STANDARD_TYPE ","
+                                   G_FILE_ATTRIBUTE_STANDARD_SIZE ","
+                                   G_FILE_ATTRIBUTE_TIME_MODIFIED,
+                                   G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                   exo_job_get_cancellable (EXO_JOB (job)), NULL);
+
+  /* only regular files are compared, folders are merged anyway */
+  if (source_info != NULL && target_info != NULL
+      && g_file_info_get_file_type (source_info) == G_FILE_TYPE_REGULAR
+      && g_file_info_get_file_type (target_info) == G_FILE_TYPE_REGULAR
+      && g_file_info_get_size (source_info) == g_file_info_get_size (target_info))
+    {
+      size = g_file_info_get_size (source_info);
+      source_mtime = g_file_info_get_attribute_uint64 (source_info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+      target_mtime = g_file_info_get_attribute_uint64 (target_info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+      is_identical = ABS (source_mtime - target_mtime) <= IDENTICAL_MTIME_TOLERANCE;
+    }
+
+  g_clear_object (&source_info);
+  g_clear_object (&target_info);
+
+  if (is_identical && job->transfer_skip_identical == THUNAR_SKIP_IDENTICAL_MODE_CHECKSUM)
+    {
+      thunar_job_info_message (THUNAR_JOB (job), _("Comparing checksums..."));
+      is_identical = thunar_transfer_job_compare_contents (job, source_file, target_file);
+    }
+
+  if (is_identical)
+    {
+      /* the bytes count as done, but they don't speed up the transfer rate */
+      job->identical_size += size;
+      job->total_progress += size;
+      job->last_total_progress += size;
+    }
+
+  return is_identical;
+}
+
+
+
+/* remembers how much of the copied @target_file are holes, which were
+ * counted for the progress but not written */
+static void
+thunar_transfer_job_account_holes (ThunarTransferJob *job,
+                                   GFile             *target_file)
+{
+  GFileInfo *info;
+  guint64    allocated_size;
+
+  info = g_file_query_info (target_file, G_FILE_ATTRIBUTE_STANDARD_ALLOCATED_SIZE,
+                            G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                            exo_job_get_cancellable (EXO_JOB (job)), NULL);
+  if (info == NULL)
+    return;
+
+  allocated_size = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_ALLOCATED_SIZE);
+  if (allocated_size > 0 && allocated_size < job->file_progress)
+    job->hole_size += job->file_progress - allocated_size;
+
+  g_object_unref (info);
+}
+
+
+
+static gboolean
+ttj_copy_file (ThunarTransferJob  *job,
+               ThunarJobOperation *operation,
+               GFile              *source_file,
+               GFile              *target_file,
+               GFileCopyFlags      copy_flags,
+               GError            **error)
+{
+  GFileInfo *info;
+  GFileType  source_type;
+  GFileType  target_type;
+  gboolean   target_exists;
+  gboolean   use_partial;
+  gboolean   verify_file;
+  gboolean   add_to_operation = TRUE;
+  gchar     *checksum = NULL;
+  gchar     *target_checksum;
+  goffset    resume_offset = 0;
+  gint64     start_time;
+  GError    *err = NULL;
+
+  _thunar_return_val_if_fail (THUNAR_IS_TRANSFER_JOB (job), FALSE);
+  _thunar_return_val_if_fail (G_IS_FILE (source_file), FALSE);
+  _thunar_return_val_if_fail (G_IS_FILE (target_file), FALSE);
+  _thunar_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+  /* reset the file progress */
+  job->file_progress = 0;
+
+  if (exo_job_set_error_if_cancelled (EXO_JOB (job), error))
+    return FALSE;
+  thunar_transfer_job_check_pause (job);
+
+  /* report the verifications done while copying the previous files */
+  if (!thunar_transfer_job_verify_collect (job, FALSE, error))
+    return FALSE;
+
+  start_time = g_get_monotonic_time ();
+  source_type = g_file_query_file_type (source_file, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                        exo_job_get_cancellable (EXO_JOB (job)));
+  thunar_job_stats_latency (THUNAR_JOB (job), THUNAR_JOB_IO_STAT, start_time);
+
+  if (exo_job_set_error_if_cancelled (EXO_JOB (job), error))
+    return FALSE;
+  thunar_transfer_job_check_pause (job);
+
+  start_time = g_get_monotonic_time ();
+  target_type = g_file_query_file_type (target_file, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                        exo_job_get_cancellable (EXO_JOB (job)));
+  thunar_job_stats_latency (THUNAR_JOB (job), THUNAR_JOB_IO_STAT, start_time);
+
+  if (exo_job_set_error_if_cancelled (EXO_JOB (job), error))
+    return FALSE;
+  thunar_transfer_job_check_pause (job);
+
+  /* check if the target is a symlink and we are in overwrite mode */
   if (target_type == G_FILE_TYPE_SYMBOLIC_LINK && (copy_flags & G_FILE_COPY_OVERWRITE) != 0)
     {
       /* try to delete the symlink */
+      start_time = g_get_monotonic_time ();
       if (!g_file_delete (target_file, exo_job_get_cancellable (EXO_JOB (job)), &err))
         {
           g_propagate_error (error, err);
           return FALSE;
         }
+      thunar_job_stats_latency (THUNAR_JOB (job), THUNAR_JOB_IO_DELETE, start_time);
     }
 
   switch (job->transfer_use_partial)
@@ -522,10 +1479,12 @@ ttj_copy_file (ThunarTransferJob  *job,
       use_partial = FALSE;
     }
 
-  /* try to copy the file */
-  thunar_g_file_copy (source_file, target_file, copy_flags, use_partial,
-                      exo_job_get_cancellable (EXO_JOB (job)),
-                      thunar_transfer_job_progress, job, &err);
+  /* journaled copies can resume files from their .partial~ file */
+  if (job->journal != NULL && source_type == G_FILE_TYPE_REGULAR)
+    {
+      use_partial = TRUE;
+      resume_offset = thunar_transfer_journal_get_offset (job->journal, target_file);
+    }
 
   switch (job->transfer_verify_file)
     {
@@ -540,23 +1499,83 @@ ttj_copy_file (ThunarTransferJob  *job,
     }
 
   /* Only verify when the file is a regular file */
-  verify_file = verify_file && (g_file_query_file_type (source_file, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS, exo_job_get_cancellable (EXO_JOB (job))) == G_FILE_TYPE_REGULAR);
+  verify_file = verify_file && source_type == G_FILE_TYPE_REGULAR;
 
-  if (verify_file && err == NULL)
+  /* record the progress of this copy */
+  if (job->journal != NULL)
+    job->journal_target = target_file;
+
+  /* time opening and closing the file, see thunar_transfer_job_progress() */
+  job->copy_start_time = g_get_monotonic_time ();
+  job->copy_has_data = FALSE;
+
+  /* try to copy the file, the source checksum is computed on the way */
+  if (G_UNLIKELY (resume_offset > 0))
+    {
+      thunar_g_file_copy_resume (source_file, target_file, copy_flags, resume_offset,
+                                 exo_job_get_cancellable (EXO_JOB (job)),
+                                 thunar_transfer_job_progress, job, &err);
+      if (verify_file && err == NULL)
+        checksum = thunar_g_file_create_checksum (source_file, VERIFY_CHECKSUM_TYPE,
+                                                  exo_job_get_cancellable (EXO_JOB (job)), &err);
+      if (checksum != NULL)
+        thunar_job_stats_bytes (THUNAR_JOB (job), job->file_progress, 0);
+    }
+  else if (verify_file)
     {
-      gboolean is_equal;
-      exo_job_info_message (EXO_JOB (job), _("Comparing checksums..."));
-      is_equal = thunar_g_file_compare_checksum (source_file, target_file,
-                                                 exo_job_get_cancellable (EXO_JOB (job)), &err);
+      thunar_g_file_copy_with_checksum (source_file, target_file, copy_flags, use_partial,
+                                        exo_job_get_cancellable (EXO_JOB (job)),
+                                        thunar_transfer_job_progress, job,
+                                        VERIFY_CHECKSUM_TYPE, &checksum, &err);
+    }
+  else
+    {
+      thunar_g_file_copy (source_file, target_file, copy_flags, use_partial,
+                          exo_job_get_cancellable (EXO_JOB (job)),
+                          thunar_transfer_job_progress, job, &err);
+    }
+
+  job->journal_target = NULL;
 
-      /* if the copied file is corrupted and yet no error*/
-      if (!is_equal && err == NULL)
+  /* closing lasts from the last data until the copy returned, links
+   * and empty files have no data in between */
+  if (err == NULL && job->copy_has_data)
+    thunar_job_stats_latency (THUNAR_JOB (job), THUNAR_JOB_IO_CLOSE, job->copy_data_time);
+  else if (err == NULL && source_type == G_FILE_TYPE_SYMBOLIC_LINK)
+    thunar_job_stats_latency (THUNAR_JOB (job), THUNAR_JOB_IO_CREATE, job->copy_start_time);
+  else if (err == NULL && source_type == G_FILE_TYPE_REGULAR)
+    thunar_job_stats_latency (THUNAR_JOB (job), THUNAR_JOB_IO_OPEN, job->copy_start_time);
+  job->copy_start_time = 0;
+
+  /* local copies keep the holes of sparse files */
+  if (err == NULL && source_type == G_FILE_TYPE_REGULAR
+      && job->file_progress >= SPARSE_FILE_MIN_SIZE && g_file_is_native (target_file))
+    thunar_transfer_job_account_holes (job, target_file);
+
+  if (verify_file && err == NULL)
+    {
+      /* copies read the target back while copying the next file, moves
+       * have to verify the target before the source gets removed */
+      if (job->type != THUNAR_TRANSFER_JOB_COPY
+          || !thunar_transfer_job_verify_push (job, source_file, target_file, checksum, use_partial))
         {
-          err = g_error_new (G_FILE_ERROR,
-                             G_FILE_ERROR_AGAIN,
-                             "Copied file does not match with the original");
+          thunar_job_info_message (THUNAR_JOB (job), _("Comparing checksums..."));
+          target_checksum = thunar_g_file_create_checksum (target_file, VERIFY_CHECKSUM_TYPE,
+                                                           exo_job_get_cancellable (EXO_JOB (job)), &err);
+          if (target_checksum != NULL)
+            thunar_job_stats_bytes (THUNAR_JOB (job), job->file_progress, 0);
+
+          /* if the copied file is corrupted and yet no error*/
+          if (err == NULL && g_strcmp0 (checksum, target_checksum) != 0)
+            {
+              err = g_error_new (G_FILE_ERROR,
+                                 G_FILE_ERROR_AGAIN,
+                                 "Copied file does not match with the original");
+            }
+          g_free (target_checksum);
         }
     }
+  g_free (checksum);
 
   /**
    * MR !127 notes:
@@ -633,18 +1652,22 @@ ttj_copy_file (ThunarTransferJob  *job,
                 {
                   /* the target still exists and thus is not a directory. try to remove it */
                   add_to_operation = TRUE;
-                  g_file_delete (target_file,
-                                 exo_job_get_cancellable (EXO_JOB (job)),
-                                 &err);
+                  start_time = g_get_monotonic_time ();
+                  if (g_file_delete (target_file,
+                                     exo_job_get_cancellable (EXO_JOB (job)),
+                                     &err))
+                    thunar_job_stats_latency (THUNAR_JOB (job), THUNAR_JOB_IO_DELETE, start_time);
                 }
 
               /* abort on error or cancellation, continue otherwise */
               if (err == NULL)
                 {
                   /* now try to create the directory */
-                  g_file_make_directory (target_file,
-                                         exo_job_get_cancellable (EXO_JOB (job)),
-                                         &err);
+                  start_time = g_get_monotonic_time ();
+                  if (g_file_make_directory (target_file,
+                                             exo_job_get_cancellable (EXO_JOB (job)),
+                                             &err))
+                    thunar_job_stats_latency (THUNAR_JOB (job), THUNAR_JOB_IO_CREATE, start_time);
                 }
             }
         }
@@ -734,11 +1757,19 @@ thunar_transfer_job_copy_file (ThunarTransferJob     *job,
 
       if (err == NULL)
         {
-          /* try to copy the file from source file to the duplicate file */
+          /* try to copy the file from source file to the duplicate file, the
+           * folder of the target updates it once when the copy is done */
+          thunar_folder_expect_changes (target);
           if (ttj_copy_file (job, operation, source_file, target, copy_flags, &err))
-            return target;
+            {
+              thunar_folder_expect_changes_done (target);
+              return target;
+            }
           else /* go to error case */
-            g_object_unref (target);
+            {
+              thunar_folder_expect_changes_done (target);
+              g_object_unref (target);
+            }
         }
 
       /* check if we can recover from this error */
@@ -747,6 +1778,10 @@ thunar_transfer_job_copy_file (ThunarTransferJob     *job,
           /* reset the error */
           g_clear_error (&err);
 
+          /* the target may be a copy made earlier, even after "Replace All" */
+          if (thunar_transfer_job_skip_identical (job, source_file, dest_file))
+            return g_object_ref (source_file);
+
           /* if necessary, ask the user whether to replace or rename the target file */
           if (replace_confirmed)
             response = THUNAR_JOB_RESPONSE_REPLACE;
@@ -800,6 +1835,272 @@ thunar_transfer_job_copy_file (ThunarTransferJob     *job,
 
 
 
+static gboolean
+thunar_transfer_job_can_pipeline (ThunarTransferJob  *job,
+                                  ThunarTransferNode *node,
+                                  GFile              *target_file)
+{
+  gchar    *base_name;
+  gboolean  is_desktop_file;
+
+  /* only plain copies of small local files, anything that needs
+   * to ask the user or to look at the file again is done in order */
+  if (job->type != THUNAR_TRANSFER_JOB_COPY
+      || node->type != G_FILE_TYPE_REGULAR
+      || node->size > SMALL_FILE_SIZE
+      || node->children != NULL
+      || node->replace_confirmed
+      || node->rename_confirmed
+      || job->transfer_verify_file == THUNAR_VERIFY_FILE_MODE_ALWAYS
+      || !g_file_is_native (node->source_file)
+      || !g_file_is_native (target_file)
+      || g_file_equal (node->source_file, target_file))
+    return FALSE;
+
+  /* launchers get their trusted state copied in ttj_copy_file() */
+  base_name = g_file_get_basename (node->source_file);
+  is_desktop_file = g_str_has_suffix (base_name, ".desktop");
+  g_free (base_name);
+
+  return !is_desktop_file;
+}
+
+
+
+/* only times the pipelined copies, their progress is accounted when they complete */
+static void
+thunar_transfer_job_pipeline_progress (goffset  current_num_bytes,
+                                       goffset  total_num_bytes,
+                                       gpointer user_data)
+{
+  ThunarTransferTask *task = user_data;
+
+  /* opening lasts until the first data of the copy arrived */
+  if (task->data_time == 0)
+    thunar_job_stats_latency (task->job, THUNAR_JOB_IO_OPEN, task->start_time);
+  task->data_time = g_get_monotonic_time ();
+}
+
+
+
+static void
+thunar_transfer_job_pipeline_worker (gpointer data,
+                                     gpointer user_data)
+{
+  ThunarTransferTask *task = data;
+  ThunarTransferJob  *job = THUNAR_TRANSFER_JOB (user_data);
+  GError             *err = NULL;
+  gint                io_prio;
+
+  if (!exo_job_set_error_if_cancelled (EXO_JOB (job), &err))
+    {
+      /* the threads of the pool are shared, so the class is kept for one copy */
+      io_prio = thunar_transfer_job_enter_io_class (job->io_class);
+      thunar_folder_expect_changes (task->target_file);
+      task->start_time = g_get_monotonic_time ();
+      thunar_g_file_copy (task->node->source_file, task->target_file,
+                          G_FILE_COPY_NOFOLLOW_SYMLINKS, task->use_partial,
+                          exo_job_get_cancellable (EXO_JOB (job)),
+                          thunar_transfer_job_pipeline_progress, task, &err);
+      thunar_folder_expect_changes_done (task->target_file);
+      thunar_transfer_job_leave_io_class (io_prio);
+
+      /* like in ttj_copy_file(), empty files have no data in between */
+      if (err == NULL && task->data_time > 0)
+        thunar_job_stats_latency (THUNAR_JOB (job), THUNAR_JOB_IO_CLOSE, task->data_time);
+      else if (err == NULL)
+        thunar_job_stats_latency (THUNAR_JOB (job), THUNAR_JOB_IO_OPEN, task->start_time);
+    }
+
+  g_mutex_lock (&job->pipeline_mutex);
+  task->error = err;
+  task->done = TRUE;
+  g_cond_broadcast (&job->pipeline_cond);
+  g_mutex_unlock (&job->pipeline_mutex);
+}
+
+
+
+/* starts copying a small file in the background, the task is queued to pick
+ * up its result in order with thunar_transfer_job_pipeline_complete() */
+static gboolean
+thunar_transfer_job_pipeline_push (ThunarTransferJob  *job,
+                                   GQueue             *pipeline,
+                                   ThunarTransferNode *node,
+                                   GFile              *target_file)
+{
+  ThunarTransferTask *task;
+
+  if (G_UNLIKELY (job->pipeline_pool == NULL))
+    {
+      job->pipeline_pool = g_thread_pool_new (thunar_transfer_job_pipeline_worker, job,
+                                              SMALL_FILE_THREADS, FALSE, NULL);
+      if (job->pipeline_pool == NULL)
+        return FALSE;
+    }
+
+  task = g_slice_new0 (ThunarTransferTask);
+  task->node = node;
+  task->target_file = g_object_ref (target_file);
+  task->use_partial = (job->transfer_use_partial == THUNAR_USE_PARTIAL_MODE_ALWAYS);
+  task->job = THUNAR_JOB (job);
+
+  g_queue_push_tail (pipeline, task);
+  g_thread_pool_push (job->pipeline_pool, task, NULL);
+
+  return TRUE;
+}
+
+
+
+/* waits for the oldest task and handles its result like the sequential
+ * copy would, falling back to it for errors so replacing, renaming,
+ * skipping and retrying are asked for in the order of the files */
+static void
+thunar_transfer_job_pipeline_complete (ThunarTransferJob    *job,
+                                       ThunarJobOperation   *operation,
+                                       GQueue               *pipeline,
+                                       ThunarThumbnailCache *thumbnail_cache,
+                                       GList               **target_file_list_return,
+                                       GError              **error)
+{
+  ThunarTransferTask *task;
+  ThunarTransferNode *node;
+  ThunarJobResponse   response;
+  GFile              *real_target_file = NULL;
+  GError             *err = NULL;
+
+  task = g_queue_pop_head (pipeline);
+  node = task->node;
+
+  g_mutex_lock (&job->pipeline_mutex);
+  while (!task->done)
+    g_cond_wait (&job->pipeline_cond, &job->pipeline_mutex);
+  g_mutex_unlock (&job->pipeline_mutex);
+
+  /* after an error or cancellation the results are only waited for */
+  if (*error != NULL || exo_job_set_error_if_cancelled (EXO_JOB (job), &err))
+    {
+      g_clear_error (&task->error);
+    }
+  else if (task->error == NULL)
+    {
+      if (operation != NULL)
+        thunar_job_operation_add (operation, node->source_file, task->target_file);
+
+      real_target_file = g_object_ref (task->target_file);
+
+      /* account the file at once */
+      job->file_progress = 0;
+      thunar_transfer_job_progress (node->size, node->size, job);
+    }
+  else
+    {
+      /* an existing target is handled by the sequential copy, which asks
+       * whether to replace or rename it, other errors are reported as is */
+      if (!g_error_matches (task->error, G_IO_ERROR, G_IO_ERROR_EXISTS))
+        {
+          err = g_steal_pointer (&task->error);
+          goto ask_skip;
+        }
+
+retry_copy:
+      thunar_transfer_job_check_pause (job);
+
+      real_target_file = thunar_transfer_job_copy_file (job, operation,
+                                                        node->source_file,
+                                                        task->target_file,
+                                                        node->replace_confirmed,
+                                                        node->rename_confirmed,
+                                                        &err);
+ask_skip:
+      if (real_target_file == NULL && err != NULL
+          && (err->domain != G_IO_ERROR || err->code != G_IO_ERROR_NO_SPACE))
+        {
+          /* ask the user to skip this file */
+          response = thunar_job_ask_skip (THUNAR_JOB (job), "%s", err->message);
+
+          /* reset the error */
+          g_clear_error (&err);
+
+          /* check whether to retry */
+          if (G_UNLIKELY (response == THUNAR_JOB_RESPONSE_RETRY))
+            goto retry_copy;
+        }
+    }
+
+  if (real_target_file != NULL)
+    {
+      /* node->source_file == real_target_file means to skip the file */
+      if (G_LIKELY (node->source_file != real_target_file))
+        {
+          /* notify the thumbnail cache of the copy operation */
+          thunar_thumbnail_cache_copy_file (thumbnail_cache, node->source_file, real_target_file);
+
+          /* add the real target file to the return list */
+          if (G_LIKELY (target_file_list_return != NULL))
+            *target_file_list_return = thunar_g_list_prepend_deep (*target_file_list_return, real_target_file);
+
+          if (job->journal != NULL)
+            thunar_transfer_journal_done (job->journal, task->target_file);
+        }
+
+      g_object_unref (real_target_file);
+    }
+
+  job->n_completed_files++;
+  thunar_job_stats_files (THUNAR_JOB (job), 1);
+
+  if (err != NULL)
+    g_propagate_error (error, err);
+
+  g_clear_error (&task->error);
+  g_object_unref (task->target_file);
+  g_slice_free (ThunarTransferTask, task);
+}
+
+
+
+static gboolean
+thunar_transfer_job_rename_node (ThunarTransferJob     *job,
+                                 ThunarJobOperation    *operation,
+                                 ThunarTransferNode    *node,
+                                 GFile                 *target_file,
+                                 ThunarThumbnailCache  *thumbnail_cache,
+                                 GList                **target_file_list_return)
+{
+  if (!g_file_is_native (node->source_file))
+    return FALSE;
+
+  /* a plain rename, which fails for existing targets and across file
+   * systems, both of which are left to the copy+remove fallback */
+  if (!g_file_move (node->source_file, target_file,
+                    G_FILE_COPY_NOFOLLOW_SYMLINKS | G_FILE_COPY_NO_FALLBACK_FOR_MOVE,
+                    exo_job_get_cancellable (EXO_JOB (job)),
+                    NULL, NULL, NULL))
+    return FALSE;
+
+  if (operation != NULL)
+    thunar_job_operation_add (operation, node->source_file, target_file);
+
+  /* notify the thumbnail cache of the move operation */
+  thunar_thumbnail_cache_move_file (thumbnail_cache, node->source_file, target_file);
+
+  if (G_LIKELY (target_file_list_return != NULL))
+    *target_file_list_return = thunar_g_list_prepend_deep (*target_file_list_return, target_file);
+
+  /* the children were moved along with it */
+  job->total_progress += thunar_transfer_node_get_size (node);
+  job->n_completed_files += thunar_transfer_node_get_n_files (node);
+  thunar_job_stats_files (THUNAR_JOB (job), thunar_transfer_node_get_n_files (node));
+  thunar_transfer_node_free (node->children);
+  node->children = NULL;
+
+  return TRUE;
+}
+
+
+
 static void
 thunar_transfer_job_copy_node (ThunarTransferJob  *job,
                                ThunarJobOperation *operation,
@@ -817,10 +2118,14 @@ thunar_transfer_job_copy_node (ThunarTransferJob  *job,
   GFileInfo            *fs_info;
   GError               *err = NULL;
   GFile                *real_target_file = NULL;
+  GQueue                pipeline = G_QUEUE_INIT;
+  gint64                start_time;
   gchar                *base_name;
   const gchar          *fs_type;
   gboolean              should_use_copy_name;
   gboolean              use_fat_name_scheme;
+  gboolean              use_pipeline;
+  gboolean              use_rename;
 
   _thunar_return_if_fail (THUNAR_IS_TRANSFER_JOB (job));
   _thunar_return_if_fail (node != NULL && G_IS_FILE (node->source_file));
@@ -848,12 +2153,22 @@ thunar_transfer_job_copy_node (ThunarTransferJob  *job,
 
   should_use_copy_name = G_UNLIKELY (!g_file_is_native (node->source_file));
 
+  /* the children of a folder are copied through the small file pipeline */
+  use_pipeline = (target_file == NULL);
+
   if (target_parent_file == NULL)
     target_parent_file = g_file_get_parent (target_file);
   else
     g_object_ref (target_parent_file);
   g_assert (target_parent_file != NULL);
 
+  /* the copy+remove fallback for moves within one file system, e.g. when
+   * merging into an existing folder, still renames what it can */
+  use_rename = job->type == THUNAR_TRANSFER_JOB_MOVE
+               && g_file_is_native (target_parent_file)
+               && (!job->device_info_filled
+                   || g_strcmp0 (job->source_device_fs_id, job->target_device_fs_id) == 0);
+
   fs_info = g_file_query_filesystem_info (target_parent_file,
                                           G_FILE_ATTRIBUTE_FILESYSTEM_TYPE,
                                           NULL, NULL);
@@ -877,6 +2192,7 @@ thunar_transfer_job_copy_node (ThunarTransferJob  *job,
   for (; err == NULL && node != NULL; node = node->next)
     {
       /* query file info */
+      start_time = g_get_monotonic_time ();
       info = g_file_query_info (node->source_file,
                                 G_FILE_ATTRIBUTE_STANDARD_COPY_NAME "," G_FILE_ATTRIBUTE_STANDARD_DISPLAY_NAME,
                                 G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
@@ -886,6 +2202,7 @@ thunar_transfer_job_copy_node (ThunarTransferJob  *job,
       /* abort on error or cancellation */
       if (info == NULL)
         break;
+      thunar_job_stats_latency (THUNAR_JOB (job), THUNAR_JOB_IO_STAT, start_time);
 
       /* guess the target file for this node (unless already provided) */
       if (should_use_copy_name)
@@ -944,7 +2261,51 @@ thunar_transfer_job_copy_node (ThunarTransferJob  *job,
         }
 
       /* update progress information */
-      exo_job_info_message (EXO_JOB (job), "%s", g_file_info_get_display_name (info));
+      thunar_job_info_message (THUNAR_JOB (job), "%s", g_file_info_get_display_name (info));
+
+      /* skip what the interrupted copy this job resumes completed */
+      if (job->journal != NULL && thunar_transfer_journal_is_done (job->journal, target_file))
+        {
+          job->total_progress += thunar_transfer_node_get_size (node);
+          job->n_completed_files += thunar_transfer_node_get_n_files (node);
+          g_clear_object (&target_file);
+          g_object_unref (info);
+          continue;
+        }
+
+      if (use_pipeline
+          && thunar_transfer_job_can_pipeline (job, node, target_file)
+          && thunar_transfer_job_pipeline_push (job, &pipeline, node, target_file))
+        {
+          /* make room in the pipeline, in order */
+          while (err == NULL && g_queue_get_length (&pipeline) > SMALL_FILE_PIPELINE_SIZE)
+            thunar_transfer_job_pipeline_complete (job, operation, &pipeline, thumbnail_cache,
+                                                   target_file_list_return, &err);
+
+          g_clear_object (&target_file);
+          g_object_unref (info);
+          continue;
+        }
+
+      /* finish the small files before this one, to keep the order of the results */
+      while (err == NULL && !g_queue_is_empty (&pipeline))
+        thunar_transfer_job_pipeline_complete (job, operation, &pipeline, thumbnail_cache,
+                                               target_file_list_return, &err);
+      if (G_UNLIKELY (err != NULL))
+        {
+          g_clear_object (&target_file);
+          g_object_unref (info);
+          break;
+        }
+
+      if (use_rename
+          && thunar_transfer_job_rename_node (job, operation, node, target_file,
+                                              thumbnail_cache, target_file_list_return))
+        {
+          g_clear_object (&target_file);
+          g_object_unref (info);
+          continue;
+        }
 
 retry_copy:
       thunar_transfer_job_check_pause (job);
@@ -994,16 +2355,23 @@ retry_copy:
                                                 real_target_file);
                 }
 
+              /* the node and all its children are copied now */
+              if (job->journal != NULL)
+                thunar_transfer_journal_done (job->journal, target_file);
+
 retry_remove:
               thunar_transfer_job_check_pause (job);
 
               /* try to remove the source directory if we are on copy+remove fallback for move */
               if (job->type == THUNAR_TRANSFER_JOB_MOVE)
                 {
+                  start_time = g_get_monotonic_time ();
                   if (g_file_delete (node->source_file,
                                      exo_job_get_cancellable (EXO_JOB (job)),
                                      &err))
                     {
+                      thunar_job_stats_latency (THUNAR_JOB (job), THUNAR_JOB_IO_DELETE, start_time);
+
                       /* notify the thumbnail cache of the delete operation */
                       thunar_thumbnail_cache_delete_file (thumbnail_cache,
                                                           node->source_file);
@@ -1043,6 +2411,10 @@ retry_remove:
             }
         }
 
+      /* copied children were released above, skipped ones count as done */
+      job->n_completed_files += thunar_transfer_node_get_n_files (node);
+      thunar_job_stats_files (THUNAR_JOB (job), thunar_transfer_node_get_n_files (node));
+
       /* release the guessed target file */
       g_clear_object (&target_file);
 
@@ -1050,6 +2422,11 @@ retry_remove:
       g_object_unref (info);
     }
 
+  /* pick up the remaining small files, just waiting for them after errors */
+  while (!g_queue_is_empty (&pipeline))
+    thunar_transfer_job_pipeline_complete (job, operation, &pipeline, thumbnail_cache,
+                                           target_file_list_return, &err);
+
   /* release parent file */
   g_object_unref (target_parent_file);
 
@@ -1066,6 +2443,73 @@ retry_remove:
 
 
 
+/* counts the files of @node that exist at @target_file already, the
+ * folders which exist are merged and only their files can conflict */
+static guint64
+thunar_transfer_job_count_conflicts (ThunarTransferJob  *job,
+                                     ThunarTransferNode *node,
+                                     GFile              *target_file)
+{
+  ThunarTransferNode *child;
+  GFileType           target_type;
+  GFile              *child_file;
+  guint64             n_conflicts = 0;
+  gchar              *base_name;
+
+  if (exo_job_is_cancelled (EXO_JOB (job)))
+    return 0;
+
+  target_type = g_file_query_file_type (target_file, G_FILE_QUERY_INFO_NOFOLLOW_SYMLINKS,
+                                        exo_job_get_cancellable (EXO_JOB (job)));
+  if (target_type == G_FILE_TYPE_UNKNOWN)
+    return 0;
+
+  if (node->type != G_FILE_TYPE_DIRECTORY || target_type != G_FILE_TYPE_DIRECTORY)
+    return 1;
+
+  for (child = node->children; child != NULL; child = child->next)
+    {
+      base_name = g_file_get_basename (child->source_file);
+      child_file = g_file_get_child (target_file, base_name);
+      n_conflicts += thunar_transfer_job_count_conflicts (job, child, child_file);
+      g_object_unref (child_file);
+      g_free (base_name);
+    }
+
+  return n_conflicts;
+}
+
+
+
+/* asks once how to resolve the conflicts of the copy, instead of
+ * asking from the job thread for every conflict until the user
+ * applies the answer to all. The scan maps the sources to the plain
+ * target names, so the count is an estimate on FAT file systems */
+static void
+thunar_transfer_job_ask_conflicts (ThunarTransferJob *job)
+{
+  ThunarTransferNode *node;
+  guint64             n_conflicts = 0;
+  GList              *sp;
+  GList              *tp;
+
+  thunar_job_info_message (THUNAR_JOB (job), _("Looking for conflicts..."));
+
+  for (sp = job->source_node_list, tp = job->target_file_list;
+       sp != NULL && tp != NULL;
+       sp = sp->next, tp = tp->next)
+    {
+      node = sp->data;
+      if (!node->replace_confirmed && !node->rename_confirmed)
+        n_conflicts += thunar_transfer_job_count_conflicts (job, node, tp->data);
+    }
+
+  if (n_conflicts >= BATCH_CONFLICTS_MIN)
+    thunar_job_ask_conflicts (THUNAR_JOB (job), n_conflicts);
+}
+
+
+
 static gboolean
 thunar_transfer_job_verify_destination (ThunarTransferJob  *transfer_job,
                                         GError            **error)
@@ -1164,8 +2608,8 @@ thunar_transfer_job_prepare_untrash_file (ExoJob     *job,
   gchar             *parent_display_name;
 
   /* update progress information */
-  exo_job_info_message (job, _("Trying to restore \"%s\""),
-                        g_file_info_get_display_name (info));
+  thunar_job_info_message (THUNAR_JOB (job), _("Trying to restore \"%s\""),
+                           g_file_info_get_display_name (info));
 
   /* determine the parent file */
   target_parent = g_file_get_parent (file);
@@ -1184,61 +2628,350 @@ thunar_transfer_job_prepare_untrash_file (ExoJob     *job,
       return FALSE;
     }
 
-  if (target_parent != NULL && !parent_exists)
+  if (target_parent != NULL && !parent_exists)
+    {
+      /* determine the display name of the parent */
+      base_name = g_file_get_basename (target_parent);
+      parent_display_name = g_filename_display_name (base_name);
+      g_free (base_name);
+
+      /* ask the user whether he wants to create the parent folder because its gone */
+      response = thunar_job_ask_create (THUNAR_JOB (job),
+                                        _("The folder \"%s\" does not exist anymore but is "
+                                          "required to restore the file \"%s\" from the "
+                                          "trash"),
+                                        parent_display_name,
+                                        g_file_info_get_display_name (info));
+
+      /* abort if cancelled */
+      if (G_UNLIKELY (response == THUNAR_JOB_RESPONSE_CANCEL))
+        {
+          g_free (parent_display_name);
+          g_object_unref (info);
+          if (target_parent != NULL)
+            g_object_unref (target_parent);
+          return FALSE;
+        }
+
+      /* try to create the parent directory */
+      if (!g_file_make_directory_with_parents (target_parent,
+                                               exo_job_get_cancellable (job),
+                                               error))
+        {
+          if (!exo_job_is_cancelled (job))
+            {
+              g_clear_error (error);
+
+              /* overwrite the internal GIO error with something more user-friendly */
+              g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                           _("Failed to restore the folder \"%s\""),
+                           parent_display_name);
+            }
+
+          g_free (parent_display_name);
+          g_object_unref (info);
+          if (target_parent != NULL)
+            g_object_unref (target_parent);
+          return FALSE;
+        }
+
+      /* clean up */
+      g_free (parent_display_name);
+    }
+
+  if (target_parent != NULL)
+    g_object_unref (target_parent);
+  return TRUE;
+}
+
+
+#ifdef UNTRASH_NATIVE
+/* returns the original path in the *.trashinfo @info_name, or %NULL */
+static gchar *
+thunar_transfer_job_read_trash_info (gint         info_fd,
+                                     const gchar *info_name)
+{
+  GKeyFile *key_file;
+  gchar     buffer[UNTRASH_INFO_MAX_SIZE];
+  gchar    *escaped;
+  gchar    *path = NULL;
+  gssize    length;
+  gint      fd;
+
+  fd = openat (info_fd, info_name, O_RDONLY | O_NOFOLLOW | O_CLOEXEC);
+  if (fd < 0)
+    return NULL;
+
+  do
+    length = read (fd, buffer, sizeof (buffer));
+  while (length < 0 && errno == EINTR);
+  close (fd);
+
+  /* a short read of a bigger file is not an info file we wrote */
+  if (length <= 0 || length == sizeof (buffer))
+    return NULL;
+
+  key_file = g_key_file_new ();
+  if (g_key_file_load_from_data (key_file, buffer, length, G_KEY_FILE_NONE, NULL))
+    {
+      escaped = g_key_file_get_string (key_file, "Trash Info", "Path", NULL);
+      if (escaped != NULL)
+        path = g_uri_unescape_string (escaped, NULL);
+      g_free (escaped);
+    }
+  g_key_file_free (key_file);
+
+  /* the items of the home trash keep their absolute path */
+  if (path != NULL && !g_path_is_absolute (path))
+    {
+      g_free (path);
+      path = NULL;
+    }
+
+  return path;
+}
+
+
+
+static void
+thunar_transfer_untrash_free (gpointer data)
+{
+  ThunarTransferUntrash *untrash = data;
+
+  g_free (untrash->name);
+  g_slice_free (ThunarTransferUntrash, untrash);
+}
+
+
+
+static void
+thunar_transfer_untrash_queue_free (gpointer data)
+{
+  g_queue_free_full (data, thunar_transfer_untrash_free);
+}
+
+
+
+/* restores the items of the home trash among the source nodes by renaming
+ * them back, like the trash backend of GVfs does, without its round trips
+ * for every item. The *.trashinfo files of all items are read in one pass,
+ * and the items are restored by target folder, so a missing folder is asked
+ * for and created once. Items on other volumes, with a conflict or failing
+ * otherwise are left to the loop over the source nodes */
+static void
+thunar_transfer_job_untrash_native (ThunarTransferJob     *transfer_job,
+                                    ThunarJobOperation    *operation,
+                                    ThunarThumbnailCache  *thumbnail_cache,
+                                    GList                **new_files_list_p,
+                                    GError               **error)
+{
+  ThunarTransferUntrash *untrash;
+  ThunarTransferNode    *node;
+  ThunarJobResponse      response;
+  struct stat            statb;
+  GHashTable            *folders;
+  GQueue                *items;
+  gboolean               is_top;
+  gint64                 current_time;
+  gint64                 last_update_time = 0;
+  GFile                 *trash_root;
+  GFile                 *parent;
+  GList                 *folder_paths;
+  GList                 *lp;
+  GList                 *ip;
+  GList                 *sp;
+  GList                 *tp;
+  gchar                 *trash_dir;
+  gchar                 *path;
+  gchar                 *info_name;
+  gchar                 *original_path;
+  gchar                 *display_name;
+  gchar                 *folder_display_name;
+  guint                  n_items = 0;
+  guint                  n_done = 0;
+  gint                   files_fd;
+  gint                   info_fd;
+
+  trash_dir = thunar_io_trash_get_home_dir ();
+  path = g_build_filename (trash_dir, "files", NULL);
+  files_fd = open (path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  g_free (path);
+  path = g_build_filename (trash_dir, "info", NULL);
+  info_fd = open (path, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  g_free (path);
+  g_free (trash_dir);
+
+  if (files_fd < 0 || info_fd < 0)
+    {
+      if (files_fd >= 0)
+        close (files_fd);
+      if (info_fd >= 0)
+        close (info_fd);
+      return;
+    }
+
+  /* target folder path -> GQueue of ThunarTransferUntrash */
+  folders = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, thunar_transfer_untrash_queue_free);
+  trash_root = g_file_new_for_uri ("trash:///");
+
+  /* find the items of the home trash, whose info file names the target */
+  for (sp = transfer_job->source_node_list, tp = transfer_job->target_file_list;
+       sp != NULL && tp != NULL;
+       sp = sp->next, tp = tp->next)
+    {
+      node = sp->data;
+      if (!g_file_is_native (tp->data))
+        continue;
+
+      parent = g_file_get_parent (node->source_file);
+      is_top = (parent != NULL && g_file_equal (parent, trash_root));
+      if (parent != NULL)
+        g_object_unref (parent);
+      if (!is_top)
+        continue;
+
+      untrash = g_slice_new0 (ThunarTransferUntrash);
+      untrash->sp = sp;
+      untrash->tp = tp;
+      untrash->name = g_file_get_basename (node->source_file);
+
+      /* items of the other trash folders have names which don't exist in the home trash */
+      info_name = g_strconcat (untrash->name, ".trashinfo", NULL);
+      original_path = thunar_transfer_job_read_trash_info (info_fd, info_name);
+      g_free (info_name);
+
+      if (original_path == NULL
+          || strcmp (original_path, g_file_peek_path (tp->data)) != 0
+          || fstatat (files_fd, untrash->name, &statb, AT_SYMLINK_NOFOLLOW) != 0)
+        {
+          thunar_transfer_untrash_free (untrash);
+          g_free (original_path);
+          continue;
+        }
+
+      path = g_path_get_dirname (original_path);
+      items = g_hash_table_lookup (folders, path);
+      if (items == NULL)
+        {
+          items = g_queue_new ();
+          g_hash_table_insert (folders, path, items);
+        }
+      else
+        {
+          g_free (path);
+        }
+      g_queue_push_tail (items, untrash);
+      g_free (original_path);
+      n_items++;
+    }
+
+  g_object_unref (trash_root);
+
+  /* the folders in order, so restored folders exist before the items restored into them */
+  folder_paths = g_list_sort (g_hash_table_get_keys (folders), (GCompareFunc) strcmp);
+
+  for (lp = folder_paths; lp != NULL; lp = lp->next)
     {
-      /* determine the display name of the parent */
-      base_name = g_file_get_basename (target_parent);
-      parent_display_name = g_filename_display_name (base_name);
-      g_free (base_name);
+      items = g_hash_table_lookup (folders, lp->data);
 
-      /* ask the user whether he wants to create the parent folder because its gone */
-      response = thunar_job_ask_create (THUNAR_JOB (job),
-                                        _("The folder \"%s\" does not exist anymore but is "
-                                          "required to restore the file \"%s\" from the "
-                                          "trash"),
-                                        parent_display_name,
-                                        g_file_info_get_display_name (info));
+      if (*error != NULL || exo_job_is_cancelled (EXO_JOB (transfer_job)))
+        continue;
 
-      /* abort if cancelled */
-      if (G_UNLIKELY (response == THUNAR_JOB_RESPONSE_CANCEL))
+      /* a folder that is gone is asked for once for all of its items */
+      if (lstat (lp->data, &statb) != 0)
         {
-          g_free (parent_display_name);
-          g_object_unref (info);
-          if (target_parent != NULL)
-            g_object_unref (target_parent);
-          return FALSE;
+          if (errno != ENOENT)
+            continue;
+
+          untrash = g_queue_peek_head (items);
+          folder_display_name = g_filename_display_basename (lp->data);
+          display_name = g_filename_display_basename (g_file_peek_path (untrash->tp->data));
+
+          /* ask the user whether he wants to create the parent folder because its gone */
+          response = thunar_job_ask_create (THUNAR_JOB (transfer_job),
+                                            _("The folder \"%s\" does not exist anymore but is "
+                                              "required to restore the file \"%s\" from the "
+                                              "trash"),
+                                            folder_display_name, display_name);
+          g_free (display_name);
+
+          if (G_UNLIKELY (response == THUNAR_JOB_RESPONSE_CANCEL))
+            {
+              g_free (folder_display_name);
+              exo_job_cancel (EXO_JOB (transfer_job));
+              continue;
+            }
+
+          if (g_mkdir_with_parents (lp->data, 0777) != 0)
+            {
+              if (!exo_job_is_cancelled (EXO_JOB (transfer_job)))
+                g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
+                             _("Failed to restore the folder \"%s\""),
+                             folder_display_name);
+              g_free (folder_display_name);
+              continue;
+            }
+
+          g_free (folder_display_name);
+        }
+      else if (!S_ISDIR (statb.st_mode))
+        {
+          continue;
         }
 
-      /* try to create the parent directory */
-      if (!g_file_make_directory_with_parents (target_parent,
-                                               exo_job_get_cancellable (job),
-                                               error))
+      for (ip = items->head; ip != NULL && !exo_job_is_cancelled (EXO_JOB (transfer_job)); ip = ip->next)
         {
-          if (!exo_job_is_cancelled (job))
-            {
-              g_clear_error (error);
+          untrash = ip->data;
+          node = untrash->sp->data;
 
-              /* overwrite the internal GIO error with something more user-friendly */
-              g_set_error (error, G_IO_ERROR, G_IO_ERROR_FAILED,
-                           _("Failed to restore the folder \"%s\""),
-                           parent_display_name);
+          current_time = g_get_real_time ();
+          if (current_time - last_update_time > PROGRESS_MIN_INTERVAL)
+            {
+              display_name = g_filename_display_basename (g_file_peek_path (untrash->tp->data));
+              thunar_job_info_message (THUNAR_JOB (transfer_job), _("Trying to restore \"%s\""), display_name);
+              thunar_job_percent (THUNAR_JOB (transfer_job), (n_done * 100.0) / n_items);
+              g_free (display_name);
+              last_update_time = current_time;
             }
+          n_done++;
 
-          g_free (parent_display_name);
-          g_object_unref (info);
-          if (target_parent != NULL)
-            g_object_unref (target_parent);
-          return FALSE;
-        }
+          /* conflicts are asked for by the loop over the nodes, rename() would replace the target */
+          if (lstat (g_file_peek_path (untrash->tp->data), &statb) == 0 || errno != ENOENT)
+            continue;
 
-      /* clean up */
-      g_free (parent_display_name);
+          /* items on other volumes are moved by GVfs */
+          if (renameat (files_fd, untrash->name, AT_FDCWD, g_file_peek_path (untrash->tp->data)) != 0)
+            continue;
+
+          info_name = g_strconcat (untrash->name, ".trashinfo", NULL);
+          unlinkat (info_fd, info_name, 0);
+          g_free (info_name);
+
+          if (operation != NULL)
+            thunar_job_operation_add (operation, node->source_file, untrash->tp->data);
+
+          /* notify the thumbnail cache of the move operation */
+          thunar_thumbnail_cache_move_file (thumbnail_cache, node->source_file, untrash->tp->data);
+
+          /* add the target file to the new files list */
+          *new_files_list_p = thunar_g_list_prepend_deep (*new_files_list_p, untrash->tp->data);
+
+          /* release source and target files, and drop the matching list items */
+          thunar_transfer_node_free (node);
+          g_object_unref (untrash->tp->data);
+          transfer_job->source_node_list = g_list_delete_link (transfer_job->source_node_list, untrash->sp);
+          transfer_job->target_file_list = g_list_delete_link (transfer_job->target_file_list, untrash->tp);
+        }
     }
 
-  if (target_parent != NULL)
-    g_object_unref (target_parent);
-  return TRUE;
+  g_list_free (folder_paths);
+  g_hash_table_destroy (folders);
+
+  close (files_fd);
+  close (info_fd);
 }
+#endif
+
 
 
 static gboolean
@@ -1301,8 +3034,8 @@ thunar_transfer_job_move_file (ExoJob                *job,
   gboolean           move_successful;
 
   /* update progress information */
-  exo_job_info_message (job, _("Trying to move \"%s\""),
-                        g_file_info_get_display_name (info));
+  thunar_job_info_message (THUNAR_JOB (job), _("Trying to move \"%s\""),
+                           g_file_info_get_display_name (info));
 
   move_successful = g_file_move (node->source_file,
                                  tp->data,
@@ -1390,9 +3123,9 @@ thunar_transfer_job_move_file (ExoJob                *job,
       g_clear_error (error);
 
       /* update progress information */
-      exo_job_info_message (job, _("Could not move \"%s\" directly. "
-                                   "Collecting files for copying..."),
-                            g_file_info_get_display_name (info));
+      thunar_job_info_message (THUNAR_JOB (job), _("Could not move \"%s\" directly. "
+                                                   "Collecting files for copying..."),
+                               g_file_info_get_display_name (info));
 
       /* if this call fails to collect the node, err will be non-NULL and the loop will exit */
       thunar_transfer_job_collect_node (transfer_job, node, error);
@@ -1402,24 +3135,65 @@ thunar_transfer_job_move_file (ExoJob                *job,
 
 
 
-static gboolean
-thunar_transfer_job_device_id_in_job_list (const char *device_fs_id,
-                                           GList      *jobs)
+static guint
+thunar_transfer_job_device_n_jobs (const gchar *device_fs_id,
+                                   GList       *jobs)
 {
   ThunarTransferJob *job;
+  guint              n_jobs = 0;
 
   for (GList *ljobs = jobs; device_fs_id != NULL && ljobs != NULL; ljobs = ljobs->next)
     {
       if (THUNAR_IS_TRANSFER_JOB (ljobs->data))
         {
           job = THUNAR_TRANSFER_JOB (ljobs->data);
-          if (g_strcmp0 (device_fs_id, job->source_device_fs_id) == 0)
-            return TRUE;
-          if (g_strcmp0 (device_fs_id, job->target_device_fs_id) == 0)
-            return TRUE;
+          if (g_strcmp0 (device_fs_id, job->source_device_fs_id) == 0
+              || g_strcmp0 (device_fs_id, job->target_device_fs_id) == 0)
+            n_jobs++;
         }
     }
-  return FALSE;
+  return n_jobs;
+}
+
+
+
+static guint
+thunar_transfer_job_device_max_jobs (GFileInfo *file_info,
+                                     gboolean   is_local)
+{
+#ifdef HAVE_SYS_SYSMACROS_H
+  guint32  device;
+  gchar   *path;
+  gchar   *contents = NULL;
+#endif
+  guint    max_jobs = SOLID_STATE_DEVICE_JOBS;
+
+  /* remote devices are served one job after the other */
+  if (!is_local)
+    return 1;
+
+  if (file_info == NULL || !g_file_info_has_attribute (file_info, G_FILE_ATTRIBUTE_UNIX_DEVICE))
+    return max_jobs;
+
+#ifdef HAVE_SYS_SYSMACROS_H
+  /* ask the block layer whether the device has to seek, for partitions the
+   * queue attributes are found on the parent device */
+  device = g_file_info_get_attribute_uint32 (file_info, G_FILE_ATTRIBUTE_UNIX_DEVICE);
+  path = g_strdup_printf ("/sys/dev/block/%u:%u/queue/rotational", major (device), minor (device));
+  if (!g_file_get_contents (path, &contents, NULL, NULL))
+    {
+      g_free (path);
+      path = g_strdup_printf ("/sys/dev/block/%u:%u/../queue/rotational", major (device), minor (device));
+      g_file_get_contents (path, &contents, NULL, NULL);
+    }
+  g_free (path);
+
+  if (contents != NULL && contents[0] == '1')
+    max_jobs = 1;
+  g_free (contents);
+#endif
+
+  return max_jobs;
 }
 
 
@@ -1431,16 +3205,17 @@ thunar_transfer_job_fill_source_device_info (ThunarTransferJob *transfer_job,
   /* query device filesystem id (unique string)
    * The source exists and can be queried directly. */
   GFileInfo *file_info = g_file_query_info (file,
-                                            G_FILE_ATTRIBUTE_ID_FILESYSTEM,
+                                            G_FILE_ATTRIBUTE_ID_FILESYSTEM "," G_FILE_ATTRIBUTE_UNIX_DEVICE,
                                             G_FILE_QUERY_INFO_NONE,
                                             exo_job_get_cancellable (EXO_JOB (transfer_job)),
                                             NULL);
+  transfer_job->is_source_device_local = thunar_g_file_is_on_local_device (file);
+  transfer_job->source_device_max_jobs = thunar_transfer_job_device_max_jobs (file_info, transfer_job->is_source_device_local);
   if (file_info != NULL)
     {
       transfer_job->source_device_fs_id = g_strdup (g_file_info_get_attribute_string (file_info, G_FILE_ATTRIBUTE_ID_FILESYSTEM));
       g_object_unref (file_info);
     }
-  transfer_job->is_source_device_local = thunar_g_file_is_on_local_device (file);
 }
 
 
@@ -1456,19 +3231,18 @@ thunar_transfer_job_fill_target_device_info (ThunarTransferJob *transfer_job,
    * because that always exists. */
   GFile     *target_file = g_object_ref (file); /* start with target file */
   GFile     *target_parent;
-  GFileInfo *file_info;
+  GFileInfo *file_info = NULL;
   while (target_file != NULL)
     {
       /* query device id */
       file_info = g_file_query_info (target_file,
-                                     G_FILE_ATTRIBUTE_ID_FILESYSTEM,
+                                     G_FILE_ATTRIBUTE_ID_FILESYSTEM "," G_FILE_ATTRIBUTE_UNIX_DEVICE,
                                      G_FILE_QUERY_INFO_NONE,
                                      exo_job_get_cancellable (EXO_JOB (transfer_job)),
                                      NULL);
       if (file_info != NULL)
         {
           transfer_job->target_device_fs_id = g_strdup (g_file_info_get_attribute_string (file_info, G_FILE_ATTRIBUTE_ID_FILESYSTEM));
-          g_object_unref (file_info);
           break;
         }
       else /* target file or parent directory does not exist (yet) */
@@ -1481,81 +3255,70 @@ thunar_transfer_job_fill_target_device_info (ThunarTransferJob *transfer_job,
     }
   g_object_unref (target_file);
   transfer_job->is_target_device_local = thunar_g_file_is_on_local_device (file);
+  transfer_job->target_device_max_jobs = thunar_transfer_job_device_max_jobs (file_info, transfer_job->is_target_device_local);
+  if (file_info != NULL)
+    g_object_unref (file_info);
 }
 
 
 
 static void
 thunar_transfer_job_determine_copy_behavior (ThunarTransferJob *transfer_job,
-                                             gboolean          *freeze_if_src_busy_p,
-                                             gboolean          *freeze_if_tgt_busy_p,
-                                             gboolean          *always_parallel_copy_p,
+                                             guint             *max_src_jobs_p,
+                                             guint             *max_tgt_jobs_p,
                                              gboolean          *should_freeze_on_any_other_job_p)
 {
-  *freeze_if_src_busy_p = FALSE;
-  *freeze_if_tgt_busy_p = FALSE;
+  *max_src_jobs_p = G_MAXUINT;
+  *max_tgt_jobs_p = G_MAXUINT;
   *should_freeze_on_any_other_job_p = FALSE;
-  if (transfer_job->parallel_copy_mode == THUNAR_PARALLEL_COPY_MODE_ALWAYS)
-    /* never freeze, always parallel copies */
-    *always_parallel_copy_p = TRUE;
+  if (transfer_job->type == THUNAR_TRANSFER_JOB_MOVE
+      && transfer_job->is_source_device_local
+      && transfer_job->source_device_fs_id != NULL
+      && g_strcmp0 (transfer_job->source_device_fs_id, transfer_job->target_device_fs_id) == 0)
+    {
+      /* moves within one file system are renamed where possible, which
+       * neither waits for nor slows down the copies on that device */
+    }
+  else if (transfer_job->parallel_copy_mode == THUNAR_PARALLEL_COPY_MODE_ALWAYS)
+    {
+      /* never freeze, always parallel copies */
+    }
   else if (transfer_job->parallel_copy_mode == THUNAR_PARALLEL_COPY_MODE_ONLY_LOCAL)
     {
-      /* always parallel copy if:
-       * - source device is local
-       * AND
-       * - target device is local
-       */
-      *always_parallel_copy_p = transfer_job->is_source_device_local && transfer_job->is_target_device_local;
-      *freeze_if_src_busy_p = ! transfer_job->is_source_device_local;
-      *freeze_if_tgt_busy_p = ! transfer_job->is_target_device_local;
+      /* share each device between as many jobs as it can serve, which
+       * is a single job for remote and rotational devices */
+      *max_src_jobs_p = transfer_job->source_device_max_jobs;
+      *max_tgt_jobs_p = transfer_job->target_device_max_jobs;
     }
   else if (transfer_job->parallel_copy_mode == THUNAR_PARALLEL_COPY_MODE_ONLY_LOCAL_SAME_DEVICES)
     {
-      /* always parallel copy if:
-       * - source and target device fs are identical
-       * AND
-       * - source device is local
-       * AND
-       * - target device is local
-       */
       /* freeze copy if
        * - src device fs ≠ tgt device fs and src or tgt appears in another job
-       * OR
-       * - src device is not local and src device appears in another job
-       * OR
-       * - tgt device is not local and tgt device appears in another job
+       * or
+       * - same as THUNAR_PARALLEL_COPY_MODE_ONLY_LOCAL
        */
       if (g_strcmp0 (transfer_job->source_device_fs_id, transfer_job->target_device_fs_id) != 0)
         {
-          *always_parallel_copy_p = FALSE;
-          /* freeze when either src or tgt device appears on another job */
-          *freeze_if_src_busy_p = TRUE;
-          *freeze_if_tgt_busy_p = TRUE;
+          *max_src_jobs_p = 1;
+          *max_tgt_jobs_p = 1;
         }
-      else /* same as THUNAR_PARALLEL_COPY_MODE_ONLY_LOCAL */
+      else
         {
-          *always_parallel_copy_p = transfer_job->is_source_device_local && transfer_job->is_target_device_local;
-          *freeze_if_src_busy_p = ! transfer_job->is_source_device_local;
-          *freeze_if_tgt_busy_p = ! transfer_job->is_target_device_local;
+          *max_src_jobs_p = transfer_job->source_device_max_jobs;
+          *max_tgt_jobs_p = transfer_job->target_device_max_jobs;
         }
     }
   else if (transfer_job->parallel_copy_mode == THUNAR_PARALLEL_COPY_MODE_ONLY_LOCAL_IDLE_DEVICE)
     {
-      /* always parallel copy if:
-       * - source and target device fs are local
-       */
-      *always_parallel_copy_p = transfer_job->is_source_device_local && transfer_job->is_target_device_local;
-
       /* freeze copy if
        * - src / tgt device appears in another job
        */
-      *freeze_if_src_busy_p = TRUE;
-      *freeze_if_tgt_busy_p = TRUE;
+      *max_src_jobs_p = 1;
+      *max_tgt_jobs_p = 1;
     }
   else /* THUNAR_PARALLEL_COPY_MODE_NEVER */
     {
       /* freeze copy if another transfer job is running */
-      *always_parallel_copy_p = FALSE;
       *should_freeze_on_any_other_job_p = TRUE;
     }
 }
@@ -1564,16 +3327,24 @@ thunar_transfer_job_determine_copy_behavior (ThunarTransferJob *transfer_job,
 
 /**
  * thunar_transfer_job_can_start:
+ * @transfer_job      : a #ThunarTransferJob.
+ * @running_job_list  : the jobs which are currently running.
+ * @waiting_job_list  : the jobs queued before @transfer_job.
  *
+ * Schedules @transfer_job on the devices it reads from and writes to:
+ * each device is shared by as many running jobs as it can serve without
+ * seeking back and forth, and jobs waiting for a device are started in the
+ * order they were queued.
  *
+ * Return value: %TRUE if @transfer_job may be started now.
  **/
 gboolean
 thunar_transfer_job_can_start (ThunarTransferJob *transfer_job,
-                               GList             *running_job_list)
+                               GList             *running_job_list,
+                               GList             *waiting_job_list)
 {
-  gboolean freeze_if_src_busy;
-  gboolean freeze_if_tgt_busy;
-  gboolean always_parallel_copy;
+  guint    max_src_jobs;
+  guint    max_tgt_jobs;
   gboolean should_freeze_on_any_other_job;
 
   _thunar_return_val_if_fail (THUNAR_IS_TRANSFER_JOB (transfer_job), FALSE);
@@ -1582,31 +3353,204 @@ thunar_transfer_job_can_start (ThunarTransferJob *transfer_job,
   /* no source node list nor target file list */
   if (transfer_job->source_node_list == NULL || transfer_job->target_file_list == NULL)
     return TRUE;
-  /* first source file */
-  thunar_transfer_job_fill_source_device_info (transfer_job, ((ThunarTransferNode*) transfer_job->source_node_list->data)->source_file);
-  /* first target file */
-  thunar_transfer_job_fill_target_device_info (transfer_job, G_FILE (transfer_job->target_file_list->data));
+
+  /* the devices don't change while the job is waiting */
+  if (!transfer_job->device_info_filled)
+    {
+      /* first source file */
+      thunar_transfer_job_fill_source_device_info (transfer_job, ((ThunarTransferNode*) transfer_job->source_node_list->data)->source_file);
+      /* first target file */
+      thunar_transfer_job_fill_target_device_info (transfer_job, G_FILE (transfer_job->target_file_list->data));
+      transfer_job->device_info_filled = TRUE;
+    }
+
   thunar_transfer_job_determine_copy_behavior (transfer_job,
-                                               &freeze_if_src_busy,
-                                               &freeze_if_tgt_busy,
-                                               &always_parallel_copy,
+                                               &max_src_jobs,
+                                               &max_tgt_jobs,
                                                &should_freeze_on_any_other_job);
 
-  if (should_freeze_on_any_other_job && running_job_list != NULL)
+  if (should_freeze_on_any_other_job)
+    return running_job_list == NULL && waiting_job_list == NULL;
+
+  /* keep the order of the jobs queued for the same devices */
+  if (max_src_jobs != G_MAXUINT && thunar_transfer_job_device_n_jobs (transfer_job->source_device_fs_id, waiting_job_list) > 0)
+    return FALSE;
+  if (max_tgt_jobs != G_MAXUINT && thunar_transfer_job_device_n_jobs (transfer_job->target_device_fs_id, waiting_job_list) > 0)
+    return FALSE;
+
+  if (thunar_transfer_job_device_n_jobs (transfer_job->source_device_fs_id, running_job_list) >= max_src_jobs)
+    return FALSE;
+  if (thunar_transfer_job_device_n_jobs (transfer_job->target_device_fs_id, running_job_list) >= max_tgt_jobs)
     return FALSE;
-  if (freeze_if_src_busy && thunar_transfer_job_device_id_in_job_list (transfer_job->source_device_fs_id, running_job_list))
+
+  return TRUE;
+}
+
+
+
+/**
+ * thunar_transfer_job_shares_device:
+ * @transfer_job : a #ThunarTransferJob.
+ * @other        : another #ThunarTransferJob.
+ *
+ * Tells whether @transfer_job reads from or writes to one of the devices
+ * @other reads from or writes to. Only known for jobs that were queued
+ * with thunar_transfer_job_can_start().
+ *
+ * Return value: %TRUE if the jobs have a device in common.
+ **/
+gboolean
+thunar_transfer_job_shares_device (ThunarTransferJob *transfer_job,
+                                   ThunarTransferJob *other)
+{
+  GList jobs = { other, NULL, NULL };
+
+  _thunar_return_val_if_fail (THUNAR_IS_TRANSFER_JOB (transfer_job), FALSE);
+  _thunar_return_val_if_fail (THUNAR_IS_TRANSFER_JOB (other), FALSE);
+
+  if (!transfer_job->device_info_filled || !other->device_info_filled)
     return FALSE;
-  if (freeze_if_tgt_busy && thunar_transfer_job_device_id_in_job_list (transfer_job->target_device_fs_id, running_job_list))
+
+  return thunar_transfer_job_device_n_jobs (transfer_job->source_device_fs_id, &jobs) > 0
+         || thunar_transfer_job_device_n_jobs (transfer_job->target_device_fs_id, &jobs) > 0;
+}
+
+
+
+/* announces the files of the merged copies, which didn't run themselves */
+static void
+thunar_transfer_job_parts_finished (ThunarTransferJob *job)
+{
+  ThunarTransferPart *part;
+  GList              *cached_files;
+  GList              *lp;
+  GList              *fp;
+
+  for (lp = job->parts; lp != NULL; lp = lp->next)
+    {
+      part = lp->data;
+      if (part->new_files != NULL)
+        {
+          /* like thunar_job_new_files() */
+          cached_files = thunar_file_cache_lookup_batch (part->new_files);
+          for (fp = cached_files; fp != NULL; fp = fp->next)
+            if (fp->data != NULL)
+              thunar_file_reload_idle_unref (fp->data);
+          g_list_free (cached_files);
+
+          g_signal_emit_by_name (part->job, "new-files", part->new_files);
+        }
+
+      g_signal_emit_by_name (part->job, "finished");
+    }
+}
+
+
+
+/**
+ * thunar_transfer_job_merge:
+ * @job   : a #ThunarTransferJob, queued but not yet launched.
+ * @other : a #ThunarTransferJob, not yet launched.
+ *
+ * Takes over the files of @other, so both copies are done by @job
+ * one after the other, with a single collection of the files and a
+ * single progress. @other is never launched, it emits its "new-files"
+ * and "finished" signals after @job finished, and keeps its own
+ * undo record. Only copies between the same devices are merged, and
+ * only after thunar_transfer_job_can_start() queued both of them.
+ *
+ * Return value: %TRUE if @job took over the files of @other.
+ **/
+gboolean
+thunar_transfer_job_merge (ThunarTransferJob *job,
+                           ThunarTransferJob *other)
+{
+  ThunarTransferPart *part;
+  GList              *lp;
+
+  _thunar_return_val_if_fail (THUNAR_IS_TRANSFER_JOB (job), FALSE);
+  _thunar_return_val_if_fail (THUNAR_IS_TRANSFER_JOB (other), FALSE);
+
+  if (job == other
+      || job->type != THUNAR_TRANSFER_JOB_COPY
+      || other->type != THUNAR_TRANSFER_JOB_COPY
+      || job->journal != NULL
+      || other->journal != NULL
+      || job->source_node_list == NULL
+      || other->source_node_list == NULL
+      || other->parts != NULL
+      || !job->device_info_filled
+      || !other->device_info_filled
+      || job->target_device_fs_id == NULL
+      || g_strcmp0 (job->source_device_fs_id, other->source_device_fs_id) != 0
+      || g_strcmp0 (job->target_device_fs_id, other->target_device_fs_id) != 0)
     return FALSE;
 
+  if (job->parts == NULL)
+    g_signal_connect (job, "finished", G_CALLBACK (thunar_transfer_job_parts_finished), NULL);
+
+  part = g_slice_new0 (ThunarTransferPart);
+  part->job = g_object_ref (other);
+  part->index = g_list_length (job->parts) + 1;
+  job->parts = g_list_append (job->parts, part);
+
+  for (lp = other->source_node_list; lp != NULL; lp = lp->next)
+    ((ThunarTransferNode *) lp->data)->part = part;
+
+  job->source_node_list = g_list_concat (job->source_node_list, g_steal_pointer (&other->source_node_list));
+  job->target_file_list = g_list_concat (job->target_file_list, g_steal_pointer (&other->target_file_list));
+
   return TRUE;
 }
 
 
 
+/**
+ * thunar_transfer_job_resume:
+ * @job     : a #ThunarTransferJob, not yet launched.
+ * @journal : the #ThunarTransferJournal of the interrupted copy.
+ *
+ * Makes @job skip the files the interrupted copy recorded in @journal
+ * as completed and continue the file it was copying. @job takes over
+ * @journal and records its own progress in it.
+ **/
+void
+thunar_transfer_job_resume (ThunarTransferJob     *job,
+                            ThunarTransferJournal *journal)
+{
+  _thunar_return_if_fail (THUNAR_IS_TRANSFER_JOB (job));
+  _thunar_return_if_fail (job->journal == NULL);
+  _thunar_return_if_fail (journal != NULL);
+
+  job->journal = journal;
+}
+
+
+
 static gboolean
 thunar_transfer_job_execute (ExoJob  *job,
                              GError **error)
+{
+  ThunarTransferJob *transfer_job = THUNAR_TRANSFER_JOB (job);
+  gboolean           succeed;
+
+  _thunar_return_val_if_fail (THUNAR_IS_TRANSFER_JOB (job), FALSE);
+
+  /* the job runs in a shared thread, which gets its IO priority back */
+  thunar_transfer_job_apply_io_class (transfer_job);
+  succeed = thunar_transfer_job_transfer (job, error);
+  thunar_transfer_job_leave_io_class (transfer_job->io_prio_saved);
+  transfer_job->io_prio_saved = -1;
+  transfer_job->io_class_applied = THUNAR_TRANSFER_IO_CLASS_NORMAL;
+
+  return succeed;
+}
+
+
+
+static gboolean
+thunar_transfer_job_transfer (ExoJob  *job,
+                              GError **error)
 {
   ThunarThumbnailCache *thumbnail_cache;
   ThunarTransferNode   *node;
@@ -1616,10 +3560,13 @@ thunar_transfer_job_execute (ExoJob  *job,
   GFileInfo            *info;
   GError               *err = NULL;
   GList                *new_files_list = NULL;
+  GList                *source_file_list = NULL;
   GList                *snext;
   GList                *sp;
   GList                *tnext;
   GList                *tp;
+  GList                *lp;
+  ThunarTransferPart   *part;
 
   _thunar_return_val_if_fail (THUNAR_IS_TRANSFER_JOB (job), FALSE);
   _thunar_return_val_if_fail (error == NULL || *error == NULL, FALSE);
@@ -1627,7 +3574,7 @@ thunar_transfer_job_execute (ExoJob  *job,
   if (exo_job_set_error_if_cancelled (job, error))
     return FALSE;
 
-  exo_job_info_message (job, _("Collecting files..."));
+  thunar_job_info_message (THUNAR_JOB (job), _("Collecting files..."));
 
   /* take a reference on the thumbnail cache */
   application = thunar_application_get ();
@@ -1645,6 +3592,20 @@ thunar_transfer_job_execute (ExoJob  *job,
         operation = NULL;
     }
 
+  /* the merged copies keep their own undo records */
+  for (lp = transfer_job->parts; lp != NULL; lp = lp->next)
+    {
+      part = lp->data;
+      if (thunar_job_get_log_mode (THUNAR_JOB (part->job)) == THUNAR_OPERATION_LOG_OPERATIONS)
+        part->operation = thunar_job_operation_new (THUNAR_JOB_OPERATION_KIND_COPY);
+    }
+
+#ifdef UNTRASH_NATIVE
+  /* restoring files from the trash, which can be plenty of them */
+  if (transfer_job->type == THUNAR_TRANSFER_JOB_MOVE)
+    thunar_transfer_job_untrash_native (transfer_job, operation, thumbnail_cache, &new_files_list, &err);
+#endif
+
   for (sp = transfer_job->source_node_list, tp = transfer_job->target_file_list;
        sp != NULL && tp != NULL && err == NULL;
        sp = snext, tp = tnext)
@@ -1719,17 +3680,54 @@ thunar_transfer_job_execute (ExoJob  *job,
             }
         }
 
+      /* decide on the conflicts ahead all at once */
+      if (transfer_job->type == THUNAR_TRANSFER_JOB_COPY)
+        thunar_transfer_job_ask_conflicts (transfer_job);
+
+      /* big copies keep a journal, to resume them if thunar doesn't get to finish */
+      if (transfer_job->type == THUNAR_TRANSFER_JOB_COPY
+          && transfer_job->journal == NULL
+          && transfer_job->total_size >= JOURNAL_MIN_SIZE)
+        {
+          for (sp = transfer_job->source_node_list; sp != NULL; sp = sp->next)
+            source_file_list = g_list_prepend (source_file_list, ((ThunarTransferNode *) sp->data)->source_file);
+          source_file_list = g_list_reverse (source_file_list);
+
+          transfer_job->journal = thunar_transfer_journal_new (source_file_list, transfer_job->target_file_list);
+          g_list_free (source_file_list);
+        }
+
       /* transfer starts now */
       transfer_job->start_time = g_get_real_time ();
+      transfer_job->last_sample_time = transfer_job->start_time;
 
       /* perform the copy recursively for all source transfer nodes */
       for (sp = transfer_job->source_node_list, tp = transfer_job->target_file_list;
            sp != NULL && tp != NULL && err == NULL;
            sp = sp->next, tp = tp->next)
         {
-          thunar_transfer_job_copy_node (transfer_job, operation, sp->data, tp->data, NULL,
-                                         &new_files_list, &err);
+          part = ((ThunarTransferNode *) sp->data)->part;
+          if (G_UNLIKELY (part != NULL))
+            {
+              transfer_job->current_part = part->index;
+              thunar_transfer_job_copy_node (transfer_job, part->operation, sp->data, tp->data, NULL,
+                                             &part->new_files, &err);
+            }
+          else
+            {
+              transfer_job->current_part = 0;
+              thunar_transfer_job_copy_node (transfer_job, operation, sp->data, tp->data, NULL,
+                                             &new_files_list, &err);
+            }
+        }
+
+      /* wait for the files still being verified */
+      if (err == NULL && !g_queue_is_empty (&transfer_job->verify_queue))
+        {
+          thunar_job_info_message (THUNAR_JOB (job), _("Comparing checksums..."));
+          thunar_transfer_job_verify_collect (transfer_job, TRUE, &err);
         }
+
     }
 
   /* check if we failed */
@@ -1753,12 +3751,34 @@ thunar_transfer_job_execute (ExoJob  *job,
           g_object_unref (operation);
         }
 
+      /* the new files of the merged copies are announced when the job finished */
+      for (lp = transfer_job->parts; lp != NULL; lp = lp->next)
+        {
+          part = lp->data;
+          if (part->operation != NULL)
+            thunar_job_operation_history_commit (part->operation);
+        }
+
       return TRUE;
     }
 }
 
 
 
+static void
+thunar_transfer_part_free (gpointer data)
+{
+  ThunarTransferPart *part = data;
+
+  g_object_unref (part->job);
+  if (part->operation != NULL)
+    g_object_unref (part->operation);
+  thunar_g_list_free_full (part->new_files);
+  g_slice_free (ThunarTransferPart, part);
+}
+
+
+
 static void
 thunar_transfer_node_free (gpointer data)
 {
@@ -1787,6 +3807,47 @@ thunar_transfer_node_free (gpointer data)
 
 
 
+static guint64
+thunar_transfer_node_get_size (ThunarTransferNode *node)
+{
+  guint64 size = node->size;
+
+  for (node = node->children; node != NULL; node = node->next)
+    size += thunar_transfer_node_get_size (node);
+
+  return size;
+}
+
+
+
+static guint64
+thunar_transfer_node_get_n_files (ThunarTransferNode *node)
+{
+  guint64 n_files = 1;
+
+  for (node = node->children; node != NULL; node = node->next)
+    n_files += thunar_transfer_node_get_n_files (node);
+
+  return n_files;
+}
+
+
+
+static void
+thunar_transfer_verification_free (gpointer data)
+{
+  ThunarTransferVerification *verification = data;
+
+  g_object_unref (verification->source_file);
+  g_object_unref (verification->target_file);
+  g_free (verification->checksum);
+  g_free (verification->target_checksum);
+  g_clear_error (&verification->error);
+  g_slice_free (ThunarTransferVerification, verification);
+}
+
+
+
 ThunarJob *
 thunar_transfer_job_new (GList                *source_node_list,
                          GList                *target_file_list,
@@ -1836,11 +3897,60 @@ thunar_transfer_job_new (GList                *source_node_list,
 
 
 
+/**
+ * thunar_transfer_job_bind_preferences:
+ * @job         : a #ThunarTransferJob.
+ * @preferences : the object holding the transfer settings.
+ *
+ * Keeps the settings of @job in sync with the misc-file-size-binary,
+ * misc-parallel-copy-mode, misc-transfer-use-partial,
+ * misc-transfer-verify-file, misc-transfer-io-class,
+ * misc-transfer-bandwidth-limit and misc-transfer-skip-identical
+ * properties of @preferences. Without it the
+ * job uses the defaults of its own properties, so it can run without
+ * the #ThunarPreferences of the application.
+ **/
+void
+thunar_transfer_job_bind_preferences (ThunarTransferJob *job,
+                                      GObject           *preferences)
+{
+  _thunar_return_if_fail (THUNAR_IS_TRANSFER_JOB (job));
+  _thunar_return_if_fail (G_IS_OBJECT (preferences));
+  _thunar_return_if_fail (job->preferences == NULL);
+
+  job->preferences = g_object_ref (preferences);
+  g_object_bind_property (job->preferences, "misc-file-size-binary",
+                          job,              "file-size-binary",
+                          G_BINDING_SYNC_CREATE);
+  g_object_bind_property (job->preferences, "misc-parallel-copy-mode",
+                          job,              "parallel-copy-mode",
+                          G_BINDING_SYNC_CREATE);
+  g_object_bind_property (job->preferences, "misc-transfer-use-partial",
+                          job,              "transfer-use-partial",
+                          G_BINDING_SYNC_CREATE);
+  g_object_bind_property (job->preferences, "misc-transfer-verify-file",
+                          job,              "transfer-verify-file",
+                          G_BINDING_SYNC_CREATE);
+  g_object_bind_property (job->preferences, "misc-transfer-io-class",
+                          job,              "io-class",
+                          G_BINDING_SYNC_CREATE);
+  g_object_bind_property (job->preferences, "misc-transfer-bandwidth-limit",
+                          job,              "bandwidth-limit",
+                          G_BINDING_SYNC_CREATE);
+  g_object_bind_property (job->preferences, "misc-transfer-skip-identical",
+                          job,              "transfer-skip-identical",
+                          G_BINDING_SYNC_CREATE);
+}
+
+
+
 gchar *
 thunar_transfer_job_get_status (ThunarTransferJob *job)
 {
   gchar             *total_size_str;
   gchar             *total_progress_str;
+  gchar             *identical_size_str;
+  gchar             *written_size_str;
   gchar             *transfer_rate_str;
   GString           *status;
   gulong             remaining_time;
@@ -1849,6 +3959,10 @@ thunar_transfer_job_get_status (ThunarTransferJob *job)
 
   status = g_string_sized_new (100);
 
+  /* the merged copy being done, like "2 of 3: " */
+  if (job->parts != NULL)
+    g_string_append_printf (status, _("%u of %u: "), job->current_part + 1, g_list_length (job->parts) + 1);
+
   /* transfer status like "22.6MB of 134.1MB" */
   total_size_str = g_format_size_full (job->total_size, job->file_size_binary ? G_FORMAT_SIZE_IEC_UNITS : G_FORMAT_SIZE_DEFAULT);
   total_progress_str = g_format_size_full (job->total_progress, job->file_size_binary ? G_FORMAT_SIZE_IEC_UNITS : G_FORMAT_SIZE_DEFAULT);
@@ -1856,6 +3970,22 @@ thunar_transfer_job_get_status (ThunarTransferJob *job)
   g_free (total_size_str);
   g_free (total_progress_str);
 
+  /* the bytes which didn't need a copy, like "(1.2GB identical)" */
+  if (job->identical_size > 0)
+    {
+      identical_size_str = g_format_size_full (job->identical_size, job->file_size_binary ? G_FORMAT_SIZE_IEC_UNITS : G_FORMAT_SIZE_DEFAULT);
+      g_string_append_printf (status, _(" (%s identical, not copied)"), identical_size_str);
+      g_free (identical_size_str);
+    }
+
+  /* the bytes actually written, if sparse files were copied */
+  if (job->hole_size > 0 && job->total_progress > job->hole_size)
+    {
+      written_size_str = g_format_size_full (job->total_progress - job->hole_size, job->file_size_binary ? G_FORMAT_SIZE_IEC_UNITS : G_FORMAT_SIZE_DEFAULT);
+      g_string_append_printf (status, _(" (%s written)"), written_size_str);
+      g_free (written_size_str);
+    }
+
   /* show time and transfer rate after 10 seconds */
   if (job->transfer_rate > 0
       && (job->last_update_time - job->start_time) > MINIMUM_TRANSFER_TIME)
@@ -1864,6 +3994,10 @@ thunar_transfer_job_get_status (ThunarTransferJob *job)
       transfer_rate_str = g_format_size_full (job->transfer_rate, job->file_size_binary ? G_FORMAT_SIZE_IEC_UNITS : G_FORMAT_SIZE_DEFAULT);
       remaining_time = (job->total_size - job->total_progress) / job->transfer_rate;
 
+      /* many small files take longer than their size suggests */
+      if (job->files_rate > 0.0 && job->n_total_files > job->n_completed_files)
+        remaining_time = MAX (remaining_time, (gulong) ((job->n_total_files - job->n_completed_files) / job->files_rate));
+
       if (remaining_time > 0)
         {
           /* insert long dash */
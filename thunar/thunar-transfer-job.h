@@ -23,6 +23,8 @@
 
 #include <glib-object.h>
 
+#include "thunar/thunar-transfer-journal.h"
+
 G_BEGIN_DECLS
 
 /**
@@ -55,10 +57,23 @@ ThunarJob *thunar_transfer_job_new        (GList                *source_file_lis
                                            GList                *target_file_list,
                                            ThunarTransferJobType type) G_GNUC_MALLOC G_GNUC_WARN_UNUSED_RESULT;
 
+void       thunar_transfer_job_bind_preferences (ThunarTransferJob *job,
+                                                 GObject           *preferences);
+
 gchar     *thunar_transfer_job_get_status (ThunarTransferJob    *job);
 
 gboolean   thunar_transfer_job_can_start  (ThunarTransferJob *transfer_job,
-                                           GList             *running_job_list);
+                                           GList             *running_job_list,
+                                           GList             *waiting_job_list);
+
+gboolean   thunar_transfer_job_shares_device (ThunarTransferJob *transfer_job,
+                                              ThunarTransferJob *other);
+
+gboolean   thunar_transfer_job_merge      (ThunarTransferJob *job,
+                                           ThunarTransferJob *other);
+
+void       thunar_transfer_job_resume     (ThunarTransferJob     *job,
+                                           ThunarTransferJournal *journal);
 
 G_END_DECLS
 
@@ -0,0 +1,509 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#ifdef HAVE_ERRNO_H
+#include <errno.h>
+#endif
+#include <stdio.h>
+#ifdef HAVE_STDLIB_H
+#include <stdlib.h>
+#endif
+#ifdef HAVE_STRING_H
+#include <string.h>
+#endif
+
+#include <glib/gstdio.h>
+
+#include "thunar/thunar-gio-extensions.h"
+#include "thunar/thunar-private.h"
+#include "thunar/thunar-transfer-journal.h"
+
+/**
+ * SECTION:thunar-transfer-journal
+ * @Short_description: Persistent record of the progress of a copy
+ * @Title: ThunarTransferJournal
+ *
+ * A #ThunarTransferJournal is kept in the user's state directory while a big
+ * copy is running. It lists the files to copy, the targets completed so far
+ * and the number of bytes written to the .partial~ file of the target in
+ * progress. The journal is removed once the job ends, so the journals found
+ * at startup belong to copies interrupted by a crash or the end of the session,
+ * which can be resumed from them.
+ *
+ * The journal is a text file with one tab separated record per line, only
+ * appended to while copying:
+ *
+ *   thunar-transfer-journal-1
+ *   file    source-uri  target-uri
+ *   done    target-uri
+ *   offset  target-uri  bytes
+ **/
+
+
+
+/* The first record of every journal */
+#define THUNAR_TRANSFER_JOURNAL_MAGIC "thunar-transfer-journal-1"
+
+/* Minimum interval between two offset records */
+#define THUNAR_TRANSFER_JOURNAL_PROGRESS_INTERVAL G_USEC_PER_SEC
+
+
+
+struct _ThunarTransferJournal
+{
+  gchar      *path;
+  FILE       *stream;
+
+  GList      *source_file_list;
+  GList      *target_file_list;
+
+  /* records of the interrupted job, when resuming */
+  GHashTable *done;     /* target uri */
+  GHashTable *offsets;  /* target uri -> goffset */
+
+  gint64      last_progress_time;
+};
+
+
+
+static gchar *
+thunar_transfer_journal_get_directory (void)
+{
+#if GLIB_CHECK_VERSION (2, 72, 0)
+  return g_build_filename (g_get_user_state_dir (), "Thunar", "transfers", NULL);
+#else
+  return g_build_filename (g_get_home_dir (), ".local", "state", "Thunar", "transfers", NULL);
+#endif
+}
+
+
+
+static ThunarTransferJournal *
+thunar_transfer_journal_alloc (void)
+{
+  ThunarTransferJournal *journal;
+
+  journal = g_slice_new0 (ThunarTransferJournal);
+  journal->done = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+  journal->offsets = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+  return journal;
+}
+
+
+
+static void
+thunar_transfer_journal_append (ThunarTransferJournal *journal,
+                                const gchar           *record)
+{
+  if (journal->stream == NULL)
+    return;
+
+  /* written at once, so a crash never leaves more than the last line incomplete */
+  if (fputs (record, journal->stream) == EOF || fflush (journal->stream) == EOF)
+    {
+      g_warning ("Failed to write the transfer journal \"%s\"", journal->path);
+      fclose (journal->stream);
+      journal->stream = NULL;
+    }
+}
+
+
+
+/**
+ * thunar_transfer_journal_new:
+ * @source_file_list : the #GFile<!---->s to copy.
+ * @target_file_list : the #GFile<!---->s to copy them to.
+ *
+ * Creates a new journal for a copy of @source_file_list to @target_file_list.
+ *
+ * Return value: the new journal or %NULL if it can't be stored.
+ **/
+ThunarTransferJournal *
+thunar_transfer_journal_new (GList *source_file_list,
+                             GList *target_file_list)
+{
+  ThunarTransferJournal *journal;
+  GString               *contents;
+  GError                *err = NULL;
+  GList                 *sp, *tp;
+  gchar                 *directory;
+  gchar                 *name;
+  gchar                 *source_uri;
+  gchar                 *target_uri;
+
+  _thunar_return_val_if_fail (g_list_length (source_file_list) == g_list_length (target_file_list), NULL);
+
+  directory = thunar_transfer_journal_get_directory ();
+  if (g_mkdir_with_parents (directory, 0700) != 0)
+    {
+      g_free (directory);
+      return NULL;
+    }
+
+  journal = thunar_transfer_journal_alloc ();
+  name = g_strdup_printf ("%" G_GINT64_FORMAT "-%08x.journal", g_get_real_time (), g_random_int ());
+  journal->path = g_build_filename (directory, name, NULL);
+  journal->source_file_list = thunar_g_list_copy_deep (source_file_list);
+  journal->target_file_list = thunar_g_list_copy_deep (target_file_list);
+  g_free (directory);
+  g_free (name);
+
+  contents = g_string_new (THUNAR_TRANSFER_JOURNAL_MAGIC "\n");
+  for (sp = source_file_list, tp = target_file_list; sp != NULL && tp != NULL; sp = sp->next, tp = tp->next)
+    {
+      source_uri = g_file_get_uri (sp->data);
+      target_uri = g_file_get_uri (tp->data);
+      g_string_append_printf (contents, "file\t%s\t%s\n", source_uri, target_uri);
+      g_free (source_uri);
+      g_free (target_uri);
+    }
+
+  /* the list of files is written as a whole, the records are appended */
+  if (g_file_set_contents_full (journal->path, contents->str, contents->len,
+                                G_FILE_SET_CONTENTS_CONSISTENT, 0600, &err))
+    journal->stream = g_fopen (journal->path, "a");
+  g_string_free (contents, TRUE);
+
+  if (journal->stream == NULL)
+    {
+      g_warning ("Failed to create the transfer journal \"%s\": %s",
+                 journal->path, err != NULL ? err->message : g_strerror (errno));
+      g_clear_error (&err);
+      g_unlink (journal->path);
+      thunar_transfer_journal_free (journal);
+      return NULL;
+    }
+
+  return journal;
+}
+
+
+
+/**
+ * thunar_transfer_journal_load:
+ * @path  : the path of a journal returned by thunar_transfer_journal_list_pending().
+ * @error : return location for errors or %NULL.
+ *
+ * Loads the journal of an interrupted copy, to resume it. The records of
+ * the resumed copy are appended to the same journal.
+ *
+ * Return value: the journal or %NULL on error.
+ **/
+ThunarTransferJournal *
+thunar_transfer_journal_load (const gchar *path,
+                              GError     **error)
+{
+  ThunarTransferJournal *journal;
+  gchar                 *contents;
+  gchar                **lines;
+  gchar                **fields;
+  goffset               *offset;
+  gsize                  length;
+  guint                  n_lines;
+  guint                  n;
+
+  _thunar_return_val_if_fail (path != NULL, NULL);
+  _thunar_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  if (!g_file_get_contents (path, &contents, &length, error))
+    return NULL;
+
+  lines = g_strsplit (contents, "\n", -1);
+  n_lines = g_strv_length (lines);
+  g_free (contents);
+
+  /* the last line is only complete if the journal ends with a newline */
+  if (n_lines > 0)
+    n_lines--;
+
+  if (n_lines == 0 || strcmp (lines[0], THUNAR_TRANSFER_JOURNAL_MAGIC) != 0)
+    {
+      g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "\"%s\" is no transfer journal", path);
+      g_strfreev (lines);
+      return NULL;
+    }
+
+  journal = thunar_transfer_journal_alloc ();
+  journal->path = g_strdup (path);
+
+  for (n = 1; n < n_lines; n++)
+    {
+      fields = g_strsplit (lines[n], "\t", 3);
+      if (g_strcmp0 (fields[0], "file") == 0 && g_strv_length (fields) == 3)
+        {
+          journal->source_file_list = g_list_prepend (journal->source_file_list, g_file_new_for_uri (fields[1]));
+          journal->target_file_list = g_list_prepend (journal->target_file_list, g_file_new_for_uri (fields[2]));
+        }
+      else if (g_strcmp0 (fields[0], "done") == 0 && g_strv_length (fields) == 2)
+        {
+          g_hash_table_add (journal->done, g_strdup (fields[1]));
+          g_hash_table_remove (journal->offsets, fields[1]);
+        }
+      else if (g_strcmp0 (fields[0], "offset") == 0 && g_strv_length (fields) == 3)
+        {
+          offset = g_new (goffset, 1);
+          *offset = g_ascii_strtoll (fields[2], NULL, 10);
+          g_hash_table_insert (journal->offsets, g_strdup (fields[1]), offset);
+        }
+      g_strfreev (fields);
+    }
+  g_strfreev (lines);
+
+  journal->source_file_list = g_list_reverse (journal->source_file_list);
+  journal->target_file_list = g_list_reverse (journal->target_file_list);
+
+  if (journal->source_file_list == NULL)
+    {
+      g_set_error (error, G_FILE_ERROR, G_FILE_ERROR_INVAL, "The transfer journal \"%s\" lists no files", path);
+      thunar_transfer_journal_free (journal);
+      return NULL;
+    }
+
+  journal->stream = g_fopen (journal->path, "a");
+
+  return journal;
+}
+
+
+
+/**
+ * thunar_transfer_journal_free:
+ * @journal : a #ThunarTransferJournal.
+ *
+ * Releases @journal, keeping the journal file unless
+ * thunar_transfer_journal_remove() was called.
+ **/
+void
+thunar_transfer_journal_free (ThunarTransferJournal *journal)
+{
+  if (journal == NULL)
+    return;
+
+  if (journal->stream != NULL)
+    fclose (journal->stream);
+
+  thunar_g_list_free_full (journal->source_file_list);
+  thunar_g_list_free_full (journal->target_file_list);
+  g_hash_table_destroy (journal->done);
+  g_hash_table_destroy (journal->offsets);
+  g_free (journal->path);
+  g_slice_free (ThunarTransferJournal, journal);
+}
+
+
+
+/**
+ * thunar_transfer_journal_list_pending:
+ *
+ * Returns the paths of the journals left by interrupted copies, oldest
+ * first. The caller is responsible to free the returned list using
+ * g_list_free_full() with g_free().
+ *
+ * Return value: the list of journal paths.
+ **/
+GList *
+thunar_transfer_journal_list_pending (void)
+{
+  const gchar *name;
+  GList       *paths = NULL;
+  gchar       *directory;
+  GDir        *dir;
+
+  directory = thunar_transfer_journal_get_directory ();
+  dir = g_dir_open (directory, 0, NULL);
+  if (dir != NULL)
+    {
+      while ((name = g_dir_read_name (dir)) != NULL)
+        if (g_str_has_suffix (name, ".journal"))
+          paths = g_list_insert_sorted (paths, g_build_filename (directory, name, NULL), (GCompareFunc) g_strcmp0);
+      g_dir_close (dir);
+    }
+  g_free (directory);
+
+  return paths;
+}
+
+
+
+/**
+ * thunar_transfer_journal_get_files:
+ * @journal          : a #ThunarTransferJournal.
+ * @source_file_list : return location for the files to copy.
+ * @target_file_list : return location for their targets.
+ *
+ * Returns the files of the copy recorded by @journal. The caller is
+ * responsible to free both lists using thunar_g_list_free_full().
+ **/
+void
+thunar_transfer_journal_get_files (ThunarTransferJournal *journal,
+                                   GList                **source_file_list,
+                                   GList                **target_file_list)
+{
+  _thunar_return_if_fail (journal != NULL);
+
+  *source_file_list = thunar_g_list_copy_deep (journal->source_file_list);
+  *target_file_list = thunar_g_list_copy_deep (journal->target_file_list);
+}
+
+
+
+/**
+ * thunar_transfer_journal_is_done:
+ * @journal     : a #ThunarTransferJournal.
+ * @target_file : a target of the copy.
+ *
+ * Return value: %TRUE if the interrupted copy completed @target_file,
+ *               including its contents for folders.
+ **/
+gboolean
+thunar_transfer_journal_is_done (ThunarTransferJournal *journal,
+                                 GFile                 *target_file)
+{
+  gchar    *uri;
+  gboolean  is_done;
+
+  _thunar_return_val_if_fail (journal != NULL, FALSE);
+  _thunar_return_val_if_fail (G_IS_FILE (target_file), FALSE);
+
+  if (g_hash_table_size (journal->done) == 0)
+    return FALSE;
+
+  uri = g_file_get_uri (target_file);
+  is_done = g_hash_table_contains (journal->done, uri);
+  g_free (uri);
+
+  return is_done;
+}
+
+
+
+/**
+ * thunar_transfer_journal_get_offset:
+ * @journal     : a #ThunarTransferJournal.
+ * @target_file : a target of the copy.
+ *
+ * Return value: the number of bytes the interrupted copy wrote to the
+ *               .partial~ file of @target_file, or 0.
+ **/
+goffset
+thunar_transfer_journal_get_offset (ThunarTransferJournal *journal,
+                                    GFile                 *target_file)
+{
+  goffset *offset;
+  gchar   *uri;
+
+  _thunar_return_val_if_fail (journal != NULL, 0);
+  _thunar_return_val_if_fail (G_IS_FILE (target_file), 0);
+
+  if (g_hash_table_size (journal->offsets) == 0)
+    return 0;
+
+  uri = g_file_get_uri (target_file);
+  offset = g_hash_table_lookup (journal->offsets, uri);
+  g_free (uri);
+
+  return offset != NULL ? *offset : 0;
+}
+
+
+
+/**
+ * thunar_transfer_journal_done:
+ * @journal     : a #ThunarTransferJournal.
+ * @target_file : a target of the copy.
+ *
+ * Records that @target_file, including its contents for folders, is completed.
+ **/
+void
+thunar_transfer_journal_done (ThunarTransferJournal *journal,
+                              GFile                 *target_file)
+{
+  gchar *uri;
+  gchar *record;
+
+  _thunar_return_if_fail (journal != NULL);
+  _thunar_return_if_fail (G_IS_FILE (target_file));
+
+  uri = g_file_get_uri (target_file);
+  record = g_strconcat ("done\t", uri, "\n", NULL);
+  thunar_transfer_journal_append (journal, record);
+  g_free (record);
+  g_free (uri);
+
+  /* a new offset record may follow right away */
+  journal->last_progress_time = 0;
+}
+
+
+
+/**
+ * thunar_transfer_journal_progress:
+ * @journal     : a #ThunarTransferJournal.
+ * @target_file : the target being copied.
+ * @offset      : the number of bytes written so far.
+ *
+ * Records the progress of the copy of @target_file, at most once a second.
+ **/
+void
+thunar_transfer_journal_progress (ThunarTransferJournal *journal,
+                                  GFile                 *target_file,
+                                  goffset                offset)
+{
+  gint64  now;
+  gchar  *uri;
+  gchar  *record;
+
+  _thunar_return_if_fail (journal != NULL);
+  _thunar_return_if_fail (G_IS_FILE (target_file));
+
+  now = g_get_monotonic_time ();
+  if (now - journal->last_progress_time < THUNAR_TRANSFER_JOURNAL_PROGRESS_INTERVAL)
+    return;
+  journal->last_progress_time = now;
+
+  uri = g_file_get_uri (target_file);
+  record = g_strdup_printf ("offset\t%s\t%" G_GINT64_FORMAT "\n", uri, (gint64) offset);
+  thunar_transfer_journal_append (journal, record);
+  g_free (record);
+  g_free (uri);
+}
+
+
+
+/**
+ * thunar_transfer_journal_remove:
+ * @journal : a #ThunarTransferJournal.
+ *
+ * Deletes the journal file once the copy ended, so it isn't resumed.
+ **/
+void
+thunar_transfer_journal_remove (ThunarTransferJournal *journal)
+{
+  _thunar_return_if_fail (journal != NULL);
+
+  if (journal->stream != NULL)
+    {
+      fclose (journal->stream);
+      journal->stream = NULL;
+    }
+
+  g_unlink (journal->path);
+}
@@ -0,0 +1,53 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __THUNAR_TRANSFER_JOURNAL_H__
+#define __THUNAR_TRANSFER_JOURNAL_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct _ThunarTransferJournal ThunarTransferJournal;
+
+ThunarTransferJournal *thunar_transfer_journal_new           (GList                 *source_file_list,
+                                                              GList                 *target_file_list);
+ThunarTransferJournal *thunar_transfer_journal_load          (const gchar           *path,
+                                                              GError               **error);
+void                   thunar_transfer_journal_free          (ThunarTransferJournal *journal);
+
+GList                 *thunar_transfer_journal_list_pending  (void) G_GNUC_MALLOC;
+
+void                   thunar_transfer_journal_get_files     (ThunarTransferJournal *journal,
+                                                              GList                **source_file_list,
+                                                              GList                **target_file_list);
+
+gboolean               thunar_transfer_journal_is_done       (ThunarTransferJournal *journal,
+                                                              GFile                 *target_file);
+goffset                thunar_transfer_journal_get_offset    (ThunarTransferJournal *journal,
+                                                              GFile                 *target_file);
+
+void                   thunar_transfer_journal_done          (ThunarTransferJournal *journal,
+                                                              GFile                 *target_file);
+void                   thunar_transfer_journal_progress      (ThunarTransferJournal *journal,
+                                                              GFile                 *target_file,
+                                                              goffset                offset);
+
+void                   thunar_transfer_journal_remove        (ThunarTransferJournal *journal);
+
+G_END_DECLS
+
+#endif /* !__THUNAR_TRANSFER_JOURNAL_H__ */
@@ -30,6 +30,7 @@
 #endif
 
 #include "thunar/thunar-folder.h"
+#include "thunar/thunar-folder-index.h"
 #include "thunar/thunar-gio-extensions.h"
 #include "thunar/thunar-pango-extensions.h"
 #include "thunar/thunar-preferences.h"
@@ -47,6 +48,10 @@
                                       && node->children->data == NULL \
                                       && node->children->next == NULL)
 
+/* time spent per idle callback inserting folders or walking the
+ * tree, so the side pane is still redrawn in between */
+#define THUNAR_TREE_MODEL_IDLE_BUDGET (8 * 1000) /* in µs */
+
 
 
 /* Property identifiers */
@@ -58,6 +63,15 @@ enum
 
 
 
+/* What the walk over the whole tree does on each node */
+typedef enum
+{
+  THUNAR_TREE_MODEL_WALK_SORT    = 1 << 0,
+  THUNAR_TREE_MODEL_WALK_VISIBLE = 1 << 1,
+} ThunarTreeModelWalkFlags;
+
+
+
 typedef struct _ThunarTreeModelItem ThunarTreeModelItem;
 
 
@@ -112,6 +126,12 @@ static void                 thunar_tree_model_sort                    (ThunarTre
                                                                        GNode                  *node);
 static gboolean             thunar_tree_model_cleanup_idle            (gpointer                user_data);
 static void                 thunar_tree_model_cleanup_idle_destroy    (gpointer                user_data);
+static gboolean             thunar_tree_model_insert_idle             (gpointer                user_data);
+static void                 thunar_tree_model_insert_idle_destroy     (gpointer                user_data);
+static void                 thunar_tree_model_walk                    (ThunarTreeModel        *model,
+                                                                       guint                   flags);
+static gboolean             thunar_tree_model_walk_idle               (gpointer                user_data);
+static void                 thunar_tree_model_walk_idle_destroy       (gpointer                user_data);
 static void                 thunar_tree_model_device_added            (ThunarDeviceMonitor    *device_monitor,
                                                                        ThunarDevice           *device,
                                                                        ThunarTreeModel        *model);
@@ -132,12 +152,17 @@ static ThunarTreeModelItem *thunar_tree_model_item_new_with_device    (ThunarTre
 static void                 thunar_tree_model_item_free               (ThunarTreeModelItem    *item);
 static void                 thunar_tree_model_item_reset              (ThunarTreeModelItem    *item);
 static void                 thunar_tree_model_item_load_folder        (ThunarTreeModelItem    *item);
+static void                 thunar_tree_model_item_add_directories    (ThunarTreeModelItem    *item,
+                                                                       GList                  *directories,
+                                                                       gboolean                sorted);
+static void                 thunar_tree_model_item_drop_pending       (ThunarTreeModelItem    *item);
 static void                 thunar_tree_model_item_files_added        (ThunarTreeModelItem    *item,
                                                                        GList                  *files,
-                                                                       ThunarFolder           *folder);
+                                                                       ThunarFolderIndex      *index);
 static void                 thunar_tree_model_item_files_removed      (ThunarTreeModelItem    *item,
                                                                        GList                  *files,
-                                                                       ThunarFolder           *folder);
+                                                                       ThunarFolderIndex      *index);
+static void                 thunar_tree_model_item_trash_changed      (ThunarTreeModelItem    *item);
 static void                 thunar_tree_model_item_files_changed      (ThunarTreeModelItem    *item,
                                                                        GList                  *files,
                                                                        ThunarFolder           *folder);
@@ -156,12 +181,10 @@ static gboolean             thunar_tree_model_node_traverse_changed   (GNode
                                                                        gpointer                user_data);
 static gboolean             thunar_tree_model_node_traverse_remove    (GNode                  *node,
                                                                        gpointer                user_data);
-static gboolean             thunar_tree_model_node_traverse_sort      (GNode                  *node,
-                                                                       gpointer                user_data);
 static gboolean             thunar_tree_model_node_traverse_free      (GNode                  *node,
                                                                        gpointer                user_data);
-static gboolean             thunar_tree_model_node_traverse_visible   (GNode                  *node,
-                                                                       gpointer                user_data);
+static gboolean             thunar_tree_model_node_refilter           (ThunarTreeModel        *model,
+                                                                       GNode                  *node);
 static gboolean             thunar_tree_model_get_case_sensitive      (ThunarTreeModel        *model);
 static void                 thunar_tree_model_set_case_sensitive      (ThunarTreeModel        *model,
                                                                        gboolean                case_sensitive);
@@ -201,20 +224,39 @@ struct _ThunarTreeModel
   GNode                      *network;
 
   guint                       cleanup_idle_id;
+
+  /* items with sub folders waiting to be inserted, the most recently expanded first */
+  GQueue                      pending_items;
+  guint                       insert_idle_id;
+
+  /* nodes left to visit by the walk over the whole tree */
+  GQueue                      walk_nodes;
+  guint                       walk_flags;
+  guint                       walk_idle_id;
 };
 
 struct _ThunarTreeModelItem
 {
-  gint             ref_count;
-  guint            load_idle_id;
-  ThunarFile      *file;
-  ThunarFolder    *folder;
-  ThunarDevice    *device;
-  ThunarTreeModel *model;
+  gint               ref_count;
+  guint              load_idle_id;
+  ThunarFile        *file;
+  ThunarFolder      *folder;
+  ThunarDevice      *device;
+  ThunarTreeModel   *model;
+
+  /* the sub folders of the folder, shared with the other
+   * models, or NULL for the trash */
+  ThunarFolderIndex *index;
 
   /* list of children of this node that are
    * not visible in the treeview */
-  GSList          *invisible_children;
+  GSList            *invisible_children;
+
+  /* sub folders waiting to be inserted, the link in the pending
+   * items of the model, and whether they need to be sorted */
+  GList             *pending;
+  GList             *pending_link;
+  gboolean           pending_unsorted;
 };
 
 typedef struct
@@ -389,6 +431,13 @@ thunar_tree_model_finalize (GObject *object)
   if (model->cleanup_idle_id != 0)
     g_source_remove (model->cleanup_idle_id);
 
+  /* stop inserting folders and walking the tree */
+  if (model->insert_idle_id != 0)
+    g_source_remove (model->insert_idle_id);
+  if (model->walk_idle_id != 0)
+    g_source_remove (model->walk_idle_id);
+  g_queue_clear (&model->walk_nodes);
+
   /* release all resources allocated to the model */
   g_node_traverse (model->root, G_POST_ORDER, G_TRAVERSE_ALL, -1, thunar_tree_model_node_traverse_free, NULL);
   g_node_destroy (model->root);
@@ -942,6 +991,140 @@ thunar_tree_model_cleanup_idle_destroy (gpointer user_data)
 
 
 
+static gboolean
+thunar_tree_model_insert_idle (gpointer user_data)
+{
+  ThunarTreeModelItem *item;
+  ThunarTreeModel     *model = THUNAR_TREE_MODEL (user_data);
+  ThunarFile          *file;
+  GNode               *node;
+  gint64               end_time;
+  guint                n;
+
+  end_time = g_get_monotonic_time () + THUNAR_TREE_MODEL_IDLE_BUDGET;
+
+  while (!g_queue_is_empty (&model->pending_items))
+    {
+      /* the folder the user expanded last comes first */
+      item = g_queue_peek_head (&model->pending_items);
+      node = g_node_find (model->root, G_POST_ORDER, G_TRAVERSE_ALL, item);
+      _thunar_return_val_if_fail (node != NULL, FALSE);
+
+      for (n = 1; item->pending != NULL; ++n)
+        {
+          file = item->pending->data;
+          item->pending = g_list_delete_link (item->pending, item->pending);
+
+          /* if this file should be visible */
+          if (model->visible_func (model, file, model->visible_data))
+            thunar_tree_model_add_child (model, node, file);
+          else
+            item->invisible_children = g_slist_prepend (item->invisible_children, g_object_ref (G_OBJECT (file)));
+
+          g_object_unref (G_OBJECT (file));
+
+          /* continue in the next idle callback, after the redraw */
+          if (n % 16 == 0 && g_get_monotonic_time () >= end_time)
+            return TRUE;
+        }
+
+      g_queue_delete_link (&model->pending_items, item->pending_link);
+      item->pending_link = NULL;
+
+      /* sort the folders if any were not added in the order of the index */
+      if (item->pending_unsorted)
+        {
+          item->pending_unsorted = FALSE;
+          thunar_tree_model_sort (model, node);
+        }
+
+      /* the dummy was kept while the sub folders were inserted */
+      if (item->folder != NULL && !thunar_folder_get_loading (item->folder) && G_NODE_HAS_DUMMY (node))
+        thunar_tree_model_node_drop_dummy (node, model);
+
+      if (g_get_monotonic_time () >= end_time)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+
+
+static void
+thunar_tree_model_insert_idle_destroy (gpointer user_data)
+{
+  THUNAR_TREE_MODEL (user_data)->insert_idle_id = 0;
+}
+
+
+
+static void
+thunar_tree_model_walk (ThunarTreeModel *model,
+                        guint            flags)
+{
+  /* a walk in progress starts over, doing both */
+  model->walk_flags |= flags;
+  g_queue_clear (&model->walk_nodes);
+  g_queue_push_head (&model->walk_nodes, model->root);
+
+  if (model->walk_idle_id == 0)
+    {
+      model->walk_idle_id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE, thunar_tree_model_walk_idle,
+                                             model, thunar_tree_model_walk_idle_destroy);
+    }
+}
+
+
+
+static gboolean
+thunar_tree_model_walk_idle (gpointer user_data)
+{
+  ThunarTreeModel *model = THUNAR_TREE_MODEL (user_data);
+  GNode           *child_node;
+  GNode           *node;
+  gint64           end_time;
+
+  end_time = g_get_monotonic_time () + THUNAR_TREE_MODEL_IDLE_BUDGET;
+
+  while (!g_queue_is_empty (&model->walk_nodes))
+    {
+      node = g_queue_pop_head (&model->walk_nodes);
+
+      /* the node is gone if it is filtered out now */
+      if ((model->walk_flags & THUNAR_TREE_MODEL_WALK_VISIBLE) != 0
+          && thunar_tree_model_node_refilter (model, node))
+        continue;
+
+      /* we don't want to sort the children of the root node */
+      if ((model->walk_flags & THUNAR_TREE_MODEL_WALK_SORT) != 0
+          && node != model->root && !G_NODE_HAS_DUMMY (node))
+        thunar_tree_model_sort (model, node);
+
+      /* visit the sub folders next, in the order of the tree */
+      for (child_node = g_node_last_child (node); child_node != NULL; child_node = g_node_prev_sibling (child_node))
+        if (child_node->data != NULL)
+          g_queue_push_head (&model->walk_nodes, child_node);
+
+      if (g_get_monotonic_time () >= end_time)
+        return TRUE;
+    }
+
+  model->walk_flags = 0;
+
+  return FALSE;
+}
+
+
+
+static void
+thunar_tree_model_walk_idle_destroy (gpointer user_data)
+{
+  THUNAR_TREE_MODEL (user_data)->walk_idle_id = 0;
+}
+
+
+
 static void
 thunar_tree_model_item_files_changed (ThunarTreeModelItem *item,
                                       GList               *files,
@@ -1215,6 +1398,9 @@ thunar_tree_model_item_reset (ThunarTreeModelItem *item)
   if (G_UNLIKELY (item->load_idle_id != 0))
     g_source_remove (item->load_idle_id);
 
+  /* forget the folders not inserted yet */
+  thunar_tree_model_item_drop_pending (item);
+
   /* disconnect from the folder */
   if (G_LIKELY (item->folder != NULL))
     {
@@ -1223,6 +1409,14 @@ thunar_tree_model_item_reset (ThunarTreeModelItem *item)
       item->folder = NULL;
     }
 
+  /* disconnect from the index */
+  if (G_LIKELY (item->index != NULL))
+    {
+      g_signal_handlers_disconnect_by_data (G_OBJECT (item->index), item);
+      g_object_unref (G_OBJECT (item->index));
+      item->index = NULL;
+    }
+
   /* free all the invisible children */
   if (item->invisible_children != NULL)
     {
@@ -1252,60 +1446,71 @@ thunar_tree_model_item_load_folder (ThunarTreeModelItem *item)
       item->load_idle_id = g_idle_add_full (G_PRIORITY_HIGH, thunar_tree_model_item_load_idle,
                                             item, thunar_tree_model_item_load_idle_destroy);
     }
+  else if (item->pending_link != NULL)
+    {
+      /* expanded again while its folders are inserted, so insert them first */
+      g_queue_unlink (&item->model->pending_items, item->pending_link);
+      g_queue_push_head_link (&item->model->pending_items, item->pending_link);
+    }
 }
 
 
 
 static void
-thunar_tree_model_item_files_added (ThunarTreeModelItem *item,
-                                    GList               *files,
-                                    ThunarFolder        *folder)
+thunar_tree_model_item_add_directories (ThunarTreeModelItem *item,
+                                        GList               *directories,
+                                        gboolean             sorted)
 {
-  ThunarTreeModel     *model = THUNAR_TREE_MODEL (item->model);
-  ThunarFile          *file;
-  GNode               *node = NULL;
-  GList               *lp;
+  ThunarTreeModel *model = item->model;
 
-  _thunar_return_if_fail (THUNAR_IS_FOLDER (folder));
-  _thunar_return_if_fail (item->folder == folder);
-  _thunar_return_if_fail (model->visible_func != NULL);
+  if (directories == NULL)
+    return;
+
+  /* the folders are inserted a few at a time, see thunar_tree_model_insert_idle() */
+  item->pending = g_list_concat (item->pending, thunar_g_list_copy_deep (directories));
+  if (!sorted)
+    item->pending_unsorted = TRUE;
 
-  /* someone added files to trash ... let's just update the trash icon and return */
-  if (thunar_file_is_trash (thunar_folder_get_corresponding_file (folder)))
+  if (item->pending_link == NULL)
     {
-      node = g_node_find (model->root, G_POST_ORDER, G_TRAVERSE_ALL, item);
-      thunar_tree_model_node_traverse_changed (node, thunar_folder_get_corresponding_file (folder));
-      return;
+      g_queue_push_head (&model->pending_items, item);
+      item->pending_link = model->pending_items.head;
     }
 
-  /* process all specified files */
-  for (lp = files; lp != NULL; lp = lp->next)
+  if (model->insert_idle_id == 0)
     {
-      /* we don't care for anything except folders */
-      file = THUNAR_FILE (lp->data);
-      if (!thunar_file_is_directory (file))
-        continue;
+      model->insert_idle_id = g_idle_add_full (G_PRIORITY_DEFAULT_IDLE, thunar_tree_model_insert_idle,
+                                               model, thunar_tree_model_insert_idle_destroy);
+    }
+}
 
-      /* if this file should be visible */
-      if (!model->visible_func (model, file, model->visible_data))
-        {
-          /* file is invisible, insert it in the invisible list and continue */
-          item->invisible_children = g_slist_prepend (item->invisible_children,
-                                                      g_object_ref (G_OBJECT (file)));
-          continue;
-        }
 
-      /* lookup the node for the item (on-demand) */
-      if (G_UNLIKELY (node == NULL))
-        node = g_node_find (model->root, G_POST_ORDER, G_TRAVERSE_ALL, item);
-      _thunar_return_if_fail (node != NULL);
 
-      thunar_tree_model_add_child (model, node, file);
+static void
+thunar_tree_model_item_drop_pending (ThunarTreeModelItem *item)
+{
+  if (item->pending_link != NULL)
+    {
+      g_queue_delete_link (&item->model->pending_items, item->pending_link);
+      item->pending_link = NULL;
     }
 
-  /* sort the folders if any new ones were added */
-  if (G_LIKELY (node != NULL))
-    thunar_tree_model_sort (model, node);
+  thunar_g_list_free_full (item->pending);
+  item->pending = NULL;
+  item->pending_unsorted = FALSE;
+}
+
+
+
+static void
+thunar_tree_model_item_files_added (ThunarTreeModelItem *item,
+                                    GList               *files,
+                                    ThunarFolderIndex   *index)
+{
+  _thunar_return_if_fail (THUNAR_IS_FOLDER_INDEX (index));
+  _thunar_return_if_fail (item->index == index);
+
+  thunar_tree_model_item_add_directories (item, files, FALSE);
 }
 
 
@@ -1313,7 +1518,7 @@ thunar_tree_model_item_files_added (ThunarTreeModelItem *item,
 static void
 thunar_tree_model_item_files_removed (ThunarTreeModelItem *item,
                                       GList               *files,
-                                      ThunarFolder        *folder)
+                                      ThunarFolderIndex   *index)
 {
   ThunarTreeModel *model = item->model;
   GtkTreePath     *path;
@@ -1321,22 +1526,16 @@ thunar_tree_model_item_files_removed (ThunarTreeModelItem *item,
   GNode           *child_node;
   GNode           *node;
   GList           *lp;
+  GList           *pending_link;
   GSList          *inv_link;
 
-  _thunar_return_if_fail (THUNAR_IS_FOLDER (folder));
-  _thunar_return_if_fail (item->folder == folder);
+  _thunar_return_if_fail (THUNAR_IS_FOLDER_INDEX (index));
+  _thunar_return_if_fail (item->index == index);
 
   /* determine the node for the folder */
   node = g_node_find (model->root, G_POST_ORDER, G_TRAVERSE_ALL, item);
   _thunar_return_if_fail (node != NULL);
 
-  /* someone removed files from trash ..let's just update the trash icon */
-  if (thunar_file_is_trash (thunar_folder_get_corresponding_file (folder)))
-    {
-      thunar_tree_model_node_traverse_changed (node, thunar_folder_get_corresponding_file (folder));
-      return;
-    }
-
   /* check if the node has any visible children */
   if (G_LIKELY (node->children != NULL))
     {
@@ -1383,6 +1582,36 @@ thunar_tree_model_item_files_removed (ThunarTreeModelItem *item,
             }
         }
     }
+
+  /* and the folders not inserted yet */
+  if (item->pending != NULL)
+    {
+      for (lp = files; lp != NULL; lp = lp->next)
+        {
+          pending_link = g_list_find (item->pending, lp->data);
+          if (pending_link != NULL)
+            {
+              g_object_unref (G_OBJECT (lp->data));
+              item->pending = g_list_delete_link (item->pending, pending_link);
+            }
+        }
+    }
+}
+
+
+
+static void
+thunar_tree_model_item_trash_changed (ThunarTreeModelItem *item)
+{
+  GNode *node;
+
+  _thunar_return_if_fail (THUNAR_IS_FOLDER (item->folder));
+
+  /* someone added or removed files in the trash ... let's just update the trash icon */
+  node = g_node_find (item->model->root, G_POST_ORDER, G_TRAVERSE_ALL, item);
+  _thunar_return_if_fail (node != NULL);
+
+  thunar_tree_model_node_traverse_changed (node, item->file);
 }
 
 
@@ -1398,8 +1627,9 @@ thunar_tree_model_item_notify_loading (ThunarTreeModelItem *item,
   _thunar_return_if_fail (item->folder == folder);
   _thunar_return_if_fail (THUNAR_IS_TREE_MODEL (item->model));
 
-  /* be sure to drop the dummy child node once the folder is loaded */
-  if (G_LIKELY (!thunar_folder_get_loading (folder)))
+  /* be sure to drop the dummy child node once the folder is loaded,
+   * or once its sub folders are inserted, see thunar_tree_model_insert_idle() */
+  if (G_LIKELY (!thunar_folder_get_loading (folder) && item->pending == NULL))
     {
       /* lookup the node for the item... */
       node = g_node_find (item->model->root, G_POST_ORDER, G_TRAVERSE_ALL, item);
@@ -1424,6 +1654,7 @@ thunar_tree_model_item_load_idle (gpointer user_data)
 #endif
 
   _thunar_return_val_if_fail (item->folder == NULL, FALSE);
+  _thunar_return_val_if_fail (item->index == NULL, FALSE);
 
 #ifndef NDEBUG
       /* find the node in the tree */
@@ -1450,22 +1681,43 @@ thunar_tree_model_item_load_idle (gpointer user_data)
   /* verify that we have a file */
   if (G_LIKELY (item->file != NULL))
     {
-      /* open the folder for the item */
-      item->folder = thunar_folder_get_for_file (item->file);
+      /* the trash only updates its icon, other folders show their sub folders */
+      if (thunar_file_is_trash (item->file))
+        {
+          item->folder = thunar_folder_get_for_file (item->file);
+          if (G_LIKELY (item->folder != NULL))
+            {
+              g_signal_connect_swapped (G_OBJECT (item->folder), "files-added", G_CALLBACK (thunar_tree_model_item_trash_changed), item);
+              g_signal_connect_swapped (G_OBJECT (item->folder), "files-removed", G_CALLBACK (thunar_tree_model_item_trash_changed), item);
+            }
+        }
+      else
+        {
+          /* open the index for the item, which is shared with the other models */
+          item->index = thunar_folder_index_get_for_file (item->file);
+          if (G_LIKELY (item->index != NULL))
+            {
+              item->folder = g_object_ref (thunar_folder_index_get_folder (item->index));
+              g_signal_connect_swapped (G_OBJECT (item->index), "directories-added", G_CALLBACK (thunar_tree_model_item_files_added), item);
+              g_signal_connect_swapped (G_OBJECT (item->index), "directories-removed", G_CALLBACK (thunar_tree_model_item_files_removed), item);
+            }
+        }
+
       if (G_LIKELY (item->folder != NULL))
         {
           /* connect signals */
-          g_signal_connect_swapped (G_OBJECT (item->folder), "files-added", G_CALLBACK (thunar_tree_model_item_files_added), item);
-          g_signal_connect_swapped (G_OBJECT (item->folder), "files-removed", G_CALLBACK (thunar_tree_model_item_files_removed), item);
           g_signal_connect_swapped (G_OBJECT (item->folder), "files-changed", G_CALLBACK (thunar_tree_model_item_files_changed), item);
           g_signal_connect_swapped (G_OBJECT (item->folder), "notify::loading", G_CALLBACK (thunar_tree_model_item_notify_loading), item);
 
-          /* load the initial set of files (if any) */
-          files = thunar_folder_get_files (item->folder);
-          if (G_UNLIKELY (files != NULL))
+          /* load the initial set of folders (if any), which the index sorted already */
+          if (item->index != NULL)
             {
-              thunar_tree_model_item_files_added (item, files, item->folder);
-              g_list_free (files);
+              files = thunar_folder_index_get_directories (item->index, item->model->sort_case_sensitive);
+              if (G_UNLIKELY (files != NULL))
+                {
+                  thunar_tree_model_item_add_directories (item, files, TRUE);
+                  g_list_free (files);
+                }
             }
 
           /* notify for "loading" if already loaded */
@@ -1565,6 +1817,17 @@ thunar_tree_model_node_traverse_cleanup (GNode    *node,
       g_object_unref (G_OBJECT (item->folder));
       item->folder = NULL;
 
+      /* and from the index */
+      if (item->index != NULL)
+        {
+          g_signal_handlers_disconnect_by_data (G_OBJECT (item->index), item);
+          g_object_unref (G_OBJECT (item->index));
+          item->index = NULL;
+        }
+
+      /* forget the folders not inserted yet */
+      thunar_tree_model_item_drop_pending (item);
+
       /* remove all the children of the node */
       while (node->children)
         g_node_traverse (node->children, G_POST_ORDER, G_TRAVERSE_ALL, -1,
@@ -1647,6 +1910,10 @@ thunar_tree_model_node_traverse_remove (GNode   *node,
       /* release the item for the node */
       thunar_tree_model_node_traverse_free (node, user_data);
 
+      /* the walk over the tree must not visit it any longer */
+      if (G_UNLIKELY (!g_queue_is_empty (&model->walk_nodes)))
+        g_queue_remove (&model->walk_nodes, node);
+
       /* remove the node from the tree */
       g_node_destroy (node);
 
@@ -1659,21 +1926,6 @@ thunar_tree_model_node_traverse_remove (GNode   *node,
 
 
 
-static gboolean
-thunar_tree_model_node_traverse_sort (GNode   *node,
-                                      gpointer user_data)
-{
-  ThunarTreeModel *model = THUNAR_TREE_MODEL (user_data);
-
-  /* we don't want to sort the children of the root node */
-  if (G_LIKELY (node != model->root))
-    thunar_tree_model_sort (model, node);
-
-  return FALSE;
-}
-
-
-
 static gboolean
 thunar_tree_model_node_traverse_free (GNode   *node,
                                       gpointer user_data)
@@ -1686,11 +1938,10 @@ thunar_tree_model_node_traverse_free (GNode   *node,
 
 
 static gboolean
-thunar_tree_model_node_traverse_visible (GNode    *node,
-                                         gpointer  user_data)
+thunar_tree_model_node_refilter (ThunarTreeModel *model,
+                                 GNode           *node)
 {
   ThunarTreeModelItem *item = node->data;
-  ThunarTreeModel     *model = THUNAR_TREE_MODEL (user_data);
   GtkTreePath         *path;
   GtkTreeIter          iter;
   GNode               *child_node;
@@ -1728,6 +1979,8 @@ thunar_tree_model_node_traverse_visible (GNode    *node,
           /* free the item and destroy the node */
           thunar_tree_model_item_free (item);
           g_node_destroy (node);
+
+          return TRUE;
         }
       else if (!G_NODE_HAS_DUMMY (node))
         {
@@ -1773,6 +2026,7 @@ thunar_tree_model_node_traverse_visible (GNode    *node,
         }
     }
 
+  /* the node is still in the tree */
   return FALSE;
 }
 
@@ -1819,8 +2073,8 @@ thunar_tree_model_set_case_sensitive (ThunarTreeModel *model,
       /* apply the new setting */
       model->sort_case_sensitive = case_sensitive;
 
-      /* resort the model with the new setting */
-      g_node_traverse (model->root, G_POST_ORDER, G_TRAVERSE_NON_LEAVES, -1, thunar_tree_model_node_traverse_sort, model);
+      /* resort the model with the new setting, a few folders at a time */
+      thunar_tree_model_walk (model, THUNAR_TREE_MODEL_WALK_SORT);
 
       /* notify listeners */
       g_object_notify (G_OBJECT (model), "case-sensitive");
@@ -1866,9 +2120,8 @@ thunar_tree_model_refilter (ThunarTreeModel *model)
 {
   _thunar_return_if_fail (THUNAR_IS_TREE_MODEL (model));
 
-  /* traverse all nodes to update their visibility */
-  g_node_traverse (model->root, G_PRE_ORDER, G_TRAVERSE_ALL, -1,
-                   thunar_tree_model_node_traverse_visible, model);
+  /* traverse all nodes to update their visibility, a few at a time */
+  thunar_tree_model_walk (model, THUNAR_TREE_MODEL_WALK_VISIBLE);
 }
 
 
@@ -37,6 +37,15 @@
  *
  * A Node's children are stored in sorted manner in a GSequence and additionally
  * a HashTable is used to quickly query and retrieve the required child.
+ *
+ * When a collapsed subdir is unloaded, its children are frozen into a #_Snapshot:
+ * a packed array with the name, a few flags and the modification time of each
+ * child, in their sorted order, plus the snapshots of the subdirs which were
+ * loaded below it. When the subdir is loaded again, the snapshot tells which
+ * children have children themselves without probing them, and if nothing
+ * changed the children are appended in the frozen order instead of being
+ * sorted again. All snapshots share SNAPSHOT_BUDGET; the subtrees frozen the
+ * longest time ago are dropped completely to stay within it.
  */
 
 
@@ -56,12 +65,12 @@
 
 #include "thunar/thunar-application.h"
 #include "thunar/thunar-file.h"
+#include "thunar/thunar-folder-index.h"
 #include "thunar/thunar-gobject-extensions.h"
 #include "thunar/thunar-tree-view-model.h"
 #include "thunar/thunar-preferences.h"
 #include "thunar/thunar-private.h"
 #include "thunar/thunar-user.h"
-#include "thunar/thunar-simple-job.h"
 #include "thunar/thunar-util.h"
 #include "thunar/thunar-io-jobs.h"
 #include "thunar/thunar-gio-extensions.h"
@@ -73,8 +82,30 @@
  * expanded before the delay elapses the scheduled cleanup will be cancelled */
 #define CLEANUP_AFTER_COLLAPSE_DELAY 5000 /* in ms */
 
+/* Memory shared by the snapshots of the unloaded subdirs of all models */
+#define SNAPSHOT_BUDGET (16 * 1024 * 1024) /* in bytes */
+
+/* The number of files with the longest names kept for the column sizing of the view */
+#define N_LONG_NAMES 8
+
 /* Defintions & typedefs */
-typedef struct _Node Node;
+typedef struct _Node     Node;
+typedef struct _Snapshot Snapshot;
+
+typedef enum
+{
+  SNAPSHOT_ENTRY_DIRECTORY    = 1 << 0,
+  SNAPSHOT_ENTRY_HAS_CHILDREN = 1 << 1,
+} SnapshotEntryFlags;
+
+typedef struct
+{
+  guint32   name_offset; /* into the names of the snapshot */
+  guint32   flags;       /* SnapshotEntryFlags */
+  guint64   mtime;       /* the flags are trusted as long as the child is unchanged */
+  Snapshot *subtree;     /* of a loaded subdir, or NULL */
+}
+SnapshotEntry;
 
 
 
@@ -197,6 +228,8 @@ static ThunarFile       *thunar_tree_view_model_get_file (ThunarStandardViewMode
 static GList            *thunar_tree_view_model_get_paths_for_files (ThunarStandardViewModel *model,
                                                                      GList                   *files);
 static ThunarJob        *thunar_tree_view_model_get_job (ThunarStandardViewModel *model);
+static ThunarStandardViewModelTotals
+                        *thunar_tree_view_model_get_totals (ThunarStandardViewModel *model);
 
 /* Setters */
 static void              thunar_tree_view_model_set_folder (ThunarStandardViewModel *model,
@@ -242,10 +275,27 @@ static void              thunar_tree_view_model_node_add_child (Node *node,
                                                                 Node *child);
 static void              thunar_tree_view_model_node_add_dummy_child (Node *node);
 static void              thunar_tree_view_model_node_drop_dummy_child (Node *node);
+static void              thunar_tree_view_model_node_append_child (Node *node,
+                                                                   Node *child);
 static void              thunar_tree_view_model_dir_add_file (Node       *node,
                                                               ThunarFile *file);
+static void              thunar_tree_view_model_dir_insert_file (Node       *node,
+                                                                 ThunarFile *file,
+                                                                 gboolean    append);
+static Snapshot         *thunar_tree_view_model_snapshot_new (Node *node);
+static void              thunar_tree_view_model_snapshot_free (Snapshot *snapshot);
+static SnapshotEntry    *thunar_tree_view_model_snapshot_lookup (Snapshot   *snapshot,
+                                                                 ThunarFile *file);
+static void              thunar_tree_view_model_node_set_snapshot (Node     *node,
+                                                                   Snapshot *snapshot);
+static Snapshot         *thunar_tree_view_model_node_take_snapshot (Node *node);
 static void              thunar_tree_view_model_dir_remove_file (Node       *node,
                                                                  ThunarFile *file);
+static void              thunar_tree_view_model_long_names_add (ThunarTreeViewModel *model,
+                                                                ThunarFile          *file);
+static void              thunar_tree_view_model_long_names_remove (ThunarTreeViewModel *model,
+                                                                   ThunarFile          *file);
+static void              thunar_tree_view_model_long_names_clear (ThunarTreeViewModel *model);
 static Node             *thunar_tree_view_model_locate_file (ThunarTreeViewModel *model,
                                                              ThunarFile          *file);
 static gint              thunar_tree_view_model_cmp_nodes (gconstpointer a,
@@ -254,14 +304,13 @@ static gint              thunar_tree_view_model_cmp_nodes (gconstpointer a,
 static void              thunar_tree_view_model_sort (ThunarTreeViewModel *model);
 static void              thunar_tree_view_model_load_dir (Node *node);
 static void              thunar_tree_view_model_cleanup_model (ThunarTreeViewModel *model);
-static void              thunar_tree_view_model_file_count_callback (ExoJob  *job,
-                                                                     gpointer node);
 static void              thunar_tree_view_model_node_destroy (Node *node);
 static void              thunar_tree_view_model_dir_files_changed (Node  *node,
                                                                    GList *files);
 static void              thunar_tree_view_model_set_loading (ThunarTreeViewModel *model,
                                                              gboolean             loading);
-static gboolean          thunar_tree_view_model_update_search_files (ThunarTreeViewModel *model);
+static void              thunar_tree_view_model_insert_search_files (GList    *files,
+                                                                     gpointer  user_data);
 static void              thunar_tree_view_model_add_search_files (ThunarStandardViewModel *model,
                                                                   GList                   *files);
 
@@ -296,6 +345,9 @@ struct _ThunarTreeViewModel
   Node                 *root;
   ThunarFolder         *dir;
 
+  /* running counts of the top level rows for the statusbar text */
+  ThunarStandardViewModelTotals *totals;
+
   /* Hashtable for quick access to all directories and sub-directories which are managed by this view
    * The key is the corresponding #ThunarFile of the directory, and the value is the #_Node of the directory */
   GHashTable           *subdirs;
@@ -317,11 +369,17 @@ struct _ThunarTreeViewModel
 
   gchar               **search_terms;
 
-  ThunarJob            *search_job;
-  GList                *search_files;
-  GMutex                mutex_add_search_files;
+  ThunarJob                      *search_job;
+  ThunarStandardViewModelResults *search_results;
 
-  guint                 update_search_results_timeout_id;
+  /* directory loaded ahead of its expansion, see thunar_tree_view_model_prefetch_subdir() */
+  ThunarFolderIndex    *prefetch_index;
+  guint                 prefetch_release_id;
+
+  /* the files with the longest display names, longest first,
+   * see thunar_tree_view_model_get_long_name_files() */
+  ThunarFile           *long_names[N_LONG_NAMES];
+  glong                 long_names_length[N_LONG_NAMES];
 };
 
 
@@ -330,6 +388,7 @@ struct _Node
 {
   ThunarFile          *file;
   ThunarFolder        *dir;
+  ThunarFolderIndex   *index; /* of dir, shared with the tree of the side pane */
 
   Node                *parent;
   GSequenceIter       *ptr; /* self ref */
@@ -348,6 +407,34 @@ struct _Node
   ThunarTreeViewModel *model;
 
   guint                scheduled_unload_id;
+
+  /* the frozen children while unloaded, and its link in snapshot_lru */
+  Snapshot            *snapshot;
+  GList               *snapshot_link;
+
+  /* the snapshot being thawed while the dir is loaded again */
+  Snapshot            *thawing;
+};
+
+
+
+struct _Snapshot
+{
+  guint64         mtime; /* of the dir, the order is only trusted while it is unchanged */
+
+  /* the order of the entries */
+  ThunarSortFunc  sort_func;
+  gint            sort_sign;
+  gboolean        sort_case_sensitive;
+  gboolean        sort_folders_first;
+
+  SnapshotEntry  *entries;
+  guint           n_entries;
+  gchar          *names; /* NUL terminated, one after the other */
+  gsize           size;  /* without the subtrees */
+
+  /* name -> entry index + 1, only built while thawing */
+  GHashTable     *index;
 };
 
 
@@ -365,6 +452,10 @@ static GParamSpec *tree_model_props[N_PROPERTIES] = {
   NULL,
 };
 
+/* the nodes owning a snapshot, the most recently frozen first */
+static GQueue      snapshot_lru = G_QUEUE_INIT;
+static gsize       snapshot_bytes = 0;
+
 
 
 static void
@@ -487,16 +578,15 @@ thunar_tree_view_model_init (ThunarTreeViewModel *model)
 #endif
 
   model->search_job = NULL;
-  model->update_search_results_timeout_id = 0;
+  model->search_results = thunar_standard_view_model_results_new (thunar_tree_view_model_insert_search_files, model);
 
   model->search_terms = NULL;
-  model->search_files = NULL;
-  g_mutex_init (&model->mutex_add_search_files);
 
   model->sort_func = thunar_file_compare_by_name;
   model->loading = 0;
 
   model->subdirs = g_hash_table_new (g_direct_hash, g_direct_equal);
+  model->totals = thunar_standard_view_model_totals_new ();
 }
 
 
@@ -537,6 +627,7 @@ thunar_tree_view_model_standard_view_model_init (ThunarStandardViewModelIface *i
   iface->set_file_size_binary = thunar_tree_view_model_set_file_size_binary;
   iface->set_folders_first = thunar_tree_view_model_set_folders_first;
   iface->add_search_files = thunar_tree_view_model_add_search_files;
+  iface->get_totals = thunar_tree_view_model_get_totals;
 }
 
 
@@ -567,9 +658,19 @@ thunar_tree_view_model_tree_model_init (GtkTreeModelIface *iface)
 static void
 thunar_tree_view_model_dispose (GObject *object)
 {
+  ThunarTreeViewModel *model = THUNAR_TREE_VIEW_MODEL (object);
+
   /* unlink from the folder (if any) */
   thunar_tree_view_model_set_folder (THUNAR_STANDARD_VIEW_MODEL (object), NULL, NULL);
 
+  /* release the prefetched directory (if any) */
+  if (model->prefetch_release_id != 0)
+    {
+      g_source_remove (model->prefetch_release_id);
+      model->prefetch_release_id = 0;
+    }
+  g_clear_object (&model->prefetch_index);
+
   (*G_OBJECT_CLASS (thunar_tree_view_model_parent_class)->dispose) (object);
 }
 
@@ -584,12 +685,15 @@ thunar_tree_view_model_finalize (GObject *object)
   thunar_tree_view_model_set_folder (THUNAR_STANDARD_VIEW_MODEL (object),
                                      NULL, NULL);
 
-  g_mutex_clear (&model->mutex_add_search_files);
+  thunar_standard_view_model_results_free (model->search_results);
 
   g_free (model->date_custom_style);
   g_strfreev (model->search_terms);
 
+  thunar_tree_view_model_long_names_clear (model);
+
   g_hash_table_destroy (model->subdirs);
+  thunar_standard_view_model_totals_free (model->totals);
 
   (*G_OBJECT_CLASS (thunar_tree_view_model_parent_class)->finalize) (object);
 }
@@ -1053,6 +1157,30 @@ thunar_tree_view_model_get_path (GtkTreeModel *model,
 
 
 
+static gboolean
+thunar_tree_view_model_memoize_column (ThunarFile *file,
+                                        gint        column)
+{
+  switch (column)
+    {
+    case THUNAR_COLUMN_GROUP:
+    case THUNAR_COLUMN_OWNER:
+    case THUNAR_COLUMN_PERMISSIONS:
+    case THUNAR_COLUMN_SIZE_IN_BYTES:
+    case THUNAR_COLUMN_TYPE:
+      return TRUE;
+
+    case THUNAR_COLUMN_SIZE:
+      /* item counts and free space change without the file changing */
+      return !thunar_file_is_mountable (file) && !thunar_file_is_directory (file);
+
+    default:
+      return FALSE;
+    }
+}
+
+
+
 static void
 thunar_tree_view_model_get_value (GtkTreeModel *model,
                                   GtkTreeIter  *iter,
@@ -1070,7 +1198,9 @@ thunar_tree_view_model_get_value (GtkTreeModel *model,
   GFile        *g_file;
   GFile        *g_file_parent = NULL;
   gchar        *str = NULL;
+  const gchar  *memoized;
   ThunarFile   *file = NULL;
+  gboolean      memoize;
 
   _thunar_return_if_fail (THUNAR_STANDARD_VIEW_MODEL (model));
   _thunar_return_if_fail (iter->stamp == (THUNAR_TREE_VIEW_MODEL (model))->stamp);
@@ -1080,6 +1210,20 @@ thunar_tree_view_model_get_value (GtkTreeModel *model,
   if (file != NULL)
     g_object_ref (file);
 
+  /* reuse the string formatted for an earlier query, until the file changes */
+  memoize = (file != NULL && thunar_tree_view_model_memoize_column (file, column));
+  if (memoize)
+    {
+      memoized = thunar_file_get_column_string (file, column, THUNAR_TREE_VIEW_MODEL (model)->file_size_binary);
+      if (memoized != NULL)
+        {
+          g_value_init (value, G_TYPE_STRING);
+          g_value_set_string (value, memoized);
+          g_object_unref (file);
+          return;
+        }
+    }
+
   switch (column)
     {
       case THUNAR_COLUMN_DATE_CREATED:
@@ -1194,7 +1338,9 @@ thunar_tree_view_model_get_value (GtkTreeModel *model,
           group = thunar_file_get_group (file);
         if (G_LIKELY (group != NULL))
           {
-            g_value_set_string (value, thunar_group_get_name (group));
+            /* don't block the redraw on the name service, and don't keep the placeholder */
+            g_value_set_string (value, thunar_group_peek_name (group));
+            memoize = memoize && thunar_group_is_resolved (group);
             g_object_unref (G_OBJECT (group));
           }
         else
@@ -1229,9 +1375,10 @@ thunar_tree_view_model_get_value (GtkTreeModel *model,
           user = thunar_file_get_user (file);
         if (G_LIKELY (user != NULL))
           {
-            /* determine sane display name for the owner */
-            name = thunar_user_get_name (user);
-            real_name = thunar_user_get_real_name (user);
+            /* determine sane display name for the owner, see the group above */
+            name = thunar_user_peek_name (user);
+            real_name = thunar_user_peek_real_name (user);
+            memoize = memoize && thunar_user_is_resolved (user);
             if (G_LIKELY (real_name != NULL))
               {
                 if (strcmp (name, real_name) == 0)
@@ -1285,7 +1432,7 @@ thunar_tree_view_model_get_value (GtkTreeModel *model,
             /* If the option is set to always show folder sizes as item counts, then give the folder's item count */
             else if (THUNAR_TREE_VIEW_MODEL (model)->folder_item_count == THUNAR_FOLDER_ITEM_COUNT_ALWAYS)
               {
-                item_count = thunar_file_get_file_count (file, G_CALLBACK (thunar_tree_view_model_file_count_callback), node);
+                item_count = thunar_file_get_file_count (file, TRUE);
                 g_value_take_string (value, g_strdup_printf (ngettext ("%u item", "%u items", item_count), item_count));
               }
 
@@ -1295,7 +1442,7 @@ thunar_tree_view_model_get_value (GtkTreeModel *model,
               {
                 if (thunar_file_is_local (file))
                   {
-                    item_count = thunar_file_get_file_count (file, G_CALLBACK (thunar_tree_view_model_file_count_callback), node);
+                    item_count = thunar_file_get_file_count (file, TRUE);
                     g_value_take_string (value, g_strdup_printf (ngettext ("%u item", "%u items", item_count), item_count));
                   }
                 else
@@ -1356,6 +1503,9 @@ thunar_tree_view_model_get_value (GtkTreeModel *model,
         break;
     }
 
+  if (memoize)
+    thunar_file_set_column_string (file, column, THUNAR_TREE_VIEW_MODEL (model)->file_size_binary, g_value_dup_string (value));
+
   if (file != NULL)
     g_object_unref (file);
 }
@@ -1621,15 +1771,7 @@ _thunar_tree_view_model_search_finished (ThunarJob           *job,
       model->search_job = NULL;
     }
 
-  if (model->update_search_results_timeout_id > 0)
-    {
-      thunar_tree_view_model_update_search_files (model);
-      g_source_remove (model->update_search_results_timeout_id);
-      model->update_search_results_timeout_id = 0;
-    }
-
-  thunar_g_list_free_full (model->search_files);
-  model->search_files = NULL;
+  thunar_standard_view_model_results_stop (model->search_results, TRUE);
 
   g_signal_emit_by_name (model, "search-done");
 }
@@ -1665,16 +1807,14 @@ thunar_tree_view_model_set_folder (ThunarStandardViewModel *model,
   _model = THUNAR_TREE_VIEW_MODEL (model);
 
   _thunar_tree_view_model_cancel_search_job (_model);
+  thunar_standard_view_model_results_stop (_model->search_results, FALSE);
 
-  if (_model->update_search_results_timeout_id != 0)
-    {
-      g_source_remove (_model->update_search_results_timeout_id);
-      _model->update_search_results_timeout_id = 0;
-    }
-  thunar_g_list_free_full (_model->search_files);
-  _model->search_files = NULL;
+  /* the rows of the root are search results only while searching */
+  g_strfreev (_model->search_terms);
+  _model->search_terms = NULL;
 
   thunar_tree_view_model_cleanup_model (_model);
+  thunar_standard_view_model_totals_clear (_model->totals);
   _model->root = NULL;
 
   if (g_hash_table_size (_model->subdirs) > 0)
@@ -1699,8 +1839,7 @@ thunar_tree_view_model_set_folder (ThunarStandardViewModel *model,
   else
     {
       search_query_normalized = thunar_g_utf8_normalize_for_search (search_query, TRUE, TRUE);
-      g_strfreev (_model->search_terms);
-      _model->search_terms = thunar_util_split_search_query (search_query_normalized, NULL);
+      _model->search_terms = thunar_util_split_search_query (search_query_normalized, NULL, NULL);
       if (_model->search_terms != NULL)
         {
           /* search the current folder
@@ -1710,8 +1849,8 @@ thunar_tree_view_model_set_folder (ThunarStandardViewModel *model,
           g_signal_connect (_model->search_job, "finished", G_CALLBACK (_thunar_tree_view_model_search_finished), _model);
           exo_job_launch (EXO_JOB (_model->search_job));
 
-          /* add new results to the model every X ms */
-          _model->update_search_results_timeout_id = g_timeout_add (500, G_SOURCE_FUNC (thunar_tree_view_model_update_search_files), _model);
+          /* add new results to the model every X ms, like the list model */
+          thunar_standard_view_model_results_start (_model->search_results);
         }
       g_free (search_query_normalized);
     }
@@ -1845,6 +1984,15 @@ thunar_tree_view_model_set_job (ThunarStandardViewModel *model,
 
 
 
+static ThunarStandardViewModelTotals *
+thunar_tree_view_model_get_totals (ThunarStandardViewModel *model)
+{
+  _thunar_return_val_if_fail (THUNAR_IS_TREE_VIEW_MODEL (model), NULL);
+  return THUNAR_TREE_VIEW_MODEL (model)->totals;
+}
+
+
+
 static gboolean
 thunar_tree_view_model_get_case_sensitive (ThunarTreeViewModel *model)
 {
@@ -2023,6 +2171,7 @@ thunar_tree_view_model_new_node (ThunarFile *file)
   _node->file = g_object_ref (file);
 
   _node->dir = NULL;
+  _node->index = NULL;
 
   /* Not been added to the model yet */
   _node->parent = NULL;
@@ -2039,6 +2188,10 @@ thunar_tree_view_model_new_node (ThunarFile *file)
 
   _node->scheduled_unload_id = 0;
 
+  _node->snapshot = NULL;
+  _node->snapshot_link = NULL;
+  _node->thawing = NULL;
+
   return _node;
 }
 
@@ -2052,6 +2205,7 @@ thunar_tree_view_model_new_dummy_node (void)
   _node->file = NULL;
 
   _node->dir = NULL;
+  _node->index = NULL;
 
   /* Not been added to the model yet */
   _node->parent = NULL;
@@ -2068,6 +2222,10 @@ thunar_tree_view_model_new_dummy_node (void)
 
   _node->scheduled_unload_id = 0;
 
+  _node->snapshot = NULL;
+  _node->snapshot_link = NULL;
+  _node->thawing = NULL;
+
   return _node;
 }
 
@@ -2207,22 +2365,102 @@ thunar_tree_view_model_node_drop_dummy_child (Node *node)
 
 
 
+static void
+thunar_tree_view_model_node_append_child (Node *node,
+                                          Node *child)
+{
+  GtkTreeIter    tree_iter;
+  GtkTreePath   *path;
+
+  THUNAR_WARN_VOID_RETURN (child->file == NULL);
+
+  /* the first child replaces the dummy node */
+  if (thunar_tree_view_model_node_has_dummy_child (node))
+    {
+      thunar_tree_view_model_node_add_child (node, child);
+      return;
+    }
+
+  child->depth = node->depth + 1;
+  child->parent = node;
+  child->model = node->model;
+
+  /* the caller knows that child sorts after all the other children */
+  node->n_children++;
+  child->ptr = g_sequence_append (node->children, child);
+
+  /* notify the view */
+  GTK_TREE_ITER_INIT (tree_iter, node->model->stamp, child->ptr);
+  path = gtk_tree_model_get_path (GTK_TREE_MODEL (node->model), &tree_iter);
+  gtk_tree_model_row_inserted (GTK_TREE_MODEL (node->model), path, &tree_iter);
+  gtk_tree_path_free (path);
+
+  g_hash_table_insert (node->set, child->file, child->ptr);
+}
+
+
+
 static void
 thunar_tree_view_model_dir_add_file (Node       *node,
                                      ThunarFile *file)
 {
-  GtkTreeIter  tree_iter;
-  GtkTreePath *path;
-  Node        *child;
+  thunar_tree_view_model_dir_insert_file (node, file, FALSE);
+}
+
+
+
+static void
+thunar_tree_view_model_dir_insert_file (Node       *node,
+                                        ThunarFile *file,
+                                        gboolean    append)
+{
+  SnapshotEntry *entry = NULL;
+  GtkTreeIter    tree_iter;
+  GtkTreePath   *path;
+  Node          *child;
+  gboolean       has_children;
 
   THUNAR_WARN_VOID_RETURN (g_hash_table_contains (node->set, file));
 
   child = thunar_tree_view_model_new_node (file);
-  thunar_tree_view_model_node_add_child (node, child);
+  if (append)
+    thunar_tree_view_model_node_append_child (node, child);
+  else
+    thunar_tree_view_model_node_add_child (node, child);
 
-  if (thunar_file_is_directory (file)
-      && !thunar_g_file_is_empty (thunar_file_get_file (file)))
-    thunar_tree_view_model_node_add_dummy_child (child);
+  /* the statusbar only summarizes the top level rows */
+  if (node == node->model->root)
+    thunar_standard_view_model_totals_add (node->model->totals, file);
+
+  thunar_tree_view_model_long_names_add (node->model, file);
+
+  /* the frozen state of the child, if it was loaded before */
+  if (node->thawing != NULL)
+    entry = thunar_tree_view_model_snapshot_lookup (node->thawing, file);
+  if (entry != NULL && entry->subtree != NULL)
+    {
+      thunar_tree_view_model_node_set_snapshot (child, entry->subtree);
+      entry->subtree = NULL;
+    }
+
+  if (thunar_file_is_directory (file))
+    {
+      if (entry != NULL && entry->mtime == thunar_file_get_date (file, THUNAR_FILE_DATE_MODIFIED))
+        has_children = (entry->flags & SNAPSHOT_ENTRY_HAS_CHILDREN) != 0;
+      else if (node == node->model->root && node->model->search_terms != NULL)
+        {
+          /* don't look into every folder found by a search, the children
+           * are loaded on expansion and an empty folder loses its expander */
+          has_children = TRUE;
+        }
+      else if (node->index != NULL)
+        has_children = thunar_folder_index_has_children (node->index, file);
+      else
+        has_children = thunar_g_file_has_children (thunar_file_get_file (file));
+
+      if (has_children)
+        thunar_tree_view_model_node_add_dummy_child (child);
+    }
 
   /* notify the model if a child has been added to previously empty folder */
   if (node->ptr != NULL && node->n_children == 1)
@@ -2253,6 +2491,11 @@ thunar_tree_view_model_dir_remove_file (Node       *node,
 
   thunar_tree_view_model_node_destroy (g_sequence_get (iter));
 
+  if (node == node->model->root)
+    thunar_standard_view_model_totals_remove (node->model->totals, file);
+
+  thunar_tree_view_model_long_names_remove (node->model, file);
+
   g_sequence_remove (iter);
   g_hash_table_remove (node->set, file);
   node->n_children--;
@@ -2276,6 +2519,73 @@ thunar_tree_view_model_dir_remove_file (Node       *node,
 
 
 
+static void
+thunar_tree_view_model_long_names_add (ThunarTreeViewModel *model,
+                                       ThunarFile          *file)
+{
+  glong length;
+  guint n;
+
+  /* the rows are only measured by their number of characters here */
+  length = g_utf8_strlen (thunar_file_get_display_name (file), -1);
+  if (length <= model->long_names_length[N_LONG_NAMES - 1])
+    return;
+
+  /* the same file may be inserted again after it was hidden */
+  thunar_tree_view_model_long_names_remove (model, file);
+
+  for (n = 0; n < N_LONG_NAMES - 1 && model->long_names_length[n] >= length; ++n)
+    ;
+
+  if (model->long_names[N_LONG_NAMES - 1] != NULL)
+    g_object_unref (model->long_names[N_LONG_NAMES - 1]);
+  memmove (model->long_names + n + 1, model->long_names + n, (N_LONG_NAMES - 1 - n) * sizeof (*model->long_names));
+  memmove (model->long_names_length + n + 1, model->long_names_length + n, (N_LONG_NAMES - 1 - n) * sizeof (*model->long_names_length));
+
+  model->long_names[n] = g_object_ref (file);
+  model->long_names_length[n] = length;
+}
+
+
+
+static void
+thunar_tree_view_model_long_names_remove (ThunarTreeViewModel *model,
+                                          ThunarFile          *file)
+{
+  guint n;
+
+  for (n = 0; n < N_LONG_NAMES && model->long_names[n] != NULL; ++n)
+    if (model->long_names[n] == file)
+      {
+        /* the next longest name is only found again by the next insertion,
+         * the view widens its columns lazily for the rows it shows anyway */
+        g_object_unref (file);
+        memmove (model->long_names + n, model->long_names + n + 1, (N_LONG_NAMES - 1 - n) * sizeof (*model->long_names));
+        memmove (model->long_names_length + n, model->long_names_length + n + 1, (N_LONG_NAMES - 1 - n) * sizeof (*model->long_names_length));
+        model->long_names[N_LONG_NAMES - 1] = NULL;
+        model->long_names_length[N_LONG_NAMES - 1] = 0;
+        break;
+      }
+}
+
+
+
+static void
+thunar_tree_view_model_long_names_clear (ThunarTreeViewModel *model)
+{
+  guint n;
+
+  for (n = 0; n < N_LONG_NAMES; ++n)
+    {
+      if (model->long_names[n] != NULL)
+        g_object_unref (model->long_names[n]);
+      model->long_names[n] = NULL;
+      model->long_names_length[n] = 0;
+    }
+}
+
+
+
 static Node *
 thunar_tree_view_model_locate_file (ThunarTreeViewModel *model,
                                     ThunarFile          *file)
@@ -2492,6 +2802,72 @@ _thunar_tree_view_model_dir_files_added (Node  *node,
 
 
 
+static void
+thunar_tree_view_model_dir_thaw_files (Node  *node,
+                                       GList *files)
+{
+  ThunarTreeViewModel *model = node->model;
+  SnapshotEntry       *entry;
+  Snapshot            *snapshot = node->thawing;
+  ThunarFile         **ordered;
+  ThunarFile          *file;
+  GList               *unknown = NULL;
+  GList               *lp;
+  guint                n;
+
+  /* the frozen order is only correct for the same names in the same order */
+  if (snapshot->mtime != thunar_file_get_date (node->file, THUNAR_FILE_DATE_MODIFIED)
+      || model->sort_func != thunar_file_compare_by_name
+      || snapshot->sort_func != model->sort_func
+      || snapshot->sort_sign != model->sort_sign
+      || snapshot->sort_case_sensitive != model->sort_case_sensitive
+      || snapshot->sort_folders_first != model->sort_folders_first
+      || node->n_children != 1
+      || !thunar_tree_view_model_node_has_dummy_child (node))
+    {
+      _thunar_tree_view_model_dir_files_added (node, files);
+      return;
+    }
+
+  ordered = g_new0 (ThunarFile *, snapshot->n_entries);
+  for (lp = files; lp != NULL; lp = lp->next)
+    {
+      file = THUNAR_FILE (lp->data);
+
+      /* see _thunar_tree_view_model_dir_files_added() */
+      if (thunar_file_is_hidden (file) && !g_hash_table_contains (node->hidden_files, file))
+        {
+          g_hash_table_add (node->hidden_files, g_object_ref (file));
+
+          if (!model->show_hidden)
+            continue;
+        }
+
+      if (g_hash_table_contains (node->set, file))
+        continue;
+
+      entry = thunar_tree_view_model_snapshot_lookup (snapshot, file);
+      if (entry != NULL)
+        ordered[entry - snapshot->entries] = file;
+      else
+        unknown = g_list_prepend (unknown, file);
+    }
+
+  /* append the known children in their frozen order, skipping the sort */
+  for (n = 0; n < snapshot->n_entries; ++n)
+    if (ordered[n] != NULL)
+      thunar_tree_view_model_dir_insert_file (node, ordered[n], TRUE);
+
+  /* e.g. hidden files which are shown now */
+  for (lp = unknown; lp != NULL; lp = lp->next)
+    thunar_tree_view_model_dir_insert_file (node, lp->data, FALSE);
+
+  g_list_free (unknown);
+  g_free (ordered);
+}
+
+
+
 static void
 _thunar_tree_view_model_dir_files_removed (Node  *node,
                                            GList *files)
@@ -2528,6 +2904,13 @@ _thunar_tree_view_model_dir_notify_loading (Node         *node,
     {
       node->loaded = TRUE;
 
+      /* all children are live again */
+      if (node->thawing != NULL)
+        {
+          thunar_tree_view_model_snapshot_free (node->thawing);
+          node->thawing = NULL;
+        }
+
       if (thunar_tree_view_model_node_has_dummy_child (node))
         thunar_tree_view_model_node_drop_dummy_child (node);
 
@@ -2553,8 +2936,14 @@ thunar_tree_view_model_load_dir (Node *node)
 
   thunar_tree_view_model_set_loading (node->model, TRUE);
 
-  node->dir = thunar_folder_get_for_file (node->file);
-  THUNAR_WARN_VOID_RETURN (node->dir == NULL);
+  /* thaw the children frozen when the dir was unloaded; that snapshot
+   * cannot be dropped for the budget while it is in use */
+  if (node->snapshot != NULL && node->thawing == NULL)
+    node->thawing = thunar_tree_view_model_node_take_snapshot (node);
+
+  node->index = thunar_folder_index_get_for_file (node->file);
+  THUNAR_WARN_VOID_RETURN (node->index == NULL);
+  node->dir = g_object_ref (thunar_folder_index_get_folder (node->index));
 
   g_signal_connect_swapped (G_OBJECT (node->dir), "destroy", G_CALLBACK (_thunar_tree_view_model_folder_destroy), node);
   g_signal_connect_swapped (G_OBJECT (node->dir), "error", G_CALLBACK (_thunar_tree_view_model_folder_error), node);
@@ -2566,7 +2955,11 @@ thunar_tree_view_model_load_dir (Node *node)
   files = thunar_folder_get_files (node->dir);
   if (files != NULL)
     {
-      _thunar_tree_view_model_dir_files_added (node, files);
+      /* all the files are known if the folder was loaded already */
+      if (node->thawing != NULL && !thunar_folder_get_loading (node->dir))
+        thunar_tree_view_model_dir_thaw_files (node, files);
+      else
+        _thunar_tree_view_model_dir_files_added (node, files);
       g_list_free (files);
     }
 
@@ -2613,36 +3006,15 @@ thunar_tree_view_model_cleanup_model (ThunarTreeViewModel *model)
       g_signal_handlers_disconnect_by_data (G_OBJECT (_node->dir), _node);
       g_object_unref (_node->dir);
       _node->dir = NULL;
+      g_clear_object (&_node->index);
     }
   g_list_free (values);
 
   /* clean up the nodes in the background*/
   g_idle_add ((GSourceFunc) _thunar_tree_view_model_cleanup_idle, model->root);
   model->root = NULL;
-}
-
 
-
-static void
-thunar_tree_view_model_file_count_callback (ExoJob  *job,
-                                            gpointer node)
-{
-  GArray              *param_values;
-  ThunarFile          *file;
-  GList               *files = NULL;
-
-  if (job == NULL)
-    return;
-
-  param_values = thunar_simple_job_get_param_values (THUNAR_SIMPLE_JOB (job));
-  file = THUNAR_FILE (g_value_get_object (&g_array_index (param_values, GValue, 0)));
-
-  if (file == NULL)
-    return;
-
-  files = g_list_append (files, file);
-  thunar_tree_view_model_dir_files_changed (node, files);
-  g_list_free (files);
+  thunar_tree_view_model_long_names_clear (model);
 }
 
 
@@ -2667,6 +3039,10 @@ thunar_tree_view_model_node_destroy (Node *node)
 
   THUNAR_WARN_VOID_RETURN (node->file == NULL);
 
+  thunar_tree_view_model_node_set_snapshot (node, NULL);
+  if (node->thawing != NULL)
+    thunar_tree_view_model_snapshot_free (node->thawing);
+
   if (node->dir != NULL)
     {
       g_signal_handlers_disconnect_by_data (G_OBJECT (node->dir), node);
@@ -2675,6 +3051,7 @@ thunar_tree_view_model_node_destroy (Node *node)
 
       g_hash_table_remove (node->model->subdirs, node->file);
       g_object_unref (node->dir);
+      g_clear_object (&node->index);
     }
 
   while (node->n_children > 0)
@@ -2741,6 +3118,10 @@ thunar_tree_view_model_dir_files_changed (Node  *node_parent,
 
       iter = node->ptr;
 
+      /* the size or type of the file may have changed */
+      if (node_parent == model->root)
+        thunar_standard_view_model_totals_changed (model->totals, file);
+
       pos_before = g_sequence_iter_get_position (iter);
       g_sequence_sort_changed (iter, thunar_tree_view_model_cmp_nodes, model);
       pos_after = g_sequence_iter_get_position (iter);
@@ -2783,7 +3164,7 @@ thunar_tree_view_model_dir_files_changed (Node  *node_parent,
         }
 
       if (thunar_file_is_directory (file)
-          && !thunar_g_file_is_empty (thunar_file_get_file (file))
+          && thunar_folder_index_has_children (node_parent->index, file)
           && !node->loaded
           && !thunar_tree_view_model_node_has_dummy_child (node))
         {
@@ -2802,6 +3183,155 @@ thunar_tree_view_model_dir_files_changed (Node  *node_parent,
 
 
 
+static Snapshot *
+thunar_tree_view_model_snapshot_new (Node *node)
+{
+  SnapshotEntry *entry;
+  GSequenceIter *iter;
+  const gchar   *name;
+  Snapshot      *snapshot;
+  GString       *names;
+  Node          *child;
+  guint          n = 0;
+
+  snapshot = g_new0 (Snapshot, 1);
+  snapshot->mtime = thunar_file_get_date (node->file, THUNAR_FILE_DATE_MODIFIED);
+  snapshot->sort_func = node->model->sort_func;
+  snapshot->sort_sign = node->model->sort_sign;
+  snapshot->sort_case_sensitive = node->model->sort_case_sensitive;
+  snapshot->sort_folders_first = node->model->sort_folders_first;
+  snapshot->entries = g_new (SnapshotEntry, node->n_children);
+  names = g_string_sized_new (node->n_children * 16);
+
+  for (iter = g_sequence_get_begin_iter (node->children);
+       !g_sequence_iter_is_end (iter);
+       iter = g_sequence_iter_next (iter))
+    {
+      child = g_sequence_get (iter);
+      if (child->file == NULL)
+        continue;
+
+      entry = &snapshot->entries[n++];
+      name = thunar_file_get_basename (child->file);
+      entry->name_offset = names->len;
+      g_string_append_len (names, name, strlen (name) + 1);
+      entry->flags = 0;
+      entry->mtime = thunar_file_get_date (child->file, THUNAR_FILE_DATE_MODIFIED);
+      entry->subtree = NULL;
+
+      if (thunar_file_is_directory (child->file))
+        {
+          entry->flags |= SNAPSHOT_ENTRY_DIRECTORY;
+
+          /* either the dummy child or the loaded children */
+          if (child->n_children > 0)
+            entry->flags |= SNAPSHOT_ENTRY_HAS_CHILDREN;
+
+          /* freeze the loaded subdirs as well, and take over the
+           * snapshots of subdirs which were unloaded before */
+          if (child->loaded && child->n_children > 0 && !thunar_tree_view_model_node_has_dummy_child (child))
+            entry->subtree = thunar_tree_view_model_snapshot_new (child);
+          else
+            entry->subtree = thunar_tree_view_model_node_take_snapshot (child);
+        }
+    }
+
+  snapshot->n_entries = n;
+  snapshot->size = sizeof (Snapshot) + node->n_children * sizeof (SnapshotEntry) + names->len;
+  snapshot->names = g_string_free (names, FALSE);
+
+  snapshot_bytes += snapshot->size;
+
+  return snapshot;
+}
+
+
+
+static void
+thunar_tree_view_model_snapshot_free (Snapshot *snapshot)
+{
+  guint n;
+
+  for (n = 0; n < snapshot->n_entries; ++n)
+    if (snapshot->entries[n].subtree != NULL)
+      thunar_tree_view_model_snapshot_free (snapshot->entries[n].subtree);
+
+  if (snapshot->index != NULL)
+    g_hash_table_destroy (snapshot->index);
+
+  snapshot_bytes -= snapshot->size;
+
+  g_free (snapshot->entries);
+  g_free (snapshot->names);
+  g_free (snapshot);
+}
+
+
+
+static SnapshotEntry *
+thunar_tree_view_model_snapshot_lookup (Snapshot   *snapshot,
+                                        ThunarFile *file)
+{
+  guint n;
+
+  if (G_UNLIKELY (snapshot->index == NULL))
+    {
+      snapshot->index = g_hash_table_new (g_str_hash, g_str_equal);
+      for (n = 0; n < snapshot->n_entries; ++n)
+        g_hash_table_insert (snapshot->index, snapshot->names + snapshot->entries[n].name_offset, GUINT_TO_POINTER (n + 1));
+    }
+
+  n = GPOINTER_TO_UINT (g_hash_table_lookup (snapshot->index, thunar_file_get_basename (file)));
+
+  return (n > 0) ? &snapshot->entries[n - 1] : NULL;
+}
+
+
+
+static void
+thunar_tree_view_model_node_set_snapshot (Node     *node,
+                                          Snapshot *snapshot)
+{
+  Node *oldest;
+
+  if (node->snapshot != NULL)
+    thunar_tree_view_model_snapshot_free (thunar_tree_view_model_node_take_snapshot (node));
+
+  if (snapshot == NULL)
+    return;
+
+  node->snapshot = snapshot;
+  g_queue_push_head (&snapshot_lru, node);
+  node->snapshot_link = snapshot_lru.head;
+
+  /* make room by dropping the subtrees frozen the longest time ago,
+   * which is this one if it exceeds the budget on its own */
+  while (snapshot_bytes > SNAPSHOT_BUDGET && !g_queue_is_empty (&snapshot_lru))
+    {
+      oldest = g_queue_peek_tail (&snapshot_lru);
+      thunar_tree_view_model_snapshot_free (thunar_tree_view_model_node_take_snapshot (oldest));
+    }
+}
+
+
+
+static Snapshot *
+thunar_tree_view_model_node_take_snapshot (Node *node)
+{
+  Snapshot *snapshot = node->snapshot;
+
+  if (snapshot != NULL)
+    {
+      g_queue_delete_link (&snapshot_lru, node->snapshot_link);
+      node->snapshot_link = NULL;
+      node->snapshot = NULL;
+    }
+
+  return snapshot;
+}
+
+
+
 static void
 thunar_tree_view_model_set_loading (ThunarTreeViewModel *model,
                                     gboolean             loading)
@@ -2848,15 +3378,28 @@ _thunar_tree_view_model_dir_unload_timeout (Node *node)
   GSequenceIter *iter;
   GtkTreeIter    tree_iter;
   GtkTreePath   *path;
+  Snapshot      *snapshot = NULL;
   Node          *_node;
 
+  /* freeze the children before they are destroyed */
+  if (node->loaded && node->n_children > 0 && !thunar_tree_view_model_node_has_dummy_child (node))
+    snapshot = thunar_tree_view_model_snapshot_new (node);
+
   node->loaded = FALSE;
 
+  /* unloaded before the thawing finished */
+  if (node->thawing != NULL)
+    {
+      thunar_tree_view_model_snapshot_free (node->thawing);
+      node->thawing = NULL;
+    }
+
   if (node->dir != NULL)
     {
       g_signal_handlers_disconnect_by_data (G_OBJECT (node->dir), node);
       g_object_unref (node->dir);
       node->dir = NULL;
+      g_clear_object (&node->index);
     }
 
   GTK_TREE_ITER_INIT (tree_iter, node->model->stamp, node->ptr);
@@ -2882,6 +3425,10 @@ _thunar_tree_view_model_dir_unload_timeout (Node *node)
 
   g_hash_table_remove (node->model->subdirs, node->file);
 
+  /* keep the frozen children if they fit into the budget */
+  if (snapshot != NULL)
+    thunar_tree_view_model_node_set_snapshot (node, snapshot);
+
   return G_SOURCE_REMOVE;
 }
 
@@ -2914,24 +3461,92 @@ thunar_tree_view_model_schedule_unload (ThunarTreeViewModel *model,
   node->scheduled_unload_id = g_timeout_add_full (G_PRIORITY_LOW, CLEANUP_AFTER_COLLAPSE_DELAY,
                                                   G_SOURCE_FUNC (_thunar_tree_view_model_dir_unload_timeout),
                                                   node, (GDestroyNotify) _thunar_tree_view_model_dir_unload_timeout_destroy);
+  g_source_set_name_by_id (node->scheduled_unload_id, "_thunar_tree_view_model_dir_unload_timeout");
 }
 
 
 
 static gboolean
-thunar_tree_view_model_update_search_files (ThunarTreeViewModel *model)
+thunar_tree_view_model_prefetch_release (gpointer user_data)
 {
-  ThunarFile *file;
-  gboolean    matched;
-  gchar      *name_n;
+  ThunarTreeViewModel *model = THUNAR_TREE_VIEW_MODEL (user_data);
+
+  model->prefetch_release_id = 0;
+  g_clear_object (&model->prefetch_index);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+/**
+ * thunar_tree_view_model_prefetch_subdir:
+ * @model : a #ThunarTreeViewModel.
+ * @iter  : a #GtkTreeIter pointing to a collapsed directory.
+ *
+ * Starts loading the local directory at @iter before it is expanded,
+ * so that thunar_tree_view_model_load_subdir() finds its files loaded
+ * already. Only one directory is prefetched at a time, and it is
+ * released again if it is not expanded within a few seconds.
+ **/
+void
+thunar_tree_view_model_prefetch_subdir (ThunarTreeViewModel *model,
+                                        GtkTreeIter         *iter)
+{
+  Node *node;
+
+  _thunar_return_if_fail (THUNAR_IS_TREE_VIEW_MODEL (model));
+  _thunar_return_if_fail (iter->stamp == model->stamp);
+  _thunar_return_if_fail (iter->user_data != NULL);
+
+  THUNAR_WARN_VOID_RETURN (g_sequence_iter_is_end (iter->user_data));
+
+  node = g_sequence_get (iter->user_data);
+  THUNAR_WARN_VOID_RETURN (node == NULL);
+
+  /* remote folders are not loaded speculatively */
+  if (node->file == NULL || node->loaded
+      || !thunar_file_is_directory (node->file)
+      || !thunar_file_is_local (node->file))
+    return;
+
+  if (model->prefetch_index != NULL
+      && thunar_folder_get_corresponding_file (thunar_folder_index_get_folder (model->prefetch_index)) == node->file)
+    return;
+
+  if (model->prefetch_release_id != 0)
+    g_source_remove (model->prefetch_release_id);
+  g_clear_object (&model->prefetch_index);
+
+  /* the folder keeps loading as long as the index is referenced,
+   * and thunar_folder_index_get_for_file() returns it again on expansion */
+  model->prefetch_index = thunar_folder_index_get_for_file (node->file);
+  model->prefetch_release_id = g_timeout_add_full (G_PRIORITY_LOW, CLEANUP_AFTER_COLLAPSE_DELAY,
+                                                   thunar_tree_view_model_prefetch_release, model, NULL);
+  g_source_set_name_by_id (model->prefetch_release_id, "thunar_tree_view_model_prefetch_release");
+}
+
+
+
+static void
+thunar_tree_view_model_insert_search_files (GList    *files,
+                                            gpointer  user_data)
+{
+  ThunarTreeViewModel *model = THUNAR_TREE_VIEW_MODEL (user_data);
+  ThunarFile          *file;
+  gboolean             matched;
+  gchar               *name_n;
 
-  g_mutex_lock (&model->mutex_add_search_files);
+  _thunar_return_if_fail (model->root != NULL);
 
-  for (GList *lp = model->search_files; lp != NULL; lp = lp->next)
+  /* the results are flat rows of the root, see thunar_tree_view_model_dir_insert_file() */
+  for (GList *lp = files; lp != NULL; lp = lp->next)
     {
-      /* take a reference on that file */
-      file = THUNAR_FILE (g_object_ref (G_OBJECT (lp->data)));
-      _thunar_return_val_if_fail (THUNAR_IS_FILE (file), TRUE);
+      file = THUNAR_FILE (lp->data);
+
+      /* the same file may be found twice, e.g. through recent:/// */
+      if (g_hash_table_contains (model->root->set, file))
+        continue;
 
       name_n = (gchar *) thunar_file_get_display_name (file);
       name_n = thunar_g_utf8_normalize_for_search (name_n, TRUE, TRUE);
@@ -2939,17 +3554,8 @@ thunar_tree_view_model_update_search_files (ThunarTreeViewModel *model)
       g_free (name_n);
 
       if (matched)
-        thunar_tree_view_model_dir_add_file (model->root, lp->data);
-
-      g_object_unref (file);
+        thunar_tree_view_model_dir_add_file (model->root, file);
     }
-
-  if (model->search_files != NULL)
-    g_list_free (model->search_files);
-  model->search_files = NULL;
-  g_mutex_unlock (&model->mutex_add_search_files);
-
-  return TRUE;
 }
 
 
@@ -2958,11 +3564,35 @@ static void
 thunar_tree_view_model_add_search_files (ThunarStandardViewModel *model,
                                          GList                   *files)
 {
-  ThunarTreeViewModel *_model = THUNAR_TREE_VIEW_MODEL (model);
+  thunar_standard_view_model_results_push (THUNAR_TREE_VIEW_MODEL (model)->search_results, files);
+}
 
-  g_mutex_lock (&_model->mutex_add_search_files);
 
-  _model->search_files = g_list_concat (_model->search_files, files);
 
-  g_mutex_unlock (&_model->mutex_add_search_files);
-}
\ No newline at end of file
+/**
+ * thunar_tree_view_model_get_long_name_files:
+ * @model : a #ThunarTreeViewModel.
+ *
+ * Returns the few files of @model with the longest display names,
+ * longest first. They are tracked while the files are inserted, so
+ * the view can size its name column without measuring every row.
+ *
+ * The caller is responsible to free the returned list using
+ * thunar_g_list_free_full() when no longer needed.
+ *
+ * Return value: the list of #ThunarFile<!---->s with the longest names.
+ **/
+GList *
+thunar_tree_view_model_get_long_name_files (ThunarTreeViewModel *model)
+{
+  GList *files = NULL;
+  guint  n;
+
+  _thunar_return_val_if_fail (THUNAR_IS_TREE_VIEW_MODEL (model), NULL);
+
+  for (n = N_LONG_NAMES; n > 0; --n)
+    if (model->long_names[n - 1] != NULL)
+      files = g_list_prepend (files, g_object_ref (model->long_names[n - 1]));
+
+  return files;
+}
@@ -41,6 +41,9 @@ void                     thunar_tree_view_model_load_subdir (ThunarTreeViewModel
                                                              GtkTreeIter         *iter);
 void                     thunar_tree_view_model_schedule_unload (ThunarTreeViewModel *model,
                                                                   GtkTreeIter         *iter);
+void                     thunar_tree_view_model_prefetch_subdir (ThunarTreeViewModel *model,
+                                                                  GtkTreeIter         *iter);
+GList                   *thunar_tree_view_model_get_long_name_files (ThunarTreeViewModel *model);
 G_END_DECLS;
 
 #endif /* !__THUNAR_TREE_VIEW_MODEL_H__ */
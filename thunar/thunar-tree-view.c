@@ -1005,8 +1005,18 @@ thunar_tree_view_drag_drop (GtkWidget      *widget,
        */
       view->drop_occurred = TRUE;
 
+      /* drags from this process hand over their files directly */
+      if (!view->drop_data_ready)
+        {
+          view->drop_file_list = thunar_dnd_dup_source_files (context);
+          view->drop_data_ready = (view->drop_file_list != NULL);
+        }
+
       /* request the drag data from the source. */
-      gtk_drag_get_data (widget, context, target, timestamp);
+      if (view->drop_data_ready)
+        thunar_tree_view_drag_data_received (widget, context, x, y, NULL, TARGET_TEXT_URI_LIST, timestamp);
+      else
+        gtk_drag_get_data (widget, context, target, timestamp);
     }
   else
     {
@@ -1040,6 +1050,13 @@ thunar_tree_view_drag_motion (GtkWidget      *widget,
       return FALSE;
     }
 
+  /* drags from this process hand over their files directly */
+  if (G_UNLIKELY (!view->drop_data_ready))
+    {
+      view->drop_file_list = thunar_dnd_dup_source_files (context);
+      view->drop_data_ready = (view->drop_file_list != NULL);
+    }
+
   /* request the drop data on-demand (if we don't have it already) */
   if (G_UNLIKELY (!view->drop_data_ready))
     {
@@ -46,12 +46,17 @@
 #include <unistd.h>
 #endif
 
+#include <errno.h>
+
 #include <glib-object.h>
+#include <gio/gio.h>
 
 #include <exo/exo.h>
 
 #include <libxfce4util/libxfce4util.h>
 
+#include "thunar/thunar-cache-registry.h"
+#include "thunar/thunar-private.h"
 #include "thunar/thunar-user.h"
 #include "thunar/thunar-util.h"
 
@@ -60,6 +65,29 @@
 /* the interval in which the user/group cache is flushed (in seconds) */
 #define THUNAR_USER_MANAGER_FLUSH_INTERVAL (10 * 60)
 
+/* whether the name service can be asked from the resolver thread */
+#if defined(HAVE_GETPWUID_R) && defined(HAVE_GETGRGID_R)
+#define THUNAR_USER_MANAGER_ASYNC
+#endif
+
+
+
+/* the result of a lookup in the resolver thread */
+typedef struct
+{
+  guint32  id;
+  gboolean found;
+  gchar   *name;
+  gchar   *gecos;  /* users only */
+  guint32  gid;    /* users only */
+}
+ThunarUserLookup;
+
+#ifdef THUNAR_USER_MANAGER_ASYNC
+static void thunar_user_manager_queue_group (guint32 id);
+static void thunar_user_manager_queue_user  (guint32 id);
+#endif
+
 
 
 
@@ -79,6 +107,7 @@ struct _ThunarGroup
 
   guint32 id;
   gchar  *name;
+  gchar  *id_name;  /* shown until the name is resolved */
 };
 
 
@@ -111,6 +140,7 @@ thunar_group_finalize (GObject *object)
   ThunarGroup *group = THUNAR_GROUP (object);
 
   /* release the group's name */
+  g_free (group->id_name);
   g_free (group->name);
 
   (*G_OBJECT_CLASS (thunar_group_parent_class)->finalize) (object);
@@ -180,8 +210,81 @@ thunar_group_get_name (ThunarGroup *group)
 
 
 
+/**
+ * thunar_group_peek_name:
+ * @group : a #ThunarGroup.
+ *
+ * Like thunar_group_get_name(), but never blocks on the name
+ * service. If the name of @group is not known yet, it is resolved
+ * in the background and the group id is returned as string. The
+ * #ThunarUserManager emits "changed" once the name arrived.
+ *
+ * Return value: the name of @group or its id.
+ **/
+const gchar*
+thunar_group_peek_name (ThunarGroup *group)
+{
+  g_return_val_if_fail (THUNAR_IS_GROUP (group), NULL);
+
+#ifdef THUNAR_USER_MANAGER_ASYNC
+  if (G_UNLIKELY (group->name == NULL))
+    {
+      /* queued once, on the first request */
+      if (group->id_name == NULL)
+        {
+          thunar_user_manager_queue_group (group->id);
+          group->id_name = g_strdup_printf ("%u", (guint) group->id);
+        }
+
+      return group->id_name;
+    }
+#endif
+
+  return thunar_group_get_name (group);
+}
+
+
+
+/**
+ * thunar_group_is_resolved:
+ * @group : a #ThunarGroup.
+ *
+ * Tells whether the name of @group is known, i.e. whether
+ * thunar_group_peek_name() returns more than a placeholder.
+ *
+ * Return value: %TRUE once the name of @group was looked up.
+ **/
+gboolean
+thunar_group_is_resolved (ThunarGroup *group)
+{
+  g_return_val_if_fail (THUNAR_IS_GROUP (group), FALSE);
+  return group->name != NULL;
+}
+
+
+
+#ifdef THUNAR_USER_MANAGER_ASYNC
+static void
+thunar_group_set_name (ThunarGroup *group,
+                       const gchar *name)
+{
+  /* keep the string if nothing changed, callers might still use it */
+  if (name != NULL && g_strcmp0 (group->name, name) == 0)
+    return;
+
+  g_free (group->name);
+  group->name = (name != NULL) ? g_strdup (name) : g_strdup_printf ("%u", (guint) group->id);
+}
+#endif
+
+
+
 static void        thunar_user_finalize          (GObject         *object);
 static void        thunar_user_load              (ThunarUser      *user);
+static void        thunar_user_set_passwd        (ThunarUser      *user,
+                                                  const gchar     *pw_name,
+                                                  const gchar     *pw_gecos,
+                                                  guint32          pw_gid);
 static ThunarUser *thunar_user_new               (guint32          id);
 static ThunarGroup*thunar_user_get_primary_group (ThunarUser      *user);
 
@@ -200,6 +303,7 @@ struct _ThunarUser
   guint32      id;
   gchar       *name;
   gchar       *real_name;
+  gchar       *id_name;  /* shown until the name is resolved */
 };
 
 
@@ -249,6 +353,7 @@ thunar_user_finalize (GObject *object)
     g_object_unref (G_OBJECT (user->primary_group));
 
   /* release the names */
+  g_free (user->id_name);
   g_free (user->real_name);
   g_free (user->name);
 
@@ -260,51 +365,84 @@ thunar_user_finalize (GObject *object)
 static void
 thunar_user_load (ThunarUser *user)
 {
-  ThunarUserManager *manager;
-  struct passwd     *pw;
-  const gchar       *s;
-  gchar             *name;
-  gchar             *t;
+  struct passwd *pw;
 
   g_return_if_fail (user->name == NULL);
 
   pw = getpwuid (user->id);
   if (G_LIKELY (pw != NULL))
-    {
-      manager = thunar_user_manager_get_default ();
+    thunar_user_set_passwd (user, pw->pw_name, pw->pw_gecos, pw->pw_gid);
+  else
+    thunar_user_set_passwd (user, NULL, NULL, 0);
+}
 
-      /* query name and primary group */
-      user->name = g_strdup (pw->pw_name);
-      user->primary_group = thunar_user_manager_get_group_by_id (manager, pw->pw_gid);
 
-      /* try to figure out the real name */
-      s = strchr (pw->pw_gecos, ',');
-      if (s != NULL)
-        user->real_name = g_strndup (pw->pw_gecos, s - pw->pw_gecos);
-      else if (pw->pw_gecos[0] != '\0')
-        user->real_name = g_strdup (pw->pw_gecos);
 
-      /* substitute '&' in the real_name with the account name */
-      if (G_LIKELY (user->real_name != NULL && strchr (user->real_name, '&') != NULL))
-        {
-          /* generate a version of the username with the first char upper'd */
-          name = g_strdup (user->name);
-          name[0] = g_ascii_toupper (name[0]);
+static void
+thunar_user_set_passwd (ThunarUser  *user,
+                        const gchar *pw_name,
+                        const gchar *pw_gecos,
+                        guint32      pw_gid)
+{
+  ThunarUserManager *manager;
+  const gchar       *s;
+  gchar             *real_name = NULL;
+  gchar             *name;
+  gchar             *t;
 
-          /* replace all occurances of '&' */
-          t = xfce_str_replace (user->real_name, "&", name);
-          g_free (user->real_name);
-          user->real_name = t;
+  if (G_UNLIKELY (pw_name == NULL))
+    {
+      if (user->name == NULL)
+        user->name = g_strdup_printf ("%u", (guint) user->id);
+      return;
+    }
 
-          /* clean up */
-          g_free (name);
-        }
+  /* try to figure out the real name */
+  s = strchr (pw_gecos, ',');
+  if (s != NULL)
+    real_name = g_strndup (pw_gecos, s - pw_gecos);
+  else if (pw_gecos[0] != '\0')
+    real_name = g_strdup (pw_gecos);
 
-      g_object_unref (G_OBJECT (manager));
+  /* substitute '&' in the real_name with the account name */
+  if (G_LIKELY (real_name != NULL && strchr (real_name, '&') != NULL))
+    {
+      /* generate a version of the username with the first char upper'd */
+      name = g_strdup (pw_name);
+      name[0] = g_ascii_toupper (name[0]);
+
+      /* replace all occurances of '&' */
+      t = xfce_str_replace (real_name, "&", name);
+      g_free (real_name);
+      real_name = t;
+
+      /* clean up */
+      g_free (name);
     }
-  else
+
+  /* keep the strings if nothing changed (on a refresh), callers might still use them */
+  if (g_strcmp0 (user->name, pw_name) != 0)
     {
-      user->name = g_strdup_printf ("%u", (guint) user->id);
+      g_free (user->name);
+      user->name = g_strdup (pw_name);
+    }
+  if (g_strcmp0 (user->real_name, real_name) != 0)
+    {
+      g_free (user->real_name);
+      user->real_name = real_name;
+      real_name = NULL;
+    }
+  g_free (real_name);
+
+  /* query the primary group */
+  if (user->primary_group == NULL || thunar_group_get_id (user->primary_group) != pw_gid)
+    {
+      if (user->primary_group != NULL)
+        g_object_unref (user->primary_group);
+
+      manager = thunar_user_manager_get_default ();
+      user->primary_group = thunar_user_manager_get_group_by_id (manager, pw_gid);
+      g_object_unref (G_OBJECT (manager));
     }
 }
 
@@ -449,6 +587,88 @@ thunar_user_get_real_name (ThunarUser *user)
 
 
 
+/**
+ * thunar_user_peek_name:
+ * @user : a #ThunarUser.
+ *
+ * Like thunar_user_get_name(), but never blocks on the name
+ * service. If the account of @user is not known yet, it is
+ * resolved in the background and the user id is returned as
+ * string. The #ThunarUserManager emits "changed" once the
+ * account arrived.
+ *
+ * Return value: the name of @user or its id.
+ **/
+const gchar*
+thunar_user_peek_name (ThunarUser *user)
+{
+  g_return_val_if_fail (THUNAR_IS_USER (user), NULL);
+
+#ifdef THUNAR_USER_MANAGER_ASYNC
+  if (G_UNLIKELY (user->name == NULL))
+    {
+      /* queued once, on the first request */
+      if (user->id_name == NULL)
+        {
+          thunar_user_manager_queue_user (user->id);
+          user->id_name = g_strdup_printf ("%u", (guint) user->id);
+        }
+
+      return user->id_name;
+    }
+#endif
+
+  return thunar_user_get_name (user);
+}
+
+
+
+/**
+ * thunar_user_peek_real_name:
+ * @user : a #ThunarUser.
+ *
+ * Like thunar_user_get_real_name(), but returns %NULL
+ * while the account of @user is still being resolved,
+ * see thunar_user_peek_name().
+ *
+ * Return value: the real name for @user or %NULL.
+ **/
+const gchar*
+thunar_user_peek_real_name (ThunarUser *user)
+{
+  g_return_val_if_fail (THUNAR_IS_USER (user), NULL);
+
+#ifdef THUNAR_USER_MANAGER_ASYNC
+  if (G_UNLIKELY (user->name == NULL))
+    {
+      thunar_user_peek_name (user);
+      return NULL;
+    }
+#endif
+
+  return thunar_user_get_real_name (user);
+}
+
+
+
+/**
+ * thunar_user_is_resolved:
+ * @user : a #ThunarUser.
+ *
+ * Tells whether the account of @user is known, i.e. whether
+ * thunar_user_peek_name() returns more than a placeholder.
+ *
+ * Return value: %TRUE once the account of @user was looked up.
+ **/
+gboolean
+thunar_user_is_resolved (ThunarUser *user)
+{
+  g_return_val_if_fail (THUNAR_IS_USER (user), FALSE);
+  return user->name != NULL;
+}
+
+
+
 /**
  * thunar_user_is_me:
  * @user : a #ThunarUser.
@@ -472,6 +692,22 @@ thunar_user_is_me (ThunarUser *user)
 static void     thunar_user_manager_finalize            (GObject                *object);
 static gboolean thunar_user_manager_flush_timer         (gpointer                user_data);
 static void     thunar_user_manager_flush_timer_destroy (gpointer                user_data);
+static gsize    thunar_user_manager_cache_size          (gpointer                user_data);
+static void     thunar_user_manager_cache_shed          (gpointer                user_data,
+                                                         GMemoryMonitorWarningLevel level);
+#ifdef THUNAR_USER_MANAGER_ASYNC
+static void     thunar_user_manager_refresh             (ThunarUserManager      *manager);
+static void     thunar_user_manager_resolve             (ThunarUserManager      *manager);
+#endif
+
+
+
+/* Signal identifiers */
+enum
+{
+  CHANGED,
+  LAST_SIGNAL,
+};
 
 
 
@@ -484,14 +720,23 @@ struct _ThunarUserManager
 {
   GObject __parent__;
 
-  GHashTable *groups;
-  GHashTable *users;
+  GHashTable   *groups;
+  GHashTable   *users;
 
-  guint       flush_timer_id;
+  guint         flush_timer_id;
+
+  /* ids waiting for the resolver thread, and the running resolver */
+  GHashTable   *pending_groups;
+  GHashTable   *pending_users;
+  GCancellable *resolve_cancellable;
 };
 
 
 
+static guint manager_signals[LAST_SIGNAL];
+
+
+
 G_DEFINE_TYPE (ThunarUserManager, thunar_user_manager, G_TYPE_OBJECT)
 
 
@@ -503,6 +748,22 @@ thunar_user_manager_class_init (ThunarUserManagerClass *klass)
 
   gobject_class = G_OBJECT_CLASS (klass);
   gobject_class->finalize = thunar_user_manager_finalize;
+
+  /**
+   * ThunarUserManager::changed:
+   * @manager : a #ThunarUserManager.
+   *
+   * Emitted when names of users or groups, which were shown as
+   * ids by thunar_user_peek_name() or thunar_group_peek_name(),
+   * were resolved or changed.
+   **/
+  manager_signals[CHANGED] =
+    g_signal_new (I_("changed"),
+                  G_TYPE_FROM_CLASS (klass),
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL,
+                  g_cclosure_marshal_VOID__VOID,
+                  G_TYPE_NONE, 0);
 }
 
 
@@ -512,6 +773,8 @@ thunar_user_manager_init (ThunarUserManager *manager)
 {
   manager->groups = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_object_unref);
   manager->users = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_object_unref);
+  manager->pending_groups = g_hash_table_new (g_direct_hash, g_direct_equal);
+  manager->pending_users = g_hash_table_new (g_direct_hash, g_direct_equal);
 
   /* keep the groups file in memory if possible */
 #ifdef HAVE_SETGROUPENT
@@ -527,6 +790,10 @@ thunar_user_manager_init (ThunarUserManager *manager)
   manager->flush_timer_id = g_timeout_add_seconds_full (G_PRIORITY_LOW, THUNAR_USER_MANAGER_FLUSH_INTERVAL,
                                                         thunar_user_manager_flush_timer, manager,
                                                         thunar_user_manager_flush_timer_destroy);
+
+  /* the unused entries and the name service files are cheap to load again */
+  thunar_cache_registry_add ("users", G_MEMORY_MONITOR_WARNING_LEVEL_LOW,
+                             thunar_user_manager_cache_size, thunar_user_manager_cache_shed, manager);
 }
 
 
@@ -536,11 +803,18 @@ thunar_user_manager_finalize (GObject *object)
 {
   ThunarUserManager *manager = THUNAR_USER_MANAGER (object);
 
+  thunar_cache_registry_remove (manager);
+
   /* stop the flush timer */
   if (G_LIKELY (manager->flush_timer_id != 0))
     g_source_remove (manager->flush_timer_id);
 
+  /* the running resolver holds a reference, so it cannot be running here */
+  _thunar_assert (manager->resolve_cancellable == NULL);
+
   /* destroy the hash tables */
+  g_hash_table_destroy (manager->pending_groups);
+  g_hash_table_destroy (manager->pending_users);
   g_hash_table_destroy (manager->groups);
   g_hash_table_destroy (manager->users);
 
@@ -555,21 +829,28 @@ thunar_user_manager_finalize (GObject *object)
 
 
 
+static gboolean
+thunar_user_manager_evict (gpointer key,
+                           gpointer value,
+                           gpointer user_data)
+{
+  /* only the cache knows about the entry */
+  return G_OBJECT (value)->ref_count == 1;
+}
+
+
+
 static gboolean
 thunar_user_manager_flush_timer (gpointer user_data)
 {
   ThunarUserManager *manager = THUNAR_USER_MANAGER (user_data);
   guint              size = 0;
 
-  /* drop all cached groups */
-  size += g_hash_table_foreach_remove (manager->groups,
-                                       (GHRFunc) (void (*)(void)) gtk_true,
-                                       NULL);
-
-  /* drop all cached users */
-  size += g_hash_table_foreach_remove (manager->users,
-                                       (GHRFunc) (void (*)(void)) gtk_true,
-                                       NULL);
+  /* drop the cached groups and users nobody uses anymore, the
+   * others are kept so views never fall back to showing ids */
+  size += g_hash_table_foreach_remove (manager->groups, thunar_user_manager_evict, NULL);
+  size += g_hash_table_foreach_remove (manager->users, thunar_user_manager_evict, NULL);
+  size += g_hash_table_size (manager->groups) + g_hash_table_size (manager->users);
 
   /* reload groups and passwd files if we had cached entities */
   if (G_LIKELY (size > 0))
@@ -586,6 +867,11 @@ thunar_user_manager_flush_timer (gpointer user_data)
 #endif
     }
 
+#ifdef THUNAR_USER_MANAGER_ASYNC
+  /* pick up renamed accounts of the remaining entries in the background */
+  thunar_user_manager_refresh (manager);
+#endif
+
   return TRUE;
 }
 
@@ -599,6 +885,286 @@ thunar_user_manager_flush_timer_destroy (gpointer user_data)
 
 
 
+static gsize
+thunar_user_manager_cache_size (gpointer user_data)
+{
+  ThunarUserManager *manager = THUNAR_USER_MANAGER (user_data);
+
+  /* the objects and about as much for their names */
+  return g_hash_table_size (manager->groups) * 2 * sizeof (ThunarGroup)
+       + g_hash_table_size (manager->users) * 2 * sizeof (ThunarUser);
+}
+
+
+
+static void
+thunar_user_manager_cache_shed (gpointer                   user_data,
+                                GMemoryMonitorWarningLevel level)
+{
+  ThunarUserManager *manager = THUNAR_USER_MANAGER (user_data);
+
+  /* drop what nobody uses, like the flush timer does */
+  g_hash_table_foreach_remove (manager->groups, thunar_user_manager_evict, NULL);
+  g_hash_table_foreach_remove (manager->users, thunar_user_manager_evict, NULL);
+
+  /* and let go of the groups and passwd files kept open, they are
+   * opened again by the next lookup */
+  endgrent ();
+  endpwent ();
+}
+
+
+
+#ifdef THUNAR_USER_MANAGER_ASYNC
+static GArray *
+thunar_user_manager_steal_pending (GHashTable *pending)
+{
+  ThunarUserLookup lookup = { 0, };
+  GHashTableIter   iter;
+  gpointer         key;
+  GArray          *lookups;
+
+  lookups = g_array_sized_new (FALSE, FALSE, sizeof (ThunarUserLookup), g_hash_table_size (pending));
+
+  g_hash_table_iter_init (&iter, pending);
+  while (g_hash_table_iter_next (&iter, &key, NULL))
+    {
+      lookup.id = GPOINTER_TO_UINT (key);
+      g_array_append_val (lookups, lookup);
+    }
+  g_hash_table_remove_all (pending);
+
+  return lookups;
+}
+
+
+
+static void
+thunar_user_manager_lookups_free (gpointer data)
+{
+  GArray           *lookups = data;
+  ThunarUserLookup *lookup;
+  guint             n;
+
+  for (n = 0; n < lookups->len; n++)
+    {
+      lookup = &g_array_index (lookups, ThunarUserLookup, n);
+      g_free (lookup->name);
+      g_free (lookup->gecos);
+    }
+
+  g_array_free (lookups, TRUE);
+}
+
+
+
+static void
+thunar_user_manager_resolve_thread (GTask        *task,
+                                    gpointer      source_object,
+                                    gpointer      task_data,
+                                    GCancellable *cancellable)
+{
+  GArray          **lookups = task_data;
+  ThunarUserLookup *lookup;
+  struct passwd     pwd, *pw;
+  struct group      grd, *gr;
+  gsize             buffer_size = 4096;
+  gchar            *buffer;
+  guint             n;
+  gint              result;
+
+  buffer = g_malloc (buffer_size);
+
+  /* groups */
+  for (n = 0; n < lookups[0]->len && !g_cancellable_is_cancelled (cancellable); n++)
+    {
+      lookup = &g_array_index (lookups[0], ThunarUserLookup, n);
+      while ((result = getgrgid_r (lookup->id, &grd, buffer, buffer_size, &gr)) == ERANGE)
+        buffer = g_realloc (buffer, buffer_size *= 2);
+
+      if (result == 0 && gr != NULL)
+        {
+          lookup->found = TRUE;
+          lookup->name = g_strdup (gr->gr_name);
+        }
+    }
+
+  /* users */
+  for (n = 0; n < lookups[1]->len && !g_cancellable_is_cancelled (cancellable); n++)
+    {
+      lookup = &g_array_index (lookups[1], ThunarUserLookup, n);
+      while ((result = getpwuid_r (lookup->id, &pwd, buffer, buffer_size, &pw)) == ERANGE)
+        buffer = g_realloc (buffer, buffer_size *= 2);
+
+      if (result == 0 && pw != NULL)
+        {
+          lookup->found = TRUE;
+          lookup->name = g_strdup (pw->pw_name);
+          lookup->gecos = g_strdup (pw->pw_gecos);
+          lookup->gid = pw->pw_gid;
+        }
+    }
+
+  g_free (buffer);
+
+  g_task_return_boolean (task, TRUE);
+}
+
+
+
+static void
+thunar_user_manager_lookups_destroy (gpointer data)
+{
+  GArray **lookups = data;
+
+  thunar_user_manager_lookups_free (lookups[0]);
+  thunar_user_manager_lookups_free (lookups[1]);
+  g_free (lookups);
+}
+
+
+
+static void
+thunar_user_manager_resolve_finished (GObject      *source_object,
+                                      GAsyncResult *result,
+                                      gpointer      user_data)
+{
+  ThunarUserManager *manager = THUNAR_USER_MANAGER (source_object);
+  GArray           **lookups = g_task_get_task_data (G_TASK (result));
+  ThunarUserLookup  *lookup;
+  ThunarGroup       *group;
+  ThunarUser        *user;
+  guint              n;
+
+  g_clear_object (&manager->resolve_cancellable);
+
+  /* entries which are not cached anymore aren't interesting */
+  for (n = 0; n < lookups[0]->len; n++)
+    {
+      lookup = &g_array_index (lookups[0], ThunarUserLookup, n);
+      group = g_hash_table_lookup (manager->groups, GUINT_TO_POINTER (lookup->id));
+      if (group != NULL && (lookup->found || group->name == NULL))
+        thunar_group_set_name (group, lookup->name);
+    }
+
+  for (n = 0; n < lookups[1]->len; n++)
+    {
+      lookup = &g_array_index (lookups[1], ThunarUserLookup, n);
+      user = g_hash_table_lookup (manager->users, GUINT_TO_POINTER (lookup->id));
+      if (user != NULL)
+        thunar_user_set_passwd (user, lookup->name, lookup->gecos, lookup->gid);
+    }
+
+  /* let the views show the names */
+  g_signal_emit (manager, manager_signals[CHANGED], 0);
+
+  /* continue with the ids queued in the meantime */
+  thunar_user_manager_resolve (manager);
+}
+
+
+
+static gboolean
+thunar_user_manager_resolve_idle (gpointer user_data)
+{
+  ThunarUserManager *manager = THUNAR_USER_MANAGER (user_data);
+
+  thunar_user_manager_resolve (manager);
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+static void
+thunar_user_manager_resolve (ThunarUserManager *manager)
+{
+  GArray **lookups;
+  GTask   *task;
+
+  /* one resolver at a time, it picks up the rest when done */
+  if (manager->resolve_cancellable != NULL)
+    return;
+
+  if (g_hash_table_size (manager->pending_groups) == 0 && g_hash_table_size (manager->pending_users) == 0)
+    return;
+
+  lookups = g_new (GArray *, 2);
+  lookups[0] = thunar_user_manager_steal_pending (manager->pending_groups);
+  lookups[1] = thunar_user_manager_steal_pending (manager->pending_users);
+
+  manager->resolve_cancellable = g_cancellable_new ();
+
+  task = g_task_new (manager, manager->resolve_cancellable, thunar_user_manager_resolve_finished, NULL);
+  g_task_set_task_data (task, lookups, thunar_user_manager_lookups_destroy);
+  g_task_run_in_thread (task, thunar_user_manager_resolve_thread);
+  g_object_unref (task);
+}
+
+
+
+static void
+thunar_user_manager_refresh (ThunarUserManager *manager)
+{
+  GHashTableIter iter;
+  gpointer       key, value;
+
+  g_hash_table_iter_init (&iter, manager->groups);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    if (THUNAR_GROUP (value)->name != NULL)
+      g_hash_table_add (manager->pending_groups, key);
+
+  g_hash_table_iter_init (&iter, manager->users);
+  while (g_hash_table_iter_next (&iter, &key, &value))
+    if (THUNAR_USER (value)->name != NULL)
+      g_hash_table_add (manager->pending_users, key);
+
+  thunar_user_manager_resolve (manager);
+}
+
+
+
+static void
+thunar_user_manager_queue (ThunarUserManager *manager,
+                           GHashTable        *pending,
+                           guint32            id)
+{
+  if (g_hash_table_contains (pending, GUINT_TO_POINTER (id)))
+    return;
+
+  /* collect the ids asked for during one redraw before resolving */
+  if (g_hash_table_size (manager->pending_groups) == 0 && g_hash_table_size (manager->pending_users) == 0)
+    g_idle_add_full (G_PRIORITY_DEFAULT_IDLE, thunar_user_manager_resolve_idle,
+                     g_object_ref (manager), g_object_unref);
+
+  g_hash_table_add (pending, GUINT_TO_POINTER (id));
+}
+
+
+
+static void
+thunar_user_manager_queue_group (guint32 id)
+{
+  ThunarUserManager *manager = thunar_user_manager_get_default ();
+
+  thunar_user_manager_queue (manager, manager->pending_groups, id);
+  g_object_unref (manager);
+}
+
+
+
+static void
+thunar_user_manager_queue_user (guint32 id)
+{
+  ThunarUserManager *manager = thunar_user_manager_get_default ();
+
+  thunar_user_manager_queue (manager, manager->pending_users, id);
+  g_object_unref (manager);
+}
+#endif
+
+
+
 /**
  * thunar_user_manager_get_default:
  *
@@ -40,6 +40,8 @@ GType         thunar_group_get_type  (void) G_GNUC_CONST;
 
 guint32       thunar_group_get_id    (ThunarGroup *group);
 const gchar  *thunar_group_get_name  (ThunarGroup *group);
+const gchar  *thunar_group_peek_name (ThunarGroup *group);
+gboolean      thunar_group_is_resolved (ThunarGroup *group);
 
 
 typedef struct _ThunarUserClass ThunarUserClass;
@@ -57,6 +59,9 @@ GType         thunar_user_get_type          (void) G_GNUC_CONST;
 GList        *thunar_user_get_groups        (ThunarUser *user);
 const gchar  *thunar_user_get_name          (ThunarUser *user);
 const gchar  *thunar_user_get_real_name     (ThunarUser *user);
+const gchar  *thunar_user_peek_name         (ThunarUser *user);
+const gchar  *thunar_user_peek_real_name    (ThunarUser *user);
+gboolean      thunar_user_is_resolved       (ThunarUser *user);
 gboolean      thunar_user_is_me             (ThunarUser *user);
 
 
@@ -54,6 +54,7 @@
 #include <glib/gwin32.h>
 #endif
 
+#include "thunar/thunar-gobject-extensions.h"
 #include "thunar/thunar-private.h"
 #include "thunar/thunar-util.h"
 #include "thunar/thunar-folder.h"
@@ -68,6 +69,9 @@
 
 #define BORDER_RADIUS 8
 
+/* upper bound for the number of cached date strings */
+#define DATE_STRING_CACHE_MAX 8192
+
 enum
 {
   THUNAR_CELL_TOP_RIGHT,
@@ -398,23 +402,50 @@ thunar_util_expand_filename (const gchar  *filename,
 
 
 
-/**
- * thunar_util_humanize_file_time:
- * @file_time         : a #guint64 timestamp.
- * @date_style        : the #ThunarDateFormat used to humanize the @file_time.
- * @date_custom_style : custom style to apply, if @date_style is set to custom
- *
- * Returns a human readable date representation of the specified
- * @file_time. The caller is responsible to free the returned
- * string using g_free() when no longer needed.
- *
- * Return value: a human readable date representation of @file_time
- *               according to the @date_format.
- **/
-gchar*
-thunar_util_humanize_file_time (guint64          file_time,
-                                ThunarDateStyle  date_style,
-                                const gchar     *date_custom_style)
+/* formatted date strings, keyed by timestamp and date style */
+G_LOCK_DEFINE_STATIC (date_string_cache);
+static GHashTable *date_string_cache = NULL;
+static gchar      *date_string_cache_custom_style = NULL;
+static time_t      date_string_cache_expires = 0;
+
+
+
+static time_t
+thunar_util_next_midnight (time_t now)
+{
+  GDateTime *dt_now;
+  GDateTime *dt_midnight;
+  GDateTime *dt_next;
+  time_t     result;
+
+  dt_now = g_date_time_new_from_unix_local (now);
+  if (G_UNLIKELY (dt_now == NULL))
+    return now + 60;
+
+  /* relative date strings ("Today", weekdays) change at local midnight */
+  dt_midnight = g_date_time_new_local (g_date_time_get_year (dt_now),
+                                       g_date_time_get_month (dt_now),
+                                       g_date_time_get_day_of_month (dt_now),
+                                       0, 0, 0);
+  dt_next = (dt_midnight != NULL) ? g_date_time_add_days (dt_midnight, 1) : NULL;
+  result = (dt_next != NULL) ? g_date_time_to_unix (dt_next) : now + 60;
+
+  if (dt_next != NULL)
+    g_date_time_unref (dt_next);
+  if (dt_midnight != NULL)
+    g_date_time_unref (dt_midnight);
+  g_date_time_unref (dt_now);
+
+  /* re-check hourly to notice DST and timezone changes */
+  return MIN (MAX (result, now + 60), now + 3600);
+}
+
+
+
+static gchar *
+thunar_util_format_file_time (guint64          file_time,
+                              ThunarDateStyle  date_style,
+                              const gchar     *date_custom_style)
 {
   const gchar *date_format;
   gchar       *time_str;
@@ -528,6 +559,80 @@ thunar_util_humanize_file_time (guint64          file_time,
 
 
 
+/**
+ * thunar_util_humanize_file_time:
+ * @file_time         : a #guint64 timestamp.
+ * @date_style        : the #ThunarDateFormat used to humanize the @file_time.
+ * @date_custom_style : custom style to apply, if @date_style is set to custom
+ *
+ * Returns a human readable date representation of the specified
+ * @file_time. The caller is responsible to free the returned
+ * string using g_free() when no longer needed.
+ *
+ * Return value: a human readable date representation of @file_time
+ *               according to the @date_format.
+ **/
+gchar*
+thunar_util_humanize_file_time (guint64          file_time,
+                                ThunarDateStyle  date_style,
+                                const gchar     *date_custom_style)
+{
+  const gchar *cached;
+  gchar       *time_str;
+  gint64       key;
+  time_t       now;
+
+  /* invalid timestamps are cheap, no need to cache them */
+  if (G_UNLIKELY (file_time == 0 || file_time > G_MAXINT64 / 16))
+    return thunar_util_format_file_time (file_time, date_style, date_custom_style);
+
+  /* every date style may print seconds, so the key is the exact timestamp */
+  key = (gint64) file_time * 16 + date_style;
+  now = time (NULL);
+
+  G_LOCK (date_string_cache);
+
+  if (G_UNLIKELY (date_string_cache == NULL))
+    {
+      date_string_cache = g_hash_table_new_full (g_int64_hash, g_int64_equal, g_free, g_free);
+      date_string_cache_custom_style = g_strdup (date_custom_style);
+      date_string_cache_expires = thunar_util_next_midnight (now);
+    }
+  else if (now >= date_string_cache_expires
+           || g_strcmp0 (date_string_cache_custom_style, date_custom_style) != 0
+           || g_hash_table_size (date_string_cache) >= DATE_STRING_CACHE_MAX)
+    {
+      /* drop all strings when the day changed or the custom style differs */
+      g_hash_table_remove_all (date_string_cache);
+      g_free (date_string_cache_custom_style);
+      date_string_cache_custom_style = g_strdup (date_custom_style);
+      date_string_cache_expires = thunar_util_next_midnight (now);
+    }
+
+  cached = g_hash_table_lookup (date_string_cache, &key);
+  if (G_LIKELY (cached != NULL))
+    {
+      time_str = g_strdup (cached);
+      G_UNLOCK (date_string_cache);
+      return time_str;
+    }
+
+  G_UNLOCK (date_string_cache);
+
+  /* format outside the lock, this may be called from job threads */
+  time_str = thunar_util_format_file_time (file_time, date_style, date_custom_style);
+
+  G_LOCK (date_string_cache);
+  if (g_strcmp0 (date_string_cache_custom_style, date_custom_style) == 0
+      && now < date_string_cache_expires)
+    g_hash_table_replace (date_string_cache, g_memdup2 (&key, sizeof (key)), g_strdup (time_str));
+  G_UNLOCK (date_string_cache);
+
+  return time_str;
+}
+
+
+
 /**
  * thunar_util_parse_parent:
  * @parent        : a #GtkWidget, a #GdkScreen or %NULL.
@@ -686,6 +791,78 @@ thunar_setup_display_cb (gpointer data)
 
 
 
+typedef struct
+{
+  const gchar *prefix;
+  gsize        prefix_len;
+  const gchar *suffix;
+  gsize        suffix_len;
+  GHashTable  *used; /* the numbers in use */
+} ThunarUtilNameScan;
+
+
+
+static gchar *
+thunar_util_format_new_file_name (const gchar           *file_name,
+                                  gint                   file_name_size,
+                                  const gchar           *extension,
+                                  ThunarNextFileNameMode name_mode,
+                                  guint                  count)
+{
+  switch (name_mode)
+    {
+    case THUNAR_NEXT_FILE_NAME_MODE_NEW:
+      return g_strdup_printf (_("%.*s %u%s"), file_name_size, file_name, count, extension ? extension : "");
+
+    case THUNAR_NEXT_FILE_NAME_MODE_COPY:
+      return g_strdup_printf (_("%.*s (copy %u)%s"), file_name_size, file_name, count, extension ? extension : "");
+
+    case THUNAR_NEXT_FILE_NAME_MODE_LINK:
+      if (count == 1)
+        return g_strdup_printf (_("link to %.*s%s"), file_name_size, file_name, extension ? extension : "");
+      return g_strdup_printf (_("link %u to %.*s%s"), count, file_name_size, file_name, extension ? extension : "");
+
+    default:
+      _thunar_assert_not_reached ();
+      return g_strdup (file_name);
+    }
+}
+
+
+
+static void
+thunar_util_scan_file_name (gpointer data,
+                            gpointer user_data)
+{
+  ThunarUtilNameScan *scan = user_data;
+  const gchar        *name = data;
+  const gchar        *digits;
+  gsize               name_len = strlen (name);
+  gsize               n_digits;
+  gsize               n;
+  guint64             count;
+
+  /* only names with the number between the prefix and the suffix count */
+  if (name_len <= scan->prefix_len + scan->suffix_len
+      || strncmp (name, scan->prefix, scan->prefix_len) != 0
+      || strcmp (name + name_len - scan->suffix_len, scan->suffix) != 0)
+    return;
+
+  /* the part between is the number of the name, if it is one */
+  digits = name + scan->prefix_len;
+  n_digits = name_len - scan->prefix_len - scan->suffix_len;
+  if (digits[0] == '0' || n_digits > 9)
+    return;
+  for (n = 0; n < n_digits; ++n)
+    if (!g_ascii_isdigit (digits[n]))
+      return;
+
+  count = g_ascii_strtoull (digits, NULL, 10);
+  g_hash_table_add (scan->used, GUINT_TO_POINTER ((guint) count));
+}
+
+
+
 /**
  * thunar_util_next_new_file_name
  * @dir : the directory to search for a free filename
@@ -716,12 +893,14 @@ thunar_util_next_new_file_name (ThunarFile            *dir,
                                 ThunarNextFileNameMode name_mode,
                                 gboolean               is_directory)
 {
-  ThunarFolder   *folder          = thunar_folder_get_for_file (dir);
-  unsigned long   file_name_size  = strlen (file_name);
-  unsigned        count           = 0;
-  gboolean        found_duplicate = FALSE;
-  gchar          *extension       = NULL;
-  gchar          *new_name        = g_strdup (file_name);
+  ThunarUtilNameScan scan;
+  ThunarFolder      *folder          = thunar_folder_get_for_file (dir);
+  unsigned long      file_name_size  = strlen (file_name);
+  guint              count;
+  gchar             *extension       = NULL;
+  gchar             *new_name        = g_strdup (file_name);
+  gchar             *other_name;
+  gsize              n;
 
   /* get file extension if file is not a directory */
   if (!is_directory)
@@ -731,51 +910,312 @@ thunar_util_next_new_file_name (ThunarFile            *dir,
   if (extension != NULL)
     file_name_size -= strlen (extension);
 
-  /* loop through the directory until new_name is unique */
-  while (TRUE)
+  /* in most cases the name is free or the first variant is */
+  count = 1;
+  if (thunar_folder_has_file_name (folder, new_name) && name_mode == THUNAR_NEXT_FILE_NAME_MODE_LINK)
     {
-      GList *files = thunar_folder_get_files (folder);
-      found_duplicate = FALSE;
-      for (;files != NULL; files = files->next)
+      g_free (new_name);
+      new_name = thunar_util_format_new_file_name (file_name, (gint) file_name_size, extension, name_mode, count++);
+    }
+
+  if (thunar_folder_has_file_name (folder, new_name))
+    {
+      /* two numbered names only differ in the number, which gives what
+       * comes before and after the number in all of them */
+      g_free (new_name);
+      new_name = thunar_util_format_new_file_name (file_name, (gint) file_name_size, extension, name_mode, 2);
+      other_name = thunar_util_format_new_file_name (file_name, (gint) file_name_size, extension, name_mode, 3);
+      for (n = 0; new_name[n] != '\0' && new_name[n] == other_name[n]; ++n)
+        ;
+      scan.prefix = new_name;
+      scan.prefix_len = n;
+      scan.suffix = new_name + n + 1;
+      scan.suffix_len = strlen (scan.suffix);
+
+      /* one pass over the folder collects the numbers in use, instead
+       * of a pass per number tried */
+      scan.used = g_hash_table_new (g_direct_hash, g_direct_equal);
+      thunar_folder_foreach_file_name (folder, thunar_util_scan_file_name, &scan);
+      g_free (other_name);
+
+      /* take the lowest free number, the check of the name is for names
+       * which look numbered without being formatted like this */
+      for (;; ++count)
         {
-          ThunarFile  *file = files->data;
-          gchar       *name = g_file_get_basename (thunar_file_get_file (file));
+          if (g_hash_table_contains (scan.used, GUINT_TO_POINTER (count)))
+            continue;
 
-          if (g_strcmp0 (new_name, name) == 0)
-            {
-              found_duplicate = TRUE;
-              g_free (name);
-              break;
-            }
-          g_free (name);
+          other_name = thunar_util_format_new_file_name (file_name, (gint) file_name_size, extension, name_mode, count);
+          if (!thunar_folder_has_file_name (folder, other_name))
+            break;
+          g_free (other_name);
         }
-      g_list_free (files);
 
-      if (!found_duplicate)
-        break;
+      g_hash_table_destroy (scan.used);
       g_free (new_name);
-      if (name_mode == THUNAR_NEXT_FILE_NAME_MODE_NEW)
-        new_name = g_strdup_printf (_("%.*s %u%s"), (int) file_name_size, file_name, ++count, extension ? extension : "");
-      else if (name_mode == THUNAR_NEXT_FILE_NAME_MODE_COPY)
-        new_name = g_strdup_printf (_("%.*s (copy %u)%s"), (int) file_name_size, file_name, ++count, extension ? extension : "");
-      else if (name_mode == THUNAR_NEXT_FILE_NAME_MODE_LINK)
+      new_name = other_name;
+    }
+
+  g_object_unref (G_OBJECT (folder));
+
+  return new_name;
+}
+
+
+
+/**
+ * thunar_util_get_thumbnail_path:
+ * @uri            : the URI of a file.
+ * @is_directory   : whether @uri refers to a directory.
+ * @thumbnail_size : the #ThunarThumbnailSize of the thumbnail.
+ *
+ * Looks for an existing thumbnail of @uri in the thumbnail cache, the old
+ * thumbnail location and, for files, the shared thumbnail repository.
+ * Unlike thunar_file_get_thumbnail_path() this doesn't touch a #ThunarFile,
+ * so it can be used from any thread.
+ *
+ * The caller is responsible to free the returned string using g_free() when no longer needed.
+ *
+ * Return value: the path of the thumbnail, or %NULL if there is none.
+**/
+gchar*
+thunar_util_get_thumbnail_path (const gchar        *uri,
+                                gboolean            is_directory,
+                                ThunarThumbnailSize thumbnail_size)
+{
+  GChecksum *checksum;
+  gchar     *thumbnail_path = NULL;
+
+  _thunar_return_val_if_fail (uri != NULL, NULL);
+
+  checksum = g_checksum_new (G_CHECKSUM_MD5);
+  if (G_LIKELY (checksum != NULL))
+    {
+      g_checksum_update (checksum, (const guchar *) uri, strlen (uri));
+      thumbnail_path = thunar_util_get_thumbnail_path_for_hash (uri, g_checksum_get_string (checksum),
+                                                                is_directory, thumbnail_size);
+      g_checksum_free (checksum);
+    }
+
+  return thumbnail_path;
+}
+
+
+
+/**
+ * thunar_util_get_thumbnail_path_for_hash:
+ * @uri            : the URI of a file.
+ * @uri_hash       : the hexadecimal MD5 checksum of @uri.
+ * @is_directory   : whether @uri refers to a directory.
+ * @thumbnail_size : the #ThunarThumbnailSize of the thumbnail.
+ *
+ * Same as thunar_util_get_thumbnail_path(), for callers which
+ * already know the checksum of @uri.
+ *
+ * The caller is responsible to free the returned string using g_free() when no longer needed.
+ *
+ * Return value: the path of the thumbnail, or %NULL if there is none.
+**/
+gchar*
+thunar_util_get_thumbnail_path_for_hash (const gchar        *uri,
+                                         const gchar        *uri_hash,
+                                         gboolean            is_directory,
+                                         ThunarThumbnailSize thumbnail_size)
+{
+  gchar *filename;
+  gchar *thumbnail_path = NULL;
+
+  _thunar_return_val_if_fail (uri != NULL, NULL);
+  _thunar_return_val_if_fail (uri_hash != NULL, NULL);
+
+  filename = g_strconcat (uri_hash, ".png", NULL);
+
+  /* The thumbnail is in the format/location
+   * $XDG_CACHE_HOME/thumbnails/(nromal|large)/MD5_Hash_Of_URI.png
+   * for version 0.8.0 if XDG_CACHE_HOME is defined, otherwise
+   * /homedir/.thumbnails/(normal|large)/MD5_Hash_Of_URI.png
+   * will be used, which is also always used for versions prior
+   * to 0.7.0.
+   */
+
+  /* build and check if the thumbnail is in the new location */
+  thumbnail_path = g_build_path ("/", g_get_user_cache_dir(),
+                                       "thumbnails", thunar_thumbnail_size_get_nick (thumbnail_size),
+                                       filename, NULL);
+
+  if (!g_file_test(thumbnail_path, G_FILE_TEST_EXISTS))
+    {
+      /* Fallback to old version */
+      g_free(thumbnail_path);
+
+      thumbnail_path = g_build_filename (xfce_get_homedir (),
+                                               ".thumbnails", thunar_thumbnail_size_get_nick (thumbnail_size),
+                                               filename, NULL);
+
+      if(!g_file_test(thumbnail_path, G_FILE_TEST_EXISTS))
         {
-          if (count == 0)
+          g_free(thumbnail_path);
+          thumbnail_path = NULL;
+
+          if (!is_directory)
             {
-              new_name = g_strdup_printf (_("link to %.*s%s"), (int) file_name_size, file_name, extension ? extension : "");
-              ++count;
+              /* Thumbnail doesn't exist in either spot, look for shared repository */
+              thumbnail_path = xfce_create_shared_thumbnail_path (uri, thunar_thumbnail_size_get_nick (thumbnail_size));
+
+              if (thumbnail_path != NULL && !g_file_test (thumbnail_path, G_FILE_TEST_EXISTS))
+                {
+                  /* Thumbnail doesn't exist */
+                  g_free (thumbnail_path);
+                  thumbnail_path = NULL;
+                }
             }
-          else
+        }
+    }
+
+  g_free (filename);
+
+  return thumbnail_path;
+}
+
+
+
+/**
+ * thunar_util_thumbnail_is_stale:
+ * @path  : the path of a thumbnail PNG.
+ * @mtime : the modification time of the thumbnailed file.
+ *
+ * Compares the Thumb::MTime of the thumbnail at @path with @mtime. Only
+ * the chunks in front of the image data are read, nothing is decoded.
+ * May be called from any thread.
+ *
+ * Return value: %TRUE if the thumbnail was made for another version of the file.
+**/
+gboolean
+thunar_util_thumbnail_is_stale (const gchar *path,
+                                guint64      mtime)
+{
+  static const guchar signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+  guchar              header[8];
+  gchar               text[64];
+  guint32             length;
+  gboolean            stale = FALSE;
+  FILE               *fp;
+
+  _thunar_return_val_if_fail (path != NULL, FALSE);
+
+  fp = g_fopen (path, "rb");
+  if (G_UNLIKELY (fp == NULL))
+    return FALSE;
+
+  if (fread (header, 1, sizeof (header), fp) == sizeof (header) && memcmp (header, signature, sizeof (signature)) == 0)
+    {
+      /* walk the chunks in front of the image data */
+      while (fread (header, 1, sizeof (header), fp) == sizeof (header))
+        {
+          length = ((guint32) header[0] << 24) | ((guint32) header[1] << 16) | ((guint32) header[2] << 8) | header[3];
+          if (memcmp (header + 4, "IDAT", 4) == 0 || memcmp (header + 4, "IEND", 4) == 0)
+            break;
+
+          if (memcmp (header + 4, "tEXt", 4) == 0 && length > sizeof ("Thumb::MTime") && length < sizeof (text))
             {
-              new_name = g_strdup_printf (_("link %u to %.*s%s"), ++count, (int) file_name_size, file_name, extension ? extension : "");
+              if (fread (text, 1, length, fp) != length)
+                break;
+
+              if (memcmp (text, "Thumb::MTime", sizeof ("Thumb::MTime")) == 0)
+                {
+                  text[length] = '\0';
+                  stale = (g_ascii_strtoull (text + sizeof ("Thumb::MTime"), NULL, 10) != mtime);
+                  break;
+                }
+
+              /* only the CRC is left */
+              length = 0;
             }
+
+          if (fseek (fp, (glong) length + 4, SEEK_CUR) != 0)
+            break;
+        }
+    }
+
+  fclose (fp);
+
+  return stale;
+}
+
+
+
+typedef struct
+{
+  gchar  *path;
+  gint64  mtime;
+}
+ThunarUtilFileAge;
+
+
+
+static gint
+thunar_util_compare_file_age (gconstpointer a,
+                              gconstpointer b)
+{
+  const ThunarUtilFileAge *age_a = a;
+  const ThunarUtilFileAge *age_b = b;
+
+  return (age_a->mtime > age_b->mtime) - (age_a->mtime < age_b->mtime);
+}
+
+
+
+/**
+ * thunar_util_prune_directory:
+ * @dirname   : the path of a cache directory.
+ * @max_files : the number of files to keep.
+ *
+ * Removes the least recently modified files in @dirname beyond
+ * @max_files. May be called from any thread.
+**/
+void
+thunar_util_prune_directory (const gchar *dirname,
+                             guint        max_files)
+{
+  ThunarUtilFileAge  age;
+  const gchar       *name;
+  GStatBuf           statb;
+  GArray            *ages;
+  GDir              *dir;
+  gchar             *path;
+  guint              n;
+
+  _thunar_return_if_fail (dirname != NULL);
+
+  dir = g_dir_open (dirname, 0, NULL);
+  if (dir == NULL)
+    return;
+
+  ages = g_array_new (FALSE, FALSE, sizeof (ThunarUtilFileAge));
+  while ((name = g_dir_read_name (dir)) != NULL)
+    {
+      path = g_build_filename (dirname, name, NULL);
+      if (g_stat (path, &statb) == 0)
+        {
+          age.path = path;
+          age.mtime = statb.st_mtime;
+          g_array_append_val (ages, age);
         }
       else
-        g_assert("should not be reached");
+        g_free (path);
     }
-  g_object_unref (G_OBJECT (folder));
+  g_dir_close (dir);
 
-  return new_name;
+  if (ages->len > max_files)
+    {
+      g_array_sort (ages, thunar_util_compare_file_age);
+      for (n = 0; n < ages->len - max_files; n++)
+        g_unlink (g_array_index (ages, ThunarUtilFileAge, n).path);
+    }
+
+  for (n = 0; n < ages->len; n++)
+    g_free (g_array_index (ages, ThunarUtilFileAge, n).path);
+  g_array_free (ages, TRUE);
 }
 
 
@@ -1031,30 +1471,171 @@ thunar_util_clip_view_background (GtkCellRenderer      *cell,
 
 
 
+typedef enum
+{
+  THUNAR_SEARCH_PREDICATE_SIZE,
+  THUNAR_SEARCH_PREDICATE_MODIFIED,
+  THUNAR_SEARCH_PREDICATE_TYPE,
+} ThunarSearchPredicateKind;
+
+struct _ThunarSearchPredicate
+{
+  ThunarSearchPredicateKind kind;
+  gint                      cmp;   /* the sign the comparison of the attribute and the value must have */
+  gboolean                  equal; /* whether equal values match too */
+  guint64                   value; /* size in bytes, age in seconds or GFileType */
+};
+
+
+
+static guint64
+thunar_util_search_predicate_unit (const gchar *unit,
+                                   gboolean     is_size)
+{
+  static const struct { const gchar *unit; guint64 size; guint64 age; } units[] =
+  {
+    { "",  1,                 24 * 60 * 60 },
+    { "b", 1,                 0 },
+    { "k", 1024,              0 },
+    { "m", 1024 * 1024,       60 },
+    { "g", 1024 * 1024 * 1024, 0 },
+    { "t", G_GUINT64_CONSTANT (1024) * 1024 * 1024 * 1024, 0 },
+    { "s", 0,                 1 },
+    { "h", 0,                 60 * 60 },
+    { "d", 0,                 24 * 60 * 60 },
+    { "w", 0,                 7 * 24 * 60 * 60 },
+    { "y", 0,                 365 * 24 * 60 * 60 },
+  };
+  guint n;
+
+  for (n = 0; n < G_N_ELEMENTS (units); n++)
+    if (strcmp (units[n].unit, unit) == 0)
+      return is_size ? units[n].size : units[n].age;
+
+  return 0;
+}
+
+
+
+/* parses "size:>100m", "modified:<7d" or "type:dir", returns NULL for anything else */
+static ThunarSearchPredicate *
+thunar_util_search_predicate_parse (const gchar *term)
+{
+  ThunarSearchPredicate predicate;
+  const gchar          *p;
+  gchar                *unit;
+  guint64               factor;
+
+  if (g_str_has_prefix (term, "type:"))
+    {
+      p = term + strlen ("type:");
+      predicate.kind = THUNAR_SEARCH_PREDICATE_TYPE;
+      predicate.cmp = 0;
+      predicate.equal = TRUE;
+      if (strcmp (p, "file") == 0)
+        predicate.value = G_FILE_TYPE_REGULAR;
+      else if (strcmp (p, "dir") == 0 || strcmp (p, "folder") == 0)
+        predicate.value = G_FILE_TYPE_DIRECTORY;
+      else if (strcmp (p, "link") == 0)
+        predicate.value = G_FILE_TYPE_SYMBOLIC_LINK;
+      else
+        return NULL;
+
+      return g_slice_dup (ThunarSearchPredicate, &predicate);
+    }
+
+  if (g_str_has_prefix (term, "size:"))
+    {
+      p = term + strlen ("size:");
+      predicate.kind = THUNAR_SEARCH_PREDICATE_SIZE;
+    }
+  else if (g_str_has_prefix (term, "modified:"))
+    {
+      p = term + strlen ("modified:");
+      predicate.kind = THUNAR_SEARCH_PREDICATE_MODIFIED;
+    }
+  else
+    return NULL;
+
+  /* the comparison is optional and defaults to equality */
+  predicate.cmp = 0;
+  predicate.equal = TRUE;
+  if (*p == '<' || *p == '>')
+    {
+      predicate.cmp = (*p == '<') ? -1 : 1;
+      predicate.equal = (p[1] == '=');
+      p += predicate.equal ? 2 : 1;
+    }
+  else if (*p == '=')
+    p++;
+
+  if (!g_ascii_isdigit (*p))
+    return NULL;
+
+  predicate.value = g_ascii_strtoull (p, &unit, 10);
+  factor = thunar_util_search_predicate_unit (unit, predicate.kind == THUNAR_SEARCH_PREDICATE_SIZE);
+  if (factor == 0)
+    return NULL;
+  predicate.value *= factor;
+
+  return g_slice_dup (ThunarSearchPredicate, &predicate);
+}
+
+
+
 /**
  * thunar_util_split_search_query:
  * @search_query: The search query to split.
+ * @predicates: Return location for the predicates of the query, or %NULL.
  * @error: Return location for regex compilation errors.
  *
  * Search terms are split on whitespace. Search queries must be
  * normalized before passing to this function.
  *
- * See also: thunar_g_utf8_normalize_for_search().
+ * Terms of the form "size:[<|>|<=|>=]N[b|k|m|g|t]",
+ * "modified:[<|>|<=|>=]N[s|m|h|d|w|y]" (the age, in days by
+ * default) and "type:file|dir|link" are not returned as search
+ * terms but as predicates on the file attributes, which are
+ * prepended to @predicates. They are dropped if @predicates is %NULL.
+ *
+ * See also: thunar_g_utf8_normalize_for_search(), thunar_util_search_matcher_new().
  *
  * Return value: a list of search terms which must be freed with g_strfreev()
  **/
 gchar **
 thunar_util_split_search_query (const gchar *search_query_normalized,
+                                GList      **predicates,
                                 GError     **error)
 {
-  GRegex *whitespace_regex;
-  gchar **search_terms;
+  ThunarSearchPredicate *predicate;
+  GRegex                *whitespace_regex;
+  gchar                **search_terms;
+  guint                  n, m;
 
   whitespace_regex = g_regex_new ("\\s+", 0, 0, error);
   if (whitespace_regex == NULL)
     return NULL;
   search_terms = g_regex_split (whitespace_regex, search_query_normalized, 0);
   g_regex_unref (whitespace_regex);
+
+  /* move the predicates out of the terms */
+  for (n = m = 0; search_terms[n] != NULL; n++)
+    {
+      predicate = thunar_util_search_predicate_parse (search_terms[n]);
+      if (predicate == NULL)
+        {
+          search_terms[m++] = search_terms[n];
+          continue;
+        }
+
+      if (predicates != NULL)
+        *predicates = g_list_prepend (*predicates, predicate);
+      else
+        g_slice_free (ThunarSearchPredicate, predicate);
+      g_free (search_terms[n]);
+    }
+  search_terms[m] = NULL;
+
   return search_terms;
 }
 
@@ -1086,6 +1667,292 @@ thunar_util_search_terms_match (gchar **terms,
 
 
 
+static void
+thunar_util_search_predicate_free (gpointer data)
+{
+  g_slice_free (ThunarSearchPredicate, data);
+}
+
+
+
+/* a search term with its Boyer-Moore-Horspool skip table */
+typedef struct
+{
+  const gchar *term;
+  gsize        length;
+  gsize        shift[256];
+}
+ThunarSearchMatcherTerm;
+
+struct _ThunarSearchMatcher
+{
+  ThunarSearchMatcherTerm *terms;
+  guint                    n_terms;
+
+  /* whether all terms are plain ASCII, else ASCII names can never match */
+  gboolean                 ascii_terms;
+
+  /* the ThunarSearchPredicates on the file attributes */
+  GList                   *predicates;
+  guint64                  now; /* in seconds, for the age of files */
+};
+
+
+
+/**
+ * thunar_util_search_matcher_new:
+ * @terms: The search terms to look for, prepared with thunar_util_split_search_query().
+ * @predicates: (transfer full): The predicates returned by thunar_util_split_search_query().
+ *
+ * Compiles @terms for matching many names against them, see
+ * thunar_util_search_matcher_match(). @terms must stay alive
+ * as long as the returned matcher.
+ *
+ * Return value: a new #ThunarSearchMatcher, free with thunar_util_search_matcher_free().
+ **/
+ThunarSearchMatcher *
+thunar_util_search_matcher_new (gchar **terms,
+                                GList  *predicates)
+{
+  ThunarSearchMatcherTerm *term;
+  ThunarSearchMatcher     *matcher;
+  const gchar             *p;
+  guchar                   c;
+  guint                    n;
+  gsize                    i;
+
+  _thunar_return_val_if_fail (terms != NULL, NULL);
+
+  matcher = g_slice_new (ThunarSearchMatcher);
+  matcher->terms = g_new (ThunarSearchMatcherTerm, g_strv_length (terms));
+  matcher->n_terms = 0;
+  matcher->ascii_terms = TRUE;
+  matcher->predicates = predicates;
+  matcher->now = g_get_real_time () / G_USEC_PER_SEC;
+
+  for (n = 0; terms[n] != NULL; n++)
+    {
+      /* empty terms match everything */
+      if (*terms[n] == '\0')
+        continue;
+
+      term = &matcher->terms[matcher->n_terms++];
+      term->term = terms[n];
+      term->length = strlen (terms[n]);
+
+      for (p = terms[n]; *p != '\0'; p++)
+        if ((guchar) *p >= 0x80)
+          matcher->ascii_terms = FALSE;
+
+      /* the terms are case folded already, the names are folded
+       * while comparing, so skip on both cases of a letter */
+      for (i = 0; i < G_N_ELEMENTS (term->shift); i++)
+        term->shift[i] = term->length;
+      for (i = 0; i + 1 < term->length; i++)
+        {
+          c = terms[n][i];
+          term->shift[c] = term->length - 1 - i;
+          term->shift[(guchar) g_ascii_toupper (c)] = term->length - 1 - i;
+        }
+    }
+
+  return matcher;
+}
+
+
+
+/**
+ * thunar_util_search_matcher_free:
+ * @matcher: a #ThunarSearchMatcher.
+ *
+ * Frees a matcher created with thunar_util_search_matcher_new().
+ **/
+void
+thunar_util_search_matcher_free (ThunarSearchMatcher *matcher)
+{
+  if (matcher == NULL)
+    return;
+
+  g_list_free_full (matcher->predicates, thunar_util_search_predicate_free);
+  g_free (matcher->terms);
+  g_slice_free (ThunarSearchMatcher, matcher);
+}
+
+
+
+/**
+ * thunar_util_search_matcher_has_predicates:
+ * @matcher: a #ThunarSearchMatcher.
+ *
+ * Return value: TRUE if the query of @matcher has predicates
+ *               on the file attributes besides the name.
+ **/
+gboolean
+thunar_util_search_matcher_has_predicates (const ThunarSearchMatcher *matcher)
+{
+  return matcher->predicates != NULL;
+}
+
+
+
+/**
+ * thunar_util_search_matcher_match_info:
+ * @matcher: a #ThunarSearchMatcher.
+ * @info: the #GFileInfo of a file, with the type, size and
+ *        modification time.
+ *
+ * Evaluates the predicates of @matcher on @info, which
+ * is cheap enough to do for every entry of a folder.
+ *
+ * Return value: TRUE if all predicates match, FALSE otherwise.
+ **/
+gboolean
+thunar_util_search_matcher_match_info (const ThunarSearchMatcher *matcher,
+                                       GFileInfo                 *info)
+{
+  ThunarSearchPredicate *predicate;
+  guint64                value;
+  guint64                mtime;
+  GList                 *lp;
+  gint                   cmp;
+
+  for (lp = matcher->predicates; lp != NULL; lp = lp->next)
+    {
+      predicate = lp->data;
+      switch (predicate->kind)
+        {
+        case THUNAR_SEARCH_PREDICATE_SIZE:
+          value = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_SIZE);
+          break;
+
+        case THUNAR_SEARCH_PREDICATE_MODIFIED:
+          mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+          value = (mtime < matcher->now) ? matcher->now - mtime : 0;
+          break;
+
+        case THUNAR_SEARCH_PREDICATE_TYPE:
+          value = g_file_info_get_file_type (info);
+          break;
+
+        default:
+          _thunar_assert_not_reached ();
+          return FALSE;
+        }
+
+      cmp = (value > predicate->value) - (value < predicate->value);
+      if (cmp != predicate->cmp && !(cmp == 0 && predicate->equal))
+        return FALSE;
+    }
+
+  return TRUE;
+}
+
+
+
+static gboolean
+thunar_util_search_matcher_find (const ThunarSearchMatcherTerm *term,
+                                 const guchar                  *str,
+                                 gsize                          length)
+{
+  gsize pos;
+  gsize j;
+
+  if (term->length > length)
+    return FALSE;
+
+  for (pos = 0; pos <= length - term->length; pos += term->shift[str[pos + term->length - 1]])
+    {
+      for (j = term->length; j > 0 && g_ascii_tolower (str[pos + j - 1]) == (guchar) term->term[j - 1]; j--)
+        ;
+      if (j == 0)
+        return TRUE;
+    }
+
+  return FALSE;
+}
+
+
+
+/**
+ * thunar_util_search_matcher_match_normalized:
+ * @matcher        : a #ThunarSearchMatcher.
+ * @str_normalized : a string normalized with thunar_g_utf8_normalize_for_search().
+ *
+ * Same as thunar_util_search_terms_match(), with the terms of @matcher.
+ *
+ * Return value: TRUE if all terms matched, FALSE otherwise.
+ **/
+gboolean
+thunar_util_search_matcher_match_normalized (const ThunarSearchMatcher *matcher,
+                                             const gchar               *str_normalized)
+{
+  gsize length;
+  guint n;
+
+  if (G_UNLIKELY (str_normalized == NULL))
+    return FALSE;
+
+  length = strlen (str_normalized);
+  for (n = 0; n < matcher->n_terms; n++)
+    if (!thunar_util_search_matcher_find (&matcher->terms[n], (const guchar *) str_normalized, length))
+      return FALSE;
+
+  return TRUE;
+}
+
+
+
+/**
+ * thunar_util_search_matcher_match:
+ * @matcher      : a #ThunarSearchMatcher.
+ * @display_name : a display name, not normalized.
+ *
+ * Checks whether all terms of @matcher are found in @display_name, like
+ * thunar_util_search_terms_match() after thunar_g_utf8_normalize_for_search().
+ * Normalization leaves ASCII unchanged except for the case, so ASCII
+ * names are folded while matching and nothing is allocated for them.
+ *
+ * Return value: TRUE if all terms matched, FALSE otherwise.
+ **/
+gboolean
+thunar_util_search_matcher_match (const ThunarSearchMatcher *matcher,
+                                  const gchar               *display_name)
+{
+  const gchar *p;
+  gchar       *normalized;
+  gboolean     matched;
+  guint        n;
+
+  _thunar_return_val_if_fail (matcher != NULL, FALSE);
+
+  if (G_UNLIKELY (display_name == NULL))
+    return FALSE;
+
+  for (p = display_name; *p != '\0'; p++)
+    if (G_UNLIKELY ((guchar) *p >= 0x80))
+      break;
+
+  /* only non-ASCII names need the full Unicode normalization */
+  if (G_UNLIKELY (*p != '\0'))
+    {
+      normalized = thunar_g_utf8_normalize_for_search (display_name, TRUE, TRUE);
+      matched = thunar_util_search_matcher_match_normalized (matcher, normalized);
+      g_free (normalized);
+      return matched;
+    }
+
+  if (!matcher->ascii_terms)
+    return FALSE;
+
+  for (n = 0; n < matcher->n_terms; n++)
+    if (!thunar_util_search_matcher_find (&matcher->terms[n], (const guchar *) display_name, p - display_name))
+      return FALSE;
+
+  return TRUE;
+}
+
+
+
 gboolean
 thunar_util_save_geometry_timer (gpointer user_data)
 {
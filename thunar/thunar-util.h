@@ -43,6 +43,9 @@ typedef enum
 } ThunarNextFileNameMode;
 
 
+typedef struct _ThunarSearchMatcher   ThunarSearchMatcher;
+typedef struct _ThunarSearchPredicate ThunarSearchPredicate;
+
 typedef void (*ThunarBookmarksFunc) (GFile       *file,
                                      const gchar *name,
                                      gint         row_num,
@@ -76,6 +79,17 @@ gchar*      thunar_util_next_new_file_name       (ThunarFile            *dir,
                                                   const gchar           *file_name,
                                                   ThunarNextFileNameMode name_mode,
                                                   gboolean               is_directory);
+gchar      *thunar_util_get_thumbnail_path       (const gchar          *uri,
+                                                  gboolean              is_directory,
+                                                  ThunarThumbnailSize   thumbnail_size) G_GNUC_MALLOC;
+gchar      *thunar_util_get_thumbnail_path_for_hash (const gchar       *uri,
+                                                  const gchar          *uri_hash,
+                                                  gboolean              is_directory,
+                                                  ThunarThumbnailSize   thumbnail_size) G_GNUC_MALLOC;
+gboolean    thunar_util_thumbnail_is_stale       (const gchar          *path,
+                                                  guint64               mtime);
+void        thunar_util_prune_directory          (const gchar          *dirname,
+                                                  guint                 max_files);
 const char *thunar_util_get_search_prefix        (void);
 gboolean    thunar_util_is_a_search_query        (const gchar    *string);
 gchar*      thunar_util_strjoin_list             (GList       *string_list,
@@ -86,9 +100,20 @@ void        thunar_util_clip_view_background     (GtkCellRenderer      *cell,
                                                   GtkWidget            *widget,
                                                   GtkCellRendererState  flags);
 gchar     **thunar_util_split_search_query       (const gchar          *search_query_normalized,
+                                                  GList               **predicates,
                                                   GError              **error);
 gboolean    thunar_util_search_terms_match       (gchar               **terms,
                                                   gchar                *str);
+ThunarSearchMatcher *thunar_util_search_matcher_new             (gchar                    **terms,
+                                                                 GList                     *predicates) G_GNUC_MALLOC;
+void                 thunar_util_search_matcher_free            (ThunarSearchMatcher       *matcher);
+gboolean             thunar_util_search_matcher_has_predicates  (const ThunarSearchMatcher *matcher);
+gboolean             thunar_util_search_matcher_match_info      (const ThunarSearchMatcher *matcher,
+                                                                 GFileInfo                 *info);
+gboolean             thunar_util_search_matcher_match           (const ThunarSearchMatcher *matcher,
+                                                                 const gchar               *display_name);
+gboolean             thunar_util_search_matcher_match_normalized (const ThunarSearchMatcher *matcher,
+                                                                 const gchar               *str_normalized);
 gboolean    thunar_util_save_geometry_timer      (gpointer user_data);
 
 
@@ -0,0 +1,495 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+/* The view settings store keeps the directory specific settings (view
+ * type, sort column and order, zoom levels) of the folders, keyed by
+ * the URI of the folder, so setting up the view of a folder needs no
+ * metadata query through gvfs. The gvfs metadata stays the backing of
+ * the settings: every change is written there as well, and a folder
+ * missing in the store takes over its metadata once, on its first
+ * visit. Folders without settings are remembered as empty entries.
+ *
+ * The store is a text file in the cache directory of the user, which
+ * is mapped into memory when loaded, one folder per line. It is only
+ * used from the main thread. */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include <libxfce4util/libxfce4util.h>
+
+#include "thunar/thunar-private.h"
+#include "thunar/thunar-view-settings.h"
+
+
+
+/* the file of the store in the cache directory */
+#define THUNAR_VIEW_SETTINGS_PATH "Thunar/view-settings"
+
+/* the store forgets the least recently used folders beyond this number */
+#define THUNAR_VIEW_SETTINGS_MAX_DIRECTORIES (2000)
+
+/* the delay between a change and the next write of the store, in seconds */
+#define THUNAR_VIEW_SETTINGS_SAVE_DELAY (10)
+
+/* the last use of a folder is only updated in steps of a day, in seconds */
+#define THUNAR_VIEW_SETTINGS_USE_RESOLUTION (24 * 60 * 60)
+
+
+
+typedef struct
+{
+  gchar      *uri;
+  gint64      last_use; /* in seconds since the epoch */
+  GHashTable *settings; /* name -> value */
+}
+ThunarViewSettingsEntry;
+
+
+
+/* folder uri -> ThunarViewSettingsEntry */
+static GHashTable *view_settings_entries = NULL;
+static guint       view_settings_save_id = 0;
+
+
+
+static ThunarViewSettingsEntry *
+thunar_view_settings_entry_new (gchar *uri)
+{
+  ThunarViewSettingsEntry *entry;
+
+  entry = g_slice_new (ThunarViewSettingsEntry);
+  entry->uri = uri;
+  entry->last_use = 0;
+  entry->settings = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+
+  return entry;
+}
+
+
+
+static void
+thunar_view_settings_entry_free (gpointer data)
+{
+  ThunarViewSettingsEntry *entry = data;
+
+  g_hash_table_destroy (entry->settings);
+  g_free (entry->uri);
+  g_slice_free (ThunarViewSettingsEntry, entry);
+}
+
+
+
+static gint
+thunar_view_settings_entry_compare (gconstpointer a,
+                                    gconstpointer b)
+{
+  const ThunarViewSettingsEntry *entry_a = *(ThunarViewSettingsEntry *const *) a;
+  const ThunarViewSettingsEntry *entry_b = *(ThunarViewSettingsEntry *const *) b;
+
+  /* most recently used first */
+  if (entry_a->last_use != entry_b->last_use)
+    return (entry_a->last_use > entry_b->last_use) ? -1 : 1;
+  return 0;
+}
+
+
+
+static void
+thunar_view_settings_parse_line (const gchar *line,
+                                 gsize        length)
+{
+  ThunarViewSettingsEntry *entry;
+  gchar                  **fields;
+  gchar                   *text;
+  gchar                   *separator;
+  guint                    n;
+
+  /* every line is "<last use>\t<uri>[\t<name>=<value>...]", with the
+   * values escaped by g_strescape(), the uri contains no tabs */
+  text = g_strndup (line, length);
+  fields = g_strsplit (text, "\t", -1);
+  if (g_strv_length (fields) >= 2 && *fields[1] != '\0')
+    {
+      entry = thunar_view_settings_entry_new (g_strdup (fields[1]));
+      entry->last_use = g_ascii_strtoll (fields[0], NULL, 10);
+
+      for (n = 2; fields[n] != NULL; ++n)
+        {
+          separator = strchr (fields[n], '=');
+          if (separator != NULL && separator != fields[n])
+            g_hash_table_replace (entry->settings,
+                                  g_strndup (fields[n], separator - fields[n]),
+                                  g_strcompress (separator + 1));
+        }
+
+      g_hash_table_replace (view_settings_entries, entry->uri, entry);
+    }
+
+  g_strfreev (fields);
+  g_free (text);
+}
+
+
+
+static void
+thunar_view_settings_load (void)
+{
+  GMappedFile *mapped;
+  const gchar *contents;
+  const gchar *end;
+  const gchar *line_end;
+  gchar       *path;
+
+  if (G_LIKELY (view_settings_entries != NULL))
+    return;
+
+  view_settings_entries = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, thunar_view_settings_entry_free);
+
+  path = xfce_resource_lookup (XFCE_RESOURCE_CACHE, THUNAR_VIEW_SETTINGS_PATH);
+  if (path == NULL)
+    return;
+
+  /* map the store instead of reading it, it is parsed right away and
+   * the pages are dropped again when the mapping is released */
+  mapped = g_mapped_file_new (path, FALSE, NULL);
+  if (mapped != NULL)
+    {
+      contents = g_mapped_file_get_contents (mapped);
+      end = contents + g_mapped_file_get_length (mapped);
+
+      while (contents != NULL && contents < end)
+        {
+          line_end = memchr (contents, '\n', end - contents);
+          if (line_end == NULL)
+            line_end = end;
+
+          if (line_end > contents)
+            thunar_view_settings_parse_line (contents, line_end - contents);
+
+          contents = line_end + 1;
+        }
+
+      g_mapped_file_unref (mapped);
+    }
+
+  g_free (path);
+}
+
+
+
+static void
+thunar_view_settings_save (void)
+{
+  ThunarViewSettingsEntry *entry;
+  GHashTableIter           iter;
+  GHashTableIter           setting_iter;
+  const gchar             *name;
+  const gchar             *value;
+  GString                 *contents;
+  GError                  *error = NULL;
+  gchar                   *escaped;
+  gchar                   *path;
+
+  path = xfce_resource_save_location (XFCE_RESOURCE_CACHE, THUNAR_VIEW_SETTINGS_PATH, TRUE);
+  if (G_UNLIKELY (path == NULL))
+    return;
+
+  contents = g_string_sized_new (128 * g_hash_table_size (view_settings_entries));
+
+  g_hash_table_iter_init (&iter, view_settings_entries);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry))
+    {
+      g_string_append_printf (contents, "%" G_GINT64_FORMAT "\t%s", entry->last_use, entry->uri);
+
+      g_hash_table_iter_init (&setting_iter, entry->settings);
+      while (g_hash_table_iter_next (&setting_iter, (gpointer *) &name, (gpointer *) &value))
+        {
+          escaped = g_strescape (value, NULL);
+          g_string_append_printf (contents, "\t%s=%s", name, escaped);
+          g_free (escaped);
+        }
+
+      g_string_append_c (contents, '\n');
+    }
+
+  if (!g_file_set_contents (path, contents->str, contents->len, &error))
+    {
+      g_warning ("Failed to write the folder view settings to \"%s\": %s", path, error->message);
+      g_error_free (error);
+    }
+
+  g_string_free (contents, TRUE);
+  g_free (path);
+}
+
+
+
+static gboolean
+thunar_view_settings_save_timeout (gpointer user_data)
+{
+  view_settings_save_id = 0;
+
+  thunar_view_settings_save ();
+
+  return G_SOURCE_REMOVE;
+}
+
+
+
+static void
+thunar_view_settings_schedule_save (void)
+{
+  if (view_settings_save_id == 0)
+    view_settings_save_id = g_timeout_add_seconds (THUNAR_VIEW_SETTINGS_SAVE_DELAY, thunar_view_settings_save_timeout, NULL);
+}
+
+
+
+static void
+thunar_view_settings_prune (ThunarViewSettingsEntry *keep)
+{
+  ThunarViewSettingsEntry *entry;
+  GHashTableIter           iter;
+  GPtrArray               *entries;
+  guint                    n;
+
+  entries = g_ptr_array_sized_new (g_hash_table_size (view_settings_entries));
+  g_hash_table_iter_init (&iter, view_settings_entries);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &entry))
+    g_ptr_array_add (entries, entry);
+
+  /* drop the least recently used tenth of the folders at once */
+  g_ptr_array_sort (entries, thunar_view_settings_entry_compare);
+  for (n = THUNAR_VIEW_SETTINGS_MAX_DIRECTORIES * 9 / 10; n < entries->len; ++n)
+    {
+      entry = g_ptr_array_index (entries, n);
+      if (entry != keep)
+        g_hash_table_remove (view_settings_entries, entry->uri);
+    }
+  g_ptr_array_free (entries, TRUE);
+}
+
+
+
+static ThunarViewSettingsEntry *
+thunar_view_settings_lookup (GFile    *directory,
+                             gboolean  create)
+{
+  ThunarViewSettingsEntry *entry;
+  gchar                   *uri;
+  gint64                   now;
+
+  thunar_view_settings_load ();
+
+  now = g_get_real_time () / G_USEC_PER_SEC;
+
+  uri = g_file_get_uri (directory);
+  entry = g_hash_table_lookup (view_settings_entries, uri);
+  if (entry == NULL && create)
+    {
+      entry = thunar_view_settings_entry_new (g_steal_pointer (&uri));
+      entry->last_use = now;
+      g_hash_table_insert (view_settings_entries, entry->uri, entry);
+
+      if (G_UNLIKELY (g_hash_table_size (view_settings_entries) > THUNAR_VIEW_SETTINGS_MAX_DIRECTORIES))
+        thunar_view_settings_prune (entry);
+
+      thunar_view_settings_schedule_save ();
+    }
+  g_free (uri);
+
+  if (entry != NULL)
+    {
+      if (now - entry->last_use >= THUNAR_VIEW_SETTINGS_USE_RESOLUTION)
+        {
+          entry->last_use = now;
+          thunar_view_settings_schedule_save ();
+        }
+    }
+
+  return entry;
+}
+
+
+
+/**
+ * thunar_view_settings_has_directory:
+ * @directory : the #GFile of a folder.
+ *
+ * Checks whether the store knows the settings of @directory, even
+ * if there are none. Otherwise the settings of @directory have to be
+ * taken over from its metadata with thunar_view_settings_set() first.
+ *
+ * Return value: %TRUE if @directory is in the store.
+ **/
+gboolean
+thunar_view_settings_has_directory (GFile *directory)
+{
+  _thunar_return_val_if_fail (G_IS_FILE (directory), FALSE);
+
+  return thunar_view_settings_lookup (directory, FALSE) != NULL;
+}
+
+
+
+/**
+ * thunar_view_settings_add_directory:
+ * @directory : the #GFile of a folder.
+ *
+ * Adds @directory to the store without any settings, unless it is
+ * in the store already.
+ **/
+void
+thunar_view_settings_add_directory (GFile *directory)
+{
+  _thunar_return_if_fail (G_IS_FILE (directory));
+
+  thunar_view_settings_lookup (directory, TRUE);
+}
+
+
+
+/**
+ * thunar_view_settings_get:
+ * @directory : the #GFile of a folder.
+ * @name      : the name of the setting, e.g. "thunar-view-type".
+ *
+ * Returns the value of the setting @name of @directory, or %NULL
+ * if the setting is not stored. Release with g_free() after usage.
+ *
+ * Return value: (transfer full): the value of the setting, or %NULL.
+ **/
+gchar *
+thunar_view_settings_get (GFile       *directory,
+                          const gchar *name)
+{
+  ThunarViewSettingsEntry *entry;
+
+  _thunar_return_val_if_fail (G_IS_FILE (directory), NULL);
+  _thunar_return_val_if_fail (name != NULL, NULL);
+
+  entry = thunar_view_settings_lookup (directory, FALSE);
+  if (entry == NULL)
+    return NULL;
+
+  return g_strdup (g_hash_table_lookup (entry->settings, name));
+}
+
+
+
+/**
+ * thunar_view_settings_set:
+ * @directory : the #GFile of a folder.
+ * @name      : the name of the setting, e.g. "thunar-view-type".
+ * @value     : the new value, or %NULL to remove the setting.
+ *
+ * Stores @value as the setting @name of @directory. The store is
+ * written to disk a few seconds later; writing the metadata of
+ * @directory as well is up to the caller.
+ **/
+void
+thunar_view_settings_set (GFile       *directory,
+                          const gchar *name,
+                          const gchar *value)
+{
+  ThunarViewSettingsEntry *entry;
+
+  _thunar_return_if_fail (G_IS_FILE (directory));
+  _thunar_return_if_fail (name != NULL);
+
+  entry = thunar_view_settings_lookup (directory, TRUE);
+  if (value != NULL)
+    {
+      if (g_strcmp0 (g_hash_table_lookup (entry->settings, name), value) == 0)
+        return;
+      g_hash_table_replace (entry->settings, g_strdup (name), g_strdup (value));
+    }
+  else if (!g_hash_table_remove (entry->settings, name))
+    {
+      return;
+    }
+
+  thunar_view_settings_schedule_save ();
+}
+
+
+
+/**
+ * thunar_view_settings_has_any:
+ * @directory : the #GFile of a folder.
+ *
+ * Return value: %TRUE if any setting of @directory is stored.
+ **/
+gboolean
+thunar_view_settings_has_any (GFile *directory)
+{
+  ThunarViewSettingsEntry *entry;
+
+  _thunar_return_val_if_fail (G_IS_FILE (directory), FALSE);
+
+  entry = thunar_view_settings_lookup (directory, FALSE);
+
+  return entry != NULL && g_hash_table_size (entry->settings) > 0;
+}
+
+
+
+/**
+ * thunar_view_settings_clear:
+ * @directory : the #GFile of a folder.
+ *
+ * Removes all settings of @directory, the folder stays in the store
+ * as one without settings.
+ **/
+void
+thunar_view_settings_clear (GFile *directory)
+{
+  ThunarViewSettingsEntry *entry;
+
+  _thunar_return_if_fail (G_IS_FILE (directory));
+
+  entry = thunar_view_settings_lookup (directory, TRUE);
+  if (g_hash_table_size (entry->settings) > 0)
+    {
+      g_hash_table_remove_all (entry->settings);
+      thunar_view_settings_schedule_save ();
+    }
+}
+
+
+
+/**
+ * thunar_view_settings_flush:
+ *
+ * Writes the pending changes to disk right away. Called before the
+ * application quits, so the last changes are not lost.
+ **/
+void
+thunar_view_settings_flush (void)
+{
+  if (view_settings_save_id != 0)
+    {
+      g_source_remove (view_settings_save_id);
+      view_settings_save_id = 0;
+
+      thunar_view_settings_save ();
+    }
+}
@@ -0,0 +1,38 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program; if not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef __THUNAR_VIEW_SETTINGS_H__
+#define __THUNAR_VIEW_SETTINGS_H__
+
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+gboolean thunar_view_settings_has_directory (GFile       *directory);
+void     thunar_view_settings_add_directory (GFile       *directory);
+gchar   *thunar_view_settings_get           (GFile       *directory,
+                                             const gchar *name) G_GNUC_MALLOC;
+void     thunar_view_settings_set           (GFile       *directory,
+                                             const gchar *name,
+                                             const gchar *value);
+gboolean thunar_view_settings_has_any       (GFile       *directory);
+void     thunar_view_settings_clear         (GFile       *directory);
+void     thunar_view_settings_flush         (void);
+
+G_END_DECLS
+
+#endif /* !__THUNAR_VIEW_SETTINGS_H__ */
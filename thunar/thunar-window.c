@@ -40,6 +40,7 @@
 #include "thunar/thunar-clipboard-manager.h"
 #include "thunar/thunar-compact-view.h"
 #include "thunar/thunar-details-view.h"
+#include "thunar/thunar-disk-usage-view.h"
 #include "thunar/thunar-dialogs.h"
 #include "thunar/thunar-shortcuts-pane.h"
 #include "thunar/thunar-gio-extensions.h"
@@ -68,6 +69,11 @@
 
 
 
+/* the smallest level of the image preview mip chain, previews are rarely smaller */
+#define THUNAR_WINDOW_PREVIEW_MIN_MIP_SIZE (128)
+
+
+
 /* Property identifiers */
 enum
 {
@@ -168,7 +174,8 @@ static GtkWidget*thunar_window_notebook_insert_page       (ThunarWindow
                                                            ThunarFile             *directory,
                                                            GType                   view_type,
                                                            gint                    position,
-                                                           ThunarHistory          *history);
+                                                           ThunarHistory          *history,
+                                                           gboolean                suspended);
 static void      thunar_window_notebook_select_current_page(ThunarWindow           *window);
 
 static GtkWidget*thunar_window_paned_notebooks_add        (ThunarWindow           *window);
@@ -219,6 +226,7 @@ static gboolean  thunar_window_action_menubar_changed     (ThunarWindow
 static gboolean  thunar_window_action_detailed_view       (ThunarWindow           *window);
 static gboolean  thunar_window_action_icon_view           (ThunarWindow           *window);
 static gboolean  thunar_window_action_compact_view        (ThunarWindow           *window);
+static gboolean  thunar_window_action_disk_usage_view     (ThunarWindow           *window);
 static gboolean  thunar_window_action_show_toolbar_editor (ThunarWindow           *window);
 static void      thunar_window_replace_view               (ThunarWindow           *window,
                                                            GtkWidget              *view,
@@ -314,6 +322,8 @@ static void      thunar_window_update_bookmarks           (ThunarWindow
 static void      thunar_window_free_bookmarks             (ThunarWindow           *window);
 static void      thunar_window_menu_add_bookmarks         (ThunarWindow           *window,
                                                            GtkMenuShell           *view_menu);
+static void      thunar_window_redirect_menu_tooltips_to_statusbar_recursive (GtkWidget    *menu_item,
+                                                                              ThunarWindow *window);
 static gboolean   thunar_window_check_uca_key_activation                 (ThunarWindow           *window,
                                                                           GdkEventKey            *key_event,
                                                                           gpointer                user_data);
@@ -328,6 +338,9 @@ static void       thunar_window_trash_infobar_clicked                    (GtkInf
 static void       thunar_window_update_embedded_image_preview            (ThunarWindow           *window);
 static void       thunar_window_update_standalone_image_preview          (ThunarWindow           *window);
 static void       thunar_window_selection_changed                        (ThunarWindow           *window);
+static void       thunar_window_preview_image_load                       (ThunarWindow           *window,
+                                                                          const gchar            *thumbnail_path);
+static void       thunar_window_preview_image_clear                      (ThunarWindow           *window);
 static void       thunar_window_finished_thumbnailing                    (ThunarWindow           *window,
                                                                           ThunarThumbnailSize     size,
                                                                           ThunarFile             *file);
@@ -392,6 +405,10 @@ struct _ThunarWindow
   GList                     *bookmarks;
   GFileMonitor              *bookmark_monitor;
 
+  /* the bookmarks menu is only built again after the bookmarks changed */
+  gboolean                   bookmarks_menu_valid;
+  GtkWidget                 *bookmarks_menu_sendto_item;
+
   ThunarClipboardManager    *clipboard;
 
   ThunarPreferences         *preferences;
@@ -481,7 +498,10 @@ struct _ThunarWindow
 
   /* Image Preview thumbnail generation */
   ThunarFile                *preview_image_file;
-  GdkPixbuf                 *preview_image_pixbuf;
+  GCancellable              *preview_image_cancellable;
+
+  /* the decoded thumbnail of the preview, followed by its halved versions */
+  GPtrArray                 *preview_image_mips;
 
   /* Reference to the global job operation history */
   ThunarJobOperationHistory *job_operation_history;
@@ -533,6 +553,7 @@ static XfceGtkActionEntry thunar_window_action_entries[] =
     { THUNAR_WINDOW_ACTION_VIEW_AS_ICONS,                  "<Actions>/ThunarWindow/view-as-icons",                   "<Primary>1",           XFCE_GTK_RADIO_MENU_ITEM, N_ ("_Icon View"),             N_ ("Display folder content in an icon view"),                                       "view-grid-symbolic",      G_CALLBACK (thunar_window_action_icon_view),          },
     { THUNAR_WINDOW_ACTION_VIEW_AS_DETAILED_LIST,          "<Actions>/ThunarWindow/view-as-detailed-list",           "<Primary>2",           XFCE_GTK_RADIO_MENU_ITEM, N_ ("_List View"),             N_ ("Display folder content in a detailed list view"),                               "view-list-symbolic",      G_CALLBACK (thunar_window_action_detailed_view),      },
     { THUNAR_WINDOW_ACTION_VIEW_AS_COMPACT_LIST,           "<Actions>/ThunarWindow/view-as-compact-list",            "<Primary>3",           XFCE_GTK_RADIO_MENU_ITEM, N_ ("_Compact View"),          N_ ("Display folder content in a compact list view"),                                "view-compact-symbolic",   G_CALLBACK (thunar_window_action_compact_view),       },
+    { THUNAR_WINDOW_ACTION_VIEW_AS_DISK_USAGE,             "<Actions>/ThunarWindow/view-as-disk-usage",              "<Primary>4",           XFCE_GTK_RADIO_MENU_ITEM, N_ ("_Disk Usage View"),       N_ ("Display folder content by the disk space it uses"),                             "drive-harddisk-symbolic", G_CALLBACK (thunar_window_action_disk_usage_view),    },
 
     { THUNAR_WINDOW_ACTION_GO_MENU,                        "<Actions>/ThunarWindow/go-menu",                         "",                     XFCE_GTK_MENU_ITEM,       N_ ("_Go"),                    NULL,                                                                                NULL,                      NULL                                                  },
     { THUNAR_WINDOW_ACTION_BOOKMARKS_MENU,                 "<Actions>/ThunarWindow/bookmarks-menu",                  "",                     XFCE_GTK_MENU_ITEM,       N_ ("_Bookmarks"),             NULL,                                                                                NULL,                      NULL                                                  },
@@ -601,6 +622,9 @@ thunar_window_class_init (ThunarWindowClass *klass)
 
   xfce_gtk_translate_action_entries (thunar_window_action_entries, G_N_ELEMENTS (thunar_window_action_entries));
 
+  /* the accel map is global, every window only connects its accel group */
+  xfce_gtk_accel_map_add_entries (thunar_window_action_entries, G_N_ELEMENTS (thunar_window_action_entries));
+
   /**
    * ThunarWindow:current-directory:
    *
@@ -791,7 +815,6 @@ thunar_window_init (ThunarWindow *window)
   window->preferences = thunar_preferences_get ();
 
   window->accel_group = gtk_accel_group_new ();
-  xfce_gtk_accel_map_add_entries (thunar_window_action_entries, G_N_ELEMENTS (thunar_window_action_entries));
   xfce_gtk_accel_group_connect_action_entries (window->accel_group,
                                                thunar_window_action_entries,
                                                G_N_ELEMENTS (thunar_window_action_entries),
@@ -970,8 +993,9 @@ thunar_window_init (ThunarWindow *window)
   g_signal_connect (G_OBJECT (window->right_pane_box), "size-allocate", G_CALLBACK (image_preview_update), window->right_pane_preview_image);
   g_signal_connect_swapped (window->preferences, "notify::misc-image-preview-mode", G_CALLBACK (thunar_window_image_preview_mode_changed), window);
 
-  window->preview_image_pixbuf = NULL;
+  window->preview_image_mips = NULL;
   window->preview_image_file = NULL;
+  window->preview_image_cancellable = NULL;
 
   /* split view: Create panes where the two notebooks */
   window->paned_notebooks = gtk_paned_new (GTK_ORIENTATION_HORIZONTAL);
@@ -1065,6 +1089,7 @@ thunar_window_init (ThunarWindow *window)
   g_type_ensure (THUNAR_TYPE_ICON_VIEW);
   g_type_ensure (THUNAR_TYPE_DETAILS_VIEW);
   g_type_ensure (THUNAR_TYPE_COMPACT_VIEW);
+  g_type_ensure (THUNAR_TYPE_DISK_USAGE_VIEW);
 
   /* load the bookmarks file and monitor */
   window->bookmarks = NULL;
@@ -1221,12 +1246,31 @@ thunar_window_select_files (ThunarWindow *window,
 {
   GList        *thunar_files = NULL;
   ThunarFolder *thunar_folder;
+  GFile        *parent;
+  gchar        *name;
+  gboolean      reload = FALSE;
 
-  /* If possible, reload the current directory to make sure new files got added to the view */
+  /* If possible, reload the current directory to make sure new files got added to the view.
+   * A folder which is still loading picks them up anyway, and one which has all of them
+   * already needn't be enumerated again */
   thunar_folder = thunar_folder_get_for_file (window->current_directory);
   if (thunar_folder != NULL)
     {
-      thunar_folder_reload (thunar_folder, FALSE);
+      for (GList *lp = files_to_select; lp != NULL && !reload && !thunar_folder_get_loading (thunar_folder); lp = lp->next)
+        {
+          parent = g_file_get_parent (lp->data);
+          if (parent != NULL && g_file_equal (parent, thunar_file_get_file (window->current_directory)))
+            {
+              name = g_file_get_basename (lp->data);
+              reload = !thunar_folder_has_file_name (thunar_folder, name);
+              g_free (name);
+            }
+          if (parent != NULL)
+            g_object_unref (parent);
+        }
+
+      if (reload)
+        thunar_folder_reload (thunar_folder, FALSE);
       g_object_unref (thunar_folder);
     }
 
@@ -1446,6 +1490,10 @@ thunar_window_update_view_menu (ThunarWindow *window,
                                                           G_OBJECT (window), window->view_type == THUNAR_TYPE_COMPACT_VIEW, GTK_MENU_SHELL (menu));
   if (window->is_searching == TRUE)
     gtk_widget_set_sensitive (item, FALSE);
+  item = xfce_gtk_toggle_menu_item_new_from_action_entry (get_action_entry (THUNAR_WINDOW_ACTION_VIEW_AS_DISK_USAGE),
+                                                          G_OBJECT (window), window->view_type == THUNAR_TYPE_DISK_USAGE_VIEW, GTK_MENU_SHELL (menu));
+  if (window->is_searching == TRUE)
+    gtk_widget_set_sensitive (item, FALSE);
 
   gtk_widget_show_all (GTK_WIDGET (menu));
 
@@ -1531,15 +1579,33 @@ thunar_window_update_bookmarks_menu (ThunarWindow *window,
 {
   _thunar_return_if_fail (THUNAR_IS_WINDOW (window));
 
-  thunar_gtk_menu_clean (GTK_MENU (menu));
+  /* resolving every bookmark is expensive, so the bookmark items are kept
+   * until the bookmarks change, only the first item follows the selection */
+  if (!window->bookmarks_menu_valid)
+    {
+      thunar_gtk_menu_clean (GTK_MENU (menu));
+      window->bookmarks_menu_sendto_item = NULL;
 
-  thunar_action_manager_append_menu_item (window->action_mgr, GTK_MENU_SHELL (menu),THUNAR_ACTION_MANAGER_ACTION_SENDTO_SHORTCUTS, FALSE);
-  xfce_gtk_menu_append_separator (GTK_MENU_SHELL (menu));
-  thunar_window_menu_add_bookmarks (window, GTK_MENU_SHELL (menu));
+      xfce_gtk_menu_append_separator (GTK_MENU_SHELL (menu));
+      thunar_window_menu_add_bookmarks (window, GTK_MENU_SHELL (menu));
 
-  gtk_widget_show_all (GTK_WIDGET (menu));
+      gtk_widget_show_all (GTK_WIDGET (menu));
+      thunar_window_redirect_menu_tooltips_to_statusbar (window, GTK_MENU (menu));
 
-  thunar_window_redirect_menu_tooltips_to_statusbar (window, GTK_MENU (menu));
+      window->bookmarks_menu_valid = TRUE;
+    }
+  else if (window->bookmarks_menu_sendto_item != NULL)
+    {
+      gtk_widget_destroy (window->bookmarks_menu_sendto_item);
+    }
+
+  window->bookmarks_menu_sendto_item = thunar_action_manager_append_menu_item (window->action_mgr, GTK_MENU_SHELL (menu), THUNAR_ACTION_MANAGER_ACTION_SENDTO_SHORTCUTS, FALSE);
+  if (window->bookmarks_menu_sendto_item != NULL)
+    {
+      gtk_menu_reorder_child (GTK_MENU (menu), window->bookmarks_menu_sendto_item, 0);
+      gtk_widget_show (window->bookmarks_menu_sendto_item);
+      thunar_window_redirect_menu_tooltips_to_statusbar_recursive (window->bookmarks_menu_sendto_item, window);
+    }
 }
 
 
@@ -1584,6 +1650,9 @@ thunar_window_dispose (GObject *object)
   /* disconnect from the current-directory */
   thunar_window_set_current_directory (window, NULL);
 
+  /* stop decoding the image preview */
+  thunar_window_preview_image_clear (window);
+
   (*G_OBJECT_CLASS (thunar_window_parent_class)->dispose) (object);
 }
 
@@ -1606,13 +1675,6 @@ thunar_window_finalize (GObject *object)
       window->preview_image_file = NULL;
     }
 
-  /* clear image preview pixbuf */
-  if (window->preview_image_pixbuf != NULL)
-    {
-      g_object_unref (window->preview_image_pixbuf);
-      window->preview_image_pixbuf = NULL;
-    }
-
   /* disconnect from the volume monitor */
   g_signal_handlers_disconnect_by_data (window->device_monitor, window);
   g_object_unref (window->device_monitor);
@@ -2575,7 +2637,8 @@ thunar_window_notebook_insert_page (ThunarWindow  *window,
                                     ThunarFile    *directory,
                                     GType          view_type,
                                     gint           position,
-                                    ThunarHistory *history)
+                                    ThunarHistory *history,
+                                    gboolean       suspended)
 {
   GtkWidget      *view;
   GtkWidget      *label;
@@ -2591,14 +2654,21 @@ thunar_window_notebook_insert_page (ThunarWindow  *window,
   _thunar_return_val_if_fail (view_type != G_TYPE_NONE, NULL);
   _thunar_return_val_if_fail (history == NULL || THUNAR_IS_HISTORY (history), NULL);
 
-  /* Figure out which sort settings to use */
-  if (window->view == NULL)
+  /* Figure out which sort settings to use, the disk usage view always starts with the largest
+   * folders, without taking that over as the sort order of the other views */
+  if (view_type == THUNAR_TYPE_DISK_USAGE_VIEW)
+    {
+      sort_column = THUNAR_COLUMN_SIZE;
+      sort_order = GTK_SORT_DESCENDING;
+    }
+  else if (window->view == NULL || THUNAR_IS_DISK_USAGE_VIEW (window->view))
     g_object_get (G_OBJECT (window->preferences), "last-sort-column", &sort_column, "last-sort-order", &sort_order, NULL);
   else
     g_object_get (window->view, "sort-column", &sort_column, "sort-order", &sort_order, NULL);
 
-  /* allocate and setup a new view */
-  view = g_object_new (view_type, "current-directory", directory,
+  /* allocate and setup a new view, a suspended one loads the directory when it is shown */
+  view = g_object_new (view_type, "suspended", suspended,
+                                  "current-directory", directory,
                                   "sort-column-default", sort_column,
                                   "sort-order-default", sort_order, NULL);
   thunar_view_set_show_hidden (THUNAR_VIEW (view), window->show_hidden);
@@ -2849,7 +2919,7 @@ thunar_window_notebook_add_new_tab (ThunarWindow        *window,
 
   /* insert the new view */
   page_num = gtk_notebook_get_current_page (GTK_NOTEBOOK (window->notebook_selected));
-  view = thunar_window_notebook_insert_page (window, directory, view_type, page_num + 1, history);
+  view = thunar_window_notebook_insert_page (window, directory, view_type, page_num + 1, history, FALSE);
 
   /* switch to the new view */
   g_object_get (G_OBJECT (window->preferences), "misc-switch-to-new-tab", &switch_to_new_tab, NULL);
@@ -2921,6 +2991,54 @@ thunar_window_notebook_set_current_tab (ThunarWindow *window,
 
 
 
+/**
+ * thunar_window_show_directory:
+ * @window    : a #ThunarWindow.
+ * @directory : a #ThunarFile.
+ *
+ * Switches to the tab of @window which shows @directory, if any.
+ *
+ * Return value: %TRUE if a tab of @window shows @directory.
+ **/
+gboolean
+thunar_window_show_directory (ThunarWindow *window,
+                              ThunarFile   *directory)
+{
+  GtkWidget *notebooks[2];
+  GtkWidget *view;
+  guint      i;
+  gint       n;
+
+  _thunar_return_val_if_fail (THUNAR_IS_WINDOW (window), FALSE);
+  _thunar_return_val_if_fail (THUNAR_IS_FILE (directory), FALSE);
+
+  /* the selected notebook first, so its tab wins over the one in the other pane */
+  notebooks[0] = window->notebook_selected;
+  notebooks[1] = (window->notebook_selected == window->notebook_left) ? window->notebook_right : window->notebook_left;
+
+  for (i = 0; i < G_N_ELEMENTS (notebooks); ++i)
+    {
+      if (notebooks[i] == NULL)
+        continue;
+
+      for (n = 0; n < gtk_notebook_get_n_pages (GTK_NOTEBOOK (notebooks[i])); ++n)
+        {
+          view = gtk_notebook_get_nth_page (GTK_NOTEBOOK (notebooks[i]), n);
+          if (!THUNAR_IS_NAVIGATOR (view)
+              || thunar_navigator_get_current_directory (THUNAR_NAVIGATOR (view)) != directory)
+            continue;
+
+          gtk_notebook_set_current_page (GTK_NOTEBOOK (notebooks[i]), n);
+          thunar_window_focus_view (window, view);
+          return TRUE;
+        }
+    }
+
+  return FALSE;
+}
+
+
+
 void
 thunar_window_update_directories (ThunarWindow *window,
                                   ThunarFile   *old_directory,
@@ -3226,6 +3344,7 @@ thunar_window_update_bookmarks (ThunarWindow *window)
   _thunar_return_if_fail (THUNAR_IS_WINDOW (window));
 
   thunar_window_free_bookmarks (window);
+  window->bookmarks_menu_valid = FALSE;
 
   /* re-create our internal bookmarks according to the bookmark file */
   thunar_util_load_bookmarks (window->bookmark_file,
@@ -3707,7 +3826,7 @@ thunar_window_action_toggle_split_view (ThunarWindow *window)
 
       /* insert the new view */
       page_num = gtk_notebook_get_current_page (GTK_NOTEBOOK (window->notebook_selected));
-      thunar_window_notebook_insert_page (window, directory, view_type, page_num+1, history);
+      thunar_window_notebook_insert_page (window, directory, view_type, page_num+1, history, FALSE);
 
       /* Prevent notebook expand on tab creation */
       g_object_get (G_OBJECT (window->preferences), "last-splitview-separator-position", &last_splitview_separator_position, NULL);
@@ -3883,17 +4002,19 @@ image_preview_update (GtkWidget     *parent,
 {
   ThunarWindow    *window = THUNAR_WINDOW (gtk_widget_get_toplevel (parent));
   GdkPixbuf       *scaled_preview;
+  GdkPixbuf       *source;
+  GdkPixbuf       *mip;
   cairo_surface_t *surface;
   gint             new_size;
   gint             scale_factor;
+  guint            n;
 
   _thunar_return_if_fail (THUNAR_IS_WINDOW (window));
 
   /* there is no image to preview */
-  if (window->preview_image_pixbuf == NULL)
+  if (window->preview_image_mips == NULL)
     return;
 
-
   if (allocation != NULL)
     {
       new_size = allocation->width < allocation->height ?
@@ -3912,7 +4033,24 @@ image_preview_update (GtkWidget     *parent,
     }
 
   scale_factor = gtk_widget_get_scale_factor (parent);
-  scaled_preview = exo_gdk_pixbuf_scale_ratio (window->preview_image_pixbuf, new_size * scale_factor);
+  new_size *= scale_factor;
+
+  /* the pane is allocated again and again at the same size, while the user browses */
+  if (new_size <= 0 || GPOINTER_TO_INT (g_object_get_data (G_OBJECT (image), "preview-size")) == new_size)
+    return;
+  g_object_set_data (G_OBJECT (image), "preview-size", GINT_TO_POINTER (new_size));
+
+  /* scale down the smallest level of the mip chain that is still larger than the preview */
+  source = g_ptr_array_index (window->preview_image_mips, 0);
+  for (n = 1; n < window->preview_image_mips->len; ++n)
+    {
+      mip = g_ptr_array_index (window->preview_image_mips, n);
+      if (MAX (gdk_pixbuf_get_width (mip), gdk_pixbuf_get_height (mip)) < new_size)
+        break;
+      source = mip;
+    }
+
+  scaled_preview = exo_gdk_pixbuf_scale_ratio (source, new_size);
   surface = gdk_cairo_surface_create_from_pixbuf (scaled_preview, scale_factor, gtk_widget_get_window (parent));
   gtk_image_set_from_surface (GTK_IMAGE (image), surface);
 
@@ -4042,6 +4180,18 @@ thunar_window_action_compact_view (ThunarWindow *window)
 
 
 
+static gboolean
+thunar_window_action_disk_usage_view (ThunarWindow *window)
+{
+  if (window->is_searching == FALSE)
+    thunar_window_action_view_changed (window, THUNAR_TYPE_DISK_USAGE_VIEW);
+
+  /* required in case of shortcut activation, in order to signal that the accel key got handled */
+  return TRUE;
+}
+
+
+
 static void
 thunar_window_replace_view (ThunarWindow *window,
                             GtkWidget    *view,
@@ -4116,7 +4266,7 @@ thunar_window_replace_view (ThunarWindow *window,
     page_num = -1;
 
   /* insert the new view */
-  new_view = thunar_window_notebook_insert_page (window, current_directory, view_type, page_num + 1, history);
+  new_view = thunar_window_notebook_insert_page (window, current_directory, view_type, page_num + 1, history, FALSE);
 
   /* if we are replacing the active view, make the new view the active view */
   if (is_current_view)
@@ -5330,42 +5480,96 @@ thunar_window_get_directories (ThunarWindow *window,
 
 
 
+static ThunarFile*
+thunar_window_directory_for_uri (const gchar *uri)
+{
+  ThunarFile *directory;
+
+  /* check if the string looks like an uri */
+  if (!g_uri_is_valid (uri, G_URI_FLAGS_NONE, NULL))
+    return NULL;
+
+  /* get the file for the uri */
+  directory = thunar_file_get_for_uri (uri, NULL);
+  if (G_UNLIKELY (directory == NULL))
+    return NULL;
+
+  if (!thunar_file_is_directory (directory))
+    {
+      g_object_unref (G_OBJECT (directory));
+      return NULL;
+    }
+
+  return directory;
+}
+
+
+
 gboolean
 thunar_window_set_directories (ThunarWindow   *window,
                                gchar         **uris,
                                gint            active_page)
 {
   ThunarFile *directory;
-  guint       n;
+  GtkWidget  *active_view = NULL;
+  GType       view_type;
+  gint        n_uris;
+  gint        position = 0;
+  gint        n;
 
   _thunar_return_val_if_fail (THUNAR_IS_WINDOW (window), FALSE);
   _thunar_return_val_if_fail (uris != NULL, FALSE);
 
-  for (n = 0; uris[n] != NULL; n++)
+  n_uris = g_strv_length (uris);
+  if (active_page < 0 || active_page >= n_uris)
+    active_page = 0;
+
+  /* the active tab is opened first and loads right away, starting
+   * from the snapshot of its folder if there is one */
+  directory = (n_uris > 0) ? thunar_window_directory_for_uri (uris[active_page]) : NULL;
+  if (G_LIKELY (directory != NULL))
     {
-      /* check if the string looks like an uri */
-      if (!g_uri_is_valid (uris[n], G_URI_FLAGS_NONE, NULL))
-        continue;
+      thunar_window_set_current_directory (window, directory);
+      active_view = window->view;
+      g_object_unref (G_OBJECT (directory));
+    }
+
+  /* the other tabs only load their folder when they are shown, or in the
+   * background when the application is idle */
+  for (n = 0; n < n_uris; n++)
+    {
+      if (n == active_page)
+        {
+          /* the tabs after the active one are appended */
+          position = -1;
+          continue;
+        }
 
-      /* get the file for the uri */
-      directory = thunar_file_get_for_uri (uris[n], NULL);
+      directory = thunar_window_directory_for_uri (uris[n]);
       if (G_UNLIKELY (directory == NULL))
         continue;
 
-      /* open the directory in a new notebook */
-      if (thunar_file_is_directory (directory))
+      if (gtk_notebook_get_n_pages (GTK_NOTEBOOK (window->notebook_selected)) == 0)
         {
-          if (gtk_notebook_get_n_pages (GTK_NOTEBOOK (window->notebook_selected)) == 0)
-            thunar_window_set_current_directory (window, directory);
-          else
-            thunar_window_notebook_open_new_tab (window, directory);
+          /* the active tab didn't open, use this one instead */
+          thunar_window_set_current_directory (window, directory);
+          active_view = window->view;
+          position = -1;
+        }
+      else
+        {
+          view_type = thunar_window_view_type_for_directory (window, directory);
+          thunar_window_notebook_insert_page (window, directory, view_type, position, NULL, TRUE);
+          if (position >= 0)
+            position++;
         }
 
       g_object_unref (G_OBJECT (directory));
     }
 
   /* select the page */
-  thunar_window_notebook_set_current_tab (window, active_page);
+  if (active_view != NULL)
+    thunar_window_notebook_set_current_tab (window, gtk_notebook_page_num (GTK_NOTEBOOK (window->notebook_selected), active_view));
 
   /* we succeeded if new pages have been opened */
   return gtk_notebook_get_n_pages (GTK_NOTEBOOK (window->notebook_selected)) > 0;
@@ -5727,7 +5931,7 @@ static void thunar_window_update_embedded_image_preview (ThunarWindow *window)
                 "misc-image-preview-mode", &misc_image_preview_mode,
                 NULL);
 
-  if (window->preview_image_pixbuf != NULL)
+  if (window->preview_image_mips != NULL)
     {
       image_preview_update (window->sidepane_box, NULL, window->sidepane_preview_image);
       if (last_image_preview_visible == TRUE && misc_image_preview_mode == THUNAR_IMAGE_PREVIEW_MODE_EMBEDDED)
@@ -5745,7 +5949,7 @@ static void thunar_window_update_standalone_image_preview (ThunarWindow *window)
 {
   GList *selected_files = thunar_view_get_selected_files (THUNAR_VIEW (window->view));
 
-  if (window->preview_image_pixbuf != NULL)
+  if (window->preview_image_mips != NULL)
     {
       gchar *file_size = thunar_file_get_size_string (selected_files->data);
 
@@ -5792,7 +5996,7 @@ thunar_window_selection_changed (ThunarWindow *window)
   GList    *selected_files = thunar_view_get_selected_files (THUNAR_VIEW (window->view));
 
   /* butttons specific to the Trash location */
-  if (g_list_length (selected_files) > 0)
+  if (selected_files != NULL)
     gtk_widget_set_sensitive (window->trash_infobar_restore_button, TRUE);
   else
     gtk_widget_set_sensitive (window->trash_infobar_restore_button, FALSE);
@@ -5805,12 +6009,8 @@ thunar_window_selection_changed (ThunarWindow *window)
       window->preview_image_file = NULL;
     }
 
-  /* clear image previews */
-  if (window->preview_image_pixbuf != NULL)
-    {
-      g_object_unref (window->preview_image_pixbuf);
-      window->preview_image_pixbuf = NULL;
-    }
+  /* clear image previews, and stop decoding the previous one */
+  thunar_window_preview_image_clear (window);
 
   /* only request new preview thumbnails if the user wants image previews */
   g_object_get (G_OBJECT (window->preferences),
@@ -5818,7 +6018,7 @@ thunar_window_selection_changed (ThunarWindow *window)
                 NULL);
 
   /* get or request a thumbnail */
-  if ((last_image_preview_visible == TRUE) && (g_list_length (selected_files) == 1))
+  if ((last_image_preview_visible == TRUE) && selected_files != NULL && selected_files->next == NULL)
     {
       ThunarFileThumbState state;
 
@@ -5834,7 +6034,7 @@ thunar_window_selection_changed (ThunarWindow *window)
         {
           const gchar *thumbnail_path = thunar_file_get_thumbnail_path (window->preview_image_file, THUNAR_THUMBNAIL_SIZE_XX_LARGE);
           if (thumbnail_path != NULL)
-            window->preview_image_pixbuf = gdk_pixbuf_new_from_file (thumbnail_path, NULL);
+            thunar_window_preview_image_load (window, thumbnail_path);
         }
 
       thunar_window_update_embedded_image_preview (window);
@@ -5860,9 +6060,127 @@ thunar_window_finished_thumbnailing (ThunarWindow       *window,
       if (path == NULL)
         return;
 
-      window->preview_image_pixbuf = gdk_pixbuf_new_from_file (path, NULL);
-      thunar_window_update_embedded_image_preview (window);
-      thunar_window_update_standalone_image_preview (window);
+      /* the previews are updated once the thumbnail is decoded */
+      thunar_window_preview_image_load (window, path);
+    }
+}
+
+
+
+static void
+thunar_window_preview_image_load_thread (GTask        *task,
+                                         gpointer      source_object,
+                                         gpointer      task_data,
+                                         GCancellable *cancellable)
+{
+  const gchar *thumbnail_path = task_data;
+  GPtrArray   *mips;
+  GdkPixbuf   *pixbuf;
+  GError      *error = NULL;
+  gint         width;
+  gint         height;
+
+  pixbuf = gdk_pixbuf_new_from_file (thumbnail_path, &error);
+  if (G_UNLIKELY (pixbuf == NULL))
+    {
+      g_task_return_error (task, error);
+      return;
+    }
+
+  mips = g_ptr_array_new_with_free_func (g_object_unref);
+  g_ptr_array_add (mips, pixbuf);
+
+  /* halve the thumbnail down to the smallest preview size, so a resize of
+   * the pane never scales more than two times down on the main thread */
+  width = gdk_pixbuf_get_width (pixbuf);
+  height = gdk_pixbuf_get_height (pixbuf);
+  while (MAX (width, height) / 2 >= THUNAR_WINDOW_PREVIEW_MIN_MIP_SIZE
+         && !g_cancellable_is_cancelled (cancellable))
+    {
+      width = MAX (width / 2, 1);
+      height = MAX (height / 2, 1);
+      pixbuf = gdk_pixbuf_scale_simple (pixbuf, width, height, GDK_INTERP_BILINEAR);
+      g_ptr_array_add (mips, pixbuf);
+    }
+
+  if (g_task_return_error_if_cancelled (task))
+    {
+      g_ptr_array_unref (mips);
+      return;
+    }
+
+  g_task_return_pointer (task, mips, (GDestroyNotify) g_ptr_array_unref);
+}
+
+
+
+static void
+thunar_window_preview_image_loaded (GObject      *object,
+                                    GAsyncResult *result,
+                                    gpointer      user_data)
+{
+  ThunarWindow *window = THUNAR_WINDOW (object);
+  GPtrArray    *mips;
+
+  /* superseded by a newer selection, or the thumbnail is unreadable */
+  mips = g_task_propagate_pointer (G_TASK (result), NULL);
+  if (mips == NULL)
+    return;
+
+  thunar_window_preview_image_clear (window);
+  window->preview_image_mips = mips;
+
+  thunar_window_update_embedded_image_preview (window);
+  thunar_window_update_standalone_image_preview (window);
+}
+
+
+
+static void
+thunar_window_preview_image_load (ThunarWindow *window,
+                                  const gchar  *thumbnail_path)
+{
+  GTask *task;
+
+  _thunar_return_if_fail (THUNAR_IS_WINDOW (window));
+  _thunar_return_if_fail (thumbnail_path != NULL);
+
+  /* decoding an extra large thumbnail takes too long for the main
+   * thread, a previous decode of the same preview is no longer needed */
+  if (window->preview_image_cancellable != NULL)
+    {
+      g_cancellable_cancel (window->preview_image_cancellable);
+      g_object_unref (window->preview_image_cancellable);
+    }
+  window->preview_image_cancellable = g_cancellable_new ();
+
+  task = g_task_new (window, window->preview_image_cancellable, thunar_window_preview_image_loaded, NULL);
+  g_task_set_task_data (task, g_strdup (thumbnail_path), g_free);
+  g_task_run_in_thread (task, thunar_window_preview_image_load_thread);
+  g_object_unref (task);
+}
+
+
+
+static void
+thunar_window_preview_image_clear (ThunarWindow *window)
+{
+  _thunar_return_if_fail (THUNAR_IS_WINDOW (window));
+
+  if (window->preview_image_cancellable != NULL)
+    {
+      g_cancellable_cancel (window->preview_image_cancellable);
+      g_clear_object (&window->preview_image_cancellable);
+    }
+
+  if (window->preview_image_mips != NULL)
+    {
+      g_ptr_array_unref (window->preview_image_mips);
+      window->preview_image_mips = NULL;
+
+      /* the next image is scaled even if it gets the size of this one */
+      g_object_set_data (G_OBJECT (window->sidepane_preview_image), "preview-size", NULL);
+      g_object_set_data (G_OBJECT (window->right_pane_preview_image), "preview-size", NULL);
     }
 }
 
@@ -80,6 +80,7 @@ typedef enum
   THUNAR_WINDOW_ACTION_VIEW_AS_ICONS,
   THUNAR_WINDOW_ACTION_VIEW_AS_DETAILED_LIST,
   THUNAR_WINDOW_ACTION_VIEW_AS_COMPACT_LIST,
+  THUNAR_WINDOW_ACTION_VIEW_AS_DISK_USAGE,
   THUNAR_WINDOW_ACTION_GO_MENU,
   THUNAR_WINDOW_ACTION_BOOKMARKS_MENU,
   THUNAR_WINDOW_ACTION_OPEN_PARENT,
@@ -120,6 +121,8 @@ gboolean                  thunar_window_set_directories                     (Thu
 void                      thunar_window_update_directories                  (ThunarWindow        *window,
                                                                              ThunarFile          *old_directory,
                                                                              ThunarFile          *new_directory);
+gboolean                  thunar_window_show_directory                      (ThunarWindow        *window,
+                                                                             ThunarFile          *directory);
 void                      thunar_window_notebook_toggle_split_view          (ThunarWindow        *window);
 void                      thunar_window_notebook_open_new_tab               (ThunarWindow        *window,
                                                                              ThunarFile          *directory);
@@ -360,6 +360,108 @@ thunarx_file_info_get_location (ThunarxFileInfo *file_info)
 
 
 
+/**
+ * thunarx_file_info_peek_name:
+ * @file_info : a #ThunarxFileInfo.
+ *
+ * Like thunarx_file_info_get_name(), but returns the name owned by
+ * @file_info instead of a copy. Use this when processing many files,
+ * where the copies add up.
+ *
+ * The string is only valid until @file_info changes or the main loop
+ * runs again, so don't keep it around.
+ *
+ * Returns: (transfer none): the real name of the file represented by @file_info.
+ *
+ * Since: 4.20
+ **/
+const gchar*
+thunarx_file_info_peek_name (ThunarxFileInfo *file_info)
+{
+  ThunarxFileInfoIface *iface;
+  gchar                *name;
+
+  g_return_val_if_fail (THUNARX_IS_FILE_INFO (file_info), NULL);
+
+  iface = THUNARX_FILE_INFO_GET_IFACE (file_info);
+  if (iface->peek_name != NULL)
+    return (*iface->peek_name) (file_info);
+
+  /* the file manager doesn't support borrowing, keep a copy on the object */
+  name = (*iface->get_name) (file_info);
+  g_object_set_data_full (G_OBJECT (file_info), I_("thunarx-file-info-peek-name"), name, g_free);
+  return name;
+}
+
+
+
+/**
+ * thunarx_file_info_peek_mime_type:
+ * @file_info : a #ThunarxFileInfo.
+ *
+ * Like thunarx_file_info_get_mime_type(), but returns the MIME-type
+ * owned by @file_info instead of a copy.
+ *
+ * The string is only valid until @file_info changes or the main loop
+ * runs again, so don't keep it around.
+ *
+ * Returns: (transfer none) (nullable): the MIME-type for @file_info or %NULL.
+ *
+ * Since: 4.20
+ **/
+const gchar*
+thunarx_file_info_peek_mime_type (ThunarxFileInfo *file_info)
+{
+  ThunarxFileInfoIface *iface;
+  gchar                *mime_type;
+
+  g_return_val_if_fail (THUNARX_IS_FILE_INFO (file_info), NULL);
+
+  iface = THUNARX_FILE_INFO_GET_IFACE (file_info);
+  if (iface->peek_mime_type != NULL)
+    return (*iface->peek_mime_type) (file_info);
+
+  mime_type = (*iface->get_mime_type) (file_info);
+  g_object_set_data_full (G_OBJECT (file_info), I_("thunarx-file-info-peek-mime-type"), mime_type, g_free);
+  return mime_type;
+}
+
+
+
+/**
+ * thunarx_file_info_peek_file_info:
+ * @file_info : a #ThunarxFileInfo.
+ *
+ * Like thunarx_file_info_get_file_info(), but returns the #GFileInfo
+ * without a new reference. The #GFileInfo must not be modified.
+ *
+ * The object is only valid until @file_info changes or the main loop
+ * runs again, take a reference with g_object_ref() to keep it.
+ *
+ * Returns: (transfer none) (nullable): the #GFileInfo object associated
+ *          with @file_info or %NULL.
+ *
+ * Since: 4.20
+ **/
+GFileInfo*
+thunarx_file_info_peek_file_info (ThunarxFileInfo *file_info)
+{
+  ThunarxFileInfoIface *iface;
+  GFileInfo            *info;
+
+  g_return_val_if_fail (THUNARX_IS_FILE_INFO (file_info), NULL);
+
+  iface = THUNARX_FILE_INFO_GET_IFACE (file_info);
+  if (iface->peek_file_info != NULL)
+    return (*iface->peek_file_info) (file_info);
+
+  info = (*iface->get_file_info) (file_info);
+  g_object_set_data_full (G_OBJECT (file_info), I_("thunarx-file-info-peek-file-info"), info, g_object_unref);
+  return info;
+}
+
+
+
 /**
  * thunarx_file_info_changed:
  * @file_info : a #ThunarxFileInfo.
@@ -446,3 +548,67 @@ thunarx_file_info_list_free (GList *file_infos)
 {
   g_list_free_full (file_infos, g_object_unref);
 }
+
+
+
+/**
+ * thunarx_file_info_list_query_info:
+ * @file_infos : (element-type ThunarxFileInfo): a #GList of #ThunarxFileInfo<!---->s.
+ * @attributes : an attribute query string, like for g_file_query_info().
+ *
+ * Returns the @attributes of all @file_infos in one go, from the
+ * information the file manager already has, so no I/O is done. Only
+ * the matching attributes are copied, which is much cheaper than
+ * calling thunarx_file_info_get_file_info() for every file when only
+ * a few attributes are needed. Attributes the file manager didn't
+ * query are not set in the returned #GFileInfo<!---->s.
+ *
+ * The caller is responsible to free the returned array using
+ * g_ptr_array_unref() when no longer needed.
+ *
+ * Returns: (transfer full) (element-type GFileInfo): a #GFileInfo with the
+ *          @attributes of each of the @file_infos, in the same order.
+ *
+ * Since: 4.20
+ **/
+GPtrArray*
+thunarx_file_info_list_query_info (GList       *file_infos,
+                                   const gchar *attributes)
+{
+  GFileAttributeMatcher *matcher;
+  GFileAttributeType     type;
+  GFileInfo             *source;
+  GFileInfo             *info;
+  GPtrArray             *infos;
+  gpointer               value;
+  gchar                **names;
+  GList                 *lp;
+  guint                  n;
+
+  g_return_val_if_fail (attributes != NULL, NULL);
+
+  matcher = g_file_attribute_matcher_new (attributes);
+  infos = g_ptr_array_new_full (g_list_length (file_infos), g_object_unref);
+
+  for (lp = file_infos; lp != NULL; lp = lp->next)
+    {
+      info = g_file_info_new ();
+      g_ptr_array_add (infos, info);
+
+      source = thunarx_file_info_peek_file_info (lp->data);
+      if (G_UNLIKELY (source == NULL))
+        continue;
+
+      /* copy only the requested attributes of the borrowed info */
+      names = g_file_info_list_attributes (source, NULL);
+      for (n = 0; names != NULL && names[n] != NULL; ++n)
+        if (g_file_attribute_matcher_matches (matcher, names[n])
+            && g_file_info_get_attribute_data (source, names[n], &type, &value, NULL))
+          g_file_info_set_attribute (info, names[n], type, value);
+      g_strfreev (names);
+    }
+
+  g_file_attribute_matcher_unref (matcher);
+
+  return infos;
+}
@@ -83,6 +83,9 @@ typedef struct _ThunarxFileInfo      ThunarxFileInfo;
  * @get_file_info: See thunarx_file_info_get_file_info().
  * @get_filesystem_info: See thunarx_filesystem_info_get_filesystem_info().
  * @get_location: See thunarx_location_get_location().
+ * @peek_name: See thunarx_file_info_peek_name(). Since: 4.20
+ * @peek_mime_type: See thunarx_file_info_peek_mime_type(). Since: 4.20
+ * @peek_file_info: See thunarx_file_info_peek_file_info(). Since: 4.20
  * @changed: See thunarx_file_info_changed().
  * @renamed: See thunarx_file_info_renamed().
  *
@@ -114,10 +117,11 @@ struct _ThunarxFileInfoIface
   GFileInfo *(*get_filesystem_info) (ThunarxFileInfo *file_info);
   GFile     *(*get_location)        (ThunarxFileInfo *file_info);
 
+  const gchar *(*peek_name)         (ThunarxFileInfo *file_info);
+  const gchar *(*peek_mime_type)    (ThunarxFileInfo *file_info);
+  GFileInfo   *(*peek_file_info)    (ThunarxFileInfo *file_info);
+
   /*< private >*/
-  void (*reserved0) (void);
-  void (*reserved1) (void);
-  void (*reserved2) (void);
   void (*reserved3) (void);
   void (*reserved4) (void);
   void (*reserved5) (void);
@@ -152,6 +156,10 @@ GFileInfo *thunarx_file_info_get_file_info       (ThunarxFileInfo *file_info);
 GFileInfo *thunarx_file_info_get_filesystem_info (ThunarxFileInfo *file_info);
 GFile     *thunarx_file_info_get_location        (ThunarxFileInfo *file_info);
 
+const gchar *thunarx_file_info_peek_name         (ThunarxFileInfo *file_info);
+const gchar *thunarx_file_info_peek_mime_type    (ThunarxFileInfo *file_info);
+GFileInfo   *thunarx_file_info_peek_file_info    (ThunarxFileInfo *file_info);
+
 void       thunarx_file_info_changed             (ThunarxFileInfo *file_info);
 void       thunarx_file_info_renamed             (ThunarxFileInfo *file_info);
 
@@ -163,6 +171,9 @@ GType      thunarx_file_info_list_get_type       (void) G_GNUC_CONST;
 GList     *thunarx_file_info_list_copy           (GList           *file_infos);
 void       thunarx_file_info_list_free           (GList           *file_infos);
 
+GPtrArray *thunarx_file_info_list_query_info     (GList           *file_infos,
+                                                  const gchar     *attributes) G_GNUC_MALLOC;
+
 G_END_DECLS
 
 #endif /* !__THUNARX_FILE_INFO_H__ */
@@ -0,0 +1,701 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string.h>
+
+#include <gdk-pixbuf/gdk-pixbuf.h>
+#include <libxfce4util/libxfce4util.h>
+
+#ifdef HAVE_EXIF
+#include <libexif/exif-data.h>
+#include <libexif/exif-loader.h>
+#endif
+
+#include "thunarx/thunarx-file-metadata.h"
+#include "thunarx/thunarx-private.h"
+
+
+
+/* number of files whose metadata is kept in the cache */
+#define THUNARX_FILE_METADATA_CACHE_SIZE      (16 * 1024)
+
+/* never read more than this from a file, the headers we are
+ * looking for are always located at the start of the file */
+#define THUNARX_FILE_METADATA_MAX_HEADER_SIZE (512 * 1024)
+#define THUNARX_FILE_METADATA_CHUNK_SIZE      (8 * 1024)
+
+
+
+typedef struct _ThunarxFileMetadataEntry   ThunarxFileMetadataEntry;
+typedef struct _ThunarxFileMetadataRequest ThunarxFileMetadataRequest;
+
+
+
+static ThunarxFileMetadata        *thunarx_file_metadata_load          (GFile                      *location,
+                                                                        GCancellable               *cancellable,
+                                                                        GError                    **error);
+static void                        thunarx_file_metadata_size_prepared (GdkPixbufLoader            *loader,
+                                                                        gint                        width,
+                                                                        gint                        height,
+                                                                        ThunarxFileMetadata        *metadata);
+static ThunarxFileMetadata        *thunarx_file_metadata_cache_lookup  (const gchar                *uri,
+                                                                        guint64                     mtime,
+                                                                        guint64                     size);
+static void                        thunarx_file_metadata_cache_insert  (const gchar                *uri,
+                                                                        guint64                     mtime,
+                                                                        guint64                     size,
+                                                                        ThunarxFileMetadata        *metadata);
+static void                        thunarx_file_metadata_entry_free    (ThunarxFileMetadataEntry   *entry);
+static ThunarxFileMetadataRequest *thunarx_file_metadata_request_new   (ThunarxFileInfo            *file_info);
+static void                        thunarx_file_metadata_request_free  (ThunarxFileMetadataRequest *request);
+static void                        thunarx_file_metadata_thread        (GTask                      *task,
+                                                                        gpointer                    source_object,
+                                                                        gpointer                    task_data,
+                                                                        GCancellable               *cancellable);
+
+
+
+#ifdef HAVE_EXIF
+/* the Exif tags extracted from the files, these are
+ * the names that can be passed to thunarx_file_metadata_get_exif() */
+static const struct
+{
+  const gchar *name;
+  ExifTag      tag;
+} THUNARX_FILE_METADATA_EXIF[] =
+{
+  { "DateTime",          EXIF_TAG_DATE_TIME,           },
+  { "DateTimeOriginal",  EXIF_TAG_DATE_TIME_ORIGINAL,  },
+  { "DateTimeDigitized", EXIF_TAG_DATE_TIME_DIGITIZED, },
+  { "Make",              EXIF_TAG_MAKE,                },
+  { "Model",             EXIF_TAG_MODEL,               },
+  { "ExposureTime",      EXIF_TAG_EXPOSURE_TIME,       },
+  { "ExposureProgram",   EXIF_TAG_EXPOSURE_PROGRAM,    },
+  { "ApertureValue",     EXIF_TAG_APERTURE_VALUE,      },
+  { "MeteringMode",      EXIF_TAG_METERING_MODE,       },
+  { "Flash",             EXIF_TAG_FLASH,               },
+  { "FocalLength",       EXIF_TAG_FOCAL_LENGTH,        },
+  { "ShutterSpeedValue", EXIF_TAG_SHUTTER_SPEED_VALUE, },
+  { "ISOSpeedRatings",   EXIF_TAG_ISO_SPEED_RATINGS,   },
+  { "Software",          EXIF_TAG_SOFTWARE,            },
+  { "ImageDescription",  EXIF_TAG_IMAGE_DESCRIPTION,   },
+  { "UserComment",       EXIF_TAG_USER_COMMENT,        },
+};
+#endif
+
+
+
+struct _ThunarxFileMetadata
+{
+  gint   ref_count;
+
+  gchar *format_name;
+  gchar *format_description;
+  gint   width;
+  gint   height;
+
+#ifdef HAVE_EXIF
+  gchar *exif[G_N_ELEMENTS (THUNARX_FILE_METADATA_EXIF)];
+#endif
+};
+
+struct _ThunarxFileMetadataEntry
+{
+  gchar               *uri;
+  guint64              mtime;
+  guint64              size;
+  ThunarxFileMetadata *metadata;
+
+  /* link in the cache_lru queue, data points to the entry */
+  GList                lru_link;
+};
+
+struct _ThunarxFileMetadataRequest
+{
+  GFile   *location;
+  gchar   *uri;
+  guint64  mtime;
+  guint64  size;
+};
+
+
+
+/* the cache is shared by all extensions and accessed from the worker threads */
+G_LOCK_DEFINE_STATIC (cache_lock);
+static GHashTable *cache_table = NULL;
+static GQueue      cache_lru = G_QUEUE_INIT;
+
+/**
+ * SECTION: thunarx-file-metadata
+ * @short_description: Cached image and Exif information about files
+ * @title: ThunarxFileMetadata
+ * @include: thunarx/thunarx.h
+ *
+ * #ThunarxFileMetadata provides extensions with the image format, the image
+ * dimensions and the most common Exif tags of a file. Only the headers of the
+ * file are read and the results are kept in a cache shared by all extensions,
+ * keyed by the URI, the modification time and the size of the file, so asking
+ * again for an unmodified file does not touch the disk.
+ */
+
+
+
+GType
+thunarx_file_metadata_get_type (void)
+{
+  static GType type = G_TYPE_INVALID;
+
+  if (G_UNLIKELY (type == G_TYPE_INVALID))
+    {
+      type = g_boxed_type_register_static (I_("ThunarxFileMetadata"),
+                                           (GBoxedCopyFunc) thunarx_file_metadata_ref,
+                                           (GBoxedFreeFunc) thunarx_file_metadata_unref);
+    }
+
+  return type;
+}
+
+
+
+static ThunarxFileMetadata*
+thunarx_file_metadata_load (GFile         *location,
+                            GCancellable  *cancellable,
+                            GError       **error)
+{
+  ThunarxFileMetadata *metadata;
+  GFileInputStream    *stream;
+  GdkPixbufLoader     *pixbuf_loader;
+  GdkPixbufFormat     *format;
+  gboolean             pixbuf_done = FALSE;
+  gboolean             exif_done = TRUE;
+  guchar               buffer[THUNARX_FILE_METADATA_CHUNK_SIZE];
+  gssize               n_read;
+  gsize                n_total = 0;
+#ifdef HAVE_EXIF
+  ExifLoader          *exif_loader;
+  ExifEntry           *exif_entry;
+  ExifData            *exif_data;
+  gchar                exif_buffer[1024];
+  guint                n;
+#endif
+
+  stream = g_file_read (location, cancellable, error);
+  if (G_UNLIKELY (stream == NULL))
+    return NULL;
+
+  metadata = g_new0 (ThunarxFileMetadata, 1);
+  metadata->ref_count = 1;
+
+  /* the pixbuf loader tells us the format and the size as soon as it parsed the header */
+  pixbuf_loader = gdk_pixbuf_loader_new ();
+  g_signal_connect (G_OBJECT (pixbuf_loader), "size-prepared", G_CALLBACK (thunarx_file_metadata_size_prepared), metadata);
+
+#ifdef HAVE_EXIF
+  exif_loader = exif_loader_new ();
+  exif_done = FALSE;
+#endif
+
+  /* feed the start of the file to the loaders until both know enough */
+  while ((!pixbuf_done || !exif_done) && n_total < THUNARX_FILE_METADATA_MAX_HEADER_SIZE)
+    {
+      n_read = g_input_stream_read (G_INPUT_STREAM (stream), buffer, sizeof (buffer), cancellable, error);
+      if (G_UNLIKELY (n_read < 0))
+        {
+          thunarx_file_metadata_unref (metadata);
+          metadata = NULL;
+          break;
+        }
+      else if (n_read == 0)
+        break;
+
+      n_total += n_read;
+
+      /* stop feeding the pixbuf loader once the size is known, so the image is not decoded */
+      if (!pixbuf_done)
+        pixbuf_done = !gdk_pixbuf_loader_write (pixbuf_loader, buffer, n_read, NULL) || metadata->width > 0;
+
+#ifdef HAVE_EXIF
+      /* the exif loader returns 0 when it does not need more data */
+      if (!exif_done)
+        exif_done = (exif_loader_write (exif_loader, buffer, n_read) == 0);
+#endif
+    }
+
+  if (G_LIKELY (metadata != NULL))
+    {
+      /* only report a format if we were able to determine the size */
+      format = gdk_pixbuf_loader_get_format (pixbuf_loader);
+      if (format != NULL && metadata->width > 0 && metadata->height > 0)
+        {
+          metadata->format_name = gdk_pixbuf_format_get_name (format);
+          metadata->format_description = gdk_pixbuf_format_get_description (format);
+        }
+
+#ifdef HAVE_EXIF
+      exif_data = exif_loader_get_data (exif_loader);
+      if (G_LIKELY (exif_data != NULL))
+        {
+          for (n = 0; n < G_N_ELEMENTS (THUNARX_FILE_METADATA_EXIF); ++n)
+            {
+              exif_entry = exif_data_get_entry (exif_data, THUNARX_FILE_METADATA_EXIF[n].tag);
+              if (exif_entry != NULL && exif_entry_get_value (exif_entry, exif_buffer, sizeof (exif_buffer)) != NULL)
+                {
+                  metadata->exif[n] = g_utf8_validate (exif_buffer, -1, NULL)
+                                      ? g_strdup (exif_buffer)
+                                      : g_filename_display_name (exif_buffer);
+                }
+            }
+
+          exif_data_unref (exif_data);
+        }
+#endif
+    }
+
+  /* the image is incomplete, so ignore the error */
+  gdk_pixbuf_loader_close (pixbuf_loader, NULL);
+  g_object_unref (G_OBJECT (pixbuf_loader));
+
+#ifdef HAVE_EXIF
+  exif_loader_unref (exif_loader);
+#endif
+
+  g_object_unref (G_OBJECT (stream));
+
+  return metadata;
+}
+
+
+
+static void
+thunarx_file_metadata_size_prepared (GdkPixbufLoader     *loader,
+                                     gint                 width,
+                                     gint                 height,
+                                     ThunarxFileMetadata *metadata)
+{
+  metadata->width = width;
+  metadata->height = height;
+}
+
+
+
+static ThunarxFileMetadata*
+thunarx_file_metadata_cache_lookup (const gchar *uri,
+                                    guint64      mtime,
+                                    guint64      size)
+{
+  ThunarxFileMetadataEntry *entry;
+  ThunarxFileMetadata      *metadata = NULL;
+
+  G_LOCK (cache_lock);
+
+  if (G_LIKELY (cache_table != NULL))
+    {
+      entry = g_hash_table_lookup (cache_table, uri);
+      if (entry != NULL && entry->mtime == mtime && entry->size == size)
+        {
+          metadata = thunarx_file_metadata_ref (entry->metadata);
+
+          /* mark the entry as most recently used */
+          g_queue_unlink (&cache_lru, &entry->lru_link);
+          g_queue_push_head_link (&cache_lru, &entry->lru_link);
+        }
+    }
+
+  G_UNLOCK (cache_lock);
+
+  return metadata;
+}
+
+
+
+static void
+thunarx_file_metadata_cache_insert (const gchar         *uri,
+                                    guint64              mtime,
+                                    guint64              size,
+                                    ThunarxFileMetadata *metadata)
+{
+  ThunarxFileMetadataEntry *entry;
+  GList                    *lp;
+
+  G_LOCK (cache_lock);
+
+  if (G_UNLIKELY (cache_table == NULL))
+    cache_table = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, (GDestroyNotify) thunarx_file_metadata_entry_free);
+
+  /* drop an outdated entry for the uri */
+  entry = g_hash_table_lookup (cache_table, uri);
+  if (entry != NULL)
+    {
+      g_queue_unlink (&cache_lru, &entry->lru_link);
+      g_hash_table_remove (cache_table, uri);
+    }
+
+  entry = g_new0 (ThunarxFileMetadataEntry, 1);
+  entry->uri = g_strdup (uri);
+  entry->mtime = mtime;
+  entry->size = size;
+  entry->metadata = thunarx_file_metadata_ref (metadata);
+  entry->lru_link.data = entry;
+
+  g_hash_table_insert (cache_table, entry->uri, entry);
+  g_queue_push_head_link (&cache_lru, &entry->lru_link);
+
+  /* evict the least recently used entries */
+  while (cache_lru.length > THUNARX_FILE_METADATA_CACHE_SIZE)
+    {
+      lp = g_queue_pop_tail_link (&cache_lru);
+      entry = lp->data;
+      g_hash_table_remove (cache_table, entry->uri);
+    }
+
+  G_UNLOCK (cache_lock);
+}
+
+
+
+static void
+thunarx_file_metadata_entry_free (ThunarxFileMetadataEntry *entry)
+{
+  thunarx_file_metadata_unref (entry->metadata);
+  g_free (entry->uri);
+  g_free (entry);
+}
+
+
+
+static ThunarxFileMetadataRequest*
+thunarx_file_metadata_request_new (ThunarxFileInfo *file_info)
+{
+  ThunarxFileMetadataRequest *request;
+  GFileInfo                  *info;
+
+  request = g_new0 (ThunarxFileMetadataRequest, 1);
+  request->location = thunarx_file_info_get_location (file_info);
+  request->uri = thunarx_file_info_get_uri (file_info);
+
+  /* the modification time and the size tell whether the cached data is still valid */
+  info = thunarx_file_info_get_file_info (file_info);
+  if (G_LIKELY (info != NULL))
+    {
+      request->mtime = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_TIME_MODIFIED);
+      request->size = g_file_info_get_attribute_uint64 (info, G_FILE_ATTRIBUTE_STANDARD_SIZE);
+      g_object_unref (G_OBJECT (info));
+    }
+
+  return request;
+}
+
+
+
+static void
+thunarx_file_metadata_request_free (ThunarxFileMetadataRequest *request)
+{
+  g_object_unref (G_OBJECT (request->location));
+  g_free (request->uri);
+  g_free (request);
+}
+
+
+
+static void
+thunarx_file_metadata_thread (GTask        *task,
+                              gpointer      source_object,
+                              gpointer      task_data,
+                              GCancellable *cancellable)
+{
+  ThunarxFileMetadataRequest *request = task_data;
+  ThunarxFileMetadata        *metadata;
+  GError                     *error = NULL;
+
+  metadata = thunarx_file_metadata_load (request->location, cancellable, &error);
+  if (G_LIKELY (metadata != NULL))
+    {
+      thunarx_file_metadata_cache_insert (request->uri, request->mtime, request->size, metadata);
+      g_task_return_pointer (task, metadata, (GDestroyNotify) thunarx_file_metadata_unref);
+    }
+  else
+    {
+      g_task_return_error (task, error);
+    }
+}
+
+
+
+/**
+ * thunarx_file_metadata_lookup:
+ * @file_info : a #ThunarxFileInfo.
+ *
+ * Returns the metadata for @file_info. If the cache does not
+ * contain up to date metadata for the file, the headers of the
+ * file are parsed in the calling thread, which may block. Use
+ * thunarx_file_metadata_lookup_async() from user interface code.
+ *
+ * The caller is responsible to free the returned object using
+ * thunarx_file_metadata_unref() when no longer needed.
+ *
+ * Returns: (transfer full) (nullable): the #ThunarxFileMetadata
+ *          for @file_info or %NULL if the file could not be read.
+ **/
+ThunarxFileMetadata*
+thunarx_file_metadata_lookup (ThunarxFileInfo *file_info)
+{
+  ThunarxFileMetadataRequest *request;
+  ThunarxFileMetadata        *metadata;
+
+  g_return_val_if_fail (THUNARX_IS_FILE_INFO (file_info), NULL);
+
+  request = thunarx_file_metadata_request_new (file_info);
+
+  metadata = thunarx_file_metadata_cache_lookup (request->uri, request->mtime, request->size);
+  if (metadata == NULL)
+    {
+      metadata = thunarx_file_metadata_load (request->location, NULL, NULL);
+      if (G_LIKELY (metadata != NULL))
+        thunarx_file_metadata_cache_insert (request->uri, request->mtime, request->size, metadata);
+    }
+
+  thunarx_file_metadata_request_free (request);
+
+  return metadata;
+}
+
+
+
+/**
+ * thunarx_file_metadata_lookup_async:
+ * @file_info   : a #ThunarxFileInfo.
+ * @cancellable : (nullable): a #GCancellable or %NULL.
+ * @callback    : the function to call when the metadata is available.
+ * @user_data   : the data to pass to @callback.
+ *
+ * Asynchronous version of thunarx_file_metadata_lookup(). Files
+ * that are not in the cache are parsed in a worker thread. Call
+ * thunarx_file_metadata_lookup_finish() from @callback to get
+ * the result.
+ **/
+void
+thunarx_file_metadata_lookup_async (ThunarxFileInfo     *file_info,
+                                    GCancellable        *cancellable,
+                                    GAsyncReadyCallback  callback,
+                                    gpointer             user_data)
+{
+  ThunarxFileMetadataRequest *request;
+  ThunarxFileMetadata        *metadata;
+  GTask                      *task;
+
+  g_return_if_fail (THUNARX_IS_FILE_INFO (file_info));
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  request = thunarx_file_metadata_request_new (file_info);
+
+  task = g_task_new (NULL, cancellable, callback, user_data);
+  g_task_set_source_tag (task, thunarx_file_metadata_lookup_async);
+
+  /* no need for a thread if the metadata is cached */
+  metadata = thunarx_file_metadata_cache_lookup (request->uri, request->mtime, request->size);
+  if (metadata != NULL)
+    {
+      g_task_return_pointer (task, metadata, (GDestroyNotify) thunarx_file_metadata_unref);
+      thunarx_file_metadata_request_free (request);
+    }
+  else
+    {
+      g_task_set_task_data (task, request, (GDestroyNotify) thunarx_file_metadata_request_free);
+      g_task_run_in_thread (task, thunarx_file_metadata_thread);
+    }
+
+  g_object_unref (G_OBJECT (task));
+}
+
+
+
+/**
+ * thunarx_file_metadata_lookup_finish:
+ * @result : the #GAsyncResult passed to the callback.
+ * @error  : return location for errors or %NULL.
+ *
+ * Finishes an operation started with thunarx_file_metadata_lookup_async().
+ *
+ * Returns: (transfer full) (nullable): the #ThunarxFileMetadata or
+ *          %NULL if the file could not be read or the operation was
+ *          cancelled, in which case @error is set.
+ **/
+ThunarxFileMetadata*
+thunarx_file_metadata_lookup_finish (GAsyncResult  *result,
+                                     GError       **error)
+{
+  g_return_val_if_fail (g_task_is_valid (result, NULL), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  return g_task_propagate_pointer (G_TASK (result), error);
+}
+
+
+
+/**
+ * thunarx_file_metadata_ref:
+ * @metadata : a #ThunarxFileMetadata.
+ *
+ * Increases the reference count on @metadata by one.
+ *
+ * Returns: (transfer full): @metadata.
+ **/
+ThunarxFileMetadata*
+thunarx_file_metadata_ref (ThunarxFileMetadata *metadata)
+{
+  g_return_val_if_fail (metadata != NULL, NULL);
+  g_atomic_int_inc (&metadata->ref_count);
+  return metadata;
+}
+
+
+
+/**
+ * thunarx_file_metadata_unref:
+ * @metadata : a #ThunarxFileMetadata.
+ *
+ * Decreases the reference count on @metadata by one and
+ * frees it once the count drops to zero.
+ **/
+void
+thunarx_file_metadata_unref (ThunarxFileMetadata *metadata)
+{
+#ifdef HAVE_EXIF
+  guint n;
+#endif
+
+  g_return_if_fail (metadata != NULL);
+
+  if (g_atomic_int_dec_and_test (&metadata->ref_count))
+    {
+#ifdef HAVE_EXIF
+      for (n = 0; n < G_N_ELEMENTS (THUNARX_FILE_METADATA_EXIF); ++n)
+        g_free (metadata->exif[n]);
+#endif
+
+      g_free (metadata->format_description);
+      g_free (metadata->format_name);
+      g_free (metadata);
+    }
+}
+
+
+
+/**
+ * thunarx_file_metadata_get_format_name:
+ * @metadata : a #ThunarxFileMetadata.
+ *
+ * Returns the name of the image format of the file, for
+ * example "jpeg", or %NULL if the file is not an image.
+ *
+ * Returns: (nullable): the image format name.
+ **/
+const gchar*
+thunarx_file_metadata_get_format_name (ThunarxFileMetadata *metadata)
+{
+  g_return_val_if_fail (metadata != NULL, NULL);
+  return metadata->format_name;
+}
+
+
+
+/**
+ * thunarx_file_metadata_get_format_description:
+ * @metadata : a #ThunarxFileMetadata.
+ *
+ * Returns the human readable description of the image format
+ * of the file, or %NULL if the file is not an image.
+ *
+ * Returns: (nullable): the image format description.
+ **/
+const gchar*
+thunarx_file_metadata_get_format_description (ThunarxFileMetadata *metadata)
+{
+  g_return_val_if_fail (metadata != NULL, NULL);
+  return metadata->format_description;
+}
+
+
+
+/**
+ * thunarx_file_metadata_get_dimensions:
+ * @metadata      : a #ThunarxFileMetadata.
+ * @width_return  : (out) (optional): return location for the width or %NULL.
+ * @height_return : (out) (optional): return location for the height or %NULL.
+ *
+ * Determines the size of the image in pixels.
+ *
+ * Returns: %TRUE if the file is an image and its size is known.
+ **/
+gboolean
+thunarx_file_metadata_get_dimensions (ThunarxFileMetadata *metadata,
+                                      gint                *width_return,
+                                      gint                *height_return)
+{
+  g_return_val_if_fail (metadata != NULL, FALSE);
+
+  if (metadata->format_name == NULL)
+    return FALSE;
+
+  if (width_return != NULL)
+    *width_return = metadata->width;
+  if (height_return != NULL)
+    *height_return = metadata->height;
+
+  return TRUE;
+}
+
+
+
+/**
+ * thunarx_file_metadata_get_exif:
+ * @metadata : a #ThunarxFileMetadata.
+ * @tag_name : the name of an Exif tag.
+ *
+ * Returns the formatted value of the Exif tag @tag_name. The supported
+ * tags are "DateTime", "DateTimeOriginal", "DateTimeDigitized", "Make",
+ * "Model", "ExposureTime", "ExposureProgram", "ApertureValue",
+ * "MeteringMode", "Flash", "FocalLength", "ShutterSpeedValue",
+ * "ISOSpeedRatings", "Software", "ImageDescription" and "UserComment".
+ *
+ * Returns: (nullable): the UTF-8 value of the tag or %NULL if the file
+ *          does not contain the tag or Exif support is not available.
+ **/
+const gchar*
+thunarx_file_metadata_get_exif (ThunarxFileMetadata *metadata,
+                                const gchar         *tag_name)
+{
+#ifdef HAVE_EXIF
+  guint n;
+#endif
+
+  g_return_val_if_fail (metadata != NULL, NULL);
+  g_return_val_if_fail (tag_name != NULL, NULL);
+
+#ifdef HAVE_EXIF
+  for (n = 0; n < G_N_ELEMENTS (THUNARX_FILE_METADATA_EXIF); ++n)
+    if (strcmp (THUNARX_FILE_METADATA_EXIF[n].name, tag_name) == 0)
+      return metadata->exif[n];
+#endif
+
+  return NULL;
+}
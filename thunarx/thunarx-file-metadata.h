@@ -0,0 +1,57 @@
+/* vi:set et ai sw=2 sts=2 ts=2: */
+/*-
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+#if !defined(THUNARX_INSIDE_THUNARX_H) && !defined(THUNARX_COMPILATION)
+#error "Only <thunarx/thunarx.h> can be included directly, this file may disappear or change contents"
+#endif
+
+#ifndef __THUNARX_FILE_METADATA_H__
+#define __THUNARX_FILE_METADATA_H__
+
+#include "thunarx/thunarx-file-info.h"
+
+G_BEGIN_DECLS
+
+typedef struct _ThunarxFileMetadata ThunarxFileMetadata;
+
+#define THUNARX_TYPE_FILE_METADATA (thunarx_file_metadata_get_type ())
+
+GType                thunarx_file_metadata_get_type               (void) G_GNUC_CONST;
+
+ThunarxFileMetadata *thunarx_file_metadata_lookup                 (ThunarxFileInfo      *file_info);
+void                 thunarx_file_metadata_lookup_async           (ThunarxFileInfo      *file_info,
+                                                                   GCancellable         *cancellable,
+                                                                   GAsyncReadyCallback   callback,
+                                                                   gpointer              user_data);
+ThunarxFileMetadata *thunarx_file_metadata_lookup_finish          (GAsyncResult         *result,
+                                                                   GError              **error);
+
+ThunarxFileMetadata *thunarx_file_metadata_ref                    (ThunarxFileMetadata  *metadata);
+void                 thunarx_file_metadata_unref                  (ThunarxFileMetadata  *metadata);
+
+const gchar         *thunarx_file_metadata_get_format_name        (ThunarxFileMetadata  *metadata);
+const gchar         *thunarx_file_metadata_get_format_description (ThunarxFileMetadata  *metadata);
+gboolean             thunarx_file_metadata_get_dimensions         (ThunarxFileMetadata  *metadata,
+                                                                   gint                 *width_return,
+                                                                   gint                 *height_return);
+const gchar         *thunarx_file_metadata_get_exif               (ThunarxFileMetadata  *metadata,
+                                                                   const gchar          *tag_name);
+
+G_END_DECLS
+
+#endif /* !__THUNARX_FILE_METADATA_H__ */
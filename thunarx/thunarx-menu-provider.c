@@ -53,6 +53,11 @@
  * menu items and menu items provided by other extensions. For example, the menu item provided
  * by the <systemitem class="library">ThunarOpenTerminal</systemitem> extension should be
  * called <literal>ThunarOpenTerminal::open-terminal</literal>.
+ *
+ * Extensions which cannot avoid slow operations, for example talking to a
+ * version control daemon, can implement the asynchronous variants instead,
+ * see thunarx_menu_provider_get_file_menu_items_async(). The file manager
+ * shows the menu right away and inserts their menu items when they arrive.
  */
 
 GType
@@ -254,3 +259,181 @@ thunarx_menu_provider_get_dnd_menu_items (ThunarxMenuProvider *provider,
 
   return items;
 }
+
+
+
+static void
+thunarx_menu_provider_items_free (gpointer data)
+{
+  g_list_free_full (data, g_object_unref);
+}
+
+
+
+/**
+ * thunarx_menu_provider_has_async_menu_items:
+ * @provider : a #ThunarxMenuProvider.
+ *
+ * Checks whether @provider implements the asynchronous variants of the
+ * methods. For other providers, thunarx_menu_provider_get_file_menu_items_async()
+ * and thunarx_menu_provider_get_folder_menu_items_async() simply invoke the
+ * synchronous method and report the result from the main loop.
+ *
+ * Returns: %TRUE if @provider determines its menu items asynchronously.
+ *
+ * Since: 4.20
+ **/
+gboolean
+thunarx_menu_provider_has_async_menu_items (ThunarxMenuProvider *provider)
+{
+  g_return_val_if_fail (THUNARX_IS_MENU_PROVIDER (provider), FALSE);
+
+  return THUNARX_MENU_PROVIDER_GET_IFACE (provider)->get_file_menu_items_async != NULL
+      || THUNARX_MENU_PROVIDER_GET_IFACE (provider)->get_folder_menu_items_async != NULL;
+}
+
+
+
+/**
+ * thunarx_menu_provider_get_file_menu_items_async: (skip)
+ * @provider    : a #ThunarxMenuProvider.
+ * @window      : the #GtkWindow within which the menu items will be used.
+ * @files       : (element-type ThunarxFileInfo): the list of #ThunarxFileInfo<!---->s
+ *                to which the menu items will be applied.
+ * @cancellable : a #GCancellable or %NULL.
+ * @callback    : the #GAsyncReadyCallback to invoke when the menu items are known.
+ * @user_data   : data to pass to @callback.
+ *
+ * Asynchronous variant of thunarx_menu_provider_get_file_menu_items(). When
+ * the menu items are known, @callback is invoked in the thread-default main
+ * context of the caller, which calls thunarx_menu_provider_get_menu_items_finish()
+ * to get them. The file manager cancels @cancellable when the menu is closed
+ * before the items arrived.
+ *
+ * Implementations must complete the request with a #GTask whose source
+ * object is @provider, and return the list of #ThunarxMenuItem<!---->s with
+ * g_task_return_pointer(), using g_object_unref() on every item to free them.
+ * If @provider only implements the synchronous method, that method is
+ * invoked right away and @callback is invoked from the main loop.
+ *
+ * Since: 4.20
+ **/
+void
+thunarx_menu_provider_get_file_menu_items_async (ThunarxMenuProvider *provider,
+                                                 GtkWidget           *window,
+                                                 GList               *files,
+                                                 GCancellable        *cancellable,
+                                                 GAsyncReadyCallback  callback,
+                                                 gpointer             user_data)
+{
+  GTask *task;
+  GList *items = NULL;
+
+  g_return_if_fail (THUNARX_IS_MENU_PROVIDER (provider));
+  g_return_if_fail (GTK_IS_WINDOW (window));
+  g_return_if_fail (files != NULL);
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  if (THUNARX_MENU_PROVIDER_GET_IFACE (provider)->get_file_menu_items_async != NULL)
+    {
+      (*THUNARX_MENU_PROVIDER_GET_IFACE (provider)->get_file_menu_items_async) (provider, window, files, cancellable, callback, user_data);
+      return;
+    }
+
+  /* compatibility path for the synchronous providers */
+  task = g_task_new (provider, cancellable, callback, user_data);
+  g_task_set_source_tag (task, thunarx_menu_provider_get_file_menu_items_async);
+  if (THUNARX_MENU_PROVIDER_GET_IFACE (provider)->get_file_menu_items != NULL)
+    items = (*THUNARX_MENU_PROVIDER_GET_IFACE (provider)->get_file_menu_items) (provider, window, files);
+  g_task_return_pointer (task, items, thunarx_menu_provider_items_free);
+  g_object_unref (task);
+}
+
+
+
+/**
+ * thunarx_menu_provider_get_folder_menu_items_async: (skip)
+ * @provider    : a #ThunarxMenuProvider.
+ * @window      : the #GtkWindow within which the menu items will be used.
+ * @folder      : the folder to which the menu items should will be applied.
+ * @cancellable : a #GCancellable or %NULL.
+ * @callback    : the #GAsyncReadyCallback to invoke when the menu items are known.
+ * @user_data   : data to pass to @callback.
+ *
+ * Asynchronous variant of thunarx_menu_provider_get_folder_menu_items(),
+ * see thunarx_menu_provider_get_file_menu_items_async() for the details.
+ *
+ * Since: 4.20
+ **/
+void
+thunarx_menu_provider_get_folder_menu_items_async (ThunarxMenuProvider *provider,
+                                                   GtkWidget           *window,
+                                                   ThunarxFileInfo     *folder,
+                                                   GCancellable        *cancellable,
+                                                   GAsyncReadyCallback  callback,
+                                                   gpointer             user_data)
+{
+  GTask *task;
+  GList *items = NULL;
+
+  g_return_if_fail (THUNARX_IS_MENU_PROVIDER (provider));
+  g_return_if_fail (GTK_IS_WINDOW (window));
+  g_return_if_fail (THUNARX_IS_FILE_INFO (folder));
+  g_return_if_fail (thunarx_file_info_is_directory (folder));
+  g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  if (THUNARX_MENU_PROVIDER_GET_IFACE (provider)->get_folder_menu_items_async != NULL)
+    {
+      (*THUNARX_MENU_PROVIDER_GET_IFACE (provider)->get_folder_menu_items_async) (provider, window, folder, cancellable, callback, user_data);
+      return;
+    }
+
+  /* compatibility path for the synchronous providers */
+  task = g_task_new (provider, cancellable, callback, user_data);
+  g_task_set_source_tag (task, thunarx_menu_provider_get_folder_menu_items_async);
+  if (THUNARX_MENU_PROVIDER_GET_IFACE (provider)->get_folder_menu_items != NULL)
+    items = (*THUNARX_MENU_PROVIDER_GET_IFACE (provider)->get_folder_menu_items) (provider, window, folder);
+  g_task_return_pointer (task, items, thunarx_menu_provider_items_free);
+  g_object_unref (task);
+}
+
+
+
+/**
+ * thunarx_menu_provider_get_menu_items_finish: (skip)
+ * @provider : a #ThunarxMenuProvider.
+ * @result   : the #GAsyncResult passed to the callback.
+ * @error    : return location for errors or %NULL.
+ *
+ * Finishes thunarx_menu_provider_get_file_menu_items_async() or
+ * thunarx_menu_provider_get_folder_menu_items_async(). Like the
+ * synchronous methods, this takes a reference on @provider for
+ * every returned #ThunarxMenuItem.
+ *
+ * The caller is responsible to free the returned list of menu items
+ * using thunarx_menu_item_list_free() when no longer needed.
+ *
+ * Returns: (transfer full) (element-type ThunarxMenuItem): the list of
+ *          #ThunarxMenuItem<!---->s, or %NULL if @error is set or @provider
+ *          has nothing to offer.
+ *
+ * Since: 4.20
+ **/
+GList*
+thunarx_menu_provider_get_menu_items_finish (ThunarxMenuProvider *provider,
+                                             GAsyncResult        *result,
+                                             GError             **error)
+{
+  GList *items;
+
+  g_return_val_if_fail (THUNARX_IS_MENU_PROVIDER (provider), NULL);
+  g_return_val_if_fail (g_task_is_valid (result, provider), NULL);
+  g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+  items = g_task_propagate_pointer (G_TASK (result), error);
+
+  /* take a reference on the provider for each menu item */
+  thunarx_object_list_take_reference (items, provider);
+
+  return items;
+}
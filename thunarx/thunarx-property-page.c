@@ -52,6 +52,12 @@
  * <filename>tag-page.h</filename> header file would look like this (this is really just
  * an example of the suggested way to implement property pages, you may of course choose
  * a different way)
+ *
+ * Pages that are expensive to fill, because they parse the file or need many
+ * widgets, should override the #ThunarxPropertyPageClass.load method and do
+ * the work there. The file manager calls thunarx_property_page_load() when the
+ * user opens the page for the first time, so the properties dialog opens
+ * quickly and pages that are never looked at cost almost nothing.
  */
 
 /* Property identifiers */
@@ -78,7 +84,11 @@ static void thunarx_property_page_destroy       (GtkWidget                *objec
 
 struct _ThunarxPropertyPagePrivate
 {
-  GtkWidget *label_widget;
+  GtkWidget    *label_widget;
+
+  /* cancelled when the page is destroyed */
+  GCancellable *cancellable;
+  guint         loaded : 1;
 };
 
 
@@ -194,6 +204,13 @@ thunarx_property_page_destroy (GtkWidget *object)
 {
   ThunarxPropertyPage *property_page = THUNARX_PROPERTY_PAGE (object);
 
+  /* stop the work of the load method, the dialog is going away */
+  if (property_page->priv->cancellable != NULL)
+    {
+      g_cancellable_cancel (property_page->priv->cancellable);
+      g_clear_object (&property_page->priv->cancellable);
+    }
+
   /* destroy the label widget (if any) */
   if (G_LIKELY (property_page->priv->label_widget != NULL))
     {
@@ -350,3 +367,62 @@ thunarx_property_page_set_label_widget (ThunarxPropertyPage *property_page,
   g_object_notify (G_OBJECT (property_page), "label-widget");
   g_object_thaw_notify (G_OBJECT (property_page));
 }
+
+
+
+/**
+ * thunarx_property_page_load:
+ * @property_page : a #ThunarxPropertyPage.
+ *
+ * Fills the @property_page by calling its #ThunarxPropertyPageClass.load
+ * method, unless that was done before. The file manager calls this when
+ * the @property_page is shown for the first time, extensions don't need
+ * to call it.
+ *
+ * The load method receives a #GCancellable, which is cancelled when the
+ * @property_page is destroyed, so asynchronous work started there can
+ * stop when the properties dialog is closed.
+ *
+ * Since: 4.20
+ **/
+void
+thunarx_property_page_load (ThunarxPropertyPage *property_page)
+{
+  ThunarxPropertyPageClass *klass;
+
+  g_return_if_fail (THUNARX_IS_PROPERTY_PAGE (property_page));
+
+  if (property_page->priv->loaded)
+    return;
+
+  property_page->priv->loaded = TRUE;
+
+  /* pages without a load method are filled when they are created */
+  klass = THUNARX_PROPERTY_PAGE_GET_CLASS (property_page);
+  if (klass->load != NULL)
+    {
+      property_page->priv->cancellable = g_cancellable_new ();
+      (*klass->load) (property_page, property_page->priv->cancellable);
+    }
+}
+
+
+
+/**
+ * thunarx_property_page_is_loaded:
+ * @property_page : a #ThunarxPropertyPage.
+ *
+ * Returns whether thunarx_property_page_load() was called for the
+ * @property_page. Pages with a #ThunarxPropertyPageClass.load method
+ * can use this to skip updates while they are not filled yet.
+ *
+ * Return value: %TRUE if the @property_page was loaded.
+ *
+ * Since: 4.20
+ **/
+gboolean
+thunarx_property_page_is_loaded (ThunarxPropertyPage *property_page)
+{
+  g_return_val_if_fail (THUNARX_IS_PROPERTY_PAGE (property_page), FALSE);
+  return property_page->priv->loaded;
+}
@@ -40,12 +40,24 @@ typedef struct _ThunarxPropertyPage        ThunarxPropertyPage;
 #define THUNARX_IS_PROPERTY_PAGE_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE ((klass), THUNARX_TYPE_PROPERTY_PAGE))
 #define THUNARX_PROPERTY_PAGE_GET_CLASS(obj)  (G_TYPE_INSTANCE_GET_CLASS ((obj), THUNARX_TYPE_PROPERTY_PAGE))
 
+/**
+ * ThunarxPropertyPageClass:
+ * @load: see thunarx_property_page_load(). Since: 4.20
+ *
+ * Base class for the pages added to the properties dialog.
+ */
 struct _ThunarxPropertyPageClass
 {
+  /*< private >*/
   GtkBinClass __parent__;
 
+  /*< public >*/
+
+  /* virtual methods */
+  void (*load) (ThunarxPropertyPage *property_page,
+                GCancellable        *cancellable);
+
   /*< private >*/
-  void (*reserved1) (void);
   void (*reserved2) (void);
   void (*reserved3) (void);
   void (*reserved4) (void);
@@ -72,6 +84,9 @@ GtkWidget   *thunarx_property_page_get_label_widget      (ThunarxPropertyPage *p
 void         thunarx_property_page_set_label_widget      (ThunarxPropertyPage *property_page,
                                                           GtkWidget           *label_widget);
 
+void         thunarx_property_page_load                  (ThunarxPropertyPage *property_page);
+gboolean     thunarx_property_page_is_loaded             (ThunarxPropertyPage *property_page);
+
 G_END_DECLS
 
 #endif /* !__THUNARX_PROPERTY_PAGE_H__ */
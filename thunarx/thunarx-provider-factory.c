@@ -52,6 +52,10 @@ static void     thunarx_provider_factory_timer_destroy  (gpointer
  * The #ThunarxProviderFactory class allows applications to use Thunar plugins. It handles
  * the loading of the installed extensions and instantiates providers for the application.
  * For example, Thunar uses this class to access the installed extensions.
+ *
+ * An extension is only loaded once a provider type is requested that it declares in the
+ * manifest next to its library, see thunarx-writing-extensions. Extensions without a
+ * manifest are loaded on the first request of any provider type.
  */
 
 typedef struct
@@ -74,12 +78,12 @@ struct _ThunarxProviderFactory
 
   guint                timer_id;  /* GSource timer to cleanup cached providers */
 
-  gint                 initialized;
-
+  GList               *modules;   /* loaded modules whose types are in the infos array */
 };
 
 static gboolean thunarx_provider_modules_created = FALSE;
 static GList *thunarx_provider_modules            = NULL; /* list of all active provider modules */
+static GList *thunarx_pending_provider_modules    = NULL; /* list of provider modules not loaded yet */
 static GList *thunarx_persistent_provider_modules = NULL; /* list of active persistent provider modules */
 static GList *thunarx_volatile_provider_modules   = NULL; /* list of active volatile provider modules */
 
@@ -102,7 +106,7 @@ thunarx_provider_factory_class_init (ThunarxProviderFactoryClass *klass)
 static void
 thunarx_provider_factory_init (ThunarxProviderFactory *factory)
 {
-  factory->initialized = FALSE;
+  factory->modules = NULL;
 }
 
 
@@ -122,6 +126,7 @@ thunarx_provider_factory_finalize (GObject *object)
     if (factory->infos[n].provider != NULL)
       g_object_unref (factory->infos[n].provider);
   g_free (factory->infos);
+  g_list_free (factory->modules);
 
   (*G_OBJECT_CLASS (thunarx_provider_factory_parent_class)->finalize) (object);
 }
@@ -200,9 +205,11 @@ thunarx_provider_factory_create_modules (ThunarxProviderFactory *factory)
                   if (G_UNLIKELY (module_already_loaded == TRUE))
                     continue;
 
-                  /* allocate the new module and add it to our lists */
+                  /* allocate the new module and add it to our lists, it is loaded on demand */
                   module = thunarx_provider_module_new (name);
+                  thunarx_provider_module_read_manifest (module, dirs[i]);
                   thunarx_provider_modules = g_list_prepend (thunarx_provider_modules, module);
+                  thunarx_pending_provider_modules = g_list_prepend (thunarx_pending_provider_modules, module);
                 }
             }
 
@@ -306,45 +313,51 @@ thunarx_provider_factory_list_providers (ThunarxProviderFactory *factory,
   ThunarxProviderInfo *info;
   GList               *providers = NULL;
   GList               *lp;
+  GList               *lnext;
   gint                 n;
 
-  /* create all available modules */
+  /* create all available modules, without loading them yet */
   if (thunarx_provider_modules_created == FALSE)
     {
       thunarx_provider_factory_create_modules (factory);
-
-      /* On the first call, we need to load all modules once, since only when loaded, we can tell if they are persistent or volatile */
-      for (lp = thunarx_provider_modules; lp != NULL; lp = lp->next)
-        {
-          g_type_module_use (G_TYPE_MODULE (lp->data));
-          if (thunarx_provider_plugin_get_resident (THUNARX_PROVIDER_PLUGIN (lp->data)))
-              thunarx_persistent_provider_modules = g_list_prepend (thunarx_persistent_provider_modules, lp->data);
-          else
-              thunarx_volatile_provider_modules = g_list_prepend (thunarx_volatile_provider_modules, lp->data);
-        }
-
       thunarx_provider_modules_created = TRUE;
     }
-  else
+
+  /* volatile modules are reloaded on each call */
+  for (lp = thunarx_volatile_provider_modules; lp != NULL; lp = lp->next)
+    g_type_module_use (G_TYPE_MODULE (lp->data));
+
+  /* load the modules which may provide the type for the first time, since only when loaded, we can tell if they are persistent or volatile */
+  for (lp = thunarx_pending_provider_modules; lp != NULL; lp = lnext)
     {
-      /* volatile modules are reloaded on each call */
-      for (lp = thunarx_volatile_provider_modules; lp != NULL; lp = lp->next)
-        g_type_module_use (G_TYPE_MODULE (lp->data));
+      lnext = lp->next;
+      if (!thunarx_provider_module_provides (THUNARX_PROVIDER_MODULE (lp->data), type))
+        continue;
+
+      g_type_module_use (G_TYPE_MODULE (lp->data));
+      if (thunarx_provider_plugin_get_resident (THUNARX_PROVIDER_PLUGIN (lp->data)))
+          thunarx_persistent_provider_modules = g_list_prepend (thunarx_persistent_provider_modules, lp->data);
+      else
+          thunarx_volatile_provider_modules = g_list_prepend (thunarx_volatile_provider_modules, lp->data);
+
+      thunarx_pending_provider_modules = g_list_delete_link (thunarx_pending_provider_modules, lp);
     }
 
-  if (factory->initialized == FALSE)
-    {
-      for (lp = thunarx_provider_modules; lp != NULL; lp = lp->next)
+  /* add the types of the loaded modules this factory does not know yet */
+  for (lp = thunarx_provider_modules; lp != NULL; lp = lp->next)
+    if (g_list_find (thunarx_pending_provider_modules, lp->data) == NULL
+        && g_list_find (factory->modules, lp->data) == NULL)
+      {
         thunarx_provider_factory_add (factory, THUNARX_PROVIDER_MODULE (lp->data));
+        factory->modules = g_list_prepend (factory->modules, lp->data);
+      }
 
-      if (G_UNLIKELY (factory->timer_id == 0))
-        {
-          /* start the "provider cache" cleanup timer */
-          factory->timer_id = g_timeout_add_seconds_full (G_PRIORITY_LOW, THUNARX_PROVIDER_FACTORY_INTERVAL,
-                                                          thunarx_provider_factory_timer, factory,
-                                                          thunarx_provider_factory_timer_destroy);
-        }
-      factory->initialized = TRUE;
+  if (G_UNLIKELY (factory->timer_id == 0))
+    {
+      /* start the "provider cache" cleanup timer */
+      factory->timer_id = g_timeout_add_seconds_full (G_PRIORITY_LOW, THUNARX_PROVIDER_FACTORY_INTERVAL,
+                                                      thunarx_provider_factory_timer, factory,
+                                                      thunarx_provider_factory_timer_destroy);
     }
 
   /* determine all available providers for the type */
@@ -22,6 +22,8 @@
 #include "config.h"
 #endif
 
+#include <string.h>
+
 #include <gmodule.h>
 
 #include "thunarx/thunarx-private.h"
@@ -30,6 +32,18 @@
 
 
 
+/* The manifest of a module is a key file next to its library, named like the
+ * library with the ".plugin" suffix. It lists the provider interfaces the
+ * module implements, so the module is only loaded once they are requested:
+ *
+ *   [Thunar Extension]
+ *   Interfaces=ThunarxMenuProvider;ThunarxPreferencesProvider;
+ */
+#define MANIFEST_SUFFIX ".plugin"
+#define MANIFEST_GROUP  "Thunar Extension"
+
+
+
 /* Property identifiers */
 enum
 {
@@ -40,6 +54,7 @@ enum
 
 
 static void     thunarx_provider_module_plugin_init   (ThunarxProviderPluginIface  *iface);
+static void     thunarx_provider_module_finalize      (GObject                     *object);
 static void     thunarx_provider_module_get_property  (GObject                     *object,
                                                        guint                        prop_id,
                                                        GValue                      *value,
@@ -68,6 +83,9 @@ struct _ThunarxProviderModule
   GModule *library;
   gboolean resident;
 
+  /* the provider interfaces declared by the manifest, %NULL if there is none */
+  gchar  **interfaces;
+
   void (*initialize) (ThunarxProviderModule *module);
   void (*shutdown)   (void);
   void (*list_types) (const GType **types,
@@ -88,6 +106,7 @@ thunarx_provider_module_class_init (ThunarxProviderModuleClass *klass)
   GObjectClass     *gobject_class;
 
   gobject_class = G_OBJECT_CLASS (klass);
+  gobject_class->finalize = thunarx_provider_module_finalize;
   gobject_class->get_property = thunarx_provider_module_get_property;
   gobject_class->set_property = thunarx_provider_module_set_property;
 
@@ -110,6 +129,17 @@ thunarx_provider_module_init (ThunarxProviderModule *module)
 
 
 
+static void
+thunarx_provider_module_finalize (GObject *object)
+{
+  ThunarxProviderModule *module = THUNARX_PROVIDER_MODULE (object);
+
+  g_strfreev (module->interfaces);
+
+  (*G_OBJECT_CLASS (thunarx_provider_module_parent_class)->finalize) (object);
+}
+
+
 
 static void
 thunarx_provider_module_plugin_init (ThunarxProviderPluginIface *iface)
@@ -340,4 +370,83 @@ thunarx_provider_module_unuse (ThunarxProviderModule *module)
 
   if (G_TYPE_MODULE (module)->use_count > 0)
     g_type_module_unuse (G_TYPE_MODULE (module));
-}
\ No newline at end of file
+}
+
+
+
+/**
+ * thunarx_provider_module_read_manifest:
+ * @module    : a #ThunarxProviderModule.
+ * @directory : the directory containing the library of @module.
+ *
+ * Reads the provider interfaces declared by the manifest of @module
+ * in @directory, if there is one.
+ **/
+void
+thunarx_provider_module_read_manifest (ThunarxProviderModule *module,
+                                       const gchar           *directory)
+{
+  const gchar *name;
+  GKeyFile    *key_file;
+  gchar       *basename;
+  gchar       *path;
+
+  g_return_if_fail (THUNARX_IS_PROVIDER_MODULE (module));
+  g_return_if_fail (directory != NULL);
+
+  /* the manifest of "foo.so" is "foo.plugin" */
+  name = G_TYPE_MODULE (module)->name;
+  basename = g_strndup (name, strlen (name) - strlen ("." G_MODULE_SUFFIX));
+  path = g_strconcat (directory, G_DIR_SEPARATOR_S, basename, MANIFEST_SUFFIX, NULL);
+
+  key_file = g_key_file_new ();
+  if (g_key_file_load_from_file (key_file, path, G_KEY_FILE_NONE, NULL))
+    {
+      g_strfreev (module->interfaces);
+      module->interfaces = g_key_file_get_string_list (key_file, MANIFEST_GROUP, "Interfaces", NULL, NULL);
+      if (G_UNLIKELY (module->interfaces == NULL))
+        g_printerr ("Thunar :Manifest `%s' lacks the provider interfaces.\n", path);
+    }
+
+  g_key_file_free (key_file);
+  g_free (basename);
+  g_free (path);
+}
+
+
+
+/**
+ * thunarx_provider_module_provides:
+ * @module : a #ThunarxProviderModule.
+ * @type   : a provider interface #GType.
+ *
+ * Tells whether @module may provide a @type provider. Modules without
+ * a manifest may provide any type.
+ *
+ * Return value: %FALSE if @module has to be loaded only for other types.
+ **/
+gboolean
+thunarx_provider_module_provides (const ThunarxProviderModule *module,
+                                  GType                        type)
+{
+  GType interface;
+  guint n;
+
+  g_return_val_if_fail (THUNARX_IS_PROVIDER_MODULE (module), FALSE);
+
+  if (module->interfaces == NULL)
+    return TRUE;
+
+  for (n = 0; module->interfaces[n] != NULL; ++n)
+    {
+      /* types of libthunarx not requested yet are not registered, compare the name first */
+      if (g_strcmp0 (module->interfaces[n], g_type_name (type)) == 0)
+        return TRUE;
+
+      interface = g_type_from_name (module->interfaces[n]);
+      if (interface != G_TYPE_INVALID && g_type_is_a (interface, type))
+        return TRUE;
+    }
+
+  return FALSE;
+}
@@ -46,4 +46,9 @@ void                   thunarx_provider_module_list_types (const ThunarxProvider
                                                            gint                        *n_types);
 void                   thunarx_provider_module_unuse      (ThunarxProviderModule       *module);
 
+void                   thunarx_provider_module_read_manifest (ThunarxProviderModule       *module,
+                                                              const gchar                 *directory);
+gboolean               thunarx_provider_module_provides      (const ThunarxProviderModule *module,
+                                                              GType                        type);
+
 #endif /* !__THUNARX_PROVIDER_MODULE_H__ */
@@ -67,6 +67,10 @@ enum
  * each file name and, if the pattern is found, replacing it with the specified
  * replacement text.
  *
+ * Renamers that need to prepare their settings before they can process a file
+ * may also override the thunarx_renamer_process_batch() method, which is
+ * called with many files at once.
+ *
  * The active <type>ThunarxRenamer</type>s user interface is displayed in a frame
  * below the file list, as shown in the screenshot above. Derived classes should try
  * to limit the number of widgets displayed in the main user interface. For example,
@@ -543,6 +547,59 @@ thunarx_renamer_process (ThunarxRenamer  *renamer,
 
 
 
+/**
+ * thunarx_renamer_process_batch:
+ * @renamer : a #ThunarxRenamer.
+ * @files   : (array length=n_files): the #ThunarxFileInfo<!---->s
+ *            of the files whose new names should be determined.
+ * @texts   : (array length=n_files): the parts of the file names to
+ *            which the @renamer should be applied.
+ * @indices : (array length=n_files): the indices of the files in the
+ *            list, used for renamers that work on numbering.
+ * @n_files : the number of elements in @files, @texts and @indices.
+ * @names   : (array length=n_files) (out caller-allocates): return
+ *            location for the @n_files replacements.
+ *
+ * Determines the replacements for all @texts at once, as if
+ * thunarx_renamer_process() was called for every element, and stores
+ * them in @names. Renamers that implement the process_batch method can
+ * check their settings once for all files, others are simply invoked
+ * once per file.
+ *
+ * The caller is responsible to free the strings stored in @names
+ * using g_free() when no longer needed.
+ *
+ * Since: 4.20
+ **/
+void
+thunarx_renamer_process_batch (ThunarxRenamer   *renamer,
+                               ThunarxFileInfo **files,
+                               const gchar     **texts,
+                               const guint      *indices,
+                               guint             n_files,
+                               gchar           **names)
+{
+  ThunarxRenamerClass *klass;
+  guint                n;
+
+  g_return_if_fail (THUNARX_IS_RENAMER (renamer));
+  g_return_if_fail (n_files == 0 || (files != NULL && texts != NULL && indices != NULL && names != NULL));
+
+  klass = THUNARX_RENAMER_GET_CLASS (renamer);
+
+  /* use the batch method if the renamer has one */
+  if (klass->process_batch != NULL)
+    {
+      (*klass->process_batch) (renamer, files, texts, indices, n_files, names);
+      return;
+    }
+
+  for (n = 0; n < n_files; ++n)
+    names[n] = thunarx_renamer_process (renamer, files[n], texts[n], indices[n]);
+}
+
+
+
 /**
  * thunarx_renamer_load:
  * @renamer  : a #ThunarxRenamer.
@@ -45,6 +45,7 @@ typedef struct _ThunarxRenamer        ThunarxRenamer;
 /**
  * ThunarxRenamerClass:
  * @process:        see thunarx_renamer_process().
+ * @process_batch:  see thunarx_renamer_process_batch().
  * @load:           see thunarx_renamer_load().
  * @save:           see thunarx_renamer_save().
  * @get_menu_items: see thunarx_renamer_get_menu_items().
@@ -78,8 +79,14 @@ struct _ThunarxRenamerClass
                             GtkWindow       *window,
                             GList           *files);
 
+  void   (*process_batch)  (ThunarxRenamer   *renamer,
+                            ThunarxFileInfo **files,
+                            const gchar     **texts,
+                            const guint      *indices,
+                            guint             n_files,
+                            gchar           **names);
+
   /*< private >*/
-  void (*reserved0) (void);
   void (*reserved1) (void);
   void (*reserved2) (void);
   void (*reserved3) (void);
@@ -118,6 +125,12 @@ gchar       *thunarx_renamer_process        (ThunarxRenamer   *renamer,
                                              ThunarxFileInfo  *file,
                                              const gchar      *text,
                                              guint             index) G_GNUC_MALLOC;
+void         thunarx_renamer_process_batch  (ThunarxRenamer   *renamer,
+                                             ThunarxFileInfo **files,
+                                             const gchar     **texts,
+                                             const guint      *indices,
+                                             guint             n_files,
+                                             gchar           **names);
 
 void         thunarx_renamer_load           (ThunarxRenamer   *renamer,
                                              GHashTable       *settings);